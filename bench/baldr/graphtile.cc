@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "baldr/compression_utils.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string kTileDir = "test/data/utrecht_tiles";
+
+struct tile_t {
+  GraphId id;
+  std::vector<char> bytes;
+};
+
+// The raw bytes of every Utrecht tile, read once
+const std::vector<tile_t>& Tiles() {
+  static const std::vector<tile_t> tiles = []() {
+    midgard::logging::Configure({{"type", ""}});
+    GraphReader reader(test::make_config(kTileDir).get_child("mjolnir"));
+    std::vector<tile_t> tiles;
+    for (const auto& id : reader.GetTileSet()) {
+      std::ifstream file(kTileDir + filesystem::path::preferred_separator +
+                             GraphTile::FileSuffix(id),
+                         std::ios::binary);
+      tiles.push_back({id, std::vector<char>((std::istreambuf_iterator<char>(file)),
+                                             std::istreambuf_iterator<char>())});
+    }
+    if (tiles.empty()) {
+      throw std::runtime_error("Found no tiles");
+    }
+    return tiles;
+  }();
+  return tiles;
+}
+
+// Gzips bytes the way tiles are gzipped on disk
+std::vector<char> Gzip(const std::vector<char>& bytes) {
+  std::vector<char> gzipped;
+  auto src = [&bytes](z_stream& s) {
+    s.next_in = reinterpret_cast<Byte*>(const_cast<char*>(bytes.data()));
+    s.avail_in = static_cast<unsigned int>(bytes.size());
+    return Z_FINISH;
+  };
+  auto dst = [&gzipped](z_stream& s) {
+    auto size = gzipped.size();
+    if (s.total_out < size) {
+      gzipped.resize(s.total_out);
+    } else {
+      gzipped.resize(size + (1 << 16));
+      s.next_out = reinterpret_cast<Byte*>(gzipped.data() + size);
+      s.avail_out = 1 << 16;
+    }
+  };
+  if (!deflate(src, dst)) {
+    gzipped.clear();
+  }
+  return gzipped;
+}
+
+// Loads every tile from disk and reads its header
+void BM_GraphTileCreate(benchmark::State& state) {
+  const auto& tiles = Tiles();
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (const auto& tile : tiles) {
+      auto graph_tile = GraphTile::Create(kTileDir, tile.id);
+      benchmark::DoNotOptimize(graph_tile);
+      bytes += tile.bytes.size();
+    }
+  }
+  state.counters["Tiles"] =
+      benchmark::Counter(tiles.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_GraphTileCreate)->Unit(benchmark::kMillisecond);
+
+// Builds every tile from bytes already in memory, the way tiles of an extract are
+void BM_GraphTileFromMemory(benchmark::State& state) {
+  const auto& tiles = Tiles();
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (const auto& tile : tiles) {
+      state.PauseTiming();
+      auto memory = tile.bytes;
+      state.ResumeTiming();
+      auto graph_tile = GraphTile::Create(tile.id, std::move(memory));
+      benchmark::DoNotOptimize(graph_tile);
+      bytes += tile.bytes.size();
+    }
+  }
+  state.counters["Tiles"] =
+      benchmark::Counter(tiles.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_GraphTileFromMemory)->Unit(benchmark::kMillisecond);
+
+// Decompresses every tile, the bytes processed are those of the decompressed tiles
+void BM_GraphTileDecompress(benchmark::State& state, const tile_compression_t compression) {
+  const auto& tiles = Tiles();
+  std::vector<std::vector<char>> compressed;
+  for (const auto& tile : tiles) {
+    std::vector<char> bytes;
+    switch (compression) {
+      case tile_compression_t::gzip:
+        bytes = Gzip(tile.bytes);
+        break;
+      case tile_compression_t::zstd:
+        zstd_compress(tile.bytes.data(), tile.bytes.size(), bytes, 3);
+        break;
+      case tile_compression_t::lz4:
+        lz4_compress(tile.bytes.data(), tile.bytes.size(), bytes);
+        break;
+      default:
+        break;
+    }
+    if (bytes.empty()) {
+      state.SkipWithError("Valhalla was built without this compression");
+      return;
+    }
+    compressed.push_back(std::move(bytes));
+  }
+
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      auto graph_tile =
+          GraphTile::DecompressTile(tiles[i].id, compressed[i].data(), compressed[i].size());
+      benchmark::DoNotOptimize(graph_tile);
+      bytes += tiles[i].bytes.size();
+    }
+  }
+  state.counters["Tiles"] =
+      benchmark::Counter(tiles.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_CAPTURE(BM_GraphTileDecompress, gzip, tile_compression_t::gzip)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_GraphTileDecompress, zstd, tile_compression_t::zstd)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_GraphTileDecompress, lz4, tile_compression_t::lz4)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
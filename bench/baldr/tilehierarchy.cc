@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include "baldr/graphid.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/pointll.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// random points over the whole world
+std::vector<PointLL> RandomPoints(size_t count) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> lng(-180, 180), lat(-90, 90);
+  std::vector<PointLL> points;
+  points.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    points.emplace_back(lng(generator), lat(generator));
+  }
+  return points;
+}
+
+// the local tiles of the points from the runtime tiling of the level, dividing by its tile size
+static void BM_TilingTileId(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  const auto& tiles = TileHierarchy::levels().back().tiles;
+  std::vector<GraphId> ids(points.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      ids[i] = GraphId(tiles.TileId(points[i]), 2, 0);
+    }
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.counters["Points"] =
+      benchmark::Counter(points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_TilingTileId)->Arg(4096);
+
+// the local tiles of the points one at a time, with the level known at runtime
+static void BM_GetGraphId(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  std::vector<GraphId> ids(points.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      ids[i] = TileHierarchy::GetGraphId(points[i], 2);
+    }
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.counters["Points"] =
+      benchmark::Counter(points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_GetGraphId)->Arg(4096);
+
+// the local tiles of the points one at a time, with the level known at compile time
+static void BM_GetGraphIdLevel(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  std::vector<GraphId> ids(points.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      ids[i] = TileHierarchy::GetGraphId<2>(points[i]);
+    }
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.counters["Points"] =
+      benchmark::Counter(points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_GetGraphIdLevel)->Arg(4096);
+
+// the local tiles of all the points at once
+static void BM_GetGraphIds(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  std::vector<GraphId> ids(points.size());
+  for (auto _ : state) {
+    TileHierarchy::GetGraphIds(points.data(), points.size(), 2, ids.data());
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.counters["Points"] =
+      benchmark::Counter(points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_GetGraphIds)->Arg(4096);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/location.h"
+#include "loki/search.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "test.h"
+
+using namespace valhalla;
+
+namespace {
+
+// random locations around Utrecht, the reach and radius loki asks for by default
+std::vector<baldr::Location> RandomLocations(size_t count) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> lng(5.03, 5.17), lat(52.05, 52.12);
+  std::vector<baldr::Location> locations;
+  locations.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    locations.emplace_back(midgard::PointLL{lng(generator), lat(generator)},
+                           baldr::Location::StopType::BREAK, 50, 50, 0);
+  }
+  return locations;
+}
+
+// one reader for all the runs so the tiles are cached once
+baldr::GraphReader& Reader() {
+  static const auto config = test::make_config("test/data/utrecht_tiles");
+  static baldr::GraphReader reader(config.get_child("mjolnir"));
+  return reader;
+}
+
+// correlates the locations to the graph at once, the way a matrix or an optimized route does
+void BM_UtrechtSearch(benchmark::State& state, const Costing::Type costing) {
+  midgard::logging::Configure({{"type", ""}});
+  auto& reader = Reader();
+  const auto locations = RandomLocations(state.range(0));
+  Options options;
+  options.set_costing_type(costing);
+  rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  const auto cost = sif::CostFactory().Create(options);
+
+  size_t found = 0;
+  for (auto _ : state) {
+    found += loki::Search(locations, reader, cost).size();
+  }
+  if (found == 0) {
+    state.SkipWithError("Found no matching locations");
+  }
+  state.counters["Locations"] =
+      benchmark::Counter(locations.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_CAPTURE(BM_UtrechtSearch, auto, Costing::auto_)
+    ->RangeMultiplier(10)
+    ->Range(1, 1000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtSearch, pedestrian, Costing::pedestrian)
+    ->RangeMultiplier(10)
+    ->Range(1, 1000)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include "midgard/distanceapproximator.h"
+#include "midgard/pointll.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// random points around Utrecht, the way the searches see them
+std::vector<PointLL> RandomPoints(size_t count) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> lng(4.9, 5.3), lat(51.9, 52.3);
+  std::vector<PointLL> points;
+  points.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    points.emplace_back(lng(generator), lat(generator));
+  }
+  return points;
+}
+
+// the distance between two points that each set their own test point, computing a cosine each
+static void BM_DistanceSquaredCosine(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  for (auto _ : state) {
+    double total = 0;
+    for (size_t i = 1; i < points.size(); ++i) {
+      DistanceApproximator<PointLL> approx(points[i - 1]);
+      total += approx.DistanceSquared(points[i]);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Distances"] =
+      benchmark::Counter(points.size() - 1, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_DistanceSquaredCosine)->Arg(4096);
+
+// the same with the longitude scale looked up in the table of latitude bands
+static void BM_DistanceSquaredTable(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  for (auto _ : state) {
+    double total = 0;
+    for (size_t i = 1; i < points.size(); ++i) {
+      total += points[i - 1].DistanceSquared(points[i]);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Distances"] =
+      benchmark::Counter(points.size() - 1, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_DistanceSquaredTable)->Arg(4096);
+
+// distances from one test point, a call per point
+static void BM_DistanceSquaredFromTestPoint(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  const DistanceApproximator<PointLL> approx(PointLL(5.1, 52.1));
+  for (auto _ : state) {
+    double total = 0;
+    for (const auto& point : points) {
+      total += approx.DistanceSquared(point);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Distances"] =
+      benchmark::Counter(points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_DistanceSquaredFromTestPoint)->Arg(4096);
+
+// distances from one test point, all of the points in one call
+static void BM_DistanceSquaredBatch(benchmark::State& state) {
+  const auto points = RandomPoints(state.range(0));
+  const DistanceApproximator<PointLL> approx(PointLL(5.1, 52.1));
+  std::vector<double> sq_distances(points.size());
+  for (auto _ : state) {
+    approx.DistanceSquared(points.data(), points.size(), sq_distances.data());
+    benchmark::DoNotOptimize(sq_distances.data());
+    benchmark::ClobberMemory();
+  }
+  state.counters["Distances"] =
+      benchmark::Counter(points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_DistanceSquaredBatch)->Arg(4096);
+
+} // namespace
+
+BENCHMARK_MAIN();
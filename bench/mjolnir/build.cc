@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "mjolnir/util.h"
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+const std::vector<std::string> kInput = {VALHALLA_SOURCE_DIR
+                                         "test/data/utrecht_netherlands.osm.pbf"};
+
+// The config the Utrecht test tiles are built with, in a directory of their own
+boost::property_tree::ptree BuildConfig() {
+  return test::json_to_pt(R"({"mjolnir":{
+    "id_table_size":1000,
+    "tile_dir":"test/data/utrecht_bench_tiles",
+    "timezone":"test/data/tz.sqlite",
+    "admin":")" VALHALLA_SOURCE_DIR R"(test/data/netherlands_admin.sqlite",
+    "include_construction":true,
+    "hierarchy":true,
+    "shortcuts":true,
+    "concurrency":1,
+    "logging":{"type":""}
+  }})");
+}
+
+// Runs the stages from start to end of the Utrecht build, the stages before them are run untimed
+// first since most stages change the tiles they work on
+void BM_UtrechtBuild(benchmark::State& state, const BuildStage start, const BuildStage end) {
+  const auto config = BuildConfig();
+  for (auto _ : state) {
+    if (start != BuildStage::kInitialize) {
+      state.PauseTiming();
+      build_tile_set(config, kInput, BuildStage::kInitialize,
+                     static_cast<BuildStage>(static_cast<int>(start) - 1));
+      state.ResumeTiming();
+    }
+    if (!build_tile_set(config, kInput, start, end)) {
+      state.SkipWithError(("Failed to run " + to_string(start)).c_str());
+      break;
+    }
+  }
+}
+
+#define BENCHMARK_STAGES(name, start, end)                                                         \
+  BENCHMARK_CAPTURE(BM_UtrechtBuild, name, BuildStage::start, BuildStage::end)                     \
+      ->Unit(benchmark::kMillisecond)                                                              \
+      ->Iterations(1)
+
+BENCHMARK_STAGES(parseways, kInitialize, kParseWays);
+BENCHMARK_STAGES(parserelations, kParseRelations, kParseRelations);
+BENCHMARK_STAGES(parsenodes, kParseNodes, kParseNodes);
+BENCHMARK_STAGES(constructedges, kConstructEdges, kConstructEdges);
+BENCHMARK_STAGES(build, kBuild, kBuild);
+BENCHMARK_STAGES(enhance, kEnhance, kEnhance);
+BENCHMARK_STAGES(filter, kFilter, kFilter);
+BENCHMARK_STAGES(hierarchy, kHierarchy, kHierarchy);
+BENCHMARK_STAGES(shortcuts, kShortcuts, kShortcuts);
+BENCHMARK_STAGES(restrictions, kRestrictions, kRestrictions);
+BENCHMARK_STAGES(validate, kValidate, kValidate);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "mjolnir/graph_lua_proc.h"
+#include "mjolnir/graphtagtransform.h"
+#include "mjolnir/luatagtransform.h"
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// ways as they are commonly tagged, from a plain street to one with most of what the lua handles
+const std::vector<Tags> kWays = {
+    {{"highway", "residential"}, {"name", "Oak Street"}},
+    {{"highway", "primary"},
+     {"ref", "B 1"},
+     {"maxspeed", "50"},
+     {"lanes", "2"},
+     {"surface", "asphalt"}},
+    {{"highway", "motorway"}, {"oneway", "yes"}, {"maxspeed", "65 mph"}, {"lanes", "3"},
+     {"maxheight", "13'6\""}, {"toll", "yes"}},
+    {{"highway", "footway"}, {"footway", "sidewalk"}, {"bicycle", "yes"}, {"segregated", "no"}},
+    {{"highway", "service"}, {"service", "driveway"}, {"access", "private"}},
+    {{"highway", "secondary"}, {"oneway", "-1"}, {"cycleway:right", "lane"},
+     {"oneway:bicycle", "no"}, {"maxweight", "7.5 t"}, {"hgv", "destination"}},
+    {{"highway", "track"}, {"tracktype", "grade2"}, {"motor_vehicle", "agricultural"}},
+    {{"route", "ferry"}, {"name", "Harbour Ferry"}, {"foot", "yes"}},
+};
+
+template <typename Transform> void BM_TagTransform(benchmark::State& state, Transform& transform) {
+  for (auto _ : state) {
+    for (const auto& tags : kWays) {
+      benchmark::DoNotOptimize(transform.Transform(OSMType::kWay, 1, tags));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kWays.size());
+}
+
+void BM_LuaTagTransform(benchmark::State& state) {
+  LuaTagTransform lua(std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len));
+  BM_TagTransform(state, lua);
+}
+
+void BM_GraphTagTransform(benchmark::State& state) {
+  GraphTagTransform graph;
+  BM_TagTransform(state, graph);
+}
+
+BENCHMARK(BM_LuaTagTransform);
+BENCHMARK(BM_GraphTagTransform);
+
+} // namespace
+
+BENCHMARK_MAIN();
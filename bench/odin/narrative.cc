@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "midgard/logging.h"
+#include "odin/directionsbuilder.h"
+#include "odin/markup_formatter.h"
+#include "test.h"
+#include "tyr/actor.h"
+
+using namespace valhalla;
+
+namespace {
+
+// A few locations around Utrecht, the routes are between each pair of them
+const std::vector<std::string> kLocations = {
+    R"({"lon":5.115873,"lat":52.099247})", R"({"lon":5.117328,"lat":52.099464})",
+    R"({"lon":5.114576,"lat":52.101841})", R"({"lon":5.114598,"lat":52.103607})",
+    R"({"lon":5.112481,"lat":52.074073})", R"({"lon":5.135983,"lat":52.110116})",
+    R"({"lon":5.095273,"lat":52.108956})", R"({"lon":5.110077,"lat":52.062043})",
+    R"({"lon":5.025595,"lat":52.067372})",
+};
+
+// Routes once between every pair of locations so only the directions are timed
+const std::vector<Api>& Routes() {
+  static const std::vector<Api> routes = []() {
+    midgard::logging::Configure({{"type", ""}});
+    tyr::actor_t actor(test::make_config("test/data/utrecht_tiles"), true);
+    std::vector<Api> routes;
+    for (const auto& origin : kLocations) {
+      for (const auto& destination : kLocations) {
+        if (origin == destination) {
+          continue;
+        }
+        Api api;
+        try {
+          actor.route(R"({"costing":"auto","directions_type":"none","locations":[)" + origin + "," +
+                          destination + "]}",
+                      nullptr, &api);
+        } catch (...) {
+          continue;
+        }
+        actor.cleanup();
+        api.clear_directions();
+        routes.push_back(std::move(api));
+      }
+    }
+    if (routes.empty()) {
+      throw std::runtime_error("Found no routes");
+    }
+    return routes;
+  }();
+  return routes;
+}
+
+// Routes once through every location in turn, starting at each of them, so each route has a leg
+// per location and crosses the city several times
+const std::vector<Api>& LongRoutes() {
+  static const std::vector<Api> routes = []() {
+    midgard::logging::Configure({{"type", ""}});
+    tyr::actor_t actor(test::make_config("test/data/utrecht_tiles"), true);
+    std::vector<Api> routes;
+    for (size_t start = 0; start < kLocations.size(); ++start) {
+      std::string locations;
+      for (size_t i = 0; i < kLocations.size(); ++i) {
+        locations += (i ? "," : "") + kLocations[(start + i) % kLocations.size()];
+      }
+      Api api;
+      try {
+        actor.route(R"({"costing":"auto","directions_type":"none","locations":[)" + locations +
+                        "]}",
+                    nullptr, &api);
+      } catch (...) {
+        continue;
+      }
+      actor.cleanup();
+      api.clear_directions();
+      routes.push_back(std::move(api));
+    }
+    if (routes.empty()) {
+      throw std::runtime_error("Found no routes");
+    }
+    return routes;
+  }();
+  return routes;
+}
+
+// Builds the maneuvers and their narrative for every route in the specified language
+void BM_UtrechtNarrative(benchmark::State& state, const std::string& language) {
+  const auto& routes = Routes();
+  const odin::MarkupFormatter markup_formatter;
+  Api api;
+  size_t maneuvers = 0;
+  for (auto _ : state) {
+    for (const auto& route : routes) {
+      api.CopyFrom(route);
+      api.mutable_options()->set_language(language);
+      api.mutable_options()->set_directions_type(DirectionsType::instructions);
+      odin::DirectionsBuilder::Build(api, markup_formatter);
+      maneuvers += api.directions().routes(0).legs(0).maneuver_size();
+    }
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(routes.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["Maneuvers"] = benchmark::Counter(maneuvers, benchmark::Counter::kIsRate);
+}
+
+// Builds the maneuvers and their narrative for every leg of the long routes
+void BM_UtrechtLongRouteNarrative(benchmark::State& state) {
+  const auto& routes = LongRoutes();
+  const odin::MarkupFormatter markup_formatter;
+  Api api;
+  size_t legs = 0, maneuvers = 0;
+  for (auto _ : state) {
+    for (const auto& route : routes) {
+      api.CopyFrom(route);
+      api.mutable_options()->set_directions_type(DirectionsType::instructions);
+      odin::DirectionsBuilder::Build(api, markup_formatter);
+      for (const auto& leg : api.directions().routes(0).legs()) {
+        maneuvers += leg.maneuver_size();
+      }
+      legs += api.directions().routes(0).legs_size();
+    }
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(routes.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["Legs"] = benchmark::Counter(legs, benchmark::Counter::kIsRate);
+  state.counters["Maneuvers"] = benchmark::Counter(maneuvers, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_UtrechtLongRouteNarrative)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtNarrative, en_US, std::string("en-US"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtNarrative, de_DE, std::string("de-DE"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtNarrative, fr_FR, std::string("fr-FR"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtNarrative, it_IT, std::string("it-IT"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtNarrative, ru_RU, std::string("ru-RU"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtNarrative, hi_IN, std::string("hi-IN"))->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
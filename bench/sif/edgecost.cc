@@ -0,0 +1,231 @@
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/time_info.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "sif/edgelabel.h"
+#include "test.h"
+#include <valhalla/proto/options.pb.h>
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree json_to_pt(const std::string& json) {
+  std::stringstream ss;
+  ss << json;
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(ss, pt);
+  return pt;
+}
+
+const auto config = json_to_pt(R"({
+    "mjolnir":{
+      "tile_dir":"test/data/utrecht_tiles",
+      "traffic_extract":"test/data/utrecht_tiles/sif-live-data.tar",
+      "concurrency": 1
+    }
+  })");
+
+const std::vector<Costing::Type> kCostings = {Costing::auto_,     Costing::truck,
+                                              Costing::bicycle,   Costing::pedestrian,
+                                              Costing::motorcycle, Costing::motor_scooter};
+
+// where the speeds of the edges come from
+enum class Speeds { fixed, time_dependent, live_traffic };
+const std::vector<std::pair<Speeds, std::string>> kSpeeds = {
+    {Speeds::fixed, "fixed"},
+    {Speeds::time_dependent, "time_dependent"},
+    {Speeds::live_traffic, "live_traffic"},
+};
+
+// a fifth of the edges get live speeds, the rest keep their historical and default speeds
+baldr::GraphReader& GetReader() {
+  static std::unique_ptr<baldr::GraphReader> reader = []() {
+    test::build_live_traffic_data(config);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<> dist(0., 1.);
+    test::customize_live_traffic_data(config, [&](baldr::GraphReader&, baldr::TrafficTile&, int,
+                                                  baldr::TrafficSpeed* current) {
+      if (dist(gen) < 0.2) {
+        current->breakpoint1 = 255;
+        current->overall_encoded_speed = dist(gen) * 100;
+      }
+    });
+    return std::make_unique<baldr::GraphReader>(config.get_child("mjolnir"));
+  }();
+  return *reader;
+}
+
+// a predecessor and an edge the costing allows leaving its end node
+struct transition_t {
+  uint32_t pred;
+  baldr::GraphId edgeid;
+};
+
+// every pair of consecutive edges on the local level of the Utrecht tiles that a costing allows,
+// with the speeds the costing is set up to use
+class Transitions {
+public:
+  Transitions(Costing::Type type, Speeds speeds) : reader(GetReader()) {
+    // fixed speeds leave out the historical and live ones, time dependent ones the live ones
+    const std::string speed_types = speeds == Speeds::fixed ? R"(["freeflow", "constrained"])"
+                                    : speeds == Speeds::time_dependent
+                                        ? R"(["freeflow", "constrained", "predicted"])"
+                                        : R"(["freeflow", "constrained", "predicted", "current"])";
+    const std::string json = R"({"costing_options": {")" + Costing_Enum_Name(type) +
+                             R"(": {"speed_types": )" + speed_types + "}}}";
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    Options options;
+    options.set_costing_type(type);
+    sif::ParseCosting(doc, "/costing_options", options);
+    costing = sif::CostFactory().Create(options);
+
+    // a wednesday morning for the historical speeds, now for the live ones
+    std::string date_time = speeds == Speeds::live_traffic ? "current" : "2023-05-10T08:00";
+    time_info = speeds == Speeds::fixed
+                    ? baldr::TimeInfo::invalid()
+                    : baldr::TimeInfo::make(date_time, baldr::DateTime::get_tz_db().to_index(
+                                                           "Europe/Amsterdam"));
+
+    for (const auto& tile_id : reader.GetTileSet(2)) {
+      auto tile = reader.GetGraphTile(tile_id);
+      for (baldr::GraphId pred_id = tile_id; pred_id.id() < tile->header()->directededgecount();
+           ++pred_id) {
+        const auto* pred_edge = tile->directededge(pred_id);
+        if (pred_edge->endnode().Tile_Base() != tile_id) {
+          continue;
+        }
+        labels.emplace_back(0, pred_id, pred_edge, sif::Cost{}, 0.f, 0.f, costing->travel_mode(),
+                            0, sif::Cost{}, baldr::kInvalidRestriction, true, false,
+                            sif::InternalTurn::kNoTurn);
+        const auto* node = tile->node(pred_edge->endnode());
+        baldr::GraphId edgeid(tile_id.tileid(), tile_id.level(), node->edge_index());
+        for (uint32_t i = 0; i < node->edge_count(); ++i, ++edgeid) {
+          uint8_t restriction_idx = baldr::kInvalidRestriction;
+          if (costing->Allowed(tile->directededge(edgeid), false, labels.back(), tile, edgeid, 0,
+                               0, restriction_idx)) {
+            transitions.push_back({static_cast<uint32_t>(labels.size() - 1), edgeid});
+          }
+        }
+      }
+    }
+  }
+
+  baldr::GraphReader& reader;
+  sif::cost_ptr_t costing;
+  baldr::TimeInfo time_info;
+  std::vector<sif::EdgeLabel> labels;
+  std::vector<transition_t> transitions;
+};
+
+Transitions& GetTransitions(Costing::Type type, Speeds speeds) {
+  static std::map<std::pair<Costing::Type, Speeds>, std::unique_ptr<Transitions>> transitions;
+  auto& t = transitions[{type, speeds}];
+  if (!t) {
+    t = std::make_unique<Transitions>(type, speeds);
+  }
+  return *t;
+}
+
+// the access check of every transition, all of them pass
+void BM_Allowed(benchmark::State& state, Costing::Type type, Speeds speeds) {
+  auto& t = GetTransitions(type, speeds);
+  const sif::DynamicCost& costing = *t.costing;
+  for (auto _ : state) {
+    uint32_t allowed = 0;
+    baldr::graph_tile_ptr tile;
+    for (const auto& transition : t.transitions) {
+      if (!tile || tile->id() != transition.edgeid.Tile_Base()) {
+        tile = t.reader.GetGraphTile(transition.edgeid);
+      }
+      uint8_t restriction_idx = baldr::kInvalidRestriction;
+      allowed += costing.Allowed(tile->directededge(transition.edgeid), false,
+                                 t.labels[transition.pred], tile, transition.edgeid, 0, 0,
+                                 restriction_idx);
+    }
+    benchmark::DoNotOptimize(allowed);
+  }
+  state.counters["Edges"] = benchmark::Counter(t.transitions.size(),
+                                               benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// the cost of traversing every allowed edge
+void BM_EdgeCost(benchmark::State& state, Costing::Type type, Speeds speeds) {
+  auto& t = GetTransitions(type, speeds);
+  const sif::DynamicCost& costing = *t.costing;
+  for (auto _ : state) {
+    float total = 0.f;
+    baldr::graph_tile_ptr tile;
+    for (const auto& transition : t.transitions) {
+      if (!tile || tile->id() != transition.edgeid.Tile_Base()) {
+        tile = t.reader.GetGraphTile(transition.edgeid);
+      }
+      uint8_t flow_sources;
+      total += costing
+                   .EdgeCost(tile->directededge(transition.edgeid), tile, t.time_info,
+                             flow_sources)
+                   .cost;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Edges"] = benchmark::Counter(t.transitions.size(),
+                                               benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// the cost of turning from the predecessor onto every allowed edge
+void BM_TransitionCost(benchmark::State& state, Costing::Type type, Speeds speeds) {
+  auto& t = GetTransitions(type, speeds);
+  const sif::DynamicCost& costing = *t.costing;
+  for (auto _ : state) {
+    float total = 0.f;
+    baldr::graph_tile_ptr tile;
+    for (const auto& transition : t.transitions) {
+      if (!tile || tile->id() != transition.edgeid.Tile_Base()) {
+        tile = t.reader.GetGraphTile(transition.edgeid);
+      }
+      const auto& pred = t.labels[transition.pred];
+      total += costing
+                   .TransitionCost(tile->directededge(transition.edgeid),
+                                   tile->node(pred.endnode()), pred)
+                   .cost;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Edges"] = benchmark::Counter(t.transitions.size(),
+                                               benchmark::Counter::kIsIterationInvariantRate);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  logging::Configure({{"type", ""}});
+
+  // one benchmark per hot function, costing and source of speeds, like BM_EdgeCost/truck/fixed.
+  // Allowed and TransitionCost do not look at speeds so they only run with the fixed ones
+  for (const auto type : kCostings) {
+    const auto& costing = Costing_Enum_Name(type);
+    ::benchmark::RegisterBenchmark(("BM_Allowed/" + costing).c_str(), BM_Allowed, type,
+                                   Speeds::fixed)
+        ->Unit(benchmark::kMicrosecond);
+    for (const auto& speeds : kSpeeds) {
+      ::benchmark::RegisterBenchmark(("BM_EdgeCost/" + costing + "/" + speeds.second).c_str(),
+                                     BM_EdgeCost, type, speeds.first)
+          ->Unit(benchmark::kMicrosecond);
+    }
+    ::benchmark::RegisterBenchmark(("BM_TransitionCost/" + costing).c_str(), BM_TransitionCost,
+                                   type, Speeds::fixed)
+        ->Unit(benchmark::kMicrosecond);
+  }
+  ::benchmark::Initialize(&argc, argv);
+  ::benchmark::RunSpecifiedBenchmarks();
+}
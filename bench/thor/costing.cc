@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "sif/costfactory.h"
+#include "sif/edgelabel.h"
+#include <valhalla/proto/options.pb.h>
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree json_to_pt(const std::string& json) {
+  std::stringstream ss;
+  ss << json;
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(ss, pt);
+  return pt;
+}
+
+const auto config = json_to_pt(R"({
+    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1}
+  })");
+
+// a predecessor and an edge leaving its end node, what an expansion looks at
+struct transition_t {
+  uint32_t pred;
+  baldr::GraphId edgeid;
+};
+
+// every pair of consecutive edges on the local level of the Utrecht tiles
+class Transitions {
+public:
+  Transitions() : reader(config.get_child("mjolnir")) {
+    Options options;
+    options.set_costing_type(Costing::auto_);
+    rapidjson::Document doc;
+    sif::ParseCosting(doc, "/costing_options", options);
+    costing = sif::CostFactory().Create(options);
+
+    for (const auto& tile_id : reader.GetTileSet(2)) {
+      auto tile = reader.GetGraphTile(tile_id);
+      for (baldr::GraphId pred_id = tile_id; pred_id.id() < tile->header()->directededgecount();
+           ++pred_id) {
+        const auto* pred_edge = tile->directededge(pred_id);
+        if (pred_edge->endnode().Tile_Base() != tile_id) {
+          continue;
+        }
+        labels.emplace_back(0, pred_id, pred_edge, sif::Cost{}, 0.f, 0.f, sif::TravelMode::kDrive, 0,
+                            sif::Cost{}, baldr::kInvalidRestriction, true, false,
+                            sif::InternalTurn::kNoTurn);
+        const auto* node = tile->node(pred_edge->endnode());
+        baldr::GraphId edgeid(tile_id.tileid(), tile_id.level(), node->edge_index());
+        for (uint32_t i = 0; i < node->edge_count(); ++i, ++edgeid) {
+          transitions.push_back({static_cast<uint32_t>(labels.size() - 1), edgeid});
+        }
+      }
+    }
+  }
+
+  baldr::GraphReader reader;
+  sif::cost_ptr_t costing;
+  std::vector<sif::EdgeLabel> labels;
+  std::vector<transition_t> transitions;
+};
+
+Transitions& GetTransitions() {
+  static Transitions t;
+  return t;
+}
+
+// Allowed, EdgeCost and TransitionCost each through their own virtual call
+static void BM_UtrechtSeparateCalls(benchmark::State& state) {
+  auto& t = GetTransitions();
+  const sif::DynamicCost& costing = *t.costing;
+  const auto time_info = baldr::TimeInfo::invalid();
+  for (auto _ : state) {
+    float total = 0.f;
+    baldr::graph_tile_ptr tile;
+    for (const auto& transition : t.transitions) {
+      if (!tile || tile->id() != transition.edgeid.Tile_Base()) {
+        tile = t.reader.GetGraphTile(transition.edgeid);
+      }
+      const auto& pred = t.labels[transition.pred];
+      const auto* edge = tile->directededge(transition.edgeid);
+      uint8_t restriction_idx = baldr::kInvalidRestriction;
+      if (!costing.Allowed(edge, false, pred, tile, transition.edgeid, 0, 0, restriction_idx)) {
+        continue;
+      }
+      uint8_t flow_sources;
+      const auto edge_cost = costing.EdgeCost(edge, tile, time_info, flow_sources);
+      const auto transition_cost = costing.TransitionCost(edge, tile->node(pred.endnode()), pred);
+      total += edge_cost.cost + transition_cost.cost;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Edges"] = benchmark::Counter(t.transitions.size(),
+                                               benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_UtrechtSeparateCalls)->Unit(benchmark::kMillisecond);
+
+// the same through the one virtual call of EvaluateEdge
+static void BM_UtrechtEvaluateEdge(benchmark::State& state) {
+  auto& t = GetTransitions();
+  const sif::DynamicCost& costing = *t.costing;
+  const auto time_info = baldr::TimeInfo::invalid();
+  for (auto _ : state) {
+    float total = 0.f;
+    baldr::graph_tile_ptr tile;
+    for (const auto& transition : t.transitions) {
+      if (!tile || tile->id() != transition.edgeid.Tile_Base()) {
+        tile = t.reader.GetGraphTile(transition.edgeid);
+      }
+      const auto& pred = t.labels[transition.pred];
+      const auto* edge = tile->directededge(transition.edgeid);
+      sif::EdgeEvaluation evaluation;
+      if (!costing.EvaluateEdge(edge, false, pred, tile, transition.edgeid,
+                                tile->node(pred.endnode()), time_info, 0, 0, evaluation)) {
+        continue;
+      }
+      total += evaluation.edge_cost.cost + evaluation.transition_cost.cost;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["Edges"] = benchmark::Counter(t.transitions.size(),
+                                               benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_UtrechtEvaluateEdge)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "gurka/procedural.h"
+#include "mjolnir/tileextract.h"
+#include "test.h"
+
+using namespace valhalla;
+namespace procedural = gurka::procedural;
+
+namespace {
+
+// a grid of 100 km by 100 km, the route between two of its corners is 100 km long
+procedural::Params grid_params() {
+  procedural::Params params;
+  params.size = 201;
+  params.spacing = 500;
+  params.jitter = 50;
+  params.highway_every = 50;
+  params.arterial_every = 10;
+  return params;
+}
+
+// the tiles of the map packed into an extract next to them
+const gurka::map& grid() {
+  static const gurka::map map = []() {
+    auto map = procedural::build(grid_params());
+    const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+    const auto extract = tile_dir + "/tiles.tar";
+    if (!filesystem::exists(extract)) {
+      mjolnir::TileExtract::Build(tile_dir, extract, 1);
+    }
+    map.config.put("mjolnir.tile_extract", extract);
+    return map;
+  }();
+  return map;
+}
+
+// the profile of docs/embedded.md
+gurka::map embedded(const gurka::map& map) {
+  auto config = map;
+  config.config.put("mjolnir.tile_extract_pread", true);
+  config.config.put("mjolnir.use_lru_mem_cache", true);
+  config.config.put("mjolnir.lru_mem_cache_hard_control", true);
+  config.config.put("mjolnir.max_cache_size", 16 * 1024 * 1024);
+  config.config.put("thor.max_reserved_labels_count_bidir_astar", 100000);
+  config.config.put("thor.max_reserved_labels_count_astar", 100000);
+  config.config.put("thor.clear_reserved_memory", true);
+  return config;
+}
+
+double resident_mb() {
+  size_t pages = 0, resident = 0;
+  std::ifstream("/proc/self/statm") >> pages >> resident;
+  return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+double peak_resident_mb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.;
+}
+
+// routes along the 100 km edge of the grid using the tiles through the mmap of the extract (0) or
+// reading them with pread into a small cache (1), the resident memory after the routes is what
+// the reader held on to, the peak also counts building the map in case it was not cached yet
+void BM_EmbeddedRoute(benchmark::State& state) {
+  const auto map = state.range(0) ? embedded(grid()) : grid();
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  const double before = resident_mb();
+  for (auto _ : state) {
+    auto result = gurka::do_action(Options::route, map, {"nw", "ne"}, "auto", {}, reader);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["rss_mb"] = resident_mb();
+  state.counters["rss_growth_mb"] = resident_mb() - before;
+  state.counters["peak_rss_mb"] = peak_resident_mb();
+}
+BENCHMARK(BM_EmbeddedRoute)->Unit(benchmark::kMillisecond)->Arg(1)->Arg(0);
+
+} // namespace
+
+BENCHMARK_MAIN();
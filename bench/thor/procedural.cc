@@ -0,0 +1,103 @@
+#include <benchmark/benchmark.h>
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "gurka/procedural.h"
+#include "test.h"
+
+using namespace valhalla;
+namespace procedural = gurka::procedural;
+
+namespace {
+
+procedural::Params grid_params(const uint32_t size) {
+  procedural::Params params;
+  params.size = size;
+  params.jitter = 20;
+  params.oneway_share = .2;
+  return params;
+}
+
+// the maps are built once per size and kept on disk between runs
+const gurka::map& grid(const uint32_t size) {
+  static std::unordered_map<uint32_t, gurka::map> maps;
+  auto found = maps.find(size);
+  if (found == maps.end()) {
+    found = maps.emplace(size, procedural::build(grid_params(size))).first;
+  }
+  return found->second;
+}
+
+std::string locations_json(const std::vector<midgard::PointLL>& points, const char* key) {
+  std::stringstream json;
+  json << std::setprecision(7) << std::fixed << "\"" << key << "\":[";
+  for (size_t i = 0; i < points.size(); ++i) {
+    json << (i ? "," : "") << "{\"lon\":" << points[i].lng() << ",\"lat\":" << points[i].lat()
+         << "}";
+  }
+  json << "]";
+  return json.str();
+}
+
+// routes between random nodes of grids of growing size
+void BM_ProceduralRoute(benchmark::State& state) {
+  const auto size = static_cast<uint32_t>(state.range(0));
+  const auto& map = grid(size);
+  const auto params = grid_params(size);
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+
+  const auto points = procedural::locations(params, 64, 7);
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string request =
+        "{" + locations_json({points[i % points.size()], points[(i + 1) % points.size()]},
+                             "locations") +
+        ",\"costing\":\"auto\"}";
+    benchmark::DoNotOptimize(gurka::do_action(Options::route, map, request, reader));
+    i += 2;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["nodes"] = static_cast<double>(size) * size;
+}
+BENCHMARK(BM_ProceduralRoute)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(32, 256);
+
+// locates batches of random nodes
+void BM_ProceduralLocate(benchmark::State& state) {
+  const auto size = static_cast<uint32_t>(state.range(0));
+  const auto& map = grid(size);
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+
+  const auto request =
+      "{" + locations_json(procedural::locations(grid_params(size), 100), "locations") +
+      ",\"costing\":\"auto\"}";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(gurka::do_action(Options::locate, map, request, reader));
+  }
+  state.SetItemsProcessed(state.iterations() * 100);
+}
+BENCHMARK(BM_ProceduralLocate)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(32, 256);
+
+// map matches a trace along a row of the grid
+void BM_ProceduralTraceRoute(benchmark::State& state) {
+  const auto size = static_cast<uint32_t>(state.range(0));
+  const auto& map = grid(size);
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+
+  const auto request = "{" + locations_json(procedural::trace(grid_params(size), 30), "shape") +
+                       ",\"costing\":\"auto\",\"shape_match\":\"map_snap\"}";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(gurka::do_action(Options::trace_route, map, request, reader));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProceduralTraceRoute)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(2)
+    ->Range(32, 256);
+
+} // namespace
+
+BENCHMARK_MAIN();
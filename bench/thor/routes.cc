@@ -4,10 +4,12 @@
 #include <random>
 #include <string>
 
+#include "baldr/altbounds.h"
 #include "baldr/graphreader.h"
 #include "loki/search.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "mjolnir/altbuilder.h"
 #include "sif/autocost.h"
 #include "sif/costfactory.h"
 #include "test.h"
@@ -383,6 +385,131 @@ static void BM_Sif_Allowed(benchmark::State& state) {
 
 BENCHMARK(BM_Sif_Allowed)->Unit(benchmark::kNanosecond);
 
+/**
+ * Walks the edges leaving every node of the Utrecht tiles and reads the fields path expansion
+ * looks at for each of them, once through the DirectedEdges and once through the hot field
+ * arrays. The difference in time is the cost of the cache lines the 48 byte edges drag in.
+ */
+static void BM_EdgeHotFields(benchmark::State& state) {
+  const bool use_hot_fields = state.range(0);
+  auto config = build_config("");
+  config.get_child("mjolnir").erase("traffic_extract");
+  baldr::GraphTile::set_hot_fields_enabled(use_hot_fields);
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+  baldr::GraphTile::set_hot_fields_enabled(false);
+
+  std::vector<baldr::graph_tile_ptr> tiles;
+  for (const auto& tile_id : clean_reader->GetTileSet()) {
+    tiles.push_back(clean_reader->GetGraphTile(tile_id));
+  }
+
+  uint64_t edges = 0;
+  uint64_t checksum = 0;
+  for (auto _ : state) {
+    for (const auto& tile : tiles) {
+      const auto& hot = tile->GetDirectedEdgeHot();
+      for (const auto& node : tile->GetNodes()) {
+        const uint32_t end = node.edge_index() + node.edge_count();
+        for (uint32_t idx = node.edge_index(); idx < end; ++idx, ++edges) {
+          if (use_hot_fields) {
+            const auto& attributes = hot.attributes(idx);
+            if (attributes.forwardaccess & baldr::kAutoAccess) {
+              checksum += hot.endnode(idx).value + hot.length(idx) + attributes.speed +
+                          attributes.use + attributes.classification;
+            }
+          } else {
+            const auto* edge = tile->directededge(idx);
+            if (edge->forwardaccess() & baldr::kAutoAccess) {
+              checksum += edge->endnode().value + edge->length() + edge->speed() +
+                          static_cast<uint32_t>(edge->use()) +
+                          static_cast<uint32_t>(edge->classification());
+            }
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.counters["Edges"] = benchmark::Counter(edges, benchmark::Counter::kIsRate);
+  state.counters["BytesPerEdge"] =
+      use_hot_fields ? sizeof(uint64_t) + sizeof(uint32_t) + sizeof(baldr::DirectedEdgeHotAttributes)
+                     : sizeof(baldr::DirectedEdge);
+}
+
+BENCHMARK(BM_EdgeHotFields)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Routes between every pair of a few locations around Utrecht with the time dependent and the
+ * bidirectional A*, once with the straight line heuristic alone and once bounded by the landmark
+ * distances of valhalla_build_alt. The labels counter is how many edges the searches labeled per
+ * route, the landmarks only pay off if it drops by more than the lookups cost.
+ */
+template <class Algorithm> void BM_UtrechtAlt(benchmark::State& state) {
+  const bool use_alt = state.range(0);
+  auto config = build_config("");
+  config.get_child("mjolnir").erase("traffic_extract");
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+
+  std::shared_ptr<const baldr::AltBounds> alt_bounds;
+  if (use_alt) {
+    const std::string alt_file = "test/data/utrecht_alt.bin";
+    static bool built = false;
+    if (!built) {
+      mjolnir::AltBuilder::Build(config.get_child("mjolnir"), alt_file, 16);
+      built = true;
+    }
+    alt_bounds = baldr::AltBounds::get(alt_file);
+  }
+
+  Options options;
+  create_costing_options(options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+
+  std::vector<valhalla::baldr::Location> locations{
+      midgard::PointLL{5.115873, 52.099247}, midgard::PointLL{5.112481, 52.074073},
+      midgard::PointLL{5.135983, 52.110116}, midgard::PointLL{5.095273, 52.108956},
+      midgard::PointLL{5.110077, 52.062043}, midgard::PointLL{5.025595, 52.067372},
+  };
+  const auto projections = loki::Search(locations, *clean_reader, costs[static_cast<size_t>(mode)]);
+  std::vector<valhalla::Location> projected;
+  for (const auto& location : locations) {
+    projected.emplace_back();
+    baldr::PathLocation::toPBF(projections.at(location), &projected.back(), *clean_reader);
+  }
+
+  Algorithm astar;
+  astar.set_alt_bounds(alt_bounds);
+  size_t routes = 0, labels = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < projected.size(); ++i) {
+      for (size_t j = 0; j < projected.size(); ++j) {
+        if (i == j) {
+          continue;
+        }
+        auto origin = projected[i];
+        auto destination = projected[j];
+        auto result = astar.GetBestPath(origin, destination, *clean_reader, costs, mode);
+        benchmark::DoNotOptimize(result);
+        labels += astar.label_count();
+        astar.Clear();
+        ++routes;
+      }
+    }
+  }
+  state.counters["Routes"] = routes;
+  state.counters["Labels"] = static_cast<double>(labels) / routes;
+}
+
+BENCHMARK_TEMPLATE(BM_UtrechtAlt, thor::TimeDepForward)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_UtrechtAlt, thor::BidirectionalAStar)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
 } // namespace
 
 int main(int argc, char** argv) {
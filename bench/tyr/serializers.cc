@@ -0,0 +1,169 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "loki/search.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "test.h"
+#include "tyr/actor.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla;
+
+namespace {
+
+// A few locations around Utrecht, the routes are between each pair of them
+const std::vector<std::string> kLocations = {
+    R"({"lon":5.115873,"lat":52.099247})", R"({"lon":5.117328,"lat":52.099464})",
+    R"({"lon":5.114576,"lat":52.101841})", R"({"lon":5.114598,"lat":52.103607})",
+    R"({"lon":5.112481,"lat":52.074073})", R"({"lon":5.135983,"lat":52.110116})",
+    R"({"lon":5.095273,"lat":52.108956})", R"({"lon":5.110077,"lat":52.062043})",
+    R"({"lon":5.025595,"lat":52.067372})",
+};
+
+tyr::actor_t& Actor() {
+  static tyr::actor_t actor = []() {
+    midgard::logging::Configure({{"type", ""}});
+    return tyr::actor_t(test::make_config("test/data/utrecht_tiles"), true);
+  }();
+  return actor;
+}
+
+// Routes with their directions between every pair of locations, so only the serializing is timed
+const std::vector<Api>& Routes() {
+  static const std::vector<Api> routes = []() {
+    std::vector<Api> routes;
+    for (const auto& origin : kLocations) {
+      for (const auto& destination : kLocations) {
+        if (origin == destination) {
+          continue;
+        }
+        Api api;
+        try {
+          Actor().route(R"({"costing":"auto","locations":[)" + origin + "," + destination + "]}",
+                        nullptr, &api);
+        } catch (...) { continue; }
+        routes.push_back(std::move(api));
+      }
+    }
+    if (routes.empty()) {
+      throw std::runtime_error("Found no routes");
+    }
+    return routes;
+  }();
+  return routes;
+}
+
+// A matrix between all the locations
+const Api& Matrix() {
+  static const Api matrix = []() {
+    std::string locations;
+    for (const auto& location : kLocations) {
+      locations += (locations.empty() ? "" : ",") + location;
+    }
+    Api api;
+    Actor().matrix(R"({"costing":"auto","sources":[)" + locations + R"(],"targets":[)" +
+                       locations + "]}",
+                   nullptr, &api);
+    return api;
+  }();
+  return matrix;
+}
+
+// Serializes every route in a format, the copy the pbf serializer needs to clear fields of is not
+// timed
+void BM_SerializeRoute(benchmark::State& state, const Options::Format format) {
+  const auto& routes = Routes();
+  Api api;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (const auto& route : routes) {
+      state.PauseTiming();
+      api.CopyFrom(route);
+      api.mutable_options()->set_format(format);
+      state.ResumeTiming();
+      bytes += tyr::serializeDirections(api).size();
+    }
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(routes.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_CAPTURE(BM_SerializeRoute, json, Options::json)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SerializeRoute, osrm, Options::osrm)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SerializeRoute, gpx, Options::gpx)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SerializeRoute, pbf, Options::pbf)->Unit(benchmark::kMillisecond);
+
+// Serializes the matrix in a format
+void BM_SerializeMatrix(benchmark::State& state, const Options::Format format) {
+  Api api;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    api.CopyFrom(Matrix());
+    api.mutable_options()->set_format(format);
+    state.ResumeTiming();
+    bytes += tyr::serializeMatrix(api).size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_CAPTURE(BM_SerializeMatrix, json, Options::json);
+BENCHMARK_CAPTURE(BM_SerializeMatrix, osrm, Options::osrm);
+BENCHMARK_CAPTURE(BM_SerializeMatrix, binary, Options::binary);
+BENCHMARK_CAPTURE(BM_SerializeMatrix, pbf, Options::pbf);
+
+// Serializes the heights and ranges of a long shape
+void BM_SerializeHeight(benchmark::State& state) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> height(-10, 100);
+  std::vector<double> heights(state.range(0)), ranges(state.range(0));
+  for (size_t i = 0; i < heights.size(); ++i) {
+    heights[i] = height(generator);
+    ranges[i] = i * 30.;
+  }
+  Api api;
+  api.mutable_options()->set_action(Options::height);
+  size_t bytes = 0;
+  for (auto _ : state) {
+    bytes += tyr::serializeHeight(api, heights, ranges).size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_SerializeHeight)->Arg(10000);
+
+// Serializes the candidates of the locations, which looks up the edges they are on
+void BM_SerializeLocate(benchmark::State& state) {
+  midgard::logging::Configure({{"type", ""}});
+  const auto config = test::make_config("test/data/utrecht_tiles");
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  std::vector<baldr::Location> locations;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> lng(5.03, 5.17), lat(52.05, 52.12);
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    locations.emplace_back(midgard::PointLL{lng(generator), lat(generator)});
+  }
+  Api api;
+  api.mutable_options()->set_costing_type(Costing::auto_);
+  rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", *api.mutable_options());
+  const auto projections =
+      loki::Search(locations, reader, sif::CostFactory().Create(api.options()));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    bytes += tyr::serializeLocate(api, locations, projections, reader).size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_SerializeLocate)->Arg(100)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -203,6 +203,21 @@ Options:
       endforeach()
       set(map "${map}};\n")
       file(APPEND ${target} "${map}")
+
+      # the aliases of each locale so a locale can be loaded by its alias without parsing the others
+      set(map "\nconst std::unordered_map<std::string, std::string> locales_aliases = {\n")
+      foreach(file ${json_files})
+        get_filename_component(locale "${file}" NAME_WE)
+        file(READ ${file} json)
+        string(REGEX MATCH "\"aliases\"[ \t\r\n]*:[ \t\r\n]*\\[[^]]*\\]" aliases "${json}")
+        string(REGEX REPLACE "^\"aliases\"[^[]*\\[" "" aliases "${aliases}")
+        string(REGEX MATCHALL "\"[^\"]+\"" aliases "${aliases}")
+        foreach(alias ${aliases})
+          set(map "${map}    {${alias}, \"${locale}\"},\n")
+        endforeach()
+      endforeach()
+      set(map "${map}};\n")
+      file(APPEND ${target} "${map}")
     endif()
   endif()
 endif()
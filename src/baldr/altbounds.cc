@@ -0,0 +1,112 @@
+#include "baldr/altbounds.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace valhalla {
+namespace baldr {
+
+AltBounds::AltBounds(const std::string& file) {
+  if (!filesystem::exists(file)) {
+    throw std::runtime_error(file + " does not exist");
+  }
+  const auto size = filesystem::directory_entry(file).file_size();
+  if (size < sizeof(AltBoundsHeader)) {
+    throw std::runtime_error(file + " is too small to be a landmark distance file");
+  }
+  memory_.map_readonly(file, size);
+
+  header_ = reinterpret_cast<const AltBoundsHeader*>(memory_.get());
+  if (std::memcmp(header_->magic, kAltBoundsMagic, sizeof(kAltBoundsMagic)) != 0 ||
+      header_->version != kAltBoundsVersion) {
+    throw std::runtime_error(file + " is not a landmark distance file of this version");
+  }
+  if (header_->tile_count != TileSlotCount()) {
+    throw std::runtime_error(file + " was built for another tile hierarchy");
+  }
+  const uint64_t expected = sizeof(AltBoundsHeader) + header_->landmark_count * sizeof(uint64_t) +
+                            (header_->tile_count + 1) * sizeof(uint64_t) +
+                            header_->node_count * header_->landmark_count * sizeof(float);
+  if (size != expected) {
+    throw std::runtime_error(file + " is truncated");
+  }
+
+  landmarks_ = reinterpret_cast<const uint64_t*>(memory_.get() + sizeof(AltBoundsHeader));
+  offsets_ = landmarks_ + header_->landmark_count;
+  distances_ = reinterpret_cast<const float*>(offsets_ + header_->tile_count + 1);
+}
+
+std::shared_ptr<const AltBounds> AltBounds::get(const std::string& file) {
+  if (file.empty()) {
+    return nullptr;
+  }
+
+  // the workers of a process share the map of each file
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::weak_ptr<const AltBounds>> instances;
+  std::lock_guard<std::mutex> _(lock);
+  auto bounds = instances[file].lock();
+  if (!bounds) {
+    try {
+      bounds = std::make_shared<const AltBounds>(file);
+      instances[file] = bounds;
+      LOG_INFO("Using the distances to " + std::to_string(bounds->landmark_count()) +
+               " landmarks from " + file);
+    } catch (const std::exception& e) {
+      LOG_WARN("Not using landmark distances: " + std::string(e.what()));
+    }
+  }
+  return bounds;
+}
+
+const float* AltBounds::Distances(const GraphId& node) const {
+  if (node.level() >= TileHierarchy::levels().size()) {
+    return nullptr;
+  }
+  const uint64_t slot = TileSlot(node);
+  const uint64_t first = offsets_[slot];
+  if (node.id() >= offsets_[slot + 1] - first) {
+    return nullptr;
+  }
+  return distances_ + (first + node.id()) * header_->landmark_count;
+}
+
+float AltBounds::LowerBound(const float* from, const float* to) const {
+  float bound = 0.f;
+  for (uint32_t i = 0; i < header_->landmark_count; ++i) {
+    // a landmark one of them cant reach says nothing about their distance
+    if (std::isinf(from[i]) || std::isinf(to[i])) {
+      continue;
+    }
+    bound = std::max(bound, std::abs(from[i] - to[i]));
+  }
+  return bound;
+}
+
+uint64_t AltBounds::TileSlot(const GraphId& tile_id) {
+  uint64_t slot = tile_id.tileid();
+  for (const auto& level : TileHierarchy::levels()) {
+    if (level.level == tile_id.level()) {
+      break;
+    }
+    slot += level.tiles.TileCount();
+  }
+  return slot;
+}
+
+uint64_t AltBounds::TileSlotCount() {
+  uint64_t count = 0;
+  for (const auto& level : TileHierarchy::levels()) {
+    count += level.tiles.TileCount();
+  }
+  return count;
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -63,6 +63,8 @@ const std::unordered_map<std::string, bool> AttributesController::kDefaultAttrib
     {kEdgeMaxUpwardGrade, true},
     {kEdgeMaxDownwardGrade, true},
     {kEdgeMeanElevation, true},
+    {kEdgeAscent, true},
+    {kEdgeDescent, true},
     {kEdgeLaneCount, true},
     {kEdgeLaneConnectivity, true},
     {kEdgeCycleLane, true},
@@ -141,8 +143,53 @@ const std::unordered_map<std::string, bool> AttributesController::kDefaultAttrib
     {kShapeAttributesClosure, false},
 };
 
+/*
+ * The keys of the attributes in the order of the Attribute enum, used to compile the bitset.
+ */
+const std::string* const kAttributeKeys[] = {
+    &kEdgeNames, &kEdgeLength, &kEdgeSpeed, &kEdgeRoadClass, &kEdgeBeginHeading, &kEdgeEndHeading,
+    &kEdgeBeginShapeIndex, &kEdgeEndShapeIndex, &kEdgeTraversability, &kEdgeUse, &kEdgeToll,
+    &kEdgeUnpaved, &kEdgeTunnel, &kEdgeBridge, &kEdgeRoundabout, &kEdgeInternalIntersection,
+    &kEdgeDriveOnRight, &kEdgeSurface, &kEdgeSignExitNumber, &kEdgeSignExitBranch,
+    &kEdgeSignExitToward, &kEdgeSignExitName, &kEdgeSignGuideBranch, &kEdgeSignGuideToward,
+    &kEdgeSignJunctionName, &kEdgeSignGuidanceViewJunction, &kEdgeSignGuidanceViewSignboard,
+    &kEdgeTravelMode, &kEdgeVehicleType, &kEdgePedestrianType, &kEdgeBicycleType, &kEdgeTransitType,
+    &kEdgeTransitRouteInfoOnestopId, &kEdgeTransitRouteInfoBlockId, &kEdgeTransitRouteInfoTripId,
+    &kEdgeTransitRouteInfoShortName, &kEdgeTransitRouteInfoLongName, &kEdgeTransitRouteInfoHeadsign,
+    &kEdgeTransitRouteInfoColor, &kEdgeTransitRouteInfoTextColor, &kEdgeTransitRouteInfoDescription,
+    &kEdgeTransitRouteInfoOperatorOnestopId, &kEdgeTransitRouteInfoOperatorName,
+    &kEdgeTransitRouteInfoOperatorUrl, &kEdgeId, &kEdgeWayId, &kEdgeWeightedGrade,
+    &kEdgeMaxUpwardGrade, &kEdgeMaxDownwardGrade, &kEdgeMeanElevation, &kEdgeAscent,
+    &kEdgeDescent, &kEdgeLaneCount,
+    &kEdgeLaneConnectivity, &kEdgeCycleLane, &kEdgeBicycleNetwork, &kEdgeSacScale, &kEdgeShoulder,
+    &kEdgeSidewalk, &kEdgeDensity, &kEdgeSpeedLimit, &kEdgeTruckSpeed, &kEdgeTruckRoute,
+    &kEdgeDefaultSpeed, &kEdgeDestinationOnly, &kEdgeIsUrban, &kEdgeTaggedValues, &kEdgeIndoor,
+    &kEdgeLandmarks, &kNodeIntersectingEdgeBeginHeading,
+    &kNodeIntersectingEdgeFromEdgeNameConsistency, &kNodeIntersectingEdgeToEdgeNameConsistency,
+    &kNodeIntersectingEdgeDriveability, &kNodeIntersectingEdgeCyclability,
+    &kNodeIntersectingEdgeWalkability, &kNodeIntersectingEdgeUse, &kNodeIntersectingEdgeRoadClass,
+    &kNodeIntersectingEdgeLaneCount, &kNodeIntersectingEdgeSignInfo, &kNodeElapsedTime,
+    &kNodeAdminIndex, &kNodeType, &kNodeFork, &kNodeTransitPlatformInfoType,
+    &kNodeTransitPlatformInfoOnestopId, &kNodeTransitPlatformInfoName,
+    &kNodeTransitPlatformInfoStationOnestopId, &kNodeTransitPlatformInfoStationName,
+    &kNodeTransitPlatformInfoArrivalDateTime, &kNodeTransitPlatformInfoDepartureDateTime,
+    &kNodeTransitPlatformInfoIsParentStop, &kNodeTransitPlatformInfoAssumedSchedule,
+    &kNodeTransitPlatformInfoLatLon, &kNodeTransitStationInfoOnestopId,
+    &kNodeTransitStationInfoName, &kNodeTransitStationInfoLatLon, &kNodeTransitEgressInfoOnestopId,
+    &kNodeTransitEgressInfoName, &kNodeTransitEgressInfoLatLon, &kNodeTimeZone,
+    &kNodeTransitionTime, &kOsmChangeset, &kAdminCountryCode, &kAdminCountryText, &kAdminStateCode,
+    &kAdminStateText, &kShape, &kIncidents, &kMatchedPoint, &kMatchedType, &kMatchedEdgeIndex,
+    &kMatchedBeginRouteDiscontinuity, &kMatchedEndRouteDiscontinuity, &kMatchedDistanceAlongEdge,
+    &kMatchedDistanceFromTracePoint, &kConfidenceScore, &kRawScore, &kShapeAttributesTime,
+    &kShapeAttributesLength, &kShapeAttributesSpeed, &kShapeAttributesSpeedLimit,
+    &kShapeAttributesClosure,
+};
+static_assert(sizeof(kAttributeKeys) / sizeof(kAttributeKeys[0]) == kAttributeCount,
+              "Every attribute needs its key");
+
 AttributesController::AttributesController() {
   attributes = kDefaultAttributes;
+  compile();
 }
 
 AttributesController::AttributesController(const Options& options, bool is_strict_filter) {
@@ -171,12 +218,21 @@ AttributesController::AttributesController(const Options& options, bool is_stric
     default:
       break;
   }
+  compile();
 }
 
 void AttributesController::disable_all() {
   for (auto& pair : attributes) {
     pair.second = false;
   }
+  enabled.reset();
+}
+
+void AttributesController::compile() {
+  for (size_t i = 0; i < kAttributeCount; ++i) {
+    auto found = attributes.find(*kAttributeKeys[i]);
+    enabled[i] = found != attributes.end() && found->second;
+  }
 }
 
 bool AttributesController::operator()(const std::string& key) const {
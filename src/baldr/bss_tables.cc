@@ -0,0 +1,143 @@
+#include "baldr/bss_tables.h"
+#include "filesystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kBssTablesMagic[8] = {'V', 'A', 'L', 'H', 'A', 'L', 'B', 'S'};
+constexpr uint32_t kBssTablesVersion = 1;
+
+// Fixed size header at the start of a tables file, followed by the stations and the rides
+struct BssTablesHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t spare;
+  uint64_t dataset_id;
+  uint64_t station_count;
+  uint64_t ride_count;
+};
+
+template <typename T> void read_array(std::ifstream& file, std::vector<T>& array, size_t count) {
+  array.resize(count);
+  file.read(reinterpret_cast<char*>(array.data()), count * sizeof(T));
+}
+
+template <typename T> void write_array(std::ofstream& file, const std::vector<T>& array) {
+  file.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(T));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+BssTables::BssTables(std::vector<GraphId> stations,
+                     std::vector<BssRide> rides,
+                     const uint64_t dataset_id)
+    : stations_(std::move(stations)), rides_(std::move(rides)), dataset_id_(dataset_id) {
+  for (const auto& ride : rides_) {
+    if (ride.from >= stations_.size() || ride.to >= stations_.size()) {
+      throw std::logic_error("Bike share ride between unknown stations");
+    }
+  }
+  Index();
+}
+
+std::string BssTables::file_name(const std::string& tile_dir) {
+  return tile_dir + filesystem::path::preferred_separator + "bss_tables.bin";
+}
+
+std::shared_ptr<const BssTables> BssTables::Load(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::in | std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open bike share tables " + file_name);
+  }
+
+  BssTablesHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, kBssTablesMagic, sizeof(kBssTablesMagic)) != 0 ||
+      header.version != kBssTablesVersion) {
+    throw std::runtime_error("Not supported bike share tables " + file_name);
+  }
+
+  auto tables = std::make_shared<BssTables>();
+  tables->dataset_id_ = header.dataset_id;
+  read_array(file, tables->stations_, header.station_count);
+  read_array(file, tables->rides_, header.ride_count);
+  if (!file) {
+    throw std::runtime_error("Truncated bike share tables " + file_name);
+  }
+
+  // sanity check the rides so that a corrupt file fails here rather than while routing
+  for (const auto& ride : tables->rides_) {
+    if (ride.from >= header.station_count || ride.to >= header.station_count) {
+      throw std::runtime_error("Corrupt bike share tables " + file_name);
+    }
+  }
+  tables->Index();
+  return tables;
+}
+
+void BssTables::Save(const std::string& file_name) const {
+  filesystem::path path(file_name);
+  if (!filesystem::exists(path.parent_path())) {
+    filesystem::create_directories(path.parent_path());
+  }
+
+  std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("Could not write bike share tables " + file_name);
+  }
+
+  BssTablesHeader header{};
+  std::memcpy(header.magic, kBssTablesMagic, sizeof(kBssTablesMagic));
+  header.version = kBssTablesVersion;
+  header.dataset_id = dataset_id_;
+  header.station_count = stations_.size();
+  header.ride_count = rides_.size();
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_array(file, stations_);
+  write_array(file, rides_);
+  if (!file) {
+    throw std::runtime_error("Failed writing bike share tables " + file_name);
+  }
+}
+
+uint32_t BssTables::station_index(const GraphId& node) const {
+  auto found = std::lower_bound(stations_.begin(), stations_.end(), node);
+  if (found == stations_.end() || *found != node) {
+    return kInvalidBssStation;
+  }
+  return static_cast<uint32_t>(found - stations_.begin());
+}
+
+void BssTables::Index() {
+  std::sort(rides_.begin(), rides_.end(), [](const BssRide& a, const BssRide& b) {
+    return a.from == b.from ? a.to < b.to : a.from < b.from;
+  });
+
+  // count the rides of each station first so we can lay the lists out back to back
+  from_offsets_.assign(stations_.size() + 1, 0);
+  to_offsets_.assign(stations_.size() + 1, 0);
+  for (const auto& ride : rides_) {
+    ++from_offsets_[ride.from + 1];
+    ++to_offsets_[ride.to + 1];
+  }
+  for (size_t i = 1; i < from_offsets_.size(); ++i) {
+    from_offsets_[i] += from_offsets_[i - 1];
+    to_offsets_[i] += to_offsets_[i - 1];
+  }
+
+  to_rides_.resize(rides_.size());
+  std::vector<uint32_t> to_fill(to_offsets_.begin(), to_offsets_.end() - 1);
+  for (uint32_t i = 0; i < rides_.size(); ++i) {
+    to_rides_[to_fill[rides_[i].to]++] = i;
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
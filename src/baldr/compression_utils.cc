@@ -1,5 +1,15 @@
 #include "baldr/compression_utils.h"
 
+#include <memory>
+#include <stdexcept>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
 namespace valhalla {
 namespace baldr {
 
@@ -121,5 +131,149 @@ bool inflate(const std::function<void(z_stream&)>& src_func,
   return true;
 }
 
+tile_compression_t detect_compression(const char* data, size_t size) {
+  if (size < 4) {
+    return tile_compression_t::none;
+  }
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  if (bytes[0] == 0x1f && bytes[1] == 0x8b) {
+    return tile_compression_t::gzip;
+  }
+  // the magic numbers of zstd and lz4 frames are little endian
+  const uint32_t magic = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+  if (magic == 0xFD2FB528) {
+    return tile_compression_t::zstd;
+  }
+  if (magic == 0x184D2204) {
+    return tile_compression_t::lz4;
+  }
+  return tile_compression_t::none;
+}
+
+#ifdef HAVE_ZSTD
+namespace {
+// decompression contexts are expensive to make so every thread keeps one around
+ZSTD_DCtx* thread_dctx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),
+                                                                          &ZSTD_freeDCtx);
+  return dctx.get();
+}
+} // namespace
+
+zstd_dictionary_t::zstd_dictionary_t(const char* data, size_t size)
+    : ddict_(ZSTD_createDDict(data, size)), id_(ZSTD_getDictID_fromDict(data, size)) {
+  if (!ddict_) {
+    throw std::runtime_error("Failed to load zstd dictionary");
+  }
+}
+
+zstd_dictionary_t::~zstd_dictionary_t() {
+  ZSTD_freeDDict(ddict_);
+}
+
+bool zstd_compress(const char* src,
+                   size_t size,
+                   std::vector<char>& dst,
+                   int level,
+                   const std::vector<char>& dictionary) {
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+  dst.resize(ZSTD_compressBound(size));
+  auto written = ZSTD_compress_usingDict(cctx.get(), dst.data(), dst.size(), src, size,
+                                         dictionary.data(), dictionary.size(), level);
+  if (ZSTD_isError(written)) {
+    return false;
+  }
+  dst.resize(written);
+  return true;
+}
+
+bool zstd_decompress(const char* src,
+                     size_t size,
+                     std::vector<char>& dst,
+                     const zstd_dictionary_t* dictionary) {
+  // we only write frames that know how large they get so we can allocate once
+  auto content_size = ZSTD_getFrameContentSize(src, size);
+  if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR) {
+    return false;
+  }
+  dst.resize(content_size);
+  auto written = dictionary ? ZSTD_decompress_usingDDict(thread_dctx(), dst.data(), dst.size(), src,
+                                                         size, dictionary->get())
+                            : ZSTD_decompressDCtx(thread_dctx(), dst.data(), dst.size(), src, size);
+  return !ZSTD_isError(written) && written == content_size;
+}
+#else
+zstd_dictionary_t::zstd_dictionary_t(const char*, size_t) : ddict_(nullptr), id_(0) {
+  throw std::runtime_error("Valhalla was built without zstd support");
+}
+
+zstd_dictionary_t::~zstd_dictionary_t() = default;
+
+bool zstd_compress(const char*, size_t, std::vector<char>&, int, const std::vector<char>&) {
+  return false;
+}
+
+bool zstd_decompress(const char*, size_t, std::vector<char>&, const zstd_dictionary_t*) {
+  return false;
+}
+#endif
+
+#ifdef HAVE_LZ4
+bool lz4_compress(const char* src, size_t size, std::vector<char>& dst) {
+  LZ4F_preferences_t preferences{};
+  preferences.frameInfo.contentSize = size;
+  dst.resize(LZ4F_compressFrameBound(size, &preferences));
+  auto written = LZ4F_compressFrame(dst.data(), dst.size(), src, size, &preferences);
+  if (LZ4F_isError(written)) {
+    return false;
+  }
+  dst.resize(written);
+  return true;
+}
+
+bool lz4_decompress(const char* src, size_t size, std::vector<char>& dst) {
+  LZ4F_dctx* raw = nullptr;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&raw, LZ4F_VERSION))) {
+    return false;
+  }
+  std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)> dctx(
+      raw, &LZ4F_freeDecompressionContext);
+
+  // size the output from the frame header when it knows, otherwise grow as we go
+  LZ4F_frameInfo_t info{};
+  size_t consumed = size;
+  auto hint = LZ4F_getFrameInfo(dctx.get(), &info, src, &consumed);
+  if (LZ4F_isError(hint)) {
+    return false;
+  }
+  dst.resize(info.contentSize ? info.contentSize : size * 4);
+
+  size_t in = consumed, out = 0;
+  while (hint != 0) {
+    // a frame that knows its size never needs more, it only has its end mark left to read
+    if (out == dst.size() && !info.contentSize) {
+      dst.resize(dst.size() * 2);
+    }
+    size_t src_size = size - in, dst_size = dst.size() - out;
+    hint = LZ4F_decompress(dctx.get(), dst.data() + out, &dst_size, src + in, &src_size, nullptr);
+    if (LZ4F_isError(hint) || (src_size == 0 && dst_size == 0)) {
+      return false;
+    }
+    in += src_size;
+    out += dst_size;
+  }
+  dst.resize(out);
+  return true;
+}
+#else
+bool lz4_compress(const char*, size_t, std::vector<char>&) {
+  return false;
+}
+
+bool lz4_decompress(const char*, size_t, std::vector<char>&) {
+  return false;
+}
+#endif
+
 } // namespace baldr
 } // namespace valhalla
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <list>
 #include <random>
@@ -9,6 +11,7 @@
 #include "baldr/graphtile.h"
 #include "baldr/json.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/constants.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -113,8 +116,54 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt,
   if (!reader) {
     reader = std::make_shared<GraphReader>(pt);
   }
-  auto tiles = reader->GetTileSet();
   transit_level = TileHierarchy::GetTransitLevel().level;
+  if (open(reader)) {
+    return;
+  }
+
+  // otherwise color the tiles we have
+  computed_ = color_tiles(reader->GetTileSet());
+  tiles_ = computed_.data();
+  tile_count_ = computed_.size();
+  for (const auto& tile : computed_) {
+    const auto level = GraphId(tile.tile_id).level();
+    levels_.resize(std::max<size_t>(levels_.size(), level + 1));
+    levels_[level] = true;
+  }
+}
+
+connectivity_map_t::connectivity_map_t() : transit_level(TileHierarchy::GetTransitLevel().level) {
+}
+
+std::shared_ptr<const connectivity_map_t>
+connectivity_map_t::load(const std::shared_ptr<GraphReader>& reader) {
+  std::shared_ptr<connectivity_map_t> connectivity(new connectivity_map_t());
+  return connectivity->open(reader) ? connectivity : nullptr;
+}
+
+bool connectivity_map_t::open(const std::shared_ptr<GraphReader>& reader) {
+  // the connectivity valhalla_build_connectivity stored with the tiles, the extract's first
+  const auto extract = reader->GetConnectivity();
+  const auto file = reader->tile_dir() + filesystem::path::preferred_separator + kConnectivityFile;
+  if (extract.first && load(extract.first, extract.second)) {
+    reader_ = reader;
+    LOG_INFO("Loaded the connectivity from the tile extract");
+    return true;
+  }
+  if (!reader->tile_dir().empty() && filesystem::exists(file)) {
+    file_.map(file, filesystem::directory_entry(file).file_size(), POSIX_MADV_RANDOM, true);
+    if (load(file_.get(), file_.size())) {
+      LOG_INFO("Loaded the connectivity from " + file);
+      return true;
+    }
+    file_.unmap();
+  }
+  return false;
+}
+
+std::vector<connectivity_map_t::tile_t>
+connectivity_map_t::color_tiles(const std::unordered_set<GraphId>& tiles) {
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
 
   // Quick hack to remove connectivity between known unconnected regions
   // The only land connection from north to south america is through
@@ -130,6 +179,7 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt,
   // then use this map as input to this singleton (via geojson?)
 
   // Populate a map for each level of the tiles that exist
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
   for (const auto& t : tiles) {
     auto& level_colors =
         colors.insert({t.level(), std::unordered_map<uint32_t, size_t>{}}).first->second;
@@ -148,22 +198,144 @@ connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt,
                                                               : decltype(not_neighbors){});
     }
   }
+
+  // flatten them into the layout of connectivity.bin
+  std::vector<tile_t> result;
+  result.reserve(tiles.size());
+  for (const auto& level : colors) {
+    for (const auto& tile : level.second) {
+      tile_t t{static_cast<uint32_t>(GraphId(tile.first, level.first, 0).value),
+               static_cast<uint32_t>(tile.second)};
+      std::fill(std::begin(t.component), std::end(t.component), kNoComponent);
+      std::fill(std::begin(t.first_node), std::end(t.first_node), 0);
+      result.push_back(t);
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const tile_t& a, const tile_t& b) { return a.tile_id < b.tile_id; });
+  return result;
+}
+
+bool connectivity_map_t::load(const char* data, size_t size) {
+  file_header_t header;
+  if (size < sizeof(header)) {
+    LOG_WARN("Ignoring the connectivity, it is truncated");
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+    LOG_WARN("Ignoring the connectivity, it is not of version " + std::to_string(kVersion));
+    return false;
+  }
+  uint64_t expected = sizeof(header) + header.tile_count * sizeof(tile_t);
+  for (size_t set = 0; set < kComponentSetCount; ++set) {
+    expected += header.node_count[set] * sizeof(node_t) + header.component_count[set];
+  }
+  if (size != expected) {
+    LOG_WARN("Ignoring the connectivity, its size does not match its header");
+    return false;
+  }
+
+  tiles_ = reinterpret_cast<const tile_t*>(data + sizeof(header));
+  tile_count_ = header.tile_count;
+  const char* next = reinterpret_cast<const char*>(tiles_ + tile_count_);
+  for (size_t set = 0; set < kComponentSetCount; ++set) {
+    nodes_[set] = reinterpret_cast<const node_t*>(next);
+    node_count_[set] = header.node_count[set];
+    next += node_count_[set] * sizeof(node_t);
+  }
+  for (size_t set = 0; set < kComponentSetCount; ++set) {
+    flags_[set] = reinterpret_cast<const uint8_t*>(next);
+    component_count_[set] = header.component_count[set];
+    next += component_count_[set];
+  }
+  has_components_ = true;
+  for (size_t i = 0; i < tile_count_; ++i) {
+    const auto level = GraphId(tiles_[i].tile_id).level();
+    levels_.resize(std::max<size_t>(levels_.size(), level + 1));
+    levels_[level] = true;
+  }
+  return true;
+}
+
+const connectivity_map_t::tile_t* connectivity_map_t::find_tile(const GraphId& id) const {
+  const auto tile_id = static_cast<uint32_t>(id.Tile_Base().value);
+  const auto* end = tiles_ + tile_count_;
+  const auto* tile = std::lower_bound(tiles_, end, tile_id, [](const tile_t& t, uint32_t id) {
+    return t.tile_id < id;
+  });
+  return tile != end && tile->tile_id == tile_id ? tile : nullptr;
 }
 
 bool connectivity_map_t::level_color_exists(const uint32_t level) const {
-  return colors.find(level) != colors.end();
+  return level < levels_.size() && levels_[level];
 }
 
 size_t connectivity_map_t::get_color(const GraphId& id) const {
-  auto level = colors.find(id.level());
-  if (level == colors.cend()) {
-    return 0;
+  const auto* tile = find_tile(id);
+  return tile ? tile->color : 0;
+}
+
+uint32_t connectivity_map_t::get_component(const GraphId& node, ComponentSet set) const {
+  const auto* tile = find_tile(node);
+  if (!has_components_ || !tile) {
+    return kNoComponent;
+  }
+
+  // the nodes of the tile that are not in its component
+  const auto s = static_cast<size_t>(set);
+  const auto* first = nodes_[s] + tile->first_node[s];
+  const auto* last = tile + 1 != tiles_ + tile_count_ ? nodes_[s] + tile[1].first_node[s]
+                                                      : nodes_[s] + node_count_[s];
+  const auto index = static_cast<uint32_t>(node.id());
+  const auto* found = std::lower_bound(first, last, index, [](const node_t& n, uint32_t index) {
+    return n.index < index;
+  });
+  return found != last && found->index == index ? found->component : tile->component[s];
+}
+
+bool connectivity_map_t::unreachable(const GraphId& from,
+                                     const GraphId& to,
+                                     ComponentSet set) const {
+  const auto a = get_component(from, set);
+  const auto b = get_component(to, set);
+  const auto s = static_cast<size_t>(set);
+  if (a == kNoComponent || b == kNoComponent || a == b || a >= component_count_[s] ||
+      b >= component_count_[s]) {
+    return false;
   }
-  auto color = level->second.find(id.tileid());
-  if (color == level->second.cend()) {
-    return 0;
+  return !(flags_[s][a] & kComponentLeft) || !(flags_[s][b] & kComponentEntered);
+}
+
+bool connectivity_map_t::strong_components(uint32_t access_mask, ComponentSet& set) {
+  for (size_t s = 1; s < kComponentSetCount; ++s) {
+    if (access_mask && (access_mask & kComponentSetAccess[s]) == access_mask) {
+      set = static_cast<ComponentSet>(s);
+      return true;
+    }
   }
-  return color->second;
+  return false;
+}
+
+std::unordered_set<uint32_t> connectivity_map_t::get_components(const baldr::PathLocation& location,
+                                                                GraphReader& reader) const {
+  std::unordered_set<uint32_t> result;
+  if (!has_components_) {
+    return result;
+  }
+  graph_tile_ptr tile;
+  for (const auto* edges : {&location.edges, &location.filtered_edges}) {
+    for (const auto& edge : *edges) {
+      const auto* directededge = reader.directededge(edge.id, tile);
+      const auto component = directededge ? get_component(directededge->endnode()) : kNoComponent;
+      // an edge we know nothing about could lead anywhere
+      if (component == kNoComponent) {
+        return {};
+      }
+      result.emplace(component);
+    }
+  }
+  return result;
 }
 
 std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel& hierarchy_level,
@@ -171,8 +343,7 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel
                                                           float radius) const {
 
   std::unordered_set<size_t> result;
-  auto level = colors.find(hierarchy_level.level);
-  if (level == colors.cend()) {
+  if (!level_color_exists(hierarchy_level.level)) {
     return result;
   }
   std::vector<const decltype(location.edges)*> edge_sets{&location.edges, &location.filtered_edges};
@@ -186,9 +357,9 @@ std::unordered_set<size_t> connectivity_map_t::get_colors(const baldr::TileLevel
       AABB2<PointLL> bbox(ll.lng() - lngdeg, ll.lat() - latdeg, ll.lng() + lngdeg, ll.lat() + latdeg);
       std::vector<int32_t> tilelist = hierarchy_level.tiles.TileList(bbox);
       for (const auto& id : tilelist) {
-        auto color = level->second.find(id);
-        if (color != level->second.cend()) {
-          result.emplace(color->second);
+        const auto* tile = find_tile(GraphId(id, hierarchy_level.level, 0));
+        if (tile) {
+          result.emplace(tile->color);
         }
       }
     }
@@ -208,15 +379,16 @@ std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const
   // make a region map (inverse mapping of color to lists of tiles)
   // could cache this but shouldnt need to call it much
   std::unordered_map<size_t, std::unordered_set<uint32_t>> regions;
-  auto level = colors.find(hierarchy_level);
-  if (level != colors.cend()) {
-    for (const auto& tile : level->second) {
-      auto region = regions.find(tile.second);
-      if (region == regions.end()) {
-        regions.emplace(tile.second, std::unordered_set<uint32_t>{tile.first});
-      } else {
-        region->second.emplace(tile.first);
-      }
+  for (size_t i = 0; i < tile_count_; ++i) {
+    const GraphId id(tiles_[i].tile_id);
+    if (id.level() != hierarchy_level) {
+      continue;
+    }
+    auto region = regions.find(tiles_[i].color);
+    if (region == regions.end()) {
+      regions.emplace(tiles_[i].color, std::unordered_set<uint32_t>{id.tileid()});
+    } else {
+      region->second.emplace(id.tileid());
     }
   }
 
@@ -247,13 +419,10 @@ std::vector<size_t> connectivity_map_t::to_image(const uint32_t hierarchy_level)
                                 : TileHierarchy::levels()[hierarchy_level].tiles;
 
   std::vector<size_t> tiles(level_tiles.nrows() * level_tiles.ncolumns(), 0);
-  auto level = colors.find(hierarchy_level);
-  if (level != colors.cend()) {
-    for (size_t i = 0; i < tiles.size(); ++i) {
-      const auto color = level->second.find(static_cast<uint32_t>(i));
-      if (color != level->second.cend()) {
-        tiles[i] = color->second;
-      }
+  for (size_t i = 0; i < tile_count_; ++i) {
+    const GraphId id(tiles_[i].tile_id);
+    if (id.level() == hierarchy_level && id.tileid() < tiles.size()) {
+      tiles[id.tileid()] = tiles_[i].color;
     }
   }
 
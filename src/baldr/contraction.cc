@@ -0,0 +1,284 @@
+#include "baldr/contraction.h"
+#include "filesystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kContractionMagic[8] = {'V', 'A', 'L', 'H', 'A', 'L', 'C', 'H'};
+constexpr uint32_t kContractionVersion = 1;
+constexpr size_t kMaxCostingName = 32;
+
+// Fixed size header at the start of an overlay file, followed by the nodes, the ranks and the arcs
+struct ContractionHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t level;
+  uint64_t dataset_id;
+  uint64_t node_count;
+  uint64_t arc_count;
+  char costing[kMaxCostingName];
+};
+
+template <typename T> void read_array(std::ifstream& file, std::vector<T>& array, size_t count) {
+  array.resize(count);
+  file.read(reinterpret_cast<char*>(array.data()), count * sizeof(T));
+}
+
+template <typename T> void write_array(std::ofstream& file, const std::vector<T>& array) {
+  file.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(T));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+ContractionOverlay::ContractionOverlay(std::vector<GraphId> nodes,
+                                       std::vector<uint32_t> ranks,
+                                       std::vector<ContractionArc> arcs,
+                                       const uint8_t level,
+                                       const std::string& costing,
+                                       const uint64_t dataset_id)
+    : nodes_(std::move(nodes)), ranks_(std::move(ranks)), arcs_(std::move(arcs)), level_(level),
+      costing_(costing), dataset_id_(dataset_id) {
+  if (nodes_.size() != ranks_.size()) {
+    throw std::logic_error("Contraction overlay needs exactly one rank per node");
+  }
+  if (costing_.size() >= kMaxCostingName) {
+    throw std::logic_error("Contraction overlay costing name is too long: " + costing_);
+  }
+  Index();
+}
+
+std::string ContractionOverlay::file_name(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + filesystem::path::preferred_separator + "contraction" +
+         filesystem::path::preferred_separator + costing + ".ch";
+}
+
+std::shared_ptr<const ContractionOverlay> ContractionOverlay::Load(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::in | std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open contraction overlay " + file_name);
+  }
+
+  ContractionHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, kContractionMagic, sizeof(kContractionMagic)) != 0 ||
+      header.version != kContractionVersion) {
+    throw std::runtime_error("Not a supported contraction overlay " + file_name);
+  }
+
+  auto overlay = std::make_shared<ContractionOverlay>();
+  overlay->level_ = header.level;
+  overlay->dataset_id_ = header.dataset_id;
+  overlay->costing_.assign(header.costing, strnlen(header.costing, kMaxCostingName));
+  read_array(file, overlay->nodes_, header.node_count);
+  read_array(file, overlay->ranks_, header.node_count);
+  read_array(file, overlay->arcs_, header.arc_count);
+  if (!file) {
+    throw std::runtime_error("Truncated contraction overlay " + file_name);
+  }
+
+  // sanity check the arcs so that a corrupt file fails here rather than while routing
+  for (const auto& arc : overlay->arcs_) {
+    if (arc.from >= header.node_count || arc.to >= header.node_count ||
+        (arc.is_shortcut() && (arc.first >= header.arc_count || arc.second >= header.arc_count))) {
+      throw std::runtime_error("Corrupt contraction overlay " + file_name);
+    }
+  }
+  overlay->Index();
+  return overlay;
+}
+
+void ContractionOverlay::Save(const std::string& file_name) const {
+  filesystem::path path(file_name);
+  if (!filesystem::exists(path.parent_path())) {
+    filesystem::create_directories(path.parent_path());
+  }
+
+  std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("Could not write contraction overlay " + file_name);
+  }
+
+  ContractionHeader header{};
+  std::memcpy(header.magic, kContractionMagic, sizeof(kContractionMagic));
+  header.version = kContractionVersion;
+  header.level = level_;
+  header.dataset_id = dataset_id_;
+  header.node_count = nodes_.size();
+  header.arc_count = arcs_.size();
+  std::memcpy(header.costing, costing_.data(), costing_.size());
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_array(file, nodes_);
+  write_array(file, ranks_);
+  write_array(file, arcs_);
+  if (!file) {
+    throw std::runtime_error("Failed writing contraction overlay " + file_name);
+  }
+}
+
+uint32_t ContractionOverlay::node_index(const GraphId& node) const {
+  auto found = std::lower_bound(nodes_.begin(), nodes_.end(), node);
+  return found == nodes_.end() || *found != node ? kInvalidContractionNode
+                                                 : static_cast<uint32_t>(found - nodes_.begin());
+}
+
+void ContractionOverlay::Index() {
+  // count the arcs of each node first so we can lay the lists out back to back
+  up_offsets_.assign(nodes_.size() + 1, 0);
+  down_offsets_.assign(nodes_.size() + 1, 0);
+  for (const auto& arc : arcs_) {
+    if (ranks_[arc.to] > ranks_[arc.from]) {
+      ++up_offsets_[arc.from + 1];
+    } else {
+      ++down_offsets_[arc.to + 1];
+    }
+  }
+  for (size_t i = 1; i < up_offsets_.size(); ++i) {
+    up_offsets_[i] += up_offsets_[i - 1];
+    down_offsets_[i] += down_offsets_[i - 1];
+  }
+
+  up_arcs_.resize(up_offsets_.back());
+  down_arcs_.resize(down_offsets_.back());
+  std::vector<uint32_t> up_fill(up_offsets_.begin(), up_offsets_.end() - 1);
+  std::vector<uint32_t> down_fill(down_offsets_.begin(), down_offsets_.end() - 1);
+  for (uint32_t i = 0; i < arcs_.size(); ++i) {
+    const auto& arc = arcs_[i];
+    if (ranks_[arc.to] > ranks_[arc.from]) {
+      up_arcs_[up_fill[arc.from]++] = i;
+    } else {
+      down_arcs_[down_fill[arc.to]++] = i;
+    }
+  }
+}
+
+void ContractionOverlay::Unpack(const uint32_t arc, std::vector<GraphId>& edges) const {
+  // depth first with an explicit stack, the second half of a shortcut goes on first
+  std::vector<uint32_t> stack{arc};
+  while (!stack.empty()) {
+    const auto& current = arcs_[stack.back()];
+    stack.pop_back();
+    if (current.is_shortcut()) {
+      stack.push_back(current.second);
+      stack.push_back(current.first);
+    } else {
+      edges.emplace_back(current.edgeid);
+    }
+  }
+}
+
+void ContractionSearch::direction_t::reset(const size_t node_count) {
+  if (costs.size() != node_count) {
+    costs.assign(node_count, std::numeric_limits<float>::max());
+    parents.assign(node_count, kInvalidArc);
+  } else {
+    for (auto node : touched) {
+      costs[node] = std::numeric_limits<float>::max();
+      parents[node] = kInvalidArc;
+    }
+  }
+  touched.clear();
+  queue = queue_t();
+}
+
+void ContractionSearch::direction_t::seed(const seed_t& seed) {
+  if (seed.cost < costs[seed.node]) {
+    if (costs[seed.node] == std::numeric_limits<float>::max()) {
+      touched.push_back(seed.node);
+    }
+    costs[seed.node] = seed.cost;
+    parents[seed.node] = kInvalidArc;
+    queue.emplace(seed.cost, seed.node);
+  }
+}
+
+float ContractionSearch::Find(const ContractionOverlay& overlay,
+                              const std::vector<seed_t>& sources,
+                              const std::vector<seed_t>& targets,
+                              std::vector<uint32_t>& arcs,
+                              uint32_t& source,
+                              uint32_t& target) {
+  arcs.clear();
+  forward_.reset(overlay.node_count());
+  reverse_.reset(overlay.node_count());
+  for (const auto& seed : sources) {
+    forward_.seed(seed);
+  }
+  for (const auto& seed : targets) {
+    reverse_.seed(seed);
+  }
+
+  constexpr float kNone = std::numeric_limits<float>::max();
+  float best = kNone;
+  uint32_t meeting = kInvalidContractionNode;
+  while (true) {
+    // stop once neither direction can improve on the best meeting found so far
+    float forward_min = forward_.queue.empty() ? kNone : forward_.queue.top().first;
+    float reverse_min = reverse_.queue.empty() ? kNone : reverse_.queue.top().first;
+    if (std::min(forward_min, reverse_min) >= best) {
+      break;
+    }
+
+    // expand whichever direction is behind
+    const bool is_forward = forward_min <= reverse_min;
+    auto& current = is_forward ? forward_ : reverse_;
+    const auto& other = is_forward ? reverse_ : forward_;
+    auto label = current.queue.top();
+    current.queue.pop();
+    const uint32_t node = label.second;
+    if (label.first > current.costs[node]) {
+      continue;
+    }
+
+    // both searches reached this node, is it the best place to meet?
+    if (other.costs[node] != kNone && label.first + other.costs[node] < best) {
+      best = label.first + other.costs[node];
+      meeting = node;
+    }
+
+    // forward relaxes arcs leaving towards higher ranks, reverse those entering from higher ranks
+    auto adjacent = is_forward ? overlay.up(node) : overlay.down(node);
+    for (auto* index = adjacent.first; index != adjacent.second; ++index) {
+      const auto& arc = overlay.arc(*index);
+      const uint32_t next = is_forward ? arc.to : arc.from;
+      const float cost = label.first + arc.cost;
+      if (cost < current.costs[next]) {
+        if (current.costs[next] == kNone) {
+          current.touched.push_back(next);
+        }
+        current.costs[next] = cost;
+        current.parents[next] = *index;
+        current.queue.emplace(cost, next);
+      }
+    }
+  }
+
+  if (meeting == kInvalidContractionNode) {
+    return kNone;
+  }
+
+  // walk the forward tree back to its source and then the reverse tree down to its target
+  source = meeting;
+  for (uint32_t arc = forward_.parents[source]; arc != kInvalidArc;
+       arc = forward_.parents[source]) {
+    arcs.push_back(arc);
+    source = overlay.arc(arc).from;
+  }
+  std::reverse(arcs.begin(), arcs.end());
+  target = meeting;
+  for (uint32_t arc = reverse_.parents[target]; arc != kInvalidArc;
+       arc = reverse_.parents[target]) {
+    arcs.push_back(arc);
+    target = overlay.arc(arc).to;
+  }
+  return best;
+}
+
+} // namespace baldr
+} // namespace valhalla
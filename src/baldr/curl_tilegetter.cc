@@ -0,0 +1,153 @@
+#include "baldr/curl_tilegetter.h"
+
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+using valhalla::baldr::tile_getter_t;
+
+// the requests that are being fetched by some getter of the process, keyed by their url
+struct in_flight_t {
+  std::mutex mutex;
+  std::unordered_map<std::string, std::shared_future<tile_getter_t::response_t>> fetches;
+
+  static in_flight_t& get() {
+    static in_flight_t in_flight;
+    return in_flight;
+  }
+};
+
+// compressed and uncompressed responses of the same url are different requests
+std::string in_flight_key(const std::string& url, bool gzipped) {
+  return (gzipped ? "gz " : "") + url;
+}
+
+tile_getter_t::response_t to_response(long http_code, std::vector<char>&& tile_data) {
+  tile_getter_t::response_t result;
+  // TODO: Check other codes.
+  if (http_code == 200) {
+    result.bytes_ = std::move(tile_data);
+    result.status_ = tile_getter_t::status_code_t::SUCCESS;
+  }
+  return result;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+curl_tile_getter_t::response_t curl_tile_getter_t::get(const std::string& url) {
+  auto& in_flight = in_flight_t::get();
+  const auto key = in_flight_key(url, gzipped_);
+
+  // if someone is already fetching it we wait for them
+  std::promise<response_t> promise;
+  std::shared_future<response_t> fetching;
+  {
+    std::lock_guard<std::mutex> lock(in_flight.mutex);
+    auto found = in_flight.fetches.find(key);
+    if (found != in_flight.fetches.cend()) {
+      fetching = found->second;
+    } else {
+      in_flight.fetches.emplace(key, promise.get_future().share());
+    }
+  }
+  if (fetching.valid()) {
+    try {
+      return fetching.get();
+    } catch (...) {
+      // their request was interrupted, that says nothing about ours
+      return fetch(url);
+    }
+  }
+
+  // otherwise we fetch it for everyone asking in the meantime
+  auto done = [&in_flight, &key]() {
+    std::lock_guard<std::mutex> lock(in_flight.mutex);
+    in_flight.fetches.erase(key);
+  };
+  try {
+    auto result = fetch(url);
+    promise.set_value(result);
+    done();
+    return result;
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+    done();
+    throw;
+  }
+}
+
+std::vector<curl_tile_getter_t::response_t>
+curl_tile_getter_t::get_batch(const std::vector<std::string>& urls) {
+  auto& in_flight = in_flight_t::get();
+  std::vector<response_t> results(urls.size());
+
+  // split the urls into the ones someone is already fetching and the ones we fetch
+  std::vector<std::pair<size_t, std::shared_future<response_t>>> waiting;
+  std::vector<size_t> fetching;
+  std::vector<std::string> fetching_urls;
+  std::vector<std::promise<response_t>> promises;
+  {
+    std::lock_guard<std::mutex> lock(in_flight.mutex);
+    for (size_t i = 0; i < urls.size(); ++i) {
+      const auto key = in_flight_key(urls[i], gzipped_);
+      auto found = in_flight.fetches.find(key);
+      if (found != in_flight.fetches.cend()) {
+        waiting.emplace_back(i, found->second);
+        continue;
+      }
+      promises.emplace_back();
+      in_flight.fetches.emplace(key, promises.back().get_future().share());
+      fetching.push_back(i);
+      fetching_urls.push_back(urls[i]);
+    }
+  }
+
+  auto done = [&]() {
+    std::lock_guard<std::mutex> lock(in_flight.mutex);
+    for (const auto& url : fetching_urls) {
+      in_flight.fetches.erase(in_flight_key(url, gzipped_));
+    }
+  };
+  size_t answered = 0;
+  try {
+    std::vector<long> http_codes;
+    std::vector<std::vector<char>> tile_data;
+    if (!fetching_urls.empty()) {
+      scoped_curler_t curler(curlers_);
+      tile_data = curler.get()(fetching_urls, http_codes, gzipped_, interrupt_);
+    }
+    for (; answered < fetching.size(); ++answered) {
+      results[fetching[answered]] = to_response(http_codes[answered], std::move(tile_data[answered]));
+      promises[answered].set_value(results[fetching[answered]]);
+    }
+    done();
+  } catch (...) {
+    for (; answered < promises.size(); ++answered) {
+      promises[answered].set_exception(std::current_exception());
+    }
+    done();
+    throw;
+  }
+
+  for (auto& wait : waiting) {
+    try {
+      results[wait.first] = wait.second.get();
+    } catch (...) { results[wait.first] = fetch(urls[wait.first]); }
+  }
+  return results;
+}
+
+curl_tile_getter_t::response_t curl_tile_getter_t::fetch(const std::string& url) {
+  scoped_curler_t curler(curlers_);
+  long http_code = 0;
+  auto tile_data = curler.get()(url, http_code, gzipped_, interrupt_);
+  return to_response(http_code, std::move(tile_data));
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -2,6 +2,8 @@
 #include "midgard/logging.h"
 #include "midgard/util.h"
 
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -30,9 +32,40 @@ struct curl_singleton_t {
   }
 };
 
+// connections, dns lookups and tls sessions are shared by all the curlers of the process so that
+// a curler can reuse a connection another one opened to the same server
+struct curl_share_t {
+  curl_share_t() : share(curl_share_init()) {
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  }
+  ~curl_share_t() {
+    curl_share_cleanup(share);
+  }
+  static void lock(CURL*, curl_lock_data data, curl_lock_access, void* self) {
+    static_cast<curl_share_t*>(self)->mutexes[data].lock();
+  }
+  static void unlock(CURL*, curl_lock_data data, void* self) {
+    static_cast<curl_share_t*>(self)->mutexes[data].unlock();
+  }
+  CURLSH* share;
+  std::array<std::mutex, CURL_LOCK_DATA_LAST> mutexes;
+};
+
 static std::shared_ptr<CURL> init_curl() {
   static curl_singleton_t s;
-  return std::shared_ptr<CURL>(curl_easy_init(), [](CURL* c) { curl_easy_cleanup(c); });
+  static curl_share_t shared;
+  std::shared_ptr<CURL> connection(curl_easy_init(), [](CURL* c) { curl_easy_cleanup(c); });
+  if (connection) {
+    curl_easy_setopt(connection.get(), CURLOPT_SHARE, shared.share);
+  }
+  return connection;
 }
 
 size_t write_callback(char* in, size_t block_size, size_t blocks, std::vector<char>* out) {
@@ -69,44 +102,57 @@ struct curler_t::pimpl_t {
     }
     assert_curl(curl_easy_setopt(connection.get(), CURLOPT_ERRORBUFFER, error),
                 "Failed to set error buffer ");
-    assert_curl(curl_easy_setopt(connection.get(), CURLOPT_FOLLOWLOCATION, 1L),
+    configure(connection.get());
+  }
+
+  // the options every transfer uses
+  void configure(CURL* transfer) const {
+    assert_curl(curl_easy_setopt(transfer, CURLOPT_FOLLOWLOCATION, 1L),
                 "Failed to set redirect option ");
-    assert_curl(curl_easy_setopt(connection.get(), CURLOPT_WRITEFUNCTION, write_callback),
+    assert_curl(curl_easy_setopt(transfer, CURLOPT_WRITEFUNCTION, write_callback),
                 "Failed to set writer ");
     // this is less secure but we'll worry about that later
-    assert_curl(curl_easy_setopt(connection.get(), CURLOPT_SSL_VERIFYPEER, 0L),
+    assert_curl(curl_easy_setopt(transfer, CURLOPT_SSL_VERIFYPEER, 0L),
                 "Failed to disable peer verification ");
-    assert_curl(curl_easy_setopt(connection.get(), CURLOPT_SSL_VERIFYHOST, 0L),
+    assert_curl(curl_easy_setopt(transfer, CURLOPT_SSL_VERIFYHOST, 0L),
                 "Failed to disable host verification ");
+    // http/2 where the server speaks it, so the transfers of a batch can share one connection
+    curl_easy_setopt(transfer, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(transfer, CURLOPT_PIPEWAIT, 1L);
   }
 
-  // TODO: retries?
-  std::vector<char> fetch(const std::string& url,
-                          long& http_code,
-                          bool gzipped,
-                          const curler_t::interrupt_t* interrupt) const {
+  // the options that depend on the request
+  void prepare(CURL* transfer, bool gzipped, const curler_t::interrupt_t* interrupt) const {
     if (interrupt) {
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_XFERINFOFUNCTION, progress_callback),
+      assert_curl(curl_easy_setopt(transfer, CURLOPT_XFERINFOFUNCTION, progress_callback),
                   "Failed to set custom progress callback ");
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_XFERINFODATA, interrupt),
+      assert_curl(curl_easy_setopt(transfer, CURLOPT_XFERINFODATA, interrupt),
                   "Failed to set custom progress data");
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_NOPROGRESS, 0L),
+      assert_curl(curl_easy_setopt(transfer, CURLOPT_NOPROGRESS, 0L),
                   "Failed to turn the progress callback on ");
     }
 
     // use gzip compression in any case
-    assert_curl(curl_easy_setopt(connection.get(), CURLOPT_ACCEPT_ENCODING, "gzip"),
+    assert_curl(curl_easy_setopt(transfer, CURLOPT_ACCEPT_ENCODING, "gzip"),
                 "Failed to set content encoding header ");
     // Curler do uncompressing by default. So if user asks for compressed data,
     // we just disable default uncompressing
     if (gzipped) {
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_HTTP_CONTENT_DECODING, 0L),
+      assert_curl(curl_easy_setopt(transfer, CURLOPT_HTTP_CONTENT_DECODING, 0L),
                   "Failed to disable decoding ");
     }
     // set the user agent
     if (!user_agent.empty())
-      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_USERAGENT, user_agent.c_str()),
+      assert_curl(curl_easy_setopt(transfer, CURLOPT_USERAGENT, user_agent.c_str()),
                   "Failed to set User-Agent ");
+  }
+
+  // TODO: retries?
+  std::vector<char> fetch(const std::string& url,
+                          long& http_code,
+                          bool gzipped,
+                          const curler_t::interrupt_t* interrupt) const {
+    prepare(connection.get(), gzipped, interrupt);
     // set the url
     assert_curl(curl_easy_setopt(connection.get(), CURLOPT_URL, url.c_str()), "Failed to set URL ");
     // set the location of the result
@@ -121,6 +167,80 @@ struct curler_t::pimpl_t {
     return result;
   }
 
+  std::vector<std::vector<char>> fetch(const std::vector<std::string>& urls,
+                                       std::vector<long>& http_codes,
+                                       bool gzipped,
+                                       const curler_t::interrupt_t* interrupt) const {
+    std::vector<std::vector<char>> results(urls.size());
+    http_codes.assign(urls.size(), 0);
+    if (urls.empty()) {
+      return results;
+    }
+
+    // one multi handle drives all the transfers, multiplexing them where the server allows it
+    std::shared_ptr<CURLM> multi(curl_multi_init(), [](CURLM* m) { curl_multi_cleanup(m); });
+    if (!multi) {
+      throw std::runtime_error("Failed to created CURL multi handle");
+    }
+    curl_multi_setopt(multi.get(), CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    std::vector<std::shared_ptr<CURL>> transfers;
+    transfers.reserve(urls.size());
+    // the transfers have to leave the multi handle before either is cleaned up
+    midgard::Finally<std::function<void()>> remove_transfers([&multi, &transfers]() {
+      for (const auto& transfer : transfers) {
+        curl_multi_remove_handle(multi.get(), transfer.get());
+      }
+    });
+    for (size_t i = 0; i < urls.size(); ++i) {
+      auto transfer = init_curl();
+      if (!transfer) {
+        throw std::runtime_error("Failed to created CURL connection");
+      }
+      configure(transfer.get());
+      prepare(transfer.get(), gzipped, interrupt);
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_URL, urls[i].c_str()),
+                  "Failed to set URL ");
+      assert_curl(curl_easy_setopt(transfer.get(), CURLOPT_WRITEDATA, &results[i]),
+                  "Failed to set write data ");
+      curl_multi_add_handle(multi.get(), transfer.get());
+      transfers.push_back(std::move(transfer));
+    }
+
+    // drive them all until they are done
+    int running = 0;
+    do {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      if (curl_multi_perform(multi.get(), &running) != CURLM_OK) {
+        throw std::runtime_error("Failed to get URLs");
+      }
+      if (running) {
+        curl_multi_wait(multi.get(), nullptr, 0, 100, nullptr);
+      }
+    } while (running);
+
+    // grab the return codes of the ones that went through
+    int left = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi.get(), &left)) {
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+      auto transfer = std::find_if(transfers.cbegin(), transfers.cend(),
+                                   [message](const std::shared_ptr<CURL>& t) {
+                                     return t.get() == message->easy_handle;
+                                   });
+      auto i = transfer - transfers.cbegin();
+      if (message->data.result == CURLE_OK) {
+        curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &http_codes[i]);
+      } else {
+        LOG_WARN("Failed to get URL " + urls[i] + ": " + curl_easy_strerror(message->data.result));
+      }
+    }
+    return results;
+  }
+
   void assert_curl(CURLcode code, const std::string& msg) const {
     if (code != CURLE_OK) {
       std::string what = msg + error;
@@ -144,6 +264,13 @@ std::vector<char> curler_t::operator()(const std::string& url,
   return pimpl->fetch(url, http_code, gzipped, interrupt);
 }
 
+std::vector<std::vector<char>> curler_t::operator()(const std::vector<std::string>& urls,
+                                                    std::vector<long>& http_codes,
+                                                    bool gzipped,
+                                                    const curler_t::interrupt_t* interrupt) const {
+  return pimpl->fetch(urls, http_codes, gzipped, interrupt);
+}
+
 // curler_pool_t
 
 curler_pool_t::curler_pool_t(const size_t pool_size, const std::string& user_agent)
@@ -188,6 +315,13 @@ curler_t::operator()(const std::string&, long&, bool gzipped, const curler_t::in
   LOG_ERROR("This version of libvalhalla was not built with CURL support");
   throw std::runtime_error("This version of libvalhalla was not built with CURL support");
 }
+std::vector<std::vector<char>> curler_t::operator()(const std::vector<std::string>&,
+                                                    std::vector<long>&,
+                                                    bool,
+                                                    const curler_t::interrupt_t*) const {
+  LOG_ERROR("This version of libvalhalla was not built with CURL support");
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
 
 curler_pool_t::curler_pool_t(const size_t pool_size, const std::string&) : size_(pool_size) {
 }
@@ -41,6 +41,16 @@ from_cache(const TP& tp,
   infos.emplace_back(tp.get_info());
   return infos.back();
 }
+
+// the local time of a utc time, from the offsets of the timezone when it has them
+date::local_seconds to_local(const uint64_t seconds, const date::time_zone* time_zone) {
+  using namespace valhalla::baldr::DateTime;
+  if (const auto* offsets = get_tz_db().offsets(time_zone)) {
+    return date::local_seconds(std::chrono::seconds(seconds + offsets->offset(seconds)));
+  }
+  return date::make_zoned(time_zone, date::sys_seconds(std::chrono::seconds(seconds)))
+      .get_local_time();
+}
 } // namespace
 
 using namespace valhalla::baldr;
@@ -48,15 +58,51 @@ namespace valhalla {
 namespace baldr {
 namespace DateTime {
 
-tz_db_t::tz_db_t() : db(date::get_tzdb()) {
+tz_offsets_t::tz_offsets_t(const date::time_zone* time_zone) : time_zone_(time_zone) {
+  // walk the transitions of the range, the ones that keep the offset don't matter
+  date::sys_seconds at{std::chrono::seconds(kBegin)};
+  const date::sys_seconds end{std::chrono::seconds(kEnd)};
+  while (at < end) {
+    const auto info = time_zone->get_info(at);
+    const auto offset = static_cast<int32_t>(info.offset.count());
+    if (offsets_.empty() || offsets_.back() != offset) {
+      begins_.push_back(at.time_since_epoch().count());
+      offsets_.push_back(offset);
+    }
+    if (info.end <= at) {
+      break;
+    }
+    at = info.end;
+  }
+}
+
+int32_t tz_offsets_t::offset(int64_t seconds) const {
+  if (seconds < kBegin || seconds >= kEnd || begins_.empty()) {
+    return static_cast<int32_t>(
+        time_zone_->get_info(date::sys_seconds(std::chrono::seconds(seconds))).offset.count());
+  }
+  // the first begin is kBegin so there is always one before
+  const auto next = std::upper_bound(begins_.begin(), begins_.end(), seconds);
+  return offsets_[next - begins_.begin() - 1];
+}
+
+tz_db_t::tz_db_t()
+    : db(date::get_tzdb()), offsets_(new std::atomic<const tz_offsets_t*>[db.zones.size()]) {
   // NOTE: outside of this class 0 is reserved for invalid timezone
   // so we offset each index by 1 to get into the valid range 1-300 or so
   size_t idx{0};
   for (const auto& zone : db.zones) {
+    offsets_[idx].store(nullptr);
     names.emplace(zone.name(), ++idx);
   }
 }
 
+tz_db_t::~tz_db_t() {
+  for (size_t i = 0; i < db.zones.size(); ++i) {
+    delete offsets_[i].load();
+  }
+}
+
 size_t tz_db_t::to_index(const std::string& zone) const {
   auto it = names.find(zone);
   if (it == names.cend()) {
@@ -72,6 +118,26 @@ const date::time_zone* tz_db_t::from_index(size_t index) const {
   return &db.zones[index - 1];
 }
 
+const tz_offsets_t* tz_db_t::offsets(const date::time_zone* time_zone) const {
+  const std::less<const date::time_zone*> before;
+  if (!time_zone || before(time_zone, db.zones.data()) ||
+      !before(time_zone, db.zones.data() + db.zones.size())) {
+    return nullptr;
+  }
+  auto& made = offsets_[time_zone - db.zones.data()];
+  const auto* offsets = made.load(std::memory_order_acquire);
+  if (!offsets) {
+    // threads asking for the same zone at once each make it, the first one to finish wins
+    auto* mine = new tz_offsets_t(time_zone);
+    if (made.compare_exchange_strong(offsets, mine, std::memory_order_acq_rel)) {
+      offsets = mine;
+    } else {
+      delete mine;
+    }
+  }
+  return offsets;
+}
+
 const tz_db_t& get_tz_db() {
   static const tz_db_t tz_db;
   return tz_db;
@@ -145,6 +211,14 @@ int timezone_diff(const uint64_t seconds,
   if (!origin_tz || !dest_tz || origin_tz == dest_tz) {
     return 0;
   }
+
+  // the offset tables need neither a zoned time nor the cache
+  const auto* origin_offsets = get_tz_db().offsets(origin_tz);
+  const auto* dest_offsets = get_tz_db().offsets(dest_tz);
+  if (origin_offsets && dest_offsets) {
+    return dest_offsets->offset(seconds) - origin_offsets->offset(seconds);
+  }
+
   std::chrono::seconds dur(seconds);
   std::chrono::time_point<std::chrono::system_clock> tp(dur);
 
@@ -281,14 +355,11 @@ bool is_conditional_active(const bool type,
   std::chrono::minutes b_td = std::chrono::hours(0);
   std::chrono::minutes e_td = std::chrono::hours(23) + std::chrono::minutes(59);
 
-  std::chrono::seconds dur(current_time);
-  std::chrono::time_point<std::chrono::system_clock> tp(dur);
-
   uint32_t e_year = 0, b_year = 0;
-  const auto in_local_time = date::make_zoned(time_zone, tp);
-  auto date = date::floor<date::days>(in_local_time.get_local_time());
+  const auto in_local_time = to_local(current_time, time_zone);
+  auto date = date::floor<date::days>(in_local_time);
   auto d = date::year_month_day(date);
-  auto t = date::make_time(in_local_time.get_local_time() - date); // Yields time_of_day type
+  auto t = date::make_time(in_local_time - date); // Yields time_of_day type
   std::chrono::minutes td = t.hours() + t.minutes();               // Yields time_of_day type
 
   try {
@@ -461,12 +532,11 @@ bool is_conditional_active(const bool type,
       e_td = std::chrono::hours(end_hrs) + std::chrono::minutes(end_mins);
     }
 
-    // Time does not matter here; we are only dealing with dates.
-    auto b_in_local_time =
-        date::make_zoned(time_zone, date::local_days(begin_date), date::choose::latest);
-    auto local_dt = date::make_zoned(time_zone, date::local_days(d), date::choose::latest);
-    auto e_in_local_time =
-        date::make_zoned(time_zone, date::local_days(end_date), date::choose::latest);
+    // Time does not matter here; we are only dealing with dates. They are all local days so they
+    // compare the same without going through the timezone
+    const date::local_days b_in_local_time(begin_date);
+    const date::local_days local_dt(d);
+    const date::local_days e_in_local_time(end_date);
 
     if (edge_case) {
 
@@ -477,22 +547,17 @@ bool is_conditional_active(const bool type,
       // end date = Jan 02, 2021
       date::year_month_day new_ed =
           date::year_month_day(date::year(b_year), date::month(12), date::day(31));
-      auto new_e_in_local_time =
-          date::make_zoned(time_zone, date::local_days(new_ed), date::choose::latest);
+      const date::local_days new_e_in_local_time(new_ed);
 
       date::year_month_day new_bd =
           date::year_month_day(date::year(b_year), date::month(1), date::day(1));
-      auto new_b_in_local_time =
-          date::make_zoned(time_zone, date::local_days(new_bd), date::choose::latest);
+      const date::local_days new_b_in_local_time(new_bd);
 
       // we need to check Jan 04, 2021 to Dec 31, 2021 and Jan 01, 2021 to Jan 02, 2021
-      dt_in_range = (((b_in_local_time.get_local_time() <= local_dt.get_local_time() &&
-                       local_dt.get_local_time() <= new_e_in_local_time.get_local_time())) ||
-                     ((new_b_in_local_time.get_local_time() <= local_dt.get_local_time() &&
-                       local_dt.get_local_time() <= e_in_local_time.get_local_time())));
+      dt_in_range = ((b_in_local_time <= local_dt && local_dt <= new_e_in_local_time) ||
+                     (new_b_in_local_time <= local_dt && local_dt <= e_in_local_time));
     } else {
-      dt_in_range = (b_in_local_time.get_local_time() <= local_dt.get_local_time() &&
-                     local_dt.get_local_time() <= e_in_local_time.get_local_time());
+      dt_in_range = (b_in_local_time <= local_dt && local_dt <= e_in_local_time);
     }
 
     bool time_in_range = false;
@@ -509,6 +574,16 @@ bool is_conditional_active(const bool type,
 }
 
 uint32_t second_of_week(uint32_t epoch_time, const date::time_zone* time_zone) {
+  // the offsets of the timezone are just a bit of arithmetic away from the second of the week
+  if (const auto* offsets = get_tz_db().offsets(time_zone)) {
+    const int64_t local = static_cast<int64_t>(epoch_time) + offsets->offset(epoch_time);
+    const int64_t days = local / midgard::kSecondsPerDay - (local % midgard::kSecondsPerDay < 0);
+    // 1970-01-01 was a thursday, the 4th day of a week that starts on sunday
+    const uint32_t day = ((days + 4) % 7 + 7) % 7;
+    return day * midgard::kSecondsPerDay +
+           static_cast<uint32_t>(local - days * midgard::kSecondsPerDay);
+  }
+
   // get the date time in this timezone
   std::chrono::seconds dur(epoch_time);
   std::chrono::time_point<std::chrono::system_clock> utp(dur);
@@ -0,0 +1,59 @@
+#include "baldr/defaultedgecosts.h"
+
+#include <memory>
+
+namespace {
+
+// Whether tiles keep default edge costs, see DefaultEdgeCosts::set_enabled
+std::atomic<bool> costs_enabled{false};
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+DefaultEdgeCosts::DefaultEdgeCosts(const uint32_t edge_count) : edge_count_(edge_count) {
+  for (auto& costs : costs_) {
+    costs.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+DefaultEdgeCosts::~DefaultEdgeCosts() {
+  for (auto& costs : costs_) {
+    delete[] costs.load(std::memory_order_relaxed);
+  }
+}
+
+const DefaultEdgeCosts::Entry*
+DefaultEdgeCosts::Fill(const uint32_t costing, const std::function<void(Entry*)>& fill) const {
+  std::unique_ptr<Entry[]> filled(new Entry[edge_count_]);
+  fill(filled.get());
+
+  // whoever fills the array first wins, the entries handed out before must not change
+  const Entry* expected = nullptr;
+  if (costs_[costing].compare_exchange_strong(expected, filled.get(), std::memory_order_acq_rel)) {
+    return filled.release();
+  }
+  return expected;
+}
+
+size_t DefaultEdgeCosts::memory_usage() const {
+  size_t size = 0;
+  for (const auto& costs : costs_) {
+    if (costs.load(std::memory_order_relaxed)) {
+      size += edge_count_ * sizeof(Entry);
+    }
+  }
+  return size;
+}
+
+bool DefaultEdgeCosts::enabled() {
+  return costs_enabled.load(std::memory_order_relaxed);
+}
+
+void DefaultEdgeCosts::set_enabled(const bool enabled) {
+  costs_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -68,8 +68,13 @@ std::vector<std::string> parse_tagged_value(const char* ptr) {
 namespace valhalla {
 namespace baldr {
 
-EdgeInfo::EdgeInfo(char* ptr, const char* names_list, const size_t names_list_length)
-    : names_list_(names_list), names_list_length_(names_list_length) {
+EdgeInfo::EdgeInfo(char* ptr,
+                   const char* names_list,
+                   const size_t names_list_length,
+                   const ShapeCache* shape_cache,
+                   const uint32_t offset)
+    : shape_cache_(shape_cache), offset_(offset), names_list_(names_list),
+      names_list_length_(names_list_length) {
 
   ei_ = *reinterpret_cast<EdgeInfoInner*>(ptr);
   ptr += sizeof(EdgeInfoInner);
@@ -321,9 +326,18 @@ uint16_t EdgeInfo::GetTypes() const {
 // Returns shape as a vector of PointLL
 // TODO: use shared ptr here so that we dont have to worry about lifetime
 const std::vector<midgard::PointLL>& EdgeInfo::shape() const {
+  // the tile may already have decoded the shape for another request
+  if (shape_cached()) {
+    if (!cached_shape_) {
+      cached_shape_ = shape_cache_->get(offset_, encoded_shape_, ei_.encoded_shape_size_);
+    }
+    return *cached_shape_;
+  }
+
   // if we haven't yet decoded the shape, do so
   if (encoded_shape_ != nullptr && shape_.empty()) {
     shape_ = midgard::decode7<std::vector<midgard::PointLL>>(encoded_shape_, ei_.encoded_shape_size_);
+    ShapeCache::count_decode();
   }
   return shape_;
 }
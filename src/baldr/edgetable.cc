@@ -0,0 +1,172 @@
+#include "baldr/edgetable.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace {
+
+// How long a loaded table is used before its file is checked for changes again
+constexpr auto kReloadCheckInterval = std::chrono::seconds(1);
+
+// The loaded tables of the whole process, see EdgeTable::get
+struct loaded_table_t {
+  std::shared_ptr<const valhalla::baldr::EdgeTable> table;
+  decltype(stat::st_ino) inode;
+  decltype(stat::st_mtime) modified;
+  decltype(stat::st_size) size;
+  std::chrono::steady_clock::time_point checked;
+};
+
+std::mutex tables_mutex;
+std::string tables_dir;
+std::unordered_map<std::string, loaded_table_t> tables;
+
+bool valid_id(const std::string& id) {
+  return !id.empty() && std::all_of(id.begin(), id.end(), [](const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' ||
+           c == '_';
+  });
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+EdgeTable::EdgeTable(const std::string& file_name) : entries_(nullptr) {
+  struct stat s;
+  if (stat(file_name.c_str(), &s) || s.st_size < static_cast<off_t>(sizeof(EdgeTableHeader))) {
+    throw std::runtime_error("Edge table " + file_name + " is missing or too small");
+  }
+  memory_.map_readonly(file_name, s.st_size);
+
+  const auto* header = reinterpret_cast<const EdgeTableHeader*>(memory_.get());
+  if (std::memcmp(header->magic, kEdgeTableMagic, sizeof(kEdgeTableMagic)) != 0 ||
+      header->version != kEdgeTableVersion) {
+    throw std::runtime_error("Edge table " + file_name + " has an unknown format");
+  }
+  const size_t entries_offset =
+      sizeof(EdgeTableHeader) + size_t(header->tile_count) * sizeof(EdgeTableTile);
+  if (memory_.size() < entries_offset) {
+    throw std::runtime_error("Edge table " + file_name + " is truncated");
+  }
+  const size_t entry_count = (memory_.size() - entries_offset) / sizeof(EdgeTableEntry);
+
+  const auto* tile = reinterpret_cast<const EdgeTableTile*>(memory_.get() + sizeof(EdgeTableHeader));
+  tiles_.reserve(header->tile_count);
+  for (uint32_t i = 0; i < header->tile_count; ++i, ++tile) {
+    if (size_t(tile->offset) + tile->edge_count > entry_count) {
+      throw std::runtime_error("Edge table " + file_name + " has entries beyond its end");
+    }
+    tiles_.emplace(tile->tile_id, tile);
+  }
+  entries_ = reinterpret_cast<const EdgeTableEntry*>(memory_.get() + entries_offset);
+}
+
+void EdgeTable::write(const std::string& file_name,
+                      const std::unordered_map<GraphId, EdgeTableEntry>& entries) {
+  // how many entries each tile needs
+  std::map<uint64_t, uint32_t> edge_counts;
+  for (const auto& entry : entries) {
+    auto& count = edge_counts[entry.first.Tile_Base()];
+    count = std::max(count, static_cast<uint32_t>(entry.first.id() + 1));
+  }
+
+  // lay the tiles out one after the other
+  std::vector<EdgeTableTile> tiles;
+  tiles.reserve(edge_counts.size());
+  uint32_t offset = 0;
+  for (const auto& count : edge_counts) {
+    tiles.push_back({count.first, offset, count.second});
+    offset += count.second;
+  }
+  std::vector<EdgeTableEntry> table(offset, EdgeTableEntry{});
+  for (const auto& entry : entries) {
+    const auto& tile = tiles[std::distance(edge_counts.begin(),
+                                           edge_counts.find(entry.first.Tile_Base()))];
+    table[tile.offset + entry.first.id()] = entry.second;
+  }
+
+  EdgeTableHeader header{};
+  std::memcpy(header.magic, kEdgeTableMagic, sizeof(kEdgeTableMagic));
+  header.version = kEdgeTableVersion;
+  header.tile_count = static_cast<uint32_t>(tiles.size());
+
+  std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open " + file_name + " to write the edge table");
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(EdgeTableTile));
+  file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(EdgeTableEntry));
+  if (!file) {
+    throw std::runtime_error("Could not write the edge table " + file_name);
+  }
+}
+
+std::shared_ptr<const EdgeTable> EdgeTable::get(const std::string& id) {
+  if (!valid_id(id)) {
+    throw std::runtime_error("Invalid edge table id: " + id);
+  }
+
+  std::lock_guard<std::mutex> lock(tables_mutex);
+  if (tables_dir.empty()) {
+    return {};
+  }
+
+  // use what we have until it is time to look at the file again
+  auto now = std::chrono::steady_clock::now();
+  auto found = tables.find(id);
+  if (found != tables.end() && now - found->second.checked < kReloadCheckInterval) {
+    return found->second.table;
+  }
+
+  // the table is gone
+  auto file_name = tables_dir + filesystem::path::preferred_separator + id + kEdgeTableSuffix;
+  struct stat s;
+  if (stat(file_name.c_str(), &s)) {
+    if (found != tables.end()) {
+      LOG_INFO("Edge table " + id + " was removed");
+      tables.erase(found);
+    }
+    return {};
+  }
+
+  // the table is still the same
+  if (found != tables.end() && found->second.inode == s.st_ino &&
+      found->second.modified == s.st_mtime && found->second.size == s.st_size) {
+    found->second.checked = now;
+    return found->second.table;
+  }
+
+  // the table is new or changed, requests holding the old one keep it until they are done
+  auto table = std::make_shared<const EdgeTable>(file_name);
+  LOG_INFO("Edge table " + id + (found == tables.end() ? " loaded" : " reloaded"));
+  tables[id] = {table, s.st_ino, s.st_mtime, s.st_size, now};
+  return table;
+}
+
+std::string EdgeTable::dir() {
+  std::lock_guard<std::mutex> lock(tables_mutex);
+  return tables_dir;
+}
+
+void EdgeTable::set_dir(const std::string& dir) {
+  std::lock_guard<std::mutex> lock(tables_mutex);
+  if (dir != tables_dir) {
+    tables.clear();
+  }
+  tables_dir = dir;
+}
+
+} // namespace baldr
+} // namespace valhalla
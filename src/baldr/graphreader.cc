@@ -1,16 +1,27 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
+#include "baldr/compression_utils.h"
 #include "baldr/connectivity_map.h"
 #include "baldr/curl_tilegetter.h"
+#include "baldr/edgetable.h"
 #include "baldr/graphreader.h"
 #include "filesystem.h"
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/numa.h"
 #include "shortcut_recovery.h"
 
 using namespace valhalla::midgard;
@@ -20,6 +31,12 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+constexpr size_t DEFAULT_CACHE_SHARDS = 64;
+
+// every how many tile accesses one is counted for the access log and how many counted accesses
+// a reader gathers before it hands them to the log
+constexpr uint64_t kAccessSampleRate = 16;
+constexpr uint32_t kAccessFlushSamples = 4096;
 
 struct tile_index_entry {
   uint64_t offset;  // byte offset from the beginning of the tar
@@ -27,11 +44,116 @@ struct tile_index_entry {
   uint32_t size;    // size of the tile in bytes
 };
 
+// level and tileindex only take 25 bits so this tile_id marks the index entry of the dictionary
+constexpr uint32_t kDictionaryIndexId = std::numeric_limits<uint32_t>::max();
+
+// whether the tile is on disk in any of the forms we can read
+bool tile_file_exists(const std::string& file_location) {
+  struct stat buffer;
+  for (const auto& suffix : {std::string(), std::string(".gz"), std::string(".zst"),
+                             std::string(".lz4")}) {
+    if (stat((file_location + suffix).c_str(), &buffer) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// compares incident locations with an edge index either way round, for equal_range
+struct edge_index_less {
+  using location_t = valhalla::baldr::IncidentLocation;
+  bool operator()(const location_t& location, const uint32_t edge_index) const {
+    return location.edge_index < edge_index;
+  }
+  bool operator()(const uint32_t edge_index, const location_t& location) const {
+    return edge_index < location.edge_index;
+  }
+};
+
+int to_posix_advice(const std::string& advice) {
+  if (advice == "normal")
+    return POSIX_MADV_NORMAL;
+  if (advice == "random")
+    return POSIX_MADV_RANDOM;
+  if (advice == "sequential")
+    return POSIX_MADV_SEQUENTIAL;
+  if (advice == "willneed")
+    return POSIX_MADV_WILLNEED;
+  if (advice == "dontneed")
+    return POSIX_MADV_DONTNEED;
+  throw std::runtime_error("Unknown tile extract advice: " + advice);
+}
+
+// Publishes the tile set again whenever the tile or traffic extract is replaced, which is done by
+// moving the new file over the old one. Live traffic written into the traffic extract changes
+// neither the inode nor the size of the file so it does not count as a replacement.
+class tile_set_watcher_t {
+public:
+  tile_set_watcher_t(const boost::property_tree::ptree& pt, std::chrono::seconds interval)
+      : pt_(pt), interval_(interval), stamp_(stamp()), thread_([this]() { watch(); }) {
+  }
+
+  ~tile_set_watcher_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    changed_.notify_one();
+    thread_.join();
+  }
+
+  // one watcher per process, the config of the first reader that asks for it wins
+  static void start(const boost::property_tree::ptree& pt, std::chrono::seconds interval) {
+    static tile_set_watcher_t watcher(pt, interval);
+  }
+
+private:
+  std::string stamp() const {
+    std::string stamp;
+    for (const auto* key : {"tile_extract", "traffic_extract"}) {
+      struct stat buffer;
+      const auto file_name = pt_.get<std::string>(key, "");
+      if (!file_name.empty() && stat(file_name.c_str(), &buffer) == 0) {
+        stamp += std::to_string(buffer.st_ino) + ":" + std::to_string(buffer.st_size);
+      }
+      stamp += ";";
+    }
+    return stamp;
+  }
+
+  void watch() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!changed_.wait_for(lock, interval_, [this]() { return done_; })) {
+      auto current = stamp();
+      if (current == stamp_) {
+        continue;
+      }
+      stamp_ = std::move(current);
+      LOG_INFO("Tile extract was replaced, loading it");
+      lock.unlock();
+      valhalla::baldr::GraphReader::PublishTileSet(pt_);
+      lock.lock();
+    }
+  }
+
+  const boost::property_tree::ptree pt_;
+  const std::chrono::seconds interval_;
+  std::string stamp_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  bool done_ = false;
+  std::thread thread_;
+};
+
 } // namespace
 
 namespace valhalla {
 namespace baldr {
 
+std::mutex GraphReader::published_tile_set_mutex_;
+std::shared_ptr<const GraphReader::tile_extract_t> GraphReader::published_tile_set_;
+std::atomic<uint64_t> GraphReader::published_tile_set_epoch_{0};
+
 tile_gone_error_t::tile_gone_error_t(const std::string& errormessage)
     : std::runtime_error(errormessage) {
 }
@@ -52,16 +174,19 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
     if (filename != "index.bin")
       return {};
 
-    // get the info
-    decltype(midgard::tar::contents) contents;
+    // get the info, we only need to map graph ids to their location in the tar so we dont bother
+    // naming every entry for the tar, telling it about the index is enough to stop its scan
+    decltype(midgard::tar::contents) contents{{filename, {index_begin, size}}};
     auto entries = midgard::iterable_t<tile_index_entry>(reinterpret_cast<tile_index_entry*>(
                                                              const_cast<char*>(index_begin)),
                                                          size / sizeof(tile_index_entry));
+    (traffic_from_index ? traffic_tiles : tiles).reserve(entries.size());
     for (const auto& entry : entries) {
-      contents.insert(
-          std::make_pair(std::to_string(entry.tile_id),
-                         std::make_pair(const_cast<char*>(file_begin + entry.offset), entry.size)));
-      if (!traffic_from_index) {
+      if (!traffic_from_index && entry.tile_id == kDictionaryIndexId) {
+        dictionary = std::make_shared<const zstd_dictionary_t>(file_begin + entry.offset, entry.size);
+      } else if (!traffic_from_index && entry.tile_id == kConnectivityIndexId) {
+        connectivity = {file_begin + entry.offset, entry.size};
+      } else if (!traffic_from_index) {
         tiles.emplace(std::piecewise_construct, std::forward_as_tuple(entry.tile_id),
                       std::forward_as_tuple(const_cast<char*>(file_begin + entry.offset),
                                             entry.size));
@@ -86,6 +211,14 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
       // map files to graph ids
       if (tiles.empty()) {
         for (const auto& c : archive->contents) {
+          if (c.first == TILE_DICTIONARY) {
+            dictionary = std::make_shared<const zstd_dictionary_t>(c.second.first, c.second.second);
+            continue;
+          }
+          if (c.first == kConnectivityFile) {
+            connectivity = c.second;
+            continue;
+          }
           try {
             auto id = GraphTile::GetTileId(c.first);
             tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
@@ -120,10 +253,30 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
     }
   }
 
+  // tell the kernel how we are going to access the tiles of each level of the hierarchy, for
+  // example keeping the highway level resident while the local level is read randomly
+  if (archive) {
+    advise_levels(pt);
+  }
+
+  // read the tiles with pread so that only the tiles the reader holds on to take up its memory, the
+  // pages the index was read through are dropped again
+  if (archive && pt.get<bool>("tile_extract_pread", false)) {
+#ifndef _WIN32
+    fd = open(pt.get<std::string>("tile_extract").c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd == -1) {
+      LOG_WARN("Tile extract could not be opened for pread, its tiles are used through the mmap");
+    } else {
+      archive->mm.advise(0, archive->mm.size(), POSIX_MADV_DONTNEED);
+    }
+  }
+
   if (pt.get_optional<std::string>("traffic_extract")) {
     try {
       // load the tar
       traffic_from_index = true;
+      traffic_writable = !traffic_readonly;
       traffic_archive.reset(new midgard::tar(pt.get<std::string>("traffic_extract"), traffic_readonly,
                                              true, index_loader));
       if (traffic_tiles.empty()) {
@@ -163,6 +316,46 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
   }
 }
 
+GraphReader::tile_extract_t::~tile_extract_t() {
+#ifndef _WIN32
+  if (fd != -1) {
+    close(fd);
+  }
+#endif
+}
+
+void GraphReader::tile_extract_t::advise_levels(const boost::property_tree::ptree& pt) {
+  auto advice_config = pt.get_child_optional("tile_extract_advice");
+  if (!advice_config) {
+    return;
+  }
+
+  // parse the advice for each level by name
+  std::unordered_map<uint8_t, int> level_advice;
+  auto levels = TileHierarchy::levels();
+  levels.push_back(TileHierarchy::GetTransitLevel());
+  for (const auto& level : levels) {
+    auto advice = advice_config->get_optional<std::string>(level.name);
+    if (advice) {
+      level_advice[level.level] = to_posix_advice(*advice);
+    }
+  }
+  if (level_advice.empty()) {
+    return;
+  }
+
+  // apply it to the byte range of every tile on those levels
+  size_t advised = 0;
+  for (const auto& tile : tiles) {
+    auto advice = level_advice.find(GraphId(tile.first).level());
+    if (advice != level_advice.cend()) {
+      archive->mm.advise(tile.second.first - archive->mm.get(), tile.second.second, advice->second);
+      ++advised;
+    }
+  }
+  LOG_INFO("Applied access advice to " + std::to_string(advised) + " tiles of the extract");
+}
+
 // ----------------------------------------------------------------------------
 // FlatTileCache implementation
 // ----------------------------------------------------------------------------
@@ -277,8 +470,37 @@ void SimpleTileCache::Trim() {
 // ----------------------------------------------------------------------------
 
 // Constructor.
-TileCacheLRU::TileCacheLRU(size_t max_size, MemoryLimitControl mem_control)
+TileCacheLRU::TileCacheLRU(size_t max_size,
+                           MemoryLimitControl mem_control,
+                           const std::vector<float>& level_shares,
+                           bool admission)
     : mem_control_(mem_control), cache_size_(0), max_cache_size_(max_size) {
+  // split the limit by level if asked to, rounding down so the budgets never add up to more
+  float total = 0.f;
+  for (auto share : level_shares) {
+    if (share < 0.f) {
+      throw std::runtime_error("TileCacheLRU: level shares cannot be negative");
+    }
+    total += share;
+  }
+  if (total > 0.f) {
+    for (auto share : level_shares) {
+      budgets_.emplace_back();
+      budgets_.back().max_cache_size = static_cast<size_t>(max_size * (share / total));
+    }
+  } else {
+    budgets_.emplace_back();
+    budgets_.back().max_cache_size = max_size;
+  }
+
+  for (uint32_t level = 0; level < level_usage_.size(); ++level) {
+    level_usage_[level].level = level;
+  }
+
+  // enough counters to tell apart a few times as many tiles as fit into the cache
+  if (admission && mem_control_ == MemoryLimitControl::HARD) {
+    sketch_.reset(new FrequencySketch(4 * (max_size / AVERAGE_TILE_SIZE + 1)));
+  }
 }
 
 void TileCacheLRU::Reserve(size_t tile_size) {
@@ -293,20 +515,39 @@ bool TileCacheLRU::Contains(const GraphId& graphid) const {
 }
 
 bool TileCacheLRU::OverCommitted() const {
-  return cache_size_ > max_cache_size_;
+  if (cache_size_ > max_cache_size_) {
+    return true;
+  }
+  return budgets_.size() > 1 && std::any_of(budgets_.cbegin(), budgets_.cend(), [](const auto& b) {
+           return b.cache_size > b.max_cache_size;
+         });
 }
 
 void TileCacheLRU::Clear() {
   cache_size_ = 0;
   cache_.clear();
-  key_val_lru_list_.clear();
+  for (auto& budget : budgets_) {
+    budget.key_val_lru_list.clear();
+    budget.cache_size = 0;
+  }
+  for (auto& usage : level_usage_) {
+    usage.tiles = 0;
+    usage.bytes = 0;
+  }
 }
 
 void TileCacheLRU::Trim() {
-  TrimToFit(0);
+  for (auto& budget : budgets_) {
+    TrimToFit(budget, 0);
+  }
 }
 
 graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
+  // misses count as well, they are what gets put next
+  if (sketch_) {
+    sketch_->increment(graphid);
+  }
+
   auto cached = cache_.find(graphid);
   if (cached == cache_.cend()) {
     return nullptr;
@@ -318,22 +559,55 @@ graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
   return entry_iter->tile;
 }
 
-size_t TileCacheLRU::TrimToFit(const size_t required_size) {
+std::vector<TileCacheLevelUsage> TileCacheLRU::GetLevelUsage() const {
+  std::vector<TileCacheLevelUsage> usage;
+  for (const auto& level : level_usage_) {
+    const bool has_budget = budgets_.size() > 1 && level.level < budgets_.size();
+    if (level.tiles == 0 && level.rejected == 0 && !has_budget) {
+      continue;
+    }
+    usage.push_back(level);
+    if (budgets_.size() > 1) {
+      usage.back().max_bytes = GetBudget(GraphId(0, level.level, 0)).max_cache_size;
+    }
+  }
+  return usage;
+}
+
+size_t TileCacheLRU::TrimToFit(Budget& budget, const size_t required_size) {
   size_t freed_space = 0;
-  while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
-         !key_val_lru_list_.empty()) {
-    const KeyValue& entry_to_evict = key_val_lru_list_.back();
-    const auto tile_size = entry_to_evict.tile->header()->end_offset();
-    cache_size_ -= tile_size;
-    freed_space += tile_size;
+  while ((budget.cache_size > budget.max_cache_size ||
+          (budget.max_cache_size - budget.cache_size) < required_size) &&
+         !budget.key_val_lru_list.empty()) {
+    const KeyValue& entry_to_evict = budget.key_val_lru_list.back();
+    auto& usage = level_usage_[entry_to_evict.id.level()];
+    --usage.tiles;
+    usage.bytes -= entry_to_evict.size;
+    budget.cache_size -= entry_to_evict.size;
+    cache_size_ -= entry_to_evict.size;
+    freed_space += entry_to_evict.size;
     cache_.erase(entry_to_evict.id);
-    key_val_lru_list_.pop_back();
+    budget.key_val_lru_list.pop_back();
   }
   return freed_space;
 }
 
+bool TileCacheLRU::Admit(const GraphId& graphid,
+                         const Budget& budget,
+                         const size_t required_size) const {
+  if (required_size > budget.max_cache_size) {
+    return false;
+  }
+  if (!sketch_ || budget.key_val_lru_list.empty() ||
+      budget.max_cache_size - budget.cache_size >= required_size) {
+    return true;
+  }
+  return sketch_->estimate(graphid) > sketch_->estimate(budget.key_val_lru_list.back().id);
+}
+
 void TileCacheLRU::MoveToLruHead(const KeyValueIter& entry_iter) const {
-  key_val_lru_list_.splice(key_val_lru_list_.begin(), key_val_lru_list_, entry_iter);
+  auto& list = GetBudget(entry_iter->id).key_val_lru_list;
+  list.splice(list.begin(), list, entry_iter);
 }
 
 graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, size_t new_tile_size) {
@@ -341,13 +615,21 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
     throw std::runtime_error("TileCacheLRU: tile size is bigger than max cache size");
   }
 
+  auto& budget = GetBudget(graphid);
+  auto& usage = level_usage_[graphid.level()];
   auto cached = cache_.find(graphid);
   if (cached == cache_.end()) {
     if (mem_control_ == MemoryLimitControl::HARD) {
-      TrimToFit(new_tile_size);
+      // hand the tile back without caching it rather than evicting something more popular
+      if (!Admit(graphid, budget, new_tile_size)) {
+        ++usage.rejected;
+        return tile;
+      }
+      TrimToFit(budget, new_tile_size);
     }
-    key_val_lru_list_.emplace_front(KeyValue{graphid, std::move(tile)});
-    cache_.emplace(graphid, key_val_lru_list_.begin());
+    budget.key_val_lru_list.emplace_front(KeyValue{graphid, std::move(tile), new_tile_size});
+    cache_.emplace(graphid, budget.key_val_lru_list.begin());
+    ++usage.tiles;
   } else {
     // Value update; the new size may be different form the previous
     // TODO: in practice tile size for a specific id never changes
@@ -355,26 +637,42 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
     //  do we need to take it into account here? (can dramatically simplify the code)
     // note: SimpleTileCache does not handle the overwrite at the moment
     auto& entry_iter = cached->second;
-    const auto old_tile_size = entry_iter->tile->header()->end_offset();
+    const auto old_tile_size = entry_iter->size;
 
     // do it before TrimToFit avoid its eviction to free space
     MoveToLruHead(entry_iter);
 
     if (mem_control_ == MemoryLimitControl::HARD) {
+      // a tile that outgrew its budget can only be dropped
+      if (new_tile_size > budget.max_cache_size) {
+        budget.key_val_lru_list.pop_front();
+        cache_.erase(cached);
+        cache_size_ -= old_tile_size;
+        budget.cache_size -= old_tile_size;
+        usage.bytes -= old_tile_size;
+        --usage.tiles;
+        ++usage.rejected;
+        return tile;
+      }
       if (new_tile_size > old_tile_size) {
         const auto extra_size_required = new_tile_size - old_tile_size;
         // We do not allow insertion of items greater than the cache size
         // Thus it's not possible the current value will be evicted.
-        TrimToFit(extra_size_required);
+        TrimToFit(budget, extra_size_required);
       }
     }
 
     entry_iter->tile = std::move(tile);
+    entry_iter->size = new_tile_size;
     cache_size_ -= old_tile_size;
+    budget.cache_size -= old_tile_size;
+    usage.bytes -= old_tile_size;
   }
   cache_size_ += new_tile_size;
+  budget.cache_size += new_tile_size;
+  usage.bytes += new_tile_size;
 
-  return key_val_lru_list_.front().tile;
+  return budget.key_val_lru_list.front().tile;
 }
 
 // ----------------------------------------------------------------------------
@@ -415,6 +713,11 @@ void SynchronizedTileCache::Trim() {
   cache_.Trim();
 }
 
+std::vector<TileCacheLevelUsage> SynchronizedTileCache::GetLevelUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  return cache_.GetLevelUsage();
+}
+
 // Get a pointer to a graph tile object given a GraphId.
 graph_tile_ptr SynchronizedTileCache::Get(const GraphId& graphid) const {
   std::lock_guard<std::mutex> lock(mutex_ref_);
@@ -427,6 +730,169 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ShardedTileCache implementation
+// ----------------------------------------------------------------------------
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(size_t max_size,
+                                   size_t shard_count,
+                                   TileCacheLRU::MemoryLimitControl mem_control)
+    : shards_(std::make_shared<std::vector<Shard>>(std::max(shard_count, size_t(1)))),
+      mem_control_(mem_control), max_cache_size_(max_size),
+      max_shard_size_(max_size / shards_->size()) {
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size) {
+  assert(tile_size != 0);
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.write_mutex);
+    auto index = std::make_shared<index_t>(*std::atomic_load(&shard.index));
+    index->reserve(max_shard_size_ / tile_size);
+    std::atomic_store(&shard.index, std::shared_ptr<const index_t>(std::move(index)));
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const {
+  auto index = std::atomic_load(&GetShard(graphid).index);
+  return index->find(graphid) != index->cend();
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const {
+  size_t cache_size = 0;
+  for (const auto& shard : *shards_) {
+    cache_size += shard.cache_size.load(std::memory_order_relaxed);
+  }
+  return cache_size > max_cache_size_;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear() {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.write_mutex);
+    std::atomic_store(&shard.index, std::make_shared<const index_t>());
+    shard.cache_size = 0;
+  }
+}
+
+void ShardedTileCache::Trim() {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.write_mutex);
+    if (shard.cache_size <= max_shard_size_) {
+      continue;
+    }
+    auto index = std::make_shared<index_t>(*std::atomic_load(&shard.index));
+    TrimToFit(shard, *index, 0);
+    std::atomic_store(&shard.index, std::shared_ptr<const index_t>(std::move(index)));
+  }
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ShardedTileCache::Get(const GraphId& graphid) const {
+  auto& shard = GetShard(graphid);
+  auto index = std::atomic_load(&shard.index);
+  auto cached = index->find(graphid);
+  if (cached == index->cend()) {
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // only touch the entry if it wasn't already seen since the last insertion
+  const auto tick = shard.clock.load(std::memory_order_relaxed);
+  if (cached->second->last_access.load(std::memory_order_relaxed) != tick) {
+    cached->second->last_access.store(tick, std::memory_order_relaxed);
+  }
+  shard.hits.fetch_add(1, std::memory_order_relaxed);
+  return cached->second->tile;
+}
+
+void ShardedTileCache::TrimToFit(Shard& shard, index_t& index, size_t required_size) const {
+  if (shard.cache_size + required_size <= max_shard_size_) {
+    return;
+  }
+
+  // order the entries from the least to the most recently used
+  std::vector<std::pair<uint64_t, uint64_t>> by_access;
+  by_access.reserve(index.size());
+  for (const auto& kv : index) {
+    by_access.emplace_back(kv.second->last_access.load(std::memory_order_relaxed), kv.first);
+  }
+  std::sort(by_access.begin(), by_access.end());
+
+  for (const auto& access : by_access) {
+    if (shard.cache_size + required_size <= max_shard_size_) {
+      break;
+    }
+    auto entry = index.find(access.second);
+    shard.cache_size -= entry->second->size;
+    index.erase(entry);
+    shard.evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ShardedTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  if (size > max_shard_size_) {
+    throw std::runtime_error("ShardedTileCache: tile size is bigger than max shard size");
+  }
+
+  auto& shard = GetShard(graphid);
+  std::lock_guard<std::mutex> lock(shard.write_mutex);
+  auto index = std::make_shared<index_t>(*std::atomic_load(&shard.index));
+
+  // an overwrite gives back the space of the previous value before anything is evicted
+  auto cached = index->find(graphid);
+  if (cached != index->end()) {
+    shard.cache_size -= cached->second->size;
+    index->erase(cached);
+  }
+
+  if (mem_control_ == TileCacheLRU::MemoryLimitControl::HARD) {
+    TrimToFit(shard, *index, size);
+  }
+
+  const auto tick = shard.clock.fetch_add(1, std::memory_order_relaxed) + 1;
+  auto entry = std::make_shared<const Entry>(std::move(tile), size, tick);
+  index->emplace(graphid, entry);
+  shard.cache_size += size;
+
+  std::atomic_store(&shard.index, std::shared_ptr<const index_t>(std::move(index)));
+  return entry->tile;
+}
+
+ShardedTileCache::Stats ShardedTileCache::GetStats() const {
+  Stats stats;
+  for (const auto& shard : *shards_) {
+    stats.hits += shard.hits.load(std::memory_order_relaxed);
+    stats.misses += shard.misses.load(std::memory_order_relaxed);
+    stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+std::vector<TileCacheLevelUsage> ShardedTileCache::GetLevelUsage() const {
+  std::array<TileCacheLevelUsage, kMaxGraphHierarchy + 1> levels;
+  for (const auto& shard : *shards_) {
+    const auto index = std::atomic_load(&shard.index);
+    for (const auto& entry : *index) {
+      auto& level = levels[GraphId(entry.first).level()];
+      ++level.tiles;
+      level.bytes += entry.second->size;
+    }
+  }
+  std::vector<TileCacheLevelUsage> usage;
+  for (uint32_t i = 0; i < levels.size(); ++i) {
+    if (levels[i].tiles > 0) {
+      usage.push_back(levels[i]);
+      usage.back().level = i;
+    }
+  }
+  return usage;
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -436,19 +902,53 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
                              ? TileCacheLRU::MemoryLimitControl::HARD
                              : TileCacheLRU::MemoryLimitControl::SOFT;
 
+  // per level budgets and frequency aware admission of the lru cache
+  std::vector<float> lru_level_shares;
+  if (auto shares = pt.get_child_optional("lru_mem_cache_level_shares")) {
+    for (const auto& share : *shares) {
+      lru_level_shares.push_back(share.second.get_value<float>());
+    }
+  }
+  bool lru_admission = pt.get<bool>("lru_mem_cache_admission", false);
+
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
+  // the readers on one NUMA node share a global cache of their own, allocated by the first of
+  // them so that it sits on their node
+  const size_t cache_node =
+      pt.get<bool>("numa_local_cache", false) ? midgard::current_numa_node() : 0;
+
+  // the sharded cache is thread-safe by itself, when its global all readers share its shards
+  if (pt.get<bool>("use_sharded_mem_cache", false)) {
+    auto shard_count = pt.get<size_t>("sharded_mem_cache_shards", DEFAULT_CACHE_SHARDS);
+    if (pt.get<bool>("global_synchronized_cache", false)) {
+      static std::unordered_map<size_t, std::shared_ptr<ShardedTileCache>> globalShardedCaches_;
+      static std::mutex factoryMutex;
+      std::lock_guard<std::mutex> lock(factoryMutex);
+      auto& globalShardedCache_ = globalShardedCaches_[cache_node];
+      if (!globalShardedCache_) {
+        globalShardedCache_.reset(
+            new ShardedTileCache(max_cache_size, shard_count, lru_mem_control));
+      }
+      return new ShardedTileCache(*globalShardedCache_);
+    }
+    return new ShardedTileCache(max_cache_size, shard_count, lru_mem_control);
+  }
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
     // Handle synchronization of cache
-    static std::mutex globalCacheMutex_;
-    static std::shared_ptr<TileCache> globalTileCache_;
+    static std::unordered_map<size_t, std::mutex> globalCacheMutexes_;
+    static std::unordered_map<size_t, std::shared_ptr<TileCache>> globalTileCaches_;
     // We need to lock the factory method itself to prevent races
     static std::mutex factoryMutex;
     std::lock_guard<std::mutex> lock(factoryMutex);
+    auto& globalCacheMutex_ = globalCacheMutexes_[cache_node];
+    auto& globalTileCache_ = globalTileCaches_[cache_node];
     if (!globalTileCache_) {
       if (use_lru_cache) {
-        globalTileCache_.reset(new TileCacheLRU(max_cache_size, lru_mem_control));
+        globalTileCache_.reset(
+            new TileCacheLRU(max_cache_size, lru_mem_control, lru_level_shares, lru_admission));
       } else {
         // globalTileCache_.reset(new SimpleTileCache(max_cache_size));
         globalTileCache_.reset(new FlatTileCache(max_cache_size));
@@ -459,7 +959,7 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   // or do you want to use an LRU cache
   if (use_lru_cache) {
-    return new TileCacheLRU(max_cache_size, lru_mem_control);
+    return new TileCacheLRU(max_cache_size, lru_mem_control, lru_level_shares, lru_admission);
   }
 
   // maybe you want a basic hashmap of tiles
@@ -476,22 +976,33 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          std::unique_ptr<tile_getter_t>&& tile_getter,
                          bool traffic_readonly)
     : tile_extract_(new tile_extract_t(pt, traffic_readonly)),
+      tile_set_epoch_(published_tile_set_epoch_.load()),
       tile_dir_(tile_extract_->tiles.empty() ? pt.get<std::string>("tile_dir", "") : ""),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
-      tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
+      tile_url_(pt.get<std::string>("tile_url", "")),
+      tile_url_neighbors_(pt.get<bool>("tile_url_neighbors", false)),
+      cache_(TileCacheFactory::createTileCache(pt)),
+      shared_cache_(pt.get<bool>("global_synchronized_cache", false)),
+      prefetcher_(TilePrefetcher::shared(pt)),
+      prefetch_width_(pt.get<float>("tile_prefetch.corridor_width", 10.f)),
+      landmark_store_(LandmarkStore::get(pt.get<std::string>("landmark_store", ""))) {
 
   // Make a tile fetcher if we havent passed one in from somewhere else
   if (!tile_getter_ && !tile_url_.empty()) {
-    tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
-                                                        pt.get<std::string>("user_agent", ""),
-                                                        pt.get<bool>("tile_url_gz", false));
+    tile_getter_ = std::make_unique<curl_tile_getter_t>(
+        max_concurrent_users_, pt.get<std::string>("user_agent", ""),
+        pt.get<bool>("tile_url_gz", false),
+        GraphTile::CompressionSuffix(pt.get<std::string>("tile_url_compression", "")));
   }
 
   // validate tile url
   if (!tile_url_.empty() && tile_url_.find(GraphTile::kTilePathPattern) == std::string::npos)
     throw std::runtime_error("Not found tilePath pattern in tile url");
 
+  // zstd compressed tiles need the dictionary they were compressed with
+  tile_dictionary_ = LoadTileDictionary();
+
   // Reserve cache (based on whether using individual tile files or shared,
   // mmap'd file
   cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
@@ -507,10 +1018,244 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                                                            : GetTileSet());
   }
 
+  // Let tiles with predicted speeds remember the last speed they decoded for each edge
+  if (pt.get<bool>("predicted_speed_cache", false)) {
+    PredictedSpeeds::set_cache_enabled(true);
+  }
+
+  // Let requests name the edge table of per edge speeds, penalties and bans they want
+  EdgeTable::set_dir(pt.get<std::string>("edge_table_dir", ""));
+
+  // Share the tiles this process loads with the other processes on the host
+  const auto shared_cache = pt.get<std::string>("shared_mem_cache", "");
+  if (!shared_cache.empty()) {
+    shared_tiles_ = SharedTileStore::get(shared_cache, pt.get<size_t>("shared_mem_cache_size",
+                                                                      DEFAULT_MAX_CACHE_SIZE));
+  }
+
+  // Let tiles keep the shapes they decoded for the requests that follow
+  if (pt.get<uint32_t>("shape_cache_size", 0) > 0) {
+    ShapeCache::set_size(pt.get<uint32_t>("shape_cache_size"));
+  }
+
+  // Let tiles keep the costs of their edges for costings with default options
+  if (pt.get<bool>("default_edge_costs", false)) {
+    DefaultEdgeCosts::set_enabled(true);
+  }
+
+  // Let tiles keep the turn classes of their edges for the transition costs
+  if (pt.get<bool>("turn_classes", false)) {
+    TurnClasses::set_enabled(true);
+  }
+
+  // Let tiles keep a dense copy of the directed edge fields path expansion reads
+  if (pt.get<bool>("directededge_hot_fields", false)) {
+    GraphTile::set_hot_fields_enabled(true);
+  }
+
+  // Let tiles keep a uint8_t speed snapshot of the 15 minute windows of the week we expect most
+  // departures in
+  if (auto windows = pt.get_child_optional("predicted_speed_snapshots")) {
+    std::vector<uint32_t> snapshot_windows;
+    for (const auto& window : *windows) {
+      snapshot_windows.push_back(window.second.get_value<uint32_t>());
+    }
+    PredictedSpeeds::set_snapshot_windows(snapshot_windows);
+  }
+
+  // Copy the tiles of these levels out of the extract, with the reader's thread pinned to a NUMA
+  // node the copies are local to it while the mapped pages sit wherever they were first read
+  if (auto levels = pt.get_child_optional("tile_extract_replicate_levels")) {
+    for (const auto& level : *levels) {
+      replicate_levels_ |= 1u << level.second.get_value<uint32_t>();
+    }
+  }
+
   // Fill shortcut recovery cache if requested or by default in memmap mode
   if (pt.get<bool>("shortcut_caching", false)) {
     shortcut_recovery_t::get_instance(this);
   }
+
+  // Count how often tiles are asked for so the next process can warm up with the popular ones
+  const auto access_log = pt.get<std::string>("tile_access_log", "");
+  if (!access_log.empty()) {
+    const auto interval = std::chrono::seconds(pt.get<uint32_t>("tile_access_log_interval", 300));
+    access_log_ = TileAccessLog::get(access_log, interval);
+  }
+
+  // Load the tiles the processes before us used most, we only answer requests once we have
+  const size_t warmup_size = std::min(pt.get<size_t>("tile_warmup_size", 0),
+                                      pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE));
+  if (warmup_size > 0 && !access_log.empty()) {
+    std::vector<GraphId> tiles;
+    for (const auto& tile : TileAccessLog::Read(access_log)) {
+      tiles.emplace_back(tile.tile_id);
+    }
+    const size_t threads =
+        pt.get<size_t>("tile_warmup_threads", std::thread::hardware_concurrency());
+    warmup_stats_ = Warmup(tiles, warmup_size, threads);
+    LOG_INFO("Warmed up the tile cache with " + std::to_string(warmup_stats_.tiles) + " tiles (" +
+             std::to_string(warmup_stats_.bytes) + " bytes) in " +
+             std::to_string(warmup_stats_.millis) + " ms");
+  }
+
+  // Switch to the extract whenever it is replaced, the readers pick it up in between requests
+  const auto reload_interval = pt.get<uint32_t>("tile_extract_reload_interval", 0);
+  if (reload_interval > 0 && !tile_extract_->tiles.empty()) {
+    tile_set_watcher_t::start(pt, std::chrono::seconds(reload_interval));
+  }
+}
+
+uint64_t GraphReader::PublishTileSet(const boost::property_tree::ptree& pt) {
+  const auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<tile_extract_t> tile_set = std::make_shared<tile_extract_t>(pt);
+  if (tile_set->tiles.empty()) {
+    LOG_WARN("Staying on the current tile set, the new tile extract has no usable tiles");
+    return 0;
+  }
+  if (pt.get<bool>("shortcut_caching", false)) {
+    LOG_WARN("The shortcut cache is not rebuilt for the new tile set");
+  }
+
+  // ask the kernel for the pages of the tiles that were used most so the first requests on the
+  // new tile set don't all wait on the disk
+  const auto access_log = pt.get<std::string>("tile_access_log", "");
+  size_t warmup_size = pt.get<size_t>("tile_warmup_size", 0);
+  size_t warmed = 0;
+  if (warmup_size > 0 && !access_log.empty()) {
+    const auto interval = std::chrono::seconds(pt.get<uint32_t>("tile_access_log_interval", 300));
+    for (const auto& tile : TileAccessLog::get(access_log, interval)->Counts()) {
+      auto t = tile_set->tiles.find(tile.tile_id);
+      if (t == tile_set->tiles.cend()) {
+        continue;
+      }
+      if (t->second.second > warmup_size) {
+        break;
+      }
+      tile_set->archive->mm.advise(t->second.first - tile_set->archive->mm.get(), t->second.second,
+                                   POSIX_MADV_WILLNEED);
+      warmup_size -= t->second.second;
+      ++warmed;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(published_tile_set_mutex_);
+  published_tile_set_ = std::move(tile_set);
+  const auto epoch = published_tile_set_epoch_.load() + 1;
+  published_tile_set_epoch_.store(epoch, std::memory_order_release);
+  const auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  LOG_INFO("Published tile set " + std::to_string(epoch) + " with " +
+           std::to_string(published_tile_set_->tiles.size()) + " tiles, " +
+           std::to_string(warmed) + " of them warmed, in " + std::to_string(millis) + " ms");
+  return epoch;
+}
+
+bool GraphReader::SwitchTileSet() {
+  if (tile_set_epoch_ == published_tile_set_epoch_.load(std::memory_order_acquire) ||
+      tile_extract_->traffic_writable) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(published_tile_set_mutex_);
+    tile_extract_ = published_tile_set_;
+    tile_set_epoch_ = published_tile_set_epoch_.load();
+  }
+
+  // nothing of the old tile set may be used anymore, a cache shared with other readers is cleared
+  // by each of them as they switch which costs a few misses but never mixes the two sets
+  tile_dictionary_ = LoadTileDictionary();
+  cache_->Clear();
+  {
+    std::lock_guard<std::mutex> lock(_404s_lock);
+    _404s.clear();
+  }
+  if (shared_tiles_) {
+    LOG_WARN("No longer sharing tiles with other processes, the store holds the old tile set");
+    shared_tiles_.reset();
+  }
+  return true;
+}
+
+GraphReader::~GraphReader() {
+  if (access_log_ && !access_counts_.empty()) {
+    access_log_->Add(access_counts_, access_misses_);
+  }
+}
+
+GraphReader::WarmupStats
+GraphReader::Warmup(const std::vector<GraphId>& tiles, size_t max_bytes, size_t threads) {
+  const auto start = std::chrono::steady_clock::now();
+
+  // the tiles are loaded in parallel but only this thread touches the cache
+  std::vector<GraphId> wanted;
+  for (const auto& tile_id : tiles) {
+    if (tile_id.Is_Valid() && !cache_->Contains(tile_id.Tile_Base())) {
+      wanted.push_back(tile_id.Tile_Base());
+    }
+  }
+  // tiles used straight from an uncompressed extract only take up what they decoded
+  auto cache_size = [this](const GraphId& base, const GraphTile& tile) {
+    auto t = tile_extract_->tiles.find(base);
+    const bool mapped = t != tile_extract_->tiles.cend() && tile_extract_->fd == -1 &&
+                        detect_compression(t->second.first, t->second.second) ==
+                            tile_compression_t::none;
+    return (mapped ? AVERAGE_MM_TILE_SIZE : tile.header()->end_offset()) + tile.decoded_size();
+  };
+  std::vector<graph_tile_ptr> loaded(wanted.size());
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> bytes(0);
+  auto load = [&]() {
+    for (size_t i = next++; i < wanted.size() && bytes.load() < max_bytes; i = next++) {
+      auto tile = LoadTile(wanted[i]);
+      if (tile) {
+        bytes += cache_size(wanted[i], *tile);
+        loaded[i] = std::move(tile);
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < std::max<size_t>(threads, 1); ++i) {
+    workers.emplace_back(load);
+  }
+  load();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // the most important tiles go in first, the last ones may not fit anymore
+  WarmupStats stats;
+  for (size_t i = 0; i < loaded.size(); ++i) {
+    if (!loaded[i]) {
+      continue;
+    }
+    const size_t size = cache_size(wanted[i], *loaded[i]);
+    if (stats.bytes + size > max_bytes) {
+      break;
+    }
+    cache_->Put(wanted[i], std::move(loaded[i]), size);
+    ++stats.tiles;
+    stats.bytes += size;
+  }
+  stats.millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  return stats;
+}
+
+// Most recent update of the live traffic
+uint64_t GraphReader::GetTrafficLastUpdate() const {
+  uint64_t last_update = 0;
+  for (const auto& tile : tile_extract_->traffic_tiles) {
+    // the traffic is updated in place by other processes
+    const auto* header = reinterpret_cast<const volatile TrafficTileHeader*>(tile.second.first);
+    if (tile.second.second >= sizeof(TrafficTileHeader)) {
+      const uint64_t updated = header->last_update;
+      last_update = std::max(last_update, updated);
+    }
+  }
+  return last_update;
 }
 
 // Method to test if tile exists
@@ -528,11 +1273,8 @@ bool GraphReader::DoesTileExist(const GraphId& graphid) const {
   }
   if (tile_dir_.empty())
     return false;
-  std::string file_location =
-      tile_dir_ + filesystem::path::preferred_separator + GraphTile::FileSuffix(graphid.Tile_Base());
-  struct stat buffer;
-  return stat(file_location.c_str(), &buffer) == 0 ||
-         stat((file_location + ".gz").c_str(), &buffer) == 0;
+  return tile_file_exists(tile_dir_ + filesystem::path::preferred_separator +
+                          GraphTile::FileSuffix(graphid.Tile_Base()));
 }
 
 class TarballGraphMemory final : public GraphMemory {
@@ -547,8 +1289,228 @@ private:
   const std::shared_ptr<midgard::tar> archive_;
 };
 
+// A copy of a tile of the extract in the memory of the reader, see tile_extract_replicate_levels
+class CopiedGraphMemory final : public GraphMemory {
+public:
+  CopiedGraphMemory(const std::pair<char*, size_t>& position)
+      : memory_(position.first, position.first + position.second) {
+    data = memory_.data();
+    size = memory_.size();
+  }
+
+private:
+  std::vector<char> memory_;
+};
+
+// A tile of the extract read with pread, see tile_extract_pread
+class ReadGraphMemory final : public GraphMemory {
+public:
+  ReadGraphMemory(int fd, size_t offset, size_t length) : memory_(length) {
+#ifndef _WIN32
+    size_t read = 0;
+    while (read < length) {
+      const auto bytes = pread(fd, memory_.data() + read, length - read, offset + read);
+      if (bytes <= 0) {
+        if (bytes == -1 && errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      read += bytes;
+    }
+    memory_.resize(read < length ? 0 : length);
+#else
+    memory_.clear();
+#endif
+    data = memory_.data();
+    size = memory_.size();
+  }
+
+private:
+  std::vector<char> memory_;
+};
+
+graph_tile_ptr GraphReader::ReadTile(const GraphId& base,
+                                     const std::pair<char*, size_t>& position) const {
+  auto memory = std::make_unique<ReadGraphMemory>(tile_extract_->fd,
+                                                  position.first - tile_extract_->archive->mm.get(),
+                                                  position.second);
+  if (memory->size == 0) {
+    LOG_ERROR("Could not read tile " + std::to_string(base.value) + " out of the extract");
+    return nullptr;
+  }
+  // a compressed tile only needs its bytes for as long as it takes to decompress them
+  if (detect_compression(memory->data, memory->size) != tile_compression_t::none) {
+    return GraphTile::DecompressTile(base, memory->data, memory->size,
+                                     tile_extract_->dictionary.get(), GetTrafficMemory(base));
+  }
+  return GraphTile::Create(base, std::move(memory), GetTrafficMemory(base));
+}
+
+std::unique_ptr<const GraphMemory> GraphReader::GetTrafficMemory(const GraphId& base) const {
+  auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
+  if (traffic_ptr == tile_extract_->traffic_tiles.end()) {
+    return nullptr;
+  }
+  return std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive, traffic_ptr->second);
+}
+
+graph_tile_ptr GraphReader::GetSharedTile(const GraphId& base) {
+  if (!shared_tiles_) {
+    return nullptr;
+  }
+  auto memory = shared_tiles_->Get(base);
+  if (!memory) {
+    return nullptr;
+  }
+  auto tile = GraphTile::Create(base, std::move(memory), GetTrafficMemory(base));
+  if (!tile) {
+    return nullptr;
+  }
+  if (!UseCache()) {
+    return tile;
+  }
+  const size_t size = tile->header()->end_offset() + tile->decoded_size();
+  return cache_->Put(base, std::move(tile), size);
+}
+
+graph_tile_ptr GraphReader::ShareTile(const GraphId& base, graph_tile_ptr tile) const {
+  // Hand the data to the other processes and use the shared copy so it is in memory only once
+  if (shared_tiles_) {
+    if (auto memory = shared_tiles_->Put(base, reinterpret_cast<const char*>(tile->header()),
+                                         tile->header()->end_offset())) {
+      if (auto shared = GraphTile::Create(base, std::move(memory), GetTrafficMemory(base))) {
+        return shared;
+      }
+    }
+  }
+  return tile;
+}
+
+graph_tile_ptr GraphReader::PutTile(const GraphId& base, graph_tile_ptr tile) {
+  tile = ShareTile(base, std::move(tile));
+  if (!UseCache()) {
+    return tile;
+  }
+  const size_t size = tile->header()->end_offset() + tile->decoded_size();
+  return cache_->Put(base, std::move(tile), size);
+}
+
+graph_tile_ptr GraphReader::LoadTile(const GraphId& base) const {
+  // Tiles in an uncompressed extract are used straight from the mmap
+  if (!tile_extract_->tiles.empty()) {
+    auto t = tile_extract_->tiles.find(base);
+    if (t == tile_extract_->tiles.cend()) {
+      return nullptr;
+    }
+    if (tile_extract_->fd == -1 &&
+        detect_compression(t->second.first, t->second.second) == tile_compression_t::none) {
+      auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
+      return GraphTile::Create(base, std::move(memory), GetTrafficMemory(base));
+    }
+  }
+
+  // Another process may have loaded it already
+  if (shared_tiles_) {
+    if (auto memory = shared_tiles_->Get(base)) {
+      if (auto tile = GraphTile::Create(base, std::move(memory), GetTrafficMemory(base))) {
+        return tile;
+      }
+    }
+  }
+
+  graph_tile_ptr tile;
+  if (!tile_extract_->tiles.empty() && tile_extract_->fd != -1) {
+    tile = ReadTile(base, tile_extract_->tiles.find(base)->second);
+  } else if (!tile_extract_->tiles.empty()) {
+    const auto& t = tile_extract_->tiles.find(base)->second;
+    tile = GraphTile::DecompressTile(base, t.first, t.second, tile_extract_->dictionary.get(),
+                                     GetTrafficMemory(base));
+  } else if (!tile_dir_.empty()) {
+    tile = GraphTile::Create(tile_dir_, base, GetTrafficMemory(base), tile_dictionary_.get());
+  }
+  if (!tile || !tile->header()) {
+    return nullptr;
+  }
+  return ShareTile(base, std::move(tile));
+}
+
+bool GraphReader::UpdateLiveTraffic(const GraphId& tile_id,
+                                    const std::vector<TrafficSpeedUpdate>& updates,
+                                    uint64_t last_update) {
+  if (!tile_extract_->traffic_writable) {
+    throw std::runtime_error("Live traffic can only be updated with a writable traffic extract");
+  }
+  auto traffic = tile_extract_->traffic_tiles.find(tile_id.Tile_Base());
+  if (traffic == tile_extract_->traffic_tiles.cend()) {
+    return false;
+  }
+  TrafficTile(std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive, traffic->second))
+      .update(updates, last_update);
+  return true;
+}
+
 // Get a pointer to a graph tile object given a GraphId. Return nullptr
 // if the tile is not found/empty
+// Warm the tiles between two points in the background
+void GraphReader::PrefetchCorridor(const PointLL& origin, const PointLL& destination) {
+  if (!prefetcher_) {
+    return;
+  }
+
+  for (const auto& tile_id : TilePrefetcher::Corridor(origin, destination, prefetch_width_)) {
+    if (cache_->Contains(tile_id)) {
+      continue;
+    }
+
+    // page in the bytes of the tile from the memmapped tar extract
+    if (!tile_extract_->tiles.empty()) {
+      auto t = tile_extract_->tiles.find(tile_id);
+      if (t == tile_extract_->tiles.cend()) {
+        continue;
+      }
+      prefetcher_->Enqueue(tile_id, [extract = tile_extract_, tile = t->second]() {
+#ifndef _WIN32
+        // tiles read with pread only need to be in the page cache, not in our memory
+        if (extract->fd != -1) {
+          posix_fadvise(extract->fd, tile.first - extract->archive->mm.get(), tile.second,
+                        POSIX_FADV_WILLNEED);
+          return true;
+        }
+#endif
+        // reading a byte of each page is enough to fault all of them in
+        constexpr size_t kPageSize = 4096;
+        volatile char sink = 0;
+        for (size_t offset = 0; offset < tile.second; offset += kPageSize) {
+          sink = sink + tile.first[offset];
+        }
+        return true;
+      });
+    } // read the tile file or download it into the tile_dir where GetGraphTile will find it
+    else if (!tile_dir_.empty()) {
+      prefetcher_->Enqueue(tile_id, [tile_dir = tile_dir_, tile_url = tile_url_, tile_id,
+                                     tile_getter = prefetcher_->tile_getter(),
+                                     dictionary = tile_dictionary_]() {
+        const auto file_location =
+            tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(tile_id);
+        for (const auto& location : {file_location, file_location + ".gz", file_location + ".zst",
+                                     file_location + ".lz4"}) {
+          std::ifstream file(location, std::ios::in | std::ios::binary);
+          if (file.is_open()) {
+            std::vector<char> buffer(64 * 1024);
+            while (file.read(buffer.data(), buffer.size())) {
+            }
+            return true;
+          }
+        }
+        return tile_getter && !tile_url.empty() &&
+               GraphTile::CacheTileURL(tile_url, tile_id, tile_getter, tile_dir, dictionary.get()) !=
+                   nullptr;
+      });
+    }
+  }
+}
+
 graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
   // Return nullptr if not a valid tile
   if (!graphid.Is_Valid()) {
@@ -556,10 +1518,28 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
   }
 
   // Check if the level/tileid combination is in the cache
+  ++tile_counts_.fetched;
   auto base = graphid.Tile_Base();
-  if (const auto& cached = cache_->Get(base)) {
-    // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
-    return cached;
+  const bool sampled = access_log_ && tile_counts_.fetched % kAccessSampleRate == 0;
+  if (sampled) {
+    ++access_counts_[base];
+    if (++access_samples_ == kAccessFlushSamples) {
+      access_log_->Add(access_counts_, access_misses_);
+      access_counts_.clear();
+      access_misses_.clear();
+      access_samples_ = 0;
+    }
+  }
+  const bool use_cache = UseCache();
+  if (use_cache) {
+    if (const auto& cached = cache_->Get(base)) {
+      // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
+      return cached;
+    }
+  }
+  ++tile_counts_.cache_misses;
+  if (sampled) {
+    ++access_misses_[base];
   }
 
   // Try getting it from the memmapped tar extract
@@ -570,16 +1550,42 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
-    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
-
-    auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
+    // A tile read with pread is the reader's own, like a tile file
+    if (tile_extract_->fd != -1) {
+      if (auto shared = GetSharedTile(base)) {
+        return shared;
+      }
+      auto tile = ReadTile(base, t->second);
+      if (!tile) {
+        return nullptr;
+      }
+      return PutTile(base, std::move(tile));
+    }
+    // A compressed tile is decompressed out of the mmap and takes as much memory as a tile file,
+    // unless another process decompressed it into the shared store already
+    if (detect_compression(t->second.first, t->second.second) != tile_compression_t::none) {
+      if (auto shared = GetSharedTile(base)) {
+        return shared;
+      }
+      auto tile = GraphTile::DecompressTile(base, t->second.first, t->second.second,
+                                            tile_extract_->dictionary.get(),
+                                            GetTrafficMemory(base));
+      if (!tile) {
+        return nullptr;
+      }
+      return PutTile(base, std::move(tile));
+    }
 
-    // This initializes the tile from mmap
-    auto tile = GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
+    // This initializes the tile from mmap, or from a copy of it on the levels that are replicated
+    const bool replicate = replicate_levels_ & (1u << base.level());
+    std::unique_ptr<const GraphMemory> memory;
+    if (replicate) {
+      memory = std::make_unique<CopiedGraphMemory>(t->second);
+      ++tile_counts_.replicated;
+    } else {
+      memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
+    }
+    auto tile = GraphTile::Create(base, std::move(memory), GetTrafficMemory(base));
     if (!tile) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
@@ -587,18 +1593,23 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     // LOG_DEBUG("Memory map cache hit " + GraphTile::FileSuffix(base));
 
     // Keep a copy in the cache and return it
-    const size_t size = AVERAGE_MM_TILE_SIZE; // tile.end_offset();  // TODO what size??
+    // The data stays in the mmap, only what the tile decoded next to it is its own
+    if (!use_cache) {
+      return tile;
+    }
+    const size_t size =
+        (replicate ? t->second.second : AVERAGE_MM_TILE_SIZE) + tile->decoded_size();
     return cache_->Put(base, std::move(tile), size);
   } // Try getting it from flat file
   else {
-    auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
+    // Another process may have loaded it already
+    if (auto shared = GetSharedTile(base)) {
+      return shared;
+    }
 
     // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+    graph_tile_ptr tile =
+        GraphTile::Create(tile_dir_, base, GetTrafficMemory(base), tile_dictionary_.get());
     if (!tile || !tile->header()) {
       if (!tile_getter_) {
         return nullptr;
@@ -612,8 +1623,15 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
         }
       }
 
-      // Get it from the url and cache it to disk if you can
-      tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
+      // Get it from the url and cache it to disk if you can, a tile the batch did not get is asked
+      // for again on its own which throws on network errors and tells us when it doesnt exist
+      if (tile_url_neighbors_) {
+        tile = FetchTileAndNeighbors(base);
+      }
+      if (!tile) {
+        tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_,
+                                       tile_dictionary_.get());
+      }
       if (!tile) {
         std::lock_guard<std::mutex> lock(_404s_lock);
         _404s.insert(base);
@@ -626,9 +1644,78 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     }
 
     // Keep a copy in the cache and return it
-    const size_t size = tile->header()->end_offset();
-    return cache_->Put(base, std::move(tile), size);
+    return PutTile(base, std::move(tile));
+  }
+}
+
+std::shared_ptr<const zstd_dictionary_t> GraphReader::LoadTileDictionary() const {
+  if (!tile_extract_->tiles.empty()) {
+    return tile_extract_->dictionary;
+  }
+
+  // a dictionary in the tile_dir, either shipped with the tiles or cached from the tile_url
+  const auto location = tile_dir_ + filesystem::path::preferred_separator + TILE_DICTIONARY;
+  if (!tile_dir_.empty()) {
+    std::ifstream file(location, std::ios::in | std::ios::binary | std::ios::ate);
+    if (file.is_open()) {
+      std::vector<char> data(file.tellg());
+      file.seekg(0, std::ios::beg);
+      file.read(data.data(), data.size());
+      return std::make_shared<const zstd_dictionary_t>(data.data(), data.size());
+    }
+  }
+
+  // the tile_url serves it next to the tiles
+  if (tile_getter_ && !tile_url_.empty() && tile_getter_->tile_suffix() == SUFFIX_ZSTD) {
+    auto result = tile_getter_->get(make_single_point_url(tile_url_, TILE_DICTIONARY));
+    if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
+      LOG_WARN("Could not fetch the tile dictionary from " + tile_url_);
+      return nullptr;
+    }
+    if (!tile_dir_.empty()) {
+      filesystem::save(location, result.bytes_);
+    }
+    return std::make_shared<const zstd_dictionary_t>(result.bytes_.data(), result.bytes_.size());
   }
+  return nullptr;
+}
+
+// Fetch a tile and its missing neighbours from the tile_url at once
+graph_tile_ptr GraphReader::FetchTileAndNeighbors(const GraphId& base) {
+  const auto& tiling = TileHierarchy::get_tiling(base.level());
+  const int32_t tile_id = base.tileid();
+  std::unordered_set<int32_t> around;
+  for (auto row : {tiling.BottomNeighbor(tile_id), tile_id, tiling.TopNeighbor(tile_id)}) {
+    around.insert({tiling.LeftNeighbor(row), row, tiling.RightNeighbor(row)});
+  }
+
+  std::vector<GraphId> tile_ids{base};
+  for (auto id : around) {
+    GraphId neighbor(id, base.level(), 0);
+    if (neighbor == base || cache_->Contains(neighbor)) {
+      continue;
+    }
+    if (!tile_dir_.empty()) {
+      const auto file_location =
+          tile_dir_ + filesystem::path::preferred_separator + GraphTile::FileSuffix(neighbor);
+      if (tile_file_exists(file_location)) {
+        continue;
+      }
+    }
+    std::lock_guard<std::mutex> lock(_404s_lock);
+    if (_404s.find(neighbor) == _404s.end()) {
+      tile_ids.push_back(neighbor);
+    }
+  }
+
+  auto tiles = GraphTile::CacheTileURLs(tile_url_, tile_ids, tile_getter_.get(), tile_dir_,
+                                        tile_dictionary_.get());
+  for (size_t i = 1; i < tiles.size(); ++i) {
+    if (tiles[i] && tiles[i]->header()) {
+      PutTile(tile_ids[i], std::move(tiles[i]));
+    }
+  }
+  return tiles.front();
 }
 
 // Convenience method to get an opposing directed edge graph Id.
@@ -639,6 +1726,15 @@ GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, graph_tile_ptr& op
     return {};
   };
 
+  // The tile knows the opposing edge, transit edges have an invalid one
+  if (tile->has_opposing_edge_ids()) {
+    GraphId id = tile->opposing_edge_id(edgeid.id());
+    if (!id.Is_Valid() || !GetGraphTile(id, opp_tile)) {
+      return {};
+    }
+    return id;
+  }
+
   // For now return an invalid Id if this is a transit edge
   const auto* directededge = tile->directededge(edgeid);
   if (directededge->IsTransitLine()) {
@@ -975,52 +2071,29 @@ int GraphReader::GetTimezone(const baldr::GraphId& node, graph_tile_ptr& tile) {
   return (tile == nullptr) ? 0 : tile->node(node)->timezone();
 }
 
-std::shared_ptr<const valhalla::IncidentsTile>
-GraphReader::GetIncidentTile(const GraphId& tile_id) const {
+std::shared_ptr<const IncidentTile> GraphReader::GetIncidentTile(const GraphId& tile_id) const {
   return enable_incidents_ ? incident_singleton_t::get(tile_id.Tile_Base())
-                           : std::shared_ptr<valhalla::IncidentsTile>{};
+                           : std::shared_ptr<const IncidentTile>{};
 }
 
 IncidentResult GraphReader::GetIncidents(const GraphId& edge_id, graph_tile_ptr& tile) {
   // if we are not doing this for any reason then bail
-  std::shared_ptr<const valhalla::IncidentsTile> itile;
+  std::shared_ptr<const IncidentTile> itile;
   if (!enable_incidents_ || !GetGraphTile(edge_id, tile) ||
       !tile->trafficspeed(tile->directededge(edge_id)).has_incidents ||
       !(itile = GetIncidentTile(edge_id))) {
     return {};
   }
 
-  // get the range of incidents we care about and hand it back, equal_range has no lambda option
-  auto begin = std::partition_point(itile->locations().begin(), itile->locations().end(),
-                                    [&edge_id](const valhalla::IncidentsTile::Location& candidate) {
-                                      // first one that is >= the id we want
-                                      bool is_found = candidate.edge_index() < edge_id.id();
-                                      return is_found;
-                                    });
-  auto end = std::partition_point(begin, itile->locations().end(),
-                                  [&edge_id](const valhalla::IncidentsTile::Location& candidate) {
-                                    // first one that is > the id we want
-                                    bool is_found = candidate.edge_index() <= edge_id.id();
-                                    return is_found;
-                                  });
-
-  int begin_index = begin - itile->locations().begin();
-  int end_index = end - itile->locations().begin();
+  // get the range of incidents we care about and hand it back
+  const auto locations = itile->locations();
+  auto range =
+      std::equal_range(locations.begin(), locations.end(), edge_id.id(), edge_index_less{});
+  int begin_index = range.first - locations.begin();
+  int end_index = range.second - locations.begin();
 
   return {itile, begin_index, end_index};
 }
 
-const valhalla::IncidentsTile::Metadata&
-getIncidentMetadata(const std::shared_ptr<const valhalla::IncidentsTile>& tile,
-                    const valhalla::IncidentsTile::Location& incident_location) {
-  const int64_t metadata_index = incident_location.metadata_index();
-  if (metadata_index >= tile->metadata_size()) {
-    throw std::runtime_error(std::string("Invalid incident tile with an incident_index of ") +
-                             std::to_string(metadata_index) + " but total incident metadata of " +
-                             std::to_string(tile->metadata_size()));
-  }
-  return tile->metadata(metadata_index);
-}
-
 } // namespace baldr
 } // namespace valhalla
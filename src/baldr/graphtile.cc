@@ -10,6 +10,8 @@
 #include "midgard/pointll.h"
 #include "midgard/tiles.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <chrono>
 #include <cmath>
@@ -22,6 +24,7 @@
 #include <locale>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,6 +34,24 @@ namespace {
 const AABB2<PointLL> world_box(PointLL(-180, -90), PointLL(180, 90));
 constexpr float COMPRESSION_HINT = 3.5f;
 
+// the offsets of the complex restrictions sorted by the edge they are looked up by, the ones of
+// an edge stay in the order they are in the tile
+std::vector<std::pair<uint64_t, uint32_t>>
+index_restrictions(const char* restrictions, const size_t size, const bool forward) {
+  std::vector<std::pair<uint64_t, uint32_t>> index;
+  for (size_t offset = 0; offset < size;) {
+    const auto* cr =
+        reinterpret_cast<const valhalla::baldr::ComplexRestriction*>(restrictions + offset);
+    index.emplace_back(forward ? cr->to_graphid().value : cr->from_graphid().value, offset);
+    offset += cr->SizeOf();
+  }
+  std::sort(index.begin(), index.end());
+  return index;
+}
+
+// Whether tiles copy out the hot fields of their edges, see GraphTile::set_hot_fields_enabled
+std::atomic<bool> hot_fields_enabled{false};
+
 // the point of this function is to avoid race conditions for writing a tile between threads
 // so the easiest thing to do is just use the thread id to differentiate
 std::string GenerateTmpSuffix() {
@@ -57,46 +78,79 @@ private:
 };
 
 graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
-                                         const std::vector<char>& compressed) {
-  // for setting where to read compressed data from
-  auto src_func = [&compressed](z_stream& s) -> void {
-    s.next_in =
-        const_cast<Byte*>(static_cast<const Byte*>(static_cast<const void*>(compressed.data())));
-    s.avail_in = static_cast<unsigned int>(compressed.size());
-  };
-
-  // for setting where to write the uncompressed data to
+                                         const char* compressed,
+                                         size_t size,
+                                         const zstd_dictionary_t* dictionary,
+                                         std::unique_ptr<const GraphMemory>&& traffic_memory) {
   std::vector<char> data;
-  auto dst_func = [&data, &compressed](z_stream& s) -> int {
-    // if the whole buffer wasn't used we are done
-    auto size = data.size();
-    if (s.total_out < size)
-      data.resize(s.total_out);
-    // we need more space
-    else {
-      // assume we need 3.5x the space
-      data.resize(size + (compressed.size() * COMPRESSION_HINT));
-      // set the pointer to the next spot
-      s.next_out = static_cast<Byte*>(static_cast<void*>(data.data() + size));
-      s.avail_out = compressed.size() * COMPRESSION_HINT;
-    }
-    return Z_NO_FLUSH;
-  };
+  switch (detect_compression(compressed, size)) {
+    // zstd and lz4 frames know how large the tile is so they decompress in one go
+    case tile_compression_t::zstd:
+      if (!zstd_decompress(compressed, size, data, dictionary)) {
+        LOG_ERROR("Failed to decompress " + GraphTile::FileSuffix(graphid, SUFFIX_ZSTD));
+        return nullptr;
+      }
+      break;
+    case tile_compression_t::lz4:
+      if (!lz4_decompress(compressed, size, data)) {
+        LOG_ERROR("Failed to decompress " + GraphTile::FileSuffix(graphid, SUFFIX_LZ4));
+        return nullptr;
+      }
+      break;
+    default: {
+      // for setting where to read compressed data from
+      auto src_func = [compressed, size](z_stream& s) -> void {
+        s.next_in = const_cast<Byte*>(static_cast<const Byte*>(static_cast<const void*>(compressed)));
+        s.avail_in = static_cast<unsigned int>(size);
+      };
+
+      // for setting where to write the uncompressed data to
+      auto dst_func = [&data, size](z_stream& s) -> int {
+        // if the whole buffer wasn't used we are done
+        auto data_size = data.size();
+        if (s.total_out < data_size)
+          data.resize(s.total_out);
+        // we need more space
+        else {
+          // assume we need 3.5x the space
+          data.resize(data_size + (size * COMPRESSION_HINT));
+          // set the pointer to the next spot
+          s.next_out = static_cast<Byte*>(static_cast<void*>(data.data() + data_size));
+          s.avail_out = size * COMPRESSION_HINT;
+        }
+        return Z_NO_FLUSH;
+      };
 
-  // Decompress tile into memory
-  if (!baldr::inflate(src_func, dst_func)) {
-    LOG_ERROR("Failed to gunzip " + GraphTile::FileSuffix(graphid, SUFFIX_COMPRESSED));
-    return nullptr;
+      // Decompress tile into memory
+      if (!baldr::inflate(src_func, dst_func)) {
+        LOG_ERROR("Failed to gunzip " + GraphTile::FileSuffix(graphid, SUFFIX_COMPRESSED));
+        return nullptr;
+      }
+    }
   }
 
-  return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(data)))};
+  return graph_tile_ptr{new GraphTile(graphid,
+                                      std::make_unique<const VectorGraphMemory>(std::move(data)),
+                                      std::move(traffic_memory))};
+}
+
+const std::string& GraphTile::CompressionSuffix(const std::string& compression) {
+  if (compression.empty() || compression == "none")
+    return SUFFIX_NON_COMPRESSED;
+  if (compression == "gzip")
+    return SUFFIX_COMPRESSED;
+  if (compression == "zstd")
+    return SUFFIX_ZSTD;
+  if (compression == "lz4")
+    return SUFFIX_LZ4;
+  throw std::runtime_error("Unknown tile compression: " + compression);
 }
 
 // Constructor given a filename. Reads the graph data into memory.
 graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
                                  const GraphId& graphid,
-                                 std::unique_ptr<const GraphMemory>&& traffic_memory) {
+                                 std::unique_ptr<const GraphMemory>&& traffic_memory,
+                                 const zstd_dictionary_t* dictionary) {
   if (!graphid.Is_Valid()) {
     LOG_ERROR("Failed to build GraphTile. Error: GraphId is invalid");
     return nullptr;
@@ -129,16 +183,21 @@ graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
                                         std::move(traffic_memory))};
   }
 
-  // Try to load a gzipped tile
-  std::ifstream gz_file(file_location + ".gz", std::ios::in | std::ios::binary | std::ios::ate);
-  if (gz_file.is_open()) {
-    // Read the compressed file into memory
-    size_t filesize = gz_file.tellg();
-    gz_file.seekg(0, std::ios::beg);
-    std::vector<char> compressed(filesize);
-    gz_file.read(&compressed[0], filesize);
-    gz_file.close();
-    return DecompressTile(graphid, std::move(compressed));
+  // Try to load a gzipped, zstd or lz4 compressed tile
+  for (const auto& suffix : {SUFFIX_COMPRESSED, SUFFIX_ZSTD, SUFFIX_LZ4}) {
+    std::ifstream compressed_file(tile_dir + filesystem::path::preferred_separator +
+                                      FileSuffix(graphid.Tile_Base(), suffix),
+                                  std::ios::in | std::ios::binary | std::ios::ate);
+    if (compressed_file.is_open()) {
+      // Read the compressed file into memory
+      size_t filesize = compressed_file.tellg();
+      compressed_file.seekg(0, std::ios::beg);
+      std::vector<char> compressed(filesize);
+      compressed_file.read(compressed.data(), filesize);
+      compressed_file.close();
+      return DecompressTile(graphid, compressed.data(), compressed.size(), dictionary,
+                            std::move(traffic_memory));
+    }
   }
 
   // Nothing to load anywhere
@@ -209,14 +268,17 @@ void GraphTile::SaveTileToFile(const std::vector<char>& tile_data, const std::st
 
 void store(const std::string& cache_location,
            const GraphId& graphid,
-           const tile_getter_t* tile_getter,
            const std::vector<char>& raw_data) {
   if (!cache_location.empty()) {
-    auto suffix =
-        valhalla::baldr::GraphTile::FileSuffix(graphid.Tile_Base(),
-                                               (tile_getter->gzipped()
-                                                    ? valhalla::baldr::SUFFIX_COMPRESSED
-                                                    : valhalla::baldr::SUFFIX_NON_COMPRESSED));
+    // keep the bytes the way they came so the tile_dir holds the same files the server does
+    static const std::unordered_map<tile_compression_t, std::string> suffixes{
+        {tile_compression_t::none, valhalla::baldr::SUFFIX_NON_COMPRESSED},
+        {tile_compression_t::gzip, valhalla::baldr::SUFFIX_COMPRESSED},
+        {tile_compression_t::zstd, valhalla::baldr::SUFFIX_ZSTD},
+        {tile_compression_t::lz4, valhalla::baldr::SUFFIX_LZ4},
+    };
+    auto suffix = valhalla::baldr::GraphTile::FileSuffix(
+        graphid.Tile_Base(), suffixes.at(detect_compression(raw_data.data(), raw_data.size())));
     auto disk_location = cache_location + filesystem::path::preferred_separator + suffix;
     filesystem::save(disk_location, raw_data);
   }
@@ -225,28 +287,68 @@ void store(const std::string& cache_location,
 graph_tile_ptr GraphTile::CacheTileURL(const std::string& tile_url,
                                        const GraphId& graphid,
                                        tile_getter_t* tile_getter,
-                                       const std::string& cache_location) {
+                                       const std::string& cache_location,
+                                       const zstd_dictionary_t* dictionary) {
   // Don't bother with invalid ids
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level() || !tile_getter) {
     return nullptr;
   }
 
-  auto fname = valhalla::baldr::GraphTile::FileSuffix(graphid.Tile_Base(),
-                                                      valhalla::baldr::SUFFIX_NON_COMPRESSED, false);
+  auto fname =
+      valhalla::baldr::GraphTile::FileSuffix(graphid.Tile_Base(), tile_getter->tile_suffix(), false);
   auto result = tile_getter->get(baldr::make_single_point_url(tile_url, fname));
   if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
     return nullptr;
   }
+  return CacheTileBytes(graphid, std::move(result.bytes_), cache_location, dictionary);
+}
+
+std::vector<graph_tile_ptr> GraphTile::CacheTileURLs(const std::string& tile_url,
+                                                     const std::vector<GraphId>& graphids,
+                                                     tile_getter_t* tile_getter,
+                                                     const std::string& cache_location,
+                                                     const zstd_dictionary_t* dictionary) {
+  std::vector<graph_tile_ptr> tiles(graphids.size());
+  if (!tile_getter) {
+    return tiles;
+  }
+
+  // Don't bother with invalid ids
+  std::vector<size_t> valid;
+  std::vector<std::string> urls;
+  for (size_t i = 0; i < graphids.size(); ++i) {
+    if (graphids[i].Is_Valid() && graphids[i].level() <= TileHierarchy::get_max_level()) {
+      auto fname = valhalla::baldr::GraphTile::FileSuffix(graphids[i].Tile_Base(),
+                                                          tile_getter->tile_suffix(), false);
+      valid.push_back(i);
+      urls.push_back(baldr::make_single_point_url(tile_url, fname));
+    }
+  }
+
+  auto results = tile_getter->get_batch(urls);
+  for (size_t i = 0; i < valid.size(); ++i) {
+    if (results[i].status_ == tile_getter_t::status_code_t::SUCCESS) {
+      tiles[valid[i]] = CacheTileBytes(graphids[valid[i]], std::move(results[i].bytes_),
+                                       cache_location, dictionary);
+    }
+  }
+  return tiles;
+}
+
+graph_tile_ptr GraphTile::CacheTileBytes(const GraphId& graphid,
+                                         std::vector<char>&& bytes,
+                                         const std::string& cache_location,
+                                         const zstd_dictionary_t* dictionary) {
   // try to cache it on disk so we dont have to keep fetching it from url
-  store(cache_location, graphid, tile_getter, result.bytes_);
+  store(cache_location, graphid, bytes);
 
   // turn the memory into a tile
-  if (tile_getter->gzipped()) {
-    return DecompressTile(graphid, result.bytes_);
+  if (detect_compression(bytes.data(), bytes.size()) != tile_compression_t::none) {
+    return DecompressTile(graphid, bytes.data(), bytes.size(), dictionary);
   }
 
   return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(result.bytes_)))};
+      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(bytes)))};
 }
 
 GraphTile::~GraphTile() = default;
@@ -342,10 +444,17 @@ void GraphTile::Initialize(const GraphId& graphid) {
   complex_restriction_reverse_ = tile_ptr + header_->complex_restriction_reverse_offset();
   complex_restriction_reverse_size_ =
       header_->edgeinfo_offset() - header_->complex_restriction_reverse_offset();
+  complex_restriction_forward_index_ =
+      index_restrictions(complex_restriction_forward_, complex_restriction_forward_size_, true);
+  complex_restriction_reverse_index_ =
+      index_restrictions(complex_restriction_reverse_, complex_restriction_reverse_size_, false);
 
   // Start of edge information and its size
   edgeinfo_ = tile_ptr + header_->edgeinfo_offset();
   edgeinfo_size_ = header_->textlist_offset() - header_->edgeinfo_offset();
+  if (ShapeCache::size() > 0) {
+    shape_cache_ = std::make_unique<ShapeCache>(ShapeCache::size());
+  }
 
   // Start of text list and its size
   textlist_ = tile_ptr + header_->textlist_offset();
@@ -362,24 +471,96 @@ void GraphTile::Initialize(const GraphId& graphid) {
     char* ptr2 = ptr1 + (header_->directededgecount() * sizeof(int32_t));
     predictedspeeds_.set_offset(reinterpret_cast<uint32_t*>(ptr1));
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
+    if (PredictedSpeeds::cache_enabled()) {
+      predictedspeeds_.enable_cache(header_->predictedspeeds_count());
+    }
+    if (PredictedSpeeds::snapshots_enabled()) {
+      predictedspeeds_.enable_snapshots(header_->predictedspeeds_count());
+    }
 
     lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
   } else {
     lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
   }
 
+  // Start of the precomputed reach, which valhalla_build_reach appends after whatever the tile
+  // already had so it may come before or after the predicted speeds
+  if (header_->reach_offset() > 0) {
+    reach_index_ = ReachIndex(tile_ptr + header_->reach_offset(), header_->directededgecount());
+    if (header_->reach_offset() > header_->lane_connectivity_offset()) {
+      lane_connectivity_size_ =
+          std::min<size_t>(lane_connectivity_size_,
+                           header_->reach_offset() - header_->lane_connectivity_offset());
+    }
+  }
+
+  // Start of the precomputed opposing edge ids, which valhalla_build_opposing appends the same way
+  if (header_->opposing_offset() > 0) {
+    opposing_edge_ids_ = reinterpret_cast<const GraphId*>(tile_ptr + header_->opposing_offset());
+    if (header_->opposing_offset() > header_->lane_connectivity_offset()) {
+      lane_connectivity_size_ =
+          std::min<size_t>(lane_connectivity_size_,
+                           header_->opposing_offset() - header_->lane_connectivity_offset());
+    }
+  }
+
+  // Start of the edge elevation summaries, which the ElevationBuilder appends the same way
+  if (header_->elevation_offset() > 0) {
+    edge_elevations_ =
+        reinterpret_cast<const EdgeElevation*>(tile_ptr + header_->elevation_offset());
+    if (header_->elevation_offset() > header_->lane_connectivity_offset()) {
+      lane_connectivity_size_ =
+          std::min<size_t>(lane_connectivity_size_,
+                           header_->elevation_offset() - header_->lane_connectivity_offset());
+    }
+  }
+
+  // Start of the departure index of the transit stops, which is written right after the lane
+  // connectivity of transit tiles
+  if (header_->stop_departure_offset() > 0) {
+    stop_departures_ = StopDepartureIndex(tile_ptr + header_->stop_departure_offset());
+    if (header_->stop_departure_offset() > header_->lane_connectivity_offset()) {
+      lane_connectivity_size_ =
+          std::min<size_t>(lane_connectivity_size_,
+                           header_->stop_departure_offset() - header_->lane_connectivity_offset());
+    }
+  }
+
   // For reference - how to use the end offset to set size of an object (that
   // is not fixed size and count).
   // example_size_ = header_->end_offset() - header_->example_offset();
 
   // ANY NEW EXPANSION DATA GOES HERE
 
+  // Copy the fields path expansion reads for every edge into dense arrays
+  if (::hot_fields_enabled.load(std::memory_order_relaxed)) {
+    directededge_hot_ = DirectedEdgeHot(directededges_, header_->directededgecount());
+  }
+
+  // Make room for the costs of the edges with default costing options, filled as they are used
+  if (DefaultEdgeCosts::enabled() && graphid.level() != 3) {
+    default_edge_costs_ = std::make_unique<DefaultEdgeCosts>(header_->directededgecount());
+  }
+
+  // Make room for the turn classes of the edges, filled when a costing first asks for them
+  if (TurnClasses::enabled() && graphid.level() != 3) {
+    turn_classes_ = std::make_unique<TurnClasses>(header_->directededgecount());
+  }
+
   // Associate one stop Ids for transit tiles
   if (graphid.level() == 3) {
     AssociateOneStopIds(graphid);
   }
 }
 
+bool GraphTile::hot_fields_enabled() {
+  return ::hot_fields_enabled.load(std::memory_order_relaxed);
+}
+
+void GraphTile::set_hot_fields_enabled(const bool enabled) {
+  ::hot_fields_enabled.store(enabled, std::memory_order_relaxed);
+}
+
 // For transit tiles we need to save off the pair<tileid,lineid> lookup via
 // onestop_ids.  This will be used for including or excluding transit lines
 // for transit routes.  We save 2 maps because operators contain all of their
@@ -667,32 +848,25 @@ iterable_t<const DirectedEdgeExt> GraphTile::GetDirectedEdgeExts(const size_t id
 }
 
 EdgeInfo GraphTile::edgeinfo(const DirectedEdge* edge) const {
-  return EdgeInfo(edgeinfo_ + edge->edgeinfo_offset(), textlist_, textlist_size_);
+  return EdgeInfo(edgeinfo_ + edge->edgeinfo_offset(), textlist_, textlist_size_,
+                  shape_cache_.get(), edge->edgeinfo_offset());
 }
 
 // Get the complex restrictions in the forward or reverse order based on
 // the id and modes.
 std::vector<ComplexRestriction*>
 GraphTile::GetRestrictions(const bool forward, const GraphId id, const uint64_t modes) const {
-  size_t offset = 0;
+  // the forward ones are looked up by the edge they end on and the reverse ones by the one they
+  // start on, the index has the ones of each edge next to each other
+  const auto& index =
+      forward ? complex_restriction_forward_index_ : complex_restriction_reverse_index_;
+  char* restrictions = forward ? complex_restriction_forward_ : complex_restriction_reverse_;
   std::vector<ComplexRestriction*> cr_vector;
-  if (forward) {
-    while (offset < complex_restriction_forward_size_) {
-      ComplexRestriction* cr =
-          reinterpret_cast<ComplexRestriction*>(complex_restriction_forward_ + offset);
-      if (cr->to_graphid() == id && (cr->modes() & modes)) {
-        cr_vector.push_back(cr);
-      }
-      offset += cr->SizeOf();
-    }
-  } else {
-    while (offset < complex_restriction_reverse_size_) {
-      ComplexRestriction* cr =
-          reinterpret_cast<ComplexRestriction*>(complex_restriction_reverse_ + offset);
-      if (cr->from_graphid() == id && (cr->modes() & modes)) {
-        cr_vector.push_back(cr);
-      }
-      offset += cr->SizeOf();
+  for (auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(id.value, 0u));
+       it != index.end() && it->first == id.value; ++it) {
+    ComplexRestriction* cr = reinterpret_cast<ComplexRestriction*>(restrictions + it->second);
+    if (cr->modes() & modes) {
+      cr_vector.push_back(cr);
     }
   }
   return cr_vector;
@@ -1016,6 +1190,62 @@ const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
   return nullptr;
 }
 
+// Get the next departure from a stop on any of its lines given the current time (seconds from
+// midnight).
+const TransitDeparture* GraphTile::GetNextStopDeparture(const uint32_t node_index,
+                                                        const uint32_t current_time,
+                                                        const uint32_t day,
+                                                        const uint32_t dow,
+                                                        bool date_before_tile,
+                                                        bool wheelchair,
+                                                        bool bicycle,
+                                                        uint32_t& departure_time) const {
+  auto usable = [&](const TransitDeparture& d) {
+    return (!wheelchair || d.wheelchair_accessible()) && (!bicycle || d.bicycle_accessible()) &&
+           GetTransitSchedule(d.schedule_index())->IsValid(day, dow, date_before_tile);
+  };
+
+  // The fixed schedule departures are sorted by time, the first usable one not before the
+  // current time is the next one among them
+  const TransitDeparture* next = nullptr;
+  const auto fixed = stop_departures_.fixed(node_index);
+  auto found = std::lower_bound(fixed.begin(), fixed.end(), current_time,
+                                [this](const uint32_t index, const uint32_t time) {
+                                  return departures_[index].departure_time() < time;
+                                });
+  for (; found != fixed.end(); ++found) {
+    if (usable(departures_[*found])) {
+      next = &departures_[*found];
+      departure_time = next->departure_time();
+      break;
+    }
+  }
+
+  // The frequency based departures are sorted by the end of their service, each one still running
+  // gets its next run the same way GetNextDeparture finds it
+  const auto frequency = stop_departures_.frequency(node_index);
+  found = std::lower_bound(frequency.begin(), frequency.end(), current_time,
+                           [this](const uint32_t index, const uint32_t time) {
+                             return departures_[index].end_time() < time;
+                           });
+  for (; found != frequency.end(); ++found) {
+    const auto& d = departures_[*found];
+    if (!usable(d)) {
+      continue;
+    }
+    uint32_t run = d.departure_time();
+    const uint32_t until = std::min(current_time, d.end_time());
+    if (run < until && d.frequency() > 0) {
+      run += (until - run + d.frequency() - 1) / d.frequency() * d.frequency();
+    }
+    if (next == nullptr || run < departure_time) {
+      next = &d;
+      departure_time = run;
+    }
+  }
+  return next;
+}
+
 // Get the departure given the line Id and tripid
 const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
                                                        const uint32_t tripid,
@@ -1094,6 +1324,53 @@ std::unordered_map<uint32_t, TransitDeparture*> GraphTile::GetTransitDepartures(
   return deps;
 }
 
+// Get the turn classes of a directed edge, filling those of the whole tile the first time
+const TurnClass* GraphTile::turn_classes(const DirectedEdge* edge) const {
+  const uint32_t edge_count = header_->directededgecount();
+  if (!turn_classes_ || edge < directededges_ || edge >= directededges_ + edge_count) {
+    return nullptr;
+  }
+  const auto* classes = turn_classes_->get([this](TurnClass* c) {
+    // every directed edge leaves one of the nodes of the tile
+    for (uint32_t n = 0; n < header_->nodecount(); ++n) {
+      const NodeInfo* node = &nodes_[n];
+      for (uint32_t i = 0; i < node->edge_count(); ++i) {
+        const uint32_t e = node->edge_index() + i;
+        for (uint32_t idx = 0; idx < kTurnClassesPerEdge; ++idx) {
+          c[e * kTurnClassesPerEdge + idx] = TurnClass(&directededges_[e], node, idx);
+        }
+      }
+    }
+  });
+  return classes + (edge - directededges_) * kTurnClassesPerEdge;
+}
+
+// Get the memory allocated next to the tile data.
+size_t GraphTile::decoded_size() const {
+  size_t size = directededge_hot_.memory_usage() + predictedspeeds_.memory_usage();
+  if (shape_cache_) {
+    size += shape_cache_->memory_usage();
+  }
+  if (default_edge_costs_) {
+    size += default_edge_costs_->memory_usage();
+  }
+  if (turn_classes_) {
+    size += turn_classes_->memory_usage();
+  }
+
+  // hash map nodes hold the pair and a next pointer, list nodes the value and two pointers
+  for (const auto& stop : stop_one_stops) {
+    size += sizeof(stop) + sizeof(void*) + stop.first.capacity();
+  }
+  for (const auto* one_stops : {&route_one_stops, &oper_one_stops}) {
+    for (const auto& one_stop : *one_stops) {
+      size += sizeof(one_stop) + sizeof(void*) + one_stop.first.capacity() +
+              one_stop.second.size() * (sizeof(GraphId) + 2 * sizeof(void*));
+    }
+  }
+  return size;
+}
+
 // Get the stop onestop Ids in this tile.
 const std::unordered_map<std::string, GraphId>& GraphTile::GetStopOneStops() const {
   return stop_one_stops;
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "baldr/graphreader.h"
+#include "baldr/incidenttile.h"
 #include "filesystem.h"
 #include "midgard/sequence.h"
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <ctime>
@@ -22,13 +24,19 @@ constexpr size_t DEFAULT_MAX_LATENT_COUNT = 5;
 struct incident_singleton_t {
 protected:
   // parameter pack to share state between daemon thread and singleton instance
+  using cache_t =
+      std::unordered_map<uint64_t, std::shared_ptr<const valhalla::baldr::IncidentTile>>;
   struct state_t {
     std::atomic<bool> initialized;  // whether or not the watcher thread has done 1 load of incidents
-    std::atomic<bool> lock_free;    // whether or not we can skip locking around cache operations
+    std::atomic<bool> lock_free;    // whether the tileset is static so unknown tiles are ignored
     std::condition_variable signal; // how the watcher tells the main thread its done its first load
-    std::mutex mutex;               // for locking on cache operations
-    // the actual cache where tiles are stored
-    std::unordered_map<uint64_t, std::shared_ptr<const valhalla::IncidentsTile>> cache;
+    std::mutex mutex;               // for waiting on the first load
+    // the watchers working copy of every tile it tracks, only ever touched by the watcher thread
+    cache_t cache;
+    // an immutable copy of the tiles that have incidents, which the watcher swaps out after every
+    // scan that changed something. readers just load the pointer so they never wait on the watcher
+    // and the tiles they already hold stay alive until they let go of them
+    std::shared_ptr<const cache_t> published;
   };
   // we use a shared_ptr to wrap the state between the watcher thread and the main threads singleton
   // instance. this gives the responsibility to the last living thread to deallocate the state object.
@@ -50,7 +58,7 @@ protected:
   /**
    * Singleton private constructor that static function uses to instantiate the singleton
    * @param config      lets the daemon thread know where/how to look for incidents
-   * @param tileset     an mmapped graph tileset (ie static) allows incident loading to be lock-free
+   * @param tileset     an mmapped graph tileset (ie static) limits which incident tiles are loaded
    * @param watch_func  the function the background thread will run to keep incident caches up to date
    */
   incident_singleton_t(const boost::property_tree::ptree& config,
@@ -81,38 +89,63 @@ protected:
   }
 
   /**
-   * Read the contents of a file into an incident tile
+   * Read the contents of a file into an incident tile. Tiles written in the flat layout are used as
+   * read, tiles written as a protobuf IncidentsTile are parsed and laid out flat once here so that
+   * requests never parse more than the metadata of the incidents they pass
    * @param filename   name of the file on the file system to read into memory
    * @return a shared pointer with the data of the tile or an empty pointer if it could not be read
    */
-  static std::shared_ptr<const valhalla::IncidentsTile> read_tile(const std::string& filename) {
+  static std::shared_ptr<const valhalla::baldr::IncidentTile>
+  read_tile(const std::string& filename) {
     // open the file for reading. its normal for this to fail when the file has been removed
     std::ifstream file(filename, std::ios::in | std::ios::binary);
     if (!file.is_open()) {
       return {};
     }
 
-    // prepare a stream for parsing
+    // the file is read rather than mapped because producers may rewrite it in place
     std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    google::protobuf::io::ArrayInputStream as(static_cast<const void*>(buffer.c_str()),
-                                              buffer.size());
-    google::protobuf::io::CodedInputStream cs(
-        static_cast<google::protobuf::io::ZeroCopyInputStream*>(&as));
-
-    // try to parse the stream
-    std::shared_ptr<valhalla::IncidentsTile> tile(new valhalla::IncidentsTile);
-    if (!tile->ParseFromCodedStream(&cs)) {
-      LOG_WARN("Incident Watcher failed to parse " + filename);
-      return {};
+    std::shared_ptr<valhalla::baldr::IncidentTile> tile;
+    if (valhalla::baldr::IncidentTile::IsFlat(buffer.data(), buffer.size())) {
+      try {
+        tile = std::make_shared<valhalla::baldr::IncidentTile>(std::move(buffer));
+      } catch (const std::exception& e) {
+        LOG_WARN("Incident Watcher failed to read " + filename + ": " + e.what());
+        return {};
+      }
+    } else {
+      google::protobuf::io::ArrayInputStream as(static_cast<const void*>(buffer.c_str()),
+                                                buffer.size());
+      google::protobuf::io::CodedInputStream cs(
+          static_cast<google::protobuf::io::ZeroCopyInputStream*>(&as));
+      valhalla::IncidentsTile message;
+      if (!message.ParseFromCodedStream(&cs)) {
+        LOG_WARN("Incident Watcher failed to parse " + filename);
+        return {};
+      }
+      tile = std::make_shared<valhalla::baldr::IncidentTile>(message);
     }
 
     // dont store empty tiles no point
-    if (tile->locations_size() == 0) {
+    if (tile->location_count() == 0) {
       return {};
     }
 
+    // lookups binary search the locations by edge so make sure they are sorted that way, the
+    // buffer is ours so they are sorted in place
+    auto by_edge = [](const valhalla::baldr::IncidentLocation& a,
+                      const valhalla::baldr::IncidentLocation& b) {
+      return a.edge_index < b.edge_index;
+    };
+    if (!std::is_sorted(tile->locations().begin(), tile->locations().end(), by_edge)) {
+      LOG_WARN("Incident watcher sorted unsorted locations in " + filename);
+      auto* locations = reinterpret_cast<valhalla::baldr::IncidentLocation*>(
+          tile->memory().data + sizeof(valhalla::baldr::IncidentTileHeader));
+      std::stable_sort(locations, locations + tile->location_count(), by_edge);
+    }
+
     // hand back something that isnt modifiable
-    return std::const_pointer_cast<const valhalla::IncidentsTile>(tile);
+    return std::const_pointer_cast<const valhalla::baldr::IncidentTile>(tile);
   }
 
   /**
@@ -125,11 +158,11 @@ protected:
    */
   static bool update_tile(const std::shared_ptr<state_t>& state,
                           const valhalla::baldr::GraphId& tile_id,
-                          std::shared_ptr<const valhalla::IncidentsTile>&& tile,
+                          std::shared_ptr<const valhalla::baldr::IncidentTile>&& tile,
                           decltype(state_t::cache)::iterator* hint = nullptr) {
     // see if we have a slot
     auto found = hint ? *hint : state->cache.find(tile_id);
-    // if we dont have a slot make one, this must be synchronized
+    // if we dont have a slot make one, readers never see this map so no locking is needed
     if (found == state->cache.cend()) {
       // this shouldnt happen in lock free mode but can if you put unexpected tiles in the log/dir
       if (state->lock_free.load()) {
@@ -137,22 +170,32 @@ protected:
                  " because it was not found in the configured tile extract");
         return false;
       }
-      // actually make a spot in the cache synchronously
-      try {
-        std::unique_lock<std::mutex> lock(state->mutex);
-        found = state->cache.insert({tile_id, {}}).first;
-      } // if anything went wrong we have to catch it so that the mutex is unlocked
-      catch (...) {
-        LOG_ERROR("Incident watcher failed to add incident tile to cache");
-      }
+      found = state->cache.insert({tile_id, {}}).first;
     }
-    // atomically store the tile shared_ptr, could be actually nullptr when there are no incidents
-    std::atomic_store_explicit(&found->second, tile, std::memory_order_release);
-    LOG_DEBUG("Incident watcher " + std::string(tile ? "loaded " : "unloaded ") +
+    // store the tile shared_ptr, could be actually nullptr when there are no incidents
+    found->second = std::move(tile);
+    LOG_DEBUG("Incident watcher " + std::string(found->second ? "loaded " : "unloaded ") +
               std::to_string(tile_id));
     return true;
   }
 
+  /**
+   * Publishes the tiles in the states cache which have incidents for readers to find. The old copy
+   * is left to the readers still holding it
+   * @param state     the state to publish
+   */
+  static void publish(const std::shared_ptr<state_t>& state) {
+    auto published = std::make_shared<cache_t>();
+    for (const auto& entry : state->cache) {
+      if (entry.second) {
+        published->emplace(entry);
+      }
+    }
+    std::atomic_store_explicit(&state->published,
+                               std::shared_ptr<const cache_t>(std::move(published)),
+                               std::memory_order_release);
+  }
+
   /**
    * Thread work function that continually checks for updates to incident tiles. The thread begins by
    * deciding whether its just scanning the directory (works for a small number of incidents) or using
@@ -182,7 +225,7 @@ protected:
    *
    * @param config     lets the function know where to look for incidents and desired update frequency
    * @param tileset    if not empty, the static list of tiles to track (other tiles will be ignored).
-                       if the tileset is static (mem map tar file) we can use lockfree mode
+                       if the tileset is static (mem map tar file) unknown tiles are skipped
    * @param state      inter thread communication object (mainly tile cache)
    * @param interrupt  functor that, if set and returns true, stops the main loop of this function
    */
@@ -216,7 +259,7 @@ protected:
       return;
     }
 
-    // a static tileset allows us to preallocate the cache entries which makes everything lock-free
+    // a static tileset allows us to preallocate the cache entries and skip any others
     // for a planet extract this should be about 200000 * 8 * 2 == 3MB of ram
     state->lock_free.store(!tileset.empty());
     state->cache.reserve(tileset.size());
@@ -304,6 +347,11 @@ protected:
         }
       }
 
+      // let readers see what changed
+      if (update_count > 0 || run_count == 0) {
+        publish(state);
+      }
+
       // if this round finished but was slower than we want
       last_scan = current_scan;
       auto latency = time(nullptr) - current_scan;
@@ -339,23 +387,22 @@ public:
    * @param tileset   only needed on first call, configures the incident loading
    * @return a shared_ptr to the incident tile or an empty shared_ptr when none exists
    */
-  static std::shared_ptr<const valhalla::IncidentsTile>
+  static std::shared_ptr<const valhalla::baldr::IncidentTile>
   get(const valhalla::baldr::GraphId& tile_id,
       const boost::property_tree::ptree& config = {},
       const std::unordered_set<valhalla::baldr::GraphId>& tileset = {}) {
     // spawn a daemon to watch for incidents
     static incident_singleton_t singleton{config, tileset};
 
-    // return the tile from the cache or an empty one if its not there
-    auto scoped_lock = singleton.state->lock_free.load()
-                           ? std::unique_lock<std::mutex>()
-                           : std::unique_lock<std::mutex>(singleton.state->mutex);
-    auto found = singleton.state->cache.find(tile_id);
-    if (found == singleton.state->cache.cend()) {
+    // return the tile from the published cache or an empty one if its not there
+    auto published =
+        std::atomic_load_explicit(&singleton.state->published, std::memory_order_acquire);
+    if (!published) {
       return {};
     }
-    auto tile = std::atomic_load_explicit(&found->second, std::memory_order_acquire);
-    return tile;
+    auto found = published->find(tile_id);
+    return found == published->cend() ? std::shared_ptr<const valhalla::baldr::IncidentTile>{}
+                                      : found->second;
   }
 };
 } // namespace
@@ -0,0 +1,131 @@
+#include "baldr/incidenttile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using namespace valhalla::baldr;
+
+class StringGraphMemory final : public GraphMemory {
+public:
+  StringGraphMemory(std::string&& memory) : memory_(std::move(memory)) {
+    data = const_cast<char*>(memory_.data());
+    size = memory_.size();
+  }
+
+private:
+  const std::string memory_;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+IncidentTile::IncidentTile(std::unique_ptr<const GraphMemory> memory) : memory_(std::move(memory)) {
+  if (!memory_ || !IsFlat(memory_->data, memory_->size)) {
+    throw std::runtime_error("Not a flat incident tile");
+  }
+  header_ = reinterpret_cast<const IncidentTileHeader*>(memory_->data);
+  if (header_->version != INCIDENT_TILE_VERSION) {
+    throw std::runtime_error("Incident tile version " + std::to_string(header_->version) +
+                             " is not the supported version " +
+                             std::to_string(INCIDENT_TILE_VERSION));
+  }
+  const uint64_t size = sizeof(IncidentTileHeader) +
+                        uint64_t(header_->location_count) * sizeof(IncidentLocation) +
+                        uint64_t(header_->metadata_count) * sizeof(IncidentMetadataEntry) +
+                        header_->metadata_bytes;
+  if (size != memory_->size) {
+    throw std::runtime_error("Incident tile is " + std::to_string(memory_->size) +
+                             " bytes but its header needs " + std::to_string(size));
+  }
+  locations_ =
+      reinterpret_cast<const IncidentLocation*>(memory_->data + sizeof(IncidentTileHeader));
+  entries_ =
+      reinterpret_cast<const IncidentMetadataEntry*>(locations_ + header_->location_count);
+  metadata_ = reinterpret_cast<const char*>(entries_ + header_->metadata_count);
+}
+
+IncidentTile::IncidentTile(std::string&& bytes)
+    : IncidentTile(std::make_unique<StringGraphMemory>(std::move(bytes))) {
+}
+
+IncidentTile::IncidentTile(const IncidentsTile& tile) : IncidentTile(Serialize(tile)) {
+}
+
+std::string IncidentTile::Serialize(const IncidentsTile& tile) {
+  // lookups binary search the locations by edge
+  std::vector<IncidentLocation> locations;
+  locations.reserve(tile.locations_size());
+  for (const auto& location : tile.locations()) {
+    locations.push_back({location.edge_index(), location.start_offset(), location.end_offset(),
+                         location.metadata_index()});
+  }
+  std::stable_sort(locations.begin(), locations.end(),
+                   [](const IncidentLocation& a, const IncidentLocation& b) {
+                     return a.edge_index < b.edge_index;
+                   });
+
+  std::vector<IncidentMetadataEntry> entries;
+  entries.reserve(tile.metadata_size());
+  std::string metadata;
+  for (const auto& meta : tile.metadata()) {
+    const auto offset = metadata.size();
+    meta.AppendToString(&metadata);
+    entries.push_back({meta.id(), offset, static_cast<uint32_t>(metadata.size() - offset), 0});
+  }
+
+  IncidentTileHeader header{};
+  std::memcpy(header.magic, kIncidentTileMagic, sizeof(header.magic));
+  header.version = INCIDENT_TILE_VERSION;
+  header.location_count = locations.size();
+  header.metadata_count = entries.size();
+  header.metadata_bytes = metadata.size();
+
+  std::string bytes;
+  bytes.reserve(sizeof(header) + locations.size() * sizeof(IncidentLocation) +
+                entries.size() * sizeof(IncidentMetadataEntry) + metadata.size());
+  bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  bytes.append(reinterpret_cast<const char*>(locations.data()),
+               locations.size() * sizeof(IncidentLocation));
+  bytes.append(reinterpret_cast<const char*>(entries.data()),
+               entries.size() * sizeof(IncidentMetadataEntry));
+  bytes.append(metadata);
+  return bytes;
+}
+
+bool IncidentTile::IsFlat(const char* data, size_t size) {
+  return size >= sizeof(IncidentTileHeader) &&
+         std::memcmp(data, kIncidentTileMagic, sizeof(kIncidentTileMagic)) == 0;
+}
+
+const IncidentMetadataEntry& IncidentTile::entry(const IncidentLocation& location) const {
+  if (location.metadata_index >= header_->metadata_count) {
+    throw std::runtime_error(std::string("Invalid incident tile with an incident_index of ") +
+                             std::to_string(location.metadata_index) +
+                             " but total incident metadata of " +
+                             std::to_string(header_->metadata_count));
+  }
+  return entries_[location.metadata_index];
+}
+
+uint64_t IncidentTile::metadata_id(const IncidentLocation& location) const {
+  return entry(location).id;
+}
+
+void IncidentTile::metadata(const IncidentLocation& location,
+                            IncidentsTile::Metadata& metadata) const {
+  const auto& found = entry(location);
+  if (found.offset + found.size > header_->metadata_bytes ||
+      !metadata.ParseFromArray(metadata_ + found.offset, found.size)) {
+    throw std::runtime_error("Invalid incident tile metadata for incident " +
+                             std::to_string(found.id));
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,135 @@
+#include "baldr/landmarkstore.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace valhalla {
+namespace baldr {
+
+LandmarkStore::LandmarkStore(const std::string& file) {
+  if (!filesystem::exists(file)) {
+    throw std::runtime_error(file + " does not exist");
+  }
+  const auto size = filesystem::directory_entry(file).file_size();
+  if (size < sizeof(LandmarkStoreHeader)) {
+    throw std::runtime_error(file + " is too small to be a landmark store");
+  }
+  memory_.map_readonly(file, size);
+
+  header_ = reinterpret_cast<const LandmarkStoreHeader*>(memory_.get());
+  if (std::memcmp(header_->magic, kLandmarkStoreMagic, sizeof(kLandmarkStoreMagic)) != 0 ||
+      header_->version != kLandmarkStoreVersion) {
+    throw std::runtime_error(file + " is not a landmark store of this version");
+  }
+  // the landmarks start at a multiple of their alignment
+  const uint64_t tiles_size = header_->tile_count * sizeof(uint32_t);
+  const uint64_t bins_size = (header_->tile_count * kLandmarkBinCount + 1) * sizeof(uint32_t);
+  const uint64_t landmarks_at =
+      (sizeof(LandmarkStoreHeader) + tiles_size + bins_size + 7) & ~static_cast<uint64_t>(7);
+  const uint64_t expected =
+      landmarks_at + header_->landmark_count * sizeof(LandmarkRecord) + header_->names_size;
+  if (size != expected) {
+    throw std::runtime_error(file + " is truncated");
+  }
+
+  tiles_ = reinterpret_cast<const uint32_t*>(memory_.get() + sizeof(LandmarkStoreHeader));
+  bins_ = tiles_ + header_->tile_count;
+  landmarks_ = reinterpret_cast<const LandmarkRecord*>(memory_.get() + landmarks_at);
+  names_ = reinterpret_cast<const char*>(landmarks_ + header_->landmark_count);
+}
+
+std::shared_ptr<const LandmarkStore> LandmarkStore::get(const std::string& file) {
+  if (file.empty()) {
+    return nullptr;
+  }
+
+  // the workers of a process share the map of each file
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::weak_ptr<const LandmarkStore>> instances;
+  std::lock_guard<std::mutex> _(lock);
+  auto store = instances[file].lock();
+  if (!store) {
+    try {
+      store = std::make_shared<const LandmarkStore>(file);
+      instances[file] = store;
+      LOG_INFO("Using the " + std::to_string(store->landmark_count()) + " landmarks of " + file);
+    } catch (const std::exception& e) {
+      LOG_WARN("Not using the landmark store: " + std::string(e.what()));
+    }
+  }
+  return store;
+}
+
+Landmark LandmarkStore::Get(const uint64_t id) const {
+  if (id >= header_->landmark_count) {
+    throw std::runtime_error("Landmark " + std::to_string(id) + " is not in the store");
+  }
+  const auto& record = landmarks_[id];
+  const auto lnglat = decode_lnglat(record.location);
+  return Landmark(static_cast<int64_t>(id), names_ + record.name_offset,
+                  static_cast<LandmarkType>(record.type), lnglat.first, lnglat.second);
+}
+
+std::vector<Landmark> LandmarkStore::Find(const midgard::AABB2<midgard::PointLL>& bbox) const {
+  std::vector<Landmark> landmarks;
+  const auto& tiles = TileHierarchy::levels().back().tiles;
+  const double bin_size = tiles.TileSize() / kLandmarkBinsDim;
+  const auto* tiles_end = tiles_ + header_->tile_count;
+  for (const auto tile_id : tiles.TileList(bbox)) {
+    const auto* found = std::lower_bound(tiles_, tiles_end, static_cast<uint32_t>(tile_id));
+    if (found == tiles_end || *found != static_cast<uint32_t>(tile_id)) {
+      continue;
+    }
+    const auto* bins = bins_ + (found - tiles_) * kLandmarkBinCount;
+    const auto bounds = tiles.TileBounds(tile_id);
+    for (uint32_t row = 0; row < kLandmarkBinsDim; ++row) {
+      for (uint32_t col = 0; col < kLandmarkBinsDim; ++col) {
+        const uint32_t bin = row * kLandmarkBinsDim + col;
+        if (bins[bin] == bins[bin + 1]) {
+          continue;
+        }
+        const midgard::AABB2<midgard::PointLL> bin_bbox(bounds.minx() + col * bin_size,
+                                                        bounds.miny() + row * bin_size,
+                                                        bounds.minx() + (col + 1) * bin_size,
+                                                        bounds.miny() + (row + 1) * bin_size);
+        if (!bin_bbox.Intersects(bbox)) {
+          continue;
+        }
+        for (uint32_t id = bins[bin]; id < bins[bin + 1]; ++id) {
+          const auto lnglat = decode_lnglat(landmarks_[id].location);
+          if (bbox.Contains({lnglat.first, lnglat.second})) {
+            landmarks.push_back(Get(id));
+          }
+        }
+      }
+    }
+  }
+  return landmarks;
+}
+
+int32_t LandmarkStore::Bin(const midgard::PointLL& ll, int32_t& tile_id) {
+  const auto& tiles = TileHierarchy::levels().back().tiles;
+  tile_id = tiles.TileId(ll);
+  if (tile_id < 0) {
+    return -1;
+  }
+  const auto bounds = tiles.TileBounds(tile_id);
+  const double bin_size = tiles.TileSize() / kLandmarkBinsDim;
+  // positions right on the sides of the tile go into its outer bins
+  const auto col = std::min(
+      static_cast<uint32_t>(std::max((ll.lng() - bounds.minx()) / bin_size, 0.0)),
+      kLandmarkBinsDim - 1);
+  const auto row = std::min(
+      static_cast<uint32_t>(std::max((ll.lat() - bounds.miny()) / bin_size, 0.0)),
+      kLandmarkBinsDim - 1);
+  return row * kLandmarkBinsDim + col;
+}
+
+} // namespace baldr
+} // namespace valhalla
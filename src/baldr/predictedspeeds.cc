@@ -1,4 +1,19 @@
 #include "baldr/predictedspeeds.h"
+#include "baldr/graphconstants.h"
+
+#include <algorithm>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define SPEED_KERNEL_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SPEED_KERNEL_AVX2
+#define SPEED_KERNEL_AVX2_DISPATCH
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPEED_KERNEL_NEON
+#endif
 
 namespace valhalla {
 namespace baldr {
@@ -51,18 +66,222 @@ private:
   float table_[kCosBucketTableSize];
 };
 
-std::array<int16_t, kCoefficientCount> compress_speed_buckets(const float* speeds) {
-  std::array<float, kCoefficientCount> coefficients;
-  coefficients.fill(0.f);
+namespace {
 
-  // DCT-II with speed normalization
+// Whether tiles enable their decoded speed cache, see PredictedSpeeds::set_cache_enabled
+std::atomic<bool> speed_cache_enabled{false};
+
+// Snapshot slot of every window of the week or -1, see PredictedSpeeds::set_snapshot_windows
+std::array<int16_t, kSnapshotWindowsPerWeek> snapshot_slots = [] {
+  std::array<int16_t, kSnapshotWindowsPerWeek> slots;
+  slots.fill(-1);
+  return slots;
+}();
+int16_t snapshot_count = 0;
+
+// The kernels below compute the dot product of the coefficients with the cos values of a bucket.
+// The first cos value is always 1 so the 1 / sqrt(2) weight of the first coefficient is left to
+// the caller.
+float speed_dot_scalar(const int16_t* coefficients, const float* cos_values) {
+  float sum = 0.f;
+  for (uint32_t c = 0; c < kCoefficientCount; ++c) {
+    sum += coefficients[c] * cos_values[c];
+  }
+  return sum;
+}
+
+#ifdef SPEED_KERNEL_AVX2
+static_assert(kCoefficientCount % 8 == 0, "AVX2 kernel expects a multiple of 8 coefficients");
+
+#ifdef SPEED_KERNEL_AVX2_DISPATCH
+__attribute__((target("avx2,fma")))
+#endif
+float speed_dot_avx2(const int16_t* coefficients, const float* cos_values) {
+  // two accumulators to hide the latency of the fused multiply add
+  __m256 sum0 = _mm256_setzero_ps();
+  __m256 sum1 = _mm256_setzero_ps();
+  uint32_t c = 0;
+  for (; c + 16 <= kCoefficientCount; c += 16) {
+    const __m128i coef0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + c));
+    const __m128i coef1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + c + 8));
+    sum0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(coef0)),
+                           _mm256_loadu_ps(cos_values + c), sum0);
+    sum1 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(coef1)),
+                           _mm256_loadu_ps(cos_values + c + 8), sum1);
+  }
+  for (; c < kCoefficientCount; c += 8) {
+    const __m128i coef = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + c));
+    sum0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(coef)),
+                           _mm256_loadu_ps(cos_values + c), sum0);
+  }
+
+  // horizontal sum of the 8 lanes
+  const __m256 sum = _mm256_add_ps(sum0, sum1);
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x1));
+  return _mm_cvtss_f32(half);
+}
+#endif
+
+#ifdef SPEED_KERNEL_NEON
+static_assert(kCoefficientCount % 8 == 0, "NEON kernel expects a multiple of 8 coefficients");
+
+float speed_dot_neon(const int16_t* coefficients, const float* cos_values) {
+  float32x4_t sum0 = vdupq_n_f32(0.f);
+  float32x4_t sum1 = vdupq_n_f32(0.f);
+  for (uint32_t c = 0; c < kCoefficientCount; c += 8) {
+    const int16x8_t coef = vld1q_s16(coefficients + c);
+    sum0 = vmlaq_f32(sum0, vcvtq_f32_s32(vmovl_s16(vget_low_s16(coef))), vld1q_f32(cos_values + c));
+    sum1 = vmlaq_f32(sum1, vcvtq_f32_s32(vmovl_s16(vget_high_s16(coef))),
+                     vld1q_f32(cos_values + c + 4));
+  }
+  const float32x4_t sum = vaddq_f32(sum0, sum1);
+  return vgetq_lane_f32(sum, 0) + vgetq_lane_f32(sum, 1) + vgetq_lane_f32(sum, 2) +
+         vgetq_lane_f32(sum, 3);
+}
+#endif
+
+// The kernels below compute the DCT-II sums of the speeds of all buckets, each coefficient sums
+// the speeds weighted by its cos values. The table holds the cos values of a bucket next to each
+// other, so the vector kernels keep a block of coefficients in registers and stream over the
+// buckets once per block instead of loading and storing every coefficient for every bucket.
+void speed_dct_scalar(const float* speeds, const float* cos_table, float* coefficients) {
+  std::fill(coefficients, coefficients + kCoefficientCount, 0.f);
   for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
-    // Get a pointer to the precomputed cos values for this bucket
-    const float* cos_values = BucketCosTable::GetInstance().get(bucket);
+    const float* cos_values = cos_table + bucket * kCoefficientCount;
     for (uint32_t c = 0; c < kCoefficientCount; ++c) {
       coefficients[c] += cos_values[c] * speeds[bucket];
     }
   }
+}
+
+#ifdef SPEED_KERNEL_AVX2
+#ifdef SPEED_KERNEL_AVX2_DISPATCH
+__attribute__((target("avx2,fma")))
+#endif
+void speed_dct_avx2(const float* speeds, const float* cos_table, float* coefficients) {
+  // blocks of 32 coefficients in four accumulators
+  uint32_t c = 0;
+  for (; c + 32 <= kCoefficientCount; c += 32) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    __m256 sum2 = _mm256_setzero_ps();
+    __m256 sum3 = _mm256_setzero_ps();
+    const float* cos_values = cos_table + c;
+    for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+      const __m256 speed = _mm256_set1_ps(speeds[bucket]);
+      sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(cos_values), speed, sum0);
+      sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(cos_values + 8), speed, sum1);
+      sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(cos_values + 16), speed, sum2);
+      sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(cos_values + 24), speed, sum3);
+      cos_values += kCoefficientCount;
+    }
+    _mm256_storeu_ps(coefficients + c, sum0);
+    _mm256_storeu_ps(coefficients + c + 8, sum1);
+    _mm256_storeu_ps(coefficients + c + 16, sum2);
+    _mm256_storeu_ps(coefficients + c + 24, sum3);
+  }
+
+  // the coefficients left over
+  for (; c < kCoefficientCount; c += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    const float* cos_values = cos_table + c;
+    for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+      sum = _mm256_fmadd_ps(_mm256_loadu_ps(cos_values), _mm256_set1_ps(speeds[bucket]), sum);
+      cos_values += kCoefficientCount;
+    }
+    _mm256_storeu_ps(coefficients + c, sum);
+  }
+}
+#endif
+
+#ifdef SPEED_KERNEL_NEON
+void speed_dct_neon(const float* speeds, const float* cos_table, float* coefficients) {
+  // blocks of 16 coefficients in four accumulators
+  uint32_t c = 0;
+  for (; c + 16 <= kCoefficientCount; c += 16) {
+    float32x4_t sum0 = vdupq_n_f32(0.f);
+    float32x4_t sum1 = vdupq_n_f32(0.f);
+    float32x4_t sum2 = vdupq_n_f32(0.f);
+    float32x4_t sum3 = vdupq_n_f32(0.f);
+    const float* cos_values = cos_table + c;
+    for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+      const float32x4_t speed = vdupq_n_f32(speeds[bucket]);
+      sum0 = vmlaq_f32(sum0, vld1q_f32(cos_values), speed);
+      sum1 = vmlaq_f32(sum1, vld1q_f32(cos_values + 4), speed);
+      sum2 = vmlaq_f32(sum2, vld1q_f32(cos_values + 8), speed);
+      sum3 = vmlaq_f32(sum3, vld1q_f32(cos_values + 12), speed);
+      cos_values += kCoefficientCount;
+    }
+    vst1q_f32(coefficients + c, sum0);
+    vst1q_f32(coefficients + c + 4, sum1);
+    vst1q_f32(coefficients + c + 8, sum2);
+    vst1q_f32(coefficients + c + 12, sum3);
+  }
+
+  // the coefficients left over
+  for (; c < kCoefficientCount; c += 8) {
+    float32x4_t sum0 = vdupq_n_f32(0.f);
+    float32x4_t sum1 = vdupq_n_f32(0.f);
+    const float* cos_values = cos_table + c;
+    for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+      const float32x4_t speed = vdupq_n_f32(speeds[bucket]);
+      sum0 = vmlaq_f32(sum0, vld1q_f32(cos_values), speed);
+      sum1 = vmlaq_f32(sum1, vld1q_f32(cos_values + 4), speed);
+      cos_values += kCoefficientCount;
+    }
+    vst1q_f32(coefficients + c, sum0);
+    vst1q_f32(coefficients + c + 4, sum1);
+  }
+}
+#endif
+
+#ifdef SPEED_KERNEL_AVX2_DISPATCH
+bool cpu_supports_avx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#endif
+
+using speed_dot_t = float (*)(const int16_t*, const float*);
+using speed_dct_t = void (*)(const float*, const float*, float*);
+
+// Pick the fastest kernel this machine can run, only x86 builds without -mavx2 need to check
+speed_dot_t select_speed_dot() {
+#if defined(SPEED_KERNEL_AVX2_DISPATCH)
+  return cpu_supports_avx2() ? speed_dot_avx2 : speed_dot_scalar;
+#elif defined(SPEED_KERNEL_AVX2)
+  return speed_dot_avx2;
+#elif defined(SPEED_KERNEL_NEON)
+  return speed_dot_neon;
+#else
+  return speed_dot_scalar;
+#endif
+}
+
+const speed_dot_t speed_dot = select_speed_dot();
+
+speed_dct_t select_speed_dct() {
+#if defined(SPEED_KERNEL_AVX2_DISPATCH)
+  return cpu_supports_avx2() ? speed_dct_avx2 : speed_dct_scalar;
+#elif defined(SPEED_KERNEL_AVX2)
+  return speed_dct_avx2;
+#elif defined(SPEED_KERNEL_NEON)
+  return speed_dct_neon;
+#else
+  return speed_dct_scalar;
+#endif
+}
+
+const speed_dct_t speed_dct = select_speed_dct();
+
+} // namespace
+
+std::array<int16_t, kCoefficientCount> compress_speed_buckets(const float* speeds) {
+  // DCT-II with speed normalization
+  std::array<float, kCoefficientCount> coefficients;
+  speed_dct(speeds, BucketCosTable::GetInstance().get(0), coefficients.data());
   coefficients[0] *= k1OverSqrt2;
 
   std::array<int16_t, kCoefficientCount> result;
@@ -76,15 +295,67 @@ float decompress_speed_bucket(const int16_t* coefficients, uint32_t bucket_idx)
   // Get a pointer to the precomputed cos values for this bucket
   const float* b = BucketCosTable::GetInstance().get(bucket_idx);
 
-  // DCT-III with speed normalization
-  float speed = *coefficients * k1OverSqrt2;
-  const auto* coef_end = coefficients + kCoefficientCount;
-  for (++b, ++coefficients; coefficients < coef_end; ++coefficients, ++b) {
-    speed += *coefficients * *b;
-  }
+  // DCT-III with speed normalization, the first cos value is 1 so we only reweight the coefficient
+  const float speed = speed_dot(coefficients, b) - *coefficients * (1.f - k1OverSqrt2);
   return speed * kSpeedNormalization;
 }
 
+bool PredictedSpeeds::cache_enabled() {
+  return speed_cache_enabled.load(std::memory_order_relaxed);
+}
+
+void PredictedSpeeds::set_cache_enabled(const bool enabled) {
+  speed_cache_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void PredictedSpeeds::set_snapshot_windows(const std::vector<uint32_t>& windows) {
+  snapshot_slots.fill(-1);
+  snapshot_count = 0;
+  for (const auto window : windows) {
+    if (window < kSnapshotWindowsPerWeek && snapshot_slots[window] < 0) {
+      snapshot_slots[window] = snapshot_count++;
+    }
+  }
+}
+
+bool PredictedSpeeds::snapshots_enabled() {
+  return snapshot_count > 0;
+}
+
+void PredictedSpeeds::enable_snapshots(const uint32_t profile_count) {
+  snapshots_.reset(new Snapshot[snapshot_count]);
+  snapshot_slots_ = snapshot_slots.data();
+  snapshot_profiles_ = profile_count;
+}
+
+size_t PredictedSpeeds::memory_usage() const {
+  size_t bytes = static_cast<size_t>(cache_size_) * sizeof(std::atomic<uint64_t>);
+  if (snapshots_ != nullptr) {
+    bytes += snapshot_count *
+             (sizeof(Snapshot) + static_cast<size_t>(snapshot_profiles_) * kBucketsPerSnapshotWindow);
+  }
+  return bytes;
+}
+
+const uint8_t* PredictedSpeeds::snapshot(const int16_t slot, const uint32_t bucket) const {
+  auto& snapshot = snapshots_[slot];
+  std::call_once(snapshot.built, [&]() {
+    const uint32_t first = bucket - bucket % kBucketsPerSnapshotWindow;
+    snapshot.speeds.reset(new uint8_t[snapshot_profiles_ * kBucketsPerSnapshotWindow]);
+    uint8_t* speed = snapshot.speeds.get();
+    for (uint32_t p = 0; p < snapshot_profiles_; ++p) {
+      const int16_t* coefficients = profiles_ + p * kCoefficientCount;
+      for (uint32_t b = first; b < first + kBucketsPerSnapshotWindow; ++b, ++speed) {
+        // GetSpeed rounds the predicted speed, so we can keep it rounded. Speeds that GetSpeed
+        // would not use are kept as 0 which it does not use either
+        const float decoded = decompress_speed_bucket(coefficients, b);
+        *speed = valid_speed(decoded) ? static_cast<uint8_t>(decoded + 0.5f) : 0;
+      }
+    }
+  });
+  return snapshot.speeds.get();
+}
+
 std::string encode_compressed_speeds(const int16_t* coefficients) {
   std::string result;
   result.reserve(kCoefficientCount * sizeof(uint16_t) / sizeof(char));
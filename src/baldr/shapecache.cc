@@ -0,0 +1,61 @@
+#include "baldr/shapecache.h"
+#include "midgard/encoded.h"
+
+#include <atomic>
+
+namespace {
+
+// Slots of the cache of each tile, see ShapeCache::set_size
+std::atomic<uint32_t> cache_size{0};
+
+// Shape decoding counters of the whole process
+std::atomic<uint64_t> decode_count{0};
+std::atomic<uint64_t> hit_count{0};
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+ShapeCache::ShapeCache(const uint32_t size) : shift_(31) {
+  while (shift_ > 0 && (1u << (32 - shift_)) < size) {
+    --shift_;
+  }
+  slots_.resize(1u << (32 - shift_));
+}
+
+ShapeCache::Shape
+ShapeCache::get(const uint32_t offset, const char* encoded, const size_t encoded_size) const {
+  // edge infos are variable length, hashing spreads their offsets over the slots
+  auto& slot = slots_[(offset * 2654435761u) >> shift_];
+  auto entry = std::atomic_load_explicit(&slot, std::memory_order_acquire);
+  if (entry && entry->offset == offset) {
+    hit_count.fetch_add(1, std::memory_order_relaxed);
+    return Shape(entry, &entry->shape);
+  }
+
+  entry = std::make_shared<const Entry>(
+      Entry{offset, midgard::decode7<std::vector<midgard::PointLL>>(encoded, encoded_size)});
+  decode_count.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_store_explicit(&slot, entry, std::memory_order_release);
+  return Shape(entry, &entry->shape);
+}
+
+uint32_t ShapeCache::size() {
+  return cache_size.load(std::memory_order_relaxed);
+}
+
+void ShapeCache::set_size(const uint32_t size) {
+  cache_size.store(size, std::memory_order_relaxed);
+}
+
+ShapeCache::Stats ShapeCache::stats() {
+  return {decode_count.load(std::memory_order_relaxed), hit_count.load(std::memory_order_relaxed)};
+}
+
+void ShapeCache::count_decode() {
+  decode_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace baldr
+} // namespace valhalla
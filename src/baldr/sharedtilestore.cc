@@ -0,0 +1,418 @@
+#include "baldr/sharedtilestore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+namespace valhalla {
+namespace baldr {
+
+// Start of the segment, the fields after write_mutex are only changed while holding it
+struct SharedTileStoreHeader {
+  std::atomic<uint64_t> ready; // kReady once the creating process initialized the segment
+  char magic[8];
+  uint32_t version;
+  uint32_t slot_count;
+  uint64_t data_size;
+  pthread_mutex_t write_mutex;
+  uint64_t head; // where the next tile is written
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> puts;
+  std::atomic<uint64_t> evictions;
+  std::atomic<uint64_t> rejected;
+};
+
+// A tile in the store. The state packs a valid bit, a generation which changes whenever the slot
+// is invalidated and the number of pins. The other fields are only written while it is invalid
+struct SharedTileSlot {
+  std::atomic<uint64_t> state;
+  std::atomic<uint64_t> tile_id;
+  std::atomic<uint64_t> offset;
+  std::atomic<uint64_t> size;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+using namespace valhalla::baldr;
+
+namespace {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The shared tile store needs lock-free 64 bit atomics to work across processes");
+
+constexpr char kMagic[8] = {'V', 'A', 'L', 'T', 'I', 'L', 'E', 'S'};
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kReady = 0x5245414459ULL;
+
+// Slots a tile can be in, starting at the one its id hashes to
+constexpr uint32_t kProbeCount = 16;
+// Tiles are written at multiples of this, plenty for the structures in them
+constexpr uint64_t kAlignment = 64;
+// One slot per this many bytes of tile data, tiles are usually much bigger
+constexpr uint64_t kBytesPerSlot = 64 * 1024;
+constexpr uint32_t kMinSlotCount = 1024;
+
+constexpr uint64_t kValid = 1ULL << 63;
+constexpr uint64_t kGenerationOne = 1ULL << 32;
+constexpr uint64_t kGenerationMask = 0x7fffffff00000000ULL;
+constexpr uint64_t kPinMask = 0xffffffffULL;
+
+uint64_t aligned(uint64_t size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// The state of a slot after invalidating it
+uint64_t invalidated(uint64_t state) {
+  return (state + kGenerationOne) & kGenerationMask;
+}
+
+uint64_t hash(uint64_t key) {
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+  return key ^ (key >> 31);
+}
+
+// Tile data in the segment, unpins its slot when the tile is done with it
+class SharedTileMemory final : public GraphMemory {
+public:
+  SharedTileMemory(std::shared_ptr<char> segment, SharedTileSlot* slot, char* tile_data, size_t size)
+      : segment_(std::move(segment)), slot_(slot) {
+    data = tile_data;
+    this->size = size;
+  }
+  ~SharedTileMemory() override {
+    slot_->state.fetch_sub(1, std::memory_order_release);
+  }
+
+private:
+  const std::shared_ptr<char> segment_;
+  SharedTileSlot* slot_;
+};
+
+// Holds the write lock of the segment, taking over from a process that died holding it
+class write_lock_t {
+public:
+  explicit write_lock_t(pthread_mutex_t* mutex) : mutex_(mutex) {
+    int result = pthread_mutex_lock(mutex_);
+#ifdef __linux__
+    if (result == EOWNERDEAD) {
+      pthread_mutex_consistent(mutex_);
+      result = 0;
+    }
+#endif
+    if (result != 0) {
+      throw std::runtime_error("Could not lock the shared tile store: " +
+                               std::string(strerror(result)));
+    }
+  }
+  ~write_lock_t() {
+    pthread_mutex_unlock(mutex_);
+  }
+
+private:
+  pthread_mutex_t* mutex_;
+};
+
+size_t header_size() {
+  return aligned(sizeof(SharedTileStoreHeader));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+SharedTileStore::SharedTileStore(const std::string& name, size_t size) {
+  if (size < kAlignment) {
+    throw std::runtime_error("The shared tile store " + name + " is too small");
+  }
+
+  // whoever creates the segment lays it out, everyone else waits for that to be done
+  bool created = true;
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    created = false;
+    fd = shm_open(name.c_str(), O_RDWR, 0600);
+  }
+  if (fd < 0) {
+    throw std::runtime_error("Could not open the shared tile store " + name + ": " +
+                             strerror(errno));
+  }
+
+  const uint64_t data_size = aligned(size);
+  const auto slot_count = static_cast<uint32_t>(
+      std::min<uint64_t>(std::max<uint64_t>(kMinSlotCount, data_size / kBytesPerSlot), UINT32_MAX));
+  size_t segment_size = header_size() + aligned(slot_count * sizeof(SharedTileSlot)) + data_size;
+  if (created) {
+    if (ftruncate(fd, segment_size) != 0) {
+      close(fd);
+      shm_unlink(name.c_str());
+      throw std::runtime_error("Could not size the shared tile store " + name + ": " +
+                               strerror(errno));
+    }
+  } else {
+    // the creator may not have sized it yet
+    struct stat s {};
+    for (int i = 0; i < 500 && fstat(fd, &s) == 0 && s.st_size == 0; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    segment_size = s.st_size;
+    if (segment_size < header_size()) {
+      close(fd);
+      throw std::runtime_error("The shared tile store " + name + " was never laid out");
+    }
+  }
+
+  void* mapped = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Could not map the shared tile store " + name + ": " +
+                             strerror(errno));
+  }
+  segment_.reset(static_cast<char*>(mapped),
+                 [segment_size](char* segment) { munmap(segment, segment_size); });
+  header_ = reinterpret_cast<SharedTileStoreHeader*>(segment_.get());
+
+  if (created) {
+    // a new segment is all zeros, which is an empty slot and a zero counter
+    std::memcpy(header_->magic, kMagic, sizeof(kMagic));
+    header_->version = kVersion;
+    header_->slot_count = slot_count;
+    header_->data_size = data_size;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&header_->write_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    header_->ready.store(kReady, std::memory_order_release);
+  } else {
+    for (int i = 0; i < 500 && header_->ready.load(std::memory_order_acquire) != kReady; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (header_->ready.load(std::memory_order_acquire) != kReady ||
+        std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 || header_->version != kVersion ||
+        header_size() + aligned(header_->slot_count * sizeof(SharedTileSlot)) +
+                header_->data_size !=
+            segment_size) {
+      throw std::runtime_error("The shared tile store " + name +
+                               " has a different layout, remove it and try again");
+    }
+  }
+  data_ = segment_.get() + header_size() +
+          aligned(header_->slot_count * sizeof(SharedTileSlot));
+}
+
+SharedTileSlot* SharedTileStore::slot(uint64_t idx) const {
+  auto* slots = reinterpret_cast<SharedTileSlot*>(segment_.get() + header_size());
+  return slots + idx % header_->slot_count;
+}
+
+std::unique_ptr<const GraphMemory> SharedTileStore::Pin(SharedTileSlot* slot,
+                                                        uint64_t tile_id) const {
+  uint64_t state = slot->state.load(std::memory_order_acquire);
+  while (state & kValid) {
+    if (slot->tile_id.load(std::memory_order_relaxed) != tile_id) {
+      return nullptr;
+    }
+    const uint64_t offset = slot->offset.load(std::memory_order_relaxed);
+    const uint64_t size = slot->size.load(std::memory_order_relaxed);
+
+    // if the state did not change the slot was not invalidated since we read it
+    if (slot->state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+      return std::make_unique<SharedTileMemory>(segment_, slot, data_ + offset, size);
+    }
+    // someone else pinned or unpinned it or it was replaced, look at it again
+  }
+  return nullptr;
+}
+
+std::unique_ptr<const GraphMemory> SharedTileStore::Get(const GraphId& graphid) const {
+  const uint64_t start = hash(graphid.value);
+  for (uint32_t i = 0; i < kProbeCount; ++i) {
+    if (auto memory = Pin(slot(start + i), graphid.value)) {
+      header_->hits.fetch_add(1, std::memory_order_relaxed);
+      return memory;
+    }
+  }
+  header_->misses.fetch_add(1, std::memory_order_relaxed);
+  return nullptr;
+}
+
+uint64_t SharedTileStore::Evict(uint64_t begin, uint64_t end) {
+  for (uint32_t i = 0; i < header_->slot_count; ++i) {
+    auto* candidate = slot(i);
+    uint64_t state = candidate->state.load(std::memory_order_acquire);
+    if (!(state & kValid)) {
+      continue;
+    }
+    const uint64_t offset = candidate->offset.load(std::memory_order_relaxed);
+    const uint64_t slot_end = offset + aligned(candidate->size.load(std::memory_order_relaxed));
+    if (slot_end <= begin || offset >= end) {
+      continue;
+    }
+    // only writers invalidate and we hold the lock, so this only fails when it gets pinned
+    while (!(state & kPinMask) &&
+           !candidate->state.compare_exchange_weak(state, invalidated(state),
+                                                   std::memory_order_acq_rel)) {
+    }
+    if (state & kPinMask) {
+      return slot_end;
+    }
+    header_->evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+  return 0;
+}
+
+std::unique_ptr<const GraphMemory>
+SharedTileStore::Put(const GraphId& graphid, const char* data, size_t size) {
+  if (size == 0 || aligned(size) > header_->data_size) {
+    header_->rejected.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  write_lock_t lock(&header_->write_mutex);
+
+  // another process may have been faster
+  const uint64_t start = hash(graphid.value);
+  for (uint32_t i = 0; i < kProbeCount; ++i) {
+    if (auto memory = Pin(slot(start + i), graphid.value)) {
+      return memory;
+    }
+  }
+
+  // a free slot or one we can evict
+  SharedTileSlot* target = nullptr;
+  for (uint32_t i = 0; i < kProbeCount && !target; ++i) {
+    auto* candidate = slot(start + i);
+    uint64_t state = candidate->state.load(std::memory_order_acquire);
+    if (!(state & kValid)) {
+      target = candidate;
+    } else if (!(state & kPinMask) &&
+               candidate->state.compare_exchange_strong(state, invalidated(state),
+                                                        std::memory_order_acq_rel)) {
+      header_->evictions.fetch_add(1, std::memory_order_relaxed);
+      target = candidate;
+    }
+  }
+  if (!target) {
+    header_->rejected.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // make room at the head of the ring, skipping past tiles that are pinned
+  const uint64_t needed = aligned(size);
+  bool found = false;
+  for (uint32_t attempt = 0; attempt <= header_->slot_count && !found; ++attempt) {
+    if (header_->head + needed > header_->data_size) {
+      header_->head = 0;
+    }
+    const uint64_t blocked = Evict(header_->head, header_->head + needed);
+    found = blocked == 0;
+    if (!found) {
+      header_->head = blocked;
+    }
+  }
+  if (!found) {
+    header_->rejected.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // write the tile and publish it pinned for the caller
+  const uint64_t offset = header_->head;
+  std::memcpy(data_ + offset, data, size);
+  target->tile_id.store(graphid.value, std::memory_order_relaxed);
+  target->offset.store(offset, std::memory_order_relaxed);
+  target->size.store(size, std::memory_order_relaxed);
+  const uint64_t state = target->state.load(std::memory_order_relaxed);
+  target->state.store((state & kGenerationMask) | kValid | 1, std::memory_order_release);
+  header_->head = offset + needed;
+  header_->puts.fetch_add(1, std::memory_order_relaxed);
+  return std::make_unique<SharedTileMemory>(segment_, target, data_ + offset, size);
+}
+
+SharedTileStore::Stats SharedTileStore::GetStats() const {
+  Stats stats;
+  stats.hits = header_->hits.load(std::memory_order_relaxed);
+  stats.misses = header_->misses.load(std::memory_order_relaxed);
+  stats.puts = header_->puts.load(std::memory_order_relaxed);
+  stats.evictions = header_->evictions.load(std::memory_order_relaxed);
+  stats.rejected = header_->rejected.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::shared_ptr<SharedTileStore> SharedTileStore::get(const std::string& name, size_t size) {
+  static std::mutex stores_mutex;
+  static std::unordered_map<std::string, std::weak_ptr<SharedTileStore>> stores;
+  std::lock_guard<std::mutex> lock(stores_mutex);
+  auto store = stores[name].lock();
+  if (!store) {
+    store = std::make_shared<SharedTileStore>(name, size);
+    stores[name] = store;
+  }
+  return store;
+}
+
+void SharedTileStore::Remove(const std::string& name) {
+  shm_unlink(name.c_str());
+}
+
+} // namespace baldr
+} // namespace valhalla
+
+#else
+
+namespace valhalla {
+namespace baldr {
+
+struct SharedTileStoreHeader {};
+struct SharedTileSlot {};
+
+SharedTileStore::SharedTileStore(const std::string& name, size_t) {
+  throw std::runtime_error("The shared tile store " + name + " needs POSIX shared memory");
+}
+
+std::unique_ptr<const GraphMemory> SharedTileStore::Get(const GraphId&) const {
+  return nullptr;
+}
+
+std::unique_ptr<const GraphMemory> SharedTileStore::Put(const GraphId&, const char*, size_t) {
+  return nullptr;
+}
+
+SharedTileStore::Stats SharedTileStore::GetStats() const {
+  return {};
+}
+
+std::shared_ptr<SharedTileStore> SharedTileStore::get(const std::string& name, size_t size) {
+  return std::make_shared<SharedTileStore>(name, size);
+}
+
+void SharedTileStore::Remove(const std::string&) {
+}
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // _WIN32
@@ -0,0 +1,156 @@
+#include "baldr/tileaccesslog.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace valhalla {
+namespace baldr {
+
+TileAccessLog::TileAccessLog(const std::string& file_name, std::chrono::seconds write_interval)
+    : file_name_(file_name), write_interval_(write_interval),
+      last_write_(std::chrono::steady_clock::now()) {
+  // what was popular before counts half as much as what is popular now
+  for (const auto& tile : Read(file_name_)) {
+    if (tile.count > 1) {
+      counts_[tile.tile_id] = {tile.count / 2, tile.misses / 2};
+    }
+  }
+}
+
+TileAccessLog::~TileAccessLog() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  WriteLocked();
+}
+
+void TileAccessLog::Add(const std::unordered_map<uint64_t, uint32_t>& counts,
+                        const std::unordered_map<uint64_t, uint32_t>& misses) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& count : counts) {
+    counts_[count.first].count += count.second;
+  }
+  for (const auto& miss : misses) {
+    counts_[miss.first].misses += miss.second;
+  }
+  if (std::chrono::steady_clock::now() - last_write_ >= write_interval_) {
+    WriteLocked();
+  }
+}
+
+bool TileAccessLog::Write() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return WriteLocked();
+}
+
+std::vector<TileAccessCount> TileAccessLog::Counts() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return CountsLocked();
+}
+
+std::vector<TileAccessCount> TileAccessLog::CountsLocked() const {
+  std::vector<TileAccessCount> tiles;
+  tiles.reserve(counts_.size());
+  for (const auto& count : counts_) {
+    tiles.push_back({count.first, count.second.count, count.second.misses});
+  }
+  std::sort(tiles.begin(), tiles.end(), [](const TileAccessCount& a, const TileAccessCount& b) {
+    return a.count > b.count || (a.count == b.count && a.tile_id < b.tile_id);
+  });
+  return tiles;
+}
+
+std::vector<TileAccessLevel> TileAccessLog::ByLevel(const std::vector<TileAccessCount>& counts) {
+  std::vector<TileAccessLevel> levels;
+  for (const auto& tile : counts) {
+    const auto level = GraphId(tile.tile_id).level();
+    auto found = std::find_if(levels.begin(), levels.end(),
+                              [level](const TileAccessLevel& l) { return l.level == level; });
+    if (found == levels.end()) {
+      found = levels.insert(levels.end(), TileAccessLevel{level, 0, 0, 0});
+    }
+    ++found->tiles;
+    found->count += tile.count;
+    found->misses += tile.misses;
+  }
+  std::sort(levels.begin(), levels.end(),
+            [](const TileAccessLevel& a, const TileAccessLevel& b) { return a.level < b.level; });
+  return levels;
+}
+
+bool TileAccessLog::WriteLocked() {
+  last_write_ = std::chrono::steady_clock::now();
+
+  const auto tiles = CountsLocked();
+
+  TileAccessLogHeader header{};
+  std::memcpy(header.magic, kTileAccessLogMagic, sizeof(kTileAccessLogMagic));
+  header.version = kTileAccessLogVersion;
+  header.tile_count = static_cast<uint32_t>(tiles.size());
+
+  // write next to the log and move it over, processes reading it see the old or the new one
+  const auto tmp_name = file_name_ + ".tmp";
+  {
+    std::ofstream file(tmp_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(TileAccessCount));
+    if (!file) {
+      LOG_WARN("Could not write the tile access log " + tmp_name);
+      return false;
+    }
+  }
+  if (std::rename(tmp_name.c_str(), file_name_.c_str())) {
+    LOG_WARN("Could not move the tile access log to " + file_name_);
+    std::remove(tmp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::vector<TileAccessCount> TileAccessLog::Read(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    return {};
+  }
+
+  TileAccessLogHeader header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, kTileAccessLogMagic, sizeof(kTileAccessLogMagic)) != 0 ||
+      header.version < 1 || header.version > kTileAccessLogVersion) {
+    LOG_WARN("Ignoring " + file_name + ", it is not a tile access log");
+    return {};
+  }
+
+  std::vector<TileAccessCount> tiles(header.tile_count);
+  if (header.version == 1) {
+    // the logs of older processes have no misses
+    for (auto& tile : tiles) {
+      file.read(reinterpret_cast<char*>(&tile), sizeof(uint64_t) * 2);
+      tile.misses = 0;
+    }
+  } else {
+    file.read(reinterpret_cast<char*>(tiles.data()), tiles.size() * sizeof(TileAccessCount));
+  }
+  if (!file) {
+    LOG_WARN("Ignoring " + file_name + ", the tile access log is truncated");
+    return {};
+  }
+  return tiles;
+}
+
+std::shared_ptr<TileAccessLog> TileAccessLog::get(const std::string& file_name,
+                                                  std::chrono::seconds write_interval) {
+  // the logs stay until the process exits so their counts are only picked up from the file once
+  static std::mutex logs_mutex;
+  static std::unordered_map<std::string, std::shared_ptr<TileAccessLog>> logs;
+  std::lock_guard<std::mutex> lock(logs_mutex);
+  auto& log = logs[file_name];
+  if (!log) {
+    log = std::make_shared<TileAccessLog>(file_name, write_interval);
+  }
+  return log;
+}
+
+} // namespace baldr
+} // namespace valhalla
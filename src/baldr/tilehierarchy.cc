@@ -13,17 +13,17 @@ const std::vector<TileLevel>& TileHierarchy::levels() {
 
       TileLevel{0, stringToRoadClass("Primary"), "highway",
                 midgard::Tiles<midgard::PointLL>{{{-180, -90}, {180, 90}},
-                                                 4,
+                                                 static_cast<float>(kTileSizes[0]),
                                                  static_cast<unsigned short>(kBinsDim)}},
 
       TileLevel{1, stringToRoadClass("Tertiary"), "arterial",
                 midgard::Tiles<midgard::PointLL>{{{-180, -90}, {180, 90}},
-                                                 1,
+                                                 static_cast<float>(kTileSizes[1]),
                                                  static_cast<unsigned short>(kBinsDim)}},
 
       TileLevel{2, stringToRoadClass("ServiceOther"), "local",
                 midgard::Tiles<midgard::PointLL>{{{-180, -90}, {180, 90}},
-                                                 .25,
+                                                 static_cast<float>(kTileSizes[2]),
                                                  static_cast<unsigned short>(kBinsDim)}},
   };
 
@@ -35,7 +35,7 @@ const TileLevel& TileHierarchy::GetTransitLevel() {
   static const TileLevel transit_level_ =
       {3, stringToRoadClass("ServiceOther"), "transit",
        midgard::Tiles<midgard::PointLL>{{{-180, -90}, {180, 90}},
-                                        .25,
+                                        static_cast<float>(kTransitTileSize),
                                         static_cast<unsigned short>(kBinsDim)}};
 
   return transit_level_;
@@ -50,6 +50,19 @@ midgard::AABB2<midgard::PointLL> TileHierarchy::GetGraphIdBoundingBox(const Grap
 // Returns the GraphId of the requested tile based on a lat,lng and a level.
 // If the level is not supported an invalid id will be returned.
 GraphId TileHierarchy::GetGraphId(const midgard::PointLL& pointll, const uint8_t level) {
+  // the levels have their tile math worked out at compile time
+  switch (level) {
+    case 0:
+      return GetGraphId<0>(pointll);
+    case 1:
+      return GetGraphId<1>(pointll);
+    case 2:
+      return GetGraphId<2>(pointll);
+    default:
+      break;
+  }
+
+  // any other level of the tilings goes through them at runtime
   GraphId id;
   if (level < levels().size()) {
     auto tile_id = levels()[level].tiles.TileId(pointll);
@@ -60,6 +73,35 @@ GraphId TileHierarchy::GetGraphId(const midgard::PointLL& pointll, const uint8_t
   return id;
 }
 
+namespace {
+
+template <uint8_t level>
+void level_graph_ids(const midgard::PointLL* points, const size_t count, GraphId* ids) {
+  for (size_t i = 0; i < count; ++i) {
+    ids[i] = TileHierarchy::GetGraphId<level>(points[i]);
+  }
+}
+
+} // namespace
+
+void TileHierarchy::GetGraphIds(const midgard::PointLL* points,
+                                const size_t count,
+                                const uint8_t level,
+                                GraphId* ids) {
+  switch (level) {
+    case 0:
+      return level_graph_ids<0>(points, count, ids);
+    case 1:
+      return level_graph_ids<1>(points, count, ids);
+    case 2:
+      return level_graph_ids<2>(points, count, ids);
+    default:
+      for (size_t i = 0; i < count; ++i) {
+        ids[i] = GetGraphId(points[i], level);
+      }
+  }
+}
+
 // Gets the hierarchy level given the road class.
 uint8_t TileHierarchy::get_level(const RoadClass roadclass) {
   if (roadclass <= levels()[0].importance) {
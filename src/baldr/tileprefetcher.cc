@@ -0,0 +1,156 @@
+#include "baldr/tileprefetcher.h"
+#include "baldr/curl_tilegetter.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/constants.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// how many tiles may wait to be warmed, the tiles of later searches are dropped beyond that
+constexpr size_t kMaxQueued = 4096;
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+TilePrefetcher::TilePrefetcher(size_t max_in_flight, std::unique_ptr<tile_getter_t>&& tile_getter)
+    : tile_getter_(std::move(tile_getter)), in_flight_(0), stop_(false) {
+  for (size_t i = 0; i < max_in_flight; ++i) {
+    threads_.emplace_back(&TilePrefetcher::Work, this);
+  }
+}
+
+TilePrefetcher::~TilePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  signal_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<TilePrefetcher> TilePrefetcher::shared(const boost::property_tree::ptree& pt) {
+  auto max_in_flight = pt.get<size_t>("tile_prefetch.max_in_flight", 0);
+  if (max_in_flight == 0) {
+    return nullptr;
+  }
+
+  // the first reader of the process to ask makes it, the others share it
+  static std::mutex lock;
+  static std::weak_ptr<TilePrefetcher> instance;
+  std::lock_guard<std::mutex> _(lock);
+  auto prefetcher = instance.lock();
+  if (!prefetcher) {
+    // remote tiles get their own curlers so the prefetching never waits on the ones of the readers
+    std::unique_ptr<tile_getter_t> tile_getter;
+    if (!pt.get<std::string>("tile_url", "").empty()) {
+      tile_getter = std::make_unique<curl_tile_getter_t>(
+          max_in_flight, pt.get<std::string>("user_agent", ""), pt.get<bool>("tile_url_gz", false),
+          GraphTile::CompressionSuffix(pt.get<std::string>("tile_url_compression", "")));
+    }
+    prefetcher = std::make_shared<TilePrefetcher>(max_in_flight, std::move(tile_getter));
+    instance = prefetcher;
+  }
+  return prefetcher;
+}
+
+std::vector<GraphId>
+TilePrefetcher::Corridor(const PointLL& origin, const PointLL& destination, float width) {
+  // the width in degrees, the degrees of longitude get shorter towards the poles
+  const double lat = std::max(std::abs(origin.lat()), std::abs(destination.lat()));
+  const double width_lat = width * kMetersPerKm / kMetersPerDegreeLat;
+  const double width_lng = width_lat / std::max(std::cos(lat * kRadPerDeg), 0.01);
+
+  std::vector<std::pair<double, GraphId>> corridor;
+  const std::vector<PointLL> line{origin, destination};
+  for (const auto& level : TileHierarchy::levels()) {
+    // widen each tile the line crosses by the width
+    std::unordered_map<int32_t, std::unordered_set<uint16_t>> tiles;
+    for (const auto& crossed : level.tiles.Intersect(line)) {
+      auto bounds = level.tiles.TileBounds(crossed.first);
+      AABB2<PointLL> widened(bounds.minx() - width_lng, bounds.miny() - width_lat,
+                             bounds.maxx() + width_lng, bounds.maxy() + width_lat);
+      auto near = level.tiles.Intersect(widened);
+      tiles.insert(near.begin(), near.end());
+    }
+
+    for (const auto& tile : tiles) {
+      auto center = level.tiles.Center(tile.first);
+      corridor.emplace_back(std::min(center.Distance(origin), center.Distance(destination)),
+                            GraphId(tile.first, level.level, 0));
+    }
+  }
+
+  std::sort(corridor.begin(), corridor.end(),
+            [](const std::pair<double, GraphId>& a, const std::pair<double, GraphId>& b) {
+              return a.first < b.first;
+            });
+  std::vector<GraphId> tile_ids;
+  tile_ids.reserve(corridor.size());
+  for (const auto& tile : corridor) {
+    tile_ids.push_back(tile.second);
+  }
+  return tile_ids;
+}
+
+void TilePrefetcher::Enqueue(const GraphId& tile_id, fetch_t&& fetch) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= kMaxQueued || missing_.count(tile_id) || !queued_.insert(tile_id).second) {
+      return;
+    }
+    queue_.emplace_back(tile_id, std::move(fetch));
+  }
+  signal_.notify_one();
+}
+
+void TilePrefetcher::Wait() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  signal_.wait(lock, [this]() { return queue_.empty() && in_flight_ == 0; });
+}
+
+void TilePrefetcher::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    signal_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (stop_) {
+      return;
+    }
+
+    auto tile = std::move(queue_.front());
+    queue_.pop_front();
+    ++in_flight_;
+    lock.unlock();
+
+    bool found = false;
+    try {
+      found = tile.second();
+    } catch (const std::exception& e) {
+      LOG_WARN("Failed to prefetch tile " + std::to_string(tile.first) + ": " + e.what());
+    }
+
+    lock.lock();
+    --in_flight_;
+    queued_.erase(tile.first);
+    if (!found) {
+      missing_.insert(tile.first);
+    }
+    // someone may be waiting for the queue to run dry
+    if (queue_.empty() && in_flight_ == 0) {
+      signal_.notify_all();
+    }
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,27 @@
+#include "baldr/tilescope.h"
+
+namespace valhalla {
+namespace baldr {
+
+TileScope::TileScope(size_t max_tiles) : max_tiles_(max_tiles) {
+  pins_.reserve(max_tiles_ + 1);
+}
+
+const graph_tile_ptr& TileScope::Pin(GraphReader& reader, uint32_t tile, slot_t& slot) {
+  auto found = pins_.find(tile);
+  if (found == pins_.end()) {
+    // tiles the reader does not have are remembered as well so they are only asked for once
+    found = pins_.emplace(tile, reader.GetGraphTile(GraphId(tile))).first;
+  }
+  slot.tile = tile;
+  slot.pin = &found->second;
+  return found->second;
+}
+
+void TileScope::Clear() {
+  slots_.fill({});
+  pins_.clear();
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,67 @@
+#include "baldr/turnclasses.h"
+#include "baldr/directededge.h"
+#include "baldr/turn.h"
+#include "midgard/util.h"
+
+#include <memory>
+
+namespace {
+
+// Whether tiles keep turn classes, see TurnClasses::set_enabled
+std::atomic<bool> classes_enabled{false};
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+TurnClass::TurnClass(const DirectedEdge* edge, const NodeInfo* node, const uint32_t idx) {
+  // the degree and the u-turn the way the OSRM car turn duration works them out
+  const uint32_t in_heading = (node->heading(idx) + 180) % 360;
+  turn_degree_ = midgard::GetTurnDegree(in_heading, node->heading(edge->localedgeidx()));
+  const bool u_turn = Turn::GetType(turn_degree_) == Turn::Type::kReverse;
+  osrm_turn_ = u_turn ? kOsrmUTurn : node->local_edge_count() > 2 ? kOsrmTurn : kNoOsrmTurn;
+
+  if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+    cost_index_ = kCrossingTurnCostIndex;
+  } else {
+    cost_index_ = static_cast<uint32_t>(edge->turntype(idx)) +
+                  (node->drive_on_right() ? 0 : kLeftSideTurnCostIndex);
+  }
+}
+
+TurnClasses::TurnClasses(const uint32_t edge_count) : edge_count_(edge_count), classes_(nullptr) {
+}
+
+TurnClasses::~TurnClasses() {
+  delete[] classes_.load(std::memory_order_relaxed);
+}
+
+const TurnClass* TurnClasses::Fill(const std::function<void(TurnClass*)>& fill) const {
+  std::unique_ptr<TurnClass[]> filled(new TurnClass[edge_count_ * kTurnClassesPerEdge]);
+  fill(filled.get());
+
+  // whoever fills the array first wins, the classes handed out before must not change
+  const TurnClass* expected = nullptr;
+  if (classes_.compare_exchange_strong(expected, filled.get(), std::memory_order_acq_rel)) {
+    return filled.release();
+  }
+  return expected;
+}
+
+size_t TurnClasses::memory_usage() const {
+  return classes_.load(std::memory_order_relaxed)
+             ? edge_count_ * kTurnClassesPerEdge * sizeof(TurnClass)
+             : 0;
+}
+
+bool TurnClasses::enabled() {
+  return classes_enabled.load(std::memory_order_relaxed);
+}
+
+void TurnClasses::set_enabled(const bool enabled) {
+  classes_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+} // namespace baldr
+} // namespace valhalla
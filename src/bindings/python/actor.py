@@ -1,5 +1,5 @@
 import json
-from typing import Union
+from typing import List, Union
 
 try:
     from .python_valhalla import _Actor
@@ -25,6 +25,8 @@ def dict_or_str(func):
 
 
 class Actor(_Actor):
+    # the actions release the GIL, an Actor is not thread safe though so give every thread its own
+    # or use batch() which runs the requests on a pool of native threads
     @dict_or_str
     def route(self, req: Union[str, dict]):
         return super().route(req)
@@ -41,6 +43,22 @@ class Actor(_Actor):
     def matrix(self, req: Union[str, dict]):
         return super().matrix(req)
 
+    def route_batch(self, req: Union[str, dict]):
+        # the response is newline delimited json, for dict input we return a list with one dict per pair
+        if isinstance(req, dict):
+            return [json.loads(line) for line in super().route_batch(json.dumps(req)).splitlines()]
+        elif not isinstance(req, str):
+            raise ValueError("Request must be either of type str or dict")
+        return super().route_batch(req)
+
+    def isochrone_batch(self, req: Union[str, dict]):
+        # the response is newline delimited json, for dict input we return a list with one dict per location
+        if isinstance(req, dict):
+            return [json.loads(line) for line in super().isochrone_batch(json.dumps(req)).splitlines()]
+        elif not isinstance(req, str):
+            raise ValueError("Request must be either of type str or dict")
+        return super().isochrone_batch(req)
+
     @dict_or_str
     def trace_route(self, req: Union[str, dict]):
         return super().traceRoute(req)
@@ -49,6 +67,22 @@ class Actor(_Actor):
     def trace_attributes(self, req: Union[str, dict]):
         return super().traceAttributes(req)
 
+    def matrix_arrays(self, req: Union[str, dict]):
+        # the times and distances come as numpy arrays of sources by targets instead of json
+        if isinstance(req, dict):
+            req = json.dumps(req)
+        elif not isinstance(req, str):
+            raise ValueError("Request must be either of type str or dict")
+        return super().matrix_arrays(req)
+
+    def trace_arrays(self, req: Union[str, dict]):
+        # the matched edges and the shape come as numpy arrays instead of json
+        if isinstance(req, dict):
+            req = json.dumps(req)
+        elif not isinstance(req, str):
+            raise ValueError("Request must be either of type str or dict")
+        return super().trace_arrays(req)
+
     @dict_or_str
     def height(self, req: Union[str, dict]):
         return super().height(req)
@@ -68,3 +102,15 @@ class Actor(_Actor):
     @dict_or_str
     def status(self, req: Union[str, dict] = ""):
         return super().status(req)
+
+    def batch(self, action: str, reqs: List[Union[str, dict]], threads: int = 0):
+        # dict requests get dict responses, the rest stays a string
+        for req in reqs:
+            if not isinstance(req, (str, dict)):
+                raise ValueError("Requests must be either of type str or dict")
+        responses = super().batch(
+            action, [json.dumps(req) if isinstance(req, dict) else req for req in reqs], threads
+        )
+        return [
+            json.loads(resp) if isinstance(req, dict) else resp for req, resp in zip(reqs, responses)
+        ]
@@ -1,16 +1,27 @@
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 #include "baldr/rapidjson_utils.h"
 #include <boost/make_shared.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "baldr/rapidjson_utils.h"
+#include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
+#include "proto_conversions.h"
+#include "thor/matrix_common.h"
 #include "tyr/actor.h"
+#include "worker.h"
 
 namespace vt = valhalla::tyr;
 namespace {
@@ -34,50 +45,214 @@ const boost::property_tree::ptree configure(const std::string& config) {
 
   return pt;
 }
+
+// a matched edge of a trace, one row of the structured array trace_arrays returns
+struct trace_edge_t {
+  uint32_t leg;
+  uint64_t id;
+  uint64_t way_id;
+  float length_km;
+  float speed;
+  uint8_t road_class;
+  uint32_t begin_shape_index;
+  uint32_t end_shape_index;
+};
+
+/**
+ * Runs a json request for its results in the Api rather than as json. The request is answered as
+ * pbf, which leaves the selected parts and the options in the Api, and the bytes of the pbf are
+ * dropped since the results are read right out of the Api.
+ */
+std::unique_ptr<valhalla::Api> act(vt::actor_t& actor,
+                                   const std::string& request,
+                                   valhalla::Options::Action action,
+                                   const std::function<void(valhalla::PbfFieldSelector&)>& select) {
+  std::unique_ptr<valhalla::Api> api(new valhalla::Api);
+  valhalla::ParseApi(request, action, *api);
+  auto& options = *api->mutable_options();
+  options.set_format(valhalla::Options::pbf);
+  options.clear_pbf_field_selector();
+  options.mutable_pbf_field_selector()->set_options(true);
+  select(*options.mutable_pbf_field_selector());
+  actor.act(*api);
+  return api;
+}
+
 } // namespace
 
 namespace py = pybind11;
 
+PYBIND11_NUMPY_DTYPE(trace_edge_t,
+                     leg,
+                     id,
+                     way_id,
+                     length_km,
+                     speed,
+                     road_class,
+                     begin_shape_index,
+                     end_shape_index);
+
+// the actions run without the gil so that python threads, each with its own actor, run in parallel
+using release_gil = py::call_guard<py::gil_scoped_release>;
+
 PYBIND11_MODULE(python_valhalla, m) {
   py::class_<vt::actor_t>(m, "_Actor", "Valhalla Actor class")
       .def(py::init<>([](std::string config) { return vt::actor_t(configure(config), true); }))
       .def(
           "route", [](vt::actor_t& self, std::string& req) { return self.route(req); },
-          "Calculates a route.")
+          "Calculates a route.", release_gil())
       .def(
           "locate", [](vt::actor_t& self, std::string& req) { return self.locate(req); },
-          "Provides information about nodes and edges.")
+          "Provides information about nodes and edges.", release_gil())
       .def(
           "optimized_route",
           [](vt::actor_t& self, std::string& req) { return self.optimized_route(req); },
-          "Optimizes the order of a set of waypoints by time.")
+          "Optimizes the order of a set of waypoints by time.", release_gil())
       .def(
           "matrix", [](vt::actor_t& self, std::string& req) { return self.matrix(req); },
-          "Computes the time and distance between a set of locations and returns them as a matrix table.")
+          "Computes the time and distance between a set of locations and returns them as a matrix table.",
+          release_gil())
+      .def(
+          "matrix_arrays",
+          [](vt::actor_t& self, const std::string& req) {
+            std::unique_ptr<valhalla::Api> api;
+            {
+              py::gil_scoped_release release;
+              api = act(self, req, valhalla::Options::sources_to_targets,
+                        [](valhalla::PbfFieldSelector& select) { select.set_matrix(true); });
+            }
+            // the arrays are views of the matrix, which lives as long as the last of them
+            auto* matrix = api->mutable_matrix();
+            const auto rows = static_cast<py::ssize_t>(api->options().sources_size());
+            const auto columns = static_cast<py::ssize_t>(api->options().targets_size());
+            if (matrix->times_size() != rows * columns ||
+                matrix->distances_size() != rows * columns) {
+              throw std::runtime_error("The matrix does not have a cell for every pair");
+            }
+            for (int i = 0; i < matrix->times_size(); ++i) {
+              if (matrix->times(i) == valhalla::thor::kMaxCost) {
+                matrix->set_times(i, std::numeric_limits<float>::infinity());
+                matrix->set_distances(i, std::numeric_limits<uint32_t>::max());
+              }
+            }
+            py::capsule owner(api.release(),
+                              [](void* api) { delete static_cast<valhalla::Api*>(api); });
+            py::dict arrays;
+            arrays["times"] =
+                py::array_t<float>({rows, columns}, matrix->mutable_times()->mutable_data(), owner);
+            arrays["distances"] = py::array_t<uint32_t>({rows, columns},
+                                                        matrix->mutable_distances()->mutable_data(),
+                                                        owner);
+            return arrays;
+          },
+          "Computes the matrix between a set of locations and returns the times in seconds and the distances in meters as numpy arrays of sources by targets, without going through json. Unreachable cells have an infinite time and the largest uint32 distance.")
+      .def(
+          "route_batch", [](vt::actor_t& self, std::string& req) { return self.route_batch(req); },
+          "Computes the time and distance of a route from each source to the target at the same index and returns newline delimited json.",
+          release_gil())
       .def(
           "isochrone", [](vt::actor_t& self, std::string& req) { return self.isochrone(req); },
-          "Calculates isochrones and isodistances.")
+          "Calculates isochrones and isodistances.", release_gil())
+      .def(
+          "isochrone_batch",
+          [](vt::actor_t& self, std::string& req) { return self.isochrone_batch(req); },
+          "Calculates the isochrones of many locations and the area and population within them and returns newline delimited json.",
+          release_gil())
       .def(
           "trace_route", [](vt::actor_t& self, std::string& req) { return self.trace_route(req); },
-          "Map-matching for a set of input locations, e.g. from a GPS.")
+          "Map-matching for a set of input locations, e.g. from a GPS.", release_gil())
       .def(
           "trace_attributes",
           [](vt::actor_t& self, std::string& req) { return self.trace_attributes(req); },
-          "Returns detailed attribution along each portion of a route calculated from a set of input locations, e.g. from a GPS trace.")
+          "Returns detailed attribution along each portion of a route calculated from a set of input locations, e.g. from a GPS trace.",
+          release_gil())
+      .def(
+          "trace_arrays",
+          [](vt::actor_t& self, const std::string& req) {
+            std::unique_ptr<valhalla::Api> api;
+            {
+              py::gil_scoped_release release;
+              api = act(self, req, valhalla::Options::trace_attributes,
+                        [](valhalla::PbfFieldSelector& select) { select.set_trip(true); });
+            }
+            // the edges and shapes of all the legs, the shape indices count from the first leg on
+            size_t edge_count = 0, point_count = 0;
+            std::vector<std::vector<valhalla::midgard::PointLL>> shapes;
+            for (const auto& route : api->trip().routes()) {
+              for (const auto& leg : route.legs()) {
+                shapes.push_back(valhalla::midgard::decode<std::vector<valhalla::midgard::PointLL>>(
+                    leg.shape()));
+                point_count += shapes.back().size();
+                edge_count += std::count_if(leg.node().begin(), leg.node().end(),
+                                            [](const valhalla::TripLeg::Node& node) {
+                                              return node.has_edge();
+                                            });
+              }
+            }
+            py::array_t<trace_edge_t> edges(static_cast<py::ssize_t>(edge_count));
+            py::array_t<double> shape({static_cast<py::ssize_t>(point_count), py::ssize_t(2)});
+            auto* edge = edges.mutable_data();
+            auto* point = shape.mutable_data();
+            uint32_t leg_index = 0, offset = 0;
+            for (const auto& route : api->trip().routes()) {
+              for (const auto& leg : route.legs()) {
+                for (const auto& node : leg.node()) {
+                  if (!node.has_edge()) {
+                    continue;
+                  }
+                  const auto& e = node.edge();
+                  *edge++ = trace_edge_t{leg_index,
+                                         e.id(),
+                                         e.way_id(),
+                                         e.length_km(),
+                                         e.speed(),
+                                         static_cast<uint8_t>(e.road_class()),
+                                         offset + e.begin_shape_index(),
+                                         offset + e.end_shape_index()};
+                }
+                for (const auto& ll : shapes[leg_index]) {
+                  *point++ = ll.lat();
+                  *point++ = ll.lng();
+                }
+                offset += shapes[leg_index++].size();
+              }
+            }
+            py::dict arrays;
+            arrays["edges"] = edges;
+            arrays["shape"] = shape;
+            return arrays;
+          },
+          "Matches a trace and returns the matched edges as a numpy structured array with the leg, id, way_id, length_km, speed, road_class, begin_shape_index and end_shape_index of each, and the shape of all the legs as a numpy array of lat, lon rows, without going through json.")
       .def(
           "height", [](vt::actor_t& self, std::string& req) { return self.height(req); },
-          "Provides elevation data for a set of input geometries.")
+          "Provides elevation data for a set of input geometries.", release_gil())
       .def(
           "transit_available",
           [](vt::actor_t& self, std::string& req) { return self.transit_available(req); },
-          "Lookup if transit stops are available in a defined radius around a set of input locations.")
+          "Lookup if transit stops are available in a defined radius around a set of input locations.",
+          release_gil())
       .def(
           "expansion", [](vt::actor_t& self, std::string& req) { return self.expansion(req); },
-          "Returns all road segments which were touched by the routing algorithm during the graph traversal.")
+          "Returns all road segments which were touched by the routing algorithm during the graph traversal.",
+          release_gil())
       .def(
           "centroid", [](vt::actor_t& self, std::string& req) { return self.centroid(req); },
-          "Returns routes from all the input locations to the minimum cost meeting point of those paths.")
+          "Returns routes from all the input locations to the minimum cost meeting point of those paths.",
+          release_gil())
       .def(
           "status", [](vt::actor_t& self, std::string& req) { return self.status(req); },
-          "Returns nothing or optionally details about Valhalla's configuration.");
+          "Returns nothing or optionally details about Valhalla's configuration.", release_gil())
+      .def(
+          "batch",
+          [](vt::actor_t& self, const std::string& action, const std::vector<std::string>& reqs,
+             size_t threads) {
+            valhalla::Options::Action parsed;
+            if (!valhalla::Options_Action_Enum_Parse(action, &parsed)) {
+              throw std::invalid_argument("Unknown action: " + action);
+            }
+            return self.batch(parsed, reqs, threads);
+          },
+          py::arg("action"), py::arg("requests"), py::arg("threads") = 0,
+          "Runs the same action for a list of requests on a pool of native threads and returns the responses in the order of the requests.",
+          release_gil());
 }
@@ -10,6 +10,25 @@ using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 using namespace valhalla::skadi;
 
+namespace {
+
+// puts the resampled shape back into the request
+void set_shape(Options& options, const std::vector<PointLL>& shape) {
+  options.clear_shape();
+  for (const auto& p : shape) {
+    from_ll(options.mutable_shape()->Add(), p);
+  }
+  // re-encode it for display if they sent it encoded
+  if (options.has_encoded_polyline_case()) {
+    // Default to 6 digit precision unless polyline5 is specified
+    // NOTE: geojson is NOT support yet for height action
+    int precision = options.shape_format() == polyline5 ? 1e5 : 1e6;
+    options.set_encoded_polyline(midgard::encode(shape, precision));
+  }
+}
+
+} // namespace
+
 namespace valhalla {
 namespace loki {
 
@@ -37,18 +56,7 @@ std::vector<PointLL> loki_worker_t::init_height(Api& request) {
       auto last = shape.back();
       shape = midgard::resample_spherical_polyline(shape, options.resample_distance());
       shape.emplace_back(std::move(last));
-      // put it back
-      options.clear_shape();
-      for (const auto& p : shape) {
-        from_ll(options.mutable_shape()->Add(), p);
-      }
-      // re-encode it for display if they sent it encoded
-      if (options.has_encoded_polyline_case()) {
-        // Default to 6 digit precision unless polyline5 is specified
-        // NOTE: geojson is NOT support yet for height action
-        int precision = options.shape_format() == polyline5 ? 1e5 : 1e6;
-        options.set_encoded_polyline(midgard::encode(shape, precision));
-      }
+      set_shape(options, shape);
       resampled = true;
     }
   }
@@ -73,9 +81,33 @@ std::string loki_worker_t::height(Api& request) {
   // time this whole method and save that statistic
   auto _ = measure_scope_time(request);
 
-  auto shape = init_height(request);
-  // get the elevation of each posting
-  std::vector<double> heights = sample.get_all(shape);
+  // shapes that were asked for before get their profile from the cache, the key has to be made
+  // before the shape is resampled
+  std::string key;
+  const HeightCache::Profile* cached = nullptr;
+  if (height_cache) {
+    key = HeightCache::make_key(request.options());
+    cached = height_cache->Find(key);
+  }
+
+  HeightCache::Profile profile;
+  if (cached) {
+    profile = *cached;
+    if (profile.resampled) {
+      set_shape(*request.mutable_options(), profile.shape);
+    }
+  } else {
+    profile.resampled =
+        request.options().has_resample_distance_case() && request.options().shape_size() > 1;
+    profile.shape = init_height(request);
+    // get the elevation of each posting
+    profile.heights = sample.get_all(profile.shape);
+    if (height_cache) {
+      height_cache->Insert(std::move(key), profile);
+    }
+  }
+  const auto& shape = profile.shape;
+  const auto& heights = profile.heights;
 
   // get the distances between the postings if desired
   std::vector<double> ranges;
@@ -0,0 +1,69 @@
+#include "loki/height_cache.h"
+
+namespace {
+
+// append the raw bytes of a value to the key
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+HeightCache::HeightCache(const boost::property_tree::ptree& config)
+    : max_postings_(config.get<size_t>("size", 1000000)) {
+}
+
+std::string HeightCache::make_key(const Options& options) {
+  // the fixed size parts go first so the variable shape can't run into them
+  std::string key;
+  append(key, options.has_resample_distance_case() ? options.resample_distance() : -1.0);
+  if (options.has_encoded_polyline_case()) {
+    key.push_back('e');
+    append(key, options.shape_format());
+    key.append(options.encoded_polyline());
+  } else {
+    key.reserve(key.size() + 1 + options.shape_size() * 2 * sizeof(double));
+    key.push_back('s');
+    for (const auto& location : options.shape()) {
+      append(key, location.ll().lat());
+      append(key, location.ll().lng());
+    }
+  }
+  return key;
+}
+
+const HeightCache::Profile* HeightCache::Find(const std::string& key) {
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return &found->second->profile;
+}
+
+void HeightCache::Insert(std::string key, Profile profile) {
+  const auto postings = profile.heights.size();
+  if (postings > max_postings_ || index_.count(key)) {
+    return;
+  }
+
+  // make room by dropping the least recently used profiles
+  while (!entries_.empty() && postings_ + postings > max_postings_) {
+    postings_ -= entries_.back().profile.heights.size();
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+    ++stats_.evictions;
+  }
+
+  entries_.push_front({std::move(key), std::move(profile)});
+  index_.emplace(entries_.front().key, entries_.begin());
+  postings_ += postings;
+}
+
+} // namespace loki
+} // namespace valhalla
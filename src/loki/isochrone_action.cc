@@ -76,7 +76,7 @@ void loki_worker_t::isochrones(Api& request) {
   try {
     // correlate the various locations to the underlying graph
     auto locations = PathLocation::fromPBF(options.locations());
-    const auto projections = loki::Search(locations, *reader, costing);
+    const auto projections = search(locations, request);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& projection = projections.at(locations[i]);
       PathLocation::toPBF(projection, options.mutable_locations(i), *reader);
@@ -84,5 +84,33 @@ void loki_worker_t::isochrones(Api& request) {
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 }
 
+void loki_worker_t::isochrone_batch(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  // every location is the origin of an isochrone of its own so they may be as far apart as they
+  // like, only their count is limited
+  init_isochrones(request);
+  auto& options = *request.mutable_options();
+  if (options.locations_size() > static_cast<int>(max_batch_isochrones)) {
+    throw valhalla_exception_t{150, std::to_string(max_batch_isochrones)};
+  };
+
+  // correlate all of the locations in one go
+  auto locations = PathLocation::fromPBF(options.locations());
+  std::unordered_map<baldr::Location, PathLocation> projections;
+  try {
+    projections = search(locations, request);
+  } catch (const std::exception&) { throw valhalla_exception_t{171}; }
+
+  // a location which didn't snap only fails its own isochrone, thor reports it as unreached
+  for (size_t i = 0; i < locations.size(); ++i) {
+    auto projection = projections.find(locations[i]);
+    if (projection != projections.cend()) {
+      PathLocation::toPBF(projection->second, options.mutable_locations(i), *reader);
+    }
+  }
+}
+
 } // namespace loki
 } // namespace valhalla
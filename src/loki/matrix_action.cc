@@ -1,6 +1,7 @@
 #include "loki/search.h"
 #include "loki/worker.h"
 
+#include <algorithm>
 #include <unordered_map>
 
 #include "baldr/datetime.h"
@@ -123,8 +124,10 @@ void loki_worker_t::matrix(Api& request) {
 
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
+  std::unordered_map<uint32_t, size_t> component_counts;
+  bool components = connectivity_map && connectivity_map->has_components();
   try {
-    const auto searched = loki::Search(sources_targets, *reader, costing);
+    const auto searched = search(sources_targets, request);
     for (size_t i = 0; i < sources_targets.size(); ++i) {
       const auto& l = sources_targets[i];
       const auto& projection = searched.at(l);
@@ -148,6 +151,13 @@ void loki_worker_t::matrix(Api& request) {
           ++itr->second;
         }
       }
+      if (components) {
+        auto location_components = connectivity_map->get_components(projection, *reader);
+        components = !location_components.empty();
+        for (auto component : location_components) {
+          ++component_counts[component];
+        }
+      }
     }
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 
@@ -162,6 +172,11 @@ void loki_worker_t::matrix(Api& request) {
       break;
     }
   }
+  // and is there a component every location has an edge in
+  if (connected && components) {
+    connected = std::any_of(component_counts.begin(), component_counts.end(),
+                            [&](const auto& c) { return c.second == sources_targets.size(); });
+  }
   if (!connected) {
     throw valhalla_exception_t{170};
   };
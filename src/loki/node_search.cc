@@ -4,6 +4,7 @@
 #include "midgard/pointll.h"
 #include "midgard/tiles.h"
 #include <cmath>
+#include <functional>
 
 namespace vm = valhalla::midgard;
 namespace vb = valhalla::baldr;
@@ -359,15 +360,51 @@ private:
   std::vector<vb::GraphId> m_backfill_nodes;
 };
 
+using tile_bins_t = std::unordered_map<int32_t, std::unordered_set<uint16_t>>::value_type;
+using tile_search_t = std::function<
+    void(const tile_bins_t& entry, vb::GraphReader& reader, std::vector<vb::GraphId>& found)>;
+
+// run the search of each tile the box intersects, on the pool when there is one, and gather what
+// they found. the tiles are independent so each task only needs a reader of its own.
+std::vector<vb::GraphId>
+search_tiles(const std::unordered_map<int32_t, std::unordered_set<uint16_t>>& intersections,
+             vb::GraphReader& reader,
+             valhalla::thread_pool_t* pool,
+             const tile_search_t& search) {
+  std::vector<vb::GraphId> found;
+  if (pool == nullptr || intersections.size() < 2) {
+    for (const auto& entry : intersections) {
+      search(entry, reader, found);
+    }
+    return found;
+  }
+
+  std::vector<const tile_bins_t*> entries;
+  entries.reserve(intersections.size());
+  for (const auto& entry : intersections) {
+    entries.push_back(&entry);
+  }
+  std::vector<std::vector<vb::GraphId>> slot_found(pool->size() + 1);
+  pool->run(
+      entries.size(),
+      [&](size_t index, size_t slot, vb::GraphReader& slot_reader) {
+        search(*entries[index], slot_reader, slot_found[slot]);
+      },
+      reader);
+  for (const auto& part : slot_found) {
+    found.insert(found.end(), part.begin(), part.end());
+  }
+  return found;
+}
+
 } // anonymous namespace
 
 namespace valhalla {
 namespace loki {
 
 std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
-                                          baldr::GraphReader& reader) {
-  std::vector<vb::GraphId> nodes;
-
+                                          baldr::GraphReader& reader,
+                                          thread_pool_t* pool) {
   const auto& tiles = vb::TileHierarchy::levels().back().tiles;
   const uint8_t bin_level = vb::TileHierarchy::levels().back().level;
 
@@ -377,39 +414,55 @@ std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
   auto expanded_bboxes = expand_bbox_across_boundaries(bbox, tiles);
   auto intersections = merge_intersections(expanded_bboxes, tiles);
 
-  // we cache the last tile lookup, since the nodes and tweeners arrays are in
-  // order then this guarantees the smallest number of times we have to look up
-  // a new tile from the reader.
-  tile_cache cache(reader);
-
-  // wrap the nodes in a filter so that only nodes contained within the bounding
-  // box are appended to the vector. there might be duplicates, so we have to
-  // sort and uniq the vector later.
-  filtered_nodes filtered(bbox, nodes);
-
-  // a wrapper process which aims to order the lookups against tiles into a
-  // number of sequential passes through the set of tiles.
-  node_collector collector(cache, filtered);
+  auto search = [&](const tile_bins_t& entry, vb::GraphReader& tile_reader,
+                    std::vector<vb::GraphId>& nodes) {
+    // we cache the last tile lookup, since the nodes and tweeners arrays are in
+    // order then this guarantees the smallest number of times we have to look up
+    // a new tile from the reader.
+    tile_cache cache(tile_reader);
 
-  for (const auto& entry : intersections) {
-    vb::GraphId tile_id(entry.first, bin_level, 0);
     // tile might not exist - the Tiles::Intersect routine returns all tiles
     // which might intersect, regardless of whether any of them exist.
+    vb::GraphId tile_id(entry.first, bin_level, 0);
     auto& tile = cache(tile_id);
     if (!tile.exists()) {
-      continue;
+      return;
     }
 
+    // wrap the nodes in a filter so that only nodes contained within the bounding
+    // box are appended to the vector. there might be duplicates, so we have to
+    // sort and uniq the vector later.
+    filtered_nodes filtered(bbox, nodes);
+
+    // a tile the box covers has all of its nodes in it, they are read in order
+    // rather than found through the edges of its bins. nodes of other tiles
+    // in the box are found through the bins of their own tiles.
+    const auto tile_box = tiles.TileBounds(entry.first);
+    if (bbox.Contains(tile_box.minpt()) && bbox.Contains(tile_box.maxpt())) {
+      const auto node_count = tile.tile()->header()->nodecount();
+      for (uint32_t i = 0; i < node_count; ++i) {
+        const auto node_id = tile_id + uint64_t(i);
+        if (tile.node(node_id).edge_count() > 0) {
+          filtered.push_back(node_id, tile.node_ll(node_id));
+        }
+      }
+      return;
+    }
+
+    // a wrapper process which aims to order the lookups against tiles into a
+    // number of sequential passes through the set of tiles.
+    node_collector collector(cache, filtered);
     for (auto bin_id : entry.second) {
       for (auto edge_id : tile.tile()->GetBin(bin_id)) {
         collector.add_edge(edge_id);
       }
     }
-  }
 
-  // finish the collector by going over any stored edges or nodes which weren't
-  // accessible in the current tile at the time they were found.
-  collector.finish();
+    // finish the collector by going over any stored edges or nodes which weren't
+    // accessible in the current tile at the time they were found.
+    collector.finish();
+  };
+  auto nodes = search_tiles(intersections, reader, pool, search);
 
   // erase the duplicates
   std::sort(nodes.begin(), nodes.end());
@@ -423,7 +476,8 @@ std::vector<baldr::GraphId> nodes_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
 }
 
 std::vector<baldr::GraphId> edges_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
-                                          baldr::GraphReader& reader) {
+                                          baldr::GraphReader& reader,
+                                          thread_pool_t* pool) {
 
   auto tiles = vb::TileHierarchy::levels().back().tiles;
   const uint8_t bin_level = vb::TileHierarchy::levels().back().level;
@@ -434,39 +488,29 @@ std::vector<baldr::GraphId> edges_in_bbox(const vm::AABB2<vm::PointLL>& bbox,
   auto expanded_bboxes = expand_bbox_across_boundaries(bbox, tiles);
   auto intersections = merge_intersections(expanded_bboxes, tiles);
 
-  // we cache the last tile lookup, since the nodes and tweeners arrays are in
-  // order then this guarantees the smallest number of times we have to look up
-  // a new tile from the reader.
-  tile_cache cache(reader);
-
-  std::vector<vb::GraphId> edge_ids;
-  for (const auto& entry : intersections) {
-    vb::GraphId tile_id(entry.first, bin_level, 0);
+  auto search = [&](const tile_bins_t& entry, vb::GraphReader& tile_reader,
+                    std::vector<vb::GraphId>& edge_ids) {
     // tile might not exist - the Tiles::Intersect routine returns all tiles
     // which might intersect, regardless of whether any of them exist.
-    auto& tile = cache(tile_id);
-    if (!tile.exists()) {
-      continue;
+    auto tile = tile_reader.GetGraphTile(vb::GraphId(entry.first, bin_level, 0));
+    if (tile == nullptr) {
+      return;
     }
 
     for (auto bin_id : entry.second) {
-      for (auto edge_id : tile.tile()->GetBin(bin_id)) {
+      for (auto edge_id : tile->GetBin(bin_id)) {
         edge_ids.push_back(edge_id);
       }
     }
-  }
+  };
+  auto edge_ids = search_tiles(intersections, reader, pool, search);
 
   // erase the duplicates by sorting
   {
-    std::sort(edge_ids.begin(), edge_ids.end(), [](const auto a, const auto b) {
-      // This ordering means when we iterate over this list, it'll be
-      // cache friendly, in-memory-order
-      if (a.level() == b.level())
-        return a.tileid() < b.tileid();
-      if (a.tileid() == b.tileid())
-        return a.id() < b.id();
-      return a.level() < b.level();
-    });
+    // This ordering means when we iterate over this list, it'll be
+    // cache friendly, in-memory-order. the ids within a tile are ordered too
+    // so that duplicates end up next to each other, whichever tile found them.
+    std::sort(edge_ids.begin(), edge_ids.end(), sort_by_tile());
     auto uniq_end = std::unique(edge_ids.begin(), edge_ids.end());
     edge_ids.erase(uniq_end, edge_ids.end());
   }
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <thread>
+
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/register/point.hpp>
 #include <boost/geometry/geometries/register/ring.hpp>
@@ -29,6 +32,17 @@ using namespace vb::json;
 using bins_collector =
     std::unordered_map<uint32_t, std::unordered_map<unsigned short, std::vector<size_t>>>;
 
+// an edge of an intersected bin along with the rings intersecting its bin
+struct candidate_t {
+  vb::GraphId edge_id;
+  vb::GraphId opp_id; // only set if it was needed to tell whether the edge is allowed
+  graph_tile_ptr tile;
+  const std::vector<size_t>* rings;
+};
+
+// the intersections are only spread over threads if each thread gets at least this many edges
+constexpr size_t kMinCandidatesPerThread = 512;
+
 static const auto Haversine = [] {
   return bg::strategy::distance::haversine<float>(vm::kRadEarthMeters);
 };
@@ -98,7 +112,8 @@ std::unordered_set<vb::GraphId>
 edges_in_rings(const google::protobuf::RepeatedPtrField<valhalla::Ring>& rings_pbf,
                baldr::GraphReader& reader,
                const std::shared_ptr<sif::DynamicCost>& costing,
-               float max_length) {
+               float max_length,
+               size_t threads) {
   // protect for bogus input
   if (rings_pbf.empty() || rings_pbf.Get(0).coords().empty() ||
       !rings_pbf.Get(0).coords()[0].has_lat_case() || !rings_pbf.Get(0).coords()[0].has_lng_case()) {
@@ -123,7 +138,6 @@ edges_in_rings(const google::protobuf::RepeatedPtrField<valhalla::Ring>& rings_p
 
   // keep track which tile's bins intersect which rings
   bins_collector bins_intersected;
-  std::unordered_set<vb::GraphId> avoid_edge_ids;
 
   // first pull out all *unique* bins which intersect the rings
   for (size_t ring_idx = 0; ring_idx < rings_bg.size(); ring_idx++) {
@@ -135,22 +149,24 @@ edges_in_rings(const google::protobuf::RepeatedPtrField<valhalla::Ring>& rings_p
       }
     }
   }
+
+  // the reader isn't thread safe so the tiles and the access of the binned edges are sorted out
+  // first, only the intersections of the edge shapes with the rings run in parallel
+  std::unordered_map<vb::GraphId, graph_tile_ptr> edge_tiles;
+  std::vector<candidate_t> candidates;
   for (const auto& intersection : bins_intersected) {
-    auto tile = reader.GetGraphTile({intersection.first, bin_level, 0});
-    if (!tile) {
+    auto bin_tile = reader.GetGraphTile({intersection.first, bin_level, 0});
+    if (!bin_tile) {
       continue;
     }
     for (const auto& bin : intersection.second) {
-      // tile will be mutated most likely in the loop
-      reader.GetGraphTile({intersection.first, bin_level, 0}, tile);
-      for (const auto& edge_id : tile->GetBin(bin.first)) {
-        if (avoid_edge_ids.count(edge_id) != 0) {
-          continue;
+      for (const auto& edge_id : bin_tile->GetBin(bin.first)) {
+        auto found = edge_tiles.find(edge_id.Tile_Base());
+        if (found == edge_tiles.end()) {
+          found = edge_tiles.emplace(edge_id.Tile_Base(), reader.GetGraphTile(edge_id)).first;
         }
-        // TODO: optimize the tile switching by enqueuing edges
-        // from other levels & tiles and process them after this big loop
-        if (edge_id.Tile_Base() != tile->header()->graphid().Tile_Base() &&
-            !reader.GetGraphTile(edge_id, tile)) {
+        auto tile = found->second;
+        if (!tile) {
           continue;
         }
         const auto edge = tile->directededge(edge_id);
@@ -164,25 +180,54 @@ edges_in_rings(const google::protobuf::RepeatedPtrField<valhalla::Ring>& rings_p
              !costing->Allowed(opp_edge, opp_tile))) {
           continue;
         }
+        candidates.push_back({edge_id, opp_id, tile, &bin.second});
+      }
+    }
+  }
 
-        // TODO: some logic to set percent_along for origin/destination edges
-        // careful: polygon can intersect a single edge multiple times
-        auto edge_info = tile->edgeinfo(edge);
-        bool intersects = false;
-        for (const auto& ring_loc : bin.second) {
-          intersects = bg::intersects(rings_bg[ring_loc],
-                                      line_bg_t(edge_info.shape().begin(), edge_info.shape().end()));
-          if (intersects) {
-            break;
-          }
-        }
-        if (intersects) {
-          avoid_edge_ids.emplace(edge_id);
-          avoid_edge_ids.emplace(
-              opp_id.Is_Valid() ? opp_id : reader.GetOpposingEdgeId(edge_id, opp_edge, opp_tile));
+  // TODO: some logic to set percent_along for origin/destination edges
+  // careful: polygon can intersect a single edge multiple times
+  std::vector<char> intersects(candidates.size(), false);
+  const auto intersect = [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto& candidate = candidates[i];
+      const auto shape =
+          candidate.tile->edgeinfo(candidate.tile->directededge(candidate.edge_id)).shape();
+      const line_bg_t line(shape.begin(), shape.end());
+      for (const auto& ring_loc : *candidate.rings) {
+        if (bg::intersects(rings_bg[ring_loc], line)) {
+          intersects[i] = true;
+          break;
         }
       }
     }
+  };
+  threads = std::max<size_t>(std::min(threads, candidates.size() / kMinCandidatesPerThread), 1);
+  if (threads == 1) {
+    intersect(0, candidates.size());
+  } else {
+    // the candidates are in the order of their bins so each thread gets the edges of a few tiles
+    std::vector<std::thread> pool;
+    const size_t chunk = (candidates.size() + threads - 1) / threads;
+    for (size_t begin = 0; begin < candidates.size(); begin += chunk) {
+      pool.emplace_back(intersect, begin, std::min(begin + chunk, candidates.size()));
+    }
+    for (auto& thread : pool) {
+      thread.join();
+    }
+  }
+
+  std::unordered_set<vb::GraphId> avoid_edge_ids;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const auto& candidate = candidates[i];
+    if (!intersects[i] || !avoid_edge_ids.emplace(candidate.edge_id).second) {
+      continue;
+    }
+    auto opp_tile = candidate.tile;
+    const baldr::DirectedEdge* opp_edge = nullptr;
+    avoid_edge_ids.emplace(candidate.opp_id.Is_Valid()
+                               ? candidate.opp_id
+                               : reader.GetOpposingEdgeId(candidate.edge_id, opp_edge, opp_tile));
   }
 
 // log the GeoJSON of avoided edges
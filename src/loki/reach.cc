@@ -1,5 +1,7 @@
 #include "loki/reach.h"
 
+#include <algorithm>
+
 using namespace valhalla::baldr;
 
 namespace valhalla {
@@ -53,6 +55,10 @@ directed_reach Reach::operator()(const DirectedEdge* edge,
     return reach;
   max_reach_ = max_reach;
 
+  // the tiles may already know
+  if (use_reach_index_ && indexed(edge_id, max_reach, reader, costing, direction, reach))
+    return reach;
+
   // these are used below to get conservative estimates of forward and reverse reach
   constexpr uint16_t forward_disallow_mask = sif::kDisallowEndRestriction |
                                              sif::kDisallowSimpleRestriction | sif::kDisallowClosure |
@@ -155,6 +161,31 @@ directed_reach Reach::operator()(const DirectedEdge* edge,
   return reach;
 }
 
+bool Reach::indexed(const GraphId edge_id,
+                    uint32_t max_reach,
+                    GraphReader& reader,
+                    const std::shared_ptr<sif::DynamicCost>& costing,
+                    uint8_t direction,
+                    directed_reach& reach) {
+  // the section has to go at least as far as we need to look
+  graph_tile_ptr tile = reader.GetGraphTile(edge_id);
+  if (!tile)
+    return false;
+  const auto& index = tile->GetReachIndex();
+  if (index.max_reach() < max_reach)
+    return false;
+  int column = index.column(costing->access_mode());
+  if (column < 0)
+    return false;
+
+  // below the max reach of the section the stored reach is exact so capping it gives the same
+  // answer an expansion up to max_reach would have
+  auto stored = index.reach(edge_id.id(), column);
+  reach.outbound = direction & kOutbound ? std::min<uint32_t>(stored.outbound, max_reach) : 0;
+  reach.inbound = direction & kInbound ? std::min<uint32_t>(stored.inbound, max_reach) : 0;
+  return true;
+}
+
 directed_reach Reach::exact(const valhalla::baldr::DirectedEdge* edge,
                             const GraphId edge_id,
                             uint32_t max_reach,
@@ -1,6 +1,9 @@
 #include "loki/search.h"
 #include "loki/worker.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "baldr/datetime.h"
 #include "baldr/rapidjson_utils.h"
 #include "baldr/tilehierarchy.h"
@@ -100,9 +103,13 @@ void loki_worker_t::route(Api& request) {
 
   // correlate the various locations to the underlying graph
   std::unordered_map<size_t, size_t> color_counts;
+  // transit connects what the roads dont so the components only tell on the road levels
+  std::unordered_map<uint32_t, size_t> component_counts;
+  bool components = connectivity_map && connectivity_map->has_components() &&
+                    connectivity_level.level != TileHierarchy::GetTransitLevel().level;
   try {
     auto locations = PathLocation::fromPBF(options.locations(), true);
-    const auto projections = loki::Search(locations, *reader, costing);
+    const auto projections = search(locations, request);
     for (size_t i = 0; i < locations.size(); ++i) {
       const auto& correlated = projections.at(locations[i]);
       PathLocation::toPBF(correlated, options.mutable_locations(i), *reader);
@@ -118,6 +125,13 @@ void loki_worker_t::route(Api& request) {
           ++itr->second;
         }
       }
+      if (components) {
+        auto location_components = connectivity_map->get_components(correlated, *reader);
+        components = !location_components.empty();
+        for (auto component : location_components) {
+          ++component_counts[component];
+        }
+      }
     }
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 
@@ -132,6 +146,12 @@ void loki_worker_t::route(Api& request) {
       break;
     }
   }
+  // and is there a component every location has an edge in
+  if (connected && components) {
+    connected = std::any_of(component_counts.begin(), component_counts.end(), [&](const auto& c) {
+      return c.second == static_cast<size_t>(options.locations_size());
+    });
+  }
   if (!connected) {
     throw valhalla_exception_t{170};
   };
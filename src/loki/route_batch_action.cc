@@ -0,0 +1,90 @@
+#include "loki/search.h"
+#include "loki/worker.h"
+
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "tyr/actor.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+
+namespace valhalla {
+namespace loki {
+
+void loki_worker_t::init_route_batch(Api& request) {
+  // each source is routed to the target at the same index
+  auto& options = *request.mutable_options();
+  parse_locations(options.mutable_sources(), valhalla_exception_t{112});
+  parse_locations(options.mutable_targets(), valhalla_exception_t{112});
+  if (options.sources_size() < 1) {
+    throw valhalla_exception_t{121};
+  };
+  if (options.targets_size() < 1) {
+    throw valhalla_exception_t{122};
+  };
+  if (options.sources_size() != options.targets_size()) {
+    throw valhalla_exception_t{129};
+  }
+
+  // no locations!
+  options.clear_locations();
+
+  // one costing for the whole batch
+  parse_costing(request);
+}
+
+void loki_worker_t::route_batch(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  init_route_batch(request);
+  auto& options = *request.mutable_options();
+  const auto& costing_name = Costing_Enum_Name(options.costing_type());
+
+  if (costing_name == "multimodal") {
+    throw valhalla_exception_t{140, Options_Action_Enum_Name(options.action())};
+  };
+
+  // the batch counts against the matrix limits and every pair against the route distance limit
+  auto max_pairs = max_matrix_locations.find(costing_name)->second;
+  if (options.sources_size() > max_pairs) {
+    throw valhalla_exception_t{150, std::to_string(static_cast<size_t>(max_pairs))};
+  };
+  auto max_pair_distance = max_distance.find(costing_name)->second;
+  for (int i = 0; i < options.sources_size(); ++i) {
+    if (to_ll(options.sources(i)).Distance(to_ll(options.targets(i))) > max_pair_distance) {
+      throw valhalla_exception_t{154,
+                                 std::to_string(static_cast<size_t>(max_pair_distance)) + " meters"};
+    }
+  }
+
+  // check distance for hierarchy pruning
+  check_hierarchy_distance(request);
+
+  // correlate all of the locations in one go, many pairs share their origin or destination
+  auto locations = PathLocation::fromPBF(options.sources());
+  auto targets = PathLocation::fromPBF(options.targets());
+  locations.insert(locations.end(), std::make_move_iterator(targets.begin()),
+                   std::make_move_iterator(targets.end()));
+  std::unordered_map<baldr::Location, PathLocation> searched;
+  try {
+    searched = search(locations, request);
+  } catch (const std::exception&) { throw valhalla_exception_t{171}; }
+
+  // a location which didn't snap only fails its own pair, thor reports it as unroutable
+  for (size_t i = 0; i < locations.size(); ++i) {
+    auto projection = searched.find(locations[i]);
+    if (projection == searched.cend()) {
+      continue;
+    }
+    PathLocation::toPBF(projection->second,
+                        i < static_cast<size_t>(options.sources_size())
+                            ? options.mutable_sources(i)
+                            : options.mutable_targets(i - options.sources_size()),
+                        *reader);
+  }
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -7,6 +7,7 @@
 #include "midgard/util.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iterator>
 #include <list>
@@ -256,8 +257,13 @@ struct bin_handler_t {
   std::shared_ptr<DynamicCost> costing;
   unsigned int max_reach_limit;
   std::vector<candidate_t> bin_candidates;
+  // shape of the current edge and the distances of a point to its segments
+  std::vector<double> shape_lngs;
+  std::vector<double> shape_lats;
+  std::vector<double> sq_distances;
   std::unordered_set<uint64_t> correlated_edges;
   Reach reach_finder;
+  SearchStats* stats;
 
   // keep track of edges whose reachability we've already computed
   // TODO: dont use pointers as keys, its safe for now but fancy caching one day could be bad
@@ -265,8 +271,11 @@ struct bin_handler_t {
 
   bin_handler_t(const std::vector<valhalla::baldr::Location>& locations,
                 valhalla::baldr::GraphReader& reader,
-                const std::shared_ptr<DynamicCost>& costing)
-      : reader(reader), costing(costing) {
+                const std::shared_ptr<DynamicCost>& costing,
+                bool use_reach_index,
+                SearchStats* stats)
+      : reader(reader), costing(costing), stats(stats) {
+    reach_finder.set_use_reach_index(use_reach_index);
     // get the unique set of input locations and the max reachability of them all
     std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
     pps.reserve(uniq_locations.size());
@@ -448,6 +457,19 @@ struct bin_handler_t {
     }
   }
 
+  // find the reach in both directions, timing it if the caller wants to know
+  directed_reach find_reach(const DirectedEdge* edge, const GraphId edge_id) {
+    if (!stats) {
+      return reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats->reach_ms += elapsed.count();
+    ++stats->reach_checks;
+    return reach;
+  }
+
   directed_reach get_reach(const GraphId edge_id, const DirectedEdge* edge) {
     // if its in cache return it
     auto itr = directed_reaches.find(edge);
@@ -455,7 +477,7 @@ struct bin_handler_t {
       return itr->second;
 
     // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    auto reach = find_reach(edge, edge_id);
     directed_reaches[edge] = reach;
     return reach;
   }
@@ -489,7 +511,7 @@ struct bin_handler_t {
       return {max_reach_limit, max_reach_limit};
 
     // notice we do both directions here because in the end we use this reach for all input locations
-    auto reach = reach_finder(edge, edge_id, max_reach_limit, reader, costing, kInbound | kOutbound);
+    auto reach = find_reach(edge, edge_id);
     directed_reaches[edge] = reach;
 
     // if the inbound reach is not 0 and the outbound reach is not 0 and the opposing edge is not
@@ -552,26 +574,46 @@ struct bin_handler_t {
       // of the shape which are on the same side of h that p is. to make this fast we would need a
       // a trivial half plane test as maybe a single dot product and comparison?
 
-      // get some shape of the edge
+      // decode the shape of the edge once for all the input points
       auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge));
-      auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty()) {
-        v = shape.pop();
+      shape_lngs.clear();
+      shape_lats.clear();
+      if (edge_info->shape_cached()) {
+        // the tile keeps the decoded shape of edges that are snapped to over and over
+        for (const auto& point : edge_info->shape()) {
+          shape_lngs.push_back(point.lng());
+          shape_lats.push_back(point.lat());
+        }
+      } else {
+        auto shape = edge_info->lazy_shape();
+        while (!shape.empty()) {
+          auto point = shape.pop();
+          shape_lngs.push_back(point.lng());
+          shape_lats.push_back(point.lat());
+        }
       }
+      const size_t shape_size = shape_lngs.size();
+      sq_distances.resize(shape_size);
 
-      // iterate along this edges segments projecting each of the points
-      for (size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        // for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          // skip updating this candidate because it was prefiltered
-          if (c_itr->prefiltered) {
+      // for each input point
+      c_itr = bin_candidates.begin();
+      for (p_itr = begin; p_itr != end && shape_size > 1; ++p_itr, ++c_itr) {
+        // skip updating this candidate because it was prefiltered
+        if (c_itr->prefiltered) {
+          continue;
+        }
+        // how close is the input to each segment, the batch may round differently than the
+        // projector so we let the projector decide between the segments that are about as
+        // close as the closest one, that way we pick exactly what projecting one by one would
+        project_segments(p_itr->project, shape_lngs.data(), shape_lats.data(), shape_size,
+                         sq_distances.data());
+        const double closest = *std::min_element(sq_distances.begin(), sq_distances.end() - 1);
+        const double close_enough = closest + closest * 1e-6 + 1e-6;
+        for (size_t i = 0; i + 1 < shape_size; ++i) {
+          if (sq_distances[i] > close_enough) {
             continue;
           }
-          // how close is the input to this segment
+          PointLL u(shape_lngs[i], shape_lats[i]), v(shape_lngs[i + 1], shape_lats[i + 1]);
           auto point = p_itr->project(u, v);
           auto sq_distance = p_itr->project.approx.DistanceSquared(point);
           // do we want to keep it
@@ -810,7 +852,9 @@ namespace loki {
 std::unordered_map<valhalla::baldr::Location, PathLocation>
 Search(const std::vector<valhalla::baldr::Location>& locations,
        GraphReader& reader,
-       const std::shared_ptr<DynamicCost>& costing) {
+       const std::shared_ptr<DynamicCost>& costing,
+       bool use_reach_index,
+       SearchStats* stats) {
   // we cannot continue without costing
   if (!costing)
     throw std::runtime_error("No costing was provided for edge candidate search");
@@ -820,7 +864,7 @@ Search(const std::vector<valhalla::baldr::Location>& locations,
     return std::unordered_map<valhalla::baldr::Location, PathLocation>{};
 
   // setup the unique list of locations
-  bin_handler_t handler(locations, reader, costing);
+  bin_handler_t handler(locations, reader, costing, use_reach_index, stats);
   // search over the bins doing multiple locations per bin
   handler.search();
   // turn each locations candidate set into path locations
@@ -0,0 +1,166 @@
+#include "loki/snap_cache.h"
+#include "filesystem.h"
+#include "loki/search.h"
+
+#include <cmath>
+#include <cstring>
+#include <optional>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// append the raw bytes of a value to the key
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T> void append(std::string& key, const std::optional<T>& value) {
+  append(key, value.has_value());
+  if (value) {
+    append(key, *value);
+  }
+}
+
+std::chrono::system_clock::time_point tileset_modified(const GraphReader& reader) {
+  try {
+    return filesystem::last_write_time(reader.GetTileSetLocation());
+  } catch (...) {}
+  return {};
+}
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+SnapCache::SnapCache(const boost::property_tree::ptree& config, const GraphReader& reader)
+    : max_size_(config.get<size_t>("size", 10000)),
+      quantization_(config.get<double>("quantization", 0.000001)),
+      max_age_(std::chrono::seconds(config.get<uint32_t>("max_age", 60))),
+      tileset_check_interval_(
+          std::chrono::seconds(config.get<uint32_t>("tileset_check_interval", 10))),
+      tileset_modified_(tileset_modified(reader)), tileset_checked_(clock_t::now()) {
+  if (quantization_ <= 0) {
+    throw std::runtime_error("loki.snap_cache.quantization must be positive");
+  }
+  index_.reserve(max_size_);
+}
+
+std::string SnapCache::make_key(const Location& location, const std::string& costing_key) const {
+  std::string key;
+  key.reserve(costing_key.size() + 96);
+  append(key, static_cast<int64_t>(std::llround(location.latlng_.lat() / quantization_)));
+  append(key, static_cast<int64_t>(std::llround(location.latlng_.lng() / quantization_)));
+  append(key, location.heading_);
+  append(key, location.min_outbound_reach_);
+  append(key, location.min_inbound_reach_);
+  append(key, location.radius_);
+  append(key, location.preferred_side_);
+  append(key, location.node_snap_tolerance_);
+  append(key, location.heading_tolerance_);
+  append(key, location.search_cutoff_);
+  append(key, location.street_side_tolerance_);
+  append(key, location.street_side_max_distance_);
+  append(key, location.street_side_cutoff_);
+  const auto& filter = location.search_filter_;
+  append(key, filter.min_road_class_);
+  append(key, filter.max_road_class_);
+  append(key, filter.exclude_tunnel_);
+  append(key, filter.exclude_bridge_);
+  append(key, filter.exclude_ramp_);
+  append(key, filter.exclude_closures_);
+  append(key, location.display_latlng_.has_value());
+  if (location.display_latlng_) {
+    append(key, static_cast<int64_t>(std::llround(location.display_latlng_->lat() / quantization_)));
+    append(key, static_cast<int64_t>(std::llround(location.display_latlng_->lng() / quantization_)));
+  }
+  append(key, location.preferred_layer_);
+  key.append(costing_key);
+  return key;
+}
+
+void SnapCache::clear() {
+  stats_.invalidations += entries_.size();
+  entries_.clear();
+  index_.clear();
+}
+
+void SnapCache::check_tileset(GraphReader& reader, clock_t::time_point now) {
+  if (now - tileset_checked_ < tileset_check_interval_) {
+    return;
+  }
+  tileset_checked_ = now;
+  auto modified = tileset_modified(reader);
+  if (modified != tileset_modified_) {
+    tileset_modified_ = modified;
+    clear();
+  }
+}
+
+std::unordered_map<Location, PathLocation>
+SnapCache::Search(const std::vector<Location>& locations,
+                  GraphReader& reader,
+                  const sif::cost_ptr_t& costing,
+                  const std::string& costing_key,
+                  bool use_reach_index,
+                  SearchStats* stats) {
+  const auto now = clock_t::now();
+  check_tileset(reader, now);
+  // closures come and go with live traffic so entries only live so long
+  const bool expires = reader.HasLiveTraffic();
+
+  // answer what we can from the cache
+  std::unordered_map<Location, PathLocation> correlated;
+  std::vector<Location> misses;
+  std::vector<std::string> miss_keys;
+  for (const auto& location : locations) {
+    auto key = make_key(location, costing_key);
+    auto found = index_.find(key);
+    if (found != index_.end() && expires && now - found->second->created > max_age_) {
+      entries_.erase(found->second);
+      index_.erase(found);
+      found = index_.end();
+      ++stats_.invalidations;
+    }
+    if (found == index_.end()) {
+      ++stats_.misses;
+      misses.push_back(location);
+      miss_keys.push_back(std::move(key));
+      continue;
+    }
+
+    // the cached edges with the location that was asked for
+    ++stats_.hits;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    PathLocation path_location = found->second->correlated;
+    static_cast<Location&>(path_location) = location;
+    correlated.emplace(location, std::move(path_location));
+  }
+  if (misses.empty()) {
+    return correlated;
+  }
+
+  // search the rest and remember what was found
+  auto searched = loki::Search(misses, reader, costing, use_reach_index, stats);
+  for (size_t i = 0; i < misses.size(); ++i) {
+    auto found = searched.find(misses[i]);
+    if (found == searched.end()) {
+      continue;
+    }
+    if (max_size_ > 0 && !index_.count(miss_keys[i])) {
+      if (entries_.size() >= max_size_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+        ++stats_.evictions;
+      }
+      entries_.push_front(entry_t{miss_keys[i], found->second, now});
+      index_.emplace(miss_keys[i], entries_.begin());
+    }
+    correlated.emplace(found->first, found->second);
+  }
+  return correlated;
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -1,4 +1,8 @@
+#include <map>
+
+#include "baldr/shapecache.h"
 #include "baldr/tilehierarchy.h"
+#include "baldr/traffictile.h"
 #include "config.h"
 #include "filesystem.h"
 #include "loki/worker.h"
@@ -32,6 +36,34 @@ time_t get_tileset_last_modified(const std::shared_ptr<GraphReader>& reader) {
 
 namespace valhalla {
 namespace loki {
+void loki_worker_t::update_tileset_status() {
+  auto tileset = std::make_shared<tileset_status_t>();
+  tileset->epoch = reader->GetTileSetEpoch();
+
+  // count the tiles per level in one pass over the tile set
+  std::map<uint32_t, uint64_t> level_tiles;
+  for (const auto& tile_id : reader->GetTileSet()) {
+    ++level_tiles[tile_id.level()];
+  }
+  tileset->level_tiles.assign(level_tiles.begin(), level_tiles.end());
+  tileset->has_transit_tiles = level_tiles.count(TileHierarchy::GetTransitLevel().level) > 0;
+  if (connectivity_map) {
+    tileset->bbox = connectivity_map->to_geojson(2);
+  }
+
+  // the rest comes from _some_ tile
+  const auto tile = get_graphtile(reader);
+  tileset->has_tiles = static_cast<bool>(tile);
+  if (tile) {
+    tileset->has_admins = tile->header()->admincount() > 0;
+    tileset->has_timezones = tile->header()->nodecount() > 0 && tile->node(0)->timezone() > 0;
+    tileset->has_elevation = tile->header()->has_elevation();
+    tileset->osm_changeset = tile->header()->dataset_id();
+    tileset->tileset_version = tile->header()->version();
+  }
+  tileset_status = std::move(tileset);
+}
+
 void loki_worker_t::status(Api& request) const {
 #ifdef HAVE_HTTP
   // if we are in the process of shutting down we signal that here
@@ -55,24 +87,84 @@ void loki_worker_t::status(Api& request) const {
   if (!request.options().verbose() || !allow_verbose)
     return;
 
-  // get _some_ tile
-  const static baldr::graph_tile_ptr tile = get_graphtile(reader);
+  // what there is to tell about the tile set was found before the request came in
+  if (tileset_status) {
+    const auto& tileset = *tileset_status;
+    if (!tileset.bbox.empty()) {
+      status->set_bbox(tileset.bbox);
+    }
+    status->set_has_tiles(tileset.has_tiles);
+    status->set_has_admins(tileset.has_admins);
+    status->set_has_timezones(tileset.has_timezones);
+    status->set_has_transit_tiles(tileset.has_transit_tiles);
+    status->set_has_elevation(tileset.has_elevation);
+    status->set_osm_changeset(tileset.osm_changeset);
+    if (!tileset.tileset_version.empty()) {
+      status->set_tileset_version(tileset.tileset_version);
+    }
+    for (const auto& level_tiles : tileset.level_tiles) {
+      auto* level = status->add_tileset_levels();
+      level->set_level(level_tiles.first);
+      level->set_tiles(level_tiles.second);
+    }
+  }
+  status->set_has_live_traffic(reader->HasLiveTraffic());
+
+  if (snap_cache) {
+    const auto& stats = snap_cache->stats();
+    auto* snap_cache_pbf = status->mutable_snap_cache();
+    snap_cache_pbf->set_hits(stats.hits);
+    snap_cache_pbf->set_misses(stats.misses);
+    snap_cache_pbf->set_evictions(stats.evictions);
+    snap_cache_pbf->set_invalidations(stats.invalidations);
+    snap_cache_pbf->set_size(snap_cache->size());
+  }
 
-  if (connectivity_map) {
-    status->set_bbox(connectivity_map->to_geojson(2));
-    const bool has_transit_tiles =
-        connectivity_map->level_color_exists(TileHierarchy::GetTransitLevel().level);
-    status->set_has_transit_tiles(has_transit_tiles);
-  } else {
-    const static bool has_transit_tiles = !reader->GetTileSet(3).empty();
-    status->set_has_transit_tiles(has_transit_tiles);
+  // how often the process decoded edge shapes and how often the tiles had them decoded already
+  const auto shape_stats = ShapeCache::stats();
+  status->mutable_shape_cache()->set_decodes(shape_stats.decodes);
+  status->mutable_shape_cache()->set_hits(shape_stats.hits);
+
+  // how much live traffic the process wrote and how often reads ran into the writes
+  const auto traffic_stats = TrafficTile::stats();
+  auto* traffic_writes = status->mutable_traffic_writes();
+  traffic_writes->set_batches(traffic_stats.batches);
+  traffic_writes->set_updates(traffic_stats.updates);
+  traffic_writes->set_write_waits(traffic_stats.write_waits);
+  traffic_writes->set_read_retries(traffic_stats.read_retries);
+
+  // how much of the tile cache each hierarchy level takes up
+  for (const auto& usage : reader->GetCacheLevelUsage()) {
+    auto* level = status->add_tile_cache();
+    level->set_level(usage.level);
+    level->set_tiles(usage.tiles);
+    level->set_bytes(usage.bytes);
+    level->set_max_bytes(usage.max_bytes);
+    level->set_rejected(usage.rejected);
   }
 
-  status->set_has_tiles(static_cast<bool>(tile));
-  status->set_has_admins(tile && tile->header()->admincount() > 0);
-  status->set_has_timezones(tile && tile->node(0)->timezone() > 0);
-  status->set_has_live_traffic(reader->HasLiveTraffic());
-  status->set_osm_changeset(tile ? tile->header()->dataset_id() : 0);
+  // which tiles the reader loaded before it answered the first request
+  const auto& warmup = reader->GetWarmupStats();
+  if (warmup.tiles > 0) {
+    auto* tile_warmup = status->mutable_tile_warmup();
+    tile_warmup->set_tiles(warmup.tiles);
+    tile_warmup->set_bytes(warmup.bytes);
+    tile_warmup->set_millis(warmup.millis);
+  }
+
+  // where the tiles are used and missed the cache, the tiles themselves are in the log
+  if (const auto& access_log = reader->GetTileAccessLog()) {
+    for (const auto& counts : TileAccessLog::ByLevel(access_log->Counts())) {
+      auto* level = status->add_tile_access();
+      level->set_level(counts.level);
+      level->set_tiles(counts.tiles);
+      level->set_accesses(counts.count);
+      level->set_misses(counts.misses);
+    }
+  }
+
+  // what the requests this process finished spent their time on
+  service_metrics_t::get().fill(*status);
 }
 } // namespace loki
 } // namespace valhalla
@@ -0,0 +1,305 @@
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "baldr/graphconstants.h"
+#include "baldr/tilehierarchy.h"
+#include "loki/worker.h"
+#include "midgard/aabb2.h"
+#include "midgard/constants.h"
+#include "midgard/polyline2.h"
+#include "proto/vector_tile.pb.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// Tile units along each side of a tile, what the vector tile spec and its renderers default to
+constexpr uint32_t kExtent = 4096;
+// Tile units the lines go on past the sides of a tile, so that the lines of neighbouring tiles
+// overlap rather than end right at the side where a renderer would cut their caps
+constexpr double kBuffer = 64;
+// Tiles below these zoom levels leave out the arterial and the local roads
+constexpr uint32_t kArterialMinZoom = 10;
+constexpr uint32_t kLocalMinZoom = 13;
+
+// Web mercator coordinates of a position in tiles of the zoom level
+double mercator_x(double lng, uint32_t z) {
+  return (lng + 180.0) / 360.0 * std::ldexp(1.0, z);
+}
+
+double mercator_y(double lat, uint32_t z) {
+  const double lat_rad = lat * kRadPerDegD;
+  return (1.0 - std::log(std::tan(lat_rad) + 1.0 / std::cos(lat_rad)) / kPiD) / 2.0 *
+         std::ldexp(1.0, z);
+}
+
+double mercator_lng(double x, uint32_t z) {
+  return x / std::ldexp(1.0, z) * 360.0 - 180.0;
+}
+
+double mercator_lat(double y, uint32_t z) {
+  return std::atan(std::sinh(kPiD * (1.0 - 2.0 * y / std::ldexp(1.0, z)))) * kDegPerRadD;
+}
+
+// A position in tile units
+using tile_point_t = std::pair<int32_t, int32_t>;
+
+uint32_t command(uint32_t id, uint32_t count) {
+  return (id & 0x7) | (count << 3);
+}
+
+uint32_t zigzag(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+// Adds the features of a layer, the keys and values of their tags are stored once per layer
+class layer_builder_t {
+public:
+  layer_builder_t(vector_tile::Tile::Layer& layer) : layer_(layer) {
+  }
+
+  vector_tile::Tile::Feature* add_feature(uint64_t id, const std::vector<tile_point_t>& line) {
+    auto* feature = layer_.add_features();
+    feature->set_id(id);
+    feature->set_type(vector_tile::Tile::LINESTRING);
+    auto* geometry = feature->mutable_geometry();
+    geometry->Reserve(line.size() * 2 + 2);
+    tile_point_t cursor(0, 0);
+    for (size_t i = 0; i < line.size(); ++i) {
+      if (i == 0) {
+        geometry->Add(command(1, 1));
+      } else if (i == 1) {
+        geometry->Add(command(2, line.size() - 1));
+      }
+      geometry->Add(zigzag(line[i].first - cursor.first));
+      geometry->Add(zigzag(line[i].second - cursor.second));
+      cursor = line[i];
+    }
+    return feature;
+  }
+
+  void add_tag(vector_tile::Tile::Feature& feature, const char* key, const std::string& value) {
+    auto found = strings_.find(value);
+    if (found == strings_.end()) {
+      found = strings_.emplace(value, layer_.values_size()).first;
+      layer_.add_values()->set_string_value(value);
+    }
+    feature.add_tags(key_index(key));
+    feature.add_tags(found->second);
+  }
+
+  void add_tag(vector_tile::Tile::Feature& feature, const char* key, uint64_t value) {
+    auto found = uints_.find(value);
+    if (found == uints_.end()) {
+      found = uints_.emplace(value, layer_.values_size()).first;
+      layer_.add_values()->set_uint_value(value);
+    }
+    feature.add_tags(key_index(key));
+    feature.add_tags(found->second);
+  }
+
+  void add_tag(vector_tile::Tile::Feature& feature, const char* key, bool value) {
+    auto& index = value ? true_ : false_;
+    if (index < 0) {
+      index = layer_.values_size();
+      layer_.add_values()->set_bool_value(value);
+    }
+    feature.add_tags(key_index(key));
+    feature.add_tags(index);
+  }
+
+protected:
+  uint32_t key_index(const char* key) {
+    auto found = keys_.find(key);
+    if (found == keys_.end()) {
+      found = keys_.emplace(key, layer_.keys_size()).first;
+      layer_.add_keys(key);
+    }
+    return found->second;
+  }
+
+  vector_tile::Tile::Layer& layer_;
+  std::unordered_map<std::string, uint32_t> keys_;
+  std::unordered_map<std::string, uint32_t> strings_;
+  std::unordered_map<uint64_t, uint32_t> uints_;
+  int64_t true_ = -1, false_ = -1;
+};
+
+} // namespace
+
+namespace valhalla {
+namespace loki {
+
+void loki_worker_t::init_tile(Api& request) {
+  const auto& options = request.options();
+  const auto& xyz = options.tile_xyz();
+  if (!options.has_tile_xyz() || xyz.z() > max_tile_zoom || xyz.x() >> xyz.z() != 0 ||
+      xyz.y() >> xyz.z() != 0) {
+    throw valhalla_exception_t{174};
+  }
+  if (xyz.z() < min_tile_zoom) {
+    throw valhalla_exception_t{175, std::to_string(min_tile_zoom)};
+  }
+}
+
+std::string loki_worker_t::tile(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  init_tile(request);
+  const auto z = request.options().tile_xyz().z();
+  const auto x = request.options().tile_xyz().x();
+  const auto y = request.options().tile_xyz().y();
+  if (vector_tile_cache) {
+    if (const auto* bytes = vector_tile_cache->Find(z, x, y)) {
+      return *bytes;
+    }
+  }
+
+  // the area of the tile and its buffer
+  const double buffer = kBuffer / kExtent;
+  const AABB2<PointLL> bbox(mercator_lng(x - buffer, z), mercator_lat(y + 1 + buffer, z),
+                            mercator_lng(x + 1 + buffer, z), mercator_lat(y - buffer, z));
+  const AABB2<Point2d> extent(-kBuffer, -kBuffer, kExtent + kBuffer, kExtent + kBuffer);
+  const auto& levels = TileHierarchy::levels();
+  const uint8_t max_level = z >= kLocalMinZoom      ? levels.back().level
+                            : z >= kArterialMinZoom ? levels[1].level
+                                                    : levels.front().level;
+  const double tolerance = kGeneralizeTolerances[std::min(z, kMaxGeneralizeZoom)];
+
+  vector_tile::Tile vector_tile;
+  auto& layer = *vector_tile.add_layers();
+  layer.set_version(2);
+  layer.set_name("edges");
+  layer.set_extent(kExtent);
+  layer_builder_t builder(layer);
+
+  // one feature per pair of directed edges, the one along the shape, with the attributes of both
+  std::unordered_set<GraphId> seen;
+  std::vector<PointLL> shape;
+  std::vector<Point2d> projected;
+  std::vector<tile_point_t> line;
+  const auto add_edge = [&](GraphId edge_id, graph_tile_ptr tile) {
+    if (edge_id.level() > max_level || !reader->GetGraphTile(edge_id, tile)) {
+      return;
+    }
+    const DirectedEdge* edge = tile->directededge(edge_id);
+    const DirectedEdge* opp_edge = nullptr;
+    graph_tile_ptr opp_tile = tile;
+    auto opp_edge_id = reader->GetOpposingEdgeId(edge_id, opp_edge, opp_tile);
+    if (!edge->forward() && opp_edge) {
+      std::swap(edge_id, opp_edge_id);
+      std::swap(edge, opp_edge);
+      std::swap(tile, opp_tile);
+    }
+    if (!edge->forward() || edge->is_shortcut() || edge->use() == Use::kTransitConnection ||
+        edge->use() == Use::kPlatformConnection || edge->use() == Use::kEgressConnection ||
+        !seen.insert(edge_id).second) {
+      return;
+    }
+
+    // the shape within the buffer of the tile, generalized for the zoom level
+    shape = tile->edgeinfo(edge).shape();
+    AABB2<PointLL> shape_bbox(shape);
+    if (!shape_bbox.Intersects(bbox)) {
+      return;
+    }
+    Polyline2<PointLL>::Generalize(shape, tolerance);
+    projected.clear();
+    for (const auto& ll : shape) {
+      projected.emplace_back((mercator_x(ll.lng(), z) - x) * kExtent,
+                             (mercator_y(ll.lat(), z) - y) * kExtent);
+    }
+    extent.Clip(projected, false);
+    line.clear();
+    for (const auto& p : projected) {
+      tile_point_t point(std::lround(p.x()), std::lround(p.y()));
+      if (line.empty() || line.back() != point) {
+        line.push_back(point);
+      }
+    }
+    if (line.size() < 2) {
+      return;
+    }
+
+    auto& feature = *builder.add_feature(edge_id.value, line);
+    builder.add_tag(feature, "road_class", to_string(edge->classification()));
+    builder.add_tag(feature, "use", to_string(edge->use()));
+    builder.add_tag(feature, "access", static_cast<uint64_t>(edge->forwardaccess()));
+    builder.add_tag(feature, "reverse_access", static_cast<uint64_t>(edge->reverseaccess()));
+    builder.add_tag(feature, "speed", static_cast<uint64_t>(edge->speed()));
+    const auto live = tile->trafficspeed(edge);
+    if (live.speed_valid()) {
+      builder.add_tag(feature, "live_speed", static_cast<uint64_t>(live.get_overall_speed()));
+      builder.add_tag(feature, "closed", live.closed());
+    }
+    if (opp_edge) {
+      builder.add_tag(feature, "reverse_speed", static_cast<uint64_t>(opp_edge->speed()));
+      const auto reverse_live = opp_tile->trafficspeed(opp_edge);
+      if (reverse_live.speed_valid()) {
+        builder.add_tag(feature, "reverse_live_speed",
+                        static_cast<uint64_t>(reverse_live.get_overall_speed()));
+        builder.add_tag(feature, "reverse_closed", reverse_live.closed());
+      }
+    }
+  };
+
+  if (max_level == levels.back().level) {
+    // the bins of the local tiles hold the edges of all levels that pass through them
+    const auto& tiles = levels.back().tiles;
+    const double bin_size = tiles.TileSize() / kBinsDim;
+    for (const auto tile_id : tiles.TileList(bbox)) {
+      auto tile = reader->GetGraphTile(GraphId(tile_id, max_level, 0));
+      if (!tile) {
+        continue;
+      }
+      const auto bounds = tiles.TileBounds(tile_id);
+      for (size_t row = 0; row < kBinsDim; ++row) {
+        for (size_t col = 0; col < kBinsDim; ++col) {
+          const AABB2<PointLL> bin(bounds.minx() + col * bin_size, bounds.miny() + row * bin_size,
+                                   bounds.minx() + (col + 1) * bin_size,
+                                   bounds.miny() + (row + 1) * bin_size);
+          if (!bin.Intersects(bbox)) {
+            continue;
+          }
+          for (const auto edge_id : tile->GetBin(col, row)) {
+            add_edge(edge_id, tile);
+          }
+        }
+      }
+    }
+  } else {
+    // the tiles of the higher levels are big enough to look at all of their edges, the ones
+    // around the tile too for the edges that only pass through
+    for (const auto& level : levels) {
+      if (level.level > max_level) {
+        break;
+      }
+      const auto size = level.tiles.TileSize();
+      const AABB2<PointLL> around(bbox.minx() - size, bbox.miny() - size, bbox.maxx() + size,
+                                  bbox.maxy() + size);
+      for (const auto tile_id : level.tiles.TileList(around)) {
+        auto tile = reader->GetGraphTile(GraphId(tile_id, level.level, 0));
+        if (!tile) {
+          continue;
+        }
+        for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+          add_edge(GraphId(tile_id, level.level, i), tile);
+        }
+      }
+    }
+  }
+
+  auto bytes = vector_tile.SerializeAsString();
+  if (vector_tile_cache) {
+    vector_tile_cache->Insert(z, x, y, bytes);
+  }
+  return bytes;
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -156,6 +156,9 @@ void loki_worker_t::init_trace(Api& request) {
   if (options.has_turn_penalty_factor_case()) {
     check_turn_penalty_factor(options.turn_penalty_factor());
   }
+  if (options.has_beam_cost_gap_case() && options.beam_cost_gap() < 0.f) {
+    throw valhalla_exception_t{158};
+  }
 
   // Set locations after parsing the shape
   locations_from_shape(request);
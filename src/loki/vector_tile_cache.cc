@@ -0,0 +1,69 @@
+#include "loki/vector_tile_cache.h"
+
+#include <iterator>
+
+namespace valhalla {
+namespace loki {
+
+VectorTileCache::VectorTileCache(const boost::property_tree::ptree& config)
+    : max_bytes_(config.get<size_t>("size", 64 * 1024 * 1024)),
+      max_age_(config.get<uint32_t>("max_age", 60)) {
+}
+
+uint64_t VectorTileCache::make_key(uint32_t z, uint32_t x, uint32_t y) {
+  // zoom levels stay far below 32 so 5 bits hold it and a column or row of up to 29 bits
+  return (static_cast<uint64_t>(z) << 58) | (static_cast<uint64_t>(x) << 29) | y;
+}
+
+void VectorTileCache::Erase(std::list<entry_t>::iterator entry) {
+  bytes_ -= entry->bytes.size();
+  index_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+const std::string* VectorTileCache::Find(uint32_t z, uint32_t x, uint32_t y) {
+  auto found = index_.find(make_key(z, x, y));
+  if (found == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  // the live speeds in it are stale
+  if (clock_t::now() - found->second->encoded > max_age_) {
+    Erase(found->second);
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return &found->second->bytes;
+}
+
+void VectorTileCache::Insert(uint32_t z, uint32_t x, uint32_t y, std::string bytes) {
+  const auto key = make_key(z, x, y);
+  if (bytes.size() > max_bytes_) {
+    return;
+  }
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    Erase(found->second);
+  }
+
+  // make room by dropping the least recently used tiles
+  while (!entries_.empty() && bytes_ + bytes.size() > max_bytes_) {
+    Erase(std::prev(entries_.end()));
+    ++stats_.evictions;
+  }
+
+  bytes_ += bytes.size();
+  entries_.push_front({key, std::move(bytes), clock_t::now()});
+  index_.emplace(key, entries_.begin());
+}
+
+void VectorTileCache::Clear() {
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+} // namespace loki
+} // namespace valhalla
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <boost/property_tree/ptree.hpp>
 #include <cstdint>
 #include <functional>
@@ -10,12 +11,14 @@
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
 #include "midgard/logging.h"
+#include "midgard/pointll.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/motorcyclecost.h"
 #include "sif/motorscootercost.h"
 #include "sif/pedestriancost.h"
 #include "tyr/actor.h"
+#include "tyr/serializers.h"
 
 #include "loki/polygon_search.h"
 #include "loki/search.h"
@@ -86,7 +89,8 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
 
   if (options.exclude_polygons_size()) {
     const auto edges =
-        edges_in_rings(options.exclude_polygons(), *reader, costing, max_exclude_polygons_length);
+        edges_in_rings(options.exclude_polygons(), *reader, costing, max_exclude_polygons_length,
+                       exclude_polygons_threads);
     auto& co = *options.mutable_costings()->find(options.costing_type())->second.mutable_options();
     for (const auto& edge_id : edges) {
       auto* avoid = co.add_exclude_edges();
@@ -142,6 +146,24 @@ void loki_worker_t::parse_costing(Api& api, bool allow_none) {
     }
   }
 
+  // Remember exactly which costing the locations of this request are snapped with
+  if (snap_cache) {
+    costing_key = Costing_Enum_Name(options.costing_type());
+    auto found = options.costings().find(options.costing_type());
+    if (found != options.costings().end()) {
+      costing_key += found->second.SerializeAsString();
+    }
+  }
+
+  // The precomputed reach only holds for the default options of a costing without live traffic
+  use_reach_index = false;
+  auto reach_options = reach_index_options.find(options.costing_type());
+  if (reach_options != reach_index_options.end() && !reader->HasLiveTraffic()) {
+    auto found = options.costings().find(options.costing_type());
+    use_reach_index = found != options.costings().end() &&
+                      found->second.options().SerializeAsString() == reach_options->second;
+  }
+
   // If more alternates are requested than we support we cap it
   if (options.action() != Options::trace_attributes && options.alternates() > max_alternates)
     options.set_alternates(max_alternates);
@@ -160,10 +182,14 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
       max_contours(config.get<size_t>("service_limits.isochrone.max_contours")),
       max_contour_min(config.get<size_t>("service_limits.isochrone.max_time_contour")),
       max_contour_km(config.get<size_t>("service_limits.isochrone.max_distance_contour")),
+      max_batch_isochrones(
+          config.get<size_t>("service_limits.isochrone.max_batch_locations", 1000)),
       max_trace_shape(config.get<size_t>("service_limits.trace.max_shape")),
       sample(config.get<std::string>("additional_data.elevation", "")),
       max_elevation_shape(config.get<size_t>("service_limits.skadi.max_shape")),
-      min_resample(config.get<float>("service_limits.skadi.min_resample")) {
+      min_resample(config.get<float>("service_limits.skadi.min_resample")),
+      min_tile_zoom(config.get<uint32_t>("service_limits.tile.min_zoom", 6)),
+      max_tile_zoom(std::min(config.get<uint32_t>("service_limits.tile.max_zoom", 20), 24u)) {
 
   // Keep a string noting which actions we support, throw if one isnt supported
   Options::Action action;
@@ -228,6 +254,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
 
   max_exclude_locations = config.get<size_t>("service_limits.max_exclude_locations");
   max_exclude_polygons_length = config.get<float>("service_limits.max_exclude_polygons_length");
+  exclude_polygons_threads = config.get<size_t>("loki.exclude_polygons_threads", 1);
   max_reachability = config.get<unsigned int>("service_limits.max_reachability");
   default_reachability = config.get<unsigned int>("loki.service_defaults.minimum_reachability");
   max_radius = config.get<unsigned int>("service_limits.max_radius");
@@ -251,14 +278,76 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   max_distance_disable_hierarchy_culling =
       config.get<float>("service_limits.max_distance_disable_hierarchy_culling", 0.f);
 
+  // remember what the default options of the costings in the reach index look like
+  if (config.get<bool>("loki.use_reach_index", true)) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    for (auto type : {Costing::auto_, Costing::truck, Costing::bicycle, Costing::pedestrian,
+                      Costing::motor_scooter, Costing::motorcycle}) {
+      Costing defaults;
+      sif::ParseCosting(doc, "/costing_options", &defaults, type);
+      reach_index_options[type] = defaults.options().SerializeAsString();
+    }
+  }
+
+  // cache the snapping of locations that keep coming back
+  auto snap_cache_config = config.get_child_optional("loki.snap_cache");
+  if (snap_cache_config && snap_cache_config->get<size_t>("size", 0) > 0) {
+    snap_cache = std::make_shared<SnapCache>(*snap_cache_config, *reader);
+  }
+
+  // and the elevation profiles of shapes that keep coming back
+  auto height_cache_config = config.get_child_optional("loki.height_cache");
+  if (height_cache_config && height_cache_config->get<size_t>("size", 0) > 0) {
+    height_cache = std::make_shared<HeightCache>(*height_cache_config);
+  }
+
+  // the vector tiles of recent /tile requests
+  auto vector_tile_cache_config = config.get_child_optional("loki.vector_tile_cache");
+  if (vector_tile_cache_config && vector_tile_cache_config->get<size_t>("size", 0) > 0) {
+    vector_tile_cache = std::make_shared<VectorTileCache>(*vector_tile_cache_config);
+    vector_tile_epoch = reader->GetTileSetEpoch();
+  }
+
+  // what the verbose status tells about the tile set is found once up front
+  if (allow_verbose) {
+    update_tileset_status();
+  }
+
   // signal that the worker started successfully
   started();
 }
 
+std::unordered_map<baldr::Location, baldr::PathLocation>
+loki_worker_t::search(const std::vector<baldr::Location>& locations, Api& request) {
+  SearchStats stats;
+  std::unordered_map<baldr::Location, baldr::PathLocation> found;
+  {
+    auto _ = measure_phase_time(request, service_name(), "search");
+    found = snap_cache
+                ? snap_cache->Search(locations, *reader, costing, costing_key, use_reach_index, &stats)
+                : loki::Search(locations, *reader, costing, use_reach_index, &stats);
+  }
+  // the reach is found during the search, its time is part of the search time
+  add_timing(request, service_name(), "reach", stats.reach_ms);
+  add_count(request, service_name(), "reach_checks", stats.reach_checks);
+  return found;
+}
+
 void loki_worker_t::cleanup() {
   service_worker_t::cleanup();
   if (reader->OverCommitted()) {
     reader->Trim();
+  }  // requests in flight are done with the tiles, time to move to a newly published tile set
+  reader->SwitchTileSet();
+  // the reader may be shared, so whoever switched it the status has to follow
+  if (tileset_status && tileset_status->epoch != reader->GetTileSetEpoch()) {
+    update_tileset_status();
+  }
+  // and the vector tiles encoded from the old tile set are gone
+  if (vector_tile_cache && vector_tile_epoch != reader->GetTileSetEpoch()) {
+    vector_tile_cache->Clear();
+    vector_tile_epoch = reader->GetTileSetEpoch();
   }
 }
 
@@ -296,6 +385,15 @@ void loki_worker_t::check_hierarchy_distance(Api& request) {
         }
       }
     }
+  } // a batch only pairs each source with the target at the same index
+  else if (request.options().action() == Options_Action_route_batch) {
+    for (int i = 0; i < options.sources_size(); ++i) {
+      if (to_ll(options.sources(i)).Distance(to_ll(options.targets(i))) >
+          max_distance_disable_hierarchy_culling) {
+        max_distance_exceeded = true;
+        break;
+      }
+    }
   } else {
     auto locations = options.locations();
     float arc_distance = 0.0f;
@@ -315,7 +413,73 @@ void loki_worker_t::check_hierarchy_distance(Api& request) {
   }
 }
 
+double estimate_cost(const Options& options) {
+  // kilometers across the bounding box of the locations, at least 1
+  using locations_t = google::protobuf::RepeatedPtrField<valhalla::Location>;
+  auto span = [](std::initializer_list<const locations_t*> lists) {
+    double min_lng = 180, min_lat = 90, max_lng = -180, max_lat = -90;
+    for (const auto* locations : lists) {
+      for (const auto& location : *locations) {
+        min_lng = std::min<double>(min_lng, location.ll().lng());
+        min_lat = std::min<double>(min_lat, location.ll().lat());
+        max_lng = std::max<double>(max_lng, location.ll().lng());
+        max_lat = std::max<double>(max_lat, location.ll().lat());
+      }
+    }
+    if (min_lng > max_lng) {
+      return 1.0;
+    }
+    return std::max(PointLL(min_lng, min_lat).Distance(PointLL(max_lng, max_lat)) / 1000.0, 1.0);
+  };
+
+  double cost = 0;
+  switch (options.action()) {
+    case Options::sources_to_targets:
+      cost = static_cast<double>(options.sources_size()) * options.targets_size() *
+             span({&options.sources(), &options.targets()});
+      break;
+    case Options::optimized_route:
+      cost = static_cast<double>(options.locations_size()) * options.locations_size() *
+             span({&options.locations()});
+      break;
+    case Options::isochrone:
+    case Options::isochrone_batch: {
+      // the expansion covers the whole area, time is taken as a kilometer a minute
+      double extent = 1;
+      for (const auto& contour : options.contours()) {
+        extent = std::max<double>(extent, std::max(contour.time(), contour.distance()));
+      }
+      cost = options.locations_size() * extent * extent;
+      break;
+    }
+    default:
+      cost = std::max(options.locations_size() - 1, 1) * span({&options.locations()});
+      break;
+  }
+
+  // without the hierarchy or with transit there is much more graph per kilometer
+  switch (options.costing_type()) {
+    case Costing::pedestrian:
+    case Costing::bicycle:
+    case Costing::bikeshare:
+      return cost * 2;
+    case Costing::multimodal:
+    case Costing::transit:
+      return cost * 4;
+    default:
+      return cost;
+  }
+}
+
 #ifdef HAVE_HTTP
+namespace {
+// the request for thor, stamped with when it left so thor can tell how long it waited for it
+std::string hand_off(Api& request) {
+  stamp_hand_off(request);
+  return request.SerializeAsString();
+}
+} // namespace
+
 prime_server::worker_t::result_t
 loki_worker_t::work(const std::list<zmq::message_t>& job,
                     void* request_info,
@@ -324,7 +488,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
   // grab the request info and make sure to record any metrics before we are done
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Loki Request " + std::to_string(info.id));
-  Api request;
+  Api& request = request_arena.next();
   prime_server::worker_t::result_t result{true, {}, ""};
   try {
     // request parsing
@@ -332,6 +496,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
                                                   job.front().size());
     ParseApi(http_request, request);
+    sample_trace(request, trace_sample_rate);
     const auto& options = request.options();
 
     // check there is a valid action
@@ -341,12 +506,30 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
 
     // Set the interrupt function
     service_worker_t::set_interrupt(&interrupt_function);
+
+    // so thor can tell the expensive requests from the cheap ones
+    request.mutable_info()->set_cost(estimate_cost(options));
+    add_count(request, service_name(), "cost", request.info().cost());
+
+    // exact repeats of routes and matrices are answered with the results of the first one, note
+    // that a hit swaps out the options so we only use what we copied from them before
+    const auto action = options.action();
+    if (result_cache && (action == Options::route || action == Options::sources_to_targets)) {
+      request.mutable_info()->set_cache_key(result_cache_t::key(request));
+      if (result_cache->get(request, [this]() { return reader->GetTrafficLastUpdate(); })) {
+        if (action == Options::route) {
+          return to_response(tyr::serializeDirections(request), info, request);
+        }
+        return to_response(tyr::serializeMatrixChunks(request), info, request);
+      }
+    }
+
     // do request specific processing
     switch (options.action()) {
       case Options::route:
       case Options::centroid:
         route(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(hand_off(request));
         break;
       case Options::locate:
         result = to_response(locate(request), info, request);
@@ -354,16 +537,24 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
       case Options::sources_to_targets:
       case Options::optimized_route:
         matrix(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(hand_off(request));
+        break;
+      case Options::route_batch:
+        route_batch(request);
+        result.messages.emplace_back(hand_off(request));
         break;
       case Options::isochrone:
         isochrones(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(hand_off(request));
+        break;
+      case Options::isochrone_batch:
+        isochrone_batch(request);
+        result.messages.emplace_back(hand_off(request));
         break;
       case Options::trace_attributes:
       case Options::trace_route:
         trace(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(hand_off(request));
         break;
       case Options::height:
         result = to_response(height(request), info, request);
@@ -371,9 +562,12 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
       case Options::transit_available:
         result = to_response(transit_available(request), info, request);
         break;
+      case Options::tile:
+        result = to_response(tile(request), info, request);
+        break;
       case Options::status:
         status(request);
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(hand_off(request));
         break;
       case Options::expansion:
         if (options.expansion_action() == Options::route) {
@@ -383,7 +577,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         } else {
           matrix(request);
         }
-        result.messages.emplace_back(request.SerializeAsString());
+        result.messages.emplace_back(hand_off(request));
         break;
       default:
         // apparently you wanted something that we figured we'd support but havent written yet
@@ -397,9 +591,11 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
     result = serialize_error({199, std::string(e.what())}, info, request);
   }
 
-  // keep track of the metrics if the request is going back to the client
-  if (!result.intermediate)
+  // keep track of the metrics and the trace if the request is going back to the client
+  if (!result.intermediate) {
     enqueue_statistics(request);
+    export_trace(request);
+  }
 
   return result;
 }
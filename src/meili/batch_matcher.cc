@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <thread>
+
+#include "baldr/pathlocation.h"
+#include "meili/batch_matcher.h"
+#include "worker.h"
+
+namespace {
+
+using namespace valhalla;
+using namespace valhalla::meili;
+
+constexpr size_t kDefaultChunkSize = 1024;
+
+// matches this close to a spot along the path are taken to be at it
+constexpr double kAnchorTolerance = 0.1;
+
+// everything a matcher created from the options depends on
+std::string matcher_key(const Options& options) {
+  std::string key(1, static_cast<char>(options.costing_type()));
+  auto append = [&key](const int set, const float value) {
+    key.push_back(static_cast<char>(set));
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  append(options.has_search_radius_case(), options.search_radius());
+  append(options.has_turn_penalty_factor_case(), options.turn_penalty_factor());
+  append(options.has_gps_accuracy_case(), options.gps_accuracy());
+  append(options.has_breakage_distance_case(), options.breakage_distance());
+  append(options.has_interpolation_distance_case(), options.interpolation_distance());
+  append(options.has_beam_width_case(), options.beam_width());
+  append(options.has_beam_cost_gap_case(), options.beam_cost_gap());
+  auto costing = options.costings().find(options.costing_type());
+  if (costing != options.costings().end()) {
+    key += costing->second.SerializeAsString();
+  }
+  return key;
+}
+
+// where a timed match is along the path of a trace
+struct anchor_t {
+  uint32_t run;    // the stretch of the path without discontinuities it is on
+  double distance; // meters along the path
+  double time;     // seconds from epoch
+};
+
+// read the next trace of the stream into the api, false when the stream is done
+bool read_trace(std::istream& traces, const BatchMatcher::Format format, Api& api) {
+  if (format == BatchMatcher::Format::kPbf) {
+    uint32_t size = 0;
+    if (!traces.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+      return false;
+    }
+    std::string bytes(size, '\0');
+    if (!traces.read(&bytes[0], size) || !api.ParseFromString(bytes)) {
+      throw std::runtime_error("Truncated or invalid pbf trace");
+    }
+    ParseApi("", Options::trace_attributes, api);
+    return true;
+  }
+
+  // skip blank lines
+  std::string line;
+  while (std::getline(traces, line)) {
+    if (line.find_first_not_of(" \t\r") != std::string::npos) {
+      ParseApi(line, Options::trace_attributes, api);
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+std::vector<SpeedObservation> ObserveSpeeds(const MatchResults& match, baldr::GraphReader& reader) {
+  // where along the path each segment starts and which run of connected segments it is on
+  const auto& segments = match.segments;
+  std::vector<double> starts(segments.size()), lengths(segments.size());
+  std::vector<uint32_t> runs(segments.size());
+  double distance = 0;
+  uint32_t run = 0;
+  baldr::graph_tile_ptr tile;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const auto* edge = reader.directededge(segments[i].edgeid, tile);
+    lengths[i] = edge ? edge->length() * (segments[i].target - segments[i].source) : 0;
+    starts[i] = distance;
+    runs[i] = run;
+    distance += lengths[i];
+    run += segments[i].discontinuity;
+  }
+
+  // the results and the segments are both in path order so the timed matches are found by
+  // walking the segments forward
+  std::vector<anchor_t> anchors;
+  size_t s = 0;
+  for (const auto& result : match.results) {
+    if (!result.edgeid.Is_Valid() || result.epoch_time < 0) {
+      continue;
+    }
+    auto found = s;
+    for (; found < segments.size(); ++found) {
+      const auto& segment = segments[found];
+      if (segment.edgeid == result.edgeid && result.distance_along >= segment.source - 1e-6 &&
+          result.distance_along <= segment.target + 1e-6) {
+        break;
+      }
+    }
+    if (found == segments.size()) {
+      continue;
+    }
+    s = found;
+
+    const auto& segment = segments[s];
+    const double span = segment.target - segment.source;
+    const double along =
+        span > 0 ? std::min(std::max((result.distance_along - segment.source) / span, 0.), 1.) : 0;
+    const anchor_t anchor{runs[s], starts[s] + lengths[s] * along, result.epoch_time};
+    // a match that goes back in time or along the path can't be interpolated from
+    if (!anchors.empty() && anchors.back().run == anchor.run &&
+        (anchor.distance < anchors.back().distance || anchor.time < anchors.back().time)) {
+      continue;
+    }
+    anchors.push_back(anchor);
+  }
+
+  // the time the path was at a spot, the latest one if it stood there for a while
+  auto time_at = [&anchors](const uint32_t run, const double distance, double& time) {
+    auto right = std::upper_bound(anchors.cbegin(), anchors.cend(), distance + kAnchorTolerance,
+                                  [run](const double d, const anchor_t& a) {
+                                    return run < a.run || (run == a.run && d < a.distance);
+                                  });
+    if (right == anchors.cbegin() || std::prev(right)->run != run) {
+      return false;
+    }
+    const auto left = std::prev(right);
+    if (left->distance >= distance - kAnchorTolerance) {
+      time = left->time;
+      return true;
+    }
+    if (right == anchors.cend() || right->run != run) {
+      return false;
+    }
+    time = left->time +
+           (right->time - left->time) * (distance - left->distance) /
+               (right->distance - left->distance);
+    return true;
+  };
+
+  std::vector<SpeedObservation> observations;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    double entry, exit;
+    if (lengths[i] > 0 && time_at(runs[i], starts[i], entry) &&
+        time_at(runs[i], starts[i] + lengths[i], exit) && exit > entry) {
+      observations.push_back({segments[i].edgeid, entry, exit, static_cast<float>(lengths[i]),
+                              static_cast<float>(segments[i].target - segments[i].source)});
+    }
+  }
+  return observations;
+}
+
+std::unordered_map<baldr::GraphId, std::vector<baldr::TrafficSpeedUpdate>>
+TrafficUpdates(const std::vector<SpeedObservation>& observations, const float min_coverage) {
+  // total length and time of each edge
+  std::unordered_map<uint64_t, std::pair<double, double>> totals;
+  for (const auto& observation : observations) {
+    if (observation.coverage >= min_coverage && observation.exit_time > observation.entry_time) {
+      auto& total = totals[observation.edge];
+      total.first += observation.length;
+      total.second += observation.exit_time - observation.entry_time;
+    }
+  }
+
+  std::unordered_map<baldr::GraphId, std::vector<baldr::TrafficSpeedUpdate>> updates;
+  for (const auto& total : totals) {
+    const baldr::GraphId edge(total.first);
+    const double kph = std::min(total.second.first / total.second.second * 3.6,
+                                static_cast<double>(baldr::kMaxTrafficSpeed));
+    // the encoding is in 2kph steps and 0 would close the edge
+    const uint32_t encoded = std::max<uint32_t>(std::lround(kph / 2), 1);
+    updates[edge.Tile_Base()].push_back(
+        {edge.id(), baldr::TrafficSpeed{encoded, encoded, 0, 0, 255, 0, 0, 0, 0, false}});
+  }
+  return updates;
+}
+
+BatchMatcher::BatchMatcher(const boost::property_tree::ptree& root, const Output output)
+    : chunk_size_(root.get<size_t>("meili.batch.chunk_size", kDefaultChunkSize)), output_(output) {
+  chunk_size_ = std::max<size_t>(chunk_size_, 1);
+
+  // every thread gets its own reader and candidate grid
+  size_t threads = root.get<size_t>("meili.batch.threads", std::thread::hardware_concurrency());
+  threads = std::max<size_t>(threads, 1);
+  factories_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    factories_.emplace_back(new MapMatcherFactory(root));
+  }
+  matchers_.resize(threads);
+}
+
+BatchMatcher::~BatchMatcher() {
+}
+
+BatchRecord
+BatchMatcher::MatchTrace(const size_t thread, const uint64_t index, Api& api, uint64_t& points) {
+  BatchRecord record{index, kBatchMatched, {}, {}};
+  try {
+    // probe traces mostly ask for the same matcher, only make a new one when they don't
+    const auto& options = api.options();
+    auto& pooled = matchers_[thread];
+    auto key = matcher_key(options);
+    if (!pooled.matcher || pooled.key != key) {
+      pooled.matcher.reset(factories_[thread]->Create(options));
+      pooled.key = std::move(key);
+    }
+    auto& matcher = pooled.matcher;
+
+    // the same defaults as trace_attributes
+    const auto& config = matcher->config();
+    std::vector<Measurement> measurements;
+    measurements.reserve(options.shape_size());
+    for (const auto& pt : options.shape()) {
+      measurements.emplace_back(midgard::PointLL{pt.ll().lng(), pt.ll().lat()},
+                                pt.has_accuracy_case() ? pt.accuracy()
+                                                       : config.emission_cost.gps_accuracy_meters,
+                                pt.has_radius_case() ? pt.radius()
+                                                     : config.candidate_search.search_radius_meters,
+                                pt.time(), baldr::PathLocation::fromPBF(pt.type()));
+    }
+    points += measurements.size();
+
+    auto match = std::move(matcher->OfflineMatch(measurements).front());
+    if (output_ == Output::kSpeeds) {
+      record.speeds = ObserveSpeeds(match, matcher->graphreader());
+    } else {
+      record.edges = std::move(match.edges);
+    }
+  } catch (const valhalla_exception_t& e) {
+    record.status = e.code;
+  } catch (const std::exception&) { record.status = kBatchUnknownError; }
+  return record;
+}
+
+BatchStats BatchMatcher::Match(std::istream& traces,
+                               std::ostream& records,
+                               const Format format,
+                               const std::function<void()>* interrupt) {
+  const auto start = std::chrono::steady_clock::now();
+  BatchStats stats;
+
+  std::vector<Api> chunk(chunk_size_);
+  std::vector<uint32_t> parse_errors(chunk_size_);
+  std::vector<std::string> bytes(chunk_size_);
+  std::vector<uint64_t> points(factories_.size());
+  std::vector<uint64_t> matched(factories_.size());
+  bool done = false;
+  while (!done) {
+    if (interrupt) {
+      (*interrupt)();
+    }
+
+    // read a chunk, a trace that doesnt parse still gets its record
+    size_t count = 0;
+    for (; count < chunk_size_; ++count) {
+      chunk[count].Clear();
+      parse_errors[count] = kBatchMatched;
+      try {
+        if (!read_trace(traces, format, chunk[count])) {
+          done = true;
+          break;
+        }
+      } catch (const valhalla_exception_t& e) {
+        parse_errors[count] = e.code;
+      } catch (const std::exception& e) {
+        // the rest of a pbf stream cant be trusted
+        if (format == Format::kPbf) {
+          throw;
+        }
+        parse_errors[count] = kBatchUnknownError;
+      }
+    }
+    if (count == 0) {
+      break;
+    }
+
+    // match the chunk on as many threads as we have or need
+    std::atomic<size_t> next_trace{0};
+    auto match_traces = [&](const size_t thread) {
+      for (size_t i = next_trace++; i < count; i = next_trace++) {
+        BatchRecord record{stats.traces + i, parse_errors[i], {}, {}};
+        if (record.status == kBatchMatched) {
+          record = MatchTrace(thread, record.index, chunk[i], points[thread]);
+        }
+        matched[thread] += record.status == kBatchMatched;
+        bytes[i].clear();
+        WriteRecord(bytes[i], record, output_);
+      }
+      factories_[thread]->ClearFullCache();
+    };
+
+    const size_t thread_count = std::min(factories_.size(), count);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+      threads.emplace_back(match_traces, i);
+    }
+    match_traces(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // write the chunk in the order it was read
+    for (size_t i = 0; i < count; ++i) {
+      records.write(bytes[i].data(), bytes[i].size());
+    }
+    stats.traces += count;
+  }
+
+  for (size_t i = 0; i < factories_.size(); ++i) {
+    stats.points += points[i];
+    stats.matched += matched[i];
+  }
+  stats.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+void BatchMatcher::WriteRecord(std::string& bytes,
+                               const BatchRecord& record,
+                               const Output output) {
+  const bool speeds = output == Output::kSpeeds;
+  const uint32_t count = speeds ? record.speeds.size() : record.edges.size();
+  bytes.append(reinterpret_cast<const char*>(&record.index), sizeof(record.index));
+  bytes.append(reinterpret_cast<const char*>(&record.status), sizeof(record.status));
+  bytes.append(reinterpret_cast<const char*>(&count), sizeof(count));
+  if (speeds) {
+    bytes.append(reinterpret_cast<const char*>(record.speeds.data()),
+                 count * sizeof(SpeedObservation));
+  } else {
+    bytes.append(reinterpret_cast<const char*>(record.edges.data()), count * sizeof(uint64_t));
+  }
+}
+
+bool BatchMatcher::ReadRecord(std::istream& records, BatchRecord& record, const Output output) {
+  uint32_t count = 0;
+  if (!records.read(reinterpret_cast<char*>(&record.index), sizeof(record.index)) ||
+      !records.read(reinterpret_cast<char*>(&record.status), sizeof(record.status)) ||
+      !records.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+  record.edges.clear();
+  record.speeds.clear();
+  if (output == Output::kSpeeds) {
+    record.speeds.resize(count);
+    return static_cast<bool>(records.read(reinterpret_cast<char*>(record.speeds.data()),
+                                          count * sizeof(SpeedObservation)));
+  }
+  record.edges.resize(count);
+  return static_cast<bool>(
+      records.read(reinterpret_cast<char*>(record.edges.data()), count * sizeof(uint64_t)));
+}
+
+} // namespace meili
+} // namespace valhalla
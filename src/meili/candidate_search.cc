@@ -12,128 +12,88 @@ constexpr double kSnapToNodeDistance = 1.0; // meters
 
 namespace meili {
 
-struct CandidateCollector {
-public:
-  explicit CandidateCollector(baldr::GraphReader& reader) : reader_(reader) {
-  }
-
-  template <typename edgeid_iterator_t>
-  std::vector<baldr::PathLocation> WithinSquaredDistance(const midgard::PointLL& location,
-                                                         baldr::Location::StopType stop_type,
-                                                         float sq_search_radius,
-                                                         edgeid_iterator_t edgeid_begin,
-                                                         edgeid_iterator_t edgeid_end,
-                                                         const sif::cost_ptr_t& costing) const;
-
-private:
-  baldr::GraphReader& reader_;
-};
-
-template <typename edgeid_iterator_t>
-std::vector<baldr::PathLocation>
-CandidateCollector::WithinSquaredDistance(const midgard::PointLL& location,
-                                          baldr::Location::StopType stop_type,
-                                          float sq_search_radius,
-                                          edgeid_iterator_t edgeid_begin,
-                                          edgeid_iterator_t edgeid_end,
-                                          const sif::cost_ptr_t& costing) const {
-  std::vector<baldr::PathLocation> candidates;
-  std::unordered_set<baldr::GraphId> visited_nodes;
-  midgard::projector_t projector(location);
-  graph_tile_ptr tile;
+namespace {
 
-  for (auto it = edgeid_begin; it != edgeid_end; it++) {
-    const auto& edgeid = *it;
-    if (!edgeid.Is_Valid()) {
-      continue;
-    }
-
-    // Get the edge. Transition edges are not allowed so we do not need to check node levels.
-    const auto* edge = reader_.directededge(edgeid, tile);
-    if (!edge) {
-      continue;
-    }
-
-    // Get the opposing edge as well
-    auto opp_tile = tile;
-    const baldr::DirectedEdge* opp_edge = nullptr;
-    const auto opp_edgeid = reader_.GetOpposingEdgeId(edgeid, opp_edge, opp_tile);
-    if (!opp_edgeid.Is_Valid()) {
-      continue;
-    }
+// The key of a square of the grid of a bin
+inline uint64_t cell_key(const int32_t bin_id, const uint32_t square) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(bin_id)) << 32) | square;
+}
 
-    // Get at the shape
-    auto shape = tile->edgeinfo(edge).lazy_shape();
-    if (shape.empty()) {
-      // Otherwise Project will fail
-      continue;
+// Projects the location onto an edge and its opposing edge and adds them as a candidate if they are
+// within the search radius
+template <typename shape_t>
+void Correlate(const midgard::projector_t& projector,
+               const midgard::PointLL& location,
+               baldr::Location::StopType stop_type,
+               float sq_search_radius,
+               const baldr::GraphId& edgeid,
+               const baldr::DirectedEdge* edge,
+               const bool edge_included,
+               const baldr::GraphId& opp_edgeid,
+               const baldr::DirectedEdge* opp_edge,
+               const bool oppedge_included,
+               shape_t& shape,
+               std::unordered_set<baldr::GraphId>& visited_nodes,
+               std::vector<baldr::PathLocation>& candidates) {
+  // Projection information
+  midgard::PointLL point;
+  double sq_distance = 0.0;
+  size_t segment;
+  double offset;
+
+  baldr::GraphId snapped_node;
+  baldr::PathLocation correlated(baldr::Location(location, stop_type));
+
+  if (edge_included) {
+    std::tie(point, sq_distance, segment, offset) =
+        helpers::Project(projector, shape, kSnapToNodeDistance);
+
+    if (sq_distance <= sq_search_radius) {
+      const double dist = edge->forward() ? offset : 1.0 - offset;
+      if (dist == 1.0) {
+        snapped_node = edge->endnode();
+      } else if (dist == 0.0) {
+        snapped_node = opp_edge->endnode();
+      }
+      correlated.edges.emplace_back(edgeid, dist, point, sq_distance);
     }
+  }
 
-    // Projection information
-    midgard::PointLL point;
-    double sq_distance = 0.0;
-    size_t segment;
-    double offset;
-
-    baldr::GraphId snapped_node;
-    baldr::PathLocation correlated(baldr::Location(location, stop_type));
-
-    // For avoiding recomputing projection later
-    const bool edge_included = !costing || costing->Allowed(edge, tile, sif::kDisallowShortcut);
-
-    if (edge_included) {
+  // Correlate its opp edge
+  if (oppedge_included) {
+    // No need to project again if we already did it above
+    if (!edge_included) {
       std::tie(point, sq_distance, segment, offset) =
           helpers::Project(projector, shape, kSnapToNodeDistance);
-
-      if (sq_distance <= sq_search_radius) {
-        const double dist = edge->forward() ? offset : 1.0 - offset;
-        if (dist == 1.0) {
-          snapped_node = edge->endnode();
-        } else if (dist == 0.0) {
-          snapped_node = opp_edge->endnode();
-        }
-        correlated.edges.emplace_back(edgeid, dist, point, sq_distance);
-      }
     }
-
-    bool oppedge_included = !costing || costing->Allowed(opp_edge, opp_tile, sif::kDisallowShortcut);
-
-    // Correlate its opp edge
-    if (oppedge_included) {
-      // No need to project again if we already did it above
-      if (!edge_included) {
-        std::tie(point, sq_distance, segment, offset) =
-            helpers::Project(projector, shape, kSnapToNodeDistance);
-      }
-      if (sq_distance <= sq_search_radius) {
-        const double dist = opp_edge->forward() ? offset : 1.0 - offset;
-        if (dist == 1.0) {
-          snapped_node = opp_edge->endnode();
-        } else if (dist == 0.0) {
-          snapped_node = edge->endnode();
-        }
-        correlated.edges.emplace_back(opp_edgeid, dist, point, sq_distance);
+    if (sq_distance <= sq_search_radius) {
+      const double dist = opp_edge->forward() ? offset : 1.0 - offset;
+      if (dist == 1.0) {
+        snapped_node = opp_edge->endnode();
+      } else if (dist == 0.0) {
+        snapped_node = edge->endnode();
       }
+      correlated.edges.emplace_back(opp_edgeid, dist, point, sq_distance);
     }
+  }
 
-    // We found some edge candidates within the distance cut off
-    if (correlated.edges.size()) {
-      // If the candidates are not at a node we just add them if they are at a node
-      // we avoid adding them multiple times by remembering the node we snapped to
-      // this has two consequences:
-      // 1. it allows us to keep the number of edge candidates low which keeps the search fast
-      // 2. in routing.cc we will find a route to the node, ie not the candidate edge, which means
-      //    the route may not end or begin with the candidates we store here, we will need to
-      //    handle this case inside of FindMatchResult which expects a candidate to be used
-      if (!snapped_node.Is_Valid() || visited_nodes.insert(snapped_node).second) {
-        candidates.emplace_back(std::move(correlated));
-      }
+  // We found some edge candidates within the distance cut off
+  if (correlated.edges.size()) {
+    // If the candidates are not at a node we just add them if they are at a node
+    // we avoid adding them multiple times by remembering the node we snapped to
+    // this has two consequences:
+    // 1. it allows us to keep the number of edge candidates low which keeps the search fast
+    // 2. in routing.cc we will find a route to the node, ie not the candidate edge, which means
+    //    the route may not end or begin with the candidates we store here, we will need to
+    //    handle this case inside of FindMatchResult which expects a candidate to be used
+    if (!snapped_node.Is_Valid() || visited_nodes.insert(snapped_node).second) {
+      candidates.emplace_back(std::move(correlated));
     }
   }
-
-  return candidates;
 }
 
+} // namespace
+
 // Add each road linestring's line segments into grid. Only one side
 // of directed edges is added
 void IndexBin(const graph_tile_ptr& tile,
@@ -232,12 +192,133 @@ CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range) const {
   return result;
 }
 
+void CandidateGridQuery::MoveWindow(const AABB2<midgard::PointLL>& range) const {
+  const Tiles<PointLL>& tiles = baldr::TileHierarchy::levels().back().tiles;
+  Tiles<PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
+
+  // The cells of the range
+  next_cells_.clear();
+  for (auto bin_id : bins.TileList(range)) {
+    const auto* grid = GetGrid(bin_id, tiles, bins);
+    if (!grid) {
+      continue;
+    }
+    int mincol, minrow, maxcol, maxrow;
+    std::tie(mincol, minrow, maxcol, maxrow) = grid->SquareRange(range);
+    for (int row = minrow; row <= maxrow; ++row) {
+      for (int col = mincol; col <= maxcol; ++col) {
+        next_cells_.push_back(cell_key(bin_id, col + row * grid->ncols()));
+      }
+    }
+  }
+  std::sort(next_cells_.begin(), next_cells_.end());
+
+  // Add or drop the edges of a cell that joins or leaves the window
+  auto update = [this](const uint64_t cell, const bool joins) {
+    const auto grid = grid_cache_.find(static_cast<int32_t>(cell >> 32));
+    if (grid == grid_cache_.end()) {
+      return;
+    }
+    const auto square = static_cast<uint32_t>(cell);
+    const auto ncols = grid->second.ncols();
+    for (const auto& edgeid : grid->second.GetItemsInSquare(square % ncols, square / ncols)) {
+      if (joins) {
+        ++window_edges_[edgeid].cells;
+        continue;
+      }
+      const auto it = window_edges_.find(edgeid);
+      if (it != window_edges_.end() && --it->second.cells == 0) {
+        window_edges_.erase(it);
+      }
+    }
+  };
+
+  // Both are sorted so one walk finds the cells only one of them has
+  auto current = window_cells_.cbegin();
+  auto next = next_cells_.cbegin();
+  while (current != window_cells_.cend() || next != next_cells_.cend()) {
+    if (next == next_cells_.cend() || (current != window_cells_.cend() && *current < *next)) {
+      update(*current++, false);
+    } else if (current == window_cells_.cend() || *next < *current) {
+      update(*next++, true);
+    } else {
+      ++current;
+      ++next;
+    }
+  }
+  window_cells_.swap(next_cells_);
+}
+
+bool CandidateGridQuery::Resolve(const baldr::GraphId& edgeid, WindowEdge& window_edge) const {
+  if (!window_edge.resolved) {
+    window_edge.resolved = true;
+    window_edge.allowed_by = window_costings_ + 1;
+    if (!edgeid.Is_Valid()) {
+      return false;
+    }
+
+    // Get the edge. Transition edges are not allowed so we do not need to check node levels.
+    window_edge.edge = reader_.directededge(edgeid, window_edge.tile);
+    if (!window_edge.edge) {
+      return false;
+    }
+
+    // Get the opposing edge as well
+    window_edge.opp_tile = window_edge.tile;
+    window_edge.opp_edgeid =
+        reader_.GetOpposingEdgeId(edgeid, window_edge.opp_edge, window_edge.opp_tile);
+    if (!window_edge.opp_edgeid.Is_Valid()) {
+      return false;
+    }
+
+    // Get at the shape, without one Project would fail
+    auto shape = window_edge.tile->edgeinfo(window_edge.edge).lazy_shape();
+    while (!shape.empty()) {
+      window_edge.shape.push_back(shape.pop());
+    }
+    window_edge.usable = !window_edge.shape.empty();
+  }
+
+  // The flags are for the costing they were computed with
+  if (window_edge.usable && window_edge.allowed_by != window_costings_) {
+    window_edge.allowed_by = window_costings_;
+    const auto& costing = window_costing_;
+    window_edge.edge_allowed =
+        !costing || costing->Allowed(window_edge.edge, window_edge.tile, sif::kDisallowShortcut);
+    window_edge.opp_edge_allowed =
+        !costing ||
+        costing->Allowed(window_edge.opp_edge, window_edge.opp_tile, sif::kDisallowShortcut);
+  }
+  return window_edge.usable;
+}
+
 std::vector<baldr::PathLocation> CandidateGridQuery::Query(const midgard::PointLL& location,
                                                            baldr::Location::StopType stop_type,
                                                            float sq_search_radius,
                                                            const sif::cost_ptr_t& costing) const {
-  CandidateCollector collector(reader_);
-  return Query(location, stop_type, sq_search_radius, costing, collector);
+  if (!location.IsValid()) {
+    throw std::invalid_argument("Expect a valid location");
+  }
+
+  // What the costing allows is looked up again for the edges of the window
+  if (costing != window_costing_) {
+    window_costing_ = costing;
+    ++window_costings_;
+  }
+  MoveWindow(midgard::ExpandMeters(location, std::sqrt(sq_search_radius)));
+
+  std::vector<baldr::PathLocation> candidates;
+  std::unordered_set<baldr::GraphId> visited_nodes;
+  midgard::projector_t projector(location);
+  for (auto& window_edge : window_edges_) {
+    auto& edge = window_edge.second;
+    if (Resolve(window_edge.first, edge)) {
+      Correlate(projector, location, stop_type, sq_search_radius, window_edge.first, edge.edge,
+                edge.edge_allowed, edge.opp_edgeid, edge.opp_edge, edge.opp_edge_allowed,
+                edge.shape, visited_nodes, candidates);
+    }
+  }
+  return candidates;
 }
 
 } // namespace meili
@@ -37,6 +37,8 @@ void Config::Read(const boost::property_tree::ptree& params) {
   transition_cost.Read(params);
   emission_cost.Read(params);
   routing.Read(params);
+  viterbi.Read(params);
+  session.Read(params);
 }
 
 void Config::CandidateSearch::Read(const boost::property_tree::ptree& params) {
@@ -108,5 +110,26 @@ void Config::Routing::Read(const boost::property_tree::ptree& params) {
   }
 }
 
+void Config::Viterbi::Read(const boost::property_tree::ptree& params) {
+  ReadParamOptional(beam_width, params, "default.beam_width");
+
+  ReadParamOptional(beam_cost_gap, params, "default.beam_cost_gap");
+  CHECK_THROWS(beam_cost_gap >= 0.f, NONNEGATIVE_VALUE_MSG(beam_cost_gap, "beam_cost_gap"));
+
+  if (const auto node = params.get_child_optional("customizable")) {
+    is_beam_width_customizable = FindValue(*node, "beam_width");
+    is_beam_cost_gap_customizable = FindValue(*node, "beam_cost_gap");
+  }
+}
+
+void Config::Session::Read(const boost::property_tree::ptree& params) {
+  ReadParamOptional(finalize_lag, params, "session.finalize_lag");
+
+  ReadParamOptional(max_window, params, "session.max_window");
+  CHECK_THROWS(max_window > finalize_lag + 1,
+               std::string("Expect 'max_window' to be greater than 'finalize_lag' + 1 (got: ") +
+                   std::to_string(max_window) + ")");
+}
+
 } // namespace meili
 } // namespace valhalla
\ No newline at end of file
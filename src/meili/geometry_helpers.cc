@@ -10,13 +10,32 @@ using namespace valhalla;
 using namespace valhalla::meili;
 using namespace valhalla::midgard;
 
-namespace valhalla {
-namespace meili {
-namespace helpers {
+namespace {
+
+// Pops the points of a decoded shape like the decoder does
+class ShapeCursor {
+public:
+  explicit ShapeCursor(const std::vector<PointLL>& shape)
+      : it_(shape.cbegin()), end_(shape.cend()) {
+  }
+
+  PointLL pop() {
+    return *it_++;
+  }
+
+  bool empty() const {
+    return it_ == end_;
+  }
+
+private:
+  std::vector<PointLL>::const_iterator it_;
+  std::vector<PointLL>::const_iterator end_;
+};
 
 // snapped point, squared distance, segment index, offset
+template <typename shape_t>
 std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
-Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double snap_distance) {
+ProjectShape(const projector_t& p, shape_t& shape, double snap_distance) {
   PointLL first_point(shape.pop());
   auto closest_point = first_point;
   auto closest_segment_point = first_point;
@@ -96,6 +115,23 @@ Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double sna
   return std::make_tuple(std::move(closest_point), closest_distance, closest_segment, percent_along);
 }
 
+} // namespace
+
+namespace valhalla {
+namespace meili {
+namespace helpers {
+
+std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
+Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double snap_distance) {
+  return ProjectShape(p, shape, snap_distance);
+}
+
+std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
+Project(const projector_t& p, const std::vector<PointLL>& shape, double snap_distance) {
+  ShapeCursor cursor(shape);
+  return ProjectShape(p, cursor, snap_distance);
+}
+
 } // namespace helpers
 } // namespace meili
 } // namespace valhalla
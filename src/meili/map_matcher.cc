@@ -505,6 +505,7 @@ MapMatcher::MapMatcher(const Config& config,
                              config_.transition_cost) {
   vs_.set_emission_cost_model(emission_cost_model_);
   vs_.set_transition_cost_model(transition_cost_model_);
+  vs_.set_beam(config_.viterbi.beam_width, config_.viterbi.beam_cost_gap);
 }
 
 MapMatcher::~MapMatcher() {
@@ -517,6 +518,7 @@ void MapMatcher::Clear() {
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  transition_cost_model_.ClearCache();
 }
 
 void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result,
@@ -867,7 +869,8 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
 }
 
 StateId::Time MapMatcher::AppendMeasurement(const Measurement& measurement,
-                                            const float sq_max_search_radius) {
+                                            const float sq_max_search_radius,
+                                            const baldr::GraphId& pinned_edge) {
   // Test interrupt
   if (interrupt_) {
     (*interrupt_)();
@@ -876,9 +879,26 @@ StateId::Time MapMatcher::AppendMeasurement(const Measurement& measurement,
   auto sq_radius = std::min(sq_max_search_radius,
                             std::max(measurement.sq_search_radius(), measurement.sq_gps_accuracy()));
 
-  const auto& candidates =
+  auto candidates =
       candidatequery_.Query(measurement.lnglat(), measurement.stop_type(), sq_radius, costing());
 
+  // Keep only the candidates on the pinned edge if there are any
+  if (pinned_edge.Is_Valid()) {
+    std::vector<baldr::PathLocation> pinned;
+    for (const auto& candidate : candidates) {
+      for (const auto& edge : candidate.edges) {
+        if (edge.id == pinned_edge) {
+          pinned.push_back(candidate);
+          pinned.back().edges = {edge};
+          break;
+        }
+      }
+    }
+    if (!pinned.empty()) {
+      candidates = std::move(pinned);
+    }
+  }
+
   const auto time = container_.AppendMeasurement(measurement);
 
   for (const auto& candidate : candidates) {
@@ -889,5 +909,42 @@ StateId::Time MapMatcher::AppendMeasurement(const Measurement& measurement,
   return time;
 }
 
+StateId::Time MapMatcher::AppendOnline(const Measurement& measurement,
+                                       const baldr::GraphId& pinned_edge) {
+  const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
+                                     config_.candidate_search.max_search_radius_meters;
+  return AppendMeasurement(measurement, sq_max_search_radius, pinned_edge);
+}
+
+std::vector<MatchResult> MapMatcher::OnlineResults(StateId::Time begin, StateId::Time end) {
+  end = std::min<StateId::Time>(end, container_.size());
+  if (begin >= end) {
+    return {};
+  }
+
+  // Get the states of the best path in reversed order, across any discontinuities
+  std::vector<StateId> state_ids;
+  state_ids.reserve(container_.size());
+  while (state_ids.size() < container_.size()) {
+    const auto time = container_.size() - state_ids.size() - 1;
+    std::copy(vs_.SearchPathVS(time, false), vs_.PathEnd(), std::back_inserter(state_ids));
+  }
+
+  // Get back the real state ids in order
+  std::vector<StateId> original_state_ids;
+  original_state_ids.reserve(state_ids.size());
+  for (auto s_itr = state_ids.rbegin(); s_itr != state_ids.rend(); ++s_itr) {
+    original_state_ids.push_back(ts_.GetOrigin(*s_itr, *s_itr));
+  }
+
+  // Only find the results that were asked for
+  std::vector<MatchResult> results;
+  results.reserve(end - begin);
+  for (auto time = begin; time < end; ++time) {
+    results.push_back(FindMatchResult(*this, original_state_ids, time, graphreader_));
+  }
+  return results;
+}
+
 } // namespace meili
 } // namespace valhalla
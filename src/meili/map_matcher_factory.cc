@@ -74,6 +74,12 @@ Config MapMatcherFactory::MergeConfig(const Options& options) const {
       config.routing.is_interpolation_distance_customizable) {
     config.routing.interpolation_distance_meters = options.interpolation_distance();
   }
+  if (options.has_beam_width_case() && config.viterbi.is_beam_width_customizable) {
+    config.viterbi.beam_width = options.beam_width();
+  }
+  if (options.has_beam_cost_gap_case() && config.viterbi.is_beam_cost_gap_customizable) {
+    config.viterbi.beam_cost_gap = options.beam_cost_gap();
+  }
 
   // Give it back
   return config;
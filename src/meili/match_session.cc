@@ -0,0 +1,121 @@
+#include <algorithm>
+
+#include "meili/match_session.h"
+
+namespace valhalla {
+namespace meili {
+
+MatchSession::MatchSession(MapMatcher* matcher)
+    : matcher_(matcher), window_begin_(0), finalized_(0), anchor_(), has_anchor_(false) {
+  matcher_->Clear();
+}
+
+MatchSession::~MatchSession() {
+}
+
+MatchResults MatchSession::Push(const std::vector<Measurement>& measurements) {
+  const auto& session = matcher_->config().session;
+  std::vector<MatchResult> results;
+  std::vector<EdgeSegment> segments;
+  for (const auto& measurement : measurements) {
+    // make room by finalizing what we can and dropping it from the search
+    if (window_.size() >= session.max_window) {
+      Finalize(pushed() - session.finalize_lag, results, segments);
+      Prune();
+    }
+    window_.push_back(measurement);
+    matcher_->AppendOnline(measurement);
+  }
+
+  if (pushed() > session.finalize_lag) {
+    Finalize(pushed() - session.finalize_lag, results, segments);
+  }
+  return MatchResults(std::move(results), std::move(segments), 0.f);
+}
+
+MatchResults MatchSession::Finish() {
+  std::vector<MatchResult> results;
+  std::vector<EdgeSegment> segments;
+  Finalize(pushed(), results, segments);
+
+  // start over for the next trace
+  matcher_->Clear();
+  window_.clear();
+  window_begin_ = 0;
+  finalized_ = 0;
+  has_anchor_ = false;
+  return MatchResults(std::move(results), std::move(segments), 0.f);
+}
+
+void MatchSession::Finalize(const size_t end,
+                            std::vector<MatchResult>& results,
+                            std::vector<EdgeSegment>& segments) {
+  if (end <= finalized_) {
+    return;
+  }
+
+  // the results of the best path so far, from the first one that isnt final yet
+  auto finalized = matcher_->OnlineResults(finalized_ - window_begin_, end - window_begin_);
+
+  // route from the last finalized result so the path continues where the last one stopped
+  std::vector<MatchResult> route_results;
+  route_results.reserve(finalized.size() + 1);
+  size_t first_idx = finalized_;
+  if (has_anchor_) {
+    route_results.push_back(anchor_);
+    --first_idx;
+  }
+  route_results.insert(route_results.end(), finalized.begin(), finalized.end());
+  auto route = ConstructRoute(*matcher_, route_results);
+
+  // shift the match indices to the session and merge with the path of this push
+  auto segment = route.begin();
+  for (; segment != route.end(); ++segment) {
+    if (segment->first_match_idx >= 0) {
+      segment->first_match_idx += first_idx;
+    }
+    if (segment->last_match_idx >= 0) {
+      segment->last_match_idx += first_idx;
+    }
+  }
+  segment = route.begin();
+  if (segment != route.end() && !segments.empty() && !segments.back().discontinuity &&
+      segments.back().edgeid == segment->edgeid) {
+    segments.back().target = segment->target;
+    if (segment->last_match_idx != -1) {
+      segments.back().last_match_idx = segment->last_match_idx;
+    }
+    segments.back().discontinuity = segment->discontinuity;
+    ++segment;
+  }
+  segments.insert(segments.end(), segment, route.end());
+
+  // only the last finalized result can anchor the next ones
+  has_anchor_ = finalized.back().GetType() == MatchResult::Type::kMatched;
+  if (has_anchor_) {
+    anchor_ = finalized.back();
+  }
+  results.insert(results.end(), finalized.begin(), finalized.end());
+  finalized_ = end;
+}
+
+void MatchSession::Prune() {
+  // keep what isnt final yet and the anchor before it
+  const size_t keep = finalized_ - window_begin_ - (has_anchor_ ? 1 : 0);
+  window_.erase(window_.begin(), window_.begin() + keep);
+  window_begin_ += keep;
+
+  // search again from the anchor which can only be matched where it was before
+  matcher_->Clear();
+  for (size_t i = 0; i < window_.size(); ++i) {
+    matcher_->AppendOnline(window_[i],
+                           i == 0 && has_anchor_ ? anchor_.edgeid : baldr::GraphId());
+  }
+  if (has_anchor_) {
+    has_anchor_ = matcher_->state_container().column(0).size() == 1;
+    anchor_.stateid = StateId(0, 0);
+  }
+}
+
+} // namespace meili
+} // namespace valhalla
@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "meili/openlr_matcher.h"
+#include "midgard/util.h"
+#include "worker.h"
+
+namespace {
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::meili;
+
+using FormOfWay = OpenLR::LocationReferencePoint::FormOfWay;
+
+constexpr size_t kDefaultChunkSize = 1024;
+constexpr float kDefaultSearchRadius = 50.f;
+// points can be almost 15km apart, the matcher has to route at least that far between them
+constexpr float kDefaultBreakageDistance = 20000.f;
+
+// the longest distance a point can give to the next one
+const double kMaxPointDistance = OpenLR::integer2distance(255);
+
+// how far the length of a decoded path may be off the length of its reference, on top of the
+// rounding of the distance of each point
+constexpr double kLengthTolerance = 0.35;
+
+// how far along an edge its bearing is taken, 20m as the white paper recommends
+constexpr float kBearingDistance = 20.f;
+
+FormOfWay get_fow(const DirectedEdge* de) {
+  if (de->classification() == baldr::RoadClass::kMotorway) {
+    return FormOfWay::MOTORWAY;
+  } else if (de->roundabout()) {
+    return FormOfWay::ROUNDABOUT;
+  } else if (de->use() == Use::kRamp || de->use() == Use::kTurnChannel) {
+    return FormOfWay::SLIPROAD;
+  } else if ((de->forwardaccess() & kVehicularAccess) && (de->reverseaccess() & kVehicularAccess)) {
+    return FormOfWay::MULTIPLE_CARRIAGEWAY;
+  } else if ((de->forwardaccess() & kVehicularAccess) || (de->reverseaccess() & kVehicularAccess)) {
+    return FormOfWay::SINGLE_CARRIAGEWAY;
+  }
+  return FormOfWay::OTHER;
+}
+
+// where a point is, what it says about the edge at it and about the path to the next point
+struct point_t {
+  midgard::PointLL ll;
+  float bearing;
+  uint8_t frc;
+  FormOfWay fow;
+  double distance;
+  uint8_t lfrcnp;
+};
+
+/**
+ * Reads a chunk of inputs, converts them on the threads and writes what they were converted to in
+ * the order they were read, until the inputs run out.
+ * @param read     reads the next input, false when there are no more
+ * @param convert  converts an input on a thread, appends the output and tells if it succeeded
+ * @param finish   called on each thread when it is done with a chunk
+ */
+template <typename input_t, typename read_t, typename convert_t, typename finish_t>
+OpenLrStats convert_chunks(const size_t chunk_size,
+                           const size_t threads,
+                           std::ostream& out,
+                           const read_t& read,
+                           const convert_t& convert,
+                           const finish_t& finish) {
+  const auto start = std::chrono::steady_clock::now();
+  OpenLrStats stats;
+
+  std::vector<input_t> chunk(chunk_size);
+  std::vector<std::string> bytes(chunk_size);
+  std::vector<uint64_t> converted(threads);
+  bool done = false;
+  while (!done) {
+    size_t count = 0;
+    for (; count < chunk_size; ++count) {
+      if (!read(chunk[count])) {
+        done = true;
+        break;
+      }
+    }
+    if (count == 0) {
+      break;
+    }
+
+    std::atomic<size_t> next{0};
+    auto convert_inputs = [&](const size_t thread) {
+      for (size_t i = next++; i < count; i = next++) {
+        bytes[i].clear();
+        converted[thread] += convert(thread, stats.references + i, chunk[i], bytes[i]);
+      }
+      finish(thread);
+    };
+
+    const size_t thread_count = std::min(threads, count);
+    std::vector<std::thread> pool;
+    pool.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+      pool.emplace_back(convert_inputs, i);
+    }
+    convert_inputs(0);
+    for (auto& thread : pool) {
+      thread.join();
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      out.write(bytes[i].data(), bytes[i].size());
+    }
+    stats.references += count;
+  }
+
+  for (const auto c : converted) {
+    stats.converted += c;
+  }
+  stats.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+std::vector<uint64_t>
+DecodeOpenLr(const OpenLR::OpenLr& reference, MapMatcher& matcher, const float search_radius) {
+  if (reference.isPointAlongLine) {
+    throw std::invalid_argument("Only OpenLR line references can be decoded");
+  }
+
+  std::vector<Measurement> measurements;
+  measurements.reserve(reference.lrps.size());
+  const float accuracy = matcher.config().emission_cost.gps_accuracy_meters;
+  for (const auto& lrp : reference.lrps) {
+    measurements.emplace_back(midgard::PointLL{lrp.longitude, lrp.latitude}, accuracy,
+                              search_radius);
+  }
+  const auto match = std::move(matcher.OfflineMatch(measurements).front());
+
+  // every point has to be on the one path
+  const auto& segments = match.segments;
+  for (const auto& result : match.results) {
+    if (!result.HasState()) {
+      throw valhalla_exception_t{444};
+    }
+  }
+  if (segments.empty()) {
+    throw valhalla_exception_t{444};
+  }
+  for (size_t i = 0; i + 1 < segments.size(); ++i) {
+    if (segments[i].discontinuity) {
+      throw valhalla_exception_t{442};
+    }
+  }
+
+  std::vector<double> lengths;
+  lengths.reserve(segments.size());
+  double total = 0;
+  graph_tile_ptr tile;
+  for (const auto& segment : segments) {
+    const auto* edge = matcher.graphreader().directededge(segment.edgeid, tile);
+    lengths.push_back(edge ? edge->length() * (segment.target - segment.source) : 0);
+    total += lengths.back();
+  }
+
+  // a path of another length is not the one the reference was made from
+  const double length = reference.getLength();
+  if (std::abs(total - length) >
+      length * kLengthTolerance + OpenLR::integer2distance(1) * (reference.lrps.size() - 1)) {
+    throw valhalla_exception_t{444};
+  }
+
+  // the offsets are 1/256th buckets of the distance of the first and of the next to last point
+  const double skip_front =
+      reference.poff ? (reference.poff + .5) / 256 * reference.lrps.front().distance : 0;
+  const double skip_back =
+      reference.noff ? (reference.noff + .5) / 256 * std::prev(reference.lrps.end(), 2)->distance
+                     : 0;
+
+  // the pieces of edges at the points have no length and those within the offsets are not part of
+  // the location
+  std::vector<uint64_t> edges;
+  double along = 0;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const double start = along;
+    along += lengths[i];
+    if (lengths[i] <= 0 || along <= skip_front || start >= total - skip_back) {
+      continue;
+    }
+    if (edges.empty() || edges.back() != segments[i].edgeid) {
+      edges.push_back(segments[i].edgeid);
+    }
+  }
+  if (edges.empty()) {
+    throw valhalla_exception_t{444};
+  }
+  return edges;
+}
+
+OpenLR::OpenLr EncodeOpenLr(const std::vector<uint64_t>& edges, GraphReader& reader) {
+  if (edges.empty()) {
+    throw std::invalid_argument("No edges to encode");
+  }
+
+  std::vector<point_t> points;
+  std::vector<midgard::PointLL> shape;
+  graph_tile_ptr tile;
+  const DirectedEdge* edge = nullptr;
+  for (const auto id : edges) {
+    edge = reader.directededge(GraphId(id), tile);
+    if (edge == nullptr) {
+      throw std::invalid_argument("Unknown edge " + std::to_string(id));
+    }
+    if (edge->length() > kMaxPointDistance) {
+      throw std::invalid_argument("Edge " + std::to_string(id) + " is too long for OpenLR");
+    }
+    const auto frc = static_cast<uint8_t>(edge->classification());
+
+    // a new point where the distance to the next one would get too long
+    if (points.empty() || points.back().distance + edge->length() > kMaxPointDistance) {
+      shape = tile->edgeinfo(edge).shape();
+      if (!edge->forward()) {
+        std::reverse(shape.begin(), shape.end());
+      }
+      const float bearing = midgard::tangent_angle(0, shape.front(), shape, kBearingDistance, true);
+      points.push_back({shape.front(), bearing, frc, get_fow(edge), 0., frc});
+    }
+    points.back().distance += edge->length();
+    points.back().lfrcnp = std::max(points.back().lfrcnp, frc);
+  }
+
+  // the last point is at the end of the last edge and looks back along it
+  shape = tile->edgeinfo(edge).shape();
+  if (!edge->forward()) {
+    std::reverse(shape.begin(), shape.end());
+  }
+  const auto frc = static_cast<uint8_t>(edge->classification());
+  const float bearing =
+      midgard::tangent_angle(shape.size() - 1, shape.back(), shape, kBearingDistance, false);
+  points.push_back({shape.back(), bearing, frc, get_fow(edge), 0., 0});
+
+  // each point is relative to the one before, they must not move while they are added
+  std::vector<OpenLR::LocationReferencePoint> lrps;
+  lrps.reserve(points.size());
+  for (const auto& point : points) {
+    lrps.emplace_back(point.ll.lng(), point.ll.lat(), point.bearing, point.frc, point.fow,
+                      lrps.empty() ? nullptr : &lrps.back(), point.distance, point.lfrcnp);
+  }
+  return OpenLR::OpenLr{lrps, 0, 0};
+}
+
+OpenLrMatcher::OpenLrMatcher(const boost::property_tree::ptree& root)
+    : chunk_size_(root.get<size_t>("meili.openlr.chunk_size", kDefaultChunkSize)),
+      search_radius_(root.get<float>("meili.openlr.search_radius", kDefaultSearchRadius)) {
+  chunk_size_ = std::max<size_t>(chunk_size_, 1);
+
+  const auto name = root.get<std::string>("meili.openlr.costing", "auto");
+  Costing::Type costing;
+  if (!Costing_Enum_Parse(name, &costing)) {
+    throw std::runtime_error("No costing method found for OpenLR: " + name);
+  }
+
+  // the points are much further apart than the measurements of a trace
+  auto config = root;
+  config.put("meili.default.breakage_distance",
+             root.get<float>("meili.openlr.breakage_distance", kDefaultBreakageDistance));
+  config.put("meili.default.interpolation_distance", 0.f);
+
+  size_t threads = root.get<size_t>("meili.openlr.threads", std::thread::hardware_concurrency());
+  threads = std::max<size_t>(threads, 1);
+  factories_.reserve(threads);
+  matchers_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    factories_.emplace_back(new MapMatcherFactory(config));
+    matchers_.emplace_back(factories_.back()->Create(costing));
+  }
+}
+
+OpenLrMatcher::~OpenLrMatcher() {
+}
+
+OpenLrStats OpenLrMatcher::Decode(std::istream& references, std::ostream& records) {
+  auto read = [&references](std::string& line) {
+    return static_cast<bool>(std::getline(references, line));
+  };
+
+  auto convert = [this](const size_t thread, const uint64_t index, std::string& line,
+                        std::string& bytes) {
+    BatchRecord record{index, kBatchMatched, {}, {}};
+    try {
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (line.empty()) {
+        throw std::invalid_argument("Empty OpenLR reference");
+      }
+      record.edges =
+          DecodeOpenLr(OpenLR::OpenLr(line, true), *matchers_[thread], search_radius_);
+    } catch (const valhalla_exception_t& e) {
+      record.status = e.code;
+    } catch (const std::exception&) { record.status = kBatchUnknownError; }
+    BatchMatcher::WriteRecord(bytes, record);
+    return record.status == kBatchMatched;
+  };
+
+  auto finish = [this](const size_t thread) { factories_[thread]->ClearFullCache(); };
+
+  return convert_chunks<std::string>(chunk_size_, factories_.size(), records, read, convert,
+                                     finish);
+}
+
+OpenLrStats OpenLrMatcher::Encode(std::istream& records, std::ostream& references) {
+  auto read = [&records](BatchRecord& record) {
+    return BatchMatcher::ReadRecord(records, record);
+  };
+
+  auto convert = [this](const size_t thread, const uint64_t, BatchRecord& record,
+                        std::string& bytes) {
+    bool encoded = false;
+    if (record.status == kBatchMatched && !record.edges.empty()) {
+      try {
+        bytes = EncodeOpenLr(record.edges, matchers_[thread]->graphreader()).toBase64();
+        encoded = true;
+      } catch (const std::exception&) {}
+    }
+    bytes.push_back('\n');
+    return encoded;
+  };
+
+  auto finish = [this](const size_t thread) { factories_[thread]->ClearFullCache(); };
+
+  return convert_chunks<BatchRecord>(chunk_size_, factories_.size(), references, read, convert,
+                                     finish);
+}
+
+} // namespace meili
+} // namespace valhalla
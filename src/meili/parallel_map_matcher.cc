@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "meili/parallel_map_matcher.h"
+#include "worker.h"
+
+namespace {
+
+using namespace valhalla;
+using namespace valhalla::meili;
+
+constexpr size_t kDefaultWindowSize = 1000;
+constexpr size_t kDefaultWindowOverlap = 50;
+
+EdgeSegment shift(EdgeSegment segment, const size_t offset) {
+  if (segment.first_match_idx >= 0) {
+    segment.first_match_idx += offset;
+  }
+  if (segment.last_match_idx >= 0) {
+    segment.last_match_idx += offset;
+  }
+  return segment;
+}
+
+// the last segment on the edge that holds the match
+std::vector<EdgeSegment>::const_iterator find_segment(const std::vector<EdgeSegment>& segments,
+                                                      const int match_idx,
+                                                      const baldr::GraphId& edgeid) {
+  auto found = std::find_if(segments.crbegin(), segments.crend(), [&](const EdgeSegment& segment) {
+    return segment.edgeid == edgeid && segment.first_match_idx >= 0 &&
+           segment.first_match_idx <= match_idx && match_idx <= segment.last_match_idx;
+  });
+  return found == segments.crend() ? segments.cend() : std::prev(found.base());
+}
+
+bool is_matched(const MatchResult& result) {
+  return result.GetType() == MatchResult::Type::kMatched;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+ParallelMapMatcher::ParallelMapMatcher(const boost::property_tree::ptree& root)
+    : window_size_(root.get<size_t>("meili.parallel.window_size", kDefaultWindowSize)),
+      window_overlap_(root.get<size_t>("meili.parallel.window_overlap", kDefaultWindowOverlap)) {
+  if (window_size_ < 2) {
+    throw std::invalid_argument("Expect 'window_size' to be at least 2 (got: " +
+                                std::to_string(window_size_) + ")");
+  }
+  if (window_overlap_ < 1 || window_overlap_ >= window_size_) {
+    throw std::invalid_argument("Expect 'window_overlap' to be between 1 and window_size - 1 (got: " +
+                                std::to_string(window_overlap_) + ")");
+  }
+
+  // every thread gets its own reader and candidate grid
+  size_t threads = root.get<size_t>("meili.parallel.threads", std::thread::hardware_concurrency());
+  threads = std::max<size_t>(threads, 1);
+  factories_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    factories_.emplace_back(new MapMatcherFactory(root));
+  }
+}
+
+ParallelMapMatcher::~ParallelMapMatcher() {
+}
+
+std::vector<ParallelMapMatcher::Window>
+ParallelMapMatcher::Windows(const std::vector<Measurement>& measurements,
+                            const float breakage_distance,
+                            const size_t window_size,
+                            const size_t window_overlap) {
+  std::vector<Window> windows;
+  const size_t count = measurements.size();
+
+  // cut a piece into overlapping windows, the last one has at least window_overlap + 1
+  auto add_piece = [&](const size_t piece_begin, const size_t piece_end) {
+    size_t begin = piece_begin;
+    while (true) {
+      size_t end = std::min(begin + window_size, piece_end);
+      windows.push_back({begin, end, begin != piece_begin});
+      if (end == piece_end) {
+        break;
+      }
+      begin = end - window_overlap;
+    }
+  };
+
+  // the matcher wont connect measurements past the breakage distance so we can cut there, as
+  // long as neither side is left with a single measurement that the matcher would refuse
+  size_t piece_begin = 0;
+  for (size_t i = 1; i < count; ++i) {
+    if (i - piece_begin >= 2 && count - i >= 2 &&
+        measurements[i - 1].lnglat().Distance(measurements[i].lnglat()) > breakage_distance) {
+      add_piece(piece_begin, i);
+      piece_begin = i;
+    }
+  }
+  if (piece_begin < count) {
+    add_piece(piece_begin, count);
+  }
+  return windows;
+}
+
+void ParallelMapMatcher::Stitch(std::vector<MatchResult>& results,
+                                std::vector<EdgeSegment>& segments,
+                                const Window& window,
+                                const MatchResults& match) {
+  const auto& window_results = match.results;
+  const auto& window_segments = match.segments;
+
+  // nothing to stitch to
+  if (results.empty()) {
+    results = window_results;
+    for (const auto& segment : window_segments) {
+      segments.push_back(shift(segment, window.begin));
+    }
+    return;
+  }
+
+  // a piece after a breakage is a discontinuity, just as it is for the sequential matcher
+  if (!window.overlaps) {
+    if (is_matched(results.back())) {
+      results.back().begins_discontinuity = true;
+    }
+    if (!segments.empty()) {
+      segments.back().discontinuity = true;
+    }
+    const size_t first = results.size();
+    results.insert(results.end(), window_results.begin(), window_results.end());
+    if (is_matched(results[first])) {
+      results[first].ends_discontinuity = true;
+    }
+    for (const auto& segment : window_segments) {
+      segments.push_back(shift(segment, window.begin));
+    }
+    return;
+  }
+
+  // look for a measurement in the overlap that both windows put on the same edge, starting from
+  // the middle where both windows have the most context around it
+  const size_t overlap_end = results.size();
+  const size_t middle = (window.begin + overlap_end) / 2;
+  for (size_t distance = 0; distance < overlap_end - window.begin; ++distance) {
+    for (int side : {-1, 1}) {
+      const size_t c = middle + side * static_cast<int64_t>(distance);
+      if (c < window.begin || c >= overlap_end || (distance == 0 && side > 0)) {
+        continue;
+      }
+      const auto& left = results[c];
+      const auto& right = window_results[c - window.begin];
+      if (!is_matched(left) || !is_matched(right) || left.edgeid != right.edgeid) {
+        continue;
+      }
+      auto left_segment = find_segment(segments, c, left.edgeid);
+      auto right_segment = find_segment(window_segments, c - window.begin, right.edgeid);
+      if (left_segment == segments.cend() || right_segment == window_segments.cend()) {
+        continue;
+      }
+
+      // join the two segments on the shared edge and carry on with the right window
+      EdgeSegment joined = *left_segment;
+      joined.target = right_segment->target;
+      joined.last_match_idx = right_segment->last_match_idx + window.begin;
+      joined.discontinuity = right_segment->discontinuity;
+      joined.restriction_idx = right_segment->restriction_idx;
+      segments.erase(left_segment, segments.cend());
+      segments.push_back(joined);
+      for (auto segment = std::next(right_segment); segment != window_segments.cend(); ++segment) {
+        segments.push_back(shift(*segment, window.begin));
+      }
+
+      results[c].begins_discontinuity = right.begins_discontinuity;
+      results.resize(c + 1);
+      results.insert(results.end(), window_results.begin() + (c - window.begin) + 1,
+                     window_results.end());
+      return;
+    }
+  }
+
+  // the windows disagree all over the overlap so we give up on connecting them in the middle
+  const size_t cut = std::max(middle, window.begin + 1);
+  while (!segments.empty() &&
+         (segments.back().first_match_idx < 0 ||
+          segments.back().first_match_idx >= static_cast<int>(cut))) {
+    segments.pop_back();
+  }
+  if (!segments.empty()) {
+    segments.back().last_match_idx =
+        std::min(segments.back().last_match_idx, static_cast<int>(cut) - 1);
+    segments.back().discontinuity = true;
+  }
+  const int local_cut = cut - window.begin;
+  auto segment = std::find_if(window_segments.cbegin(), window_segments.cend(),
+                              [local_cut](const EdgeSegment& segment) {
+                                return segment.last_match_idx >= local_cut;
+                              });
+  for (bool first = true; segment != window_segments.cend(); ++segment, first = false) {
+    segments.push_back(shift(*segment, window.begin));
+    if (first) {
+      segments.back().first_match_idx =
+          std::max(segment->first_match_idx, local_cut) + static_cast<int>(window.begin);
+    }
+  }
+
+  results.resize(cut);
+  results.insert(results.end(), window_results.begin() + local_cut, window_results.end());
+  if (is_matched(results[cut - 1])) {
+    results[cut - 1].begins_discontinuity = true;
+  }
+  if (is_matched(results[cut])) {
+    results[cut].ends_discontinuity = true;
+  }
+}
+
+MatchResults ParallelMapMatcher::Match(const Options& options,
+                                       const std::vector<Measurement>& measurements) {
+  if (measurements.empty()) {
+    return MatchResults({}, {}, 0);
+  }
+
+  const auto config = factories_.front()->MergeConfig(options);
+  const auto windows = Windows(measurements, config.transition_cost.breakage_distance_meters,
+                               window_size_, window_overlap_);
+
+  // match the windows on as many threads as we have or need
+  std::vector<std::unique_ptr<MatchResults>> matches(windows.size());
+  std::vector<std::exception_ptr> errors(windows.size());
+  std::atomic<size_t> next_window{0};
+  auto match_windows = [&](MapMatcherFactory& factory) {
+    std::unique_ptr<MapMatcher> matcher(factory.Create(options));
+    for (size_t i = next_window++; i < windows.size(); i = next_window++) {
+      const auto& window = windows[i];
+      std::vector<Measurement> window_measurements(measurements.begin() + window.begin,
+                                                   measurements.begin() + window.end);
+      try {
+        matches[i].reset(
+            new MatchResults(std::move(matcher->OfflineMatch(window_measurements).front())));
+      } catch (const valhalla_exception_t& e) {
+        if (e.code != 443) {
+          errors[i] = std::current_exception();
+          continue;
+        }
+        // no candidates anywhere in the window, the other windows may still match
+        std::vector<MatchResult> unmatched;
+        unmatched.reserve(window_measurements.size());
+        for (const auto& measurement : window_measurements) {
+          unmatched.push_back({measurement.lnglat(), 0.f, baldr::GraphId{}, -1.f,
+                               measurement.epoch_time(), StateId(), measurement.is_break_point()});
+        }
+        matches[i].reset(new MatchResults(std::move(unmatched), {}, 0));
+      } catch (...) { errors[i] = std::current_exception(); }
+    }
+  };
+
+  const size_t thread_count = std::min(factories_.size(), windows.size());
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(match_windows, std::ref(*factories_[i]));
+  }
+  match_windows(*factories_.front());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // put the windows back together in order
+  std::vector<MatchResult> results;
+  std::vector<EdgeSegment> segments;
+  results.reserve(measurements.size());
+  float score = 0.f;
+  for (size_t i = 0; i < windows.size(); ++i) {
+    Stitch(results, segments, windows[i], *matches[i]);
+    score += matches[i]->score;
+  }
+
+  // same as the sequential matcher when there is nothing to match to at all
+  if (std::none_of(results.begin(), results.end(), is_matched)) {
+    throw valhalla_exception_t{443};
+  }
+  return MatchResults(std::move(results), std::move(segments), score);
+}
+
+void ParallelMapMatcher::ClearFullCache() {
+  for (auto& factory : factories_) {
+    factory->ClearFullCache();
+  }
+}
+
+} // namespace meili
+} // namespace valhalla
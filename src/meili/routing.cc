@@ -2,6 +2,8 @@
 #include <unordered_set>
 #include <vector>
 
+#include <robin_hood.h>
+
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
 #include "baldr/nodetransition.h"
@@ -19,6 +21,13 @@ LabelSet::LabelSet(const float max_cost, const float bucket_size)
     : queue_(0.0f, max_cost, bucket_size, &labels_) {
 }
 
+void LabelSet::reuse(const float max_cost, const float bucket_size) {
+  queue_.clear();
+  clear_status();
+  labels_.clear();
+  queue_.reuse(0.0f, max_cost, bucket_size, &labels_);
+}
+
 void LabelSet::put(const baldr::GraphId& nodeid,
                    const baldr::GraphId& edgeid,
                    const float source,
@@ -97,6 +106,42 @@ void LabelSet::put(const uint16_t dest,
   }
 }
 
+struct ExpansionCache::Edges : public robin_hood::unordered_flat_map<uint64_t, EdgeExpansion> {};
+
+ExpansionCache::ExpansionCache() : edges_(new Edges()) {
+}
+
+ExpansionCache::~ExpansionCache() {
+}
+
+bool ExpansionCache::find(const baldr::GraphId& edgeid, EdgeExpansion& expansion) const {
+  const auto it = edges_->find(edgeid);
+  if (it == edges_->end()) {
+    return false;
+  }
+  expansion = it->second;
+  return true;
+}
+
+void ExpansionCache::insert(const baldr::GraphId& edgeid, const EdgeExpansion& expansion) {
+  edges_->emplace(edgeid, expansion);
+}
+
+void ExpansionCache::set_inbound_heading(const baldr::GraphId& edgeid, const uint16_t heading) {
+  const auto it = edges_->find(edgeid);
+  if (it != edges_->end()) {
+    it->second.inbound_heading = heading;
+  }
+}
+
+void ExpansionCache::clear() {
+  edges_->clear();
+}
+
+size_t ExpansionCache::size() const {
+  return edges_->size();
+}
+
 // Get the next label from the priority queue. Marks the popped label
 // as permanent (best path found).
 uint32_t LabelSet::pop() {
@@ -266,26 +311,37 @@ void set_destinations(baldr::GraphReader& reader,
  */
 inline uint16_t get_inbound_edgelabel_heading(baldr::GraphReader& reader,
                                               const Label& label,
-                                              const baldr::NodeInfo* nodeinfo) {
+                                              const baldr::NodeInfo* nodeinfo,
+                                              ExpansionCache* cache) {
   // Get the opposing local index of the predecessor edge. If this is less
   // than 8 then we can get the heading from the nodeinfo.
   const auto idx = label.opp_local_idx();
   if (idx < 8) {
     return nodeinfo->heading(idx);
-  } else {
-    // Have to get the heading from the edge shape...
-    graph_tile_ptr tile;
-    const auto directededge = reader.directededge(label.edgeid(), tile);
-    const auto edgeinfo = tile->edgeinfo(directededge);
-    const auto& shape = edgeinfo.shape();
-    if (shape.size() >= 2) {
-      float heading = (directededge->forward()) ? shape.back().Heading(shape.rbegin()[1])
-                                                : shape.front().Heading(shape[1]);
-      return static_cast<uint16_t>(std::max(0.f, std::min(359.f, heading)));
-    } else {
-      return 0;
-    }
   }
+
+  // Maybe an earlier search already decoded the shape
+  EdgeExpansion expansion;
+  if (cache && cache->find(label.edgeid(), expansion) &&
+      expansion.inbound_heading != kUnknownHeading) {
+    return expansion.inbound_heading;
+  }
+
+  // Have to get the heading from the edge shape...
+  uint16_t inbound_heading = 0;
+  graph_tile_ptr tile;
+  const auto directededge = reader.directededge(label.edgeid(), tile);
+  const auto edgeinfo = tile->edgeinfo(directededge);
+  const auto& shape = edgeinfo.shape();
+  if (shape.size() >= 2) {
+    float heading = (directededge->forward()) ? shape.back().Heading(shape.rbegin()[1])
+                                              : shape.front().Heading(shape[1]);
+    inbound_heading = static_cast<uint16_t>(std::max(0.f, std::min(359.f, heading)));
+  }
+  if (cache) {
+    cache->set_inbound_heading(label.edgeid(), inbound_heading);
+  }
+  return inbound_heading;
 }
 
 /**
@@ -357,7 +413,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const Label* edgelabel,
                    const float turn_cost_table[181],
                    const float max_dist,
-                   const float max_time) {
+                   const float max_time,
+                   ExpansionCache* cache) {
   Label label;
   const sif::TravelMode travelmode = costing->travel_mode();
 
@@ -375,6 +432,27 @@ find_shortest_path(baldr::GraphReader& reader,
     return (d2 < search_rad2) ? 0.0f : sqrtf(d2) - search_radius;
   };
 
+  // Lambda to get what expanding an edge needs to know about it from the cache if we can
+  const auto edge_expansion = [&](const baldr::GraphId& edgeid,
+                                  const baldr::DirectedEdge* directededge,
+                                  const graph_tile_ptr& tile, const baldr::NodeInfo* nodeinfo) {
+    EdgeExpansion expansion;
+    if (cache && cache->find(edgeid, expansion)) {
+      return expansion;
+    }
+    graph_tile_ptr endtile =
+        directededge->leaves_tile() ? reader.GetGraphTile(directededge->endnode()) : tile;
+    expansion.end_ll =
+        endtile != nullptr ? endtile->get_node_ll(directededge->endnode()) : midgard::PointLL();
+    expansion.secs = costing->EdgeCost(directededge, tile).secs;
+    expansion.outbound_heading = get_outbound_edge_heading(tile, directededge, nodeinfo);
+    expansion.inbound_heading = kUnknownHeading;
+    if (cache) {
+      cache->insert(edgeid, expansion);
+    }
+    return expansion;
+  };
+
   // Lambda method to expand along edges from this node. This method has to
   // be set-up to be called recursively (for transition edges) so we set up
   // a function reference.
@@ -394,7 +472,8 @@ find_shortest_path(baldr::GraphReader& reader,
 
     // Get the inbound edge heading (clamped to range [0,360])
     const auto inbound_hdg =
-        label.edgeid().Is_Valid() ? get_inbound_edgelabel_heading(reader, label, nodeinfo) : 0;
+        label.edgeid().Is_Valid() ? get_inbound_edgelabel_heading(reader, label, nodeinfo, cache)
+                                  : 0;
 
     // Expand from end node in forward direction.
     baldr::GraphId edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
@@ -413,10 +492,11 @@ find_shortest_path(baldr::GraphReader& reader,
 
       // Get outbound heading (clamped to range [0,360]) and add to turn
       // cost based on turn degree
+      const auto expansion = edge_expansion(edgeid, directededge, tile, nodeinfo);
       float turn_cost = label.turn_cost();
       if (label.edgeid().Is_Valid()) {
-        const auto outbound_hdg = get_outbound_edge_heading(tile, directededge, nodeinfo);
-        turn_cost += turn_cost_table[midgard::get_turn_degree180(inbound_hdg, outbound_hdg)];
+        turn_cost += turn_cost_table[midgard::get_turn_degree180(inbound_hdg,
+                                                                 expansion.outbound_heading)];
       }
 
       // If destinations found along the edge, add segments to each
@@ -430,8 +510,7 @@ find_shortest_path(baldr::GraphReader& reader,
               // Override cost portion to be distance. Heuristic cost from a
               // destination to itself must be 0, so sortcost = cost
               sif::Cost cost(label.cost().cost + directededge->length() * edge.percent_along,
-                             label.cost().secs +
-                                 costing->EdgeCost(directededge, tile).secs * edge.percent_along);
+                             label.cost().secs + expansion.secs * edge.percent_along);
               // We only add the labels if we are under the limits for
               // distance and for time or time limit is 0
               if (cost.cost < max_dist && (max_time < 0 || cost.secs < max_time)) {
@@ -443,18 +522,16 @@ find_shortest_path(baldr::GraphReader& reader,
         }
       }
 
-      // Get the end node tile and nodeinfo (to compute heuristic)
-      graph_tile_ptr endtile =
-          directededge->leaves_tile() ? reader.GetGraphTile(directededge->endnode()) : tile;
-      if (endtile != nullptr) {
+      // Need the end node (to compute heuristic)
+      if (expansion.end_ll.IsValid()) {
         // Get cost - use EdgeCost to get time along the edge. Override
         // cost portion to be distance. Add heuristic to get sort cost.
         sif::Cost cost(label.cost().cost + directededge->length(),
-                       label.cost().secs + costing->EdgeCost(directededge, tile).secs);
+                       label.cost().secs + expansion.secs);
         // We only add the labels if we are under the limits for distance
         // and for time or time limit is 0
         if (cost.cost < max_dist && (max_time < 0 || cost.secs < max_time)) {
-          float sortcost = cost.cost + heuristic(endtile->get_node_ll(directededge->endnode()));
+          float sortcost = cost.cost + heuristic(expansion.end_ll);
           labelset->put(directededge->endnode(), edgeid, 0.0f, 1.0f, cost, turn_cost, sortcost,
                         label_idx, directededge, travelmode, restriction_idx);
         }
@@ -2,6 +2,10 @@
 #include "meili/routing.h"
 
 namespace {
+
+// Label sets kept for the next match, each holds on to the buckets of its queue
+constexpr size_t kMaxPooledLabelSets = 256;
+
 inline float GreatCircleDistance(const valhalla::meili::Measurement& left,
                                  const valhalla::meili::Measurement& right) {
   return left.lnglat().Distance(right.lnglat());
@@ -26,7 +30,9 @@ TransitionCostModel::TransitionCostModel(baldr::GraphReader& graphreader,
       travelmode_(travelmode), beta_(beta), inv_beta_(1.f / beta_),
       breakage_distance_(breakage_distance), max_route_distance_factor_(max_route_distance_factor),
       max_route_time_factor_(max_route_time_factor),
-      turn_penalty_factor_(turn_penalty_factor), turn_cost_table_{0.f} {
+      turn_penalty_factor_(turn_penalty_factor), turn_cost_table_{0.f},
+      expansion_cache_(std::make_shared<ExpansionCache>()),
+      labelsets_(std::make_shared<LabelSetPool>()) {
   if (beta_ <= 0.f) {
     throw std::invalid_argument("Expect beta to be positive");
   }
@@ -149,11 +155,24 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
     max_route_time = std::ceil(max_route_time);
   }
 
-  labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance);
+  // reuse the label set of a route of an earlier match once no state holds on to it anymore
+  auto& pool = *labelsets_;
+  labelset_ptr_t labelset;
+  if (pool.used < pool.labelsets.size() && pool.labelsets[pool.used].use_count() == 1) {
+    labelset = pool.labelsets[pool.used++];
+    labelset->reuse(max_route_distance);
+  } else {
+    labelset = std::make_shared<LabelSet>(max_route_distance);
+    if (pool.used == pool.labelsets.size() && pool.labelsets.size() < kMaxPooledLabelSets) {
+      pool.labelsets.push_back(labelset);
+      ++pool.used;
+    }
+  }
   const auto& results = find_shortest_path(graphreader_, locations, 0, labelset, approximator,
                                            right_measurement.search_radius(),
                                            mode_costing_[static_cast<size_t>(travelmode_)], edgelabel,
-                                           turn_cost_table_, max_route_distance, max_route_time);
+                                           turn_cost_table_, max_route_distance, max_route_time,
+                                           expansion_cache_.get());
 
   left.SetRoute(unreached_stateids, results, labelset);
 }
@@ -1,8 +1,10 @@
 #include "baldr/rapidjson_utils.h"
 #include <boost/property_tree/ptree.hpp>
 
+#include "meili/batch_matcher.h"
 #include "meili/map_matcher_factory.h"
 #include "meili/measurement.h"
+#include "meili/openlr_matcher.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::meili;
@@ -35,14 +37,66 @@ ReadMeasurements(istream_t& istream, float default_gps_accuracy, float default_s
   return measurements;
 }
 
+// Match the traces of stdin on meili.batch.threads threads and write their records to stdout
+int RunBatch(const boost::property_tree::ptree& config,
+             const BatchMatcher::Format format,
+             const BatchMatcher::Output output) {
+  std::ios::sync_with_stdio(false);
+  BatchMatcher matcher(config, output);
+  const auto stats = matcher.Match(std::cin, std::cout, format);
+  std::cout.flush();
+
+  std::cerr << stats.matched << "/" << stats.traces << " traces matched on " << matcher.concurrency()
+            << " threads in " << stats.seconds << "s, " << stats.traces_per_second()
+            << " traces/s, " << stats.points_per_second() << " points/s" << std::endl;
+  return 0;
+}
+
+// Decode the OpenLR references of stdin to edge records, or encode edge records to references, on
+// meili.openlr.threads threads and write them to stdout
+int RunOpenLr(const boost::property_tree::ptree& config, const bool encode) {
+  std::ios::sync_with_stdio(false);
+  OpenLrMatcher matcher(config);
+  const auto stats =
+      encode ? matcher.Encode(std::cin, std::cout) : matcher.Decode(std::cin, std::cout);
+  std::cout.flush();
+
+  std::cerr << stats.converted << "/" << stats.references << " references "
+            << (encode ? "encoded" : "decoded") << " on " << matcher.concurrency() << " threads in "
+            << stats.seconds << "s, " << stats.references_per_second() << " references/s"
+            << std::endl;
+  return 0;
+}
+
 int main(int argc, char* argv[]) {
   if (argc < 2) {
-    std::cout << "usage: map_matching CONFIG" << std::endl;
+    std::cout << "usage: map_matching CONFIG [--batch [json|pbf] [speeds] | --openlr decode|encode]"
+              << std::endl;
+    std::cout << "  --batch  match a stream of trace_attributes requests from stdin and write the"
+              << std::endl
+              << "           matched edge ids of each trace to stdout, see meili/batch_matcher.h"
+              << std::endl
+              << "  speeds   write the speed observations of the matched edges instead"
+              << std::endl
+              << "  --openlr decode the base64 OpenLR line references of stdin, one per line, to"
+              << std::endl
+              << "           edge records on stdout, or encode edge records to references"
+              << std::endl;
     return 1;
   }
 
   boost::property_tree::ptree config;
   rapidjson::read_json(argv[1], config);
+
+  if (argc > 2 && std::string(argv[2]) == "--batch") {
+    const bool pbf = argc > 3 && std::string(argv[3]) == "pbf";
+    const bool speeds = argc > 4 && std::string(argv[4]) == "speeds";
+    return RunBatch(config, pbf ? BatchMatcher::Format::kPbf : BatchMatcher::Format::kJson,
+                    speeds ? BatchMatcher::Output::kSpeeds : BatchMatcher::Output::kEdges);
+  }
+  if (argc > 2 && std::string(argv[2]) == "--openlr") {
+    return RunOpenLr(config, argc > 3 && std::string(argv[3]) == "encode");
+  }
   const std::string modename = config.get<std::string>("meili.mode");
   valhalla::Costing::Type costing;
   if (!valhalla::Costing_Enum_Parse(modename, &costing)) {
@@ -1,8 +1,18 @@
 #include "meili/viterbi_search.h"
 
 #include <algorithm>
+#include <limits>
 #include <string>
 
+namespace {
+
+constexpr uint32_t kNoLabel = std::numeric_limits<uint32_t>::max();
+
+// Ids up to here get a slot, the candidates of a measurement are far fewer
+constexpr uint32_t kMaxSlottedId = 1 << 12;
+
+} // namespace
+
 namespace valhalla {
 namespace meili {
 
@@ -377,6 +387,13 @@ bool ViterbiSearch::AddStateId(const StateId& stateid) {
   }
   unreached_states_by_time[stateid.time()].push_back(stateid);
 
+  if (stateid.id() < kMaxSlottedId) {
+    if (column_widths_.size() <= stateid.time()) {
+      column_widths_.resize(stateid.time() + 1, 0);
+    }
+    column_widths_[stateid.time()] = std::max(column_widths_[stateid.time()], stateid.id() + 1);
+  }
+
   return true;
 }
 
@@ -427,26 +444,19 @@ StateId ViterbiSearch::SearchWinner(StateId::Time time) {
 }
 
 StateId ViterbiSearch::Predecessor(const StateId& stateid) const {
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
-    return {};
-  } else {
-    return (it->second).predecessor();
-  }
+  const auto* label = ScannedLabel(stateid);
+  return label ? label->predecessor() : StateId();
 }
 
 double ViterbiSearch::AccumulatedCost(const StateId& stateid) const {
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
-    return -1.f;
-  } else {
-    return it->second.costsofar();
-  }
+  const auto* label = ScannedLabel(stateid);
+  return label ? label->costsofar() : -1.f;
 }
 
 void ViterbiSearch::Clear() {
   IViterbiSearch::Clear();
   states_by_time.clear();
+  column_widths_.clear();
   ClearSearch();
 }
 
@@ -454,10 +464,69 @@ void ViterbiSearch::ClearSearch() {
   earliest_time_ = 0;
   queue_.clear();
   scanned_labels_.clear();
+  label_slots_.clear();
+  column_offsets_.resize(1);
+  unslotted_labels_.clear();
+  scanned_by_time_.clear();
   winner_by_time.clear();
   unreached_states_by_time = states_by_time;
 }
 
+const StateLabel* ViterbiSearch::ScannedLabel(const StateId& stateid) const {
+  if (!stateid.IsValid()) {
+    return nullptr;
+  }
+
+  const auto time = stateid.time();
+  if (time + 1 < column_offsets_.size() &&
+      stateid.id() < column_offsets_[time + 1] - column_offsets_[time]) {
+    const auto index = label_slots_[column_offsets_[time] + stateid.id()];
+    return index == kNoLabel ? nullptr : &scanned_labels_[index];
+  }
+
+  const auto it = unslotted_labels_.find(stateid);
+  return it == unslotted_labels_.end() ? nullptr : &scanned_labels_[it->second];
+}
+
+bool ViterbiSearch::ScanLabel(const StateLabel& label) {
+  const auto stateid = label.stateid();
+  const auto time = stateid.time();
+
+  // lay out the columns up to this one with the widths they have now
+  while (column_offsets_.size() <= time + 1) {
+    const auto laid_out = column_offsets_.size() - 1;
+    const auto width = laid_out < column_widths_.size() ? column_widths_[laid_out] : 0;
+    column_offsets_.push_back(column_offsets_.back() + width);
+  }
+  label_slots_.resize(column_offsets_.back(), kNoLabel);
+
+  const uint32_t index = scanned_labels_.size();
+  if (stateid.id() < column_offsets_[time + 1] - column_offsets_[time]) {
+    auto& slot = label_slots_[column_offsets_[time] + stateid.id()];
+    if (slot != kNoLabel) {
+      return false;
+    }
+    slot = index;
+  } else if (!unslotted_labels_.emplace(stateid, index).second) {
+    return false;
+  }
+  scanned_labels_.push_back(label);
+  return true;
+}
+
+bool ViterbiSearch::OutOfBeam(const StateLabel& label) const {
+  // the winner of a column is always in it
+  const auto time = label.stateid().time();
+  if (winner_by_time.size() <= time) {
+    return false;
+  }
+  if (beam_width_ && time < scanned_by_time_.size() && beam_width_ <= scanned_by_time_[time]) {
+    return true;
+  }
+  const auto* winner = beam_cost_gap_ > 0 ? ScannedLabel(winner_by_time[time]) : nullptr;
+  return winner && beam_cost_gap_ < label.costsofar() - winner->costsofar();
+}
+
 void ViterbiSearch::InitQueue(const std::vector<StateId>& column) {
   queue_.clear();
   for (const auto stateid : column) {
@@ -475,11 +544,11 @@ void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid) {
                            " is impossible to have successors");
   }
 
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
+  const auto* label = ScannedLabel(stateid);
+  if (!label) {
     throw std::logic_error("the state must be scanned");
   }
-  const auto costsofar = it->second.costsofar();
+  const auto costsofar = label->costsofar();
   if (IsInvalidCost(costsofar)) {
     // All invalid ones should be filtered out before pushing labels
     // into the queue
@@ -553,12 +622,25 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
       continue;
     }
 
+    // The rest of its column comes off the queue at the same or a higher cost, so none of it
+    // makes it into the beam either. Dropping the column skips all of their labels from here on
+    if (OutOfBeam(label)) {
+      unreached_states_by_time[stateid.time()].clear();
+      earliest_time_ = stateid.time() + 1;
+      continue;
+    }
+
     // Mark it as scanned and remember its cost and predecessor
-    const auto& inserted = scanned_labels_.emplace(stateid, label);
-    if (!inserted.second) {
+    if (!ScanLabel(label)) {
       throw std::logic_error("the principle of optimality is violated in the viterbi search,"
                              " probably negative costs occurred");
     }
+    if (beam_width_) {
+      if (scanned_by_time_.size() <= stateid.time()) {
+        scanned_by_time_.resize(stateid.time() + 1, 0);
+      }
+      ++scanned_by_time_[stateid.time()];
+    }
 
     // Remove it from its column
     auto& column = unreached_states_by_time[stateid.time()];
@@ -0,0 +1,127 @@
+#include "midgard/allocations.h"
+
+#ifdef VALHALLA_COUNT_ALLOCATIONS
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// plain integers so they need no initialization before the first allocation of a thread
+thread_local uint64_t allocation_count = 0;
+thread_local uint64_t allocated_bytes = 0;
+
+void* allocate(std::size_t size) {
+  ++allocation_count;
+  allocated_bytes += size;
+  // new has to return a unique pointer even for no bytes
+  return std::malloc(size ? size : 1);
+}
+
+void* allocate(std::size_t size, std::align_val_t alignment) {
+  ++allocation_count;
+  allocated_bytes += size;
+  void* memory = nullptr;
+  const auto align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+  return posix_memalign(&memory, align, size ? size : 1) == 0 ? memory : nullptr;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+  if (auto* memory = allocate(size))
+    return memory;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  if (auto* memory = allocate(size, alignment))
+    return memory;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory) noexcept {
+  std::free(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
+void operator delete(void* memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
+
+namespace valhalla {
+namespace midgard {
+
+bool counting_allocations() {
+  return true;
+}
+
+allocation_counts_t thread_allocations() {
+  return {allocation_count, allocated_bytes};
+}
+
+} // namespace midgard
+} // namespace valhalla
+
+#else
+
+namespace valhalla {
+namespace midgard {
+
+bool counting_allocations() {
+  return false;
+}
+
+allocation_counts_t thread_allocations() {
+  return {0, 0};
+}
+
+} // namespace midgard
+} // namespace valhalla
+
+#endif
@@ -0,0 +1,170 @@
+#include "midgard/encoded.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ENCODE_KERNEL_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define ENCODE_KERNEL_AVX2
+#define ENCODE_KERNEL_AVX2_DISPATCH
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ENCODE_KERNEL_NEON
+#endif
+
+namespace {
+
+// Coordinates are quantized a block at a time so the numbers fit on the stack
+constexpr size_t kBlockSize = 256;
+
+// The longest polyline chunks of a 32 bit number
+constexpr size_t kMaxChunks = 7;
+
+// The kernels below turn interleaved coordinates into the zigzag encoded offset of each one from
+// the coordinate of the previous point, rounding half away from zero like round() does. last holds
+// the previous longitude and latitude going in and the last ones coming out
+void zigzag_offsets_scalar(const double* coords,
+                           size_t begin,
+                           size_t count,
+                           double precision,
+                           int32_t* last,
+                           uint32_t* numbers) {
+  for (size_t i = begin; i < count; ++i) {
+    const int32_t value = static_cast<int32_t>(round(coords[i] * precision));
+    const uint32_t offset = static_cast<uint32_t>(value) - static_cast<uint32_t>(last[i & 1]);
+    numbers[i] = (offset << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(offset) >> 31);
+    last[i & 1] = value;
+  }
+}
+
+#ifdef ENCODE_KERNEL_AVX2
+#ifdef ENCODE_KERNEL_AVX2_DISPATCH
+__attribute__((target("avx2")))
+#endif
+void zigzag_offsets_avx2(const double* coords,
+                         size_t count,
+                         double precision,
+                         int32_t* last,
+                         uint32_t* numbers) {
+  const __m256d scale = _mm256_set1_pd(precision);
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d one = _mm256_set1_pd(1.0);
+  __m128i previous = _mm_set_epi32(last[1], last[0], 0, 0);
+
+  // 2 points at a time, the rest is left to the scalar loop
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // truncate and step away from zero when the dropped fraction is at least a half, the
+    // difference of a double and its truncation is exact so this is round()
+    const __m256d v = _mm256_mul_pd(_mm256_loadu_pd(coords + i), scale);
+    const __m256d t = _mm256_round_pd(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256d fraction = _mm256_andnot_pd(sign, _mm256_sub_pd(v, t));
+    const __m256d step = _mm256_and_pd(_mm256_cmp_pd(fraction, half, _CMP_GE_OQ),
+                                       _mm256_or_pd(_mm256_and_pd(v, sign), one));
+    const __m128i values = _mm256_cvttpd_epi32(_mm256_add_pd(t, step));
+
+    // offset from the point before, which is the upper half of the previous values
+    const __m128i offsets = _mm_sub_epi32(values, _mm_alignr_epi8(values, previous, 8));
+    const __m128i zigzag = _mm_xor_si128(_mm_slli_epi32(offsets, 1), _mm_srai_epi32(offsets, 31));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(numbers + i), zigzag);
+    previous = values;
+  }
+  last[0] = _mm_extract_epi32(previous, 2);
+  last[1] = _mm_extract_epi32(previous, 3);
+  zigzag_offsets_scalar(coords, i, count, precision, last, numbers);
+}
+#endif
+
+#ifdef ENCODE_KERNEL_NEON
+void zigzag_offsets_neon(const double* coords,
+                         size_t count,
+                         double precision,
+                         int32_t* last,
+                         uint32_t* numbers) {
+  const float64x2_t scale = vdupq_n_f64(precision);
+  int32x2_t previous = vld1_s32(last);
+
+  // 1 point at a time, frinta rounds half away from zero just like round()
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float64x2_t v = vrndaq_f64(vmulq_f64(vld1q_f64(coords + i), scale));
+    const int32x2_t values = vmovn_s64(vcvtq_s64_f64(v));
+    const int32x2_t offsets = vsub_s32(values, previous);
+    const int32x2_t zigzag = veor_s32(vshl_n_s32(offsets, 1), vshr_n_s32(offsets, 31));
+    vst1_u32(numbers + i, vreinterpret_u32_s32(zigzag));
+    previous = values;
+  }
+  vst1_s32(last, previous);
+  zigzag_offsets_scalar(coords, i, count, precision, last, numbers);
+}
+#endif
+
+void zigzag_offsets_fallback(const double* coords,
+                             size_t count,
+                             double precision,
+                             int32_t* last,
+                             uint32_t* numbers) {
+  zigzag_offsets_scalar(coords, 0, count, precision, last, numbers);
+}
+
+using zigzag_offsets_t = void (*)(const double*, size_t, double, int32_t*, uint32_t*);
+
+// Pick the widest kernel this machine can run, only x86 builds without -mavx2 need to check
+zigzag_offsets_t select_zigzag_offsets() {
+#if defined(ENCODE_KERNEL_AVX2_DISPATCH)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? zigzag_offsets_avx2 : zigzag_offsets_fallback;
+#elif defined(ENCODE_KERNEL_AVX2)
+  return zigzag_offsets_avx2;
+#elif defined(ENCODE_KERNEL_NEON)
+  return zigzag_offsets_neon;
+#else
+  return zigzag_offsets_fallback;
+#endif
+}
+
+const zigzag_offsets_t zigzag_offsets_kernel = select_zigzag_offsets();
+
+// write 5 bit chunks of the number, kept signed so numbers past 31 bits come out as they always have
+inline char* serialize(const uint32_t zigzag, char* output) {
+  int number = static_cast<int>(zigzag);
+  while (number >= 0x20) {
+    *output++ = static_cast<char>((0x20 | (number & 0x1f)) + 63);
+    number >>= 5;
+  }
+  *output++ = static_cast<char>(number + 63);
+  return output;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace midgard {
+
+std::string encode_polyline(const double* coords, const size_t count, const int precision) {
+  // room for the longest numbers so nothing has to be checked while writing
+  std::string output(count * 2 * kMaxChunks, '\0');
+  char* out = &output[0];
+
+  int32_t last[2] = {0, 0};
+  uint32_t numbers[kBlockSize];
+  for (size_t begin = 0; begin < count * 2; begin += kBlockSize) {
+    const size_t size = std::min(kBlockSize, count * 2 - begin);
+    zigzag_offsets_kernel(coords + begin, size, precision, last, numbers);
+    // lat first for some reason
+    for (size_t i = 0; i < size; i += 2) {
+      out = serialize(numbers[i + 1], out);
+      out = serialize(numbers[i], out);
+    }
+  }
+  output.resize(out - output.data());
+  return output;
+}
+
+} // namespace midgard
+} // namespace valhalla
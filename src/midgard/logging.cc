@@ -1,8 +1,10 @@
 #include "midgard/logging.h"
 #include "filesystem.h"
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
@@ -10,6 +12,8 @@
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -78,6 +82,17 @@ const std::unordered_map<valhalla::midgard::logging::LogLevel, android_LogPriori
                    {valhalla::midgard::logging::LogLevel::LogTrace, ANDROID_LOG_VERBOSE}};
 #endif
 
+// the line a message is logged as
+std::string Format(const std::string& message, const std::string& custom_directive) {
+  std::string output;
+  output.reserve(message.length() + 64);
+  output.append(TimeStamp());
+  output.append(custom_directive);
+  output.append(message);
+  output.push_back('\n');
+  return output;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -124,12 +139,24 @@ bool logger_registered = RegisterLogger("", [](const LoggingConfig& config) {
   return l;
 });
 
+// logger that writes formatted lines somewhere, the async logger hands them its lines
+class LineLogger : public Logger {
+public:
+  using Logger::Logger;
+  // the directive the lines of a level are logged with
+  virtual const std::string& Directive(const LogLevel level) const {
+    return uncolored.find(level)->second;
+  }
+  // write one or more lines, each ending with a newline
+  virtual void Write(const std::string& lines) = 0;
+};
+
 // logger that writes to standard out
-class StdOutLogger : public Logger {
+class StdOutLogger : public LineLogger {
 public:
   StdOutLogger() = delete;
   StdOutLogger(const LoggingConfig& config)
-      : Logger(config),
+      : LineLogger(config),
         levels(config.find("color") != config.end() && config.find("color")->second == "true"
                    ? colored
                    : uncolored) {
@@ -144,19 +171,23 @@ public:
   virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
 #ifdef __ANDROID__
     std::string tmp = custom_directive; // to prevent -Wunused-parameter
-    __android_log_print(ANDROID_LOG_INFO, "valhalla", "%s", message.c_str());
+    Write(message);
+#else
+    Write(Format(message, custom_directive));
+#endif
+  }
+  virtual const std::string& Directive(const LogLevel level) const {
+    return levels.find(level)->second;
+  }
+  virtual void Write(const std::string& lines) {
+#ifdef __ANDROID__
+    __android_log_print(ANDROID_LOG_INFO, "valhalla", "%s", lines.c_str());
 #else
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
     // cout is thread safe, to avoid multiple threads interleaving on one line
     // though, we make sure to only call the << operator once on std::cout
     // otherwise the << operators from different threads could interleave
     // obviously we dont care if flushes interleave
-    std::cout << output;
+    std::cout << lines;
     std::cout.flush();
 #endif
   }
@@ -171,18 +202,11 @@ bool std_out_logger_registered = RegisterLogger("std_out", [](const LoggingConfi
 
 class StdErrLogger : public StdOutLogger {
   using StdOutLogger::StdOutLogger;
-  virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
+  virtual void Write(const std::string& lines) {
 #ifdef __ANDROID__
-    std::string tmp = custom_directive; // to prevent -Wunused-parameter
-    __android_log_print(ANDROID_LOG_ERROR, "valhalla", "%s", message.c_str());
+    __android_log_print(ANDROID_LOG_ERROR, "valhalla", "%s", lines.c_str());
 #else
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
-    std::cerr << output;
+    std::cerr << lines;
     std::cerr.flush();
 #endif
   }
@@ -194,10 +218,10 @@ bool std_err_logger_registered = RegisterLogger("std_err", [](const LoggingConfi
 
 // TODO: add log rolling
 // logger that writes to file
-class FileLogger : public Logger {
+class FileLogger : public LineLogger {
 public:
   FileLogger() = delete;
-  FileLogger(const LoggingConfig& config) : Logger(config) {
+  FileLogger(const LoggingConfig& config) : LineLogger(config) {
     // grab the file name
     auto name = config.find("file_name");
     if (name == config.end()) {
@@ -220,17 +244,14 @@ public:
     ReOpen();
   }
   virtual void Log(const std::string& message, const LogLevel level) {
-    Log(message, uncolored.find(level)->second);
+    Log(message, Directive(level));
   }
   virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
+    Write(Format(message, custom_directive));
+  }
+  virtual void Write(const std::string& lines) {
     lock.lock();
-    file << output;
+    file << lines;
     file.flush();
     lock.unlock();
     ReOpen();
@@ -280,6 +301,196 @@ bool file_logger_registered = RegisterLogger("file", [](const LoggingConfig& con
   return l;
 });
 
+// logger that formats the lines in the threads logging them and hands them to a background thread
+// through a lock-free ring buffer, the background thread writes them to the sink in batches so
+// the threads logging never wait on the output
+class AsyncLogger : public Logger {
+public:
+  AsyncLogger() = delete;
+  AsyncLogger(const LoggingConfig& config) : Logger(config) {
+    // the logger the lines are written with, configured like the async logger itself
+    auto sink_config = config;
+    auto sink = config.find("sink");
+    sink_config["type"] = sink == config.end() ? "std_out" : sink->second;
+    std::unique_ptr<Logger> logger(GetFactory().Produce(sink_config));
+    sink_.reset(dynamic_cast<LineLogger*>(logger.get()));
+    if (!sink_) {
+      throw std::runtime_error("The async logger can only write to std_out, std_err or file");
+    }
+    logger.release();
+
+    // the ring buffer, its size is a power of two so positions map to cells with a mask
+    size_t queue_size = 8192;
+    auto size = config.find("queue_size");
+    if (size != config.end()) {
+      try {
+        queue_size = std::stoul(size->second);
+      } catch (...) { queue_size = 0; }
+      if (queue_size < 2) {
+        throw std::runtime_error(size->second + " is not a valid async logger queue size");
+      }
+    }
+    size_t cells = 2;
+    while (cells < queue_size) {
+      cells <<= 1;
+    }
+    cells_ = std::vector<cell_t>(cells);
+    for (size_t i = 0; i < cells; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask_ = cells - 1;
+
+    // whether to drop lines or wait for room when the writer falls behind
+    auto overflow = config.find("overflow");
+    if (overflow != config.end() && overflow->second != "drop") {
+      if (overflow->second != "block") {
+        throw std::runtime_error("Unknown async logger overflow policy: " + overflow->second);
+      }
+      block_ = true;
+    }
+
+    writer_ = std::thread([this]() { Drain(); });
+  }
+
+  virtual ~AsyncLogger() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+  }
+
+  virtual void Log(const std::string& message, const LogLevel level) {
+    Log(message, sink_->Directive(level));
+  }
+
+  virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
+    stats_.logged.fetch_add(1, std::memory_order_relaxed);
+    auto line = Format(message, custom_directive);
+    while (!Push(line)) {
+      if (!block_) {
+        stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      std::this_thread::yield();
+    }
+    if (sleeping_.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> guard(lock);
+      wake_.notify_one();
+    }
+  }
+
+  AsyncLoggerStats Stats() const {
+    return {stats_.logged.load(), stats_.dropped.load(), stats_.written.load(),
+            stats_.writes.load()};
+  }
+
+protected:
+  // a slot of the ring buffer, its sequence says whether it is free or holds a line for the writer
+  struct cell_t {
+    std::atomic<size_t> sequence{0};
+    std::string line;
+  };
+
+  // a bounded multi producer queue after Dmitry Vyukov, false when it is full
+  bool Push(std::string& line) {
+    size_t position = push_position_.load(std::memory_order_relaxed);
+    cell_t* cell;
+    for (;;) {
+      cell = &cells_[position & mask_];
+      const auto sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto difference =
+          static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+      if (difference == 0) {
+        if (push_position_.compare_exchange_weak(position, position + 1,
+                                                 std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = push_position_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->line = std::move(line);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // only the writer pops
+  bool Pop(std::string& lines) {
+    auto& cell = cells_[pop_position_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != pop_position_ + 1) {
+      return false;
+    }
+    lines.append(cell.line);
+    cell.line.clear();
+    cell.sequence.store(pop_position_ + mask_ + 1, std::memory_order_release);
+    ++pop_position_;
+    return true;
+  }
+
+  void Drain() {
+    std::string lines;
+    uint64_t reported_drops = 0;
+    for (;;) {
+      // everything that is queued is written at once
+      uint64_t count = 0;
+      while (count <= mask_ && Pop(lines)) {
+        ++count;
+      }
+      const auto dropped = stats_.dropped.load(std::memory_order_relaxed);
+      if (dropped != reported_drops) {
+        lines.append(Format("Dropped " + std::to_string(dropped - reported_drops) +
+                                " log lines, the async logger queue was full",
+                            sink_->Directive(LogLevel::LogWarn)));
+        reported_drops = dropped;
+      }
+      if (!lines.empty()) {
+        sink_->Write(lines);
+        lines.clear();
+        stats_.written.fetch_add(count, std::memory_order_relaxed);
+        stats_.writes.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+
+      // nothing to write, sleep until a line comes in. a line pushed before the writer says it
+      // sleeps can miss the wake up, the timeout bounds how long it waits in that case
+      std::unique_lock<std::mutex> guard(lock);
+      if (done_) {
+        break;
+      }
+      sleeping_.store(true, std::memory_order_release);
+      wake_.wait_for(guard, std::chrono::milliseconds(kSleepMillis));
+      sleeping_.store(false, std::memory_order_release);
+    }
+  }
+
+  // how long the writer sleeps at most when there is nothing to write
+  static constexpr uint32_t kSleepMillis = 10;
+
+  std::unique_ptr<LineLogger> sink_;
+  std::vector<cell_t> cells_;
+  size_t mask_;
+  bool block_ = false;
+  alignas(64) std::atomic<size_t> push_position_{0};
+  alignas(64) size_t pop_position_ = 0;
+  std::atomic<bool> sleeping_{false};
+  std::condition_variable wake_;
+  bool done_ = false;
+  struct {
+    std::atomic<uint64_t> logged{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> writes{0};
+  } stats_;
+  std::thread writer_;
+};
+bool async_logger_registered = RegisterLogger("async", [](const LoggingConfig& config) {
+  Logger* l = new AsyncLogger(config);
+  return l;
+});
 } // namespace logging
 
 // statically get a logger using the factory
@@ -298,6 +509,12 @@ void logging::Log(const std::string& message, const std::string& custom_directiv
   GetLogger().Log(message, custom_directive);
 }
 
+// statically get what the async logger did
+logging::AsyncLoggerStats logging::GetAsyncLoggerStats() {
+  auto* logger = dynamic_cast<AsyncLogger*>(&GetLogger());
+  return logger ? logger->Stats() : AsyncLoggerStats{};
+}
+
 // statically configure logging
 void logging::Configure(const LoggingConfig& config) {
   GetLogger(config);
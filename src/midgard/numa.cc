@@ -0,0 +1,133 @@
+#include "midgard/numa.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// parses a sysfs cpu list like 0-3,8-11
+std::vector<uint32_t> parse_cpu_list(const std::string& list) {
+  std::vector<uint32_t> cpus;
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty() || !std::isdigit(range.front())) {
+      continue;
+    }
+    auto dash = range.find('-');
+    uint32_t first = std::stoul(range.substr(0, dash));
+    uint32_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+    for (uint32_t cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<std::vector<uint32_t>> read_node_cpus() {
+  std::vector<std::vector<uint32_t>> nodes;
+#ifdef __linux__
+  // nodes are numbered without gaps on all but the most exotic hosts
+  for (size_t node = 0;; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!file) {
+      break;
+    }
+    std::string list;
+    std::getline(file, list);
+    nodes.push_back(parse_cpu_list(list));
+  }
+#endif
+  if (nodes.empty()) {
+    nodes.emplace_back();
+  }
+  return nodes;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace midgard {
+
+const std::vector<std::vector<uint32_t>>& numa_node_cpus() {
+  static const auto nodes = read_node_cpus();
+  return nodes;
+}
+
+size_t numa_node_count() {
+  return numa_node_cpus().size();
+}
+
+bool pin_thread_to_numa_node(const size_t node) {
+#ifdef __linux__
+  const auto& cpus = numa_node_cpus()[node % numa_node_count()];
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+size_t current_numa_node() {
+#ifdef __linux__
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+  return 0;
+}
+
+std::vector<size_t> numa_page_nodes(const void* data, const size_t size, const size_t stride) {
+  std::vector<size_t> counts;
+#if defined(__linux__) && defined(SYS_move_pages)
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t step = page_size * std::max<size_t>(stride, 1);
+  const auto begin = reinterpret_cast<uintptr_t>(data) / page_size * page_size;
+  const auto end = reinterpret_cast<uintptr_t>(data) + size;
+
+  // without target nodes move_pages only reports where each page is
+  std::vector<void*> pages;
+  for (auto page = begin; page < end; page += step) {
+    pages.push_back(reinterpret_cast<void*>(page));
+  }
+  std::vector<int> status(pages.size());
+  if (pages.empty() || syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr,
+                               status.data(), 0) != 0) {
+    return counts;
+  }
+
+  counts.resize(numa_node_count());
+  for (auto node : status) {
+    // negative are errors like pages that were never faulted in
+    if (node >= 0) {
+      if (static_cast<size_t>(node) >= counts.size()) {
+        counts.resize(node + 1);
+      }
+      ++counts[node];
+    }
+  }
+#endif
+  return counts;
+}
+
+} // namespace midgard
+} // namespace valhalla
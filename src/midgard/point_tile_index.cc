@@ -63,12 +63,15 @@ PointTileIndex::PointTileIndex(double tile_width_degrees, const container_t& pol
 
   this->points.reserve(polyline.size());
   tiled_space.reserve(polyline.size());
-  size_t index = 0;
-  for (auto iter = polyline.begin(); iter != polyline.end(); iter++, index++) {
-    const PointLL& p = *iter;
-    this->points.emplace_back(p);
-    int32_t tid = tiles->TileId(p);
-    tiled_space[tid].insert(index);
+  for (auto iter = polyline.begin(); iter != polyline.end(); iter++) {
+    this->points.emplace_back(*iter);
+  }
+
+  // bin all the points at once
+  std::vector<int32_t> tids;
+  tiles->TileIds(this->points, tids);
+  for (size_t index = 0; index < tids.size(); index++) {
+    tiled_space[tids[index]].insert(index);
   }
 }
 
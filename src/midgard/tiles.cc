@@ -1,19 +1,175 @@
 #include <array>
 #include <cmath>
+#include <limits>
 #include <queue>
 #include <unordered_set>
 #include <vector>
 
 #include "midgard/distanceapproximator.h"
 #include "midgard/ellipse.h"
+#include "midgard/point2.h"
+#include "midgard/pointll.h"
 #include "midgard/polyline2.h"
 #include "midgard/tiles.h"
 #include "midgard/util.h"
 
 #include <robin_hood.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TILES_KERNEL_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define TILES_KERNEL_AVX2
+#define TILES_KERNEL_AVX2_DISPATCH
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TILES_KERNEL_NEON
+#endif
+
 namespace {
 
+// The kernels below leave this in place of the tile Id of a coordinate they can't bin exactly the
+// way Tiles::TileId does, a valid tile Id is never negative
+constexpr int32_t kUnbinned = std::numeric_limits<int32_t>::min();
+
+// What the kernels need to know of a tiling system
+struct grid_t {
+  double minx, miny, maxx, maxy;
+  double tilesize;
+  int32_t ncolumns;
+};
+
+// The kernels below bin interleaved x,y coordinates. TileId rounds the coordinates to float before
+// it finds their row and column and the column to float before truncating it, so the kernels do
+// too. Coordinates outside of the extent get -1,
+// the ones on the max edges or that round to float across an edge are left to the scalar TileId
+#ifdef TILES_KERNEL_AVX2
+#ifdef TILES_KERNEL_AVX2_DISPATCH
+__attribute__((target("avx2")))
+#endif
+size_t tile_ids_avx2(const double* coords, size_t count, const grid_t& grid, int32_t* tile_ids) {
+  const __m256d minx = _mm256_set1_pd(grid.minx);
+  const __m256d miny = _mm256_set1_pd(grid.miny);
+  const __m256d maxx = _mm256_set1_pd(grid.maxx);
+  const __m256d maxy = _mm256_set1_pd(grid.maxy);
+  const __m256d size = _mm256_set1_pd(grid.tilesize);
+  const __m128i ncolumns = _mm_set1_epi32(grid.ncolumns);
+  const __m128i outside_id = _mm_set1_epi32(-1);
+  const __m128i unbinned_id = _mm_set1_epi32(kUnbinned);
+  // picks the low half of each 64 bit mask lane
+  const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+
+  // 4 points at a time, the rest is left to the scalar loop
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256d a = _mm256_loadu_pd(coords + 2 * i);
+    const __m256d b = _mm256_loadu_pd(coords + 2 * i + 4);
+    const __m256d x = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8);
+    const __m256d y = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8);
+
+    const __m256d outside =
+        _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(y, miny, _CMP_LT_OQ),
+                                  _mm256_cmp_pd(x, minx, _CMP_LT_OQ)),
+                     _mm256_or_pd(_mm256_cmp_pd(y, maxy, _CMP_GT_OQ),
+                                  _mm256_cmp_pd(x, maxx, _CMP_GT_OQ)));
+    const __m256d xf = _mm256_cvtps_pd(_mm256_cvtpd_ps(x));
+    const __m256d yf = _mm256_cvtps_pd(_mm256_cvtpd_ps(y));
+    const __m256d inside =
+        _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(yf, miny, _CMP_GE_OQ),
+                                    _mm256_cmp_pd(yf, maxy, _CMP_LT_OQ)),
+                      _mm256_and_pd(_mm256_cmp_pd(xf, minx, _CMP_GE_OQ),
+                                    _mm256_cmp_pd(xf, maxx, _CMP_LT_OQ)));
+
+    const __m128i rows = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_sub_pd(yf, miny), size));
+    const __m128i cols =
+        _mm_cvttps_epi32(_mm256_cvtpd_ps(_mm256_div_pd(_mm256_sub_pd(xf, minx), size)));
+    __m128i ids = _mm_add_epi32(_mm_mullo_epi32(rows, ncolumns), cols);
+    ids = _mm_blendv_epi8(unbinned_id, ids,
+                          _mm256_castsi256_si128(
+                              _mm256_permutevar8x32_epi32(_mm256_castpd_si256(inside), narrow)));
+    ids = _mm_blendv_epi8(ids, outside_id,
+                          _mm256_castsi256_si128(
+                              _mm256_permutevar8x32_epi32(_mm256_castpd_si256(outside), narrow)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(tile_ids + i), ids);
+  }
+  return i;
+}
+#endif
+
+#ifdef TILES_KERNEL_NEON
+size_t tile_ids_neon(const double* coords, size_t count, const grid_t& grid, int32_t* tile_ids) {
+  const float64x2_t minx = vdupq_n_f64(grid.minx);
+  const float64x2_t miny = vdupq_n_f64(grid.miny);
+  const float64x2_t maxx = vdupq_n_f64(grid.maxx);
+  const float64x2_t maxy = vdupq_n_f64(grid.maxy);
+  const float64x2_t size = vdupq_n_f64(grid.tilesize);
+  const int32x2_t ncolumns = vdup_n_s32(grid.ncolumns);
+  const int32x2_t outside_id = vdup_n_s32(-1);
+  const int32x2_t unbinned_id = vdup_n_s32(kUnbinned);
+
+  // 2 points at a time, the load splits them into their x and y
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float64x2x2_t xy = vld2q_f64(coords + 2 * i);
+    const float64x2_t x = xy.val[0];
+    const float64x2_t y = xy.val[1];
+
+    const uint64x2_t outside = vorrq_u64(vorrq_u64(vcltq_f64(y, miny), vcltq_f64(x, minx)),
+                                         vorrq_u64(vcgtq_f64(y, maxy), vcgtq_f64(x, maxx)));
+    const float64x2_t xf = vcvt_f64_f32(vcvt_f32_f64(x));
+    const float64x2_t yf = vcvt_f64_f32(vcvt_f32_f64(y));
+    const uint64x2_t inside = vandq_u64(vandq_u64(vcgeq_f64(yf, miny), vcltq_f64(yf, maxy)),
+                                        vandq_u64(vcgeq_f64(xf, minx), vcltq_f64(xf, maxx)));
+
+    const int32x2_t rows = vmovn_s64(vcvtq_s64_f64(vdivq_f64(vsubq_f64(yf, miny), size)));
+    const int32x2_t cols = vcvt_s32_f32(vcvt_f32_f64(vdivq_f64(vsubq_f64(xf, minx), size)));
+    int32x2_t ids = vmla_s32(cols, rows, ncolumns);
+    ids = vbsl_s32(vmovn_u64(inside), ids, unbinned_id);
+    ids = vbsl_s32(vmovn_u64(outside), outside_id, ids);
+    vst1_s32(tile_ids + i, ids);
+  }
+  return i;
+}
+#endif
+
+size_t tile_ids_fallback(const double*, size_t, const grid_t&, int32_t*) {
+  return 0;
+}
+
+using tile_ids_t = size_t (*)(const double*, size_t, const grid_t&, int32_t*);
+
+// Pick the widest kernel this machine can run, only x86 builds without -mavx2 need to check
+tile_ids_t select_tile_ids() {
+#if defined(TILES_KERNEL_AVX2_DISPATCH)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? tile_ids_avx2 : tile_ids_fallback;
+#elif defined(TILES_KERNEL_AVX2)
+  return tile_ids_avx2;
+#elif defined(TILES_KERNEL_NEON)
+  return tile_ids_neon;
+#else
+  return tile_ids_fallback;
+#endif
+}
+
+const tile_ids_t tile_ids_kernel = select_tile_ids();
+
+// Only double precision points are binned by the kernels, they are laid out as x,y pairs
+static_assert(sizeof(valhalla::midgard::PointLL) == 2 * sizeof(double),
+              "PointLL must be a pair of doubles to be binned in bulk");
+
+size_t tile_ids(const valhalla::midgard::PointLL* coords,
+                size_t count,
+                const grid_t& grid,
+                int32_t* tile_ids) {
+  return tile_ids_kernel(reinterpret_cast<const double*>(coords), count, grid, tile_ids);
+}
+
+size_t tile_ids(const valhalla::midgard::Point2*, size_t, const grid_t&, int32_t*) {
+  return 0;
+}
+
 // this is modified to include all pixels that are intersected by the floating point line
 // at each step it decides to either move in the x or y direction based on which pixels midpoint
 // forms a smaller triangle with the line. to avoid edge cases we allow set_pixel to make the
@@ -475,6 +631,18 @@ Tiles<coord_t>::Intersect(const AABB2<coord_t>& box) const {
   return intersection;
 }
 
+template <class coord_t>
+void Tiles<coord_t>::TileIds(const coord_t* coords, const size_t count, int32_t* tile_ids) const {
+  const grid_t grid{tilebounds_.minx(), tilebounds_.miny(), tilebounds_.maxx(), tilebounds_.maxy(),
+                    tilesize_, ncolumns_};
+  const size_t binned = ::tile_ids(coords, count, grid, tile_ids);
+  for (size_t i = 0; i < count; ++i) {
+    if (i >= binned || tile_ids[i] == kUnbinned) {
+      tile_ids[i] = TileId(coords[i]);
+    }
+  }
+}
+
 template <class coord_t>
 std::function<std::tuple<int32_t, unsigned short, double>()>
 Tiles<coord_t>::ClosestFirst(const coord_t& seed) const {
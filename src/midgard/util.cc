@@ -23,8 +23,174 @@
 #include <boost/archive/iterators/remove_whitespace.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PROJECT_KERNEL_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define PROJECT_KERNEL_AVX2
+#define PROJECT_KERNEL_AVX2_DISPATCH
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PROJECT_KERNEL_NEON
+#endif
+
 namespace {
 
+using valhalla::midgard::kMetersPerDegreeLat;
+using valhalla::midgard::projector_t;
+
+// The kernels below follow projector_t::operator() and DistanceApproximator::DistanceSquared
+// operation by operation, segment i runs from point i to point i + 1
+void project_segments_scalar(const projector_t& p,
+                             const double* lngs,
+                             const double* lats,
+                             size_t begin,
+                             size_t count,
+                             double* sq_distances) {
+  const double m_per_lng = p.approx.GetLngScale() * kMetersPerDegreeLat;
+  for (size_t i = begin; i + 1 < count; ++i) {
+    const double ux = lngs[i], uy = lats[i];
+    const double bx = lngs[i + 1] - ux, by = lats[i + 1] - uy;
+    const double bx2 = bx * p.lon_scale;
+    const double sq = bx2 * bx2 + by * by;
+    double scale = (p.lng - ux) * p.lon_scale * bx2 + (p.lat - uy) * by;
+    double x = ux, y = uy;
+    if (scale >= sq && scale > 0.0) {
+      x = lngs[i + 1];
+      y = lats[i + 1];
+    } else if (scale > 0.0) {
+      scale /= sq;
+      x = ux + bx * scale;
+      y = uy + by * scale;
+    }
+    const double dy = (y - p.lat) * kMetersPerDegreeLat;
+    const double dx = (x - p.lng) * m_per_lng;
+    sq_distances[i] = dy * dy + dx * dx;
+  }
+}
+
+#ifdef PROJECT_KERNEL_AVX2
+#ifdef PROJECT_KERNEL_AVX2_DISPATCH
+__attribute__((target("avx2")))
+#endif
+void project_segments_avx2(const projector_t& p,
+                           const double* lngs,
+                           const double* lats,
+                           size_t count,
+                           double* sq_distances) {
+  const __m256d lon_scale = _mm256_set1_pd(p.lon_scale);
+  const __m256d lng = _mm256_set1_pd(p.lng);
+  const __m256d lat = _mm256_set1_pd(p.lat);
+  const __m256d m_per_lat = _mm256_set1_pd(kMetersPerDegreeLat);
+  const __m256d m_per_lng = _mm256_set1_pd(p.approx.GetLngScale() * kMetersPerDegreeLat);
+  const __m256d zero = _mm256_setzero_pd();
+
+  // 4 segments at a time, the rest is left to the scalar loop
+  size_t i = 0;
+  for (; i + 4 < count; i += 4) {
+    const __m256d ux = _mm256_loadu_pd(lngs + i);
+    const __m256d uy = _mm256_loadu_pd(lats + i);
+    const __m256d vx = _mm256_loadu_pd(lngs + i + 1);
+    const __m256d vy = _mm256_loadu_pd(lats + i + 1);
+    const __m256d bx = _mm256_sub_pd(vx, ux);
+    const __m256d by = _mm256_sub_pd(vy, uy);
+    const __m256d bx2 = _mm256_mul_pd(bx, lon_scale);
+    const __m256d sq = _mm256_add_pd(_mm256_mul_pd(bx2, bx2), _mm256_mul_pd(by, by));
+    const __m256d scale =
+        _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(lng, ux), lon_scale), bx2),
+                      _mm256_mul_pd(_mm256_sub_pd(lat, uy), by));
+
+    // between u and v, then clamp to v past the end and to u before the start. zero length
+    // segments divide by zero but always take u
+    const __m256d t = _mm256_div_pd(scale, sq);
+    __m256d x = _mm256_add_pd(ux, _mm256_mul_pd(bx, t));
+    __m256d y = _mm256_add_pd(uy, _mm256_mul_pd(by, t));
+    const __m256d after = _mm256_cmp_pd(scale, sq, _CMP_GE_OQ);
+    x = _mm256_blendv_pd(x, vx, after);
+    y = _mm256_blendv_pd(y, vy, after);
+    const __m256d before = _mm256_cmp_pd(scale, zero, _CMP_LE_OQ);
+    x = _mm256_blendv_pd(x, ux, before);
+    y = _mm256_blendv_pd(y, uy, before);
+
+    const __m256d dy = _mm256_mul_pd(_mm256_sub_pd(y, lat), m_per_lat);
+    const __m256d dx = _mm256_mul_pd(_mm256_sub_pd(x, lng), m_per_lng);
+    _mm256_storeu_pd(sq_distances + i, _mm256_add_pd(_mm256_mul_pd(dy, dy), _mm256_mul_pd(dx, dx)));
+  }
+  project_segments_scalar(p, lngs, lats, i, count, sq_distances);
+}
+#endif
+
+#ifdef PROJECT_KERNEL_NEON
+void project_segments_neon(const projector_t& p,
+                           const double* lngs,
+                           const double* lats,
+                           size_t count,
+                           double* sq_distances) {
+  const float64x2_t lon_scale = vdupq_n_f64(p.lon_scale);
+  const float64x2_t lng = vdupq_n_f64(p.lng);
+  const float64x2_t lat = vdupq_n_f64(p.lat);
+  const float64x2_t m_per_lat = vdupq_n_f64(kMetersPerDegreeLat);
+  const float64x2_t m_per_lng = vdupq_n_f64(p.approx.GetLngScale() * kMetersPerDegreeLat);
+  const float64x2_t zero = vdupq_n_f64(0.0);
+
+  size_t i = 0;
+  for (; i + 2 < count; i += 2) {
+    const float64x2_t ux = vld1q_f64(lngs + i);
+    const float64x2_t uy = vld1q_f64(lats + i);
+    const float64x2_t vx = vld1q_f64(lngs + i + 1);
+    const float64x2_t vy = vld1q_f64(lats + i + 1);
+    const float64x2_t bx = vsubq_f64(vx, ux);
+    const float64x2_t by = vsubq_f64(vy, uy);
+    const float64x2_t bx2 = vmulq_f64(bx, lon_scale);
+    const float64x2_t sq = vaddq_f64(vmulq_f64(bx2, bx2), vmulq_f64(by, by));
+    const float64x2_t scale = vaddq_f64(vmulq_f64(vmulq_f64(vsubq_f64(lng, ux), lon_scale), bx2),
+                                        vmulq_f64(vsubq_f64(lat, uy), by));
+
+    const float64x2_t t = vdivq_f64(scale, sq);
+    float64x2_t x = vaddq_f64(ux, vmulq_f64(bx, t));
+    float64x2_t y = vaddq_f64(uy, vmulq_f64(by, t));
+    const uint64x2_t after = vcgeq_f64(scale, sq);
+    x = vbslq_f64(after, vx, x);
+    y = vbslq_f64(after, vy, y);
+    const uint64x2_t before = vcleq_f64(scale, zero);
+    x = vbslq_f64(before, ux, x);
+    y = vbslq_f64(before, uy, y);
+
+    const float64x2_t dy = vmulq_f64(vsubq_f64(y, lat), m_per_lat);
+    const float64x2_t dx = vmulq_f64(vsubq_f64(x, lng), m_per_lng);
+    vst1q_f64(sq_distances + i, vaddq_f64(vmulq_f64(dy, dy), vmulq_f64(dx, dx)));
+  }
+  project_segments_scalar(p, lngs, lats, i, count, sq_distances);
+}
+#endif
+
+void project_segments_fallback(const projector_t& p,
+                               const double* lngs,
+                               const double* lats,
+                               size_t count,
+                               double* sq_distances) {
+  project_segments_scalar(p, lngs, lats, 0, count, sq_distances);
+}
+
+using project_segments_t = void (*)(const projector_t&, const double*, const double*, size_t, double*);
+
+// Pick the widest kernel this machine can run, only x86 builds without -mavx2 need to check
+project_segments_t select_project_segments() {
+#if defined(PROJECT_KERNEL_AVX2_DISPATCH)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? project_segments_avx2 : project_segments_fallback;
+#elif defined(PROJECT_KERNEL_AVX2)
+  return project_segments_avx2;
+#elif defined(PROJECT_KERNEL_NEON)
+  return project_segments_neon;
+#else
+  return project_segments_fallback;
+#endif
+}
+
+const project_segments_t project_segments_kernel = select_project_segments();
+
 std::vector<valhalla::midgard::PointLL>
 resample_at_1hz(const std::vector<valhalla::midgard::gps_segment_t>& segments) {
   std::vector<valhalla::midgard::PointLL> resampled;
@@ -734,6 +900,14 @@ polygon_t to_boundary(const std::unordered_set<uint32_t>& region, const Tiles<Po
 constexpr char PADDING_ENCODED = '=';
 constexpr char ZERO_ENCODED = 'A';
 
+void project_segments(const projector_t& project,
+                      const double* lngs,
+                      const double* lats,
+                      size_t count,
+                      double* sq_distances) {
+  project_segments_kernel(project, lngs, lats, count, sq_distances);
+}
+
 std::string encode64(const std::string& text) {
   using namespace boost::archive::iterators;
   using Base64Encode = base64_from_binary<transform_width<std::string::const_iterator, 6, 8>>;
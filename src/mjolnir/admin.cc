@@ -1,16 +1,250 @@
 #include "mjolnir/admin.h"
 #include "baldr/datetime.h"
+#include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
 #include "mjolnir/util.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <sqlite3.h>
 #include <unordered_map>
 
 #include <spatialite.h>
 
+namespace {
+
+using namespace valhalla::mjolnir;
+
+std::string column_text(sqlite3_stmt* stmt, int column) {
+  return sqlite3_column_type(stmt, column) == SQLITE_TEXT
+             ? reinterpret_cast<const char*>(sqlite3_column_text(stmt, column))
+             : "";
+}
+
+// the admins of a query with the same columns as the ones of GetAdminInfo and their rowid, the
+// geometry is left out when it is null
+void ReadAdmins(sqlite3* db_handle,
+                const std::string& sql,
+                std::vector<PolygonIndex::Record>& records,
+                std::unordered_map<int64_t, size_t>& rowids) {
+  sqlite3_stmt* stmt = 0;
+  if (sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      PolygonIndex::Record record;
+      record.country_name = column_text(stmt, 0);
+      record.state_name = column_text(stmt, 1);
+      record.country_iso = column_text(stmt, 2);
+      record.state_iso = column_text(stmt, 3);
+      if (sqlite3_column_type(stmt, 4) == SQLITE_INTEGER) {
+        record.drive_on_right = sqlite3_column_int(stmt, 4);
+      }
+      if (sqlite3_column_type(stmt, 5) == SQLITE_INTEGER) {
+        record.allow_intersection_names = sqlite3_column_int(stmt, 5);
+      }
+      if (sqlite3_column_type(stmt, 6) == SQLITE_TEXT) {
+        boost::geometry::read_wkt(column_text(stmt, 6), record.geometry);
+      }
+      rowids.emplace(sqlite3_column_int64(stmt, 7), records.size());
+      records.emplace_back(std::move(record));
+    }
+  }
+  if (stmt) {
+    sqlite3_finalize(stmt);
+  }
+}
+
+// the pieces of the admins in the local tiles, when the db has them
+bool ReadAdminTiles(sqlite3* db_handle,
+                    const std::unordered_map<int64_t, size_t>& rowids,
+                    PolygonIndex::tile_pieces_t& tiles) {
+  sqlite3_stmt* stmt = 0;
+  const std::string sql = "SELECT tileid, admin_id, geom from admin_tiles;";
+  if (sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0) != SQLITE_OK) {
+    if (stmt) {
+      sqlite3_finalize(stmt);
+    }
+    return false;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    // states without a country aren't loaded
+    const auto record = rowids.find(sqlite3_column_int64(stmt, 1));
+    if (record == rowids.end()) {
+      continue;
+    }
+    multi_polygon_type piece;
+    if (sqlite3_column_type(stmt, 2) == SQLITE_TEXT) {
+      boost::geometry::read_wkt(column_text(stmt, 2), piece);
+      boost::geometry::correct(piece);
+    }
+    tiles[sqlite3_column_int(stmt, 0)].emplace_back(record->second, std::move(piece));
+  }
+  sqlite3_finalize(stmt);
+  return true;
+}
+
+// whether a db has a table
+bool HasTable(sqlite3* db_handle, const std::string& table) {
+  sqlite3_stmt* stmt = 0;
+  const std::string sql = "SELECT 1 from sqlite_master where type='table' and name=?;";
+  bool found = false;
+  if (sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, table.c_str(), table.length(), SQLITE_STATIC);
+    found = sqlite3_step(stmt) == SQLITE_ROW;
+  }
+  if (stmt) {
+    sqlite3_finalize(stmt);
+  }
+  return found;
+}
+
+} // namespace
+
 namespace valhalla {
 namespace mjolnir {
 
+PolygonIndex::PolygonIndex(std::vector<Record>&& records) : records_(std::move(records)) {
+  std::vector<value_type> boxes;
+  boxes.reserve(records_.size());
+  for (size_t i = 0; i < records_.size(); ++i) {
+    // the rings of the dbs can go either way round, clipping only works on ones that go clockwise
+    boost::geometry::correct(records_[i].geometry);
+    boxes.emplace_back(boost::geometry::return_envelope<box_type>(records_[i].geometry), i);
+  }
+  // packed in one go, which makes for a better tree than inserting them one by one
+  rtree_ = decltype(rtree_)(boxes.begin(), boxes.end());
+}
+
+PolygonIndex::PolygonIndex(std::vector<Record>&& records, tile_pieces_t&& tiles)
+    : records_(std::move(records)), tiles_(std::move(tiles)) {
+}
+
+std::shared_ptr<const PolygonIndex> PolygonIndex::LoadAdmins(sqlite3* db_handle) {
+  std::vector<Record> records;
+  std::unordered_map<int64_t, size_t> rowids;
+  const bool tiled = db_handle && HasTable(db_handle, "admin_tiles");
+  if (db_handle) {
+    // states first, then countries, like a tile gets them from GetAdminInfo. The whole polygons
+    // are only needed when there are no tile pieces
+    ReadAdmins(db_handle,
+               "SELECT country.name, state.name, country.iso_code, state.iso_code, "
+               "state.drive_on_right, state.allow_intersection_names, " +
+                   std::string(tiled ? "NULL" : "st_astext(state.geom)") +
+                   ", state.rowid from admins state, admins country where country.rowid = "
+                   "state.parent_admin and state.admin_level=4;",
+               records, rowids);
+    ReadAdmins(db_handle,
+               "SELECT name, \"\", iso_code, \"\", drive_on_right, allow_intersection_names, " +
+                   std::string(tiled ? "NULL" : "st_astext(geom)") +
+                   ", rowid from admins where admin_level=2;",
+               records, rowids);
+  }
+
+  tile_pieces_t tiles;
+  if (tiled && ReadAdminTiles(db_handle, rowids, tiles)) {
+    return std::make_shared<const PolygonIndex>(std::move(records), std::move(tiles));
+  }
+  return std::make_shared<const PolygonIndex>(std::move(records));
+}
+
+std::shared_ptr<const PolygonIndex> PolygonIndex::LoadTimeZones(sqlite3* db_handle) {
+  std::vector<Record> records;
+  sqlite3_stmt* stmt = 0;
+  std::string sql = "select TZID, st_astext(geom) from tz_world;";
+  if (db_handle &&
+      sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, 0) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      Record record;
+      record.id = DateTime::get_tz_db().to_index(column_text(stmt, 0));
+      if (record.id == 0) {
+        continue;
+      }
+      boost::geometry::read_wkt(column_text(stmt, 1), record.geometry);
+      records.emplace_back(std::move(record));
+    }
+  }
+  if (stmt) {
+    sqlite3_finalize(stmt);
+  }
+  return std::make_shared<const PolygonIndex>(std::move(records));
+}
+
+std::vector<std::pair<const PolygonIndex::Record*, multi_polygon_type>>
+PolygonIndex::Clip(const AABB2<PointLL>& aabb) const {
+  box_type box(point_type(aabb.minx(), aabb.miny()), point_type(aabb.maxx(), aabb.maxy()));
+  if (!tiles_.empty()) {
+    return ClipTiles(aabb, box);
+  }
+  std::vector<value_type> candidates;
+  rtree_.query(boost::geometry::index::intersects(box), std::back_inserter(candidates));
+  std::sort(candidates.begin(), candidates.end(),
+            [](const value_type& a, const value_type& b) { return a.second < b.second; });
+
+  std::vector<std::pair<const Record*, multi_polygon_type>> clipped;
+  for (const auto& candidate : candidates) {
+    const auto& record = records_[candidate.second];
+    multi_polygon_type within;
+    try {
+      boost::geometry::intersection(record.geometry, box, within);
+    } catch (const std::exception&) {
+      // polygons that are not valid can't always be clipped, those are tested whole
+      within.clear();
+      if (boost::geometry::intersects(record.geometry, box)) {
+        within = record.geometry;
+      }
+    }
+    if (!within.empty()) {
+      clipped.emplace_back(&record, std::move(within));
+    }
+  }
+  return clipped;
+}
+
+std::vector<std::pair<const PolygonIndex::Record*, multi_polygon_type>>
+PolygonIndex::ClipTiles(const AABB2<PointLL>& aabb, const box_type& box) const {
+  // the pieces of the tiles under the box, by record so they come back in the order of loading
+  const auto& tiling = TileHierarchy::levels().back().tiles;
+  std::map<size_t, multi_polygon_type> within;
+  for (const auto tileid : tiling.TileList(aabb)) {
+    const auto pieces = tiles_.find(tileid);
+    const auto bounds = tiling.TileBounds(tileid);
+    // tiles that only touch the box have nothing in it
+    if (pieces == tiles_.end() || bounds.minx() >= aabb.maxx() || bounds.maxx() <= aabb.minx() ||
+        bounds.miny() >= aabb.maxy() || bounds.maxy() <= aabb.miny()) {
+      continue;
+    }
+
+    const box_type tile_box(point_type(bounds.minx(), bounds.miny()),
+                            point_type(bounds.maxx(), bounds.maxy()));
+    const bool whole_tile = aabb.Contains(bounds);
+    for (const auto& piece : pieces->second) {
+      auto& polygons = within[piece.first];
+      multi_polygon_type part;
+      if (piece.second.empty()) {
+        box_type overlap = tile_box;
+        if (!whole_tile) {
+          boost::geometry::intersection(tile_box, box, overlap);
+        }
+        part.resize(1);
+        boost::geometry::convert(overlap, part.front());
+      } else if (whole_tile) {
+        part = piece.second;
+      } else {
+        boost::geometry::intersection(piece.second, box, part);
+      }
+      polygons.insert(polygons.end(), part.begin(), part.end());
+    }
+  }
+
+  std::vector<std::pair<const Record*, multi_polygon_type>> clipped;
+  for (auto& polygons : within) {
+    if (!polygons.second.empty()) {
+      clipped.emplace_back(&records_[polygons.first], std::move(polygons.second));
+    }
+  }
+  return clipped;
+}
+
 // Get the dbhandle of a sqlite db.  Used for timezones and admins DBs.
 sqlite3* GetDBHandle(const std::string& database) {
 
@@ -115,6 +349,16 @@ std::multimap<uint32_t, multi_polygon_type> GetTimeZones(sqlite3* db_handle,
   return polys;
 }
 
+// Get the timezone polys from the preloaded timezones, clipped to the tile
+std::multimap<uint32_t, multi_polygon_type> GetTimeZones(const PolygonIndex& index,
+                                                         const AABB2<PointLL>& aabb) {
+  std::multimap<uint32_t, multi_polygon_type> polys;
+  for (auto& tz : index.Clip(aabb)) {
+    polys.emplace(tz.first->id, std::move(tz.second));
+  }
+  return polys;
+}
+
 void GetData(sqlite3* db_handle,
              sqlite3_stmt* stmt,
              const std::string& sql,
@@ -235,6 +479,25 @@ GetAdminInfo(sqlite3* db_handle,
   return polys;
 }
 
+// Get the admin polys that intersect with the tile bounding box from the preloaded admins.
+std::multimap<uint32_t, multi_polygon_type>
+GetAdminInfo(const PolygonIndex& index,
+             std::unordered_map<uint32_t, bool>& drive_on_right,
+             std::unordered_map<uint32_t, bool>& allow_intersection_names,
+             const AABB2<PointLL>& aabb,
+             GraphTileBuilder& tilebuilder) {
+  std::multimap<uint32_t, multi_polygon_type> polys;
+  for (auto& admin : index.Clip(aabb)) {
+    const auto& record = *admin.first;
+    uint32_t idx = tilebuilder.AddAdmin(record.country_name, record.state_name, record.country_iso,
+                                        record.state_iso);
+    polys.emplace(idx, std::move(admin.second));
+    drive_on_right.emplace(idx, record.drive_on_right);
+    allow_intersection_names.emplace(idx, record.allow_intersection_names);
+  }
+  return polys;
+}
+
 // Get all the country access records from the db and save them to a map.
 std::unordered_map<std::string, std::vector<int>> GetCountryAccess(sqlite3* db_handle) {
 
@@ -1,8 +1,15 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "baldr/graphconstants.h"
+#include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "mjolnir/adminbuilder.h"
 #include "mjolnir/adminconstants.h"
@@ -25,6 +32,11 @@ BOOST_GEOMETRY_REGISTER_POINT_2D(valhalla::midgard::PointLL,
 using ring_t = boost::geometry::model::ring<valhalla::midgard::PointLL>;
 using polygon_t = boost::geometry::model::polygon<valhalla::midgard::PointLL>;
 using multipolygon_t = boost::geometry::model::multi_polygon<polygon_t>;
+// the tile pieces are cut in plain degrees, like the graph builder clips the admins to its tiles
+using xy_t = boost::geometry::model::d2::point_xy<double>;
+using xy_multipolygon_t =
+    boost::geometry::model::multi_polygon<boost::geometry::model::polygon<xy_t>>;
+using xy_box_t = boost::geometry::model::box<xy_t>;
 
 // For OSM pbf reader
 using namespace valhalla::mjolnir;
@@ -34,34 +46,43 @@ using namespace valhalla::midgard;
 namespace {
 
 /**
- * a simple singleton to wrap geos setup and tear down as well as conversion to and from boost types
+ * A geos context of its own for a thread, so threads can assemble admins at the same time, as well
+ * as conversion to and from boost types
  */
-struct geos_helper_t {
-  static const geos_helper_t& get() {
-    static geos_helper_t singleton;
-    return singleton;
+struct geos_context_t {
+  GEOSContextHandle_t handle;
+
+  geos_context_t() : handle(GEOS_init_r()) {
+    GEOSContext_setNoticeHandler_r(handle, message_handler);
+    GEOSContext_setErrorHandler_r(handle, message_handler);
+  }
+  ~geos_context_t() {
+    GEOS_finish_r(handle);
   }
+  geos_context_t(const geos_context_t&) = delete;
+  geos_context_t& operator=(const geos_context_t&) = delete;
+
   template <typename striped_container_t>
-  static GEOSGeometry* from_striped_container(const striped_container_t& coords) {
+  GEOSGeometry* from_striped_container(const striped_container_t& coords) const {
     // sadly we dont layout the memory in parallel arrays so we have to copy to geos
-    GEOSCoordSequence* geos_coords = GEOSCoordSeq_create(coords.size(), 2);
+    GEOSCoordSequence* geos_coords = GEOSCoordSeq_create_r(handle, coords.size(), 2);
     for (unsigned int i = 0; i < static_cast<unsigned int>(coords.size()); ++i) {
-      GEOSCoordSeq_setX(geos_coords, i, coords[i].first);
-      GEOSCoordSeq_setY(geos_coords, i, coords[i].second);
+      GEOSCoordSeq_setX_r(handle, geos_coords, i, coords[i].first);
+      GEOSCoordSeq_setY_r(handle, geos_coords, i, coords[i].second);
     }
-    return GEOSGeom_createLinearRing(geos_coords);
+    return GEOSGeom_createLinearRing_r(handle, geos_coords);
   }
   template <typename striped_container_t>
-  static striped_container_t to_striped_container(const GEOSGeometry* geometry) {
+  striped_container_t to_striped_container(const GEOSGeometry* geometry) const {
     // sadly we dont layout the memory in parallel arrays so we have to copy from geos
-    auto* coords = GEOSGeom_getCoordSeq(geometry);
+    auto* coords = GEOSGeom_getCoordSeq_r(handle, geometry);
     unsigned int coords_size;
-    GEOSCoordSeq_getSize(coords, &coords_size);
+    GEOSCoordSeq_getSize_r(handle, coords, &coords_size);
     striped_container_t container;
     container.resize(coords_size);
     for (unsigned int i = 0; i < coords_size; ++i) {
-      GEOSCoordSeq_getX(coords, i, &container[i].first);
-      GEOSCoordSeq_getY(coords, i, &container[i].second);
+      GEOSCoordSeq_getX_r(handle, coords, i, &container[i].first);
+      GEOSCoordSeq_getY_r(handle, coords, i, &container[i].second);
     }
     return container;
   }
@@ -73,45 +94,44 @@ protected:
     vprintf(fmt, ap);
     va_end(ap);
   }
-  geos_helper_t() {
-    initGEOS(message_handler, message_handler);
-  }
-  ~geos_helper_t() {
-    finishGEOS();
-  }
 };
 
 /**
  * Temporarily convert to a less convenient geos representation in c to get access to a working
  * buffer implementation and then back to boost geometry
+ * @param geos   the geos context of the thread
  * @param ring   to buffer to fix self intersections
  * @param rings  any resulting rings are output here
  * @param inners if some kind of self intersection should cause inners to be created we push them here
  */
-void buffer_ring(const ring_t& ring, std::vector<ring_t>& rings, std::vector<ring_t>& inners) {
+void buffer_ring(const geos_context_t& geos,
+                 const ring_t& ring,
+                 std::vector<ring_t>& rings,
+                 std::vector<ring_t>& inners) {
   // for collecting polygons
   auto add = [&](auto* geos_poly) {
-    rings.emplace_back(geos_helper_t::to_striped_container<ring_t>(GEOSGetExteriorRing(geos_poly)));
-    for (int i = 0; i < GEOSGetNumInteriorRings(geos_poly); ++i) {
-      auto* inner = GEOSGetInteriorRingN(geos_poly, i);
-      inners.push_back(geos_helper_t::to_striped_container<ring_t>(inner));
+    rings.emplace_back(
+        geos.to_striped_container<ring_t>(GEOSGetExteriorRing_r(geos.handle, geos_poly)));
+    for (int i = 0; i < GEOSGetNumInteriorRings_r(geos.handle, geos_poly); ++i) {
+      auto* inner = GEOSGetInteriorRingN_r(geos.handle, geos_poly, i);
+      inners.push_back(geos.to_striped_container<ring_t>(inner));
     }
   };
 
-  auto* outer_ring = geos_helper_t::from_striped_container(ring);
-  auto* geos_poly = GEOSGeom_createPolygon(outer_ring, nullptr, 0);
-  auto* buffered = GEOSBuffer(geos_poly, 0, 8);
-  GEOSNormalize(buffered);
-  auto geom_type = GEOSGeomTypeId(buffered);
+  auto* outer_ring = geos.from_striped_container(ring);
+  auto* geos_poly = GEOSGeom_createPolygon_r(geos.handle, outer_ring, nullptr, 0);
+  auto* buffered = GEOSBuffer_r(geos.handle, geos_poly, 0, 8);
+  GEOSNormalize_r(geos.handle, buffered);
+  auto geom_type = GEOSGeomTypeId_r(geos.handle, buffered);
   switch (geom_type) {
     case GEOS_POLYGON: {
       add(buffered);
       break;
     }
     case GEOS_MULTIPOLYGON: {
-      for (int i = 0; i < GEOSGetNumGeometries(buffered); ++i) {
-        auto* geom = GEOSGetGeometryN(buffered, i);
-        if (GEOSGeomTypeId(geom) != GEOS_POLYGON)
+      for (int i = 0; i < GEOSGetNumGeometries_r(geos.handle, buffered); ++i) {
+        auto* geom = GEOSGetGeometryN_r(geos.handle, buffered, i);
+        if (GEOSGeomTypeId_r(geos.handle, geom) != GEOS_POLYGON)
           throw std::runtime_error("Unusable geometry type after buffering");
         add(geom);
       }
@@ -120,43 +140,47 @@ void buffer_ring(const ring_t& ring, std::vector<ring_t>& rings, std::vector<rin
     default:
       throw std::runtime_error("Unusable geometry type after buffering");
   }
-  GEOSGeom_destroy(geos_poly);
-  GEOSGeom_destroy(buffered);
+  GEOSGeom_destroy_r(geos.handle, geos_poly);
+  GEOSGeom_destroy_r(geos.handle, buffered);
 }
 
 /**
+ * @param geos          the geos context of the thread
  * @param polygon       to buffer to fix self intersections
  * @param multipolygon  any resulting polygons are output here
  */
-void buffer_polygon(const polygon_t& polygon, multipolygon_t& multipolygon) {
+void buffer_polygon(const geos_context_t& geos,
+                    const polygon_t& polygon,
+                    multipolygon_t& multipolygon) {
   // for collecting polygons
   auto add = [&](auto* geos_poly) {
     auto& poly = *multipolygon.emplace(multipolygon.end());
-    poly.outer() = geos_helper_t::to_striped_container<ring_t>(GEOSGetExteriorRing(geos_poly));
-    for (int i = 0; i < GEOSGetNumInteriorRings(geos_poly); ++i) {
-      auto* inner = GEOSGetInteriorRingN(geos_poly, i);
-      poly.inners().push_back(geos_helper_t::to_striped_container<ring_t>(inner));
+    poly.outer() = geos.to_striped_container<ring_t>(GEOSGetExteriorRing_r(geos.handle, geos_poly));
+    for (int i = 0; i < GEOSGetNumInteriorRings_r(geos.handle, geos_poly); ++i) {
+      auto* inner = GEOSGetInteriorRingN_r(geos.handle, geos_poly, i);
+      poly.inners().push_back(geos.to_striped_container<ring_t>(inner));
     }
   };
 
-  auto* outer_ring = geos_helper_t::from_striped_container(polygon.outer());
+  auto* outer_ring = geos.from_striped_container(polygon.outer());
   std::vector<GEOSGeometry*> inner_rings;
   inner_rings.reserve(polygon.inners().size());
   for (const auto& inner : polygon.inners())
-    inner_rings.push_back(geos_helper_t::from_striped_container(inner));
-  auto* geos_poly = GEOSGeom_createPolygon(outer_ring, &inner_rings.front(), inner_rings.size());
-  auto* buffered = GEOSBuffer(geos_poly, 0, 8);
-  GEOSNormalize(buffered);
-  auto geom_type = GEOSGeomTypeId(buffered);
+    inner_rings.push_back(geos.from_striped_container(inner));
+  auto* geos_poly = GEOSGeom_createPolygon_r(geos.handle, outer_ring, inner_rings.data(),
+                                             inner_rings.size());
+  auto* buffered = GEOSBuffer_r(geos.handle, geos_poly, 0, 8);
+  GEOSNormalize_r(geos.handle, buffered);
+  auto geom_type = GEOSGeomTypeId_r(geos.handle, buffered);
   switch (geom_type) {
     case GEOS_POLYGON: {
       add(buffered);
       break;
     }
     case GEOS_MULTIPOLYGON: {
-      for (int i = 0; i < GEOSGetNumGeometries(buffered); ++i) {
-        auto* geom = GEOSGetGeometryN(buffered, i);
-        if (GEOSGeomTypeId(geom) != GEOS_POLYGON)
+      for (int i = 0; i < GEOSGetNumGeometries_r(geos.handle, buffered); ++i) {
+        auto* geom = GEOSGetGeometryN_r(geos.handle, buffered, i);
+        if (GEOSGeomTypeId_r(geos.handle, geom) != GEOS_POLYGON)
           throw std::runtime_error("Unusable geometry type after buffering");
         add(geom);
       }
@@ -165,8 +189,8 @@ void buffer_polygon(const polygon_t& polygon, multipolygon_t& multipolygon) {
     default:
       throw std::runtime_error("Unusable geometry type after buffering");
   }
-  GEOSGeom_destroy(geos_poly);
-  GEOSGeom_destroy(buffered);
+  GEOSGeom_destroy_r(geos.handle, geos_poly);
+  GEOSGeom_destroy_r(geos.handle, buffered);
 }
 
 /**
@@ -229,6 +253,7 @@ bool to_segments(const OSMAdminData& admin_data,
 /**
  * Converts a series of a linestrings into one or more polygons (rings) by connecting contiguous
  * ones until a ring is formed
+ * @param geos        the geos context of the thread
  * @param admin_info  a simple pair that has the admins name and relation id, useful for logging
  * @param lines       the line segments we need to merge into rings
  * @param line_lookup a multi map that lets one easily find a line segment by its first or last point
@@ -236,7 +261,8 @@ bool to_segments(const OSMAdminData& admin_data,
  * @param inners      a place to put any inners that occur from self intersection corrections
  * @return zero or more rings
  */
-void to_rings(const std::pair<std::string, uint64_t>& admin_info,
+void to_rings(const geos_context_t& geos,
+              const std::pair<std::string, uint64_t>& admin_info,
               std::vector<ring_t>& lines,
               std::unordered_multimap<valhalla::midgard::PointLL, size_t>& line_lookup,
               std::vector<ring_t>& rings,
@@ -280,8 +306,7 @@ void to_rings(const std::pair<std::string, uint64_t>& admin_info,
     }
 
     // otherwise we try to make sure the ring is not self intersecting etc and correct it if it is
-    multipolygon_t buffered;
-    buffer_ring(ring, rings, inners);
+    buffer_ring(geos, ring, rings, inners);
   }
 }
 
@@ -296,12 +321,14 @@ struct polygon_data {
 
 /**
  * Takes outer and inner rings and combines them first into polygons and finally into a multipolygon
+ * @param geos        the geos context of the thread
  * @param admin_info  a simple pair of name and relation id used for logging
  * @param outers      outer rings of polygons
  * @param inners      inner rings of polygons
  * @return the multipolygon of the combined outer and inner rings
  */
-multipolygon_t to_multipolygon(const std::pair<std::string, uint64_t>& admin_info,
+multipolygon_t to_multipolygon(const geos_context_t& geos,
+                               const std::pair<std::string, uint64_t>& admin_info,
                                std::vector<ring_t>& outers,
                                std::vector<ring_t>& inners) {
   // Associate an area with each outer so we can
@@ -344,13 +371,151 @@ multipolygon_t to_multipolygon(const std::pair<std::string, uint64_t>& admin_inf
   multipolygon_t multipolygon;
   multipolygon.reserve(polys.size());
   for (auto& poly : polys) {
-    multipolygon_t buffered;
     poly.polygon.inners().swap(poly.postponed_inners);
-    buffer_polygon(poly.polygon, multipolygon);
+    buffer_polygon(geos, poly.polygon, multipolygon);
   }
   return multipolygon;
 }
 
+/**
+ * Assembles the rings of an admin relation into a multipolygon, fixing the validity of its rings
+ * and polygons on the way
+ * @param geos        the geos context of the thread
+ * @param admin_data  used to look up the shape of the member ways
+ * @param admin       the admin to assemble
+ * @return the wkt of the multipolygon, empty when the admin is incomplete or degenerate
+ */
+std::string assemble(const geos_context_t& geos,
+                     const OSMAdminData& admin_data,
+                     const OSMAdmin& admin) {
+  std::pair<std::string, uint64_t> admin_info(admin_data.name_offset_map.name(admin.name_index),
+                                              admin.id);
+  LOG_DEBUG("Building admin: " + admin_info.first);
+
+  // do inners and outers separately
+  std::array<std::vector<ring_t>, 2> outers_inners;
+  for (bool outer : {true, false}) {
+    // grab the ring segments and a lookup to find them when connecting them
+    std::vector<ring_t> lines;
+    std::unordered_multimap<valhalla::midgard::PointLL, size_t> line_lookup;
+    if (!to_segments(admin_data, admin, admin_info.first, outer, lines, line_lookup)) {
+      outers_inners.front().clear();
+      break;
+    }
+    // connect them into a series of one or more rings
+    to_rings(geos, admin_info, lines, line_lookup, outers_inners[!outer], outers_inners[1]);
+  }
+
+  // if we didn't have a complete relation (ie some members were missing) we bail
+  if (outers_inners.front().empty()) {
+    LOG_WARN(admin_info.first + " (" + std::to_string(admin_info.second) +
+             ") is degenerate and will be skipped");
+    return "";
+  }
+
+  // convert the rings into multipolygons
+  auto multipolygon =
+      to_multipolygon(geos, admin_info, outers_inners.front(), outers_inners.back());
+
+  // convert that into wkt format so we can put it into sqlite
+  std::stringstream ss;
+  ss << std::setprecision(7) << boost::geometry::wkt(multipolygon);
+  return ss.str();
+}
+
+/**
+ * Cuts an admin into the pieces within each local tile it touches, the way the spatial admin
+ * lookup of the graph builder clips it to the tile. The pieces are simplified to the tolerance.
+ * @param wkt        the multipolygon of the admin
+ * @param tolerance  the distance in degrees the simplified borders may be off, 0 for none
+ * @return the tile ids and the wkt of the pieces, empty when the admin covers the whole tile
+ */
+std::vector<std::pair<uint32_t, std::string>> cut_into_tiles(const std::string& wkt,
+                                                              const double tolerance) {
+  xy_multipolygon_t admin;
+  boost::geometry::read_wkt(wkt, admin);
+  // the rings go either way round, clipping only works on ones that go clockwise
+  boost::geometry::correct(admin);
+  const auto envelope = boost::geometry::return_envelope<xy_box_t>(admin);
+
+  const auto& tiling = TileHierarchy::levels().back().tiles;
+  std::vector<std::pair<uint32_t, std::string>> pieces;
+  for (const auto tileid : tiling.TileList(AABB2<PointLL>(envelope.min_corner().x(),
+                                                          envelope.min_corner().y(),
+                                                          envelope.max_corner().x(),
+                                                          envelope.max_corner().y()))) {
+    const auto bounds = tiling.TileBounds(tileid);
+    const xy_box_t box(xy_t(bounds.minx(), bounds.miny()),
+                       xy_t(bounds.maxx(), bounds.maxy()));
+    xy_multipolygon_t within;
+    try {
+      boost::geometry::intersection(admin, box, within);
+    } catch (const std::exception&) {
+      // polygons that are not valid can't always be clipped, those are kept whole
+      within.clear();
+      if (boost::geometry::intersects(admin, box)) {
+        within = admin;
+      }
+    }
+    const double area = boost::geometry::area(within);
+    if (area <= 0) {
+      continue;
+    }
+
+    // a tile entirely within the admin needs no geometry at all
+    if (area >= boost::geometry::area(box) * (1 - 1e-9)) {
+      pieces.emplace_back(tileid, "");
+      continue;
+    }
+    if (tolerance > 0) {
+      xy_multipolygon_t simplified;
+      boost::geometry::simplify(within, simplified, tolerance);
+      if (boost::geometry::area(simplified) > 0) {
+        within = std::move(simplified);
+      }
+    }
+    std::stringstream ss;
+    ss << std::setprecision(7) << boost::geometry::wkt(within);
+    pieces.emplace_back(tileid, ss.str());
+  }
+  return pieces;
+}
+
+/**
+ * Runs a job for each index from 0 to count on all the threads, the first exception of a thread
+ * is thrown once they are all done. The threads take the next index as they finish one, the cost
+ * of an admin goes from a village to a continent.
+ * @param count         number of indices
+ * @param thread_count  number of threads
+ * @param job           called with the number of the thread and the index
+ */
+void parallel_for(const size_t count,
+                  const size_t thread_count,
+                  const std::function<void(size_t, size_t)>& job) {
+  std::atomic<size_t> next(0);
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&, i]() {
+      try {
+        for (size_t index = next++; index < count; index = next++) {
+          job(i, index);
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
 } // anonymous namespace
 
 namespace valhalla {
@@ -383,6 +548,21 @@ bool BuildAdminFromPBF(const boost::property_tree::ptree& pt,
   // done with the protobuffer library, cant use it again after this
   OSMPBF::Parser::free();
 
+  // assemble the admins on all threads, each with a geos context of its own
+  const size_t thread_count =
+      std::max(1U, pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  LOG_INFO("Assembling " + std::to_string(admin_data.admins.size()) + " admins with " +
+           std::to_string(thread_count) + " threads");
+  std::vector<std::unique_ptr<geos_context_t>> geos(thread_count);
+  for (auto& context : geos) {
+    context.reset(new geos_context_t());
+  }
+  std::vector<std::string> wkts(admin_data.admins.size());
+  parallel_for(admin_data.admins.size(), thread_count, [&](size_t thread, size_t index) {
+    wkts[index] = assemble(*geos[thread], admin_data, admin_data.admins[index]);
+  });
+  geos.clear();
+
   if (filesystem::exists(*database)) {
     filesystem::remove(*database);
   }
@@ -507,49 +687,19 @@ bool BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     return false;
   }
 
-  // initialize geos
-  geos_helper_t::get();
+  // the states and countries the graph builder looks nodes up in are cut into tiles as well
+  const bool pretile = pt.get<bool>("data_processing.pretile_admins", true);
+  std::vector<std::pair<sqlite3_int64, size_t>> tiled;
 
-  // for each admin area (relation)
+  // load the admins into sqlite in the order they were parsed
   uint32_t count = 0;
-  for (const auto& admin : admin_data.admins) {
-    std::pair<std::string, uint64_t> admin_info(admin_data.name_offset_map.name(admin.name_index),
-                                                admin.id);
-    LOG_DEBUG("Building admin: " + admin_info.first);
-
-    // do inners and outers separately
-    bool complete = true;
-    std::array<std::vector<ring_t>, 2> outers_inners;
-    for (bool outer : {true, false}) {
-      // grab the ring segments and a lookup to find them when connecting them
-      std::vector<ring_t> lines;
-      std::unordered_multimap<valhalla::midgard::PointLL, size_t> line_lookup;
-      if (!to_segments(admin_data, admin, admin_info.first, outer, lines, line_lookup)) {
-        complete = false;
-        break;
-      }
-      // connect them into a series of one or more rings
-      to_rings(admin_info, lines, line_lookup, outers_inners[!outer], outers_inners[1]);
-    }
-
-    // if we didn't have a complete relation (ie some members were missing) we bail
-    if (!complete || outers_inners.front().empty()) {
-      LOG_WARN(admin_info.first + " (" + std::to_string(admin_info.second) +
-               ") is degenerate and will be skipped");
-      continue;
-    }
-
-    // convert the rings into multipolygons
-    auto multipolygon = to_multipolygon(admin_info, outers_inners.front(), outers_inners.back());
-
-    // convert that into wkt format so we can put it into sqlite
-    std::stringstream ss;
-    ss << std::setprecision(7) << boost::geometry::wkt(multipolygon);
-    auto wkt = ss.str();
+  for (size_t i = 0; i < admin_data.admins.size(); ++i) {
+    const auto& admin = admin_data.admins[i];
+    const auto& wkt = wkts[i];
     if (wkt.empty())
       continue;
+    const auto& name = admin_data.name_offset_map.name(admin.name_index);
 
-    // load it into sqlite
     count++;
     sqlite3_reset(stmt);
     sqlite3_clear_bindings(stmt);
@@ -565,7 +715,7 @@ bool BuildAdminFromPBF(const boost::property_tree::ptree& pt,
 
     sqlite3_bind_null(stmt, 3);
 
-    sqlite3_bind_text(stmt, 4, admin_info.first.c_str(), admin_info.first.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, name.c_str(), name.length(), SQLITE_STATIC);
 
     std::string name_en;
     if (admin.name_en_index) {
@@ -582,10 +732,15 @@ bool BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     /* performing INSERT INTO */
     ret = sqlite3_step(stmt);
     if (ret == SQLITE_DONE || ret == SQLITE_ROW) {
+      if (pretile && (admin.admin_level == 2 || admin.admin_level == 4)) {
+        tiled.emplace_back(sqlite3_last_insert_rowid(db_handle), i);
+      } else {
+        wkts[i] = std::string();
+      }
       continue;
     }
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
-    LOG_ERROR("sqlite3_step() Name: " + admin_data.name_offset_map.name(admin.name_index));
+    LOG_ERROR("sqlite3_step() Name: " + name);
     LOG_ERROR("sqlite3_step() Name:en: " + admin_data.name_offset_map.name(admin.name_en_index));
     LOG_ERROR("sqlite3_step() Admin Level: " + std::to_string(admin.admin_level));
     LOG_ERROR("sqlite3_step() Drive on Right: " + std::to_string(admin.drive_on_right));
@@ -744,6 +899,81 @@ bool BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     return false;
   }
 
+  // cut the states and countries into the local tiles they touch on all threads, the graph
+  // builder then only reads the pieces of the tiles it builds
+  if (pretile) {
+    const double tolerance = pt.get<double>("data_processing.admin_simplify_tolerance", 0.00001);
+    std::vector<std::vector<std::pair<uint32_t, std::string>>> pieces(tiled.size());
+    parallel_for(tiled.size(), thread_count, [&](size_t, size_t index) {
+      pieces[index] = cut_into_tiles(wkts[tiled[index].second], tolerance);
+    });
+
+    sql = "CREATE TABLE admin_tiles (tileid INTEGER NOT NULL, admin_id INTEGER NOT NULL, ";
+    sql += "geom TEXT)";
+    ret = sqlite3_exec(db_handle, sql.c_str(), NULL, NULL, &err_msg);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("Error: " + std::string(err_msg));
+      sqlite3_free(err_msg);
+      sqlite3_close(db_handle);
+      return false;
+    }
+
+    sql = "INSERT INTO admin_tiles (tileid, admin_id, geom) VALUES (?, ?, ?)";
+    ret = sqlite3_prepare_v2(db_handle, sql.c_str(), strlen(sql.c_str()), &stmt, NULL);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("SQL error: " + sql);
+      LOG_ERROR(std::string(sqlite3_errmsg(db_handle)));
+    }
+    ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("Error: " + std::string(err_msg));
+      sqlite3_free(err_msg);
+      sqlite3_close(db_handle);
+      return false;
+    }
+
+    size_t piece_count = 0;
+    for (size_t i = 0; i < tiled.size(); ++i) {
+      for (const auto& piece : pieces[i]) {
+        sqlite3_reset(stmt);
+        sqlite3_bind_int(stmt, 1, piece.first);
+        sqlite3_bind_int64(stmt, 2, tiled[i].first);
+        // a tile the admin covers entirely has no geometry
+        if (piece.second.empty()) {
+          sqlite3_bind_null(stmt, 3);
+        } else {
+          sqlite3_bind_text(stmt, 3, piece.second.c_str(), piece.second.length(), SQLITE_STATIC);
+        }
+        ret = sqlite3_step(stmt);
+        if (ret == SQLITE_DONE || ret == SQLITE_ROW) {
+          ++piece_count;
+          continue;
+        }
+        LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
+      }
+    }
+
+    sqlite3_finalize(stmt);
+    ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("Error: " + std::string(err_msg));
+      sqlite3_free(err_msg);
+      sqlite3_close(db_handle);
+      return false;
+    }
+
+    sql = "CREATE INDEX IdxAdminTiles ON admin_tiles (tileid)";
+    ret = sqlite3_exec(db_handle, sql.c_str(), NULL, NULL, &err_msg);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("Error: " + std::string(err_msg));
+      sqlite3_free(err_msg);
+      sqlite3_close(db_handle);
+      return false;
+    }
+    LOG_INFO("Cut " + std::to_string(tiled.size()) + " states and countries into " +
+             std::to_string(piece_count) + " tile pieces");
+  }
+
   sqlite3_close(db_handle);
 
   LOG_INFO("Finished.");
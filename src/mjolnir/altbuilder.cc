@@ -0,0 +1,225 @@
+#include "mjolnir/altbuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "baldr/altbounds.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr float kUnreached = std::numeric_limits<float>::infinity();
+
+// how many parts of the graph are looked at for the largest one
+constexpr uint32_t kMaxStartTries = 10;
+
+/**
+ * The nodes of the road levels numbered tile slot after tile slot, and the network distance between
+ * them over every edge in both directions. Transitions between the levels are free, so a node has
+ * the same distances on every level it is on.
+ */
+class Network {
+public:
+  explicit Network(GraphReader& reader)
+      : reader_(reader), offsets_(AltBounds::TileSlotCount() + 1, 0) {
+    for (const auto& level : TileHierarchy::levels()) {
+      for (const auto& tile_id : reader_.GetTileSet(level.level)) {
+        auto tile = reader_.GetGraphTile(tile_id);
+        if (tile) {
+          offsets_[AltBounds::TileSlot(tile_id) + 1] = tile->header()->nodecount();
+        }
+      }
+    }
+    for (size_t i = 1; i < offsets_.size(); ++i) {
+      offsets_[i] += offsets_[i - 1];
+    }
+  }
+
+  uint64_t node_count() const {
+    return offsets_.back();
+  }
+
+  const std::vector<uint64_t>& offsets() const {
+    return offsets_;
+  }
+
+  // the number of a node, node_count() when it is not on a road level of the graph
+  uint64_t Index(const GraphId& node) const {
+    if (node.level() >= TileHierarchy::levels().size()) {
+      return node_count();
+    }
+    const auto slot = AltBounds::TileSlot(node);
+    const auto index = offsets_[slot] + node.id();
+    return index < offsets_[slot + 1] ? index : node_count();
+  }
+
+  // the node of a number
+  GraphId Node(const uint64_t index) const {
+    auto slot = std::upper_bound(offsets_.begin(), offsets_.end(), index) - offsets_.begin() - 1;
+    const auto id = index - offsets_[slot];
+    for (const auto& level : TileHierarchy::levels()) {
+      if (static_cast<uint64_t>(slot) < level.tiles.TileCount()) {
+        return GraphId(slot, level.level, id);
+      }
+      slot -= level.tiles.TileCount();
+    }
+    throw std::logic_error("Node number " + std::to_string(index) + " is out of range");
+  }
+
+  // dijkstra from one node to all the others
+  void Distances(const GraphId& source, std::vector<float>& distances) {
+    distances.assign(node_count(), kUnreached);
+    using entry_t = std::pair<float, uint64_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+
+    auto relax = [&](const GraphId& node, const float distance) {
+      const auto index = Index(node);
+      if (index < distances.size() && distance < distances[index]) {
+        distances[index] = distance;
+        queue.emplace(distance, node.value);
+      }
+    };
+
+    relax(source, 0.f);
+    while (!queue.empty()) {
+      const auto distance = queue.top().first;
+      const GraphId node(queue.top().second);
+      queue.pop();
+      if (distance > distances[Index(node)]) {
+        continue;
+      }
+
+      if (reader_.OverCommitted()) {
+        reader_.Trim();
+      }
+      auto tile = reader_.GetGraphTile(node);
+      const auto* info = tile->node(node);
+      for (uint32_t i = 0; i < info->edge_count(); ++i) {
+        const auto* edge = tile->directededge(info->edge_index() + i);
+        relax(edge->endnode(), distance + edge->length());
+      }
+      for (uint32_t i = 0; i < info->transition_count(); ++i) {
+        relax(tile->transition(info->transition_index() + i)->endnode(), distance);
+      }
+    }
+  }
+
+protected:
+  GraphReader& reader_;
+  std::vector<uint64_t> offsets_;
+};
+
+// the node whose distance is the largest of the ones that were reached
+uint64_t farthest(const std::vector<float>& distances) {
+  uint64_t farthest = 0;
+  float largest = -1.f;
+  for (uint64_t i = 0; i < distances.size(); ++i) {
+    if (distances[i] != kUnreached && distances[i] > largest) {
+      largest = distances[i];
+      farthest = i;
+    }
+  }
+  return farthest;
+}
+
+// a node of the largest part of the graph the landmarks are picked from, the landmarks would all end
+// up on some island otherwise
+uint64_t start(Network& network, std::vector<float>& distances) {
+  uint64_t start = 0, most_reached = 0, tried = 0;
+  for (uint32_t i = 0; i < kMaxStartTries && most_reached * 2 < network.node_count(); ++i) {
+    network.Distances(network.Node(tried), distances);
+    const uint64_t reached =
+        distances.size() - std::count(distances.begin(), distances.end(), kUnreached);
+    if (reached > most_reached) {
+      most_reached = reached;
+      start = farthest(distances);
+    }
+    // try again from a node this part does not reach
+    tried = std::find(distances.begin(), distances.end(), kUnreached) - distances.begin();
+    if (tried == distances.size()) {
+      break;
+    }
+  }
+  return start;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void AltBuilder::Build(const boost::property_tree::ptree& config,
+                       const std::string& file,
+                       const uint32_t landmark_count) {
+  if (landmark_count == 0) {
+    throw std::invalid_argument("At least one landmark is needed");
+  }
+
+  GraphReader reader(config);
+  Network network(reader);
+  const uint64_t node_count = network.node_count();
+  if (node_count == 0) {
+    throw std::runtime_error("There are no nodes to measure the distance of");
+  }
+  LOG_INFO("Measuring the distance of " + std::to_string(node_count) + " nodes to " +
+           std::to_string(landmark_count) + " landmarks");
+
+  // lay the file out, it is swapped in whole when it is done so services can keep reading the old one
+  const auto& offsets = network.offsets();
+  const uint64_t landmarks_at = sizeof(AltBoundsHeader);
+  const uint64_t offsets_at = landmarks_at + landmark_count * sizeof(uint64_t);
+  const uint64_t distances_at = offsets_at + offsets.size() * sizeof(uint64_t);
+  const uint64_t size = distances_at + node_count * landmark_count * sizeof(float);
+  const auto staged = file + ".tmp";
+  filesystem::remove(staged);
+  {
+    midgard::mem_map<char> memory;
+    memory.create(staged, size);
+    auto* header = reinterpret_cast<AltBoundsHeader*>(memory.get());
+    std::memcpy(header->magic, kAltBoundsMagic, sizeof(kAltBoundsMagic));
+    header->version = kAltBoundsVersion;
+    header->landmark_count = landmark_count;
+    header->tile_count = offsets.size() - 1;
+    header->node_count = node_count;
+    auto* landmarks = reinterpret_cast<uint64_t*>(memory.get() + landmarks_at);
+    std::memcpy(memory.get() + offsets_at, offsets.data(), offsets.size() * sizeof(uint64_t));
+    auto* distances = reinterpret_cast<float*>(memory.get() + distances_at);
+
+    // the first landmark is the node farthest from the start node, each of the others is the
+    // node farthest from the landmarks picked before it. landmarks at the edge of the graph give
+    // the tightest bounds for the routes that head past them
+    std::vector<float> from_landmark, from_picked(node_count, kUnreached);
+    auto landmark = start(network, from_landmark);
+    for (uint32_t i = 0; i < landmark_count; ++i) {
+      landmarks[i] = network.Node(landmark).value;
+      network.Distances(network.Node(landmark), from_landmark);
+      for (uint64_t node = 0; node < node_count; ++node) {
+        distances[node * landmark_count + i] = from_landmark[node];
+        from_picked[node] = std::min(from_picked[node], from_landmark[node]);
+      }
+      LOG_INFO("Measured the distances to landmark " + std::to_string(i + 1) + " of " +
+               std::to_string(landmark_count));
+      landmark = farthest(from_picked);
+    }
+  }
+
+  if (!filesystem::rename(staged, file)) {
+    throw std::runtime_error("Could not move " + staged + " to " + file);
+  }
+  LOG_INFO("Wrote the landmark distances to " + file);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
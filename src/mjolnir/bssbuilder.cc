@@ -3,6 +3,7 @@
 #include "baldr/graphid.h"
 #include "midgard/pointll.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
 
 #include <algorithm>
 #include <limits>
@@ -341,25 +342,26 @@ void add_bss_nodes_and_edges(GraphTileBuilder& tilebuilder_local,
 
 void project_and_add_bss_nodes(const boost::property_tree::ptree& pt,
                                std::mutex& lock,
-                               bss_by_tile_t::const_iterator tile_start,
-                               bss_by_tile_t::const_iterator tile_end,
+                               TileScheduler& scheduler,
+                               size_t worker,
+                               const bss_by_tile_t& bss_by_tile,
                                const OSMData& osm_data,
                                std::vector<BSSConnection>& all) {
 
   GraphReader reader_local_level(pt);
-  for (; tile_start != tile_end; ++tile_start) {
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
 
     graph_tile_ptr local_tile = nullptr;
     std::unique_ptr<GraphTileBuilder> tilebuilder_local = nullptr;
     {
       std::lock_guard<std::mutex> l(lock);
 
-      auto tile_id = tile_start->first;
       local_tile = reader_local_level.GetGraphTile(tile_id);
       tilebuilder_local.reset(new GraphTileBuilder{reader_local_level.tile_dir(), tile_id, true});
     }
 
-    auto new_connections = project(*local_tile, tile_start->second);
+    auto new_connections = project(*local_tile, bss_by_tile.at(tile_id));
     add_bss_nodes_and_edges(*tilebuilder_local, *local_tile, osm_data, lock, new_connections);
     {
       std::lock_guard<std::mutex> l{lock};
@@ -492,22 +494,23 @@ void create_edges(GraphTileBuilder& tilebuilder_local,
 void create_edges_from_way_node(
     const boost::property_tree::ptree& pt,
     std::mutex& lock,
-    std::unordered_map<GraphId, std::vector<BSSConnection>>::const_iterator tile_start,
-    std::unordered_map<GraphId, std::vector<BSSConnection>>::const_iterator tile_end) {
+    TileScheduler& scheduler,
+    size_t worker,
+    const std::unordered_map<GraphId, std::vector<BSSConnection>>& connections_by_tile) {
 
   GraphReader reader_local_level(pt);
-  for (; tile_start != tile_end; ++tile_start) {
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
 
     graph_tile_ptr local_tile = nullptr;
     std::unique_ptr<GraphTileBuilder> tilebuilder_local = nullptr;
     {
       std::lock_guard<std::mutex> l(lock);
 
-      auto tile_id = tile_start->first;
       local_tile = reader_local_level.GetGraphTile(tile_id);
       tilebuilder_local.reset(new GraphTileBuilder{reader_local_level.tile_dir(), tile_id, true});
     }
-    create_edges(*tilebuilder_local, *local_tile, lock, tile_start->second);
+    create_edges(*tilebuilder_local, *local_tile, lock, connections_by_tile.at(tile_id));
   }
 }
 
@@ -628,28 +631,27 @@ void BssBuilder::Build(const boost::property_tree::ptree& pt,
            std::to_string(bss_by_tile.size()) + " local graphs with " + std::to_string(nb_threads) +
            " thread(s)");
 
+  // The tiles are worked on the biggest first
+  auto tile_size = TileScheduler::FileSize(reader.tile_dir());
+
   std::vector<BSSConnection> all;
   {
-    size_t floor = bss_by_tile.size() / threads.size();
-    size_t at_ceiling = bss_by_tile.size() - (threads.size() * floor);
-    bss_by_tile_t::const_iterator tile_start, tile_end = bss_by_tile.begin();
+    std::vector<GraphId> tiles;
+    for (const auto& tile : bss_by_tile) {
+      tiles.push_back(tile.first);
+    }
+    TileScheduler scheduler("Adding bike share stations", tiles, threads.size(), tile_size);
 
     for (size_t i = 0; i < threads.size(); ++i) {
-      // Figure out how many this thread will work on (either ceiling or floor)
-      size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-      // Where the range begins
-      tile_start = tile_end;
-      // Where the range ends
-      std::advance(tile_end, tile_count);
-      // Make the thread
       threads[i].reset(new std::thread(project_and_add_bss_nodes, std::cref(pt.get_child("mjolnir")),
-                                       std::ref(lock), tile_start, tile_end, std::cref(osmdata),
-                                       std::ref(all)));
+                                       std::ref(lock), std::ref(scheduler), i,
+                                       std::cref(bss_by_tile), std::cref(osmdata), std::ref(all)));
     }
 
     for (auto& thread : threads) {
       thread->join();
     }
+    scheduler.LogUtilization();
   }
 
   // the collection is sorted so that the search will be much faster later.
@@ -673,26 +675,21 @@ void BssBuilder::Build(const boost::property_tree::ptree& pt,
   }
 
   {
-    size_t floor = map.size() / threads.size();
-    size_t at_ceiling = map.size() - (threads.size() * floor);
-    std::unordered_map<GraphId, std::vector<BSSConnection>>::const_iterator tile_start,
-        tile_end = map.begin();
+    std::vector<GraphId> tiles;
+    for (const auto& tile : map) {
+      tiles.push_back(tile.first);
+    }
+    TileScheduler scheduler("Connecting bike share stations", tiles, threads.size(), tile_size);
 
     for (size_t i = 0; i < threads.size(); ++i) {
-      // Figure out how many this thread will work on (either ceiling or floor)
-      size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-      // Where the range begins
-      tile_start = tile_end;
-      // Where the range ends
-      std::advance(tile_end, tile_count);
-      // Make the thread
       threads[i].reset(new std::thread(create_edges_from_way_node, std::cref(pt.get_child("mjolnir")),
-                                       std::ref(lock), tile_start, tile_end));
+                                       std::ref(lock), std::ref(scheduler), i, std::cref(map)));
     }
 
     for (auto& thread : threads) {
       thread->join();
     }
+    scheduler.LogUtilization();
   }
 }
 
@@ -0,0 +1,115 @@
+#include "mjolnir/bsstablesbuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "baldr/bss_tables.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "thor/bss_tables.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// rides the stations handed out one at a time, from each to all the others within reach
+void ride(const boost::property_tree::ptree& pt,
+          const std::vector<GraphId>& stations,
+          const float max_secs,
+          std::atomic<size_t>& next,
+          std::vector<BssRide>& rides,
+          std::exception_ptr& error) {
+  try {
+    GraphReader reader(pt.get_child("mjolnir"));
+    auto bicycle = valhalla::sif::CostFactory().Create(valhalla::Costing::bicycle);
+    valhalla::thor::BssStationSearch search;
+    for (size_t from = next++; from < stations.size(); from = next++) {
+      for (const auto& found : search.Expand(reader, *bicycle, stations[from], max_secs)) {
+        auto to = std::lower_bound(stations.begin(), stations.end(), found.station);
+        const auto& label = search.label(found.label);
+        const auto path = search.Path(found.label);
+        rides.push_back({static_cast<uint32_t>(from), static_cast<uint32_t>(to - stations.begin()),
+                         label.cost().cost, label.cost().secs, label.path_distance(), 0,
+                         path.front().edgeid().value, label.edgeid().value});
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  } catch (...) { error = std::current_exception(); }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void BssTablesBuilder::Build(const boost::property_tree::ptree& pt) {
+  const float max_secs = pt.get<float>("mjolnir.bss_tables.max_bicycle_seconds", 3600.f);
+
+  // the stations can be on any level, they usually are on the local one
+  GraphReader reader(pt.get_child("mjolnir"));
+  std::vector<GraphId> stations;
+  uint64_t dataset_id = 0;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+      dataset_id = tile->header()->dataset_id();
+      for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+        if (tile->node(n)->type() == NodeType::kBikeShare) {
+          stations.emplace_back(tile_id.tileid(), tile_id.level(), n);
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+  if (stations.empty()) {
+    LOG_INFO("No bike share stations found, skipping bike share tables");
+    return;
+  }
+  std::sort(stations.begin(), stations.end());
+  LOG_INFO("Riding between " + std::to_string(stations.size()) + " bike share stations");
+
+  const size_t thread_count =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  std::atomic<size_t> next(0);
+  std::vector<std::vector<BssRide>> rides(thread_count);
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(ride, std::cref(pt), std::cref(stations), max_secs, std::ref(next),
+                         std::ref(rides[i]), std::ref(errors[i]));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  std::vector<BssRide> all;
+  for (auto& thread_rides : rides) {
+    all.insert(all.end(), thread_rides.begin(), thread_rides.end());
+  }
+  BssTables tables(std::move(stations), std::move(all), dataset_id);
+  const auto file_name = BssTables::file_name(reader.tile_dir());
+  tables.Save(file_name);
+  LOG_INFO("Wrote bike share tables with " + std::to_string(tables.ride_count()) + " rides to " +
+           file_name);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,303 @@
+#include "mjolnir/connectivitybuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "baldr/connectivity_map.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+using tile_t = connectivity_map_t::tile_t;
+using node_t = connectivity_map_t::node_t;
+
+// Union find over the nodes of all tiles with union by rank and path halving
+class disjoint_sets_t {
+public:
+  explicit disjoint_sets_t(size_t count) : parent_(count), rank_(count, 0) {
+    for (size_t i = 0; i < count; ++i) {
+      parent_[i] = static_cast<uint32_t>(i);
+    }
+  }
+
+  uint32_t find(uint32_t i) {
+    while (parent_[i] != i) {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+
+  void unite(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) {
+      return;
+    }
+    if (rank_[a] < rank_[b]) {
+      std::swap(a, b);
+    }
+    parent_[b] = a;
+    if (rank_[a] == rank_[b]) {
+      ++rank_[a];
+    }
+  }
+
+private:
+  std::vector<uint32_t> parent_;
+  std::vector<uint8_t> rank_;
+};
+
+// The nodes of all tiles and the edges and transitions between them, with the access of every
+// edge, which the components of all sets are found over
+struct graph_t {
+  std::vector<uint64_t> first_arc; // the arcs of a node start here and end where the next node's do
+  std::vector<uint32_t> to;        // the node an arc leads to
+  std::vector<uint16_t> access;    // the forward access of the edge, all of it for transitions
+};
+
+// Tarjan's strongly connected components over the arcs with some of the access, without recursion
+// so the searches of a planet dont run out of stack. Returns the component of every node.
+std::vector<uint32_t> strong_components(const graph_t& graph, uint16_t mask, uint32_t& count) {
+  const auto nodes = graph.first_arc.size() - 1;
+  std::vector<uint32_t> index(nodes, kNoComponent), low(nodes), component(nodes, kNoComponent);
+  std::vector<uint32_t> stack;
+  std::vector<std::pair<uint32_t, uint64_t>> path; // a node of the search and its next arc
+  uint32_t next_index = 0;
+  count = 0;
+  for (uint32_t root = 0; root < nodes; ++root) {
+    if (index[root] != kNoComponent) {
+      continue;
+    }
+    index[root] = low[root] = next_index++;
+    stack.push_back(root);
+    path.emplace_back(root, graph.first_arc[root]);
+    while (!path.empty()) {
+      const auto v = path.back().first;
+      auto& arc = path.back().second;
+      if (arc < graph.first_arc[v + 1]) {
+        const auto w = graph.to[arc];
+        const auto usable = graph.access[arc] & mask;
+        ++arc;
+        if (!usable) {
+          continue;
+        }
+        if (index[w] == kNoComponent) {
+          index[w] = low[w] = next_index++;
+          stack.push_back(w);
+          path.emplace_back(w, graph.first_arc[w]);
+        } else if (component[w] == kNoComponent) {
+          // still on the stack
+          low[v] = std::min(low[v], index[w]);
+        }
+        continue;
+      }
+
+      // all arcs of the node were followed, it is the root of a component if nothing lower is
+      // reachable from it
+      if (low[v] == index[v]) {
+        uint32_t w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          component[w] = count;
+        } while (w != v);
+        ++count;
+      }
+      path.pop_back();
+      if (!path.empty()) {
+        low[path.back().first] = std::min(low[path.back().first], low[v]);
+      }
+    }
+  }
+  return component;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+ConnectivityBuilder::Stats ConnectivityBuilder::Build(const boost::property_tree::ptree& config,
+                                                      const std::string& file) {
+  GraphReader reader(config);
+  auto tiles = connectivity_map_t::color_tiles(reader.GetTileSet());
+  const auto transit_level = TileHierarchy::GetTransitLevel().level;
+
+  // every node of the road levels gets an index, those of a tile follow each other
+  std::vector<uint64_t> first_node(tiles.size() + 1, 0);
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    const GraphId tile_id(tiles[i].tile_id);
+    auto tile = tile_id.level() != transit_level ? reader.GetGraphTile(tile_id) : nullptr;
+    first_node[i + 1] = first_node[i] + (tile ? tile->header()->nodecount() : 0);
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (first_node.back() >= kNoComponent) {
+    throw std::runtime_error("Too many nodes for the connectivity");
+  }
+  auto node_index = [&](const GraphId& node) -> uint64_t {
+    const auto tile_id = static_cast<uint32_t>(node.Tile_Base().value);
+    auto tile = std::lower_bound(tiles.begin(), tiles.end(), tile_id,
+                                 [](const tile_t& t, uint32_t id) { return t.tile_id < id; });
+    if (tile == tiles.end() || tile->tile_id != tile_id) {
+      return kNoComponent;
+    }
+    const auto i = tile - tiles.begin();
+    return first_node[i] + node.id() < first_node[i + 1] ? first_node[i] + node.id()
+                                                           : kNoComponent;
+  };
+
+  // the arcs of the nodes, shortcuts only connect what their edges do and the edges of tiles that
+  // arent there lead nowhere
+  graph_t graph;
+  graph.first_arc.reserve(first_node.back() + 1);
+  graph.first_arc.push_back(0);
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    if (first_node[i] == first_node[i + 1]) {
+      continue;
+    }
+    auto tile = reader.GetGraphTile(GraphId(tiles[i].tile_id));
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      const auto* node = tile->node(n);
+      for (uint32_t e = 0; e < node->edge_count(); ++e) {
+        const auto* edge = tile->directededge(node->edge_index() + e);
+        const auto end = edge->is_shortcut() ? kNoComponent : node_index(edge->endnode());
+        if (end != kNoComponent) {
+          graph.to.push_back(static_cast<uint32_t>(end));
+          graph.access.push_back(static_cast<uint16_t>(edge->forwardaccess()));
+        }
+      }
+      for (uint32_t t = 0; t < node->transition_count(); ++t) {
+        const auto end = node_index(tile->transition(node->transition_index() + t)->endnode());
+        if (end != kNoComponent) {
+          graph.to.push_back(static_cast<uint32_t>(end));
+          graph.access.push_back(kAllAccess);
+        }
+      }
+      graph.first_arc.push_back(graph.to.size());
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // the weak components are the sets of nodes the arcs connect
+  Stats stats;
+  std::vector<std::vector<uint32_t>> components(kComponentSetCount);
+  std::vector<uint32_t> counts(kComponentSetCount, 0);
+  {
+    disjoint_sets_t sets(first_node.back());
+    for (uint32_t n = 0; n < first_node.back(); ++n) {
+      for (auto arc = graph.first_arc[n]; arc < graph.first_arc[n + 1]; ++arc) {
+        sets.unite(n, graph.to[arc]);
+      }
+    }
+    auto& weak = components[0];
+    weak.resize(first_node.back());
+    std::vector<uint32_t> numbers(first_node.back(), kNoComponent);
+    for (uint32_t n = 0; n < first_node.back(); ++n) {
+      auto& number = numbers[sets.find(n)];
+      if (number == kNoComponent) {
+        number = counts[0]++;
+      }
+      weak[n] = number;
+    }
+  }
+  for (size_t set = 1; set < kComponentSetCount; ++set) {
+    components[set] = strong_components(graph, kComponentSetAccess[set], counts[set]);
+  }
+
+  // which components arcs leave and enter, the weak ones none, and which nodes arcs of a set touch
+  std::vector<std::vector<uint8_t>> flags(kComponentSetCount);
+  std::vector<std::vector<bool>> touched(kComponentSetCount);
+  for (size_t set = 0; set < kComponentSetCount; ++set) {
+    flags[set].resize(counts[set], 0);
+    touched[set].resize(first_node.back(), set == 0);
+  }
+  for (uint32_t n = 0; n < first_node.back(); ++n) {
+    for (auto arc = graph.first_arc[n]; arc < graph.first_arc[n + 1]; ++arc) {
+      const auto to = graph.to[arc];
+      for (size_t set = 1; set < kComponentSetCount; ++set) {
+        if (!(graph.access[arc] & kComponentSetAccess[set])) {
+          continue;
+        }
+        touched[set][n] = touched[set][to] = true;
+        if (components[set][n] != components[set][to]) {
+          flags[set][components[set][n]] |= kComponentLeft;
+          flags[set][components[set][to]] |= kComponentEntered;
+        }
+      }
+    }
+  }
+  graph = graph_t{};
+
+  // give every tile the component of each set most of its nodes are in and list the others
+  std::vector<std::vector<node_t>> nodes(kComponentSetCount);
+  std::unordered_map<uint32_t, uint32_t> tally;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    for (size_t set = 0; set < kComponentSetCount; ++set) {
+      tally.clear();
+      for (auto n = first_node[i]; n < first_node[i + 1]; ++n) {
+        if (touched[set][n]) {
+          ++tally[components[set][n]];
+        }
+      }
+      auto most = std::max_element(tally.begin(), tally.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second || (a.second == b.second && a.first > b.first);
+      });
+      tiles[i].component[set] = most == tally.end() ? kNoComponent : most->first;
+      tiles[i].first_node[set] = static_cast<uint32_t>(nodes[set].size());
+      for (auto n = first_node[i]; n < first_node[i + 1]; ++n) {
+        if (touched[set][n] && components[set][n] != tiles[i].component[set]) {
+          nodes[set].push_back(
+              {static_cast<uint32_t>(n - first_node[i]), components[set][n]});
+        }
+      }
+    }
+  }
+  stats.tiles = tiles.size();
+  stats.nodes = first_node.back();
+  stats.components = counts[0];
+  stats.listed = nodes[0].size();
+  for (size_t set = 1; set < kComponentSetCount; ++set) {
+    stats.strong_components += counts[set];
+    stats.listed += nodes[set].size();
+  }
+
+  connectivity_map_t::file_header_t header{};
+  std::memcpy(header.magic, connectivity_map_t::kMagic, sizeof(header.magic));
+  header.version = connectivity_map_t::kVersion;
+  header.tile_count = static_cast<uint32_t>(tiles.size());
+  for (size_t set = 0; set < kComponentSetCount; ++set) {
+    header.node_count[set] = nodes[set].size();
+    header.component_count[set] = counts[set];
+  }
+  std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(tile_t));
+  for (const auto& set : nodes) {
+    out.write(reinterpret_cast<const char*>(set.data()), set.size() * sizeof(node_t));
+  }
+  for (const auto& set : flags) {
+    out.write(reinterpret_cast<const char*>(set.data()), set.size());
+  }
+  if (!out) {
+    throw std::runtime_error("Failed to write " + file);
+  }
+  return stats;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,303 @@
+#include "mjolnir/contractionbuilder.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "baldr/time_info.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+constexpr uint32_t kUncontracted = std::numeric_limits<uint32_t>::max();
+constexpr float kUnreached = std::numeric_limits<float>::max();
+
+// The cheapest arc to each distinct neighbour of a node
+using neighbours_t = std::vector<std::pair<uint32_t, uint32_t>>;
+
+/**
+ * The state of the graph while it is being contracted
+ */
+struct contraction_t {
+  std::vector<ContractionArc>& arcs;
+  std::vector<std::vector<uint32_t>> outbound;
+  std::vector<std::vector<uint32_t>> inbound;
+  std::vector<uint32_t> ranks;
+  std::vector<uint32_t> deleted_neighbours;
+  uint32_t max_settled;
+
+  // witness search buffers
+  std::vector<float> costs;
+  std::vector<uint32_t> touched;
+
+  contraction_t(const uint32_t node_count,
+                std::vector<ContractionArc>& graph_arcs,
+                const uint32_t settled)
+      : arcs(graph_arcs), outbound(node_count), inbound(node_count),
+        ranks(node_count, kUncontracted), deleted_neighbours(node_count, 0), max_settled(settled),
+        costs(node_count, kUnreached) {
+    for (uint32_t i = 0; i < arcs.size(); ++i) {
+      // loops can never be part of a shortest path
+      if (arcs[i].from != arcs[i].to) {
+        outbound[arcs[i].from].push_back(i);
+        inbound[arcs[i].to].push_back(i);
+      }
+    }
+  }
+
+  // collect the cheapest arc to each uncontracted neighbour
+  neighbours_t neighbours(const std::vector<uint32_t>& adjacent, const bool outgoing) const {
+    neighbours_t result;
+    for (auto index : adjacent) {
+      const auto& arc = arcs[index];
+      const uint32_t neighbour = outgoing ? arc.to : arc.from;
+      if (ranks[neighbour] != kUncontracted) {
+        continue;
+      }
+      auto found = std::find_if(result.begin(), result.end(),
+                                [neighbour](const auto& n) { return n.first == neighbour; });
+      if (found == result.end()) {
+        result.emplace_back(neighbour, index);
+      } else if (arc.cost < arcs[found->second].cost) {
+        found->second = index;
+      }
+    }
+    return result;
+  }
+
+  // bounded dijkstra from source which avoids the node being contracted
+  void witness_search(const uint32_t source, const uint32_t avoid, const float limit) {
+    for (auto node : touched) {
+      costs[node] = kUnreached;
+    }
+    touched.clear();
+
+    using label_t = std::pair<float, uint32_t>;
+    std::priority_queue<label_t, std::vector<label_t>, std::greater<label_t>> queue;
+    costs[source] = 0.f;
+    touched.push_back(source);
+    queue.emplace(0.f, source);
+    for (uint32_t settled = 0; !queue.empty() && settled < max_settled; ++settled) {
+      auto label = queue.top();
+      queue.pop();
+      if (label.first > costs[label.second]) {
+        continue;
+      }
+      if (label.first > limit) {
+        break;
+      }
+      for (auto index : outbound[label.second]) {
+        const auto& arc = arcs[index];
+        if (arc.to == avoid || ranks[arc.to] != kUncontracted) {
+          continue;
+        }
+        const float cost = label.first + arc.cost;
+        if (cost < costs[arc.to]) {
+          if (costs[arc.to] == kUnreached) {
+            touched.push_back(arc.to);
+          }
+          costs[arc.to] = cost;
+          queue.emplace(cost, arc.to);
+        }
+      }
+    }
+  }
+
+  // the shortcuts needed to contract the node, if shortcuts is null they are only counted
+  uint32_t shortcuts(const uint32_t node, std::vector<ContractionArc>* shortcuts) {
+    const auto sources = neighbours(inbound[node], false);
+    const auto targets = neighbours(outbound[node], true);
+    uint32_t count = 0;
+    for (const auto& source : sources) {
+      const auto& first = arcs[source.second];
+      float limit = 0.f;
+      for (const auto& target : targets) {
+        limit = std::max(limit, first.cost + arcs[target.second].cost);
+      }
+      witness_search(source.first, node, limit);
+
+      for (const auto& target : targets) {
+        if (target.first == source.first) {
+          continue;
+        }
+        const auto& second = arcs[target.second];
+        const float cost = first.cost + second.cost;
+        if (costs[target.first] <= cost) {
+          continue;
+        }
+        ++count;
+        if (shortcuts) {
+          shortcuts->push_back({source.first, target.first, cost, first.secs + second.secs,
+                                first.length + second.length, source.second, target.second, 0,
+                                kInvalidGraphId});
+        }
+      }
+    }
+    return count;
+  }
+
+  // edge difference plus the number of neighbours already contracted to spread the contraction
+  int priority(const uint32_t node) {
+    const int removed = neighbours(inbound[node], false).size() +
+                        neighbours(outbound[node], true).size();
+    return static_cast<int>(shortcuts(node, nullptr)) - removed + deleted_neighbours[node];
+  }
+};
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+std::vector<uint32_t> ContractionBuilder::Contract(const uint32_t node_count,
+                                                   std::vector<ContractionArc>& arcs,
+                                                   const uint32_t max_settled) {
+  contraction_t graph(node_count, arcs, max_settled);
+
+  using entry_t = std::pair<int, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+  for (uint32_t node = 0; node < node_count; ++node) {
+    queue.emplace(graph.priority(node), node);
+  }
+
+  uint32_t rank = 0;
+  std::vector<ContractionArc> added;
+  while (!queue.empty()) {
+    const uint32_t node = queue.top().second;
+    queue.pop();
+
+    // lazy update, if the node got worse since it was queued put it back
+    const int current = graph.priority(node);
+    if (!queue.empty() && current > queue.top().first) {
+      queue.emplace(current, node);
+      continue;
+    }
+
+    added.clear();
+    graph.shortcuts(node, &added);
+    for (const auto& shortcut : added) {
+      graph.outbound[shortcut.from].push_back(arcs.size());
+      graph.inbound[shortcut.to].push_back(arcs.size());
+      arcs.push_back(shortcut);
+    }
+    for (const auto& neighbour : graph.neighbours(graph.inbound[node], false)) {
+      ++graph.deleted_neighbours[neighbour.first];
+    }
+    for (const auto& neighbour : graph.neighbours(graph.outbound[node], true)) {
+      ++graph.deleted_neighbours[neighbour.first];
+    }
+    graph.ranks[node] = rank++;
+    std::vector<uint32_t>().swap(graph.inbound[node]);
+    std::vector<uint32_t>().swap(graph.outbound[node]);
+
+    if (rank % 100000 == 0) {
+      LOG_INFO("Contracted " + std::to_string(rank) + " of " + std::to_string(node_count) +
+               " nodes, " + std::to_string(arcs.size()) + " arcs");
+    }
+  }
+  return std::move(graph.ranks);
+}
+
+void ContractionBuilder::Build(const boost::property_tree::ptree& pt) {
+  auto costings = pt.get_child_optional("mjolnir.contraction.costings");
+  if (!costings || costings->empty()) {
+    LOG_INFO("No costings configured, skipping contraction overlays");
+    return;
+  }
+  const uint32_t max_settled = pt.get<uint32_t>("mjolnir.contraction.max_settled", 500);
+
+  // the overlay covers the highway level which is where long routes spend their time
+  GraphReader reader(pt.get_child("mjolnir"));
+  const auto level = TileHierarchy::levels().front().level;
+  auto tile_set = reader.GetTileSet(level);
+  std::vector<GraphId> tiles(tile_set.begin(), tile_set.end());
+  std::sort(tiles.begin(), tiles.end());
+  if (tiles.empty()) {
+    LOG_WARN("No tiles found on level " + std::to_string(level) + ", skipping contraction");
+    return;
+  }
+
+  std::vector<GraphId> nodes;
+  uint64_t dataset_id = 0;
+  for (const auto& tile_id : tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    dataset_id = tile->header()->dataset_id();
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      nodes.emplace_back(tile_id.tileid(), tile_id.level(), n);
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  auto node_index = [&nodes](const GraphId& node) {
+    return static_cast<uint32_t>(std::lower_bound(nodes.begin(), nodes.end(), node) - nodes.begin());
+  };
+  LOG_INFO("Contraction overlay has " + std::to_string(nodes.size()) + " nodes");
+
+  for (const auto& costing_name : *costings) {
+    const auto name = costing_name.second.get_value<std::string>();
+    Costing::Type type;
+    if (!Costing_Enum_Parse(name, &type)) {
+      throw std::runtime_error("Unknown costing for contraction overlay: " + name);
+    }
+    auto costing = sif::CostFactory().Create(type);
+
+    // every allowed edge between allowed nodes becomes an arc costed as if there were no time
+    std::vector<ContractionArc> arcs;
+    for (const auto& tile_id : tiles) {
+      graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+      for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+        const NodeInfo* nodeinfo = tile->node(n);
+        if (!costing->Allowed(nodeinfo)) {
+          continue;
+        }
+        const uint32_t from = node_index(GraphId(tile_id.tileid(), tile_id.level(), n));
+        GraphId edgeid(tile_id.tileid(), tile_id.level(), nodeinfo->edge_index());
+        const DirectedEdge* edge = tile->directededge(nodeinfo->edge_index());
+        for (uint32_t e = 0; e < nodeinfo->edge_count(); ++e, ++edge, ++edgeid) {
+          if (!costing->Allowed(edge, tile, sif::kDisallowShortcut) ||
+              edge->endnode().level() != level) {
+            continue;
+          }
+          graph_tile_ptr end_tile =
+              edge->leaves_tile() ? reader.GetGraphTile(edge->endnode()) : tile;
+          if (end_tile == nullptr || !costing->Allowed(end_tile->node(edge->endnode()))) {
+            continue;
+          }
+          uint8_t flow_sources;
+          auto cost = costing->EdgeCost(edge, tile, TimeInfo::invalid(), flow_sources);
+          arcs.push_back({from, node_index(edge->endnode()), cost.cost, cost.secs, edge->length(),
+                          kInvalidArc, kInvalidArc, 0, edgeid.value});
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+
+    LOG_INFO("Contracting " + std::to_string(arcs.size()) + " arcs for " + name);
+    auto ranks = Contract(nodes.size(), arcs, max_settled);
+    ContractionOverlay overlay(nodes, std::move(ranks), std::move(arcs), level, name, dataset_id);
+    const auto file_name = ContractionOverlay::file_name(reader.tile_dir(), name);
+    overlay.Save(file_name);
+    LOG_INFO("Wrote contraction overlay with " + std::to_string(overlay.arc_count()) +
+             " arcs to " + file_name);
+  }
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -34,6 +34,7 @@
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/ingest_transit.h"
 #include "mjolnir/servicedays.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 
 #include "proto/transit.pb.h"
@@ -993,11 +994,11 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
 }
 
 // We make sure to lock on reading and writing since tiles are now being
-// written. Also lock on queue access since shared by different threads.
+// written. The scheduler hands out the tiles to the different threads.
 void build_tiles(const boost::property_tree::ptree& pt,
                  std::mutex& lock,
-                 std::unordered_set<GraphId>::const_iterator tile_start,
-                 std::unordered_set<GraphId>::const_iterator tile_end,
+                 TileScheduler& scheduler,
+                 size_t worker,
                  std::promise<builder_stats>& results) {
 
   builder_stats stats;
@@ -1012,13 +1013,14 @@ void build_tiles(const boost::property_tree::ptree& pt,
   auto tz_conn = make_spatialite_cache(tz_db_handle);
 
   const auto& tiles = TileHierarchy::levels().back().tiles;
-  // Iterate through the tiles in the queue and find any that include stops
-  for (; tile_start != tile_end; ++tile_start) {
-    // Get the next tile Id from the queue and get a tile builder
+  // Iterate through the tiles of the scheduler and find any that include stops
+  GraphId next_tile;
+  while (scheduler.Next(worker, next_tile)) {
+    // Get the next tile Id from the scheduler and get a tile builder
     if (reader.OverCommitted()) {
       reader.Trim();
     }
-    GraphId tile_id = tile_start->Tile_Base();
+    GraphId tile_id = next_tile.Tile_Base();
 
     // Get transit pbf tile
     const std::string transit_dir = pt.get<std::string>("transit_dir");
@@ -1258,30 +1260,25 @@ std::unordered_set<GraphId> convert_transit(const ptree& pt) {
   // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<builder_stats>> results;
 
-  // Start the threads, divvy up the work
+  // Start the threads, the tiles with the most transit data first
   LOG_INFO("Creating " + std::to_string(all_tiles.size()) + " transit graph tiles...");
-  size_t floor = all_tiles.size() / threads.size();
-  size_t at_ceiling = all_tiles.size() - (threads.size() * floor);
-  std::unordered_set<GraphId>::const_iterator tile_start, tile_end = all_tiles.begin();
+  TileScheduler scheduler("Creating transit tiles", {all_tiles.begin(), all_tiles.end()},
+                          threads.size(),
+                          TileScheduler::FileSize(pt.get<std::string>("mjolnir.transit_dir"),
+                                                  ".pbf"));
 
   // Atomically pass around stats info
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
-    // Make the thread
     results.emplace_back();
     threads[i].reset(new std::thread(build_tiles, std::cref(pt.get_child("mjolnir")), std::ref(lock),
-                                     tile_start, tile_end, std::ref(results.back())));
+                                     std::ref(scheduler), i, std::ref(results.back())));
   }
 
   // Wait for them to finish up their work
   for (auto& thread : threads) {
     thread->join();
   }
+  scheduler.LogUtilization();
 
   // Check all of the outcomes, to see about maximum density (km/km2)
   builder_stats stats{};
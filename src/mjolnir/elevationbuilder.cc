@@ -1,20 +1,25 @@
 #include "mjolnir/elevationbuilder.h"
 
+#include <algorithm>
+#include <cmath>
 #include <future>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <boost/format.hpp>
 
 #include "baldr/graphconstants.h"
 #include "baldr/graphid.h"
 #include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/polyline2.h"
 #include "midgard/util.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 #include "skadi/sample.h"
 #include "skadi/util.h"
@@ -31,8 +36,9 @@ constexpr double POSTING_INTERVAL = 60;
 // Do not compute grade for intervals less than 10 meters.
 constexpr double kMinimumInterval = 10.0f;
 
-using cache_t =
-    std::unordered_map<uint32_t, std::tuple<uint32_t, uint32_t, float, float, float, float>>;
+using cache_t = std::unordered_map<
+    uint32_t,
+    std::tuple<uint32_t, uint32_t, float, float, float, float, std::pair<double, double>>>;
 
 void add_elevations_to_single_tile(GraphReader& graphreader,
                                    std::mutex& graphreader_lck,
@@ -41,6 +47,7 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
                                    GraphId& tile_id) {
   // Get the tile. Serialize the entire tile?
   GraphTileBuilder tilebuilder(graphreader.tile_dir(), tile_id, true);
+  std::vector<EdgeElevation> elevations(tilebuilder.header()->directededgecount(), {0, 0});
 
   // Set the has_elevation flag. TODO - do we need to know if any elevation is actually
   // retrieved/used?
@@ -70,6 +77,7 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
       // Grade estimation and max slopes
       std::tuple<double, double, double, double> forward_grades(0.0, 0.0, 0.0, 0.0);
       std::tuple<double, double, double, double> reverse_grades(0.0, 0.0, 0.0, 0.0);
+      std::pair<double, double> elevation_change(0.0, 0.0);
       if (!directededge.tunnel() && directededge.use() != Use::kFerry) {
         // Evenly sample the shape. If it is really short or a bridge just do both ends
         auto interval = POSTING_INTERVAL;
@@ -87,6 +95,7 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
         // mapped to a value between 0 to 15 for use in costing.
         auto heights = sample->get_all(resampled);
         auto grades = valhalla::skadi::weighted_grade(heights, interval);
+        elevation_change = valhalla::skadi::elevation_change(heights);
         if (length < kMinimumInterval) {
           // Keep the default grades - but set the mean elevation
           forward_grades = std::make_tuple(0.0, 0.0, 0.0, std::get<3>(grades));
@@ -107,7 +116,7 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
           cache.insert({edge_info_offset,
                         std::make_tuple(forward_grade, reverse_grade, std::get<1>(forward_grades),
                                         std::get<2>(forward_grades), std::get<1>(reverse_grades),
-                                        std::get<2>(reverse_grades))});
+                                        std::get<2>(reverse_grades), elevation_change)});
       found = inserted.first;
 
       // Set the mean elevation on EdgeInfo
@@ -127,10 +136,18 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
     float max_down_slope = forward ? std::get<3>(found->second) : std::get<5>(found->second);
     directededge.set_max_up_slope(max_up_slope);
     directededge.set_max_down_slope(max_down_slope);
+
+    // The climb of an edge against the shape is the drop along it
+    const auto& change = std::get<6>(found->second);
+    elevations[i].set_ascent(forward ? change.first : change.second);
+    elevations[i].set_descent(forward ? change.second : change.first);
   }
 
-  // Update the tile
+  // Update the tile and then add the ascent and descent of its edges to what was written. The
+  // tile is written anew so a section from an earlier run is not there anymore
+  tilebuilder.header_builder().set_elevation_offset(0);
   tilebuilder.StoreTileData();
+  GraphTileBuilder(graphreader.tile_dir(), tile_id, false).UpdateEdgeElevation(elevations);
 
   // Check if we need to clear the tile cache
   if (graphreader.OverCommitted()) {
@@ -141,10 +158,11 @@ void add_elevations_to_single_tile(GraphReader& graphreader,
 }
 
 /**
- * Adds elevation to a set of tiles. Each thread pulls a tile of the queue
+ * Adds elevation to a set of tiles. Each thread pulls its tiles from the scheduler
  */
 void add_elevations_to_multiple_tiles(const boost::property_tree::ptree& pt,
-                                      std::deque<GraphId>& tilequeue,
+                                      TileScheduler& scheduler,
+                                      size_t worker,
                                       std::mutex& lock,
                                       const std::unique_ptr<valhalla::skadi::sample>& sample,
                                       std::promise<uint32_t>& /*result*/) {
@@ -153,37 +171,30 @@ void add_elevations_to_multiple_tiles(const boost::property_tree::ptree& pt,
 
   // We usually end up accessing the same shape twice (once for each direction along an edge).
   // Use a cache to record elevation attributes based on the EdgeInfo offset. This includes
-  // weighted grade (forward and reverse) as well as max slopes (up/down for forward and reverse).
+  // weighted grade (forward and reverse), max slopes (up/down for forward and reverse) as well
+  // as the ascent and descent along the shape.
   cache_t geo_attribute_cache;
 
   // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
     add_elevations_to_single_tile(graphreader, lock, geo_attribute_cache, sample, tile_id);
   }
 }
 
-std::deque<GraphId> get_tile_ids(const boost::property_tree::ptree& pt) {
-  std::deque<GraphId> tilequeue;
+// Index of the 1 degree elevation tile the center of a graph tile is in
+uint32_t elevation_tile(const GraphId& tile_id) {
+  auto center = TileHierarchy::get_tiling(tile_id.level()).TileBounds(tile_id.tileid()).Center();
+  auto lon = static_cast<uint32_t>(std::floor(center.lng()) + 180);
+  auto lat = static_cast<uint32_t>(std::floor(center.lat()) + 90);
+  return lat * 360 + lon;
+}
+
+std::vector<GraphId> get_tile_ids(const boost::property_tree::ptree& pt) {
   GraphReader reader(pt.get_child("mjolnir"));
-  // Create a randomized queue of tiles (at all levels) to work from
+  // All the tiles (at all levels) to work on
   auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset)
-    tilequeue.emplace_back(id);
-
-  std::random_device rd;
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(rd()));
-
-  return tilequeue;
+  return {tileset.begin(), tileset.end()};
 }
 
 } // namespace
@@ -204,24 +215,37 @@ void ElevationBuilder::Build(const boost::property_tree::ptree& pt,
       std::max(static_cast<std::uint32_t>(1),
                pt.get<std::uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
-  if (tile_ids.empty())
-    tile_ids = get_tile_ids(pt);
+  // Unless told which, all the tiles of this shard
+  if (tile_ids.empty()) {
+    auto shard_tiles = TileShard::FromConfig(pt).Select(get_tile_ids(pt));
+    tile_ids.assign(shard_tiles.begin(), shard_tiles.end());
+  }
 
   std::vector<std::shared_ptr<std::thread>> threads(nthreads);
   std::vector<std::promise<uint32_t>> results(nthreads);
 
+  // Order the tiles by the elevation tile they are in. The threads share the unpacked elevation
+  // tiles so working through neighbouring graph tiles together unpacks each one about once
+  std::vector<GraphId> ordered(tile_ids.begin(), tile_ids.end());
+  std::sort(ordered.begin(), ordered.end(), [](const GraphId& a, const GraphId& b) {
+    auto ea = elevation_tile(a), eb = elevation_tile(b);
+    return ea == eb ? a < b : ea < eb;
+  });
+
   LOG_INFO("Adding elevation to " + std::to_string(tile_ids.size()) + " tiles with " +
            std::to_string(nthreads) + " threads...");
+  TileScheduler scheduler("Adding elevation", ordered, nthreads);
   std::mutex lock;
-  for (auto& thread : threads) {
-    results.emplace_back();
-    thread.reset(new std::thread(add_elevations_to_multiple_tiles, std::cref(pt), std::ref(tile_ids),
-                                 std::ref(lock), std::ref(sample), std::ref(results.back())));
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].reset(new std::thread(add_elevations_to_multiple_tiles, std::cref(pt),
+                                     std::ref(scheduler), i, std::ref(lock), std::ref(sample),
+                                     std::ref(results[i])));
   }
 
   for (auto& thread : threads) {
     thread->join();
   }
+  scheduler.LogUtilization();
 
   LOG_INFO("Finished");
 }
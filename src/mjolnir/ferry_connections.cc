@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <queue>
 #include <unordered_map>
 
@@ -39,7 +40,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
                       sequence<OSMWay>& ways,
                       sequence<OSMWayNode>& way_nodes,
-                      sequence<Edge>& edges,
+                      edge_view_t& edges,
                       sequence<Node>& nodes,
                       const bool inbound,
                       const bool first_edge_destonly) {
@@ -214,8 +215,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
       for (auto& edge : bundle2.node_edges) {
         bool forward = edge.first.sourcenode_ == pred_node;
         if (forward || edge.first.targetnode_ == pred_node) {
-          sequence<Edge>::iterator element = edges[edge.second];
-          auto update_edge = *element;
+          auto update_edge = edges.get(edge.second);
           if ((forward && inbound) || (!forward && !inbound)) {
             path_access &= update_edge.rev_access;
           } else if ((forward && !inbound) || (!forward && inbound)) {
@@ -224,7 +224,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
           if (update_edge.attributes.importance > kFerryUpClass) {
             update_edge.attributes.importance = kFerryUpClass;
             update_edge.attributes.reclass_ferry = true;
-            element = update_edge;
+            edges.set(edge.second, update_edge);
             edge_count++;
           }
         }
@@ -248,7 +248,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
 // just one edge and length < 2 km
 bool ShortFerry(const uint32_t node_index,
                 node_bundle& bundle,
-                sequence<Edge>& edges,
+                edge_view_t& edges,
                 sequence<Node>& nodes,
                 sequence<OSMWayNode>& way_nodes) {
   // Method to get the shape for an edge - since LL is stored as a pair of
@@ -298,11 +298,14 @@ bool ShortFerry(const uint32_t node_index,
 }
 
 // Reclassify edges from a ferry along the shortest path to the
-// specified road classification.
+// specified road classification. The ferry endpoints are worked on in
+// parallel with run_in_order, so the edges end up as if they were worked on
+// one after the other.
 void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& way_nodes_file,
                                 const std::string& nodes_file,
-                                const std::string& edges_file) {
+                                const std::string& edges_file,
+                                unsigned int concurrency) {
   LOG_INFO("Reclassifying ferry connection graph edges...");
 
   sequence<OSMWay> ways(ways_file, false);
@@ -314,16 +317,30 @@ void ReclassifyFerryConnections(const std::string& ways_file,
   // specified classification. Want to do simple shortest path (time based
   // only) and obey driveability.
 
-  // Iterate through nodes and find any that connect to both a ferry and a
-  // regular (non-ferry) edge. Skip short ferry edges (river crossing?)
-  uint32_t ferry_endpoint_count = 0;
-  uint32_t total_count = 0;
-  sequence<Node>::iterator node_itr = nodes.begin();
-  while (node_itr != nodes.end()) {
-    auto bundle = collect_node_edges(node_itr, nodes, edges);
-    if (bundle.node.ferry_edge_ && bundle.node.non_ferry_edge_ &&
-        GetBestNonFerryClass(bundle.node_edges) > kFerryUpClass &&
-        !ShortFerry(node_itr.position(), bundle, edges, nodes, way_nodes)) {
+  // Find the nodes that connect to both a ferry and a regular (non-ferry)
+  // edge. Whether they do only depends on what reclassifying leaves alone.
+  std::vector<std::vector<uint32_t>> part_nodes(std::max(concurrency, 1u));
+  auto visit = [&part_nodes](size_t part, const sequence<Node>::iterator& node_itr,
+                             const node_bundle& bundle) {
+    if (bundle.node.ferry_edge_ && bundle.node.non_ferry_edge_) {
+      part_nodes[part].push_back(node_itr.position());
+    }
+  };
+  for_each_bundle(nodes, edges, part_nodes.size(), visit);
+  std::vector<uint32_t> ferry_nodes;
+  for (const auto& positions : part_nodes) {
+    ferry_nodes.insert(ferry_nodes.end(), positions.begin(), positions.end());
+  }
+
+  // Iterate through these nodes and skip short ferry edges (river crossing?)
+  std::vector<std::pair<uint32_t, uint32_t>> counts(ferry_nodes.size());
+  run_in_order(ferry_nodes.size(), concurrency, edges, [&](size_t i, edge_view_t& view) {
+    const uint32_t node_index = ferry_nodes[i];
+    uint32_t ferry_endpoint_count = 0;
+    uint32_t total_count = 0;
+    auto bundle = collect_node_edges(nodes[node_index], nodes, view);
+    if (GetBestNonFerryClass(bundle.node_edges) > kFerryUpClass &&
+        !ShortFerry(node_index, bundle, view, nodes, way_nodes)) {
       // Form shortest path from node along each edge connected to the ferry,
       // track until the specified RC is reached
       for (const auto& edge : bundle.node_edges) {
@@ -336,9 +353,8 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         }
 
         // Expand/reclassify from the end node of this edge.
-        uint32_t end_node_idx = (edge.first.sourcenode_ == node_itr.position())
-                                    ? edge.first.targetnode_
-                                    : edge.first.sourcenode_;
+        uint32_t end_node_idx = (edge.first.sourcenode_ == node_index) ? edge.first.targetnode_
+                                                                        : edge.first.sourcenode_;
 
         // if the non-ferry edge connecting on land is dest_only, we will unset dest_only
         // for all ways encountered during the expansion, to counteract a popular mapping
@@ -352,32 +368,35 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         if (edge_fwd_access == edge_rev_access) {
           // Driveable in both directions - get an inbound path and an
           // outbound path.
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, true, remove_destonly);
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, false, remove_destonly);
+          total_count += ShortestPath(node_index, end_node_idx, ways, way_nodes, view, nodes, true,
+                                      remove_destonly);
+          total_count += ShortestPath(node_index, end_node_idx, ways, way_nodes, view, nodes, false,
+                                      remove_destonly);
         } else {
           // Check if oneway inbound to the ferry
-          bool inbound =
-              (edge.first.sourcenode_ == node_itr.position()) ? edge_rev_access : edge_fwd_access;
-          total_count += ShortestPath(node_itr.position(), end_node_idx, ways, way_nodes, edges,
-                                      nodes, inbound, remove_destonly);
+          bool inbound = (edge.first.sourcenode_ == node_index) ? edge_rev_access : edge_fwd_access;
+          total_count += ShortestPath(node_index, end_node_idx, ways, way_nodes, view, nodes,
+                                      inbound, remove_destonly);
         }
         ferry_endpoint_count++;
 
         // Reclassify the first/start edge. Do this AFTER finding shortest path so
         // we do not immediately determine we hit the specified classification
-        sequence<Edge>::iterator element = edges[edge.second];
-        auto update_edge = *element;
+        auto update_edge = view.get(edge.second);
         update_edge.attributes.importance = kFerryUpClass;
         update_edge.attributes.reclass_ferry = remove_destonly;
-        element = update_edge;
+        view.set(edge.second, update_edge);
         total_count++;
       }
     }
+    counts[i] = {ferry_endpoint_count, total_count};
+  });
 
-    // Go to the next node
-    node_itr += bundle.node_count;
+  uint32_t ferry_endpoint_count = 0;
+  uint32_t total_count = 0;
+  for (const auto& count : counts) {
+    ferry_endpoint_count += count.first;
+    total_count += count.second;
   }
   LOG_INFO("Finished ReclassifyFerryEdges: ferry_endpoint_count = " +
            std::to_string(ferry_endpoint_count) + ", " + std::to_string(total_count) +
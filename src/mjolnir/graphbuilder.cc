@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <future>
 #include <set>
 #include <thread>
@@ -39,18 +40,35 @@ namespace {
  * we need the nodes to be sorted by graphid and then by osmid to make a set of tiles
  * we also need to then update the edges that pointed to them
  *
+ * with hilbert_order the nodes of a tile are sorted along a Hilbert curve first, their ids and
+ * so the order of their directed edges then follow the curve and nodes close to each other on the
+ * map end up close to each other in the tile. ids are assigned here before anything refers to
+ * them, so nothing else has to be renumbered
  */
-std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::string& edges_file) {
+std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
+                                    const std::string& edges_file,
+                                    const unsigned int threads,
+                                    const bool hilbert_order) {
   LOG_INFO("Sorting graph...");
 
+  // the fixed point lat,lng of the nodes are already a grid of 2^32 cells a side
+  auto curve_index = [](const Node& n) {
+    return hilbert_index(n.node.lng7_, n.node.lat7_, uint64_t(1) << 32);
+  };
+
   // Sort nodes by graphid then by osmid, so its basically a set of tiles
   sequence<Node> nodes(nodes_file, false);
-  nodes.sort([](const Node& a, const Node& b) {
-    if (a.graph_id == b.graph_id) {
-      return a.node.osmid_ < b.node.osmid_;
-    }
-    return a.graph_id < b.graph_id;
-  });
+  nodes.sort(
+      [hilbert_order, &curve_index](const Node& a, const Node& b) {
+        if (a.graph_id == b.graph_id) {
+          if (hilbert_order && (a.node.lng7_ != b.node.lng7_ || a.node.lat7_ != b.node.lat7_)) {
+            return curve_index(a) < curve_index(b);
+          }
+          return a.node.osmid_ < b.node.osmid_;
+        }
+        return a.graph_id < b.graph_id;
+      },
+      sequence<Node>::sort_buffer_size, threads);
 
   // run through the sorted nodes, going back to the edges they reference and updating each edge
   // to point to the first (out of the duplicates) nodes index. at the end of this there will be
@@ -113,8 +131,8 @@ std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::st
   auto cmp = [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
     return a.first < b.first;
   };
-  starts->sort(cmp);
-  ends->sort(cmp);
+  starts->sort(cmp, edge_ends_t::sort_buffer_size, threads);
+  ends->sort(cmp, edge_ends_t::sort_buffer_size, threads);
 
   sequence<Edge> edges(edges_file, false);
 
@@ -395,6 +413,8 @@ void BuildTileSet(const std::string& ways_file,
                   std::map<GraphId, size_t>::const_iterator tile_end,
                   const uint32_t tile_creation_date,
                   const boost::property_tree::ptree& pt,
+                  const std::shared_ptr<const PolygonIndex>& admin_index,
+                  const std::shared_ptr<const PolygonIndex>& tz_index,
                   std::promise<DataQuality>& result) {
 
   sequence<OSMWay> ways(ways_file, false);
@@ -415,21 +435,22 @@ void BuildTileSet(const std::string& ways_file,
   bool use_urban_tag = pt.get<bool>("data_processing.use_urban_tag", false);
   bool use_admin_db = pt.get<bool>("data_processing.use_admin_db", true);
 
-  // Initialize the admin DB (if it exists)
-  sqlite3* admin_db_handle = (database && use_admin_db) ? GetDBHandle(*database) : nullptr;
+  // Initialize the admin DB (if it exists and its polygons weren't loaded up front)
+  sqlite3* admin_db_handle =
+      (database && use_admin_db && !admin_index) ? GetDBHandle(*database) : nullptr;
   if (!database && use_admin_db) {
     LOG_WARN("Admin db not found.  Not saving admin information.");
-  } else if (!admin_db_handle && use_admin_db) {
+  } else if (!admin_db_handle && !admin_index && use_admin_db) {
     LOG_WARN("Admin db " + *database + " not found.  Not saving admin information.");
   }
   auto admin_conn = make_spatialite_cache(admin_db_handle);
 
   database = pt.get_optional<std::string>("timezone");
   // Initialize the tz DB (if it exists)
-  sqlite3* tz_db_handle = database ? GetDBHandle(*database) : nullptr;
+  sqlite3* tz_db_handle = (database && !tz_index) ? GetDBHandle(*database) : nullptr;
   if (!database) {
     LOG_WARN("Time zone db not found.  Not saving time zone information.");
-  } else if (!tz_db_handle) {
+  } else if (!tz_db_handle && !tz_index) {
     LOG_WARN("Time zone db " + *database + " not found.  Not saving time zone information.");
   }
   auto tz_conn = make_spatialite_cache(tz_db_handle);
@@ -479,9 +500,13 @@ void BuildTileSet(const std::string& ways_file,
       std::unordered_map<uint32_t, bool> drive_on_right;
       std::unordered_map<uint32_t, bool> allow_intersection_names;
 
-      if (admin_db_handle) {
-        admin_polys = GetAdminInfo(admin_db_handle, drive_on_right, allow_intersection_names,
-                                   tiling.TileBounds(id), graphtile);
+      if (admin_index || admin_db_handle) {
+        admin_polys = admin_index ? GetAdminInfo(*admin_index, drive_on_right,
+                                                 allow_intersection_names, tiling.TileBounds(id),
+                                                 graphtile)
+                                  : GetAdminInfo(admin_db_handle, drive_on_right,
+                                                 allow_intersection_names, tiling.TileBounds(id),
+                                                 graphtile);
         if (admin_polys.size() == 1) {
           // TODO - check if tile bounding box is entirely inside the polygon...
           tile_within_one_admin = true;
@@ -490,8 +515,9 @@ void BuildTileSet(const std::string& ways_file,
 
       bool tile_within_one_tz = false;
       std::multimap<uint32_t, multi_polygon_type> tz_polys;
-      if (tz_db_handle) {
-        tz_polys = GetTimeZones(tz_db_handle, tiling.TileBounds(id));
+      if (tz_index || tz_db_handle) {
+        tz_polys = tz_index ? GetTimeZones(*tz_index, tiling.TileBounds(id))
+                            : GetTimeZones(tz_db_handle, tiling.TileBounds(id));
         if (tz_polys.size() == 1) {
           tile_within_one_tz = true;
         }
@@ -1146,6 +1172,28 @@ void BuildLocalTiles(const unsigned int thread_count,
   LOG_INFO("Building " + std::to_string(tiles.size()) + " tiles with " +
            std::to_string(thread_count) + " threads...");
 
+  // The admin and timezone polygons are loaded once for all the threads, instead of every thread
+  // querying the dbs for the ones of each of its tiles
+  std::shared_ptr<const PolygonIndex> admin_index, tz_index;
+  if (pt.get<bool>("mjolnir.data_processing.preload_polygons", true)) {
+    auto load = [](const boost::optional<std::string>& database, const auto& loader) {
+      std::shared_ptr<const PolygonIndex> index;
+      sqlite3* db_handle = database ? GetDBHandle(*database) : nullptr;
+      if (db_handle) {
+        auto conn = make_spatialite_cache(db_handle);
+        index = loader(db_handle);
+        conn.reset();
+        sqlite3_close(db_handle);
+        LOG_INFO("Loaded " + std::to_string(index->size()) + " polygons from " + *database);
+      }
+      return index;
+    };
+    if (pt.get<bool>("mjolnir.data_processing.use_admin_db", true)) {
+      admin_index = load(pt.get_optional<std::string>("mjolnir.admin"), PolygonIndex::LoadAdmins);
+    }
+    tz_index = load(pt.get_optional<std::string>("mjolnir.timezone"), PolygonIndex::LoadTimeZones);
+  }
+
   // A place to hold worker threads and their results, be they exceptions or otherwise
   std::vector<std::shared_ptr<std::thread>> threads(thread_count);
 
@@ -1172,7 +1220,8 @@ void BuildLocalTiles(const unsigned int thread_count,
                                      std::cref(complex_to_restriction_file),
                                      std::cref(pronunciation_file), std::cref(tile_dir),
                                      std::cref(osmdata), tile_start, tile_end, tile_creation_date,
-                                     std::cref(pt.get_child("mjolnir")), std::ref(results[i])));
+                                     std::cref(pt.get_child("mjolnir")), std::cref(admin_index),
+                                     std::cref(tz_index), std::ref(results[i])));
   }
 
   // Join all the threads to wait for them to finish up their work
@@ -1214,7 +1263,11 @@ std::map<GraphId, size_t> GraphBuilder::BuildEdges(const boost::property_tree::p
       [&level](const OSMNode& node) { return TileHierarchy::GetGraphId(node.latlng(), level); },
       pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
 
-  return SortGraph(nodes_file, edges_file);
+  return SortGraph(nodes_file, edges_file,
+                   std::max(static_cast<unsigned int>(1),
+                            pt.get<unsigned int>("mjolnir.concurrency",
+                                                 std::thread::hardware_concurrency())),
+                   pt.get<bool>("mjolnir.data_processing.hilbert_node_order", false));
 }
 
 // Build the graph from the input
@@ -1228,30 +1281,56 @@ void GraphBuilder::Build(const boost::property_tree::ptree& pt,
                          const std::string& complex_to_restriction_file,
                          const std::string& pronunciation_file,
                          const std::map<GraphId, size_t>& tiles) {
-  // Reclassify links (ramps). Cannot do this when building tiles since the
-  // edge list needs to be modified
+  // The edges are reclassified once, before the shards build their tiles
   DataQuality stats;
-  if (pt.get<bool>("mjolnir.reclassify_links", true)) {
-    ReclassifyLinks(ways_file, nodes_file, edges_file, way_nodes_file, osmdata,
-                    pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
-  } else {
-    LOG_WARN("Not reclassifying link graph edges");
+  const auto shard = TileShard::FromConfig(pt);
+  if (!shard.sharded()) {
+    Reclassify(pt, osmdata, ways_file, way_nodes_file, nodes_file, edges_file);
   }
-
-  // Reclassify ferry connection edges - uses RoadClass::kPrimary (highway classification) as cutoff
-  ReclassifyFerryConnections(ways_file, way_nodes_file, nodes_file, edges_file);
   unsigned int threads =
       std::max(static_cast<unsigned int>(1),
                pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
+  // The tiles of this shard, with the index of their first node
+  std::map<GraphId, size_t> shard_tiles;
+  std::vector<GraphId> tile_ids;
+  for (const auto& tile : tiles) {
+    tile_ids.push_back(tile.first);
+  }
+  for (const auto& tile_id : shard.Select(tile_ids)) {
+    shard_tiles.emplace(tile_id, tiles.at(tile_id));
+  }
+
   // Build tiles at the local level. Form connected graph from nodes and edges.
   std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
   BuildLocalTiles(threads, osmdata, ways_file, way_nodes_file, nodes_file, edges_file,
                   complex_from_restriction_file, complex_to_restriction_file, pronunciation_file,
-                  tiles, tile_dir, stats, pt);
+                  shard_tiles, tile_dir, stats, pt);
   stats.LogStatistics();
 }
 
+void GraphBuilder::Reclassify(const boost::property_tree::ptree& pt,
+                              const OSMData& osmdata,
+                              const std::string& ways_file,
+                              const std::string& way_nodes_file,
+                              const std::string& nodes_file,
+                              const std::string& edges_file) {
+  const auto concurrency = std::max(
+      pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()), 1u);
+
+  // Reclassify links (ramps). Cannot do this when building tiles since the
+  // edge list needs to be modified
+  if (pt.get<bool>("mjolnir.reclassify_links", true)) {
+    ReclassifyLinks(ways_file, nodes_file, edges_file, way_nodes_file, osmdata,
+                    pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true), concurrency);
+  } else {
+    LOG_WARN("Not reclassifying link graph edges");
+  }
+
+  // Reclassify ferry connection edges - uses RoadClass::kPrimary (highway classification) as cutoff
+  ReclassifyFerryConnections(ways_file, way_nodes_file, nodes_file, edges_file, concurrency);
+}
+
 // Get highway refs from relations
 std::string GraphBuilder::GetRef(const std::string& way_ref, const std::string& relation_ref) {
   bool found = false;
@@ -0,0 +1,1981 @@
+#include "mjolnir/graphtagtransform.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+#include <boost/format.hpp>
+
+#include "midgard/logging.h"
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// The rules follow lua/graph.lua statement by statement, with its nil as a nullptr for strings and
+// kNil for numbers, so a change there is easy to find and make here
+
+constexpr int kNil = -1;
+const char* const kTrue = "true";
+const char* const kFalse = "false";
+
+using strings_t = std::unordered_map<std::string_view, const char*>;
+using numbers_t = std::unordered_map<std::string_view, int>;
+
+// t[k] of a table, nil for a nil key or one it doesnt have
+const char* at(const strings_t& table, const char* key) {
+  if (key == nullptr) {
+    return nullptr;
+  }
+  auto found = table.find(key);
+  return found == table.end() ? nullptr : found->second;
+}
+
+int at(const numbers_t& table, const char* key) {
+  if (key == nullptr) {
+    return kNil;
+  }
+  auto found = table.find(key);
+  return found == table.end() ? kNil : found->second;
+}
+
+// a or b or ...
+const char* either(const char* a) {
+  return a;
+}
+
+template <typename... Rest> const char* either(const char* a, Rest... rest) {
+  return a != nullptr ? a : either(rest...);
+}
+
+int either(int a, int b) {
+  return a != kNil ? a : b;
+}
+
+bool eq(const char* a, const char* b) {
+  return a != nullptr && std::strcmp(a, b) == 0;
+}
+
+// tostring of a lua number, luajit prints them with %.14g
+std::string to_string(double number) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.14g", number);
+  return buffer;
+}
+
+// tonumber of a string, nil when it isnt all a number but for the white space around it
+bool to_number(const char* str, double& number) {
+  if (str == nullptr) {
+    return false;
+  }
+  while (std::isspace(static_cast<unsigned char>(*str))) {
+    ++str;
+  }
+  if (*str == '\0') {
+    return false;
+  }
+  char* end = nullptr;
+  number = std::strtod(str, &end);
+  if (end == str) {
+    return false;
+  }
+  while (std::isspace(static_cast<unsigned char>(*end))) {
+    ++end;
+  }
+  return *end == '\0';
+}
+
+// the arithmetic on a nil which makes the lua fail
+double to_number(const char* str) {
+  double number;
+  if (!to_number(str, number)) {
+    throw std::runtime_error("attempt to perform arithmetic on a nil value");
+  }
+  return number;
+}
+
+bool ends_with(const std::string& str, const char* suffix) {
+  const auto length = std::strlen(suffix);
+  return str.size() >= length && str.compare(str.size() - length, length, suffix) == 0;
+}
+
+// The tags as the lua table kv, a missing key is nil
+class kv_t {
+public:
+  explicit kv_t(Tags& tags) : tags_(tags) {
+  }
+
+  const char* operator[](const std::string& key) const {
+    auto found = tags_.find(key);
+    return found == tags_.end() ? nullptr : found->second.c_str();
+  }
+
+  bool is(const std::string& key, const char* value) const {
+    return eq((*this)[key], value);
+  }
+
+  void set(const std::string& key, const char* value) {
+    if (value == nullptr) {
+      tags_.erase(key);
+      return;
+    }
+    auto& current = tags_[key];
+    if (current.c_str() != value) {
+      current = value;
+    }
+  }
+
+  void set(const std::string& key, const std::string& value) {
+    tags_[key] = value;
+  }
+
+  void set_number(const std::string& key, double number) {
+    tags_[key] = to_string(number);
+  }
+
+  void set_number(const std::string& key, int number) {
+    if (number == kNil) {
+      tags_.erase(key);
+      return;
+    }
+    tags_[key] = std::to_string(number);
+  }
+
+  void swap(const std::string& a, const std::string& b) {
+    auto found_a = tags_.find(a);
+    auto found_b = tags_.find(b);
+    if (found_a != tags_.end() && found_b != tags_.end()) {
+      std::swap(found_a->second, found_b->second);
+    } else if (found_a != tags_.end()) {
+      tags_[b] = std::move(found_a->second);
+      tags_.erase(a);
+    } else if (found_b != tags_.end()) {
+      tags_[a] = std::move(found_b->second);
+      tags_.erase(b);
+    }
+  }
+
+private:
+  Tags& tags_;
+};
+
+// the modes of the highway table in the order of its columns
+const std::array<const char*, 8> kForwardKeys = {"auto_forward",       "truck_forward",
+                                                 "bus_forward",        "taxi_forward",
+                                                 "moped_forward",      "motorcycle_forward",
+                                                 "pedestrian_forward", "bike_forward"};
+
+// auto, truck, bus, taxi, moped, motorcycle, pedestrian, bike
+const std::unordered_map<std::string_view, std::array<bool, 8>> highway = {
+    {"motorway", {1, 1, 1, 1, 0, 1, 0, 0}},        {"motorway_link", {1, 1, 1, 1, 0, 1, 0, 0}},
+    {"trunk", {1, 1, 1, 1, 1, 1, 1, 1}},           {"trunk_link", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"primary", {1, 1, 1, 1, 1, 1, 1, 1}},         {"primary_link", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"secondary", {1, 1, 1, 1, 1, 1, 1, 1}},       {"secondary_link", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"residential", {1, 1, 1, 1, 1, 1, 1, 1}},     {"residential_link", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"service", {1, 1, 1, 1, 1, 1, 1, 1}},         {"tertiary", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"tertiary_link", {1, 1, 1, 1, 1, 1, 1, 1}},   {"road", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"track", {1, 1, 1, 1, 1, 1, 1, 1}},           {"unclassified", {1, 1, 1, 1, 1, 1, 1, 1}},
+    {"undefined", {0, 0, 0, 0, 0, 0, 0, 0}},       {"unknown", {0, 0, 0, 0, 0, 0, 0, 0}},
+    {"living_street", {1, 1, 1, 1, 1, 1, 1, 1}},   {"footway", {0, 0, 0, 0, 0, 0, 1, 0}},
+    {"pedestrian", {0, 0, 0, 0, 0, 0, 1, 0}},      {"steps", {0, 0, 0, 0, 0, 0, 1, 1}},
+    {"bridleway", {0, 0, 0, 0, 0, 0, 0, 0}},       {"cycleway", {0, 0, 0, 0, 0, 0, 0, 1}},
+    {"path", {0, 0, 0, 0, 0, 0, 1, 1}},            {"bus_guideway", {0, 0, 1, 0, 0, 0, 0, 0}},
+    {"busway", {0, 0, 1, 0, 0, 0, 0, 0}},          {"corridor", {0, 0, 0, 0, 0, 0, 1, 0}},
+    {"elevator", {0, 0, 0, 0, 0, 0, 1, 0}},        {"platform", {0, 0, 0, 0, 0, 0, 1, 0}},
+};
+
+const numbers_t road_class = {
+    {"motorway", 0},  {"motorway_link", 0},  {"trunk", 1},         {"trunk_link", 1},
+    {"primary", 2},   {"primary_link", 2},   {"secondary", 3},     {"secondary_link", 3},
+    {"tertiary", 4},  {"tertiary_link", 4},  {"unclassified", 5},  {"residential", 6},
+    {"residential_link", 6},
+};
+
+const numbers_t restriction = {
+    {"no_left_turn", 0},     {"no_right_turn", 1},  {"no_straight_on", 2}, {"no_u_turn", 3},
+    {"only_right_turn", 4},  {"only_left_turn", 5}, {"only_straight_on", 6},
+    {"no_entry", 7},         {"no_exit", 8},        {"no_turn", 9},
+};
+
+// the default speed for tracks is lowered after the call to default_speed
+const std::array<int, 8> default_speed = {105, 90, 75, 60, 50, 40, 35, 25};
+
+const strings_t access = {
+    {"yes", kTrue},         {"private", kTrue},    {"no", kFalse},          {"permissive", kTrue},
+    {"agricultural", kFalse}, {"use_sidepath", kTrue}, {"delivery", kTrue}, {"designated", kTrue},
+    {"dismount", kTrue},    {"discouraged", kFalse}, {"forestry", kFalse},  {"destination", kTrue},
+    {"customers", kTrue},   {"official", kFalse},  {"public", kTrue},       {"restricted", kTrue},
+    {"allowed", kTrue},     {"emergency", kFalse}, {"psv", kFalse},         {"permit", kTrue},
+    {"residents", kTrue},
+};
+
+const strings_t private_ = {
+    {"private", kTrue},  {"destination", kTrue}, {"customers", kTrue},
+    {"delivery", kTrue}, {"permit", kTrue},      {"residents", kTrue},
+};
+
+const strings_t no_thru_traffic = {
+    {"destination", kTrue}, {"customers", kTrue}, {"delivery", kTrue},
+    {"permit", kTrue},      {"residents", kTrue},
+};
+
+const numbers_t use = {
+    {"driveway", 4}, {"alley", 5}, {"parking_aisle", 6}, {"emergency_access", 7},
+    {"drive-through", 8},
+};
+
+const strings_t motor_vehicle = {
+    {"yes", kTrue},          {"private", kTrue},     {"no", kFalse},        {"permissive", kTrue},
+    {"agricultural", kFalse}, {"delivery", kTrue},   {"designated", kTrue}, {"discouraged", kFalse},
+    {"forestry", kFalse},    {"destination", kTrue}, {"customers", kTrue},  {"official", kFalse},
+    {"public", kTrue},       {"restricted", kTrue},  {"allowed", kTrue},    {"permit", kTrue},
+    {"residents", kTrue},
+};
+
+const strings_t moped = {
+    {"yes", kTrue},      {"designated", kTrue}, {"private", kTrue},      {"permissive", kTrue},
+    {"destination", kTrue}, {"delivery", kTrue}, {"dismount", kTrue},    {"no", kFalse},
+    {"unknown", kFalse}, {"agricultural", kFalse}, {"permit", kTrue},    {"residents", kTrue},
+};
+
+const strings_t foot = {
+    {"yes", kTrue},          {"private", kTrue},     {"no", kFalse},          {"permissive", kTrue},
+    {"agricultural", kFalse}, {"use_sidepath", kTrue}, {"delivery", kTrue},   {"designated", kTrue},
+    {"discouraged", kFalse}, {"forestry", kFalse},   {"destination", kTrue},  {"customers", kTrue},
+    {"official", kTrue},     {"public", kTrue},      {"restricted", kTrue},   {"crossing", kTrue},
+    {"sidewalk", kTrue},     {"allowed", kTrue},     {"passable", kTrue},     {"footway", kTrue},
+    {"permit", kTrue},       {"residents", kTrue},
+};
+
+const strings_t wheelchair = {
+    {"no", kFalse},       {"yes", kTrue},      {"designated", kTrue}, {"limited", kTrue},
+    {"official", kTrue},  {"destination", kTrue}, {"public", kTrue},  {"permissive", kTrue},
+    {"only", kTrue},      {"private", kTrue},  {"impassable", kFalse}, {"partial", kFalse},
+    {"bad", kFalse},      {"half", kFalse},    {"assisted", kTrue},   {"permit", kTrue},
+    {"residents", kTrue},
+};
+
+const strings_t bus = {
+    {"no", kFalse},       {"yes", kTrue},        {"designated", kTrue}, {"urban", kTrue},
+    {"permissive", kTrue}, {"restricted", kTrue}, {"destination", kTrue}, {"delivery", kFalse},
+    {"official", kFalse}, {"permit", kTrue},
+};
+
+const strings_t taxi = bus;
+
+const strings_t psv = {
+    {"bus", kTrue},        {"taxi", kTrue},       {"no", kFalse}, {"yes", kTrue},
+    {"designated", kTrue}, {"permissive", kTrue}, {"1", kTrue},   {"2", kTrue},
+};
+
+const strings_t truck = {
+    {"designated", kTrue},     {"yes", kTrue},           {"no", kFalse},
+    {"destination", kTrue},    {"delivery", kTrue},      {"local", kTrue},
+    {"agricultural", kFalse},  {"private", kTrue},       {"discouraged", kFalse},
+    {"permissive", kFalse},    {"unsuitable", kFalse},   {"agricultural;forestry", kFalse},
+    {"official", kFalse},      {"forestry", kFalse},     {"destination;delivery", kTrue},
+    {"permit", kTrue},         {"residents", kTrue},
+};
+
+const strings_t hazmat = {
+    {"designated", kTrue}, {"yes", kTrue},       {"no", kFalse},
+    {"destination", kFalse}, {"delivery", kFalse},
+};
+
+const strings_t shoulder = {{"yes", kTrue}, {"both", kTrue}, {"no", kFalse}};
+const strings_t shoulder_right = {{"right", kTrue}};
+const strings_t shoulder_left = {{"left", kTrue}};
+
+const strings_t bicycle = {
+    {"yes", kTrue},        {"designated", kTrue}, {"use_sidepath", kTrue}, {"no", kFalse},
+    {"permissive", kTrue}, {"destination", kTrue}, {"dismount", kTrue},   {"lane", kTrue},
+    {"track", kTrue},      {"shared", kTrue},     {"shared_lane", kTrue},  {"sidepath", kTrue},
+    {"share_busway", kTrue}, {"none", kFalse},    {"allowed", kTrue},      {"private", kTrue},
+    {"official", kTrue},   {"permit", kTrue},     {"residents", kTrue},
+};
+
+const strings_t cycleway = {
+    {"yes", kTrue},        {"designated", kTrue},  {"use_sidepath", kTrue}, {"permissive", kTrue},
+    {"destination", kTrue}, {"dismount", kTrue},   {"lane", kTrue},         {"track", kTrue},
+    {"shared", kTrue},     {"shared_lane", kTrue}, {"sidepath", kTrue},     {"share_busway", kTrue},
+    {"allowed", kTrue},    {"private", kTrue},     {"cyclestreet", kTrue},  {"crossing", kTrue},
+};
+
+const strings_t bike_reverse = {
+    {"opposite", kTrue}, {"opposite_lane", kTrue}, {"opposite_track", kTrue}};
+const strings_t bus_reverse = {{"opposite", kTrue}, {"opposite_lane", kTrue}};
+
+const numbers_t shared = {{"shared_lane", 1}, {"share_busway", 1}, {"shared", 1}};
+const numbers_t buffer = {{"yes", 2}};
+const numbers_t dedicated = {{"opposite_lane", 2}, {"lane", 2}, {"buffered_lane", 2}};
+const numbers_t separated = {{"opposite_track", 3}, {"track", 3}};
+
+const strings_t oneway = {
+    {"no", kFalse}, {"false", kFalse}, {"-1", kTrue},         {"yes", kTrue},
+    {"true", kTrue}, {"1", kTrue},     {"reversible", kFalse}, {"alternating", kFalse},
+};
+
+const strings_t bridge = {{"yes", kTrue}, {"no", kFalse}, {"1", kTrue}};
+
+const strings_t tunnel = {
+    {"yes", kTrue}, {"no", kFalse}, {"1", kTrue}, {"building_passage", kTrue}};
+
+const strings_t toll = {
+    {"yes", kTrue}, {"no", kFalse},      {"true", kTrue},       {"false", kFalse},
+    {"1", kTrue},   {"interval", kTrue}, {"snowmobile", kTrue},
+};
+
+const strings_t lit = {
+    {"yes", kTrue},      {"no", kFalse},      {"24/7", kTrue},      {"automatic", kTrue},
+    {"limited", kFalse}, {"disused", kFalse}, {"dusk-dawn", kTrue}, {"sunset-sunrise", kTrue},
+};
+
+// node proc needs the same info as above but in the form of a mask
+numbers_t mask(const strings_t& table, int bit) {
+  numbers_t masks;
+  for (const auto& value : table) {
+    masks.emplace(value.first, eq(value.second, kTrue) ? bit : 0);
+  }
+  return masks;
+}
+
+const numbers_t motor_vehicle_node = mask(motor_vehicle, 1);
+const numbers_t bicycle_node = mask(bicycle, 4);
+const numbers_t foot_node = mask(foot, 2);
+const numbers_t wheelchair_node = mask(wheelchair, 256);
+const numbers_t moped_node = mask(moped, 512);
+const numbers_t motor_cycle_node = [] {
+  // motor_vehicle without the residents
+  auto masks = mask(motor_vehicle, 1024);
+  masks.erase("residents");
+  return masks;
+}();
+const numbers_t bus_node = mask(bus, 64);
+const numbers_t taxi_node = mask(taxi, 32);
+const numbers_t truck_node = mask(truck, 8);
+const numbers_t psv_bus_node = [] {
+  auto masks = mask(psv, 64);
+  masks.erase("taxi");
+  return masks;
+}();
+const numbers_t psv_taxi_node = [] {
+  auto masks = mask(psv, 32);
+  masks.erase("bus");
+  return masks;
+}();
+
+double round(double val, int n) {
+  const auto scale = std::pow(10.0, n);
+  return std::floor((val * scale) + 0.5) / scale;
+}
+
+// the restriction type before the @ of a conditional restriction, as many characters of it as
+// there are others than spaces
+const char* restriction_prefix(const char* restriction_str, std::string& prefix) {
+  if (restriction_str == nullptr) {
+    return nullptr;
+  }
+  size_t index = 0;
+  bool found = false;
+  for (const char* c = restriction_str; *c; ++c) {
+    if (*c == '@') {
+      found = true;
+      break;
+    }
+    if (*c != ' ') {
+      ++index;
+    }
+  }
+  if (!found) {
+    return nullptr;
+  }
+  prefix.assign(restriction_str, index);
+  return prefix.c_str();
+}
+
+// the date and time of a conditional restriction after the @
+const char* restriction_suffix(const char* restriction_str, std::string& suffix) {
+  if (restriction_str == nullptr) {
+    return nullptr;
+  }
+  size_t index = 0;
+  bool found = false;
+  for (const char* c = restriction_str; *c; ++c) {
+    if (found) {
+      if (*c != ' ') {
+        ++index;
+        break;
+      }
+    } else if (*c == '@') {
+      found = true;
+    }
+    ++index;
+  }
+  if (!found) {
+    return nullptr;
+  }
+  // string.sub from the 1 based index to the end
+  const auto length = std::strlen(restriction_str);
+  suffix.assign(restriction_str + std::min(index, length) - (index > 0 ? 1 : 0));
+  return suffix.c_str();
+}
+
+// the numeric (non negative) number portion at the beginning of the string
+const char* numeric_prefix(const char* num_str, bool allow_decimals, std::string& prefix) {
+  if (num_str == nullptr) {
+    return nullptr;
+  }
+  size_t index = 0;
+  bool seen_dot = false;
+  for (const char* c = num_str; *c; ++c) {
+    if (!std::isdigit(static_cast<unsigned char>(*c))) {
+      if (*c == '.') {
+        if (!allow_decimals || seen_dot) {
+          break;
+        }
+        seen_dot = true;
+      } else {
+        break;
+      }
+    }
+    ++index;
+  }
+  if (index == 0) {
+    return nullptr;
+  }
+  prefix.assign(num_str, index);
+  return prefix.c_str();
+}
+
+// a speed in kph from 10 to 150, nil when there is none
+bool normalize_speed(const char* speed, double& num) {
+  std::string prefix;
+  if (!to_number(numeric_prefix(speed, false, prefix), num)) {
+    return false;
+  }
+  if (ends_with(speed, "mph")) {
+    num = round(num * 1.609344, 0);
+  }
+  return !(num > 150 || num < 10);
+}
+
+void set_speed(kv_t& kv, const std::string& key, const char* speed) {
+  double num;
+  if (normalize_speed(speed, num)) {
+    kv.set_number(key, num);
+  } else {
+    kv.set(key, nullptr);
+  }
+}
+
+// a weight in tons
+bool normalize_weight(const char* weight, double& num) {
+  if (weight == nullptr) {
+    return false;
+  }
+  std::string w;
+  for (const char* c = weight; *c; ++c) {
+    if (!std::isspace(static_cast<unsigned char>(*c))) {
+      w.push_back(*c);
+    }
+  }
+  std::string prefix;
+  if (numeric_prefix(w.c_str(), true, prefix) == nullptr) {
+    return false;
+  }
+  if (ends_with(w, "t") || ends_with(w, "tonne") || ends_with(w, "tonnes")) {
+    if (prefix + "t" == w || prefix + "tonne" == w || prefix + "tonnes" == w) {
+      num = round(to_number(prefix.c_str()), 2);
+      return true;
+    }
+  }
+  if (ends_with(w, "ton") || ends_with(w, "tons")) {
+    if (prefix + "ton" == w || prefix + "tons" == w) {
+      num = round(to_number(prefix.c_str()), 2);
+      return true;
+    }
+  }
+  if (ends_with(w, "lb") || ends_with(w, "lbs")) {
+    if (prefix + "lb" == w || prefix + "lbs" == w) {
+      num = round(to_number(prefix.c_str()) / 2000, 2);
+      return true;
+    }
+  }
+  if (ends_with(w, "kg")) {
+    if (prefix + "kg" == w) {
+      num = round(to_number(prefix.c_str()) / 1000, 2);
+      return true;
+    }
+  }
+  num = round(to_number(prefix.c_str()), 2);
+  return true;
+}
+
+void set_weight(kv_t& kv, const std::string& key, const char* weight) {
+  double num;
+  if (normalize_weight(weight, num)) {
+    kv.set_number(key, num);
+  } else {
+    kv.set(key, nullptr);
+  }
+}
+
+// a length in meters, feet and inches too
+bool normalize_measurement(const char* value, double& num) {
+  if (value == nullptr) {
+    return false;
+  }
+  // turn commas into dots to handle European-style decimal separators
+  std::string measurement(value);
+  std::replace(measurement.begin(), measurement.end(), ',', '.');
+
+  // the simple case: it's just a plain number
+  if (to_number(measurement.c_str(), num)) {
+    num = round(num, 2);
+    return true;
+  }
+
+  // the terms of compound expressions such as 3ft6in, as the lua pattern
+  // (%d+[.,]?%d*) *([a-zA-Z\"\']*) matches them, summed up in meters
+  double sum = 0;
+  int count = 0;
+  const auto is_digit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+  const auto is_unit = [](char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) != 0 || c == '"' || c == '\'';
+  };
+  size_t i = 0;
+  while (i < measurement.size()) {
+    if (!is_digit(measurement[i])) {
+      ++i;
+      continue;
+    }
+    auto start = i;
+    while (i < measurement.size() && is_digit(measurement[i])) {
+      ++i;
+    }
+    if (i < measurement.size() && (measurement[i] == '.' || measurement[i] == ',')) {
+      ++i;
+    }
+    while (i < measurement.size() && is_digit(measurement[i])) {
+      ++i;
+    }
+    const auto item = measurement.substr(start, i - start);
+    while (i < measurement.size() && measurement[i] == ' ') {
+      ++i;
+    }
+    start = i;
+    while (i < measurement.size() && is_unit(measurement[i])) {
+      ++i;
+    }
+    auto unit = measurement.substr(start, i - start);
+
+    double item_num;
+    if (!to_number(item.c_str(), item_num)) {
+      return false;
+    }
+    for (auto& c : unit) {
+      c = std::tolower(static_cast<unsigned char>(c));
+    }
+    if (unit == "m" || unit == "meter" || unit == "meters") {
+      sum = sum + item_num;
+    } else if (unit == "cm") {
+      sum = sum + item_num * 0.01;
+    } else if (unit == "ft" || unit == "feet" || unit == "foot" || unit == "'") {
+      sum = sum + item_num * 0.3048;
+    } else if (unit == "in" || unit == "inches" || unit == "inch" || unit == "\"" ||
+               unit == "''") {
+      sum = sum + item_num * 0.0254;
+    } else {
+      // unknown unit! bail!
+      return false;
+    }
+    ++count;
+  }
+
+  if (count > 0) {
+    num = round(sum, 2);
+    return true;
+  }
+  return false;
+}
+
+// true if the only payment types present are cash, see the lua for the details
+bool is_cash_only_payment(const Tags& tags) {
+  bool allows_cash_payment = false;
+  bool allows_noncash_payment = false;
+  for (const auto& tag : tags) {
+    if (tag.first.compare(0, 8, "payment:") == 0) {
+      const auto payment_type = tag.first.substr(8);
+      const bool is_cash_payment_type =
+          payment_type == "cash" || payment_type == "notes" || payment_type == "coins";
+      auto upper = tag.second;
+      for (auto& c : upper) {
+        c = std::toupper(static_cast<unsigned char>(c));
+      }
+      if (is_cash_payment_type && !allows_cash_payment) {
+        allows_cash_payment = upper != "NO";
+      }
+      if (!is_cash_payment_type && !allows_noncash_payment) {
+        allows_noncash_payment = upper != "NO";
+      }
+    }
+  }
+  return allows_cash_payment && !allows_noncash_payment;
+}
+
+void set_all(kv_t& kv, const char* direction, const char* value, bool pedestrian = true) {
+  for (const char* mode : {"auto", "truck", "bus", "taxi", "moped", "motorcycle", "bike"}) {
+    kv.set(std::string(mode) + direction, value);
+  }
+  if (pedestrian) {
+    kv.set(std::string("pedestrian") + direction, value);
+  }
+}
+
+// the mode overrides of both branches of filter_tags_generic, with what they fall back to
+void mode_overrides(kv_t& kv, bool known_highway, const char* default_val, const char* ped_val) {
+  auto fallback = [&](const char* key) { return known_highway ? kv[key] : default_val; };
+
+  // check for auto_forward overrides
+  const char* auto_tag =
+      either(at(motor_vehicle, kv["motorcar"]), at(motor_vehicle, kv["motor_vehicle"]));
+  kv.set("auto_forward", either(auto_tag, fallback("auto_forward")));
+  kv.set("auto_tag", auto_tag);
+
+  // check for truck_forward override
+  const char* truck_tag = either(at(truck, kv["hgv"]), at(motor_vehicle, kv["motor_vehicle"]));
+  if (known_highway) {
+    kv.set("truck_forward", either(truck_tag, kv["truck_forward"]));
+  } else {
+    kv.set("truck_forward", either(at(truck, kv["hgv"]), kv["truck_forward"],
+                                   at(motor_vehicle, kv["motor_vehicle"]), default_val));
+  }
+  kv.set("truck_tag", truck_tag);
+
+  // check for bus_forward overrides
+  const char* bus_tag =
+      either(at(bus, kv["bus"]), at(psv, kv["psv"]), at(psv, kv["lanes:psv:forward"]),
+             at(motor_vehicle, kv["motor_vehicle"]));
+  kv.set("bus_forward", either(bus_tag, fallback("bus_forward")));
+  kv.set("bus_tag", bus_tag);
+
+  // check for taxi_forward overrides
+  const char* taxi_tag =
+      either(at(taxi, kv["taxi"]), at(psv, kv["psv"]), at(psv, kv["lanes:psv:forward"]),
+             at(motor_vehicle, kv["motor_vehicle"]));
+  kv.set("taxi_forward", either(taxi_tag, fallback("taxi_forward")));
+  kv.set("taxi_tag", taxi_tag);
+
+  // check for ped overrides
+  const char* foot_tag = either(at(foot, kv["foot"]), at(foot, kv["pedestrian"]));
+  kv.set("pedestrian_forward",
+         either(foot_tag, known_highway ? kv["pedestrian_forward"] : ped_val));
+  kv.set("foot_tag", foot_tag);
+
+  // check for bike_forward overrides
+  const char* bike_tag = either(at(bicycle, kv["bicycle"]), at(cycleway, kv["cycleway"]),
+                                at(bicycle, kv["bicycle_road"]), at(bicycle, kv["cyclestreet"]));
+  kv.set("bike_forward", either(bike_tag, fallback("bike_forward")));
+  kv.set("bike_tag", bike_tag);
+
+  // check for moped forward overrides
+  const char* moped_tag = either(at(moped, kv["moped"]), at(moped, kv["mofa"]),
+                                 at(motor_vehicle, kv["motor_vehicle"]));
+  kv.set("moped_forward", either(moped_tag, fallback("moped_forward")));
+  kv.set("moped_tag", moped_tag);
+
+  // check for motorcycle forward overrides
+  const char* motorcycle_tag =
+      either(at(motor_vehicle, kv["motorcycle"]), at(motor_vehicle, kv["motor_vehicle"]));
+  kv.set("motorcycle_forward", either(motorcycle_tag, fallback("motorcycle_forward")));
+  kv.set("motorcycle_tag", motorcycle_tag);
+
+  if (kv["bike_tag"] == nullptr) {
+    if (kv.is("sac_scale", "hiking")) {
+      kv.set("bike_forward", kTrue);
+      kv.set("bike_tag", kTrue);
+    } else if (kv["sac_scale"] != nullptr) {
+      kv.set("bike_forward", kFalse);
+    }
+  }
+
+  if (kv.is("access", "psv")) {
+    kv.set("taxi_forward", kTrue);
+    kv.set("taxi_tag", kTrue);
+
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_tag", kTrue);
+  }
+
+  if (kv.is("motorroad", "yes")) {
+    kv.set("motorroad_tag", kTrue);
+  }
+}
+
+// the lanes of a way, nil for more than 15
+void set_lanes(kv_t& kv, const std::string& key, const char* lanes) {
+  std::string prefix;
+  double lane_count;
+  if (to_number(numeric_prefix(lanes, false, prefix), lane_count) && !(lane_count > 15)) {
+    kv.set_number(key, lane_count);
+  } else {
+    kv.set(key, nullptr);
+  }
+}
+
+// filter_tags_generic, returns true if the way should be filtered
+bool filter_tags_generic(Tags& tags) {
+  kv_t kv(tags);
+
+  if ((kv.is("highway", "construction") && kv["construction"] == nullptr) ||
+      kv.is("highway", "proposed")) {
+    return true;
+  }
+
+  // toss actual areas
+  if (kv.is("area", "yes")) {
+    return true;
+  }
+
+  // figure out what basic type of road it is
+  const char* highway_key = kv.is("highway", "construction") ? kv["construction"] : kv["highway"];
+  auto forward = highway_key ? highway.find(highway_key) : highway.end();
+  const bool ferry = kv.is("route", "ferry");
+  const bool rail = kv.is("route", "shuttle_train");
+  const char* access_ = at(access, kv["access"]);
+
+  kv.set("emergency_forward", kFalse);
+  kv.set("emergency_backward", kFalse);
+
+  if (ferry || rail || kv["highway"]) {
+    if (kv.is("access", "emergency") || kv.is("emergency", "yes") ||
+        kv.is("service", "emergency_access")) {
+      kv.set("emergency_forward", kTrue);
+      kv.set("emergency_tag", kTrue);
+    }
+
+    if (kv.is("emergency", "no")) {
+      kv.set("emergency_tag", kFalse);
+    }
+  }
+
+  const bool closed = kv.is("impassable", "yes") || eq(access_, kFalse) ||
+                      (kv.is("access", "private") &&
+                       (kv.is("emergency", "yes") || kv.is("service", "emergency_access")));
+  if (forward != highway.end()) {
+    for (size_t i = 0; i < kForwardKeys.size(); ++i) {
+      kv.set(kForwardKeys[i], forward->second[i] ? kTrue : kFalse);
+    }
+
+    if (closed) {
+      set_all(kv, "_forward", kFalse);
+      set_all(kv, "_backward", kFalse);
+    } else if (kv.is("vehicle", "no")) { // don't change ped access.
+      set_all(kv, "_forward", kFalse, false);
+      set_all(kv, "_backward", kFalse, false);
+    }
+
+    mode_overrides(kv, true, nullptr, nullptr);
+    // its not a highway type that we know of
+  } else {
+    // if its a ferry and these tags dont show up we want to set them to true
+    const char* default_val = ferry ? kTrue : kFalse;
+
+    if (!ferry && rail) {
+      default_val = kTrue;
+    }
+
+    if ((!ferry && !rail) || closed) {
+      set_all(kv, "_forward", kFalse);
+      set_all(kv, "_backward", kFalse);
+    } else {
+      const char* ped_val = default_val;
+      if (kv.is("vehicle", "no")) { // don't change ped access.
+        default_val = kFalse;
+      }
+      mode_overrides(kv, false, default_val, ped_val);
+    }
+  }
+
+  // TODO: handle Time conditional restrictions if available for HOVs with oneway = reversible
+  if ((kv.is("access", "permissive") || kv.is("access", "hov") || kv.is("access", "taxi")) &&
+      kv.is("oneway", "reversible")) {
+    // for now enable only for buses if the tag exists and they are allowed.
+    if (kv.is("bus_forward", kTrue)) {
+      kv.set("auto_forward", kFalse);
+      kv.set("truck_forward", kFalse);
+      kv.set("pedestrian_forward", kFalse);
+      kv.set("bike_forward", kFalse);
+      kv.set("moped_forward", kFalse);
+      kv.set("motorcycle_forward", kFalse);
+    } else {
+      // by returning 1 we will toss this way
+      return true;
+    }
+  }
+
+  // service=driveway means all are routable
+  if (kv.is("service", "driveway") && kv["access"] == nullptr) {
+    set_all(kv, "_forward", kTrue);
+  }
+
+  // check the oneway-ness and traversability against the direction of the geom
+  if ((kv.is("oneway", "yes") && kv.is("oneway:bicycle", "no")) ||
+      kv.is("bicycle:backward", "yes") || kv.is("bicycle:backward", "no")) {
+    kv.set("bike_backward", kTrue);
+  }
+
+  if (kv["bike_backward"] == nullptr || kv.is("bike_backward", kFalse)) {
+    kv.set("bike_backward", either(at(bike_reverse, kv["cycleway"]),
+                                   at(bike_reverse, kv["cycleway:left"]),
+                                   at(bike_reverse, kv["cycleway:right"]), kFalse));
+  }
+
+  const char* oneway_bike = nullptr;
+  if (kv.is("bike_backward", kTrue)) {
+    oneway_bike = at(oneway, kv["oneway:bicycle"]);
+  }
+
+  if (kv["oneway:bus"] == nullptr && kv["oneway:psv"] != nullptr) {
+    kv.set("oneway:bus", std::string(kv["oneway:psv"]));
+  }
+
+  if ((kv.is("oneway", "yes") && kv.is("oneway:bus", "no")) || kv.is("bus:backward", "yes") ||
+      kv.is("bus:backward", "designated")) {
+    kv.set("bus_backward", kTrue);
+  }
+
+  if (kv["bus_backward"] == nullptr || kv.is("bus_backward", kFalse)) {
+    kv.set("bus_backward",
+           either(at(bus_reverse, kv["busway"]), at(bus_reverse, kv["busway:left"]),
+                  at(bus_reverse, kv["busway:right"]), at(psv, kv["lanes:psv:backward"]), kFalse));
+  }
+
+  const char* oneway_bus = nullptr;
+  if (kv.is("bus_backward", kTrue)) {
+    oneway_bus = at(oneway, kv["oneway:bus"]);
+    if (eq(oneway_bus, kFalse) && kv.is("bus:backward", "yes")) {
+      oneway_bus = kTrue;
+    }
+  }
+
+  if (kv["oneway:taxi"] == nullptr && kv["oneway:psv"] != nullptr) {
+    kv.set("oneway:taxi", std::string(kv["oneway:psv"]));
+  }
+
+  if ((kv.is("oneway", "yes") && kv.is("oneway:taxi", "no")) || kv.is("taxi:backward", "yes") ||
+      kv.is("taxi:backward", "designated")) {
+    kv.set("taxi_backward", kTrue);
+  }
+
+  if (kv["taxi_backward"] == nullptr || kv.is("taxi_backward", kFalse)) {
+    kv.set("taxi_backward", either(at(psv, kv["lanes:psv:backward"]), kFalse));
+  }
+
+  const char* oneway_taxi = nullptr;
+  if (kv.is("taxi_backward", kTrue)) {
+    oneway_taxi = at(oneway, kv["oneway:taxi"]);
+    if (eq(oneway_taxi, kFalse) && kv.is("taxi:backward", "yes")) {
+      oneway_taxi = kTrue;
+    }
+  }
+
+  if (kv["moped_backward"] == nullptr) {
+    kv.set("moped_backward", kFalse);
+  }
+
+  if ((kv.is("oneway", "yes") && (kv.is("oneway:moped", "no") || kv.is("oneway:mofa", "no"))) ||
+      kv.is("moped:backward", "yes") || kv.is("mofa:backward", "yes")) {
+    kv.set("moped_backward", kTrue);
+  }
+
+  const char* oneway_moped = nullptr;
+  if (kv.is("moped_backward", kTrue)) {
+    oneway_moped = either(at(oneway, kv["oneway:moped"]), at(oneway, kv["oneway:mofa"]));
+  }
+
+  if (kv["motorcycle_backward"] == nullptr) {
+    kv.set("motorcycle_backward", kFalse);
+  }
+
+  if ((kv.is("oneway", "yes") && kv.is("oneway:motorcycle", "no")) ||
+      kv.is("motorcycle:backward", "yes")) {
+    kv.set("motorcycle_backward", kTrue);
+  }
+
+  const char* oneway_motorcycle = nullptr;
+  if (kv.is("motorcycle_backward", kTrue)) {
+    oneway_motorcycle = at(oneway, kv["oneway:motorcycle"]);
+  }
+
+  if (kv["pedestrian_backward"] == nullptr) {
+    kv.set("pedestrian_backward", kFalse);
+  }
+
+  if ((kv.is("oneway", "yes") && kv.is("oneway:foot", "no")) || kv.is("foot:backward", "yes")) {
+    kv.set("pedestrian_backward", kTrue);
+  }
+
+  const char* oneway_foot = nullptr;
+  if (kv.is("pedestrian_backward", kTrue)) {
+    oneway_foot = at(oneway, kv["oneway:foot"]);
+  }
+
+  const bool oneway_reverse = kv.is("oneway", "-1");
+  const char* oneway_norm = at(oneway, kv["oneway"]);
+  if (kv.is("junction", "roundabout") || kv.is("junction", "circular")) {
+    oneway_norm = kTrue;
+    kv.set("roundabout", kTrue);
+  } else {
+    kv.set("roundabout", kFalse);
+  }
+  kv.set("oneway", oneway_norm);
+  // whether the way has the oneway tag of a mode that isnt true
+  auto not_oneway = [&](const char* key) {
+    return kv[key] == nullptr || kv.is(key, "no");
+  };
+  if (eq(oneway_norm, kTrue)) {
+    kv.set("auto_backward", kFalse);
+    kv.set("truck_backward", kFalse);
+    kv.set("emergency_backward", kFalse);
+
+    if (kv.is("bike_backward", kTrue)) {
+      if (eq(oneway_bike, kTrue)) { // bike only in reverse on a bike path.
+        kv.set("bike_forward", kFalse);
+      } else if (eq(oneway_bike, kFalse)) { // bike in both directions on a bike path.
+        kv.set("bike_forward", kTrue);
+      }
+    }
+    if (kv.is("bus_backward", kTrue)) {
+      if (eq(oneway_bus, kTrue)) { // bus only in reverse on a bus path.
+        kv.set("bus_forward", kFalse);
+      } else if (eq(oneway_bus, kFalse)) { // bus in both directions on a bus path.
+        kv.set("bus_forward", kTrue);
+      }
+    }
+    if (kv.is("taxi_backward", kTrue)) {
+      if (eq(oneway_taxi, kTrue)) { // taxi only in reverse on a taxi path.
+        kv.set("taxi_forward", kFalse);
+      } else if (eq(oneway_taxi, kFalse)) { // taxi in both directions on a taxi path.
+        kv.set("taxi_forward", kTrue);
+      }
+    }
+    if (kv.is("moped_backward", kTrue)) {
+      if (eq(oneway_moped, kTrue)) { // moped only in reverse direction on street
+        kv.set("moped_forward", kFalse);
+      } else if (eq(oneway_moped, kFalse)) {
+        kv.set("moped_forward", kTrue);
+      }
+    }
+    if (kv.is("motorcycle_backward", kTrue)) {
+      if (eq(oneway_motorcycle, kTrue)) { // motorcycle only in reverse direction on street
+        kv.set("motorcycle_forward", kFalse);
+      } else if (eq(oneway_motorcycle, kFalse)) {
+        kv.set("motorcycle_forward", kTrue);
+      }
+    }
+    // don't apply oneway tag unless oneway:foot or pedestrian only way
+    if (kv.is("highway", "footway") || kv.is("highway", "pedestrian") ||
+        kv.is("highway", "steps") || kv.is("highway", "path") || kv["oneway:foot"]) {
+      if (kv.is("pedestrian_backward", kTrue)) {
+        if (eq(oneway_foot, kTrue)) { // pedestrian only in reverse direction on street
+          kv.set("pedestrian_forward", kFalse);
+        } else if (eq(oneway_foot, kFalse)) {
+          kv.set("pedestrian_forward", kTrue);
+        }
+      }
+    } else {
+      kv.set("pedestrian_backward", kv["pedestrian_forward"]);
+    }
+
+    // if there is no oneway tagging the way is bidirectional despite the backward tagging above.
+    // the lua compares oneway[...] == false, which the strings of the table never are, so only a
+    // missing or "no" oneway tag of a mode counts
+  } else if (oneway_norm == nullptr || eq(oneway_norm, kFalse)) {
+    kv.set("auto_backward", kv["auto_forward"]);
+    kv.set("truck_backward", kv["truck_forward"]);
+    kv.set("emergency_backward", kv["emergency_forward"]);
+
+    if (kv.is("bike_backward", kFalse) && !kv.is("oneway:bicycle", "-1") &&
+        not_oneway("oneway:bicycle")) {
+      kv.set("bike_backward", kv["bike_forward"]);
+    }
+
+    if (kv.is("bus_backward", kFalse) && !kv.is("oneway:bus", "-1") &&
+        kv["oneway:bus"] == nullptr) {
+      kv.set("bus_backward", kv["bus_forward"]);
+    }
+
+    if (kv.is("taxi_backward", kFalse) && !kv.is("oneway:taxi", "-1") &&
+        kv["oneway:taxi"] == nullptr) {
+      kv.set("taxi_backward", kv["taxi_forward"]);
+    }
+
+    if (kv.is("moped_backward", kFalse) && not_oneway("oneway:moped") &&
+        not_oneway("oneway:mofa")) {
+      kv.set("moped_backward", kv["moped_forward"]);
+    }
+
+    if (kv.is("motorcycle_backward", kFalse) && !kv.is("oneway:motorcycle", "-1") &&
+        not_oneway("oneway:motorcycle")) {
+      kv.set("motorcycle_backward", kv["motorcycle_forward"]);
+    }
+
+    if (kv.is("pedestrian_backward", kFalse) && not_oneway("oneway:foot")) {
+      kv.set("pedestrian_backward", kv["pedestrian_forward"]);
+    }
+  }
+
+  // bike forward / backward overrides.
+  auto cycle_lane = [&](const char* key) {
+    return at(shared, kv[key]) != kNil || at(separated, kv[key]) != kNil ||
+           at(dedicated, kv[key]) != kNil;
+  };
+  if (cycle_lane("cycleway:both") ||
+      (cycle_lane("cycleway:right") && cycle_lane("cycleway:left"))) {
+    kv.set("bike_forward", kTrue);
+    kv.set("bike_backward", kTrue);
+  }
+
+  if (kv.is("busway", "lane") || (kv.is("busway:left", "lane") && kv.is("busway:right", "lane"))) {
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_backward", kTrue);
+  }
+
+  // let all the :forward overrides through
+  const char* mv_forward = either(kv["motor_vehicle:forward"], kv["vehicle:forward"]);
+  if (mv_forward != nullptr) {
+    const char* value = at(motor_vehicle, mv_forward);
+    for (const char* key : {"auto_forward", "truck_forward", "bus_forward", "taxi_forward",
+                            "moped_forward", "motorcycle_forward"}) {
+      kv.set(key, value);
+    }
+  }
+  if (kv["foot:forward"] != nullptr) {
+    kv.set("pedestrian_forward", at(foot, kv["foot:forward"]));
+  }
+  const char* bk_forward = either(kv["bicycle:forward"], kv["vehicle:forward"]);
+  if (bk_forward != nullptr) {
+    kv.set("bike_forward", at(bicycle, bk_forward));
+  }
+
+  // let all the :backward overrides through
+  const char* mv_backward = either(kv["motor_vehicle:backward"], kv["vehicle:backward"]);
+  if (mv_backward != nullptr) {
+    const char* value = at(motor_vehicle, mv_backward);
+    for (const char* key : {"auto_backward", "truck_backward", "bus_backward", "taxi_backward",
+                            "moped_backward", "motorcycle_backward"}) {
+      kv.set(key, value);
+    }
+  }
+  if (kv["foot:backward"] != nullptr) {
+    kv.set("pedestrian_backward", at(foot, kv["foot:backward"]));
+  }
+  const char* bk_backward = either(kv["bicycle:backward"], kv["vehicle:backward"]);
+  if (bk_backward != nullptr) {
+    kv.set("bike_backward", at(bicycle, bk_backward));
+  }
+
+  kv.set("oneway_reverse", kFalse);
+
+  // flip the onewayness
+  if (oneway_reverse) {
+    kv.set("oneway_reverse", kTrue);
+    for (const std::string mode : {"auto", "truck", "emergency", "bus", "taxi", "bike", "moped",
+                                   "motorcycle", "pedestrian"}) {
+      kv.swap(mode + "_forward", mode + "_backward");
+    }
+  }
+
+  if (kv.is("oneway:bicycle", "-1")) {
+    kv.swap("bike_forward", "bike_backward");
+  }
+
+  if (kv.is("oneway:moped", "-1") || kv.is("oneway:mofa", "-1")) {
+    kv.swap("moped_forward", "moped_backward");
+  }
+
+  if (kv.is("oneway:motorcycle", "-1")) {
+    kv.swap("motorcycle_forward", "motorcycle_backward");
+  }
+
+  if (kv.is("oneway:foot", "-1")) {
+    kv.swap("pedestrian_forward", "pedestrian_backward");
+  }
+
+  if (kv.is("oneway:bus", "-1")) {
+    kv.swap("bus_forward", "bus_backward");
+  }
+
+  // bus only logic
+  if (kv.is("lanes:bus", "1")) {
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_backward", kFalse);
+  } else if (kv.is("lanes:bus", "2")) {
+    kv.set("bus_forward", kTrue);
+    kv.set("bus_backward", kTrue);
+  }
+
+  if (kv.is("oneway:taxi", "-1")) {
+    kv.swap("taxi_forward", "taxi_backward");
+  }
+
+  if (kv.is("lanes:psv", "1")) {
+    kv.set("taxi_forward", kTrue);
+    kv.set("taxi_backward", kFalse);
+  } else if (kv.is("lanes:psv", "2")) {
+    kv.set("taxi_forward", kTrue);
+    kv.set("taxi_backward", kTrue);
+  }
+
+  // if none of the modes were set we are done looking at this
+  bool none = true;
+  for (const std::string mode :
+       {"auto", "truck", "bus", "bike", "emergency", "moped", "motorcycle", "pedestrian"}) {
+    none = none && kv.is(mode + "_forward", kFalse) && kv.is(mode + "_backward", kFalse);
+  }
+  if (none && !kv.is("highway", "bridleway")) { // save bridleways for country access logic.
+    return true;
+  }
+
+  for (const char* key : {"FIXME", "note", "source"}) {
+    kv.set(key, nullptr);
+  }
+
+  // set a few flags
+  int rc = at(road_class, kv.is("highway", "construction") ? kv["construction"] : kv["highway"]);
+
+  if (kv["highway"] == nullptr && ferry) {
+    rc = 2; // TODO:  can we weight based on ferry types?
+  } else if (kv["highway"] == nullptr && (kv["railway"] || kv.is("route", "shuttle_train"))) {
+    rc = 2; // TODO:  can we weight based on rail types?
+  } else if (rc == kNil) { // service and other = 7
+    rc = 7;
+  }
+
+  kv.set_number("road_class", rc);
+
+  double speed = default_speed[rc];
+
+  // lower the default speed for driveways
+  if (kv.is("service", "driveway")) {
+    speed = std::floor(speed * 0.5);
+  }
+  kv.set_number("default_speed", speed);
+
+  kv.set("lit", at(lit, kv["lit"]));
+
+  int use_ = at(use, kv["service"]);
+
+  if (kv["highway"]) {
+    const auto all_false = [&](std::initializer_list<const char*> keys) {
+      for (const char* key : keys) {
+        if (!kv.is(key, kFalse)) {
+          return false;
+        }
+      }
+      return true;
+    };
+    if (kv.is("highway", "construction")) {
+      use_ = 43;
+    } else if (kv.is("highway", "track")) {
+      use_ = 3;
+    } else if (kv.is("highway", "living_street")) {
+      use_ = 10;
+    } else if (use_ == kNil && kv.is("highway", "service")) {
+      use_ = 11;
+    } else if (kv.is("highway", "cycleway")) {
+      use_ = 20;
+    } else if (all_false({"pedestrian_forward", "auto_forward", "auto_backward"}) &&
+               (kv.is("bike_forward", kTrue) || kv.is("bike_backward", kTrue))) {
+      use_ = 20;
+    } else if (kv.is("highway", "footway") && kv.is("footway", "sidewalk")) {
+      use_ = 24;
+    } else if (kv.is("highway", "footway") && kv.is("footway", "crossing")) {
+      use_ = 32;
+    } else if (kv.is("highway", "footway")) {
+      use_ = 25;
+    } else if (kv.is("highway", "elevator")) {
+      use_ = 33; // elevator
+    } else if (kv.is("highway", "steps") && kv["conveying"] != nullptr) {
+      use_ = 34; // escalator
+    } else if (kv.is("highway", "steps")) {
+      use_ = 26; // steps/stairs
+    } else if (kv.is("highway", "path")) {
+      use_ = 27;
+    } else if (kv.is("highway", "pedestrian")) {
+      use_ = 28;
+    } else if (kv.is("highway", "platform")) {
+      use_ = 35;
+    } else if (kv.is("pedestrian_forward", kTrue) &&
+               all_false({"auto_forward", "auto_backward", "truck_forward", "truck_backward",
+                          "bus_forward", "bus_backward", "bike_forward", "bike_backward",
+                          "moped_forward", "moped_backward", "motorcycle_forward",
+                          "motorcycle_backward"})) {
+      use_ = 28;
+    } else if (kv.is("highway", "bridleway")) {
+      use_ = 29;
+    }
+  }
+
+  if (use_ == kNil && kv["service"]) {
+    use_ = 40; // other
+  } else if (use_ == kNil) {
+    use_ = 0; // general road, no special use
+  }
+
+  // do not override 'construction' use
+  if (use_ != 43 && (kv.is("access", "emergency") || kv.is("emergency", "yes"))) {
+    bool all_false = true;
+    for (const std::string mode : {"auto", "truck", "bus", "bike", "moped", "motorcycle"}) {
+      all_false =
+          all_false && kv.is(mode + "_forward", kFalse) && kv.is(mode + "_backward", kFalse);
+    }
+    if (all_false) {
+      use_ = 7;
+    }
+  }
+
+  kv.set_number("use", use_);
+
+  const char* r_shoulder = either(at(shoulder, kv["shoulder"]), at(shoulder, kv["shoulder:both"]));
+  const char* l_shoulder = r_shoulder;
+
+  if (r_shoulder == nullptr) {
+    r_shoulder =
+        either(at(shoulder, kv["shoulder:right"]), at(shoulder_right, kv["shoulder"]), kFalse);
+    l_shoulder =
+        either(at(shoulder, kv["shoulder:left"]), at(shoulder_left, kv["shoulder"]), kFalse);
+
+    // If the road is oneway and one shoulder is tagged but not the other, we set both to true so
+    // that when setting the shoulder in graphbuilder, driving on the right side vs the left side
+    // doesn't cause the edge to miss the shoulder tag
+    if (eq(oneway_norm, kTrue) && eq(r_shoulder, kTrue) && eq(l_shoulder, kFalse)) {
+      l_shoulder = kTrue;
+    } else if (eq(oneway_norm, kTrue) && eq(r_shoulder, kFalse) && eq(l_shoulder, kTrue)) {
+      r_shoulder = kTrue;
+    }
+  }
+
+  kv.set("shoulder_right", r_shoulder);
+  kv.set("shoulder_left", l_shoulder);
+
+  const char* cycle_lane_right_opposite = kFalse;
+  const char* cycle_lane_left_opposite = kFalse;
+
+  int cycle_lane_right = 0;
+  int cycle_lane_left = 0;
+
+  // We have special use cases for cycle lanes when on a cycleway, footway, or path
+  if ((use_ == 20 || use_ == 25 || use_ == 27) &&
+      (kv.is("bike_forward", kTrue) || kv.is("bike_backward", kTrue))) {
+    if (kv.is("pedestrian_forward", kFalse)) {
+      cycle_lane_right = 3; // separated
+    } else if (kv.is("segregated", "yes")) {
+      cycle_lane_right = 2; // dedicated
+    } else if (kv.is("segregated", "no")) {
+      cycle_lane_right = 1; // shared
+    } else if (use_ == 20) {
+      cycle_lane_right = 2; // no segregated tag but tagged as a cycleway, assume separated lanes
+    } else {
+      cycle_lane_right = 1; // no segregated tag and a footway or path, assume shared lanes
+    }
+    cycle_lane_left = cycle_lane_right;
+  } else {
+    // Set flags if any of the lanes are marked "opposite" (contraflow)
+    cycle_lane_right_opposite = either(at(bike_reverse, kv["cycleway"]), kFalse);
+    cycle_lane_left_opposite = cycle_lane_right_opposite;
+
+    if (eq(cycle_lane_right_opposite, kFalse)) {
+      cycle_lane_right_opposite = either(at(bike_reverse, kv["cycleway:right"]), kFalse);
+      cycle_lane_left_opposite = either(at(bike_reverse, kv["cycleway:left"]), kFalse);
+    }
+
+    // Figure out which side of the road has what cyclelane
+    auto lane = [&](const char* key, const char* buffer_key) {
+      int value = at(shared, kv[key]);
+      value = either(value, at(separated, kv[key]));
+      value = either(value, at(dedicated, kv[key]));
+      value = either(value, at(buffer, kv[buffer_key]));
+      return either(value, 0);
+    };
+    cycle_lane_right = lane("cycleway", "cycleway:both:buffer");
+    cycle_lane_left = cycle_lane_right;
+
+    if (cycle_lane_right == 0) {
+      cycle_lane_right = lane("cycleway:right", "cycleway:right:buffer");
+      cycle_lane_left = lane("cycleway:left", "cycleway:left:buffer");
+    }
+
+    // If we have the oneway:bicycle=no tag and there are not "opposite_lane/opposite_track" tags
+    // then there are certain situations where the cyclelane is considered a two-way. (Based off
+    // of some examples on wiki.openstreetmap.org/wiki/Bicycle)
+    if (kv.is("oneway:bicycle", "no") && eq(cycle_lane_right_opposite, kFalse) &&
+        eq(cycle_lane_left_opposite, kFalse)) {
+      if (cycle_lane_right == 2 || cycle_lane_right == 3) {
+        // Example M1 or M2d but on the right side
+        if (eq(oneway_norm, kTrue)) {
+          cycle_lane_left = cycle_lane_right;
+          cycle_lane_left_opposite = kTrue;
+          // Example L1b
+        } else if (cycle_lane_left == 0) {
+          cycle_lane_left = cycle_lane_right;
+        }
+      } else if (cycle_lane_left == 2 || cycle_lane_left == 3) {
+        // Example M2d
+        if (eq(oneway_norm, kTrue)) {
+          cycle_lane_right = cycle_lane_left;
+          cycle_lane_right_opposite = kTrue;
+          // Example L1b but on the left side
+        } else if (cycle_lane_right == 0) {
+          cycle_lane_right = cycle_lane_left;
+        }
+      }
+    }
+  }
+
+  kv.set_number("cycle_lane_right", cycle_lane_right);
+  kv.set_number("cycle_lane_left", cycle_lane_left);
+
+  kv.set("cycle_lane_right_opposite", cycle_lane_right_opposite);
+  kv.set("cycle_lane_left_opposite", cycle_lane_left_opposite);
+
+  const char* highway_type = kv.is("highway", "construction") ? kv["construction"] : kv["highway"];
+  if (highway_type && std::strstr(highway_type, "_link")) { //*_link
+    kv.set("link", kTrue); // do we need to add more?  turnlane?
+  }
+
+  kv.set("private", either(at(private_, kv["access"]), at(private_, kv["motor_vehicle"]), kFalse));
+  kv.set("no_thru_traffic", either(at(no_thru_traffic, kv["access"]), kFalse));
+  kv.set("ferry", ferry ? kTrue : kFalse);
+  kv.set("rail", kv.is("auto_forward", kTrue) &&
+                         (kv.is("railway", "rail") || kv.is("route", "shuttle_train"))
+                     ? kTrue
+                     : kFalse);
+
+  if (kv.is("maxspeed", "none")) {
+    // special case unlimited speed limit (german autobahn)
+    kv.set("max_speed", "unlimited");
+  } else {
+    set_speed(kv, "max_speed", kv["maxspeed"]);
+  }
+
+  set_speed(kv, "advisory_speed", kv["maxspeed:advisory"]);
+  set_speed(kv, "average_speed", kv["maxspeed:practical"]);
+  set_speed(kv, "backward_speed", kv["maxspeed:backward"]);
+  set_speed(kv, "forward_speed", kv["maxspeed:forward"]);
+  kv.set("wheelchair", at(wheelchair, kv["wheelchair"]));
+
+  // lower the default speed for tracks
+  if (kv.is("highway", "track")) {
+    int track_speed = 5;
+    if (kv.is("tracktype", "grade1")) {
+      track_speed = 20;
+    } else if (kv.is("tracktype", "grade2")) {
+      track_speed = 15;
+    } else if (kv.is("tracktype", "grade3")) {
+      track_speed = 12;
+    } else if (kv.is("tracktype", "grade4")) {
+      track_speed = 10;
+    }
+    kv.set_number("default_speed", track_speed);
+  }
+
+  // use unsigned_ref if all the conditions are met.
+  if (kv["name"] == nullptr && kv["name:en"] == nullptr && kv["alt_name"] == nullptr &&
+      kv["official_name"] == nullptr && kv["ref"] == nullptr && kv["int_ref"] == nullptr &&
+      (kv.is("highway", "motorway") || kv.is("highway", "trunk") || kv.is("highway", "primary")) &&
+      kv["unsigned_ref"] != nullptr) {
+    kv.set("ref", std::string(kv["unsigned_ref"]));
+  }
+
+  set_lanes(kv, "lanes", kv["lanes"]);
+  set_lanes(kv, "forward_lanes", kv["lanes:forward"]);
+  set_lanes(kv, "backward_lanes", kv["lanes:backward"]);
+
+  kv.set("bridge", either(at(bridge, kv["bridge"]), kFalse));
+
+  // TODO access:conditional
+  if (kv["seasonal"] && !kv.is("seasonal", "no")) {
+    kv.set("seasonal", kTrue);
+  }
+
+  kv.set("hov_tag", kTrue);
+  if (kv.is("hov", "no")) {
+    kv.set("hov_forward", kFalse);
+    kv.set("hov_backward", kFalse);
+  } else {
+    kv.set("hov_forward", kv["auto_forward"]);
+    kv.set("hov_backward", kv["auto_backward"]);
+  }
+
+  // hov restrictions
+  if ((kv["hov"] && !kv.is("hov", "no")) || kv["hov:lanes"] || kv["hov:minimum"]) {
+    bool only_hov_allowed = kv.is("hov", "designated");
+
+    // If "hov:lanes" is specified ensure all lanes are tagged "designated"
+    if (only_hov_allowed && kv["hov:lanes"]) {
+      const std::string lanes = std::string(kv["hov:lanes"]) + "|";
+      size_t start = 0;
+      for (auto end = lanes.find('|'); end != std::string::npos; end = lanes.find('|', start)) {
+        if (lanes.compare(start, end - start, "designated") != 0) {
+          only_hov_allowed = false;
+        }
+        start = end + 1;
+      }
+    }
+
+    // only the values 2 or 3 of "hov:minimum" are accepted, routing onto an HOV lane without the
+    // correct number of occupants is illegal.
+    if (only_hov_allowed) {
+      if (kv.is("hov:minimum", "2")) {
+        kv.set("hov_type", "HOV2");
+      } else if (kv.is("hov:minimum", "3")) {
+        kv.set("hov_type", "HOV3");
+      } else {
+        only_hov_allowed = false;
+      }
+    }
+
+    // HOV lanes are sometimes time-conditional and can change direction. We avoid these.
+    if (only_hov_allowed) {
+      const bool avoid_these_hovs = kv.is("oneway", "alternating") ||
+                                    kv.is("oneway", "reversible") || kv.is("oneway", kFalse) ||
+                                    kv["oneway:conditional"] != nullptr ||
+                                    kv["access:conditional"] != nullptr;
+      only_hov_allowed = !avoid_these_hovs;
+    }
+
+    if (only_hov_allowed) {
+      // a true hov-only-lane (not mixed), none of the following costings can use it.
+      if (kv["auto_tag"] == nullptr) {
+        kv.set("auto_forward", kFalse);
+        kv.set("auto_backward", kFalse);
+      }
+
+      if (kv["truck_tag"] == nullptr) {
+        kv.set("truck_forward", kFalse);
+        kv.set("truck_backward", kFalse);
+      }
+
+      if (kv["foot_tag"] == nullptr) {
+        kv.set("pedestrian_forward", kFalse);
+        kv.set("pedestrian_backward", kFalse);
+      }
+
+      if (kv["bike_tag"] == nullptr) {
+        kv.set("bike_forward", kFalse);
+        kv.set("bike_backward", kFalse);
+      }
+    } else {
+      // This is not an hov-only lane.
+      kv.set("hov_forward", kFalse);
+      kv.set("hov_backward", kFalse);
+    }
+  }
+
+  kv.set("tunnel", either(at(tunnel, kv["tunnel"]), kFalse));
+  kv.set("toll", either(at(toll, kv["toll"]), kFalse));
+
+  // truck goodies
+  double number;
+  auto set_measurement = [&](const char* key, std::initializer_list<const char*> tags) {
+    for (const char* tag : tags) {
+      if (normalize_measurement(kv[tag], number)) {
+        kv.set_number(key, number);
+        return;
+      }
+    }
+    kv.set(key, nullptr);
+  };
+  set_measurement("maxheight", {"maxheight", "maxheight:physical"});
+  set_measurement("maxwidth", {"maxwidth", "maxwidth:physical"});
+  set_measurement("maxlength", {"maxlength"});
+
+  set_weight(kv, "maxweight", kv["maxweight"]);
+  set_weight(kv, "maxaxleload", kv["maxaxleload"]);
+  if (to_number(kv["maxaxles"], number)) {
+    kv.set_number("maxaxles", number);
+  } else {
+    kv.set("maxaxles", nullptr);
+  }
+
+  // TODO: hazmat really should have subcategories
+  kv.set("hazmat", either(at(hazmat, kv["hazmat"]), at(hazmat, kv["hazmat:water"]),
+                          at(hazmat, kv["hazmat:A"]), at(hazmat, kv["hazmat:B"]),
+                          at(hazmat, kv["hazmat:C"]), at(hazmat, kv["hazmat:D"]),
+                          at(hazmat, kv["hazmat:E"])));
+  set_speed(kv, "maxspeed:hgv", kv["maxspeed:hgv"]);
+
+  if (kv["hgv:national_network"] || kv["hgv:state_network"] || kv.is("hgv", "local") ||
+      kv.is("hgv", "designated")) {
+    kv.set("truck_route", kTrue);
+  }
+
+  int bike_mask = 0;
+  if (kv["ncn_ref"] || kv.is("ncn", "yes")) {
+    bike_mask = 1;
+  }
+  if (kv["rcn_ref"] || kv.is("rcn", "yes")) {
+    bike_mask |= 2;
+  }
+  if (kv["lcn_ref"] || kv.is("lcn", "yes")) {
+    bike_mask |= 4;
+  }
+  if (kv.is("mtb", "yes")) {
+    bike_mask |= 8;
+  }
+
+  for (const auto& ref : {std::make_pair("bike_national_ref", "ncn_ref"),
+                          std::make_pair("bike_regional_ref", "rcn_ref"),
+                          std::make_pair("bike_local_ref", "lcn_ref")}) {
+    kv.set(ref.first, kv[ref.second]);
+  }
+  kv.set_number("bike_network_mask", bike_mask);
+
+  // turn semicolon into colon due to challenges to store ";" in string
+  if (kv["level"] != nullptr) {
+    std::string level(kv["level"]);
+    std::replace(level.begin(), level.end(), ';', ':');
+    kv.set("level", level);
+  }
+
+  // Explicitly turn off access for construction type. It's done for backward compatibility of
+  // valhalla tiles and valhalla routing, older routers only look at the access of an edge.
+  if (kv.is("highway", "construction")) {
+    for (const std::string mode : {"auto", "truck", "bus", "taxi", "hov", "pedestrian", "bike",
+                                   "moped", "motorcycle", "emergency"}) {
+      kv.set(mode + "_forward", kFalse);
+      kv.set(mode + "_backward", kFalse);
+    }
+  }
+
+  return false;
+}
+
+void nodes_proc(Tags& tags) {
+  kv_t kv(tags);
+
+  if (const char* iso = kv["iso:3166_2"]) {
+    const std::string code(iso);
+    const auto dash = code.find('-');
+    if (dash == 2) {
+      if (code.size() == 6 || code.size() == 5) {
+        kv.set("state_iso_code", code.substr(3));
+      }
+    } else if (dash == std::string::npos) {
+      if (code.size() == 2 || code.size() == 3) {
+        kv.set("state_iso_code", code);
+      } else if (code.size() == 4 || code.size() == 5) {
+        kv.set("state_iso_code", code.substr(2));
+      }
+    }
+  }
+
+  // normalize a few tags that we care about
+  const char* initial_access = at(access, kv["access"]);
+  const char* access_ = either(initial_access, kTrue);
+
+  if (kv.is("impassable", "yes") ||
+      (kv.is("access", "private") &&
+       (kv.is("emergency", "yes") || kv.is("service", "emergency_access")))) {
+    access_ = kFalse;
+  }
+
+  int hov_tag = kNil;
+  if ((kv["hov"] && !kv.is("hov", "no")) || kv["hov:lanes"] || kv["hov:minimum"]) {
+    hov_tag = 128;
+  }
+
+  int foot_tag = at(foot_node, kv["foot"]);
+  int wheelchair_tag = at(wheelchair_node, kv["wheelchair"]);
+  int bike_tag = at(bicycle_node, kv["bicycle"]);
+  int truck_tag = at(truck_node, kv["hgv"]);
+  int auto_tag = at(motor_vehicle_node, kv["motorcar"]);
+  const int motor_vehicle_tag = at(motor_vehicle_node, kv["motor_vehicle"]);
+  int moped_tag = either(at(moped_node, kv["moped"]), at(moped_node, kv["mofa"]));
+  int motorcycle_tag = at(motor_cycle_node, kv["motorcycle"]);
+
+  if (auto_tag == kNil) {
+    auto_tag = motor_vehicle_tag;
+  }
+  int bus_tag;
+  int taxi_tag;
+
+  if (kv.is("access", "psv")) {
+    bus_tag = 64;
+    taxi_tag = 32;
+  } else {
+    bus_tag = at(bus_node, kv["bus"]);
+    taxi_tag = at(taxi_node, kv["taxi"]);
+  }
+
+  if (bus_tag == kNil) {
+    bus_tag = at(psv_bus_node, kv["psv"]);
+  }
+  // if bus was not set and car is
+  if (bus_tag == kNil && auto_tag == 1) {
+    bus_tag = 64;
+  }
+
+  // if wheelchair was not set and foot is
+  if (wheelchair_tag == kNil && foot_tag == 2) {
+    wheelchair_tag = 256;
+  }
+
+  // if hov was not set and car is
+  if (hov_tag == kNil && auto_tag == 1) {
+    hov_tag = 128;
+  }
+
+  if (taxi_tag == kNil) {
+    taxi_tag = at(psv_taxi_node, kv["psv"]);
+  }
+  // if taxi was not set and car is
+  if (taxi_tag == kNil && auto_tag == 1) {
+    taxi_tag = 32;
+  }
+
+  // if truck was not set and car is
+  if (truck_tag == kNil && auto_tag == 1) {
+    truck_tag = 8;
+  }
+
+  // must shut these off if motor_vehicle = 0
+  if (motor_vehicle_tag == 0) {
+    hov_tag = either(hov_tag, 0);
+    bus_tag = either(bus_tag, 0);
+    taxi_tag = either(taxi_tag, 0);
+    truck_tag = either(truck_tag, 0);
+    moped_tag = either(moped_tag, 0);
+    motorcycle_tag = either(motorcycle_tag, 0);
+  }
+
+  int emergency_tag = kNil;
+  if (kv.is("access", "emergency") || kv.is("emergency", "yes") ||
+      kv.is("service", "emergency_access")) {
+    emergency_tag = 16;
+  }
+
+  // do not shut off bike access if there is a highway crossing.
+  if (bike_tag == 0 && kv.is("highway", "crossing")) {
+    bike_tag = 4;
+  }
+
+  // if tag exists use it, otherwise access allowed for all modes unless access = false or
+  // hov=designated or vehicle=no. if access=private use allowed modes, but consider
+  // private_access tag as true.
+  int auto_ = either(auto_tag, 1);
+  int truck_ = either(truck_tag, 8);
+  int bus_ = either(bus_tag, 64);
+  int taxi_ = either(either(taxi_tag, auto_tag), 32);
+  int foot_ = either(foot_tag, 2);
+  int wheelchair_ = either(wheelchair_tag, 256);
+  int bike = either(bike_tag, 4);
+  int emergency = either(emergency_tag, 16);
+  int hov = either(either(hov_tag, auto_tag), 128);
+  int moped_ = either(moped_tag, 512);
+  int motorcycle = either(motorcycle_tag, 1024);
+
+  // if access = false use tag if exists, otherwise no access for that mode.
+  if (eq(access_, kFalse) || kv.is("vehicle", "no") || kv.is("hov", "designated")) {
+    auto_ = either(auto_tag, 0);
+    truck_ = either(truck_tag, 0);
+    bus_ = either(bus_tag, 0);
+    taxi_ = either(taxi_tag, 0);
+
+    // don't change ped if vehicle=no
+    if (eq(access_, kFalse) || kv.is("hov", "designated")) {
+      foot_ = either(foot_tag, 0);
+    }
+
+    wheelchair_ = either(wheelchair_tag, 0);
+    bike = either(bike_tag, 0);
+    moped_ = either(moped_tag, 0);
+    motorcycle = either(motorcycle_tag, 0);
+    emergency = either(emergency_tag, 0);
+    hov = either(hov_tag, 0);
+  }
+
+  // check for gates, bollards, and sump_busters
+  bool gate = kv.is("barrier", "gate") || kv.is("barrier", "yes") ||
+              kv.is("barrier", "lift_gate") || kv.is("barrier", "swing_gate");
+  bool bollard = false;
+  bool sump_buster = false;
+
+  if (!gate) {
+    // if there was a bollard cars can't get through it
+    bollard = kv.is("barrier", "bollard") || kv.is("barrier", "block") ||
+              kv.is("barrier", "jersey_barrier") || kv.is("bollard", "removable");
+
+    // if sump_buster then no access for auto, hov, and taxi unless a tag exists.
+    sump_buster = kv.is("barrier", "sump_buster");
+
+    // save the following as gates.
+    if (bollard && kv.is("bollard", "rising")) {
+      gate = true;
+      bollard = false;
+    }
+
+    // bollard = true shuts off access when access is not originally specified.
+    if (bollard && initial_access == nullptr) {
+      auto_ = either(auto_tag, 0);
+      truck_ = either(truck_tag, 0);
+      bus_ = either(bus_tag, 0);
+      taxi_ = either(taxi_tag, 0);
+      foot_ = either(foot_tag, 2);
+      wheelchair_ = either(wheelchair_tag, 256);
+      bike = either(bike_tag, 4);
+      moped_ = either(moped_tag, 0);
+      motorcycle = either(motorcycle_tag, 0);
+      emergency = either(emergency_tag, 0);
+      hov = either(hov_tag, 0);
+      // sump_buster = true shuts off access unless the tag exists.
+    } else if (sump_buster) {
+      auto_ = either(auto_tag, 0);
+      truck_ = either(truck_tag, 8);
+      bus_ = either(bus_tag, 64);
+      taxi_ = either(taxi_tag, 0);
+      foot_ = either(foot_tag, 2);
+      wheelchair_ = either(wheelchair_tag, 256);
+      bike = either(bike_tag, 4);
+      moped_ = either(moped_tag, 512);
+      motorcycle = either(motorcycle_tag, 1024);
+      emergency = either(emergency_tag, 16);
+      hov = either(hov_tag, 0);
+    }
+  }
+
+  // if nothing blocks access at this node assume access is allowed.
+  if (!gate && !bollard && !sump_buster && eq(access_, kTrue)) {
+    if (kv.is("highway", "crossing") || kv.is("railway", "crossing") ||
+        kv.is("footway", "crossing") || kv.is("cycleway", "crossing") ||
+        kv.is("foot", "crossing") || kv.is("bicycle", "crossing") ||
+        kv.is("pedestrian", "crossing") || kv["crossing"]) {
+      auto_ = either(auto_tag, 1);
+      truck_ = either(truck_tag, 8);
+      bus_ = either(bus_tag, 64);
+      taxi_ = either(taxi_tag, 32);
+      foot_ = either(foot_tag, 2);
+      wheelchair_ = either(wheelchair_tag, 256);
+      bike = either(bike_tag, 4);
+      moped_ = either(moped_tag, 512);
+      motorcycle = either(motorcycle_tag, 1024);
+      emergency = either(emergency_tag, 16);
+      hov = either(hov_tag, 128);
+    }
+  }
+
+  // store the gate and bollard info
+  kv.set("gate", gate ? kTrue : kFalse);
+  kv.set("bollard", bollard ? kTrue : kFalse);
+  kv.set("sump_buster", sump_buster ? kTrue : kFalse);
+
+  if (kv.is("barrier", "border_control")) {
+    kv.set("border_control", kTrue);
+  } else if (kv.is("barrier", "toll_booth")) {
+    kv.set("toll_booth", kTrue);
+    if (is_cash_only_payment(tags)) {
+      kv.set("cash_only_toll", kTrue);
+    }
+  } else if (kv.is("highway", "toll_gantry")) {
+    kv.set("toll_gantry", kTrue);
+  } else if (kv.is("entrance", "yes") && kv.is("indoor", "yes")) {
+    kv.set("building_entrance", kTrue);
+  } else if (kv.is("highway", "elevator")) {
+    kv.set("elevator", kTrue);
+  }
+
+  if (kv.is("amenity", "bicycle_rental") ||
+      (kv.is("shop", "bicycle") && kv.is("service:bicycle:rental", "yes"))) {
+    kv.set("bicycle_rental", kTrue);
+  }
+
+  if (kv.is("traffic_signals:direction", "forward")) {
+    kv.set("forward_signal", kTrue);
+
+    if (kv["public_transport"] == nullptr && kv["name"]) {
+      kv.set("junction", "named");
+    }
+  }
+
+  if (kv.is("traffic_signals:direction", "backward")) {
+    kv.set("backward_signal", kTrue);
+
+    if (kv["public_transport"] == nullptr && kv["name"]) {
+      kv.set("junction", "named");
+    }
+  }
+
+  for (const auto& sign : {std::make_tuple("stop", "forward_stop", "backward_stop"),
+                           std::make_tuple("give_way", "forward_yield", "backward_yield")}) {
+    if (kv.is("highway", std::get<0>(sign))) {
+      if (kv.is("direction", "both")) {
+        kv.set(std::get<1>(sign), kTrue);
+        kv.set(std::get<2>(sign), kTrue);
+      } else if (kv.is("direction", "forward")) {
+        kv.set(std::get<1>(sign), kTrue);
+      } else if (kv.is("direction", "backward") || kv.is("direction", "reverse")) {
+        kv.set(std::get<2>(sign), kTrue);
+      } else if (kv["direction"] != nullptr && kv[std::get<0>(sign)] == nullptr) {
+        kv.set("highway", nullptr);
+      }
+    }
+  }
+
+  if (kv["public_transport"] == nullptr && kv["name"]) {
+    if (kv.is("highway", "traffic_signals")) {
+      if (!kv.is("junction", "yes")) {
+        kv.set("junction", "named");
+      }
+    } else if (kv.is("junction", "yes") || kv.is("reference_point", "yes")) {
+      kv.set("junction", "named");
+    }
+  }
+
+  kv.set("private", either(at(private_, kv["access"]), at(private_, kv["motor_vehicle"]), kFalse));
+
+  // store a mask denoting access
+  kv.set_number("access_mask", auto_ | emergency | truck_ | bike | foot_ | wheelchair_ | bus_ |
+                                   hov | moped_ | motorcycle | taxi_);
+
+  // if no information about access is given.
+  const bool untagged = initial_access == nullptr && auto_tag == kNil && truck_tag == kNil &&
+                        bus_tag == kNil && taxi_tag == kNil && foot_tag == kNil &&
+                        wheelchair_tag == kNil && bike_tag == kNil && moped_tag == kNil &&
+                        motorcycle_tag == kNil && emergency_tag == kNil && hov_tag == kNil;
+  kv.set_number("tagged_access", untagged ? 0 : 1);
+}
+
+// rels_proc, returns true if the relation should be filtered
+bool rels_proc(Tags& tags) {
+  kv_t kv(tags);
+
+  if (kv.is("type", "connectivity")) {
+    return false;
+  }
+
+  if (!kv.is("type", "route") && !kv.is("type", "restriction")) {
+    return true;
+  }
+
+  if (kv["restriction:probable"] && (kv["restriction"] || kv["restriction:conditional"])) {
+    kv.set("restriction:probable", nullptr);
+  }
+
+  std::string prefix;
+  int restrict = at(restriction, kv["restriction"]);
+  restrict = either(restrict, at(restriction, restriction_prefix(kv["restriction:conditional"],
+                                                                 prefix)));
+  restrict =
+      either(restrict, at(restriction, restriction_prefix(kv["restriction:probable"], prefix)));
+
+  const std::array<const char*, 9> types = {
+      "restriction:hgv",     "restriction:emergency", "restriction:taxi",
+      "restriction:motorcar", "restriction:bus",      "restriction:bicycle",
+      "restriction:hazmat",  "restriction:motorcycle", "restriction:foot"};
+  int restrict_type = kNil;
+  for (const char* type : types) {
+    restrict_type = either(restrict_type, at(restriction, kv[type]));
+  }
+
+  // restrictions with type win over just restriction key.  people enter both.
+  if (restrict_type != kNil) {
+    restrict = restrict_type;
+  }
+
+  if (kv.is("type", "restriction") || kv["restriction:conditional"] ||
+      kv["restriction:probable"]) {
+    if (restrict == kNil) {
+      return true;
+    }
+
+    std::string suffix;
+    for (const char* key : {"restriction:conditional", "restriction:probable"}) {
+      kv.set(key, restriction_suffix(kv[key], suffix));
+    }
+
+    for (const char* type : types) {
+      kv.set_number(type, at(restriction, kv[type]));
+    }
+
+    if (restrict_type == kNil) {
+      kv.set_number("restriction", restrict);
+    } else {
+      kv.set("restriction", nullptr);
+    }
+    return false;
+  } else if (kv.is("route", "bicycle") || kv.is("route", "mtb")) {
+    int bike_mask = 0;
+
+    if (kv.is("network", "mtb") || kv.is("route", "mtb")) {
+      bike_mask = 8;
+    }
+
+    if (kv.is("network", "ncn")) {
+      bike_mask |= 1;
+    } else if (kv.is("network", "rcn")) {
+      bike_mask |= 2;
+    } else if (kv.is("network", "lcn")) {
+      bike_mask |= 4;
+    }
+
+    kv.set_number("bike_network_mask", bike_mask);
+
+    kv.set("day_on", nullptr);
+    kv.set("day_off", nullptr);
+    kv.set("restriction", nullptr);
+    return false;
+    // has a restiction but type is not restriction...ignore
+  } else if (restrict != kNil) {
+    return true;
+  }
+
+  kv.set("day_on", nullptr);
+  kv.set("day_off", nullptr);
+  kv.set("restriction", nullptr);
+  return false;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+Tags GraphTagTransform::Transform(OSMType type, uint64_t osmid, const Tags& tags) const {
+  Tags result(tags);
+  try {
+    bool filter = false;
+    if (type == OSMType::kNode) {
+      nodes_proc(result);
+    } else if (type == OSMType::kWay) {
+      // if there were no tags passed in, ie keyvalues is empty
+      filter = tags.empty() || filter_tags_generic(result);
+    } else {
+      filter = rels_proc(result);
+    }
+    if (filter) {
+      result.clear();
+    }
+  } catch (const std::exception& e) {
+    // where the lua fails so do we, without the tags
+    LOG_ERROR((boost::format("Failed to transform the tags of %1% %2%: %3%") %
+               (type == OSMType::kNode ? "node" : type == OSMType::kWay ? "way" : "relation") %
+               osmid % e.what())
+                  .str());
+    result.clear();
+  }
+  return result;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -1,5 +1,6 @@
 #include "mjolnir/graphtilebuilder.h"
 
+#include "baldr/compression_utils.h"
 #include "baldr/datetime.h"
 #include "baldr/edgeinfo.h"
 #include "baldr/tilehierarchy.h"
@@ -7,9 +8,14 @@
 #include "midgard/logging.h"
 #include <algorithm>
 #include <boost/format.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <list>
+#include <ostream>
 #include <set>
 #include <stdexcept>
+#include <streambuf>
 
 #include "baldr/directededge.h"
 #include "baldr/graphconstants.h"
@@ -43,6 +49,29 @@ std::vector<ComplexRestrictionBuilder> DeserializeRestrictions(char* restriction
   return builders;
 };
 
+// Appends what is written to a stream to a byte buffer. Unlike a stringstream it writes into
+// memory the caller can keep allocated between tiles and hands the bytes over without a copy
+class buffer_streambuf : public std::streambuf {
+public:
+  explicit buffer_streambuf(std::vector<char>& buffer) : buffer_(buffer) {
+  }
+
+protected:
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    buffer_.insert(buffer_.end(), s, s + n);
+    return n;
+  }
+
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      buffer_.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::vector<char>& buffer_;
+};
+
 } // namespace
 
 // Constructor given an existing tile. This is used to read in the tile
@@ -65,7 +94,7 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
   // Done if not deserializing and creating builders for everything
   if (!deserialize) {
     textlistbuilder_.emplace_back("");
-    text_offset_map_.emplace("", 0);
+    text_offset_map_.emplace(textlistbuilder_.back(), 0);
     text_list_offset_ = 1;
 
     // Add a dummy admin record at index 0 to be used if admin records are
@@ -240,9 +269,26 @@ void GraphTileBuilder::StoreTileData() {
     filesystem::create_directories(filename.parent_path());
   }
 
-  // Open file and truncate
-  std::stringstream in_mem;
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  // Serialize the tile into a buffer that is kept by the thread between tiles, the header is
+  // copied in front of the rest at the end and the whole tile is written at once
+  auto started = std::chrono::steady_clock::now();
+  static thread_local std::vector<char> buffer;
+  buffer.clear();
+  buffer.reserve(sizeof(GraphTileHeader) + nodes_builder_.size() * sizeof(NodeInfo) +
+                 transitions_builder_.size() * sizeof(NodeTransition) +
+                 directededges_builder_.size() * sizeof(DirectedEdge) +
+                 directededges_ext_builder_.size() * sizeof(DirectedEdgeExt) +
+                 signs_builder_.size() * sizeof(Sign) + admins_builder_.size() * sizeof(Admin) +
+                 edge_info_offset_ + text_list_offset_ +
+                 lane_connectivity_builder_.size() * sizeof(LaneConnectivity));
+  buffer.resize(sizeof(GraphTileHeader));
+  buffer_streambuf buf(buffer);
+  std::ostream in_mem(&buf);
+
+  // Open a file next to it and truncate, it is swapped in at the end so that other processes
+  // reading the tile never see it half written
+  filesystem::path tmp_filename = filename.string() + ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (file.is_open()) {
     // Write the nodes
     header_builder_.set_nodecount(nodes_builder_.size());
@@ -361,7 +407,7 @@ void GraphTileBuilder::StoreTileData() {
     }
 
     // Add padding (if needed) to align to 8-byte word.
-    int tmp = in_mem.tellp() % 8;
+    int tmp = (buffer.size() - sizeof(GraphTileHeader)) % 8;
     int padding = (tmp > 0) ? 8 - tmp : 0;
     if (padding > 0 && padding < 8) {
       in_mem.write("\0\0\0\0\0\0\0\0", padding);
@@ -374,16 +420,24 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(lane_connectivity_builder_.data()),
                  lane_connectivity_builder_.size() * sizeof(LaneConnectivity));
 
+    // Write the departure index of the transit stops, it points into the departures sorted above
+    const uint32_t stop_departure_offset =
+        header_builder_.lane_connectivity_offset() +
+        (lane_connectivity_builder_.size() * sizeof(LaneConnectivity));
+    const auto stop_departures = BuildStopDepartureIndex();
+    header_builder_.set_stop_departure_offset(stop_departures.empty() ? 0 : stop_departure_offset);
+    in_mem.write(reinterpret_cast<const char*>(stop_departures.data()),
+                 stop_departures.size() * sizeof(uint32_t));
+
     // Set the end offset
-    header_builder_.set_end_offset(header_builder_.lane_connectivity_offset() +
-                                   (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
+    header_builder_.set_end_offset(stop_departure_offset +
+                                   stop_departures.size() * sizeof(uint32_t));
 
     // Sanity check for the end offset
-    uint32_t curr =
-        static_cast<uint32_t>(in_mem.tellp()) + static_cast<uint32_t>(sizeof(GraphTileHeader));
+    uint32_t curr = static_cast<uint32_t>(buffer.size());
     if (header_builder_.end_offset() != curr) {
       LOG_ERROR("Mismatch in end offset " + std::to_string(header_builder_.end_offset()) +
-                " vs in_mem stream " + std::to_string(curr) +
+                " vs in_mem buffer " + std::to_string(curr) +
                 " padding = " + std::to_string(padding));
     }
 
@@ -398,12 +452,24 @@ void GraphTileBuilder::StoreTileData() {
                route_builder_.size())
                   .str());
 
-    // Write the header then the rest of the tile from the in memory buffer
-    file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
-    file << in_mem.rdbuf();
+    // Put the header in front of the rest of the tile and write it all
+    std::memcpy(buffer.data(), &header_builder_, sizeof(GraphTileHeader));
+    auto serialized = std::chrono::steady_clock::now();
+    file.write(buffer.data(), buffer.size());
     file.close();
+    if (std::rename(tmp_filename.c_str(), filename.c_str())) {
+      throw std::runtime_error("Failed to rename " + tmp_filename.string() + " to " +
+                               filename.string());
+    }
+    LOG_DEBUG((boost::format("   serialized %1% bytes in %2% ms, written in %3% ms") %
+               buffer.size() %
+               std::chrono::duration<float, std::milli>(serialized - started).count() %
+               std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() -
+                                                        serialized)
+                   .count())
+                  .str());
   } else {
-    throw std::runtime_error("Failed to open file " + filename.string());
+    throw std::runtime_error("Failed to open file " + tmp_filename.string());
   }
 }
 
@@ -877,8 +943,9 @@ uint32_t GraphTileBuilder::AddName(const std::string& name) {
     textlistbuilder_.emplace_back(name);
 
     // Add name/offset pair to map and update text offset value
-    // to length of string plus null terminator
-    text_offset_map_.emplace(name, text_list_offset_);
+    // to length of string plus null terminator. The key views the copy in the list so the
+    // name is only stored once
+    text_offset_map_.emplace(textlistbuilder_.back(), text_list_offset_);
     text_list_offset_ += (name.length() + 1);
     return offset;
   } else {
@@ -1121,18 +1188,24 @@ std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const gra
 
 void GraphTileBuilder::AddBins(const std::string& tile_dir,
                                const graph_tile_ptr& tile,
-                               const std::array<std::vector<GraphId>, kBinCount>& more_bins) {
+                               const std::array<std::vector<GraphId>, kBinCount>& more_bins,
+                               const std::function<bool(const GraphId& edge_id)>& drop) {
   assert(tile);
-  // read bins and append and keep track of how much is appended
+  // read bins, drop and append and keep track of how much they grow, or shrink when dropping
   std::vector<GraphId> bins[kBinCount];
-  uint32_t shift = 0;
+  int64_t growth = 0;
   for (size_t i = 0; i < kBinCount; ++i) {
     auto bin = tile->GetBin(i % kBinsDim, i / kBinsDim);
-    bins[i].assign(bin.begin(), bin.end());
+    for (const auto& edge_id : bin) {
+      if (!drop || !drop(edge_id)) {
+        bins[i].push_back(edge_id);
+      }
+    }
     bins[i].insert(bins[i].end(), more_bins[i].cbegin(), more_bins[i].cend());
-    shift += more_bins[i].size();
+    growth += static_cast<int64_t>(bins[i].size()) - static_cast<int64_t>(bin.size());
   }
-  shift *= sizeof(GraphId);
+  // the offsets wrap around like the signed shift they are
+  const uint32_t shift = static_cast<uint32_t>(growth * static_cast<int64_t>(sizeof(GraphId)));
   // update header bin indices
   uint32_t offsets[kBinCount] = {static_cast<uint32_t>(bins[0].size())};
   for (size_t i = 1; i < kBinCount; ++i) {
@@ -1261,6 +1334,277 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
   }
 }
 
+// Updates the directed edges and replaces the predicted speeds of a tile without a builder.
+bool GraphTileBuilder::PatchPredictedSpeeds(const std::string& tile_dir,
+                                            const GraphId& graphid,
+                                            const predicted_speed_patch_t& patch) {
+  filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(graphid);
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in.is_open()) {
+    return false;
+  }
+  std::vector<char> bytes(in.tellg());
+  in.seekg(0);
+  in.read(bytes.data(), bytes.size());
+  in.close();
+  if (bytes.size() < sizeof(GraphTileHeader) ||
+      detect_compression(bytes.data(), bytes.size()) != tile_compression_t::none) {
+    return false;
+  }
+  auto* header = reinterpret_cast<GraphTileHeader*>(bytes.data());
+  if (header->end_offset() != bytes.size()) {
+    return false;
+  }
+
+  // The directed edges follow the nodes and the node transitions
+  auto* directededges = reinterpret_cast<DirectedEdge*>(
+      bytes.data() + sizeof(GraphTileHeader) + header->nodecount() * sizeof(NodeInfo) +
+      header->transitioncount() * sizeof(NodeTransition));
+  const uint32_t edge_count = header->directededgecount();
+  std::vector<uint32_t> offsets;
+  std::vector<int16_t> profiles;
+  std::array<int16_t, kCoefficientCount> coefficients;
+  for (uint32_t i = 0; i < edge_count; ++i) {
+    const bool has_profile = patch(i, directededges[i], coefficients);
+    directededges[i].set_has_predicted_speed(has_profile);
+    if (has_profile) {
+      offsets.resize(edge_count);
+      offsets[i] = profiles.size();
+      profiles.insert(profiles.end(), coefficients.begin(), coefficients.end());
+    }
+  }
+
+  // The old predicted speeds are dropped if nothing came after them
+  size_t offset = header->end_offset();
+  const size_t old_size = header->predictedspeeds_count() > 0
+                              ? edge_count * sizeof(uint32_t) + header->predictedspeeds_count() *
+                                                                    kCoefficientCount *
+                                                                    sizeof(int16_t)
+                              : 0;
+  if (old_size > 0 && header->predictedspeeds_offset() + old_size == header->end_offset()) {
+    offset = header->predictedspeeds_offset();
+  }
+  header->set_predictedspeeds_offset(offset);
+  header->set_predictedspeeds_count(profiles.size() / kCoefficientCount);
+  header->set_end_offset(offset + offsets.size() * sizeof(uint32_t) +
+                         profiles.size() * sizeof(int16_t));
+
+  // Write the tile next to the old one and swap it in at the end
+  filesystem::path tmp_filename = filename.string() + ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + tmp_filename.string());
+  }
+  file.write(bytes.data(), offset);
+  file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+  file.write(reinterpret_cast<const char*>(profiles.data()), profiles.size() * sizeof(int16_t));
+  file.close();
+
+  if (std::rename(tmp_filename.c_str(), filename.c_str())) {
+    throw std::runtime_error("Failed to rename " + tmp_filename.string() + " to " +
+                             filename.string());
+  }
+  return true;
+}
+
+bool GraphTileBuilder::PatchDirectedEdges(const std::string& tile_dir,
+                                          const GraphId& graphid,
+                                          const std::vector<DirectedEdge>& edges) {
+  filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(graphid);
+  std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  GraphTileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(GraphTileHeader));
+  if (!file || detect_compression(reinterpret_cast<const char*>(&header), sizeof(header)) !=
+                   tile_compression_t::none) {
+    return false;
+  }
+  file.seekg(0, std::ios::end);
+  if (header.end_offset() != static_cast<uint64_t>(file.tellg()) ||
+      header.directededgecount() != edges.size()) {
+    return false;
+  }
+
+  // The directed edges follow the nodes and the node transitions
+  file.seekp(sizeof(GraphTileHeader) + header.nodecount() * sizeof(NodeInfo) +
+             header.transitioncount() * sizeof(NodeTransition));
+  file.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(DirectedEdge));
+  if (!file) {
+    throw std::runtime_error("Failed to write the directed edges of " + filename.string());
+  }
+  return true;
+}
+
+void GraphTileBuilder::UpdateReachIndex(const uint32_t max_reach,
+                                        const std::vector<uint32_t>& access,
+                                        const std::vector<EdgeReach>& reaches) {
+  const uint32_t edge_count = header_->directededgecount();
+  if (reaches.size() != access.size() * edge_count) {
+    throw std::runtime_error(
+        "GraphTileBuilder::UpdateReachIndex - reach count does not match the edge count");
+  }
+
+  // An existing reach section is replaced, it can only be dropped if nothing came after it
+  size_t offset = header_->end_offset();
+  if (header_->reach_offset() > 0) {
+    ReachIndex existing(reinterpret_cast<const char*>(header_) + header_->reach_offset(),
+                        edge_count);
+    if (header_->reach_offset() + ReachIndex::SizeOf(existing.column_count(), edge_count) !=
+        header_->end_offset()) {
+      throw std::runtime_error(
+          "GraphTileBuilder::UpdateReachIndex - the reach section is not the last section");
+    }
+    offset = header_->reach_offset();
+  }
+
+  // Write the tile next to the old one and swap it in at the end
+  filesystem::path filename = tile_dir_ + filesystem::path::preferred_separator +
+                              GraphTile::FileSuffix(header_builder_.graphid());
+  if (!filesystem::exists(filename.parent_path()))
+    filesystem::create_directories(filename.parent_path());
+  filesystem::path tmp_filename = filename.string() + ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + tmp_filename.string());
+  }
+
+  // Write a new header pointing at the reach section, everything else is copied as is
+  header_builder_.set_reach_offset(offset);
+  header_builder_.set_end_offset(offset + ReachIndex::SizeOf(access.size(), edge_count));
+  file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
+  file.write(reinterpret_cast<const char*>(header_) + sizeof(GraphTileHeader),
+             offset - sizeof(GraphTileHeader));
+
+  // Append the reach section
+  ReachIndexHeader reach_header{max_reach, static_cast<uint32_t>(access.size())};
+  file.write(reinterpret_cast<const char*>(&reach_header), sizeof(ReachIndexHeader));
+  file.write(reinterpret_cast<const char*>(access.data()), access.size() * sizeof(uint32_t));
+  file.write(reinterpret_cast<const char*>(reaches.data()), reaches.size() * sizeof(EdgeReach));
+  file.close();
+
+  if (std::rename(tmp_filename.c_str(), filename.c_str())) {
+    throw std::runtime_error("Failed to rename " + tmp_filename.string() + " to " +
+                             filename.string());
+  }
+}
+
+std::vector<uint32_t> GraphTileBuilder::BuildStopDepartureIndex() const {
+  if (departure_builder_.empty()) {
+    return {};
+  }
+
+  // The departures of each stop are those of the transit lines leaving it, the departures of a
+  // line are next to each other since they are sorted by line first
+  std::vector<uint32_t> offsets, departures, frequency;
+  offsets.reserve(2 * nodes_builder_.size() + 1);
+  departures.reserve(departure_builder_.size());
+  for (const auto& node : nodes_builder_) {
+    offsets.push_back(departures.size());
+    frequency.clear();
+    for (uint32_t i = 0; i < node.edge_count(); ++i) {
+      const auto& edge = directededges_builder_[node.edge_index() + i];
+      if (!edge.IsTransitLine()) {
+        continue;
+      }
+      auto departure =
+          std::lower_bound(departure_builder_.begin(), departure_builder_.end(), edge.lineid(),
+                           [](const TransitDeparture& d, const uint32_t lineid) {
+                             return d.lineid() < lineid;
+                           });
+      for (; departure != departure_builder_.end() && departure->lineid() == edge.lineid();
+           ++departure) {
+        const uint32_t index = departure - departure_builder_.begin();
+        (departure->type() == kFixedSchedule ? departures : frequency).push_back(index);
+      }
+    }
+
+    // Fixed schedules by departure time, then frequencies by the end of their service
+    std::stable_sort(departures.begin() + offsets.back(), departures.end(),
+                     [this](const uint32_t a, const uint32_t b) {
+                       return departure_builder_[a].departure_time() <
+                              departure_builder_[b].departure_time();
+                     });
+    offsets.push_back(departures.size());
+    std::stable_sort(frequency.begin(), frequency.end(), [this](const uint32_t a, const uint32_t b) {
+      return departure_builder_[a].end_time() < departure_builder_[b].end_time();
+    });
+    departures.insert(departures.end(), frequency.begin(), frequency.end());
+  }
+  offsets.push_back(departures.size());
+
+  // The header and the offsets go in front of the departures
+  std::vector<uint32_t> section = {static_cast<uint32_t>(nodes_builder_.size()),
+                                   static_cast<uint32_t>(departures.size())};
+  section.reserve(StopDepartureIndex::SizeOf(section[0], section[1]) / sizeof(uint32_t));
+  section.insert(section.end(), offsets.begin(), offsets.end());
+  section.insert(section.end(), departures.begin(), departures.end());
+  return section;
+}
+
+void GraphTileBuilder::UpdateOpposingEdgeIds(const std::vector<GraphId>& opposing_edge_ids) {
+  const uint32_t edge_count = header_->directededgecount();
+  if (opposing_edge_ids.size() != edge_count) {
+    throw std::runtime_error(
+        "GraphTileBuilder::UpdateOpposingEdgeIds - opposing edge count does not match the edge count");
+  }
+  UpdateSection(header_->opposing_offset(), reinterpret_cast<const char*>(opposing_edge_ids.data()),
+                edge_count * sizeof(GraphId), &GraphTileHeader::set_opposing_offset);
+}
+
+void GraphTileBuilder::UpdateEdgeElevation(const std::vector<EdgeElevation>& elevations) {
+  const uint32_t edge_count = header_->directededgecount();
+  if (elevations.size() != edge_count) {
+    throw std::runtime_error(
+        "GraphTileBuilder::UpdateEdgeElevation - elevation count does not match the edge count");
+  }
+  UpdateSection(header_->elevation_offset(), reinterpret_cast<const char*>(elevations.data()),
+                edge_count * sizeof(EdgeElevation), &GraphTileHeader::set_elevation_offset);
+}
+
+void GraphTileBuilder::UpdateSection(size_t offset,
+                                     const char* data,
+                                     const size_t section_size,
+                                     void (GraphTileHeader::*set_offset)(const uint32_t)) {
+  // An existing section has the same size so it is overwritten where it is, otherwise it is appended
+  size_t end_offset = header_->end_offset();
+  if (offset == 0) {
+    offset = end_offset;
+    end_offset += section_size;
+  }
+
+  // Write the tile next to the old one and swap it in at the end
+  filesystem::path filename = tile_dir_ + filesystem::path::preferred_separator +
+                              GraphTile::FileSuffix(header_builder_.graphid());
+  if (!filesystem::exists(filename.parent_path()))
+    filesystem::create_directories(filename.parent_path());
+  filesystem::path tmp_filename = filename.string() + ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + tmp_filename.string());
+  }
+
+  // Write a new header pointing at the section, everything around it is copied as is
+  (header_builder_.*set_offset)(offset);
+  header_builder_.set_end_offset(end_offset);
+  const auto* tile_ptr = reinterpret_cast<const char*>(header_);
+  file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
+  file.write(tile_ptr + sizeof(GraphTileHeader), offset - sizeof(GraphTileHeader));
+  file.write(data, section_size);
+  if (offset + section_size < end_offset) {
+    file.write(tile_ptr + offset + section_size, end_offset - offset - section_size);
+  }
+  file.close();
+
+  if (std::rename(tmp_filename.c_str(), filename.c_str())) {
+    throw std::runtime_error("Failed to rename " + tmp_filename.string() + " to " +
+                             filename.string());
+  }
+}
+
 void GraphTileBuilder::AddLandmark(const GraphId& edge_id, const Landmark& landmark) {
   // check the edge id makes sense
   if (header_builder_.graphid().Tile_Base() != edge_id.Tile_Base()) {
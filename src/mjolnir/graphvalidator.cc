@@ -1,9 +1,13 @@
 
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 
 #include <boost/format.hpp>
+#include <algorithm>
+#include <fstream>
+#include <functional>
 #include <future>
 #include <iostream>
 #include <list>
@@ -16,6 +20,7 @@
 #include <string>
 #include <thread>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -24,6 +29,7 @@
 #include "baldr/graphreader.h"
 #include "baldr/nodeinfo.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -247,7 +253,9 @@ uint32_t GetOpposingEdgeIndex(const GraphId& startnode,
 using tweeners_t = GraphTileBuilder::tweeners_t;
 void validate(
     const boost::property_tree::ptree& pt,
-    std::deque<GraphId>& tilequeue,
+    TileScheduler& scheduler,
+    const std::function<bool(const GraphId&)>& revalidated,
+    size_t worker,
     std::mutex& lock,
     std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>&
         result) {
@@ -269,17 +277,8 @@ void validate(
   std::set<uint32_t> problem_ways;
 
   // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
     // Point tiles to the set we need for current level
     const auto& tiles = tile_id.level() == TileHierarchy::GetTransitLevel().level
                             ? TileHierarchy::levels().back().tiles
@@ -458,10 +457,13 @@ void validate(
     lock.lock();
     tilebuilder.Update(nodes, directededges);
 
-    // Write the bins to it
+    // Write the bins to it, in place of the ones it had from the tiles validated again
     if (tile->header()->graphid().level() == TileHierarchy::levels().back().level) {
       auto reloaded = GraphTile::Create(graph_reader.tile_dir(), tile_id);
-      GraphTileBuilder::AddBins(graph_reader.tile_dir(), reloaded, bins);
+      GraphTileBuilder::AddBins(graph_reader.tile_dir(), reloaded, bins,
+                                [&revalidated](const GraphId& edge_id) {
+                                  return revalidated(edge_id.Tile_Base());
+                                });
     }
 
     // Check if we need to clear the tile cache
@@ -504,6 +506,7 @@ void merge(const tweeners_t& in, tweeners_t& out) {
 void bin_tweeners(const std::string& tile_dir,
                   tweeners_t::iterator& start,
                   const tweeners_t::iterator& end,
+                  const std::function<bool(const GraphId&)>& revalidated,
                   uint64_t dataset_id,
                   std::mutex& lock) {
   // go while we have tiles to update
@@ -521,6 +524,11 @@ void bin_tweeners(const std::string& tile_dir,
     // some tiles are just there because edges' shapes passes through them (no edges/nodes, just bins)
     // if that's the case we need to make a tile to store the spatial index (binned edges) there
     auto tile = GraphTile::Create(tile_dir, tile_bin.first);
+    // only the bins of tiles that were validated again might be stale, they need no new tile
+    if (!tile && std::all_of(tile_bin.second.begin(), tile_bin.second.end(),
+                             [](const std::vector<GraphId>& bin) { return bin.empty(); })) {
+      continue;
+    }
     if (!tile) {
       GraphTileBuilder empty(tile_dir, tile_bin.first, false);
       empty.header_builder().set_dataset_id(dataset_id);
@@ -528,10 +536,118 @@ void bin_tweeners(const std::string& tile_dir,
       tile = GraphTile::Create(tile_dir, tile_bin.first);
     }
 
-    // keep the extra binned edges
-    GraphTileBuilder::AddBins(tile_dir, tile, tile_bin.second);
+    // keep the extra binned edges, in place of the ones of the tiles validated again. the bins of
+    // the tile itself are already in place when it was validated again as well
+    GraphTileBuilder::AddBins(tile_dir, tile, tile_bin.second,
+                              [&revalidated, &tile_bin](const GraphId& edge_id) {
+                                return edge_id.Tile_Base() != tile_bin.first &&
+                                       revalidated(edge_id.Tile_Base());
+                              });
+  }
+}
+
+// run a pass to add the edges that binned to tweener tiles
+void bin_all_tweeners(const std::string& tile_dir,
+                      tweeners_t& tweeners,
+                      const std::function<bool(const GraphId&)>& revalidated,
+                      uint64_t dataset_id,
+                      size_t thread_count) {
+  LOG_INFO("Binning inter-tile edges...");
+  std::mutex lock;
+  auto start = tweeners.begin();
+  auto end = tweeners.end();
+  std::vector<std::shared_ptr<std::thread>> threads(thread_count);
+  for (auto& thread : threads) {
+    thread.reset(new std::thread(bin_tweeners, std::cref(tile_dir), std::ref(start), std::cref(end),
+                                 std::cref(revalidated), dataset_id, std::ref(lock)));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  LOG_INFO("Finished");
+}
+
+// where a shard keeps the edges it binned to tweener tiles until all shards are merged
+std::string tweeners_file(const std::string& tile_dir, uint32_t shard_index) {
+  return tile_dir + filesystem::path::preferred_separator + "tweeners_" +
+         std::to_string(shard_index) + ".bin";
+}
+
+void write_tweeners(const std::string& file_name, const tweeners_t& tweeners) {
+  std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  for (const auto& tile_bin : tweeners) {
+    file.write(reinterpret_cast<const char*>(&tile_bin.first), sizeof(GraphId));
+    for (const auto& bin : tile_bin.second) {
+      uint32_t count = bin.size();
+      file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      file.write(reinterpret_cast<const char*>(bin.data()), count * sizeof(GraphId));
+    }
+  }
+  file.close();
+  if (!file) {
+    throw std::runtime_error("Failed to write " + file_name);
+  }
+}
+
+tweeners_t read_tweeners(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::in | std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + file_name);
   }
+  tweeners_t tweeners;
+  GraphId tile_id;
+  while (file.read(reinterpret_cast<char*>(&tile_id), sizeof(GraphId))) {
+    auto& bins = tweeners[tile_id];
+    for (auto& bin : bins) {
+      uint32_t count = 0;
+      file.read(reinterpret_cast<char*>(&count), sizeof(count));
+      bin.resize(count);
+      file.read(reinterpret_cast<char*>(bin.data()), count * sizeof(GraphId));
+    }
+    if (!file) {
+      throw std::runtime_error("Truncated " + file_name);
+    }
+  }
+  return tweeners;
 }
+
+// The tiles to validate again for the changed tiles, which are the changed tiles and the tiles
+// their edges lead to, as the opposing edges of the edges between them have to be found again
+std::unordered_set<GraphId> revalidated_tiles(GraphReader& reader, const TileChanges& changes) {
+  std::unordered_set<GraphId> revalidated;
+  for (const auto& tile_id : changes.tiles) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    revalidated.insert(tile_id);
+    const auto* edge = tile->directededge(0);
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edge) {
+      revalidated.insert(edge->endnode().Tile_Base());
+    }
+  }
+  return revalidated;
+}
+
+// Make sure the tiles at the local level around the revalidated ones get binned, their bins may
+// have edges of the revalidated tiles that no longer pass through them. Edges are assumed to
+// stay within the tiles next to where they were.
+void add_stale_bins(const std::unordered_set<GraphId>& revalidated, tweeners_t& tweeners) {
+  const auto& level = TileHierarchy::levels().back();
+  const auto size = level.tiles.TileSize();
+  for (const auto& tile_id : revalidated) {
+    if (tile_id.level() > level.level) {
+      continue;
+    }
+    auto bounds = TileHierarchy::GetGraphIdBoundingBox(tile_id);
+    AABB2<PointLL> around(bounds.minx() - size, bounds.miny() - size, bounds.maxx() + size,
+                          bounds.maxy() + size);
+    for (auto id : level.tiles.TileList(around)) {
+      tweeners[GraphId(id, level.level, 0)];
+    }
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -541,22 +657,31 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   LOG_INFO("Validating, finishing and binning tiles...");
   auto hierarchy_properties = pt.get_child("mjolnir");
   std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
+  const auto shard = TileShard::FromConfig(pt);
 
-  // Create a randomized queue of tiles (at all levels) to work from
-  std::deque<GraphId> tilequeue;
+  // Remember what the dataset id is in case we have to make some tiles
   GraphReader reader(pt.get_child("mjolnir"));
   auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
-  }
-  // fixed seed for reproducible tile build
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(3));
-
-  // Remember what the dataset id is in case we have to make some tiles
-  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tilequeue.begin());
-  assert(tilequeue.size() && first_tile);
+  assert(!tileset.empty());
+  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tileset.begin());
+  assert(first_tile);
   auto dataset_id = first_tile->header()->dataset_id();
 
+  // Only the tiles that changed since they were last validated and their neighbours are validated
+  // and binned again, unless all of them changed
+  const auto changes = TileChanges::Read(tile_dir);
+  std::vector<GraphId> tiles(tileset.begin(), tileset.end());
+  std::unordered_set<GraphId> revalidated;
+  if (!changes.all) {
+    revalidated = revalidated_tiles(reader, changes);
+    tiles.assign(revalidated.begin(), revalidated.end());
+    LOG_INFO("Validating " + std::to_string(revalidated.size()) + " tiles for " +
+             std::to_string(changes.tiles.size()) + " changed tiles");
+  }
+  const std::function<bool(const GraphId&)> is_revalidated = [&](const GraphId& tile_id) {
+    return changes.all || revalidated.count(tile_id) > 0;
+  };
+
   // An mutex we can use to do the synchronization
   std::mutex lock;
 
@@ -565,22 +690,29 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
       std::max(static_cast<unsigned int>(1),
                pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
 
+  // Schedule the tiles (at all levels) of this shard to work on, the biggest first. The order in
+  // which they are dealt out only depends on the tiles so the tile build stays reproducible
+  TileScheduler scheduler("Validating", shard.Select(std::move(tiles)), threads.size(),
+                          TileScheduler::FileSize(tile_dir));
+
   // Setup promises
   std::list<
       std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>>
       results;
 
   // Spawn the threads
-  for (auto& thread : threads) {
+  for (size_t i = 0; i < threads.size(); ++i) {
     results.emplace_back();
-    thread.reset(new std::thread(validate, std::cref(pt), std::ref(tilequeue), std::ref(lock),
-                                 std::ref(results.back())));
+    threads[i].reset(new std::thread(validate, std::cref(pt), std::ref(scheduler),
+                                     std::cref(is_revalidated), i, std::ref(lock),
+                                     std::ref(results.back())));
   }
 
   // Wait for threads to finish
   for (auto& thread : threads) {
     thread->join();
   }
+  scheduler.LogUtilization();
   // Get the promise from the future
   std::vector<uint32_t> duplicates(TileHierarchy::levels().size(), 0);
   std::vector<std::vector<float>> densities(3);
@@ -599,18 +731,19 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
   }
   LOG_INFO("Finished");
 
-  // run a pass to add the edges that binned to tweener tiles
-  LOG_INFO("Binning inter-tile edges...");
-  auto start = tweeners.begin();
-  auto end = tweeners.end();
-  for (auto& thread : threads) {
-    thread.reset(new std::thread(bin_tweeners, std::cref(tile_dir), std::ref(start), std::cref(end),
-                                 dataset_id, std::ref(lock)));
-  }
-  for (auto& thread : threads) {
-    thread->join();
+  // the tweener tiles may belong to other shards, they are binned once all shards are done
+  if (shard.sharded()) {
+    auto file_name = tweeners_file(tile_dir, shard.index);
+    write_tweeners(file_name, tweeners);
+    LOG_INFO("Wrote inter-tile edges of " + std::to_string(tweeners.size()) + " tiles to " +
+             file_name + " for the merge stage");
+  } else {
+    if (!changes.all) {
+      add_stale_bins(revalidated, tweeners);
+    }
+    bin_all_tweeners(tile_dir, tweeners, is_revalidated, dataset_id, threads.size());
+    TileChanges::Clear(tile_dir);
   }
-  LOG_INFO("Finished");
 
   // print dupcount and find densities
   for (uint8_t level = 0; level < TileHierarchy::levels().size(); level++) {
@@ -636,5 +769,51 @@ void GraphValidator::Validate(const boost::property_tree::ptree& pt) {
 #endif
   }
 }
+
+void GraphValidator::Merge(const boost::property_tree::ptree& pt) {
+  const auto shard = TileShard::FromConfig(pt);
+  std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  LOG_INFO("Merging inter-tile edges of " + std::to_string(shard.count) + " shards...");
+
+  // every shard has to have validated its tiles
+  tweeners_t tweeners;
+  for (uint32_t index = 0; index < shard.count; ++index) {
+    auto file_name = tweeners_file(tile_dir, index);
+    if (!filesystem::exists(file_name)) {
+      throw std::runtime_error("Shard " + std::to_string(index) + " has not validated its tiles, " +
+                               file_name + " is missing");
+    }
+    merge(read_tweeners(file_name), tweeners);
+  }
+
+  // Remember what the dataset id is in case we have to make some tiles
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto tileset = reader.GetTileSet();
+  if (tileset.empty()) {
+    throw std::runtime_error("No tiles to merge in " + tile_dir);
+  }
+  graph_tile_ptr first_tile = GraphTile::Create(tile_dir, *tileset.begin());
+  auto dataset_id = first_tile->header()->dataset_id();
+
+  // the shards validated the same tiles again, the changes are gone once they are binned
+  const auto changes = TileChanges::Read(tile_dir);
+  std::unordered_set<GraphId> revalidated;
+  if (!changes.all) {
+    revalidated = revalidated_tiles(reader, changes);
+    add_stale_bins(revalidated, tweeners);
+  }
+  const std::function<bool(const GraphId&)> is_revalidated = [&](const GraphId& tile_id) {
+    return changes.all || revalidated.count(tile_id) > 0;
+  };
+
+  bin_all_tweeners(tile_dir, tweeners, is_revalidated, dataset_id,
+                   std::max(static_cast<unsigned int>(1),
+                            pt.get<unsigned int>("mjolnir.concurrency",
+                                                 std::thread::hardware_concurrency())));
+  for (uint32_t index = 0; index < shard.count; ++index) {
+    filesystem::remove(tweeners_file(tile_dir, index));
+  }
+  TileChanges::Clear(tile_dir);
+}
 } // namespace mjolnir
 } // namespace valhalla
@@ -0,0 +1,215 @@
+#include "mjolnir/gtfs_stop_times.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Column indexes of the stop_times.txt header
+struct columns_t {
+  int trip_id = -1;
+  int stop_id = -1;
+  int stop_sequence = -1;
+  int arrival_time = -1;
+  int departure_time = -1;
+  int shape_dist_traveled = -1;
+};
+
+const std::string& field(const std::vector<std::string>& fields, const int index) {
+  static const std::string empty;
+  return index < 0 || static_cast<size_t>(index) >= fields.size() ? empty : fields[index];
+}
+
+// Parse the lines starting within [begin, end) of the file
+void parse_range(const std::string& file,
+                 const columns_t& columns,
+                 const uint64_t begin,
+                 const uint64_t end,
+                 const size_t batch_size,
+                 const std::function<void(std::vector<valhalla::mjolnir::GtfsStopTime>&)>& consume,
+                 size_t& count) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Couldn't read " + file);
+  }
+
+  // The line that crosses into the range belongs to the range before
+  uint64_t position = begin;
+  std::string line;
+  if (begin > 0) {
+    in.seekg(begin - 1);
+    std::getline(in, line);
+    position += line.size();
+  }
+
+  std::vector<std::string> fields;
+  std::vector<valhalla::mjolnir::GtfsStopTime> batch;
+  batch.reserve(batch_size);
+  while (position < end && std::getline(in, line)) {
+    position += line.size() + 1;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty()) {
+      continue;
+    }
+
+    valhalla::mjolnir::split_gtfs_line(line, fields);
+    const auto& trip_id = field(fields, columns.trip_id);
+    const auto& stop_id = field(fields, columns.stop_id);
+    if (trip_id.empty() || stop_id.empty()) {
+      continue;
+    }
+    const auto& sequence = field(fields, columns.stop_sequence);
+    const auto& dist = field(fields, columns.shape_dist_traveled);
+    batch.push_back({trip_id, stop_id,
+                     static_cast<uint32_t>(std::strtoul(sequence.c_str(), nullptr, 10)),
+                     valhalla::mjolnir::parse_gtfs_time(field(fields, columns.arrival_time)),
+                     valhalla::mjolnir::parse_gtfs_time(field(fields, columns.departure_time)),
+                     dist.empty() ? 0.f : std::strtof(dist.c_str(), nullptr)});
+    if (batch.size() == batch_size) {
+      count += batch.size();
+      consume(batch);
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    count += batch.size();
+    consume(batch);
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+uint32_t parse_gtfs_time(const std::string& time) {
+  const auto first = time.find(':');
+  const auto second = first == std::string::npos ? first : time.find(':', first + 1);
+  if (second == std::string::npos) {
+    return 0;
+  }
+  const auto hours = std::strtoul(time.c_str(), nullptr, 10);
+  const auto minutes = std::strtoul(time.c_str() + first + 1, nullptr, 10);
+  const auto seconds = std::strtoul(time.c_str() + second + 1, nullptr, 10);
+  return static_cast<uint32_t>(hours * 3600 + minutes * 60 + seconds);
+}
+
+void split_gtfs_line(const std::string& line, std::vector<std::string>& fields) {
+  fields.clear();
+  fields.emplace_back();
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); ++i) {
+    const char c = line[i];
+    if (quoted) {
+      if (c != '"') {
+        fields.back().push_back(c);
+      } else if (i + 1 < line.size() && line[i + 1] == '"') {
+        fields.back().push_back('"');
+        ++i;
+      } else {
+        quoted = false;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.emplace_back();
+    } else {
+      fields.back().push_back(c);
+    }
+  }
+  for (auto& f : fields) {
+    f.erase(f.find_last_not_of(' ') + 1);
+    f.erase(0, f.find_first_not_of(' '));
+  }
+}
+
+size_t read_gtfs_stop_times(const std::string& file,
+                            unsigned int threads,
+                            size_t batch_size,
+                            const std::function<void(std::vector<GtfsStopTime>&)>& consume) {
+  std::ifstream in(file, std::ios::binary);
+  std::string header;
+  if (!in || !std::getline(in, header)) {
+    throw std::runtime_error("Couldn't read " + file);
+  }
+  const uint64_t data_begin = header.size() + 1;
+  in.seekg(0, std::ios::end);
+  const uint64_t size = in.tellg();
+  in.close();
+
+  // Map the columns, the header may start with a byte order mark
+  if (header.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+    header.erase(0, 3);
+  }
+  if (!header.empty() && header.back() == '\r') {
+    header.pop_back();
+  }
+  std::vector<std::string> names;
+  split_gtfs_line(header, names);
+  columns_t columns;
+  for (size_t i = 0; i < names.size(); ++i) {
+    const int index = static_cast<int>(i);
+    if (names[i] == "trip_id") {
+      columns.trip_id = index;
+    } else if (names[i] == "stop_id") {
+      columns.stop_id = index;
+    } else if (names[i] == "stop_sequence") {
+      columns.stop_sequence = index;
+    } else if (names[i] == "arrival_time") {
+      columns.arrival_time = index;
+    } else if (names[i] == "departure_time") {
+      columns.departure_time = index;
+    } else if (names[i] == "shape_dist_traveled") {
+      columns.shape_dist_traveled = index;
+    }
+  }
+  if (columns.trip_id < 0 || columns.stop_id < 0 || columns.stop_sequence < 0) {
+    throw std::runtime_error(file + " lacks the trip_id, stop_id or stop_sequence column");
+  }
+
+  // Every thread parses its share of the bytes after the header
+  threads = std::max(1u, threads);
+  if (size <= data_begin) {
+    return 0;
+  }
+  const uint64_t share = (size - data_begin + threads - 1) / threads;
+  batch_size = std::max(static_cast<size_t>(1), batch_size);
+  std::vector<size_t> counts(threads, 0);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> parsers;
+  for (unsigned int i = 0; i < threads; ++i) {
+    const uint64_t begin = data_begin + i * share;
+    const uint64_t end = std::min(size, begin + share);
+    if (begin >= end) {
+      break;
+    }
+    parsers.emplace_back([&, i, begin, end]() {
+      try {
+        parse_range(file, columns, begin, end, batch_size, consume, counts[i]);
+      } catch (...) { errors[i] = std::current_exception(); }
+    });
+  }
+  for (auto& parser : parsers) {
+    parser.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  size_t count = 0;
+  for (const auto c : counts) {
+    count += c;
+  }
+  return count;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
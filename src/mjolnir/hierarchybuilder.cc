@@ -4,11 +4,19 @@
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
 #include <iostream>
+#include <list>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -21,6 +29,7 @@
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/sequence.h"
+#include "mjolnir/tilescheduler.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -68,23 +77,28 @@ bool AddUpwardTransition(const GraphId& node, GraphTileBuilder* tilebuilder) {
   }
 }
 
-void SortSequences(const std::string& new_to_old_file, const std::string& old_to_new_file) {
+void SortSequences(const std::string& new_to_old_file,
+                   const std::string& old_to_new_file,
+                   size_t threads) {
   // Sort the new nodes. Sort so highway level is first
   sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-  new_to_old.sort([](const std::pair<GraphId, GraphId>& a, const std::pair<GraphId, GraphId>& b) {
-    if (a.first.level() == b.first.level()) {
-      if (a.first.tileid() == b.first.tileid()) {
-        return a.first.id() < b.first.id();
-      }
-      return a.first.tileid() < b.first.tileid();
-    }
-    return a.first.level() < b.first.level();
-  });
+  new_to_old.sort(
+      [](const std::pair<GraphId, GraphId>& a, const std::pair<GraphId, GraphId>& b) {
+        if (a.first.level() == b.first.level()) {
+          if (a.first.tileid() == b.first.tileid()) {
+            return a.first.id() < b.first.id();
+          }
+          return a.first.tileid() < b.first.tileid();
+        }
+        return a.first.level() < b.first.level();
+      },
+      sequence<std::pair<GraphId, GraphId>>::sort_buffer_size, threads);
 
   // Sort old to new by node Id
   sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
   old_to_new.sort(
-      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; });
+      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; },
+      sequence<OldToNewNodes>::sort_buffer_size, threads);
 }
 
 // Convenience method to find the node association.
@@ -121,258 +135,325 @@ bool OpposingEdgeInfoMatches(const graph_tile_ptr& tile, const DirectedEdge* edg
   return false;
 }
 
-// Form tiles in the new level.
-void FormTilesInNewLevel(GraphReader& reader,
-                         const std::string& new_to_old_file,
-                         const std::string& old_to_new_file) {
-  // Use the sequence that associate new nodes to old nodes
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-
-  // Use the sorted sequence that associates old nodes to new nodes
-  sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
-
-  // lambda to indicate whether a directed edge should be included
-  auto include_edge = [&old_to_new](const DirectedEdge* directededge, const GraphId& base_node,
-                                    const uint8_t current_level) {
-    if (directededge->use() == Use::kTransitConnection ||
-        directededge->use() == Use::kEgressConnection ||
-        directededge->use() == Use::kPlatformConnection) {
-      // Transit connection edges should live on the lowest class level
-      // where a new node exists
-      auto f = find_nodes(old_to_new, base_node);
-      uint8_t lowest_level;
-      if (f.local_node.Is_Valid())
-        lowest_level = 2;
-      else if (f.arterial_node.Is_Valid())
-        lowest_level = 1;
-      else if (f.highway_node.Is_Valid())
-        lowest_level = 0;
-      else
-        throw std::logic_error("Could not find valid node level");
-      return (lowest_level == current_level);
-    } else if (directededge->bss_connection()) {
-      // Despite the road class, Bike Share Stations' connections are always at local level
-      return (2 == current_level);
-    } else {
-      return (TileHierarchy::get_level(directededge->classification()) == current_level);
-    }
-  };
+// The range of the sorted new to old nodes that forms a tile in a new level
+using NodeRange = std::pair<size_t, size_t>;
 
-  // Iterate through the new nodes. They have been sorted by level so that
-  // highway level is done first.
-  reader.Clear();
-  bool added = false;
-  uint8_t current_level = std::numeric_limits<uint8_t>::max();
-  GraphId tile_id;
-  std::hash<std::string> hasher;
-  PointLL base_ll;
-  GraphTileBuilder* tilebuilder = nullptr;
-  for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++) {
-    // Get the node - check if a new tile
-    GraphId nodea = (*new_node).first;
-    if (nodea.Tile_Base() != tile_id) {
-      // Store the prior tile
-      if (tilebuilder != nullptr) {
-        tilebuilder->StoreTileData();
-        delete tilebuilder;
+// Form the tiles the scheduler hands this worker in the new levels. Each tile is formed from
+// its range of the sorted new to old nodes and only reads the base tiles of those nodes.
+void FormTilesInNewLevel(const boost::property_tree::ptree& hierarchy_properties,
+                         const std::string& new_to_old_file,
+                         const std::string& old_to_new_file,
+                         const std::unordered_map<GraphId, NodeRange>& new_tiles,
+                         TileScheduler& scheduler,
+                         size_t worker,
+                         std::promise<void>& result) {
+  try {
+    // Local graphreader and sequences for this thread, the sequences are only read so they
+    // need no write buffer
+    GraphReader reader(hierarchy_properties);
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false, 0);
+    sequence<OldToNewNodes> old_to_new(old_to_new_file, false, 0);
+
+    // lambda to indicate whether a directed edge should be included
+    auto include_edge = [&old_to_new](const DirectedEdge* directededge, const GraphId& base_node,
+                                      const uint8_t current_level) {
+      if (directededge->use() == Use::kTransitConnection ||
+          directededge->use() == Use::kEgressConnection ||
+          directededge->use() == Use::kPlatformConnection) {
+        // Transit connection edges should live on the lowest class level
+        // where a new node exists
+        auto f = find_nodes(old_to_new, base_node);
+        uint8_t lowest_level;
+        if (f.local_node.Is_Valid())
+          lowest_level = 2;
+        else if (f.arterial_node.Is_Valid())
+          lowest_level = 1;
+        else if (f.highway_node.Is_Valid())
+          lowest_level = 0;
+        else
+          throw std::logic_error("Could not find valid node level");
+        return (lowest_level == current_level);
+      } else if (directededge->bss_connection()) {
+        // Despite the road class, Bike Share Stations' connections are always at local level
+        return (2 == current_level);
+      } else {
+        return (TileHierarchy::get_level(directededge->classification()) == current_level);
       }
+    };
+
+    bool added = false;
+    std::hash<std::string> hasher;
+    GraphId tile_id;
+    while (scheduler.Next(worker, tile_id)) {
+      // New tilebuilder for the tile, set the base ll for it
+      const auto& range = new_tiles.at(tile_id);
+      uint8_t current_level = tile_id.level();
+      GraphTileBuilder tilebuilder(reader.tile_dir(), tile_id, false);
+      PointLL base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
+      tilebuilder.header_builder().set_base_ll(base_ll);
+
+      // Iterate through the new nodes of the tile
+      for (size_t n = range.first; n < range.second; ++n) {
+        const auto new_node = *new_to_old.at(n);
+        GraphId nodea = new_node.first;
+
+        // Get the node in the base level
+        GraphId base_node = new_node.second;
+        graph_tile_ptr tile = reader.GetGraphTile(base_node);
+        if (tile == nullptr) {
+          LOG_ERROR("Base tile is null? ");
+          continue;
+        }
 
-      // New tilebuilder for the next tile. Update current level.
-      tile_id = nodea.Tile_Base();
-      tilebuilder = new GraphTileBuilder(reader.tile_dir(), tile_id, false);
-      current_level = nodea.level();
+        // Copy the data version
+        tilebuilder.header_builder().set_dataset_id(tile->header()->dataset_id());
+
+        // Copy node information and set the node lat,lon offsets within the new tile
+        NodeInfo baseni = *(tile->node(base_node.id()));
+        tilebuilder.nodes().push_back(baseni);
+        const auto& admin = tile->admininfo(baseni.admin_index());
+        NodeInfo& node = tilebuilder.nodes().back();
+        node.set_latlng(base_ll, baseni.latlng(tile->header()->base_ll()));
+        node.set_edge_index(tilebuilder.directededges().size());
+        node.set_timezone(baseni.timezone());
+        node.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                                  admin.country_iso(), admin.state_iso()));
+
+        // Update node LL based on tile base
+        // Density at this node
+        uint32_t density1 = baseni.density();
+
+        // Current edge count
+        size_t edge_count = tilebuilder.directededges().size();
+
+        // Iterate through directed edges of the base node to get remaining
+        // directed edges (based on classification/importance cutoff)
+        GraphId base_edge_id(base_node.tileid(), base_node.level(), baseni.edge_index());
+        for (uint32_t i = 0; i < baseni.edge_count(); i++, ++base_edge_id) {
+          // Check if the directed edge should exist on this level
+          const DirectedEdge* directededge = tile->directededge(base_edge_id);
+          if (!include_edge(directededge, base_node, current_level)) {
+            continue;
+          }
 
-      // Set the base ll for this tile
-      base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
-      tilebuilder->header_builder().set_base_ll(base_ll);
+          // Copy the directed edge information
+          DirectedEdge newedge = *directededge;
+
+          // Set the end node for this edge. Transit connection edges
+          // remain connected to the same node on the transit level.
+          // Need to set nodeb for use in AddEdgeInfo
+          uint32_t density2 = 32;
+          GraphId nodeb;
+          if (directededge->use() == Use::kTransitConnection ||
+              directededge->use() == Use::kEgressConnection ||
+              directededge->use() == Use::kPlatformConnection) {
+            nodeb = directededge->endnode();
+          } else {
+            auto new_nodes = find_nodes(old_to_new, directededge->endnode());
+            if (current_level == 0) {
+              nodeb = new_nodes.highway_node;
+            } else if (current_level == 1) {
+              nodeb = new_nodes.arterial_node;
+            } else {
+              nodeb = new_nodes.local_node;
+            }
+            density2 = new_nodes.density;
+          }
+          if (!nodeb.Is_Valid()) {
+            LOG_ERROR("Invalid end node - not found in old_to_new map");
+          }
+          newedge.set_endnode(nodeb);
+
+          // Set the edge density  to the average of the relative density at the
+          // end nodes.
+          uint32_t edge_density = (density2 == 32) ? density1 : (density1 + density2) / 2;
+          newedge.set_density(edge_density);
+
+          // Set opposing edge indexes to 0 (gets set in graph validator).
+          newedge.set_opp_index(0);
+
+          // Get signs from the base directed edge
+          if (directededge->sign()) {
+            std::vector<SignInfo> signs = tile->GetSigns(base_edge_id.id());
+            if (signs.size() == 0) {
+              LOG_ERROR("Base edge should have signs, but none found");
+            }
+            tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
+          }
 
-      // Check if we need to clear the base/local tile cache
-      if (reader.OverCommitted()) {
-        reader.Trim();
-      }
-    }
+          // Get turn lanes from the base directed edge
+          if (directededge->turnlanes()) {
+            uint32_t offset = tile->turnlanes_offset(base_edge_id.id());
+            tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
+          }
 
-    // Get the node in the base level
-    GraphId base_node = (*new_node).second;
-    graph_tile_ptr tile = reader.GetGraphTile(base_node);
-    if (tile == nullptr) {
-      LOG_ERROR("Base tile is null? ");
-      continue;
-    }
+          // Get access restrictions from the base directed edge. Add these to
+          // the list of access restrictions in the new tile. Update the
+          // edge index in the restriction to be the current directed edge Id
+          if (directededge->access_restriction()) {
+            auto restrictions = tile->GetAccessRestrictions(base_edge_id.id(), kAllAccess);
+            for (const auto& res : restrictions) {
+              tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
+                                                                 res.type(), res.modes(),
+                                                                 res.value()));
+            }
+          }
 
-    // Copy the data version
-    tilebuilder->header_builder().set_dataset_id(tile->header()->dataset_id());
-
-    // Copy node information and set the node lat,lon offsets within the new tile
-    NodeInfo baseni = *(tile->node(base_node.id()));
-    tilebuilder->nodes().push_back(baseni);
-    const auto& admin = tile->admininfo(baseni.admin_index());
-    NodeInfo& node = tilebuilder->nodes().back();
-    node.set_latlng(base_ll, baseni.latlng(tile->header()->base_ll()));
-    node.set_edge_index(tilebuilder->directededges().size());
-    node.set_timezone(baseni.timezone());
-    node.set_admin_index(tilebuilder->AddAdmin(admin.country_text(), admin.state_text(),
-                                               admin.country_iso(), admin.state_iso()));
-
-    // Update node LL based on tile base
-    // Density at this node
-    uint32_t density1 = baseni.density();
-
-    // Current edge count
-    size_t edge_count = tilebuilder->directededges().size();
-
-    // Iterate through directed edges of the base node to get remaining
-    // directed edges (based on classification/importance cutoff)
-    GraphId base_edge_id(base_node.tileid(), base_node.level(), baseni.edge_index());
-    for (uint32_t i = 0; i < baseni.edge_count(); i++, ++base_edge_id) {
-      // Check if the directed edge should exist on this level
-      const DirectedEdge* directededge = tile->directededge(base_edge_id);
-      if (!include_edge(directededge, base_node, current_level)) {
-        continue;
-      }
+          // Copy lane connectivity
+          if (directededge->laneconnectivity()) {
+            auto laneconnectivity = tile->GetLaneConnectivity(base_edge_id.id());
+            if (laneconnectivity.size() == 0) {
+              LOG_ERROR("Base edge should have lane connectivity, but none found");
+            }
+            for (auto& lc : laneconnectivity) {
+              lc.set_to(tilebuilder.directededges().size());
+            }
+            tilebuilder.AddLaneConnectivity(laneconnectivity);
+          }
 
-      // Copy the directed edge information
-      DirectedEdge newedge = *directededge;
+          // Do we need to force adding edgeinfo (opposing edge could have diff names)?
+          // If end node is in the same tile and there is no opposing edge with matching
+          // edge_info_offset).
+          bool diff_names = directededge->endnode().tile_value() == base_edge_id.tile_value() &&
+                            !OpposingEdgeInfoMatches(tile, directededge);
+
+          // Get edge info, shape, and names from the old tile and add to the
+          // new. Cannot use edge info offset since edges in arterial and
+          // highway hierarchy can cross base tiles! Use a hash based on the
+          // encoded shape plus way Id.
+          auto edgeinfo = tile->edgeinfo(directededge);
+          std::string encoded_shape = edgeinfo.encoded_shape();
+          uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
+          uint32_t edge_info_offset =
+              tilebuilder.AddEdgeInfo(w, nodea, nodeb, edgeinfo.wayid(), edgeinfo.mean_elevation(),
+                                      edgeinfo.bike_network(), edgeinfo.speed_limit(),
+                                      encoded_shape, edgeinfo.GetNames(),
+                                      edgeinfo.GetTaggedValues(), edgeinfo.GetTaggedValues(true),
+                                      edgeinfo.GetTypes(), added, diff_names);
+
+          newedge.set_edgeinfo_offset(edge_info_offset);
+
+          // Add directed edge
+          tilebuilder.directededges().emplace_back(std::move(newedge));
+        }
 
-      // Set the end node for this edge. Transit connection edges
-      // remain connected to the same node on the transit level.
-      // Need to set nodeb for use in AddEdgeInfo
-      uint32_t density2 = 32;
-      GraphId nodeb;
-      if (directededge->use() == Use::kTransitConnection ||
-          directededge->use() == Use::kEgressConnection ||
-          directededge->use() == Use::kPlatformConnection) {
-        nodeb = directededge->endnode();
-      } else {
-        auto new_nodes = find_nodes(old_to_new, directededge->endnode());
+        // Add node transitions
+        uint32_t index = tilebuilder.transitions().size();
+        auto new_nodes = find_nodes(old_to_new, base_node);
         if (current_level == 0) {
-          nodeb = new_nodes.highway_node;
+          AddDownwardTransition(new_nodes.arterial_node, &tilebuilder);
+          AddDownwardTransition(new_nodes.local_node, &tilebuilder);
         } else if (current_level == 1) {
-          nodeb = new_nodes.arterial_node;
+          AddUpwardTransition(new_nodes.highway_node, &tilebuilder);
+          AddDownwardTransition(new_nodes.local_node, &tilebuilder);
+        } else if (current_level == 2) {
+          AddUpwardTransition(new_nodes.highway_node, &tilebuilder);
+          AddUpwardTransition(new_nodes.arterial_node, &tilebuilder);
         } else {
-          nodeb = new_nodes.local_node;
+          throw std::logic_error("current_level was never set");
         }
-        density2 = new_nodes.density;
-      }
-      if (!nodeb.Is_Valid()) {
-        LOG_ERROR("Invalid end node - not found in old_to_new map");
-      }
-      newedge.set_endnode(nodeb);
-
-      // Set the edge density  to the average of the relative density at the
-      // end nodes.
-      uint32_t edge_density = (density2 == 32) ? density1 : (density1 + density2) / 2;
-      newedge.set_density(edge_density);
 
-      // Set opposing edge indexes to 0 (gets set in graph validator).
-      newedge.set_opp_index(0);
-
-      // Get signs from the base directed edge
-      if (directededge->sign()) {
-        std::vector<SignInfo> signs = tile->GetSigns(base_edge_id.id());
-        if (signs.size() == 0) {
-          LOG_ERROR("Base edge should have signs, but none found");
+        // Set the node transition count and index
+        uint32_t count = tilebuilder.transitions().size() - index;
+        if (count > 0) {
+          node.set_transition_count(count);
+          node.set_transition_index(index);
         }
-        tilebuilder->AddSigns(tilebuilder->directededges().size(), signs);
-      }
 
-      // Get turn lanes from the base directed edge
-      if (directededge->turnlanes()) {
-        uint32_t offset = tile->turnlanes_offset(base_edge_id.id());
-        tilebuilder->AddTurnLanes(tilebuilder->directededges().size(), tile->GetName(offset));
-      }
+        // Set the edge count for the new node
+        node.set_edge_count(tilebuilder.directededges().size() - edge_count);
 
-      // Get access restrictions from the base directed edge. Add these to
-      // the list of access restrictions in the new tile. Update the
-      // edge index in the restriction to be the current directed edge Id
-      if (directededge->access_restriction()) {
-        auto restrictions = tile->GetAccessRestrictions(base_edge_id.id(), kAllAccess);
-        for (const auto& res : restrictions) {
-          tilebuilder->AddAccessRestriction(AccessRestriction(tilebuilder->directededges().size(),
-                                                              res.type(), res.modes(), res.value()));
+        // Get named signs from the base node
+        if (baseni.named_intersection()) {
+          std::vector<SignInfo> signs = tile->GetSigns(base_node.id(), true);
+          if (signs.size() == 0) {
+            LOG_ERROR("Base node should have signs, but none found");
+          }
+          node.set_named_intersection(true);
+          tilebuilder.AddSigns(tilebuilder.nodes().size() - 1, signs);
         }
       }
+      tilebuilder.StoreTileData();
 
-      // Copy lane connectivity
-      if (directededge->laneconnectivity()) {
-        auto laneconnectivity = tile->GetLaneConnectivity(base_edge_id.id());
-        if (laneconnectivity.size() == 0) {
-          LOG_ERROR("Base edge should have lane connectivity, but none found");
-        }
-        for (auto& lc : laneconnectivity) {
-          lc.set_to(tilebuilder->directededges().size());
-        }
-        tilebuilder->AddLaneConnectivity(laneconnectivity);
+      // Check if we need to clear the base/local tile cache
+      if (reader.OverCommitted()) {
+        reader.Trim();
       }
-
-      // Do we need to force adding edgeinfo (opposing edge could have diff names)?
-      // If end node is in the same tile and there is no opposing edge with matching
-      // edge_info_offset).
-      bool diff_names = directededge->endnode().tile_value() == base_edge_id.tile_value() &&
-                        !OpposingEdgeInfoMatches(tile, directededge);
-
-      // Get edge info, shape, and names from the old tile and add to the
-      // new. Cannot use edge info offset since edges in arterial and
-      // highway hierarchy can cross base tiles! Use a hash based on the
-      // encoded shape plus way Id.
-      auto edgeinfo = tile->edgeinfo(directededge);
-      std::string encoded_shape = edgeinfo.encoded_shape();
-      uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
-      uint32_t edge_info_offset =
-          tilebuilder->AddEdgeInfo(w, nodea, nodeb, edgeinfo.wayid(), edgeinfo.mean_elevation(),
-                                   edgeinfo.bike_network(), edgeinfo.speed_limit(), encoded_shape,
-                                   edgeinfo.GetNames(), edgeinfo.GetTaggedValues(),
-                                   edgeinfo.GetTaggedValues(true), edgeinfo.GetTypes(), added,
-                                   diff_names);
-
-      newedge.set_edgeinfo_offset(edge_info_offset);
-
-      // Add directed edge
-      tilebuilder->directededges().emplace_back(std::move(newedge));
     }
+    result.set_value();
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
 
-    // Add node transitions
-    uint32_t index = tilebuilder->transitions().size();
-    auto new_nodes = find_nodes(old_to_new, base_node);
-    if (current_level == 0) {
-      AddDownwardTransition(new_nodes.arterial_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
-    } else if (current_level == 1) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
-    } else if (current_level == 2) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddUpwardTransition(new_nodes.arterial_node, tilebuilder);
-    } else {
-      throw std::logic_error("current_level was never set");
-    }
+// The levels a base node exists on, with the tiles it goes in on the highway and arterial
+// levels. Found for the base tiles in parallel, before the new node ids are handed out.
+struct NodeLevels {
+  GraphId highway_tile;  // Tile on the highway level, invalid if not on it
+  GraphId arterial_tile; // Tile on the arterial level, invalid if not on it
+  bool local;            // Whether the node is on the local level
+  uint32_t density;      // Density at the node (for edge density)
+};
 
-    // Set the node transition count and index
-    uint32_t count = tilebuilder->transitions().size() - index;
-    if (count > 0) {
-      node.set_transition_count(count);
-      node.set_transition_index(index);
-    }
+// Find the levels of the nodes in a base tile
+std::vector<NodeLevels> FindNodeLevels(GraphReader& reader, const GraphId& base_tile_id) {
+  // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
+  std::vector<NodeLevels> nodes;
+  graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
+  if (!tile) {
+    return nodes;
+  }
 
-    // Set the edge count for the new node
-    node.set_edge_count(tilebuilder->directededges().size() - edge_count);
+  // Hierarchy level information
+  const auto& arterial_level = TileHierarchy::levels()[1];
+  uint32_t al = static_cast<uint32_t>(arterial_level.level);
+  const auto& highway_level = TileHierarchy::levels()[0];
+  uint32_t hl = static_cast<uint32_t>(highway_level.level);
 
-    // Get named signs from the base node
-    if (baseni.named_intersection()) {
-      std::vector<SignInfo> signs = tile->GetSigns(base_node.id(), true);
-      if (signs.size() == 0) {
-        LOG_ERROR("Base node should have signs, but none found");
+  // Iterate through the nodes. Add nodes to the new level when
+  // best road class <= the new level classification cutoff
+  bool levels[3];
+  uint32_t nodecount = tile->header()->nodecount();
+  nodes.reserve(nodecount);
+  GraphId basenode = base_tile_id;
+  GraphId edgeid = base_tile_id;
+  PointLL base_ll = tile->header()->base_ll();
+  const NodeInfo* nodeinfo = tile->node(basenode);
+  for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
+    // Iterate through the edges to see which levels this node exists.
+    levels[0] = levels[1] = levels[2] = false;
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
+      // Update the flag for the level of this edge (skip transit
+      // connection edges)
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      if (directededge->bss_connection()) {
+        // Despite the road class, Bike Share Stations' connections are always at local level
+        levels[2] = true;
+      } else if (directededge->use() != Use::kTransitConnection &&
+                 directededge->use() != Use::kEgressConnection &&
+                 directededge->use() != Use::kPlatformConnection) {
+        levels[TileHierarchy::get_level(directededge->classification())] = true;
       }
-      node.set_named_intersection(true);
-      tilebuilder->AddSigns(tilebuilder->nodes().size() - 1, signs);
     }
+
+    NodeLevels node{{}, {}, levels[2], nodeinfo->density()};
+    if (levels[0]) {
+      node.highway_tile = GraphId(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
+    }
+    if (levels[1]) {
+      node.arterial_tile = GraphId(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
+    }
+    if (!levels[0] && !levels[1] && !levels[2]) {
+      LOG_ERROR("No valid level for this node!");
+    }
+    nodes.push_back(node);
   }
 
-  // Delete the tile builder
-  if (tilebuilder != nullptr) {
-    tilebuilder->StoreTileData();
-    delete tilebuilder;
+  // Check if we need to clear the tile cache
+  if (reader.OverCommitted()) {
+    reader.Trim();
   }
+  return nodes;
 }
 
 /**
@@ -380,11 +461,14 @@ void FormTilesInNewLevel(GraphReader& reader,
  * hierarchy levels and the existing nodes on the base/local level. The
  * associations go both ways: from the "old" nodes on the base/local level
  * to new nodes (using a mapping in memory) and from new nodes to old nodes
- * using a sequence (file).
+ * using a sequence (file). The levels of the nodes are found on multiple
+ * threads a batch of base tiles at a time, the new node ids are handed out
+ * in tile order afterwards so they do not depend on the threading.
  */
-void CreateNodeAssociations(GraphReader& reader,
+void CreateNodeAssociations(const boost::property_tree::ptree& hierarchy_properties,
                             const std::string& new_to_old_file,
-                            const std::string& old_to_new_file) {
+                            const std::string& old_to_new_file,
+                            size_t thread_count) {
   // Map of tiles vs. count of nodes. Used to construct new node Ids.
   std::unordered_map<GraphId, uint32_t> new_nodes;
 
@@ -408,84 +492,77 @@ void CreateNodeAssociations(GraphReader& reader,
   // Create a sequence to associate new nodes to old nodes
   sequence<OldToNewNodes> old_to_new(old_to_new_file, true);
 
-  // Hierarchy level information
-  const auto& arterial_level = TileHierarchy::levels()[1];
-  uint32_t al = static_cast<uint32_t>(arterial_level.level);
-  const auto& highway_level = TileHierarchy::levels()[0];
-  uint32_t hl = static_cast<uint32_t>(highway_level.level);
-
-  // Iterate through all tiles in the local level
-  auto local_tiles = reader.GetTileSet();
-  for (const auto& base_tile_id : local_tiles) {
-    // We keep all transit data inside the transit hierarchy
-    if (base_tile_id.level() == TileHierarchy::GetTransitLevel().level) {
-      continue;
-    }
+  // A graphreader per thread, they keep their caches from batch to batch
+  std::vector<std::unique_ptr<GraphReader>> readers;
+  for (size_t i = 0; i < thread_count; ++i) {
+    readers.emplace_back(new GraphReader(hierarchy_properties));
+  }
 
-    // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
-    graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
-    if (!tile) {
-      continue;
+  // Iterate through all tiles in the local level. We keep all transit data
+  // inside the transit hierarchy
+  std::vector<GraphId> local_tiles;
+  for (const auto& base_tile_id : readers.front()->GetTileSet()) {
+    if (base_tile_id.level() != TileHierarchy::GetTransitLevel().level) {
+      local_tiles.push_back(base_tile_id);
     }
-
-    // Iterate through the nodes. Add nodes to the new level when
-    // best road class <= the new level classification cutoff
-    bool levels[3];
-    uint32_t nodecount = tile->header()->nodecount();
-    GraphId basenode = base_tile_id;
-    GraphId edgeid = base_tile_id;
-    PointLL base_ll = tile->header()->base_ll();
-    const NodeInfo* nodeinfo = tile->node(basenode);
-    for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
-      // Iterate through the edges to see which levels this node exists.
-      levels[0] = levels[1] = levels[2] = false;
-      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
-        // Update the flag for the level of this edge (skip transit
-        // connection edges)
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        if (directededge->bss_connection()) {
-          // Despite the road class, Bike Share Stations' connections are always at local level
-          levels[2] = true;
-        } else if (directededge->use() != Use::kTransitConnection &&
-                   directededge->use() != Use::kEgressConnection &&
-                   directededge->use() != Use::kPlatformConnection) {
-          levels[TileHierarchy::get_level(directededge->classification())] = true;
+  }
+  const size_t batch_size = thread_count * 16;
+  std::vector<std::vector<NodeLevels>> batch;
+  for (size_t start = 0; start < local_tiles.size(); start += batch_size) {
+    // Find the levels of the nodes in the tiles of the batch
+    const size_t end = std::min(start + batch_size, local_tiles.size());
+    batch.assign(end - start, {});
+    std::atomic<size_t> next(start);
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t]() {
+        try {
+          for (size_t i = next++; i < end; i = next++) {
+            batch[i - start] = FindNodeLevels(*readers[t], local_tiles[i]);
+          }
+        } catch (...) {
+          errors[t] = std::current_exception();
+          next = end;
         }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
       }
+    }
 
-      // Associate new nodes to base nodes and base node to new nodes
-      GraphId highway_node, arterial_node, local_node;
-      if (levels[0]) {
-        // New node is on the highway level. Associate back to base/local node
-        GraphId new_tile(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
-        highway_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(highway_node, basenode));
-      }
-      if (levels[1]) {
-        // New node is on the arterial level. Associate back to base/local node
-        GraphId new_tile(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
-        arterial_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(arterial_node, basenode));
-      }
-      if (levels[2]) {
-        // New node is on the local level. Associate back to base/local node
-        local_node = get_new_node(base_tile_id);
-        new_to_old.push_back(std::make_pair(local_node, basenode));
-      }
+    // Associate new nodes to base nodes and base node to new nodes
+    for (size_t i = start; i < end; ++i) {
+      GraphId basenode = local_tiles[i];
+      for (const auto& node : batch[i - start]) {
+        GraphId highway_node, arterial_node, local_node;
+        if (node.highway_tile.Is_Valid()) {
+          // New node is on the highway level. Associate back to base/local node
+          highway_node = get_new_node(node.highway_tile);
+          new_to_old.push_back(std::make_pair(highway_node, basenode));
+        }
+        if (node.arterial_tile.Is_Valid()) {
+          // New node is on the arterial level. Associate back to base/local node
+          arterial_node = get_new_node(node.arterial_tile);
+          new_to_old.push_back(std::make_pair(arterial_node, basenode));
+        }
+        if (node.local) {
+          // New node is on the local level. Associate back to base/local node
+          local_node = get_new_node(local_tiles[i]);
+          new_to_old.push_back(std::make_pair(local_node, basenode));
+        }
 
-      if (!levels[0] && !levels[1] && !levels[2]) {
-        LOG_ERROR("No valid level for this node!");
+        // Associate the old node to the new node(s). Entries in the tuple
+        // that are invalid nodes indicate no node exists in the new level.
+        OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, node.density);
+        old_to_new.push_back(assoc);
+        ++basenode;
       }
-
-      // Associate the old node to the new node(s). Entries in the tuple
-      // that are invalid nodes indicate no node exists in the new level.
-      OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, nodeinfo->density());
-      old_to_new.push_back(assoc);
-    }
-
-    // Check if we need to clear the tile cache
-    if (reader.OverCommitted()) {
-      reader.Trim();
     }
   }
 }
@@ -585,30 +662,72 @@ namespace mjolnir {
 void HierarchyBuilder::Build(const boost::property_tree::ptree& pt,
                              const std::string& new_to_old_file,
                              const std::string& old_to_new_file) {
-
-  // TODO: thread this. Might be more possible now that we don't create
-  // shortcuts in the HierarchyBuilder
-
   // Construct GraphReader
   LOG_INFO("HierarchyBuilder");
-  GraphReader reader(pt.get_child("mjolnir"));
+  auto hierarchy_properties = pt.get_child("mjolnir");
+  GraphReader reader(hierarchy_properties);
+
+  // A place to hold worker threads and their results, exceptions or otherwise
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
 
   // Association of old nodes to new nodes
-  CreateNodeAssociations(reader, new_to_old_file, old_to_new_file);
+  CreateNodeAssociations(hierarchy_properties, new_to_old_file, old_to_new_file, threads.size());
 
   // Sort the sequences
-  SortSequences(new_to_old_file, old_to_new_file);
+  SortSequences(new_to_old_file, old_to_new_file, threads.size());
+
+  // The range of the new nodes that goes in each new tile
+  std::unordered_map<GraphId, NodeRange> new_tiles;
+  std::vector<GraphId> upper_tiles, local_tiles;
+  {
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    size_t n = 0;
+    for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); ++new_node, ++n) {
+      GraphId tile_id = (*new_node).first.Tile_Base();
+      auto inserted = new_tiles.emplace(tile_id, NodeRange{n, n});
+      if (inserted.second) {
+        (tile_id.level() == TileHierarchy::levels().back().level ? local_tiles : upper_tiles)
+            .push_back(tile_id);
+      }
+      inserted.first->second.second = n + 1;
+    }
+  }
 
-  // Iterate through the hierarchy (from highway down to local) and build
-  // new tiles
-  FormTilesInNewLevel(reader, new_to_old_file, old_to_new_file);
+  // Iterate through the hierarchy (from highway down to local) and build new tiles. The
+  // highway and arterial tiles are done first since they read the base tiles the local
+  // tiles are written over
+  auto cost = [&new_tiles](const GraphId& tile_id) {
+    const auto& range = new_tiles.at(tile_id);
+    return static_cast<uint64_t>(range.second - range.first);
+  };
+  for (const auto* tiles : {&upper_tiles, &local_tiles}) {
+    std::list<std::promise<void>> results;
+    TileScheduler scheduler("Forming hierarchy", *tiles, threads.size(), cost);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      results.emplace_back();
+      threads[i].reset(new std::thread(FormTilesInNewLevel, std::cref(hierarchy_properties),
+                                       std::cref(new_to_old_file), std::cref(old_to_new_file),
+                                       std::cref(new_tiles), std::ref(scheduler), i,
+                                       std::ref(results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    scheduler.LogUtilization();
+
+    // If something bad went down this will rethrow it
+    for (auto& result : results) {
+      result.get_future().get();
+    }
+  }
 
   // Remove any base tiles that no longer have any data (nodes and edges
   // only exist on arterial and highway levels)
   RemoveUnusedLocalTiles(reader.tile_dir(), old_to_new_file);
 
   // Update the end nodes to all transit connections in the transit hierarchy
-  auto hierarchy_properties = pt.get_child("mjolnir");
   auto transit_dir = hierarchy_properties.get_optional<std::string>("transit_dir");
   if (transit_dir && filesystem::exists(*transit_dir) && filesystem::is_directory(*transit_dir)) {
     UpdateTransitConnections(reader, old_to_new_file);
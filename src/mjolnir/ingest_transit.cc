@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <future>
@@ -11,6 +15,7 @@
 #include <sstream>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -34,6 +39,7 @@
 #include "just_gtfs/just_gtfs.h"
 #include "midgard/util.h"
 #include "mjolnir/admin.h"
+#include "mjolnir/gtfs_stop_times.h"
 #include "mjolnir/ingest_transit.h"
 #include "mjolnir/servicedays.h"
 #include "mjolnir/util.h"
@@ -78,7 +84,6 @@ struct tile_transit_info_t {
   //  platform/egress (child) (Max 2 kinds / many could exists)
   std::unordered_multimap<feed_object_t, gtfs::Id> station_children;
   std::unordered_set<feed_object_t> stations;
-  std::unordered_set<feed_object_t> trips;
   std::unordered_map<feed_object_t, size_t> routes;
   std::unordered_map<feed_object_t, size_t> shapes;
 
@@ -88,22 +93,144 @@ struct tile_transit_info_t {
   }
 };
 
+// every feed without its stop times, loaded once and shared read only by the tile threads
 struct feed_cache_t {
   std::unordered_map<std::string, gtfs::Feed> cache;
-  std::string gtfs_dir;
 
-  feed_cache_t(const std::string& gtfs_dir) : gtfs_dir(gtfs_dir) {
+  const gtfs::Feed& operator()(const feed_object_t& feed_object) const {
+    return cache.at(feed_object.feed);
+  }
+};
+
+// stop_times.txt is spilled in buckets of about this many bytes, each holding whole trips
+constexpr uint64_t kStopTimesBucketSize = 64 * 1024 * 1024;
+
+// stop times are handed over from the parsing threads in batches of this many
+constexpr size_t kStopTimesBatchSize = 64 * 1024;
+
+// the stop time pairs a thread buffers before appending them to the files of their tiles
+constexpr size_t kSpillBufferSize = 16 * 1024 * 1024;
+
+// appends a string with its length to a buffer
+void append_string(const std::string& value, std::string& out) {
+  const auto size = static_cast<uint32_t>(value.size());
+  out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.append(value);
+}
+
+// reads a string with its length from a buffer
+std::string read_string(const char*& pos) {
+  uint32_t size;
+  std::memcpy(&size, pos, sizeof(size));
+  pos += sizeof(size);
+  std::string value(pos, size);
+  pos += size;
+  return value;
+}
+
+// stop times are spilled to their buckets as plain bytes, they only live until their trips are
+// paired up
+void append_stop_time(const GtfsStopTime& stop_time, std::string& out) {
+  append_string(stop_time.trip_id, out);
+  append_string(stop_time.stop_id, out);
+  out.append(reinterpret_cast<const char*>(&stop_time.stop_sequence),
+             sizeof(stop_time.stop_sequence));
+  out.append(reinterpret_cast<const char*>(&stop_time.arrival_time),
+             sizeof(stop_time.arrival_time));
+  out.append(reinterpret_cast<const char*>(&stop_time.departure_time),
+             sizeof(stop_time.departure_time));
+  out.append(reinterpret_cast<const char*>(&stop_time.shape_dist_traveled),
+             sizeof(stop_time.shape_dist_traveled));
+}
+
+std::vector<GtfsStopTime> read_stop_times(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::in | std::ios::binary);
+  std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::vector<GtfsStopTime> stop_times;
+  for (const char* pos = buffer.data(); pos < buffer.data() + buffer.size();) {
+    GtfsStopTime stop_time;
+    stop_time.trip_id = read_string(pos);
+    stop_time.stop_id = read_string(pos);
+    std::memcpy(&stop_time.stop_sequence, pos, sizeof(stop_time.stop_sequence));
+    pos += sizeof(stop_time.stop_sequence);
+    std::memcpy(&stop_time.arrival_time, pos, sizeof(stop_time.arrival_time));
+    pos += sizeof(stop_time.arrival_time);
+    std::memcpy(&stop_time.departure_time, pos, sizeof(stop_time.departure_time));
+    pos += sizeof(stop_time.departure_time);
+    std::memcpy(&stop_time.shape_dist_traveled, pos, sizeof(stop_time.shape_dist_traveled));
+    pos += sizeof(stop_time.shape_dist_traveled);
+    stop_times.emplace_back(std::move(stop_time));
+  }
+  return stop_times;
+}
+
+// appends to the temporary files of the tiles, every file holds length delimited StopTimePairs
+struct pair_spill_t {
+  std::string dir;
+  std::array<std::mutex, 64> locks;
+
+  explicit pair_spill_t(const std::string& dir) : dir(dir) {
+  }
+
+  std::string path(const GraphId& tile_id) const {
+    return dir + std::to_string(tile_id.tileid()) + ".pairs";
   }
 
-  const gtfs::Feed& operator()(const feed_object_t& feed_object) {
-    auto found = cache.find(feed_object.feed);
-    if (found != cache.end()) {
-      return found->second;
+  void append(const GraphId& tile_id, const std::string& bytes) {
+    std::lock_guard<std::mutex> lock(locks[tile_id.tileid() % locks.size()]);
+    std::ofstream file(path(tile_id), std::ios::out | std::ios::binary | std::ios::app);
+    file.write(bytes.data(), bytes.size());
+  }
+
+  // buffers the pairs of one thread until enough of them are collected
+  struct buffer_t {
+    pair_spill_t& spill;
+    std::unordered_map<GraphId, std::string> tiles;
+    size_t size = 0;
+
+    void add(const GraphId& tile_id, const std::string& pair) {
+      auto& bytes = tiles[tile_id];
+      uint32_t length = pair.size();
+      for (; length >= 0x80; length >>= 7) {
+        bytes.push_back(static_cast<char>(length | 0x80));
+      }
+      bytes.push_back(static_cast<char>(length));
+      bytes.append(pair);
+      size += pair.size() + 5;
+      if (size >= kSpillBufferSize) {
+        flush();
+      }
+    }
+
+    void flush() {
+      for (const auto& tile : tiles) {
+        spill.append(tile.first, tile.second);
+      }
+      tiles.clear();
+      size = 0;
     }
+  };
 
-    auto inserted = cache.insert({feed_object.feed, gtfs::Feed(gtfs_dir + feed_object.feed)});
-    inserted.first->second.read_feed();
-    return inserted.first->second;
+  std::vector<StopTimePair> read(const GraphId& tile_id) const {
+    std::ifstream file(path(tile_id), std::ios::in | std::ios::binary);
+    std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<StopTimePair> pairs;
+    for (size_t pos = 0; pos < buffer.size();) {
+      uint32_t length = 0;
+      for (uint32_t shift = 0; pos < buffer.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(buffer[pos++]);
+        length |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+          break;
+        }
+      }
+      pairs.emplace_back();
+      if (!pairs.back().ParseFromArray(buffer.data() + pos, length)) {
+        throw std::runtime_error("Couldn't load " + path(tile_id));
+      }
+      pos += length;
+    }
+    return pairs;
   }
 };
 
@@ -150,8 +277,184 @@ std::string get_onestop_id_base(const std::string& stop_id, const std::string& f
   return feed_name + "_" + stop_id;
 }
 
-// Read from GTFS feed, sort data into the unique tiles they belong to
-std::priority_queue<tile_transit_info_t> select_transit_tiles(const std::string& gtfs_path) {
+// Mirrors a feed into a directory with only the header line of its stop_times.txt, so that the feed
+// can be loaded without its biggest file. The stop times are streamed from the original instead
+std::string make_feed_view(const filesystem::path& feed_path, const std::string& view_dir) {
+  filesystem::create_directories(view_dir);
+  filesystem::directory_iterator file_itr(feed_path);
+  filesystem::directory_iterator end_file_itr;
+  for (; file_itr != end_file_itr; ++file_itr) {
+    const auto& file_path = file_itr->path();
+    if (!filesystem::is_regular_file(file_path)) {
+      continue;
+    }
+    const auto file_name = file_path.filename().string();
+    std::ifstream in(file_path.string(), std::ios::in | std::ios::binary);
+    std::ofstream out(view_dir + file_name, std::ios::out | std::ios::binary);
+    if (file_name == "stop_times.txt") {
+      std::string header;
+      std::getline(in, header);
+      out << header << '\n';
+    } else if (in.peek() != std::ifstream::traits_type::eof()) {
+      out << in.rdbuf();
+    }
+  }
+  return view_dir;
+}
+
+// Streams the stop times of a feed into buckets of whole trips, then sorts each bucket by trip and
+// stop sequence to pair up consecutive stops. Every pair goes to the spill files of the tiles of
+// its stops and the routes and shapes of its trip are added to those tiles
+void pair_stop_times(const std::string& stop_times_file,
+                     const std::string& feed_name,
+                     const gtfs::Feed& feed,
+                     const std::unordered_map<gtfs::Id, GraphId>& stop_tiles,
+                     const std::string& bucket_dir,
+                     const unsigned int thread_count,
+                     pair_spill_t& spill,
+                     std::unordered_map<GraphId, tile_transit_info_t>& tile_map) {
+  std::ifstream file(stop_times_file, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file) {
+    LOG_ERROR("Feed " + feed_name + " has no stop_times.txt, skipping its trips...");
+    return;
+  }
+  const uint64_t size = file.tellg();
+  file.close();
+
+  // hash the trips into buckets on disk so that each bucket can be paired up on its own
+  const size_t bucket_count =
+      std::max(static_cast<size_t>(thread_count), static_cast<size_t>(size / kStopTimesBucketSize));
+  const auto bucket_path = [&bucket_dir](const size_t bucket) {
+    return bucket_dir + std::to_string(bucket) + ".stop_times";
+  };
+  filesystem::create_directories(bucket_dir);
+  std::vector<std::mutex> bucket_locks(bucket_count);
+  const auto stop_time_count =
+      read_gtfs_stop_times(stop_times_file, thread_count, kStopTimesBatchSize,
+                           [&](std::vector<GtfsStopTime>& batch) {
+                             std::vector<std::string> buckets(bucket_count);
+                             for (const auto& stop_time : batch) {
+                               const auto bucket =
+                                   std::hash<std::string>()(stop_time.trip_id) % bucket_count;
+                               append_stop_time(stop_time, buckets[bucket]);
+                             }
+                             for (size_t i = 0; i < bucket_count; ++i) {
+                               if (buckets[i].empty()) {
+                                 continue;
+                               }
+                               std::lock_guard<std::mutex> lock(bucket_locks[i]);
+                               std::ofstream out(bucket_path(i), std::ios::out | std::ios::binary |
+                                                                     std::ios::app);
+                               out.write(buckets[i].data(), buckets[i].size());
+                             }
+                           });
+  LOG_INFO("Spilled " + std::to_string(stop_time_count) + " stop times of " + feed_name + " into " +
+           std::to_string(bucket_count) + " buckets");
+
+  // pair up the stops of the trips, bucket by bucket
+  std::atomic<size_t> next_bucket(0);
+  std::mutex tile_lock;
+  const auto pair_buckets = [&]() {
+    struct tile_refs_t {
+      std::unordered_set<gtfs::Id> routes;
+      std::unordered_set<gtfs::Id> shapes;
+    };
+    std::unordered_map<GraphId, tile_refs_t> refs;
+    pair_spill_t::buffer_t buffer{spill};
+    StopTimePair pair;
+    for (size_t bucket = next_bucket++; bucket < bucket_count; bucket = next_bucket++) {
+      auto stop_times = read_stop_times(bucket_path(bucket));
+      filesystem::remove(bucket_path(bucket));
+      std::sort(stop_times.begin(), stop_times.end(),
+                [](const GtfsStopTime& a, const GtfsStopTime& b) {
+                  return std::tie(a.trip_id, a.stop_sequence) <
+                         std::tie(b.trip_id, b.stop_sequence);
+                });
+
+      for (auto begin = stop_times.cbegin(); begin != stop_times.cend();) {
+        const auto end = std::find_if(begin, stop_times.cend(), [&begin](const GtfsStopTime& st) {
+          return st.trip_id != begin->trip_id;
+        });
+
+        // add trip, route, agency and service_id from stop_time, it's the only place with that info
+        // TODO: should we throw here?
+        const auto& trip = feed.get_trip(begin->trip_id);
+        const auto& route = feed.get_route(trip.route_id);
+        if (!gtfs::valid(trip) || !gtfs::valid(route) || trip.service_id.empty()) {
+          LOG_ERROR("Missing trip or route or service_id for trip");
+          begin = end;
+          continue;
+        }
+
+        for (auto stop_time = begin; stop_time != end; ++stop_time) {
+          const auto origin_tile = stop_tiles.find(stop_time->stop_id);
+          if (origin_tile != stop_tiles.cend()) {
+            auto& tile_refs = refs[origin_tile->second];
+            tile_refs.routes.insert(route.route_id);
+            // shapes are optional, don't keep non-existing shapes around
+            if (!trip.shape_id.empty()) {
+              tile_refs.shapes.insert(trip.shape_id);
+            }
+          }
+
+          const auto dest_stop_time = std::next(stop_time);
+          if (dest_stop_time == end) {
+            break;
+          }
+          const auto dest_tile = stop_tiles.find(dest_stop_time->stop_id);
+          pair.set_feed(feed_name);
+          pair.set_trip_id(trip.trip_id);
+          pair.set_stop_sequence(stop_time->stop_sequence);
+          pair.set_origin_stop_id(stop_time->stop_id);
+          pair.set_origin_departure_time(stop_time->departure_time);
+          pair.set_origin_dist_traveled(stop_time->shape_dist_traveled);
+          pair.set_destination_stop_id(dest_stop_time->stop_id);
+          pair.set_destination_arrival_time(dest_stop_time->arrival_time);
+          pair.set_destination_dist_traveled(dest_stop_time->shape_dist_traveled);
+          const auto bytes = pair.SerializeAsString();
+          if (origin_tile != stop_tiles.cend()) {
+            buffer.add(origin_tile->second, bytes);
+          }
+          if (dest_tile != stop_tiles.cend() &&
+              (origin_tile == stop_tiles.cend() || origin_tile->second != dest_tile->second)) {
+            buffer.add(dest_tile->second, bytes);
+          }
+        }
+        begin = end;
+      }
+    }
+    buffer.flush();
+
+    std::lock_guard<std::mutex> lock(tile_lock);
+    for (const auto& tile_refs : refs) {
+      auto& tile_info = tile_map.at(tile_refs.first);
+      for (const auto& route_id : tile_refs.second.routes) {
+        tile_info.routes.insert({{route_id, feed_name}, tile_info.routes.size()});
+      }
+      for (const auto& shape_id : tile_refs.second.shapes) {
+        tile_info.shapes.insert({{shape_id, feed_name}, tile_info.shapes.size()});
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < std::max(1u, thread_count); ++i) {
+    threads.emplace_back(pair_buckets);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  filesystem::remove_all(bucket_dir);
+}
+
+// Read from GTFS feed, sort data into the unique tiles they belong to. The feeds are loaded once
+// without their stop times into the cache, the stop times are streamed and paired up into the
+// spill files of the tiles instead of being held in memory all at once
+std::priority_queue<tile_transit_info_t> select_transit_tiles(const std::string& gtfs_path,
+                                                              const std::string& scratch_dir,
+                                                              const unsigned int thread_count,
+                                                              feed_cache_t& feeds,
+                                                              pair_spill_t& spill) {
 
   std::set<GraphId> tiles;
   const auto& local_tiles = TileHierarchy::levels().back().tiles;
@@ -175,7 +478,11 @@ std::priority_queue<tile_transit_info_t> select_transit_tiles(const std::string&
       const auto feed_name = feed_path.filename().string();
 
       LOG_INFO("Loading " + feed_name);
-      gtfs::Feed feed(feed_path.string());
+      const auto view_dir = make_feed_view(feed_path, scratch_dir + "feeds" +
+                                                          filesystem::path::preferred_separator +
+                                                          feed_name +
+                                                          filesystem::path::preferred_separator);
+      auto& feed = feeds.cache.emplace(feed_name, gtfs::Feed(view_dir)).first->second;
       feed.read_feed();
       LOG_INFO("Done loading, now parsing " + feed_name);
 
@@ -189,6 +496,7 @@ std::priority_queue<tile_transit_info_t> select_transit_tiles(const std::string&
       }
 
       // 2nd pass to add the platforms/stops
+      std::unordered_map<gtfs::Id, GraphId> stop_tiles;
       for (const auto& stop : stops) {
         // TODO: GenericNode & BoardingArea could be useful at some point
         if (!(stop.location_type == gtfs::StopLocationType::StopOrPlatform) &&
@@ -197,6 +505,7 @@ std::priority_queue<tile_transit_info_t> select_transit_tiles(const std::string&
         }
 
         auto& tile_info = get_tile_info(stop);
+        stop_tiles.emplace(stop.stop_id, tile_info.graphid);
 
         // if this station doesn't exist, we need to create it: we use the fact that this entry is
         // not a station type to fake a station object in write_stops()
@@ -218,27 +527,15 @@ std::priority_queue<tile_transit_info_t> select_transit_tiles(const std::string&
           tile_info.stations.insert({stop.stop_id, feed_name});
           tile_info.station_children.insert({{stop.stop_id, feed_name}, stop.stop_id});
         }
-
-        for (const auto& stopTime : feed.get_stop_times_for_stop(stop.stop_id)) {
-          // add trip, route, agency and service_id from stop_time, it's the only place with that info
-          // TODO: should we throw here?
-          auto trip = feed.get_trip(stopTime.trip_id);
-          auto route = feed.get_route(trip.route_id);
-          if (!gtfs::valid(trip) || !gtfs::valid(route) || trip.service_id.empty()) {
-            LOG_ERROR("Missing trip or route or service_id for trip");
-            continue;
-          }
-
-          tile_info.trips.insert({trip.trip_id, feed_name});
-          tile_info.routes.insert({{route.route_id, feed_name}, tile_info.routes.size()});
-
-          // shapes are optional, don't keep non-existing shapes around
-          if (!trip.shape_id.empty()) {
-            tile_info.shapes.insert({{trip.shape_id, feed_name}, tile_info.shapes.size()});
-          }
-        }
       }
 
+      // the stop times are the only place with the trips, routes and shapes of the stops
+      auto stop_times_path = feed_path;
+      stop_times_path /= "stop_times.txt";
+      pair_stop_times(stop_times_path.string(), feed_name, feed, stop_tiles,
+                      scratch_dir + "buckets" + filesystem::path::preferred_separator,
+                      thread_count, spill, tile_map);
+
       LOG_INFO("Done parsing " + std::to_string(tile_map.size()) + " transit tiles for GTFS feed " +
                feed_name);
     }
@@ -299,7 +596,7 @@ void setup_stops(Transit& tile,
  *         later on we use these ids to connect platforms that reference each other in the schedule
  */
 std::unordered_map<feed_object_t, GraphId>
-write_stops(Transit& tile, const tile_transit_info_t& tile_info, feed_cache_t& feeds) {
+write_stops(Transit& tile, const tile_transit_info_t& tile_info, const feed_cache_t& feeds) {
   const auto& tile_children = tile_info.station_children;
   auto node_id = tile_info.graphid;
 
@@ -368,10 +665,10 @@ write_stops(Transit& tile, const tile_transit_info_t& tile_info, feed_cache_t& f
 // read feed data per stop, given shape
 float get_stop_pair_dist(const gtfs::Stop& stop_connect,
                          gtfs::ShapeRange trip_shape,
-                         const gtfs::StopTime& pointStopTime) {
+                         const float shape_dist_traveled) {
   // check which segment would belong to which tile
-  if (pointStopTime.shape_dist_traveled > 0) {
-    return pointStopTime.shape_dist_traveled;
+  if (shape_dist_traveled > 0) {
+    return shape_dist_traveled;
   } else if (trip_shape.first == trip_shape.second) {
     return 0.f;
   }
@@ -414,6 +711,8 @@ bool write_stop_pair(
     const tile_transit_info_t& tile_info,
     const feed_object_t& feed_trip,
     const gtfs::Feed& feed,
+    std::vector<StopTimePair>::const_iterator pairs_begin,
+    const std::vector<StopTimePair>::const_iterator pairs_end,
     const std::unordered_map<feed_object_t, GraphId>& platform_node_ids,
     unique_transit_t& uniques,
     const google::protobuf::RepeatedPtrField<valhalla::mjolnir::Transit_Node>& tile_nodes,
@@ -441,14 +740,12 @@ bool write_stop_pair(
   auto pbf_shape_it = tile_info.shapes.find({currTrip.shape_id, feed_trip.feed});
 
   // already sorted by stop_sequence
-  auto tile_stopTimes = feed.get_stop_times_for_trip(tile_tripId);
-  for (; tile_stopTimes.first < tile_stopTimes.second - 1; ++tile_stopTimes.first) {
-    const auto& origin_stopTime = *tile_stopTimes.first;
-    const auto& origin_stopId = origin_stopTime.stop_id;
+  for (; pairs_begin != pairs_end; ++pairs_begin) {
+    const auto& stop_time_pair = *pairs_begin;
+    const auto& origin_stopId = stop_time_pair.origin_stop_id();
     const auto& origin_stop = feed.get_stop(origin_stopId);
     assert(gtfs::valid(origin_stop));
-    const auto& dest_stopTime = *std::next(tile_stopTimes.first);
-    const auto& dest_stopId = dest_stopTime.stop_id;
+    const auto& dest_stopId = stop_time_pair.destination_stop_id();
     const auto& dest_stop = feed.get_stop(dest_stopId);
     assert(gtfs::valid(dest_stop));
     const auto origin_graphid_it = platform_node_ids.find({origin_stopId, currFeedPath});
@@ -472,7 +769,7 @@ bool write_stop_pair(
         dest_is_in_tile ? tile_nodes.Get(dest_graphid_it->second.id()).generated() : false;
 
     // check if this stop_pair (the origin of the pair) is inside the current tile
-    if ((origin_is_in_tile || dest_is_in_tile) && origin_stopTime.trip_id == dest_stopTime.trip_id) {
+    if (origin_is_in_tile || dest_is_in_tile) {
       auto* stop_pair = tile.add_stop_pairs();
 
       // add information from calendar.txt and calendar_dates.txt
@@ -529,14 +826,16 @@ bool write_stop_pair(
       stop_pair->set_origin_onestop_id(origin_onestop_id);
       stop_pair->set_destination_onestop_id(dest_onestop_id);
 
-      stop_pair->set_destination_arrival_time(dest_stopTime.arrival_time.get_total_seconds());
-      stop_pair->set_origin_departure_time(origin_stopTime.departure_time.get_total_seconds());
+      stop_pair->set_destination_arrival_time(stop_time_pair.destination_arrival_time());
+      stop_pair->set_origin_departure_time(stop_time_pair.origin_departure_time());
 
       // maybe set the dist_traveled
-      if (const auto dist = get_stop_pair_dist(origin_stop, currShape, origin_stopTime)) {
+      const auto origin_dist = stop_time_pair.origin_dist_traveled();
+      if (const auto dist = get_stop_pair_dist(origin_stop, currShape, origin_dist)) {
         stop_pair->set_origin_dist_traveled(dist);
       }
-      if (const auto dist = get_stop_pair_dist(dest_stop, currShape, dest_stopTime)) {
+      const auto dest_dist = stop_time_pair.destination_dist_traveled();
+      if (const auto dist = get_stop_pair_dist(dest_stop, currShape, dest_dist)) {
         stop_pair->set_destination_dist_traveled(dist);
       }
 
@@ -609,7 +908,7 @@ bool write_stop_pair(
 
 // read routes data from feed
 std::unordered_map<feed_object_t, size_t>
-write_routes(Transit& tile, const tile_transit_info_t& tile_info, feed_cache_t& feeds) {
+write_routes(Transit& tile, const tile_transit_info_t& tile_info, const feed_cache_t& feeds) {
 
   const auto& tile_routeIds = tile_info.routes;
 
@@ -649,7 +948,7 @@ write_routes(Transit& tile, const tile_transit_info_t& tile_info, feed_cache_t&
 }
 
 // grab feed data from feed
-void write_shapes(Transit& tile, const tile_transit_info_t& tile_info, feed_cache_t& feeds) {
+void write_shapes(Transit& tile, const tile_transit_info_t& tile_info, const feed_cache_t& feeds) {
 
   // loop through all shapes inside the tile
   for (const auto& feed_shape : tile_info.shapes) {
@@ -667,7 +966,8 @@ void write_shapes(Transit& tile, const tile_transit_info_t& tile_info, feed_cach
 }
 
 // pre-processes feed data and writes to the pbfs (calls the 'write' functions)
-void ingest_tiles(const std::string& gtfs_dir,
+void ingest_tiles(const feed_cache_t& feeds,
+                  const pair_spill_t& spill,
                   const std::string& transit_dir,
                   const uint32_t pbf_trip_limit,
                   std::priority_queue<tile_transit_info_t>& queue,
@@ -694,12 +994,6 @@ void ingest_tiles(const std::string& gtfs_dir,
     const auto tile_path = get_tile_path(transit_dir, current.graphid);
     auto current_path = tile_path;
 
-    // collect all the feeds in this tile
-    feed_cache_t feeds(gtfs_dir);
-    for (const auto& route : current.routes) {
-      feeds(route.first);
-    }
-
     // keep track of the PBF insertion order for the routes to set route_index on the stop_pairs
     std::unordered_map<feed_object_t, size_t> routes_ids = write_routes(tile, current, feeds);
     write_shapes(tile, current, feeds);
@@ -709,12 +1003,29 @@ void ingest_tiles(const std::string& gtfs_dir,
     const auto tile_nodes = tile.nodes();
     // we have to be careful with writing stop_pairs to not exceed PBF's stupid 2 GB limit
     size_t trip_count = 0;
-    for (const auto& trip : current.trips) {
+    // the stop time pairs touching this tile, grouped by trip in the order of their stops
+    auto pairs = spill.read(current.graphid);
+    filesystem::remove(spill.path(current.graphid));
+    std::sort(pairs.begin(), pairs.end(), [](const StopTimePair& a, const StopTimePair& b) {
+      if (a.feed() != b.feed()) {
+        return a.feed() < b.feed();
+      }
+      if (a.trip_id() != b.trip_id()) {
+        return a.trip_id() < b.trip_id();
+      }
+      return a.stop_sequence() < b.stop_sequence();
+    });
+    for (auto begin = pairs.cbegin(); begin != pairs.cend();) {
+      const auto end = std::find_if(begin, pairs.cend(), [&begin](const StopTimePair& pair) {
+        return pair.trip_id() != begin->trip_id() || pair.feed() != begin->feed();
+      });
       trip_count++;
 
-      dangles = write_stop_pair(tile, current, trip, feeds(trip), platform_node_ids, uniques,
-                                tile_nodes, routes_ids) ||
+      const feed_object_t trip{begin->trip_id(), begin->feed()};
+      dangles = write_stop_pair(tile, current, trip, feeds(trip), begin, end, platform_node_ids,
+                                uniques, tile_nodes, routes_ids) ||
                 dangles;
+      begin = end;
 
       if (trip_count >= pbf_trip_limit) {
         LOG_INFO("Writing " + current_path);
@@ -872,9 +1183,15 @@ std::list<GraphId> ingest_transit(const boost::property_tree::ptree& pt) {
   auto thread_count =
       pt.get<unsigned int>("mjolnir.concurrency", std::max(static_cast<unsigned int>(1),
                                                            std::thread::hardware_concurrency()));
+  // scratch space to pair up the stop times in, it's removed once the pbfs are written
+  const auto scratch_dir = transit_dir + "ingest_scratch" + filesystem::path::preferred_separator;
+  feed_cache_t feeds;
+  pair_spill_t spill(scratch_dir + "pairs" + filesystem::path::preferred_separator);
+  filesystem::create_directories(spill.dir);
+
   // go get information about what transit tiles we should be fetching
   LOG_INFO("Tiling GTFS Feeds");
-  auto tiles = select_transit_tiles(gtfs_dir);
+  auto tiles = select_transit_tiles(gtfs_dir, scratch_dir, thread_count, feeds, spill);
 
   LOG_INFO("Writing " + std::to_string(tiles.size()) + " transit pbf tiles with " +
            std::to_string(thread_count) + " threads...");
@@ -887,7 +1204,8 @@ std::list<GraphId> ingest_transit(const boost::property_tree::ptree& pt) {
   auto pbf_trip_limit = pt.get<uint32_t>("mjolnir.transit_pbf_limit");
 
   for (size_t i = 0; i < threads.size(); ++i) {
-    threads[i].reset(new std::thread(ingest_tiles, std::cref(gtfs_dir), std::cref(transit_dir),
+    threads[i].reset(new std::thread(ingest_tiles, std::cref(feeds), std::cref(spill),
+                                     std::cref(transit_dir),
                                      pbf_trip_limit, std::ref(tiles), std::ref(uniques),
                                      std::ref(promises[i])));
   }
@@ -904,6 +1222,7 @@ std::list<GraphId> ingest_transit(const boost::property_tree::ptree& pt) {
       // TODO: throw further up the chain?
     }
   }
+  filesystem::remove_all(scratch_dir);
 
   LOG_INFO("Finished");
   return dangling;
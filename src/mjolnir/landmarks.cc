@@ -2,6 +2,7 @@
 #include "filesystem.h"
 
 #include "baldr/graphreader.h"
+#include "baldr/landmarkstore.h"
 #include "midgard/sequence.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/util.h"
@@ -11,9 +12,15 @@
 #include "baldr/tilehierarchy.h"
 #include "loki/search.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
 #include "sif/nocost.h"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <future>
+#include <limits>
+#include <memory>
 #include <thread>
 #include <tuple>
 
@@ -32,7 +39,10 @@ constexpr float kLandmarkSearchCutoff = 75.;
 
 struct landmark_callback : public OSMPBF::Callback {
 public:
-  landmark_callback(const std::string& db_name) : db_(db_name, false) {
+  using add_landmark_t =
+      std::function<void(const std::string&, const LandmarkType, const double, const double)>;
+
+  landmark_callback(const add_landmark_t& add_landmark) : add_landmark_(add_landmark) {
   }
   virtual ~landmark_callback() {
   }
@@ -50,8 +60,8 @@ public:
           name = it->second;
         }
 
-        // insert parsed landmark directly into database
-        db_.insert_landmark(name, landmark_type, lng, lat);
+        // hand the parsed landmark straight to the database or the store
+        add_landmark_(name, landmark_type, lng, lat);
       } catch (...) {}
     }
   }
@@ -72,7 +82,7 @@ public:
     LOG_WARN("landmark relation callback shouldn't be called!");
   }
 
-  valhalla::mjolnir::LandmarkDatabase db_;
+  add_landmark_t add_landmark_;
 };
 
 // sort a sequence file to put the edges in the same tile together
@@ -303,11 +313,122 @@ std::vector<Landmark> LandmarkDatabase::get_landmarks_by_bbox(const double minln
   return landmarks;
 }
 
+void WriteLandmarkStore(const std::string& file, std::vector<Landmark> landmarks) {
+  // bin the landmarks where the store will have them, at the precision it keeps them at
+  struct binned_t {
+    int32_t tile_id;
+    int32_t bin;
+    uint64_t location;
+    const Landmark* landmark;
+  };
+  std::vector<binned_t> binned;
+  binned.reserve(landmarks.size());
+  uint64_t names_size = 0;
+  for (const auto& landmark : landmarks) {
+    const auto location = encode_lnglat(landmark.lng, landmark.lat);
+    const auto lnglat = decode_lnglat(location);
+    int32_t tile_id;
+    const auto bin = LandmarkStore::Bin({lnglat.first, lnglat.second}, tile_id);
+    if (bin < 0) {
+      LOG_WARN("Skipping landmark " + landmark.name + " outside of the tiles");
+      continue;
+    }
+    binned.push_back({tile_id, bin, location, &landmark});
+    names_size += landmark.name.size() + 1;
+  }
+  if (binned.size() > std::numeric_limits<uint32_t>::max() ||
+      names_size > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Too many landmarks for a landmark store");
+  }
+  std::stable_sort(binned.begin(), binned.end(), [](const binned_t& a, const binned_t& b) {
+    return std::tie(a.tile_id, a.bin) < std::tie(b.tile_id, b.bin);
+  });
+  std::vector<uint32_t> tiles;
+  for (const auto& b : binned) {
+    if (tiles.empty() || tiles.back() != static_cast<uint32_t>(b.tile_id)) {
+      tiles.push_back(b.tile_id);
+    }
+  }
+
+  // lay the file out, it is swapped in whole when it is done so services can keep reading the old one
+  const uint64_t tiles_at = sizeof(LandmarkStoreHeader);
+  const uint64_t bins_at = tiles_at + tiles.size() * sizeof(uint32_t);
+  const uint64_t bin_count = tiles.size() * kLandmarkBinCount + 1;
+  const uint64_t landmarks_at =
+      (bins_at + bin_count * sizeof(uint32_t) + 7) & ~static_cast<uint64_t>(7);
+  const uint64_t names_at = landmarks_at + binned.size() * sizeof(LandmarkRecord);
+  const uint64_t size = names_at + names_size;
+  const auto staged = file + ".tmp";
+  filesystem::remove(staged);
+  const filesystem::path parent_dir = filesystem::path(file).parent_path();
+  if (!parent_dir.string().empty() && !filesystem::exists(parent_dir) &&
+      !filesystem::create_directories(parent_dir)) {
+    throw std::runtime_error("Can't create parent directory " + parent_dir.string());
+  }
+  {
+    midgard::mem_map<char> memory;
+    memory.create(staged, size);
+    std::memset(memory.get(), 0, size);
+    auto* header = reinterpret_cast<LandmarkStoreHeader*>(memory.get());
+    std::memcpy(header->magic, kLandmarkStoreMagic, sizeof(kLandmarkStoreMagic));
+    header->version = kLandmarkStoreVersion;
+    header->tile_count = tiles.size();
+    header->landmark_count = binned.size();
+    header->names_size = names_size;
+    std::memcpy(memory.get() + tiles_at, tiles.data(), tiles.size() * sizeof(uint32_t));
+    auto* bins = reinterpret_cast<uint32_t*>(memory.get() + bins_at);
+    auto* records = reinterpret_cast<LandmarkRecord*>(memory.get() + landmarks_at);
+    auto* names = memory.get() + names_at;
+
+    // each bin starts where the landmarks of the bins before it end
+    uint32_t name_offset = 0;
+    size_t tile_index = 0;
+    uint32_t next_bin = 0;
+    for (uint32_t id = 0; id < binned.size(); ++id) {
+      const auto& b = binned[id];
+      while (tiles[tile_index] != static_cast<uint32_t>(b.tile_id)) {
+        ++tile_index;
+      }
+      const uint32_t bin = tile_index * kLandmarkBinCount + b.bin;
+      for (; next_bin <= bin; ++next_bin) {
+        bins[next_bin] = id;
+      }
+      records[id].location = b.location;
+      records[id].name_offset = name_offset;
+      records[id].type = static_cast<uint8_t>(b.landmark->type);
+      std::memcpy(names + name_offset, b.landmark->name.c_str(), b.landmark->name.size() + 1);
+      name_offset += b.landmark->name.size() + 1;
+    }
+    for (; next_bin < bin_count; ++next_bin) {
+      bins[next_bin] = binned.size();
+    }
+  }
+
+  if (!filesystem::rename(staged, file)) {
+    throw std::runtime_error("Could not move " + staged + " to " + file);
+  }
+  LOG_INFO("Wrote " + std::to_string(binned.size()) + " landmarks in " +
+           std::to_string(tiles.size()) + " tiles to " + file);
+}
+
 bool BuildLandmarkFromPBF(const boost::property_tree::ptree& pt,
                           const std::vector<std::string>& input_files) {
-  // parse pbf to get landmark nodes
-  const std::string db_name = pt.get<std::string>("landmarks", "");
-  landmark_callback callback(db_name);
+  // parse pbf to get landmark nodes, into the store if there is one and the database otherwise
+  const std::string store_name = pt.get<std::string>("landmark_store", "");
+  std::unique_ptr<LandmarkDatabase> db;
+  std::vector<Landmark> landmarks;
+  landmark_callback::add_landmark_t add_landmark;
+  if (store_name.empty()) {
+    db.reset(new LandmarkDatabase(pt.get<std::string>("landmarks", ""), false));
+    add_landmark = [&db](const std::string& name, const LandmarkType type, const double lng,
+                         const double lat) { db->insert_landmark(name, type, lng, lat); };
+  } else {
+    add_landmark = [&landmarks](const std::string& name, const LandmarkType type, const double lng,
+                                const double lat) {
+      landmarks.emplace_back(landmarks.size(), name, type, lng, lat);
+    };
+  }
+  landmark_callback callback(add_landmark);
 
   LOG_INFO("Parsing files...");
   // hold open all the files so that if something else (like diff application)
@@ -326,6 +447,11 @@ bool BuildLandmarkFromPBF(const boost::property_tree::ptree& pt,
                           callback);
   }
 
+  if (!store_name.empty()) {
+    WriteLandmarkStore(store_name, std::move(landmarks));
+    LOG_INFO("Successfully built landmark store from PBF");
+    return true;
+  }
   LOG_INFO("Successfully built landmark database from PBF");
   return true;
 }
@@ -333,56 +459,56 @@ bool BuildLandmarkFromPBF(const boost::property_tree::ptree& pt,
 // Find landmarks in the tiles and the edges correlated to each landmark,
 // and return the sequence file name where we wrote the correlations
 void FindLandmarkEdges(const boost::property_tree::ptree& pt,
-                       const std::vector<GraphId>& tileset,
+                       TileScheduler& scheduler,
                        const size_t& thread_number,
-                       const size_t& total_threads,
                        std::promise<std::string>& seq_file_name) {
-  // Open the database and create a graph reader
-  const std::string db_name = pt.get<std::string>("landmarks", "");
-
-  LandmarkDatabase db(db_name, true);
+  // Open the store or the database and create a graph reader
+  const auto store = LandmarkStore::get(pt.get<std::string>("landmark_store", ""));
+  std::unique_ptr<LandmarkDatabase> db;
+  if (!store) {
+    db.reset(new LandmarkDatabase(pt.get<std::string>("landmarks", ""), true));
+  }
   GraphReader reader(pt);
   // create the sequence file
   std::string file_name = "landmark_dump_" + std::to_string(thread_number);
   midgard::sequence<std::pair<GraphId, uint64_t>> seq_file(file_name, true);
 
-  for (size_t i = 0; i < tileset.size(); ++i) {
-    // every i'th thread works on every i'th tile
-    if (i % total_threads == thread_number) {
-      // get landmarks in the tile
-      midgard::AABB2<PointLL> bbox = baldr::TileHierarchy::GetGraphIdBoundingBox(tileset[i]);
-
-      std::vector<Landmark> landmarks =
-          db.get_landmarks_by_bbox(bbox.minx(), bbox.miny(), bbox.maxx(), bbox.maxy());
-
-      // find and collect all nearby path locations for the landmarks
-      for (const auto& landmark : landmarks) {
-        baldr::Location landmark_location(midgard::PointLL{landmark.lng, landmark.lat},
-                                          baldr::Location::StopType::BREAK, 0, 0, kLandmarkRadius);
-        landmark_location.search_cutoff_ = kLandmarkSearchCutoff;
-
-        // call loki::Search to get nearby edges to each landmark
-        std::unordered_map<valhalla::baldr::Location, PathLocation> result =
-            loki::Search({landmark_location}, reader, sif::CreateNoCost({}));
-
-        // we only have one landmark as input so the return size should be no more than one
-        if (result.size() > 1) {
-          throw std::logic_error(
-              "Error occurred in finding nearby edges to a landmark. Result size is " +
-              std::to_string(result.size()) + ", but should be one or zero");
-        }
-        // if the landmark should not be associated with any edge
-        if (result.size() == 0) {
-          continue;
-        }
+  GraphId tile_id;
+  while (scheduler.Next(thread_number, tile_id)) {
+    // get landmarks in the tile
+    midgard::AABB2<PointLL> bbox = baldr::TileHierarchy::GetGraphIdBoundingBox(tile_id);
+
+    std::vector<Landmark> landmarks =
+        store ? store->Find(bbox)
+              : db->get_landmarks_by_bbox(bbox.minx(), bbox.miny(), bbox.maxx(), bbox.maxy());
+
+    // find and collect all nearby path locations for the landmarks
+    for (const auto& landmark : landmarks) {
+      baldr::Location landmark_location(midgard::PointLL{landmark.lng, landmark.lat},
+                                        baldr::Location::StopType::BREAK, 0, 0, kLandmarkRadius);
+      landmark_location.search_cutoff_ = kLandmarkSearchCutoff;
+
+      // call loki::Search to get nearby edges to each landmark
+      std::unordered_map<valhalla::baldr::Location, PathLocation> result =
+          loki::Search({landmark_location}, reader, sif::CreateNoCost({}));
+
+      // we only have one landmark as input so the return size should be no more than one
+      if (result.size() > 1) {
+        throw std::logic_error(
+            "Error occurred in finding nearby edges to a landmark. Result size is " +
+            std::to_string(result.size()) + ", but should be one or zero");
+      }
+      // if the landmark should not be associated with any edge
+      if (result.size() == 0) {
+        continue;
+      }
 
-        std::vector<PathLocation::PathEdge> edges = result.begin()->second.edges;
-        // for each edge insert edgeid - landmark_pkey pair into the sequence file
-        // TODO: maybe do some filtering and only keep some of the edges it finds? (now we have the
-        // 75m search cutoff)
-        for (const auto& edge : edges) {
-          seq_file.push_back(std::make_pair(edge.id, landmark.id));
-        }
+      std::vector<PathLocation::PathEdge> edges = result.begin()->second.edges;
+      // for each edge insert edgeid - landmark_pkey pair into the sequence file
+      // TODO: maybe do some filtering and only keep some of the edges it finds? (now we have the
+      // 75m search cutoff)
+      for (const auto& edge : edges) {
+        seq_file.push_back(std::make_pair(edge.id, landmark.id));
       }
     }
   }
@@ -394,73 +520,53 @@ void FindLandmarkEdges(const boost::property_tree::ptree& pt,
 // tiles, edges, and landmarks. NOTE: the input sequence file seq_file is passed by reference, but
 // should not be modified by these threads.
 void UpdateTiles(midgard::sequence<std::pair<GraphId, uint64_t>>& seq_file,
+                 const std::unordered_map<GraphId, std::pair<size_t, size_t>>& tile_ranges,
                  const std::string& tile_dir,
                  const std::string& db_name,
+                 const std::shared_ptr<const LandmarkStore>& store,
+                 TileScheduler& scheduler,
                  const size_t& thread_number,
-                 const size_t& total_threads,
                  std::promise<std::tuple<size_t, size_t, size_t>>& stats) {
-  // open the database and initialize a unique pointer to graph tile builder
-  std::unique_ptr<GraphTileBuilder> tile_builder_ptr = nullptr;
-
-  LandmarkDatabase db(db_name, true);
+  std::unique_ptr<LandmarkDatabase> db;
+  if (!store) {
+    db.reset(new LandmarkDatabase(db_name, true));
+  }
 
   // stats to record how many tiles, edges and landmarks are updated
   size_t updated_tiles = 0, updated_edges = 0, updated_landmarks = 0;
-  GraphId last_edge, last_tile;
-
-  size_t tile_count = static_cast<size_t>(-1);
-  // every i'th thread works on every i'th tile
-  for (auto it = seq_file.begin(); it != seq_file.end(); ++it) {
-    // if the current tile is not the same as the last one, increase counter by one
-    if ((*it).first.Tile_Base() != last_tile) {
-      last_tile = (*it).first.Tile_Base();
-      tile_count++;
-    }
-    // decide whether this tile is a "every i'th tile". if not, the thread should skip it
-    if (tile_count % total_threads != thread_number) {
-      continue;
-    }
 
-    // now this pair is on a "every i'th tile". the thread should process it.
-
-    // if this pair is on a new tile, then store the previous tile and move to the new tile
-    if (!tile_builder_ptr ||
-        tile_builder_ptr->header_builder().graphid().Tile_Base() != (*it).first.Tile_Base()) {
-      // store the previously updated tile
-      if (tile_builder_ptr) {
-        tile_builder_ptr->StoreTileData();
-        updated_tiles++;
+  // the pairs of a tile are next to each other in the sorted sequence file
+  GraphId tile_id;
+  while (scheduler.Next(thread_number, tile_id)) {
+    const auto& range = tile_ranges.at(tile_id);
+    GraphTileBuilder tile_builder(tile_dir, tile_id, true);
+    GraphId last_edge;
+    for (auto it = seq_file.begin() + range.first; it != seq_file.begin() + range.second; ++it) {
+      // retrieve the landmark to be added
+      // TODO: in the future we can do batches of ids, though it will complicate the code it will
+      // likely speed up the processing
+      const std::vector<Landmark> landmark =
+          store ? std::vector<Landmark>{store->Get((*it).second)}
+                : db->get_landmarks_by_ids({static_cast<int64_t>((*it).second)});
+      if (landmark.size() != 1) {
+        throw std::logic_error("Incorrect result size " + std::to_string(landmark.size()) +
+                               " of retrieved landmarks, which should be 1");
+      }
+      // add the landmark to the tile
+      GraphId edge_id = (*it).first;
+      tile_builder.AddLandmark(edge_id, landmark[0]);
+
+      // update the stats
+      updated_landmarks++;
+      // a single edge can have multiple landmarks
+      // record the number of unique edges updated (pairs with the same edge should appear
+      // consecutively in the sequence)
+      if (last_edge != edge_id) {
+        updated_edges++;
+        last_edge = edge_id;
       }
-      // reset the tile builder to this new tile
-      tile_builder_ptr.reset(new GraphTileBuilder(tile_dir, (*it).first.Tile_Base(), true));
-    }
-
-    // retrieve the landmark to be added
-    // TODO: in the future we can do batches of ids, though it will complicate the code it will likely
-    // speed up the processing
-    const std::vector<Landmark> landmark =
-        db.get_landmarks_by_ids({static_cast<int64_t>((*it).second)});
-    if (landmark.size() != 1) {
-      throw std::logic_error("Incorrect result size " + std::to_string(landmark.size()) +
-                             " of retrieved landmarks, which should be 1");
-    }
-    // add the landmark to the tile
-    GraphId edge_id = (*it).first;
-    tile_builder_ptr->AddLandmark(edge_id, landmark[0]);
-
-    // update the stats
-    updated_landmarks++;
-    // a single edge can have multiple landmarks
-    // record the number of unique edges updated (pairs with the same edge should appear consecutively
-    // in the sequence)
-    if (last_edge != (*it).first) {
-      updated_edges++;
-      last_edge = (*it).first;
     }
-  }
-  // store the last updated tile
-  if (tile_builder_ptr) {
-    tile_builder_ptr->StoreTileData();
+    tile_builder.StoreTileData();
     updated_tiles++;
   }
 
@@ -475,6 +581,8 @@ bool AddLandmarks(const boost::property_tree::ptree& pt) {
   const size_t num_threads =
       pt.get<size_t>("mjolnir.concurrency", std::thread::hardware_concurrency());
   const std::string db_name = pt.get_child("mjolnir").get<std::string>("landmarks_db", "");
+  const auto store =
+      LandmarkStore::get(pt.get_child("mjolnir").get<std::string>("landmark_store", ""));
 
   // get tile access
   baldr::GraphReader reader(pt.get_child("mjolnir"));
@@ -486,18 +594,18 @@ bool AddLandmarks(const boost::property_tree::ptree& pt) {
   std::vector<GraphId> vec_tileset(tileset.begin(),
                                    tileset.end()); // turn the unordered_set into a vector for sorting
 
-  std::sort(vec_tileset.begin(), vec_tileset.end(), [&](const auto id_a, const auto id_b) {
-    return reader.GetGraphTile(id_a)->header()->nodecount() >
-           reader.GetGraphTile(id_b)->header()->nodecount();
-  });
-
   LOG_INFO("Finding landmarks and their correlated edges...");
 
+  // the searches around the landmarks reach into the neighbouring tiles so the tiles are handed
+  // out in batches of neighbours, the biggest first to balance the threads
+  TileScheduler find_scheduler("Finding landmark edges", vec_tileset, num_threads,
+                               TileScheduler::FileSize(reader.tile_dir()),
+                               TileScheduler::kNeighbourBatch);
   std::vector<std::shared_ptr<std::thread>> threads(num_threads);
   std::vector<std::promise<std::string>> sequence_file_names(num_threads);
   for (size_t i = 0; i < num_threads; ++i) {
     threads[i].reset(new std::thread(FindLandmarkEdges, std::cref(pt.get_child("mjolnir")),
-                                     std::cref(vec_tileset), i, num_threads,
+                                     std::ref(find_scheduler), i,
                                      std::ref(sequence_file_names[i])));
   }
 
@@ -505,6 +613,7 @@ bool AddLandmarks(const boost::property_tree::ptree& pt) {
   for (auto& thread : threads) {
     thread->join();
   }
+  find_scheduler.LogUtilization();
 
   std::vector<std::string> seq_names{};
   seq_names.reserve(sequence_file_names.size());
@@ -530,20 +639,39 @@ bool AddLandmarks(const boost::property_tree::ptree& pt) {
 
   LOG_INFO("Updating tiles...");
 
+  // where the pairs of each tile are in the sorted sequence file, the tiles with the most first
+  std::unordered_map<GraphId, std::pair<size_t, size_t>> tile_ranges;
+  std::vector<GraphId> updated_tileset;
+  size_t index = 0;
+  for (const auto& pair : merged_sequence_file) {
+    const auto tile_id = pair.first.Tile_Base();
+    if (updated_tileset.empty() || updated_tileset.back() != tile_id) {
+      updated_tileset.push_back(tile_id);
+      tile_ranges[tile_id] = {index, index};
+    }
+    tile_ranges[tile_id].second = ++index;
+  }
+  TileScheduler update_scheduler("Updating tiles with landmarks", updated_tileset, num_threads,
+                                 [&tile_ranges](const GraphId& tile_id) {
+                                   const auto& range = tile_ranges.at(tile_id);
+                                   return range.second - range.first;
+                                 });
+
   // re-open the thread pool to update tiles
   std::vector<std::promise<std::tuple<size_t, size_t, size_t>>> stats_info(
       num_threads); // tiles, edges, landmarks
 
   const std::string tile_dir = reader.tile_dir();
   for (size_t i = 0; i < num_threads; ++i) {
-    // assume the data size that each thread processes doesn't affect performance a lot
-    threads[i].reset(new std::thread(UpdateTiles, std::ref(merged_sequence_file), tile_dir, db_name,
-                                     i, num_threads, std::ref(stats_info[i])));
+    threads[i].reset(new std::thread(UpdateTiles, std::ref(merged_sequence_file),
+                                     std::cref(tile_ranges), tile_dir, db_name, std::cref(store),
+                                     std::ref(update_scheduler), i, std::ref(stats_info[i])));
   }
 
   for (auto& thread : threads) {
     thread->join();
   }
+  update_scheduler.LogUtilization();
 
   // collect and log the stats
   size_t tiles = 0, edges = 0, landmarks = 0;
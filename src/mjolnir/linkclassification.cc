@@ -66,20 +66,12 @@ uint32_t GetBestNonLinkClass(const std::map<Edge, size_t>& edges) {
   return bestrc;
 }
 
+// The data a task of reclassification works with, the edges as the task sees them
 struct Data {
-  Data(const std::string& nodes_file,
-       const std::string& edges_file,
-       const std::string& ways_file,
-       const std::string& way_nodes_file,
-       const OSMData& osmdata)
-      : nodes(nodes_file, false), edges(edges_file, false), ways(ways_file, false),
-        way_nodes(way_nodes_file, false), osmdata(osmdata) {
-  }
-
-  sequence<Node> nodes;
-  sequence<Edge> edges;
-  sequence<OSMWay> ways;
-  sequence<OSMWayNode> way_nodes;
+  sequence<Node>& nodes;
+  edge_view_t& edges;
+  sequence<OSMWay>& ways;
+  sequence<OSMWayNode>& way_nodes;
   const OSMData& osmdata;
 };
 
@@ -97,7 +89,7 @@ std::vector<PointLL> EdgeShape(Data& data, const Edge& edge) {
 float CalcEdgesLength(Data& data, const std::vector<uint32_t>& edges) {
   float total_length = 0.0f;
   for (auto idx : edges) {
-    Edge edge = *data.edges[idx];
+    Edge edge = data.edges.get(idx);
     auto shape = EdgeShape(data, edge);
     total_length += valhalla::midgard::length(shape);
   }
@@ -106,12 +98,12 @@ float CalcEdgesLength(Data& data, const std::vector<uint32_t>& edges) {
 
 // Form a list of all nodes - sorted by highest classification of non-link
 // edges at the node.
-nodelist_t FormExitNodes(sequence<Node>& nodes, sequence<Edge>& edges) {
-  nodelist_t exit_nodes(kMaxClassification);
-  sequence<Node>::iterator node_itr = nodes.begin();
-  while (node_itr != nodes.end()) {
+nodelist_t FormExitNodes(sequence<Node>& nodes, sequence<Edge>& edges, unsigned int concurrency) {
+  // the parts of the nodes are searched in parallel and their exits put together in order
+  std::vector<nodelist_t> part_exits(std::max(concurrency, 1u), nodelist_t(kMaxClassification));
+  auto visit = [&part_exits](size_t part, const sequence<Node>::iterator& node_itr,
+                             const node_bundle& bundle) {
     // If the node has a both links and non links at it
-    auto bundle = collect_node_edges(node_itr, nodes, edges);
     if (bundle.node.link_edge_ && bundle.node.non_link_edge_) {
       // Check if this node has a link edge that is driveable from the node
       for (const auto& edge : bundle.node_edges) {
@@ -121,14 +113,19 @@ nodelist_t FormExitNodes(sequence<Node>& nodes, sequence<Edge>& edges) {
           // connecting edge is driveable the node will be skipped.
           uint32_t rc = GetBestNonLinkClass(bundle.node_edges);
           if (rc < kMaxClassification) {
-            exit_nodes[rc].push_back(node_itr);
+            part_exits[part][rc].push_back(node_itr);
           }
         }
       }
     }
+  };
+  for_each_bundle(nodes, edges, part_exits.size(), visit);
 
-    // Go to the next node
-    node_itr += bundle.node_count;
+  nodelist_t exit_nodes(kMaxClassification);
+  for (const auto& exits : part_exits) {
+    for (uint32_t rc = 0; rc < kMaxClassification; rc++) {
+      exit_nodes[rc].insert(exit_nodes[rc].end(), exits[rc].begin(), exits[rc].end());
+    }
   }
 
   // Output exit counts for each class
@@ -541,7 +538,7 @@ std::vector<uint32_t> GoTowardsIntersection(uint32_t start_node,
                                             bool forward,
                                             double length_stop_threshold,
                                             Data& data) {
-  Edge start_edge = *data.edges[start_edge_idx];
+  Edge start_edge = data.edges.get(start_edge_idx);
   uint32_t node = EndNode(start_node, start_edge);
   Edge prev_edge = start_edge;
   bool next_found = false;
@@ -692,12 +689,12 @@ SlipLaneInput GetSlipLaneInput(Data& data, const std::vector<uint32_t>& link_edg
   SlipLaneInput res;
   // link_edges store link sequence in reverse order
   // so first link edge is actually the last in the list
-  Edge first_link_edge = *data.edges[link_edges.back()];
+  Edge first_link_edge = data.edges.get(link_edges.back());
   res.first_node = (first_link_edge.fwd_access & kAutoAccess) ? first_link_edge.sourcenode_
                                                               : first_link_edge.targetnode_;
   res.fork_edge = find_closest_neighbour_edge(res.first_node, first_link_edge, true);
 
-  Edge last_link_edge = *data.edges[link_edges.front()];
+  Edge last_link_edge = data.edges.get(link_edges.front());
   res.last_node = (last_link_edge.fwd_access & kAutoAccess) ? last_link_edge.targetnode_
                                                             : last_link_edge.sourcenode_;
   res.merge_edge = find_closest_neighbour_edge(res.last_node, last_link_edge, false);
@@ -707,7 +704,7 @@ SlipLaneInput GetSlipLaneInput(Data& data, const std::vector<uint32_t>& link_edg
 // Test if the set of edges can be classified as a turn channel.
 bool IsTurnChannel(Data& data, const std::vector<uint32_t>& link_edges) {
   bool bidirectional = std::any_of(link_edges.begin(), link_edges.end(), [&](uint32_t edge_idx) {
-    Edge edge = *data.edges[edge_idx];
+    Edge edge = data.edges.get(edge_idx);
     OSMWay way = *data.ways[edge.wayindex_];
     return way.auto_forward() && way.auto_backward();
   });
@@ -723,7 +720,7 @@ bool IsTurnChannel(Data& data, const std::vector<uint32_t>& link_edges) {
   SlipLaneInput input = GetSlipLaneInput(data, link_edges);
   if (input.Valid()) {
 #ifdef LOGGING_LEVEL_DEBUG
-    uint64_t way_id = (*data.ways[(*data.edges[link_edges[0]]).wayindex_]).way_id();
+    uint64_t way_id = (*data.ways[data.edges.get(link_edges[0]).wayindex_]).way_id();
     LOG_DEBUG("Link edges with way_id=" + std::to_string(way_id));
 #endif
 
@@ -847,8 +844,7 @@ std::pair<uint32_t, uint32_t> ReclassifyLinkGraph(std::vector<LinkGraphNode>& li
 
       // Reclassify link edges to the new classification.
       for (auto edge_idx : link_edges) {
-        sequence<Edge>::iterator element = data.edges[edge_idx];
-        auto edge = *element;
+        auto edge = data.edges.get(edge_idx);
 
         if (rc > edge.attributes.importance) {
           if (rc < static_cast<uint32_t>(RoadClass::kUnclassified))
@@ -866,7 +862,7 @@ std::pair<uint32_t, uint32_t> ReclassifyLinkGraph(std::vector<LinkGraphNode>& li
         // Mark the edge so we don't try to reclassify it again. Copy
         // the updated edge back to the sequence.
         edge.attributes.reclass_link = true;
-        element = edge;
+        data.edges.set(edge_idx, edge);
       }
     } // for each leaf parent
   }   // for each leaf
@@ -881,18 +877,24 @@ std::pair<uint32_t, uint32_t> ReclassifyLinkGraph(std::vector<LinkGraphNode>& li
 // from the exit node and uses the classifications at the nodes of the link
 // graph to potentially reclassify link edges. This also contains logic to
 // identify turn channels / turn lanes (likely to be at-grade "slip roads").
+// The link graphs of the exits are worked on in parallel with run_in_order, so
+// the links end up as if the exits were worked on one after the other.
 void ReclassifyLinks(const std::string& ways_file,
                      const std::string& nodes_file,
                      const std::string& edges_file,
                      const std::string& way_nodes_file,
                      const OSMData& osmdata,
-                     bool infer_turn_channels) {
+                     bool infer_turn_channels,
+                     unsigned int concurrency) {
   LOG_INFO("Reclassifying_V2 link graph edges...");
 
-  Data data(nodes_file, edges_file, ways_file, way_nodes_file, osmdata);
+  sequence<Node> nodes(nodes_file, false);
+  sequence<Edge> edges(edges_file, false);
+  sequence<OSMWay> ways(ways_file, false);
+  sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   // Find list of exit nodes - nodes where driveable outbound links connect to
   // non-link edges. Group by best road class of the non-link connecting edges.
-  nodelist_t exit_nodes = FormExitNodes(data.nodes, data.edges);
+  nodelist_t exit_nodes = FormExitNodes(nodes, edges, concurrency);
 
   // Iterate through the exit node list by classification so exits from major
   // roads are considered before exits from minor roads.
@@ -900,15 +902,20 @@ void ReclassifyLinks(const std::string& ways_file,
   uint32_t tc_count = 0;
 
   for (uint32_t classification = 0; classification < kMaxClassification; classification++) {
-    for (auto& node : exit_nodes[classification]) {
+    auto& exits = exit_nodes[classification];
+    std::vector<std::pair<uint32_t, uint32_t>> counts(exits.size());
+    run_in_order(exits.size(), concurrency, edges, [&](size_t i, edge_view_t& view) {
+      Data data{nodes, view, ways, way_nodes, osmdata};
       LinkGraphBuilder build_graph(data);
       // build link graph
-      auto link_graph = build_graph(node, classification);
+      auto link_graph = build_graph(exits[i], classification);
       // reclassify links and infer turn channels
-      auto counts = ReclassifyLinkGraph(link_graph, classification, data, infer_turn_channels);
-      // update counters
-      reclass_count += counts.first;
-      tc_count += counts.second;
+      counts[i] = ReclassifyLinkGraph(link_graph, classification, data, infer_turn_channels);
+    });
+    // update counters
+    for (const auto& count : counts) {
+      reclass_count += count.first;
+      tc_count += count.second;
     }
   }
 
@@ -1,11 +1,21 @@
 #include "mjolnir/node_expander.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
 namespace valhalla {
 namespace mjolnir {
 
-node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
-                               sequence<Node>& nodes,
-                               sequence<Edge>& edges) {
+namespace {
+
+template <class edges_t>
+node_bundle collect(const sequence<Node>::iterator& node_itr,
+                    sequence<Node>& nodes,
+                    const edges_t& get_edge) {
   // copy out the first nodes attributes (as they are the correctly merged one)
   auto itr = node_itr;
   node_bundle bundle(*itr);
@@ -14,7 +24,7 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
   for (; itr != nodes.end() && (node = *itr).node.osmid_ == bundle.node.osmid_; ++itr) {
     ++bundle.node_count;
     if (node.is_start()) {
-      auto edge = *edges[node.start_of];
+      auto edge = get_edge(node.start_of);
       edge.attributes.driveforward = edge.fwd_access & baldr::kAutoAccess;
       // Set driveforward - this edge is traversed in forward direction
       bundle.node_edges.emplace(std::make_pair(edge, node.start_of));
@@ -41,7 +51,7 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
       }
     }
     if (node.is_end()) {
-      auto edge = *edges[node.end_of];
+      auto edge = get_edge(node.end_of);
       // Set driveforward - this edge is traversed in reverse direction
       edge.attributes.driveforward = edge.rev_access & baldr::kAutoAccess;
       bundle.node_edges.emplace(std::make_pair(edge, node.end_of));
@@ -70,5 +80,136 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
   return bundle;
 }
 
+} // namespace
+
+node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
+                               sequence<Node>& nodes,
+                               sequence<Edge>& edges) {
+  return collect(node_itr, nodes, [&edges](uint32_t index) -> Edge { return *edges[index]; });
+}
+
+node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
+                               sequence<Node>& nodes,
+                               edge_view_t& edges) {
+  return collect(node_itr, nodes, [&edges](uint32_t index) { return edges.get(index); });
+}
+
+void for_each_bundle(
+    sequence<Node>& nodes,
+    sequence<Edge>& edges,
+    size_t threads,
+    const std::function<
+        void(size_t part, const sequence<Node>::iterator& node_itr, const node_bundle& bundle)>&
+        visit) {
+  // the parts start where a bundle starts, a bundle is the nodes with the same osm id in a row
+  threads = std::max<size_t>(threads, 1);
+  std::vector<size_t> starts;
+  for (size_t part = 0; part <= threads; ++part) {
+    size_t start = nodes.size() * part / threads;
+    while (start > 0 && start < nodes.size() &&
+           (*nodes[start]).node.osmid_ == (*nodes[start - 1]).node.osmid_) {
+      ++start;
+    }
+    starts.push_back(std::max(start, part ? starts.back() : 0));
+  }
+
+  std::exception_ptr error;
+  std::mutex error_lock;
+  auto visit_part = [&](size_t part) {
+    try {
+      auto node_itr = nodes[starts[part]];
+      const auto end = nodes[starts[part + 1]];
+      while (node_itr != end) {
+        auto bundle = collect_node_edges(node_itr, nodes, edges);
+        visit(part, node_itr, bundle);
+        node_itr += bundle.node_count;
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t part = 1; part < threads; ++part) {
+    workers.emplace_back(visit_part, part);
+  }
+  visit_part(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void run_in_order(size_t count,
+                  size_t threads,
+                  sequence<Edge>& edges,
+                  const std::function<void(size_t index, edge_view_t& edges)>& task) {
+  threads = std::max<size_t>(threads, 1);
+  if (threads == 1) {
+    for (size_t i = 0; i < count; ++i) {
+      edge_view_t view(edges, false);
+      task(i, view);
+    }
+    return;
+  }
+
+  // a batch keeps the threads busy and is small enough to not fall far behind the edges
+  const size_t batch_size = threads * 64;
+  for (size_t begin = 0; begin < count; begin += batch_size) {
+    const size_t end = std::min(count, begin + batch_size);
+    std::vector<edge_view_t> views;
+    views.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      views.emplace_back(edges, true);
+    }
+
+    // a task that failed on stale edges gets another chance, so errors wait for their turn
+    std::vector<std::exception_ptr> errors(end - begin);
+    std::atomic<size_t> next(begin);
+    auto speculate = [&]() {
+      for (size_t i = next++; i < end; i = next++) {
+        try {
+          task(i, views[i - begin]);
+        } catch (...) { errors[i - begin] = std::current_exception(); }
+      }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(threads, end - begin); ++i) {
+      workers.emplace_back(speculate);
+    }
+    speculate();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    // apply the changes in order, running the tasks that read what came before them again
+    std::unordered_set<uint32_t> changed;
+    for (size_t i = begin; i < end; ++i) {
+      const auto& view = views[i - begin];
+      const bool stale = std::any_of(view.reads().begin(), view.reads().end(),
+                                     [&changed](uint32_t index) { return changed.count(index); });
+      if (stale) {
+        edge_view_t direct(edges, false);
+        task(i, direct);
+        for (const auto& change : direct.changes()) {
+          changed.insert(change.first);
+        }
+        continue;
+      }
+      if (errors[i - begin]) {
+        std::rethrow_exception(errors[i - begin]);
+      }
+      for (const auto& change : view.changes()) {
+        edges[change.first] = change.second;
+        changed.insert(change.first);
+      }
+    }
+  }
+}
+
 } // namespace mjolnir
 } // namespace valhalla
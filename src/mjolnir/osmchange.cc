@@ -0,0 +1,169 @@
+#include <stdexcept>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "mjolnir/osmchange.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// positive ids only, new objects of a change that wasnt uploaded yet have negative ones
+bool get_id(const boost::property_tree::ptree& element, const std::string& key, uint64_t& id) {
+  auto value = element.get_optional<int64_t>("<xmlattr>." + key);
+  if (!value || *value <= 0) {
+    return false;
+  }
+  id = static_cast<uint64_t>(*value);
+  return true;
+}
+
+// call back every directed edge of every tile, the callback returns true when its done with a tile
+template <class edge_callback_t>
+void for_each_tile(GraphReader& reader,
+                   const std::vector<GraphId>& tiles,
+                   const edge_callback_t& callback) {
+  for (const auto& tile_id : tiles) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    for (const auto& edge : tile->GetDirectedEdges()) {
+      if (callback(tile, edge)) {
+        break;
+      }
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+OSMChange OSMChange::Read(std::istream& osc) {
+  boost::property_tree::ptree doc;
+  boost::property_tree::read_xml(osc, doc);
+  auto root = doc.get_child_optional("osmChange");
+  if (!root) {
+    throw std::runtime_error("Not an osmChange document");
+  }
+
+  OSMChange change;
+  for (const auto& section : *root) {
+    if (section.first != "create" && section.first != "modify" && section.first != "delete") {
+      continue;
+    }
+    for (const auto& element : section.second) {
+      uint64_t id = 0;
+      if (element.first == "node") {
+        auto lat = element.second.get_optional<double>("<xmlattr>.lat");
+        auto lon = element.second.get_optional<double>("<xmlattr>.lon");
+        if (lat && lon) {
+          change.node_positions.emplace_back(*lon, *lat);
+        }
+      } else if (element.first == "way") {
+        if (get_id(element.second, "id", id)) {
+          change.way_ids.insert(id);
+        }
+      } else if (element.first == "relation") {
+        // restrictions and the like are stored with the ways they refer to
+        for (const auto& member : element.second) {
+          if (member.first == "member" &&
+              member.second.get<std::string>("<xmlattr>.type", "") == "way" &&
+              get_id(member.second, "ref", id)) {
+            change.way_ids.insert(id);
+          }
+        }
+      }
+    }
+  }
+  return change;
+}
+
+std::set<GraphId> AffectedTiles(GraphReader& reader, const OSMChange& change) {
+  const auto& levels = TileHierarchy::levels();
+  const auto& local = levels.back();
+  std::vector<GraphId> tiles;
+  for (const auto& level : levels) {
+    auto level_tiles = reader.GetTileSet(level.level);
+    tiles.insert(tiles.end(), level_tiles.begin(), level_tiles.end());
+  }
+
+  // the tiles the changed nodes are in, whether the graph has them yet or not
+  std::unordered_set<GraphId> changed;
+  for (const auto& position : change.node_positions) {
+    changed.insert(TileHierarchy::GetGraphId(position, local.level));
+  }
+
+  // the tiles with edges of the changed ways
+  if (!change.way_ids.empty()) {
+    for_each_tile(reader, tiles, [&](const graph_tile_ptr& tile, const DirectedEdge& edge) {
+      if (change.way_ids.count(tile->edgeinfo(&edge).wayid())) {
+        changed.insert(tile->id());
+        return true;
+      }
+      return false;
+    });
+  }
+  LOG_INFO(std::to_string(changed.size()) + " tiles have changed nodes or ways");
+
+  // new ways may connect to the existing nodes of the neighbors
+  std::unordered_set<GraphId> neighborhood(changed);
+  for (const auto& tile_id : changed) {
+    if (tile_id.level() != local.level) {
+      continue;
+    }
+    const auto row_col = local.tiles.GetRowColumn(tile_id.tileid());
+    for (int32_t row = row_col.first - 1; row <= row_col.first + 1; ++row) {
+      for (int32_t col = row_col.second - 1; col <= row_col.second + 1; ++col) {
+        if (row < 0 || row >= local.tiles.nrows() || col < 0 || col >= local.tiles.ncolumns()) {
+          continue;
+        }
+        GraphId neighbor(local.tiles.TileId(col, row), local.level, 0);
+        if (reader.DoesTileExist(neighbor)) {
+          neighborhood.insert(neighbor);
+        }
+      }
+    }
+  }
+
+  // edges that end in the neighborhood refer to its nodes and their edges by index
+  std::set<GraphId> affected(neighborhood.begin(), neighborhood.end());
+  for_each_tile(reader, tiles, [&](const graph_tile_ptr& tile, const DirectedEdge& edge) {
+    if (neighborhood.count(edge.endnode().Tile_Base())) {
+      affected.insert(tile->id());
+      return true;
+    }
+    return false;
+  });
+
+  // the hierarchy is formed from the local tiles within the tiles of the higher levels
+  std::vector<GraphId> local_tiles;
+  for (const auto& tile_id : affected) {
+    if (tile_id.level() == local.level) {
+      local_tiles.push_back(tile_id);
+    }
+  }
+  for (const auto& tile_id : local_tiles) {
+    const auto center = local.tiles.Center(tile_id.tileid());
+    for (const auto& level : levels) {
+      if (level.level != local.level) {
+        affected.insert(TileHierarchy::GetGraphId(center, level.level));
+      }
+    }
+  }
+  LOG_INFO(std::to_string(affected.size()) + " tiles are affected by the change");
+  return affected;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
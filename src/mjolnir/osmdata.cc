@@ -498,6 +498,13 @@ bool OSMData::write_to_temp_files(const std::string& tile_dir) {
   file.write(reinterpret_cast<const char*>(&node_exit_to_count), sizeof(uint64_t));
   file.close();
 
+  // Only the node data changes once the rest has been released to the files
+  if (released) {
+    bool status = write_node_names(tile_dir + node_names_file, node_names);
+    LOG_INFO("Done");
+    return status;
+  }
+
   // Write the rest of OSMData
   bool status = write_restrictions(tile_dir + restrictions_file, restrictions) &&
                 write_viaset(tile_dir + viaset_file, via_set) &&
@@ -552,9 +559,34 @@ bool OSMData::read_from_temp_files(const std::string& tile_dir) {
       read_lane_connectivity(tile_directory + lane_connectivity_file, lane_connectivity_map);
   LOG_INFO("Done");
   initialized = status;
+  if (status) {
+    released = false;
+  }
   return status;
 }
 
+// Write OSMData to temporary files and free its memory
+bool OSMData::release_to_temp_files(const std::string& tile_dir) {
+  if (!write_to_temp_files(tile_dir)) {
+    return false;
+  }
+
+  // swap with empty containers, clearing them would keep their buckets. the names are replaced
+  // rather than cleared so that they keep the blank name at index 0
+  LOG_INFO("Release OSMData memory");
+  RestrictionsMultiMap().swap(restrictions);
+  ViaSet().swap(via_set);
+  AccessRestrictionsMultiMap().swap(access_restrictions);
+  BikeMultiMap().swap(bike_relations);
+  OSMStringMap().swap(way_ref);
+  OSMStringMap().swap(way_ref_rev);
+  OSMLaneConnectivityMultiMap().swap(lane_connectivity_map);
+  node_names = UniqueNames();
+  name_offset_map = UniqueNames();
+  released = true;
+  return true;
+}
+
 // Read OSMData from temporary files
 bool OSMData::read_from_unique_names_file(const std::string& tile_dir) {
   LOG_INFO("Read OSMData unique_names from temp file");
@@ -33,6 +33,10 @@
 #else
 #include <netinet/in.h>
 #endif
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <zlib.h>
@@ -81,20 +85,9 @@ BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
   return result;
 }
 
-int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
+int32_t unpack_blob(const char* buffer, int32_t sz, char* unpack_buffer) {
   Blob blob;
 
-  // is the size of the following blob sane
-  int32_t sz = header.datasize();
-  if (sz > MAX_UNCOMPRESSED_BLOB_SIZE) {
-    throw std::runtime_error("blob-size is bigger than allowed");
-  }
-
-  // pull out the bytes
-  if (!file.read(buffer, sz)) {
-    throw std::runtime_error("unable to read blob from file");
-  }
-
   // turn it into a protobuf object
   if (!blob.ParseFromArray(buffer, sz)) {
     throw std::runtime_error("unable to parse blob");
@@ -139,6 +132,24 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   throw std::runtime_error("Unsupported blob data format");
 }
 
+// the size of the blob that follows the header, if its sane
+int32_t blob_size(const BlobHeader& header) {
+  int32_t sz = header.datasize();
+  if (sz > MAX_UNCOMPRESSED_BLOB_SIZE) {
+    throw std::runtime_error("blob-size is bigger than allowed");
+  }
+  return sz;
+}
+
+int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
+  // pull out the bytes
+  int32_t sz = blob_size(header);
+  if (!file.read(buffer, sz)) {
+    throw std::runtime_error("unable to read blob from file");
+  }
+  return unpack_blob(buffer, sz, unpack_buffer);
+}
+
 template <class T> OSMPBF::Tags get_tags(const T& object, const OSMPBF::PrimitiveBlock& primblock) {
   OSMPBF::Tags result(object.keys_size());
   for (int i = 0; i < object.keys_size(); ++i) {
@@ -272,6 +283,192 @@ void parse_header_block(char* unpack_buffer, int32_t sz) {
   // TODO: do something with replication information?
 }
 
+// an object of a block kept to be called back later
+struct object_t {
+  Interest type;
+  uint64_t osmid;
+  double lng, lat;
+  Tags tags;
+  std::vector<uint64_t> nodes;
+  std::vector<Member> members;
+  bool transformed;
+  Tags transformed_tags;
+};
+
+// keeps the objects of a block in the order they would have been called back
+struct recorder_t : public Callback {
+  virtual void node_callback(const uint64_t osmid,
+                             const double lng,
+                             const double lat,
+                             const Tags& tags) override {
+    objects.push_back({NODES, osmid, lng, lat, tags, {}, {}, false, {}});
+  }
+  virtual void way_callback(const uint64_t osmid,
+                            const Tags& tags,
+                            const std::vector<uint64_t>& nodes) override {
+    objects.push_back({WAYS, osmid, 0, 0, tags, nodes, {}, false, {}});
+  }
+  virtual void relation_callback(const uint64_t osmid,
+                                 const Tags& tags,
+                                 const std::vector<Member>& members) override {
+    objects.push_back({RELATIONS, osmid, 0, 0, tags, {}, {}, false, {}});
+    for (const auto& member : members) {
+      objects.back().members.emplace_back(member.member_type, member.member_id, member.role);
+    }
+  }
+  virtual void changeset_callback(const uint64_t changeset_id) override {
+    objects.push_back({CHANGESETS, changeset_id, 0, 0, {}, {}, {}, false, {}});
+  }
+  // a deque because objects cant be copied when it grows
+  std::deque<object_t> objects;
+};
+
+// a blob as it was read from the file
+struct raw_blob_t {
+  std::string type;
+  std::vector<char> bytes;
+  int32_t size;
+};
+
+// decompress, decode and transform a blob
+void decode_blob(const raw_blob_t& raw,
+                 char* unpack_buffer,
+                 const Interest interest,
+                 TagTransform* transform,
+                 recorder_t& recorder) {
+  recorder.objects.clear();
+  int32_t sz = unpack_blob(raw.bytes.data(), raw.size, unpack_buffer);
+  if (raw.type == "OSMData") {
+    parse_primitive_block(unpack_buffer, sz, interest, recorder);
+  } else if (raw.type == "OSMHeader") {
+    parse_header_block(unpack_buffer, sz);
+  }
+
+  if (!transform) {
+    return;
+  }
+  for (auto& object : recorder.objects) {
+    if (object.type != CHANGESETS) {
+      object.transformed =
+          transform->transform(object.type, object.osmid, object.tags, object.transformed_tags);
+    }
+  }
+}
+
+// call back the objects of a block
+void replay(std::deque<object_t>& objects, Callback& callback) {
+  for (auto& object : objects) {
+    callback.transformed_tags = object.transformed ? &object.transformed_tags : nullptr;
+    switch (object.type) {
+      case NODES:
+        callback.node_callback(object.osmid, object.lng, object.lat, object.tags);
+        break;
+      case WAYS:
+        callback.way_callback(object.osmid, object.tags, object.nodes);
+        break;
+      case RELATIONS:
+        callback.relation_callback(object.osmid, object.tags, object.members);
+        break;
+      default:
+        callback.changeset_callback(object.osmid);
+        break;
+    }
+  }
+  callback.transformed_tags = nullptr;
+  objects.clear();
+}
+
+// read up to blobs.size() blobs, returns how many were read
+size_t read_blobs(char* buffer, std::ifstream& file, std::vector<raw_blob_t>& blobs) {
+  size_t count = 0;
+  while (count < blobs.size() && !file.eof()) {
+    bool finished = false;
+    BlobHeader header = read_header(buffer, file, finished);
+    if (finished) {
+      break;
+    }
+    auto& blob = blobs[count];
+    blob.size = blob_size(header);
+    blob.bytes.resize(blob.size);
+    if (!file.read(blob.bytes.data(), blob.size)) {
+      throw std::runtime_error("unable to read blob from file");
+    }
+    if (header.type() != "OSMData" && header.type() != "OSMHeader") {
+      LOG_WARN("Unknown blob type: " + header.type());
+      continue;
+    }
+    blob.type = header.type();
+    ++count;
+  }
+  return count;
+}
+
+void parse_parallel(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const size_t threads) {
+  // each thread gets its own buffer and transform
+  std::vector<std::unique_ptr<char[]>> unpack_buffers;
+  std::vector<std::unique_ptr<TagTransform>> transforms;
+  for (size_t i = 0; i < threads; ++i) {
+    unpack_buffers.emplace_back(new char[MAX_UNCOMPRESSED_BLOB_SIZE]);
+    transforms.emplace_back(callback.tag_transform());
+  }
+  std::unique_ptr<char[]> buffer(new char[MAX_BLOB_HEADER_SIZE]);
+
+  // while the threads decode a round of blobs this thread calls back the previous round and reads
+  // the next one, so at most 3 rounds are held in memory
+  const size_t round = threads * 2;
+  std::vector<raw_blob_t> reading(round), decoding(round);
+  std::vector<recorder_t> decoded(round), replaying(round);
+  std::vector<std::exception_ptr> errors(round);
+  size_t decoding_count = read_blobs(buffer.get(), file, decoding);
+  size_t replaying_count = 0;
+  while (decoding_count > 0 || replaying_count > 0) {
+    std::atomic<size_t> next_blob{0};
+    auto decode = [&](const size_t thread) {
+      for (size_t i = next_blob++; i < decoding_count; i = next_blob++) {
+        try {
+          decode_blob(decoding[i], unpack_buffers[thread].get(), interest,
+                      transforms[thread].get(), decoded[i]);
+        } catch (...) { errors[i] = std::current_exception(); }
+      }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+      workers.emplace_back(decode, i);
+    }
+
+    // the workers have to be joined whatever happens here
+    std::exception_ptr error;
+    size_t reading_count = 0;
+    try {
+      for (size_t i = 0; i < replaying_count; ++i) {
+        replay(replaying[i].objects, callback);
+      }
+      reading_count = decoding_count > 0 ? read_blobs(buffer.get(), file, reading) : 0;
+    } catch (...) { error = std::current_exception(); }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    for (size_t i = 0; i < decoding_count; ++i) {
+      if (errors[i]) {
+        std::rethrow_exception(errors[i]);
+      }
+    }
+
+    // what was decoded is called back next and what was read is decoded next
+    replaying.swap(decoded);
+    replaying_count = decoding_count;
+    decoding.swap(reading);
+    decoding_count = reading_count;
+  }
+}
+
 } // namespace
 
 // extend the protobuf osmpbf namespace
@@ -285,14 +482,23 @@ Member::Member(Member&& other)
     : member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
 }
 
-void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback) {
-  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-
+void Parser::parse(std::ifstream& file,
+                   const Interest interest,
+                   Callback& callback,
+                   const size_t threads) {
   // start from the top
   file.clear();
   file.seekg(0, std::ios::beg);
 
+  // decode in parallel but call back in order
+  if (threads > 1) {
+    parse_parallel(file, interest, callback, threads);
+    return;
+  }
+
+  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
+  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
+
   // while there is more to read
   while (!file.eof()) {
     // grab the blob header
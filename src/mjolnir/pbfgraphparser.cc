@@ -18,6 +18,7 @@
 #include "midgard/polyline2.h"
 #include "midgard/sequence.h"
 #include "midgard/tiles.h"
+#include "mjolnir/graphtagtransform.h"
 #include "mjolnir/luatagtransform.h"
 #include "mjolnir/osmaccess.h"
 #include "mjolnir/osmpbfparser.h"
@@ -140,6 +141,46 @@ private:
   std::unordered_map<uint64_t, loop_meta> loops_meta_;
 };
 
+// Transforms tags with a lua state running the script or, without a script, with the compiled
+// rules of the default lua/graph.lua
+class tag_transformer {
+public:
+  explicit tag_transformer(const std::string& lua)
+      : lua_(lua.empty() ? nullptr : std::make_unique<LuaTagTransform>(lua)) {
+  }
+
+  Tags Transform(const OSMType type, const uint64_t osmid, const Tags& tags) {
+    return lua_ ? lua_->Transform(type, osmid, tags) : graph_.Transform(type, osmid, tags);
+  }
+
+private:
+  std::unique_ptr<LuaTagTransform> lua_;
+  GraphTagTransform graph_;
+};
+
+// Runs the tag transformation on a parsing thread
+struct lua_transform : public OSMPBF::TagTransform {
+  explicit lua_transform(const std::string& lua) : lua_(lua) {
+  }
+
+  virtual bool transform(const OSMPBF::Interest type,
+                         const uint64_t osmid,
+                         const OSMPBF::Tags& tags,
+                         OSMPBF::Tags& transformed) override {
+    // the callbacks have defaults for objects without tags
+    if (tags.empty()) {
+      return false;
+    }
+    transformed = lua_.Transform(type == OSMPBF::Interest::NODES  ? OSMType::kNode
+                                 : type == OSMPBF::Interest::WAYS ? OSMType::kWay
+                                                                  : OSMType::kRelation,
+                                 osmid, tags);
+    return true;
+  }
+
+  tag_transformer lua_;
+};
+
 // Construct PBFGraphParser based on properties file and input PBF extract
 struct graph_callback : public OSMPBF::Callback {
 public:
@@ -149,7 +190,7 @@ public:
   }
 
   graph_callback(const boost::property_tree::ptree& pt, OSMData& osmdata)
-      : lua_(get_lua(pt)), osmdata_(osmdata) {
+      : lua_script_(get_lua(pt)), lua_(lua_script_), osmdata_(osmdata) {
     current_way_node_index_ = last_node_ = last_way_ = last_relation_ = 0;
 
     highway_cutoff_rc_ = RoadClass::kPrimary;
@@ -1422,7 +1463,20 @@ public:
       }
       return std::string((std::istreambuf_iterator<char>(lua)), std::istreambuf_iterator<char>());
     }
-    return std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len);
+    // the compiled rules stand in for the default lua unless it is asked for
+    if (pt.get<bool>("lua_tag_transform", false)) {
+      return std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len);
+    }
+    return {};
+  }
+
+  virtual std::unique_ptr<OSMPBF::TagTransform> tag_transform() override {
+    return std::make_unique<lua_transform>(lua_script_);
+  }
+
+  // the tags as transformed on a parsing thread or by our own transformer
+  Tags transform(const OSMType type, const uint64_t osmid, const OSMPBF::Tags& tags) {
+    return transformed_tags ? *transformed_tags : lua_.Transform(type, osmid, tags);
   }
 
   virtual void node_callback(const uint64_t osmid,
@@ -1440,7 +1494,7 @@ public:
     if (bss_nodes_) {
       // Get tags - do't bother with Lua callout if the taglist is empty
       if (tags.size() > 0) {
-        results = lua_.Transform(OSMType::kNode, osmid, tags);
+        results = transform(OSMType::kNode, osmid, tags);
       } else {
         results = empty_node_results_;
       }
@@ -1510,7 +1564,7 @@ public:
     // Get tags if not already available.  Don't bother calling Lua if there
     // are no OSM tags to process.
     if (tags.size() > 0) {
-      results = results ? results : lua_.Transform(OSMType::kNode, osmid, tags);
+      results = results ? results : transform(OSMType::kNode, osmid, tags);
     } else {
       results = results ? results : empty_node_results_;
     }
@@ -1714,7 +1768,7 @@ public:
     // Transform tags. If no results that means the way does not have tags
     // suitable for use in routing.
     Tags results =
-        tags.size() == 0 ? empty_way_results_ : lua_.Transform(OSMType::kWay, osmid_, tags);
+        tags.size() == 0 ? empty_way_results_ : transform(OSMType::kWay, osmid_, tags);
     if (results.size() == 0) {
       return;
     }
@@ -2213,7 +2267,7 @@ public:
 
     // Get tags
     Tags results =
-        tags.empty() ? empty_relation_results_ : lua_.Transform(OSMType::kRelation, osmid, tags);
+        tags.empty() ? empty_relation_results_ : transform(OSMType::kRelation, osmid, tags);
     if (results.size() == 0) {
       return;
     }
@@ -2995,8 +3049,9 @@ public:
   // Road class assignment needs to be set to the highway cutoff for ferries and auto trains.
   RoadClass highway_cutoff_rc_;
 
-  // Lua Tag Transformation class
-  LuaTagTransform lua_;
+  // Tag Transformation class, the parsing threads get their own from the same script
+  std::string lua_script_;
+  tag_transformer lua_;
 
   // Pointer to all the OSM data (for use by callbacks)
   OSMData& osmdata_;
@@ -3042,12 +3097,11 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
                                   const std::string& way_nodes_file,
                                   const std::string& access_file,
                                   const std::string& pronunciation_file) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  // the blobs are decoded and their tags transformed on these threads, the callbacks that fill
+  // the osmdata still run one at a time in the order of the file
+  unsigned int threads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   OSMData osmdata{};
@@ -3078,7 +3132,7 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
 
   // Clarifies types of loop roads and saves fixed ways.
@@ -3115,12 +3169,11 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
                                     const std::string& complex_restriction_from_file,
                                     const std::string& complex_restriction_to_file,
                                     OSMData& osmdata) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  // the blobs are decoded and their tags transformed on these threads, the callbacks that fill
+  // the osmdata still run one at a time in the order of the file
+  unsigned int threads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   graph_callback callback(pt, osmdata);
@@ -3153,7 +3206,7 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
   LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) + " simple restrictions");
   LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) +
@@ -3184,12 +3237,11 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
                                 const std::string& way_nodes_file,
                                 const std::string& bss_nodes_file,
                                 OSMData& osmdata) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  // the blobs are decoded and their tags transformed on these threads, the callbacks that fill
+  // the osmdata still run one at a time in the order of the file
+  unsigned int threads =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   graph_callback callback(pt, osmdata);
@@ -3221,7 +3273,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
       callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
                      new sequence<OSMNode>(bss_nodes_file, create));
       OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES),
-                            callback);
+                            callback, threads);
       create = false;
     }
     // Since the sequence must be flushed before reading it...
@@ -3238,7 +3290,8 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
     way_nodes.sort(
-        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; });
+        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; },
+        sequence<OSMWayNode>::sort_buffer_size, threads);
   }
 
   // Parse node in all the input files. Skip any that are not marked from
@@ -3255,7 +3308,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
   uint64_t max_osm_id = callback.last_node_;
   callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
@@ -3267,13 +3320,15 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm way node references by way index and node shape index...");
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
-    way_nodes.sort([](const OSMWayNode& a, const OSMWayNode& b) {
-      if (a.way_index == b.way_index) {
-        // TODO: if its equal we have screwed something up, should we check and throw here?
-        return a.way_shape_node_index < b.way_shape_node_index;
-      }
-      return a.way_index < b.way_index;
-    });
+    way_nodes.sort(
+        [](const OSMWayNode& a, const OSMWayNode& b) {
+          if (a.way_index == b.way_index) {
+            // TODO: if its equal we have screwed something up, should we check and throw here?
+            return a.way_shape_node_index < b.way_shape_node_index;
+          }
+          return a.way_index < b.way_index;
+        },
+        sequence<OSMWayNode>::sort_buffer_size, threads);
   }
 
   // Some OSM extracts do not have changeset Ids. For these set the max changeset Id
@@ -0,0 +1,505 @@
+#include "mjolnir/regioncut.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/complexrestrictionbuilder.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// The new index of a node or directed edge that is cut
+constexpr uint32_t kCut = std::numeric_limits<uint32_t>::max();
+
+// What the region keeps of a tile it touches
+struct cut_tile_t {
+  bool covered = false;                 // the region covers the whole tile
+  multi_polygon_type clipped;           // the part of the region in the tile when it does not
+  std::vector<uint32_t> nodes;          // new index of every node
+  std::vector<uint32_t> old_edge_index; // index of the first edge of every node
+  std::vector<uint32_t> new_edge_index; // new index of the first edge of every node that is kept
+  std::vector<uint32_t> edges;          // new index of every directed edge
+};
+using cut_tiles_t = std::unordered_map<GraphId, cut_tile_t>;
+
+struct stats_t {
+  std::atomic<uint64_t> copied_tiles{0};
+  std::atomic<uint64_t> rebuilt_tiles{0};
+  std::atomic<uint64_t> nodes{0};
+  std::atomic<uint64_t> edges{0};
+  std::atomic<uint64_t> cut_nodes{0};
+  std::atomic<uint64_t> cut_edges{0};
+};
+
+// The new id of a node or directed edge, an invalid id if it is cut
+GraphId renumber(const cut_tiles_t& tiles,
+                 const GraphId& id,
+                 std::vector<uint32_t> cut_tile_t::*indices) {
+  const auto tile = tiles.find(id.Tile_Base());
+  if (tile == tiles.end() || id.id() >= (tile->second.*indices).size() ||
+      (tile->second.*indices)[id.id()] == kCut) {
+    return {};
+  }
+  return GraphId(id.tileid(), id.level(), (tile->second.*indices)[id.id()]);
+}
+
+bool covers(const cut_tile_t& tile, const PointLL& ll) {
+  return tile.covered ||
+         boost::geometry::covered_by(point_type(ll.lng(), ll.lat()), tile.clipped);
+}
+
+// Whether the region covers a point, looked up in the part of the region in the tile of the point
+bool covers(const cut_tiles_t& tiles, const PointLL& ll, const uint8_t level) {
+  const auto tile = tiles.find(TileHierarchy::GetGraphId(ll, level));
+  return tile != tiles.end() && covers(tile->second, ll);
+}
+
+// The complex restrictions kept in a tile, the forward ones with the edge they end on and the
+// reverse ones with the edge they start on
+std::vector<ComplexRestriction*> complex_restrictions(const graph_tile_ptr& tile,
+                                                      const bool forward) {
+  std::vector<ComplexRestriction*> restrictions;
+  GraphId edge_id = tile->id();
+  for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edge_id) {
+    auto edge_restrictions = tile->GetRestrictions(forward, edge_id, kAllAccess);
+    restrictions.insert(restrictions.end(), edge_restrictions.begin(), edge_restrictions.end());
+  }
+  return restrictions;
+}
+
+// Runs a pass over the tiles on the threads, each with a reader of its own
+void run(const std::string& stage,
+         const std::vector<GraphId>& tile_ids,
+         const boost::property_tree::ptree& config,
+         const size_t threads,
+         const std::function<void(GraphReader&, const GraphId&)>& pass) {
+  TileScheduler scheduler(stage, tile_ids, threads,
+                          TileScheduler::FileSize(config.get<std::string>("tile_dir", "")));
+  std::vector<std::exception_ptr> errors(scheduler.workers());
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < scheduler.workers(); ++worker) {
+    workers.emplace_back([&, worker]() {
+      try {
+        GraphReader reader(config);
+        GraphId tile_id;
+        while (scheduler.Next(worker, tile_id)) {
+          pass(reader, tile_id);
+          if (reader.OverCommitted()) {
+            reader.Trim();
+          }
+        }
+      } catch (...) { errors[worker] = std::current_exception(); }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  scheduler.LogUtilization();
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Keep the nodes the region covers
+void cut_nodes(GraphReader& reader, const GraphId& tile_id, cut_tiles_t& tiles, stats_t& stats) {
+  auto& cut = tiles.at(tile_id);
+  graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+  const uint32_t node_count = tile->header()->nodecount();
+  cut.nodes.resize(node_count);
+  cut.old_edge_index.resize(node_count);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < node_count; ++i) {
+    const NodeInfo* node = tile->node(i);
+    cut.old_edge_index[i] = node->edge_index();
+    cut.nodes[i] = covers(cut, node->latlng(tile->header()->base_ll())) ? kept++ : kCut;
+  }
+  stats.cut_nodes += node_count - kept;
+}
+
+// Keep the edges between the nodes that are kept, shortcuts only when the region covers them
+void cut_edges(GraphReader& reader, const GraphId& tile_id, cut_tiles_t& tiles, stats_t& stats) {
+  auto& cut = tiles.at(tile_id);
+  graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+  cut.edges.assign(tile->header()->directededgecount(), kCut);
+  cut.new_edge_index.assign(cut.nodes.size(), kCut);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < cut.nodes.size(); ++i) {
+    if (cut.nodes[i] == kCut) {
+      continue;
+    }
+    cut.new_edge_index[i] = kept;
+    const NodeInfo* node = tile->node(i);
+    for (uint32_t j = node->edge_index(); j < node->edge_index() + node->edge_count(); ++j) {
+      const DirectedEdge* edge = tile->directededge(j);
+      if (!renumber(tiles, edge->endnode(), &cut_tile_t::nodes).Is_Valid()) {
+        continue;
+      }
+      if (edge->is_shortcut()) {
+        const auto edgeinfo = tile->edgeinfo(edge);
+        const auto& shape = edgeinfo.shape();
+        if (!std::all_of(shape.begin(), shape.end(), [&](const PointLL& ll) {
+              return covers(tiles, ll, tile_id.level());
+            })) {
+          continue;
+        }
+      }
+      cut.edges[j] = kept++;
+    }
+  }
+  stats.cut_edges += cut.edges.size() - kept;
+}
+
+// Whether nothing the tile refers to is cut or renumbered
+bool unchanged(const graph_tile_ptr& tile, const cut_tile_t& cut, const cut_tiles_t& tiles) {
+  auto same = [&tiles](const GraphId& id, std::vector<uint32_t> cut_tile_t::*indices) {
+    return renumber(tiles, id, indices) == id;
+  };
+  if (std::count(cut.nodes.begin(), cut.nodes.end(), kCut) ||
+      std::count(cut.edges.begin(), cut.edges.end(), kCut)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+    if (!same(tile->directededge(i)->endnode(), &cut_tile_t::nodes)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < tile->header()->transitioncount(); ++i) {
+    if (!same(tile->transition(i)->endnode(), &cut_tile_t::nodes)) {
+      return false;
+    }
+  }
+  for (const bool forward : {true, false}) {
+    for (const auto* restriction : complex_restrictions(tile, forward)) {
+      bool vias_same = true;
+      restriction->WalkVias([&](const GraphId* via) {
+        vias_same = same(*via, &cut_tile_t::edges);
+        return vias_same ? WalkingVia::KeepWalking : WalkingVia::StopWalking;
+      });
+      if (!vias_same || !same(restriction->from_graphid(), &cut_tile_t::edges) ||
+          !same(restriction->to_graphid(), &cut_tile_t::edges)) {
+        return false;
+      }
+    }
+  }
+  for (size_t i = 0; i < kBinCount; ++i) {
+    for (const auto& edge_id : tile->GetBin(i)) {
+      if (!same(edge_id, &cut_tile_t::edges)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Write the tile as it is
+void copy_tile(const graph_tile_ptr& tile, const std::string& out_dir) {
+  filesystem::path file(out_dir + filesystem::path::preferred_separator +
+                        GraphTile::FileSuffix(tile->id()));
+  if (!filesystem::exists(file.parent_path())) {
+    filesystem::create_directories(file.parent_path());
+  }
+  std::ofstream out(file.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(tile->header()), tile->header()->end_offset());
+  if (!out) {
+    throw std::runtime_error("Failed to write " + file.string());
+  }
+}
+
+// Write the tile again with what is kept of it and renumbered references
+void rebuild_tile(const graph_tile_ptr& tile,
+                  const cut_tile_t& cut,
+                  const cut_tiles_t& tiles,
+                  const std::string& out_dir,
+                  stats_t& stats) {
+  const GraphId tile_id = tile->id();
+
+  // the bins of the tile with the edges that pass through it
+  std::array<std::vector<GraphId>, kBinCount> bins;
+  bool binned = false;
+  for (size_t i = 0; i < kBinCount; ++i) {
+    for (const auto& edge_id : tile->GetBin(i)) {
+      const auto new_id = renumber(tiles, edge_id, &cut_tile_t::edges);
+      if (new_id.Is_Valid()) {
+        bins[i].push_back(new_id);
+        binned = true;
+      }
+    }
+  }
+  if (!binned &&
+      std::all_of(cut.nodes.begin(), cut.nodes.end(), [](uint32_t n) { return n == kCut; })) {
+    return;
+  }
+
+  // the header as it was, without the sections that are not written again
+  GraphTileBuilder tilebuilder(out_dir, tile_id, false);
+  auto& header = tilebuilder.header_builder();
+  header = *tile->header();
+  const uint32_t no_bins[kBinCount] = {};
+  header.set_edge_bin_offsets(no_bins);
+  header.set_predictedspeeds_offset(0);
+  header.set_predictedspeeds_count(0);
+  header.set_reach_offset(0);
+  header.set_opposing_offset(0);
+  header.set_elevation_offset(0);
+
+  std::hash<std::string> hasher;
+  std::vector<std::pair<uint32_t, std::array<int16_t, kCoefficientCount>>> profiles;
+  std::vector<EdgeElevation> elevations;
+  for (uint32_t i = 0; i < cut.nodes.size(); ++i) {
+    if (cut.nodes[i] == kCut) {
+      continue;
+    }
+    const GraphId nodeid(tile_id.tileid(), tile_id.level(), i);
+    const NodeInfo* nodeinfo = tile->node(i);
+    NodeInfo node = *nodeinfo;
+
+    // transitions to the same node on the other levels, which the region keeps too
+    node.set_transition_index(tilebuilder.transitions().size());
+    for (uint32_t t = 0; t < nodeinfo->transition_count(); ++t) {
+      const NodeTransition* transition = tile->transition(nodeinfo->transition_index() + t);
+      const auto endnode = renumber(tiles, transition->endnode(), &cut_tile_t::nodes);
+      if (endnode.Is_Valid()) {
+        tilebuilder.transitions().emplace_back(endnode, transition->up());
+      }
+    }
+    node.set_transition_count(tilebuilder.transitions().size() - node.transition_index());
+
+    // the edges superseded by a shortcut that is cut are no longer superseded
+    uint32_t cut_shortcuts = 0;
+    for (uint32_t j = nodeinfo->edge_index(); j < nodeinfo->edge_index() + nodeinfo->edge_count();
+         ++j) {
+      if (cut.edges[j] == kCut) {
+        cut_shortcuts |= tile->directededge(j)->shortcut();
+      }
+    }
+
+    node.set_edge_index(tilebuilder.directededges().size());
+    for (uint32_t j = nodeinfo->edge_index(); j < nodeinfo->edge_index() + nodeinfo->edge_count();
+         ++j) {
+      if (cut.edges[j] == kCut) {
+        continue;
+      }
+      const DirectedEdge* directededge = tile->directededge(j);
+      const uint32_t idx = tilebuilder.directededges().size();
+      DirectedEdge newedge = *directededge;
+
+      // the end node and the opposing edge there, which is kept with the edge
+      const GraphId endnode = directededge->endnode();
+      const auto& end_cut = tiles.at(endnode.Tile_Base());
+      newedge.set_endnode(renumber(tiles, endnode, &cut_tile_t::nodes));
+      newedge.set_opp_index(
+          end_cut.edges[end_cut.old_edge_index[endnode.id()] + directededge->opp_index()] -
+          end_cut.new_edge_index[endnode.id()]);
+      if (newedge.superseded() & cut_shortcuts) {
+        newedge.set_superseded(0);
+      }
+
+      if (directededge->sign()) {
+        tilebuilder.AddSigns(idx, tile->GetSigns(j));
+      }
+      if (directededge->turnlanes()) {
+        tilebuilder.AddTurnLanes(idx, tile->GetName(tile->turnlanes_offset(j)));
+      }
+      if (directededge->access_restriction()) {
+        for (const auto& res : tile->GetAccessRestrictions(j, kAllAccess)) {
+          tilebuilder.AddAccessRestriction(
+              AccessRestriction(idx, res.type(), res.modes(), res.value()));
+        }
+      }
+      if (directededge->laneconnectivity()) {
+        auto laneconnectivity = tile->GetLaneConnectivity(j);
+        for (auto& lc : laneconnectivity) {
+          lc.set_to(idx);
+        }
+        tilebuilder.AddLaneConnectivity(laneconnectivity);
+      }
+
+      // edge info is shared by the two directions of an edge, and on the upper levels by edges
+      // that start in different tiles, so it is told apart by its shape and way id like
+      // GraphFilter does
+      bool added;
+      auto edgeinfo = tile->edgeinfo(directededge);
+      std::string encoded_shape = edgeinfo.encoded_shape();
+      uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
+      newedge.set_edgeinfo_offset(
+          tilebuilder.AddEdgeInfo(w, nodeid, endnode, edgeinfo.wayid(), edgeinfo.mean_elevation(),
+                                  edgeinfo.bike_network(), edgeinfo.speed_limit(), encoded_shape,
+                                  edgeinfo.GetNames(), edgeinfo.GetTaggedValues(),
+                                  edgeinfo.GetTaggedValues(true), edgeinfo.GetTypes(), added));
+
+      if (tile->header()->has_ext_directededge()) {
+        tilebuilder.directededges_ext().push_back(*tile->ext_directededge(j));
+      }
+      if (directededge->has_predicted_speed()) {
+        profiles.emplace_back(idx, tile->GetSpeedProfile(j));
+      }
+      if (tile->has_edge_elevation()) {
+        elevations.push_back(tile->edge_elevation(j));
+      }
+      tilebuilder.directededges().emplace_back(std::move(newedge));
+    }
+    node.set_edge_count(tilebuilder.directededges().size() - node.edge_index());
+
+    const auto& admin = tile->admininfo(nodeinfo->admin_index());
+    node.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                              admin.country_iso(), admin.state_iso()));
+    tilebuilder.nodes().push_back(node);
+    if (nodeinfo->named_intersection()) {
+      tilebuilder.AddSigns(tilebuilder.nodes().size() - 1, tile->GetSigns(i, true));
+    }
+  }
+
+  for (const bool forward : {true, false}) {
+    for (const auto* restriction : complex_restrictions(tile, forward)) {
+      std::vector<GraphId> vias;
+      restriction->WalkVias([&](const GraphId* via) {
+        vias.push_back(renumber(tiles, *via, &cut_tile_t::edges));
+        return WalkingVia::KeepWalking;
+      });
+      ComplexRestrictionBuilder res(*restriction);
+      res.set_from_id(renumber(tiles, restriction->from_graphid(), &cut_tile_t::edges));
+      res.set_to_id(renumber(tiles, restriction->to_graphid(), &cut_tile_t::edges));
+      res.set_via_list(vias);
+      if (!res.from_graphid().Is_Valid() || !res.to_graphid().Is_Valid() ||
+          std::any_of(vias.begin(), vias.end(),
+                      [](const GraphId& via) { return !via.Is_Valid(); })) {
+        continue;
+      }
+      if (forward) {
+        tilebuilder.AddForwardComplexRestriction(res);
+      } else {
+        tilebuilder.AddReverseComplexRestriction(res);
+      }
+    }
+  }
+  tilebuilder.StoreTileData();
+  stats.nodes += tilebuilder.nodes().size();
+  stats.edges += tilebuilder.directededges().size();
+  ++stats.rebuilt_tiles;
+
+  // the sections that go after the tile data, in the order the build adds them
+  if (binned) {
+    GraphTileBuilder::AddBins(out_dir, GraphTile::Create(out_dir, tile_id), bins);
+  }
+  if (!profiles.empty()) {
+    GraphTileBuilder speeds(out_dir, tile_id, false);
+    for (const auto& profile : profiles) {
+      speeds.AddPredictedSpeed(profile.first, profile.second, profiles.size());
+    }
+    speeds.UpdatePredictedSpeeds(tilebuilder.directededges());
+  }
+  if (!elevations.empty()) {
+    GraphTileBuilder(out_dir, tile_id, false).UpdateEdgeElevation(elevations);
+  }
+}
+
+void write_tile(GraphReader& reader,
+                const GraphId& tile_id,
+                const cut_tiles_t& tiles,
+                const std::string& out_dir,
+                stats_t& stats) {
+  const auto& cut = tiles.at(tile_id);
+  graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+  if (unchanged(tile, cut, tiles)) {
+    copy_tile(tile, out_dir);
+    stats.nodes += tile->header()->nodecount();
+    stats.edges += tile->header()->directededgecount();
+    ++stats.copied_tiles;
+  } else {
+    rebuild_tile(tile, cut, tiles, out_dir, stats);
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+RegionCut::Stats RegionCut::Cut(const boost::property_tree::ptree& config,
+                                multi_polygon_type region,
+                                const std::string& out_dir,
+                                size_t threads) {
+  const auto tile_dir = config.get<std::string>("tile_dir", "");
+  if (out_dir.empty() || out_dir == tile_dir) {
+    throw std::runtime_error("The region has to be cut into a directory other than the tile_dir");
+  }
+  boost::geometry::correct(region);
+  box_type envelope;
+  boost::geometry::envelope(region, envelope);
+
+  // the tiles of the graph levels the region touches, transit is not cut
+  cut_tiles_t tiles;
+  std::vector<GraphId> tile_ids;
+  {
+    GraphReader reader(config);
+    for (const auto& level : TileHierarchy::levels()) {
+      for (const auto& tile_id : reader.GetTileSet(level.level)) {
+        const auto bbox = TileHierarchy::GetGraphIdBoundingBox(tile_id);
+        const box_type box(point_type(bbox.minx(), bbox.miny()),
+                           point_type(bbox.maxx(), bbox.maxy()));
+        if (!boost::geometry::intersects(box, envelope) ||
+            !boost::geometry::intersects(box, region)) {
+          continue;
+        }
+        // the region covers the tile when all of it is left after clipping the region to it
+        auto& cut = tiles[tile_id];
+        boost::geometry::intersection(box, region, cut.clipped);
+        cut.covered = boost::geometry::area(cut.clipped) >=
+                      boost::geometry::area(box) * (1 - std::numeric_limits<float>::epsilon());
+        if (cut.covered) {
+          cut.clipped.clear();
+        }
+        tile_ids.push_back(tile_id);
+      }
+    }
+  }
+  LOG_INFO("The region touches " + std::to_string(tile_ids.size()) + " tiles");
+
+  // the passes only change the entry of the tile they work on, the map itself stays as it is
+  stats_t stats;
+  threads = std::max(threads, static_cast<size_t>(1));
+  run("Cutting nodes", tile_ids, config, threads, [&](GraphReader& reader, const GraphId& tile_id) {
+    cut_nodes(reader, tile_id, tiles, stats);
+  });
+  run("Cutting edges", tile_ids, config, threads, [&](GraphReader& reader, const GraphId& tile_id) {
+    cut_edges(reader, tile_id, tiles, stats);
+  });
+  run("Writing the cut tiles", tile_ids, config, threads,
+      [&](GraphReader& reader, const GraphId& tile_id) {
+        write_tile(reader, tile_id, tiles, out_dir, stats);
+      });
+
+  Stats result;
+  result.copied_tiles = stats.copied_tiles;
+  result.rebuilt_tiles = stats.rebuilt_tiles;
+  result.nodes = stats.nodes;
+  result.edges = stats.edges;
+  result.cut_nodes = stats.cut_nodes;
+  result.cut_edges = stats.cut_edges;
+  return result;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -3,9 +3,9 @@
 #include "mjolnir/dataquality.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/osmrestriction.h"
+#include "mjolnir/tilescheduler.h"
 
 #include <future>
-#include <queue>
 #include <set>
 #include <thread>
 #include <unordered_set>
@@ -323,7 +323,8 @@ void HandleOnlyRestrictionProperties(const std::vector<Result>& results,
 void build(const std::string& complex_restriction_from_file,
            const std::string& complex_restriction_to_file,
            const boost::property_tree::ptree& hierarchy_properties,
-           std::queue<GraphId>& tilequeue,
+           TileScheduler& scheduler,
+           size_t worker,
            std::mutex& lock,
            std::promise<Result>& result) {
   sequence<OSMRestriction> complex_restrictions_from(complex_restriction_from_file, false);
@@ -332,17 +333,11 @@ void build(const std::string& complex_restriction_from_file,
   GraphReader reader(hierarchy_properties);
   Result stats;
 
-  // Iterate through the tiles in the queue and perform enhancements
-  while (true) {
-    // Get the next tile Id from the queue and get writeable and readable
-    // tile. Lock while we access the tile queue and get the tile.
+  // Iterate through the tiles of the scheduler and perform enhancements
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
+    // Get writeable and readable tile. Lock while we get the tile.
     lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop();
 
     // Get a readable tile. If the tile is empty, skip it. Empty tiles are
     // added where ways go through a tile but no end not is within the tile.
@@ -731,32 +726,30 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
   boost::property_tree::ptree hierarchy_properties = pt.get_child("mjolnir");
   GraphReader reader(hierarchy_properties);
   for (auto tl = TileHierarchy::levels().rbegin(); tl != TileHierarchy::levels().rend(); ++tl) {
-    // Create a randomized queue of tiles to work from
-    std::deque<GraphId> tempqueue;
-    auto level_tiles = reader.GetTileSet(tl->level);
-    for (const auto& tile_id : level_tiles) {
-      tempqueue.emplace_back(tile_id);
-    }
-    std::random_device rd;
-    std::shuffle(tempqueue.begin(), tempqueue.end(), std::mt19937(rd()));
-    std::queue<GraphId> tilequeue(tempqueue);
-
-    // An atomic object we can use to do the synchronization
-    std::mutex lock;
     // A place to hold worker threads and their results, exceptions or otherwise
-
     std::vector<std::shared_ptr<std::thread>> threads(
         std::max(static_cast<unsigned int>(1),
                  pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
     // Hold the results (DataQuality/stats) for the threads
     std::vector<std::promise<Result>> promises(threads.size());
 
+    // Schedule the tiles of the level in batches of neighbours, the restrictions that cross tiles
+    // are walked through the neighbours so those tend to be in the cache already
+    auto level_tiles = reader.GetTileSet(tl->level);
+    TileScheduler scheduler("Adding restrictions at level " + std::to_string(tl->level),
+                            {level_tiles.begin(), level_tiles.end()}, threads.size(),
+                            TileScheduler::FileSize(reader.tile_dir()),
+                            TileScheduler::kNeighbourBatch);
+
+    // An atomic object we can use to do the synchronization
+    std::mutex lock;
+
     // Start the threads
     LOG_INFO("Adding Restrictions at level " + std::to_string(tl->level));
     for (size_t i = 0; i < threads.size(); ++i) {
       threads[i].reset(new std::thread(build, std::cref(complex_from_restrictions_file),
                                        std::cref(complex_to_restrictions_file),
-                                       std::cref(hierarchy_properties), std::ref(tilequeue),
+                                       std::cref(hierarchy_properties), std::ref(scheduler), i,
                                        std::ref(lock), std::ref(promises[i])));
     }
 
@@ -764,6 +757,7 @@ void RestrictionBuilder::Build(const boost::property_tree::ptree& pt,
     for (auto& thread : threads) {
       thread->join();
     }
+    scheduler.LogUtilization();
 
     std::vector<Result> results;
     for (auto& p : promises) {
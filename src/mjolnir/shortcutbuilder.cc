@@ -3,12 +3,17 @@
 
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <future>
 #include <iostream>
+#include <list>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -17,9 +22,11 @@
 #include "baldr/graphreader.h"
 #include "baldr/graphtile.h"
 #include "baldr/tilehierarchy.h"
+#include "filesystem.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "mjolnir/tilescheduler.h"
 #include "mjolnir/util.h"
 #include "sif/osrm_car_duration.h"
 
@@ -571,157 +578,171 @@ uint32_t AddShortcutEdges(GraphReader& reader,
   return shortcut_count;
 }
 
-// Form shortcuts for tiles in this level.
-uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
-  // Iterate through the tiles at this level (TODO - can we mark the tiles
-  // the tiles that shortcuts end within?)
-  reader.Clear();
-  bool added = false;
-  uint32_t shortcut_count = 0;
-  uint32_t ntiles = level.tiles.TileCount();
-  uint32_t tile_level = (uint32_t)level.level;
-  graph_tile_ptr tile;
-  for (uint32_t tileid = 0; tileid < ntiles; tileid++) {
-    // Get the graph tile. Skip if no tile exists (common case)
-    tile = reader.GetGraphTile(GraphId(tileid, tile_level, 0));
-    if (!tile) {
-      continue;
-    }
+// Form shortcuts for the tiles of a level the scheduler hands this worker. The new tiles are
+// written to the staging directory so all the workers keep reading the tiles of the level as
+// they were before any shortcuts were added.
+void FormShortcuts(const boost::property_tree::ptree& hierarchy_properties,
+                   const std::string& staging_dir,
+                   TileScheduler& scheduler,
+                   size_t worker,
+                   std::promise<uint32_t>& result) {
+  try {
+    // Local graphreader for this thread
+    GraphReader reader(hierarchy_properties);
+    bool added = false;
+    uint32_t shortcut_count = 0;
+    GraphId new_tile;
+    while (scheduler.Next(worker, new_tile)) {
+      // Get the graph tile. Skip if no tile exists
+      graph_tile_ptr tile = reader.GetGraphTile(new_tile);
+      if (!tile) {
+        continue;
+      }
 
-    // Create GraphTileBuilder for the new tile
-    GraphId new_tile(tileid, tile_level, 0);
-    GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile, false);
+      // Create GraphTileBuilder for the new tile
+      uint32_t tileid = new_tile.tileid();
+      uint32_t tile_level = new_tile.level();
+      GraphTileBuilder tilebuilder(staging_dir, new_tile, false);
 
-    // Since the old tile is not serialized we must copy any data that is not
-    // dependent on edge Id into the new builders (e.g., node transitions)
-    if (tile->header()->transitioncount() > 0) {
-      for (uint32_t i = 0; i < tile->header()->transitioncount(); ++i) {
-        tilebuilder.transitions().emplace_back(std::move(*(tile->transition(i))));
+      // There is no tile in the staging directory to take the header from, copy it from the tile
+      tilebuilder.header_builder() = *tile->header();
+      tilebuilder.header_builder().set_graphid(new_tile);
+
+      // Since the old tile is not serialized we must copy any data that is not
+      // dependent on edge Id into the new builders (e.g., node transitions)
+      if (tile->header()->transitioncount() > 0) {
+        for (uint32_t i = 0; i < tile->header()->transitioncount(); ++i) {
+          tilebuilder.transitions().emplace_back(std::move(*(tile->transition(i))));
+        }
       }
-    }
 
-    // Iterate through the nodes in the tile
-    GraphId node_id(tileid, tile_level, 0);
-    for (uint32_t n = 0; n < tile->header()->nodecount(); n++, ++node_id) {
-      // Get the node info, copy node index and count from old tile
-      NodeInfo nodeinfo = *(tile->node(node_id));
-      uint32_t old_edge_index = nodeinfo.edge_index();
-      uint32_t old_edge_count = nodeinfo.edge_count();
-
-      // Update node information
-      const auto& admin = tile->admininfo(nodeinfo.admin_index());
-      nodeinfo.set_edge_index(tilebuilder.directededges().size());
-      nodeinfo.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
-                                                    admin.country_iso(), admin.state_iso()));
-
-      // Current edge count
-      size_t edge_count = tilebuilder.directededges().size();
-
-      // Add shortcut edges first.
-      std::unordered_map<uint32_t, uint32_t> shortcuts;
-      shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id, old_edge_index,
-                                         old_edge_count, shortcuts);
-
-      // Copy the rest of the directed edges from this node
-      GraphId edgeid(tileid, tile_level, old_edge_index);
-      for (uint32_t i = 0; i < old_edge_count; i++, ++edgeid) {
-        // Copy the directed edge information and update end node,
-        // edge data offset, and opp_index
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        DirectedEdge newedge = *directededge;
-
-        // Get signs from the base directed edge
-        if (directededge->sign()) {
-          std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
-          if (signs.size() == 0) {
-            LOG_ERROR("Base edge should have signs, but none found");
+      // Iterate through the nodes in the tile
+      GraphId node_id(tileid, tile_level, 0);
+      for (uint32_t n = 0; n < tile->header()->nodecount(); n++, ++node_id) {
+        // Get the node info, copy node index and count from old tile
+        NodeInfo nodeinfo = *(tile->node(node_id));
+        uint32_t old_edge_index = nodeinfo.edge_index();
+        uint32_t old_edge_count = nodeinfo.edge_count();
+
+        // Update node information
+        const auto& admin = tile->admininfo(nodeinfo.admin_index());
+        nodeinfo.set_edge_index(tilebuilder.directededges().size());
+        nodeinfo.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                                      admin.country_iso(), admin.state_iso()));
+
+        // Current edge count
+        size_t edge_count = tilebuilder.directededges().size();
+
+        // Add shortcut edges first.
+        std::unordered_map<uint32_t, uint32_t> shortcuts;
+        shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id, old_edge_index,
+                                           old_edge_count, shortcuts);
+
+        // Copy the rest of the directed edges from this node
+        GraphId edgeid(tileid, tile_level, old_edge_index);
+        for (uint32_t i = 0; i < old_edge_count; i++, ++edgeid) {
+          // Copy the directed edge information and update end node,
+          // edge data offset, and opp_index
+          const DirectedEdge* directededge = tile->directededge(edgeid);
+          DirectedEdge newedge = *directededge;
+
+          // Get signs from the base directed edge
+          if (directededge->sign()) {
+            std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
+            if (signs.size() == 0) {
+              LOG_ERROR("Base edge should have signs, but none found");
+            }
+            tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
           }
-          tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
-        }
 
-        // Get turn lanes from the base directed edge
-        if (directededge->turnlanes()) {
-          uint32_t offset = tile->turnlanes_offset(edgeid.id());
-          tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
-        }
+          // Get turn lanes from the base directed edge
+          if (directededge->turnlanes()) {
+            uint32_t offset = tile->turnlanes_offset(edgeid.id());
+            tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
+          }
 
-        // Get access restrictions from the base directed edge. Add these to
-        // the list of access restrictions in the new tile. Update the
-        // edge index in the restriction to be the current directed edge Id
-        if (directededge->access_restriction()) {
-          auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
-          for (const auto& res : restrictions) {
-            tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
-                                                               res.type(), res.modes(), res.value()));
+          // Get access restrictions from the base directed edge. Add these to
+          // the list of access restrictions in the new tile. Update the
+          // edge index in the restriction to be the current directed edge Id
+          if (directededge->access_restriction()) {
+            auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
+            for (const auto& res : restrictions) {
+              tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
+                                                                 res.type(), res.modes(),
+                                                                 res.value()));
+            }
           }
-        }
 
-        // Copy lane connectivity
-        if (directededge->laneconnectivity()) {
-          auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
-          if (laneconnectivity.size() == 0) {
-            LOG_ERROR("Base edge should have lane connectivity, but none found");
+          // Copy lane connectivity
+          if (directededge->laneconnectivity()) {
+            auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
+            if (laneconnectivity.size() == 0) {
+              LOG_ERROR("Base edge should have lane connectivity, but none found");
+            }
+            for (auto& lc : laneconnectivity) {
+              lc.set_to(tilebuilder.directededges().size());
+            }
+            tilebuilder.AddLaneConnectivity(laneconnectivity);
           }
-          for (auto& lc : laneconnectivity) {
-            lc.set_to(tilebuilder.directededges().size());
+
+          // Get edge info, shape, and names from the old tile and add
+          // to the new. Use prior edgeinfo offset as the key to make sure
+          // edges that have the same end nodes are differentiated (this
+          // should be a valid key since tile sizes aren't changed)
+          auto edgeinfo = tile->edgeinfo(directededge);
+          uint32_t edge_info_offset =
+              tilebuilder.AddEdgeInfo(directededge->edgeinfo_offset(), node_id,
+                                      directededge->endnode(), edgeinfo.wayid(),
+                                      edgeinfo.mean_elevation(),
+                                      edgeinfo.bike_network(), edgeinfo.speed_limit(),
+                                      edgeinfo.encoded_shape(), edgeinfo.GetNames(),
+                                      edgeinfo.GetTaggedValues(), edgeinfo.GetTaggedValues(true),
+                                      edgeinfo.GetTypes(), added);
+          newedge.set_edgeinfo_offset(edge_info_offset);
+
+          // Set the superseded mask - this is the shortcut mask that supersedes this edge
+          // (outbound from the node). Do not set (keep as 0) if maximum number of shortcuts
+          // from a node has been exceeded.
+          auto s = shortcuts.find(i);
+          uint32_t superseded_idx = (s != shortcuts.end()) ? s->second : 0;
+          if (superseded_idx <= kMaxShortcutsFromNode) {
+            newedge.set_superseded(superseded_idx);
           }
-          tilebuilder.AddLaneConnectivity(laneconnectivity);
-        }
 
-        // Get edge info, shape, and names from the old tile and add
-        // to the new. Use prior edgeinfo offset as the key to make sure
-        // edges that have the same end nodes are differentiated (this
-        // should be a valid key since tile sizes aren't changed)
-        auto edgeinfo = tile->edgeinfo(directededge);
-        uint32_t edge_info_offset =
-            tilebuilder.AddEdgeInfo(directededge->edgeinfo_offset(), node_id, directededge->endnode(),
-                                    edgeinfo.wayid(), edgeinfo.mean_elevation(),
-                                    edgeinfo.bike_network(), edgeinfo.speed_limit(),
-                                    edgeinfo.encoded_shape(), edgeinfo.GetNames(),
-                                    edgeinfo.GetTaggedValues(), edgeinfo.GetTaggedValues(true),
-                                    edgeinfo.GetTypes(), added);
-        newedge.set_edgeinfo_offset(edge_info_offset);
-
-        // Set the superseded mask - this is the shortcut mask that supersedes this edge
-        // (outbound from the node). Do not set (keep as 0) if maximum number of shortcuts
-        // from a node has been exceeded.
-        auto s = shortcuts.find(i);
-        uint32_t superseded_idx = (s != shortcuts.end()) ? s->second : 0;
-        if (superseded_idx <= kMaxShortcutsFromNode) {
-          newedge.set_superseded(superseded_idx);
+          // Add directed edge
+          tilebuilder.directededges().emplace_back(std::move(newedge));
         }
 
-        // Add directed edge
-        tilebuilder.directededges().emplace_back(std::move(newedge));
-      }
-
-      // Set the edge count for the new node
-      nodeinfo.set_edge_count(tilebuilder.directededges().size() - edge_count);
+        // Set the edge count for the new node
+        nodeinfo.set_edge_count(tilebuilder.directededges().size() - edge_count);
 
-      // Get named signs from the base node
-      if (nodeinfo.named_intersection()) {
+        // Get named signs from the base node
+        if (nodeinfo.named_intersection()) {
 
-        std::vector<SignInfo> signs = tile->GetSigns(n, true);
-        if (signs.size() == 0) {
-          LOG_ERROR("Base node should have signs, but none found");
+          std::vector<SignInfo> signs = tile->GetSigns(n, true);
+          if (signs.size() == 0) {
+            LOG_ERROR("Base node should have signs, but none found");
+          }
+          tilebuilder.AddSigns(tilebuilder.nodes().size(), signs);
         }
-        tilebuilder.AddSigns(tilebuilder.nodes().size(), signs);
+        tilebuilder.nodes().emplace_back(std::move(nodeinfo));
       }
-      tilebuilder.nodes().emplace_back(std::move(nodeinfo));
-    }
 
-    // Store the new tile
-    tilebuilder.StoreTileData();
-    LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") % tile %
-               tilebuilder.header_builder().end_offset())
-                  .str());
+      // Store the new tile
+      tilebuilder.StoreTileData();
+      LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") % tile %
+                 tilebuilder.header_builder().end_offset())
+                    .str());
 
-    // Check if we need to clear the tile cache.
-    if (reader.OverCommitted()) {
-      reader.Trim();
+      // Check if we need to clear the tile cache.
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
     }
+    result.set_value(shortcut_count);
+  } catch (...) {
+    result.set_exception(std::current_exception());
   }
-  return shortcut_count;
 }
 
 } // namespace
@@ -733,20 +754,58 @@ namespace mjolnir {
 // only connect to 2 edges on the hierarchy level, and have compatible
 // attributes. Shortcut edges are inserted before regular edges.
 void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
+  // Get GraphReader
+  auto hierarchy_properties = pt.get_child("mjolnir");
+  GraphReader reader(hierarchy_properties);
 
-  // TODO: thread this. would need to make sure we dont make shortcuts
-  // across tile boundaries so that we are only messing with one tile
-  // in one thread at a time
+  // A place to hold worker threads and their results, exceptions or otherwise
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency())));
 
-  // Get GraphReader
-  GraphReader reader(pt.get_child("mjolnir"));
+  // The new tiles of a level wait here until all of the level is done
+  const std::string staging_dir =
+      reader.tile_dir() + filesystem::path::preferred_separator + "shortcuts";
 
   auto tile_level = TileHierarchy::levels().rbegin();
   tile_level++;
   for (; tile_level != TileHierarchy::levels().rend(); ++tile_level) {
     // Create shortcuts on this level
     LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level->level));
-    [[maybe_unused]] uint32_t count = FormShortcuts(reader, *tile_level);
+    if (filesystem::exists(staging_dir)) {
+      filesystem::remove_all(staging_dir);
+    }
+    auto tiles = reader.GetTileSet(tile_level->level);
+    std::list<std::promise<uint32_t>> results;
+    TileScheduler scheduler("Shortcuts", {tiles.begin(), tiles.end()}, threads.size(),
+                            TileScheduler::FileSize(reader.tile_dir()));
+    for (size_t i = 0; i < threads.size(); ++i) {
+      results.emplace_back();
+      threads[i].reset(new std::thread(FormShortcuts, std::cref(hierarchy_properties),
+                                       std::cref(staging_dir), std::ref(scheduler), i,
+                                       std::ref(results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    scheduler.LogUtilization();
+
+    // If something bad went down this will rethrow it
+    uint32_t count = 0;
+    for (auto& result : results) {
+      count += result.get_future().get();
+    }
+
+    // Move the new tiles over the old ones
+    for (const auto& tile_id : tiles) {
+      auto suffix = GraphTile::FileSuffix(tile_id);
+      auto staged = staging_dir + filesystem::path::preferred_separator + suffix;
+      if (filesystem::exists(staged)) {
+        filesystem::rename(staged,
+                           reader.tile_dir() + filesystem::path::preferred_separator + suffix);
+      }
+    }
+    filesystem::remove_all(staging_dir);
     LOG_INFO("Finished with " + std::to_string(count) + " shortcuts");
   }
 }
@@ -28,29 +28,23 @@ using namespace valhalla::baldr;
 using namespace valhalla::mjolnir;
 
 namespace {
-// merges contents of sets and maps that do not have overlapping keys
-template <class T> T merge(T& a, T b) {
-  T tmp(a);
-  tmp.insert(b.begin(), b.end());
-  return tmp;
+// merges the contents of sets and maps that do not have overlapping keys into the first one
+template <class T> void merge(T& a, const T& b) {
+  a.insert(b.begin(), b.end());
 }
 
-// accumulates counts into a new map for maps that have counts associated with its keys
-template <class T> T merge_counts(T& a, T b) {
-  T tmp(a);
+// accumulates counts into the first map for maps that have counts associated with its keys
+template <class T> void merge_counts(T& a, const T& b) {
   for (auto it = b.begin(); it != b.end(); it++) {
-    tmp[it->first] += it->second;
+    a[it->first] += it->second;
   }
-  return tmp;
 }
 
-// merge two hashes by key and merge underlying hash buckets
-template <class T> T deep_merge_counts(T& a, T const& b) {
-  T tmp(a);
+// merge two hashes by key and merge underlying hash buckets into the first one
+template <class T> void deep_merge_counts(T& a, const T& b) {
   for (auto it = b.begin(); it != b.end(); it++) {
-    tmp[it->first] = merge_counts(tmp[it->first], it->second);
+    merge_counts(a[it->first], it->second);
   }
-  return tmp;
 }
 
 } // namespace
@@ -393,51 +387,51 @@ const std::unordered_map<std::string, size_t>& statistics::get_ctry_exit_count()
 
 void statistics::add(const statistics& stats) {
   // Combine ids and isos
-  tile_ids = merge(tile_ids, stats.get_ids());
-  iso_codes = merge(iso_codes, stats.get_isos());
+  merge(tile_ids, stats.get_ids());
+  merge(iso_codes, stats.get_isos());
 
   // Combine tile statistics
-  tile_areas = merge(tile_areas, stats.get_tile_areas());
-  tile_geometries = merge(tile_geometries, stats.get_tile_geometries());
-  tile_lengths = merge(tile_lengths, stats.get_tile_lengths());
-  tile_one_way = merge(tile_one_way, stats.get_tile_one_way());
-  tile_speed_info = merge(tile_speed_info, stats.get_tile_speed_info());
-  tile_int_edges = merge(tile_int_edges, stats.get_tile_int_edges());
-  tile_named = merge(tile_named, stats.get_tile_named());
-  tile_hazmat = merge(tile_hazmat, stats.get_tile_hazmat());
-  tile_truck_route = merge(tile_truck_route, stats.get_tile_truck_route());
-  tile_height = merge(tile_height, stats.get_tile_height());
-  tile_width = merge(tile_width, stats.get_tile_width());
-  tile_length = merge(tile_length, stats.get_tile_length());
-  tile_weight = merge(tile_weight, stats.get_tile_weight());
-  tile_axle_load = merge(tile_axle_load, stats.get_tile_axle_load());
+  merge(tile_areas, stats.get_tile_areas());
+  merge(tile_geometries, stats.get_tile_geometries());
+  merge(tile_lengths, stats.get_tile_lengths());
+  merge(tile_one_way, stats.get_tile_one_way());
+  merge(tile_speed_info, stats.get_tile_speed_info());
+  merge(tile_int_edges, stats.get_tile_int_edges());
+  merge(tile_named, stats.get_tile_named());
+  merge(tile_hazmat, stats.get_tile_hazmat());
+  merge(tile_truck_route, stats.get_tile_truck_route());
+  merge(tile_height, stats.get_tile_height());
+  merge(tile_width, stats.get_tile_width());
+  merge(tile_length, stats.get_tile_length());
+  merge(tile_weight, stats.get_tile_weight());
+  merge(tile_axle_load, stats.get_tile_axle_load());
 
   // Combine country statistics
-  country_lengths = deep_merge_counts(country_lengths, stats.get_country_lengths());
-  country_one_way = deep_merge_counts(country_one_way, stats.get_country_one_way());
-  country_speed_info = deep_merge_counts(country_speed_info, stats.get_country_speed_info());
-  country_int_edges = deep_merge_counts(country_int_edges, stats.get_country_int_edges());
-  country_named = deep_merge_counts(country_named, stats.get_country_named());
-  country_hazmat = deep_merge_counts(country_hazmat, stats.get_country_hazmat());
-  country_truck_route = deep_merge_counts(country_truck_route, stats.get_country_truck_route());
-  country_height = deep_merge_counts(country_height, stats.get_country_height());
-  country_width = deep_merge_counts(country_width, stats.get_country_width());
-  country_length = deep_merge_counts(country_length, stats.get_country_length());
-  country_weight = deep_merge_counts(country_weight, stats.get_country_weight());
-  country_axle_load = deep_merge_counts(country_axle_load, stats.get_country_axle_load());
+  deep_merge_counts(country_lengths, stats.get_country_lengths());
+  deep_merge_counts(country_one_way, stats.get_country_one_way());
+  deep_merge_counts(country_speed_info, stats.get_country_speed_info());
+  deep_merge_counts(country_int_edges, stats.get_country_int_edges());
+  deep_merge_counts(country_named, stats.get_country_named());
+  deep_merge_counts(country_hazmat, stats.get_country_hazmat());
+  deep_merge_counts(country_truck_route, stats.get_country_truck_route());
+  deep_merge_counts(country_height, stats.get_country_height());
+  deep_merge_counts(country_width, stats.get_country_width());
+  deep_merge_counts(country_length, stats.get_country_length());
+  deep_merge_counts(country_weight, stats.get_country_weight());
+  deep_merge_counts(country_axle_load, stats.get_country_axle_load());
 
   // Combine exit statistics
-  tile_exit_signs = merge_counts(tile_exit_signs, stats.get_tile_exit_info());
-  ctry_exit_signs = merge_counts(ctry_exit_signs, stats.get_ctry_exit_info());
+  merge_counts(tile_exit_signs, stats.get_tile_exit_info());
+  merge_counts(ctry_exit_signs, stats.get_ctry_exit_info());
 
-  tile_exit_count = merge_counts(tile_exit_count, stats.get_tile_exit_count());
-  ctry_exit_count = merge_counts(ctry_exit_count, stats.get_ctry_exit_count());
+  merge_counts(tile_exit_count, stats.get_tile_exit_count());
+  merge_counts(ctry_exit_count, stats.get_ctry_exit_count());
 
-  tile_fork_signs = merge_counts(tile_fork_signs, stats.get_tile_fork_info());
-  ctry_fork_signs = merge_counts(ctry_fork_signs, stats.get_ctry_fork_info());
+  merge_counts(tile_fork_signs, stats.get_tile_fork_info());
+  merge_counts(ctry_fork_signs, stats.get_ctry_fork_info());
 
-  tile_fork_count = merge_counts(tile_fork_count, stats.get_tile_fork_count());
-  ctry_fork_count = merge_counts(ctry_fork_count, stats.get_ctry_fork_count());
+  merge_counts(tile_fork_count, stats.get_tile_fork_count());
+  merge_counts(ctry_fork_count, stats.get_ctry_fork_count());
 
   // Combine roulette data
   roulette_data.Add(stats.roulette_data);
@@ -461,10 +455,10 @@ void statistics::RouletteData::AddNode(const PointLL& p) {
 }
 
 void statistics::RouletteData::Add(const RouletteData& rd) {
-  way_IDs = merge(way_IDs, rd.way_IDs);
-  way_shapes = merge(way_shapes, rd.way_shapes);
-  shape_bb = merge(shape_bb, rd.shape_bb);
-  unroutable_nodes = merge(unroutable_nodes, rd.unroutable_nodes);
+  merge(way_IDs, rd.way_IDs);
+  merge(way_shapes, rd.way_shapes);
+  merge(shape_bb, rd.shape_bb);
+  merge(unroutable_nodes, rd.unroutable_nodes);
 }
 
 void statistics::RouletteData::GenerateTasks(const boost::property_tree::ptree& /*pt*/) const {
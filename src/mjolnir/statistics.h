@@ -278,8 +278,20 @@ public:
 
   void add(const statistics& stats);
 
+  /**
+   * Writes the statistics to statistics.sqlite, a spatialite database with a table per kind of
+   * statistic and the tile polygons.
+   */
   void build_db();
 
+  /**
+   * Writes the statistics as csv files of the same columns as the tables of build_db, one file
+   * per table into the directory, without spatialite. The tile polygons are minx, miny, maxx and
+   * maxy columns.
+   * @param directory  where to write the files, it is created if needed
+   */
+  void build_csv(const std::string& directory);
+
 private:
   void create_tile_tables(sqlite3* db_handle);
 
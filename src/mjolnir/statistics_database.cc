@@ -1,5 +1,9 @@
 #include "statistics.h"
 #include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <type_traits>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -35,8 +39,10 @@ void statistics::build_db() {
 
   LOG_INFO("Writing statistics database");
 
-  // Turn on foreign keys
-  std::string sql = "PRAGMA foreign_keys = ON";
+  // Turn on foreign keys, the database is thrown away if the build fails so it is written
+  // without syncing or a rollback journal
+  std::string sql = "PRAGMA foreign_keys = ON; PRAGMA synchronous = OFF; "
+                    "PRAGMA journal_mode = OFF; PRAGMA cache_size = -262144";
   ret = sqlite3_exec(db_handle, sql.c_str(), NULL, NULL, &err_msg);
   if (ret != SQLITE_OK) {
     LOG_ERROR("Error: " + std::string(err_msg));
@@ -57,6 +63,15 @@ void statistics::build_db() {
   create_exit_tables(db_handle);
   LOG_INFO("Created exit tables");
 
+  // All the rows go in with one transaction of reused prepared statements
+  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("Error: " + std::string(err_msg));
+    sqlite3_free(err_msg);
+    sqlite3_close(db_handle);
+    return;
+  }
+
   insert_tile_data(db_handle, stmt);
   LOG_INFO("Tile info inserted");
 
@@ -66,6 +81,14 @@ void statistics::build_db() {
   insert_exit_data(db_handle, stmt);
   LOG_INFO("Exit info inserted");
 
+  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("Error: " + std::string(err_msg));
+    sqlite3_free(err_msg);
+    sqlite3_close(db_handle);
+    return;
+  }
+
   // Create Index on geometry column
   sql = "SELECT CreateSpatialIndex('tiledata', 'geom')";
   ret = sqlite3_exec(db_handle, sql.c_str(), NULL, NULL, &err_msg);
@@ -97,6 +120,118 @@ void statistics::build_db() {
   sqlite3_close(db_handle);
   LOG_INFO("Statistics database saved to statistics.sqlite");
 }
+
+void statistics::build_csv(const std::string& directory) {
+  filesystem::create_directories(directory);
+  LOG_INFO("Writing statistics csv files to " + directory);
+
+  // the columns of the road classes, in the order of rclasses
+  const std::string rclass_columns =
+      "motorway,pmary,secondary,tertiary,trunk,residential,serviceother,unclassified";
+  const auto open = [&directory](const std::string& name, const std::string& header) {
+    std::ofstream file(directory + filesystem::path::preferred_separator + name + ".csv");
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open " + name + ".csv in " + directory);
+    }
+    file << std::setprecision(9) << header << '\n';
+    return file;
+  };
+  // the value of a road class without adding it to the statistics
+  const auto value = [](const auto& stats, const auto& key, RoadClass rclass) {
+    const auto found = stats.find(key);
+    if (found == stats.end()) {
+      return typename std::decay_t<decltype(found->second)>::mapped_type{};
+    }
+    const auto rclass_value = found->second.find(rclass);
+    return rclass_value == found->second.end() ? decltype(rclass_value->second){}
+                                               : rclass_value->second;
+  };
+
+  // the tiles, their bounding boxes are separate columns
+  auto tiledata = open("tiledata", "tileid,tilearea,totalroadlen," + rclass_columns +
+                                       ",minx,miny,maxx,maxy");
+  auto rclasstiledata = open("rclasstiledata", "tileid,type,oneway,maxspeed,internaledges,named");
+  auto truckrclasstiledata = open("truckrclasstiledata", "tileid,type,hazmat,truck_route,height,"
+                                                         "width,length,weight,axle_load");
+  for (auto tileid : tile_ids) {
+    const auto area = tile_areas.find(tileid);
+    float total = 0;
+    for (auto rclass : rclasses) {
+      total += value(tile_lengths, tileid, rclass);
+    }
+    tiledata << tileid << ',' << (area == tile_areas.end() ? 0.f : area->second) << ',' << total;
+    for (auto rclass : rclasses) {
+      tiledata << ',' << value(tile_lengths, tileid, rclass);
+    }
+    const auto geometry = tile_geometries.find(tileid);
+    if (geometry != tile_geometries.end()) {
+      tiledata << ',' << geometry->second.minx() << ',' << geometry->second.miny() << ','
+               << geometry->second.maxx() << ',' << geometry->second.maxy() << '\n';
+    } else {
+      tiledata << ",,,,\n";
+    }
+
+    for (auto rclass : rclasses) {
+      const auto& type = roadClassToString.at(rclass);
+      rclasstiledata << tileid << ',' << type << ',' << value(tile_one_way, tileid, rclass) << ','
+                     << value(tile_speed_info, tileid, rclass) << ','
+                     << value(tile_int_edges, tileid, rclass) << ','
+                     << value(tile_named, tileid, rclass) << '\n';
+      truckrclasstiledata << tileid << ',' << type << ',' << value(tile_hazmat, tileid, rclass)
+                          << ',' << value(tile_truck_route, tileid, rclass) << ','
+                          << value(tile_height, tileid, rclass) << ','
+                          << value(tile_width, tileid, rclass) << ','
+                          << value(tile_length, tileid, rclass) << ','
+                          << value(tile_weight, tileid, rclass) << ','
+                          << value(tile_axle_load, tileid, rclass) << '\n';
+    }
+  }
+
+  // the countries
+  auto countrydata = open("countrydata", "isocode," + rclass_columns);
+  auto rclassctrydata = open("rclassctrydata", "isocode,type,oneway,maxspeed,internaledges,named");
+  auto truckrclassctrydata = open("truckrclassctrydata", "isocode,type,hazmat,truck_route,height,"
+                                                         "width,length,weight,axle_load");
+  for (const auto& country : iso_codes) {
+    countrydata << country;
+    for (auto rclass : rclasses) {
+      countrydata << ',' << value(country_lengths, country, rclass);
+    }
+    countrydata << '\n';
+
+    for (auto rclass : rclasses) {
+      const auto& type = roadClassToString.at(rclass);
+      rclassctrydata << country << ',' << type << ',' << value(country_one_way, country, rclass)
+                     << ',' << value(country_speed_info, country, rclass) << ','
+                     << value(country_int_edges, country, rclass) << ','
+                     << value(country_named, country, rclass) << '\n';
+      truckrclassctrydata << country << ',' << type << ','
+                          << value(country_hazmat, country, rclass) << ','
+                          << value(country_truck_route, country, rclass) << ','
+                          << value(country_height, country, rclass) << ','
+                          << value(country_width, country, rclass) << ','
+                          << value(country_length, country, rclass) << ','
+                          << value(country_weight, country, rclass) << ','
+                          << value(country_axle_load, country, rclass) << '\n';
+    }
+  }
+
+  // the share of exits and forks with signs
+  const auto write_signs = [&open](const std::string& name, const std::string& key,
+                                   const auto& signs, const auto& counts) {
+    auto file = open(name, key + ",exitsign");
+    for (const auto& sign : signs) {
+      file << sign.first << ','
+           << static_cast<float>(sign.second) / static_cast<float>(counts.at(sign.first)) << '\n';
+    }
+  };
+  write_signs("tile_exitinfo", "tileid", tile_exit_signs, tile_exit_count);
+  write_signs("tile_forkinfo", "tileid", tile_fork_signs, tile_fork_count);
+  write_signs("ctry_exitinfo", "isocode", ctry_exit_signs, ctry_exit_count);
+  write_signs("ctry_forkinfo", "isocode", ctry_fork_signs, ctry_fork_count);
+
+  LOG_INFO("Statistics csv files saved to " + directory);
+}
 void statistics::create_tile_tables(sqlite3* db_handle) {
   uint32_t ret;
   char* err_msg = NULL;
@@ -296,20 +431,11 @@ void statistics::create_exit_tables(sqlite3* db_handle) {
 void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
 
   uint32_t ret;
-  char* err_msg = NULL;
   std::string sql;
 
-  // Begin the prepared statements for tiledata
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
   sql = "INSERT INTO tiledata (tileid, tilearea, totalroadlen, motorway, pmary, secondary, "
         "tertiary, trunk, residential, unclassified, serviceother, geom) ";
-  sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, GeomFromText(?, 4326))";
+  sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, BuildMbr(?, ?, ?, ?, 4326))";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), strlen(sql.c_str()), &stmt, NULL);
   if (ret != SQLITE_OK) {
     LOG_ERROR("SQL error: " + sql);
@@ -322,7 +448,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   for (auto tileid : tile_ids) {
     uint8_t index = 1;
     sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
     // Tile ID
     sqlite3_bind_int(stmt, index, tileid);
     ++index;
@@ -342,17 +467,18 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
       sqlite3_bind_double(stmt, index, tile_lengths[tileid][rclass]);
       ++index;
     }
-    // Use tile bounding box corners to make a polygon
-    if (tile_geometries.find(tileid) != tile_geometries.end()) {
-      auto maxx = std::to_string(tile_geometries.at(tileid).maxx());
-      auto minx = std::to_string(tile_geometries.at(tileid).minx());
-      auto maxy = std::to_string(tile_geometries.at(tileid).maxy());
-      auto miny = std::to_string(tile_geometries.at(tileid).miny());
-      std::string polyWKT = "POLYGON ((" + minx + " " + miny + ", " + minx + " " + maxy + ", " +
-                            maxx + " " + maxy + ", " + maxx + " " + miny + ", " + minx + " " + miny +
-                            "))";
-      sqlite3_bind_text(stmt, index, polyWKT.c_str(), polyWKT.length(), SQLITE_STATIC);
+    // The tile bounding box is the polygon, built from its corners rather than parsed from text
+    const auto geometry = tile_geometries.find(tileid);
+    if (geometry != tile_geometries.end()) {
+      sqlite3_bind_double(stmt, index++, geometry->second.minx());
+      sqlite3_bind_double(stmt, index++, geometry->second.miny());
+      sqlite3_bind_double(stmt, index++, geometry->second.maxx());
+      sqlite3_bind_double(stmt, index, geometry->second.maxy());
     } else {
+      // the bindings of the previous row are kept, so the missing geometry is bound as null
+      for (int corner = 0; corner < 4; ++corner) {
+        sqlite3_bind_null(stmt, index + corner);
+      }
       LOG_ERROR("Geometry for tile " + std::to_string(tileid) + " not found.");
     }
     ret = sqlite3_step(stmt);
@@ -362,22 +488,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
-  // Begin adding the statistics for each road type of tile data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO rclasstiledata (tileid, type, oneway, maxspeed, internaledges, named) ";
   sql += "VALUES (?, ?, ?, ?, ?, ?)";
@@ -394,7 +504,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     for (auto rclass : rclasses) {
       uint8_t index = 1;
       sqlite3_reset(stmt);
-      sqlite3_clear_bindings(stmt);
       // Tile ID (parent tile)
       sqlite3_bind_int(stmt, index, tileid);
       ++index;
@@ -421,22 +530,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
-  // Begin adding the truck statistics for each road type of tile data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO truckrclasstiledata (tileid, type, hazmat, truck_route, height, width, "
         "length, weight, axle_load) ";
@@ -454,7 +547,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     for (auto rclass : rclasses) {
       uint8_t index = 1;
       sqlite3_reset(stmt);
-      sqlite3_clear_bindings(stmt);
       // Tile ID (parent tile)
       sqlite3_bind_int(stmt, index, tileid);
       ++index;
@@ -490,28 +582,12 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 }
 
 void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   uint32_t ret;
-  char* err_msg = NULL;
   std::string sql;
 
-  // Begin the prepared statements for country data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
   sql = "INSERT INTO countrydata (isocode, motorway, pmary, secondary, tertiary, trunk, "
         "residential, unclassified, serviceother)";
   sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
@@ -527,7 +603,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   for (const auto& country : iso_codes) {
     uint8_t index = 1;
     sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
     // Country ISO
     sqlite3_bind_text(stmt, index, country.c_str(), country.length(), SQLITE_STATIC);
     ++index;
@@ -544,22 +619,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
-  // Begin adding the statistics for each road type of country data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO rclassctrydata (isocode, type, oneway, maxspeed, internaledges, named) ";
   sql += "VALUES (?, ?, ?, ?, ?, ?)";
@@ -576,7 +635,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     for (auto rclass : rclasses) {
       uint8_t index = 1;
       sqlite3_reset(stmt);
-      sqlite3_clear_bindings(stmt);
       // ISO (parent ID)
       sqlite3_bind_text(stmt, index, country.c_str(), country.length(), SQLITE_STATIC);
       ++index;
@@ -603,22 +661,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
-  // Begin adding the truck statistics for each road type of country data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO truckrclassctrydata (isocode, type, hazmat, truck_route, height, width, "
         "length, weight, axle_load) ";
@@ -636,7 +678,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     for (auto rclass : rclasses) {
       uint8_t index = 1;
       sqlite3_reset(stmt);
-      sqlite3_clear_bindings(stmt);
       // ISO (parent ID)
       sqlite3_bind_text(stmt, index, country.c_str(), country.length(), SQLITE_STATIC);
       ++index;
@@ -672,29 +713,12 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 }
 
 void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   uint32_t ret;
-  char* err_msg = NULL;
   std::string sql;
 
-  // Begin adding the statistics for exits in tiles
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
   sql = "INSERT INTO tile_exitinfo (tileid, exitsign) ";
   sql += "VALUES (?, ?)";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, NULL);
@@ -709,7 +733,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   for (auto it = tile_exit_signs.cbegin(); it != tile_exit_signs.cend(); it++) {
     uint8_t index = 1;
     sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
     // Tile ID (parent tile)
     sqlite3_bind_int(stmt, index, it->first);
     ++index;
@@ -725,22 +748,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
-  // Begin adding the statistics for forks in tiles
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO tile_forkinfo (tileid, exitsign) ";
   sql += "VALUES (?, ?)";
@@ -756,7 +763,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   for (auto it = tile_fork_signs.cbegin(); it != tile_fork_signs.cend(); it++) {
     uint8_t index = 1;
     sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
     // Tile ID (parent tile)
     sqlite3_bind_int(stmt, index, it->first);
     ++index;
@@ -771,22 +777,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
-  // Begin adding the exit statistics for countries
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO ctry_exitinfo (isocode, exitsign) ";
   sql += "VALUES (?, ?)";
@@ -802,7 +792,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   for (auto it = ctry_exit_signs.cbegin(); it != ctry_exit_signs.cend(); it++) {
     uint8_t index = 1;
     sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
     // ISO (parent ID)
     sqlite3_bind_text(stmt, index, it->first.c_str(), it->first.length(), SQLITE_STATIC);
     ++index;
@@ -817,22 +806,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-  // Begin adding the fork statistics for countries
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
   sql = "INSERT INTO ctry_forkinfo (isocode, exitsign) ";
   sql += "VALUES (?, ?)";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, NULL);
@@ -847,7 +820,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   for (auto it = ctry_fork_signs.cbegin(); it != ctry_fork_signs.cend(); it++) {
     uint8_t index = 1;
     sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
     // ISO (parent ID)
     sqlite3_bind_text(stmt, index, it->first.c_str(), it->first.length(), SQLITE_STATIC);
     ++index;
@@ -862,13 +834,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize(stmt);
-  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 }
 
 } // namespace mjolnir
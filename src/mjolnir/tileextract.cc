@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "baldr/connectivity_map.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "baldr/traffictile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+#include "midgard/util.h"
+#include "mjolnir/tileextract.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+using header_t = tar::header_t;
+constexpr uint64_t kBlockSize = sizeof(header_t);
+const std::string kIndexFile = "index.bin";
+
+// The layout of index.bin, see GraphReader::tile_extract_t
+struct tile_index_entry {
+  uint64_t offset;  // byte offset from the beginning of the tar
+  uint32_t tile_id; // just level and tileindex hence fitting in 32bits
+  uint32_t size;    // size of the tile in bytes
+};
+
+// Size of an entry's data rounded up to whole blocks
+uint64_t blocks(const uint64_t size) {
+  return (size + kBlockSize - 1) / kBlockSize * kBlockSize;
+}
+
+// A ustar header for a regular file
+header_t make_header(const std::string& name, const uint64_t size, const uint64_t mtime) {
+  if (name.size() >= sizeof(header_t::name)) {
+    throw std::runtime_error("Tar entry name too long: " + name);
+  }
+  header_t header{};
+  std::memcpy(header.name, name.c_str(), name.size());
+  std::snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+  std::snprintf(header.uid, sizeof(header.uid), "%07o", 0);
+  std::snprintf(header.gid, sizeof(header.gid), "%07o", 0);
+  std::snprintf(header.size, sizeof(header.size), "%011llo", static_cast<unsigned long long>(size));
+  std::snprintf(header.mtime, sizeof(header.mtime), "%011llo",
+                static_cast<unsigned long long>(mtime));
+  header.typeflag = '0';
+  std::memcpy(header.magic, "ustar", 6);
+  std::memcpy(header.version, "00", 2);
+
+  // the checksum is the sum of the header bytes with the checksum itself taken as spaces
+  std::memset(header.chksum, ' ', sizeof(header.chksum));
+  uint64_t sum = 0;
+  for (size_t i = 0; i < sizeof(header_t); ++i) {
+    sum += reinterpret_cast<const unsigned char*>(&header)[i];
+  }
+  std::snprintf(header.chksum, sizeof(header.chksum), "%06llo", static_cast<unsigned long long>(sum));
+  header.chksum[7] = ' ';
+  return header;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+namespace {
+
+// By level and then along the curve, with the lower levels first they are all together
+bool extract_order(const TileExtract::Tile& a, const TileExtract::Tile& b) {
+  if (a.id.level() != b.id.level()) {
+    return a.id.level() < b.id.level();
+  }
+  return TileExtract::HilbertIndex(a.id) < TileExtract::HilbertIndex(b.id);
+}
+
+} // namespace
+
+uint64_t TileExtract::HilbertIndex(const GraphId& tile_id) {
+  const auto& tiling = TileHierarchy::get_tiling(tile_id.level());
+  uint64_t x = tile_id.tileid() % tiling.ncolumns();
+  uint64_t y = tile_id.tileid() / tiling.ncolumns();
+
+  // the curve covers a square grid with a power of 2 side that holds all the tiles
+  uint64_t n = 1;
+  while (n < static_cast<uint64_t>(std::max(tiling.ncolumns(), tiling.nrows()))) {
+    n <<= 1;
+  }
+
+  return midgard::hilbert_index(x, y, n);
+}
+
+std::vector<TileExtract::Tile> TileExtract::Layout(const std::string& tile_dir) {
+  std::vector<Tile> tiles;
+  if (!filesystem::is_directory(tile_dir)) {
+    throw std::runtime_error("Not a tile directory: " + tile_dir);
+  }
+  for (filesystem::recursive_directory_iterator i(tile_dir), end; i != end; ++i) {
+    if (!i->is_regular_file() || i->path().extension().string() != ".gph") {
+      continue;
+    }
+    try {
+      tiles.push_back({GraphTile::GetTileId(i->path().string()), i->path().string(),
+                       static_cast<uint64_t>(i->file_size())});
+    } catch (...) {
+      // not a tile, the same as GraphReader we leave it out
+    }
+  }
+
+  std::sort(tiles.begin(), tiles.end(), extract_order);
+
+  // the index comes first, with an entry for the connectivity if there is one, then every tile
+  // right after its header
+  const size_t entries =
+      tiles.size() + filesystem::exists(tile_dir + filesystem::path::preferred_separator +
+                                        kConnectivityFile);
+  uint64_t offset = kBlockSize + blocks(entries * sizeof(tile_index_entry));
+  for (auto& tile : tiles) {
+    tile.offset = offset + kBlockSize;
+    offset = tile.offset + blocks(tile.size);
+  }
+  return tiles;
+}
+
+size_t TileExtract::Build(const std::string& tile_dir, const std::string& extract, size_t threads) {
+  auto tiles = Layout(tile_dir);
+  if (tiles.empty()) {
+    throw std::runtime_error("No tiles found in " + tile_dir);
+  }
+  LOG_INFO("Writing " + std::to_string(tiles.size()) + " tiles to " + extract);
+
+  // write the index and size the file, the tiles are filled in afterwards
+  const uint64_t mtime = std::time(nullptr);
+  std::vector<tile_index_entry> index;
+  index.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    if (tile.size > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("Tile too large for the index: " + tile.path);
+    }
+    index.push_back({tile.offset, static_cast<uint32_t>(tile.id.Tile_Base().value),
+                     static_cast<uint32_t>(tile.size)});
+  }
+  uint64_t end = tiles.back().offset + blocks(tiles.back().size);
+
+  // the connectivity valhalla_build_connectivity wrote goes after the tiles
+  const auto connectivity = tile_dir + filesystem::path::preferred_separator + kConnectivityFile;
+  uint64_t connectivity_size = 0;
+  if (filesystem::exists(connectivity)) {
+    connectivity_size = filesystem::directory_entry(connectivity).file_size();
+    index.push_back({end + kBlockSize, kConnectivityIndexId,
+                     static_cast<uint32_t>(connectivity_size)});
+    end += kBlockSize + blocks(connectivity_size);
+  }
+  const uint64_t index_size = index.size() * sizeof(tile_index_entry);
+  auto parent = filesystem::path(extract).parent_path();
+  if (!parent.string().empty()) {
+    filesystem::create_directories(parent);
+  }
+  {
+    std::ofstream file(extract, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file " + extract);
+    }
+    auto header = make_header(kIndexFile, index_size, mtime);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), index_size);
+    if (!file) {
+      throw std::runtime_error("Failed to write " + extract);
+    }
+  }
+  // with the 2 empty blocks a tar ends with
+  filesystem::resize_file(extract, end + 2 * kBlockSize);
+  if (connectivity_size) {
+    std::ifstream in(connectivity, std::ios::in | std::ios::binary);
+    std::vector<char> data(kBlockSize + connectivity_size);
+    auto header = make_header(kConnectivityFile, connectivity_size, mtime);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::fstream file(extract, std::ios::in | std::ios::out | std::ios::binary);
+    if (!in.read(data.data() + kBlockSize, connectivity_size) || !file.is_open()) {
+      throw std::runtime_error("Failed to add " + connectivity + " to " + extract);
+    }
+    file.seekp(index.back().offset - kBlockSize);
+    file.write(data.data(), data.size());
+    if (!file) {
+      throw std::runtime_error("Failed to write " + extract);
+    }
+  }
+
+  // every thread copies the tiles it takes to their place in the tar
+  std::atomic<size_t> next(0);
+  auto copy = [&]() {
+    std::fstream file(extract, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file " + extract);
+    }
+    std::vector<char> data;
+    for (size_t i = next++; i < tiles.size(); i = next++) {
+      const auto& tile = tiles[i];
+      std::ifstream in(tile.path, std::ios::in | std::ios::binary);
+      data.resize(blocks(tile.size) + kBlockSize);
+      std::fill(data.begin() + kBlockSize + tile.size, data.end(), 0);
+      auto header = make_header(GraphTile::FileSuffix(tile.id, SUFFIX_NON_COMPRESSED, false),
+                                tile.size, mtime);
+      std::memcpy(data.data(), &header, sizeof(header));
+      if (!in.read(data.data() + kBlockSize, tile.size) || in.peek() != EOF) {
+        throw std::runtime_error("Tile changed while writing the extract: " + tile.path);
+      }
+      file.seekp(tile.offset - kBlockSize);
+      file.write(data.data(), data.size());
+      if (!file) {
+        throw std::runtime_error("Failed to write " + extract);
+      }
+    }
+  };
+
+  // run them and keep the first error to throw it once they are all done
+  threads = std::max(threads, static_cast<size_t>(1));
+  std::vector<std::thread> workers;
+  std::vector<std::exception_ptr> errors(threads);
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      try {
+        copy();
+      } catch (...) {
+        errors[t] = std::current_exception();
+        next = tiles.size();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  LOG_INFO("Finished the tile extract with " + std::to_string(end + 2 * kBlockSize) + " bytes");
+  return tiles.size();
+}
+
+size_t TileExtract::BuildTraffic(const boost::property_tree::ptree& config,
+                                 const std::string& extract) {
+  // the tiles as the config reads them, without any old traffic
+  auto tile_config = config;
+  tile_config.erase("traffic_extract");
+  GraphReader reader(tile_config);
+  std::vector<Tile> tiles;
+  for (const auto& id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(id);
+    if (!tile) {
+      continue;
+    }
+    const uint64_t size = sizeof(TrafficTileHeader) +
+                          tile->header()->directededgecount() * sizeof(TrafficSpeed);
+    tiles.push_back({id, GraphTile::FileSuffix(id, SUFFIX_NON_COMPRESSED, false), size});
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (tiles.empty()) {
+    throw std::runtime_error("No tiles found for the traffic extract");
+  }
+  LOG_INFO("Writing " + std::to_string(tiles.size()) + " traffic tiles to " + extract);
+
+  // in the order of the tile extract, every tile right after its header
+  std::sort(tiles.begin(), tiles.end(), extract_order);
+  std::vector<tile_index_entry> index;
+  index.reserve(tiles.size());
+  uint64_t offset = kBlockSize + blocks(tiles.size() * sizeof(tile_index_entry));
+  for (auto& tile : tiles) {
+    tile.offset = offset + kBlockSize;
+    offset = tile.offset + blocks(tile.size);
+    index.push_back({tile.offset, static_cast<uint32_t>(tile.id.Tile_Base().value),
+                     static_cast<uint32_t>(tile.size)});
+  }
+
+  auto parent = filesystem::path(extract).parent_path();
+  if (!parent.string().empty()) {
+    filesystem::create_directories(parent);
+  }
+  std::ofstream file(extract, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file " + extract);
+  }
+  const uint64_t mtime = std::time(nullptr);
+  std::vector<char> data;
+  const uint64_t index_size = index.size() * sizeof(tile_index_entry);
+  data.resize(kBlockSize + blocks(index_size));
+  auto header = make_header(kIndexFile, index_size, mtime);
+  std::memcpy(data.data(), &header, sizeof(header));
+  std::memcpy(data.data() + kBlockSize, index.data(), index_size);
+  file.write(data.data(), data.size());
+
+  for (const auto& tile : tiles) {
+    data.assign(kBlockSize + blocks(tile.size), 0);
+    header = make_header(tile.path, tile.size, mtime);
+    std::memcpy(data.data(), &header, sizeof(header));
+    TrafficTileHeader traffic{};
+    traffic.tile_id = tile.id.Tile_Base().value;
+    traffic.directed_edge_count = (tile.size - sizeof(TrafficTileHeader)) / sizeof(TrafficSpeed);
+    traffic.traffic_tile_version = TRAFFIC_TILE_VERSION;
+    std::memcpy(data.data() + kBlockSize, &traffic, sizeof(traffic));
+    file.write(data.data(), data.size());
+  }
+
+  // with the 2 empty blocks a tar ends with
+  data.assign(2 * kBlockSize, 0);
+  file.write(data.data(), data.size());
+  if (!file) {
+    throw std::runtime_error("Failed to write " + extract);
+  }
+
+  LOG_INFO("Finished the traffic extract with " + std::to_string(offset + 2 * kBlockSize) +
+           " bytes");
+  return tiles.size();
+}
+
+} // namespace mjolnir
+} // namespace valhalla
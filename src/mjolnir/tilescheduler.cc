@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "baldr/graphtile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/tileextract.h"
+#include "mjolnir/tilescheduler.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// CPU time the calling thread has used so far
+double thread_cpu_seconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  auto ticks = [](const FILETIME& t) {
+    return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+  };
+  // in units of 100 nanoseconds
+  return (ticks(kernel) + ticks(user)) * 1e-7;
+#else
+  timespec t;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0) {
+    return 0;
+  }
+  return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+TileScheduler::TileScheduler(const std::string& stage,
+                             const std::vector<GraphId>& tiles,
+                             size_t workers,
+                             const cost_t& cost,
+                             size_t batch)
+    : stage_(stage), size_(tiles.size()) {
+  workers_.resize(std::max(workers, static_cast<size_t>(1)));
+  for (auto& worker : workers_) {
+    worker.reset(new worker_t);
+  }
+  batch = std::max(batch, static_cast<size_t>(1));
+
+  // batches of tiles that are next to each other, they stay in the given order without batching
+  std::vector<GraphId> neighbours(tiles);
+  if (batch > 1) {
+    std::vector<std::pair<uint64_t, GraphId>> curve;
+    curve.reserve(tiles.size());
+    for (const auto& tile_id : tiles) {
+      curve.emplace_back(TileExtract::HilbertIndex(tile_id), tile_id);
+    }
+    std::stable_sort(curve.begin(), curve.end(), [](const auto& a, const auto& b) {
+      return std::make_pair(a.second.level(), a.first) < std::make_pair(b.second.level(), b.first);
+    });
+    for (size_t i = 0; i < curve.size(); ++i) {
+      neighbours[i] = curve[i].second;
+    }
+  }
+
+  // costliest first, ties and tiles without a cost in the given order
+  std::vector<std::pair<uint64_t, size_t>> ordered;
+  for (size_t i = 0; i < neighbours.size(); i += batch) {
+    uint64_t batch_cost = 0;
+    for (size_t j = i; cost && j < std::min(i + batch, neighbours.size()); ++j) {
+      batch_cost += cost(neighbours[j]);
+    }
+    ordered.emplace_back(batch_cost, i);
+  }
+  std::stable_sort(ordered.begin(), ordered.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  // deal them out so every worker starts with a share of the big ones
+  for (size_t i = 0; i < ordered.size(); ++i) {
+    auto& worker_tiles = workers_[i % workers_.size()]->tiles;
+    const auto begin = neighbours.begin() + ordered[i].second;
+    worker_tiles.insert(worker_tiles.end(), begin,
+                        begin + std::min(batch, neighbours.size() - ordered[i].second));
+  }
+}
+
+TileScheduler::cost_t TileScheduler::FileSize(const std::string& dir, const std::string& suffix) {
+  return [dir, suffix](const GraphId& tile_id) -> uint64_t {
+    filesystem::path path(dir + filesystem::path::preferred_separator +
+                          GraphTile::FileSuffix(tile_id.Tile_Base(), suffix));
+    if (!filesystem::is_regular_file(path)) {
+      return 0;
+    }
+    return filesystem::directory_entry(path).file_size();
+  };
+}
+
+bool TileScheduler::pop_front(worker_t& worker, GraphId& tile_id) {
+  std::lock_guard<std::mutex> lock(worker.lock);
+  if (worker.tiles.empty()) {
+    return false;
+  }
+  tile_id = worker.tiles.front();
+  worker.tiles.pop_front();
+  return true;
+}
+
+bool TileScheduler::pop_back(worker_t& worker, GraphId& tile_id) {
+  std::lock_guard<std::mutex> lock(worker.lock);
+  if (worker.tiles.empty()) {
+    return false;
+  }
+  tile_id = worker.tiles.back();
+  worker.tiles.pop_back();
+  return true;
+}
+
+bool TileScheduler::Next(size_t worker, GraphId& tile_id) {
+  if (worker >= workers_.size()) {
+    throw std::out_of_range("No worker " + std::to_string(worker) + " in the " + stage_ +
+                            " scheduler");
+  }
+  auto& self = *workers_[worker];
+  if (!self.started) {
+    self.started = true;
+    self.start = clock_t::now();
+    self.cpu_start = thread_cpu_seconds();
+  }
+
+  // our own tiles first, then the ones the others havent gotten to yet
+  bool found = pop_front(self, tile_id);
+  for (size_t i = 1; !found && i < workers_.size(); ++i) {
+    found = pop_back(*workers_[(worker + i) % workers_.size()], tile_id);
+    self.steals += found;
+  }
+
+  // tiles are never added so once they are all gone this worker is done
+  if (!found && !self.finished) {
+    self.finished = true;
+    self.end = clock_t::now();
+    self.cpu_seconds = thread_cpu_seconds() - self.cpu_start;
+  }
+  return found;
+}
+
+float TileScheduler::utilization() const {
+  bool any = false;
+  clock_t::time_point start, end;
+  double cpu_seconds = 0;
+  for (const auto& worker : workers_) {
+    if (!worker->finished) {
+      continue;
+    }
+    start = any ? std::min(start, worker->start) : worker->start;
+    end = any ? std::max(end, worker->end) : worker->end;
+    cpu_seconds += worker->cpu_seconds;
+    any = true;
+  }
+  double wall_seconds = std::chrono::duration<double>(end - start).count();
+  if (!any || wall_seconds <= 0) {
+    return 0.f;
+  }
+  return static_cast<float>(cpu_seconds / (wall_seconds * workers_.size()));
+}
+
+size_t TileScheduler::steals() const {
+  return std::accumulate(workers_.begin(), workers_.end(), static_cast<size_t>(0),
+                         [](size_t total, const auto& worker) { return total + worker->steals; });
+}
+
+void TileScheduler::LogUtilization() const {
+  double cpu_seconds = 0, least = 0, most = 0;
+  bool any = false;
+  for (const auto& worker : workers_) {
+    if (!worker->finished) {
+      continue;
+    }
+    cpu_seconds += worker->cpu_seconds;
+    least = any ? std::min(least, worker->cpu_seconds) : worker->cpu_seconds;
+    most = any ? std::max(most, worker->cpu_seconds) : worker->cpu_seconds;
+    any = true;
+  }
+  LOG_INFO(stage_ + ": " + std::to_string(size_) + " tiles on " + std::to_string(workers_.size()) +
+           " threads used " + std::to_string(cpu_seconds) + " CPU secs, " +
+           std::to_string(static_cast<int>(utilization() * 100.f + .5f)) + "% utilization, " +
+           std::to_string(least) + " to " + std::to_string(most) + " secs per thread, " +
+           std::to_string(steals()) + " tiles stolen");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
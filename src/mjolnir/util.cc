@@ -1,12 +1,15 @@
 #include "mjolnir/util.h"
 
+#include "baldr/connectivity_map.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/aabb2.h"
 #include "midgard/logging.h"
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
+#include "midgard/sequence.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/connectivitybuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
@@ -23,6 +26,16 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(__linux__) && !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
 using namespace valhalla::midgard;
 
 namespace {
@@ -58,6 +71,45 @@ const std::string old_to_new_file = "old_nodes_to_new_nodes.bin";
 const std::string intersections_file = "intersections.bin";
 const std::string shapes_file = "shapes.bin";
 
+// The tiles changed since they were last validated, see TileChanges
+const std::string changed_tiles_file = "changed_tiles.txt";
+
+std::string changed_tiles_path(const std::string& tile_dir) {
+  return tile_dir + filesystem::path::preferred_separator + changed_tiles_file;
+}
+
+// Log the resident memory of the process after a stage and the most it had during the stage
+void log_memory(const valhalla::mjolnir::BuildStage stage) {
+  const auto name = valhalla::mjolnir::to_string(stage);
+#if defined(__linux__)
+  // the sizes are in kB, the peak is reset below so that it covers just the one stage
+  uint64_t rss = 0, peak = 0;
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      rss = std::stoull(line.substr(6));
+    } else if (line.compare(0, 6, "VmHWM:") == 0) {
+      peak = std::stoull(line.substr(6));
+    }
+  }
+  LOG_INFO("Memory after " + name + ": " + std::to_string(rss / 1024) + " MB resident, " +
+           std::to_string(peak / 1024) + " MB peak");
+  std::ofstream("/proc/self/clear_refs") << "5";
+#elif !defined(_WIN32)
+  // there is no resetting the peak here so it covers all the stages so far
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+    const uint64_t peak = usage.ru_maxrss / 1024;
+#else
+    const uint64_t peak = usage.ru_maxrss;
+#endif
+    LOG_INFO("Memory after " + name + ": " + std::to_string(peak / 1024) + " MB peak so far");
+  }
+#endif
+}
+
 } // namespace
 
 namespace valhalla {
@@ -172,6 +224,82 @@ std::shared_ptr<void> make_spatialite_cache(sqlite3* handle) {
   return std::shared_ptr<void>(conn, [](void* c) { spatialite_cleanup_ex(c); });
 }
 
+TileShard TileShard::FromConfig(const ptree& config) {
+  TileShard shard;
+  shard.count = std::max(config.get<uint32_t>("mjolnir.shard.count", 1), 1u);
+  shard.index = config.get<uint32_t>("mjolnir.shard.index", 0);
+  if (shard.index >= shard.count) {
+    throw std::invalid_argument("mjolnir.shard.index " + std::to_string(shard.index) +
+                                " is not less than mjolnir.shard.count " +
+                                std::to_string(shard.count));
+  }
+  return shard;
+}
+
+std::vector<baldr::GraphId> TileShard::Select(std::vector<baldr::GraphId> tiles) const {
+  std::sort(tiles.begin(), tiles.end(), [](const baldr::GraphId& a, const baldr::GraphId& b) {
+    return std::make_pair(a.level(), a.tileid()) < std::make_pair(b.level(), b.tileid());
+  });
+  if (!sharded()) {
+    return tiles;
+  }
+  auto begin = tiles.size() * index / count;
+  auto end = tiles.size() * (index + 1) / count;
+  return {tiles.begin() + begin, tiles.begin() + end};
+}
+
+// one tile per line, * when all of them changed
+void TileChanges::Record(const std::string& tile_dir, const std::vector<baldr::GraphId>& tiles) {
+  std::stringstream lines;
+  for (const auto& tile : tiles) {
+    lines << tile.Tile_Base().value << '\n';
+  }
+  // a single write at the end of the file so records of several processes dont interleave
+  const auto file_name = changed_tiles_path(tile_dir);
+  std::ofstream file(file_name, std::ios::out | std::ios::app);
+  file << lines.str() << std::flush;
+  if (!file) {
+    throw std::runtime_error("Failed to record the changed tiles in " + file_name);
+  }
+}
+
+void TileChanges::RecordAll(const std::string& tile_dir) {
+  const auto file_name = changed_tiles_path(tile_dir);
+  std::ofstream file(file_name, std::ios::out | std::ios::app);
+  file << "*\n" << std::flush;
+  if (!file) {
+    throw std::runtime_error("Failed to record the changed tiles in " + file_name);
+  }
+}
+
+TileChanges TileChanges::Read(const std::string& tile_dir) {
+  TileChanges changes;
+  std::ifstream file(changed_tiles_path(tile_dir));
+  if (!file) {
+    changes.all = true;
+    return changes;
+  }
+  std::string line;
+  while (std::getline(file, line) && !changes.all) {
+    if (line == "*") {
+      changes.all = true;
+    } else if (!line.empty()) {
+      changes.tiles.insert(baldr::GraphId(std::stoull(line)));
+    }
+  }
+  if (changes.all) {
+    changes.tiles.clear();
+  }
+  return changes;
+}
+
+void TileChanges::Clear(const std::string& tile_dir) {
+  const auto file_name = changed_tiles_path(tile_dir);
+  if (filesystem::exists(file_name)) {
+    filesystem::remove(file_name);
+  }
+}
+
 bool build_tile_set(const boost::property_tree::ptree& original_config,
                     const std::vector<std::string>& input_files,
                     const BuildStage start_stage,
@@ -195,9 +323,45 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     tile_dir.push_back(filesystem::path::preferred_separator);
   }
 
+  // A shard has to wait for the others between the stages that are split by tile, it cant run
+  // one of them together with any other stage
+  const auto shard = TileShard::FromConfig(config);
+  auto per_tile = [](const BuildStage stage) {
+    return stage == BuildStage::kBuild || stage == BuildStage::kEnhance ||
+           stage == BuildStage::kElevation || stage == BuildStage::kValidate;
+  };
+  if (shard.sharded()) {
+    bool spans_per_tile = false;
+    for (auto stage = static_cast<int>(start_stage); stage <= static_cast<int>(end_stage); ++stage) {
+      spans_per_tile = spans_per_tile || per_tile(static_cast<BuildStage>(stage));
+    }
+    if (spans_per_tile && start_stage != end_stage) {
+      LOG_ERROR("Shard " + std::to_string(shard.index) + "/" + std::to_string(shard.count) +
+                " can only run the build, enhance, elevation and validate stages one at a time");
+      return false;
+    }
+    LOG_INFO("Building shard " + std::to_string(shard.index) + " of " +
+             std::to_string(shard.count) +
+             (shard.shared() ? "" : ", the stages that are not split by tile are skipped"));
+  }
+  // How the intermediate files are mapped and written
+  auto& hints = valhalla::midgard::sequence_hints();
+  hints.huge_pages = config.get<bool>("mjolnir.intermediate_files.huge_pages", hints.huge_pages);
+  hints.populate = config.get<bool>("mjolnir.intermediate_files.populate", hints.populate);
+  hints.write_behind =
+      config.get<bool>("mjolnir.intermediate_files.write_behind", hints.write_behind);
+  hints.write_buffer_size = std::max<size_t>(
+      config.get<size_t>("mjolnir.intermediate_files.write_buffer_size", hints.write_buffer_size),
+      1);
+
+  // Whether to run a stage, the ones that are not split by tile only run in one shard
+  auto run = [&](const BuildStage stage) {
+    return start_stage <= stage && stage <= end_stage && (shard.shared() || per_tile(stage));
+  };
+
   // During the initialize stage the tile directory will be purged (if it already exists)
   // and will be created if it does not already exist
-  if (start_stage == BuildStage::kInitialize) {
+  if (start_stage == BuildStage::kInitialize && shard.shared()) {
     // set up the directories and purge old tiles if starting at the parsing stage
     for (const auto& level : valhalla::baldr::TileHierarchy::levels()) {
       auto level_dir = tile_dir + std::to_string(level.level);
@@ -215,6 +379,16 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
       filesystem::remove_all(level_dir);
     }
 
+    // the connectivity of the old tiles doesnt hold for the new ones
+    auto connectivity = tile_dir + valhalla::baldr::kConnectivityFile;
+    if (filesystem::exists(connectivity)) {
+      LOG_WARN("Removing " + connectivity + ", the connectivity stage writes it again");
+      filesystem::remove(connectivity);
+    }
+
+    // all of the new tiles are validated
+    TileChanges::Clear(tile_dir);
+
     // Create the directory if it does not exist
     filesystem::create_directories(tile_dir);
   }
@@ -236,8 +410,12 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   // OSMData class
   OSMData osm_data{0};
 
+  // Trade speed for memory by keeping the way and relation data on disk while it is not used,
+  // it is written and read one more time in exchange
+  const bool low_memory = config.get<bool>("mjolnir.low_memory", false);
+
   // Parse the ways
-  if (start_stage <= BuildStage::kParseWays && BuildStage::kParseWays <= end_stage) {
+  if (run(BuildStage::kParseWays)) {
     // Read the OSM protocol buffer file. Callbacks for ways are defined within the PBFParser class
     osm_data = PBFGraphParser::ParseWays(config.get_child("mjolnir"), input_files, ways_bin,
                                          way_nodes_bin, access_bin, pronunciation_bin);
@@ -251,10 +429,11 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     if (end_stage <= BuildStage::kEnhance) {
       osm_data.write_to_temp_files(tile_dir);
     }
+    log_memory(BuildStage::kParseWays);
   }
 
   // Parse OSM data
-  if (start_stage <= BuildStage::kParseRelations && BuildStage::kParseRelations <= end_stage) {
+  if (run(BuildStage::kParseRelations)) {
 
     // Read the OSM protocol buffer file. Callbacks for relations are defined within the PBFParser
     // class
@@ -266,14 +445,18 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
       OSMPBF::Parser::free();
     }
 
-    // Write the OSMData to files if the end stage is less than enhancing
-    if (end_stage <= BuildStage::kEnhance) {
+    // Write the OSMData to files if the end stage is less than enhancing, parsing the nodes
+    // and constructing the edges dont need it in memory
+    if (low_memory && end_stage >= BuildStage::kParseNodes && end_stage <= BuildStage::kEnhance) {
+      osm_data.release_to_temp_files(tile_dir);
+    } else if (end_stage <= BuildStage::kEnhance) {
       osm_data.write_to_temp_files(tile_dir);
     }
+    log_memory(BuildStage::kParseRelations);
   }
 
   // Parse OSM data
-  if (start_stage <= BuildStage::kParseNodes && BuildStage::kParseNodes <= end_stage) {
+  if (run(BuildStage::kParseNodes)) {
     // Read the OSM protocol buffer file. Callbacks for nodes
     // are defined within the PBFParser class
     PBFGraphParser::ParseNodes(config.get_child("mjolnir"), input_files, way_nodes_bin, bss_nodes_bin,
@@ -285,14 +468,18 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     }
 
     // Write the OSMData to files if the end stage is less than enhancing
-    if (end_stage <= BuildStage::kEnhance) {
+    if (low_memory && end_stage >= BuildStage::kConstructEdges &&
+        end_stage <= BuildStage::kEnhance) {
+      osm_data.release_to_temp_files(tile_dir);
+    } else if (end_stage <= BuildStage::kEnhance) {
       osm_data.write_to_temp_files(tile_dir);
     }
+    log_memory(BuildStage::kParseNodes);
   }
 
   // Construct edges
   std::map<baldr::GraphId, size_t> tiles;
-  if (start_stage <= BuildStage::kConstructEdges && BuildStage::kConstructEdges <= end_stage) {
+  if (run(BuildStage::kConstructEdges)) {
 
     // Read OSMData from files if construct edges is the first stage
     if (start_stage == BuildStage::kConstructEdges)
@@ -302,10 +489,19 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     // Output manifest
     TileManifest manifest{tiles};
     manifest.LogToFile(tile_manifest);
+
+    // The shards only build their tiles from the edges, they cant all reclassify them
+    if (shard.sharded()) {
+      if (osm_data.released) {
+        osm_data.read_from_temp_files(tile_dir);
+      }
+      GraphBuilder::Reclassify(config, osm_data, ways_bin, way_nodes_bin, nodes_bin, edges_bin);
+    }
+    log_memory(BuildStage::kConstructEdges);
   }
 
   // Build Valhalla routing tiles
-  if (start_stage <= BuildStage::kBuild && BuildStage::kBuild <= end_stage) {
+  if (run(BuildStage::kBuild)) {
     if (start_stage == BuildStage::kBuild) {
       // Read OSMData from files if building tiles is the first stage
       osm_data.read_from_temp_files(tile_dir);
@@ -317,56 +513,84 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
         LOG_WARN("Tile manifest not found, rebuilding edges and manifest");
         tiles = GraphBuilder::BuildEdges(config, ways_bin, way_nodes_bin, nodes_bin, edges_bin);
       }
+    } else if (osm_data.released) {
+      // Read OSMData back from files if it was released to save memory
+      osm_data.read_from_temp_files(tile_dir);
     }
 
     // Build the graph using the OSMNodes and OSMWays from the parser
     GraphBuilder::Build(config, osm_data, ways_bin, way_nodes_bin, nodes_bin, edges_bin, cr_from_bin,
                         cr_to_bin, pronunciation_bin, tiles);
+    std::vector<baldr::GraphId> built;
+    for (const auto& tile : tiles) {
+      built.push_back(tile.first);
+    }
+    TileChanges::Record(tile_dir, shard.Select(std::move(built)));
+
+    // The later stages only use the names
+    if (low_memory) {
+      OSMData names{0};
+      names.name_offset_map = std::move(osm_data.name_offset_map);
+      osm_data = std::move(names);
+    }
+    log_memory(BuildStage::kBuild);
   }
 
   // Enhance the local level of the graph. This adds information to the local
   // level that is usable across all levels (density, administrative
   // information (and country based attribution), edge transition logic, etc.
-  if (start_stage <= BuildStage::kEnhance && BuildStage::kEnhance <= end_stage) {
+  if (run(BuildStage::kEnhance)) {
     // Read OSMData names from file if enhancing tiles is the first stage
     if (start_stage == BuildStage::kEnhance) {
       osm_data.read_from_unique_names_file(tile_dir);
     }
     GraphEnhancer::Enhance(config, osm_data, access_bin);
+    TileChanges::RecordAll(tile_dir);
+    log_memory(BuildStage::kEnhance);
   }
 
   // Perform optional edge filtering (remove edges and nodes for specific access modes)
-  if (start_stage <= BuildStage::kFilter && BuildStage::kFilter <= end_stage) {
+  if (run(BuildStage::kFilter)) {
     GraphFilter::Filter(config);
+    TileChanges::RecordAll(tile_dir);
+    log_memory(BuildStage::kFilter);
   }
 
   // Add transit
-  if (start_stage <= BuildStage::kTransit && BuildStage::kTransit <= end_stage) {
+  if (run(BuildStage::kTransit)) {
     TransitBuilder::Build(config);
+    TileChanges::RecordAll(tile_dir);
+    log_memory(BuildStage::kTransit);
   }
 
   // Build bike share stations
-  if (start_stage <= BuildStage::kBss && BuildStage::kBss <= end_stage) {
+  if (run(BuildStage::kBss)) {
     if (start_stage == BuildStage::kBss) {
       osm_data.read_from_unique_names_file(tile_dir);
     }
     BssBuilder::Build(config, osm_data, bss_nodes_bin);
+    TileChanges::RecordAll(tile_dir);
+    log_memory(BuildStage::kBss);
   }
 
   // Builds additional hierarchies if specified within config file. Connections
   // (directed edges) are formed between nodes at adjacent levels.
   auto build_hierarchy = config.get<bool>("mjolnir.hierarchy", true);
   if (build_hierarchy) {
-    if (start_stage <= BuildStage::kHierarchy && BuildStage::kHierarchy <= end_stage) {
+    if (run(BuildStage::kHierarchy)) {
       HierarchyBuilder::Build(config, new_to_old_bin, old_to_new_bin);
+      TileChanges::RecordAll(tile_dir);
+      log_memory(BuildStage::kHierarchy);
     }
 
     // Build shortcuts if specified in the config file. Shortcuts can only be
     // applied if hierarchies are also generated.
     auto build_shortcuts = config.get<bool>("mjolnir.shortcuts", true);
     if (build_shortcuts) {
-      if (start_stage <= BuildStage::kShortcuts && BuildStage::kShortcuts <= end_stage) {
+      if (run(BuildStage::kShortcuts)) {
         ShortcutBuilder::Build(config);
+        TileChanges::RecordAll(tile_dir);
+        log_memory(BuildStage::kShortcuts);
       }
     } else {
       LOG_INFO("Skipping shortcut builder");
@@ -376,25 +600,44 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   }
 
   // Add elevation to the tiles
-  if (start_stage <= BuildStage::kElevation && BuildStage::kElevation <= end_stage) {
+  if (run(BuildStage::kElevation)) {
     ElevationBuilder::Build(config);
+    TileChanges::RecordAll(tile_dir);
+    log_memory(BuildStage::kElevation);
   }
 
   // Build the Complex Restrictions
   // ComplexRestrictions must be done after elevation. The reason is that building
   // elevation into the tiles reads each tile and serializes the data to "builders"
   // within the tile. However, there is no serialization currently available for complex restrictions.
-  if (start_stage <= BuildStage::kRestrictions && BuildStage::kRestrictions <= end_stage) {
+  if (run(BuildStage::kRestrictions)) {
     RestrictionBuilder::Build(config, cr_from_bin, cr_to_bin);
+    TileChanges::RecordAll(tile_dir);
+    log_memory(BuildStage::kRestrictions);
   }
 
   // Validate the graph and add information that cannot be added until full graph is formed.
-  if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
+  if (run(BuildStage::kValidate)) {
     GraphValidator::Validate(config);
+    log_memory(BuildStage::kValidate);
+  }
+
+  // Bin the edges that pass through tiles of other shards
+  if (run(BuildStage::kMerge) && shard.sharded()) {
+    GraphValidator::Merge(config);
+    log_memory(BuildStage::kMerge);
+  }
+
+  // Work out which nodes are connected for which modes so the services can tell there is no route
+  // without searching for one
+  if (run(BuildStage::kConnectivity)) {
+    ConnectivityBuilder::Build(config.get_child("mjolnir"),
+                               tile_dir + valhalla::baldr::kConnectivityFile);
+    log_memory(BuildStage::kConnectivity);
   }
 
   // Cleanup bin files
-  if (start_stage <= BuildStage::kCleanup && BuildStage::kCleanup <= end_stage) {
+  if (run(BuildStage::kCleanup)) {
     LOG_INFO("Cleaning up temporary *.bin files within " + tile_dir);
     remove_temp_file(ways_bin);
     remove_temp_file(way_nodes_bin);
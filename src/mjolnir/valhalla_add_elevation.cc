@@ -12,6 +12,7 @@
 #include "baldr/rapidjson_utils.h"
 #include "config.h"
 #include "mjolnir/elevationbuilder.h"
+#include "mjolnir/util.h"
 
 #include "argparse_utils.h"
 
@@ -119,5 +120,8 @@ int main(int argc, char** argv) {
   }
 
   ElevationBuilder::Build(config, tile_ids);
+  // the validator only has to look at the tiles with elevation
+  TileChanges::Record(config.get<std::string>("mjolnir.tile_dir"),
+                      {tile_ids.begin(), tile_ids.end()});
   return EXIT_SUCCESS;
 }
\ No newline at end of file
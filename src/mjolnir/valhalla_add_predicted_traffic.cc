@@ -1,13 +1,16 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <deque>
+#include <fstream>
 #include <future>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <boost/archive/iterators/base64_from_binary.hpp>
 #include <boost/archive/iterators/binary_from_base64.hpp>
@@ -60,8 +63,115 @@ struct TrafficSpeeds {
   std::optional<std::array<int16_t, kCoefficientCount>> coefficients;
 };
 
+// Binary speed files have this extension, everything else is read as CSV
+constexpr char kBinaryExtension[] = ".spd";
+constexpr char kBinaryMagic[4] = {'V', 'S', 'P', 'D'};
+constexpr uint16_t kBinaryVersion = 1;
+
+// Header of a binary speed file, it is followed by its records
+struct BinaryHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t spare;
+  uint32_t record_count;
+};
+
+// A record of a binary speed file, the kind of the speeds it has says what follows it
+enum class BinarySpeeds : uint8_t {
+  kNone = 0,         // nothing
+  kCoefficients = 1, // kCoefficientCount compressed int16_t coefficients
+  kBuckets = 2       // kBucketsPerWeek uint8_t speeds in KPH, compressed when they are read
+};
+struct BinaryRecord {
+  uint32_t edge_index;
+  uint8_t free_flow_speed;
+  uint8_t constrained_flow_speed;
+  BinarySpeeds speeds;
+  uint8_t spare;
+};
+
+/**
+ * Read a binary speed file at once, all of its numbers are little endian. It has the speeds of
+ * the edges of one tile without any text to parse, see BinaryHeader and BinaryRecord.
+ */
+void ParseBinaryTrafficFile(const std::string& full_filename,
+                            std::unordered_map<uint32_t, TrafficSpeeds>& ts,
+                            stats& stat) {
+  std::ifstream file(full_filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    LOG_ERROR("Could not open file: " + full_filename);
+    return;
+  }
+  std::vector<char> bytes(file.tellg());
+  file.seekg(0);
+  file.read(bytes.data(), bytes.size());
+  file.close();
+
+  BinaryHeader header;
+  if (bytes.size() < sizeof(header)) {
+    LOG_WARN("Invalid binary speed file: " + full_filename);
+    return;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) ||
+      header.version != kBinaryVersion) {
+    LOG_WARN("Invalid binary speed file: " + full_filename);
+    return;
+  }
+
+  std::array<float, kBucketsPerWeek> buckets;
+  const char* ptr = bytes.data() + sizeof(header);
+  const char* const end = bytes.data() + bytes.size();
+  for (uint32_t i = 0; i < header.record_count; ++i) {
+    BinaryRecord record;
+    if (end - ptr < static_cast<std::ptrdiff_t>(sizeof(record))) {
+      LOG_WARN("Truncated binary speed file: " + full_filename + " record " + std::to_string(i));
+      return;
+    }
+    std::memcpy(&record, ptr, sizeof(record));
+    ptr += sizeof(record);
+
+    size_t speeds_size = 0;
+    if (record.speeds == BinarySpeeds::kCoefficients) {
+      speeds_size = kCoefficientCount * sizeof(int16_t);
+    } else if (record.speeds == BinarySpeeds::kBuckets) {
+      speeds_size = kBucketsPerWeek;
+    }
+    if (record.speeds > BinarySpeeds::kBuckets ||
+        end - ptr < static_cast<std::ptrdiff_t>(speeds_size)) {
+      LOG_WARN("Invalid speeds in binary speed file: " + full_filename + " record " +
+               std::to_string(i));
+      return;
+    }
+    const char* speeds = ptr;
+    ptr += speeds_size;
+
+    // skip duplicates
+    auto inserted = ts.emplace(record.edge_index, TrafficSpeeds{});
+    if (!inserted.second) {
+      ++stat.dup_count;
+      continue;
+    }
+    auto& traffic = inserted.first->second;
+    traffic.free_flow_speed = record.free_flow_speed;
+    traffic.constrained_flow_speed = record.constrained_flow_speed;
+    stat.free_flow_count++;
+    stat.constrained_count++;
+    if (record.speeds == BinarySpeeds::kCoefficients) {
+      traffic.coefficients.emplace();
+      std::memcpy(traffic.coefficients->data(), speeds, speeds_size);
+      stat.compressed_count++;
+    } else if (record.speeds == BinarySpeeds::kBuckets) {
+      const auto* kph = reinterpret_cast<const uint8_t*>(speeds);
+      std::copy(kph, kph + kBucketsPerWeek, buckets.begin());
+      traffic.coefficients = compress_speed_buckets(buckets.data());
+      stat.compressed_count++;
+    }
+  }
+}
+
 /**
- * Read speed CSV file and update the tile_speeds in unique_data
+ * Read the speed files of a tile, binary or CSV, and keep the speeds of each edge
  */
 std::unordered_map<uint32_t, TrafficSpeeds>
 ParseTrafficFile(const std::vector<std::string>& filenames, stats& stat) {
@@ -71,6 +181,11 @@ ParseTrafficFile(const std::vector<std::string>& filenames, stats& stat) {
 
   // for each traffic tile
   for (const auto& full_filename : filenames) {
+    if (filesystem::path(full_filename).extension().string() == kBinaryExtension) {
+      ParseBinaryTrafficFile(full_filename, ts, stat);
+      continue;
+    }
+
     // Open file
     std::string line;
     std::ifstream file(full_filename);
@@ -159,50 +274,31 @@ void update_tile(const std::string& tile_dir,
                  const GraphId& tile_id,
                  const std::unordered_map<uint32_t, TrafficSpeeds>& speeds,
                  stats& stat) {
-  auto tile_path = tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(tile_id);
-  if (!filesystem::exists(tile_path)) {
-    LOG_ERROR("No tile at " + tile_path);
-    return;
-  }
-
-  // Get the tile
-  vj::GraphTileBuilder tile_builder(tile_dir, tile_id, false);
-
-  // Get a count of how many predicted speed edges there will be this avoids reallocs
-  size_t pred_count = 0;
-  for (uint32_t j = 0; j < tile_builder.header()->directededgecount(); ++j) {
-    auto found = speeds.find(j);
-    pred_count += found != speeds.cend() && static_cast<bool>(found->second.coefficients);
-  }
-
-  // Update directed edges as needed
-  std::vector<DirectedEdge> directededges;
-  directededges.reserve(tile_builder.header()->directededgecount());
-  for (uint32_t j = 0; j < tile_builder.header()->directededgecount(); ++j) {
-    // skip edges for which we dont have speed data
-    DirectedEdge& directededge = tile_builder.directededge(j);
-    auto found = speeds.find(j);
-    if (found != speeds.end()) {
-      const auto& speed = found->second;
-      if (speed.constrained_flow_speed) {
-        directededge.set_constrained_flow_speed(speed.constrained_flow_speed);
-      }
-      if (speed.free_flow_speed) {
-        directededge.set_free_flow_speed(speed.free_flow_speed);
-      }
-      if (speed.coefficients) {
-        tile_builder.AddPredictedSpeed(j, *speed.coefficients, pred_count);
-        directededge.set_has_predicted_speed(true);
-      }
-      ++stat.updated_count;
+  // Patch the edges and the predicted speeds into the tile as it is on disk
+  auto patch = [&speeds, &stat](const uint32_t idx, DirectedEdge& directededge,
+                                std::array<int16_t, kCoefficientCount>& coefficients) {
+    auto found = speeds.find(idx);
+    if (found == speeds.cend()) {
+      return false;
     }
-
-    // Add the directed edge to the local list
-    directededges.emplace_back(std::move(directededge));
+    const auto& speed = found->second;
+    if (speed.constrained_flow_speed) {
+      directededge.set_constrained_flow_speed(speed.constrained_flow_speed);
+    }
+    if (speed.free_flow_speed) {
+      directededge.set_free_flow_speed(speed.free_flow_speed);
+    }
+    ++stat.updated_count;
+    if (!speed.coefficients) {
+      return false;
+    }
+    coefficients = *speed.coefficients;
+    return true;
+  };
+  if (!vj::GraphTileBuilder::PatchPredictedSpeeds(tile_dir, tile_id, patch)) {
+    LOG_ERROR("No tile at " + tile_dir + filesystem::path::preferred_separator +
+              GraphTile::FileSuffix(tile_id));
   }
-
-  // Write the new tile with updated directed edges and the predicted speeds
-  tile_builder.UpdatePredictedSpeeds(directededges);
 }
 
 /**
@@ -249,7 +345,9 @@ int main(int argc, char** argv) {
     cxxopts::Options options(
       program,
       program + " " + VALHALLA_VERSION + "\n\n"
-      "adds predicted traffic to valhalla tiles.\n");
+      "adds predicted traffic to valhalla tiles.\n\n"
+      "The speeds of a tile are read from the CSV or binary " + std::string(kBinaryExtension) +
+      " files named after it in the traffic tile dir.\n");
 
     options.add_options()
       ("h,help", "Print this help message.")
@@ -356,6 +454,13 @@ int main(int argc, char** argv) {
   LOG_INFO("Parsed " + std::to_string(compressed_count) + " compressed records.");
   LOG_INFO("Updated " + std::to_string(updated_count) + " directed edges.");
   LOG_INFO("Duplicate count " + std::to_string(duplicate_count) + ".");
+
+  // the validator only has to look at the tiles with new speeds
+  std::vector<GraphId> changed;
+  for (const auto& tile : traffic_tiles) {
+    changed.push_back(tile.first);
+  }
+  vj::TileChanges::Record(tile_dir, changed);
   LOG_INFO("Finished");
 
   if (!summary)
@@ -0,0 +1,89 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/osmchange.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string osc_file, output_file;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_affected_tiles reads an OSM change file (.osc) and prints the paths of the tiles "
+      "of the configured graph that the change affects, one per line. Tiles with changed nodes or "
+      "ways, their neighbors, the tiles with edges into those and the tiles of the higher levels "
+      "that contain any of them are listed, so that after rebuilding from the updated extract "
+      "only these have to be published.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("o,output", "Write the tile paths to this file instead of stdout, which the log may share.", cxxopts::value<std::string>(output_file))
+      ("osc", "positional argument", cxxopts::value<std::string>(osc_file));
+    // clang-format on
+
+    options.parse_positional({"osc"});
+    options.positional_help("OSM change file");
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!result.count("osc")) {
+      throw cxxopts::OptionException("OSM change file is required\n\n" + options.help() + "\n\n");
+    }
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream osc(osc_file);
+  if (!osc.is_open()) {
+    std::cerr << "Unable to open: " << osc_file << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto change = mjolnir::OSMChange::Read(osc);
+  LOG_INFO("Change has " + std::to_string(change.node_positions.size()) + " nodes and " +
+           std::to_string(change.way_ids.size()) + " ways");
+
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  const auto affected = mjolnir::AffectedTiles(reader, change);
+
+  std::ofstream output;
+  if (!output_file.empty()) {
+    output.open(output_file);
+    if (!output.is_open()) {
+      std::cerr << "Unable to open: " << output_file << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream& out = output_file.empty() ? std::cout : output;
+  for (const auto& tile_id : affected) {
+    out << baldr::GraphTile::FileSuffix(tile_id) << "\n";
+  }
+  return EXIT_SUCCESS;
+}
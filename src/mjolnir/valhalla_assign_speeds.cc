@@ -3,6 +3,8 @@
 #include "baldr/rapidjson_utils.h"
 #include "config.h"
 #include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/tilescheduler.h"
+#include "mjolnir/util.h"
 #include "speed_assigner.h"
 
 #include <cxxopts.hpp>
@@ -10,6 +12,7 @@
 #include <boost/property_tree/ptree.hpp>
 
 #include <algorithm>
+#include <cstring>
 #include <future>
 #include <memory>
 #include <thread>
@@ -21,36 +24,30 @@ using namespace valhalla::baldr;
 using namespace valhalla::mjolnir;
 
 void assign(const boost::property_tree::ptree& config,
-            std::deque<GraphId>& tilequeue,
-            std::mutex& lock,
+            TileScheduler& scheduler,
+            size_t worker,
+            std::vector<GraphId>& changed_tiles,
             std::promise<std::pair<size_t, size_t>>& result) {
   size_t assigned = 0, total = 0;
   SpeedAssigner assigner(config.get_optional<std::string>("mjolnir.default_speeds_config"));
   bool infer_turn_channels = config.get<bool>("mjolnir.data_processing.infer_turn_channels");
+  const auto tile_dir = config.get<std::string>("mjolnir.tile_dir");
+  // every thread reads through a cache of its own so none of them waits on another
   GraphReader graph_reader(config.get_child("mjolnir"));
 
-  while (true) {
-    // get the next job or quit
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
     // update all the edges
     graph_tile_ptr tile = graph_reader.GetGraphTile(tile_id);
-    if (tile->header()->directededgecount() == 0)
+    if (!tile || tile->header()->directededgecount() == 0)
       continue;
     std::vector<DirectedEdge> edges(tile->directededge(0),
                                     tile->directededge(0) + tile->header()->directededgecount());
+    graph_tile_ptr end_tile = tile;
     for (auto& edge : edges) {
       // get the end node
-      lock.lock();
-      graph_tile_ptr end_tile = graph_reader.GetGraphTile(edge.endnode());
-      lock.unlock();
+      if (!graph_reader.GetGraphTile(edge.endnode(), end_tile))
+        continue;
       const auto* node = end_tile->node(edge.endnode());
       const auto* admin = end_tile->admin(node->admin_index());
       // TODO: if this was a shortcut we need to bother about turn durations...
@@ -60,17 +57,22 @@ void assign(const boost::property_tree::ptree& config,
       ++total;
     }
 
-    // copy the nodes
-    std::vector<NodeInfo> nodes(tile->node(0), tile->node(0) + tile->header()->nodecount());
+    // only the speeds changed so the edges are written over where they are in the tile, tiles
+    // that can't be patched like that are written back out whole
+    const bool changed = std::memcmp(edges.data(), tile->directededge(0),
+                                     edges.size() * sizeof(DirectedEdge)) != 0;
+    if (changed && !GraphTileBuilder::PatchDirectedEdges(tile_dir, tile_id, edges)) {
+      std::vector<NodeInfo> nodes(tile->node(0), tile->node(0) + tile->header()->nodecount());
+      GraphTileBuilder tilebuilder(tile_dir, tile_id, false);
+      tilebuilder.Update(nodes, edges);
+    }
+    if (changed) {
+      changed_tiles.push_back(tile_id);
+    }
 
-    // write the tile back out
-    GraphTileBuilder tilebuilder(config.get<std::string>("mjolnir.tile_dir"), tile_id, false);
-    lock.lock();
-    tilebuilder.Update(nodes, edges);
     if (graph_reader.OverCommitted()) {
       graph_reader.Trim();
     }
-    lock.unlock();
   }
 
   result.set_value({assigned, total});
@@ -120,23 +122,24 @@ int main(int argc, char** argv) {
     valhalla::midgard::logging::Configure(logging_config);
   }
 
-  // queue some tiles up to modify
-  std::deque<GraphId> tilequeue;
+  // schedule the tiles to modify, neighbouring ones go to the same thread as the end nodes of
+  // their edges are mostly in the same tiles
   GraphReader reader(config.get_child("mjolnir"));
   auto tileset = reader.GetTileSet();
-  for (const auto& id : tileset) {
-    tilequeue.emplace_back(id);
-  }
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(3));
+  std::vector<GraphId> tiles(tileset.begin(), tileset.end());
+  std::vector<std::shared_ptr<std::thread>> threads(
+      std::max(config.get<unsigned int>("mjolnir.concurrency"), 1u));
+  TileScheduler scheduler("Assigning speeds", std::move(tiles), threads.size(),
+                          TileScheduler::FileSize(reader.tile_dir()),
+                          TileScheduler::kNeighbourBatch);
 
   // spawn threads to modify the tiles
-  std::vector<std::shared_ptr<std::thread>> threads(config.get<unsigned int>("mjolnir.concurrency"));
   std::list<std::promise<std::pair<size_t, size_t>>> results;
-  std::mutex lock;
-  for (auto& thread : threads) {
+  std::vector<std::vector<GraphId>> changed_tiles(threads.size());
+  for (size_t i = 0; i < threads.size(); ++i) {
     results.emplace_back();
-    thread.reset(new std::thread(assign, std::cref(config), std::ref(tilequeue), std::ref(lock),
-                                 std::ref(results.back())));
+    threads[i].reset(new std::thread(assign, std::cref(config), std::ref(scheduler), i,
+                                     std::ref(changed_tiles[i]), std::ref(results.back())));
   }
 
   // collect the results
@@ -149,6 +152,14 @@ int main(int argc, char** argv) {
     assigned += stat.first;
     total += stat.second;
   }
+  scheduler.LogUtilization();
+
+  // the validator only has to look at the tiles with new speeds
+  std::vector<GraphId> changed;
+  for (const auto& tiles : changed_tiles) {
+    changed.insert(changed.end(), tiles.begin(), tiles.end());
+  }
+  TileChanges::Record(reader.tile_dir(), changed);
 
   LOG_INFO("Assigned speeds to " + std::to_string(assigned) + " edges in total out of " +
            std::to_string(total));
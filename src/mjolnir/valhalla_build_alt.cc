@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "baldr/rapidjson_utils.h"
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/altbuilder.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string file;
+  uint32_t landmarks = 0;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_build_alt picks landmarks spread over the graph and measures the network distance "
+      "between every node and each of them, so that the A* searches of thor can bound the cost to "
+      "their destination with the triangle inequality instead of the straight line distance. Run "
+      "it after the tiles are built and point mjolnir.alt_bounds of the services at the result.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("o,output", "Where to write the distances, overrides mjolnir.alt_bounds.", cxxopts::value<std::string>())
+      ("l,landmarks", "Number of landmarks to pick.", cxxopts::value<uint32_t>()->default_value("16"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    file = result.count("output") ? result["output"].as<std::string>()
+                                  : config.get<std::string>("mjolnir.alt_bounds", "");
+    landmarks = result["landmarks"].as<uint32_t>();
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (file.empty()) {
+    std::cerr << "Either --output or mjolnir.alt_bounds needs to say where to write the distances"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (landmarks == 0) {
+    std::cerr << "At least one landmark is needed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  auto logging_subtree = config.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  try {
+    mjolnir::AltBuilder::Build(config.get_child("mjolnir"), file, landmarks);
+  } catch (std::exception& e) {
+    LOG_ERROR(std::string("Failed to measure the landmark distances: ") + e.what());
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Finished");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include "argparse_utils.h"
+#include "baldr/rapidjson_utils.h"
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/bsstablesbuilder.h"
+#include <cxxopts.hpp>
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree pt;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_build_bss_tables is a program that builds the station to station bicycle rides\n"
+      "between the bike share stations of existing graph tiles, so that bikeshare routes and\n"
+      "matrices can look them up instead of searching for them.\n"
+      "It should run after the bike share stations have been added to the tiles."
+      "\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>());
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, pt, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  auto logging_subtree = pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  try {
+    valhalla::mjolnir::BssTablesBuilder::Build(pt);
+  } catch (const std::exception& e) {
+    LOG_ERROR(std::string("Failed to build bike share tables: ") + e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -14,6 +14,8 @@
 #include "baldr/tilehierarchy.h"
 #include "config.h"
 #include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/connectivitybuilder.h"
 
 #include "argparse_utils.h"
 
@@ -53,8 +55,12 @@ int main(int argc, char** argv) {
     cxxopts::Options options(
       program,
       program + " " + VALHALLA_VERSION + "\n\n"
-      "valhalla_build_connectivity is a program that creates a PPM image file representing\n"
-      "the connectivity between tiles.\n\n");
+      "valhalla_build_connectivity is a program that writes the connectivity of the tiles to\n"
+      "connectivity.bin in the tile_dir, which loki maps at startup instead of working it out\n"
+      "and which valhalla_build_tile_extract puts in the tile extract. Besides the tiles it\n"
+      "knows which nodes are connected, so routes between locations that are not get rejected\n"
+      "right away. It also creates a GeoJSON and a PPM image file representing the connectivity\n"
+      "between tiles.\n\n");
 
     options.add_options()
       ("h,help", "Print this help message.")
@@ -75,6 +81,26 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  // Work out the connectivity and store it with the tiles
+  const auto tile_dir = pt.get<std::string>("mjolnir.tile_dir", "");
+  if (tile_dir.empty()) {
+    std::cerr << "mjolnir.tile_dir is needed to write " << kConnectivityFile << std::endl;
+    return EXIT_FAILURE;
+  }
+  const auto file = tile_dir + filesystem::path::preferred_separator + kConnectivityFile;
+  try {
+    filesystem::remove(file);
+    auto stats = valhalla::mjolnir::ConnectivityBuilder::Build(pt.get_child("mjolnir"), file);
+    LOG_INFO("Wrote " + file + " with " + std::to_string(stats.tiles) + " tiles and " +
+             std::to_string(stats.nodes) + " nodes in " + std::to_string(stats.components) +
+             " weak and " + std::to_string(stats.strong_components) +
+             " strong components, " + std::to_string(stats.listed) +
+             " times a node is not in the component of its tile");
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
   // Get something we can use to fetch tiles
   valhalla::baldr::connectivity_map_t connectivity_map(pt.get_child("mjolnir"));
 
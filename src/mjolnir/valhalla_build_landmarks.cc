@@ -18,7 +18,8 @@ int main(int argc, char** argv) {
       program,
       program + " " + VALHALLA_VERSION + "\n\n"
       "valhalla_build_landmarks is a program that builds a SQLite database to store POI as landmarks from \n"
-      "one or multiple osm.pbf files. The landmark db is used during graph building to facilitate navigation."
+      "one or multiple osm.pbf files. The landmark db is used during graph building to facilitate navigation.\n"
+      "With mjolnir.landmark_store configured the landmarks are written to that store instead."
       "\n\n");
 
     options.add_options()
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct stats {
+  uint64_t tiles = 0;
+  uint64_t edges = 0;
+  uint64_t missing = 0;
+};
+
+void build_opposing(const boost::property_tree::ptree& config,
+                    std::vector<GraphId>::const_iterator tile_start,
+                    std::vector<GraphId>::const_iterator tile_end,
+                    std::promise<stats>& result) {
+  try {
+    GraphReader reader(config);
+    const auto tile_dir = config.get<std::string>("tile_dir");
+
+    stats stat{};
+    std::vector<GraphId> opposing_edge_ids;
+    for (; tile_start != tile_end; ++tile_start) {
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+
+      graph_tile_ptr tile = reader.GetGraphTile(*tile_start);
+      if (!tile) {
+        continue;
+      }
+
+      // look the opposing edges up from the end nodes rather than asking the reader, which would
+      // hand back what an earlier run stored in the tile
+      const uint32_t edge_count = tile->header()->directededgecount();
+      opposing_edge_ids.assign(edge_count, GraphId{});
+      graph_tile_ptr end_tile = tile;
+      for (uint32_t i = 0; i < edge_count; ++i) {
+        const auto* edge = tile->directededge(i);
+        if (edge->IsTransitLine()) {
+          continue;
+        }
+        GraphId end_node = edge->endnode();
+        if (!reader.GetGraphTile(end_node, end_tile)) {
+          ++stat.missing;
+          continue;
+        }
+        opposing_edge_ids[i] = end_tile->GetOpposingEdgeId(edge);
+      }
+
+      // write the section, the tile is swapped in whole so other threads can keep reading it
+      mjolnir::GraphTileBuilder tile_builder(tile_dir, *tile_start, false);
+      tile_builder.UpdateOpposingEdgeIds(opposing_edge_ids);
+      ++stat.tiles;
+      stat.edges += edge_count;
+    }
+    result.set_value(stat);
+  } catch (...) { result.set_exception(std::current_exception()); }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_build_opposing stores the id of the opposing directed edge of every directed edge "
+      "in the tiles, so that finding it is a single lookup instead of reading the end node from "
+      "a possibly different tile. Run it after the tiles are built and after valhalla_build_reach.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("j,concurrency", "Number of threads to use.", cxxopts::value<unsigned int>());
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging", true))
+      return EXIT_SUCCESS;
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  auto logging_subtree = config.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  // queue up all the tiles
+  const auto& mjolnir_config = config.get_child("mjolnir");
+  std::vector<GraphId> tiles;
+  {
+    GraphReader reader(mjolnir_config);
+    for (const auto& level : TileHierarchy::levels()) {
+      auto level_tiles = reader.GetTileSet(level.level);
+      tiles.insert(tiles.end(), level_tiles.begin(), level_tiles.end());
+    }
+    auto transit_tiles = reader.GetTileSet(TileHierarchy::GetTransitLevel().level);
+    tiles.insert(tiles.end(), transit_tiles.begin(), transit_tiles.end());
+  }
+  std::random_device rd;
+  std::shuffle(tiles.begin(), tiles.end(), std::mt19937(rd()));
+
+  std::vector<std::shared_ptr<std::thread>> threads(config.get<uint32_t>("mjolnir.concurrency"));
+
+  LOG_INFO("Storing opposing edges of " + std::to_string(tiles.size()) + " tiles.");
+  size_t floor = tiles.size() / threads.size();
+  size_t at_ceiling = tiles.size() - (threads.size() * floor);
+  std::vector<GraphId>::const_iterator tile_start, tile_end = tiles.begin();
+  std::list<std::promise<stats>> results;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    // Where the range begins
+    tile_start = tile_end;
+    // Where the range ends
+    tile_end += (i < at_ceiling ? floor + 1 : floor);
+    // Make the thread
+    results.emplace_back();
+    threads[i].reset(new std::thread(build_opposing, std::cref(mjolnir_config), tile_start,
+                                     tile_end, std::ref(results.back())));
+  }
+
+  // wait for it to finish
+  for (auto& thread : threads)
+    thread->join();
+
+  stats total{};
+  for (auto& result : results) {
+    try {
+      auto thread_stats = result.get_future().get();
+      total.tiles += thread_stats.tiles;
+      total.edges += thread_stats.edges;
+      total.missing += thread_stats.missing;
+    } catch (std::exception& e) {
+      LOG_ERROR(std::string("Failed to build opposing edges: ") + e.what());
+      return EXIT_FAILURE;
+    }
+  }
+
+  LOG_INFO("Stored opposing edges of " + std::to_string(total.edges) + " directed edges in " +
+           std::to_string(total.tiles) + " tiles, " + std::to_string(total.missing) +
+           " edges end in a missing tile.");
+  LOG_INFO("Finished");
+  return EXIT_SUCCESS;
+}
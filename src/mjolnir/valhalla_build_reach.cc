@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/reachindex.h"
+#include "baldr/tilehierarchy.h"
+#include "config.h"
+#include "filesystem.h"
+#include "loki/reach.h"
+#include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "sif/costfactory.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// The costing whose default options the reach of each column of the index is computed with
+const std::vector<Costing::Type> kReachCostings = {
+    Costing::auto_,      Costing::truck,         Costing::bicycle,
+    Costing::pedestrian, Costing::motor_scooter, Costing::motorcycle,
+};
+
+struct stats {
+  uint64_t tiles = 0;
+  uint64_t edges = 0;
+  uint64_t capped = 0;
+};
+
+/**
+ * Create the costings of the index columns with their default options.
+ */
+std::vector<sif::cost_ptr_t> default_costings() {
+  static_assert(kReachIndexAccess.size() == 6, "Every access mode in the index needs a costing");
+  sif::CostFactory factory;
+  std::vector<sif::cost_ptr_t> costings;
+  rapidjson::Document doc;
+  doc.SetObject();
+  for (size_t i = 0; i < kReachCostings.size(); ++i) {
+    Options options;
+    options.set_costing_type(kReachCostings[i]);
+    sif::ParseCosting(doc, "/costing_options", &(*options.mutable_costings())[kReachCostings[i]],
+                      kReachCostings[i]);
+    costings.push_back(factory.Create(options));
+    if (costings.back()->access_mode() != kReachIndexAccess[i]) {
+      throw std::logic_error("Reach index costing " + Costing_Enum_Name(kReachCostings[i]) +
+                             " does not match the access mode of its column");
+    }
+  }
+  return costings;
+}
+
+void build_reach(const boost::property_tree::ptree& config,
+                 const uint32_t max_reach,
+                 std::vector<GraphId>::const_iterator tile_start,
+                 std::vector<GraphId>::const_iterator tile_end,
+                 std::promise<stats>& result) {
+  try {
+    GraphReader reader(config);
+    const auto tile_dir = config.get<std::string>("tile_dir");
+    const auto costings = default_costings();
+    const std::vector<uint32_t> access(kReachIndexAccess.begin(), kReachIndexAccess.end());
+    loki::Reach reach_finder;
+
+    stats stat{};
+    std::vector<EdgeReach> reaches;
+    for (; tile_start != tile_end; ++tile_start) {
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+
+      graph_tile_ptr tile = reader.GetGraphTile(*tile_start);
+      if (!tile) {
+        continue;
+      }
+
+      // reach of every edge for every access mode, edges the mode cant use have no reach
+      const uint32_t edge_count = tile->header()->directededgecount();
+      reaches.assign(static_cast<size_t>(edge_count) * access.size(), EdgeReach{0, 0});
+      GraphId edge_id = *tile_start;
+      for (uint32_t i = 0; i < edge_count; ++i, ++edge_id) {
+        const auto* edge = tile->directededge(i);
+        if (edge->is_shortcut()) {
+          continue;
+        }
+        for (size_t column = 0; column < access.size(); ++column) {
+          if (!((edge->forwardaccess() | edge->reverseaccess()) & access[column])) {
+            continue;
+          }
+          auto reach = reach_finder(edge, edge_id, max_reach, reader, costings[column]);
+          reaches[i * access.size() + column] = {static_cast<uint16_t>(reach.outbound),
+                                                 static_cast<uint16_t>(reach.inbound)};
+          stat.capped += reach.outbound == max_reach && reach.inbound == max_reach;
+        }
+      }
+
+      // write the section, the tile is swapped in whole so other threads can keep reading it
+      mjolnir::GraphTileBuilder tile_builder(tile_dir, *tile_start, false);
+      tile_builder.UpdateReachIndex(max_reach, access, reaches);
+      ++stat.tiles;
+      stat.edges += edge_count;
+    }
+    result.set_value(stat);
+  } catch (...) { result.set_exception(std::current_exception()); }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  uint32_t max_reach = 0;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_build_reach precomputes the inbound and outbound reach of every directed edge for "
+      "the default auto, truck, bicycle, pedestrian, motor_scooter and motorcycle costings and "
+      "appends it to the tiles, so that loki only expands the graph for reachability checks "
+      "beyond the precomputed max reach. Run it after the tiles are built.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("j,concurrency", "Number of threads to use.", cxxopts::value<unsigned int>())
+      ("m,max-reach", "Reach is computed up to this many nodes, overrides mjolnir.reach_index.max_reach.", cxxopts::value<uint32_t>());
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging", true))
+      return EXIT_SUCCESS;
+
+    max_reach = result.count("max-reach")
+                    ? result["max-reach"].as<uint32_t>()
+                    : config.get<uint32_t>("mjolnir.reach_index.max_reach", 50);
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (max_reach == 0 || max_reach > kMaxIndexedReach) {
+    std::cerr << "The max reach must be between 1 and " << kMaxIndexedReach << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  auto logging_subtree = config.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  // queue up the road tiles, transit edges are never snapped to
+  const auto& mjolnir_config = config.get_child("mjolnir");
+  std::vector<GraphId> tiles;
+  {
+    GraphReader reader(mjolnir_config);
+    for (const auto& level : TileHierarchy::levels()) {
+      auto level_tiles = reader.GetTileSet(level.level);
+      tiles.insert(tiles.end(), level_tiles.begin(), level_tiles.end());
+    }
+  }
+  std::random_device rd;
+  std::shuffle(tiles.begin(), tiles.end(), std::mt19937(rd()));
+
+  std::vector<std::shared_ptr<std::thread>> threads(config.get<uint32_t>("mjolnir.concurrency"));
+
+  LOG_INFO("Computing reach up to " + std::to_string(max_reach) + " for " +
+           std::to_string(tiles.size()) + " tiles.");
+  size_t floor = tiles.size() / threads.size();
+  size_t at_ceiling = tiles.size() - (threads.size() * floor);
+  std::vector<GraphId>::const_iterator tile_start, tile_end = tiles.begin();
+  std::list<std::promise<stats>> results;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    // Where the range begins
+    tile_start = tile_end;
+    // Where the range ends
+    tile_end += (i < at_ceiling ? floor + 1 : floor);
+    // Make the thread
+    results.emplace_back();
+    threads[i].reset(new std::thread(build_reach, std::cref(mjolnir_config), max_reach, tile_start,
+                                     tile_end, std::ref(results.back())));
+  }
+
+  // wait for it to finish
+  for (auto& thread : threads)
+    thread->join();
+
+  stats total{};
+  for (auto& result : results) {
+    try {
+      auto thread_stats = result.get_future().get();
+      total.tiles += thread_stats.tiles;
+      total.edges += thread_stats.edges;
+      total.capped += thread_stats.capped;
+    } catch (std::exception& e) {
+      LOG_ERROR(std::string("Failed to build reach: ") + e.what());
+      return EXIT_FAILURE;
+    }
+  }
+
+  LOG_INFO("Added reach of " + std::to_string(total.edges) + " directed edges to " +
+           std::to_string(total.tiles) + " tiles, " + std::to_string(total.capped) +
+           " edge modes reach the max reach in both directions.");
+  LOG_INFO("Finished");
+  return EXIT_SUCCESS;
+}
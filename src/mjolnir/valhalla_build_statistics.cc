@@ -29,6 +29,7 @@
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "mjolnir/tilescheduler.h"
 
 #include "argparse_utils.h"
 
@@ -360,26 +361,17 @@ void AddStatistics(statistics& stats,
 }
 
 void build(const boost::property_tree::ptree& pt,
-           std::deque<GraphId>& tilequeue,
-           std::mutex& lock,
+           TileScheduler& scheduler,
+           const size_t worker,
            std::promise<statistics>& result) {
   // Our local class for gathering the stats
   statistics stats;
   // Local Graphreader
   GraphReader graph_reader(pt.get_child("mjolnir"));
 
-  // Check for more tiles
-  while (true) {
-    lock.lock();
-    if (tilequeue.empty()) {
-      lock.unlock();
-      break;
-    }
-    // Get the next tile Id
-    GraphId tile_id = tilequeue.front();
-    tilequeue.pop_front();
-    lock.unlock();
-
+  // Work through the tiles the scheduler hands out
+  GraphId tile_id;
+  while (scheduler.Next(worker, tile_id)) {
     // Point tiles to the set we need for current level
     auto level = tile_id.level();
     if (TileHierarchy::levels().back().level + 1 == level) {
@@ -486,11 +478,9 @@ void build(const boost::property_tree::ptree& pt,
     stats.add_tile_geom(tileid, tiles.TileBounds(tileid));
 
     // Check if we need to clear the tile cache
-    lock.lock();
     if (graph_reader.OverCommitted()) {
       graph_reader.Trim();
     }
-    lock.unlock();
   }
 
   // Fill promise with statistics
@@ -498,15 +488,17 @@ void build(const boost::property_tree::ptree& pt,
 }
 } // namespace
 
-void BuildStatistics(const boost::property_tree::ptree& pt) {
+void BuildStatistics(const boost::property_tree::ptree& pt,
+                     const std::string& format,
+                     const std::string& output) {
 
   // Graph tile properties
   auto tile_properties = pt.get_child("mjolnir");
 
   GraphReader reader(tile_properties);
 
-  // Create a randomized queue of tiles to work from
-  std::deque<GraphId> tilequeue;
+  // All the tiles to work on
+  std::vector<GraphId> tilequeue;
   for (const auto& tier : TileHierarchy::levels()) {
     auto level = tier.level;
     const auto& tiles = tier.tiles;
@@ -530,11 +522,6 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
       }
     }
   }
-  std::random_device rd;
-  std::shuffle(tilequeue.begin(), tilequeue.end(), std::mt19937(rd()));
-
-  // A mutex we can use to do the synchronization
-  std::mutex lock;
 
   LOG_INFO("Gathering information about the tiles in " + pt.get<std::string>("mjolnir.tile_dir"));
 
@@ -543,20 +530,25 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
       std::max(static_cast<unsigned int>(1),
                pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency())));
 
+  // the tiles are handed out the biggest first so no thread is left with a big one at the end
+  TileScheduler scheduler("Gathering statistics", tilequeue, threads.size(),
+                          TileScheduler::FileSize(reader.tile_dir()));
+
   // Setup promises
   std::list<std::promise<statistics>> results;
 
   // Spawn the threads
-  for (auto& thread : threads) {
+  for (size_t i = 0; i < threads.size(); ++i) {
     results.emplace_back();
-    thread.reset(new std::thread(build, std::cref(pt), std::ref(tilequeue), std::ref(lock),
-                                 std::ref(results.back())));
+    threads[i].reset(new std::thread(build, std::cref(pt), std::ref(scheduler), i,
+                                     std::ref(results.back())));
   }
 
   // Wait for threads to finish
   for (auto& thread : threads) {
     thread->join();
   }
+  scheduler.LogUtilization();
   // Get the promise from the future
   statistics stats;
   for (auto& result : results) {
@@ -566,7 +558,11 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
   }
   LOG_INFO("Finished");
 
-  stats.build_db();
+  if (format == "csv") {
+    stats.build_csv(output);
+  } else {
+    stats.build_db();
+  }
   stats.roulette_data.GenerateTasks(pt);
 }
 
@@ -574,25 +570,34 @@ int main(int argc, char** argv) {
   const auto program = filesystem::path(__FILE__).stem().string();
   // args
   boost::property_tree::ptree pt;
+  std::string format, output;
 
   try {
     // clang-format off
     cxxopts::Options options(
       program,
       program + " " + VALHALLA_VERSION + "\n\n"
-      "valhalla_build_statistics is a program that builds a statistics database.\n\n");
+      "valhalla_build_statistics is a program that builds a statistics database, or csv files of "
+      "the same tables without spatialite.\n\n");
 
     options.add_options()
       ("h,help", "Print this help message")
       ("v,version", "Print the version of this software.")
       ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
       ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
-      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
+      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>())
+      ("f,format", "Output format, sqlite for statistics.sqlite or csv for a csv file per table.", cxxopts::value<std::string>(format)->default_value("sqlite"))
+      ("o,output", "Directory of the csv files.", cxxopts::value<std::string>(output)->default_value("statistics"));
     // clang-format on
 
     auto result = options.parse(argc, argv);
     if (!parse_common_args(program, options, result, pt, "mjolnir.logging", true))
       return EXIT_SUCCESS;
+
+    if (format != "sqlite" && format != "csv") {
+      throw cxxopts::OptionException("Unknown format " + format + "\n\n" + options.help() +
+                                     "\n\n");
+    }
   } catch (cxxopts::OptionException& e) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -602,7 +607,7 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-  BuildStatistics(pt);
+  BuildStatistics(pt, format, output);
 
   return EXIT_SUCCESS;
 }
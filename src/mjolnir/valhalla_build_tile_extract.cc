@@ -0,0 +1,78 @@
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/tileextract.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string extract;
+  bool overwrite = false;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_build_tile_extract writes the tiles in mjolnir.tile_dir to the tar at "
+      "mjolnir.tile_extract. The tar starts with the index of the tiles so they are found without "
+      "scanning it, and the tiles are ordered by level and then along a Hilbert curve so tiles "
+      "that are close on the map are close in the file. The tiles are copied into the tar on "
+      "mjolnir.concurrency threads.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("e,extract", "Write the tar to this path instead of mjolnir.tile_extract.", cxxopts::value<std::string>(extract))
+      ("O,overwrite", "Overwrite the tar if it exists.", cxxopts::value<bool>(overwrite)->default_value("false"))
+      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging", true))
+      return EXIT_SUCCESS;
+
+    if (extract.empty()) {
+      extract = config.get<std::string>("mjolnir.tile_extract", "");
+    }
+    if (extract.empty()) {
+      throw cxxopts::OptionException("No tar path in mjolnir.tile_extract or --extract\n\n" +
+                                     options.help() + "\n\n");
+    }
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (filesystem::exists(extract) && !overwrite) {
+    std::cerr << extract << " exists, use --overwrite to replace it" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    auto threads = config.get<uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency());
+    mjolnir::TileExtract::Build(config.get<std::string>("mjolnir.tile_dir"), extract, threads);
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -52,7 +52,10 @@ int main(int argc, char** argv) {
       ("s,start", "Starting stage of the build pipeline", cxxopts::value<std::string>()->default_value("initialize"))
       ("e,end", "End stage of the build pipeline", cxxopts::value<std::string>()->default_value("cleanup"))
       ("input_files", "positional arguments", cxxopts::value<std::vector<std::string>>(input_files))
-      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
+      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>())
+      ("shard", "Build shard INDEX/COUNT, e.g. 0/4, of a tile build shared by several processes. "
+        "Run each stage in every shard before starting the next, the build, enhance, elevation and "
+        "validate stages one at a time. The other stages only run in shard 0.", cxxopts::value<std::string>());
     // clang-format on
 
     options.parse_positional({"input_files"});
@@ -85,6 +88,22 @@ int main(int argc, char** argv) {
           "Starting build stage is after ending build stage in pipeline, see above");
     }
 
+    // Which shard of the tile build this is
+    if (result.count("shard")) {
+      const auto shard = result["shard"].as<std::string>();
+      const auto slash = shard.find('/');
+      try {
+        if (slash == std::string::npos) {
+          throw std::invalid_argument(shard);
+        }
+        pt.put("mjolnir.shard.index", std::stoul(shard.substr(0, slash)));
+        pt.put("mjolnir.shard.count", std::stoul(shard.substr(slash + 1)));
+        TileShard::FromConfig(pt);
+      } catch (const std::exception&) {
+        throw cxxopts::OptionException("Invalid shard " + shard + ", expected INDEX/COUNT");
+      }
+    }
+
     if (!result.count("input_files") && start_stage <= BuildStage::kParseNodes &&
         end_stage >= BuildStage::kParseWays) {
       throw cxxopts::OptionException("Input file is required\n\n" + options.help() + "\n\n");
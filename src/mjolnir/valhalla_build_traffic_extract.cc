@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "baldr/traffictile.h"
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/tileextract.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * Parses a live speed of the stream, a line of edge,speed,congestion,closed. The edge is a
+ * level/tileid/id triplet or the numeric value of its GraphId, the speed is in KPH and empty
+ * when it is not known, the congestion goes from 0 (unknown) over 1 (none) to 63 (the most) and
+ * closed is 0 or 1. An edge with neither a speed nor a closure has its live speed cleared.
+ */
+bool parse_update(const std::string& line, GraphId& edge, TrafficSpeed& speed) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  for (size_t comma = line.find(','); fields.size() < 3 && comma != std::string::npos;
+       start = comma + 1, comma = line.find(',', start)) {
+    fields.push_back(line.substr(start, comma - start));
+  }
+  fields.push_back(line.substr(start));
+  if (fields.size() != 4 || fields[0].empty()) {
+    return false;
+  }
+
+  try {
+    edge = fields[0].find('/') == std::string::npos ? GraphId(std::stoull(fields[0]))
+                                                    : GraphId(fields[0]);
+    const bool closed = !fields[3].empty() && std::stoi(fields[3]) != 0;
+    const uint32_t congestion =
+        fields[2].empty() ? UNKNOWN_CONGESTION_VAL
+                          : std::min<uint32_t>(std::stoul(fields[2]), MAX_CONGESTION_VAL);
+    if (closed) {
+      speed = TrafficSpeed{0, 0, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0,
+                           MAX_CONGESTION_VAL, 0, 0, false};
+    } else if (fields[1].empty()) {
+      speed = TrafficSpeed{};
+    } else {
+      // the encoding is in 2kph steps and 0 would close the edge
+      const double kph = std::min(std::stod(fields[1]), static_cast<double>(kMaxTrafficSpeed));
+      const uint32_t encoded = std::max<uint32_t>(std::lround(kph / 2), 1);
+      speed = TrafficSpeed{encoded, encoded, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW,
+                           255, 0, congestion, 0, 0, false};
+    }
+  } catch (...) {
+    return false;
+  }
+  return edge.Is_Valid();
+}
+
+// Live speeds read from the stream and not yet written, with when each of them was read
+struct batch_t {
+  std::unordered_map<GraphId, std::vector<TrafficSpeedUpdate>> tiles;
+  std::vector<clock_type::time_point> read;
+};
+
+// What was written since the last report
+struct report_t {
+  uint64_t updates = 0;
+  uint64_t unknown = 0;
+  uint64_t invalid = 0;
+  uint64_t batches = 0;
+  uint64_t timed = 0;
+  double latency_sum = 0;
+  double latency_max = 0;
+  clock_type::time_point start = clock_type::now();
+};
+
+/**
+ * Writes a batch into the mapped traffic extract, each tile in one go so readers see all of its
+ * speeds or none of them, and accounts for how long the speeds waited since they were read.
+ */
+void flush(GraphReader& reader, batch_t& batch, report_t& report) {
+  if (batch.read.empty()) {
+    return;
+  }
+  const uint64_t now = std::time(nullptr);
+  for (const auto& tile : batch.tiles) {
+    try {
+      if (reader.UpdateLiveTraffic(tile.first, tile.second, now)) {
+        report.updates += tile.second.size();
+      } else {
+        report.unknown += tile.second.size();
+      }
+    } catch (const std::exception& e) {
+      LOG_WARN("Live traffic of tile " + std::to_string(tile.first) + " not written: " + e.what());
+      report.invalid += tile.second.size();
+    }
+  }
+
+  const auto written = clock_type::now();
+  for (const auto& read : batch.read) {
+    const double latency = std::chrono::duration<double, std::milli>(written - read).count();
+    report.latency_sum += latency;
+    report.latency_max = std::max(report.latency_max, latency);
+  }
+  report.timed += batch.read.size();
+  ++report.batches;
+  batch.tiles.clear();
+  batch.read.clear();
+}
+
+// Logs the throughput and the latency of the updates since the last report and starts a new one
+void log_report(report_t& report) {
+  const auto now = clock_type::now();
+  const double seconds = std::chrono::duration<double>(now - report.start).count();
+  const double latency_mean = report.timed ? report.latency_sum / report.timed : 0.0;
+  LOG_INFO("Wrote " + std::to_string(report.updates) + " live speeds in " +
+           std::to_string(report.batches) + " batches at " +
+           std::to_string(static_cast<uint64_t>(report.updates / std::max(seconds, 1e-3))) +
+           "/s, latency mean " + std::to_string(latency_mean) + "ms max " +
+           std::to_string(report.latency_max) + "ms, " + std::to_string(report.unknown) +
+           " for unknown tiles, " + std::to_string(report.invalid) + " invalid");
+  report = report_t{};
+  report.start = now;
+}
+
+/**
+ * Reads live speeds from the stream until it ends and writes them into the traffic extract. The
+ * speeds are written in batches of up to batch_size, and whenever the stream has nothing more
+ * buffered so a slow stream is not held back waiting for a batch to fill.
+ */
+void stream_updates(GraphReader& reader,
+                    std::istream& stream,
+                    const size_t batch_size,
+                    const std::chrono::seconds report_interval) {
+  batch_t batch;
+  report_t report;
+  auto next_report = clock_type::now() + report_interval;
+  std::string line;
+  while (std::getline(stream, line)) {
+    GraphId edge;
+    TrafficSpeed speed;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty()) {
+      continue;
+    }
+    if (!parse_update(line, edge, speed)) {
+      ++report.invalid;
+      continue;
+    }
+    batch.tiles[edge.Tile_Base()].push_back({edge.id(), speed});
+    batch.read.push_back(clock_type::now());
+
+    if (batch.read.size() >= batch_size || stream.rdbuf()->in_avail() <= 0) {
+      flush(reader, batch, report);
+    }
+    if (clock_type::now() >= next_report) {
+      log_report(report);
+      next_report = clock_type::now() + report_interval;
+    }
+  }
+  flush(reader, batch, report);
+  log_report(report);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string extract, stream;
+  bool overwrite = false;
+  size_t batch_size = 10000;
+  uint32_t report_interval = 10;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_build_traffic_extract writes the tar at mjolnir.traffic_extract with a traffic "
+      "tile for every tile of mjolnir.tile_extract or mjolnir.tile_dir, in the same order as the "
+      "tile extract. With --stream it then keeps reading live speeds, one edge,speed,congestion,"
+      "closed line per edge, and writes them into the mapped traffic extract with atomic stores "
+      "so services using it see them right away. It logs the throughput and the latency of the "
+      "live speeds as it goes.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("e,extract", "Write the tar to this path instead of mjolnir.traffic_extract.", cxxopts::value<std::string>(extract))
+      ("O,overwrite", "Overwrite the tar if it exists.", cxxopts::value<bool>(overwrite)->default_value("false"))
+      ("s,stream", "Read live speeds from this file or fifo, - for stdin, until it ends.", cxxopts::value<std::string>(stream))
+      ("b,batch-size", "Write at most this many live speeds at a time.", cxxopts::value<size_t>(batch_size)->default_value("10000"))
+      ("r,report-interval", "Seconds between reports of the live speeds written.", cxxopts::value<uint32_t>(report_interval)->default_value("10"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (extract.empty()) {
+      extract = config.get<std::string>("mjolnir.traffic_extract", "");
+    }
+    if (extract.empty()) {
+      throw cxxopts::OptionException("No tar path in mjolnir.traffic_extract or --extract\n\n" +
+                                     options.help() + "\n\n");
+    }
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // a stream goes into the extract there is unless it should be replaced
+  if (filesystem::exists(extract) && !overwrite && stream.empty()) {
+    std::cerr << extract << " exists, use --overwrite to replace it" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if (!filesystem::exists(extract) || overwrite) {
+      mjolnir::TileExtract::BuildTraffic(config.get_child("mjolnir"), extract);
+    }
+    if (stream.empty()) {
+      return EXIT_SUCCESS;
+    }
+
+    auto traffic_config = config.get_child("mjolnir");
+    traffic_config.put("traffic_extract", extract);
+    GraphReader reader(traffic_config, nullptr, false);
+    if (!reader.HasLiveTraffic()) {
+      throw std::runtime_error("No traffic tiles in " + extract);
+    }
+    std::ifstream file;
+    if (stream != "-") {
+      file.open(stream);
+      if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + stream);
+      }
+    }
+    LOG_INFO("Writing live speeds from " + stream + " to " + extract);
+    stream_updates(reader, stream == "-" ? std::cin : file, std::max<size_t>(batch_size, 1),
+                   std::chrono::seconds(std::max<uint32_t>(report_interval, 1)));
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
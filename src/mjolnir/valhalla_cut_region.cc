@@ -0,0 +1,94 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "mjolnir/regioncut.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla;
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree config;
+  std::string polygon_file, out_dir;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "valhalla_cut_region cuts the tiles of a region out of the tiles in mjolnir.tile_dir or "
+      "mjolnir.tile_extract into a tile directory of their own, which takes minutes where a "
+      "build from an extract of the osm data takes hours. Tiles the region covers are copied, "
+      "the ones on its border are written again without the nodes outside of it and the edges "
+      "that touch them. Transit is not cut, run valhalla_build_reach and valhalla_build_opposing "
+      "on the cut tiles if the tileset had them.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("p,polygon", "File with the region as a WKT POLYGON or MULTIPOLYGON in longitude and latitude.", cxxopts::value<std::string>(polygon_file))
+      ("o,out-dir", "Directory to write the tiles of the region to.", cxxopts::value<std::string>(out_dir))
+      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, config, "mjolnir.logging", true))
+      return EXIT_SUCCESS;
+
+    if (polygon_file.empty() || out_dir.empty()) {
+      throw cxxopts::OptionException("Both --polygon and --out-dir are required\n\n" +
+                                     options.help() + "\n\n");
+    }
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::ifstream file(polygon_file);
+    if (!file) {
+      throw std::runtime_error("Couldn't read " + polygon_file);
+    }
+    std::stringstream wkt;
+    wkt << file.rdbuf();
+    auto text = boost::algorithm::trim_copy(wkt.str());
+    mjolnir::multi_polygon_type region;
+    if (boost::algorithm::istarts_with(text, "MULTIPOLYGON")) {
+      boost::geometry::read_wkt(text, region);
+    } else {
+      mjolnir::polygon_type polygon;
+      boost::geometry::read_wkt(text, polygon);
+      region.push_back(polygon);
+    }
+
+    auto threads = config.get<uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency());
+    auto stats = mjolnir::RegionCut::Cut(config.get_child("mjolnir"), region, out_dir, threads);
+    LOG_INFO("Copied " + std::to_string(stats.copied_tiles) + " tiles and wrote " +
+             std::to_string(stats.rebuilt_tiles) + " again with " + std::to_string(stats.nodes) +
+             " nodes and " + std::to_string(stats.edges) + " directed edges in all, " +
+             std::to_string(stats.cut_nodes) + " nodes and " + std::to_string(stats.cut_edges) +
+             " directed edges were cut");
+  } catch (const std::exception& e) {
+    LOG_ERROR(e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
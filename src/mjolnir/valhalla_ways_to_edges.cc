@@ -1,8 +1,14 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <fstream>
+#include <future>
+#include <list>
 #include <ostream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -33,29 +39,86 @@ struct EdgeAndDirection {
   }
 };
 
+// A record of the binary output, way_edges.bin holds one of these for every edge sorted by way id
+// and edge id so it can be memory mapped and binary searched
+struct WayEdge {
+  uint64_t wayid;
+  uint64_t edgeid : 46;
+  uint64_t forward : 1;
+  uint64_t spare : 17;
+};
+static_assert(sizeof(WayEdge) == 16, "way_edges.bin records must be 16 bytes");
+
+using WaysEdges = std::unordered_map<uint64_t, std::vector<EdgeAndDirection>>;
+
+// Collect the auto-driveable edges of the tiles the threads haven't taken yet
+void collect(const boost::property_tree::ptree& config,
+             const std::vector<GraphId>& tiles,
+             std::atomic<size_t>& next,
+             std::promise<WaysEdges>& result) {
+  WaysEdges ways_edges;
+  GraphReader reader(config);
+  for (size_t t = next++; t < tiles.size(); t = next++) {
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+
+    GraphId edge_id = tiles[t];
+    graph_tile_ptr tile = reader.GetGraphTile(edge_id);
+    if (!tile) {
+      continue;
+    }
+    for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, ++edge_id) {
+      const DirectedEdge* edge = tile->directededge(edge_id);
+      if (edge->IsTransitLine() || edge->use() == Use::kTransitConnection ||
+          edge->use() == Use::kEgressConnection || edge->use() == Use::kPlatformConnection ||
+          edge->is_shortcut()) {
+        continue;
+      }
+
+      // Skip if the edge does not allow auto use
+      if (!(edge->forwardaccess() & kAutoAccess)) {
+        continue;
+      }
+
+      // Get the way Id
+      uint64_t wayid = tile->edgeinfo(edge).wayid();
+      ways_edges[wayid].push_back({edge->forward(), edge_id});
+    }
+  }
+  result.set_value(std::move(ways_edges));
+}
+
 // Main application to create a list wayids and directed edges belonging
 // to ways that are driveable.
 int main(int argc, char** argv) {
   const auto program = filesystem::path(__FILE__).stem().string();
   // args
   boost::property_tree::ptree pt;
+  bool binary = false;
 
   try {
     // clang-format off
     cxxopts::Options options(
       program,
       program + " " + VALHALLA_VERSION + "\n\n"
-      "a program that creates a list of edges for each auto-driveable OSM way.\n\n");
+      "a program that creates a list of edges for each auto-driveable OSM way.\n\n"
+      "Writes way_edges.txt to the tile_dir with a line of wayid,forward,edgeid,forward,edgeid,... "
+      "for every way, or with --binary way_edges.bin with a 16 byte record for every edge: the "
+      "way id as a uint64 followed by a uint64 whose low 46 bits are the edge id and whose next "
+      "bit is the forward flag, sorted by way id and edge id.\n\n");
 
     options.add_options()
       ("h,help", "Print this help message.")
       ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
       ("v,version", "Print the version of this software.")
-      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>());
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("b,binary", "Write the sorted binary way_edges.bin instead of way_edges.txt.", cxxopts::value<bool>(binary)->default_value("false"))
+      ("j,concurrency", "Number of threads to use. Defaults to all threads.", cxxopts::value<uint32_t>());
     // clang-format on
 
     auto result = options.parse(argc, argv);
-    if (!parse_common_args(program, options, result, pt, "mjolnir.logging"))
+    if (!parse_common_args(program, options, result, pt, "mjolnir.logging", true))
       return EXIT_SUCCESS;
 
   } catch (cxxopts::OptionException& e) {
@@ -67,52 +130,74 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-  // Create an unordered map of OSM ways Ids and their associated graph edges
-  std::unordered_map<uint64_t, std::vector<EdgeAndDirection>> ways_edges;
-
-  GraphReader reader(pt.get_child("mjolnir"));
-  // Iterate through all tiles
-  for (auto edge_id : reader.GetTileSet()) {
-    // If tile exists add it to the queue
-    if (!reader.DoesTileExist(edge_id)) {
-      continue;
-    }
-    if (reader.OverCommitted()) {
-      reader.Trim();
-    }
-
-    graph_tile_ptr tile = reader.GetGraphTile(edge_id);
-    for (uint32_t n = 0; n < tile->header()->directededgecount(); n++, ++edge_id) {
-      const DirectedEdge* edge = tile->directededge(edge_id);
-      if (edge->IsTransitLine() || edge->use() == Use::kTransitConnection ||
-          edge->use() == Use::kEgressConnection || edge->use() == Use::kPlatformConnection ||
-          edge->is_shortcut()) {
-        continue;
-      }
-
-      // Skip if the edge does not allow auto use
-      if (!(edge->forwardaccess() & kAutoAccess)) {
-        continue;
+  // Scan the tiles in parallel, every thread with a map of OSM ways Ids and their associated graph
+  // edges of its own
+  std::vector<GraphId> tiles;
+  {
+    GraphReader reader(pt.get_child("mjolnir"));
+    for (const auto& tile_id : reader.GetTileSet()) {
+      if (reader.DoesTileExist(tile_id)) {
+        tiles.push_back(tile_id);
       }
+    }
+  }
+  std::atomic<size_t> next(0);
+  std::vector<std::shared_ptr<std::thread>> threads(pt.get<unsigned int>("mjolnir.concurrency"));
+  std::list<std::promise<WaysEdges>> results;
+  for (auto& thread : threads) {
+    results.emplace_back();
+    thread.reset(new std::thread(collect, std::cref(pt.get_child("mjolnir")), std::cref(tiles),
+                                 std::ref(next), std::ref(results.back())));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
 
-      // Get the way Id
-      uint64_t wayid = tile->edgeinfo(edge).wayid();
-      ways_edges[wayid].push_back({edge->forward(), edge_id});
+  // Merge them and put the edges of every way in order so the output doesnt depend on the threads
+  WaysEdges ways_edges;
+  for (auto& result : results) {
+    for (auto& way : result.get_future().get()) {
+      auto& edges = ways_edges[way.first];
+      edges.insert(edges.end(), way.second.begin(), way.second.end());
     }
   }
+  std::vector<uint64_t> wayids;
+  wayids.reserve(ways_edges.size());
+  for (auto& way : ways_edges) {
+    std::sort(way.second.begin(), way.second.end(),
+              [](const EdgeAndDirection& a, const EdgeAndDirection& b) {
+                return a.edgeid < b.edgeid;
+              });
+    wayids.push_back(way.first);
+  }
+  std::sort(wayids.begin(), wayids.end());
 
-  std::ofstream ways_file;
   std::string fname = pt.get<std::string>("mjolnir.tile_dir") +
-                      filesystem::path::preferred_separator + "way_edges.txt";
-  ways_file.open(fname, std::ofstream::out | std::ofstream::trunc);
-  for (const auto& way : ways_edges) {
-    ways_file << way.first;
-    for (auto edge : way.second) {
+                      filesystem::path::preferred_separator +
+                      (binary ? "way_edges.bin" : "way_edges.txt");
+  std::ofstream ways_file(fname, binary ? std::ofstream::out | std::ofstream::trunc |
+                                              std::ofstream::binary
+                                        : std::ofstream::out | std::ofstream::trunc);
+  for (const auto wayid : wayids) {
+    const auto& edges = ways_edges.find(wayid)->second;
+    if (binary) {
+      for (const auto& edge : edges) {
+        WayEdge record{wayid, edge.edgeid.value, edge.forward, 0};
+        ways_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+      }
+      continue;
+    }
+    ways_file << wayid;
+    for (const auto& edge : edges) {
       ways_file << "," << (uint32_t)edge.forward << "," << (uint64_t)edge.edgeid;
     }
-    ways_file << std::endl;
+    ways_file << "\n";
   }
   ways_file.close();
+  if (!ways_file) {
+    LOG_ERROR("Failed to write " + fname);
+    return EXIT_FAILURE;
+  }
 
   LOG_INFO("Finished with " + std::to_string(ways_edges.size()) + " ways.");
 
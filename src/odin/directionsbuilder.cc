@@ -47,11 +47,15 @@ void DirectionsBuilder::Build(Api& api, const MarkupFormatter& markup_formatter)
         // Update the heading of ~0 length edges
         UpdateHeading(&etp);
 
-        ManeuversBuilder maneuversBuilder(options, &etp);
-        maneuvers = maneuversBuilder.Build();
+        {
+          auto _ = measure_phase_time(api, "odin", "maneuvers");
+          ManeuversBuilder maneuversBuilder(options, &etp);
+          maneuvers = maneuversBuilder.Build();
+        }
 
         // Create the instructions if desired
         if (options.directions_type() == DirectionsType::instructions) {
+          auto _ = measure_phase_time(api, "odin", "narrative");
           std::unique_ptr<NarrativeBuilder> narrative_builder =
               NarrativeBuilderFactory::Create(options, &etp, markup_formatter);
           narrative_builder->Build(maneuvers);
@@ -430,6 +434,7 @@ void DirectionsBuilder::PopulateDirectionsLeg(const Options& options,
 
   // Populate shape
   trip_directions.set_shape(etp->shape());
+  *trip_directions.mutable_zoom_shapes() = etp->zoom_shapes();
 
   // Populate has_time_restrictions
   bool has_time_restrictions = false;
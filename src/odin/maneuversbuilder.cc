@@ -1723,7 +1723,7 @@ void ManeuversBuilder::SetManeuverType(Maneuver& maneuver, bool none_type_allowe
     }
   }
   // Process merge
-  else if (IsMergeManeuverType(maneuver, prev_edge.get(), curr_edge.get())) {
+  else if (IsMergeManeuverType(maneuver, prev_edge, curr_edge)) {
     switch (maneuver.merge_to_relative_direction()) {
       case Maneuver::RelativeDirection::kKeepRight: {
         maneuver.set_type(DirectionsLeg_Maneuver_Type_kMergeRight);
@@ -1779,7 +1779,7 @@ void ManeuversBuilder::SetManeuverType(Maneuver& maneuver, bool none_type_allowe
   // Process simple direction
   else {
     LOG_TRACE("ManeuverType=SIMPLE");
-    SetSimpleDirectionalManeuverType(maneuver, prev_edge.get(), curr_edge.get());
+    SetSimpleDirectionalManeuverType(maneuver, prev_edge, curr_edge);
   }
 }
 
@@ -2204,8 +2204,8 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Process fork
-  if (IsFork(node_index, prev_edge.get(), curr_edge.get()) ||
-      IsPedestrianFork(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsFork(node_index, prev_edge, curr_edge) ||
+      IsPedestrianFork(node_index, prev_edge, curr_edge)) {
     maneuver.set_fork(true);
     return false;
   }
@@ -2294,12 +2294,12 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Process pencil point u-turns
-  if (IsLeftPencilPointUturn(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsLeftPencilPointUturn(node_index, prev_edge, curr_edge)) {
     maneuver.set_type(DirectionsLeg_Maneuver_Type_kUturnLeft);
     LOG_TRACE("ManeuverType=PENCIL_POINT_UTURN_LEFT");
     return false;
   }
-  if (IsRightPencilPointUturn(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsRightPencilPointUturn(node_index, prev_edge, curr_edge)) {
     maneuver.set_type(DirectionsLeg_Maneuver_Type_kUturnRight);
     LOG_TRACE("ManeuverType=PENCIL_POINT_UTURN_RIGHT");
     return false;
@@ -2307,7 +2307,7 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Intersecting forward edge
-  if (IsIntersectingForwardEdge(node_index, prev_edge.get(), curr_edge.get())) {
+  if (IsIntersectingForwardEdge(node_index, prev_edge, curr_edge)) {
     maneuver.set_intersecting_forward_edge(true);
     LOG_TRACE("IntersectingForwardEdge");
     return false;
@@ -2322,7 +2322,7 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
 
   /////////////////////////////////////////////////////////////////////////////
   // Process 'T' intersection
-  if (IsTee(node_index, prev_edge.get(), curr_edge.get(), !common_base_names->empty())) {
+  if (IsTee(node_index, prev_edge, curr_edge, !common_base_names->empty())) {
     maneuver.set_tee(true);
     LOG_TRACE("T intersection");
     return false;
@@ -2350,7 +2350,7 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver, int node_i
   /////////////////////////////////////////////////////////////////////////////
   // Process unnamed edge
   if (!maneuver.HasStreetNames() && prev_edge->IsUnnamed() &&
-      IncludeUnnamedPrevEdge(node_index, prev_edge.get(), curr_edge.get())) {
+      IncludeUnnamedPrevEdge(node_index, prev_edge, curr_edge)) {
     return true;
   }
 
@@ -2408,8 +2408,7 @@ bool ManeuversBuilder::IsMergeManeuverType(Maneuver& maneuver,
          (curr_edge->road_class() == RoadClass::kPrimary)) &&
         curr_edge->IsOneway() && curr_edge->IsForward(maneuver.turn_degree()) &&
         node->HasIntersectingEdgeCurrNameConsistency()))) {
-    maneuver.set_merge_to_relative_direction(
-        DetermineMergeToRelativeDirection(node.get(), prev_edge));
+    maneuver.set_merge_to_relative_direction(DetermineMergeToRelativeDirection(node, prev_edge));
     return true;
   }
 
@@ -3342,9 +3341,8 @@ void ManeuversBuilder::EnhanceSignlessInterchnages(std::list<Maneuver>& maneuver
   }
 }
 
-uint16_t
-ManeuversBuilder::GetExpectedTurnLaneDirection(std::unique_ptr<EnhancedTripLeg_Edge>& turn_lane_edge,
-                                               const Maneuver& maneuver) const {
+uint16_t ManeuversBuilder::GetExpectedTurnLaneDirection(EnhancedTripLeg_Edge* turn_lane_edge,
+                                                        const Maneuver& maneuver) const {
   if (turn_lane_edge) {
     switch (maneuver.type()) {
       case valhalla::DirectionsLeg_Maneuver_Type_kUturnLeft:
@@ -3765,7 +3763,7 @@ void ManeuversBuilder::UpdateManeuverPlacementForInternalIntersectionTurns(
               is_relative_straight(GetTurnDegree(prev_edge->end_heading(), edge->begin_heading()))) {
             // Add straight internal edge to previous maneuver
             MoveInternalEdgeToPreviousManeuver(*prev_maneuver, maneuver, new_node_index,
-                                               prev_edge.get(), edge.get());
+                                               prev_edge, edge);
           } else {
             // Exit form the edge loop
             break;
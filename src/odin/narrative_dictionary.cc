@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 #include <boost/property_tree/ptree.hpp>
@@ -35,6 +37,48 @@ std::unordered_map<K, V> as_unordered_map(boost::property_tree::ptree const& pt,
 namespace valhalla {
 namespace odin {
 
+PhraseTemplate::PhraseTemplate(const std::string& phrase) {
+  std::string text;
+  for (size_t i = 0; i < phrase.size(); ++i) {
+    const char* tag = nullptr;
+    if (phrase[i] == '<') {
+      for (const auto* phrase_tag : kPhraseTags) {
+        if (phrase.compare(i, std::strlen(phrase_tag), phrase_tag) == 0) {
+          tag = phrase_tag;
+          break;
+        }
+      }
+    }
+    if (tag == nullptr) {
+      text.push_back(phrase[i]);
+      continue;
+    }
+    parts_.emplace_back(std::move(text), tag);
+    text.clear();
+    i += std::strlen(tag) - 1;
+  }
+  parts_.emplace_back(std::move(text), nullptr);
+}
+
+void PhraseTemplate::Fill(std::string& instruction, TagValues values) const {
+  instruction.clear();
+  for (const auto& part : parts_) {
+    instruction.append(part.first);
+    if (part.second == nullptr) {
+      continue;
+    }
+    // the tags are compared by their text since each translation unit has its own copy of them
+    auto value = std::find_if(values.begin(), values.end(), [&part](const auto& value) {
+      return std::strcmp(value.tag, part.second) == 0;
+    });
+    if (value == values.end()) {
+      instruction.append(part.second);
+    } else {
+      instruction.append(value->value);
+    }
+  }
+}
+
 NarrativeDictionary::NarrativeDictionary(const std::string& language_tag,
                                          const boost::property_tree::ptree& narrative_pt) {
   this->language_tag = language_tag;
@@ -341,6 +385,16 @@ void NarrativeDictionary::Load(PhraseSet& phrase_handle,
                                const boost::property_tree::ptree& phrase_pt) {
 
   phrase_handle.phrases = as_unordered_map<std::string, std::string>(phrase_pt, kPhrasesKey);
+
+  // Parse the phrases into templates once so forming an instruction does not search them
+  phrase_handle.templates.clear();
+  for (const auto& phrase : phrase_handle.phrases) {
+    const auto phrase_id = std::stoul(phrase.first);
+    if (phrase_id >= phrase_handle.templates.size()) {
+      phrase_handle.templates.resize(phrase_id + 1);
+    }
+    phrase_handle.templates[phrase_id] = PhraseTemplate(phrase.second);
+  }
 }
 
 void NarrativeDictionary::Load(StartSubset& start_handle,
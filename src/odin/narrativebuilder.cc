@@ -524,14 +524,13 @@ std::string NarrativeBuilder::FormVerbalAlertApproachInstruction(float distance,
   instruction.reserve(kInstructionInitialCapacity);
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.approach_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(distance, dictionary_.approach_verbal_alert_subset.metric_lengths,
-                                dictionary_.approach_verbal_alert_subset.us_customary_lengths));
-  boost::replace_all(instruction, kCurrentVerbalCueTag, verbal_cue);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.approach_verbal_alert_subset.templates.at(phrase_id).Fill(instruction, {
+      {kLengthTag, FormLength(distance,
+                              dictionary_.approach_verbal_alert_subset.metric_lengths,
+                              dictionary_.approach_verbal_alert_subset.us_customary_lengths)},
+      {kCurrentVerbalCueTag, verbal_cue},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -589,13 +588,12 @@ std::string NarrativeBuilder::FormStartInstruction(Maneuver& maneuver) {
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.start_subset.templates.at(phrase_id).Fill(instruction, {
+      {kCardinalDirectionTag, cardinal_direction},
+      {kStreetNamesTag, street_names},
+      {kBeginStreetNamesTag, begin_street_names},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -676,16 +674,15 @@ std::string NarrativeBuilder::FormVerbalStartInstruction(Maneuver& maneuver,
     phrase_id += 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.start_verbal_subset.metric_lengths,
-                                dictionary_.start_verbal_subset.us_customary_lengths));
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.start_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kCardinalDirectionTag, cardinal_direction},
+      {kStreetNamesTag, street_names},
+      {kBeginStreetNamesTag, begin_street_names},
+      {kLengthTag, FormLength(maneuver,
+                              dictionary_.start_verbal_subset.metric_lengths,
+                              dictionary_.start_verbal_subset.us_customary_lengths)},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -729,14 +726,11 @@ std::string NarrativeBuilder::FormDestinationInstruction(Maneuver& maneuver) {
     relative_direction = dictionary_.destination_subset.relative_directions.at(1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_subset.phrases.at(std::to_string(phrase_id));
-
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.destination_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_direction},
+      {kDestinationTag, destination},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -785,14 +779,11 @@ std::string NarrativeBuilder::FormVerbalAlertDestinationInstruction(Maneuver& ma
     relative_direction = dictionary_.destination_subset.relative_directions.at(1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
-
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.destination_verbal_alert_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_direction},
+      {kDestinationTag, destination},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -841,14 +832,11 @@ std::string NarrativeBuilder::FormVerbalDestinationInstruction(Maneuver& maneuve
     relative_direction = dictionary_.destination_subset.relative_directions.at(1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.destination_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_direction},
+      {kDestinationTag, destination},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -871,12 +859,11 @@ std::string NarrativeBuilder::FormBecomesInstruction(Maneuver& maneuver, Maneuve
   // Determine which phrase to use
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.becomes_subset.templates.at(phrase_id).Fill(instruction, {
+      {kPreviousStreetNamesTag, prev_street_names},
+      {kStreetNamesTag, street_names},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -906,12 +893,11 @@ std::string NarrativeBuilder::FormVerbalBecomesInstruction(Maneuver& maneuver,
   // Determine which phrase to use
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.becomes_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kPreviousStreetNamesTag, prev_street_names},
+      {kStreetNamesTag, street_names},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -957,13 +943,12 @@ std::string NarrativeBuilder::FormContinueInstruction(Maneuver& maneuver,
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.continue_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1013,13 +998,12 @@ std::string NarrativeBuilder::FormVerbalAlertContinueInstruction(Maneuver& maneu
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_alert_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.continue_verbal_alert_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1078,16 +1062,15 @@ std::string NarrativeBuilder::FormVerbalContinueInstruction(Maneuver& maneuver,
     phrase_id += 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.continue_verbal_subset.metric_lengths,
-                                dictionary_.continue_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.continue_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kLengthTag, FormLength(maneuver,
+                              dictionary_.continue_verbal_subset.metric_lengths,
+                              dictionary_.continue_verbal_subset.us_customary_lengths)},
+      {kStreetNamesTag, street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1163,16 +1146,14 @@ std::string NarrativeBuilder::FormTurnInstruction(Maneuver& maneuver,
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  subset->templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, FormRelativeTwoDirection(maneuver.type(), subset->relative_directions)},
+      {kStreetNamesTag, street_names},
+      {kBeginStreetNamesTag, begin_street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1271,16 +1252,14 @@ std::string NarrativeBuilder::FormVerbalTurnInstruction(Maneuver& maneuver,
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  subset->templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, FormRelativeTwoDirection(maneuver.type(), subset->relative_directions)},
+      {kStreetNamesTag, street_names},
+      {kBeginStreetNamesTag, begin_street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1341,17 +1320,15 @@ std::string NarrativeBuilder::FormUturnInstruction(Maneuver& maneuver,
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.uturn_subset.relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.uturn_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, FormRelativeTwoDirection(maneuver.type(),
+                                                       dictionary_.uturn_subset.relative_directions)},
+      {kStreetNamesTag, street_names},
+      {kCrossStreetNamesTag, cross_street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1496,15 +1473,14 @@ std::string NarrativeBuilder::FormVerbalUturnInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.uturn_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_dir},
+      {kStreetNamesTag, street_names},
+      {kCrossStreetNamesTag, cross_street_names},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1550,13 +1526,12 @@ std::string NarrativeBuilder::FormRampStraightInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.ramp_straight_subset.templates.at(phrase_id).Fill(instruction, {
+      {kBranchSignTag, exit_branch_sign},
+      {kTowardSignTag, exit_toward_sign},
+      {kNameSignTag, exit_name_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1655,13 +1630,12 @@ std::string NarrativeBuilder::FormVerbalRampStraightInstruction(uint8_t phrase_i
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.ramp_straight_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kBranchSignTag, exit_branch_sign},
+      {kTowardSignTag, exit_toward_sign},
+      {kNameSignTag, exit_name_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1729,16 +1703,14 @@ std::string NarrativeBuilder::FormRampInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.ramp_subset.relative_directions));
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.ramp_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, FormRelativeTwoDirection(maneuver.type(),
+                                                       dictionary_.ramp_subset.relative_directions)},
+      {kBranchSignTag, exit_branch_sign},
+      {kTowardSignTag, exit_toward_sign},
+      {kNameSignTag, exit_name_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1889,14 +1861,13 @@ std::string NarrativeBuilder::FormVerbalRampInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.ramp_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_dir},
+      {kBranchSignTag, exit_branch_sign},
+      {kTowardSignTag, exit_toward_sign},
+      {kNameSignTag, exit_name_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1974,17 +1945,15 @@ std::string NarrativeBuilder::FormExitInstruction(Maneuver& maneuver,
         maneuver.signs().GetExitNameString(element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.exit_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.exit_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, FormRelativeTwoDirection(maneuver.type(),
+                                                       dictionary_.exit_subset.relative_directions)},
+      {kNumberSignTag, exit_number_sign},
+      {kBranchSignTag, exit_branch_sign},
+      {kTowardSignTag, exit_toward_sign},
+      {kNameSignTag, exit_name_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2145,15 +2114,14 @@ std::string NarrativeBuilder::FormVerbalExitInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.exit_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_dir},
+      {kNumberSignTag, exit_number_sign},
+      {kBranchSignTag, exit_branch_sign},
+      {kTowardSignTag, exit_toward_sign},
+      {kNameSignTag, exit_name_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2234,16 +2202,14 @@ std::string NarrativeBuilder::FormKeepInstruction(Maneuver& maneuver,
     phrase_id += 4;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeThreeDirection(maneuver.type(),
-                                                dictionary_.keep_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.keep_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag,
+       FormRelativeThreeDirection(maneuver.type(), dictionary_.keep_subset.relative_directions)},
+      {kNumberSignTag, exit_number_sign},
+      {kStreetNamesTag, street_names},
+      {kTowardSignTag, toward_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2425,14 +2391,13 @@ std::string NarrativeBuilder::FormVerbalKeepInstruction(uint8_t phrase_id,
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.keep_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_dir},
+      {kNumberSignTag, exit_number_sign},
+      {kStreetNamesTag, street_names},
+      {kTowardSignTag, toward_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2484,16 +2449,15 @@ std::string NarrativeBuilder::FormKeepToStayOnInstruction(Maneuver& maneuver,
     phrase_id += 2;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeThreeDirection(maneuver.type(), dictionary_.keep_to_stay_on_subset
-                                                                     .relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.keep_to_stay_on_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag,
+       FormRelativeThreeDirection(maneuver.type(),
+                                  dictionary_.keep_to_stay_on_subset.relative_directions)},
+      {kStreetNamesTag, street_names},
+      {kNumberSignTag, exit_number_sign},
+      {kTowardSignTag, toward_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2583,14 +2547,13 @@ std::string NarrativeBuilder::FormVerbalKeepToStayOnInstruction(uint8_t phrase_i
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, toward_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.keep_to_stay_on_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_dir},
+      {kStreetNamesTag, street_names},
+      {kNumberSignTag, exit_number_sign},
+      {kTowardSignTag, toward_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2641,13 +2604,12 @@ std::string NarrativeBuilder::FormMergeInstruction(Maneuver& maneuver,
         FormRelativeTwoDirection(maneuver.type(), dictionary_.merge_subset.relative_directions);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.merge_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_direction},
+      {kStreetNamesTag, street_names},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2716,13 +2678,12 @@ std::string NarrativeBuilder::FormVerbalMergeInstruction(Maneuver& maneuver,
                                  dictionary_.merge_verbal_subset.relative_directions);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.merge_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_direction},
+      {kStreetNamesTag, street_names},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2839,16 +2800,14 @@ std::string NarrativeBuilder::FormEnterRoundaboutInstruction(Maneuver& maneuver,
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
-  boost::replace_all(instruction, kRoundaboutExitStreetNamesTag, roundabout_exit_street_names);
-  boost::replace_all(instruction, kRoundaboutExitBeginStreetNamesTag,
-                     roundabout_exit_begin_street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.enter_roundabout_subset.templates.at(phrase_id).Fill(instruction, {
+      {kOrdinalValueTag, ordinal_value},
+      {kStreetNamesTag, street_names},
+      {kTowardSignTag, guide_sign},
+      {kRoundaboutExitStreetNamesTag, roundabout_exit_street_names},
+      {kRoundaboutExitBeginStreetNamesTag, roundabout_exit_begin_street_names},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2991,16 +2950,14 @@ std::string NarrativeBuilder::FormVerbalEnterRoundaboutInstruction(Maneuver& man
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
-  boost::replace_all(instruction, kRoundaboutExitStreetNamesTag, roundabout_exit_street_names);
-  boost::replace_all(instruction, kRoundaboutExitBeginStreetNamesTag,
-                     roundabout_exit_begin_street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.enter_roundabout_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kOrdinalValueTag, ordinal_value},
+      {kStreetNamesTag, street_names},
+      {kTowardSignTag, guide_sign},
+      {kRoundaboutExitStreetNamesTag, roundabout_exit_street_names},
+      {kRoundaboutExitBeginStreetNamesTag, roundabout_exit_begin_street_names},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3054,13 +3011,12 @@ std::string NarrativeBuilder::FormExitRoundaboutInstruction(Maneuver& maneuver,
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.exit_roundabout_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+      {kBeginStreetNamesTag, begin_street_names},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3118,13 +3074,12 @@ std::string NarrativeBuilder::FormVerbalExitRoundaboutInstruction(Maneuver& mane
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.exit_roundabout_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+      {kBeginStreetNamesTag, begin_street_names},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3168,13 +3123,12 @@ std::string NarrativeBuilder::FormEnterFerryInstruction(Maneuver& maneuver,
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.enter_ferry_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+      {kFerryLabelTag, ferry_label},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3235,13 +3189,12 @@ std::string NarrativeBuilder::FormVerbalEnterFerryInstruction(Maneuver& maneuver
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.enter_ferry_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+      {kFerryLabelTag, ferry_label},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3274,12 +3227,11 @@ std::string NarrativeBuilder::FormTransitConnectionStartInstruction(Maneuver& ma
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_start_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_connection_start_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop},
+      {kStationLabelTag, station_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3312,13 +3264,11 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionStartInstruction(Maneuv
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_start_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_connection_start_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop},
+      {kStationLabelTag, station_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3351,12 +3301,11 @@ std::string NarrativeBuilder::FormTransitConnectionTransferInstruction(Maneuver&
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_transfer_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_connection_transfer_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop},
+      {kStationLabelTag, station_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3389,13 +3338,11 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionTransferInstruction(Man
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_connection_transfer_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop},
+      {kStationLabelTag, station_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3428,13 +3375,11 @@ std::string NarrativeBuilder::FormTransitConnectionDestinationInstruction(Maneuv
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_destination_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_connection_destination_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop},
+      {kStationLabelTag, station_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3467,13 +3412,11 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionDestinationInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.transit_connection_destination_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_connection_destination_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop},
+      {kStationLabelTag, station_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3496,13 +3439,11 @@ std::string NarrativeBuilder::FormDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.depart_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop_name},
+      {kTimeTag, get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale())},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3525,13 +3466,11 @@ std::string NarrativeBuilder::FormVerbalDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.depart_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop_name},
+      {kTimeTag, get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale())},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3554,13 +3493,11 @@ std::string NarrativeBuilder::FormArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.arrive_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop_name},
+      {kTimeTag, get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale())},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3583,13 +3520,11 @@ std::string NarrativeBuilder::FormVerbalArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-                     get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.arrive_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformTag, transit_stop_name},
+      {kTimeTag, get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale())},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3616,16 +3551,14 @@ std::string NarrativeBuilder::FormTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitNameTag, FormTransitName(maneuver,
+                                        dictionary_.transit_subset.empty_transit_name_labels)},
+      {kTransitHeadSignTag, transit_headsign},
+      {kTransitPlatformCountTag, std::to_string(stop_count)}, // TODO: locale specific numerals
+      {kTransitPlatformCountLabelTag, stop_count_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3648,14 +3581,12 @@ std::string NarrativeBuilder::FormVerbalTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_verbal_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitNameTag, FormTransitName(maneuver,
+                                        dictionary_.transit_verbal_subset.empty_transit_name_labels)},
+      {kTransitHeadSignTag, transit_headsign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3683,17 +3614,14 @@ std::string NarrativeBuilder::FormTransitRemainOnInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_remain_on_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_remain_on_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitNameTag,
+       FormTransitName(maneuver, dictionary_.transit_remain_on_subset.empty_transit_name_labels)},
+      {kTransitHeadSignTag, transit_headsign},
+      {kTransitPlatformCountTag, std::to_string(stop_count)}, // TODO: locale specific numerals
+      {kTransitPlatformCountLabelTag, stop_count_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3716,14 +3644,13 @@ std::string NarrativeBuilder::FormVerbalTransitRemainOnInstruction(Maneuver& man
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_remain_on_verbal_subset
-                                                   .empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_remain_on_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitNameTag,
+       FormTransitName(maneuver,
+                       dictionary_.transit_remain_on_verbal_subset.empty_transit_name_labels)},
+      {kTransitHeadSignTag, transit_headsign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3751,17 +3678,14 @@ std::string NarrativeBuilder::FormTransitTransferInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver,
-                                     dictionary_.transit_transfer_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_transfer_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitNameTag,
+       FormTransitName(maneuver, dictionary_.transit_transfer_subset.empty_transit_name_labels)},
+      {kTransitHeadSignTag, transit_headsign},
+      {kTransitPlatformCountTag, std::to_string(stop_count)}, // TODO: locale specific numerals
+      {kTransitPlatformCountLabelTag, stop_count_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3784,14 +3708,13 @@ std::string NarrativeBuilder::FormVerbalTransitTransferInstruction(Maneuver& man
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitNameTag,
-                     FormTransitName(maneuver, dictionary_.transit_transfer_verbal_subset
-                                                   .empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.transit_transfer_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitNameTag,
+       FormTransitName(maneuver,
+                       dictionary_.transit_transfer_verbal_subset.empty_transit_name_labels)},
+      {kTransitHeadSignTag, transit_headsign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3832,14 +3755,13 @@ std::string NarrativeBuilder::FormVerbalPostTransitionInstruction(Maneuver& mane
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transition_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
-                                dictionary_.post_transition_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.post_transition_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kLengthTag, FormLength(maneuver,
+                              dictionary_.post_transition_verbal_subset.metric_lengths,
+                              dictionary_.post_transition_verbal_subset.us_customary_lengths)},
+      {kStreetNamesTag, street_names},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3860,14 +3782,11 @@ std::string NarrativeBuilder::FormVerbalPostTransitionTransitInstruction(Maneuve
       FormTransitPlatformCountLabel(stop_count, dictionary_.post_transition_transit_verbal_subset
                                                     .transit_stop_count_labels);
 
-  // Set instruction to the determined tagged phrase
-  instruction =
-      dictionary_.post_transition_transit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformCountTag,
-                     std::to_string(stop_count)); // TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.post_transition_transit_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTransitPlatformCountTag, std::to_string(stop_count)}, // TODO: locale specific numerals
+      {kTransitPlatformCountLabelTag, stop_count_label},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3911,14 +3830,13 @@ std::string NarrativeBuilder::FormVerbalSuccinctStartTransitionInstruction(Maneu
     phrase_id += 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.start_verbal_subset.metric_lengths,
-                                dictionary_.start_verbal_subset.us_customary_lengths));
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.start_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kCardinalDirectionTag, cardinal_direction},
+      {kLengthTag, FormLength(maneuver,
+                              dictionary_.start_verbal_subset.metric_lengths,
+                              dictionary_.start_verbal_subset.us_customary_lengths)},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3977,14 +3895,12 @@ NarrativeBuilder::FormVerbalSuccinctTurnTransitionInstruction(Maneuver& maneuver
                                                maneuver.verbal_formatter(), &markup_formatter_);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  subset->templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, FormRelativeTwoDirection(maneuver.type(), subset->relative_directions)},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -4023,15 +3939,14 @@ NarrativeBuilder::FormVerbalSuccinctUturnTransitionInstruction(Maneuver& maneuve
         maneuver.signs().GetJunctionNameString(element_max_count, limit_by_consecutive_count, delim,
                                                maneuver.verbal_formatter(), &markup_formatter_);
   }
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-                     FormRelativeTwoDirection(maneuver.type(),
-                                              dictionary_.uturn_verbal_subset.relative_directions));
-  boost::replace_all(instruction, kJunctionNameTag, junction_name);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.uturn_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag,
+       FormRelativeTwoDirection(maneuver.type(),
+                                dictionary_.uturn_verbal_subset.relative_directions)},
+      {kJunctionNameTag, junction_name},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -4075,12 +3990,11 @@ NarrativeBuilder::FormVerbalSuccinctMergeTransitionInstruction(Maneuver& maneuve
                                  dictionary_.merge_verbal_subset.relative_directions);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.merge_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kRelativeDirectionTag, relative_direction},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -4123,12 +4037,11 @@ std::string NarrativeBuilder::FormVerbalSuccinctEnterRoundaboutTransitionInstruc
                                                         &markup_formatter_);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.enter_roundabout_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kOrdinalValueTag, ordinal_value},
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -4159,10 +4072,10 @@ std::string NarrativeBuilder::FormVerbalSuccinctExitRoundaboutTransitionInstruct
                                                  maneuver.verbal_formatter(), &markup_formatter_);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  boost::replace_all(instruction, kTowardSignTag, guide_sign);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.exit_roundabout_verbal_subset.templates.at(phrase_id).Fill(instruction, {
+      {kTowardSignTag, guide_sign},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -4188,11 +4101,8 @@ std::string NarrativeBuilder::FormElevatorInstruction(Maneuver& maneuver) {
     end_level = maneuver.end_level_ref();
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.elevator_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLevelTag, end_level);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.elevator_subset.templates.at(phrase_id).Fill(instruction, {{kLevelTag, end_level}});
 
   return instruction;
 }
@@ -4213,11 +4123,8 @@ std::string NarrativeBuilder::FormStepsInstruction(Maneuver& maneuver) {
     end_level = maneuver.end_level_ref();
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.steps_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLevelTag, end_level);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.steps_subset.templates.at(phrase_id).Fill(instruction, {{kLevelTag, end_level}});
 
   return instruction;
 }
@@ -4238,11 +4145,8 @@ std::string NarrativeBuilder::FormEscalatorInstruction(Maneuver& maneuver) {
     end_level = maneuver.end_level_ref();
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.escalator_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLevelTag, end_level);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.escalator_subset.templates.at(phrase_id).Fill(instruction, {{kLevelTag, end_level}});
 
   return instruction;
 }
@@ -4265,11 +4169,10 @@ std::string NarrativeBuilder::FormEnterBuildingInstruction(Maneuver& maneuver) {
     phrase_id += 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_building_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.enter_building_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+  });
 
   return instruction;
 }
@@ -4292,11 +4195,10 @@ std::string NarrativeBuilder::FormExitBuildingInstruction(Maneuver& maneuver) {
     phrase_id += 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_building_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Set instruction to the determined tagged phrase filled with the values of its tags
+  dictionary_.exit_building_subset.templates.at(phrase_id).Fill(instruction, {
+      {kStreetNamesTag, street_names},
+  });
 
   return instruction;
 }
@@ -4720,14 +4622,13 @@ std::string NarrativeBuilder::FormVerbalMultiCue(Maneuver& maneuver,
   if (maneuver.distant_verbal_multi_cue()) {
     phrase_id = 1;
   }
-  instruction = dictionary_.verbal_multi_cue_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCurrentVerbalCueTag, first_verbal_cue);
-  boost::replace_all(instruction, kNextVerbalCueTag, second_verbal_cue);
-  boost::replace_all(instruction, kLengthTag,
-                     FormLength(maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
-                                dictionary_.post_transition_verbal_subset.us_customary_lengths));
+  dictionary_.verbal_multi_cue_subset.templates.at(phrase_id).Fill(instruction, {
+      {kCurrentVerbalCueTag, first_verbal_cue},
+      {kNextVerbalCueTag, second_verbal_cue},
+      {kLengthTag, FormLength(maneuver,
+                              dictionary_.post_transition_verbal_subset.metric_lengths,
+                              dictionary_.post_transition_verbal_subset.us_customary_lengths)},
+  });
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -6,6 +6,7 @@
 
 #include <cctype>
 #include <chrono>
+#include <mutex>
 #include <regex>
 #include <sstream>
 
@@ -37,34 +38,37 @@ constexpr size_t kScriptIndex = 2;
 constexpr size_t kRegionIndex = 3;
 constexpr size_t kPrivateuseIndex = 4;
 
+// parse the json of a locale into its dictionary
+std::shared_ptr<valhalla::odin::NarrativeDictionary> load_narrative_local(const std::string& name,
+                                                                          const std::string& json) {
+  LOG_TRACE("- " + name);
+  boost::property_tree::ptree narrative_pt;
+  std::stringstream ss;
+  ss << json;
+  rapidjson::read_json(ss, narrative_pt);
+  LOG_TRACE("JSON read");
+  auto narrative_dictionary =
+      std::make_shared<valhalla::odin::NarrativeDictionary>(name, narrative_pt);
+  LOG_TRACE("NarrativeDictionary created");
+  return narrative_dictionary;
+}
+
 valhalla::odin::locales_singleton_t load_narrative_locals() {
   valhalla::odin::locales_singleton_t locales;
-  // for each locale
+  LOG_TRACE("LOCALES");
+  LOG_TRACE("-------");
+  // for each locale, sharing the dictionaries already loaded on their own
   for (const auto& json : locales_json) {
-    LOG_TRACE("LOCALES");
-    LOG_TRACE("-------");
-    LOG_TRACE("- " + json.first);
-    // load the json
-    boost::property_tree::ptree narrative_pt;
-    std::stringstream ss;
-    ss << json.second;
-    rapidjson::read_json(ss, narrative_pt);
-    LOG_TRACE("JSON read");
-    // parse it into an object and add it to the map
-    auto narrative_dictionary =
-        std::make_shared<valhalla::odin::NarrativeDictionary>(json.first, narrative_pt);
-    LOG_TRACE("NarrativeDictionary created");
+    auto narrative_dictionary = valhalla::odin::get_locale(json.first);
     locales.insert(std::make_pair(json.first, narrative_dictionary));
-    // insert all the aliases as this same object
-    auto aliases = narrative_pt.get_child("aliases");
-    for (const auto& alias : aliases) {
-      auto name = alias.second.get_value<std::string>();
-      auto inserted = locales.insert(std::make_pair(name, narrative_dictionary));
-      if (!inserted.second) {
-        throw std::logic_error("Alias '" + name + "' in json locale '" + json.first +
-                               "' has duplicate with posix_locale '" +
-                               inserted.first->second->GetLocale().name());
-      }
+  }
+  // insert all the aliases as the same object
+  for (const auto& alias : locales_aliases) {
+    auto inserted = locales.insert(std::make_pair(alias.first, locales.at(alias.second)));
+    if (!inserted.second) {
+      throw std::logic_error("Alias '" + alias.first + "' in json locale '" + alias.second +
+                             "' has duplicate with posix_locale '" +
+                             inserted.first->second->GetLocale().name());
     }
   }
   return locales;
@@ -145,6 +149,32 @@ std::string get_localized_date(const std::string& date_time, const std::locale&
   return date::format(locale, "%x", local_tp);
 }
 
+std::shared_ptr<NarrativeDictionary> get_locale(const std::string& language) {
+  // resolve an alias to the locale it names
+  auto json = locales_json.find(language);
+  if (json == locales_json.end()) {
+    auto alias = locales_aliases.find(language);
+    if (alias == locales_aliases.end()) {
+      return nullptr;
+    }
+    json = locales_json.find(alias->second);
+  }
+
+  // parse the locale on its first use
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<NarrativeDictionary>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& narrative_dictionary = loaded[json->first];
+  if (!narrative_dictionary) {
+    narrative_dictionary = load_narrative_local(json->first, json->second);
+  }
+  return narrative_dictionary;
+}
+
+bool has_locale(const std::string& language) {
+  return locales_json.count(language) || locales_aliases.count(language);
+}
+
 const locales_singleton_t& get_locales() {
   // thread safe static initializer for singleton
   static locales_singleton_t locales(load_narrative_locals());
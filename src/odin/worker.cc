@@ -45,7 +45,13 @@ std::string odin_worker_t::narrate(Api& request) const {
     odin::DirectionsBuilder().Build(request, markup_formatter_);
   } catch (...) { throw valhalla_exception_t{202}; }
 
+  // keep them for when the same route is asked for again
+  if (result_cache) {
+    result_cache->put(request);
+  }
+
   // serialize those to the proper format
+  auto serializing = measure_phase_time(request, service_name(), "serialize");
   return tyr::serializeDirections(request);
 }
 
@@ -67,18 +73,20 @@ odin_worker_t::work(const std::list<zmq::message_t>& job,
                     const std::function<void()>& interrupt_function) {
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Odin Request " + std::to_string(info.id));
-  Api request;
+  Api& request = request_arena.next();
   prime_server::worker_t::result_t result{false, {}, {}};
   try {
     // Set the interrupt function
     service_worker_t::set_interrupt(&interrupt_function);
 
     // crack open the in progress request
+    const auto received = std::chrono::steady_clock::now();
     bool success = request.ParseFromArray(job.front().data(), job.front().size());
     if (!success) {
       LOG_ERROR("Failed parsing pbf in Odin::Worker");
       throw valhalla_exception_t{200, "Failed parsing pbf in Odin::Worker"};
     }
+    trace_arrival(request, service_name(), received, std::chrono::steady_clock::now());
 
     // its either a simple status request or its a route to narrate
     switch (request.options().action()) {
@@ -99,9 +107,12 @@ odin_worker_t::work(const std::list<zmq::message_t>& job,
     result = serialize_error({299, std::string(e.what())}, info, request);
   }
 
-  // keep track of the metrics if the request is going back to the client (this should be the case)
-  if (!result.intermediate)
+  // keep track of the metrics and the trace if the request is going back to the client (this
+  // should be the case)
+  if (!result.intermediate) {
     enqueue_statistics(request);
+    export_trace(request);
+  }
 
   return result;
 }
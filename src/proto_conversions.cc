@@ -5,7 +5,14 @@ using namespace valhalla;
 
 namespace valhalla {
 std::string MatrixAlgoToString(const valhalla::Matrix::Algorithm algo) {
-  return algo == valhalla::Matrix::CostMatrix ? "costmatrix" : "timedistancematrix";
+  switch (algo) {
+    case valhalla::Matrix::CostMatrix:
+      return "costmatrix";
+    case valhalla::Matrix::BucketMatrix:
+      return "bucketmatrix";
+    default:
+      return "timedistancematrix";
+  }
 };
 
 std::string incidentTypeToString(const valhalla::IncidentsTile::Metadata::Type& incident_type) {
@@ -117,6 +124,9 @@ bool Options_Action_Enum_Parse(const std::string& action, Options::Action* a) {
       {"expansion", Options::expansion},
       {"centroid", Options::centroid},
       {"status", Options::status},
+      {"route_batch", Options::route_batch},
+      {"isochrone_batch", Options::isochrone_batch},
+      {"tile", Options::tile},
   };
   auto i = actions.find(action);
   if (i == actions.cend())
@@ -152,6 +162,9 @@ const std::string& Options_Action_Enum_Name(const Options::Action action) {
       {Options::expansion, "expansion"},
       {Options::centroid, "centroid"},
       {Options::status, "status"},
+      {Options::route_batch, "route_batch"},
+      {Options::isochrone_batch, "isochrone_batch"},
+      {Options::tile, "tile"},
   };
   auto i = actions.find(action);
   return i == actions.cend() ? empty : i->second;
@@ -270,6 +283,8 @@ bool Options_Format_Enum_Parse(const std::string& format, Options::Format* f) {
       {"gpx", Options::gpx},
       {"osrm", Options::osrm},
       {"pbf", Options::pbf},
+      {"raster", Options::raster},
+      {"binary", Options::binary},
   };
   auto i = formats.find(format);
   if (i == formats.cend())
@@ -285,6 +300,8 @@ const std::string& Options_Format_Enum_Name(const Options::Format match) {
       {Options::gpx, "gpx"},
       {Options::osrm, "osrm"},
       {Options::pbf, "pbf"},
+      {Options::raster, "raster"},
+      {Options::binary, "binary"},
   };
   auto i = formats.find(match);
   return i == formats.cend() ? empty : i->second;
@@ -373,7 +390,8 @@ bool Options_ExpansionProperties_Enum_Parse(const std::string& prop,
               {"durations", Options_ExpansionProperties_durations},
               {"distances", Options_ExpansionProperties_distances},
               {"statuses", Options_ExpansionProperties_statuses},
-              {"edge_ids", Options::ExpansionProperties::Options_ExpansionProperties_edge_ids}};
+              {"edge_ids", Options::ExpansionProperties::Options_ExpansionProperties_edge_ids},
+              {"pred_edge_ids", Options_ExpansionProperties_pred_edge_ids}};
   auto i = actions.find(prop);
   if (i == actions.cend())
     return false;
@@ -381,6 +399,21 @@ bool Options_ExpansionProperties_Enum_Parse(const std::string& prop,
   return true;
 }
 
+bool Options_LocateField_Enum_Parse(const std::string& field, Options::LocateField* f) {
+  static const std::unordered_map<std::string, Options::LocateField> fields{
+      {"edge_id", Options::edge_id},
+      {"percent_along", Options::percent_along},
+      {"distance", Options::distance},
+      {"side_of_street", Options::side_of_street},
+      {"way_id", Options::way_id},
+  };
+  auto i = fields.find(field);
+  if (i == fields.cend())
+    return false;
+  *f = i->second;
+  return true;
+}
+
 const std::unordered_map<int, std::string> vehicle_to_string{
     {static_cast<int>(VehicleType::kCar), "car"},
     {static_cast<int>(VehicleType::kMotorcycle), "motorcycle"},
@@ -0,0 +1,199 @@
+#include "region_router.h"
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "worker.h"
+
+#ifdef HAVE_HTTP
+#include <prime_server/http_protocol.hpp>
+using namespace prime_server;
+#endif
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// The level the tiles of a tile set are looked at on, the local level has the most of them
+uint8_t coverage_level() {
+  return TileHierarchy::levels().back().level;
+}
+
+// A region as it is configured
+valhalla::region_router_t::region_t make_region(const boost::property_tree::ptree& config) {
+  valhalla::region_router_t::region_t region;
+  region.name = config.get<std::string>("name", "");
+  region.url = config.get<std::string>("url");
+  if (!region.url.empty() && region.url.back() == '/') {
+    region.url.pop_back();
+  }
+
+  // the polygons of the region
+  std::vector<PointLL> points;
+  const auto polygons = config.get_child_optional("polygons");
+  for (const auto& ring : polygons ? *polygons : boost::property_tree::ptree{}) {
+    region.polygons.emplace_back();
+    for (const auto& point : ring.second) {
+      if (point.second.size() != 2) {
+        throw std::runtime_error("A point of region " + region.name + " is not [lon, lat]");
+      }
+      region.polygons.back().emplace_back(point.second.front().second.get_value<double>(),
+                                          point.second.back().second.get_value<double>());
+    }
+    if (region.polygons.back().size() < 3) {
+      throw std::runtime_error("A polygon of region " + region.name + " has less than 3 points");
+    }
+    points.insert(points.end(), region.polygons.back().begin(), region.polygons.back().end());
+  }
+
+  // or the tiles of its tile set, which are only listed
+  if (region.polygons.empty()) {
+    boost::property_tree::ptree tile_set;
+    tile_set.put("tile_dir", config.get<std::string>("tile_dir", ""));
+    tile_set.put("tile_extract", config.get<std::string>("tile_extract", ""));
+    GraphReader reader(tile_set);
+    for (const auto& id : reader.GetTileSet(coverage_level())) {
+      region.tiles.insert(id.tileid());
+      const auto bounds = TileHierarchy::GetGraphIdBoundingBox(id);
+      points.push_back(bounds.minpt());
+      points.push_back(bounds.maxpt());
+    }
+  }
+
+  if (points.empty()) {
+    throw std::runtime_error("Region " + region.name + " needs polygons or a tile set");
+  }
+  region.bounds = AABB2<PointLL>(points);
+  return region;
+}
+
+} // namespace
+
+namespace valhalla {
+
+bool region_router_t::region_t::covers(const PointLL& ll) const {
+  if (!bounds.Contains(ll)) {
+    return false;
+  }
+  for (const auto& polygon : polygons) {
+    if (ll.WithinPolygon(polygon)) {
+      return true;
+    }
+  }
+  return tiles.count(TileHierarchy::GetGraphId(ll, coverage_level()).tileid()) > 0;
+}
+
+region_router_t::region_router_t(const boost::property_tree::ptree& config) {
+  if (const auto regions = config.get_child_optional("router.regions")) {
+    for (const auto& region : *regions) {
+      regions_.push_back(make_region(region.second));
+      LOG_INFO("Region " + regions_.back().name + " goes to " + regions_.back().url);
+    }
+  }
+  fallback_.name = "fallback";
+  fallback_.url = config.get<std::string>("router.fallback");
+  if (!fallback_.url.empty() && fallback_.url.back() == '/') {
+    fallback_.url.pop_back();
+  }
+}
+
+const region_router_t::region_t& region_router_t::route(const Api& request) const {
+  // all the places a request has to get to
+  const auto& options = request.options();
+  std::vector<PointLL> points;
+  for (const auto* locations : {&options.locations(), &options.sources(), &options.targets(),
+                                &options.shape()}) {
+    for (const auto& location : *locations) {
+      points.emplace_back(location.ll().lng(), location.ll().lat());
+    }
+  }
+  if (points.empty()) {
+    return fallback_;
+  }
+
+  for (const auto& region : regions_) {
+    bool covered = true;
+    for (const auto& point : points) {
+      if (!region.covers(point)) {
+        covered = false;
+        break;
+      }
+    }
+    if (covered) {
+      return region;
+    }
+  }
+  return fallback_;
+}
+
+#ifdef HAVE_HTTP
+worker_t::result_t region_router_t::work(const std::list<zmq::message_t>& job,
+                                         void* request_info) const {
+  auto& info = *static_cast<http_request_info_t*>(request_info);
+  const std::string message(static_cast<const char*>(job.front().data()), job.front().size());
+
+  // requests the router can't make sense of are the fallback's to answer
+  const region_t* region = &fallback_;
+  try {
+    const auto request = http_request_t::from_string(message.data(), message.size());
+    Api api;
+    ParseApi(request, api);
+    region = &route(api);
+  } catch (...) {}
+
+  // the path and query of the request as they were sent, from its request line
+  std::string target = "/";
+  const auto start = message.find(' ');
+  const auto end = message.find_first_of(" \r\n", start + 1);
+  if (start != std::string::npos && end != std::string::npos && end > start + 1) {
+    target = message.substr(start + 1, end - start - 1);
+  }
+
+  // a 307 keeps the method and the body of the request
+  http_response_t response(307, "Temporary Redirect", "",
+                           headers_t{{"Location", region->url + target},
+                                     {"X-Valhalla-Region", region->name}});
+  response.from_info(info);
+  return {false, {response.to_string()}, ""};
+}
+
+void run_region_router(const boost::property_tree::ptree& config) {
+  const auto listen = config.get<std::string>("router.service.listen");
+  const auto proxy = config.get<std::string>("router.service.proxy");
+  const auto loopback = config.get<std::string>("router.service.loopback");
+  const auto interrupt = config.get<std::string>("router.service.interrupt");
+  auto concurrency = config.get<size_t>("router.service.concurrency", 0);
+  if (concurrency == 0) {
+    concurrency = std::thread::hardware_concurrency();
+  }
+
+  // the workers share the regions, they only ever read them
+  const auto router = std::make_shared<const region_router_t>(config);
+
+  zmq::context_t context;
+  std::thread server(std::bind(&http_server_t::serve,
+                               http_server_t(context, listen, proxy + "_in", loopback, interrupt,
+                                             true, DEFAULT_MAX_REQUEST_SIZE)));
+  std::thread(std::bind(&proxy_t::forward, proxy_t(context, proxy + "_in", proxy + "_out")))
+      .detach();
+  for (size_t i = 0; i < concurrency; ++i) {
+    auto work = [router](const std::list<zmq::message_t>& job, void* request_info,
+                         worker_t::interrupt_function_t&) {
+      return router->work(job, request_info);
+    };
+    std::thread(std::bind(&worker_t::work, worker_t(context, proxy + "_out", "ipc:///dev/null",
+                                                    loopback, interrupt, work)))
+        .detach();
+  }
+  server.join();
+}
+#endif
+
+} // namespace valhalla
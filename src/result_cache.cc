@@ -0,0 +1,149 @@
+#include "result_cache.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+namespace valhalla {
+
+result_cache_t::result_cache_t(size_t max_bytes, std::chrono::seconds ttl)
+    : max_bytes(max_bytes), ttl(ttl), used_bytes(0), traffic_seen(0), traffic_checked() {
+}
+
+std::shared_ptr<result_cache_t> result_cache_t::shared(const boost::property_tree::ptree& config) {
+  auto max_bytes = config.get<size_t>("httpd.service.result_cache.max_bytes", 0);
+  if (max_bytes == 0) {
+    return nullptr;
+  }
+
+  // the first worker of the process to ask makes it, the others share it
+  static std::mutex lock;
+  static std::weak_ptr<result_cache_t> instance;
+  std::lock_guard<std::mutex> _(lock);
+  auto cache = instance.lock();
+  if (!cache) {
+    cache = std::make_shared<result_cache_t>(
+        max_bytes,
+        std::chrono::seconds(config.get<uint32_t>("httpd.service.result_cache.ttl_seconds", 300)));
+    instance = cache;
+  }
+  return cache;
+}
+
+uint64_t result_cache_t::key(const Api& request) {
+  // the id and jsonp only change how the results are serialized
+  Options options = request.options();
+  options.clear_id();
+  options.clear_jsonp();
+
+  // maps like the costings only serialize in the same order when asked to
+  std::string bytes;
+  {
+    google::protobuf::io::StringOutputStream stream(&bytes);
+    google::protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    options.SerializeToCodedStream(&coded);
+  }
+  auto key = static_cast<uint64_t>(std::hash<std::string>{}(bytes));
+  return key == 0 ? 1 : key;
+}
+
+bool result_cache_t::get(Api& request, const std::function<uint64_t()>& traffic_version) {
+  const auto key = request.info().cache_key();
+  if (key == 0) {
+    return false;
+  }
+
+  std::string result;
+  {
+    std::lock_guard<std::mutex> _(mutex);
+    const auto now = clock_t::now();
+
+    // results computed with other traffic than there is now are no good
+    if (traffic_version && now - traffic_checked >= std::chrono::seconds(1)) {
+      traffic_checked = now;
+      auto version = traffic_version();
+      if (version != traffic_seen) {
+        entries.clear();
+        index.clear();
+        used_bytes = 0;
+        traffic_seen = version;
+      }
+    }
+
+    auto found = index.find(key);
+    if (found == index.cend()) {
+      return false;
+    }
+    if (found->second->expires <= now) {
+      erase(found->second);
+      return false;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    result = found->second->result;
+  }
+
+  Api cached;
+  if (!cached.ParseFromString(result)) {
+    return false;
+  }
+
+  // the same request but for the id and jsonp that this one may have
+  auto& options = *cached.mutable_options();
+  if (request.options().has_id_case()) {
+    options.set_id(request.options().id());
+  } else {
+    options.clear_id();
+  }
+  if (request.options().has_jsonp_case()) {
+    options.set_jsonp(request.options().jsonp());
+  } else {
+    options.clear_jsonp();
+  }
+  // the stats of the first request were already sent
+  cached.mutable_info()->clear_statistics();
+  cached.mutable_info()->set_is_service(request.info().is_service());
+  request.Swap(&cached);
+  return true;
+}
+
+void result_cache_t::put(const Api& request) {
+  const auto key = request.info().cache_key();
+  if (key == 0) {
+    return;
+  }
+  auto result = request.SerializeAsString();
+  if (result.size() > max_bytes) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> _(mutex);
+  auto found = index.find(key);
+  if (found != index.cend()) {
+    erase(found->second);
+  }
+  // make room by dropping the least recently used
+  while (used_bytes + result.size() > max_bytes) {
+    erase(std::prev(entries.end()));
+  }
+  used_bytes += result.size();
+  entries.push_front(entry_t{key, std::move(result), clock_t::now() + ttl});
+  index[key] = entries.begin();
+}
+
+size_t result_cache_t::size() const {
+  std::lock_guard<std::mutex> _(mutex);
+  return entries.size();
+}
+
+size_t result_cache_t::bytes() const {
+  std::lock_guard<std::mutex> _(mutex);
+  return used_bytes;
+}
+
+void result_cache_t::erase(std::list<entry_t>::iterator entry) {
+  used_bytes -= entry->result.size();
+  index.erase(entry->key);
+  entries.erase(entry);
+}
+
+} // namespace valhalla
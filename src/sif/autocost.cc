@@ -64,6 +64,10 @@ constexpr float kLeftSideTurnCosts[] = {kTCStraight,         kTCSlight,  kTCUnfa
                                         kTCUnfavorableSharp, kTCReverse, kTCFavorableSharp,
                                         kTCFavorable,        kTCSlight};
 
+// Turn costs by turn class, see TurnClass::cost_index
+constexpr auto kTurnClassCosts =
+    TurnClassCosts(kRightSideTurnCosts, kLeftSideTurnCosts, kTCCrossing);
+
 constexpr float kMinFactor = 0.1f;
 constexpr float kMaxFactor = 100000.0f;
 
@@ -131,6 +135,12 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
  */
 class AutoCost : public DynamicCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(AutoCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<AutoCost>(*this);
+  }
+
   /**
    * Construct auto costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing_options pbf with request costing_options.
@@ -232,6 +242,15 @@ public:
                         const baldr::TimeInfo& time_info,
                         uint8_t& flow_sources) const override;
 
+  /**
+   * Get the cost to traverse the specified directed edge without looking at the default edge
+   * costs of the tile.
+   */
+  Cost ComputeEdgeCost(const baldr::DirectedEdge* edge,
+                       const graph_tile_ptr& tile,
+                       const baldr::TimeInfo& time_info,
+                       uint8_t& flow_sources) const;
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -245,6 +264,22 @@ public:
                               const baldr::NodeInfo* node,
                               const EdgeLabel& pred) const override;
 
+  static constexpr bool kTurnClasses = true;
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge, looking the turn up in
+   * its turn class when the tile has them.
+   * @param  edge  Directed edge (the to edge)
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  Predecessor edge information.
+   * @param  turn  Turn class of the transition, null to work the turn out from the edge and node.
+   * @return  Returns the cost and time (seconds)
+   */
+  Cost TransitionCost(const baldr::DirectedEdge* edge,
+                      const baldr::NodeInfo* node,
+                      const EdgeLabel& pred,
+                      const baldr::TurnClass* turn) const;
+
   /**
    * Returns the cost to make the transition from the predecessor edge
    * when using a reverse search (from destination towards the origin).
@@ -263,6 +298,26 @@ public:
                                      const bool has_measured_speed,
                                      const InternalTurn internal_turn) const override;
 
+  /**
+   * Returns the cost to make the transition from the predecessor edge when using a reverse
+   * search, looking the turn up in its turn class when the tile has them.
+   * @param  idx   Directed edge local index
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  the opposing current edge in the reverse tree.
+   * @param  edge  the opposing predecessor in the reverse tree
+   * @param  has_measured_speed Do we have any of the measured speed types set?
+   * @param  internal_turn  Did we make an turn on a short internal edge.
+   * @param  turn  Turn class of the transition, null to work the turn out from the edges and node.
+   * @return  Returns the cost and time (seconds)
+   */
+  Cost TransitionCostReverse(const uint32_t idx,
+                             const baldr::NodeInfo* node,
+                             const baldr::DirectedEdge* pred,
+                             const baldr::DirectedEdge* edge,
+                             const bool has_measured_speed,
+                             const InternalTurn internal_turn,
+                             const baldr::TurnClass* turn) const;
+
   /**
    * Get the cost factor for A* heuristics. This factor is multiplied
    * with the distance to the destination to produce an estimate of the
@@ -418,6 +473,12 @@ AutoCost::AutoCost(const Costing& costing, uint32_t access_mask)
   for (uint32_t d = 0; d < 16; d++) {
     density_factor_[d] = 0.85f + (d * 0.025f);
   }
+
+  // Requests with the default options share the edge costs their tiles keep
+  if (DefaultEdgeCosts::enabled() && costing.type() == Costing::auto_ &&
+      HasDefaultOptions(costing)) {
+    default_edge_costs_ = DefaultEdgeCosts::kAuto;
+  }
 }
 
 // Check if access is allowed on the specified edge.
@@ -491,6 +552,21 @@ Cost AutoCost::EdgeCost(const baldr::DirectedEdge* edge,
                         const graph_tile_ptr& tile,
                         const baldr::TimeInfo& time_info,
                         uint8_t& flow_sources) const {
+  const auto* cached =
+      DefaultEdgeCost(edge, tile, time_info, [&](const DirectedEdge* e, uint8_t& sources) {
+        return ComputeEdgeCost(e, tile, time_info, sources);
+      });
+  if (cached) {
+    flow_sources = cached->flow_sources;
+    return {cached->cost, cached->secs};
+  }
+  return ComputeEdgeCost(edge, tile, time_info, flow_sources);
+}
+
+Cost AutoCost::ComputeEdgeCost(const baldr::DirectedEdge* edge,
+                               const graph_tile_ptr& tile,
+                               const baldr::TimeInfo& time_info,
+                               uint8_t& flow_sources) const {
   // either the computed edge speed or optional top_speed
   auto edge_speed = fixed_speed_ == baldr::kDisableFixedSpeed
                         ? tile->GetSpeed(edge, flow_mask_, time_info.second_of_week, false,
@@ -560,16 +636,28 @@ Cost AutoCost::EdgeCost(const baldr::DirectedEdge* edge,
 Cost AutoCost::TransitionCost(const baldr::DirectedEdge* edge,
                               const baldr::NodeInfo* node,
                               const EdgeLabel& pred) const {
+  return TransitionCost(edge, node, pred, nullptr);
+}
+
+// Returns the time (in seconds) to make the transition from the predecessor, the request
+// independent part of the turn comes from the turn class when there is one
+Cost AutoCost::TransitionCost(const baldr::DirectedEdge* edge,
+                              const baldr::NodeInfo* node,
+                              const EdgeLabel& pred,
+                              const baldr::TurnClass* turn) const {
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   uint32_t idx = pred.opp_local_idx();
   Cost c = base_transition_cost(node, edge, &pred, idx);
-  c.secs = OSRMCarTurnDuration(edge, node, pred.opp_local_idx());
+  c.secs = turn ? OSRMCarTurnDuration(*turn, node)
+                : OSRMCarTurnDuration(edge, node, pred.opp_local_idx());
 
   // Transition time = turncost * stopimpact * densityfactor
   if (edge->stopimpact(idx) > 0 && !shortest_) {
     float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+    if (turn) {
+      turn_cost = kTurnClassCosts[turn->cost_index()];
+    } else if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
       turn_cost = kTCCrossing;
     } else {
       turn_cost = (node->drive_on_right())
@@ -629,15 +717,30 @@ Cost AutoCost::TransitionCostReverse(const uint32_t idx,
                                      const baldr::DirectedEdge* edge,
                                      const bool has_measured_speed,
                                      const InternalTurn internal_turn) const {
+  return TransitionCostReverse(idx, node, pred, edge, has_measured_speed, internal_turn, nullptr);
+}
+
+// The reverse transition cost, the request independent part of the turn comes from the turn
+// class when there is one
+Cost AutoCost::TransitionCostReverse(const uint32_t idx,
+                                     const baldr::NodeInfo* node,
+                                     const baldr::DirectedEdge* pred,
+                                     const baldr::DirectedEdge* edge,
+                                     const bool has_measured_speed,
+                                     const InternalTurn internal_turn,
+                                     const baldr::TurnClass* turn) const {
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   Cost c = base_transition_cost(node, edge, pred, idx);
-  c.secs = OSRMCarTurnDuration(edge, node, pred->opp_local_idx());
+  c.secs = turn ? OSRMCarTurnDuration(*turn, node)
+                : OSRMCarTurnDuration(edge, node, pred->opp_local_idx());
 
   // Transition time = turncost * stopimpact * densityfactor
   if (edge->stopimpact(idx) > 0 && !shortest_) {
     float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+    if (turn) {
+      turn_cost = kTurnClassCosts[turn->cost_index()];
+    } else if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
       turn_cost = kTCCrossing;
     } else {
       turn_cost = (node->drive_on_right())
@@ -720,6 +823,12 @@ cost_ptr_t CreateAutoCost(const Costing& costing_options) {
  */
 class BusCost : public AutoCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(BusCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<BusCost>(*this);
+  }
+
   /**
    * Construct bus costing.
    * Pass in configuration using property tree.
@@ -853,6 +962,12 @@ cost_ptr_t CreateBusCost(const Costing& costing_options) {
  */
 class TaxiCost : public AutoCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(TaxiCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<TaxiCost>(*this);
+  }
+
   /**
    * Construct taxi costing.
    * Pass in costing_options using protocol buffer(pbf).
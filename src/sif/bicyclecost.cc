@@ -225,6 +225,12 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
  */
 class BicycleCost : public DynamicCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(BicycleCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<BicycleCost>(*this);
+  }
+
   /**
    * Construct bicycle costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing specified costing type.
@@ -598,7 +604,7 @@ bool BicycleCost::AllowedReverse(const baldr::DirectedEdge* edge,
 // Returns the cost to traverse the edge and an estimate of the actual time
 // (in seconds) to traverse the edge.
 Cost BicycleCost::EdgeCost(const baldr::DirectedEdge* edge,
-                           const graph_tile_ptr&,
+                           const graph_tile_ptr& tile,
                            const baldr::TimeInfo&,
                            uint8_t&) const {
   // Stairs/steps - high cost (travel speed = 1kph) so they are generally avoided.
@@ -669,9 +675,9 @@ Cost BicycleCost::EdgeCost(const baldr::DirectedEdge* edge,
   }
 
   // Create an edge factor based on total stress (sum of accommodation factor and roadway
-  // stress) and the weighted grade penalty for the edge.
+  // stress) and the grade penalty for the climbs of the edge.
   float factor =
-      1.0f + grade_penalty[edge->weighted_grade()] + (accommodation_factor * roadway_stress);
+      1.0f + grade_penalty[ClimbGrade(edge, tile)] + (accommodation_factor * roadway_stress);
 
   // If surface is worse than the minimum we add a surface factor
   if (edge->surface() >= minimal_surface_penalized_) {
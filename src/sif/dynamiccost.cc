@@ -142,6 +142,19 @@ BaseCostingOptionsConfig::BaseCostingOptionsConfig()
                                                                                       false} {
 }
 
+void ExcludedEdges::set(const baldr::GraphId& edgeid) {
+  const auto tile_id = edgeid.Tile_Base();
+  auto tile = tiles_.begin() + (find(tile_id) - tiles_.cbegin());
+  if (tile == tiles_.end() || tile->first != tile_id) {
+    tile = tiles_.insert(tile, {tile_id, {}});
+  }
+  const uint64_t word = edgeid.id() / 64;
+  if (word >= tile->second.size()) {
+    tile->second.resize(word + 1, 0);
+  }
+  tile->second[word] |= uint64_t(1) << (edgeid.id() % 64);
+}
+
 DynamicCost::DynamicCost(const Costing& costing,
                          const TravelMode mode,
                          uint32_t access_mask,
@@ -171,13 +184,26 @@ DynamicCost::DynamicCost(const Costing& costing,
 
   // Add avoid edges to internal set
   for (auto& edge : costing.options().exclude_edges()) {
-    user_exclude_edges_.insert({GraphId(edge.id()), edge.percent_along()});
+    AddUserAvoidEdge(GraphId(edge.id()), edge.percent_along());
+  }
+
+  // Per edge speeds, penalties and bans, checked to exist when the options were parsed
+  if (!costing.options().edge_table().empty()) {
+    edge_table_ = EdgeTable::get(costing.options().edge_table());
+    if (!edge_table_) {
+      throw std::runtime_error("Edge table " + costing.options().edge_table() + " is gone");
+    }
   }
 }
 
 DynamicCost::~DynamicCost() {
 }
 
+// Costings that do not override this are not copied, the factory creates them for every request.
+std::shared_ptr<DynamicCost> DynamicCost::Clone() const {
+  return nullptr;
+}
+
 // Does the costing method allow multiple passes (with relaxed hierarchy
 // limits). Defaults to false. Costing methods that wish to allow multiple
 // passes with relaxed hierarchy transitions must override this method.
@@ -185,6 +211,12 @@ bool DynamicCost::AllowMultiPass() const {
   return false;
 }
 
+// Whether matrices between the same locations may be mirrored. Defaults to false, costings that
+// respect oneways never allow it.
+bool DynamicCost::AllowSymmetricMatrix() const {
+  return false;
+}
+
 // We provide a convenience method for those algorithms which dont have time components or aren't
 // using them for the current route. Here we just call out to the derived classes costing function
 // with a time that tells the function that we aren't using time. This avoids having to worry about
@@ -214,6 +246,57 @@ Cost DynamicCost::TransitionCostReverse(const uint32_t,
   return {0.0f, 0.0f};
 }
 
+// Allowed, EdgeCost and TransitionCost through the virtual methods, the costing models override
+// this with the non virtual calls of VALHALLA_SIF_EVALUATE_EDGE
+bool DynamicCost::EvaluateEdge(const baldr::DirectedEdge* edge,
+                               const bool is_dest,
+                               const EdgeLabel& pred,
+                               const graph_tile_ptr& tile,
+                               const baldr::GraphId& edgeid,
+                               const baldr::NodeInfo* node,
+                               const baldr::TimeInfo& time_info,
+                               const uint64_t current_time,
+                               const uint32_t tz_index,
+                               EdgeEvaluation& evaluation) const {
+  if (!Allowed(edge, is_dest, pred, tile, edgeid, current_time, tz_index,
+               evaluation.restriction_idx)) {
+    return false;
+  }
+  evaluation.edge_cost = EdgeCost(edge, tile, time_info, evaluation.flow_sources);
+  if (!ApplyEdgeTable(edge, edgeid, evaluation.edge_cost)) {
+    return false;
+  }
+  evaluation.transition_cost = TransitionCost(edge, node, pred);
+  return true;
+}
+
+bool DynamicCost::EvaluateEdgeReverse(const baldr::DirectedEdge* edge,
+                                      const EdgeLabel& pred,
+                                      const baldr::DirectedEdge* opp_edge,
+                                      const graph_tile_ptr& opp_tile,
+                                      const baldr::GraphId& opp_edgeid,
+                                      const baldr::NodeInfo* node,
+                                      const baldr::DirectedEdge* opp_pred_edge,
+                                      const graph_tile_ptr&,
+                                      const baldr::TimeInfo& time_info,
+                                      const uint64_t current_time,
+                                      const uint32_t tz_index,
+                                      EdgeEvaluation& evaluation) const {
+  if (!AllowedReverse(edge, pred, opp_edge, opp_tile, opp_edgeid, current_time, tz_index,
+                      evaluation.restriction_idx)) {
+    return false;
+  }
+  evaluation.edge_cost = EdgeCost(opp_edge, opp_tile, time_info, evaluation.flow_sources);
+  if (!ApplyEdgeTable(opp_edge, opp_edgeid, evaluation.edge_cost)) {
+    return false;
+  }
+  evaluation.transition_cost =
+      TransitionCostReverse(edge->localedgeidx(), node, opp_edge, opp_pred_edge,
+                            static_cast<bool>(evaluation.flow_sources & baldr::kDefaultFlowMask),
+                            pred.internal_turn());
+  return true;
+}
+
 // Returns the transfer cost between 2 transit stops.
 Cost DynamicCost::TransferCost() const {
   return {0.0f, 0.0f};
@@ -316,7 +399,17 @@ bool DynamicCost::IsExcluded(const graph_tile_ptr&, const baldr::NodeInfo*) {
 // Adds a list of edges (GraphIds) to the user specified avoid list.
 void DynamicCost::AddUserAvoidEdges(const std::vector<AvoidEdge>& exclude_edges) {
   for (auto edge : exclude_edges) {
-    user_exclude_edges_.insert({edge.id, edge.percent_along});
+    AddUserAvoidEdge(edge.id, edge.percent_along);
+  }
+}
+
+void DynamicCost::AddUserAvoidEdge(const baldr::GraphId& edgeid, const float percent_along) {
+  if (user_exclude_edges_.get(edgeid)) {
+    return;
+  }
+  user_exclude_edges_.set(edgeid);
+  if (percent_along != 0.f) {
+    user_exclude_percents_.emplace(edgeid, percent_along);
   }
 }
 
@@ -393,6 +486,18 @@ void ParseBaseCostOptions(const rapidjson::Value& json,
   co->set_disable_hierarchy_pruning(
       rapidjson::get<bool>(json, "/disable_hierarchy_pruning", co->disable_hierarchy_pruning()));
 
+  // per edge speeds, penalties and bans
+  co->set_edge_table(rapidjson::get<std::string>(json, "/edge_table", co->edge_table()));
+  if (!co->edge_table().empty()) {
+    std::shared_ptr<const EdgeTable> table;
+    try {
+      table = EdgeTable::get(co->edge_table());
+    } catch (const std::runtime_error& e) { LOG_WARN(e.what()); }
+    if (!table) {
+      throw valhalla_exception_t{145, "'" + co->edge_table() + "'"};
+    }
+  }
+
   // top speed
   JSON_PBF_RANGED_DEFAULT(co, kVehicleSpeedRange, json, "/top_speed", top_speed);
 
@@ -576,5 +681,25 @@ void ParseCosting(const rapidjson::Document& doc,
   costing->set_type(costing_type);
 }
 
+bool HasDefaultOptions(const Costing& costing) {
+  // the options of every costing of a request that specifies none and has no time
+  static const auto defaults = []() {
+    rapidjson::Document doc;
+    doc.SetObject();
+    Options options;
+    ParseCosting(doc, "/costing_options", options);
+    std::unordered_map<int, std::string> defaults;
+    for (auto& costing : *options.mutable_costings()) {
+      auto* co = costing.second.mutable_options();
+      co->set_flow_mask(co->flow_mask() & ~(kPredictedFlowMask | kCurrentFlowMask));
+      defaults.emplace(costing.first, co->SerializeAsString());
+    }
+    return defaults;
+  }();
+
+  auto found = defaults.find(costing.type());
+  return found != defaults.end() && costing.options().SerializeAsString() == found->second;
+}
+
 } // namespace sif
 } // namespace valhalla
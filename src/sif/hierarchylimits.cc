@@ -1,7 +1,97 @@
 #include "sif/hierarchylimits.h"
+#include "baldr/rapidjson_utils.h"
+#include "midgard/logging.h"
 
+#include <mutex>
+#include <stdexcept>
+
+using namespace valhalla::midgard;
 using namespace valhalla::sif;
 
 bool HierarchyLimits::StopExpanding(const float dist) const {
   return (up_transition_count > max_up_transitions && dist > expansion_within_dist);
 }
+
+HierarchyLimitsTable::HierarchyLimitsTable(const std::string& file) {
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(file, pt);
+
+  const uint32_t n_levels = sizeof(kDefaultMaxUpTransitions) / sizeof(kDefaultMaxUpTransitions[0]);
+  for (const auto& region_pt : pt.get_child("regions")) {
+    Region region;
+    region.name = region_pt.second.get<std::string>("name", "");
+    std::vector<double> bbox;
+    for (const auto& coord : region_pt.second.get_child("bbox")) {
+      bbox.push_back(coord.second.get_value<double>());
+    }
+    if (bbox.size() != 4 || bbox[0] > bbox[2] || bbox[1] > bbox[3]) {
+      throw std::runtime_error(file + ": the bbox of region " + region.name +
+                               " is not [minlon, minlat, maxlon, maxlat]");
+    }
+    region.bbox = AABB2<PointLL>(bbox[0], bbox[1], bbox[2], bbox[3]);
+
+    for (const auto& costing_pt : region_pt.second.get_child("costings")) {
+      auto& levels = region.costings[costing_pt.first];
+      for (const auto& level_pt : costing_pt.second) {
+        LevelLimits level{level_pt.second.get<uint32_t>("level"),
+                          level_pt.second.get<uint32_t>("max_up_transitions"),
+                          level_pt.second.get<float>("expansion_within_dist")};
+        if (level.level >= n_levels) {
+          throw std::runtime_error(file + ": region " + region.name + " has limits for level " +
+                                   std::to_string(level.level) + " which does not exist");
+        }
+        levels.push_back(level);
+      }
+    }
+    regions_.push_back(std::move(region));
+  }
+}
+
+std::shared_ptr<const HierarchyLimitsTable> HierarchyLimitsTable::get(const std::string& file) {
+  if (file.empty()) {
+    return nullptr;
+  }
+
+  // the workers of a process share the table of each file
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::weak_ptr<const HierarchyLimitsTable>> instances;
+  std::lock_guard<std::mutex> _(lock);
+  auto table = instances[file].lock();
+  if (!table) {
+    try {
+      table = std::make_shared<const HierarchyLimitsTable>(file);
+      instances[file] = table;
+      LOG_INFO("Using the hierarchy limits of " + std::to_string(table->regions().size()) +
+               " regions from " + file);
+    } catch (const std::exception& e) {
+      LOG_WARN("Not using hierarchy limits from " + file + ": " + std::string(e.what()));
+    }
+  }
+  return table;
+}
+
+const HierarchyLimitsTable::Region*
+HierarchyLimitsTable::Apply(const std::string& costing,
+                            const PointLL& origin,
+                            const PointLL& destination,
+                            std::vector<HierarchyLimits>& limits) const {
+  for (const auto& region : regions_) {
+    if (!region.bbox.Contains(origin) || !region.bbox.Contains(destination)) {
+      continue;
+    }
+    auto found = region.costings.find(costing);
+    if (found == region.costings.cend()) {
+      continue;
+    }
+    for (const auto& level : found->second) {
+      if (level.level >= limits.size() ||
+          limits[level.level].max_up_transitions == kUnlimitedTransitions) {
+        continue;
+      }
+      limits[level.level].max_up_transitions = level.max_up_transitions;
+      limits[level.level].expansion_within_dist = level.expansion_within_dist;
+    }
+    return &region;
+  }
+  return nullptr;
+}
@@ -97,6 +97,12 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
  */
 class MotorcycleCost : public DynamicCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(MotorcycleCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<MotorcycleCost>(*this);
+  }
+
   /**
    * Construct motorcycle costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing specified costing type.
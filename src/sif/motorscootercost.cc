@@ -147,6 +147,12 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
  */
 class MotorScooterCost : public DynamicCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(MotorScooterCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<MotorScooterCost>(*this);
+  }
+
   /**
    * Construct motor scooter costing. Pass in cost type and costing_options using protocol
    * buffer(pbf).
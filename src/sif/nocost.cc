@@ -26,6 +26,10 @@ namespace sif {
  */
 class NoCost : public DynamicCost {
 public:
+  cost_ptr_t Clone() const override {
+    return std::make_shared<NoCost>(*this);
+  }
+
   /**
    * Construct costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing specified costing type.
@@ -192,6 +196,14 @@ public:
     return 1.f;
   }
 
+  /**
+   * Every edge costs its length whichever way it is taken.
+   * @return  Returns true.
+   */
+  virtual bool AllowSymmetricMatrix() const override {
+    return true;
+  }
+
   /**
    * Function to be used in location searching which will
    * exclude and allow ranking results from the search by looking at each
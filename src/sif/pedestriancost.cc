@@ -237,6 +237,12 @@ constexpr float kAvoidHillsStrength[] = {
  */
 class PedestrianCost : public DynamicCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(PedestrianCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<PedestrianCost>(*this);
+  }
+
   /**
    * Construct pedestrian costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing specified costing type.
@@ -257,6 +263,14 @@ public:
     return true;
   }
 
+  /**
+   * Walking ignores oneways and costs an edge the same both ways apart from its grade.
+   * @return  Returns true.
+   */
+  virtual bool AllowSymmetricMatrix() const override {
+    return true;
+  }
+
   /**
    * Returns the maximum transfer distance between stops that you are willing
    * to travel for this mode.  In this case, it is the max walking
@@ -710,7 +724,7 @@ Cost PedestrianCost::EdgeCost(const baldr::DirectedEdge* edge,
 
   // TODO - consider using an array of "use factors" to avoid this conditional
   float factor = 1.0f + kSacScaleCostFactor[static_cast<uint8_t>(edge->sac_scale())] +
-                 grade_penalty[edge->weighted_grade()];
+                 grade_penalty[ClimbGrade(edge, tile)];
   if (edge->use() == Use::kFootway || edge->use() == Use::kSidewalk) {
     factor *= walkway_factor_;
   } else if (edge->use() == Use::kAlley) {
@@ -1,6 +1,8 @@
 #include "sif/recost.h"
 #include "baldr/time_info.h"
 
+#include <algorithm>
+
 namespace valhalla {
 namespace sif {
 
@@ -28,15 +30,34 @@ void recost_forward(baldr::GraphReader& reader,
                     const baldr::TimeInfo& time_info,
                     const bool invariant,
                     const bool ignore_access) {
+  const auto allowed =
+      recost_forward(reader, {&costing}, edge_cb,
+                     [&label_cb](size_t, const EdgeLabel& label) { label_cb(label); }, source_pct,
+                     target_pct, time_info, invariant, ignore_access);
+  if (!allowed.front()) {
+    throw std::runtime_error("This path requires different access than this costing allows");
+  }
+}
+
+std::vector<bool> recost_forward(baldr::GraphReader& reader,
+                                 const std::vector<const sif::DynamicCost*>& costings,
+                                 const EdgeCallback& edge_cb,
+                                 const CostingLabelCallback& label_cb,
+                                 float source_pct,
+                                 float target_pct,
+                                 const baldr::TimeInfo& time_info,
+                                 const bool invariant,
+                                 const bool ignore_access) {
   // out of bounds edge scaling
   if (source_pct < 0.f || source_pct > 1.f || target_pct < 0.f || target_pct > 1.f) {
     throw std::logic_error("Source and target percentages must be between 0 and 1 inclusive");
   }
 
   // grab the first path edge
+  std::vector<bool> allowed(costings.size(), true);
   baldr::GraphId edge_id = edge_cb();
   if (!edge_id.Is_Valid()) {
-    return;
+    return allowed;
   }
 
   // fetch the graph objects
@@ -48,21 +69,26 @@ void recost_forward(baldr::GraphReader& reader,
     throw std::runtime_error("Edge cannot be found");
   }
 
-  // fail if the first edge is filtered
-  if (!ignore_access && costing.Allowed(edge, tile) == 0.f) {
-    throw std::runtime_error("This path requires different edge access than this costing allows");
+  // costings that filter the first edge are done
+  for (size_t i = 0; i < costings.size(); ++i) {
+    allowed[i] = ignore_access || costings[i]->Allowed(edge, tile) != 0.f;
   }
 
   edge = nullptr;
   const baldr::NodeInfo* node = nullptr;
 
-  // keep grabbing edges while we get valid ids
-  EdgeLabel label;
+  // keep grabbing edges while we get valid ids, each costing has its own label and cost
+  std::vector<EdgeLabel> labels(costings.size());
+  std::vector<Cost> costs(costings.size());
   uint32_t predecessor = baldr::kInvalidLabel;
-  Cost cost{};
   double length = 0;
 
   while (edge_id.Is_Valid()) {
+    // no point walking on once every costing is done
+    if (std::find(allowed.begin(), allowed.end(), true) == allowed.end()) {
+      break;
+    }
+
     // get the previous edges node
     node = edge ? reader.nodeinfo(edge->endnode(), tile) : nullptr;
     if (edge && !node) {
@@ -75,34 +101,7 @@ void recost_forward(baldr::GraphReader& reader,
       throw std::runtime_error("Edge cannot be found");
     }
 
-    // re-derive uturns, would have been nice to return this but we dont know the next edge yet
-    label.set_deadend(label.opp_local_idx() == edge->localedgeidx());
-
-    // this node is not allowed, unless we made a uturn at it
-    if (!ignore_access && node && !label.deadend() && !costing.Allowed(node)) {
-      throw std::runtime_error("This path requires different node access than this costing allows");
-    }
-
-    // Update the time information even if time is invariant to account for timezones
-    const auto seconds_offset = invariant ? 0.f : cost.secs;
-    const auto offset_time =
-        node ? time_info.forward(seconds_offset, static_cast<int>(node->timezone())) : time_info;
-
-    // TODO: if this edge begins a restriction, we need to start popping off edges into queue
-    // so that we can find if we reach the end of the restriction. then we need to replay the
-    // queued edges as normal
-    uint8_t time_restrictions_TODO = -1;
-    // if its not time dependent set to 0 for Allowed method below
-    const uint64_t localtime = offset_time.valid ? offset_time.local_time : 0;
-    // we should call 'Allowed' method even if 'ignore_access' flag is true in order to
-    // evaluate time restrictions
     const auto next_id = edge_cb();
-    if (predecessor != baldr::kInvalidLabel &&
-        (!costing.Allowed(edge, !next_id.Is_Valid(), label, tile, edge_id, localtime,
-                          offset_time.timezone_index, time_restrictions_TODO) &&
-         !ignore_access)) {
-      throw std::runtime_error("This path requires different edge access than this costing allows");
-    }
 
     // how much of the edge will we use, trim if its the first or last edge
     float edge_pct = 1.f;
@@ -117,25 +116,66 @@ void recost_forward(baldr::GraphReader& reader,
       edge_pct = std::max(0.f, edge_pct);
     }
 
-    // the cost for traversing this intersection
-    Cost transition_cost = node ? costing.TransitionCost(edge, node, label) : Cost{};
-    // update the cost to the end of this edge
-    uint8_t flow_sources;
-    cost += transition_cost + costing.EdgeCost(edge, tile, offset_time, flow_sources) * edge_pct;
     // update the length to the end of this edge
     length += edge->length() * edge_pct;
-    // construct the label
-
-    InternalTurn turn =
-        node ? costing.TurnType(label.opp_local_idx(), node, edge) : InternalTurn::kNoTurn;
-    label = EdgeLabel(predecessor++, edge_id, edge, cost, cost.cost, 0, costing.travel_mode(), length,
-                      transition_cost, time_restrictions_TODO, !ignore_access,
-                      static_cast<bool>(flow_sources & baldr::kDefaultFlowMask), turn);
-    // hand back the label
-    label_cb(label);
+
+    for (size_t i = 0; i < costings.size(); ++i) {
+      if (!allowed[i]) {
+        continue;
+      }
+      const auto& costing = *costings[i];
+      auto& label = labels[i];
+      auto& cost = costs[i];
+
+      // re-derive uturns, would have been nice to return this but we dont know the next edge yet
+      label.set_deadend(label.opp_local_idx() == edge->localedgeidx());
+
+      // this node is not allowed, unless we made a uturn at it
+      if (!ignore_access && node && !label.deadend() && !costing.Allowed(node)) {
+        allowed[i] = false;
+        continue;
+      }
+
+      // Update the time information even if time is invariant to account for timezones
+      const auto seconds_offset = invariant ? 0.f : cost.secs;
+      const auto offset_time =
+          node ? time_info.forward(seconds_offset, static_cast<int>(node->timezone())) : time_info;
+
+      // TODO: if this edge begins a restriction, we need to start popping off edges into queue
+      // so that we can find if we reach the end of the restriction. then we need to replay the
+      // queued edges as normal
+      uint8_t time_restrictions_TODO = -1;
+      // if its not time dependent set to 0 for Allowed method below
+      const uint64_t localtime = offset_time.valid ? offset_time.local_time : 0;
+      // we should call 'Allowed' method even if 'ignore_access' flag is true in order to
+      // evaluate time restrictions
+      if (predecessor != baldr::kInvalidLabel &&
+          (!costing.Allowed(edge, !next_id.Is_Valid(), label, tile, edge_id, localtime,
+                            offset_time.timezone_index, time_restrictions_TODO) &&
+           !ignore_access)) {
+        allowed[i] = false;
+        continue;
+      }
+
+      // the cost for traversing this intersection
+      Cost transition_cost = node ? costing.TransitionCost(edge, node, label) : Cost{};
+      // update the cost to the end of this edge
+      uint8_t flow_sources;
+      cost += transition_cost + costing.EdgeCost(edge, tile, offset_time, flow_sources) * edge_pct;
+      // construct the label
+      InternalTurn turn =
+          node ? costing.TurnType(label.opp_local_idx(), node, edge) : InternalTurn::kNoTurn;
+      label = EdgeLabel(predecessor, edge_id, edge, cost, cost.cost, 0, costing.travel_mode(),
+                        length, transition_cost, time_restrictions_TODO, !ignore_access,
+                        static_cast<bool>(flow_sources & baldr::kDefaultFlowMask), turn);
+      // hand back the label
+      label_cb(i, label);
+    }
     // next edge
+    ++predecessor;
     edge_id = next_id;
   }
+  return allowed;
 }
 
 } // namespace sif
@@ -58,6 +58,10 @@ constexpr ranged_default_t<float> kTransferPenaltyRange{0, kDefaultTransferPenal
  */
 class TransitCost : public DynamicCost {
 public:
+  cost_ptr_t Clone() const override {
+    return std::make_shared<TransitCost>(*this);
+  }
+
   /**
    * Construct transit costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing specified costing type.
@@ -63,6 +63,10 @@ constexpr float kLeftSideTurnCosts[] = {kTCStraight,         kTCSlight,  kTCUnfa
                                         kTCUnfavorableSharp, kTCReverse, kTCFavorableSharp,
                                         kTCFavorable,        kTCSlight};
 
+// Turn costs by turn class, see TurnClass::cost_index
+constexpr auto kTurnClassCosts =
+    TurnClassCosts(kRightSideTurnCosts, kLeftSideTurnCosts, kTCCrossing);
+
 // How much to favor truck routes.
 constexpr float kTruckRouteFactor = 0.85f;
 
@@ -116,6 +120,12 @@ const BaseCostingOptionsConfig kBaseCostOptsConfig = GetBaseCostOptsConfig();
  */
 class TruckCost : public DynamicCost {
 public:
+  VALHALLA_SIF_EVALUATE_EDGE(TruckCost)
+
+  cost_ptr_t Clone() const override {
+    return std::make_shared<TruckCost>(*this);
+  }
+
   /**
    * Construct truck costing. Pass in cost type and costing_options using protocol buffer(pbf).
    * @param  costing specified costing type.
@@ -222,6 +232,15 @@ public:
                         const baldr::TimeInfo& time_info,
                         uint8_t& flow_sources) const override;
 
+  /**
+   * Get the cost to traverse the specified directed edge without looking at the default edge
+   * costs of the tile.
+   */
+  Cost ComputeEdgeCost(const baldr::DirectedEdge* edge,
+                       const graph_tile_ptr& tile,
+                       const baldr::TimeInfo& time_info,
+                       uint8_t& flow_sources) const;
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -235,6 +254,22 @@ public:
                               const baldr::NodeInfo* node,
                               const EdgeLabel& pred) const override;
 
+  static constexpr bool kTurnClasses = true;
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge, looking the turn up in
+   * its turn class when the tile has them.
+   * @param  edge  Directed edge (the to edge)
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  Predecessor edge information.
+   * @param  turn  Turn class of the transition, null to work the turn out from the edge and node.
+   * @return  Returns the cost and time (seconds)
+   */
+  Cost TransitionCost(const baldr::DirectedEdge* edge,
+                      const baldr::NodeInfo* node,
+                      const EdgeLabel& pred,
+                      const baldr::TurnClass* turn) const;
+
   /**
    * Returns the cost to make the transition from the predecessor edge
    * when using a reverse search (from destination towards the origin).
@@ -253,6 +288,26 @@ public:
                                      const bool has_measured_speed,
                                      const InternalTurn internal_turn) const override;
 
+  /**
+   * Returns the cost to make the transition from the predecessor edge when using a reverse
+   * search, looking the turn up in its turn class when the tile has them.
+   * @param  idx   Directed edge local index
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  the opposing current edge in the reverse tree.
+   * @param  edge  the opposing predecessor in the reverse tree
+   * @param  has_measured_speed Do we have any of the measured speed types set?
+   * @param  internal_turn  Did we make an turn on a short internal edge.
+   * @param  turn  Turn class of the transition, null to work the turn out from the edges and node.
+   * @return  Returns the cost and time (seconds)
+   */
+  Cost TransitionCostReverse(const uint32_t idx,
+                             const baldr::NodeInfo* node,
+                             const baldr::DirectedEdge* pred,
+                             const baldr::DirectedEdge* edge,
+                             const bool has_measured_speed,
+                             const InternalTurn internal_turn,
+                             const baldr::TurnClass* turn) const;
+
   /**
    * Get the cost factor for A* heuristics. This factor is multiplied
    * with the distance to the destination to produce an estimate of the
@@ -361,6 +416,12 @@ TruckCost::TruckCost(const Costing& costing)
   for (uint32_t d = 0; d < 16; d++) {
     density_factor_[d] = 0.85f + (d * 0.025f);
   }
+
+  // Requests with the default options share the edge costs their tiles keep
+  if (DefaultEdgeCosts::enabled() && costing.type() == Costing::truck &&
+      HasDefaultOptions(costing)) {
+    default_edge_costs_ = DefaultEdgeCosts::kTruck;
+  }
 }
 
 // Destructor
@@ -473,6 +534,21 @@ Cost TruckCost::EdgeCost(const baldr::DirectedEdge* edge,
                          const graph_tile_ptr& tile,
                          const baldr::TimeInfo& time_info,
                          uint8_t& flow_sources) const {
+  const auto* cached =
+      DefaultEdgeCost(edge, tile, time_info, [&](const DirectedEdge* e, uint8_t& sources) {
+        return ComputeEdgeCost(e, tile, time_info, sources);
+      });
+  if (cached) {
+    flow_sources = cached->flow_sources;
+    return {cached->cost, cached->secs};
+  }
+  return ComputeEdgeCost(edge, tile, time_info, flow_sources);
+}
+
+Cost TruckCost::ComputeEdgeCost(const baldr::DirectedEdge* edge,
+                                const graph_tile_ptr& tile,
+                                const baldr::TimeInfo& time_info,
+                                uint8_t& flow_sources) const {
   auto edge_speed = fixed_speed_ == baldr::kDisableFixedSpeed
                         ? tile->GetSpeed(edge, flow_mask_, time_info.second_of_week, true,
                                          &flow_sources, time_info.seconds_from_now)
@@ -530,11 +606,20 @@ Cost TruckCost::EdgeCost(const baldr::DirectedEdge* edge,
 Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
                                const baldr::NodeInfo* node,
                                const EdgeLabel& pred) const {
+  return TransitionCost(edge, node, pred, nullptr);
+}
+
+// Returns the time (in seconds) to make the transition from the predecessor, the request
+// independent part of the turn comes from the turn class when there is one
+Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
+                               const baldr::NodeInfo* node,
+                               const EdgeLabel& pred,
+                               const baldr::TurnClass* turn) const {
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   uint32_t idx = pred.opp_local_idx();
   Cost c = base_transition_cost(node, edge, &pred, idx);
-  c.secs = OSRMCarTurnDuration(edge, node, idx);
+  c.secs = turn ? OSRMCarTurnDuration(*turn, node) : OSRMCarTurnDuration(edge, node, idx);
 
   // Penalty to transition onto low class roads.
   if (edge->classification() == baldr::RoadClass::kResidential ||
@@ -545,7 +630,9 @@ Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
   // Transition time = turncost * stopimpact * densityfactor
   if (edge->stopimpact(idx) > 0 && !shortest_) {
     float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+    if (turn) {
+      turn_cost = kTurnClassCosts[turn->cost_index()];
+    } else if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
       turn_cost = kTCCrossing;
     } else {
       turn_cost = (node->drive_on_right())
@@ -601,13 +688,26 @@ Cost TruckCost::TransitionCostReverse(const uint32_t idx,
                                       const baldr::DirectedEdge* edge,
                                       const bool has_measured_speed,
                                       const InternalTurn internal_turn) const {
+  return TransitionCostReverse(idx, node, pred, edge, has_measured_speed, internal_turn, nullptr);
+}
+
+// The reverse transition cost, the request independent part of the turn comes from the turn
+// class when there is one
+Cost TruckCost::TransitionCostReverse(const uint32_t idx,
+                                      const baldr::NodeInfo* node,
+                                      const baldr::DirectedEdge* pred,
+                                      const baldr::DirectedEdge* edge,
+                                      const bool has_measured_speed,
+                                      const InternalTurn internal_turn,
+                                      const baldr::TurnClass* turn) const {
 
   // TODO: do we want to update the cost if we have flow or speed from traffic.
 
   // Get the transition cost for country crossing, ferry, gate, toll booth,
   // destination only, alley, maneuver penalty
   Cost c = base_transition_cost(node, edge, pred, idx);
-  c.secs = OSRMCarTurnDuration(edge, node, pred->opp_local_idx());
+  c.secs = turn ? OSRMCarTurnDuration(*turn, node)
+                : OSRMCarTurnDuration(edge, node, pred->opp_local_idx());
 
   // Penalty to transition onto low class roads.
   if (edge->classification() == baldr::RoadClass::kResidential ||
@@ -618,7 +718,9 @@ Cost TruckCost::TransitionCostReverse(const uint32_t idx,
   // Transition time = turncost * stopimpact * densityfactor
   if (edge->stopimpact(idx) > 0 && !shortest_) {
     float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+    if (turn) {
+      turn_cost = kTurnClassCosts[turn->cost_index()];
+    } else if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
       turn_cost = kTCCrossing;
     } else {
       turn_cost = (node->drive_on_right())
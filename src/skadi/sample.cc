@@ -1,5 +1,8 @@
 #include "skadi/sample.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <fstream>
@@ -10,6 +13,7 @@
 #include <regex>
 #include <set>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 
 #include <lz4frame.h>
@@ -22,6 +26,18 @@
 #include "midgard/sequence.h"
 #include "valhalla/baldr/curl_tilegetter.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SAMPLE_KERNEL_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SAMPLE_KERNEL_AVX2
+#define SAMPLE_KERNEL_AVX2_DISPATCH
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SAMPLE_KERNEL_NEON
+#endif
+
 namespace {
 // srtmgl1 holds 1x1 degree tiles but oversamples the edge of the tile
 // by .5 seconds on all sides. that means that the center of pixel 0 is
@@ -35,6 +51,7 @@ constexpr int16_t NO_DATA_HIGH = 16384;
 constexpr int16_t NO_DATA_LOW = -16384;
 constexpr size_t TILE_COUNT = 180 * 360;
 constexpr int8_t UNPACKED_TILES_COUNT = 50;
+constexpr size_t CACHE_STRIPES = 64;
 
 // macro is faster than inline function for this...
 #define out_of_range(v) v > NO_DATA_HIGH || v < NO_DATA_LOW
@@ -43,6 +60,249 @@ int16_t flip(int16_t value) {
   return ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
 }
 
+// bilinear interpolation of the 4 pixels around the fractional pixel u, v. pixels without data get
+// no weight and the others are weighted up to make up for them
+double interpolate(const int16_t* data, double u, double v) {
+  // integer pixel
+  size_t x = std::floor(u);
+  size_t y = std::floor(v);
+
+  // coefficients
+  double u_ratio = u - x;
+  double v_ratio = v - y;
+  double u_inv = 1 - u_ratio;
+  double v_inv = 1 - v_ratio;
+  double a_coef = u_inv * v_inv;
+  double b_coef = u_ratio * v_inv;
+  double c_coef = u_inv * v_ratio;
+  double d_coef = u_ratio * v_ratio;
+
+  // values
+  double adjust = 0;
+  auto a = flip(data[y * HGT_DIM + x]);
+  auto b = flip(data[y * HGT_DIM + x + 1]);
+  if (out_of_range(a)) {
+    a_coef = 0;
+  }
+  if (out_of_range(b)) {
+    b_coef = 0;
+  }
+
+  // first part of the bilinear interpolation
+  auto value = a * a_coef + b * b_coef;
+  adjust += a_coef + b_coef;
+  // LOG_INFO('{' + std::to_string(y * HGT_DIM + x) + ',' + std::to_string(a) + '}');
+  // LOG_INFO('{' + std::to_string(y * HGT_DIM + x + 1) + ',' + std::to_string(b) + '}');
+  // only need the second part if you aren't right on the row
+  // this also protects from a corner case where you sample past the end of the image
+  if (y < HGT_DIM - 1) {
+    auto c = flip(data[(y + 1) * HGT_DIM + x]);
+    auto d = flip(data[(y + 1) * HGT_DIM + x + 1]);
+    if (out_of_range(c)) {
+      c_coef = 0;
+    }
+    if (out_of_range(d)) {
+      d_coef = 0;
+    }
+    // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x) + ',' + std::to_string(c) + '}');
+    // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x + 1) + ',' + std::to_string(d) + '}');
+    value += c * c_coef + d * d_coef;
+    adjust += c_coef + d_coef;
+  }
+  // if we are missing everything then give up
+  if (adjust == 0) {
+    return NO_DATA_VALUE;
+  }
+  // if we were missing some we need to adjust by that
+  return value / adjust;
+}
+
+// The kernels below interpolate many points of one tile, point i is at the fractional pixel
+// us[i], vs[i]. They follow interpolate operation by operation
+void interpolate_scalar(const int16_t* data,
+                        const double* us,
+                        const double* vs,
+                        size_t begin,
+                        size_t count,
+                        double* values) {
+  for (size_t i = begin; i < count; ++i) {
+    values[i] = interpolate(data, us[i], vs[i]);
+  }
+}
+
+#ifdef SAMPLE_KERNEL_AVX2
+#ifdef SAMPLE_KERNEL_AVX2_DISPATCH
+#define SAMPLE_KERNEL_TARGET __attribute__((target("avx2")))
+#else
+#define SAMPLE_KERNEL_TARGET
+#endif
+
+// half h of 8 ints as 4 doubles
+SAMPLE_KERNEL_TARGET inline __m256d half_to_pd(__m256i v, int h) {
+  return _mm256_cvtepi32_pd(h ? _mm256_extracti128_si256(v, 1) : _mm256_castsi256_si128(v));
+}
+
+// half h of 8 int masks as 4 double masks
+SAMPLE_KERNEL_TARGET inline __m256d half_mask_pd(__m256i m, int h) {
+  return _mm256_castsi256_pd(
+      _mm256_cvtepi32_epi64(h ? _mm256_extracti128_si256(m, 1) : _mm256_castsi256_si128(m)));
+}
+
+// all bits set where the pixel has data
+SAMPLE_KERNEL_TARGET inline __m256i has_data(__m256i p) {
+  const __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(p, _mm256_set1_epi32(NO_DATA_HIGH)),
+                                      _mm256_cmpgt_epi32(_mm256_set1_epi32(NO_DATA_LOW), p));
+  return _mm256_xor_si256(out, _mm256_set1_epi32(-1));
+}
+
+SAMPLE_KERNEL_TARGET void interpolate_avx2(const int16_t* data,
+                                           const double* us,
+                                           const double* vs,
+                                           size_t count,
+                                           double* values) {
+  // the pixels are big endian
+  const __m256i swap_bytes = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                              1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  const __m256i dim = _mm256_set1_epi32(HGT_DIM);
+  const __m256i last_row = _mm256_set1_epi32(HGT_DIM - 1);
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d no_data = _mm256_set1_pd(NO_DATA_VALUE);
+  const int* words = reinterpret_cast<const int*>(data);
+
+  // 8 points at a time, the rest is left to the scalar loop
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256d u[2] = {_mm256_loadu_pd(us + i), _mm256_loadu_pd(us + i + 4)};
+    const __m256d v[2] = {_mm256_loadu_pd(vs + i), _mm256_loadu_pd(vs + i + 4)};
+    const __m256d x[2] = {_mm256_floor_pd(u[0]), _mm256_floor_pd(u[1])};
+    const __m256d y[2] = {_mm256_floor_pd(v[0]), _mm256_floor_pd(v[1])};
+    const __m256i xi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(x[0])),
+                                               _mm256_cvttpd_epi32(x[1]), 1);
+    const __m256i yi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(y[0])),
+                                               _mm256_cvttpd_epi32(y[1]), 1);
+
+    // a and its right neighbour b come in one 32 bit load, c and d likewise from the row below.
+    // the last row has no row below it, there we load its own pixels again and give them no weight
+    const __m256i below = _mm256_cmpgt_epi32(last_row, yi);
+    const __m256i top = _mm256_add_epi32(_mm256_mullo_epi32(yi, dim), xi);
+    const __m256i bottom = _mm256_add_epi32(top, _mm256_and_si256(below, dim));
+    const __m256i ab = _mm256_shuffle_epi8(_mm256_i32gather_epi32(words, top, 2), swap_bytes);
+    const __m256i cd = _mm256_shuffle_epi8(_mm256_i32gather_epi32(words, bottom, 2), swap_bytes);
+    const __m256i a = _mm256_srai_epi32(_mm256_slli_epi32(ab, 16), 16);
+    const __m256i b = _mm256_srai_epi32(ab, 16);
+    const __m256i c = _mm256_srai_epi32(_mm256_slli_epi32(cd, 16), 16);
+    const __m256i d = _mm256_srai_epi32(cd, 16);
+    const __m256i a_valid = has_data(a);
+    const __m256i b_valid = has_data(b);
+    const __m256i c_valid = _mm256_and_si256(has_data(c), below);
+    const __m256i d_valid = _mm256_and_si256(has_data(d), below);
+
+    for (int h = 0; h < 2; ++h) {
+      const __m256d u_ratio = _mm256_sub_pd(u[h], x[h]);
+      const __m256d v_ratio = _mm256_sub_pd(v[h], y[h]);
+      const __m256d u_inv = _mm256_sub_pd(one, u_ratio);
+      const __m256d v_inv = _mm256_sub_pd(one, v_ratio);
+      const __m256d a_coef = _mm256_and_pd(half_mask_pd(a_valid, h), _mm256_mul_pd(u_inv, v_inv));
+      const __m256d b_coef = _mm256_and_pd(half_mask_pd(b_valid, h), _mm256_mul_pd(u_ratio, v_inv));
+      const __m256d c_coef = _mm256_and_pd(half_mask_pd(c_valid, h), _mm256_mul_pd(u_inv, v_ratio));
+      const __m256d d_coef =
+          _mm256_and_pd(half_mask_pd(d_valid, h), _mm256_mul_pd(u_ratio, v_ratio));
+
+      const __m256d value =
+          _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(half_to_pd(a, h), a_coef),
+                                      _mm256_mul_pd(half_to_pd(b, h), b_coef)),
+                        _mm256_add_pd(_mm256_mul_pd(half_to_pd(c, h), c_coef),
+                                      _mm256_mul_pd(half_to_pd(d, h), d_coef)));
+      const __m256d adjust =
+          _mm256_add_pd(_mm256_add_pd(a_coef, b_coef), _mm256_add_pd(c_coef, d_coef));
+      const __m256d missing = _mm256_cmp_pd(adjust, zero, _CMP_EQ_OQ);
+      _mm256_storeu_pd(values + i + 4 * h,
+                       _mm256_blendv_pd(_mm256_div_pd(value, adjust), no_data, missing));
+    }
+  }
+  interpolate_scalar(data, us, vs, i, count, values);
+}
+#endif
+
+#ifdef SAMPLE_KERNEL_NEON
+void interpolate_neon(const int16_t* data,
+                      const double* us,
+                      const double* vs,
+                      size_t count,
+                      double* values) {
+  const float64x2_t one = vdupq_n_f64(1.0);
+  const float64x2_t zero = vdupq_n_f64(0.0);
+  const float64x2_t no_data = vdupq_n_f64(NO_DATA_VALUE);
+
+  // there is no gather, the pixels are loaded one by one and only the math is done in lanes
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float64x2_t u = vld1q_f64(us + i);
+    const float64x2_t v = vld1q_f64(vs + i);
+    const float64x2_t x = vrndmq_f64(u);
+    const float64x2_t y = vrndmq_f64(v);
+    double pixels[4][2], weights[4][2];
+    for (size_t l = 0; l < 2; ++l) {
+      const size_t px = static_cast<size_t>(x[l]);
+      const size_t py = static_cast<size_t>(y[l]);
+      const size_t below = py < HGT_DIM - 1 ? HGT_DIM : 0;
+      const int16_t corners[4] = {flip(data[py * HGT_DIM + px]), flip(data[py * HGT_DIM + px + 1]),
+                                  flip(data[py * HGT_DIM + below + px]),
+                                  flip(data[py * HGT_DIM + below + px + 1])};
+      for (size_t k = 0; k < 4; ++k) {
+        pixels[k][l] = corners[k];
+        weights[k][l] = (out_of_range(corners[k])) || (k > 1 && !below) ? 0.0 : 1.0;
+      }
+    }
+
+    const float64x2_t u_ratio = vsubq_f64(u, x);
+    const float64x2_t v_ratio = vsubq_f64(v, y);
+    const float64x2_t u_inv = vsubq_f64(one, u_ratio);
+    const float64x2_t v_inv = vsubq_f64(one, v_ratio);
+    const float64x2_t a_coef = vmulq_f64(vld1q_f64(weights[0]), vmulq_f64(u_inv, v_inv));
+    const float64x2_t b_coef = vmulq_f64(vld1q_f64(weights[1]), vmulq_f64(u_ratio, v_inv));
+    const float64x2_t c_coef = vmulq_f64(vld1q_f64(weights[2]), vmulq_f64(u_inv, v_ratio));
+    const float64x2_t d_coef = vmulq_f64(vld1q_f64(weights[3]), vmulq_f64(u_ratio, v_ratio));
+
+    const float64x2_t value = vaddq_f64(vaddq_f64(vmulq_f64(vld1q_f64(pixels[0]), a_coef),
+                                                  vmulq_f64(vld1q_f64(pixels[1]), b_coef)),
+                                        vaddq_f64(vmulq_f64(vld1q_f64(pixels[2]), c_coef),
+                                                  vmulq_f64(vld1q_f64(pixels[3]), d_coef)));
+    const float64x2_t adjust = vaddq_f64(vaddq_f64(a_coef, b_coef), vaddq_f64(c_coef, d_coef));
+    const uint64x2_t missing = vceqq_f64(adjust, zero);
+    vst1q_f64(values + i, vbslq_f64(missing, no_data, vdivq_f64(value, adjust)));
+  }
+  interpolate_scalar(data, us, vs, i, count, values);
+}
+#endif
+
+void interpolate_fallback(const int16_t* data,
+                          const double* us,
+                          const double* vs,
+                          size_t count,
+                          double* values) {
+  interpolate_scalar(data, us, vs, 0, count, values);
+}
+
+using interpolate_t = void (*)(const int16_t*, const double*, const double*, size_t, double*);
+
+// Pick the widest kernel this machine can run, only x86 builds without -mavx2 need to check
+interpolate_t select_interpolate() {
+#if defined(SAMPLE_KERNEL_AVX2_DISPATCH)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? interpolate_avx2 : interpolate_fallback;
+#elif defined(SAMPLE_KERNEL_AVX2)
+  return interpolate_avx2;
+#elif defined(SAMPLE_KERNEL_NEON)
+  return interpolate_neon;
+#else
+  return interpolate_fallback;
+#endif
+}
+
+const interpolate_t interpolate_kernel = select_interpolate();
+
 uint64_t file_size(const std::string& file_name) {
   // TODO: detect gzip and actually validate the uncompressed size?
   struct stat s {};
@@ -61,13 +321,17 @@ class cache_item_t {
 private:
   format_t format;
   valhalla::midgard::mem_map<char> data;
-  int usages;
+  std::atomic<int> usages;
+  std::atomic<uint64_t> last_used;
   const char* unpacked;
 
 public:
-  cache_item_t() : format(format_t::UNKNOWN), usages(0), unpacked(nullptr) {
+  cache_item_t() : format(format_t::UNKNOWN), usages(0), last_used(0), unpacked(nullptr) {
+  }
+  cache_item_t(cache_item_t&& other)
+      : format(other.format), data(std::move(other.data)), usages(other.usages.load()),
+        last_used(other.last_used.load()), unpacked(other.detach_unpacked()) {
   }
-  cache_item_t(cache_item_t&&) = default;
   ~cache_item_t() {
     free((void*)unpacked);
   }
@@ -90,10 +354,14 @@ public:
     return format;
   }
 
-  inline int& get_usages() {
+  inline std::atomic<int>& get_usages() {
     return usages;
   }
 
+  inline std::atomic<uint64_t>& get_last_used() {
+    return last_used;
+  }
+
   inline const char* get_unpacked() {
     return unpacked;
   }
@@ -224,81 +492,50 @@ public:
   }
 
   double get(double u, double v) const {
-    // integer pixel
-    size_t x = std::floor(u);
-    size_t y = std::floor(v);
-
-    // coefficients
-    double u_ratio = u - x;
-    double v_ratio = v - y;
-    double u_inv = 1 - u_ratio;
-    double v_inv = 1 - v_ratio;
-    double a_coef = u_inv * v_inv;
-    double b_coef = u_ratio * v_inv;
-    double c_coef = u_inv * v_ratio;
-    double d_coef = u_ratio * v_ratio;
-
-    // values
-    double adjust = 0;
-    auto a = flip(data[y * HGT_DIM + x]);
-    auto b = flip(data[y * HGT_DIM + x + 1]);
-    if (out_of_range(a)) {
-      a_coef = 0;
-    }
-    if (out_of_range(b)) {
-      b_coef = 0;
-    }
+    return interpolate(data, u, v);
+  }
 
-    // first part of the bilinear interpolation
-    auto value = a * a_coef + b * b_coef;
-    adjust += a_coef + b_coef;
-    // LOG_INFO('{' + std::to_string(y * HGT_DIM + x) + ',' + std::to_string(a) + '}');
-    // LOG_INFO('{' + std::to_string(y * HGT_DIM + x + 1) + ',' + std::to_string(b) + '}');
-    // only need the second part if you aren't right on the row
-    // this also protects from a corner case where you sample past the end of the image
-    if (y < HGT_DIM - 1) {
-      auto c = flip(data[(y + 1) * HGT_DIM + x]);
-      auto d = flip(data[(y + 1) * HGT_DIM + x + 1]);
-      if (out_of_range(c)) {
-        c_coef = 0;
-      }
-      if (out_of_range(d)) {
-        d_coef = 0;
-      }
-      // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x) + ',' + std::to_string(c) + '}');
-      // LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x + 1) + ',' + std::to_string(d) + '}');
-      value += c * c_coef + d * d_coef;
-      adjust += c_coef + d_coef;
-    }
-    // if we are missing everything then give up
-    if (adjust == 0) {
-      return get_no_data_value();
-    }
-    // if we were missing some we need to adjust by that
-    return value / adjust;
+  // the points at fractional pixels us[i], vs[i] of the tile at once
+  void get_all(const double* us, const double* vs, size_t count, double* values) const {
+    interpolate_kernel(data, us, vs, count, values);
   }
 };
 
 struct cache_t {
+  // A lock and the unpack jobs of the tiles whose index falls into it, lookups of tiles in
+  // different stripes do not wait on each other
+  struct stripe_t {
+    std::mutex mutex;
+    // Map of pending tiles. No matter how many requests received, only one inflate job per tile
+    // started.
+    std::unordered_map<uint16_t, std::shared_future<tile_data>> pending_tiles;
+  };
+
   // Cached tiles
   std::vector<cache_item_t> cache;
-  // Set of reusable tile indexes
-  std::unordered_set<uint16_t> reusable;
-  // Map of pending tiles. No matter how many requests received, only one inflate job per tile
-  // started.
-  std::unordered_map<uint16_t, std::shared_future<tile_data>> pending_tiles;
-  // Guards access to the pending_tiles
-  std::recursive_mutex mutex;
+  // Guards the cached tiles, each by the stripe of its index
+  std::array<stripe_t, CACHE_STRIPES> stripes;
+  // Indexes of the unpacked tiles whose memory is reused, only taken to unpack a tile
+  std::vector<uint16_t> reusable;
+  std::mutex reusable_mutex;
+  // Orders the uses of unpacked tiles, the least recently used is reused first
+  std::atomic<uint64_t> clock{0};
   // Elevation tile path
   std::string data_source;
+  // Where compressed tiles are stored raw once unpacked so they can be mapped from then on
+  std::string raw_dir;
 
+  stripe_t& stripe(uint16_t index) {
+    return stripes[index % CACHE_STRIPES];
+  }
+
+  // tile data hands out unpacked memory under the lock of the stripe and only gives it back
+  // without it, memory is only reused when nobody uses it under the lock of its stripe
   void increment_usages(uint16_t index) {
-    std::lock_guard<std::recursive_mutex> lock(mutex);
     cache[index].get_usages()++;
   }
 
   void decrement_usages(uint16_t index) {
-    std::lock_guard<std::recursive_mutex> lock(mutex);
     cache[index].get_usages()--;
   }
 
@@ -311,13 +548,20 @@ struct cache_t {
   bool insert(size_t pos, const std::string& path, format_t format);
 
   tile_data source(uint16_t index);
+
+  // memory for a tile to unpack into, the least recently used unpacked tile nobody uses gives
+  // up its memory once there are enough of them
+  const char* reuse_unpacked(uint16_t index);
+
+  // keep the unpacked tile raw in the raw_dir and map it from there
+  void store_raw(uint16_t index, const char* unpacked);
 };
 
 bool cache_t::insert(size_t pos, const std::string& path, format_t format) {
   if (pos >= cache.size())
     return false;
 
-  std::lock_guard<std::recursive_mutex> lock(mutex);
+  std::lock_guard<std::mutex> lock(stripe(pos).mutex);
   return cache[pos].init(path, format);
 }
 
@@ -329,6 +573,8 @@ tile_data cache_t::source(uint16_t index) {
 
   // if we don't have anything maybe it's lazy loaded
   auto& item = cache[index];
+  auto& s = stripe(index);
+  std::unique_lock<std::mutex> lock(s.mutex);
   if (item.get_data() == nullptr) {
     auto f = data_source + get_hgt_file_name(index);
     item.init(f, format_t::RAW);
@@ -344,51 +590,76 @@ tile_data cache_t::source(uint16_t index) {
     return {this, index, false, (const int16_t*)item.get_data()};
   }
 
-  // we were able to load it but the format wasn't RAW, which only leaves compressed formats
-  mutex.lock();
-  auto it = pending_tiles.find(index);
-  if (it != pending_tiles.end()) {
+  // we were able to load it but the format wasn't RAW, which only leaves compressed formats. if
+  // another thread is unpacking it we wait for that instead of unpacking it again
+  auto it = s.pending_tiles.find(index);
+  if (it != s.pending_tiles.end()) {
     auto future = it->second;
-    mutex.unlock();
+    lock.unlock();
     return future.get();
   }
 
-  // item in cache is already unpacked
+  // item in cache is already unpacked, it is now the most recently used
   const char* unpacked = item.get_unpacked();
   if (unpacked) {
-    auto rv = tile_data(this, index, true, (const int16_t*)unpacked);
-    mutex.unlock();
-    return rv;
+    item.get_last_used() = ++clock;
+    return {this, index, true, (const int16_t*)unpacked};
   }
 
   std::promise<tile_data> promise;
-  it = pending_tiles.emplace(index, promise.get_future()).first;
+  s.pending_tiles.emplace(index, promise.get_future());
+  lock.unlock();
+
+  // unpack without holding the lock so other threads can sample or unpack other tiles
+  unpacked = reuse_unpacked(index);
+  lock.lock();
+  item.get_last_used() = ++clock;
+  auto rv = tile_data(this, index, true, (const int16_t*)unpacked);
+  lock.unlock();
+  if (!item.unpack(unpacked)) {
+    rv = tile_data();
+  } else if (!raw_dir.empty()) {
+    store_raw(index, unpacked);
+  }
 
+  lock.lock();
+  promise.set_value(rv);
+  s.pending_tiles.erase(index);
+  return rv;
+}
+
+const char* cache_t::reuse_unpacked(uint16_t index) {
+  std::lock_guard<std::mutex> reusable_lock(reusable_mutex);
+  const char* unpacked = nullptr;
   if (reusable.size() >= UNPACKED_TILES_COUNT) {
-    for (auto i : reusable) {
-      if (cache[i].get_usages() <= 0) {
+    std::sort(reusable.begin(), reusable.end(), [this](uint16_t a, uint16_t b) {
+      return cache[a].get_last_used() < cache[b].get_last_used();
+    });
+    for (auto i = reusable.begin(); i != reusable.end(); ++i) {
+      std::lock_guard<std::mutex> lock(stripe(*i).mutex);
+      if (cache[*i].get_usages() <= 0) {
+        unpacked = cache[*i].detach_unpacked();
         reusable.erase(i);
-        unpacked = cache[i].detach_unpacked();
         break;
       }
     }
   }
-  if (!unpacked) {
-    unpacked = (char*)malloc(HGT_BYTES);
-  }
-  reusable.insert(index);
-  auto rv = tile_data(this, index, true, (const int16_t*)unpacked);
-  mutex.unlock();
+  reusable.push_back(index);
+  return unpacked ? unpacked : (const char*)malloc(HGT_BYTES);
+}
 
-  if (!item.unpack(unpacked)) {
-    rv = tile_data();
+void cache_t::store_raw(uint16_t index, const char* unpacked) {
+  auto path = raw_dir + get_hgt_file_name(index);
+  if (!filesystem::save(path, std::string_view(unpacked, HGT_BYTES))) {
+    LOG_WARN("Could not store the unpacked elevation tile " + path);
+    return;
   }
 
-  mutex.lock();
-  promise.set_value(rv);
-  pending_tiles.erase(it);
-  mutex.unlock();
-  return rv;
+  // the unpacked memory stays with the item until it is reused
+  std::lock_guard<std::mutex> lock(stripe(index).mutex);
+  if (!cache[index].init(path, format_t::RAW)) {
+    LOG_WARN("Could not map the unpacked elevation tile " + path);
+  }
 }
 
 tile_data::tile_data(cache_t* c, uint16_t index, bool reusable, const int16_t* data)
@@ -428,6 +699,22 @@ sample::sample(const boost::property_tree::ptree& pt)
 
   // this line used only for testing, for more details check elevation_builder.cc
   remote_path_ = pt.get<std::string>("additional_data.elevation_dir", "");
+
+  // compressed tiles are kept raw once they were unpacked, the ones that were before are mapped
+  // from there right away
+  cache_->raw_dir = pt.get<std::string>("additional_data.elevation_raw_dir", "");
+  while (cache_->raw_dir.size() &&
+         cache_->raw_dir.back() == filesystem::path::preferred_separator) {
+    cache_->raw_dir.pop_back();
+  }
+  if (!cache_->raw_dir.empty() && cache_->size() > 0 && filesystem::exists(cache_->raw_dir)) {
+    for (const auto& f : filesystem::get_files(cache_->raw_dir)) {
+      auto data = cache_item_t::parse_hgt_name(f);
+      if (data && data->second == format_t::RAW && !cache_->insert(data->first, f, data->second)) {
+        LOG_WARN("Corrupt raw elevation data: " + f);
+      }
+    }
+  }
 }
 
 sample::sample(const std::string& data_source) {
@@ -445,12 +732,10 @@ template <class coord_t> double sample::get(const coord_t& coord, tile_data& til
   auto lat = std::floor(coord.second);
   auto index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
 
-  // the caller can pass a cached tile, so we only fetch one if its not the one they already have
+  // the caller can pass a cached tile, so we only fetch one if its not the one they already have.
+  // the cache is shared by all threads and does its own locking
   if (index != tile.get_index()) {
-    {
-      std::lock_guard<std::mutex> _(cache_lck);
-      tile = cache_->source(index);
-    }
+    tile = cache_->source(index);
     if (!tile) {
       if (!fetch(index))
         return get_no_data_value();
@@ -476,12 +761,54 @@ template <class coord_t> double sample::get(const coord_t& coord) {
 }
 
 template <class coords_t> std::vector<double> sample::get_all(const coords_t& coords) {
-  std::vector<double> values;
-  values.reserve(coords.size());
-
-  tile_data tile;
+  // where each point is, in which tile and at which fractional pixel of it
+  const size_t count = coords.size();
+  std::vector<uint16_t> indices(count);
+  std::vector<double> us(count), vs(count);
+  std::vector<uint32_t> order(count);
+  size_t i = 0;
   for (const auto& coord : coords) {
-    values.emplace_back(get(coord, tile));
+    auto lon = std::floor(coord.first);
+    auto lat = std::floor(coord.second);
+    indices[i] = get_tile_index(coord);
+    us[i] = (coord.first - lon) * (HGT_DIM - 1);
+    vs[i] = (1.0 - (coord.second - lat)) * (HGT_DIM - 1);
+    order[i] = i;
+    ++i;
+  }
+
+  // group the points by tile so each tile is sourced once however often the points go back and
+  // forth between tiles, within a tile they keep their order
+  std::stable_sort(order.begin(), order.end(),
+                   [&indices](uint32_t a, uint32_t b) { return indices[a] < indices[b]; });
+
+  std::vector<double> values(count, get_no_data_value());
+  std::vector<double> group_us, group_vs, group_values;
+  for (size_t begin = 0, end = 0; begin < count; begin = end) {
+    const auto index = indices[order[begin]];
+    for (end = begin + 1; end < count && indices[order[end]] == index; ++end) {
+    }
+
+    // the cache is shared by all threads and does its own locking
+    tile_data tile = cache_->source(index);
+    if (!tile && fetch(index)) {
+      tile = cache_->source(index);
+    }
+    if (!tile) {
+      continue;
+    }
+
+    group_us.resize(end - begin);
+    group_vs.resize(end - begin);
+    group_values.resize(end - begin);
+    for (size_t j = begin; j < end; ++j) {
+      group_us[j - begin] = us[order[j]];
+      group_vs[j - begin] = vs[order[j]];
+    }
+    tile.get_all(group_us.data(), group_vs.data(), group_values.size(), group_values.data());
+    for (size_t j = begin; j < end; ++j) {
+      values[order[j]] = group_values[j - begin];
+    }
   }
 
   return values;
@@ -75,5 +75,22 @@ weighted_grade(const std::vector<double>& heights,
                          (n == 0 ? get_no_data_value() : total_elev / n));
 }
 
+std::pair<double, double> elevation_change(const std::vector<double>& heights) {
+  double ascent = 0.0;
+  double descent = 0.0;
+  for (size_t i = 1; i < heights.size(); ++i) {
+    if (heights[i] == get_no_data_value() || heights[i - 1] == get_no_data_value()) {
+      continue;
+    }
+    const double change = heights[i] - heights[i - 1];
+    if (change > 0) {
+      ascent += change;
+    } else {
+      descent -= change;
+    }
+  }
+  return {ascent, descent};
+}
+
 } // namespace skadi
 } // namespace valhalla
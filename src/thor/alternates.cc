@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -196,5 +197,108 @@ bool validate_alternate_by_local_optimality(const std::vector<PathInfo>&) {
   // [TODO] NOT IMPLEMENTED
   return true;
 }
+
+// The path through a connection goes through the forward labels up to and including the connection
+// and then through the reverse labels after the connection, whose edge it already has.
+LabelPath get_label_path(GraphReader& graphreader,
+                         const std::vector<sif::BDEdgeLabel>& forward_labels,
+                         const std::vector<sif::BDEdgeLabel>& reverse_labels,
+                         const uint32_t forward_idx,
+                         const uint32_t reverse_idx) {
+  LabelPath path{std::vector<bool>(forward_labels.size()),
+                 std::vector<bool>(reverse_labels.size()),
+                 {},
+                 {},
+                 forward_labels[forward_idx].cost().cost,
+                 0.f};
+  const auto reverse_start = reverse_labels[reverse_idx].predecessor();
+  if (reverse_start != kInvalidLabel) {
+    path.reverse_cost = reverse_labels[reverse_start].cost().cost;
+  }
+
+  graph_tile_ptr tile;
+  const auto mark = [&graphreader, &tile](const std::vector<sif::BDEdgeLabel>& labels,
+                                          uint32_t idx, std::vector<bool>& marks,
+                                          std::vector<std::pair<uint32_t, float>>& lengths) {
+    for (; idx != kInvalidLabel; idx = labels[idx].predecessor()) {
+      marks[idx] = true;
+      lengths.emplace_back(idx, 0.f);
+    }
+    // predecessors come before their labels, so from the root on the indices go up
+    std::reverse(lengths.begin(), lengths.end());
+    float length = 0.f;
+    for (auto i = lengths.begin() + std::min<size_t>(1, lengths.size()); i != lengths.end(); ++i) {
+      const auto* edge = graphreader.directededge(labels[i->first].edgeid(), tile);
+      length += edge == nullptr ? 0.f : edge->length();
+      i->second = length;
+    }
+  };
+  mark(forward_labels, forward_idx, path.forward, path.forward_lengths);
+  mark(reverse_labels, reverse_start, path.reverse, path.reverse_lengths);
+  return path;
+}
+
+bool validate_alternate_by_labels(const std::vector<LabelPath>& label_paths,
+                                  const std::vector<std::vector<PathInfo>>& paths,
+                                  const std::vector<sif::BDEdgeLabel>& forward_labels,
+                                  const std::vector<sif::BDEdgeLabel>& reverse_labels,
+                                  const uint32_t forward_idx,
+                                  const uint32_t reverse_idx,
+                                  float at_most_shared) {
+  // the last label of the candidate it has in common with a chosen path in a label set
+  const auto branch = [](const std::vector<sif::BDEdgeLabel>& labels, uint32_t idx,
+                         const std::vector<bool>& marks) {
+    while (idx != kInvalidLabel && !marks[idx]) {
+      idx = labels[idx].predecessor();
+    }
+    return idx;
+  };
+  // the length of a chosen path from the root of a label set up to and including a label of it
+  const auto length = [](const std::vector<std::pair<uint32_t, float>>& lengths,
+                         const uint32_t idx) {
+    if (idx == kInvalidLabel) {
+      return 0.f;
+    }
+    auto found = std::lower_bound(lengths.begin(), lengths.end(), std::make_pair(idx, 0.f));
+    return found == lengths.end() ? 0.f : found->second;
+  };
+  const auto reverse_start = reverse_labels[reverse_idx].predecessor();
+
+  for (size_t i = 0; i < label_paths.size() && i < paths.size(); ++i) {
+    const auto& chosen = label_paths[i];
+    const auto forward_branch = branch(forward_labels, forward_idx, chosen.forward);
+    const auto reverse_branch = branch(reverse_labels, reverse_start, chosen.reverse);
+
+    // Limited sharing
+    const float shared_length = length(chosen.forward_lengths, forward_branch) +
+                                length(chosen.reverse_lengths, reverse_branch);
+    if (shared_length > at_most_shared * paths[i].back().path_distance) {
+      LOG_DEBUG("Candidate alternate rejected by sharing of labels");
+      return false;
+    }
+
+    // Bounded local stretch against the optimal path. Edges the paths have in common past the
+    // branches add the same to both segments, so a detour that is too long here is too long for the
+    // recovered paths as well.
+    if (i == 0) {
+      const float forward_branch_cost =
+          forward_branch == kInvalidLabel ? 0.f : forward_labels[forward_branch].cost().cost;
+      const float reverse_branch_cost =
+          reverse_branch == kInvalidLabel ? 0.f : reverse_labels[reverse_branch].cost().cost;
+      const float candidate_reverse_cost =
+          reverse_start == kInvalidLabel ? 0.f : reverse_labels[reverse_start].cost().cost;
+      const float candidate_segment_cost = forward_labels[forward_idx].cost().cost -
+                                           forward_branch_cost + candidate_reverse_cost -
+                                           reverse_branch_cost;
+      const float optimal_segment_cost =
+          chosen.forward_cost - forward_branch_cost + chosen.reverse_cost - reverse_branch_cost;
+      if (kAtMostLongerDetour * optimal_segment_cost < candidate_segment_cost) {
+        LOG_DEBUG("Candidate alternate rejected by local stretch of labels");
+        return false;
+      }
+    }
+  }
+  return true;
+}
 } // namespace thor
 } // namespace valhalla
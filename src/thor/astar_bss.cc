@@ -3,6 +3,7 @@
 #include "midgard/logging.h"
 #include <algorithm>
 #include <iostream> // TODO remove if not needed
+#include <limits>
 #include <map>
 
 using namespace valhalla::baldr;
@@ -122,6 +123,18 @@ void AStarBSSAlgorithm::ExpandForward(GraphReader& graphreader,
     return;
   }
 
+  // Riding through the tables the bicycle jumps from station to station, once it is docked the
+  // only way on is walking
+  if (use_bss_tables_ && mode == travel_mode_t::kBicycle) {
+    if (from_bss) {
+      ExpandRides(graphreader, node, pred, pred_idx);
+    } else if (nodeinfo->type() == NodeType::kBikeShare) {
+      ExpandForward(graphreader, node, pred, pred_idx, from_transition, true,
+                    travel_mode_t::kPedestrian, destination, best_path);
+    }
+    return;
+  }
+
   // Expand from end node.
   uint32_t shortcuts = 0;
   uint32_t max_shortcut_length = static_cast<uint32_t>(pred.distance() * 0.5f);
@@ -244,6 +257,59 @@ void AStarBSSAlgorithm::ExpandForward(GraphReader& graphreader,
   }
 }
 
+// Add a bicycle label for each ride of the tables from the station
+void AStarBSSAlgorithm::ExpandRides(GraphReader& graphreader,
+                                    const GraphId& node,
+                                    const EdgeLabel& pred,
+                                    const uint32_t pred_idx) {
+  const uint32_t station = bss_tables_->station_index(node);
+  if (station == kInvalidBssStation) {
+    return;
+  }
+
+  const auto rides = bss_tables_->rides_from(station);
+  for (const auto* ride = rides.first; ride != rides.second; ++ride) {
+    GraphId edgeid(ride->last_edge);
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    EdgeStatusInfo* es = bicycle_edgestatus_.GetPtr(edgeid, tile);
+    if (es->set() == EdgeSet::kPermanent) {
+      continue;
+    }
+
+    // Same as for an edge, a cheaper ride to a station that was reached before updates its label
+    const Cost newcost = pred.cost() + Cost{ride->cost, ride->secs};
+    if (es->set() == EdgeSet::kTemporary) {
+      EdgeLabel& lab = edgelabels_[es->index()];
+      if (newcost.cost < lab.cost().cost) {
+        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+        adjacencylist_.decrease(es->index(), newsortcost);
+        lab.Update(pred_idx, newcost, newsortcost, Cost{}, kInvalidRestriction);
+      }
+      continue;
+    }
+
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    graph_tile_ptr t2 =
+        directededge->leaves_tile() ? graphreader.GetGraphTile(directededge->endnode()) : tile;
+    if (t2 == nullptr) {
+      continue;
+    }
+    float dist = 0.0f;
+    float sortcost =
+        newcost.cost + bicycle_astarheuristic_.Get(t2->get_node_ll(directededge->endnode()), dist);
+
+    uint32_t idx = edgelabels_.size();
+    edgelabels_.emplace_back(pred_idx, edgeid, directededge, newcost, sortcost, dist,
+                             travel_mode_t::kBicycle, pred.path_distance() + ride->length, Cost{},
+                             baldr::kInvalidRestriction, true, false, InternalTurn::kNoTurn);
+    *es = {EdgeSet::kTemporary, idx};
+    adjacencylist_.add(idx);
+  }
+}
+
 // Calculate best path. This method is single mode, not time-dependent.
 std::vector<std::vector<PathInfo>>
 AStarBSSAlgorithm::GetBestPath(valhalla::Location& origin,
@@ -251,12 +317,13 @@ AStarBSSAlgorithm::GetBestPath(valhalla::Location& origin,
                                GraphReader& graphreader,
                                const sif::mode_costing_t& mode_costing,
                                const travel_mode_t mode,
-                               const Options&) {
+                               const Options& options) {
   // Set the mode and costing
   mode_ = mode;
   pedestrian_costing_ = mode_costing[static_cast<uint32_t>(travel_mode_t::kPedestrian)];
   bicycle_costing_ = mode_costing[static_cast<uint32_t>(travel_mode_t::kBicycle)];
   travel_type_ = pedestrian_costing_->travel_type();
+  use_bss_tables_ = bss_tables_ && BssTablesApplicable(options);
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   // Note: because we can correlate to more than one place for a given PathLocation
@@ -534,9 +601,31 @@ std::vector<PathInfo> AStarBSSAlgorithm::FormPath(baldr::GraphReader& graphreade
   for (auto edgelabel_index = dest; edgelabel_index != kInvalidLabel;
        edgelabel_index = edgelabels_[edgelabel_index].predecessor()) {
     const EdgeLabel& edgelabel = edgelabels_[edgelabel_index];
-    path.emplace_back(edgelabel.mode(), edgelabel.cost(), edgelabel.edgeid(), 0,
-                      edgelabel.path_distance(), edgelabel.restriction_idx(),
-                      edgelabel.transition_cost());
+
+    // A ride through the tables only knows its last edge, search the station for the others
+    std::vector<EdgeLabel> ride;
+    const bool jumped = use_bss_tables_ && edgelabel.mode() == travel_mode_t::kBicycle;
+    const EdgeLabel& walk = edgelabels_[jumped ? edgelabel.predecessor() : edgelabel_index];
+    if (jumped) {
+      auto found = bss_search_.Expand(graphreader, *bicycle_costing_, walk.endnode(),
+                                      std::numeric_limits<float>::max(), edgelabel.edgeid());
+      if (!found.empty()) {
+        ride = bss_search_.Path(found.front().label);
+      }
+    }
+    if (ride.size() > 1) {
+      for (auto label = ride.rbegin(); label != ride.rend(); ++label) {
+        path.emplace_back(travel_mode_t::kBicycle, walk.cost() + label->cost(), label->edgeid(),
+                          0, walk.path_distance() + label->path_distance(),
+                          label->restriction_idx(), label->transition_cost());
+      }
+      // the search may differ by rounding, the ride keeps the cost it had in the tables
+      path[path.size() - ride.size()].elapsed_cost = edgelabel.cost();
+    } else {
+      path.emplace_back(edgelabel.mode(), edgelabel.cost(), edgelabel.edgeid(), 0,
+                        edgelabel.path_distance(), edgelabel.restriction_idx(),
+                        edgelabel.transition_cost());
+    }
 
     graph_tile_ptr tile = graphreader.GetGraphTile(edgelabel.edgeid());
     const DirectedEdge* directededge = tile->directededge(edgelabel.edgeid());
@@ -33,6 +33,17 @@ constexpr float kAlternativeCostExtend = 1.2f;
 // iterations in order no to drop performance too much.
 constexpr uint32_t kAlternativeIterationsDelta = 100000;
 
+// How many edges each search settles before the searches running concurrently look for connections
+constexpr uint32_t kParallelRoundSize = 2048;
+
+// How many expansions in a row one search may put off while the prefetcher reads the tile it needs
+// next, after that it waits for the tile rather than letting the other search run away
+constexpr uint32_t kMaxDeferredExpansions = 4096;
+
+// Share of the straight line between the locations a time dependent search has to cover before its
+// pace is trusted to estimate the duration of the route
+constexpr float kMinDurationEstimateProgress = 0.05f;
+
 inline float find_percent_along(const valhalla::Location& location, const GraphId& edge_id) {
   for (const auto& e : location.correlation().edges()) {
     if (e.graph_id() == edge_id)
@@ -47,11 +58,20 @@ namespace valhalla {
 namespace thor {
 
 // Default constructor
-BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config)
+BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config,
+                                       const boost::property_tree::ptree& reader_config)
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_bidir_astar",
                                          kInitialEdgeLabelCountBidirAstar),
                     config.get<bool>("clear_reserved_memory", false)),
-      extended_search_(config.get<bool>("extended_search", false)) {
+      forward_budget_(config, max_reserved_labels_count_, clear_reserved_memory_),
+      reverse_budget_(config, max_reserved_labels_count_, clear_reserved_memory_),
+      adjacencylist_forward_(
+          ParseQueueType(config.get<std::string>("adjacency_queue", "double_bucket"))),
+      adjacencylist_reverse_(adjacencylist_forward_.type()),
+      extended_search_(config.get<bool>("extended_search", false)),
+      parallel_distance_(config.get<float>("bidirectional_parallel_distance", 0.f) * 1000.f),
+      reader_config_(reader_config), parallel_(false),
+      time_dependent_(config.get<bool>("bidirectional_time_dependent", false)) {
   cost_threshold_ = 0;
   iterations_threshold_ = 0;
   desired_paths_count_ = 1;
@@ -62,6 +82,11 @@ BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config
   pruning_disabled_at_origin_ = false;
   pruning_disabled_at_destination_ = false;
   ignore_hierarchy_limits_ = false;
+  time_dependent_search_ = false;
+  time_from_origin_ = true;
+  route_distance_ = 0.f;
+  duration_lower_bound_ = 0.f;
+  duration_estimate_ = 0.f;
 }
 
 // Destructor
@@ -70,22 +95,15 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-  if (edgelabels_forward_.size() > reservation) {
-    edgelabels_forward_.resize(reservation);
-    edgelabels_forward_.shrink_to_fit();
-  }
-  if (edgelabels_reverse_.size() > reservation) {
-    edgelabels_reverse_.resize(reservation);
-    edgelabels_reverse_.shrink_to_fit();
-  }
-  edgelabels_forward_.clear();
-  edgelabels_reverse_.clear();
+  forward_budget_.clear(edgelabels_forward_);
+  reverse_budget_.clear(edgelabels_reverse_);
 
   adjacencylist_forward_.clear();
   adjacencylist_reverse_.clear();
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
+  tiles_forward_.Clear();
+  tiles_reverse_.Clear();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -95,6 +113,8 @@ void BidirectionalAStar::Clear() {
   pruning_disabled_at_origin_ = false;
   pruning_disabled_at_destination_ = false;
   ignore_hierarchy_limits_ = false;
+  parallel_ = false;
+  time_dependent_search_ = false;
 }
 
 // Initialize the A* heuristic and adjacency lists for both the forward
@@ -102,6 +122,8 @@ void BidirectionalAStar::Clear() {
 void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   // Initialize the A* heuristics
   float factor = costing_->AStarCostFactor();
+  astarheuristic_forward_.SetAltBounds(alt_bounds_.get());
+  astarheuristic_reverse_.SetAltBounds(alt_bounds_.get());
   astarheuristic_forward_.Init(destll, factor);
   astarheuristic_reverse_.Init(origll, factor);
 
@@ -155,6 +177,28 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   ignore_hierarchy_limits_ = ignore_forward_limits && ignore_reverse_limits;
 }
 
+// Extrapolate the pace of the search counting from the known time over the straight line between
+// the locations. Early on the pace near the location says little about the rest of the route so
+// the estimate waits for some progress, and it never gets below the heuristic lower bound.
+void BidirectionalAStar::RefineDurationEstimate(GraphReader& graphreader, const BDEdgeLabel& pred) {
+  if (!best_connections_.empty()) {
+    return;
+  }
+  const auto tile = graphreader.GetGraphTile(pred.endnode());
+  if (tile == nullptr) {
+    return;
+  }
+  const auto ll = tile->get_node_ll(pred.endnode());
+  const float progress =
+      route_distance_ - (time_from_origin_ ? astarheuristic_forward_.GetDistance(ll)
+                                           : astarheuristic_reverse_.GetDistance(ll));
+  if (progress <= 0.f || progress < route_distance_ * kMinDurationEstimateProgress) {
+    return;
+  }
+  duration_estimate_ =
+      std::max(duration_lower_bound_, pred.cost().secs * route_distance_ / progress);
+}
+
 // Runs in the inner loop of `Expand`, essentially evaluating if
 // the edge described in `meta` should be placed on the stack
 // as well as doing just that.
@@ -180,20 +224,21 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     return false;
   }
 
-  graph_tile_ptr t2 = nullptr;
+  constexpr bool FORWARD = expansion_direction == ExpansionType::forward;
+  auto& tiles = FORWARD ? tiles_forward_ : tiles_reverse_;
+  const graph_tile_ptr* t2 = nullptr;
   baldr::GraphId opp_edge_id;
-  const auto get_opp_edge_data = [&t2, &opp_edge_id, &graphreader, &meta, &tile]() {
+  const auto get_opp_edge_data = [&t2, &opp_edge_id, &graphreader, &tiles, &meta, &tile]() {
     // Get end node tile, opposing edge Id, and opposing directed edge.
-    t2 = meta.edge->leaves_tile() ? graphreader.GetGraphTile(meta.edge->endnode()) : tile;
-    if (t2 == nullptr) {
+    t2 = meta.edge->leaves_tile() ? &tiles.Get(graphreader, meta.edge->endnode()) : &tile;
+    if (*t2 == nullptr) {
       return false;
     }
 
-    opp_edge_id = t2->GetOpposingEdgeId(meta.edge);
+    opp_edge_id = (*t2)->GetOpposingEdgeId(meta.edge);
     return true;
   };
 
-  constexpr bool FORWARD = expansion_direction == ExpansionType::forward;
   auto& hierarchy_limits = FORWARD ? hierarchy_limits_forward_ : hierarchy_limits_reverse_;
   // Skip shortcut edges until we have stopped expanding on the next level. Use regular
   // edges while still expanding on the next level since we can still transition down to
@@ -204,9 +249,12 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
       return false;
 
     const auto& opp_edgestatus = FORWARD ? edgestatus_reverse_ : edgestatus_forward_;
-    const auto opp_edge_set = opp_edgestatus.Get(opp_edge_id).set();
+    const auto opp_edge_set =
+        parallel_ ? EdgeSet::kUnreachedOrReset : opp_edgestatus.Get(opp_edge_id).set();
     // Synchronize shortcuts for both directions. If this shortcut has been already
     // encountered on the opposing search we should do the same now: skip or traverse.
+    // The opposing search is not looked at while both run concurrently, each direction
+    // then takes the shortcuts once it stopped expanding the next level.
     if ((opp_edge_set != EdgeSet::kSkipped &&
          hierarchy_limits[meta.edge_id.level() + 1].StopExpanding(pred.distance())) ||
         opp_edge_set == EdgeSet::kPermanent || opp_edge_set == EdgeSet::kTemporary) {
@@ -239,14 +287,14 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
       return false;
     }
 
-    opp_edge = t2->directededge(opp_edge_id);
+    opp_edge = (*t2)->directededge(opp_edge_id);
   }
 
   // Skip this edge if no access is allowed (based on costing method)
   // or if a complex restriction prevents transition onto this edge.
   // if its not time dependent set to 0 for Allowed and Restricted methods below
   const uint64_t localtime = time_info.valid ? time_info.local_time : 0;
-  uint8_t restriction_idx = -1;
+  sif::EdgeEvaluation evaluation;
   if (FORWARD) {
     // Why is is_dest false?
     // We have to consider next cases:
@@ -256,35 +304,27 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     // We can set is_dest incorrectly in the second case, but it is the rare case.
     // The result path will be correct, because there are cosing.Allowed calls inside recost_forward
     // function in second time.
-    if (!costing_->Allowed(meta.edge, false, pred, tile, meta.edge_id, localtime,
-                           time_info.timezone_index, restriction_idx) ||
+    if (!costing_->EvaluateEdge(meta.edge, false, pred, tile, meta.edge_id, nodeinfo, time_info,
+                                localtime, time_info.timezone_index, evaluation) ||
         costing_->Restricted(meta.edge, pred, edgelabels_forward_, tile, meta.edge_id, true,
                              &edgestatus_forward_, localtime, time_info.timezone_index)) {
       return false;
     }
   } else {
-    if (!costing_->AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, localtime,
-                                  time_info.timezone_index, restriction_idx) ||
+    if (!costing_->EvaluateEdgeReverse(meta.edge, pred, opp_edge, *t2, opp_edge_id, nodeinfo,
+                                       opp_pred_edge, tile, time_info, localtime,
+                                       time_info.timezone_index, evaluation) ||
         costing_->Restricted(meta.edge, pred, edgelabels_reverse_, tile, meta.edge_id, false,
                              &edgestatus_reverse_, localtime, time_info.timezone_index)) {
       return false;
     }
   }
 
-  // Get cost
-  uint8_t flow_sources;
-  sif::Cost newcost =
-      pred.cost() + (FORWARD ? costing_->EdgeCost(meta.edge, tile, time_info, flow_sources)
-                             : costing_->EdgeCost(opp_edge, t2, time_info, flow_sources));
-
-  // Separate out transition cost.
-  sif::Cost transition_cost =
-      FORWARD ? costing_->TransitionCost(meta.edge, nodeinfo, pred)
-              : costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge,
-                                                opp_pred_edge,
-                                                static_cast<bool>(flow_sources & kDefaultFlowMask),
-                                                pred.internal_turn());
-  newcost += transition_cost;
+  // Get cost, the transition cost is kept separate in the label
+  const uint8_t flow_sources = evaluation.flow_sources;
+  const uint8_t restriction_idx = evaluation.restriction_idx;
+  const sif::Cost& transition_cost = evaluation.transition_cost;
+  sif::Cost newcost = pred.cost() + evaluation.edge_cost + transition_cost;
 
   // Check if edge is temporarily labeled and this path has less cost. If
   // less cost the predecessor is updated and the sort cost is decremented
@@ -312,10 +352,10 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
   // Find the sort cost (with A* heuristic) using the lat,lng at the
   // end node of the directed edge.
   float dist = 0.0f;
+  const auto end_ll = (*t2)->get_node_ll(meta.edge->endnode());
   float sortcost =
-      newcost.cost + (FORWARD
-                          ? astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()), dist)
-                          : astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()), dist));
+      newcost.cost + (FORWARD ? astarheuristic_forward_.Get(end_ll, meta.edge->endnode(), dist)
+                              : astarheuristic_reverse_.Get(end_ll, meta.edge->endnode(), dist));
 
   // not_thru_pruning_ is only set to false on the 2nd pass in route_action.
   bool thru = not_thru_pruning_ ? (pred.not_thru_pruning() || !meta.edge->not_thru()) : false;
@@ -327,7 +367,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     if (hierarchy_limits_forward_[meta.edge_id.level()].max_up_transitions != kUnlimitedTransitions) {
       // Override distance to the destination with a distance from the origin.
       // It will be used by hierarchy limits
-      dist = astarheuristic_reverse_.GetDistance(t2->get_node_ll(meta.edge->endnode()));
+      dist = astarheuristic_reverse_.GetDistance(end_ll);
     }
     edgelabels_forward_.emplace_back(pred_idx, meta.edge_id, opp_edge_id, meta.edge, newcost,
                                      sortcost, dist, mode_, transition_cost, thru,
@@ -341,7 +381,7 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
     if (hierarchy_limits_reverse_[meta.edge_id.level()].max_up_transitions != kUnlimitedTransitions) {
       // Override distance to the origin with a distance from the destination.
       // It will be used by hierarchy limits
-      dist = astarheuristic_forward_.GetDistance(t2->get_node_ll(meta.edge->endnode()));
+      dist = astarheuristic_forward_.GetDistance(end_ll);
     }
     edgelabels_reverse_.emplace_back(pred_idx, meta.edge_id, opp_edge_id, meta.edge, newcost,
                                      sortcost, dist, mode_, transition_cost, thru,
@@ -357,7 +397,8 @@ inline bool BidirectionalAStar::ExpandInner(baldr::GraphReader& graphreader,
 
   // setting this edge as reached
   if (expansion_callback_) {
-    expansion_callback_(graphreader, FORWARD ? meta.edge_id : opp_edge_id, "bidirectional_astar", "r",
+    expansion_callback_(graphreader, FORWARD ? meta.edge_id : opp_edge_id,
+                        FORWARD ? pred.edgeid() : pred.opp_edgeid(), "bidirectional_astar", "r",
                         pred.cost().secs, pred.path_distance(), pred.cost().cost);
   }
 
@@ -375,9 +416,13 @@ bool BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
                                 const baldr::TimeInfo& time_info,
                                 const bool invariant) {
   constexpr bool FORWARD = expansion_direction == ExpansionType::forward;
+  // Nothing of the scope is referenced in between expansions so this is where it can let go of
+  // the tiles it pinned
+  auto& tiles = FORWARD ? tiles_forward_ : tiles_reverse_;
+  tiles.Trim();
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
-  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  const graph_tile_ptr& tile = tiles.Get(graphreader, node);
   if (tile == nullptr) {
     return false;
   }
@@ -391,13 +436,22 @@ bool BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
   auto offset_time = FORWARD
                          ? time_info.forward(seconds_offset, static_cast<int>(nodeinfo->timezone()))
                          : time_info.reverse(seconds_offset, static_cast<int>(nodeinfo->timezone()));
+  // The search from the location without a time gets the time of the other location offset by
+  // the duration the rest of the route is expected to take
+  if (time_dependent_search_ && FORWARD != time_from_origin_) {
+    seconds_offset = std::max(duration_estimate_ - pred.cost().secs, 0.f);
+    offset_time = FORWARD
+                      ? time_info.reverse(seconds_offset, static_cast<int>(nodeinfo->timezone()))
+                      : time_info.forward(seconds_offset, static_cast<int>(nodeinfo->timezone()));
+  }
 
   auto& edgestatus = FORWARD ? edgestatus_forward_ : edgestatus_reverse_;
 
   // If we encounter a node with an access restriction like a barrier we allow a uturn
   if (!costing_->Allowed(nodeinfo)) {
     const DirectedEdge* opp_edge = nullptr;
-    const GraphId opp_edge_id = graphreader.GetOpposingEdgeId(pred.edgeid(), opp_edge, tile);
+    graph_tile_ptr opp_tile = tile;
+    const GraphId opp_edge_id = graphreader.GetOpposingEdgeId(pred.edgeid(), opp_edge, opp_tile);
     // Mark the predecessor as a deadend to be consistent with how the
     // edgelabels are set when an *actual* deadend (i.e. some dangling OSM geometry)
     // is labelled
@@ -406,8 +460,8 @@ bool BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
     return opp_edge &&
            ExpandInner<expansion_direction>(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx,
                                             {opp_edge, opp_edge_id,
-                                             edgestatus.GetPtr(opp_edge_id, tile)},
-                                            shortcuts, tile, offset_time);
+                                             edgestatus.GetPtr(opp_edge_id, opp_tile)},
+                                            shortcuts, opp_tile, offset_time);
   }
 
   bool disable_uturn = false;
@@ -438,10 +492,12 @@ bool BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       // if this is a downward transition (ups are always allowed) AND we are no longer allowed OR
       // we cant get the tile at that level (local extracts could have this problem) THEN bail
-      graph_tile_ptr trans_tile = nullptr;
-      if ((!trans->up() && !ignore_hierarchy_limits_ &&
-           hierarchy_limits[trans->endnode().level()].StopExpanding(pred.distance())) ||
-          !(trans_tile = graphreader.GetGraphTile(trans->endnode()))) {
+      if (!trans->up() && !ignore_hierarchy_limits_ &&
+          hierarchy_limits[trans->endnode().level()].StopExpanding(pred.distance())) {
+        continue;
+      }
+      const graph_tile_ptr& trans_tile = tiles.Get(graphreader, trans->endnode());
+      if (trans_tile == nullptr) {
         continue;
       }
 
@@ -499,6 +555,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   desired_paths_count_ = 1;
   if (options.has_alternates_case() && options.alternates())
     desired_paths_count_ += options.alternates();
+  auto timing = search_timer_.start(stats_, graphreader);
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   PointLL origin_new(origin.correlation().edges(0).ll().lng(),
@@ -507,13 +564,33 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
                           destination.correlation().edges(0).ll().lat());
   Init(origin_new, destination_new);
 
-  // we use a non varying time for all time dependent routes until we can figure out how to vary the
-  // time during the path computation in the bidirectional algorithm
-  bool invariant = options.date_time_type() != Options::no_time;
+  // long searches stall on tiles that are not in the cache yet, start warming the ones in between
+  graphreader.PrefetchCorridor(origin_new, destination_new);
+
   // Get time information for forward and backward searches
   auto forward_time_info = TimeInfo::make(origin, graphreader, &tz_cache_);
   auto reverse_time_info = TimeInfo::make(destination, graphreader, &tz_cache_);
 
+  // Unless bidirectional_time_dependent is set we use a non varying time for all time dependent
+  // routes. With it both searches vary the time of the location that has one: its own search
+  // counts from it and the other search offsets it by the expected duration of the route
+  time_from_origin_ = options.date_time_type() != Options::arrive_by;
+  const auto& known_time_info = time_from_origin_ ? forward_time_info : reverse_time_info;
+  time_dependent_search_ = time_dependent_ && known_time_info.valid &&
+                           options.date_time_type() != Options::invariant;
+  bool invariant = options.date_time_type() != Options::no_time && !time_dependent_search_;
+  route_distance_ = origin_new.Distance(destination_new);
+  duration_lower_bound_ = duration_estimate_ = astarheuristic_forward_.Get(origin_new);
+  if (time_dependent_search_) {
+    // both searches start from the known time, the location without one is reached at the
+    // expected duration from it
+    if (time_from_origin_) {
+      reverse_time_info = known_time_info;
+    } else {
+      forward_time_info = known_time_info;
+    }
+  }
+
   // When a timedependent route is too long in distance it gets sent to this algorithm. It used to be
   // the case that this algorithm called EdgeCost without a time component. This would result in
   // timedependent routes falling back to time independent routing. Now that this algorithm is time
@@ -531,12 +608,36 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   // PathLocation using edges.front here means we are only setting the
   // heuristics to one of them alternate paths using the other correlated
   // points to may be harder to find
-  SetOrigin(graphreader, origin, forward_time_info);
-  SetDestination(graphreader, destination, reverse_time_info);
+  if (time_dependent_search_) {
+    const TimeInfo origin_time_info =
+        time_from_origin_ ? forward_time_info
+                          : forward_time_info.reverse(duration_estimate_,
+                                                      forward_time_info.timezone_index);
+    const TimeInfo destination_time_info =
+        time_from_origin_ ? reverse_time_info.forward(duration_estimate_,
+                                                      reverse_time_info.timezone_index)
+                          : reverse_time_info;
+    SetOrigin(graphreader, origin, origin_time_info);
+    SetDestination(graphreader, destination, destination_time_info);
+  } else {
+    SetOrigin(graphreader, origin, forward_time_info);
+    SetDestination(graphreader, destination, reverse_time_info);
+  }
 
   // Update hierarchy limits
   if (!ignore_hierarchy_limits_)
     ModifyHierarchyLimits();
+  search_timer_.phase(SearchPhase::expansion);
+
+  // Long routes run both searches at the same time if there is a thread to spare for it
+  if (parallel_distance_ > 0.f && !reader_config_.empty() && !expansion_callback_ &&
+      origin_new.Distance(destination_new) >= parallel_distance_) {
+    reverse_time_info.tz_cache = &reverse_tz_cache_;
+    if (!ExpandInParallel(graphreader, forward_time_info, reverse_time_info, invariant)) {
+      return {};
+    }
+    return FormPath(graphreader, options, origin, destination, forward_time_info);
+  }
 
   // Find shortest path. Switch between a forward direction and a reverse
   // direction search based on the current costs. Alternating like this
@@ -548,6 +649,20 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   BDEdgeLabel fwd_pred, rev_pred;
   bool expand_forward = true;
   bool expand_reverse = true;
+  // The tile each search last needed that was not pending, it only has to be checked again when
+  // the search moves on to another tile
+  GraphId forward_ready_tile, reverse_ready_tile;
+  auto pending = [&graphreader](const GraphId& node, GraphId& ready_tile) {
+    if (node.Tile_Base() == ready_tile) {
+      return false;
+    }
+    if (graphreader.IsTilePending(node)) {
+      return true;
+    }
+    ready_tile = node.Tile_Base();
+    return false;
+  };
+  uint32_t deferred_in_a_row = 0;
   while (true) {
     // Allow this process to be aborted
     if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
@@ -563,7 +678,11 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
     if (expand_forward) {
       forward_pred_idx = adjacencylist_forward_.pop();
       if (forward_pred_idx != kInvalidLabel) {
+        ++stats_.settled;
         fwd_pred = edgelabels_forward_[forward_pred_idx];
+        if (time_dependent_search_ && time_from_origin_) {
+          RefineDurationEstimate(graphreader, fwd_pred);
+        }
 
         // Forward path to this edge can't be improved, so we can settle it right now.
         edgestatus_forward_.Update(fwd_pred.edgeid(), EdgeSet::kPermanent);
@@ -613,7 +732,11 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
     if (expand_reverse) {
       reverse_pred_idx = adjacencylist_reverse_.pop();
       if (reverse_pred_idx != kInvalidLabel) {
+        ++stats_.settled;
         rev_pred = edgelabels_reverse_[reverse_pred_idx];
+        if (time_dependent_search_ && !time_from_origin_) {
+          RefineDurationEstimate(graphreader, rev_pred);
+        }
 
         // Reverse path to this edge can't be improved, so we can settle it right now.
         edgestatus_reverse_.Update(rev_pred.edgeid(), EdgeSet::kPermanent);
@@ -694,16 +817,37 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
     // Expand from the search direction with lower sort cost
     // Note: If one direction is exhausted, we force search in the remaining
     // direction
-    if (!forward_exhausted &&
-        ((!force_reverse && (fwd_pred.sortcost() + cost_diff_) < rev_pred.sortcost()) ||
-         force_forward || reverse_exhausted)) {
+    bool forward = !forward_exhausted &&
+                   ((!force_reverse && (fwd_pred.sortcost() + cost_diff_) < rev_pred.sortcost()) ||
+                    force_forward || reverse_exhausted);
+
+    // Rather than block on the tile the prefetcher is still reading, expand the other search in the
+    // meantime. Each search still settles its edges in order so this only changes how far ahead
+    // of the other one a search gets, like the hierarchy limits do.
+    if (!forward_exhausted && !reverse_exhausted && !force_forward && !force_reverse &&
+        deferred_in_a_row < kMaxDeferredExpansions) {
+      const bool forward_pending = pending(fwd_pred.endnode(), forward_ready_tile);
+      const bool reverse_pending = pending(rev_pred.endnode(), reverse_ready_tile);
+      if (forward ? forward_pending && !reverse_pending : reverse_pending && !forward_pending) {
+        forward = !forward;
+        ++deferred_in_a_row;
+        ++stats_.deferred;
+      } else {
+        deferred_in_a_row = 0;
+      }
+    }
+
+    if (forward) {
       // Expand forward - set to get next edge from forward adj. list on the next pass
       expand_forward = true;
       expand_reverse = false;
 
       // setting this edge as settled
       if (expansion_callback_) {
-        expansion_callback_(graphreader, fwd_pred.edgeid(), "bidirectional_astar", "s",
+        auto prev_pred = fwd_pred.predecessor() == kInvalidLabel
+                             ? GraphId{}
+                             : edgelabels_forward_[fwd_pred.predecessor()].edgeid();
+        expansion_callback_(graphreader, fwd_pred.edgeid(), prev_pred, "bidirectional_astar", "s",
                             fwd_pred.cost().secs, fwd_pred.path_distance(), fwd_pred.cost().cost);
       }
 
@@ -726,7 +870,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
           float route_lower_bound =
               edgelabels_forward_[fwd_pred.predecessor()].cost().cost +
               fwd_pred.transition_cost().cost + rev_pred.sortcost() -
-              astarheuristic_reverse_.Get(tile->get_node_ll(fwd_pred.endnode()));
+              astarheuristic_reverse_.Get(tile->get_node_ll(fwd_pred.endnode()), fwd_pred.endnode());
           // Prune this edge if estimated lower bound cost exceeds the cost threshold.
           if (route_lower_bound > cost_threshold_) {
             continue;
@@ -747,8 +891,12 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
       // setting this edge as settled, sending the opposing because this is the reverse tree
       if (expansion_callback_) {
-        expansion_callback_(graphreader, rev_pred.opp_edgeid(), "bidirectional_astar", "s",
-                            rev_pred.cost().secs, rev_pred.path_distance(), rev_pred.cost().cost);
+        auto prev_pred = rev_pred.predecessor() == kInvalidLabel
+                             ? GraphId{}
+                             : edgelabels_reverse_[rev_pred.predecessor()].opp_edgeid();
+        expansion_callback_(graphreader, rev_pred.opp_edgeid(), prev_pred, "bidirectional_astar",
+                            "s", rev_pred.cost().secs, rev_pred.path_distance(),
+                            rev_pred.cost().cost);
       }
 
       // Prune path if predecessor is not a through edge
@@ -777,7 +925,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
           float route_lower_bound =
               edgelabels_reverse_[rev_pred.predecessor()].cost().cost +
               rev_pred.transition_cost().cost + fwd_pred.sortcost() -
-              astarheuristic_forward_.Get(tile->get_node_ll(rev_pred.endnode()));
+              astarheuristic_forward_.Get(tile->get_node_ll(rev_pred.endnode()), rev_pred.endnode());
           // Prune this edge if estimated lower bound cost exceeds the cost threshold.
           if (route_lower_bound > cost_threshold_) {
             continue;
@@ -796,6 +944,203 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   return {}; // If we are here the route failed
 }
 
+// Settle up to a round worth of edges of one search. Only the state of this search is touched so
+// that the other one can run at the same time, the connections are found between the rounds.
+template <const ExpansionType expansion_direction>
+BidirectionalAStar::RoundEnd BidirectionalAStar::ExpandRound(GraphReader& graphreader,
+                                                             const TimeInfo& time_info,
+                                                             const bool invariant,
+                                                             const float opposite_sortcost,
+                                                             std::vector<uint32_t>& settled) {
+  constexpr bool FORWARD = expansion_direction == ExpansionType::forward;
+  auto& adjacencylist = FORWARD ? adjacencylist_forward_ : adjacencylist_reverse_;
+  auto& edgelabels = FORWARD ? edgelabels_forward_ : edgelabels_reverse_;
+  auto& edgestatus = FORWARD ? edgestatus_forward_ : edgestatus_reverse_;
+  const auto& hierarchy_limits = FORWARD ? hierarchy_limits_forward_ : hierarchy_limits_reverse_;
+  const auto& opposite_heuristic = FORWARD ? astarheuristic_reverse_ : astarheuristic_forward_;
+  const float sortcost_diff = FORWARD ? cost_diff_ : 0.f;
+
+  settled.clear();
+  for (uint32_t i = 0; i < kParallelRoundSize; ++i) {
+    const uint32_t pred_idx = adjacencylist.pop();
+    if (pred_idx == kInvalidLabel) {
+      return RoundEnd::kExhausted;
+    }
+    BDEdgeLabel pred = edgelabels[pred_idx];
+
+    // The path to this edge can't be improved, so we can settle it right now.
+    edgestatus.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    // Stop if the cost threshold has been exceeded.
+    if (pred.sortcost() + sortcost_diff > cost_threshold_) {
+      return RoundEnd::kPastThreshold;
+    }
+    settled.push_back(pred_idx);
+
+    // Prune path if predecessor is not a through edge or if the maximum
+    // number of upward transitions has been exceeded on this hierarchy level.
+    if ((pred.not_thru() && pred.not_thru_pruning()) ||
+        (!ignore_hierarchy_limits_ &&
+         hierarchy_limits[pred.endnode().level()].StopExpanding(pred.distance()))) {
+      continue;
+    }
+
+    // Get the opposing predecessor directed edge of the reverse search
+    const DirectedEdge* opp_pred_edge = nullptr;
+    if (!FORWARD) {
+      const auto pred_tile = graphreader.GetGraphTile(pred.opp_edgeid());
+      if (pred_tile == nullptr) {
+        continue;
+      }
+      opp_pred_edge = pred_tile->directededge(pred.opp_edgeid());
+    }
+
+    // Reach-based pruning as in GetBestPath. The other search only ever settles edges of a larger
+    // sort cost than the one it had at the start of the round so the bound still holds.
+    if (cost_threshold_ != std::numeric_limits<float>::max() &&
+        pred.predecessor() != kInvalidLabel) {
+      const auto tile = graphreader.GetGraphTile(pred.endnode());
+      if (tile == nullptr) {
+        continue;
+      }
+      float route_lower_bound =
+          edgelabels[pred.predecessor()].cost().cost + pred.transition_cost().cost +
+          opposite_sortcost -
+          opposite_heuristic.Get(tile->get_node_ll(pred.endnode()), pred.endnode());
+      if (route_lower_bound > cost_threshold_) {
+        continue;
+      }
+    }
+
+    Expand<expansion_direction>(graphreader, pred.endnode(), pred, pred_idx, opp_pred_edge,
+                                time_info, invariant);
+  }
+  return RoundEnd::kOpen;
+}
+
+// Run both searches at the same time, each on its own thread with its own graph reader. Neither
+// search looks at the other one during a round, afterwards the calling thread checks the edges
+// settled in the round for connections and decides whether to go on.
+bool BidirectionalAStar::ExpandInParallel(GraphReader& graphreader,
+                                          const TimeInfo& forward_time_info,
+                                          const TimeInfo& reverse_time_info,
+                                          const bool invariant) {
+  if (!pool_) {
+    pool_.reset(new SearchPool(2, reader_config_));
+  }
+
+  bool expand_forward = true, expand_reverse = true;
+  RoundEnd forward_end = RoundEnd::kOpen, reverse_end = RoundEnd::kOpen;
+  float forward_sortcost = 0.f, reverse_sortcost = 0.f;
+  std::vector<uint32_t> forward_settled, reverse_settled;
+  const SearchPool::search_t round = [&](const uint32_t direction, GraphReader& reader) {
+    if (direction == 0) {
+      forward_settled.clear();
+      if (expand_forward) {
+        forward_end = ExpandRound<ExpansionType::forward>(reader, forward_time_info, invariant,
+                                                          reverse_sortcost, forward_settled);
+      }
+    } else {
+      reverse_settled.clear();
+      if (expand_reverse) {
+        reverse_end = ExpandRound<ExpansionType::reverse>(reader, reverse_time_info, invariant,
+                                                          forward_sortcost, reverse_settled);
+      }
+    }
+  };
+
+  parallel_ = true;
+  bool connected = false;
+  while (true) {
+    // Allow this process to be aborted
+    if (interrupt) {
+      (*interrupt)();
+    }
+
+    pool_->run(2, round, graphreader);
+    stats_.settled += forward_settled.size() + reverse_settled.size();
+
+    // Check if the settled edges connect to the other search tree, including the special
+    // case of an edge at the other location that wasn't pulled out of its queue yet
+    for (const auto idx : forward_settled) {
+      const auto& fwd_pred = edgelabels_forward_[idx];
+      const auto opp_status = edgestatus_reverse_.Get(fwd_pred.opp_edgeid());
+      if (opp_status.set() == EdgeSet::kPermanent ||
+          (opp_status.set() == EdgeSet::kTemporary &&
+           edgelabels_reverse_[opp_status.index()].predecessor() == kInvalidLabel)) {
+        SetForwardConnection(graphreader, fwd_pred);
+      }
+    }
+    for (const auto idx : reverse_settled) {
+      const auto& rev_pred = edgelabels_reverse_[idx];
+      const auto opp_status = edgestatus_forward_.Get(rev_pred.opp_edgeid());
+      if (opp_status.set() == EdgeSet::kPermanent ||
+          (opp_status.set() == EdgeSet::kTemporary &&
+           edgelabels_forward_[opp_status.index()].predecessor() == kInvalidLabel)) {
+        SetReverseConnection(graphreader, rev_pred);
+      }
+    }
+    if (!forward_settled.empty()) {
+      forward_sortcost = edgelabels_forward_[forward_settled.back()].sortcost();
+    }
+    if (!reverse_settled.empty()) {
+      reverse_sortcost = edgelabels_reverse_[reverse_settled.back()].sortcost();
+    }
+
+    // The searches only read the expected duration of a time dependent route during a round
+    if (time_dependent_search_) {
+      const auto& settled = time_from_origin_ ? forward_settled : reverse_settled;
+      if (!settled.empty()) {
+        RefineDurationEstimate(graphreader, time_from_origin_
+                                                ? edgelabels_forward_[settled.back()]
+                                                : edgelabels_reverse_[settled.back()]);
+      }
+    }
+
+    // Terminate if the iterations or the cost threshold has been exceeded.
+    if ((edgelabels_reverse_.size() + edgelabels_forward_.size()) > iterations_threshold_ ||
+        forward_end == RoundEnd::kPastThreshold || reverse_end == RoundEnd::kPastThreshold) {
+      connected = true;
+      break;
+    }
+
+    // A search is exhausted. If a connection has been found, return it, otherwise extend the
+    // other search if allowed, see GetBestPath
+    if (expand_forward && forward_end == RoundEnd::kExhausted) {
+      if (!best_connections_.empty()) {
+        connected = true;
+        break;
+      }
+      LOG_ERROR("Forward search exhausted: n = " + std::to_string(edgelabels_forward_.size()) +
+                "," + std::to_string(edgelabels_reverse_.size()));
+      if (!extended_search_ || !pruning_disabled_at_destination_) {
+        break;
+      }
+      expand_forward = false;
+    }
+    if (expand_reverse && reverse_end == RoundEnd::kExhausted) {
+      if (!best_connections_.empty()) {
+        connected = true;
+        break;
+      }
+      LOG_ERROR("Reverse search exhausted: n = " + std::to_string(edgelabels_reverse_.size()) +
+                "," + std::to_string(edgelabels_forward_.size()));
+      if (!extended_search_ || !pruning_disabled_at_origin_) {
+        break;
+      }
+      expand_reverse = false;
+    }
+    if (!expand_forward && !expand_reverse) {
+      LOG_ERROR("Bi-directional route failure - search exhausted: n = " +
+                std::to_string(edgelabels_forward_.size()) + "," +
+                std::to_string(edgelabels_reverse_.size()));
+      break;
+    }
+  }
+  parallel_ = false;
+  return connected;
+}
+
 // The edge on the forward search connects to a reached edge on the reverse
 // search tree. Check if this is the best connection so far and set the
 // search threshold.
@@ -822,23 +1167,29 @@ bool BidirectionalAStar::SetForwardConnection(GraphReader& graphreader, const BD
 
   // Get the opposing edge - a candidate shortest path has been found to the
   // end node of this directed edge. Get total cost.
-  float c;
+  float c, secs;
   if (pred.predecessor() != kInvalidLabel) {
     // Get the start of the predecessor edge on the forward path. Cost is to
     // the end this edge, plus the cost to the end of the reverse predecessor,
     // plus the transition cost.
     c = edgelabels_forward_[pred.predecessor()].cost().cost + opp_pred.cost().cost +
         pred.transition_cost().cost;
+    secs = edgelabels_forward_[pred.predecessor()].cost().secs + opp_pred.cost().secs +
+           pred.transition_cost().secs;
   } else {
     // If no predecessor on the forward path get the predecessor on
     // the reverse path to form the cost.
     uint32_t predidx = opp_pred.predecessor();
     float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels_reverse_[predidx].cost().cost;
     c = pred.cost().cost + oppcost + opp_pred.transition_cost().cost;
+    float oppsecs = (predidx == kInvalidLabel) ? 0 : edgelabels_reverse_[predidx].cost().secs;
+    secs = pred.cost().secs + oppsecs + opp_pred.transition_cost().secs;
   }
 
   // Set thresholds to extend search
   if (cost_threshold_ == std::numeric_limits<float>::max() || c < best_connections_.front().cost) {
+    // the best connection so far is how long the route takes
+    duration_estimate_ = secs;
     if (desired_paths_count_ == 1) {
       cost_threshold_ = c + kThresholdDelta;
     } else {
@@ -859,8 +1210,11 @@ bool BidirectionalAStar::SetForwardConnection(GraphReader& graphreader, const BD
 
   // setting this edge as connected
   if (expansion_callback_) {
-    expansion_callback_(graphreader, pred.edgeid(), "bidirectional_astar", "c", pred.cost().secs,
-                        pred.path_distance(), pred.cost().cost);
+    auto prev_pred = pred.predecessor() == kInvalidLabel
+                         ? GraphId{}
+                         : edgelabels_forward_[pred.predecessor()].edgeid();
+    expansion_callback_(graphreader, pred.edgeid(), prev_pred, "bidirectional_astar", "c",
+                        pred.cost().secs, pred.path_distance(), pred.cost().cost);
   }
 
   return true;
@@ -891,23 +1245,29 @@ bool BidirectionalAStar::SetReverseConnection(GraphReader& graphreader, const BD
 
   // Get the opposing edge - a candidate shortest path has been found to the
   // end node of this directed edge. Get total cost.
-  float c;
+  float c, secs;
   if (rev_pred.predecessor() != kInvalidLabel) {
     // Get the start of the predecessor edge on the reverse path. Cost is to
     // the end this edge, plus the cost to the end of the forward predecessor,
     // plus the transition cost.
     c = edgelabels_reverse_[rev_pred.predecessor()].cost().cost + fwd_pred.cost().cost +
         rev_pred.transition_cost().cost;
+    secs = edgelabels_reverse_[rev_pred.predecessor()].cost().secs + fwd_pred.cost().secs +
+           rev_pred.transition_cost().secs;
   } else {
     // If no predecessor on the reverse path get the predecessor on
     // the forward path to form the cost.
     uint32_t predidx = fwd_pred.predecessor();
     float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels_forward_[predidx].cost().cost;
     c = rev_pred.cost().cost + oppcost + fwd_pred.transition_cost().cost;
+    float oppsecs = (predidx == kInvalidLabel) ? 0 : edgelabels_forward_[predidx].cost().secs;
+    secs = rev_pred.cost().secs + oppsecs + fwd_pred.transition_cost().secs;
   }
 
   // Set thresholds to extend search
   if (cost_threshold_ == std::numeric_limits<float>::max() || c < best_connections_.front().cost) {
+    // the best connection so far is how long the route takes
+    duration_estimate_ = secs;
     if (desired_paths_count_ == 1) {
       cost_threshold_ = c + kThresholdDelta;
     } else {
@@ -928,8 +1288,11 @@ bool BidirectionalAStar::SetReverseConnection(GraphReader& graphreader, const BD
 
   // setting this edge as connected, sending the opposing because this is the reverse tree
   if (expansion_callback_) {
-    expansion_callback_(graphreader, fwd_edge_id, "bidirectional_astar", "c", fwd_pred.cost().secs,
-                        fwd_pred.path_distance(), fwd_pred.cost().cost);
+    auto prev_pred = fwd_pred.predecessor() == kInvalidLabel
+                         ? GraphId{}
+                         : edgelabels_forward_[fwd_pred.predecessor()].edgeid();
+    expansion_callback_(graphreader, fwd_edge_id, prev_pred, "bidirectional_astar", "c",
+                        fwd_pred.cost().secs, fwd_pred.path_distance(), fwd_pred.cost().cost);
   }
 
   return true;
@@ -972,6 +1335,8 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
     if (!endtile) {
       continue;
     }
+    // The reverse search reaches the origin through the end node
+    astarheuristic_reverse_.AddTarget(directededge->endnode());
 
     // Get cost and sort cost (based on distance from endnode of this edge
     // to the destination
@@ -1009,8 +1374,8 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
 
     // setting this edge as reached
     if (expansion_callback_) {
-      expansion_callback_(graphreader, edgeid, "bidirectional_astar", "r", cost.secs, edge.distance(),
-                          cost.cost);
+      expansion_callback_(graphreader, edgeid, GraphId{}, "bidirectional_astar", "r", cost.secs,
+                          edge.distance(), cost.cost);
     }
 
     // Set the initial not_thru flag to false. There is an issue with not_thru
@@ -1067,6 +1432,8 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
     if (!opp_dir_edge) {
       continue;
     }
+    // The forward search reaches the destination through the begin node
+    astarheuristic_forward_.AddTarget(opp_dir_edge->endnode());
 
     // Get cost and sort cost (based on distance from endnode of this edge
     // to the origin. Make sure we use the reverse A* heuristic. Use the
@@ -1103,8 +1470,8 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
 
     // setting this edge as reached, sending the opposing because this is the reverse tree
     if (expansion_callback_) {
-      expansion_callback_(graphreader, edgeid, "bidirectional_astar", "r", cost.secs, edge.distance(),
-                          cost.cost);
+      expansion_callback_(graphreader, edgeid, GraphId{}, "bidirectional_astar", "r", cost.secs,
+                          edge.distance(), cost.cost);
     }
 
     // Set the initial not_thru flag to false. There is an issue with not_thru
@@ -1123,6 +1490,7 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
                                                                 const valhalla::Location& origin,
                                                                 const valhalla::Location& dest,
                                                                 const baldr::TimeInfo& time_info) {
+  search_timer_.phase(SearchPhase::path);
   LOG_DEBUG("Found connections before stretch filter: " + std::to_string(best_connections_.size()));
 
   if (desired_paths_count_ > 1) {
@@ -1132,6 +1500,8 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
   }
   // For looking up edge ids on previously chosen best paths
   std::vector<std::unordered_set<GraphId>> shared_edgeids;
+  // and their labels, to reject candidates before recovering their paths
+  std::vector<LabelPath> label_paths;
 
   // get maximum amount of sharing parameter based on origin->destination distance
   float max_sharing = desired_paths_count_ > 1 ? get_max_sharing(origin, dest) : 0.f;
@@ -1175,6 +1545,14 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     uint32_t idx1 = edgestatus_forward_.Get(best_connection->edgeid).index();
     uint32_t idx2 = edgestatus_reverse_.Get(best_connection->opp_edgeid).index();
 
+    // Alternates that share too much with the chosen paths or make too long a detour can be told
+    // from their labels, without recovering and recosting them
+    if (!paths.empty() &&
+        !validate_alternate_by_labels(label_paths, paths, edgelabels_forward_, edgelabels_reverse_,
+                                      idx1, idx2, max_sharing)) {
+      continue;
+    }
+
     // Metrics (TODO - more accurate cost)
     uint32_t pathcost = edgelabels_forward_[idx1].cost().cost + edgelabels_reverse_[idx2].cost().cost;
     LOG_DEBUG("path_cost::" + std::to_string(pathcost));
@@ -1280,8 +1658,18 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     //   to circumvent the closed edge(s)
     try {
       bool invariant = options.date_time_type() == Options::invariant;
+      // An arrive by route departs the expected duration before the arrival, the recost gives the
+      // times the route really takes from there
+      auto departure = time_info;
+      if (time_dependent_search_ && !time_from_origin_) {
+        graph_tile_ptr tile;
+        const auto* edge = graphreader.directededge(path_edges.front(), tile);
+        departure = time_info.reverse(duration_estimate_,
+                                      edge ? graphreader.GetTimezone(edge->endnode(), tile)
+                                           : static_cast<int>(time_info.timezone_index));
+      }
       sif::recost_forward(graphreader, *costing_, edge_cb, label_cb, source_pct, target_pct,
-                          time_info, invariant, true);
+                          departure, invariant, true);
     } catch (const std::exception& e) {
       LOG_ERROR(std::string("Bi-directional astar failed to recost final path: ") + e.what());
       continue;
@@ -1292,6 +1680,10 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
                           validate_alternate_by_stretch(paths.front(), path) &&
                           validate_alternate_by_local_optimality(path))) {
       paths.emplace_back(std::move(path));
+      if (paths.size() < desired_paths_count_) {
+        label_paths.emplace_back(
+            get_label_path(graphreader, edgelabels_forward_, edgelabels_reverse_, idx1, idx2));
+      }
     }
   }
   // give back the paths
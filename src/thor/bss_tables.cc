@@ -0,0 +1,205 @@
+#include "thor/bss_tables.h"
+#include "baldr/graphconstants.h"
+#include "midgard/logging.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// the options of the costing within a bikeshare request which doesn't specify any
+std::string default_costing_options(const valhalla::Costing::Type type) {
+  valhalla::Api api;
+  valhalla::ParseApi(
+      R"({"costing":"bikeshare","locations":[{"lat":0,"lon":0},{"lat":0,"lon":0}]})",
+      valhalla::Options::route, api);
+  return api.options().costings().find(type)->second.options().SerializeAsString();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::shared_ptr<const BssTables> LoadBssTables(GraphReader& reader) {
+  std::shared_ptr<const BssTables> tables;
+  try {
+    tables = BssTables::Load(BssTables::file_name(reader.tile_dir()));
+  } catch (const std::exception& e) {
+    LOG_WARN(std::string("Not using bike share tables: ") + e.what());
+    return nullptr;
+  }
+
+  // tables from another build of the tiles would ride the wrong edges
+  auto tile = tables->station_count() ? reader.GetGraphTile(tables->station(0)) : nullptr;
+  if (!tile || tile->header()->dataset_id() != tables->dataset_id()) {
+    LOG_WARN("Bike share tables do not match the tiles, not using them");
+    return nullptr;
+  }
+
+  LOG_INFO("Loaded bike share tables with " + std::to_string(tables->station_count()) +
+           " stations and " + std::to_string(tables->ride_count()) + " rides");
+  return tables;
+}
+
+bool BssTablesApplicable(const Options& options) {
+  static const std::string pedestrian_defaults = default_costing_options(Costing::pedestrian);
+  static const std::string bicycle_defaults = default_costing_options(Costing::bicycle);
+
+  // the tables have no notion of avoids
+  if (options.exclude_locations_size() > 0 || options.exclude_polygons_size() > 0) {
+    return false;
+  }
+
+  // and were costed with the default options
+  auto is_default = [&options](const Costing::Type type, const std::string& defaults) {
+    auto costing = options.costings().find(type);
+    return costing != options.costings().end() &&
+           costing->second.options().exclude_edges_size() == 0 &&
+           costing->second.options().SerializeAsString() == defaults;
+  };
+  return is_default(Costing::pedestrian, pedestrian_defaults) &&
+         is_default(Costing::bicycle, bicycle_defaults);
+}
+
+std::vector<BssStationSearch::ride_t> BssStationSearch::Expand(GraphReader& reader,
+                                                               const DynamicCost& bicycle,
+                                                               const GraphId& station,
+                                                               const float max_secs,
+                                                               const GraphId& last_edge) {
+  max_secs_ = max_secs;
+  labels_.clear();
+  settled_.clear();
+  edges_.clear();
+  queue_ = {};
+
+  std::vector<ride_t> rides;
+  graph_tile_ptr tile = reader.GetGraphTile(station);
+  if (tile == nullptr || tile->node(station)->edge_count() == 0) {
+    return rides;
+  }
+
+  // the rider walked in on the first connection of the station, the turn onto the bicycle
+  // hardly depends on which one it was
+  GraphId connection(station.tileid(), station.level(), tile->node(station)->edge_index());
+  graph_tile_ptr opp_tile = tile;
+  GraphId walked_in = reader.GetOpposingEdgeId(connection, opp_tile);
+  if (!walked_in.Is_Valid()) {
+    return rides;
+  }
+  const EdgeLabel walk(kInvalidLabel, walked_in, opp_tile->directededge(walked_in), Cost{}, 0.f,
+                       0.f, travel_mode_t::kPedestrian, 0, Cost{}, kInvalidRestriction, true, false,
+                       InternalTurn::kNoTurn);
+  Relax(reader, bicycle, station, walk, kInvalidLabel, false);
+
+  std::vector<GraphId> reached;
+  while (!queue_.empty()) {
+    const auto next = queue_.top();
+    queue_.pop();
+    if (settled_[next.second] || next.first > labels_[next.second].cost().cost) {
+      continue;
+    }
+    settled_[next.second] = true;
+
+    // the first label to settle at a station is the cheapest ride to it
+    const EdgeLabel pred = labels_[next.second];
+    if (last_edge.Is_Valid()) {
+      if (pred.edgeid() == last_edge) {
+        rides.push_back({pred.endnode(), next.second});
+        break;
+      }
+    } else if (pred.endnode() != station &&
+               std::find(reached.begin(), reached.end(), pred.endnode()) == reached.end()) {
+      tile = reader.GetGraphTile(pred.endnode());
+      if (tile != nullptr && tile->node(pred.endnode())->type() == NodeType::kBikeShare) {
+        reached.push_back(pred.endnode());
+        rides.push_back({pred.endnode(), next.second});
+      }
+    }
+    Relax(reader, bicycle, pred.endnode(), pred, next.second, false);
+  }
+  return rides;
+}
+
+void BssStationSearch::Relax(GraphReader& reader,
+                             const DynamicCost& bicycle,
+                             const GraphId& node,
+                             const EdgeLabel& pred,
+                             const uint32_t pred_idx,
+                             const bool from_transition) {
+  graph_tile_ptr tile = reader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+  if (!bicycle.Allowed(nodeinfo)) {
+    return;
+  }
+
+  // the ride ends at a station, there is no riding on through it
+  if (nodeinfo->type() == NodeType::kBikeShare && pred_idx != kInvalidLabel) {
+    return;
+  }
+
+  GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+    if (directededge->is_shortcut()) {
+      continue;
+    }
+
+    uint8_t restriction_idx = kInvalidRestriction;
+    if (!bicycle.Allowed(directededge, false, pred, tile, edgeid, 0, 0, restriction_idx) ||
+        bicycle.Restricted(directededge, pred, labels_, tile, edgeid, true)) {
+      continue;
+    }
+
+    const Cost transition_cost = bicycle.TransitionCost(directededge, nodeinfo, pred);
+    const Cost newcost = pred.cost() + bicycle.EdgeCost(directededge, tile) + transition_cost;
+    if (newcost.secs > max_secs_) {
+      continue;
+    }
+
+    auto found = edges_.find(edgeid);
+    if (found != edges_.end()) {
+      EdgeLabel& label = labels_[found->second];
+      if (!settled_[found->second] && newcost.cost < label.cost().cost) {
+        label.Update(pred_idx, newcost, newcost.cost, transition_cost, restriction_idx);
+        queue_.emplace(newcost.cost, found->second);
+      }
+      continue;
+    }
+
+    const uint32_t idx = labels_.size();
+    labels_.emplace_back(pred_idx, edgeid, directededge, newcost, newcost.cost, 0.f,
+                         travel_mode_t::kBicycle, pred.path_distance() + directededge->length(),
+                         transition_cost, restriction_idx, true, false, InternalTurn::kNoTurn);
+    settled_.push_back(false);
+    edges_.emplace(edgeid, idx);
+    queue_.emplace(newcost.cost, idx);
+  }
+
+  // Handle transitions - expand from the end node of each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      Relax(reader, bicycle, trans->endnode(), pred, pred_idx, true);
+    }
+  }
+}
+
+std::vector<EdgeLabel> BssStationSearch::Path(const uint32_t label) const {
+  std::vector<EdgeLabel> path;
+  for (uint32_t idx = label; idx != kInvalidLabel; idx = labels_[idx].predecessor()) {
+    path.push_back(labels_[idx]);
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,376 @@
+#include "thor/bucketmatrix.h"
+#include "baldr/time_info.h"
+#include "midgard/logging.h"
+#include "thor/costmatrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+// A search over the arcs going up in rank from the seeds of one location. The buffers are sized to
+// the overlay once and only the nodes a search touched are reset for the next one.
+class BucketMatrix::UpwardSearch {
+public:
+  /**
+   * Settles the nodes above the seeds that are cheaper than the threshold
+   * @param overlay    the overlay
+   * @param seeds      where the location joins or leaves the overlay
+   * @param forward    whether to search from a source or towards a target
+   * @param threshold  nodes more expensive than this are not settled
+   * @param visit      called with each settled node and its cost, time and length
+   */
+  template <class visit_t>
+  void Run(const ContractionOverlay& overlay,
+           const std::vector<seed_t>& seeds,
+           const bool forward,
+           const float threshold,
+           const visit_t& visit) {
+    Reset(overlay.node_count());
+    for (const auto& seed : seeds) {
+      Relax(seed.node, seed.cost, seed.secs, seed.length, threshold);
+    }
+
+    while (!queue_.empty()) {
+      const auto label = queue_.top();
+      queue_.pop();
+      const uint32_t node = label.second;
+      if (label.first > costs_[node]) {
+        continue;
+      }
+
+      // stall on demand: a higher ranked node the search already reached has a cheaper way to
+      // this node, so no shortest path meets here and nothing above it is worth expanding
+      auto higher = forward ? overlay.down(node) : overlay.up(node);
+      bool stalled = false;
+      for (auto* index = higher.first; index != higher.second && !stalled; ++index) {
+        const auto& arc = overlay.arc(*index);
+        const uint32_t other = forward ? arc.from : arc.to;
+        stalled = costs_[other] != kUnreached && costs_[other] + arc.cost < label.first;
+      }
+      if (stalled) {
+        continue;
+      }
+      visit(node, label.first, secs_[node], lengths_[node]);
+
+      // forward relaxes arcs leaving towards higher ranks, reverse those entering from higher ranks
+      auto adjacent = forward ? overlay.up(node) : overlay.down(node);
+      for (auto* index = adjacent.first; index != adjacent.second; ++index) {
+        const auto& arc = overlay.arc(*index);
+        Relax(forward ? arc.to : arc.from, label.first + arc.cost, secs_[node] + arc.secs,
+              lengths_[node] + arc.length, threshold);
+      }
+    }
+  }
+
+protected:
+  static constexpr float kUnreached = std::numeric_limits<float>::max();
+
+  using queue_t = std::priority_queue<std::pair<float, uint32_t>,
+                                      std::vector<std::pair<float, uint32_t>>,
+                                      std::greater<std::pair<float, uint32_t>>>;
+
+  void Reset(const size_t node_count) {
+    if (costs_.size() != node_count) {
+      costs_.assign(node_count, kUnreached);
+      secs_.resize(node_count);
+      lengths_.resize(node_count);
+    } else {
+      for (auto node : touched_) {
+        costs_[node] = kUnreached;
+      }
+    }
+    touched_.clear();
+    queue_ = queue_t();
+  }
+
+  void Relax(const uint32_t node,
+             const float cost,
+             const float secs,
+             const float length,
+             const float threshold) {
+    if (cost > threshold || cost >= costs_[node]) {
+      return;
+    }
+    if (costs_[node] == kUnreached) {
+      touched_.push_back(node);
+    }
+    costs_[node] = cost;
+    secs_[node] = secs;
+    lengths_[node] = length;
+    queue_.emplace(cost, node);
+  }
+
+  std::vector<float> costs_;
+  std::vector<float> secs_;
+  std::vector<float> lengths_;
+  std::vector<uint32_t> touched_;
+  queue_t queue_;
+};
+
+BucketMatrix::BucketMatrix(const boost::property_tree::ptree& config,
+                           const boost::property_tree::ptree& reader_config)
+    : thread_count_(std::max(config.get<uint32_t>("bucketmatrix_threads", 1), 1u)),
+      reader_config_(reader_config) {
+  if (reader_config_.empty()) {
+    thread_count_ = 1;
+  }
+}
+
+BucketMatrix::~BucketMatrix() {
+}
+
+bool BucketMatrix::Applicable(const Options& options, const ContractionOverlay& overlay) {
+  const auto level = overlay.level();
+  auto on_level = [level](const valhalla::Location& location) {
+    return location.date_time().empty() &&
+           std::any_of(location.correlation().edges().begin(), location.correlation().edges().end(),
+                       [level](const valhalla::PathEdge& edge) {
+                         return GraphId(edge.graph_id()).level() == level;
+                       });
+  };
+  return std::all_of(options.sources().begin(), options.sources().end(), on_level) &&
+         std::all_of(options.targets().begin(), options.targets().end(), on_level);
+}
+
+float BucketMatrix::GetCostThreshold(const travel_mode_t mode, const float max_matrix_distance) {
+  float cost_threshold;
+  switch (mode) {
+    case travel_mode_t::kBicycle:
+      cost_threshold = max_matrix_distance / kCostThresholdBicycleDivisor;
+      break;
+    case travel_mode_t::kPedestrian:
+    case travel_mode_t::kPublicTransit:
+      cost_threshold = max_matrix_distance / kCostThresholdPedestrianDivisor;
+      break;
+    case travel_mode_t::kDrive:
+    default:
+      cost_threshold = max_matrix_distance / kCostThresholdAutoDivisor;
+  }
+
+  // Same leeway as CostMatrix so requests near the max distance succeed
+  return cost_threshold * 2.0f;
+}
+
+void BucketMatrix::Seed(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                        const ContractionOverlay& overlay,
+                        GraphReader& graphreader,
+                        const DynamicCost& costing,
+                        const bool is_source) {
+  auto& seeds = is_source ? source_seeds_ : target_seeds_;
+  seeds.resize(locations.size());
+  for (auto& location_seeds : seeds) {
+    location_seeds.clear();
+  }
+  if (is_source) {
+    source_edges_.resize(locations.size());
+    for (auto& edges : source_edges_) {
+      edges.clear();
+    }
+  } else {
+    target_edges_.clear();
+  }
+
+  for (uint32_t index = 0; index < static_cast<uint32_t>(locations.size()); ++index) {
+    for (const auto& candidate : locations.Get(index).correlation().edges()) {
+      GraphId edgeid(candidate.graph_id());
+      if (edgeid.level() != overlay.level()) {
+        continue;
+      }
+      graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+      if (tile == nullptr) {
+        continue;
+      }
+      const DirectedEdge* edge = tile->directededge(edgeid);
+      if (!costing.Allowed(edge, tile, kDisallowShortcut)) {
+        continue;
+      }
+
+      uint8_t flow_sources;
+      const auto cost = costing.EdgeCost(edge, tile, TimeInfo::invalid(), flow_sources);
+      const on_edge_t on_edge{index, static_cast<float>(candidate.percent_along()),
+                              static_cast<float>(candidate.distance()), cost.cost, cost.secs,
+                              static_cast<float>(edge->length())};
+      if (is_source) {
+        source_edges_[index].emplace_back(edgeid.value, on_edge);
+      } else {
+        target_edges_[edgeid.value].push_back(on_edge);
+      }
+
+      // sources leave the overlay at the end of the edge, targets join it at the beginning
+      graph_tile_ptr node_tile = tile;
+      const auto node = overlay.node_index(is_source ? edge->endnode()
+                                                     : graphreader.GetBeginNodeId(edge, node_tile));
+      if (node == kInvalidContractionNode) {
+        continue;
+      }
+      const float pct = is_source ? 1.f - on_edge.percent_along : on_edge.percent_along;
+      seeds[index].push_back({node, on_edge.cost * pct + on_edge.penalty, on_edge.secs * pct,
+                              on_edge.length * pct});
+    }
+  }
+}
+
+void BucketMatrix::Run(const uint32_t count,
+                       const std::function<void(const uint32_t, const uint32_t)>& search,
+                       GraphReader& graphreader) {
+  const uint32_t threads = searches_.size();
+  if (pool_ && count > 1) {
+    pool_->run(
+        threads,
+        [threads, count, &search](const uint32_t thread, GraphReader&) {
+          for (uint32_t i = thread; i < count; i += threads) {
+            search(i, thread);
+          }
+        },
+        graphreader);
+    return;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    search(i, 0);
+  }
+}
+
+void BucketMatrix::Compute(const ContractionOverlay& overlay,
+                           const float threshold,
+                           GraphReader& graphreader) {
+  const uint32_t source_count = source_seeds_.size();
+  const uint32_t target_count = target_seeds_.size();
+
+  // Lazily start the helper threads the first time a matrix is asked for
+  if (searches_.empty()) {
+    for (uint32_t i = 0; i < thread_count_; ++i) {
+      searches_.emplace_back(new UpwardSearch);
+    }
+    if (thread_count_ > 1) {
+      pool_.reset(new SearchPool(thread_count_, reader_config_));
+    }
+  }
+
+  // Search up from every target and note its costs at each node it settles
+  found_.resize(searches_.size());
+  Run(
+      target_count,
+      [&](const uint32_t target, const uint32_t thread) {
+        searches_[thread]->Run(overlay, target_seeds_[target], false, threshold,
+                               [&](const uint32_t node, const float cost, const float secs,
+                                   const float length) {
+                                 found_[thread].emplace_back(node,
+                                                             entry_t{target, cost, secs, length});
+                               });
+      },
+      graphreader);
+
+  // Sort the entries into a bucket per node
+  bucket_offsets_.assign(overlay.node_count() + 1, 0);
+  size_t entry_count = 0;
+  for (const auto& found : found_) {
+    for (const auto& entry : found) {
+      ++bucket_offsets_[entry.first + 1];
+    }
+    entry_count += found.size();
+  }
+  for (size_t i = 1; i < bucket_offsets_.size(); ++i) {
+    bucket_offsets_[i] += bucket_offsets_[i - 1];
+  }
+  buckets_.resize(entry_count);
+  std::vector<uint32_t> fill(bucket_offsets_.begin(), bucket_offsets_.end() - 1);
+  for (auto& found : found_) {
+    for (const auto& entry : found) {
+      buckets_[fill[entry.first]++] = entry.second;
+    }
+    found.clear();
+  }
+
+  // Search up from every source, the buckets of the nodes it settles hold the targets it meets
+  costs_.assign(static_cast<size_t>(source_count) * target_count, kMaxCost);
+  times_.assign(costs_.size(), kMaxCost);
+  distances_.assign(costs_.size(), 0.f);
+  Run(
+      source_count,
+      [&](const uint32_t source, const uint32_t thread) {
+        const size_t row = static_cast<size_t>(source) * target_count;
+        auto update = [&](const uint32_t target, const float cost, const float secs,
+                          const float length) {
+          if (cost < costs_[row + target]) {
+            costs_[row + target] = cost;
+            times_[row + target] = secs;
+            distances_[row + target] = length;
+          }
+        };
+        searches_[thread]->Run(overlay, source_seeds_[source], true, threshold,
+                               [&](const uint32_t node, const float cost, const float secs,
+                                   const float length) {
+                                 for (uint32_t i = bucket_offsets_[node];
+                                      i < bucket_offsets_[node + 1]; ++i) {
+                                   const auto& entry = buckets_[i];
+                                   update(entry.target, cost + entry.cost, secs + entry.secs,
+                                          length + entry.length);
+                                 }
+                               });
+
+        // targets further along the edge of the source don't need the overlay
+        for (const auto& candidate : source_edges_[source]) {
+          auto found = target_edges_.find(candidate.first);
+          if (found == target_edges_.end()) {
+            continue;
+          }
+          const auto& from = candidate.second;
+          for (const auto& to : found->second) {
+            if (to.percent_along >= from.percent_along) {
+              const float pct = to.percent_along - from.percent_along;
+              update(to.location, from.cost * pct + from.penalty + to.penalty, from.secs * pct,
+                     from.length * pct);
+            }
+          }
+        }
+      },
+      graphreader);
+}
+
+void BucketMatrix::SourceToTarget(Api& request,
+                                  GraphReader& graphreader,
+                                  const sif::mode_costing_t& mode_costing,
+                                  const sif::travel_mode_t mode,
+                                  const ContractionOverlay& overlay,
+                                  const float max_matrix_distance) {
+  LOG_INFO("matrix::BucketMatrix");
+  request.mutable_matrix()->set_algorithm(Matrix::BucketMatrix);
+
+  const auto& costing = *mode_costing[static_cast<uint32_t>(mode)];
+  const uint32_t target_count = request.options().targets().size();
+  Seed(request.options().sources(), overlay, graphreader, costing, true);
+  Seed(request.options().targets(), overlay, graphreader, costing, false);
+  Compute(overlay, GetCostThreshold(mode, max_matrix_distance), graphreader);
+
+  // Form the matrix PBF output
+  valhalla::Matrix& matrix = *request.mutable_matrix();
+  reserve_pbf_arrays(matrix, costs_.size());
+  for (uint32_t count = 0; count < costs_.size(); ++count) {
+    matrix.mutable_from_indices()->Set(count, count / target_count);
+    matrix.mutable_to_indices()->Set(count, count % target_count);
+    matrix.mutable_distances()->Set(count, static_cast<uint32_t>(std::round(distances_[count])));
+    matrix.mutable_times()->Set(count, times_[count] == kMaxCost ? kMaxCost : times_[count] + .5f);
+    matrix.mutable_date_times()->Add();
+  }
+}
+
+void BucketMatrix::clear() {
+  source_seeds_.clear();
+  target_seeds_.clear();
+  source_edges_.clear();
+  target_edges_.clear();
+  buckets_.clear();
+  costs_.clear();
+  times_.clear();
+  distances_.clear();
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,10 +1,40 @@
 #include "thor/centroid.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
 
 namespace {
 
+// the cost the parallel searches go up to in their first round, each round goes further by this
+// factor so that long expansions don't need many rounds
+constexpr float kFirstRoundCost = 300.f;
+constexpr float kRoundGrowth = 1.5f;
+
+// the initial number of slots of the intersection table the parallel searches share
+constexpr size_t kSharedIntersectionsCapacity = 1 << 16;
+
+/**
+ * Gets the opposing edge of the edge of a label
+ *
+ * @param reader  provides access to graph primitives
+ * @param label   the label
+ * @return the opposing edge id, invalid if the end node of the edge isn't available
+ */
+valhalla::baldr::GraphId opposing_edge_id(valhalla::baldr::GraphReader& reader,
+                                          const valhalla::sif::EdgeLabel& label) {
+  valhalla::baldr::graph_tile_ptr tile;
+  valhalla::baldr::GraphId opp_id;
+  if (const auto* node = reader.nodeinfo(label.endnode(), tile)) {
+    opp_id = tile->header()->graphid();
+    opp_id.set_id(node->edge_index() + label.opp_index());
+  }
+  return opp_id;
+}
+
 /**
  * Constructs a path location as the mid point of an edge
  *
@@ -69,9 +99,9 @@ PathIntersection::PathIntersection(uint64_t edge_id, uint64_t opp_id, uint8_t lo
 bool PathIntersection::AddPath(uint8_t path_id) const {
   assert(path_id < 128);
   if (path_id < 64) {
-    lower_mask_ |= 1 << static_cast<uint64_t>(path_id);
+    lower_mask_ |= 1ull << static_cast<uint64_t>(path_id);
   } else {
-    upper_mask_ |= 1 << static_cast<uint64_t>(path_id - 64);
+    upper_mask_ |= 1ull << static_cast<uint64_t>(path_id - 64);
   }
   // this will only be true once all the bits are flipped to true
   return (lower_mask_ & upper_mask_) == 0xffffffffffffffff;
@@ -81,9 +111,9 @@ bool PathIntersection::AddPath(uint8_t path_id) const {
 bool PathIntersection::HasConverged(uint8_t path_id) const {
   assert(path_id < 128);
   if (path_id < 64) {
-    return lower_mask_ & (1 << static_cast<uint64_t>(path_id));
+    return lower_mask_ & (1ull << static_cast<uint64_t>(path_id));
   } else {
-    return upper_mask_ & (1 << static_cast<uint64_t>(path_id - 64));
+    return upper_mask_ & (1ull << static_cast<uint64_t>(path_id - 64));
   }
 }
 
@@ -92,6 +122,203 @@ bool PathIntersection::operator==(const PathIntersection& i) const {
   return edge_id_ == i.edge_id_;
 }
 
+// empty the table for the next expansion
+void SharedIntersections::reset(uint8_t location_count, size_t capacity) {
+  location_count_ = location_count;
+  size_.store(0, std::memory_order_relaxed);
+  if (capacity_ != capacity) {
+    slots_.reset(new Slot[capacity]());
+    capacity_ = capacity;
+    return;
+  }
+  for (size_t i = 0; i < capacity_; ++i) {
+    auto& slot = slots_[i];
+    slot.key.store(0, std::memory_order_relaxed);
+    slot.mask[0].store(0, std::memory_order_relaxed);
+    slot.mask[1].store(0, std::memory_order_relaxed);
+    slot.cost.store(0, std::memory_order_relaxed);
+    slot.arrived.store(0, std::memory_order_relaxed);
+  }
+}
+
+// find the slot of the key or take a free one for it
+SharedIntersections::Slot& SharedIntersections::claim(uint64_t key) {
+  const size_t mask = capacity_ - 1;
+  for (size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;;
+       i = (i + 1) & mask) {
+    auto& slot = slots_[i];
+    auto current = slot.key.load(std::memory_order_acquire);
+    if (current == 0 &&
+        slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+      size_.fetch_add(1, std::memory_order_relaxed);
+      return slot;
+    }
+    // either it was ours already or another search just claimed it for the same key
+    if (current == key) {
+      return slot;
+    }
+  }
+}
+
+// mark the path as converged and check if it was the last one
+bool SharedIntersections::AddPath(uint64_t edge_id, uint8_t path_id, float cost, float& max_cost) {
+  auto& slot = claim(edge_id + 1);
+  const uint64_t bit = 1ull << (path_id & 63);
+  if (slot.mask[path_id >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) {
+    return false;
+  }
+
+  // costs aren't negative so their bits are ordered the same way they are
+  uint32_t bits;
+  std::memcpy(&bits, &cost, sizeof(bits));
+  auto highest = slot.cost.load(std::memory_order_relaxed);
+  while (highest < bits &&
+         !slot.cost.compare_exchange_weak(highest, bits, std::memory_order_relaxed)) {
+  }
+
+  // the path that arrives last sees the costs of all the others
+  if (slot.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 < location_count_) {
+    return false;
+  }
+  bits = slot.cost.load(std::memory_order_relaxed);
+  std::memcpy(&max_cost, &bits, sizeof(max_cost));
+  return true;
+}
+
+// rehash into twice the slots
+void SharedIntersections::grow() {
+  std::unique_ptr<Slot[]> old(new Slot[capacity_ * 2]());
+  std::swap(old, slots_);
+  const auto old_capacity = capacity_;
+  capacity_ *= 2;
+  size_.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < old_capacity; ++i) {
+    const auto& from = old[i];
+    const auto key = from.key.load(std::memory_order_relaxed);
+    if (key == 0) {
+      continue;
+    }
+    auto& to = claim(key);
+    to.mask[0].store(from.mask[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    to.mask[1].store(from.mask[1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    to.cost.store(from.cost.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    to.arrived.store(from.arrived.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+}
+
+// The expansion of a single location. It settles its labels in rounds, each round ends once it
+// settled a label past the cost bound of the round, past the cheapest intersection found so far or
+// when the shared intersection table needs to grow. The queue is left as it is between rounds.
+class Centroid::LocationSearch : public Dijkstras {
+public:
+  LocationSearch(Centroid& centroid, const boost::property_tree::ptree& config)
+      : Dijkstras(config), centroid_(centroid), path_id_(0), bound_(0), frontier_(0),
+        paused_(false), exhausted_(true) {
+  }
+
+  // seed the expansion at the location
+  void Start(const ExpansionType expansion_type,
+             const valhalla::Location& location,
+             const uint8_t path_id,
+             baldr::GraphReader& reader,
+             const sif::mode_costing_t& costings,
+             const sif::TravelMode mode,
+             const baldr::TimeInfo& time_info) {
+    expansion_type_ = expansion_type;
+    path_id_ = path_id;
+    time_info_ = time_info;
+    mode_ = mode;
+    costing_ = costings[static_cast<uint32_t>(mode_)];
+    access_mode_ = costing_->access_mode();
+
+    locations_.Clear();
+    locations_.Add()->CopyFrom(location);
+    Initialize(bdedgelabels_, adjacencylist_, costing_->UnitSize());
+    if (expansion_type_ == ExpansionType::forward) {
+      SetOriginLocations(reader, locations_, costing_);
+    } else {
+      SetDestinationLocations(reader, locations_, costing_);
+    }
+    frontier_ = 0;
+    exhausted_ = false;
+  }
+
+  // settle labels until the round is over for this search
+  void Run(baldr::GraphReader& reader, const float bound) {
+    if (exhausted_) {
+      return;
+    }
+    bound_ = bound;
+    paused_ = false;
+    if (expansion_type_ == ExpansionType::forward) {
+      Settle<ExpansionType::forward>(reader, time_info_);
+    } else {
+      Settle<ExpansionType::reverse>(reader, time_info_);
+    }
+    exhausted_ = !paused_;
+  }
+
+  // the cost of the last label settled, every label settled from here on costs at least as much
+  float frontier() const {
+    return exhausted_ ? std::numeric_limits<float>::max() : frontier_;
+  }
+
+  const EdgeStatus& edgestatus() const {
+    return edgestatus_;
+  }
+
+  const std::vector<sif::BDEdgeLabel>& labels() const {
+    return bdedgelabels_;
+  }
+
+protected:
+  void ExpandingNode(baldr::GraphReader&,
+                     graph_tile_ptr,
+                     const baldr::NodeInfo*,
+                     const sif::EdgeLabel&,
+                     const sif::EdgeLabel*) override {
+  }
+
+  ExpansionRecommendation ShouldExpand(baldr::GraphReader& reader,
+                                       const sif::EdgeLabel& label,
+                                       const ExpansionType) override {
+    centroid_.Converge(reader, label, path_id_);
+    frontier_ = label.cost().cost;
+    if (frontier_ > bound_ || frontier_ > centroid_.best_cost() ||
+        centroid_.shared_intersections_.crowded()) {
+      paused_ = true;
+      return ExpansionRecommendation::stop_expansion;
+    }
+    return ExpansionRecommendation::continue_expansion;
+  }
+
+  void GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const override {
+    bucket_count = 20000;
+    edge_label_reservation = kInitialEdgeLabelCountDijkstras;
+  }
+
+  Centroid& centroid_;
+  ExpansionType expansion_type_;
+  uint8_t path_id_;
+  baldr::TimeInfo time_info_;
+  google::protobuf::RepeatedPtrField<valhalla::Location> locations_;
+  float bound_;
+  float frontier_;
+  bool paused_;
+  bool exhausted_;
+};
+
+Centroid::Centroid(const boost::property_tree::ptree& config,
+                   const boost::property_tree::ptree& reader_config)
+    : Dijkstras(config), location_count_(0),
+      thread_count_(std::max(config.get<uint32_t>("centroid_threads", 1), 1u)), config_(config),
+      reader_config_(reader_config), parallel_(false),
+      best_cost_(std::numeric_limits<float>::max()), best_edge_id_(baldr::kInvalidGraphId) {
+}
+
+Centroid::~Centroid() {
+}
+
 // main entry point to the functionality
 std::vector<std::vector<PathInfo>> Centroid::Expand(const ExpansionType& expansion_type,
                                                     valhalla::Api& api,
@@ -108,6 +335,15 @@ std::vector<std::vector<PathInfo>> Centroid::Expand(const ExpansionType& expansi
   best_intersection_ =
       PathIntersection{baldr::kInvalidGraphId, baldr::kInvalidGraphId, location_count_};
 
+  // expand each location on its own thread if there are threads for it, the expansion callback
+  // isn't meant to be called concurrently and multimodal expansions are always done in one go
+  parallel_ = thread_count_ > 1 && !reader_config_.empty() && location_count_ > 1 &&
+              expansion_type != ExpansionType::multimodal && !expansion_callback_;
+  if (parallel_) {
+    ExpandParallel(expansion_type, api, reader, costings, mode);
+    return FormPaths(expansion_type, api.options().locations(), bdedgelabels_, reader, centroid);
+  }
+
   // tell dijkstras we want to track the locations' paths separately/concurrently
   multipath_ = true;
 
@@ -118,6 +354,80 @@ std::vector<std::vector<PathInfo>> Centroid::Expand(const ExpansionType& expansi
   return FormPaths(expansion_type, api.options().locations(), bdedgelabels_, reader, centroid);
 }
 
+// expand every location on the search pool until no cheaper intersection can turn up
+void Centroid::ExpandParallel(const ExpansionType& expansion_type,
+                              valhalla::Api& api,
+                              baldr::GraphReader& reader,
+                              const sif::mode_costing_t& costings,
+                              const sif::TravelMode mode) {
+  if (!pool_) {
+    pool_.reset(new SearchPool(thread_count_, reader_config_));
+  }
+  while (searches_.size() < location_count_) {
+    searches_.emplace_back(new LocationSearch(*this, config_));
+  }
+  shared_intersections_.reset(location_count_, kSharedIntersectionsCapacity);
+  best_cost_.store(std::numeric_limits<float>::max(), std::memory_order_relaxed);
+  best_edge_id_ = baldr::kInvalidGraphId;
+
+  // like the single expansion every location expands with the time of the first one
+  auto& locations = *api.mutable_options()->mutable_locations();
+  auto time_infos = SetTime(locations, reader);
+  for (uint8_t i = 0; i < location_count_; ++i) {
+    searches_[i]->Start(expansion_type, locations.Get(i), i, reader, costings, mode,
+                        time_infos.front());
+  }
+
+  float bound = kFirstRoundCost;
+  const SearchPool::search_t run = [this, &bound](const uint32_t i, baldr::GraphReader& r) {
+    searches_[i]->Run(r, bound);
+  };
+  while (true) {
+    pool_->run(location_count_, run, reader);
+
+    // the searches only settle labels at or above their frontier from here on so an intersection
+    // all paths converge on later can't be cheaper than the cheapest frontier
+    float frontier = std::numeric_limits<float>::max();
+    for (uint8_t i = 0; i < location_count_; ++i) {
+      frontier = std::min(frontier, searches_[i]->frontier());
+    }
+    if (frontier == std::numeric_limits<float>::max() || best_cost() <= frontier) {
+      break;
+    }
+
+    // searches that stopped for the table to grow go on with the same bound
+    if (shared_intersections_.crowded()) {
+      shared_intersections_.grow();
+    } else {
+      bound *= kRoundGrowth;
+    }
+  }
+
+  // all the paths converged on the best intersection
+  if (best_edge_id_ != baldr::kInvalidGraphId) {
+    best_intersection_ = PathIntersection{best_edge_id_, best_edge_id_, location_count_};
+    for (uint8_t i = 0; i < location_count_; ++i) {
+      best_intersection_.AddPath(i);
+    }
+  }
+}
+
+// keep the intersection if its the cheapest one all paths converged on so far
+void Centroid::Converge(baldr::GraphReader& reader, const sif::EdgeLabel& label, uint8_t path_id) {
+  const uint64_t edge_id = std::min(static_cast<uint64_t>(label.edgeid()),
+                                    static_cast<uint64_t>(opposing_edge_id(reader, label)));
+  float max_cost;
+  if (!shared_intersections_.AddPath(edge_id, path_id, label.cost().cost, max_cost)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(best_mutex_);
+  const auto best = best_cost_.load(std::memory_order_relaxed);
+  if (max_cost < best || (max_cost == best && edge_id < best_edge_id_)) {
+    best_edge_id_ = edge_id;
+    best_cost_.store(max_cost, std::memory_order_relaxed);
+  }
+}
+
 // this is fired when the edge in the label has been settled (shortest path found) so we need to check
 // our intersections and add or update them
 thor::ExpansionRecommendation Centroid::ShouldExpand(baldr::GraphReader& reader,
@@ -127,16 +437,8 @@ thor::ExpansionRecommendation Centroid::ShouldExpand(baldr::GraphReader& reader,
 
   // TODO: refactor dijkstras a bit to get the tile and send it to us so we dont have to
 
-  // grab the opposing edge if you can
-  baldr::graph_tile_ptr tile;
-  baldr::GraphId opp_id;
-  if (const auto* node = reader.nodeinfo(label.endnode(), tile)) {
-    opp_id = tile->header()->graphid();
-    opp_id.set_id(node->edge_index() + label.opp_index());
-  }
-
-  // see if we have seen this edge before
-  PathIntersection intersection(label.edgeid(), opp_id, location_count_);
+  // see if we have seen this edge before, under the lesser id of it and its opposing edge
+  PathIntersection intersection(label.edgeid(), opposing_edge_id(reader, label), location_count_);
   auto found = intersections_.find(intersection);
 
   // if not we create the record
@@ -171,9 +473,66 @@ void Centroid::GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_re
 // deallocate and prepare for next request
 void Centroid::Clear() {
   intersections_.clear();
+  for (auto& search : searches_) {
+    search->Clear();
+  }
   Dijkstras::Clear();
 }
 
+// the label memory of the single expansion and of the parallel ones
+LabelMemory Centroid::label_memory() const {
+  auto memory = Dijkstras::label_memory();
+  for (const auto& search : searches_) {
+    memory += search->label_memory();
+  }
+  return memory;
+}
+
+// walk the edge labels of one location back from the centroid
+template <typename label_container_t>
+void Centroid::FormPath(const ExpansionType& expansion_type,
+                        const EdgeStatus& edgestatus,
+                        const label_container_t& labels,
+                        uint8_t path_id,
+                        const baldr::GraphId& edge_id,
+                        const baldr::GraphId& opp_id,
+                        baldr::GraphReader& reader,
+                        std::vector<PathInfo>& path) const {
+  // grab the edge statuses for both potential paths to two edges at the centroid
+  auto status = edgestatus.Get(edge_id, path_id);
+  auto opp_status = edgestatus.Get(opp_id, path_id);
+
+  // check the edge status for both edges and find the label that was on the cheapest path
+  // if the first status either wasnt settled (or even reached) or it was but it wasnt cheapest
+  // then we switch to using the opposing label as its a better path
+  auto label_index = status.index();
+  if (status.set() != EdgeSet::kPermanent ||
+      (opp_status.set() == EdgeSet::kPermanent &&
+       labels[opp_status.index()].cost().cost < labels[status.index()].cost().cost)) {
+    label_index = opp_status.index();
+  }
+
+  // recover the path from the centroid back to the locations edge candidate
+  graph_tile_ptr tile;
+  for (auto l = label_index; l != baldr::kInvalidLabel; l = labels[l].predecessor()) {
+    const auto& label = labels[l];
+    auto path_edge_id = expansion_type == ExpansionType::reverse
+                            ? reader.GetOpposingEdgeId(label.edgeid(), tile)
+                            : label.edgeid();
+    path.emplace_back(label.mode(), label.cost(), path_edge_id, 0, label.path_distance(),
+                      label.restriction_idx(), label.transition_cost());
+  }
+
+  // reverse the path since we recovered it starting at the beginning
+  if (expansion_type != ExpansionType::reverse)
+    std::reverse(path.begin(), path.end());
+
+  // TODO: the final edge in each path could be a long one we should probably pick the optimal spot
+  // along it to make all paths to it the most happy. for now we'll take the mid point
+  auto edge_cost = path.back().elapsed_cost - path.back().transition_cost;
+  path.back().elapsed_cost -= edge_cost * .5;
+}
+
 // walk edge labels to form paths for each location to the centroid
 template <typename label_container_t>
 std::vector<std::vector<PathInfo>>
@@ -205,38 +564,14 @@ Centroid::FormPaths(const ExpansionType& expansion_type,
       continue;
     path.reserve(path_reservation);
 
-    // grab the edge statuses for both potential paths to two edges at the centroid
-    auto status = edgestatus_.Get(edge_id, path_id);
-    auto opp_status = edgestatus_.Get(opp_id, path_id);
-
-    // check the edge status for both edges and find the label that was on the cheapest path
-    // if the first status either wasnt settled (or even reached) or it was but it wasnt cheapest
-    // then we switch to using the opposing label as its a better path
-    auto label_index = status.index();
-    if (status.set() != EdgeSet::kPermanent ||
-        (opp_status.set() == EdgeSet::kPermanent &&
-         labels[opp_status.index()].cost().cost < labels[status.index()].cost().cost)) {
-      label_index = opp_status.index();
-    }
-
-    // recover the path from the centroid back to the locations edge candidate
-    for (auto l = label_index; l != baldr::kInvalidLabel; l = labels[l].predecessor()) {
-      const auto& label = labels[l];
-      auto path_edge_id = expansion_type == ExpansionType::reverse
-                              ? reader.GetOpposingEdgeId(label.edgeid(), tile)
-                              : label.edgeid();
-      path.emplace_back(label.mode(), label.cost(), path_edge_id, 0, label.path_distance(),
-                        label.restriction_idx(), label.transition_cost());
+    // the parallel searches each expanded a single location
+    if (parallel_) {
+      const auto& search = *searches_[path_id];
+      FormPath(expansion_type, search.edgestatus(), search.labels(), 0, edge_id, opp_id, reader,
+               path);
+    } else {
+      FormPath(expansion_type, edgestatus_, labels, path_id, edge_id, opp_id, reader, path);
     }
-
-    // reverse the path since we recovered it starting at the beginning
-    if (expansion_type != ExpansionType::reverse)
-      std::reverse(path.begin(), path.end());
-
-    // TODO: the final edge in each path could be a long one we should probably pick the optimal spot
-    // along it to make all paths to it the most happy. for now we'll take the mid point
-    auto edge_cost = path.back().elapsed_cost - path.back().transition_cost;
-    path.back().elapsed_cost -= edge_cost * .5;
   }
 
   return paths;
@@ -0,0 +1,268 @@
+#include "thor/contraction.h"
+#include "baldr/directededge.h"
+#include "baldr/graphconstants.h"
+#include "baldr/time_info.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/recost.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// the options a request would get for the costing if it didn't specify any
+std::string default_costing_options(const valhalla::Costing::Type type) {
+  valhalla::Api api;
+  valhalla::ParseApi(R"({"costing":")" + valhalla::Costing_Enum_Name(type) +
+                         R"(","locations":[{"lat":0,"lon":0},{"lat":0,"lon":0}]})",
+                     valhalla::Options::route, api);
+  return api.options().costings().find(type)->second.options().SerializeAsString();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionPathAlgorithm::ContractionPathAlgorithm(const boost::property_tree::ptree& config)
+    : PathAlgorithm(0, config.get<bool>("clear_reserved_memory", false)) {
+}
+
+void ContractionPathAlgorithm::Load(const boost::property_tree::ptree& config,
+                                    baldr::GraphReader& reader) {
+  auto costings = config.get_child_optional("mjolnir.contraction.costings");
+  if (!costings) {
+    return;
+  }
+
+  for (const auto& costing_name : *costings) {
+    const auto name = costing_name.second.get_value<std::string>();
+    Costing::Type type;
+    if (!Costing_Enum_Parse(name, &type)) {
+      LOG_WARN("Unknown costing for contraction overlay: " + name);
+      continue;
+    }
+
+    std::shared_ptr<const ContractionOverlay> overlay;
+    try {
+      overlay = ContractionOverlay::Load(ContractionOverlay::file_name(reader.tile_dir(), name));
+    } catch (const std::exception& e) {
+      LOG_WARN(std::string("Not using contraction overlay: ") + e.what());
+      continue;
+    }
+
+    // an overlay from another build of the tiles would unpack into the wrong edges
+    auto tile = overlay->node_count() ? reader.GetGraphTile(overlay->node(0)) : nullptr;
+    if (!tile || tile->header()->dataset_id() != overlay->dataset_id()) {
+      LOG_WARN("Contraction overlay for " + name + " does not match the tiles, not using it");
+      continue;
+    }
+
+    overlays_[type] = {overlay, default_costing_options(type)};
+    LOG_INFO("Loaded contraction overlay for " + name + " with " +
+             std::to_string(overlay->arc_count()) + " arcs");
+  }
+}
+
+std::shared_ptr<const ContractionOverlay>
+ContractionPathAlgorithm::Overlay(const Options& options) const {
+  auto found = overlays_.find(options.costing_type());
+  if (found == overlays_.end()) {
+    return nullptr;
+  }
+
+  // the overlay has no notion of avoids
+  if (options.exclude_locations_size() > 0 || options.exclude_polygons_size() > 0) {
+    return nullptr;
+  }
+
+  // and it was costed with the default options
+  auto costing = options.costings().find(options.costing_type());
+  if (costing == options.costings().end() || costing->second.options().exclude_edges_size() > 0 ||
+      costing->second.options().SerializeAsString() != found->second.default_options) {
+    return nullptr;
+  }
+  return found->second.overlay;
+}
+
+bool ContractionPathAlgorithm::Applicable(const valhalla::Location& origin,
+                                          const valhalla::Location& dest,
+                                          const Options& options) const {
+  auto overlay = Overlay(options);
+  if (!overlay) {
+    return false;
+  }
+
+  // the overlay has no notion of time or alternates
+  if (!origin.date_time().empty() || !dest.date_time().empty() || options.alternates() > 0) {
+    return false;
+  }
+
+  // both locations need a candidate on the level of the overlay
+  const auto level = overlay->level();
+  auto on_level = [level](const valhalla::PathEdge& edge) {
+    return GraphId(edge.graph_id()).level() == level;
+  };
+  return std::any_of(origin.correlation().edges().begin(), origin.correlation().edges().end(),
+                     on_level) &&
+         std::any_of(dest.correlation().edges().begin(), dest.correlation().edges().end(),
+                     on_level);
+}
+
+void ContractionPathAlgorithm::Seed(const valhalla::Location& location,
+                                    const ContractionOverlay& overlay,
+                                    GraphReader& graphreader,
+                                    const DynamicCost& costing,
+                                    const bool is_origin) {
+  auto& seeds = is_origin ? sources_ : targets_;
+  auto& edges = is_origin ? source_edges_ : target_edges_;
+  seeds.clear();
+  edges.clear();
+  for (const auto& candidate : location.correlation().edges()) {
+    GraphId edgeid(candidate.graph_id());
+    if (edgeid.level() != overlay.level()) {
+      continue;
+    }
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* edge = tile->directededge(edgeid);
+    if (!costing.Allowed(edge, tile, kDisallowShortcut)) {
+      continue;
+    }
+
+    // origins leave the overlay at the end of the edge, destinations join it at the beginning
+    graph_tile_ptr node_tile = tile;
+    const auto node = overlay.node_index(is_origin ? edge->endnode()
+                                                   : graphreader.GetBeginNodeId(edge, node_tile));
+    if (node == kInvalidContractionNode) {
+      continue;
+    }
+    uint8_t flow_sources;
+    const float pct = is_origin ? 1.f - candidate.percent_along() : candidate.percent_along();
+    auto cost = costing.EdgeCost(edge, tile, TimeInfo::invalid(), flow_sources) * pct;
+    seeds.push_back({node, cost.cost + candidate.distance()});
+    edges.push_back(edgeid);
+  }
+}
+
+bool ContractionPathAlgorithm::Unrestricted(GraphReader& graphreader,
+                                            const DynamicCost& costing) const {
+  graph_tile_ptr tile;
+  const DirectedEdge* previous = nullptr;
+  for (const auto& edgeid : path_edges_) {
+    const DirectedEdge* edge = graphreader.directededge(edgeid, tile);
+    if (edge == nullptr) {
+      return false;
+    }
+    // the overlay doesn't know about complex restrictions so we don't go near any of them
+    if ((edge->start_restriction() | edge->end_restriction()) & costing.access_mode()) {
+      return false;
+    }
+    if (previous != nullptr && (previous->restrictions() & (1 << edge->localedgeidx()))) {
+      return false;
+    }
+    previous = edge;
+  }
+  return true;
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionPathAlgorithm::GetBestPath(valhalla::Location& origin,
+                                      valhalla::Location& dest,
+                                      GraphReader& graphreader,
+                                      const sif::mode_costing_t& mode_costing,
+                                      const sif::TravelMode mode,
+                                      const Options& options) {
+  has_ferry_ = false;
+  auto found = overlays_.find(options.costing_type());
+  if (found == overlays_.end()) {
+    return {};
+  }
+  const auto& overlay = *found->second.overlay;
+  const auto& costing = mode_costing[static_cast<size_t>(mode)];
+  if (interrupt) {
+    (*interrupt)();
+  }
+
+  Seed(origin, overlay, graphreader, *costing, true);
+  Seed(dest, overlay, graphreader, *costing, false);
+  if (sources_.empty() || targets_.empty()) {
+    return {};
+  }
+
+  uint32_t source, target;
+  if (search_.Find(overlay, sources_, targets_, arcs_, source, target) ==
+      std::numeric_limits<float>::max()) {
+    return {};
+  }
+
+  // several candidates can meet the overlay at the same node, take the cheapest of them
+  auto cheapest = [](const std::vector<ContractionSearch::seed_t>& seeds, const uint32_t node) {
+    size_t best = seeds.size();
+    for (size_t i = 0; i < seeds.size(); ++i) {
+      if (seeds[i].node == node && (best == seeds.size() || seeds[i].cost < seeds[best].cost)) {
+        best = i;
+      }
+    }
+    return best;
+  };
+  path_edges_.clear();
+  path_edges_.push_back(source_edges_[cheapest(sources_, source)]);
+  for (auto arc : arcs_) {
+    overlay.Unpack(arc, path_edges_);
+  }
+  path_edges_.push_back(target_edges_[cheapest(targets_, target)]);
+  if (!Unrestricted(graphreader, *costing)) {
+    LOG_DEBUG("Contraction path crosses a turn restriction, falling back");
+    return {};
+  }
+
+  float source_pct = 0.f, target_pct = 1.f;
+  for (const auto& edge : origin.correlation().edges()) {
+    if (edge.graph_id() == path_edges_.front()) {
+      source_pct = edge.percent_along();
+    }
+  }
+  for (const auto& edge : dest.correlation().edges()) {
+    if (edge.graph_id() == path_edges_.back()) {
+      target_pct = edge.percent_along();
+    }
+  }
+
+  // recost the unpacked edges to get turn costs and elapsed times along the path, unlike other
+  // algorithms we honour access so that anything the overlay got wrong makes us fall back
+  std::vector<PathInfo> path;
+  path.reserve(path_edges_.size());
+  auto edge_itr = path_edges_.begin();
+  const auto edge_cb = [&edge_itr, this]() {
+    return (edge_itr == path_edges_.end()) ? GraphId{} : (*edge_itr++);
+  };
+  const auto label_cb = [&path, this](const EdgeLabel& label) {
+    path.emplace_back(label.mode(), label.cost(), label.edgeid(), 0, label.path_distance(),
+                      label.restriction_idx(), label.transition_cost(), false);
+    if (label.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  };
+  try {
+    sif::recost_forward(graphreader, *costing, edge_cb, label_cb, source_pct, target_pct,
+                        TimeInfo::invalid(), false, false);
+  } catch (const std::exception& e) {
+    LOG_DEBUG(std::string("Contraction path could not be recosted, falling back: ") + e.what());
+    return {};
+  }
+
+  std::vector<std::vector<PathInfo>> paths;
+  paths.emplace_back(std::move(path));
+  return paths;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -44,12 +44,19 @@ namespace thor {
 class CostMatrix::TargetMap : public robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> {};
 
 // Constructor with cost threshold.
-CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
+CostMatrix::CostMatrix(const boost::property_tree::ptree& config,
+                       const boost::property_tree::ptree& reader_config)
     : mode_(travel_mode_t::kDrive), access_mode_(kAutoAccess), source_count_(0),
       remaining_sources_(0), target_count_(0), remaining_targets_(0),
       current_cost_threshold_(0), targets_{new TargetMap},
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_bidir_dijkstras",
-                                                      kInitialEdgeLabelCountBidirDijkstra)) {
+                                                      kInitialEdgeLabelCountBidirDijkstra)),
+      thread_count_(std::max(config.get<uint32_t>("costmatrix_threads", 1), 1u)),
+      reader_config_(reader_config),
+      queue_type_(ParseQueueType(config.get<std::string>("adjacency_queue", "double_bucket"))),
+      target_cache_bytes_(0),
+      target_cache_size_(config.get<size_t>("costmatrix_target_cache_size", 0)),
+      time_bucket_(config.get<uint32_t>("matrix_time_bucket", 0)), target_cache_hits_(0) {
 }
 
 CostMatrix::~CostMatrix() {
@@ -115,6 +122,11 @@ void CostMatrix::clear() {
   source_status_.clear();
   target_status_.clear();
   best_connection_.clear();
+  source_pending_.clear();
+  target_pending_.clear();
+  target_reached_.clear();
+  target_keys_.clear();
+  target_restored_.clear();
 }
 
 // Form a time distance matrix from the set of source locations
@@ -129,6 +141,7 @@ void CostMatrix::SourceToTarget(Api& request,
 
   LOG_INFO("matrix::CostMatrix");
   request.mutable_matrix()->set_algorithm(Matrix::CostMatrix);
+  auto timing = search_timer_.start(stats_, graphreader);
 
   // Set the mode and costing
   mode_ = mode;
@@ -140,76 +153,123 @@ void CostMatrix::SourceToTarget(Api& request,
 
   current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
 
+  // Lazily start the helper threads the first time a parallel matrix is asked for
+  if (thread_count_ > 1 && !reader_config_.empty() && !pool_) {
+    pool_.reset(new SearchPool(thread_count_, reader_config_));
+  }
+
+  // the sources have the time to depart at, if not the targets may have the time to arrive at
   auto time_infos = SetOriginTimes(source_location_list, graphreader);
+  std::vector<baldr::TimeInfo> target_time_infos(target_location_list.size(), TimeInfo::invalid());
+  if (has_time &&
+      std::none_of(time_infos.begin(), time_infos.end(), [](const auto& ti) { return ti.valid; })) {
+    target_time_infos = SetOriginTimes(target_location_list, graphreader);
+  }
 
   // Initialize best connections and status. Any locations that are the
   // same get set to 0 time, distance and are not added to the remaining
   // location set.
   Initialize(source_location_list, target_location_list);
+  SetTargetKeys(request, graphreader, target_time_infos, invariant);
 
   // Set the source and target locations
-  // TODO: for now we only allow depart_at/current date_time
   SetSources(graphreader, source_location_list, time_infos);
-  SetTargets(graphreader, target_location_list);
+  SetTargets(graphreader, target_location_list, target_time_infos);
+  search_timer_.phase(SearchPhase::expansion);
 
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
   int n = 0;
   while (true) {
+    // Every step of a search settles a label, unless the search ran dry
+    stats_.settled += std::count_if(target_status_.begin(), target_status_.end(),
+                                    [](const auto& status) { return status.threshold > 0; });
+
     // Iterate all target locations in a backwards search
+    RunSearches(
+        target_count_,
+        [this, &target_time_infos, invariant](const uint32_t i, GraphReader& reader) {
+          if (target_status_[i].threshold > 0) {
+            target_status_[i].threshold--;
+            BackwardSearch(i, reader, target_time_infos[i], invariant);
+          }
+        },
+        graphreader);
+
+    // Apply what the backward searches found in target order
     for (uint32_t i = 0; i < target_count_; i++) {
-      if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        // if we didn't see this
-        if (target_status_[i].threshold == 0) {
-          for (uint32_t source = 0; source < source_count_; source++) {
-            //  Get all targets remaining for the origin
-            auto& targets = source_status_[source].remaining_locations;
-            auto it = targets.find(i);
-            if (it != targets.end()) {
-              targets.erase(it);
-              if (targets.empty() && source_status_[source].threshold > 0) {
-                source_status_[i].threshold = -1;
-                if (remaining_sources_ > 0) {
-                  remaining_sources_--;
-                }
+      for (const auto& edgeid : target_reached_[i]) {
+        (*targets_)[edgeid].push_back(i);
+      }
+      target_reached_[i].clear();
+      for (const auto& pending : target_pending_[i]) {
+        UpdateSourceStatus(pending.first, i, pending.second);
+        UpdateTargetStatus(pending.first, i, pending.second);
+      }
+      target_pending_[i].clear();
+
+      // if we didn't see this
+      if (target_status_[i].threshold == 0) {
+        for (uint32_t source = 0; source < source_count_; source++) {
+          //  Get all targets remaining for the origin
+          auto& targets = source_status_[source].remaining_locations;
+          auto it = targets.find(i);
+          if (it != targets.end()) {
+            targets.erase(it);
+            if (targets.empty() && source_status_[source].threshold > 0) {
+              source_status_[i].threshold = -1;
+              if (remaining_sources_ > 0) {
+                remaining_sources_--;
               }
             }
           }
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
+        }
+        target_status_[i].threshold = -1;
+        if (remaining_targets_ > 0) {
+          remaining_targets_--;
         }
       }
     }
 
     // Iterate all source locations in a forward search
+    stats_.settled += std::count_if(source_status_.begin(), source_status_.end(),
+                                    [](const auto& status) { return status.threshold > 0; });
+    RunSearches(
+        source_count_,
+        [this, n, &time_infos, invariant](const uint32_t i, GraphReader& reader) {
+          if (source_status_[i].threshold > 0) {
+            source_status_[i].threshold--;
+            ForwardSearch(i, n, reader, time_infos[i], invariant);
+          }
+        },
+        graphreader);
+
+    // Apply what the forward searches found in source order
     for (uint32_t i = 0; i < source_count_; i++) {
-      if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader, time_infos[i], invariant);
-        if (source_status_[i].threshold == 0) {
-          for (uint32_t target = 0; target < target_count_; target++) {
-            //  Get all sources remaining for the destination
-            auto& sources = target_status_[target].remaining_locations;
-            auto it = sources.find(i);
-            if (it != sources.end()) {
-              sources.erase(it);
-              if (sources.empty() && target_status_[target].threshold > 0) {
-                target_status_[i].threshold = -1;
-                if (remaining_targets_ > 0) {
-                  remaining_targets_--;
-                }
+      for (const auto& pending : source_pending_[i]) {
+        UpdateTargetStatus(i, pending.first, pending.second);
+      }
+      source_pending_[i].clear();
+
+      if (source_status_[i].threshold == 0) {
+        for (uint32_t target = 0; target < target_count_; target++) {
+          //  Get all sources remaining for the destination
+          auto& sources = target_status_[target].remaining_locations;
+          auto it = sources.find(i);
+          if (it != sources.end()) {
+            sources.erase(it);
+            if (sources.empty() && target_status_[target].threshold > 0) {
+              target_status_[i].threshold = -1;
+              if (remaining_targets_ > 0) {
+                remaining_targets_--;
               }
             }
           }
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
+        }
+        source_status_[i].threshold = -1;
+        if (remaining_sources_ > 0) {
+          remaining_sources_--;
         }
       }
     }
@@ -227,9 +287,12 @@ void CostMatrix::SourceToTarget(Api& request,
     }
     n++;
   }
+  CacheTargets();
 
+  search_timer_.phase(SearchPhase::path);
   if (has_time) {
-    RecostPaths(graphreader, source_location_list, target_location_list, time_infos, invariant);
+    RecostPaths(graphreader, source_location_list, target_location_list, time_infos,
+                target_time_infos, invariant);
   }
 
   // Form the matrix PBF output
@@ -240,10 +303,13 @@ void CostMatrix::SourceToTarget(Api& request,
     uint32_t target_idx = count % target_location_list.size();
     uint32_t origin_idx = count / target_location_list.size();
     float time = connection.cost.secs + .5f;
-    auto date_time = get_date_time(source_location_list[origin_idx].date_time(),
-                                   time_infos[origin_idx].timezone_index,
-                                   target_edgelabel_[target_idx].front().edgeid(), graphreader,
-                                   static_cast<uint64_t>(time));
+    // arriving at a time the date_time of the target is the arrival
+    auto date_time = target_time_infos[target_idx].valid
+                         ? target_location_list[target_idx].date_time()
+                         : get_date_time(source_location_list[origin_idx].date_time(),
+                                         time_infos[origin_idx].timezone_index,
+                                         target_edgelabel_[target_idx].front().edgeid(),
+                                         graphreader, static_cast<uint64_t>(time));
     matrix.mutable_from_indices()->Set(count, origin_idx);
     matrix.mutable_to_indices()->Set(count, target_idx);
     matrix.mutable_distances()->Set(count, connection.distance);
@@ -273,9 +339,8 @@ void CostMatrix::Initialize(
     // Allocate the adjacency list and hierarchy limits for this source.
     // Use the cost threshold to size the adjacency list.
     source_edgelabel_[i].reserve(max_reserved_labels_count_);
-    source_adjacency_.emplace_back(DoubleBucketQueue<BDEdgeLabel>(0, current_cost_threshold_,
-                                                                  costing_->UnitSize(),
-                                                                  &source_edgelabel_[i]));
+    source_adjacency_.emplace_back(queue_type_, 0, current_cost_threshold_, costing_->UnitSize(),
+                                   &source_edgelabel_[i]);
     source_status_.emplace_back(kMaxThreshold);
     source_hierarchy_limits_.emplace_back(costing_->GetHierarchyLimits());
   }
@@ -290,13 +355,16 @@ void CostMatrix::Initialize(
     // Allocate the adjacency list and hierarchy limits for target location.
     // Use the cost threshold to size the adjacency list.
     target_edgelabel_[i].reserve(max_reserved_labels_count_);
-    target_adjacency_.emplace_back(DoubleBucketQueue<BDEdgeLabel>(0, current_cost_threshold_,
-                                                                  costing_->UnitSize(),
-                                                                  &target_edgelabel_[i]));
+    target_adjacency_.emplace_back(queue_type_, 0, current_cost_threshold_, costing_->UnitSize(),
+                                   &target_edgelabel_[i]);
     target_status_.emplace_back(kMaxThreshold);
     target_hierarchy_limits_.emplace_back(costing_->GetHierarchyLimits());
   }
 
+  source_pending_.resize(source_count_);
+  target_pending_.resize(target_count_);
+  target_reached_.resize(target_count_);
+
   // Initialize best connection
   GraphId empty;
   Cost trivial_cost(0.0f, 0.0f);
@@ -353,8 +421,11 @@ void CostMatrix::ForwardSearch(const uint32_t index,
   // Get edge label and check cost threshold
   BDEdgeLabel pred = edgelabels[pred_idx];
   if (expansion_callback_) {
-    expansion_callback_(graphreader, pred.edgeid(), "costmatrix", "s", pred.cost().secs,
-                        pred.path_distance(), pred.cost().cost);
+    auto prev_pred = pred.predecessor() == kInvalidLabel
+                         ? GraphId{}
+                         : edgelabels[pred.predecessor()].edgeid();
+    expansion_callback_(graphreader, pred.edgeid(), prev_pred, "costmatrix", "s",
+                        pred.cost().secs, pred.path_distance(), pred.cost().cost);
   }
 
   if (pred.cost().secs > current_cost_threshold_) {
@@ -420,19 +491,19 @@ void CostMatrix::ForwardSearch(const uint32_t index,
 
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
-      uint8_t restriction_idx = -1;
-      if (!costing_->Allowed(directededge, false, pred, tile, edgeid, offset_time.local_time,
-                             nodeinfo->timezone(), restriction_idx) ||
+      EdgeEvaluation evaluation;
+      if (!costing_->EvaluateEdge(directededge, false, pred, tile, edgeid, nodeinfo, offset_time,
+                                  offset_time.local_time, nodeinfo->timezone(), evaluation) ||
           costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true, nullptr,
                                offset_time.local_time, nodeinfo->timezone())) {
         continue;
       }
 
       // Get cost. Separate out transition cost.
-      Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-      uint8_t flow_sources;
-      Cost newcost =
-          pred.cost() + tc + costing_->EdgeCost(directededge, tile, offset_time, flow_sources);
+      const uint8_t restriction_idx = evaluation.restriction_idx;
+      const uint8_t flow_sources = evaluation.flow_sources;
+      const Cost& tc = evaluation.transition_cost;
+      Cost newcost = pred.cost() + tc + evaluation.edge_cost;
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -468,8 +539,8 @@ void CostMatrix::ForwardSearch(const uint32_t index,
 
       // setting this edge as reached
       if (expansion_callback_) {
-        expansion_callback_(graphreader, edgeid, "costmatrix", "r", pred.cost().secs,
-                            pred.path_distance(), pred.cost().cost);
+        expansion_callback_(graphreader, edgeid, pred.edgeid(), "costmatrix", "r",
+                            pred.cost().secs, pred.path_distance(), pred.cost().cost);
       }
     }
 
@@ -487,7 +558,7 @@ void CostMatrix::ForwardSearch(const uint32_t index,
         GraphId node = trans->endnode();
         graph_tile_ptr endtile = graphreader.GetGraphTile(node);
         if (endtile != nullptr) {
-          expand(endtile, node, endtile->node(node), pred, pred_idx, true, ti);
+          expand(endtile, node, endtile->node(node), pred, pred_idx, true, offset_time);
         }
       }
     }
@@ -596,8 +667,11 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
       }
       // setting this edge as connected
       if (expansion_callback_) {
-        expansion_callback_(graphreader, pred.edgeid(), "costmatrix", "c", pred.cost().secs,
-                            pred.path_distance(), pred.cost().cost);
+        auto prev_pred = pred.predecessor() == kInvalidLabel
+                             ? GraphId{}
+                             : source_edgelabel_[source][pred.predecessor()].edgeid();
+        expansion_callback_(graphreader, pred.edgeid(), prev_pred, "costmatrix", "c",
+                            pred.cost().secs, pred.path_distance(), pred.cost().cost);
       }
     }
   }
@@ -605,7 +679,15 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
 // Update status when a connection is found.
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
-  // Remove the target from the source status
+  const uint32_t label_count = source_edgelabel_[source].size() + target_edgelabel_[target].size();
+  UpdateSourceStatus(source, target, label_count);
+  source_pending_[source].emplace_back(target, label_count);
+}
+
+// Remove the target from the source status
+void CostMatrix::UpdateSourceStatus(const uint32_t source,
+                                    const uint32_t target,
+                                    const uint32_t label_count) {
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
   if (it != s.end()) {
@@ -613,36 +695,57 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (s.empty() && source_status_[source].threshold > 0) {
       // At least 1 connection has been found to each target for this source.
       // Set a threshold to continue search for a limited number of times.
-      source_status_[source].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      source_status_[source].threshold = GetThreshold(mode_, label_count);
     }
   }
+}
 
-  // Remove the source from the target status
+// Remove the source from the target status
+void CostMatrix::UpdateTargetStatus(const uint32_t source,
+                                    const uint32_t target,
+                                    const uint32_t label_count) {
   auto& t = target_status_[target].remaining_locations;
-  it = t.find(source);
+  auto it = t.find(source);
   if (it != t.end()) {
     t.erase(it);
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
-      target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      target_status_[target].threshold = GetThreshold(mode_, label_count);
     }
   }
 }
 
+// Run one search step for every location, on the pool if there is one
+void CostMatrix::RunSearches(const uint32_t count,
+                             const std::function<void(const uint32_t, GraphReader&)>& search,
+                             GraphReader& graphreader) {
+  // the expansion callback isn't meant to be called concurrently
+  if (pool_ && count > 1 && !expansion_callback_) {
+    pool_->run(count, search, graphreader);
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    search(i, graphreader);
+  }
+}
+
 // Expand the backwards search trees.
-void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader) {
+void CostMatrix::BackwardSearch(const uint32_t index,
+                                GraphReader& graphreader,
+                                const baldr::TimeInfo& time_info,
+                                const bool invariant) {
   // Get the next edge from the adjacency list for this target location
   auto& adj = target_adjacency_[index];
   auto& edgelabels = target_edgelabel_[index];
   uint32_t pred_idx = adj.pop();
   if (pred_idx == kInvalidLabel) {
     // Backward search is exhausted - mark this and update so we don't
-    // extend searches more than we need to
+    // extend searches more than we need to. The sources are updated once
+    // all backward searches of this iteration are done
     for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
+      target_pending_[index].emplace_back(source, source_edgelabel_[source].size() +
+                                                      target_edgelabel_[index].size());
     }
     target_status_[index].threshold = 0;
     return;
@@ -656,8 +759,11 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
   }
 
   if (expansion_callback_) {
-    expansion_callback_(graphreader, pred.edgeid(), "costmatrix", "s", pred.cost().secs,
-                        pred.path_distance(), pred.cost().cost);
+    auto prev_pred = pred.predecessor() == kInvalidLabel
+                         ? GraphId{}
+                         : edgelabels[pred.predecessor()].edgeid();
+    expansion_callback_(graphreader, pred.edgeid(), prev_pred, "costmatrix", "s",
+                        pred.cost().secs, pred.path_distance(), pred.cost().cost);
   }
 
   // Settle this edge
@@ -680,11 +786,16 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
 
   // Expand from node in reverse direction.
   std::function<void(graph_tile_ptr, const GraphId&, const NodeInfo*, const uint32_t, BDEdgeLabel&,
-                     const uint32_t, const DirectedEdge*, const bool)>
+                     const uint32_t, const DirectedEdge*, const bool, const baldr::TimeInfo&)>
       expand;
   expand = [&](graph_tile_ptr tile, const GraphId& node, const NodeInfo* nodeinfo,
                const uint32_t index, BDEdgeLabel& pred, const uint32_t pred_idx,
-               const DirectedEdge* opp_pred_edge, const bool from_transition) {
+               const DirectedEdge* opp_pred_edge, const bool from_transition,
+               const baldr::TimeInfo& ti) {
+    // the time we get to the node at, going back from the arrival at the target
+    auto offset_time = from_transition ? ti
+                                       : ti.reverse(invariant ? 0.f : pred.cost().secs,
+                                                    static_cast<int>(nodeinfo->timezone()));
     uint32_t shortcuts = 0;
     GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
     EdgeStatusInfo* es = edgestate.GetPtr(edgeid, tile);
@@ -722,24 +833,21 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
       const DirectedEdge* opp_edge = t2->directededge(oppedge);
-      uint8_t restriction_idx = -1;
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedge, 0, 0,
-                                    restriction_idx) ||
-          costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, false)) {
+      EdgeEvaluation evaluation;
+      if (!costing_->EvaluateEdgeReverse(directededge, pred, opp_edge, t2, oppedge, nodeinfo,
+                                         opp_pred_edge, tile, offset_time, offset_time.local_time,
+                                         nodeinfo->timezone(), evaluation) ||
+          costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, false, nullptr,
+                               offset_time.local_time, nodeinfo->timezone())) {
         continue;
       }
 
       // Get cost. Use opposing edge for EdgeCost. Separate the transition seconds so
       // we can properly recover elapsed time on the reverse path.
-      uint8_t flow_sources;
-      Cost newcost =
-          pred.cost() + costing_->EdgeCost(opp_edge, t2, TimeInfo::invalid(), flow_sources);
-
-      Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
-                                                opp_pred_edge,
-                                                static_cast<bool>(flow_sources & kDefaultFlowMask),
-                                                pred.internal_turn());
-      newcost += tc;
+      const uint8_t restriction_idx = evaluation.restriction_idx;
+      const uint8_t flow_sources = evaluation.flow_sources;
+      const Cost& tc = evaluation.transition_cost;
+      Cost newcost = pred.cost() + evaluation.edge_cost + tc;
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -767,12 +875,12 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       adj.add(idx);
 
       // Add to the list of targets that have reached this edge
-      (*targets_)[edgeid].push_back(index);
+      target_reached_[index].push_back(edgeid);
 
       // setting this edge as reached
       if (expansion_callback_) {
-        expansion_callback_(graphreader, edgeid, "costmatrix", "r", pred.cost().secs,
-                            pred.path_distance(), pred.cost().cost);
+        expansion_callback_(graphreader, edgeid, pred.edgeid(), "costmatrix", "r",
+                            pred.cost().secs, pred.path_distance(), pred.cost().cost);
       }
     }
 
@@ -790,7 +898,8 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
         GraphId node = trans->endnode();
         graph_tile_ptr endtile = graphreader.GetGraphTile(node);
         if (endtile != nullptr) {
-          expand(endtile, node, endtile->node(node), index, pred, pred_idx, opp_pred_edge, true);
+          expand(endtile, node, endtile->node(node), index, pred, pred_idx, opp_pred_edge, true,
+                 offset_time);
         }
         continue;
       }
@@ -812,7 +921,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
         opp_pred_edge =
             graphreader.GetGraphTile(pred.opp_edgeid().Tile_Base())->directededge(pred.opp_edgeid());
       }
-      expand(tile, node, nodeinfo, index, pred, pred_idx, opp_pred_edge, false);
+      expand(tile, node, nodeinfo, index, pred, pred_idx, opp_pred_edge, false, time_info);
     }
   }
 }
@@ -889,11 +998,18 @@ void CostMatrix::SetSources(GraphReader& graphreader,
 // Set the target/destination locations. Search expands backwards from
 // these locations.
 void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
-                            const google::protobuf::RepeatedPtrField<valhalla::Location>& targets) {
+                            const google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
+                            const std::vector<baldr::TimeInfo>& time_infos) {
   // Go through each target location
   uint32_t index = 0;
   Cost empty_cost;
   for (const auto& dest : targets) {
+    // Carry on with the reverse search an earlier matrix did for this target
+    if (RestoreTarget(index, graphreader)) {
+      index++;
+      continue;
+    }
+
     // Only skip outbound edges if we have other options
     bool has_other_edges = false;
     std::for_each(dest.correlation().edges().begin(), dest.correlation().edges().end(),
@@ -931,7 +1047,7 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
       // Use the directed edge for costing, as this is the forward direction
       // along the destination edge.
       uint8_t flow_sources;
-      Cost edgecost = costing_->EdgeCost(directededge, tile, TimeInfo::invalid(), flow_sources);
+      Cost edgecost = costing_->EdgeCost(directededge, tile, time_infos[index], flow_sources);
       Cost cost = edgecost * edge.percent_along();
       uint32_t d = std::round(directededge->length() * edge.percent_along());
 
@@ -966,13 +1082,142 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
   }
 }
 
+// Set the cache key of each target
+void CostMatrix::SetTargetKeys(const Api& request,
+                               GraphReader& graphreader,
+                               const std::vector<baldr::TimeInfo>& time_infos,
+                               const bool invariant) {
+  target_keys_.assign(target_count_, {});
+  target_restored_.assign(target_count_, 0);
+  target_cache_hits_ = 0;
+
+  // avoids aren't part of the costing options and the expansion has to be tracked from scratch
+  const auto& options = request.options();
+  if (target_cache_size_ == 0 || expansion_callback_ || options.exclude_locations_size() > 0 ||
+      options.exclude_polygons_size() > 0) {
+    return;
+  }
+
+  // what all targets have in common, the costing and the tiles
+  std::string common = std::to_string(options.costing_type()) + ':';
+  auto costing = options.costings().find(options.costing_type());
+  if (costing != options.costings().end()) {
+    common += costing->second.options().SerializeAsString();
+  }
+
+  for (uint32_t i = 0; i < target_count_; i++) {
+    const auto& edges = options.targets(i).correlation().edges();
+    if (edges.empty()) {
+      continue;
+    }
+    graph_tile_ptr tile = graphreader.GetGraphTile(GraphId(edges.begin()->graph_id()));
+    if (tile == nullptr) {
+      continue;
+    }
+
+    // the time only matters to time dependent reverse searches, within a bucket it's the same
+    std::string key = common + ':' + std::to_string(tile->header()->dataset_id()) + ':' +
+                      std::to_string(invariant) + ':';
+    if (time_infos[i].valid) {
+      const uint64_t time = time_infos[i].local_time;
+      key += std::to_string(time_bucket_ > 0 ? time / time_bucket_ : time);
+    }
+    for (const auto& edge : edges) {
+      key += ':' + std::to_string(edge.graph_id()) + ',' + std::to_string(edge.percent_along()) +
+             ',' + std::to_string(edge.distance()) + ',' + std::to_string(edge.begin_node()) +
+             std::to_string(edge.end_node());
+    }
+    target_keys_[i] = std::move(key);
+  }
+}
+
+// Restore the reverse search of a target from the cache
+bool CostMatrix::RestoreTarget(const uint32_t index, GraphReader& graphreader) {
+  if (target_keys_[index].empty()) {
+    return false;
+  }
+  auto found = target_cache_index_.find(target_keys_[index]);
+  if (found == target_cache_index_.end()) {
+    return false;
+  }
+
+  // the edge status needs the tiles, if one is gone the search starts over
+  const CachedTarget& cached = found->second->second;
+  auto& edgestatus = target_edgestatus_[index];
+  graph_tile_ptr tile;
+  for (uint32_t idx = 0; idx < cached.labels.size(); idx++) {
+    const GraphId& edgeid = cached.labels[idx].edgeid();
+    if (tile == nullptr || tile->id() != edgeid.Tile_Base()) {
+      tile = graphreader.GetGraphTile(edgeid);
+      if (tile == nullptr) {
+        edgestatus.clear();
+        return false;
+      }
+    }
+    edgestatus.Set(edgeid, cached.status[idx], idx, tile);
+  }
+
+  // labels that weren't settled yet go back on the adjacency list, all of them can connect
+  auto& edgelabels = target_edgelabel_[index];
+  edgelabels = cached.labels;
+  for (uint32_t idx = 0; idx < edgelabels.size(); idx++) {
+    if (cached.status[idx] != EdgeSet::kPermanent) {
+      target_adjacency_[index].add(idx);
+    }
+    (*targets_)[edgelabels[idx].edgeid()].push_back(index);
+  }
+  target_hierarchy_limits_[index] = cached.hierarchy_limits;
+
+  target_cache_.splice(target_cache_.begin(), target_cache_, found->second);
+  target_restored_[index] = edgelabels.size();
+  target_cache_hits_++;
+  return true;
+}
+
+// Put the reverse searches that grew during this matrix into the cache
+void CostMatrix::CacheTargets() {
+  for (uint32_t i = 0; i < target_keys_.size(); i++) {
+    const auto& edgelabels = target_edgelabel_[i];
+    if (target_keys_[i].empty() || edgelabels.size() == target_restored_[i]) {
+      continue;
+    }
+
+    CachedTarget cached{edgelabels, {}, target_hierarchy_limits_[i]};
+    cached.status.reserve(edgelabels.size());
+    for (const auto& label : edgelabels) {
+      cached.status.push_back(target_edgestatus_[i].Get(label.edgeid()).set());
+    }
+
+    // replace what an earlier matrix left for the target
+    auto found = target_cache_index_.find(target_keys_[i]);
+    if (found != target_cache_index_.end()) {
+      target_cache_bytes_ -= found->second->second.bytes();
+      target_cache_.erase(found->second);
+      target_cache_index_.erase(found);
+    }
+    if (cached.bytes() > target_cache_size_) {
+      continue;
+    }
+
+    target_cache_bytes_ += cached.bytes();
+    target_cache_.emplace_front(target_keys_[i], std::move(cached));
+    target_cache_index_.emplace(target_keys_[i], target_cache_.begin());
+    while (target_cache_bytes_ > target_cache_size_) {
+      target_cache_bytes_ -= target_cache_.back().second.bytes();
+      target_cache_index_.erase(target_cache_.back().first);
+      target_cache_.pop_back();
+    }
+  }
+}
+
 // Form the path from the adjacency list.
 // TODO: move this function to PathInfo header or so, where both bidir A* and CostMatrix
 // can see it
 void CostMatrix::RecostPaths(GraphReader& graphreader,
                              google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
                              google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
-                             const std::vector<baldr::TimeInfo>& time_infos,
+                             const std::vector<baldr::TimeInfo>& source_time_infos,
+                             const std::vector<baldr::TimeInfo>& target_time_infos,
                              bool invariant) {
   uint32_t idx = 0;
   for (auto best_connection = best_connection_.begin(); best_connection != best_connection_.end();
@@ -1050,8 +1295,13 @@ void CostMatrix::RecostPaths(GraphReader& graphreader,
     float source_pct = find_percent_along(source, path_edges.front());
     float target_pct = find_percent_along(target, path_edges.back());
 
-    // recost edges in final path; ignore access restrictions
-    auto& time_info = time_infos[source_idx];
+    // recost edges in final path; ignore access restrictions. When the targets have the time
+    // the path departs as long before the arrival as the searches found it takes
+    auto time_info = source_time_infos[source_idx];
+    if (!time_info.valid && target_time_infos[target_idx].valid) {
+      const auto& arrival = target_time_infos[target_idx];
+      time_info = arrival.reverse(best_connection->cost.secs, arrival.timezone_index);
+    }
     try {
       sif::recost_forward(graphreader, *costing_, edge_cb, label_cb, source_pct, target_pct,
                           time_info, invariant, true);
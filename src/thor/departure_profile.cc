@@ -0,0 +1,278 @@
+#include "thor/departure_profile.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "baldr/predictedspeeds.h"
+#include "thor/pathalgorithm.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Live traffic fades out over the first hour from now (see GraphTile::GetSpeed), past that the
+// cost of an edge only changes from one predicted speed bucket to the next
+constexpr uint64_t kLiveTrafficSeconds = 3600;
+
+constexpr float kUnreached = std::numeric_limits<float>::max();
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::vector<float> DepartureProfile::Compute(const valhalla::Location& origin,
+                                             const valhalla::Location& destination,
+                                             GraphReader& graphreader,
+                                             const mode_costing_t& mode_costing,
+                                             const travel_mode_t mode,
+                                             const std::vector<TimeInfo>& departures) {
+  Clear();
+  if (departures.empty()) {
+    return {};
+  }
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  arrivals_.assign(departures.size(), kUnreached);
+  latest_arrival_ = kUnreached;
+
+  // Where along the destination edges the destination is
+  for (const auto& edge : destination.correlation().edges()) {
+    if (!costing_->AvoidAsDestinationEdge(GraphId(edge.graph_id()), edge.percent_along())) {
+      destinations_.emplace(edge.graph_id(), edge.percent_along());
+    }
+  }
+  SetOrigin(graphreader, origin, departures);
+
+  size_t n = 0;
+  while (!queue_.empty()) {
+    const auto next = queue_.top();
+    queue_.pop();
+
+    // Nothing still in the queue can get to the destination sooner for any of the departures
+    if (next.first >= latest_arrival_) {
+      break;
+    }
+
+    // The label may be in the queue more than once, its times only need to go out once
+    if (!changed_[next.second]) {
+      continue;
+    }
+    changed_[next.second] = false;
+
+    if (interrupt_ && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+    Expand(graphreader, labels_[next.second].endnode(), next.second, departures, false);
+  }
+
+  std::vector<float> times(arrivals_);
+  std::replace(times.begin(), times.end(), kUnreached, -1.f);
+  return times;
+}
+
+void DepartureProfile::Clear() {
+  labels_.clear();
+  elapsed_.clear();
+  changed_.clear();
+  edgestatus_.clear();
+  queue_ = {};
+  destinations_.clear();
+  arrivals_.clear();
+}
+
+void DepartureProfile::SetOrigin(GraphReader& graphreader,
+                                 const valhalla::Location& origin,
+                                 const std::vector<TimeInfo>& departures) {
+  // Only skip inbound edges if we have other options
+  const bool has_other_edges =
+      std::any_of(origin.correlation().edges().begin(), origin.correlation().edges().end(),
+                  [](const valhalla::PathEdge& e) { return !e.end_node(); });
+
+  const size_t count = departures.size();
+  const std::vector<float> start(count, 0.f);
+  std::vector<float> secs, elapsed(count), arrivals(count);
+  for (const auto& edge : origin.correlation().edges()) {
+    // If origin is at a node - skip any inbound edge (dist = 1)
+    GraphId edgeid(edge.graph_id());
+    if ((edge.end_node() && has_other_edges) ||
+        costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    EdgeSeconds(directededge, tile, start.data(), departures.front().timezone_index, departures,
+                secs);
+
+    // A destination further along the same edge is reached without leaving it
+    auto destination = destinations_.find(edgeid);
+    if (destination != destinations_.end() && destination->second >= edge.percent_along()) {
+      for (size_t k = 0; k < count; ++k) {
+        arrivals[k] = secs[k] * (destination->second - edge.percent_along());
+      }
+      Arrive(arrivals);
+    }
+
+    const float remaining = 1.f - edge.percent_along();
+    for (size_t k = 0; k < count; ++k) {
+      elapsed[k] = secs[k] * remaining;
+    }
+    uint32_t idx = labels_.size();
+    labels_.emplace_back(kInvalidLabel, edgeid, directededge, Cost{elapsed[0], elapsed[0]},
+                         elapsed[0], 0.f, mode_,
+                         static_cast<uint32_t>(directededge->length() * remaining), Cost{},
+                         kInvalidRestriction, !costing_->IsClosed(directededge, tile), false,
+                         InternalTurn::kNoTurn);
+    labels_.back().set_origin();
+    elapsed_.resize(elapsed_.size() + count, kUnreached);
+    changed_.push_back(false);
+    Improve(idx, kInvalidLabel, elapsed);
+  }
+}
+
+void DepartureProfile::Expand(GraphReader& graphreader,
+                              const GraphId& node,
+                              const uint32_t pred_idx,
+                              const std::vector<TimeInfo>& departures,
+                              const bool from_transition) {
+  graph_tile_ptr tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+  if (!costing_->Allowed(nodeinfo)) {
+    return;
+  }
+
+  // Copies, the labels and their times move as labels are added
+  const size_t count = departures.size();
+  const EdgeLabel pred = labels_[pred_idx];
+  const std::vector<float> start(elapsed_.begin() + pred_idx * count,
+                                 elapsed_.begin() + (pred_idx + 1) * count);
+
+  std::vector<float> entry(count), secs, elapsed(count), arrivals(count);
+  GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+    if (directededge->is_shortcut()) {
+      continue;
+    }
+
+    uint8_t restriction_idx = kInvalidRestriction;
+    auto destination = destinations_.find(edgeid);
+    if (!costing_->Allowed(directededge, destination != destinations_.end(), pred, tile, edgeid, 0,
+                           nodeinfo->timezone(), restriction_idx) ||
+        costing_->Restricted(directededge, pred, labels_, tile, edgeid, true)) {
+      continue;
+    }
+
+    const Cost transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
+    for (size_t k = 0; k < count; ++k) {
+      entry[k] = start[k] + transition_cost.secs;
+    }
+    EdgeSeconds(directededge, tile, entry.data(), nodeinfo->timezone(), departures, secs);
+    if (destination != destinations_.end()) {
+      for (size_t k = 0; k < count; ++k) {
+        arrivals[k] = entry[k] + secs[k] * destination->second;
+      }
+      Arrive(arrivals);
+    }
+    for (size_t k = 0; k < count; ++k) {
+      elapsed[k] = entry[k] + secs[k];
+    }
+
+    // The first time the edge is reached it gets a label, after that only its times get better
+    EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
+    uint32_t idx = es->index();
+    if (es->set() == EdgeSet::kUnreachedOrReset) {
+      idx = labels_.size();
+      labels_.emplace_back(pred_idx, edgeid, directededge, Cost{elapsed[0], elapsed[0]}, elapsed[0],
+                           0.f, mode_, pred.path_distance() + directededge->length(),
+                           transition_cost, restriction_idx,
+                           pred.closure_pruning() || !costing_->IsClosed(directededge, tile),
+                           false, costing_->TurnType(pred.opp_local_idx(), nodeinfo, directededge));
+      elapsed_.resize(elapsed_.size() + count, kUnreached);
+      changed_.push_back(false);
+      *es = {EdgeSet::kTemporary, idx};
+    }
+    Improve(idx, pred_idx, elapsed);
+  }
+
+  // Handle transitions - expand from the end node each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      Expand(graphreader, trans->endnode(), pred_idx, departures, true);
+    }
+  }
+}
+
+void DepartureProfile::EdgeSeconds(const DirectedEdge* edge,
+                                   const graph_tile_ptr& tile,
+                                   const float* elapsed,
+                                   const uint32_t tz_index,
+                                   const std::vector<TimeInfo>& departures,
+                                   std::vector<float>& secs) {
+  secs.resize(departures.size());
+  uint8_t flow_sources;
+  uint32_t last_bucket = 0;
+  bool last_shared = false;
+  for (size_t k = 0; k < departures.size(); ++k) {
+    const auto time_info = departures[k].forward(elapsed[k], tz_index);
+    const uint32_t bucket =
+        time_info.valid ? time_info.second_of_week / kSpeedBucketSizeSeconds : 0;
+    const bool shared = !time_info.valid || time_info.seconds_from_now >= kLiveTrafficSeconds;
+    if (shared && last_shared && bucket == last_bucket) {
+      secs[k] = secs[k - 1];
+      continue;
+    }
+    secs[k] = costing_->EdgeCost(edge, tile, time_info, flow_sources).secs;
+    last_bucket = bucket;
+    last_shared = shared;
+  }
+}
+
+void DepartureProfile::Improve(const uint32_t idx,
+                               const uint32_t pred_idx,
+                               const std::vector<float>& elapsed) {
+  float* times = &elapsed_[idx * elapsed.size()];
+  float least = kUnreached;
+  for (size_t k = 0; k < elapsed.size(); ++k) {
+    if (elapsed[k] < times[k]) {
+      times[k] = elapsed[k];
+      least = std::min(least, elapsed[k]);
+    }
+  }
+  if (least == kUnreached) {
+    return;
+  }
+
+  // The predecessor is the one of the first departure, complex restrictions are walked along it
+  auto& label = labels_[idx];
+  if (times[0] == elapsed[0] && pred_idx != kInvalidLabel) {
+    label.Update(pred_idx, Cost{times[0], times[0]}, times[0], label.transition_cost(),
+                 label.restriction_idx());
+  }
+  changed_[idx] = true;
+  queue_.emplace(least, idx);
+}
+
+void DepartureProfile::Arrive(const std::vector<float>& arrivals) {
+  bool better = false;
+  for (size_t k = 0; k < arrivals.size(); ++k) {
+    if (arrivals[k] < arrivals_[k]) {
+      arrivals_[k] = arrivals[k];
+      better = true;
+    }
+  }
+  if (better) {
+    latest_arrival_ = *std::max_element(arrivals_.begin(), arrivals_.end());
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -44,24 +44,19 @@ Dijkstras::Dijkstras(const boost::property_tree::ptree& config)
     : mode_(travel_mode_t::kDrive), access_mode_(kAutoAccess),
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
-      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)), multipath_(false) {
+      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)),
+      bd_budget_(config, max_reserved_labels_count_, clear_reserved_memory_),
+      mm_budget_(config, max_reserved_labels_count_, clear_reserved_memory_),
+      adjacencylist_(ParseQueueType(config.get<std::string>("adjacency_queue", "double_bucket"))),
+      mmadjacencylist_(adjacencylist_.type()), multipath_(false) {
 }
 
 // Clear the temporary information generated during path construction.
 void Dijkstras::Clear() {
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
-  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-  if (bdedgelabels_.size() > reservation) {
-    bdedgelabels_.resize(reservation);
-    bdedgelabels_.shrink_to_fit();
-  }
-  bdedgelabels_.clear();
-  if (mmedgelabels_.size() > reservation) {
-    mmedgelabels_.resize(reservation);
-    mmedgelabels_.shrink_to_fit();
-  }
-  mmedgelabels_.clear();
+  bd_budget_.clear(bdedgelabels_);
+  mm_budget_.clear(mmedgelabels_);
 
   adjacencylist_.clear();
   mmadjacencylist_.clear();
@@ -72,7 +67,7 @@ void Dijkstras::Clear() {
 // edgelabels
 template <typename label_container_t>
 void Dijkstras::Initialize(label_container_t& labels,
-                           baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                           baldr::LabelQueue<typename label_container_t::value_type>& queue,
                            const uint32_t bucket_size) {
   // Set aside some space for edge labels
   uint32_t edge_label_reservation;
@@ -83,14 +78,15 @@ void Dijkstras::Initialize(label_container_t& labels,
   // Set up lambda to get sort costs
   float range = bucket_count * bucket_size;
   queue.reuse(0.0f, range, bucket_size, &labels);
+  queue.reserve(std::min(max_reserved_labels_count_, edge_label_reservation));
 }
 template void
 Dijkstras::Initialize<decltype(Dijkstras::bdedgelabels_)>(decltype(Dijkstras::bdedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::BDEdgeLabel>&,
+                                                          baldr::LabelQueue<sif::BDEdgeLabel>&,
                                                           const uint32_t);
 template void
 Dijkstras::Initialize<decltype(Dijkstras::mmedgelabels_)>(decltype(Dijkstras::mmedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::MMEdgeLabel>&,
+                                                          baldr::LabelQueue<sif::MMEdgeLabel>&,
                                                           const uint32_t);
 
 // Initializes the time of the expansion if there is one
@@ -147,11 +143,12 @@ void Dijkstras::ExpandInner(baldr::GraphReader& graphreader,
           : (FORWARD ? time_info.forward(pred.cost().secs, static_cast<int>(nodeinfo->timezone()))
                      : time_info.reverse(pred.cost().secs, static_cast<int>(nodeinfo->timezone())));
 
-  // Expand from end node in forward direction.
+  // Expand from end node in forward direction, unless the child-class keeps us off its edges
   GraphId edgeid = {node.tileid(), node.level(), nodeinfo->edge_index()};
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile, pred.path_id());
   const DirectedEdge* directededge = tile->directededge(edgeid);
-  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid, ++es) {
+  const uint32_t edge_count = ExpandEdgesOf(tile, nodeinfo, pred) ? nodeinfo->edge_count() : 0;
+  for (uint32_t i = 0; i < edge_count; ++i, ++directededge, ++edgeid, ++es) {
     // Skip this edge if permanently labeled (best path already found to this
     // directed edge). skip shortcuts or if no access is allowed to this edge
     // (based on the costing method) or if a complex restriction exists for
@@ -182,27 +179,19 @@ void Dijkstras::ExpandInner(baldr::GraphReader& graphreader,
     // is_dest is false, because it is a traversal algorithm in this context, not a path search
     // algorithm. In other words, destination edges are not defined for this Dijkstra's algorithm.
     const bool is_dest = false;
-    if (offset_time.valid) {
-      // With date time we check time dependent restrictions and access
-      const bool allowed =
-          FORWARD ? costing_->Allowed(directededge, is_dest, pred, tile, edgeid,
-                                      offset_time.local_time, nodeinfo->timezone(), restriction_idx)
-                  : costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedgeid,
-                                             offset_time.local_time, nodeinfo->timezone(),
-                                             restriction_idx);
-      if (!allowed || costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true,
-                                           todo, offset_time.local_time, nodeinfo->timezone())) {
-        continue;
-      }
-    } else {
-      const bool allowed = FORWARD ? costing_->Allowed(directededge, is_dest, pred, tile, edgeid, 0,
-                                                       0, restriction_idx)
-                                   : costing_->AllowedReverse(directededge, pred, opp_edge, t2,
-                                                              oppedgeid, 0, 0, restriction_idx);
-
-      if (!allowed || costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true)) {
-        continue;
-      }
+    // With date time we check time dependent restrictions and access
+    const uint64_t local_time = offset_time.valid ? offset_time.local_time : 0;
+    const uint32_t tz_index = offset_time.valid ? nodeinfo->timezone() : 0;
+    // The forward search gets the costs along with the access check
+    EdgeEvaluation evaluation;
+    const bool allowed =
+        FORWARD ? costing_->EvaluateEdge(directededge, is_dest, pred, tile, edgeid, nodeinfo,
+                                         offset_time, local_time, tz_index, evaluation)
+                : costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedgeid, local_time,
+                                           tz_index, restriction_idx);
+    if (!allowed || costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, true,
+                                         todo, local_time, tz_index)) {
+      continue;
     }
 
     // Compute the cost and path distance to the end of this edge
@@ -210,9 +199,10 @@ void Dijkstras::ExpandInner(baldr::GraphReader& graphreader,
     uint8_t flow_sources;
 
     if (FORWARD) {
-      transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
-      newcost = pred.cost() + costing_->EdgeCost(directededge, tile, offset_time, flow_sources) +
-                transition_cost;
+      restriction_idx = evaluation.restriction_idx;
+      flow_sources = evaluation.flow_sources;
+      transition_cost = evaluation.transition_cost;
+      newcost = pred.cost() + evaluation.edge_cost + transition_cost;
     } else {
       transition_cost =
           costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
@@ -294,6 +284,8 @@ void Dijkstras::Expand(const ExpansionType expansion_type,
                        baldr::GraphReader& reader,
                        const sif::mode_costing_t& costings,
                        const sif::travel_mode_t mode) {
+  auto timing = search_timer_.start(stats_, reader);
+
   // compute the expansion
   switch (expansion_type) {
     case ExpansionType::forward:
@@ -334,6 +326,34 @@ void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>&
 
   // Get the time information for all the origin locations
   auto time_infos = SetTime(locations, graphreader);
+  Settle<expansion_direction>(graphreader, time_infos.front());
+}
+
+template <const ExpansionType expansion_direction>
+void Dijkstras::Resume(google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                       baldr::GraphReader& graphreader,
+                       const sif::mode_costing_t& mode_costing,
+                       const sif::travel_mode_t mode,
+                       const std::vector<uint32_t>& labels) {
+  // The costing objects belong to the request so we take them again
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  access_mode_ = costing_->access_mode();
+
+  // The queue was drained by the traversal we continue so we can start it over with the labels
+  // that still need expanding, their edges stay permanent and are just settled again
+  Initialize(bdedgelabels_, adjacencylist_, costing_->UnitSize());
+  for (const auto label : labels) {
+    adjacencylist_.add(label);
+  }
+
+  auto time_infos = SetTime(locations, graphreader);
+  Settle<expansion_direction>(graphreader, time_infos.front());
+}
+
+template <const ExpansionType expansion_direction>
+void Dijkstras::Settle(baldr::GraphReader& graphreader, const baldr::TimeInfo& time_info) {
+  search_timer_.phase(SearchPhase::expansion);
 
   // Compute the isotile
   auto cb_decision = ExpansionRecommendation::continue_expansion;
@@ -344,6 +364,7 @@ void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>&
     if (predindex == baldr::kInvalidLabel) {
       break;
     }
+    ++stats_.settled;
 
     // Copy the EdgeLabel for use in costing and settle the edge.
     sif::BDEdgeLabel pred = bdedgelabels_[predindex];
@@ -365,12 +386,15 @@ void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>&
     if (cb_decision != ExpansionRecommendation::prune_expansion) {
       // Expand from the end node in expansion_direction.
       ExpandInner<expansion_direction>(graphreader, pred.endnode(), pred, predindex, opp_pred_edge,
-                                       false, time_infos.front());
+                                       false, time_info);
     }
 
     if (expansion_callback_) {
-      expansion_callback_(graphreader, pred.edgeid(), "dijkstras", "s", pred.cost().secs,
-                          pred.path_distance(), pred.cost().cost);
+      auto prev_pred = pred.predecessor() == kInvalidLabel
+                           ? GraphId{}
+                           : bdedgelabels_[pred.predecessor()].edgeid();
+      expansion_callback_(graphreader, pred.edgeid(), prev_pred, "dijkstras", "s",
+                          pred.cost().secs, pred.path_distance(), pred.cost().cost);
     }
   }
 }
@@ -390,6 +414,20 @@ template void Dijkstras::Compute<ExpansionType::reverse>(
     const sif::mode_costing_t& mode_costing,
     const sif::travel_mode_t mode);
 
+template void
+Dijkstras::Resume<ExpansionType::forward>(google::protobuf::RepeatedPtrField<valhalla::Location>&,
+                                          baldr::GraphReader&,
+                                          const sif::mode_costing_t&,
+                                          const sif::travel_mode_t,
+                                          const std::vector<uint32_t>&);
+
+template void
+Dijkstras::Resume<ExpansionType::reverse>(google::protobuf::RepeatedPtrField<valhalla::Location>&,
+                                          baldr::GraphReader&,
+                                          const sif::mode_costing_t&,
+                                          const sif::travel_mode_t,
+                                          const std::vector<uint32_t>&);
+
 // Expand from a node in forward direction using multimodal.
 void Dijkstras::ExpandForwardMultiModal(GraphReader& graphreader,
                                         const GraphId& node,
@@ -450,6 +488,7 @@ void Dijkstras::ExpandForwardMultiModal(GraphReader& graphreader,
   bool has_transit = pred.has_transit();
   GraphId prior_stop = pred.prior_stopid();
   uint32_t operator_id = pred.transit_operator();
+  bool departs = true;
   if (nodeinfo->type() == NodeType::kMultiUseTransitPlatform) {
     // Get the transfer penalty when changing stations
     if (mode_ == travel_mode_t::kPedestrian && prior_stop.Is_Valid() && has_transit) {
@@ -481,6 +520,14 @@ void Dijkstras::ExpandForwardMultiModal(GraphReader& graphreader,
       }
       date_set_ = true;
     }
+
+    // One lookup in the departure index of the stop tells if any of its lines still departs,
+    // when none does the departures of its transit edges need not be looked up one by one
+    uint32_t departure_time;
+    departs = !tile->has_stop_departures() ||
+              tile->GetNextStopDeparture(node.id(), offset_time.day_seconds(), day_, dow_,
+                                         date_before_tile_, tc->wheelchair(), tc->bicycle(),
+                                         departure_time) != nullptr;
   }
 
   // TODO: allow mode changes at special nodes
@@ -512,6 +559,11 @@ void Dijkstras::ExpandForwardMultiModal(GraphReader& graphreader,
     uint8_t restriction_idx = -1;
     const bool is_dest = false;
     if (directededge->IsTransitLine()) {
+      // Nothing leaves this stop anymore
+      if (!departs) {
+        continue;
+      }
+
       // Check if transit costing allows this edge
       if (!tc->Allowed(directededge, is_dest, pred, tile, edgeid, 0, 0, restriction_idx)) {
         continue;
@@ -716,6 +768,8 @@ void Dijkstras::ComputeMultiModal(
   operators_.clear();
   processed_tiles_.clear();
 
+  search_timer_.phase(SearchPhase::expansion);
+
   // Expand using adjacency list until we exceed threshold
   auto cb_decision = ExpansionRecommendation::continue_expansion;
   while (cb_decision != ExpansionRecommendation::stop_expansion) {
@@ -725,6 +779,7 @@ void Dijkstras::ComputeMultiModal(
     if (predindex == kInvalidLabel) {
       break;
     }
+    ++stats_.settled;
 
     // Copy the EdgeLabel for use in costing and settle the edge.
     MMEdgeLabel pred = mmedgelabels_[predindex];
@@ -3,9 +3,11 @@
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
 #include "midgard/constants.h"
+#include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/polyline2.h"
 #include "midgard/util.h"
+#include "tyr/serializers.h"
 
 using namespace rapidjson;
 using namespace valhalla::midgard;
@@ -14,12 +16,85 @@ namespace valhalla {
 namespace thor {
 
 // indices correspond to Options::ExpansionProperties enum
-const std::string kPropPaths[5] = {"/features/0/properties/costs", "/features/0/properties/durations",
+const std::string kPropPaths[6] = {"/features/0/properties/costs", "/features/0/properties/durations",
                                    "/features/0/properties/distances",
                                    "/features/0/properties/statuses",
-                                   "/features/0/properties/edge_ids"};
+                                   "/features/0/properties/edge_ids",
+                                   "/features/0/properties/pred_edge_ids"};
 
-std::string thor_worker_t::expansion(Api& request) {
+namespace {
+
+/*
+The binary expansion in little endian:
+
+  char[4]  "VEXP"
+  uint8    version, currently 1
+  uint8    flags, 1 when the records hold the edge shapes
+  uint16   reserved
+  then a record per edge in order of the expansion until the end of the response:
+    uint64   edge id
+    uint64   id of the edge it was reached from, kInvalidGraphId at the locations
+    uint8    status, 0 reached, 1 settled, 2 connected
+    float    cost
+    float    duration in seconds
+    uint32   distance in meters
+    if the shapes are included:
+      uint32   length of the shape
+      char[]   the generalized shape of the edge as a polyline6 in the direction of the edge
+
+The records are written as the algorithm expands and handed on in pieces of about
+kResponseChunkSize bytes, there is no document to build up and no tile to look at unless the shapes
+or skip_opposites were asked for.
+*/
+class binary_expansion_t {
+public:
+  binary_expansion_t(const bool shapes) : shapes_(shapes) {
+    chunk_.reserve(tyr::kResponseChunkSize + 4096);
+    chunk_.append("VEXP", 4);
+    tyr::write_le(chunk_, static_cast<uint8_t>(1));
+    tyr::write_le(chunk_, static_cast<uint8_t>(shapes ? 1 : 0));
+    tyr::write_le(chunk_, static_cast<uint16_t>(0));
+  }
+
+  void add(const baldr::GraphId edgeid,
+           const baldr::GraphId prev_edgeid,
+           const char* status,
+           const float cost,
+           const float duration,
+           const uint32_t distance,
+           const std::vector<PointLL>& shape) {
+    tyr::write_le(chunk_, static_cast<uint64_t>(edgeid));
+    tyr::write_le(chunk_, static_cast<uint64_t>(prev_edgeid));
+    tyr::write_le(chunk_, static_cast<uint8_t>(*status == 'r' ? 0 : (*status == 's' ? 1 : 2)));
+    tyr::write_le(chunk_, cost);
+    tyr::write_le(chunk_, duration);
+    tyr::write_le(chunk_, distance);
+    if (shapes_) {
+      auto encoded = encode(shape);
+      tyr::write_le(chunk_, static_cast<uint32_t>(encoded.size()));
+      chunk_ += encoded;
+    }
+    if (chunk_.size() >= tyr::kResponseChunkSize) {
+      chunks_.emplace_back(std::move(chunk_));
+      chunk_.clear();
+      chunk_.reserve(tyr::kResponseChunkSize + 4096);
+    }
+  }
+
+  std::list<std::string> finish() {
+    chunks_.emplace_back(std::move(chunk_));
+    return std::move(chunks_);
+  }
+
+protected:
+  bool shapes_;
+  std::string chunk_;
+  std::list<std::string> chunks_;
+};
+
+} // namespace
+
+std::list<std::string> thor_worker_t::expansion(Api& request) {
   // time this whole method and save that statistic
   measure_scope_time(request);
 
@@ -51,9 +126,9 @@ std::string thor_worker_t::expansion(Api& request) {
   // route and isochrone produce different GeoJSON properties
   auto track_expansion = [&dom, &opp_edges, &gen_factor, &skip_opps,
                           &exp_props](baldr::GraphReader& reader, baldr::GraphId edgeid,
-                                      const char* algorithm = nullptr, const char* status = nullptr,
-                                      const float duration = 0.f, const uint32_t distance = 0,
-                                      const float cost = 0.f) {
+                                      baldr::GraphId prev_edgeid, const char* algorithm = nullptr,
+                                      const char* status = nullptr, const float duration = 0.f,
+                                      const uint32_t distance = 0, const float cost = 0.f) {
     auto tile = reader.GetGraphTile(edgeid);
     if (tile == nullptr) {
       LOG_ERROR("thor_worker_t::expansion error, tile no longer available" +
@@ -64,8 +139,6 @@ std::string thor_worker_t::expansion(Api& request) {
     // unfortunately we have to call this before checking if we can skip
     // else the tile could change underneath us when we get the opposing
     auto shape = tile->edgeinfo(edge).shape();
-    auto names = tile->edgeinfo(edge).GetNames();
-    auto is_forward = edge->forward();
 
     // if requested, skip this edge in case its opposite edge has been added
     // before (i.e. lower cost) else add this edge's id to the lookup container
@@ -127,20 +200,66 @@ std::string thor_worker_t::expansion(Api& request) {
           .Get(dom)
           ->GetArray()
           .PushBack(Value{}.SetUint64(static_cast<uint64_t>(edgeid)), a);
+    if (exp_props.count(Options_ExpansionProperties_pred_edge_ids))
+      Pointer(kPropPaths[Options_ExpansionProperties_pred_edge_ids])
+          .Get(dom)
+          ->GetArray()
+          .PushBack(Value{}.SetUint64(static_cast<uint64_t>(prev_edgeid)), a);
+  };
+
+  // the binary format only looks at the tile for what it was asked to include
+  const bool shapes = options.expansion_shapes();
+  binary_expansion_t binary(shapes);
+  auto track_binary = [&binary, &opp_edges, &gen_factor, &skip_opps,
+                       shapes](baldr::GraphReader& reader, baldr::GraphId edgeid,
+                               baldr::GraphId prev_edgeid, const char*, const char* status,
+                               const float duration, const uint32_t distance, const float cost) {
+    std::vector<PointLL> shape;
+    if (shapes || skip_opps) {
+      auto tile = reader.GetGraphTile(edgeid);
+      if (tile == nullptr) {
+        LOG_ERROR("thor_worker_t::expansion error, tile no longer available" +
+                  std::to_string(edgeid.Tile_Base()));
+        return;
+      }
+      const auto* edge = tile->directededge(edgeid);
+      // the shape comes first as getting the opposing edge may change the tile
+      if (shapes) {
+        shape = tile->edgeinfo(edge).shape();
+        if (!edge->forward())
+          std::reverse(shape.begin(), shape.end());
+        Polyline2<PointLL>::Generalize(shape, gen_factor, {}, false);
+      }
+      if (skip_opps) {
+        auto opp_edgeid = reader.GetOpposingEdgeId(edgeid, tile);
+        if (opp_edgeid && opp_edges.count(opp_edgeid))
+          return;
+        opp_edges.insert(edgeid);
+      }
+    }
+    binary.add(edgeid, prev_edgeid, status, cost, duration, distance, shape);
   };
+  const bool is_binary = options.format() == Options::binary;
+  PathAlgorithm::expansion_callback_t callback;
+  if (is_binary) {
+    callback = track_binary;
+  } else {
+    callback = track_expansion;
+  }
 
   // tell all the algorithms how to track expansion
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
        }) {
-    alg->set_track_expansion(track_expansion);
+    alg->set_track_expansion(callback);
   }
-  costmatrix_.set_track_expansion(track_expansion);
-  isochrone_gen.SetInnerExpansionCallback(track_expansion);
+  costmatrix_.set_track_expansion(callback);
+  isochrone_gen.SetInnerExpansionCallback(callback);
 
   try {
     // track the expansion
@@ -157,15 +276,18 @@ std::string thor_worker_t::expansion(Api& request) {
   }
 
   // tell all the algorithms to stop tracking the expansion
-  for (auto* alg : std::vector<PathAlgorithm*>{&multi_modal_astar, &timedep_forward, &timedep_reverse,
-                                               &bidir_astar, &bss_astar}) {
+  for (auto* alg : std::vector<PathAlgorithm*>{&multi_modal_astar, &raptor, &timedep_forward,
+                                               &timedep_reverse, &bidir_astar, &bss_astar}) {
     alg->set_track_expansion(nullptr);
   }
   costmatrix_.set_track_expansion(nullptr);
   isochrone_gen.SetInnerExpansionCallback(nullptr);
 
   // serialize it
-  return to_string(dom, 5);
+  if (is_binary) {
+    return binary.finish();
+  }
+  return {to_string(dom, 5)};
 }
 
 } // namespace thor
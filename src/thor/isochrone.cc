@@ -1,10 +1,12 @@
 #include "thor/isochrone.h"
 #include "baldr/datetime.h"
+#include "baldr/tilehierarchy.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
 #include <algorithm>
 #include <iostream> // TODO remove if not needed
 #include <map>
+#include <string>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -14,6 +16,17 @@ namespace {
 
 constexpr float METRIC_PADDING = 10.f;
 
+// append the raw bytes of a value to the key
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// append a length prefixed string to the key
+void append(std::string& key, const std::string& value) {
+  append(key, value.size());
+  key.append(value);
+}
+
 template <typename PrecisionT>
 std::vector<GeoPoint<PrecisionT>> OriginEdgeShape(const std::vector<GeoPoint<PrecisionT>>& pts,
                                                   double distance_along) {
@@ -39,15 +52,25 @@ namespace thor {
 
 // Default constructor
 Isochrone::Isochrone(const boost::property_tree::ptree& config)
-    : Dijkstras(config), shape_interval_(50.0f) {
+    : Dijkstras(config), shape_interval_(50.0f),
+      contour_threads_(std::max<size_t>(config.get<size_t>("isochrone_contour_threads", 1), 1)),
+      cache_size_(config.get<size_t>("isochrone_cache.size", 0)),
+      cache_max_age_(std::chrono::seconds(config.get<uint32_t>("isochrone_cache.max_age", 300))),
+      hierarchical_(false),
+      boundary_band_(std::max(config.get<float>("isochrone_hierarchy.boundary_band", 0.1f), 0.f)) {
+  // the highway level is expanded everywhere, the transit level has no level above it
+  level_reach_.resize(TileHierarchy::levels().size(), std::numeric_limits<float>::max());
+  const float arterial = config.get<float>("isochrone_hierarchy.arterial_reach", 100000.f);
+  const float local = config.get<float>("isochrone_hierarchy.local_reach", 25000.f);
+  level_reach_[1] = arterial * arterial;
+  level_reach_[2] = local * local;
 }
 
-// Construct the isotile. Use a fixed grid size. Convert time in minutes to
-// a max distance in meters based on an estimate of max average speed for
-// the travel mode.
-void Isochrone::ConstructIsoTile(const bool multimodal,
-                                 const valhalla::Api& api,
-                                 const sif::travel_mode_t mode) {
+// Set the limits of the expansion. Convert time in minutes to a max distance in meters based on
+// an estimate of max average speed for the travel mode.
+float Isochrone::SetLimits(const bool multimodal,
+                           const valhalla::Api& api,
+                           const sif::travel_mode_t mode) {
 
   // Extend the times in the 2-D grid to be 10 minutes beyond the highest contour time.
   // Cost (including penalties) is used when adding to the adjacency list but the elapsed
@@ -59,9 +82,9 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
                          return (!a.has_time_case() && b.has_time_case()) ||
                                 (a.has_time_case() && b.has_time_case() && a.time() < b.time());
                        });
-  bool has_time = max_time_itr->has_time_case();
+  has_time_ = max_time_itr->has_time_case();
   auto max_minutes =
-      has_time ? max_time_itr->time() + METRIC_PADDING : std::numeric_limits<float>::min();
+      has_time_ ? max_time_itr->time() + METRIC_PADDING : std::numeric_limits<float>::min();
   auto max_dist_itr =
       std::max_element(api.options().contours().begin(), api.options().contours().end(),
                        [](const auto& a, const auto& b) {
@@ -69,12 +92,13 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
                                 (a.has_distance_case() && b.has_distance_case() &&
                                  a.distance() < b.distance());
                        });
-  bool has_distance = max_dist_itr->has_distance_case();
+  has_distance_ = max_dist_itr->has_distance_case();
   auto max_km =
-      has_distance ? max_dist_itr->distance() + METRIC_PADDING : std::numeric_limits<float>::min();
+      has_distance_ ? max_dist_itr->distance() + METRIC_PADDING : std::numeric_limits<float>::min();
 
-  max_seconds_ = has_time ? max_minutes * kSecPerMinute : max_minutes;
-  max_meters_ = has_distance ? max_km * kMetersPerKm : max_km;
+  max_seconds_ = has_time_ ? max_minutes * kSecPerMinute : max_minutes;
+  max_meters_ = has_distance_ ? max_km * kMetersPerKm : max_km;
+  grid_max_ = {max_minutes, max_km};
   float max_distance;
   if (multimodal) {
     max_distance = max_seconds_ * 70.0f * kMPHtoMetersPerSec;
@@ -87,8 +111,26 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
     max_distance = max_seconds_ * 70.0f * kMPHtoMetersPerSec;
   }
   // Either the user-specified or estimated max distance
-  max_distance = std::max(max_distance, max_meters_);
+  max_distance_ = std::max(max_distance, max_meters_);
+
+  // Optimize for 600 cells in latitude (slightly larger for multimodal).
+  // Round off to nearest 0.001 degree. TODO - revisit min and max grid sizes
+  float dlat = max_distance_ / kMetersPerDegreeLat;
+  float grid_size = multimodal ? dlat / 500.0f : dlat / 300.0f;
+  if (grid_size < 0.001f) {
+    grid_size = 0.001f;
+  } else if (grid_size > 0.005f) {
+    grid_size = 0.005f;
+  } else {
+    // Round to nearest 0.001
+    int r = std::round(grid_size * 1000.0f);
+    grid_size = static_cast<float>(r) * 0.001f;
+  }
+  return grid_size;
+}
 
+// Construct the isotile. Use a fixed grid size.
+void Isochrone::ConstructIsoTile(const valhalla::Api& api, const float grid_size) {
   // Form bounding box that's just big enough to surround all of the locations.
   // Convert to PointLL
   PointLL center_ll(api.options().locations(0).ll().lng(), api.options().locations(0).ll().lat());
@@ -111,22 +153,9 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
   }
 
   // Range of grids in latitude space
-  float dlat = max_distance / kMetersPerDegreeLat;
+  float dlat = max_distance_ / kMetersPerDegreeLat;
   // Range of grids in longitude space
-  float dlon = max_distance / DistanceApproximator<PointLL>::MetersPerLngDegree(center_ll.lat());
-
-  // Optimize for 600 cells in latitude (slightly larger for multimodal).
-  // Round off to nearest 0.001 degree. TODO - revisit min and max grid sizes
-  float grid_size = multimodal ? dlat / 500.0f : dlat / 300.0f;
-  if (grid_size < 0.001f) {
-    grid_size = 0.001f;
-  } else if (grid_size > 0.005f) {
-    grid_size = 0.005f;
-  } else {
-    // Round to nearest 0.001
-    int r = std::round(grid_size * 1000.0f);
-    grid_size = static_cast<float>(r) * 0.001f;
-  }
+  float dlon = max_distance_ / DistanceApproximator<PointLL>::MetersPerLngDegree(center_ll.lat());
 
   // Set the shape interval in meters
   shape_interval_ = grid_size * kMetersPerDegreeLat * 0.25f;
@@ -136,7 +165,7 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
                         loc_bounds.maxy() + dlat);
 
   // Create isotile (gridded data)
-  isotile_.reset(new GriddedData<2>(bounds, grid_size, {max_minutes, max_km}));
+  isotile_.reset(new GriddedData<2>(bounds, grid_size, grid_max_));
 
   // Find the center of the grid that the location lies within. Shift the
   // tilebounds so the location lies in the center of a tile.
@@ -156,7 +185,8 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
   // initialize the time at these locations
   for (const auto& location : api.options().locations()) {
     auto tile_id = isotile_->TileId({location.ll().lng(), location.ll().lat()});
-    isotile_->SetIfLessThan(tile_id, {has_time ? 0.0f : max_minutes, has_distance ? 0.0f : max_km});
+    isotile_->SetIfLessThan(tile_id, {has_time_ ? 0.0f : grid_max_[0],
+                                     has_distance_ ? 0.0f : grid_max_[1]});
   }
 }
 
@@ -166,23 +196,161 @@ std::shared_ptr<const GriddedData<2>> Isochrone::Expand(const ExpansionType& exp
                                                         GraphReader& reader,
                                                         const sif::mode_costing_t& mode_costing,
                                                         const travel_mode_t mode) {
-  // Initialize and create the isotile
-  ConstructIsoTile(expansion_type == ExpansionType::multimodal, api, mode);
-  // Compute the expansion
-  Dijkstras::Expand(expansion_type, api, reader, mode_costing, mode);
+  // a grid from the cache costs no search, a fresh expansion starts the timer over in Dijkstras
+  auto timing = search_timer_.start(stats_, reader);
+  const bool multimodal = expansion_type == ExpansionType::multimodal;
+  const float grid_size = SetLimits(multimodal, api, mode);
+
+  // The expansion action wants to see the search, transit schedules and requests for the current
+  // time move on with the clock
+  const auto& options = api.options();
+  // A hierarchical grid is only as detailed as the contours it was expanded for need it to be
+  hierarchical_ = options.hierarchical() && !multimodal;
+  if (hierarchical_) {
+    SetHierarchy(api);
+  }
+  const bool cacheable = cache_size_ > 0 && !multimodal && !inner_expansion_callback_ &&
+                         !hierarchical_ && options.action() != Options::expansion &&
+                         options.date_time_type() != Options::current;
+  if (!cacheable) {
+    ForgetExpansion();
+    ConstructIsoTile(api, grid_size);
+    Dijkstras::Expand(expansion_type, api, reader, mode_costing, mode);
+    return isotile_;
+  }
+
+  // Expired grids are of no use, not even to extend them
+  const auto now = std::chrono::steady_clock::now();
+  const auto key = CacheKey(expansion_type, api);
+  auto cached = std::find_if(cache_.begin(), cache_.end(),
+                             [&key](const cached_grid_t& entry) { return entry.key == key; });
+  if (cached != cache_.end() && now - cached->created > cache_max_age_) {
+    cache_.erase(cached);
+    cached = cache_.end();
+  }
+
+  // A grid that reaches as far with cells at least as small answers the request as it is
+  if (cached != cache_.end() && cached->max_seconds >= max_seconds_ &&
+      cached->max_meters >= max_meters_ && cached->grid->TileSize() <= grid_size) {
+    cache_.splice(cache_.begin(), cache_, cached);
+    return cached->grid;
+  }
+
+  if (cached != cache_.end() && resumable_key_ == key && cached->grid == isotile_) {
+    // We still have the expansion of a grid that doesnt reach far enough so we copy its cells
+    // into a larger grid with the same cell size and continue from the labels it pruned
+    auto previous = isotile_;
+    max_seconds_ = std::max(max_seconds_, cached->max_seconds);
+    max_meters_ = std::max(max_meters_, cached->max_meters);
+    max_distance_ = std::max(max_distance_, cached->max_distance);
+    for (size_t i = 0; i < grid_max_.size(); ++i) {
+      grid_max_[i] = std::max(grid_max_[i], previous->MaxValue()[i]);
+    }
+    ConstructIsoTile(api, previous->TileSize());
+    isotile_->SetIfLessThan(*previous);
+
+    auto pruned = std::move(pruned_);
+    pruned_.clear();
+    if (expansion_type == ExpansionType::forward) {
+      Resume<ExpansionType::forward>(*api.mutable_options()->mutable_locations(), reader,
+                                     mode_costing, mode, pruned);
+    } else {
+      Resume<ExpansionType::reverse>(*api.mutable_options()->mutable_locations(), reader,
+                                     mode_costing, mode, pruned);
+    }
+    cached->grid = isotile_;
+  } else {
+    // Expand from scratch and keep the labels so a later request can extend the grid
+    ForgetExpansion();
+    ConstructIsoTile(api, grid_size);
+    resumable_key_ = key;
+    Dijkstras::Expand(expansion_type, api, reader, mode_costing, mode);
+    if (cached != cache_.end()) {
+      cache_.erase(cached);
+    }
+    cache_.push_front(cached_grid_t{key, isotile_, 0.f, 0.f, 0.f, now});
+    cached = cache_.begin();
+    if (cache_.size() > cache_size_) {
+      cache_.pop_back();
+    }
+  }
+  cached->max_seconds = max_seconds_;
+  cached->max_meters = max_meters_;
+  cached->max_distance = max_distance_;
+  cache_.splice(cache_.begin(), cache_, cached);
   return isotile_;
 }
 
+// Keep the labels of the expansion we can extend, the next request may need them
+void Isochrone::Clear() {
+  if (resumable_key_.empty()) {
+    Dijkstras::Clear();
+  }
+}
+
+// Everything the grid of a request depends on besides how far it reaches
+std::string Isochrone::CacheKey(const ExpansionType expansion_type,
+                                const valhalla::Api& api) const {
+  const auto& options = api.options();
+  std::string key;
+  append(key, expansion_type);
+  append(key, has_time_);
+  append(key, has_distance_);
+  append(key, options.date_time_type());
+  append(key, options.date_time());
+
+  // the options of every costing, in the order of their type
+  std::map<int32_t, const Costing*> costings;
+  for (const auto& costing : options.costings()) {
+    costings.emplace(costing.first, &costing.second);
+  }
+  for (const auto& costing : costings) {
+    append(key, costing.first);
+    append(key, costing.second->SerializeAsString());
+  }
+
+  // the locations with the edges they were snapped to
+  for (const auto& location : options.locations()) {
+    append(key, location.SerializeAsString());
+  }
+  return key;
+}
+
+void Isochrone::SetHierarchy(const valhalla::Api& api) {
+  origins_.clear();
+  for (const auto& location : api.options().locations()) {
+    origins_.emplace_back(PointLL(location.ll().lng(), location.ll().lat()));
+  }
+  contour_seconds_.clear();
+  contour_meters_.clear();
+  for (const auto& contour : api.options().contours()) {
+    if (contour.has_time_case()) {
+      contour_seconds_.push_back(contour.time() * kSecPerMinute);
+    }
+    if (contour.has_distance_case()) {
+      contour_meters_.push_back(contour.distance() * kMetersPerKm);
+    }
+  }
+}
+
+void Isochrone::ForgetExpansion() {
+  if (!resumable_key_.empty()) {
+    resumable_key_.clear();
+    Dijkstras::Clear();
+  }
+  pruned_.clear();
+}
+
 void Isochrone::UpdateIsoTileAlongSegment(const midgard::PointLL& from,
                                           const midgard::PointLL& to,
+                                          int32_t tile1,
+                                          int32_t tile2,
                                           float seconds,
                                           float meters) {
   float minutes = seconds * kMinPerSec;
   float km = meters * kKmPerMeter;
   // Mark tiles that intersect the segment. Optimize this to avoid calling the Intersect
   // method unless more than 2 tiles are crossed by the segment.
-  auto tile1 = isotile_->TileId(from);
-  auto tile2 = isotile_->TileId(to);
   if (tile1 == tile2) {
     isotile_->SetIfLessThan(tile1, {minutes, km});
   } else if (isotile_->AreNeighbors(tile1, tile2)) {
@@ -268,11 +436,24 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred,
   float meters = dist0;
   float delta_seconds = ((secs1 - secs0) / (resampled.size() - 1));
   float delta_meters = ((dist1 - dist0) / (resampled.size() - 1));
-  auto itr1 = resampled.begin();
-  for (auto itr2 = itr1 + 1; itr2 < resampled.end(); itr1++, itr2++) {
+
+  // Find the tiles of all the shape points in one go rather than twice per segment
+  isotile_->TileIds(resampled, shape_tiles_);
+
+  // When the values only grow along the shape a segment within the tile we last marked cant
+  // lower that tile any further, so we skip it
+  const bool increasing = delta_seconds >= 0.0f && delta_meters >= 0.0f;
+  int32_t marked = -1;
+  for (size_t i = 1; i < resampled.size(); ++i) {
     seconds += delta_seconds;
     meters += delta_meters;
-    UpdateIsoTileAlongSegment(*itr1, *itr2, seconds, meters);
+    const auto tile1 = shape_tiles_[i - 1];
+    const auto tile2 = shape_tiles_[i];
+    if (increasing && tile1 == tile2 && tile2 == marked) {
+      continue;
+    }
+    UpdateIsoTileAlongSegment(resampled[i - 1], resampled[i], tile1, tile2, seconds, meters);
+    marked = tile1 == tile2 || isotile_->AreNeighbors(tile1, tile2) ? tile2 : -1;
   }
 }
 
@@ -312,8 +493,13 @@ ExpansionRecommendation Isochrone::ShouldExpand(baldr::GraphReader& /*graphreade
   // max but need to consider others so we just continue here. Tells MMExpand function to skip
   // updating or pushing the label back
   // prune the edge if its start is above max contour
-  if (time > max_seconds_ && dist > max_meters_)
+  if (time > max_seconds_ && dist > max_meters_) {
+    // remember where we stopped in case a later request wants to go further
+    if (!resumable_key_.empty()) {
+      pruned_.push_back(edgestatus_.Get(pred.edgeid(), pred.path_id()).index());
+    }
     return ExpansionRecommendation::prune_expansion;
+  }
 
   // track expansion
   if (inner_expansion_callback_ && (time <= (max_seconds_ - METRIC_PADDING * kSecondsPerMinute) ||
@@ -328,6 +514,36 @@ ExpansionRecommendation Isochrone::ShouldExpand(baldr::GraphReader& /*graphreade
   return ExpansionRecommendation::continue_expansion;
 };
 
+bool Isochrone::ExpandEdgesOf(graph_tile_ptr tile,
+                              const baldr::NodeInfo* node,
+                              const sif::EdgeLabel& pred) {
+  const auto level = tile->header()->graphid().level();
+  if (!hierarchical_ || level >= level_reach_.size()) {
+    return true;
+  }
+
+  // the roads of every level shape the contours so we take them all near a contour
+  for (const auto seconds : contour_seconds_) {
+    if (std::abs(pred.cost().secs - seconds) <= seconds * boundary_band_) {
+      return true;
+    }
+  }
+  for (const auto meters : contour_meters_) {
+    if (std::abs(pred.path_distance() - meters) <= meters * boundary_band_) {
+      return true;
+    }
+  }
+
+  // and near the locations, where the roads of the level above dont reach everywhere yet
+  const auto ll = node->latlng(tile->header()->base_ll());
+  for (const auto& origin : origins_) {
+    if (origin.DistanceSquared(ll) <= level_reach_[level]) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void Isochrone::GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const {
   bucket_count = 20000;
   edge_label_reservation = kInitialEdgeLabelCountDijkstras;
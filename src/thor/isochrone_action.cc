@@ -38,16 +38,22 @@ std::string thor_worker_t::isochrones(Api& request) {
                             ? ExpansionType::multimodal
                             : (reverse ? ExpansionType::reverse : ExpansionType::forward);
   auto grid = isochrone_gen.Expand(expansion_type, request, *reader, mode_costing, mode);
+  add_search_stats(request, "isochrone", isochrone_gen.search_stats());
 
   // e.g. in case of /expansion request
   if (options.action() == Options_Action_expansion)
     return "";
 
+  // a raster is the grid itself so there is nothing to trace
+  if (options.format() == Options::raster) {
+    return tyr::serializeIsochroneRaster(request, *grid, contours);
+  }
+
   // we have parallel vectors of contour properties and the actual geojson features
   // this method sorts the contour specifications by metric (time or distance) and then by value
   // with the largest values coming first. eg (60min, 30min, 10min, 40km, 10km)
-  auto isolines =
-      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize());
+  auto isolines = grid->GenerateContours(contours, options.polygons(), options.denoise(),
+                                         options.generalize(), isochrone_gen.contour_threads());
 
   // make the final json
   std::string ret = tyr::serializeIsochrones(request, contours, isolines, options.polygons(),
@@ -0,0 +1,154 @@
+#include <exception>
+
+#include "midgard/constants.h"
+#include "midgard/distanceapproximator.h"
+#include "midgard/logging.h"
+#include "thor/worker.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+using contour_intervals_t = std::vector<GriddedData<2>::contour_interval_t>;
+
+// the area in square kilometers and the population within each contour of an isochrone grid,
+// every cell counts whole if its value is within the contour
+std::vector<std::pair<double, double>>
+grid_metrics(const GriddedData<2>& grid,
+             const contour_intervals_t& contours,
+             const google::protobuf::RepeatedPtrField<PopulationCell>& population) {
+  std::vector<std::pair<double, double>> metrics(contours.size(), {0., 0.});
+  auto within = [&contours](const GriddedData<2>::value_type& value, size_t c) {
+    return value[std::get<0>(contours[c])] <= std::get<1>(contours[c]);
+  };
+
+  // the cells of a row all have the same area
+  const double cell_height = grid.TileSize() * kMetersPerDegreeLat;
+  for (int32_t row = 0; row < grid.nrows(); ++row) {
+    const auto lat = grid.Base(grid.TileId(0, row)).lat() + grid.TileSize() / 2;
+    const double cell_km2 = cell_height * cell_height *
+                            DistanceApproximator<PointLL>::LngScalePerLat(lat) * kKmPerMeter *
+                            kKmPerMeter;
+    for (int32_t col = 0; col < grid.ncolumns(); ++col) {
+      const auto& value = grid.DataAt(grid.TileId(col, row));
+      for (size_t c = 0; c < contours.size(); ++c) {
+        if (within(value, c)) {
+          metrics[c].first += cell_km2;
+        }
+      }
+    }
+  }
+
+  // the people of the population cells whose centers are within the contours
+  for (const auto& cell : population) {
+    const auto tile_id = grid.TileId(cell.ll().lat(), cell.ll().lng());
+    if (tile_id < 0) {
+      continue;
+    }
+    for (size_t c = 0; c < contours.size(); ++c) {
+      if (within(grid.DataAt(tile_id), c)) {
+        metrics[c].second += cell.count();
+      }
+    }
+  }
+  return metrics;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::string thor_worker_t::isochrone_batch(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  auto& options = *request.mutable_options();
+  adjust_scores(options);
+  auto costing = parse_costing(request);
+
+  // name of the metric (time/distance, value, color)
+  contour_intervals_t contours;
+  for (const auto& contour : options.contours()) {
+    if (contour.has_time_case()) {
+      contours.emplace_back(0, contour.time(), "time", contour.color());
+    }
+    if (contour.has_distance_case()) {
+      contours.emplace_back(1, contour.distance(), "distance", contour.color());
+    }
+  }
+  if (!options.has_generalize_case()) {
+    options.set_generalize(kOptimalGeneralization);
+  }
+  bool reverse = options.reverse() || options.date_time_type() == valhalla::Options::arrive_by;
+  auto expansion_type = costing == "multimodal" || costing == "transit"
+                            ? ExpansionType::multimodal
+                            : (reverse ? ExpansionType::reverse : ExpansionType::forward);
+
+  // every isochrone is expanded for a request of its own which only holds its location
+  Api base;
+  *base.mutable_options() = options;
+  base.mutable_options()->clear_locations();
+  base.mutable_options()->clear_population();
+  base.mutable_options()->clear_id();
+
+  // the isochrones are handed out one at a time to whichever thread of the pool is done with its
+  // last one, every thread expands with an isochrone and a reader of its own
+  const size_t count = options.locations_size();
+  std::vector<std::vector<std::pair<double, double>>> metrics(count);
+  std::vector<std::string> geojson(count);
+  std::vector<std::exception_ptr> errors(count);
+  const size_t helpers = std::min(isochrone_batch_workers.size(), std::max<size_t>(count, 1) - 1);
+  std::vector<sif::mode_costing_t> batch_costings(helpers);
+  const thread_pool_t::task_t expand = [&](const size_t i, const size_t slot, GraphReader&) {
+    auto& isochrone = slot == 0 ? isochrone_gen : isochrone_batch_workers[slot - 1]->isochrone;
+    auto& graph_reader = slot == 0 ? *reader : *isochrone_batch_workers[slot - 1]->reader;
+    const auto& costings = slot == 0 ? mode_costing : batch_costings[slot - 1];
+    const auto& location = options.locations(i);
+    if (location.correlation().edges_size() == 0) {
+      return;
+    }
+    try {
+      Api single(base);
+      *single.mutable_options()->add_locations() = location;
+      auto grid = isochrone.Expand(expansion_type, single, graph_reader, costings, mode);
+      metrics[i] = grid_metrics(*grid, contours, options.population());
+      if (!options.metrics_only()) {
+        auto intervals = contours;
+        auto isolines = grid->GenerateContours(intervals, options.polygons(), options.denoise(),
+                                               options.generalize());
+        geojson[i] = tyr::serializeIsochrones(single, intervals, isolines, options.polygons(),
+                                              options.show_locations());
+      }
+    } // one location without an isochrone doesn't fail the whole batch
+    catch (const valhalla_exception_t& e) {
+      LOG_DEBUG("isochrone_batch location " + std::to_string(i) + " failed: " + e.what());
+    } catch (...) { errors[i] = std::current_exception(); }
+    isochrone.Clear();
+  };
+
+  {
+    auto _ = measure_phase_time(request, service_name(), "expansion");
+    for (size_t i = 0; i < helpers; ++i) {
+      isochrone_batch_workers[i]->reader->SetInterrupt(interrupt);
+      sif::TravelMode batch_mode;
+      batch_costings[i] = factory.CreateModeCosting(options, batch_mode);
+    }
+    thread_pool->run(count, expand, *reader, interrupt, helpers + 1);
+  }
+
+  // anything but a location without an isochrone fails the request
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  return tyr::serializeIsochroneBatch(request, contours, metrics, geojson);
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,7 +1,11 @@
+#include <unordered_map>
+
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
+#include "thor/matrix_common.h"
 #include "thor/timedistancebssmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -14,12 +18,128 @@ using namespace valhalla::baldr;
 using namespace valhalla::sif;
 using namespace valhalla::thor;
 
+namespace {
+
+using locations_t = google::protobuf::RepeatedPtrField<valhalla::Location>;
+
+// The searches of a matrix only look at where a location snapped to, its coordinate and its time
+std::string search_key(const valhalla::Location& location) {
+  std::string key;
+  auto append = [&key](const std::string& part) {
+    key += std::to_string(part.size());
+    key += ':';
+    key += part;
+  };
+  append(location.ll().SerializeAsString());
+  for (const auto& edge : location.correlation().edges()) {
+    append(edge.SerializeAsString());
+  }
+  append(location.date_time());
+  return key;
+}
+
+// The locations of a request and the unique location each of them is answered by
+struct unique_locations_t {
+  locations_t all;
+  std::vector<uint32_t> index;
+  bool duplicates = false;
+};
+
+// Swaps the locations for the unique ones among them, the first of the locations that search the
+// same is kept
+unique_locations_t make_unique(locations_t& locations) {
+  unique_locations_t unique;
+  unique.index.reserve(locations.size());
+  std::unordered_map<std::string, uint32_t> keys;
+  locations_t kept;
+  for (const auto& location : locations) {
+    auto inserted = keys.emplace(search_key(location), kept.size());
+    if (inserted.second) {
+      *kept.Add() = location;
+    }
+    unique.index.push_back(inserted.first->second);
+  }
+  unique.duplicates = kept.size() < locations.size();
+  if (unique.duplicates) {
+    unique.all.Swap(&locations);
+    locations.Swap(&kept);
+  }
+  return unique;
+}
+
+// Puts the locations of the request back and fills the cells of their duplicates
+void restore(valhalla::Options& options,
+             valhalla::Matrix& matrix,
+             unique_locations_t& sources,
+             unique_locations_t& targets) {
+  if (!sources.duplicates && !targets.duplicates) {
+    return;
+  }
+  const size_t unique_targets = options.targets_size();
+  if (sources.duplicates) {
+    options.mutable_sources()->Swap(&sources.all);
+  }
+  if (targets.duplicates) {
+    options.mutable_targets()->Swap(&targets.all);
+  }
+
+  valhalla::Matrix unique;
+  unique.Swap(&matrix);
+  matrix.set_algorithm(unique.algorithm());
+  const size_t target_count = targets.index.size();
+  valhalla::thor::reserve_pbf_arrays(matrix, sources.index.size() * target_count);
+  const bool date_times = unique.date_times_size() == unique.times_size();
+  for (size_t source = 0; source < sources.index.size(); ++source) {
+    for (size_t target = 0; target < target_count; ++target) {
+      const size_t cell = source * target_count + target;
+      const size_t from = sources.index[source] * unique_targets + targets.index[target];
+      matrix.mutable_from_indices()->Set(cell, source);
+      matrix.mutable_to_indices()->Set(cell, target);
+      matrix.mutable_distances()->Set(cell, unique.distances(from));
+      matrix.mutable_times()->Set(cell, unique.times(from));
+      *matrix.add_date_times() = date_times ? unique.date_times(from) : std::string();
+    }
+  }
+
+  // the locations of a search that was not finished are all incomplete
+  for (size_t source = 0; source < sources.index.size(); ++source) {
+    for (const auto incomplete : unique.incomplete_sources()) {
+      if (sources.index[source] == incomplete) {
+        matrix.add_incomplete_sources(source);
+      }
+    }
+  }
+  for (size_t target = 0; target < target_count; ++target) {
+    for (const auto incomplete : unique.incomplete_targets()) {
+      if (targets.index[target] == incomplete) {
+        matrix.add_incomplete_targets(target);
+      }
+    }
+  }
+}
+
+// Whether the sources and targets are the same locations and none of them has a time
+bool same_locations(const valhalla::Options& options) {
+  if (options.sources_size() != options.targets_size()) {
+    return false;
+  }
+  for (int i = 0; i < options.sources_size(); ++i) {
+    const auto& source = options.sources(i);
+    if (!source.date_time().empty() || search_key(source) != search_key(options.targets(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
 namespace valhalla {
 namespace thor {
 
 constexpr uint32_t kCostMatrixThreshold = 5;
 
-std::string thor_worker_t::matrix(Api& request) {
+std::list<std::string> thor_worker_t::matrix(Api& request) {
   // time this whole method and save that statistic
   auto _ = measure_scope_time(request);
 
@@ -27,77 +147,187 @@ std::string thor_worker_t::matrix(Api& request) {
   adjust_scores(options);
   auto costing = parse_costing(request);
 
+  // Locations that snapped to the same place at the same time are only searched from once, the
+  // cells of their duplicates are copied from theirs once the matrix is done
+  auto unique_sources = make_unique(*options.mutable_sources());
+  auto unique_targets = make_unique(*options.mutable_targets());
+
+  // the rows of a time distance matrix that are not done in time are left out of it
+  time_distance_matrix_.set_deadline(matrix_time_limit.count() > 0
+                                         ? std::chrono::steady_clock::now() + matrix_time_limit
+                                         : std::chrono::steady_clock::time_point::max());
+
   // lambdas to do the real work
   auto costmatrix = [&](const bool has_time) {
-    return costmatrix_.SourceToTarget(request, *reader, mode_costing, mode,
-                                      max_matrix_distance.find(costing)->second, has_time,
-                                      options.date_time_type() == Options::invariant);
+    {
+      auto _ = measure_phase_time(request, service_name(), "expansion");
+      costmatrix_.SourceToTarget(request, *reader, mode_costing, mode,
+                                 max_matrix_distance.find(costing)->second, has_time,
+                                 options.date_time_type() == Options::invariant);
+    }
+    add_search_stats(request, "costmatrix", costmatrix_.search_stats());
   };
   auto timedistancematrix = [&]() {
-    return time_distance_matrix_.SourceToTarget(request, *reader, mode_costing, mode,
-                                                max_matrix_distance.find(costing)->second,
-                                                options.matrix_locations(),
-                                                options.date_time_type() == Options::invariant);
+    {
+      auto _ = measure_phase_time(request, service_name(), "expansion");
+      time_distance_matrix_.SourceToTarget(request, *reader, mode_costing, mode,
+                                           max_matrix_distance.find(costing)->second,
+                                           options.matrix_locations(),
+                                           options.date_time_type() == Options::invariant);
+    }
+    add_search_stats(request, "timedistancematrix", time_distance_matrix_.search_stats());
   };
+  // a matrix between the same locations computed one way: each location searches towards itself
+  // and the locations after it, the cells before the diagonal are mirrored
+  auto symmetricmatrix = [&]() {
+    SearchStats stats;
+    {
+      auto _ = measure_phase_time(request, service_name(), "expansion");
+      const auto& locations = options.sources();
+      const size_t count = locations.size();
+      auto& matrix = *request.mutable_matrix();
+      matrix.set_algorithm(Matrix::TimeDistanceMatrix);
+      reserve_pbf_arrays(matrix, count * count);
 
-  if (costing == "bikeshare") {
-    time_distance_bss_matrix_.SourceToTarget(request, *reader, mode_costing, mode,
-                                             max_matrix_distance.find(costing)->second,
-                                             options.matrix_locations());
-    return tyr::serializeMatrix(request);
-  }
+      Api row;
+      *row.mutable_options() = options;
+      auto& row_options = *row.mutable_options();
+      for (size_t i = 0; i < count; ++i) {
+        row_options.clear_sources();
+        *row_options.add_sources() = locations.Get(i);
+        row_options.clear_targets();
+        for (size_t j = i; j < count; ++j) {
+          *row_options.add_targets() = locations.Get(j);
+        }
+        row.clear_matrix();
+        time_distance_matrix_.SourceToTarget(row, *reader, mode_costing, mode,
+                                             max_matrix_distance.find(costing)->second);
+        stats += time_distance_matrix_.search_stats();
 
-  Matrix::Algorithm matrix_algo = Matrix::CostMatrix;
-  switch (source_to_target_algorithm) {
-    case SELECT_OPTIMAL:
-      // TODO - Do further performance testing to pick the best algorithm for the job
-      switch (mode) {
-        case travel_mode_t::kPedestrian:
-        case travel_mode_t::kBicycle:
-          // Use CostMatrix if number of sources and number of targets
-          // exceeds some threshold
-          if (options.sources().size() <= kCostMatrixThreshold ||
-              options.targets().size() <= kCostMatrixThreshold) {
-            matrix_algo = Matrix::TimeDistanceMatrix;
+        // once the time is up the cells between the locations left are missing
+        if (row.matrix().incomplete_sources_size() > 0) {
+          for (size_t j = i; j < count; ++j) {
+            for (size_t k = i; k < count; ++k) {
+              matrix.mutable_from_indices()->Set(j * count + k, j);
+              matrix.mutable_to_indices()->Set(j * count + k, k);
+              matrix.mutable_times()->Set(j * count + k, kMaxCost);
+            }
+            matrix.add_incomplete_sources(j);
+            matrix.add_incomplete_targets(j);
           }
+          add_warning(request, 208);
           break;
-        case travel_mode_t::kPublicTransit:
-          matrix_algo = Matrix::TimeDistanceMatrix;
-          break;
-        default:
-          break;
+        }
+
+        for (size_t j = i; j < count; ++j) {
+          for (const size_t cell : {i * count + j, j * count + i}) {
+            matrix.mutable_from_indices()->Set(cell, cell / count);
+            matrix.mutable_to_indices()->Set(cell, cell % count);
+            matrix.mutable_distances()->Set(cell, row.matrix().distances(j - i));
+            matrix.mutable_times()->Set(cell, row.matrix().times(j - i));
+          }
+        }
       }
-      break;
-    case COST_MATRIX:
-      break;
-    case TIME_DISTANCE_MATRIX:
-      matrix_algo = Matrix::TimeDistanceMatrix;
-      break;
-  }
+      for (size_t cell = 0; cell < count * count; ++cell) {
+        matrix.add_date_times();
+      }
+    }
+    add_search_stats(request, "timedistancematrix", stats);
+  };
+
+  auto compute = [&]() {
+    if (costing == "bikeshare") {
+      auto _ = measure_phase_time(request, service_name(), "expansion");
+      time_distance_bss_matrix_.SourceToTarget(request, *reader, mode_costing, mode,
+                                               max_matrix_distance.find(costing)->second,
+                                               options.matrix_locations());
+      return;
+    }
 
-  // similar to routing: prefer the exact unidirectional algo if not requested otherwise
-  // don't use matrix_type, we only need it to set the right warnings for what will be used
-  bool has_time =
-      check_matrix_time(request, options.prioritize_bidirectional() ? Matrix::CostMatrix
-                                                                    : Matrix::TimeDistanceMatrix);
-  if (has_time && !options.prioritize_bidirectional() && source_to_target_algorithm != COST_MATRIX) {
-    timedistancematrix();
-  } else if (has_time && options.prioritize_bidirectional() &&
-             source_to_target_algorithm != TIME_DISTANCE_MATRIX) {
-    costmatrix(has_time);
-  } else if (matrix_algo == Matrix::CostMatrix) {
-    // if this happens, the server config only allows for timedist matrix
-    if (has_time && !options.prioritize_bidirectional()) {
-      add_warning(request, 301);
+    if (options.symmetric()) {
+      if (same_locations(options) &&
+          mode_costing[static_cast<size_t>(mode)]->AllowSymmetricMatrix()) {
+        symmetricmatrix();
+        return;
+      }
+      add_warning(request, 207);
     }
-    costmatrix(has_time);
-  } else {
-    if (has_time && options.prioritize_bidirectional()) {
-      add_warning(request, 300);
+
+    // Without times, locations on the level of a contraction overlay of the costing are answered
+    // by one upward search per location over it
+    if (source_to_target_algorithm == SELECT_OPTIMAL) {
+      auto overlay = contraction_path.Overlay(options);
+      if (overlay && BucketMatrix::Applicable(options, *overlay)) {
+        auto _ = measure_phase_time(request, service_name(), "expansion");
+        bucket_matrix_.SourceToTarget(request, *reader, mode_costing, mode, *overlay,
+                                      max_matrix_distance.find(costing)->second);
+        return;
+      }
     }
-    timedistancematrix();
+
+    Matrix::Algorithm matrix_algo = Matrix::CostMatrix;
+    switch (source_to_target_algorithm) {
+      case SELECT_OPTIMAL:
+        // TODO - Do further performance testing to pick the best algorithm for the job
+        switch (mode) {
+          case travel_mode_t::kPedestrian:
+          case travel_mode_t::kBicycle:
+            // Use CostMatrix if number of sources and number of targets
+            // exceeds some threshold
+            if (options.sources().size() <= kCostMatrixThreshold ||
+                options.targets().size() <= kCostMatrixThreshold) {
+              matrix_algo = Matrix::TimeDistanceMatrix;
+            }
+            break;
+          case travel_mode_t::kPublicTransit:
+            matrix_algo = Matrix::TimeDistanceMatrix;
+            break;
+          default:
+            break;
+        }
+        break;
+      case COST_MATRIX:
+        break;
+      case TIME_DISTANCE_MATRIX:
+        matrix_algo = Matrix::TimeDistanceMatrix;
+        break;
+    }
+
+    // similar to routing: prefer the exact unidirectional algo if not requested otherwise
+    // don't use matrix_type, we only need it to set the right warnings for what will be used
+    bool has_time =
+        check_matrix_time(request, options.prioritize_bidirectional() ? Matrix::CostMatrix
+                                                                      : Matrix::TimeDistanceMatrix);
+    if (has_time && !options.prioritize_bidirectional() &&
+        source_to_target_algorithm != COST_MATRIX) {
+      timedistancematrix();
+    } else if (has_time && options.prioritize_bidirectional() &&
+               source_to_target_algorithm != TIME_DISTANCE_MATRIX) {
+      costmatrix(has_time);
+    } else if (matrix_algo == Matrix::CostMatrix) {
+      // if this happens, the server config only allows for timedist matrix
+      if (has_time && !options.prioritize_bidirectional()) {
+        add_warning(request, 301);
+      }
+      costmatrix(has_time);
+    } else {
+      if (has_time && options.prioritize_bidirectional()) {
+        add_warning(request, 300);
+      }
+      timedistancematrix();
+    }
+  };
+  compute();
+
+  restore(options, *request.mutable_matrix(), unique_sources, unique_targets);
+  // a matrix the time was up for is not what the same request gets the next time
+  const bool incomplete = request.matrix().incomplete_sources_size() > 0 ||
+                          request.matrix().incomplete_targets_size() > 0;
+  if (result_cache && !incomplete) {
+    result_cache->put(request);
   }
-  return tyr::serializeMatrix(request);
+  auto serializing = measure_phase_time(request, service_name(), "serialize");
+  return tyr::serializeMatrixChunks(request);
 }
 } // namespace thor
 } // namespace valhalla
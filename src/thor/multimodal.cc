@@ -43,7 +43,7 @@ MultiModalPathAlgorithm::MultiModalPathAlgorithm(const boost::property_tree::ptr
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_astar",
                                          kInitialEdgeLabelCountAstar),
                     config.get<bool>("clear_reserved_memory", false)),
-      max_walking_dist_(0), max_label_count_(std::numeric_limits<uint32_t>::max()),
+      labels_budget_(config, max_reserved_labels_count_, clear_reserved_memory_), max_walking_dist_(0), max_label_count_(std::numeric_limits<uint32_t>::max()),
       mode_(travel_mode_t::kPedestrian), travel_type_(0) {
 }
 
@@ -75,13 +75,8 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& destll,
 
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
-  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-  if (edgelabels_.size() > reservation) {
-    edgelabels_.resize(reservation);
-    edgelabels_.shrink_to_fit();
-  }
   // Clear the edge labels and destination list
-  edgelabels_.clear();
+  labels_budget_.clear(edgelabels_);
 
   destinations_.clear();
 
@@ -103,6 +98,8 @@ MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
                                      const sif::mode_costing_t& mode_costing,
                                      const travel_mode_t mode,
                                      const Options& options) {
+  auto timing = search_timer_.start(stats_, graphreader);
+
   // For pedestrian costing - set flag allowing use of transit connections
   // Set pedestrian costing to use max distance. TODO - need for other modes
   const auto& pc = mode_costing[static_cast<uint32_t>(travel_mode_t::kPedestrian)];
@@ -168,6 +165,7 @@ MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
   // Clear operators and processed tiles
   operators_.clear();
   processed_tiles_.clear();
+  search_timer_.phase(SearchPhase::expansion);
 
   // Find shortest path
   uint32_t nc = 0; // Count of iterations with no convergence
@@ -189,6 +187,7 @@ MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
       LOG_ERROR("Route failed after iterations = " + std::to_string(edgelabels_.size()));
       return {};
     }
+    ++stats_.settled;
 
     // Copy the EdgeLabel for use in costing. Check if this is a destination
     // edge and potentially complete the path.
@@ -275,6 +274,7 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
   bool has_transit = pred.has_transit();
   GraphId prior_stop = pred.prior_stopid();
   uint32_t operator_id = pred.transit_operator();
+  bool departs = true;
   if (nodeinfo->type() == NodeType::kMultiUseTransitPlatform) {
 
     // Get the transfer penalty when changing stations
@@ -308,6 +308,14 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
       }
       date_set_ = true;
     }
+
+    // One lookup in the departure index of the stop tells if any of its lines still departs,
+    // when none does the departures of its transit edges need not be looked up one by one
+    uint32_t departure_time;
+    departs = !tile->has_stop_departures() ||
+              tile->GetNextStopDeparture(node.id(), offset_time.day_seconds(), day_, dow_,
+                                         date_before_tile_, tc->wheelchair(), tc->bicycle(),
+                                         departure_time) != nullptr;
   }
 
   // Allow mode changes at special nodes
@@ -360,6 +368,11 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
     const auto dest_edge_itr = destinations_.find(edgeid);
     const bool is_dest = dest_edge_itr != destinations_.cend();
     if (directededge->IsTransitLine()) {
+      // Nothing leaves this stop anymore
+      if (!departs) {
+        continue;
+      }
+
       // Check if transit costing allows this edge
       if (!tc->Allowed(directededge, is_dest, pred, tile, edgeid, 0, 0, restriction_idx)) {
         continue;
@@ -839,6 +852,8 @@ bool MultiModalPathAlgorithm::CanReachDestination(const valhalla::Location& dest
 
 // Form the path from the adjacency list.
 std::vector<PathInfo> MultiModalPathAlgorithm::FormPath(const uint32_t dest) {
+  search_timer_.phase(SearchPhase::path);
+
   // Metrics to track
   LOG_DEBUG("path_cost::" + std::to_string(edgelabels_[dest].cost().cost));
   LOG_DEBUG("path_iterations::" + std::to_string(edgelabels_.size()));
@@ -1,179 +1,200 @@
 #include "thor/optimizer.h"
 #include "midgard/logging.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+namespace {
+
+// A move has to lower the cost of the tour by more than this to be made, so rounding errors can't
+// make the local search go back and forth
+constexpr float kMinImprovement = 1e-3f;
+
+// The randomized starts pick their next location among this many nearest ones
+constexpr uint32_t kNearestCandidates = 3;
+
+} // namespace
+
 namespace valhalla {
 namespace thor {
 
+Optimizer::Optimizer(const boost::property_tree::ptree& config)
+    : thread_count_(std::max<uint32_t>(config.get<uint32_t>("optimizer_threads", 1), 1)),
+      start_count_(std::max<uint32_t>(config.get<uint32_t>("optimizer_starts", 8), 1)),
+      time_limit_(config.get<uint32_t>("optimizer_time_limit", 1000)), seed_(0) {
+}
+
 // Optimize the tour through a set of locations given the cost matrix
 // among all locations. The first location (origin) and last location
 // (destination) remain fixed in the tour.
-std::vector<uint32_t> Optimizer::Solve(const uint32_t count, const std::vector<float>& costs) {
+std::vector<uint32_t>
+Optimizer::Solve(const uint32_t count, const std::vector<float>& costs, const bool open_end) const {
   // Handle trivial cases.
-  count_ = count;
-  if (count == 2) {
-    return {0, 1};
-  } else if (count_ == 3) {
-    return {0, 1, 2};
-  } else if (count == 4) {
-    // Only one possible way to alter the path.
-    std::vector<uint32_t> tour1 = {0, 1, 2, 3};
-    std::vector<uint32_t> tour2 = {0, 2, 1, 3};
-    return (TourCost(costs, tour1) < TourCost(costs, tour2)) ? tour1 : tour2;
+  if (count < 3 || (count == 3 && !open_end)) {
+    std::vector<uint32_t> tour(count);
+    std::iota(tour.begin(), tour.end(), 0);
+    return tour;
   }
 
-  // Populate the initial tour with a random order. The first and last
-  // locations must remain fixed as the tour begin and end locations do not
-  // change.
-  CreateRandomTour();
-
-  // Copy current tour to best tour and get the tour cost. Set the initial
-  // temperature based on tour cost
-  best_tour_ = tour_;
-  best_cost_ = TourCost(costs, tour_);
-  float temperature = best_cost_ / count_;
-
-  // Perform simulated annealing. Set a run limit per annealing step and a
-  // success limit to break out early if enough successes are found.
-  ntry_ = 0;
-  attempts_ = 400 * count_;
-  successes_ = 40 * count_;
-  for (uint32_t i = 0; i < 100; i++) {
-    // Break if no successes were found during this annealing step.
-    if (Anneal(costs, temperature) == 0) {
-      break;
+  // Every start keeps its own tour so which thread ran it does not matter
+  std::vector<std::vector<uint32_t>> tours(start_count_);
+  std::vector<float> tour_costs(start_count_, std::numeric_limits<float>::max());
+  const auto deadline = std::chrono::steady_clock::now() + time_limit_;
+  auto run = [&](const uint32_t worker) {
+    for (uint32_t start = worker; start < start_count_; start += thread_count_) {
+      // the first start always runs so there is a tour
+      if (start > 0 && time_limit_.count() > 0 && std::chrono::steady_clock::now() > deadline) {
+        break;
+      }
+      tours[start] = CreateTour(count, costs, open_end, start);
+      Improve(count, costs, open_end, tours[start]);
+      tour_costs[start] = TourCost(count, costs, tours[start]);
     }
+  };
 
-    // Reduce temperature
-    temperature *= kCoolingRate;
+  const uint32_t workers = std::min(thread_count_, start_count_);
+  std::vector<std::thread> pool;
+  pool.reserve(workers - 1);
+  for (uint32_t worker = 1; worker < workers; ++worker) {
+    pool.emplace_back(run, worker);
+  }
+  run(0);
+  for (auto& thread : pool) {
+    thread.join();
   }
 
-  // Return the best tour
-  LOG_DEBUG("Best tour cost = " + std::to_string(best_cost_) + " ntries = " + std::to_string(ntry_));
-  return best_tour_;
+  // The cheapest tour, the earliest start of equally cheap ones
+  const auto best = std::min_element(tour_costs.begin(), tour_costs.end()) - tour_costs.begin();
+  LOG_DEBUG("Best tour cost = " + std::to_string(tour_costs[best]) +
+            " start = " + std::to_string(best));
+  return tours[best];
 }
 
-// Perform the annealing process.
-uint32_t Optimizer::Anneal(const std::vector<float>& costs, float temperature) {
-  uint32_t success_count = 0;
-  for (uint32_t i = 0; i < attempts_; i++) {
-    // Select a potential tour alteration. Get temperature difference.
-    TourAlteration alteration = GetTourAlteration();
-    float diff = TemperatureDifference(costs, alteration);
-    ntry_++;
-
-    // Check if we should keep this as the new best path. The idea behind
-    // simulated annealing is that it tries to avoid becoming trapped in local
-    // optima by occasionally allowing worse solutions at a probability that
-    // declines with time.
-    // (http://www.technical-recipes.com/2012/c-implementation-of-hill-climbing-and-simulated-annealing-applied-to-travelling-salesman-problems/
-    if (diff < 0.0f || r01() < std::exp(-diff / temperature)) {
-      if (alteration.alt == kReverse) {
-        // Alter the tour by reversing the locations in the tour between a
-        // start and end location. Add 1 to the end index since STL algorithm
-        // reverse does not include the iterator at position it2.
-        auto it1 = tour_.begin() + alteration.start;
-        auto it2 = tour_.begin() + alteration.end + 1;
-        std::reverse(it1, it2);
-      } else {
-        // Alter the tour by rotating the locations about a middle point.
-        // The middle location becomes the new first location. Add 1 to
-        // the end index so that is included in the rotated set.
-        auto it1 = tour_.begin() + alteration.start;
-        auto it2 = tour_.begin() + alteration.mid;
-        auto it3 = tour_.begin() + alteration.end + 1;
-        std::rotate(it1, it2, it3);
+// Build the starting tour of a start by nearest neighbor.
+std::vector<uint32_t> Optimizer::CreateTour(const uint32_t count,
+                                            const std::vector<float>& costs,
+                                            const bool open_end,
+                                            const uint32_t start) const {
+  std::mt19937_64 generator(seed_ + start);
+  const uint32_t last = open_end ? count : count - 1;
+  std::vector<bool> visited(count, false);
+  visited[0] = true;
+
+  std::vector<uint32_t> tour;
+  tour.reserve(count);
+  tour.push_back(0);
+  std::vector<uint32_t> nearest;
+  while (tour.size() < last) {
+    // the nearest unvisited locations, only the nearest one for the first start
+    const uint32_t from = tour.back();
+    nearest.clear();
+    for (uint32_t to = 1; to < last; ++to) {
+      if (!visited[to]) {
+        nearest.push_back(to);
       }
-      success_count++;
-
-      // Get the tour cost and update the best tour if less cost
-      float cost = TourCost(costs, tour_);
-      if (cost < best_cost_) {
-        best_cost_ = cost;
-        best_tour_ = tour_;
-      }
-    }
-    if (success_count >= successes_) {
-      break;
     }
+    const auto candidates =
+        std::min<size_t>(start == 0 ? 1 : kNearestCandidates, nearest.size());
+    std::partial_sort(nearest.begin(), nearest.begin() + candidates, nearest.end(),
+                      [&](const uint32_t a, const uint32_t b) {
+                        return costs[from * count + a] < costs[from * count + b];
+                      });
+    const uint32_t next =
+        nearest[std::uniform_int_distribution<size_t>(0, candidates - 1)(generator)];
+    visited[next] = true;
+    tour.push_back(next);
   }
-  return success_count;
-}
-
-// Create a random initial tour. The first and last locations must remain
-// fixed as the tour begin and end locations do not change.
-void Optimizer::CreateRandomTour() {
-  tour_.clear();
-  for (uint32_t i = 1; i < count_ - 1; i++) {
-    tour_.push_back(i);
+  if (!open_end) {
+    tour.push_back(count - 1);
   }
-  std::random_device rd;
-  std::shuffle(tour_.begin(), tour_.end(), std::mt19937(rd()));
-  tour_.insert(tour_.begin(), 0);
-  tour_.push_back(count_ - 1);
+  return tour;
 }
 
-// Select a potential alteration of the tour.
-TourAlteration Optimizer::GetTourAlteration() {
-  // Select three unique locations between 1 and count-2
-  std::vector<uint32_t> loc(3);
-  while (true) {
-    loc[0] = get_random_location();
-    loc[1] = get_random_location();
-    loc[2] = get_random_location();
-    if (loc[0] != loc[1] && loc[0] != loc[2] && loc[1] != loc[2]) {
-      break;
+// Improve a tour by 2-opt and Or-opt moves until neither lowers its cost.
+void Optimizer::Improve(const uint32_t count,
+                        const std::vector<float>& costs,
+                        const bool open_end,
+                        std::vector<uint32_t>& tour) {
+  auto cost = [&](const uint32_t from, const uint32_t to) { return costs[from * count + to]; };
+  // the last position a location can move to
+  const uint32_t last = open_end ? count - 1 : count - 2;
+
+  // the cost of the tour up to each position along it and against it, so the cost of a reversed
+  // part of the tour is known without walking it
+  std::vector<float> along(count, 0.f), against(count, 0.f);
+  auto accumulate = [&]() {
+    for (uint32_t i = 1; i < count; ++i) {
+      along[i] = along[i - 1] + cost(tour[i - 1], tour[i]);
+      against[i] = against[i - 1] + cost(tour[i], tour[i - 1]);
     }
-  }
-
-  // Sort location indexes so they have increasing values to use as
-  // a start location index, mid location index (for rotation), and an
-  // end location index.
-  std::sort(loc.begin(), loc.end());
-
-  // Randomly select the alteration type and return the
-  // tour alteration (indexes and type).
-  AlterationType t = (r01() < 0.5f) ? kReverse : kRotate;
-  return {loc[0], loc[1], loc[2], t};
-}
-
-float Optimizer::TemperatureDifference(const std::vector<float>& costs,
-                                       const TourAlteration& alteration) {
-  float c = 0;
-  uint32_t start = alteration.start;
-  uint32_t end = alteration.end;
-  if (alteration.alt == kRotate) {
-    // Subtract costs of connections that are broken
-    uint32_t mid = alteration.mid;
-    c -= Cost(costs, tour_[start - 1], tour_[start]);
-    c -= Cost(costs, tour_[end], tour_[end + 1]);
-    c -= Cost(costs, tour_[mid - 1], tour_[mid]);
-
-    // Add costs for the new connections
-    c += Cost(costs, tour_[start - 1], tour_[mid]);
-    c += Cost(costs, tour_[end], tour_[start]);
-    c += Cost(costs, tour_[mid - 1], tour_[end + 1]);
-  } else {
-    // Reverse tour locations between a start and an end index.
-    // Subtract costs between successive locations from start-1 to end+1
-    for (uint32_t i = start - 1, j = i + 1; i <= end; i++, j++) {
-      c -= Cost(costs, tour_[i], tour_[j]);
+  };
+
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    accumulate();
+
+    // 2-opt: reverse the tour from position i to position j
+    for (uint32_t i = 1; i < last && !improved; ++i) {
+      for (uint32_t j = i + 1; j <= last; ++j) {
+        const bool has_next = j + 1 < count;
+        float delta = cost(tour[i - 1], tour[j]) - cost(tour[i - 1], tour[i]) +
+                      (against[j] - against[i]) - (along[j] - along[i]);
+        if (has_next) {
+          delta += cost(tour[i], tour[j + 1]) - cost(tour[j], tour[j + 1]);
+        }
+        if (delta < -kMinImprovement) {
+          std::reverse(tour.begin() + i, tour.begin() + j + 1);
+          improved = true;
+          break;
+        }
+      }
+    }
+    if (improved) {
+      continue;
     }
 
-    // Add costs for the new connections and the reversed order
-    c += Cost(costs, tour_[start - 1], tour_[end]);
-    c += Cost(costs, tour_[start], tour_[end + 1]);
-    for (uint32_t i = end, j = i - 1; i > start; i--, j--) {
-      c += Cost(costs, tour_[i], tour_[j]);
+    // Or-opt: move the segment from position i to position e after position p
+    for (uint32_t length = 1; length <= kMaxOrOptSegment && !improved; ++length) {
+      for (uint32_t i = 1; i + length - 1 <= last && !improved; ++i) {
+        const uint32_t e = i + length - 1;
+        const bool has_next = e + 1 < count;
+        float removed = cost(tour[i - 1], tour[i]);
+        if (has_next) {
+          removed += cost(tour[e], tour[e + 1]) - cost(tour[i - 1], tour[e + 1]);
+        }
+        for (uint32_t p = 0; p <= last; ++p) {
+          if (p + 1 >= i && p <= e) {
+            continue;
+          }
+          float added = cost(tour[p], tour[i]);
+          if (p + 1 < count) {
+            added += cost(tour[e], tour[p + 1]) - cost(tour[p], tour[p + 1]);
+          }
+          if (added - removed < -kMinImprovement) {
+            if (p < i) {
+              std::rotate(tour.begin() + p + 1, tour.begin() + i, tour.begin() + e + 1);
+            } else {
+              std::rotate(tour.begin() + i, tour.begin() + e + 1, tour.begin() + p + 1);
+            }
+            improved = true;
+            break;
+          }
+        }
+      }
     }
   }
-  return (c / static_cast<float>(count_));
 }
 
 // Get the cost for the specified tour (order of locations).
-float Optimizer::TourCost(const std::vector<float>& costs, const std::vector<uint32_t>& tour) const {
+float Optimizer::TourCost(const uint32_t count,
+                          const std::vector<float>& costs,
+                          const std::vector<uint32_t>& tour) {
   float c = 0;
-  for (uint32_t i = 0; i < count_ - 1; i++) {
-    c += costs[(tour[i] * count_) + tour[i + 1]];
+  for (uint32_t i = 0; i < count - 1; i++) {
+    c += costs[(tour[i] * count) + tour[i + 1]];
   }
   return c;
 }
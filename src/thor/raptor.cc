@@ -0,0 +1,505 @@
+#include "thor/raptor.h"
+#include "baldr/datetime.h"
+#include "midgard/logging.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+RaptorPathAlgorithm::RaptorPathAlgorithm(const boost::property_tree::ptree& config)
+    : MultiModalPathAlgorithm(config),
+      max_rounds_(config.get<uint32_t>("raptor.max_rounds", kDefaultRaptorMaxRounds)),
+      max_duration_(config.get<uint32_t>("raptor.max_duration", kDefaultRaptorMaxDuration)) {
+}
+
+// Clear the temporary information generated during path construction.
+void RaptorPathAlgorithm::Clear() {
+  MultiModalPathAlgorithm::Clear();
+  rounds_.clear();
+  walks_.clear();
+  rides_.clear();
+  best_.clear();
+  egress_.clear();
+}
+
+// Find the transit journeys from the origin to the destination round by round.
+std::vector<std::vector<PathInfo>>
+RaptorPathAlgorithm::GetBestPath(valhalla::Location& origin,
+                                 valhalla::Location& destination,
+                                 GraphReader& graphreader,
+                                 const sif::mode_costing_t& mode_costing,
+                                 const travel_mode_t mode,
+                                 const Options& options) {
+  // Without rounds there are no trips to take, leave it to the multimodal A*
+  if (max_rounds_ == 0 || origin.date_time().empty()) {
+    return MultiModalPathAlgorithm::GetBestPath(origin, destination, graphreader, mode_costing,
+                                                mode, options);
+  }
+
+  const auto& pc = mode_costing[static_cast<uint32_t>(travel_mode_t::kPedestrian)];
+  const auto& tc = mode_costing[static_cast<uint32_t>(travel_mode_t::kPublicTransit)];
+  pc->SetAllowTransitConnections(true);
+  max_walking_dist_ =
+      options.costings().find(Costing::pedestrian)->second.options().transit_start_end_max_distance();
+  max_transfer_distance_ = pc->GetMaxTransferDistanceMM();
+  mode_ = travel_mode_t::kPedestrian;
+
+  // Replaces a current date_time with the local time at the origin
+  TimeInfo::make(origin, graphreader, &tz_cache_);
+  origin_date_time_ = origin.date_time();
+  start_time_ = DateTime::seconds_from_midnight(origin_date_time_);
+  date_set_ = false;
+  date_before_tile_ = false;
+  processed_tiles_.clear();
+  rounds_.clear();
+  walks_.clear();
+  rides_.clear();
+  best_.clear();
+  egress_.clear();
+  destinations_.clear();
+  SetDestination(graphreader, destination, pc);
+
+  // Walk from the destination to the stops near it. Pedestrian access is assumed to be the same
+  // in either direction so the walk follows the opposing edges forward.
+  Walk egress;
+  for (const auto& edge : destination.correlation().edges()) {
+    const float ratio = 1.0f - edge.percent_along();
+    GraphId edgeid(edge.graph_id());
+    if (pc->AvoidAsDestinationEdge(edgeid, ratio)) {
+      continue;
+    }
+    GraphId oppedge = graphreader.GetOpposingEdgeId(edgeid);
+    graph_tile_ptr tile = graphreader.GetGraphTile(oppedge);
+    if (!tile) {
+      continue;
+    }
+    const DirectedEdge* diredge = tile->directededge(oppedge);
+    Cost cost = pc->EdgeCost(diredge, tile) * ratio;
+    egress.labels.emplace_back(kInvalidLabel, oppedge, diredge, cost, cost.cost, 0.0f, mode_,
+                               static_cast<uint32_t>(diredge->length() * ratio), Cost{},
+                               baldr::kInvalidRestriction, true, false, InternalTurn::kNoTurn);
+  }
+  WalkFrom(graphreader, pc, egress, max_walking_dist_, [&](const uint32_t idx, const bool at_stop) {
+    if (at_stop) {
+      egress_.emplace(egress.labels[idx].endnode(), egress.labels[idx].cost());
+    }
+    return true;
+  });
+
+  // Walk from the origin to the stops near it, and to the destination if it is close enough
+  walks_.emplace_back();
+  bool has_other_edges = false;
+  for (const auto& edge : origin.correlation().edges()) {
+    has_other_edges = has_other_edges || !edge.end_node();
+  }
+  for (const auto& edge : origin.correlation().edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.end_node()) ||
+        pc->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (!tile) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    Cost cost = pc->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    cost.cost += edge.distance();
+    walks_[0].labels.emplace_back(kInvalidLabel, edgeid, directededge, cost, cost.cost, 0.0f, mode_,
+                                  static_cast<uint32_t>(directededge->length() *
+                                                        (1.0f - edge.percent_along())),
+                                  Cost{}, baldr::kInvalidRestriction, true, false,
+                                  InternalTurn::kNoTurn);
+    walks_[0].labels.back().set_origin();
+  }
+
+  rounds_.emplace_back();
+  std::vector<Journey> journeys;
+  float best_dest = std::numeric_limits<float>::max();
+  uint32_t direct_label = kInvalidLabel;
+  WalkFrom(graphreader, pc, walks_[0], max_walking_dist_,
+           [&](const uint32_t idx, const bool at_stop) {
+             const auto& label = walks_[0].labels[idx];
+             auto dest = destinations_.find(label.edgeid());
+             if (dest != destinations_.end() &&
+                 (!label.origin() || IsTrivial(label.edgeid(), origin, destination))) {
+               const float secs = label.cost().secs - dest->second.secs;
+               if (secs < best_dest) {
+                 best_dest = secs;
+                 direct_label = idx;
+               }
+             }
+             if (at_stop) {
+               const auto stop = label.endnode();
+               if (best_.emplace(stop, label.cost().secs).second) {
+                 rounds_[0].arrivals.emplace(stop, Arrival{label.cost(), label.path_distance(), 0,
+                                                           idx, {}, 0});
+               }
+             }
+             return true;
+           });
+  if (direct_label != kInvalidLabel) {
+    journeys.push_back({0, {}, best_dest});
+  }
+
+  // Take one more trip each round from the stops the previous round improved
+  for (uint32_t k = 1; k <= max_rounds_ && !rounds_[k - 1].arrivals.empty(); ++k) {
+    if (interrupt) {
+      (*interrupt)();
+    }
+    rounds_.emplace_back();
+    for (const auto& arrival : rounds_[k - 1].arrivals) {
+      BoardAt(graphreader, tc, k, GraphId(arrival.first), arrival.second, best_dest);
+    }
+
+    // Walk the transfers from the stops the trips of this round arrived at
+    Round& round = rounds_[k];
+    round.arrivals = round.rides;
+    for (const auto& ride : round.rides) {
+      const GraphId from(ride.first);
+      const uint32_t w = walks_.size();
+      walks_.emplace_back();
+      SeedFromStop(graphreader, pc, from, walks_[w]);
+      WalkFrom(graphreader, pc, walks_[w], max_transfer_distance_,
+               [&](const uint32_t idx, const bool at_stop) {
+                 const auto& label = walks_[w].labels[idx];
+                 const float secs = ride.second.cost.secs + label.cost().secs;
+                 if (secs >= best_dest || secs > max_duration_) {
+                   return false;
+                 }
+                 const auto to = label.endnode();
+                 if (!at_stop || to == from) {
+                   return true;
+                 }
+                 auto best = best_.find(to);
+                 if (best != best_.end() && best->second <= secs) {
+                   return true;
+                 }
+                 best_[to] = secs;
+                 round.arrivals[to] = {ride.second.cost + label.cost(),
+                                       ride.second.path_distance + label.path_distance(),
+                                       w,
+                                       idx,
+                                       from,
+                                       0};
+                 return true;
+               });
+    }
+
+    // Keep the journey of this round if it beats the ones with fewer trips
+    Journey journey{k, {}, best_dest};
+    for (const auto& arrival : round.arrivals) {
+      auto walk = egress_.find(arrival.first);
+      if (walk != egress_.end() && arrival.second.cost.secs + walk->second.secs < journey.secs) {
+        journey.stop = GraphId(arrival.first);
+        journey.secs = arrival.second.cost.secs + walk->second.secs;
+      }
+    }
+    if (journey.stop.Is_Valid()) {
+      best_dest = journey.secs;
+      journeys.push_back(journey);
+    }
+  }
+
+  // Nothing but walking, let the multimodal A* decide
+  if (journeys.empty() || (journeys.size() == 1 && journeys.front().round == 0)) {
+    Clear();
+    return MultiModalPathAlgorithm::GetBestPath(origin, destination, graphreader, mode_costing,
+                                                mode, options);
+  }
+
+  // The fastest journey first, then the ones with fewer transfers
+  std::vector<std::vector<PathInfo>> paths;
+  for (auto journey = journeys.rbegin();
+       journey != journeys.rend() && paths.size() <= options.alternates(); ++journey) {
+    if (journey->round == 0) {
+      std::vector<PathInfo> path;
+      AppendWalk(walks_[0], direct_label, nullptr, path);
+      path.back().elapsed_cost -= destinations_[path.back().edgeid];
+      paths.emplace_back(std::move(path));
+      continue;
+    }
+    auto path = FormJourney(graphreader, pc, *journey);
+    if (!path.empty()) {
+      paths.emplace_back(std::move(path));
+    }
+  }
+  LOG_DEBUG("raptor_rounds::" + std::to_string(rounds_.size() - 1));
+  return paths;
+}
+
+// Walk from the seeded labels up to a distance.
+void RaptorPathAlgorithm::WalkFrom(GraphReader& graphreader,
+                                   const std::shared_ptr<DynamicCost>& pc,
+                                   Walk& walk,
+                                   const uint32_t max_distance,
+                                   const std::function<bool(const uint32_t, const bool)>& settled) {
+  EdgeStatus edgestatus;
+  uint32_t bucketsize = pc->UnitSize();
+  DoubleBucketQueue<EdgeLabel> adjlist(0.0f, kBucketCount * bucketsize, bucketsize, &walk.labels);
+  for (uint32_t idx = 0; idx < walk.labels.size(); ++idx) {
+    adjlist.add(idx);
+    edgestatus.Set(walk.labels[idx].edgeid(), EdgeSet::kTemporary, idx,
+                   graphreader.GetGraphTile(walk.labels[idx].edgeid()));
+  }
+
+  uint32_t predindex;
+  while ((predindex = adjlist.pop()) != kInvalidLabel) {
+    // Copy the label, expanding may grow the list
+    EdgeLabel pred = walk.labels[predindex];
+    edgestatus.Update(pred.edgeid(), EdgeSet::kPermanent);
+    if (pred.path_distance() > max_distance) {
+      continue;
+    }
+
+    // Expanding stops at transit platforms
+    const bool at_stop = ExpandFromNode(graphreader, pred.endnode(), pred, predindex, pc,
+                                        edgestatus, walk.labels, adjlist, false);
+    if (!settled(predindex, at_stop)) {
+      break;
+    }
+  }
+}
+
+// Seed a walk with the edges a pedestrian can leave a stop on.
+void RaptorPathAlgorithm::SeedFromStop(GraphReader& graphreader,
+                                       const std::shared_ptr<DynamicCost>& pc,
+                                       const GraphId& stop,
+                                       Walk& walk) {
+  auto tile = graphreader.GetGraphTile(stop);
+  if (!tile) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(stop);
+  GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  const EdgeLabel none;
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+    uint8_t restriction_idx = -1;
+    if (directededge->IsTransitLine() ||
+        !pc->Allowed(directededge, false, none, tile, edgeid, 0, 0, restriction_idx)) {
+      continue;
+    }
+    Cost cost = pc->EdgeCost(directededge, tile);
+    walk.labels.emplace_back(kInvalidLabel, edgeid, directededge, cost, cost.cost, 0.0f, mode_,
+                             directededge->length(), Cost{}, baldr::kInvalidRestriction, true,
+                             false, InternalTurn::kNoTurn);
+  }
+}
+
+// Board the next departure of each line leaving a stop and ride the trips.
+void RaptorPathAlgorithm::BoardAt(GraphReader& graphreader,
+                                  const std::shared_ptr<DynamicCost>& tc,
+                                  const uint32_t round,
+                                  const GraphId& stop,
+                                  const Arrival& arrival,
+                                  const float best_dest) {
+  auto tile = graphreader.GetGraphTile(stop);
+  if (!tile) {
+    return;
+  }
+  if (processed_tiles_.emplace(tile->id().tileid()).second) {
+    tc->AddToExcludeList(tile);
+  }
+  const NodeInfo* nodeinfo = tile->node(stop);
+  if (tc->IsExcluded(tile, nodeinfo)) {
+    return;
+  }
+
+  // The date comes from the level 3 transit tiles, it is set when the schedules were fetched
+  if (!date_set_) {
+    date_ = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin_date_time_));
+    dow_ = DateTime::day_of_week_mask(origin_date_time_);
+    uint32_t date_created = tile->header()->date_created();
+    if (date_ < date_created) {
+      date_before_tile_ = true;
+    } else {
+      day_ = date_ - date_created;
+    }
+    date_set_ = true;
+  }
+
+  // Walking onto the platform takes the transfer time, changing trips within it a little
+  const bool walked = arrival.tripid == 0;
+  const Cost transfer_cost =
+      walked && arrival.from.Is_Valid() ? tc->TransferCost() : tc->DefaultTransferCost();
+  const uint32_t arrival_time = start_time_ + static_cast<uint32_t>(arrival.cost.secs);
+  const uint32_t ready = arrival_time + (walked ? static_cast<uint32_t>(transfer_cost.secs) : 30);
+
+  uint32_t departure_time;
+  if (tile->has_stop_departures() &&
+      !tile->GetNextStopDeparture(stop.id(), ready, day_, dow_, date_before_tile_, tc->wheelchair(),
+                                  tc->bicycle(), departure_time)) {
+    return;
+  }
+
+  const EdgeLabel none;
+  GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+    uint8_t restriction_idx = -1;
+    if (!directededge->IsTransitLine() || tc->IsExcluded(tile, directededge) ||
+        !tc->Allowed(directededge, false, none, tile, edgeid, 0, 0, restriction_idx)) {
+      continue;
+    }
+
+    // Frequency based departures are made up for the time asked for and are ours to free
+    const TransitDeparture* departure =
+        tile->GetNextDeparture(directededge->lineid(), ready, day_, dow_, date_before_tile_,
+                               tc->wheelchair(), tc->bicycle());
+    if (!departure || departure->tripid() == arrival.tripid) {
+      if (departure && departure->type() == kFrequencySchedule) {
+        delete departure;
+      }
+      continue;
+    }
+    std::unique_ptr<const TransitDeparture> made(
+        departure->type() == kFrequencySchedule ? departure : nullptr);
+
+    // Ride the trip to the end of its line or of the time budget
+    const uint32_t tripid = departure->tripid();
+    const uint32_t ride_idx = rides_.size();
+    rides_.emplace_back();
+    auto& ride = rides_.back();
+    Cost cost = arrival.cost;
+    cost.cost += transfer_cost.cost;
+    uint32_t path_distance = arrival.path_distance;
+    uint32_t time = arrival_time;
+    auto ride_tile = tile;
+    GraphId ride_edgeid = edgeid;
+    const DirectedEdge* ride_edge = directededge;
+    while (departure) {
+      cost += tc->EdgeCost(ride_edge, departure, time);
+      path_distance += ride_edge->length();
+      time = departure->departure_time() + departure->elapsed_time();
+      ride.push_back({ride_edgeid, cost, path_distance});
+      if (cost.secs > max_duration_ || cost.secs >= best_dest) {
+        break;
+      }
+
+      // Record the stop if no earlier round or trip got there sooner
+      const GraphId next = ride_edge->endnode();
+      ride_tile = graphreader.GetGraphTile(next, ride_tile);
+      if (!ride_tile || next == stop) {
+        break;
+      }
+      if (processed_tiles_.emplace(ride_tile->id().tileid()).second) {
+        tc->AddToExcludeList(ride_tile);
+      }
+      const NodeInfo* next_info = ride_tile->node(next);
+      auto best = best_.find(next);
+      if (!tc->IsExcluded(ride_tile, next_info) &&
+          (best == best_.end() || cost.secs < best->second)) {
+        best_[next] = cost.secs;
+        rounds_[round].rides[next] = {cost,
+                                      path_distance,
+                                      ride_idx,
+                                      static_cast<uint32_t>(ride.size()),
+                                      stop,
+                                      tripid};
+      }
+
+      // Stay on the trip along the line leaving the stop that it departs on
+      departure = nullptr;
+      made.reset();
+      GraphId next_edgeid(next.tileid(), next.level(), next_info->edge_index());
+      const DirectedEdge* next_edge = ride_tile->directededge(next_info->edge_index());
+      for (uint32_t j = 0; j < next_info->edge_count(); ++j, ++next_edge, ++next_edgeid) {
+        if (!next_edge->IsTransitLine()) {
+          continue;
+        }
+        departure = ride_tile->GetTransitDeparture(next_edge->lineid(), tripid, time);
+        if (departure) {
+          made.reset(departure->type() == kFrequencySchedule ? departure : nullptr);
+          ride_edgeid = next_edgeid;
+          ride_edge = next_edge;
+          break;
+        }
+      }
+    }
+  }
+}
+
+// Recover the edges of a journey from the legs of its arrivals.
+std::vector<PathInfo> RaptorPathAlgorithm::FormJourney(GraphReader& graphreader,
+                                                       const std::shared_ptr<DynamicCost>& pc,
+                                                       const Journey& journey) {
+  // Walk the legs back to the origin, each with the arrival it started from
+  std::vector<std::pair<const Arrival*, const Arrival*>> legs;
+  uint32_t k = journey.round;
+  const Arrival* arrival = &rounds_[k].arrivals.at(journey.stop);
+  while (true) {
+    const Arrival* from = nullptr;
+    if (arrival->tripid != 0) {
+      from = &rounds_[--k].arrivals.at(arrival->from);
+    } else if (arrival->from.Is_Valid()) {
+      from = &rounds_[k].rides.at(arrival->from);
+    }
+    legs.emplace_back(arrival, from);
+    if (from == nullptr) {
+      break;
+    }
+    arrival = from;
+  }
+
+  std::vector<PathInfo> path;
+  for (auto leg = legs.rbegin(); leg != legs.rend(); ++leg) {
+    if (leg->first->tripid == 0) {
+      AppendWalk(walks_[leg->first->leg], leg->first->label, leg->second, path);
+      continue;
+    }
+    const auto& ride = rides_[leg->first->leg];
+    for (uint32_t i = 0; i < leg->first->label; ++i) {
+      path.emplace_back(travel_mode_t::kPublicTransit, ride[i].cost, ride[i].edgeid,
+                        leg->first->tripid, ride[i].path_distance);
+    }
+  }
+
+  // Walk from the last stop to the destination
+  Walk walk;
+  SeedFromStop(graphreader, pc, journey.stop, walk);
+  uint32_t dest_label = kInvalidLabel;
+  float dest_cost = std::numeric_limits<float>::max();
+  WalkFrom(graphreader, pc, walk, max_walking_dist_, [&](const uint32_t idx, const bool) {
+    const auto& label = walk.labels[idx];
+    if (label.cost().cost >= dest_cost) {
+      return false;
+    }
+    auto dest = destinations_.find(label.edgeid());
+    if (dest != destinations_.end() && label.cost().cost - dest->second.cost < dest_cost) {
+      dest_cost = label.cost().cost - dest->second.cost;
+      dest_label = idx;
+    }
+    return true;
+  });
+  if (dest_label == kInvalidLabel) {
+    return {};
+  }
+  AppendWalk(walk, dest_label, &rounds_[journey.round].arrivals.at(journey.stop), path);
+  path.back().elapsed_cost -= destinations_[path.back().edgeid];
+  return path;
+}
+
+// Append the edges of a walk up to a label to a path.
+void RaptorPathAlgorithm::AppendWalk(const Walk& walk,
+                                     const uint32_t label,
+                                     const Arrival* base,
+                                     std::vector<PathInfo>& path) const {
+  const size_t first = path.size();
+  for (auto idx = label; idx != kInvalidLabel; idx = walk.labels[idx].predecessor()) {
+    const EdgeLabel& edgelabel = walk.labels[idx];
+    path.emplace_back(travel_mode_t::kPedestrian,
+                      base ? base->cost + edgelabel.cost() : edgelabel.cost(), edgelabel.edgeid(),
+                      0, (base ? base->path_distance : 0) + edgelabel.path_distance(),
+                      edgelabel.restriction_idx(), edgelabel.transition_cost());
+  }
+  std::reverse(path.begin() + first, path.end());
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,5 +1,6 @@
 #include "thor/worker.h"
 #include <cstdint>
+#include <exception>
 
 #include "baldr/attributes_controller.h"
 #include "baldr/json.h"
@@ -171,6 +172,65 @@ opposing) { loc.mutable_correlation()->mutable_edges()->SwapElements(i, loc.path
   }
 }*/
 
+// Keeps the edges of a location the predicate is true for
+template <class Predicate>
+void keep_edges(google::protobuf::RepeatedPtrField<valhalla::PathEdge>& edges, Predicate pred) {
+  int kept = 0;
+  for (int i = 0; i < edges.size(); ++i) {
+    if (pred(i)) {
+      edges.SwapElements(i, kept++);
+    }
+  }
+  edges.DeleteSubrange(kept, edges.size() - kept);
+}
+
+/**
+ * Whether the strong components of the mode tell there is no route between any candidate edge of
+ * the origin and any of the destination. If there may be one and the locations are only part of
+ * this leg the candidate edges of the origin no path leads from to the destination and those of
+ * the destination no path leads to from the origin are left out, so the search only starts from
+ * edges a route can take. The other legs of a location may still need all of its edges.
+ * @return false if there is no route
+ */
+bool remove_unreachable_edges(valhalla::Location& origin,
+                              valhalla::Location& destination,
+                              const connectivity_map_t& connectivity,
+                              ComponentSet set,
+                              GraphReader& reader,
+                              bool single_leg) {
+  // a route starts at the end node of an origin edge and ends at the start node of a destination
+  // edge, unless they are the same edge
+  graph_tile_ptr tile;
+  std::vector<GraphId> ends, starts;
+  for (const auto& edge : origin.correlation().edges()) {
+    ends.push_back(reader.edge_endnode(GraphId(edge.graph_id()), tile));
+  }
+  for (const auto& edge : destination.correlation().edges()) {
+    starts.push_back(reader.edge_startnode(GraphId(edge.graph_id()), tile));
+  }
+
+  std::vector<bool> from(ends.size(), false), to(starts.size(), false);
+  for (size_t i = 0; i < ends.size(); ++i) {
+    for (size_t j = 0; j < starts.size(); ++j) {
+      if (origin.correlation().edges(i).graph_id() ==
+              destination.correlation().edges(j).graph_id() ||
+          !ends[i].Is_Valid() || !starts[j].Is_Valid() ||
+          !connectivity.unreachable(ends[i], starts[j], set)) {
+        from[i] = to[j] = true;
+      }
+    }
+  }
+  if (std::find(from.begin(), from.end(), true) == from.end()) {
+    return false;
+  }
+  if (!single_leg) {
+    return true;
+  }
+  keep_edges(*origin.mutable_correlation()->mutable_edges(), [&](int i) { return from[i]; });
+  keep_edges(*destination.mutable_correlation()->mutable_edges(), [&](int j) { return to[j]; });
+  return true;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -235,17 +295,19 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   // make sure they are all cancelable
   for (auto* alg : std::vector<PathAlgorithm*>{
            &multi_modal_astar,
+           &raptor,
            &timedep_forward,
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
+           &contraction_path,
        }) {
     alg->set_interrupt(interrupt);
   }
 
-  // Have to use multimodal for transit based routing
+  // Transit based routing goes round by round, it falls back to the multimodal A* by itself
   if (routetype == "multimodal" || routetype == "transit") {
-    return &multi_modal_astar;
+    return &raptor;
   }
 
   // Have to use bike share station algorithm
@@ -254,9 +316,10 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   }
 
   // If the origin has date_time set use timedep_forward method if the distance
-  // between location is below some maximum distance (TBD).
+  // between location is below some maximum distance (TBD). Bidirectional A* tracks the time itself
+  // when thor.bidirectional_time_dependent is set
   if (!origin.date_time().empty() && options.date_time_type() != Options::invariant &&
-      !options.prioritize_bidirectional()) {
+      !options.prioritize_bidirectional() && !bidirectional_time_dependent) {
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
     if (ll1.Distance(ll2) < max_timedep_distance) {
@@ -266,7 +329,8 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
 
   // If the destination has date_time set use timedep_reverse method if the distance
   // between location is below some maximum distance (TBD).
-  if (!destination.date_time().empty() && options.date_time_type() != Options::invariant) {
+  if (!destination.date_time().empty() && options.date_time_type() != Options::invariant &&
+      !bidirectional_time_dependent) {
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
     if (ll1.Distance(ll2) < max_timedep_distance) {
@@ -289,6 +353,11 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Long routes with default options can be answered from a contraction overlay
+  if (contraction_path.Applicable(origin, destination, options)) {
+    return &contraction_path;
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
@@ -297,17 +366,55 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
                                                                  valhalla::Location& origin,
                                                                  valhalla::Location& destination,
                                                                  const std::string& costing,
-                                                                 const Options& options) {
+                                                                 const Options& options,
+                                                                 thor::SearchStats* stats) {
   // Find the path.
   valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
 
+  // Routes that switch modes or take transit leave the components of the mode, the others cant
+  // start or end at the edges the components tell no route reaches and there is nothing to search
+  // for when that is all of them
+  ComponentSet set;
+  if (connectivity_map && path_algorithm != &multi_modal_astar && path_algorithm != &bss_astar &&
+      !cost->IgnoresAccess() && connectivity_map_t::strong_components(cost->access_mode(), set) &&
+      !remove_unreachable_edges(origin, destination, *connectivity_map, set, *reader,
+                                options.locations_size() == 2)) {
+    LOG_INFO("No route between the strongly connected components of the locations");
+    return {};
+  }
+
+  // The contraction overlay declines paths it can't answer faithfully, use bidirectional a* then
+  if (path_algorithm == &contraction_path) {
+    auto paths =
+        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    if (stats) {
+      *stats += path_algorithm->search_stats();
+    }
+    if (!paths.empty()) {
+      return paths;
+    }
+    LOG_INFO("algorithm::contraction_hierarchy declined, falling back to bidirectional_a*");
+    path_algorithm = &bidir_astar;
+    path_algorithm->Clear();
+  }
+
   // If bidirectional A* disable use of destination-only edges on the
   // first pass. If there is a failure, we allow them on the second pass.
   // Other path algorithms can use destination-only edges on the first pass.
   cost->set_allow_destination_only(path_algorithm == &bidir_astar ? false : true);
 
+  // Start from the limits tuned for the region of the route, if there are any
+  if (hierarchy_limits_table) {
+    PointLL ll1(origin.ll().lng(), origin.ll().lat());
+    PointLL ll2(destination.ll().lng(), destination.ll().lat());
+    hierarchy_limits_table->Apply(costing, ll1, ll2, cost->GetHierarchyLimits());
+  }
+
   cost->set_pass(0);
   auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+  if (stats) {
+    *stats += path_algorithm->search_stats();
+  }
 
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
@@ -340,6 +447,9 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
     // Get the best path. Return if not empty (else return the original path)
     auto relaxed_paths =
         path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    if (stats) {
+      *stats += path_algorithm->search_stats();
+    }
     if (!relaxed_paths.empty()) {
       return relaxed_paths;
     }
@@ -375,7 +485,13 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
     }
 
     // Get best path and keep it
-    auto temp_paths = this->get_path(path_algorithm, *origin, *destination, costing, options);
+    thor::SearchStats stats;
+    auto temp_paths = [&]() {
+      auto _ = measure_phase_time(api, service_name(), "expansion");
+      return this->get_path(path_algorithm, *origin, *destination, costing, options, &stats);
+    }();
+    add_count(api, service_name(), "edges_labeled", path_algorithm->label_count());
+    add_search_stats(api, path_algorithm->name(), stats);
     if (temp_paths.empty())
       return false;
 
@@ -451,9 +567,12 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
           route->mutable_legs()->Reserve(options.locations_size());
         }
         auto& leg = *route->mutable_legs()->Add();
-        TripLegBuilder::Build(options, controller, *reader, mode_costing, path.begin(), path.end(),
-                              *origin, *destination, leg, algorithms, interrupt, edge_trimming,
-                              intermediates);
+        {
+          auto _ = measure_phase_time(api, service_name(), "trip_leg");
+          TripLegBuilder::Build(options, controller, *reader, mode_costing, path.begin(),
+                                path.end(), *origin, *destination, leg, algorithms, interrupt,
+                                edge_trimming, intermediates);
+        }
 
         // advance the time for the next destination (i.e. algo origin) by the waiting_secs
         // of this origin (i.e. algo destination)
@@ -521,6 +640,94 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   *api.mutable_options()->mutable_locations() = std::move(correlated);
 }
 
+std::vector<thor_worker_t::leg_search_t> thor_worker_t::search_legs(Api& api,
+                                                                    const std::string& costing) {
+  const Options& options = api.options();
+  if (leg_workers.empty() || options.locations_size() < 3 || options.alternates() > 0 ||
+      costing == "multimodal" || costing == "transit" || costing == "bikeshare") {
+    return {};
+  }
+  // through points continue on the edge the leg before arrived on and times carry over from the
+  // arrival of the leg before, either way the legs have to be searched one after the other
+  for (const auto& location : options.locations()) {
+    if (location.type() != valhalla::Location::kBreak ||
+        (!location.date_time().empty() && options.date_time_type() != Options::invariant)) {
+      return {};
+    }
+  }
+
+  // the legs are handed out one at a time to whichever thread of the pool is done with its last
+  // one, every thread searches with a worker of its own
+  std::vector<leg_search_t> legs(options.locations_size() - 1);
+  std::vector<std::exception_ptr> errors(legs.size());
+  const size_t helpers = std::min(leg_workers.size(), legs.size() - 1);
+  const thread_pool_t::task_t search = [&](const size_t i, const size_t slot, GraphReader&) {
+    auto& worker = slot == 0 ? *this : *leg_workers[slot - 1];
+    try {
+      auto& leg = legs[i];
+      leg.origin = options.locations(i);
+      leg.destination = options.locations(i + 1);
+      auto* path_algorithm =
+          worker.get_path_algorithm(costing, leg.origin, leg.destination, options);
+      path_algorithm->Clear();
+      leg.paths = worker.get_path(path_algorithm, leg.origin, leg.destination, costing, options,
+                                  &leg.stats);
+      leg.algorithm = path_algorithm->name();
+      leg.label_count = path_algorithm->label_count();
+    } catch (...) { errors[i] = std::current_exception(); }
+  };
+
+  {
+    auto _ = measure_phase_time(api, service_name(), "expansion");
+    for (size_t i = 0; i < helpers; ++i) {
+      leg_workers[i]->parse_costing(api);
+      leg_workers[i]->set_interrupt(interrupt);
+    }
+    thread_pool->run(legs.size(), search, *reader, interrupt, helpers + 1);
+  }
+
+  // fail the way searching the legs one by one would have, at the first leg that failed
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return legs;
+}
+
+void thor_worker_t::profile_departures(Api& api,
+                                       const valhalla::Location& origin,
+                                       const valhalla::Location& destination,
+                                       TripLeg& leg) {
+  const auto& options = api.options();
+  // Only time dependent legs short enough for the time dependent algorithms get a profile
+  if (options.profile_departures() == 0 || origin.date_time().empty() ||
+      options.date_time_type() == Options::invariant) {
+    return;
+  }
+  PointLL ll1(origin.ll().lng(), origin.ll().lat());
+  PointLL ll2(destination.ll().lng(), destination.ll().lat());
+  if (ll1.Distance(ll2) >= max_timedep_distance) {
+    return;
+  }
+
+  valhalla::Location start(origin);
+  const auto time_info = TimeInfo::make(start, *reader);
+  std::vector<TimeInfo> departures;
+  departures.reserve(options.profile_departures());
+  for (uint32_t k = 0; k < options.profile_departures(); ++k) {
+    departures.push_back(
+        time_info.forward(k * options.profile_interval(), time_info.timezone_index));
+  }
+
+  auto _ = measure_phase_time(api, service_name(), "departure_profile");
+  departure_profile_.set_interrupt(interrupt);
+  auto times =
+      departure_profile_.Compute(origin, destination, *reader, mode_costing, mode, departures);
+  departure_profile_.Clear();
+  *leg.mutable_departure_profile() = {times.begin(), times.end()};
+}
+
 void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
   // Things we'll need
   TripRoute* route = nullptr;
@@ -532,22 +739,45 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
   valhalla::Trip& trip = *api.mutable_trip();
   trip.mutable_routes()->Reserve(options.alternates() + 1);
 
-  auto route_two_locations = [&, this](auto& origin, auto& destination) -> bool {
-    // Get the algorithm type for this location pair
-    thor::PathAlgorithm* path_algorithm =
-        this->get_path_algorithm(costing, *origin, *destination, options);
-    path_algorithm->Clear();
-    algorithms.push_back(path_algorithm->name());
-    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+  // Legs that don't depend on each other may already be searched, then they are only put together
+  auto legs = search_legs(api, costing);
+  size_t next_leg = 0;
 
-    // If we are continuing through a location we need to make sure we
-    // only allow the edge that was used previously (avoid u-turns)
-    if (is_through_point(*origin) && last_edge.Is_Valid()) {
-      remove_path_edges(*origin,
-                        [&last_edge](const auto& edge) { return edge.graph_id() != last_edge; });
+  auto route_two_locations = [&, this](auto& origin, auto& destination) -> bool {
+    std::vector<std::vector<thor::PathInfo>> temp_paths;
+    if (next_leg < legs.size()) {
+      // Take the locations over as the search of the leg left them
+      auto& leg = legs[next_leg++];
+      *origin = std::move(leg.origin);
+      *destination = std::move(leg.destination);
+      algorithms.push_back(leg.algorithm);
+      LOG_INFO(std::string("algorithm::") + leg.algorithm);
+      add_count(api, service_name(), "edges_labeled", leg.label_count);
+      add_search_stats(api, leg.algorithm, leg.stats);
+      temp_paths = std::move(leg.paths);
+    } else {
+      // Get the algorithm type for this location pair
+      thor::PathAlgorithm* path_algorithm =
+          this->get_path_algorithm(costing, *origin, *destination, options);
+      path_algorithm->Clear();
+      algorithms.push_back(path_algorithm->name());
+      LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+
+      // If we are continuing through a location we need to make sure we
+      // only allow the edge that was used previously (avoid u-turns)
+      if (is_through_point(*origin) && last_edge.Is_Valid()) {
+        remove_path_edges(*origin,
+                          [&last_edge](const auto& edge) { return edge.graph_id() != last_edge; });
+      }
+      // Get best path and keep it
+      thor::SearchStats stats;
+      temp_paths = [&]() {
+        auto _ = measure_phase_time(api, service_name(), "expansion");
+        return this->get_path(path_algorithm, *origin, *destination, costing, options, &stats);
+      }();
+      add_count(api, service_name(), "edges_labeled", path_algorithm->label_count());
+      add_search_stats(api, path_algorithm->name(), stats);
     }
-    // Get best path and keep it
-    auto temp_paths = this->get_path(path_algorithm, *origin, *destination, costing, options);
     if (temp_paths.empty())
       return false;
 
@@ -604,9 +834,15 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
           route->mutable_legs()->Reserve(options.locations_size());
         }
         auto& leg = *route->mutable_legs()->Add();
-        thor::TripLegBuilder::Build(options, controller, *reader, mode_costing, path.begin(),
-                                    path.end(), *origin, *destination, leg, algorithms, interrupt,
-                                    edge_trimming, {std::next(origin), destination});
+        {
+          auto _ = measure_phase_time(api, service_name(), "trip_leg");
+          thor::TripLegBuilder::Build(options, controller, *reader, mode_costing, path.begin(),
+                                      path.end(), *origin, *destination, leg, algorithms,
+                                      interrupt, edge_trimming, {std::next(origin), destination});
+        }
+        if (std::next(origin) == destination && trip.routes_size() == 1) {
+          profile_departures(api, *origin, *destination, leg);
+        }
 
         path.clear();
         edge_trimming.clear();
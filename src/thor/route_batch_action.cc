@@ -0,0 +1,60 @@
+#include "midgard/logging.h"
+#include "thor/matrix_common.h"
+#include "thor/worker.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace valhalla {
+namespace thor {
+
+std::string thor_worker_t::route_batch(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request);
+
+  auto& options = *request.mutable_options();
+  adjust_scores(options);
+  auto costing = parse_costing(request);
+
+  // the results go into the matrix, pair i is the element from source i to target i
+  auto& matrix = *request.mutable_matrix();
+  matrix.Clear();
+  matrix.mutable_from_indices()->Reserve(options.sources_size());
+  matrix.mutable_to_indices()->Reserve(options.sources_size());
+  matrix.mutable_times()->Reserve(options.sources_size());
+  matrix.mutable_distances()->Reserve(options.sources_size());
+
+  // costing and the path algorithms are set up once and reused for every pair
+  for (int i = 0; i < options.sources_size(); ++i) {
+    // work on copies, a second pass adds the filtered edges to the candidates
+    auto origin = options.sources(i);
+    auto destination = options.targets(i);
+    float time = kMaxCost;
+    uint32_t distance = 0;
+    if (origin.correlation().edges_size() > 0 && destination.correlation().edges_size() > 0) {
+      auto* path_algorithm = get_path_algorithm(costing, origin, destination, options);
+      path_algorithm->Clear();
+      try {
+        auto paths = get_path(path_algorithm, origin, destination, costing, options);
+        if (!paths.empty() && !paths.front().empty()) {
+          time = paths.front().back().elapsed_cost.secs;
+          distance = static_cast<uint32_t>(paths.front().back().path_distance + .5f);
+        }
+      } // one pair without a path doesn't fail the whole batch
+      catch (const valhalla_exception_t& e) {
+        LOG_DEBUG("route_batch pair " + std::to_string(i) + " failed: " + e.what());
+      }
+    }
+    matrix.add_from_indices(i);
+    matrix.add_to_indices(i);
+    matrix.add_times(time);
+    matrix.add_distances(distance);
+  }
+
+  return tyr::serializeRouteBatch(request);
+}
+
+} // namespace thor
+} // namespace valhalla
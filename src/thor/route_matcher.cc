@@ -4,6 +4,7 @@
 #include "baldr/tilehierarchy.h"
 #include "baldr/time_info.h"
 #include "midgard/logging.h"
+#include "midgard/point_tile_index.h"
 #include "midgard/util.h"
 #include "proto_conversions.h"
 
@@ -39,6 +40,9 @@ constexpr float kTotalDistanceEpsilon = 5.0f;
 // Minimum tolerance for edge length
 constexpr float kMinLengthTolerance = 10.0f;
 
+// Most tiles across the shape index, long shapes get tiles wider than the match tolerance
+constexpr double kMaxShapeIndexDivisions = 40000.0;
+
 // Get the length to compare to the edge length
 float length_comparison(const float length, const bool exact_match) {
   // Alter tolerance based on exact_match flag
@@ -54,6 +58,65 @@ float length_comparison(const float length, const bool exact_match) {
   return length + tolerance;
 }
 
+// Finds the shape points an edge can end at without walking the shape along the edge. The shape
+// points are binned into tiles at least as wide as the tolerance of a match, so only the points
+// near the end node of an edge are looked at, and of those only the ones that are no further
+// along the shape than the edge is long.
+class ShapeIndex {
+public:
+  ShapeIndex(const google::protobuf::RepeatedPtrField<valhalla::Location>& shape,
+             const std::vector<std::pair<float, float>>& distances)
+      : distances_(distances), index_(tile_width(shape), to_lls(shape)) {
+  }
+
+  // The indices of the shape points from first on which are at the given point and are at most
+  // max_length beyond origin_distance along the shape, in order along the shape
+  std::vector<size_t> candidates(const PointLL& ll,
+                                 const size_t first,
+                                 const float origin_distance,
+                                 const float max_length) {
+    std::vector<size_t> matches;
+    auto end = std::upper_bound(distances_.begin() + first, distances_.end(),
+                                origin_distance + max_length,
+                                [](float d, const auto& p) { return d < p.second; });
+    const size_t last = end - distances_.begin();
+    if (first >= last) {
+      return matches;
+    }
+    for (auto i : index_.get_points_near(ll)) {
+      if (i >= first && i < last && index_.points[i].ApproximatelyEqual(ll)) {
+        matches.push_back(i);
+      }
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+  }
+
+private:
+  static std::vector<PointLL>
+  to_lls(const google::protobuf::RepeatedPtrField<valhalla::Location>& shape) {
+    std::vector<PointLL> lls;
+    lls.reserve(shape.size());
+    for (const auto& location : shape) {
+      lls.emplace_back(valhalla::to_ll(location.ll()));
+    }
+    return lls;
+  }
+
+  static double tile_width(const google::protobuf::RepeatedPtrField<valhalla::Location>& shape) {
+    valhalla::midgard::AABB2<PointLL> bounds(valhalla::to_ll(shape.Get(0).ll()),
+                                              valhalla::to_ll(shape.Get(0).ll()));
+    for (const auto& location : shape) {
+      bounds.Expand(valhalla::to_ll(location.ll()));
+    }
+    return std::max<double>(LL_EPSILON,
+                            std::max(bounds.Width(), bounds.Height()) / kMaxShapeIndexDivisions);
+  }
+
+  const std::vector<std::pair<float, float>>& distances_;
+  valhalla::midgard::PointTileIndex index_;
+};
+
 // TODO: we need to stop relying on loki::Search to pre populate edge candidates for the first and
 // last locations. Instead we need to do that here where we already know the edges in question and can
 // make a single path edge for the edge we are interested in. Its the only way to get multi-leg
@@ -106,6 +169,7 @@ bool expand_from_node(const mode_costing_t& mode_costing,
                       GraphReader& reader,
                       const google::protobuf::RepeatedPtrField<valhalla::Location>& shape,
                       std::vector<std::pair<float, float>>& distances,
+                      ShapeIndex& shape_index,
                       const valhalla::baldr::TimeInfo& time_info,
                       const bool use_timestamps,
                       size_t& correlated_index,
@@ -161,20 +225,14 @@ bool expand_from_node(const mode_costing_t& mode_costing,
     valhalla::midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
     float de_length = length_comparison(de->length(), true);
 
-    // Process current edge until shape matches end node or shape length is longer than
-    // the current edge. Increment to the next shape point after the correlated index.
-    size_t index = correlated_index + 1;
-    float length = 0.0f;
-    while (index < shape.size()) {
-      // Exclude edge if length along shape is longer than the edge length
-      length += distances.at(index).first;
-      if (length > de_length) {
-        break;
-      }
-
-      // Found a match if shape equals directed edge LL within tolerance
-      if (to_ll(shape.Get(index).ll()).ApproximatelyEqual(de_end_ll) &&
-          de->length() < length_comparison(length, true)) {
+    // Find the first shape point after the correlated index which matches the end node and
+    // isn't further along the shape than the current edge is long
+    const float origin_distance = distances[correlated_index].second;
+    for (const size_t index :
+         shape_index.candidates(de_end_ll, correlated_index + 1, origin_distance, de_length)) {
+      // Found a match if the length along the shape is about the directed edge length
+      const float length = distances[index].second - origin_distance;
+      if (de->length() < length_comparison(length, true)) {
 
         // Figure out what time it is right now, the first iteration is a no-op
         auto offset_time_info = nodeinfo
@@ -215,9 +273,11 @@ bool expand_from_node(const mode_costing_t& mode_costing,
                            turn};
 
         // Continue walking shape to find the end edge...
-        if (expand_from_node(mode_costing, mode, reader, shape, distances, time_info, use_timestamps,
-                             index, end_node_tile, de->endnode(), end_nodes, prev_edge_label, elapsed,
-                             path_infos, false, end_node, followed_edges)) {
+        size_t next_index = index;
+        if (expand_from_node(mode_costing, mode, reader, shape, distances, shape_index, time_info,
+                             use_timestamps, next_index, end_node_tile, de->endnode(), end_nodes,
+                             prev_edge_label, elapsed, path_infos, false, end_node,
+                             followed_edges)) {
           return true;
         } else {
           // Match failed along this edge, pop the last entry off path_infos as well as what it
@@ -227,7 +287,6 @@ bool expand_from_node(const mode_costing_t& mode_costing,
           break;
         }
       }
-      index++;
     }
   }
 
@@ -243,9 +302,10 @@ bool expand_from_node(const mode_costing_t& mode_costing,
       if (end_node_tile == nullptr) {
         continue;
       }
-      if (expand_from_node(mode_costing, mode, reader, shape, distances, time_info, use_timestamps,
-                           correlated_index, end_node_tile, trans->endnode(), end_nodes,
-                           prev_edge_label, elapsed, path_infos, true, end_node, followed_edges)) {
+      if (expand_from_node(mode_costing, mode, reader, shape, distances, shape_index, time_info,
+                           use_timestamps, correlated_index, end_node_tile, trans->endnode(),
+                           end_nodes, prev_edge_label, elapsed, path_infos, true, end_node,
+                           followed_edges)) {
         return true;
       }
     }
@@ -315,6 +375,9 @@ bool RouteMatcher::FormPath(const sif::mode_costing_t& mode_costing,
     distances.push_back(std::make_pair(d, total_distance));
   }
 
+  // Index the shape points so that matching an edge only looks at the points near its end
+  ShapeIndex shape_index(options.shape(), distances);
+
   // Keep a record of followed edges and transition from each shape index (for each hierarchy level) -
   // this prevents doubling back and causing an infinite loop (could be due to transitions)
   followed_edges_t followed_edges;
@@ -360,9 +423,7 @@ bool RouteMatcher::FormPath(const sif::mode_costing_t& mode_costing,
     }
     midgard::PointLL de_end_ll = end_node_tile->get_node_ll(de->endnode());
 
-    // Initialize indexes and shape
-    size_t index = 0;
-    float length = 0.0f;
+    // Initialize the remaining length of the edge
     float de_remaining_length = de->length() * (1 - edge.percent_along());
     float de_length = length_comparison(de_remaining_length, true);
     EdgeLabel prev_edge_label;
@@ -370,18 +431,12 @@ bool RouteMatcher::FormPath(const sif::mode_costing_t& mode_costing,
     // Cost accumulated_elapsed{}; // TODO: use this once we have more than one leg
     const NodeInfo* nodeinfo = nullptr;
 
-    // Loop over shape to form path from matching edges
-    while (index < options.shape_size()) {
-
-      // bail on this edge if the length of input we checked is already longer than the edge
-      length += distances.at(index).first;
-      if (length > de_length) {
-        break;
-      }
-
-      // Check if shape is within tolerance at the end node
-      if (to_ll(options.shape(index).ll()).ApproximatelyEqual(de_end_ll) &&
-          de_remaining_length < length_comparison(length, true)) {
+    // Loop over the shape points at the end node which aren't further along the shape than the
+    // edge is long to form path from matching edges
+    for (size_t index : shape_index.candidates(de_end_ll, 0, 0.f, de_length)) {
+      // Check if the length along the shape is within tolerance of the edge
+      const float length = distances[index].second;
+      if (de_remaining_length < length_comparison(length, true)) {
 
         // Figure out what time it is right now, the first iteration is a no-op
         auto offset_time_info = nodeinfo
@@ -422,9 +477,10 @@ bool RouteMatcher::FormPath(const sif::mode_costing_t& mode_costing,
 
         // Continue walking shape to find the end node
         GraphId end_node;
-        if (expand_from_node(mode_costing, mode, reader, options.shape(), distances, time_info,
-                             options.use_timestamps(), index, end_node_tile, de->endnode(), end_nodes,
-                             prev_edge_label, elapsed, path_infos, false, end_node, followed_edges)) {
+        if (expand_from_node(mode_costing, mode, reader, options.shape(), distances, shape_index,
+                             time_info, options.use_timestamps(), index, end_node_tile,
+                             de->endnode(), end_nodes, prev_edge_label, elapsed, path_infos, false,
+                             end_node, followed_edges)) {
           // Find the edge we stopped on at the destination, if we didnt find it the greedy algorithm
           // hit a local maximum (made the wrong choice), TODO: we could rollback and try more
           auto n = end_nodes.find(end_node);
@@ -493,7 +549,6 @@ bool RouteMatcher::FormPath(const sif::mode_costing_t& mode_costing,
           return false;
         }
       }
-      index++;
     }
 
     // Did not find the end of the origin edge. Check for trivial route on a single edge
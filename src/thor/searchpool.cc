@@ -0,0 +1,95 @@
+#include "thor/searchpool.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// How many times an idle helper thread yields waiting for the next batch before it sleeps
+constexpr uint32_t kMaxSpins = 10000;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+SearchPool::SearchPool(const uint32_t thread_count, const boost::property_tree::ptree& reader_config)
+    : search_(nullptr), count_(0), next_(0), busy_(0), round_(0), shutdown_(false) {
+  // each helper keeps its own reader so that its tile cache is reused across requests
+  for (uint32_t i = 1; i < thread_count; ++i) {
+    readers_.emplace_back(new GraphReader(reader_config));
+  }
+  for (auto& reader : readers_) {
+    threads_.emplace_back(&SearchPool::work, this, std::ref(*reader));
+  }
+}
+
+SearchPool::~SearchPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  signal_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void SearchPool::run(const uint32_t count, const search_t& search, GraphReader& graphreader) {
+  search_ = &search;
+  count_ = count;
+  error_ = nullptr;
+  next_.store(0, std::memory_order_relaxed);
+  busy_.store(threads_.size(), std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    round_.fetch_add(1, std::memory_order_release);
+  }
+  signal_.notify_all();
+
+  // the calling thread does its share and then waits for the stragglers
+  drain(graphreader);
+  while (busy_.load(std::memory_order_acquire) > 0) {
+    std::this_thread::yield();
+  }
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void SearchPool::drain(GraphReader& graphreader) {
+  try {
+    for (uint32_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)) {
+      (*search_)(i, graphreader);
+    }
+  } catch (...) {
+    // keep the first error and stop handing out searches
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+      error_ = std::current_exception();
+    }
+    next_.store(count_);
+  }
+}
+
+void SearchPool::work(GraphReader& graphreader) {
+  uint64_t seen = 0;
+  while (true) {
+    for (uint32_t spins = 0; round_.load(std::memory_order_acquire) == seen && spins < kMaxSpins;
+         ++spins) {
+      std::this_thread::yield();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      signal_.wait(lock, [this, seen] { return shutdown_ || round_.load() != seen; });
+      if (shutdown_) {
+        return;
+      }
+      seen = round_.load();
+    }
+    drain(graphreader);
+    busy_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
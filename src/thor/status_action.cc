@@ -1,8 +1,23 @@
 #include "thor/worker.h"
 
+namespace {
+
+void add_label_memory(valhalla::Status& status,
+                      const char* algorithm,
+                      const valhalla::thor::LabelMemory& memory) {
+  auto* label_memory = status.mutable_label_memory()->Add();
+  label_memory->set_algorithm(algorithm);
+  label_memory->set_reserved_bytes(memory.reserved_bytes);
+  label_memory->set_used_bytes(memory.used_bytes);
+  label_memory->set_peak_used_bytes(memory.peak_used_bytes);
+  label_memory->set_trims(memory.trims);
+}
+
+} // namespace
+
 namespace valhalla {
 namespace thor {
-void thor_worker_t::status(Api&) const {
+void thor_worker_t::status(Api& request) const {
 #ifdef HAVE_HTTP
   // if we are in the process of shutting down we signal that here
   // should react by draining traffic (though they are likely doing this as they are usually the ones
@@ -11,6 +26,22 @@ void thor_worker_t::status(Api&) const {
     throw valhalla_exception_t{402};
   }
 #endif
+
+  // loki only fills in the verbose info if it was asked for and is allowed
+  if (!request.status().has_has_tiles_case())
+    return;
+
+  // how much label memory each algorithm of this worker holds on to between requests
+  auto& status = *request.mutable_status();
+  add_label_memory(status, "bidirectional_astar", bidir_astar.label_memory());
+  add_label_memory(status, "multimodal", multi_modal_astar.label_memory());
+  add_label_memory(status, "raptor", raptor.label_memory());
+  add_label_memory(status, "timedep_forward", timedep_forward.label_memory());
+  add_label_memory(status, "timedep_reverse", timedep_reverse.label_memory());
+  add_label_memory(status, "time_distance_matrix", time_distance_matrix_.label_memory());
+  add_label_memory(status, "time_distance_bss_matrix", time_distance_bss_matrix_.label_memory());
+  add_label_memory(status, "isochrone", isochrone_gen.label_memory());
+  add_label_memory(status, "centroid", centroid_gen.label_memory());
 }
 } // namespace thor
 } // namespace valhalla
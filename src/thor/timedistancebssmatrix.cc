@@ -38,7 +38,8 @@ TimeDistanceBSSMatrix::TimeDistanceBSSMatrix(const boost::property_tree::ptree&
     : settled_count_(0), current_cost_threshold_(0),
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
-      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)) {
+      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)),
+      labels_budget_(config, max_reserved_labels_count_, clear_reserved_memory_) {
 }
 
 float TimeDistanceBSSMatrix::GetCostThreshold(const float max_matrix_distance) const {
@@ -71,6 +72,18 @@ void TimeDistanceBSSMatrix::Expand(GraphReader& graphreader,
     return;
   }
 
+  // Riding through the tables the bicycle jumps from station to station, once it is docked the
+  // only way on is walking
+  if (use_bss_tables_ && mode == travel_mode_t::kBicycle) {
+    if (from_bss) {
+      ExpandRides<expansion_direction>(graphreader, node, pred, pred_idx);
+    } else if (nodeinfo->type() == NodeType::kBikeShare) {
+      Expand<expansion_direction>(graphreader, node, pred, pred_idx, from_transition, true,
+                                  travel_mode_t::kPedestrian);
+    }
+    return;
+  }
+
   const DirectedEdge* opp_pred_edge = nullptr;
   if (!FORWARD) {
     opp_pred_edge = tile->directededge(nodeinfo->edge_index());
@@ -178,6 +191,68 @@ void TimeDistanceBSSMatrix::Expand(GraphReader& graphreader,
   }
 }
 
+// Add a bicycle label for each ride of the tables at the station
+template <const ExpansionType expansion_direction, const bool FORWARD>
+void TimeDistanceBSSMatrix::ExpandRides(GraphReader& graphreader,
+                                        const GraphId& node,
+                                        const EdgeLabel& pred,
+                                        const uint32_t pred_idx) {
+  const uint32_t station = bss_tables_->station_index(node);
+  if (station == kInvalidBssStation) {
+    return;
+  }
+
+  auto expand = [&](const BssRide& ride) {
+    // forward the label ends at the station the ride ends at, reverse at the one it starts at
+    GraphId edgeid(FORWARD ? ride.last_edge : ride.first_edge);
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* directededge = nullptr;
+    if (!FORWARD && tile) {
+      edgeid = graphreader.GetOpposingEdgeId(edgeid, directededge, tile);
+    } else if (tile) {
+      directededge = tile->directededge(edgeid);
+    }
+    if (!edgeid.Is_Valid() || directededge == nullptr) {
+      return;
+    }
+    EdgeStatusInfo* es = bicycle_edgestatus_.GetPtr(edgeid, tile);
+    if (es->set() == EdgeSet::kPermanent) {
+      return;
+    }
+
+    // Same as for an edge, a cheaper ride to a station that was reached before updates its label
+    const Cost newcost = pred.cost() + Cost{ride.cost, ride.secs};
+    if (es->set() == EdgeSet::kTemporary) {
+      EdgeLabel& lab = edgelabels_[es->index()];
+      if (newcost.cost < lab.cost().cost) {
+        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+        adjacencylist_.decrease(es->index(), newsortcost);
+        lab.Update(pred_idx, newcost, newsortcost, Cost{}, kInvalidRestriction);
+      }
+      return;
+    }
+
+    uint32_t idx = edgelabels_.size();
+    edgelabels_.emplace_back(pred_idx, edgeid, directededge, newcost, newcost.cost, 0.0f,
+                             travel_mode_t::kBicycle, pred.path_distance() + ride.length, Cost{},
+                             kInvalidRestriction, true, false, InternalTurn::kNoTurn);
+    *es = {EdgeSet::kTemporary, idx};
+    adjacencylist_.add(idx);
+  };
+
+  if (FORWARD) {
+    const auto rides = bss_tables_->rides_from(station);
+    for (const auto* ride = rides.first; ride != rides.second; ++ride) {
+      expand(*ride);
+    }
+  } else {
+    const auto rides = bss_tables_->rides_to(station);
+    for (const auto* ride = rides.first; ride != rides.second; ++ride) {
+      expand(bss_tables_->ride(*ride));
+    }
+  }
+}
+
 // Calculate time and distance from one origin location to many destination
 // locations.
 template <const ExpansionType expansion_direction, const bool FORWARD>
@@ -1,12 +1,19 @@
 #include "thor/timedistancematrix.h"
+#include "baldr/tilehierarchy.h"
 #include "midgard/logging.h"
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
 
 namespace {
+
+// The nearest point of a tile is taken within its latitude and longitude range, which is off a
+// little from the nearest point along the great circle. Keep the bound a bit short of it
+constexpr float kTileBoundSlack = 0.9f;
+
 static bool IsTrivial(const uint64_t& edgeid,
                       const valhalla::Location& origin,
                       const valhalla::Location& destination) {
@@ -32,7 +39,12 @@ TimeDistanceMatrix::TimeDistanceMatrix(const boost::property_tree::ptree& config
     : mode_(travel_mode_t::kDrive), settled_count_(0), current_cost_threshold_(0),
       max_reserved_labels_count_(config.get<uint32_t>("max_reserved_labels_count_dijkstras",
                                                       kInitialEdgeLabelCountDijkstras)),
-      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)) {
+      clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)),
+      labels_budget_(config, max_reserved_labels_count_, clear_reserved_memory_),
+      time_bucket_(config.get<uint32_t>("matrix_time_bucket", 0)),
+      goal_pruning_(config.get<bool>("matrix_goal_pruning", false)), cost_per_meter_(0.f),
+      max_dest_threshold_(0.f), row_callback_(nullptr),
+      deadline_(std::chrono::steady_clock::time_point::max()) {
 }
 
 // Compute a cost threshold in seconds based on average speed for the travel mode.
@@ -97,6 +109,7 @@ void TimeDistanceMatrix::Expand(GraphReader& graphreader,
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
+  edge_cost_t* shared_costs = EdgeCosts(edgeid, tile, offset_time);
   const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
   for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
     // Skip shortcut edges
@@ -138,10 +151,21 @@ void TimeDistanceMatrix::Expand(GraphReader& graphreader,
       }
     }
 
-    // Get cost and update distance
+    // Get cost and update distance, another origin may have costed the edge already (at about
+    // the same time)
     uint8_t flow_sources;
-    auto newcost = FORWARD ? costing_->EdgeCost(directededge, tile, offset_time, flow_sources)
-                           : costing_->EdgeCost(opp_edge, t2, offset_time, flow_sources);
+    Cost newcost;
+    edge_cost_t* shared = shared_costs == nullptr ? nullptr : shared_costs + i;
+    if (shared != nullptr && shared->known) {
+      newcost = shared->cost;
+      flow_sources = shared->flow_sources;
+    } else {
+      newcost = FORWARD ? costing_->EdgeCost(directededge, tile, offset_time, flow_sources)
+                        : costing_->EdgeCost(opp_edge, t2, offset_time, flow_sources);
+      if (shared != nullptr) {
+        *shared = {newcost, flow_sources, true};
+      }
+    }
     auto transition_cost =
         FORWARD ? costing_->TransitionCost(directededge, nodeinfo, pred)
                 : costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
@@ -155,11 +179,10 @@ void TimeDistanceMatrix::Expand(GraphReader& graphreader,
     // less cost the predecessor is updated and the sort cost is decremented
     // by the difference in real cost (A* heuristic doesn't change)
     if (es->set() == EdgeSet::kTemporary) {
-      EdgeLabel& lab = edgelabels_[es->index()];
+      CompactEdgeLabel& lab = edgelabels_[es->index()];
       if (newcost.cost < lab.cost().cost) {
-        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
-        adjacencylist_.decrease(es->index(), newsortcost);
-        lab.Update(pred_idx, newcost, newsortcost, distance, transition_cost, restriction_idx);
+        adjacencylist_.decrease(es->index(), newcost.cost);
+        lab.Update(pred_idx, newcost, distance);
       }
       continue;
     }
@@ -170,8 +193,7 @@ void TimeDistanceMatrix::Expand(GraphReader& graphreader,
         FORWARD ? turn_type = costing_->TurnType(pred.opp_local_idx(), nodeinfo, directededge)
                 : costing_->TurnType(directededge->localedgeidx(), nodeinfo, opp_edge, opp_pred_edge);
 
-    edgelabels_.emplace_back(pred_idx, edgeid, directededge, newcost, newcost.cost, 0.0f, mode_,
-                             distance, transition_cost, restriction_idx,
+    edgelabels_.emplace_back(pred_idx, edgeid, directededge, newcost, mode_, distance,
                              (pred.closure_pruning() || !costing_->IsClosed(directededge, tile)),
                              static_cast<bool>(flow_sources & kDefaultFlowMask), turn_type);
     *es = {EdgeSet::kTemporary, idx};
@@ -202,17 +224,30 @@ void TimeDistanceMatrix::ComputeMatrix(Api& request,
 
   size_t num_elements = origins.size() * destinations.size();
   auto time_infos = SetTime(origins, graphreader);
-  // thanks to protobuf not handling strings well, we have to collect those
-  std::vector<std::string> out_date_times(num_elements);
+
+  // The shared edge costs only hold for the costing of this request
+  edge_costs_.clear();
 
   // Initialize destinations once for all origins
   InitDestinations<expansion_direction>(graphreader, destinations);
-  // reserve the PBF vectors
+  cost_per_meter_ = costing_->AStarCostFactor();
+  // reserve the PBF vectors, the date_times as well so a row is whole once it is done
   reserve_pbf_arrays(*request.mutable_matrix(), num_elements);
+  for (size_t i = 0; i < num_elements; ++i) {
+    request.mutable_matrix()->add_date_times();
+  }
+
+  uint32_t origin_index = 0;
+  bool out_of_time = false;
+  for (; origin_index < origins.size(); ++origin_index) {
+    // the origins left once the time is up are not searched from
+    if (std::chrono::steady_clock::now() > deadline_) {
+      break;
+    }
 
-  for (size_t origin_index = 0; origin_index < origins.size(); ++origin_index) {
     // reserve some space for the next dijkstras (will be cleared at the end of the loop)
     edgelabels_.reserve(max_reserved_labels_count_);
+    search_timer_.phase(SearchPhase::setup);
     auto& origin = origins.Get(origin_index);
     const auto& time_info = time_infos[origin_index];
 
@@ -225,6 +260,7 @@ void TimeDistanceMatrix::ComputeMatrix(Api& request,
     settled_count_ = 0;
     SetOrigin<expansion_direction>(graphreader, origin, time_info);
     SetDestinationEdges();
+    search_timer_.phase(SearchPhase::expansion);
 
     // Find shortest path
     graph_tile_ptr tile;
@@ -235,12 +271,20 @@ void TimeDistanceMatrix::ComputeMatrix(Api& request,
       if (predindex == kInvalidLabel) {
         // Can not expand any further...
         FormTimeDistanceMatrix(request, graphreader, FORWARD, origin_index, origin.date_time(),
-                               time_info.timezone_index, GraphId{}, out_date_times);
+                               time_info.timezone_index, GraphId{});
         break;
       }
+      ++stats_.settled;
 
-      // Copy the EdgeLabel for use in costing
-      EdgeLabel pred = edgelabels_[predindex];
+      // Give up on the origin once the time is up, the clock is only read every so many labels
+      if ((stats_.settled % kInterruptIterationsInterval) == 0 &&
+          std::chrono::steady_clock::now() > deadline_) {
+        out_of_time = true;
+        break;
+      }
+
+      // Expand the EdgeLabel for use in costing
+      EdgeLabel pred = edgelabels_[predindex].label();
 
       // Remove label from adjacency list, mark it as permanently labeled.
 
@@ -260,7 +304,7 @@ void TimeDistanceMatrix::ComputeMatrix(Api& request,
         if (UpdateDestinations(origin, destinations, destedge->second, edge, tile, pred, time_info,
                                matrix_locations)) {
           FormTimeDistanceMatrix(request, graphreader, FORWARD, origin_index, origin.date_time(),
-                                 time_info.timezone_index, pred.edgeid(), out_date_times);
+                                 time_info.timezone_index, pred.edgeid());
           break;
         }
       }
@@ -268,22 +312,36 @@ void TimeDistanceMatrix::ComputeMatrix(Api& request,
       // Terminate when we are beyond the cost threshold
       if (pred.cost().cost > current_cost_threshold_) {
         FormTimeDistanceMatrix(request, graphreader, FORWARD, origin_index, origin.date_time(),
-                               time_info.timezone_index, pred.edgeid(), out_date_times);
+                               time_info.timezone_index, pred.edgeid());
         break;
       }
 
+      // Skip nodes too far from every destination that is left
+      if (PrunedByGoal(pred.endnode(), pred.cost().cost)) {
+        continue;
+      }
+
       // Expand forward from the end node of the predecessor edge.
       Expand<expansion_direction>(graphreader, pred.endnode(), pred, predindex, false, time_info,
                                   invariant);
     }
 
+    stats_.add_labels(edgelabels_);
     reset();
+    if (out_of_time) {
+      break;
+    }
+    if (row_callback_) {
+      (*row_callback_)(request, FORWARD, origin_index);
+    }
   }
 
-  // amend the date_time strings
-  for (auto& date_time : out_date_times) {
-    auto* pbf_dt = request.mutable_matrix()->mutable_date_times()->Add();
-    *pbf_dt = date_time;
+  // the origins the time was up for are left out of the matrix
+  if (origin_index < origins.size()) {
+    for (; origin_index < origins.size(); ++origin_index) {
+      FormIncomplete(request, FORWARD, origin_index);
+    }
+    add_warning(request, 208);
   }
 }
 
@@ -368,14 +426,12 @@ void TimeDistanceMatrix::SetOrigin(GraphReader& graphreader,
     // Set the predecessor edge index to invalid to indicate the origin
     // of the path. Set the origin flag
     if (FORWARD) {
-      edgelabels_.emplace_back(kInvalidLabel, edgeid, directededge, cost, cost.cost, 0.0f, mode_,
-                               dist, Cost{}, baldr::kInvalidRestriction,
+      edgelabels_.emplace_back(kInvalidLabel, edgeid, directededge, cost, mode_, dist,
                                !costing_->IsClosed(directededge, tile),
                                static_cast<bool>(flow_sources & kDefaultFlowMask),
                                InternalTurn::kNoTurn);
     } else {
-      edgelabels_.emplace_back(kInvalidLabel, opp_edge_id, opp_dir_edge, cost, cost.cost, 0.0f, mode_,
-                               dist, Cost{}, baldr::kInvalidRestriction,
+      edgelabels_.emplace_back(kInvalidLabel, opp_edge_id, opp_dir_edge, cost, mode_, dist,
                                !costing_->IsClosed(directededge, tile),
                                static_cast<bool>(flow_sources & kDefaultFlowMask),
                                InternalTurn::kNoTurn);
@@ -392,6 +448,7 @@ void TimeDistanceMatrix::InitDestinations(
     const google::protobuf::RepeatedPtrField<valhalla::Location>& locations) {
   // For each destination
   uint32_t idx = 0;
+  max_dest_threshold_ = 0.f;
   for (const auto& loc : locations) {
     // Set up the destination - consider each possible location edge.
     bool first_edge = true;
@@ -429,6 +486,9 @@ void TimeDistanceMatrix::InitDestinations(
       if (c > d.threshold) {
         d.threshold = c;
       }
+      max_dest_threshold_ = std::max(max_dest_threshold_, d.threshold);
+      dest_points_.emplace_back(destinations_.size() - 1,
+                                midgard::PointLL(edge.ll().lng(), edge.ll().lat()));
 
       // Mark the edge as having a destination on it and add the
       // destination index
@@ -439,6 +499,34 @@ void TimeDistanceMatrix::InitDestinations(
   }
 }
 
+// Whether the node is too far from the unsettled destinations to be expanded
+bool TimeDistanceMatrix::PrunedByGoal(const GraphId& node, const float cost) {
+  if (!goal_pruning_ || cost_per_meter_ <= 0.f) {
+    return false;
+  }
+
+  // the tile's distance only changes as destinations settle
+  auto& bound = tile_bounds_[node.tile_value()];
+  if (bound.first != settled_count_ + 1) {
+    const auto box = TileHierarchy::get_tiling(node.level()).TileBounds(node.tileid());
+    float meters = std::numeric_limits<float>::max();
+    for (const auto& point : dest_points_) {
+      if (destinations_[point.first].settled) {
+        continue;
+      }
+      const auto& ll = point.second;
+      const midgard::PointLL nearest(std::min(std::max(ll.lng(), box.minx()), box.maxx()),
+                                     std::min(std::max(ll.lat(), box.miny()), box.maxy()));
+      meters = std::min(meters, static_cast<float>(ll.Distance(nearest)));
+    }
+    bound = {settled_count_ + 1, meters * kTileBoundSlack};
+  }
+
+  // the threshold can still grow by the threshold of a destination before all are found
+  return cost + bound.second * cost_per_meter_ >
+         current_cost_threshold_ + 2.f * max_dest_threshold_;
+}
+
 // Update any destinations along the edge. Returns true if all destinations
 // have be settled or if the specified location count has been met or exceeded.
 bool TimeDistanceMatrix::UpdateDestinations(
@@ -559,8 +647,9 @@ void TimeDistanceMatrix::FormTimeDistanceMatrix(Api& request,
                                                 const uint32_t origin_index,
                                                 const std::string& origin_dt,
                                                 const uint64_t& origin_tz,
-                                                const GraphId& pred_id,
-                                                std::vector<std::string>& out_date_times) {
+                                                const GraphId& pred_id) {
+  search_timer_.phase(SearchPhase::path);
+
   // when it's forward, origin_index will be the source_index
   // when it's reverse, origin_index will be the target_index
   valhalla::Matrix& matrix = *request.mutable_matrix();
@@ -574,11 +663,28 @@ void TimeDistanceMatrix::FormTimeDistanceMatrix(Api& request,
     matrix.mutable_distances()->Set(pbf_idx, dest.distance);
     matrix.mutable_times()->Set(pbf_idx, time);
 
-    // this logic doesn't work with string repeated fields, gotta collect them
-    // and process them later
-    auto date_time =
+    *matrix.mutable_date_times(pbf_idx) =
         get_date_time(origin_dt, origin_tz, pred_id, reader, static_cast<uint64_t>(time));
-    out_date_times[pbf_idx] = date_time;
+  }
+}
+
+// Leave the cells of an origin that was not searched from unreachable
+void TimeDistanceMatrix::FormIncomplete(Api& request,
+                                        const bool forward,
+                                        const uint32_t origin_index) {
+  valhalla::Matrix& matrix = *request.mutable_matrix();
+  for (uint32_t i = 0; i < destinations_.size(); i++) {
+    auto pbf_idx = forward ? (origin_index * request.options().targets().size()) + i
+                           : (i * request.options().targets().size()) + origin_index;
+    matrix.mutable_from_indices()->Set(pbf_idx, forward ? origin_index : i);
+    matrix.mutable_to_indices()->Set(pbf_idx, forward ? i : origin_index);
+    matrix.mutable_distances()->Set(pbf_idx, 0);
+    matrix.mutable_times()->Set(pbf_idx, kMaxCost);
+  }
+  if (forward) {
+    matrix.add_incomplete_sources(origin_index);
+  } else {
+    matrix.add_incomplete_targets(origin_index);
   }
 }
 
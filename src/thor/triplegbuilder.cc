@@ -12,6 +12,7 @@
 #include "baldr/edgeinfo.h"
 #include "baldr/graphconstants.h"
 #include "baldr/landmark.h"
+#include "baldr/landmarkstore.h"
 #include "baldr/signinfo.h"
 #include "baldr/tilehierarchy.h"
 #include "baldr/time_info.h"
@@ -19,6 +20,7 @@
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
+#include "midgard/polyline2.h"
 #include "midgard/util.h"
 #include "proto/common.pb.h"
 #include "sif/costconstants.h"
@@ -34,31 +36,44 @@ using namespace valhalla::thor;
 
 namespace {
 
-uint32_t
-GetAdminIndex(const AdminInfo& admin_info,
-              std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher>& admin_info_map,
-              std::vector<AdminInfo>& admin_info_list) {
-
-  uint32_t admin_index = 0;
-  auto existing_admin = admin_info_map.find(admin_info);
-
-  // If admin was not processed yet
-  if (existing_admin == admin_info_map.end()) {
-
-    // Assign new admin index
-    admin_index = admin_info_list.size();
-
-    // Add admin info to list
-    admin_info_list.emplace_back(admin_info);
+/**
+ * The admins of a leg. Nodes refer to the admins of their tile by index, so the index of a tile
+ * admin in the leg is looked up by the tile and that index. The texts of an admin are only read
+ * from the tile the first time one of its nodes comes up, admins that are the same in several
+ * tiles then get the same index in the leg.
+ */
+class AdminTable {
+public:
+  uint32_t index(const graph_tile_ptr& tile, const uint32_t tile_admin_index) {
+    // the admin index takes the place of the id, the tile base has none
+    const GraphId key(tile->id().tileid(), tile->id().level(), tile_admin_index);
+    auto by_tile = tile_admins_.find(key);
+    if (by_tile != tile_admins_.end()) {
+      return by_tile->second;
+    }
+
+    auto admin_info = tile->admininfo(tile_admin_index);
+    auto existing_admin = admin_indices_.find(admin_info);
+    uint32_t admin_index = admin_infos_.size();
+    if (existing_admin == admin_indices_.end()) {
+      admin_indices_.emplace(admin_info, admin_index);
+      admin_infos_.emplace_back(std::move(admin_info));
+    } else {
+      admin_index = existing_admin->second;
+    }
+    tile_admins_.emplace(key, admin_index);
+    return admin_index;
+  }
 
-    // Add admin info/index pair to map
-    admin_info_map.emplace(admin_info, admin_index);
-  } // Use known admin
-  else {
-    admin_index = existing_admin->second;
+  const std::vector<AdminInfo>& admins() const {
+    return admin_infos_;
   }
-  return admin_index;
-}
+
+private:
+  std::unordered_map<GraphId, uint32_t> tile_admins_;
+  std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher> admin_indices_;
+  std::vector<AdminInfo> admin_infos_;
+};
 
 void AssignAdmins(const AttributesController& controller,
                   TripLeg& trip_path,
@@ -70,22 +85,22 @@ void AssignAdmins(const AttributesController& controller,
       TripLeg_Admin* trip_admin = trip_path.add_admin();
 
       // Set country code if requested
-      if (controller(kAdminCountryCode)) {
+      if (controller(Attribute::kAdminCountryCode)) {
         trip_admin->set_country_code(admin_info.country_iso());
       }
 
       // Set country text if requested
-      if (controller(kAdminCountryText)) {
+      if (controller(Attribute::kAdminCountryText)) {
         trip_admin->set_country_text(admin_info.country_text());
       }
 
       // Set state code if requested
-      if (controller(kAdminStateCode)) {
+      if (controller(Attribute::kAdminStateCode)) {
         trip_admin->set_state_code(admin_info.state_iso());
       }
 
       // Set state text if requested
-      if (controller(kAdminStateText)) {
+      if (controller(Attribute::kAdminStateText)) {
         trip_admin->set_state_text(admin_info.state_text());
       }
     }
@@ -98,24 +113,25 @@ inline std::string country_code_from_edge(const graph_tile_ptr& tile,
   if (!tile) {
     return std::string();
   }
-  return tile->admininfo(tile->node(de.endnode())->admin_index()).country_iso();
+  // the code is stored with the admin, its texts don't have to be read
+  return tile->admin(tile->node(de.endnode())->admin_index())->country_iso();
 }
 
 /**
  * Used to add or update incidents attached to the provided leg. We could do something more exotic to
- * avoid linear scan, like keeping a separate lookup outside of the pbf
+ * avoid linear scan, like keeping a separate lookup outside of the pbf. The incident tile is read
+ * in place, the metadata of an incident is only parsed when it is new to the leg
  * @param leg        the leg to update
  * @param incident   the incident that applies
  * @param index      what shape index of the leg the index apples to
  */
-void UpdateIncident(const std::shared_ptr<const valhalla::IncidentsTile>& incidents_tile,
+void UpdateIncident(const std::shared_ptr<const valhalla::baldr::IncidentTile>& incidents_tile,
                     TripLeg& leg,
-                    const valhalla::IncidentsTile::Location* incident_location,
+                    const valhalla::baldr::IncidentLocation* incident_location,
                     uint32_t index,
                     const graph_tile_ptr& end_node_tile,
                     const valhalla::baldr::DirectedEdge& de) {
-  const uint64_t current_incident_id =
-      valhalla::baldr::getIncidentMetadata(incidents_tile, *incident_location).id();
+  const uint64_t current_incident_id = incidents_tile->metadata_id(*incident_location);
   auto found = std::find_if(leg.mutable_incidents()->begin(), leg.mutable_incidents()->end(),
                             [current_incident_id](const TripLeg::Incident& candidate) {
                               return current_incident_id == candidate.metadata().id();
@@ -128,8 +144,7 @@ void UpdateIncident(const std::shared_ptr<const valhalla::IncidentsTile>& incide
     auto* new_incident = leg.mutable_incidents()->Add();
 
     // Get the full incident metadata from the incident-tile
-    const auto& meta = valhalla::baldr::getIncidentMetadata(incidents_tile, *incident_location);
-    *new_incident->mutable_metadata() = meta;
+    incidents_tile->metadata(*incident_location, *new_incident->mutable_metadata());
 
     // Set iso country code (2 & 3 char codes) on the new incident obj created for this leg
     std::string country_code_iso_2 = country_code_from_edge(end_node_tile, de);
@@ -161,7 +176,7 @@ valhalla::TripLeg_Closure* fetch_or_create_closure_annotation(TripLeg& leg) {
  * Chops up the shape for an edge so that we have shape points where speeds change along the edge
  * and where incidents occur along the edge. Also sets the various per shape point attributes
  * such as time, distance, speed. Also updates the incidents list on the edge with their shape indices
- * @param controller
+ * @param plan
  * @param tile
  * @param edge
  * @param shape
@@ -173,7 +188,7 @@ valhalla::TripLeg_Closure* fetch_or_create_closure_annotation(TripLeg& leg) {
  * @param cut_for_traffic
  * @param incidents
  */
-void SetShapeAttributes(const AttributesController& controller,
+void SetShapeAttributes(const TripLegBuildPlan& plan,
                         const graph_tile_ptr& tile,
                         const graph_tile_ptr& end_node_tile,
                         const DirectedEdge* edge,
@@ -188,23 +203,16 @@ void SetShapeAttributes(const AttributesController& controller,
   // TODO: if this is a transit edge then the costing will throw
 
   // bail if nothing to do
-  if (!cut_for_traffic && incidents.start_index == incidents.end_index &&
-      !controller.category_attribute_enabled(kShapeAttributesCategory)) {
+  if (!cut_for_traffic && incidents.start_index == incidents.end_index && !plan.shape_attributes) {
     return;
   }
 
-  // initialize shape_attributes once
-  if (!leg.has_shape_attributes() &&
-      controller.category_attribute_enabled(kShapeAttributesCategory)) {
-    leg.mutable_shape_attributes();
-  }
-
   // convenient for bundling info about the spots where we cut the shape
   struct cut_t {
     double percent_along;
     double speed; // meters per second
     uint8_t congestion;
-    std::vector<const valhalla::IncidentsTile::Location*> incidents;
+    std::vector<const valhalla::baldr::IncidentLocation*> incidents;
     bool closed;
   };
 
@@ -248,19 +256,19 @@ void SetShapeAttributes(const AttributesController& controller,
   // sort the start and ends of the incidents along this edge
   for (auto incident_location_index = incidents.start_index;
        incident_location_index != incidents.end_index; ++incident_location_index) {
-    if (incident_location_index >= incidents.tile->locations_size()) {
+    if (incident_location_index >= static_cast<int>(incidents.tile->location_count())) {
       throw std::logic_error(
           "invalid incident_location_index: " + std::to_string(incident_location_index) + " vs " +
-          std::to_string(incidents.tile->locations_size()));
+          std::to_string(incidents.tile->location_count()));
     }
-    const auto& incident = incidents.tile->locations(incident_location_index);
+    const auto& incident = incidents.tile->locations()[incident_location_index];
     // if the incident is actually on the part of the edge we are using
-    if (incident.start_offset() > tgt_pct || incident.end_offset() < src_pct)
+    if (incident.start_offset > tgt_pct || incident.end_offset < src_pct)
       continue;
     // insert the start point and end points
     for (auto offset : {
-             std::max((double)incident.start_offset(), src_pct),
-             std::min((double)incident.end_offset(), tgt_pct),
+             std::max((double)incident.start_offset, src_pct),
+             std::min((double)incident.end_offset, tgt_pct),
          }) {
       // if this is clipped at the beginning of the edge then its not a new cut but we still need to
       // attach the incidents information to the leg
@@ -295,22 +303,19 @@ void SetShapeAttributes(const AttributesController& controller,
                               });
   assert(cut_itr != cuts.cend());
 
-  // reservations
-  if (controller(kShapeAttributesTime)) {
-    leg.mutable_shape_attributes()->mutable_time()->Reserve(leg.shape_attributes().time_size() +
-                                                            shape.size() + cuts.size());
-  }
-  if (controller(kShapeAttributesLength)) {
-    leg.mutable_shape_attributes()->mutable_length()->Reserve(leg.shape_attributes().length_size() +
-                                                              shape.size() + cuts.size());
-  }
-  if (controller(kShapeAttributesSpeed)) {
-    leg.mutable_shape_attributes()->mutable_speed()->Reserve(leg.shape_attributes().speed_size() +
-                                                             shape.size() + cuts.size());
-  }
-  if (controller(kShapeAttributesSpeedLimit)) {
-    leg.mutable_shape_attributes()->mutable_speed_limit()->Reserve(
-        leg.shape_attributes().speed_limit_size() + shape.size() + cuts.size());
+  // the columns of the requested attributes, each reserved for the points of this edge and its
+  // cuts. the shape holds the whole leg so far, reserving for all of it on every edge would keep
+  // the columns several times larger than they end up
+  auto* attributes = plan.shape_attributes ? leg.mutable_shape_attributes() : nullptr;
+  auto* times = plan.shape_time ? attributes->mutable_time() : nullptr;
+  auto* lengths = plan.shape_length ? attributes->mutable_length() : nullptr;
+  auto* speeds = plan.shape_speed ? attributes->mutable_speed() : nullptr;
+  auto* speed_limits = plan.shape_speed_limit ? attributes->mutable_speed_limit() : nullptr;
+  const int edge_points = static_cast<int>(shape.size() - shape_begin + cuts.size());
+  for (auto* column : {times, lengths, speeds, speed_limits}) {
+    if (column) {
+      column->Reserve(column->size() + edge_points);
+    }
   }
 
   // Set the shape attributes
@@ -329,7 +334,7 @@ void SetShapeAttributes(const AttributesController& controller,
       distance *= coef;
       shift = 1;
     }
-    if (controller(kShapeAttributesClosure)) {
+    if (plan.shape_closure) {
       // Process closure annotations
       if (cut_itr->closed) {
         // Found a closure. Fetch a new annotation, or the last closure
@@ -355,30 +360,30 @@ void SetShapeAttributes(const AttributesController& controller,
     }
 
     // Set shape attributes time per shape point if requested
-    if (controller(kShapeAttributesTime)) {
+    if (times) {
       // convert time to milliseconds and then round to an integer
-      leg.mutable_shape_attributes()->add_time((time * kMillisecondPerSec) + 0.5);
+      times->Add((time * kMillisecondPerSec) + 0.5);
     }
 
     // Set shape attributes length per shape point if requested
-    if (controller(kShapeAttributesLength)) {
+    if (lengths) {
       // convert length to decimeters and then round to an integer
-      leg.mutable_shape_attributes()->add_length((distance * kDecimeterPerMeter) + 0.5);
+      lengths->Add((distance * kDecimeterPerMeter) + 0.5);
     }
 
     // Set shape attributes speed per shape point if requested
-    if (controller(kShapeAttributesSpeed)) {
+    if (speeds) {
       // convert speed to decimeters per sec and then round to an integer
       double decimeters_sec = (distance * kDecimeterPerMeter / time) + 0.5;
       if (std::isnan(decimeters_sec) || time == 0.) { // avoid NaN
         decimeters_sec = 0.;
       }
-      leg.mutable_shape_attributes()->add_speed(decimeters_sec);
+      speeds->Add(decimeters_sec);
     }
 
     // Set the maxspeed if requested
-    if (controller(kShapeAttributesSpeedLimit)) {
-      leg.mutable_shape_attributes()->add_speed_limit(edgeinfo.speed_limit());
+    if (speed_limits) {
+      speed_limits->Add(edgeinfo.speed_limit());
     }
 
     // Set the incidents if we just cut or we are at the end
@@ -460,82 +465,115 @@ void CopyLocations(TripLeg& trip_path,
 /**
  * Set begin and end heading if requested.
  * @param  trip_edge  Trip path edge to add headings.
- * @param  controller Controller specifying attributes to add to trip edge.
+ * @param  plan       Which of the headings to add to trip edge.
  * @param  edge       Directed edge.
  * @param  shape      Trip shape.
  */
 void SetHeadings(TripLeg_Edge* trip_edge,
-                 const AttributesController& controller,
+                 const TripLegBuildPlan& plan,
                  const DirectedEdge* edge,
                  const std::vector<PointLL>& shape,
                  const uint32_t begin_index) {
-  if (controller(kEdgeBeginHeading) || controller(kEdgeEndHeading)) {
+  if (plan.begin_heading || plan.end_heading) {
     float offset = GetOffsetForHeading(edge->classification(), edge->use());
-    if (controller(kEdgeBeginHeading)) {
+    if (plan.begin_heading) {
       trip_edge->set_begin_heading(
           std::round(PointLL::HeadingAlongPolyline(shape, offset, begin_index, shape.size() - 1)));
     }
-    if (controller(kEdgeEndHeading)) {
+    if (plan.end_heading) {
       trip_edge->set_end_heading(
           std::round(PointLL::HeadingAtEndOfPolyline(shape, offset, begin_index, shape.size() - 1)));
     }
   }
 }
 
+// Landmarks of the landmark store at most this far from an edge are added to it when the tiles hold
+// none for the edge, the radius within which landmarks are associated with edges at build time
+constexpr float kStoreLandmarkRadius = 25.f;
+
+/**
+ * Add a landmark to the trip edge.
+ * @param  lan         Landmark to add.
+ * @param  trip_edge   Trip path edge to add the landmark to.
+ * @param  edge        Directed edge of the trip edge.
+ * @param  shape       Trip shape.
+ * @param  begin_index Index of the trip shape where the edge begins.
+ */
+void AddLandmark(const Landmark& lan,
+                 TripLeg_Edge* trip_edge,
+                 const DirectedEdge* edge,
+                 const std::vector<PointLL>& shape,
+                 const uint32_t begin_index) {
+  PointLL landmark_point = {lan.lng, lan.lat};
+
+  // find the closed point on edge to the landmark
+  auto closest = landmark_point.ClosestPoint(shape, begin_index);
+  // TODO: in the future maybe we could allow a request option to have a tighter threshold on
+  // how far landmarks should be away from an edge
+
+  // add the landmark to trip leg
+  auto* landmark = trip_edge->mutable_landmarks()->Add();
+  landmark->set_name(lan.name);
+  landmark->set_type(static_cast<valhalla::RouteLandmark::Type>(lan.type));
+  landmark->mutable_lat_lng()->set_lng(lan.lng);
+  landmark->mutable_lat_lng()->set_lat(lan.lat);
+
+  // calculate the landmark's distance along the edge
+  // that is to accumulate distance from the begin point to the closest point to it on the edge
+  int closest_idx = std::get<2>(closest);
+  double distance_along_edge = 0;
+  for (int idx = begin_index + 1; idx <= closest_idx; ++idx) {
+    distance_along_edge += shape[idx].Distance(shape[idx - 1]);
+  }
+  distance_along_edge += shape[closest_idx].Distance(std::get<0>(closest));
+  // the overall distance shouldn't be larger than edge length
+  distance_along_edge = std::min(distance_along_edge, static_cast<double>(edge->length()));
+  landmark->set_distance(distance_along_edge);
+  // check which side of the edge the landmark is on
+  // quirks of the ClosestPoint function
+  bool is_right = closest_idx == (int)shape.size() - 1
+                      ? landmark_point.IsLeft(shape[closest_idx - 1], shape[closest_idx]) < 0
+                      : landmark_point.IsLeft(shape[closest_idx], shape[closest_idx + 1]) < 0;
+  landmark->set_right(is_right);
+}
+
 /**
  * Add landmarks in the directed edge to trip edge.
  * @param  edgeinfo    Edge info of the directed edge.
  * @param  trip_edge   Trip path edge to add landmarks.
- * @param  controller  Controller specifying whether we want landmarks in the graph to come out the
- * other side.
  * @param  edge        Directed edge where the landmarks are stored.
  * @param  shape       Trip shape.
+ * @param  begin_index Index of the trip shape where the edge begins.
+ * @param  store       Landmark store to look the landmarks up in when the tile holds none for the
+ *                     edge, nullptr if there is none.
  */
 void AddLandmarks(const EdgeInfo& edgeinfo,
                   TripLeg_Edge* trip_edge,
-                  const AttributesController& controller,
                   const DirectedEdge* edge,
                   const std::vector<PointLL>& shape,
-                  const uint32_t begin_index) {
-  if (!controller(kEdgeLandmarks)) {
-    return;
-  }
-
+                  const uint32_t begin_index,
+                  const LandmarkStore* store) {
+  bool tagged = false;
   for (const auto& tag : edgeinfo.GetTags()) {
     // get landmarks from tagged values in the edge info
     if (tag.first == baldr::TaggedValue::kLandmark) {
-      Landmark lan(tag.second);
-      PointLL landmark_point = {lan.lng, lan.lat};
-
-      // find the closed point on edge to the landmark
-      auto closest = landmark_point.ClosestPoint(shape, begin_index);
-      // TODO: in the future maybe we could allow a request option to have a tighter threshold on
-      // how far landmarks should be away from an edge
-
-      // add the landmark to trip leg
-      auto* landmark = trip_edge->mutable_landmarks()->Add();
-      landmark->set_name(lan.name);
-      landmark->set_type(static_cast<valhalla::RouteLandmark::Type>(lan.type));
-      landmark->mutable_lat_lng()->set_lng(lan.lng);
-      landmark->mutable_lat_lng()->set_lat(lan.lat);
-
-      // calculate the landmark's distance along the edge
-      // that is to accumulate distance from the begin point to the closest point to it on the edge
-      int closest_idx = std::get<2>(closest);
-      double distance_along_edge = 0;
-      for (int idx = begin_index + 1; idx <= closest_idx; ++idx) {
-        distance_along_edge += shape[idx].Distance(shape[idx - 1]);
-      }
-      distance_along_edge += shape[closest_idx].Distance(std::get<0>(closest));
-      // the overall distance shouldn't be larger than edge length
-      distance_along_edge = std::min(distance_along_edge, static_cast<double>(edge->length()));
-      landmark->set_distance(distance_along_edge);
-      // check which side of the edge the landmark is on
-      // quirks of the ClosestPoint function
-      bool is_right = closest_idx == (int)shape.size() - 1
-                          ? landmark_point.IsLeft(shape[closest_idx - 1], shape[closest_idx]) < 0
-                          : landmark_point.IsLeft(shape[closest_idx], shape[closest_idx + 1]) < 0;
-      landmark->set_right(is_right);
+      AddLandmark(Landmark(tag.second), trip_edge, edge, shape, begin_index);
+      tagged = true;
+    }
+  }
+  if (tagged || !store || begin_index + 1 >= shape.size()) {
+    return;
+  }
+
+  // otherwise only the bins of the store around the edge are read
+  AABB2<PointLL> bbox(shape[begin_index], shape[begin_index]);
+  for (size_t i = begin_index + 1; i < shape.size(); ++i) {
+    bbox.Expand(AABB2<PointLL>(shape[i], shape[i]));
+  }
+  for (const auto& lan : store->Find(ExpandMeters(bbox, kStoreLandmarkRadius))) {
+    const PointLL landmark_point = {lan.lng, lan.lat};
+    if (std::get<1>(landmark_point.ClosestPoint(shape, begin_index)) <= kStoreLandmarkRadius) {
+      AddLandmark(lan, trip_edge, edge, shape, begin_index);
     }
   }
 }
@@ -573,56 +611,56 @@ void AddSignInfo(const AttributesController& controller,
     for (const auto& sign : edge_signs) {
       switch (sign.type()) {
         case valhalla::baldr::Sign::Type::kExitNumber: {
-          if (controller(kEdgeSignExitNumber)) {
+          if (controller(Attribute::kEdgeSignExitNumber)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_exit_numbers()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kExitBranch: {
-          if (controller(kEdgeSignExitBranch)) {
+          if (controller(Attribute::kEdgeSignExitBranch)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_exit_onto_streets()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kExitToward: {
-          if (controller(kEdgeSignExitToward)) {
+          if (controller(Attribute::kEdgeSignExitToward)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_exit_toward_locations()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kExitName: {
-          if (controller(kEdgeSignExitName)) {
+          if (controller(Attribute::kEdgeSignExitName)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_exit_names()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kGuideBranch: {
-          if (controller(kEdgeSignGuideBranch)) {
+          if (controller(Attribute::kEdgeSignGuideBranch)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_guide_onto_streets()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kGuideToward: {
-          if (controller(kEdgeSignGuideToward)) {
+          if (controller(Attribute::kEdgeSignGuideToward)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_guide_toward_locations()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kGuidanceViewJunction: {
-          if (controller(kEdgeSignGuidanceViewJunction)) {
+          if (controller(Attribute::kEdgeSignGuidanceViewJunction)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_guidance_view_junctions()->Add());
           }
           break;
         }
         case valhalla::baldr::Sign::Type::kGuidanceViewSignboard: {
-          if (controller(kEdgeSignGuidanceViewSignboard)) {
+          if (controller(Attribute::kEdgeSignGuidanceViewSignboard)) {
             PopulateSignElement(sign_index, sign, pronunciations,
                                 trip_sign->mutable_guidance_view_signboards()->Add());
           }
@@ -659,7 +697,7 @@ void AddTripIntersectingEdge(const AttributesController& controller,
   TripLeg_IntersectingEdge* intersecting_edge = trip_node->add_intersecting_edge();
 
   // Set the heading for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeBeginHeading)) {
+  if (controller(Attribute::kNodeIntersectingEdgeBeginHeading)) {
     intersecting_edge->set_begin_heading(nodeinfo->heading(local_edge_index));
   }
 
@@ -675,7 +713,7 @@ void AddTripIntersectingEdge(const AttributesController& controller,
                          : Traversability::kNone;
   }
   // Set the walkability flag for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeWalkability)) {
+  if (controller(Attribute::kNodeIntersectingEdgeWalkability)) {
     intersecting_edge->set_walkability(GetTripLegTraversability(traversability));
   }
 
@@ -689,45 +727,45 @@ void AddTripIntersectingEdge(const AttributesController& controller,
                                                                          : Traversability::kNone;
   }
   // Set the cyclability flag for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeCyclability)) {
+  if (controller(Attribute::kNodeIntersectingEdgeCyclability)) {
     intersecting_edge->set_cyclability(GetTripLegTraversability(traversability));
   }
 
   // Set the driveability flag for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeDriveability)) {
+  if (controller(Attribute::kNodeIntersectingEdgeDriveability)) {
     intersecting_edge->set_driveability(
         GetTripLegTraversability(nodeinfo->local_driveability(local_edge_index)));
   }
 
   // Set the previous/intersecting edge name consistency if requested
-  if (controller(kNodeIntersectingEdgeFromEdgeNameConsistency)) {
+  if (controller(Attribute::kNodeIntersectingEdgeFromEdgeNameConsistency)) {
     bool name_consistency =
         (prev_de == nullptr) ? false : prev_de->name_consistency(local_edge_index);
     intersecting_edge->set_prev_name_consistency(name_consistency);
   }
 
   // Set the current/intersecting edge name consistency if requested
-  if (controller(kNodeIntersectingEdgeToEdgeNameConsistency)) {
+  if (controller(Attribute::kNodeIntersectingEdgeToEdgeNameConsistency)) {
     intersecting_edge->set_curr_name_consistency(directededge->name_consistency(local_edge_index));
   }
 
   // Set the use for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeUse)) {
+  if (controller(Attribute::kNodeIntersectingEdgeUse)) {
     intersecting_edge->set_use(GetTripLegUse(intersecting_de->use()));
   }
 
   // Set the road class for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeRoadClass)) {
+  if (controller(Attribute::kNodeIntersectingEdgeRoadClass)) {
     intersecting_edge->set_road_class(GetRoadClass(intersecting_de->classification()));
   }
 
   // Set the lane count for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeLaneCount)) {
+  if (controller(Attribute::kNodeIntersectingEdgeLaneCount)) {
     intersecting_edge->set_lane_count(intersecting_de->lanecount());
   }
 
   // Set the sign info for the intersecting edge if requested
-  if (controller(kNodeIntersectingEdgeSignInfo)) {
+  if (controller(Attribute::kNodeIntersectingEdgeSignInfo)) {
     if (intersecting_de->sign()) {
       std::unordered_map<uint32_t, std::pair<uint8_t, std::string>> pronunciations;
       std::vector<SignInfo> edge_signs =
@@ -837,6 +875,7 @@ void AddIntersectingEdges(const AttributesController& controller,
 /**
  * Add trip edge. (TODO more comments)
  * @param  controller         Controller to determine which attributes to set.
+ * @param  plan               What of the leg is read, whole categories are skipped by it.
  * @param  edge               Identifier of an edge within the tiled, hierarchical graph.
  * @param  trip_id            Trip Id (0 if not a transit edge).
  * @param  block_id           Transit block Id (0 if not a transit edge)
@@ -853,6 +892,7 @@ void AddIntersectingEdges(const AttributesController& controller,
  *
  */
 TripLeg_Edge* AddTripEdge(const AttributesController& controller,
+                          const TripLegBuildPlan& plan,
                           const GraphId& edge,
                           const uint32_t trip_id,
                           const uint32_t block_id,
@@ -879,21 +919,19 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   auto edgeinfo = graphtile->edgeinfo(directededge);
 
   // Add names to edge if requested
-  if (controller(kEdgeNames)) {
-    auto names_and_types = edgeinfo.GetNamesAndTypes(true);
+  if (plan.names) {
+    // the tagged names are skipped, only when there are some can there be pronunciations
+    auto names_and_types = edgeinfo.GetNamesAndTypes(false);
     trip_edge->mutable_name()->Reserve(names_and_types.size());
-    std::unordered_map<uint8_t, std::pair<uint8_t, std::string>> pronunciations =
-        edgeinfo.GetPronunciationsMap();
+    std::unordered_map<uint8_t, std::pair<uint8_t, std::string>> pronunciations;
+    if (names_and_types.size() < edgeinfo.name_count()) {
+      pronunciations = edgeinfo.GetPronunciationsMap();
+    }
     uint8_t name_index = 0;
-    for (const auto& name_and_type : names_and_types) {
-      if (std::get<2>(name_and_type) != 0) {
-        // Skip the tagged names
-        continue;
-      }
-
+    for (auto& name_and_type : names_and_types) {
       auto* trip_edge_name = trip_edge->mutable_name()->Add();
       // Assign name and type
-      trip_edge_name->set_value(std::get<0>(name_and_type));
+      trip_edge_name->set_value(std::move(std::get<0>(name_and_type)));
       trip_edge_name->set_is_route_number(std::get<1>(name_and_type));
       std::unordered_map<uint8_t, std::pair<uint8_t, std::string>>::const_iterator iter =
           pronunciations.find(name_index);
@@ -911,7 +949,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Add tagged names to the edge if requested
-  if (controller(kEdgeTaggedValues)) {
+  if (plan.tagged_values) {
     const auto& tagged_values_and_types = edgeinfo.GetTags();
     trip_edge->mutable_tagged_value()->Reserve(tagged_values_and_types.size());
     for (const auto& tagged_value_and_type : tagged_values_and_types) {
@@ -927,7 +965,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 #endif
 
   // Set the signs (if the directed edge has sign information) and if requested
-  if (directededge->sign()) {
+  if (plan.signs && directededge->sign()) {
     // Add the edge signs
     std::unordered_map<uint32_t, std::pair<uint8_t, std::string>> pronunciations;
     std::vector<SignInfo> edge_signs = graphtile->GetSigns(idx, pronunciations);
@@ -938,7 +976,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Process the named junctions at nodes
-  if (has_junction_name && start_tile) {
+  if (plan.junction_names && has_junction_name && start_tile) {
     // Add the node signs
     std::unordered_map<uint32_t, std::pair<uint8_t, std::string>> pronunciations;
     std::vector<SignInfo> node_signs = start_tile->GetSigns(start_node_idx, pronunciations, true);
@@ -948,7 +986,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
       for (const auto& sign : node_signs) {
         switch (sign.type()) {
           case valhalla::baldr::Sign::Type::kJunctionName: {
-            if (controller(kEdgeSignJunctionName)) {
+            if (controller(Attribute::kEdgeSignJunctionName)) {
               PopulateSignElement(sign_index, sign, pronunciations,
                                   trip_sign->mutable_junction_names()->Add());
             }
@@ -963,7 +1001,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // If turn lanes exist
-  if (directededge->turnlanes()) {
+  if (plan.turn_lanes && directededge->turnlanes()) {
     auto turnlanes = graphtile->turnlanes(idx);
     trip_edge->mutable_turn_lanes()->Reserve(turnlanes.size());
     for (auto tl : turnlanes) {
@@ -973,13 +1011,13 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Set road class if requested
-  if (controller(kEdgeRoadClass)) {
+  if (controller(Attribute::kEdgeRoadClass)) {
     trip_edge->set_road_class(GetRoadClass(directededge->classification()));
   }
 
   // Set speed if requested
   // TODO: what to do about transit edges?
-  if (controller(kEdgeSpeed)) {
+  if (controller(Attribute::kEdgeSpeed)) {
     // TODO: could get better precision speed here by calling GraphTile::GetSpeed but we'd need to
     // know whether or not the costing actually cares about the speed of the edge. Perhaps a
     // refactor of costing to have a GetSpeed function which EdgeCost calls internally but which we
@@ -1010,7 +1048,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   // Test whether edge is traversed forward or reverse
   if (directededge->forward()) {
     // Set traversability for forward directededge if requested
-    if (controller(kEdgeTraversability)) {
+    if (controller(Attribute::kEdgeTraversability)) {
       if ((directededge->forwardaccess() & kAccess) && (directededge->reverseaccess() & kAccess)) {
         trip_edge->set_traversability(TripLeg_Traversability::TripLeg_Traversability_kBoth);
       } else if ((directededge->forwardaccess() & kAccess) &&
@@ -1025,7 +1063,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   } else {
     // Set traversability for reverse directededge if requested
-    if (controller(kEdgeTraversability)) {
+    if (controller(Attribute::kEdgeTraversability)) {
       if ((directededge->forwardaccess() & kAccess) && (directededge->reverseaccess() & kAccess)) {
         trip_edge->set_traversability(TripLeg_Traversability::TripLeg_Traversability_kBoth);
       } else if (!(directededge->forwardaccess() & kAccess) &&
@@ -1050,56 +1088,56 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   trip_edge->set_has_time_restrictions(restrictions_idx != kInvalidRestriction);
 
   // Set the trip path use based on directed edge use if requested
-  if (controller(kEdgeUse)) {
+  if (controller(Attribute::kEdgeUse)) {
     trip_edge->set_use(GetTripLegUse(directededge->use()));
   }
 
   // Set toll flag if requested
-  if (directededge->toll() && controller(kEdgeToll)) {
+  if (directededge->toll() && controller(Attribute::kEdgeToll)) {
     trip_edge->set_toll(true);
   }
 
   // Set unpaved flag if requested
-  if (directededge->unpaved() && controller(kEdgeUnpaved)) {
+  if (directededge->unpaved() && controller(Attribute::kEdgeUnpaved)) {
     trip_edge->set_unpaved(true);
   }
 
   // Set tunnel flag if requested
-  if (directededge->tunnel() && controller(kEdgeTunnel)) {
+  if (directededge->tunnel() && controller(Attribute::kEdgeTunnel)) {
     trip_edge->set_tunnel(true);
   }
 
   // Set bridge flag if requested
-  if (directededge->bridge() && controller(kEdgeBridge)) {
+  if (directededge->bridge() && controller(Attribute::kEdgeBridge)) {
     trip_edge->set_bridge(true);
   }
 
   // Set roundabout flag if requested
-  if (directededge->roundabout() && controller(kEdgeRoundabout)) {
+  if (directededge->roundabout() && controller(Attribute::kEdgeRoundabout)) {
     trip_edge->set_roundabout(true);
   }
 
   // Set internal intersection flag if requested
-  if (directededge->internal() && controller(kEdgeInternalIntersection)) {
+  if (directededge->internal() && controller(Attribute::kEdgeInternalIntersection)) {
     trip_edge->set_internal_intersection(true);
   }
 
   // Set drive_on_right if requested
-  if (controller(kEdgeDriveOnRight)) {
+  if (controller(Attribute::kEdgeDriveOnRight)) {
     trip_edge->set_drive_on_left(!drive_on_right);
   }
 
   // Set surface if requested
-  if (controller(kEdgeSurface)) {
+  if (controller(Attribute::kEdgeSurface)) {
     trip_edge->set_surface(GetTripLegSurface(directededge->surface()));
   }
 
-  if (directededge->destonly() && controller(kEdgeDestinationOnly)) {
+  if (directededge->destonly() && controller(Attribute::kEdgeDestinationOnly)) {
     trip_edge->set_destination_only(directededge->destonly());
   }
 
   // Set indoor flag if requested
-  if (directededge->indoor() && controller(kEdgeIndoor)) {
+  if (directededge->indoor() && controller(Attribute::kEdgeIndoor)) {
     trip_edge->set_indoor(true);
   }
 
@@ -1107,64 +1145,64 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   if (mode == sif::TravelMode::kBicycle) {
     // Override bicycle mode with pedestrian if dismount flag or steps
     if (directededge->dismount() || directededge->use() == Use::kSteps) {
-      if (controller(kEdgeTravelMode)) {
+      if (controller(Attribute::kEdgeTravelMode)) {
         trip_edge->set_travel_mode(valhalla::TravelMode::kPedestrian);
       }
-      if (controller(kEdgePedestrianType)) {
+      if (controller(Attribute::kEdgePedestrianType)) {
         trip_edge->set_pedestrian_type(valhalla::PedestrianType::kFoot);
       }
     } else {
-      if (controller(kEdgeTravelMode)) {
+      if (controller(Attribute::kEdgeTravelMode)) {
         trip_edge->set_travel_mode(valhalla::TravelMode::kBicycle);
       }
-      if (controller(kEdgeBicycleType)) {
+      if (controller(Attribute::kEdgeBicycleType)) {
         trip_edge->set_bicycle_type(GetTripLegBicycleType(travel_type));
       }
     }
   } else if (mode == sif::TravelMode::kDrive) {
-    if (controller(kEdgeTravelMode)) {
+    if (controller(Attribute::kEdgeTravelMode)) {
       trip_edge->set_travel_mode(valhalla::TravelMode::kDrive);
     }
-    if (controller(kEdgeVehicleType)) {
+    if (controller(Attribute::kEdgeVehicleType)) {
       trip_edge->set_vehicle_type(GetTripLegVehicleType(travel_type));
     }
   } else if (mode == sif::TravelMode::kPedestrian) {
-    if (controller(kEdgeTravelMode)) {
+    if (controller(Attribute::kEdgeTravelMode)) {
       trip_edge->set_travel_mode(valhalla::TravelMode::kPedestrian);
     }
-    if (controller(kEdgePedestrianType)) {
+    if (controller(Attribute::kEdgePedestrianType)) {
       trip_edge->set_pedestrian_type(GetTripLegPedestrianType(travel_type));
     }
   } else if (mode == sif::TravelMode::kPublicTransit) {
-    if (controller(kEdgeTravelMode)) {
+    if (controller(Attribute::kEdgeTravelMode)) {
       trip_edge->set_travel_mode(valhalla::TravelMode::kTransit);
     }
   }
 
   // Set edge id (graphid value) if requested
-  if (controller(kEdgeId)) {
+  if (controller(Attribute::kEdgeId)) {
     trip_edge->set_id(edge.value);
   }
 
   // Set way id (base data id) if requested
-  if (controller(kEdgeWayId)) {
+  if (controller(Attribute::kEdgeWayId)) {
     trip_edge->set_way_id(edgeinfo.wayid());
   }
 
   // Set weighted grade if requested
-  if (controller(kEdgeWeightedGrade)) {
+  if (controller(Attribute::kEdgeWeightedGrade)) {
     trip_edge->set_weighted_grade((directededge->weighted_grade() - 6.f) / 0.6f);
   }
 
   // Set maximum upward and downward grade if requested (set to kNoElevationData if unavailable)
-  if (controller(kEdgeMaxUpwardGrade)) {
+  if (controller(Attribute::kEdgeMaxUpwardGrade)) {
     if (graphtile->header()->has_elevation()) {
       trip_edge->set_max_upward_grade(directededge->max_up_slope());
     } else {
       trip_edge->set_max_upward_grade(kNoElevationData);
     }
   }
-  if (controller(kEdgeMaxDownwardGrade)) {
+  if (controller(Attribute::kEdgeMaxDownwardGrade)) {
     if (graphtile->header()->has_elevation()) {
       trip_edge->set_max_downward_grade(directededge->max_down_slope());
     } else {
@@ -1173,15 +1211,26 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Set mean elevation if requested (will be kNoElevationData if unavailable)
-  if (controller(kEdgeMeanElevation)) {
+  if (controller(Attribute::kEdgeMeanElevation)) {
     trip_edge->set_mean_elevation(edgeinfo.mean_elevation());
   }
 
-  if (controller(kEdgeLaneCount)) {
+  // Set the ascent and descent if requested and the tile has them
+  if (graphtile->has_edge_elevation()) {
+    const auto* elevation = graphtile->edge_elevation(directededge);
+    if (controller(Attribute::kEdgeAscent)) {
+      trip_edge->set_ascent(elevation->ascent());
+    }
+    if (controller(Attribute::kEdgeDescent)) {
+      trip_edge->set_descent(elevation->descent());
+    }
+  }
+
+  if (controller(Attribute::kEdgeLaneCount)) {
     trip_edge->set_lane_count(directededge->lanecount());
   }
 
-  if (directededge->laneconnectivity() && controller(kEdgeLaneConnectivity)) {
+  if (plan.lane_connectivity && directededge->laneconnectivity()) {
     auto laneconnectivity = graphtile->GetLaneConnectivity(idx);
     trip_edge->mutable_lane_connectivity()->Reserve(laneconnectivity.size());
     for (const auto& l : laneconnectivity) {
@@ -1192,23 +1241,23 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
-  if (directededge->cyclelane() != CycleLane::kNone && controller(kEdgeCycleLane)) {
+  if (directededge->cyclelane() != CycleLane::kNone && controller(Attribute::kEdgeCycleLane)) {
     trip_edge->set_cycle_lane(GetTripLegCycleLane(directededge->cyclelane()));
   }
 
-  if (controller(kEdgeBicycleNetwork)) {
+  if (controller(Attribute::kEdgeBicycleNetwork)) {
     trip_edge->set_bicycle_network(directededge->bike_network());
   }
 
-  if (controller(kEdgeSacScale)) {
+  if (controller(Attribute::kEdgeSacScale)) {
     trip_edge->set_sac_scale(GetTripLegSacScale(directededge->sac_scale()));
   }
 
-  if (controller(kEdgeShoulder)) {
+  if (controller(Attribute::kEdgeShoulder)) {
     trip_edge->set_shoulder(directededge->shoulder());
   }
 
-  if (controller(kEdgeSidewalk)) {
+  if (controller(Attribute::kEdgeSidewalk)) {
     if (directededge->sidewalk_left() && directededge->sidewalk_right()) {
       trip_edge->set_sidewalk(TripLeg_Sidewalk::TripLeg_Sidewalk_kBothSides);
     } else if (directededge->sidewalk_left()) {
@@ -1218,28 +1267,28 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
-  if (controller(kEdgeDensity)) {
+  if (controller(Attribute::kEdgeDensity)) {
     trip_edge->set_density(directededge->density());
   }
 
-  if (controller(kEdgeIsUrban)) {
+  if (controller(Attribute::kEdgeIsUrban)) {
     bool is_urban = (directededge->density() > 8) ? true : false;
     trip_edge->set_is_urban(is_urban);
   }
 
-  if (controller(kEdgeSpeedLimit)) {
+  if (controller(Attribute::kEdgeSpeedLimit)) {
     trip_edge->set_speed_limit(edgeinfo.speed_limit());
   }
 
-  if (controller(kEdgeDefaultSpeed)) {
+  if (controller(Attribute::kEdgeDefaultSpeed)) {
     trip_edge->set_default_speed(directededge->speed());
   }
 
-  if (controller(kEdgeTruckSpeed)) {
+  if (controller(Attribute::kEdgeTruckSpeed)) {
     trip_edge->set_truck_speed(directededge->truck_speed());
   }
 
-  if (directededge->truck_route() && controller(kEdgeTruckRoute)) {
+  if (directededge->truck_route() && controller(Attribute::kEdgeTruckRoute)) {
     trip_edge->set_truck_route(true);
   }
 
@@ -1250,12 +1299,12 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     TransitRouteInfo* transit_route_info = trip_edge->mutable_transit_route_info();
 
     // Set block_id if requested
-    if (controller(kEdgeTransitRouteInfoBlockId)) {
+    if (controller(Attribute::kEdgeTransitRouteInfoBlockId)) {
       transit_route_info->set_block_id(block_id);
     }
 
     // Set trip_id if requested
-    if (controller(kEdgeTransitRouteInfoTripId)) {
+    if (controller(Attribute::kEdgeTransitRouteInfoTripId)) {
       transit_route_info->set_trip_id(trip_id);
     }
 
@@ -1266,7 +1315,8 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     if (transit_departure) {
 
       // Set headsign if requested
-      if (controller(kEdgeTransitRouteInfoHeadsign) && transit_departure->headsign_offset()) {
+      if (controller(Attribute::kEdgeTransitRouteInfoHeadsign) &&
+          transit_departure->headsign_offset()) {
         transit_route_info->set_headsign(graphtile->GetName(transit_departure->headsign_offset()));
       }
 
@@ -1274,55 +1324,60 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 
       if (transit_route) {
         // Set transit type if requested
-        if (controller(kEdgeTransitType)) {
+        if (controller(Attribute::kEdgeTransitType)) {
           trip_edge->set_transit_type(GetTripLegTransitType(transit_route->route_type()));
         }
 
         // Set onestop_id if requested
-        if (controller(kEdgeTransitRouteInfoOnestopId) && transit_route->one_stop_offset()) {
+        if (controller(Attribute::kEdgeTransitRouteInfoOnestopId) &&
+            transit_route->one_stop_offset()) {
           transit_route_info->set_onestop_id(graphtile->GetName(transit_route->one_stop_offset()));
         }
 
         // Set short_name if requested
-        if (controller(kEdgeTransitRouteInfoShortName) && transit_route->short_name_offset()) {
+        if (controller(Attribute::kEdgeTransitRouteInfoShortName) &&
+            transit_route->short_name_offset()) {
           transit_route_info->set_short_name(graphtile->GetName(transit_route->short_name_offset()));
         }
 
         // Set long_name if requested
-        if (controller(kEdgeTransitRouteInfoLongName) && transit_route->long_name_offset()) {
+        if (controller(Attribute::kEdgeTransitRouteInfoLongName) &&
+            transit_route->long_name_offset()) {
           transit_route_info->set_long_name(graphtile->GetName(transit_route->long_name_offset()));
         }
 
         // Set color if requested
-        if (controller(kEdgeTransitRouteInfoColor)) {
+        if (controller(Attribute::kEdgeTransitRouteInfoColor)) {
           transit_route_info->set_color(transit_route->route_color());
         }
 
         // Set text_color if requested
-        if (controller(kEdgeTransitRouteInfoTextColor)) {
+        if (controller(Attribute::kEdgeTransitRouteInfoTextColor)) {
           transit_route_info->set_text_color(transit_route->route_text_color());
         }
 
         // Set description if requested
-        if (controller(kEdgeTransitRouteInfoDescription) && transit_route->desc_offset()) {
+        if (controller(Attribute::kEdgeTransitRouteInfoDescription) && transit_route->desc_offset()) {
           transit_route_info->set_description(graphtile->GetName(transit_route->desc_offset()));
         }
 
         // Set operator_onestop_id if requested
-        if (controller(kEdgeTransitRouteInfoOperatorOnestopId) &&
+        if (controller(Attribute::kEdgeTransitRouteInfoOperatorOnestopId) &&
             transit_route->op_by_onestop_id_offset()) {
           transit_route_info->set_operator_onestop_id(
               graphtile->GetName(transit_route->op_by_onestop_id_offset()));
         }
 
         // Set operator_name if requested
-        if (controller(kEdgeTransitRouteInfoOperatorName) && transit_route->op_by_name_offset()) {
+        if (controller(Attribute::kEdgeTransitRouteInfoOperatorName) &&
+            transit_route->op_by_name_offset()) {
           transit_route_info->set_operator_name(
               graphtile->GetName(transit_route->op_by_name_offset()));
         }
 
         // Set operator_url if requested
-        if (controller(kEdgeTransitRouteInfoOperatorUrl) && transit_route->op_by_website_offset()) {
+        if (controller(Attribute::kEdgeTransitRouteInfoOperatorUrl) &&
+            transit_route->op_by_website_offset()) {
           transit_route_info->set_operator_url(
               graphtile->GetName(transit_route->op_by_website_offset()));
         }
@@ -1363,6 +1418,28 @@ void AccumulateRecostingInfoForward(const valhalla::Options& options,
     return;
   }
 
+  // build all the costings up front so the path is walked only once for all of them
+  sif::CostFactory factory;
+  std::vector<sif::cost_ptr_t> costings;
+  std::vector<const sif::DynamicCost*> costing_ptrs;
+  for (const auto& recosting : options.recostings()) {
+    costings.push_back(factory.Create(recosting));
+    costing_ptrs.push_back(costings.back().get());
+  }
+
+  // every node gets a recost per costing, no elapsed time yet at the start of the leg
+  const int first = leg.node(0).recosts_size();
+  for (auto& node : *leg.mutable_node()) {
+    for (size_t i = 0; i < costings.size(); ++i) {
+      node.mutable_recosts()->Add();
+    }
+  }
+  for (size_t i = 0; i < costings.size(); ++i) {
+    auto* recost = leg.mutable_node(0)->mutable_recosts(first + i);
+    recost->mutable_elapsed_cost()->set_seconds(0);
+    recost->mutable_elapsed_cost()->set_cost(0);
+  }
+
   // setup a callback for the recosting to get each edge
   auto in_itr = leg.node().begin();
   sif::EdgeCallback edge_cb = [&in_itr]() -> baldr::GraphId {
@@ -1371,47 +1448,38 @@ void AccumulateRecostingInfoForward(const valhalla::Options& options,
     return edge_id;
   };
 
-  // setup a callback for the recosting to tell us about the new label each made
-  auto out_itr = leg.mutable_node()->begin();
-  sif::LabelCallback label_cb = [&out_itr](const sif::EdgeLabel& label) -> void {
+  // setup a callback for the recosting to tell us about the new label each costing made
+  std::vector<int> out_idx(costings.size(), 0);
+  sif::CostingLabelCallback label_cb = [&](size_t i, const sif::EdgeLabel& label) -> void {
     // get the turn cost at this node
-    out_itr->mutable_recosts()->rbegin()->mutable_transition_cost()->set_seconds(
-        label.transition_cost().secs);
-    out_itr->mutable_recosts()->rbegin()->mutable_transition_cost()->set_cost(
-        label.transition_cost().cost);
+    auto* recost = leg.mutable_node(out_idx[i])->mutable_recosts(first + i);
+    recost->mutable_transition_cost()->set_seconds(label.transition_cost().secs);
+    recost->mutable_transition_cost()->set_cost(label.transition_cost().cost);
     // get the elapsed time at the end of this labels edge and hang it on the next node
-    ++out_itr;
-    out_itr->mutable_recosts()->Add()->mutable_elapsed_cost()->set_seconds(label.cost().secs);
-    out_itr->mutable_recosts()->rbegin()->mutable_elapsed_cost()->set_cost(label.cost().cost);
+    recost = leg.mutable_node(++out_idx[i])->mutable_recosts(first + i);
+    recost->mutable_elapsed_cost()->set_seconds(label.cost().secs);
+    recost->mutable_elapsed_cost()->set_cost(label.cost().cost);
   };
 
-  // do each recosting
-  sif::CostFactory factory;
-  for (const auto& recosting : options.recostings()) {
-    // get the costing
-    auto costing = factory.Create(recosting);
-    // reset to the beginning of the route
-    in_itr = leg.node().begin();
-    out_itr = leg.mutable_node()->begin();
-    // no elapsed time yet at the start of the leg
-    out_itr->mutable_recosts()->Add()->mutable_elapsed_cost()->set_seconds(0);
-    out_itr->mutable_recosts()->rbegin()->mutable_elapsed_cost()->set_cost(0);
-    // do the recosting for this costing
-    try {
-      sif::recost_forward(reader, *costing, edge_cb, label_cb, src_pct, tgt_pct, time_info,
-                          invariant);
-      // no turn cost at the end of the leg
-      out_itr->mutable_recosts()->rbegin()->mutable_transition_cost()->set_seconds(0);
-      out_itr->mutable_recosts()->rbegin()->mutable_transition_cost()->set_cost(0);
-    } // couldnt be recosted (difference in access for example) so we fill it with nulls to show this
-    catch (...) {
-      int should_have = leg.node(0).recosts_size();
-      for (auto& node : *leg.mutable_node()) {
-        if (node.recosts_size() == should_have) {
-          node.mutable_recosts()->RemoveLast();
-        }
-        node.mutable_recosts()->Add();
-      }
+  // do all the recostings at once
+  std::vector<bool> allowed;
+  try {
+    allowed = sif::recost_forward(reader, costing_ptrs, edge_cb, label_cb, src_pct, tgt_pct,
+                                  time_info, invariant);
+  } // the path itself is broken so none of them could be recosted
+  catch (...) { allowed.assign(costings.size(), false); }
+
+  for (size_t i = 0; i < costings.size(); ++i) {
+    // no turn cost at the end of the leg
+    if (allowed[i]) {
+      auto* recost = leg.mutable_node(out_idx[i])->mutable_recosts(first + i);
+      recost->mutable_transition_cost()->set_seconds(0);
+      recost->mutable_transition_cost()->set_cost(0);
+      continue;
+    }
+    // couldnt be recosted (difference in access for example) so we fill it with nulls to show this
+    for (auto& node : *leg.mutable_node()) {
+      node.mutable_recosts(first + i)->Clear();
     }
   }
 }
@@ -1421,6 +1489,43 @@ void AccumulateRecostingInfoForward(const valhalla::Options& options,
 namespace valhalla {
 namespace thor {
 
+TripLegBuildPlan::TripLegBuildPlan(const valhalla::Options& options,
+                                   const AttributesController& controller) {
+  // only the route summary of the json format is returned, no maneuvers are built
+  summary_only = options.directions_type() == DirectionsType::none &&
+                 options.format() == Options::json && !options.linear_references() &&
+                 (options.action() == Options::route || options.action() == Options::trace_route ||
+                  options.action() == Options::optimized_route);
+  const bool guidance = !summary_only;
+
+  names = guidance && controller(Attribute::kEdgeNames);
+  tagged_values = guidance && controller(Attribute::kEdgeTaggedValues);
+  signs = guidance && (controller(Attribute::kEdgeSignExitNumber) ||
+                       controller(Attribute::kEdgeSignExitBranch) ||
+                       controller(Attribute::kEdgeSignExitToward) ||
+                       controller(Attribute::kEdgeSignExitName) ||
+                       controller(Attribute::kEdgeSignGuideBranch) ||
+                       controller(Attribute::kEdgeSignGuideToward) ||
+                       controller(Attribute::kEdgeSignGuidanceViewJunction) ||
+                       controller(Attribute::kEdgeSignGuidanceViewSignboard));
+  junction_names = guidance && controller(Attribute::kEdgeSignJunctionName);
+  turn_lanes = guidance;
+  lane_connectivity = guidance && controller(Attribute::kEdgeLaneConnectivity);
+  landmarks = guidance && controller(Attribute::kEdgeLandmarks);
+  begin_heading = guidance && controller(Attribute::kEdgeBeginHeading);
+  end_heading = guidance && controller(Attribute::kEdgeEndHeading);
+  intersecting_edges = guidance;
+  admin_index = guidance && controller(Attribute::kNodeAdminIndex);
+  incidents = controller(Attribute::kIncidents);
+
+  shape_attributes = controller.category_attribute_enabled(kShapeAttributesCategory);
+  shape_time = controller(Attribute::kShapeAttributesTime);
+  shape_length = controller(Attribute::kShapeAttributesLength);
+  shape_speed = controller(Attribute::kShapeAttributesSpeed);
+  shape_speed_limit = controller(Attribute::kShapeAttributesSpeedLimit);
+  shape_closure = controller(Attribute::kShapeAttributesClosure);
+}
+
 void TripLegBuilder::Build(
     const valhalla::Options& options,
     const AttributesController& controller,
@@ -1443,6 +1548,9 @@ void TripLegBuilder::Build(
   // Remember what algorithms were used to create this leg
   *trip_path.mutable_algorithms() = {algorithms.begin(), algorithms.end()};
 
+  // Work out once what of the leg gets read
+  const TripLegBuildPlan plan(options, controller);
+
   // Set origin, any through locations, and destination. Origin and
   // destination are assumed to be breaks.
   CopyLocations(trip_path, origin, intermediates, dest, path_begin, path_end);
@@ -1527,8 +1635,7 @@ void TripLegBuilder::Build(
   }
 
   // Structures to process admins
-  std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher> admin_info_map;
-  std::vector<AdminInfo> admin_info_list;
+  AdminTable admin_table;
 
   // Iterate through path
   uint32_t prior_opp_local_index = -1;
@@ -1570,7 +1677,7 @@ void TripLegBuilder::Build(
     }
     const NodeInfo* node = start_tile->node(startnode);
 
-    if (osmchangeset == 0 && controller(kOsmChangeset)) {
+    if (osmchangeset == 0 && controller(Attribute::kOsmChangeset)) {
       osmchangeset = start_tile->header()->dataset_id();
     }
 
@@ -1586,18 +1693,18 @@ void TripLegBuilder::Build(
     // Add a node to the trip path and set its attributes.
     TripLeg_Node* trip_node = trip_path.add_node();
 
-    if (controller(kNodeType)) {
+    if (controller(Attribute::kNodeType)) {
       trip_node->set_type(GetTripLegNodeType(node->type()));
     }
 
     if (node->intersection() == IntersectionType::kFork) {
-      if (controller(kNodeFork)) {
+      if (controller(Attribute::kNodeFork)) {
         trip_node->set_fork(true);
       }
     }
 
     // Assign the elapsed time from the start of the leg
-    if (controller(kNodeElapsedTime)) {
+    if (controller(Attribute::kNodeElapsedTime)) {
       if (edge_itr == path_begin) {
         trip_node->mutable_cost()->mutable_elapsed_cost()->set_seconds(0);
         trip_node->mutable_cost()->mutable_elapsed_cost()->set_cost(0);
@@ -1610,19 +1717,19 @@ void TripLegBuilder::Build(
     }
 
     // Assign the admin index
-    if (controller(kNodeAdminIndex)) {
+    if (plan.admin_index) {
       trip_node->set_admin_index(
-          GetAdminIndex(start_tile->admininfo(node->admin_index()), admin_info_map, admin_info_list));
+          admin_table.index(start_tile, node->admin_index()));
     }
 
-    if (controller(kNodeTimeZone)) {
+    if (controller(Attribute::kNodeTimeZone)) {
       auto tz = DateTime::get_tz_db().from_index(node->timezone());
       if (tz) {
         trip_node->set_time_zone(tz->name());
       }
     }
 
-    if (controller(kNodeTransitionTime)) {
+    if (controller(Attribute::kNodeTransitionTime)) {
       trip_node->mutable_cost()->mutable_transition_cost()->set_seconds(
           edge_itr->transition_cost.secs);
       trip_node->mutable_cost()->mutable_transition_cost()->set_cost(edge_itr->transition_cost.cost);
@@ -1634,7 +1741,7 @@ void TripLegBuilder::Build(
 
     // Add edge to the trip node and set its attributes
     TripLeg_Edge* trip_edge =
-        AddTripEdge(controller, edge, edge_itr->trip_id, multimodal_builder.block_id, mode,
+        AddTripEdge(controller, plan, edge, edge_itr->trip_id, multimodal_builder.block_id, mode,
                     travel_type, costing, directededge, node->drive_on_right(), trip_node, graphtile,
                     time_info, startnode.id(), node->named_intersection(), start_tile,
                     edge_itr->restriction_index, edge_itr->elapsed_cost.secs);
@@ -1751,7 +1858,7 @@ void TripLegBuilder::Build(
     }
 
     // Set length if requested. Convert to km
-    if (controller(kEdgeLength)) {
+    if (controller(Attribute::kEdgeLength)) {
       float km =
           std::max(directededge->length() * kKmPerMeter * (trim_end_pct - trim_start_pct), 0.0f);
       trip_edge->set_length_km(km);
@@ -1763,35 +1870,38 @@ void TripLegBuilder::Build(
       edge_seconds -= std::prev(edge_itr)->elapsed_cost.secs;
 
     // Set shape attributes, sending incidents enables them in the pbf
-    auto incidents = controller(kIncidents) ? graphreader.GetIncidents(edge_itr->edgeid, graphtile)
-                                            : valhalla::baldr::IncidentResult{};
+    auto incidents = plan.incidents ? graphreader.GetIncidents(edge_itr->edgeid, graphtile)
+                                    : valhalla::baldr::IncidentResult{};
 
     graph_tile_ptr end_node_tile = graphtile;
     graphreader.GetGraphTile(directededge->endnode(), end_node_tile);
-    SetShapeAttributes(controller, graphtile, end_node_tile, directededge, trip_shape, begin_index,
+    SetShapeAttributes(plan, graphtile, end_node_tile, directededge, trip_shape, begin_index,
                        trip_path, trim_start_pct, trim_end_pct, edge_seconds,
                        costing->flow_mask() & kCurrentFlowMask, incidents);
 
     // Set begin shape index if requested
-    if (controller(kEdgeBeginShapeIndex)) {
+    if (controller(Attribute::kEdgeBeginShapeIndex)) {
       trip_edge->set_begin_shape_index(begin_index);
     }
 
     // Set end shape index if requested
-    if (controller(kEdgeEndShapeIndex)) {
+    if (controller(Attribute::kEdgeEndShapeIndex)) {
       trip_edge->set_end_shape_index(trip_shape.size() - 1);
     }
 
     // Set begin and end heading if requested. Uses trip_shape so
     // must be done after the edge's shape has been added.
-    SetHeadings(trip_edge, controller, directededge, trip_shape, begin_index);
+    SetHeadings(trip_edge, plan, directededge, trip_shape, begin_index);
 
     // Add landmarks in the directededge to the trip leg
-    AddLandmarks(edgeinfo, trip_edge, controller, directededge, trip_shape, begin_index);
+    if (plan.landmarks) {
+      AddLandmarks(edgeinfo, trip_edge, directededge, trip_shape, begin_index,
+                   graphreader.landmark_store());
+    }
 
     // Add the intersecting edges at the node. Skip it if the node was an inner node (excluding start
     // node and end node) of a shortcut that was recovered.
-    if (startnode.Is_Valid() && !edge_itr->start_node_is_recovered) {
+    if (plan.intersecting_edges && startnode.Is_Valid() && !edge_itr->start_node_is_recovered) {
       AddIntersectingEdges(controller, start_tile, node, directededge, prev_de, prior_opp_local_index,
                            graphreader, trip_node);
     }
@@ -1818,26 +1928,24 @@ void TripLegBuilder::Build(
 
   // Add the last node
   auto* node = trip_path.add_node();
-  if (controller(kNodeAdminIndex)) {
+  if (plan.admin_index) {
     auto last_tile = graphreader.GetGraphTile(startnode);
     if (last_tile == nullptr) {
       throw tile_gone_error_t("TripLegBuilder::Build failed", startnode);
     }
-    node->set_admin_index(
-        GetAdminIndex(last_tile->admininfo(last_tile->node(startnode)->admin_index()), admin_info_map,
-                      admin_info_list));
+    node->set_admin_index(admin_table.index(last_tile, last_tile->node(startnode)->admin_index()));
   }
-  if (controller(kNodeElapsedTime)) {
+  if (controller(Attribute::kNodeElapsedTime)) {
     node->mutable_cost()->mutable_elapsed_cost()->set_seconds(std::prev(path_end)->elapsed_cost.secs);
     node->mutable_cost()->mutable_elapsed_cost()->set_cost(std::prev(path_end)->elapsed_cost.cost);
   }
 
-  if (controller(kNodeTransitionTime)) {
+  if (controller(Attribute::kNodeTransitionTime)) {
     node->mutable_cost()->mutable_transition_cost()->set_seconds(0);
     node->mutable_cost()->mutable_transition_cost()->set_cost(0);
   }
 
-  if (controller(kShapeAttributesClosure)) {
+  if (plan.shape_closure) {
     // Set the end shape index if we're ending on a closure as the last index is
     // not processed in SetShapeAttributes above
     valhalla::TripLeg_Closure* closure = fetch_last_closure_annotation(trip_path);
@@ -1847,17 +1955,27 @@ void TripLegBuilder::Build(
   }
 
   // Assign the admins
-  AssignAdmins(controller, trip_path, admin_info_list);
+  if (!plan.summary_only) {
+    AssignAdmins(controller, trip_path, admin_table.admins());
+  }
 
   // Set the bounding box of the shape
   SetBoundingBox(trip_path, trip_shape);
 
-  // Set shape if requested
-  if (controller(kShape)) {
+  // Set shape if requested, along with the shape generalized for each requested zoom level
+  if (controller(Attribute::kShape)) {
     trip_path.set_shape(encode<std::vector<PointLL>>(trip_shape));
+    std::vector<PointLL> generalized;
+    for (const auto zoom : options.shape_zooms()) {
+      generalized.assign(trip_shape.begin(), trip_shape.end());
+      Polyline2<PointLL>::Generalize(generalized, kGeneralizeTolerances[zoom]);
+      auto* zoom_shape = trip_path.add_zoom_shapes();
+      zoom_shape->set_zoom(zoom);
+      zoom_shape->set_shape(encode(generalized));
+    }
   }
 
-  if (osmchangeset != 0 && controller(kOsmChangeset)) {
+  if (osmchangeset != 0 && controller(Attribute::kOsmChangeset)) {
     trip_path.set_osm_changeset(osmchangeset);
   }
 
@@ -106,20 +106,21 @@ private:
 
       if (transit_station) {
         // Set onstop_id if requested
-        if (controller(kNodeTransitStationInfoOnestopId) && transit_station->one_stop_offset()) {
+        if (controller(Attribute::kNodeTransitStationInfoOnestopId) &&
+            transit_station->one_stop_offset()) {
           transit_station_info->set_onestop_id(
               graphtile->GetName(transit_station->one_stop_offset()));
         }
 
         // Set name if requested
-        if (controller(kNodeTransitStationInfoName) && transit_station->name_offset()) {
+        if (controller(Attribute::kNodeTransitStationInfoName) && transit_station->name_offset()) {
           transit_station_info->set_name(graphtile->GetName(transit_station->name_offset()));
         }
 
         // Set latitude and longitude
         LatLng* stop_ll = transit_station_info->mutable_ll();
         // Set transit stop lat/lon if requested
-        if (controller(kNodeTransitStationInfoLatLon)) {
+        if (controller(Attribute::kNodeTransitStationInfoLatLon)) {
           PointLL ll = node->latlng(start_tile->header()->base_ll());
           stop_ll->set_lat(ll.lat());
           stop_ll->set_lng(ll.lng());
@@ -134,19 +135,20 @@ private:
 
       if (transit_egress) {
         // Set onstop_id if requested
-        if (controller(kNodeTransitEgressInfoOnestopId) && transit_egress->one_stop_offset()) {
+        if (controller(Attribute::kNodeTransitEgressInfoOnestopId) &&
+            transit_egress->one_stop_offset()) {
           transit_egress_info->set_onestop_id(graphtile->GetName(transit_egress->one_stop_offset()));
         }
 
         // Set name if requested
-        if (controller(kNodeTransitEgressInfoName) && transit_egress->name_offset()) {
+        if (controller(Attribute::kNodeTransitEgressInfoName) && transit_egress->name_offset()) {
           transit_egress_info->set_name(graphtile->GetName(transit_egress->name_offset()));
         }
 
         // Set latitude and longitude
         LatLng* stop_ll = transit_egress_info->mutable_ll();
         // Set transit stop lat/lon if requested
-        if (controller(kNodeTransitEgressInfoLatLon)) {
+        if (controller(Attribute::kNodeTransitEgressInfoLatLon)) {
           PointLL ll = node->latlng(start_tile->header()->base_ll());
           stop_ll->set_lat(ll.lat());
           stop_ll->set_lng(ll.lng());
@@ -177,18 +179,18 @@ private:
       // Set type
       if (directededge->use() == Use::kRail) {
         // Set node transit info type if requested
-        if (controller(kNodeTransitPlatformInfoType)) {
+        if (controller(Attribute::kNodeTransitPlatformInfoType)) {
           transit_platform_info->set_type(TransitPlatformInfo_Type_kStation);
         }
         prev_transit_node_type = TransitPlatformInfo_Type_kStation;
       } else if (directededge->use() == Use::kPlatformConnection) {
         // Set node transit info type if requested
-        if (controller(kNodeTransitPlatformInfoType)) {
+        if (controller(Attribute::kNodeTransitPlatformInfoType)) {
           transit_platform_info->set_type(prev_transit_node_type);
         }
       } else { // bus logic
         // Set node transit info type if requested
-        if (controller(kNodeTransitPlatformInfoType)) {
+        if (controller(Attribute::kNodeTransitPlatformInfoType)) {
           transit_platform_info->set_type(TransitPlatformInfo_Type_kStop);
         }
         prev_transit_node_type = TransitPlatformInfo_Type_kStop;
@@ -196,13 +198,14 @@ private:
 
       if (transit_platform) {
         // Set onstop_id if requested
-        if (controller(kNodeTransitPlatformInfoOnestopId) && transit_platform->one_stop_offset()) {
+        if (controller(Attribute::kNodeTransitPlatformInfoOnestopId) &&
+            transit_platform->one_stop_offset()) {
           transit_platform_info->set_onestop_id(
               graphtile->GetName(transit_platform->one_stop_offset()));
         }
 
         // Set name if requested
-        if (controller(kNodeTransitPlatformInfoName) && transit_platform->name_offset()) {
+        if (controller(Attribute::kNodeTransitPlatformInfoName) && transit_platform->name_offset()) {
           transit_platform_info->set_name(graphtile->GetName(transit_platform->name_offset()));
         }
 
@@ -216,14 +219,15 @@ private:
             const TransitStop* transit_station = endtile->GetTransitStop(nodeinfo2->stop_index());
 
             // Set station onstop_id if requested
-            if (controller(kNodeTransitPlatformInfoStationOnestopId) &&
+            if (controller(Attribute::kNodeTransitPlatformInfoStationOnestopId) &&
                 transit_station->one_stop_offset()) {
               transit_platform_info->set_station_onestop_id(
                   endtile->GetName(transit_station->one_stop_offset()));
             }
 
             // Set station name if requested
-            if (controller(kNodeTransitPlatformInfoStationName) && transit_station->name_offset()) {
+            if (controller(Attribute::kNodeTransitPlatformInfoStationName) &&
+                transit_station->name_offset()) {
               transit_platform_info->set_station_name(
                   endtile->GetName(transit_station->name_offset()));
             }
@@ -236,7 +240,7 @@ private:
         // Set latitude and longitude
         LatLng* stop_ll = transit_platform_info->mutable_ll();
         // Set transit stop lat/lon if requested
-        if (controller(kNodeTransitPlatformInfoLatLon)) {
+        if (controller(Attribute::kNodeTransitPlatformInfoLatLon)) {
           PointLL ll = node->latlng(start_tile->header()->base_ll());
           stop_ll->set_lat(ll.lat());
           stop_ll->set_lng(ll.lng());
@@ -245,7 +249,7 @@ private:
 
       // Set the arrival time at this node (based on schedule from last trip
       // departure) if requested
-      if (controller(kNodeTransitPlatformInfoArrivalDateTime) && !arrival_time.empty()) {
+      if (controller(Attribute::kNodeTransitPlatformInfoArrivalDateTime) && !arrival_time.empty()) {
         transit_platform_info->set_arrival_date_time(arrival_time);
       }
 
@@ -268,7 +272,7 @@ private:
               days_from_creation >
                   graphtile->GetTransitSchedule(transit_departure->schedule_index())->end_day()) {
             // Set assumed schedule if requested
-            if (controller(kNodeTransitPlatformInfoAssumedSchedule)) {
+            if (controller(Attribute::kNodeTransitPlatformInfoAssumedSchedule)) {
               transit_platform_info->set_assumed_schedule(true);
             }
             assumed_schedule = true;
@@ -297,7 +301,7 @@ private:
           }
 
           // Set departure time from this transit stop if requested
-          if (controller(kNodeTransitPlatformInfoDepartureDateTime)) {
+          if (controller(Attribute::kNodeTransitPlatformInfoDepartureDateTime)) {
             transit_platform_info->set_departure_date_time(dt);
           }
 
@@ -327,7 +331,7 @@ private:
         block_id = 0;
 
         // Set assumed schedule if requested
-        if (controller(kNodeTransitPlatformInfoAssumedSchedule) && assumed_schedule) {
+        if (controller(Attribute::kNodeTransitPlatformInfoAssumedSchedule) && assumed_schedule) {
           transit_platform_info->set_assumed_schedule(true);
         }
         assumed_schedule = false;
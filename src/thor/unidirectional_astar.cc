@@ -19,6 +19,7 @@ UnidirectionalAStar<expansion_direction, FORWARD>::UnidirectionalAStar(
     : PathAlgorithm(config.get<uint32_t>("max_reserved_labels_count_astar",
                                          kInitialEdgeLabelCountAstar),
                     config.get<bool>("clear_reserved_memory", false)),
+      labels_budget_(config, max_reserved_labels_count_, clear_reserved_memory_),
       max_label_count_(std::numeric_limits<uint32_t>::max()), mode_(travel_mode_t::kDrive),
       travel_type_(0), access_mode_{kAutoAccess} {
 }
@@ -36,12 +37,7 @@ template <const ExpansionType expansion_direction, const bool FORWARD>
 void UnidirectionalAStar<expansion_direction, FORWARD>::Clear() {
   // Clear the edge labels and destination list. Reset the adjacency list
   // and clear edge status.
-  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-  if (edgelabels_.size() > reservation) {
-    edgelabels_.resize(reservation);
-    edgelabels_.shrink_to_fit();
-  }
-  edgelabels_.clear();
+  labels_budget_.clear(edgelabels_);
   destinations_.clear();
   adjacencylist_.clear();
   edgestatus_.clear();
@@ -209,6 +205,10 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
   uint8_t flow_sources;
   auto edge_cost = FORWARD ? costing_->EdgeCost(meta.edge, tile, time_info, flow_sources)
                            : costing_->EdgeCost(opp_edge, endtile, time_info, flow_sources);
+  if (!(FORWARD ? costing_->ApplyEdgeTable(meta.edge, meta.edge_id, edge_cost)
+                : costing_->ApplyEdgeTable(opp_edge, opp_edge_id, edge_cost))) {
+    return false;
+  }
 
   sif::Cost transition_cost =
       FORWARD ? costing_->TransitionCost(meta.edge, nodeinfo, pred)
@@ -252,7 +252,8 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
 
     auto dist = 0.0f;
     auto sortcost =
-        cost.cost + (dest_path_edge ? astarheuristic_.Get(0) : astarheuristic_.Get(endpoint, dist));
+        cost.cost + (dest_path_edge ? astarheuristic_.Get(0)
+                                    : astarheuristic_.Get(endpoint, meta.edge->endnode(), dist));
 
     auto path_distance =
         static_cast<uint32_t>(pred.path_distance() + meta.edge->length() * percent_traversed + .5f);
@@ -360,6 +361,8 @@ inline bool UnidirectionalAStar<expansion_direction, FORWARD>::ExpandInner(
 // Form the path from the adjacency list in the _forward_ direction
 template <>
 std::vector<PathInfo> UnidirectionalAStar<ExpansionType::forward>::FormPath(const uint32_t dest) {
+  search_timer_.phase(SearchPhase::path);
+
   // Metrics to track
   LOG_DEBUG("path_cost::" + std::to_string(edgelabels_[dest].cost().cost));
   LOG_DEBUG("path_iterations::" + std::to_string(edgelabels_.size()));
@@ -387,6 +390,8 @@ std::vector<PathInfo> UnidirectionalAStar<ExpansionType::forward>::FormPath(cons
 // Form the path from the adjacency list in the _reverse_ direction
 template <>
 std::vector<PathInfo> UnidirectionalAStar<ExpansionType::reverse>::FormPath(const uint32_t dest) {
+  search_timer_.phase(SearchPhase::path);
+
   // Metrics to track
   LOG_DEBUG("path_cost::" + std::to_string(edgelabels_[dest].cost().cost));
   LOG_DEBUG("path_iterations::" + std::to_string(edgelabels_.size()));
@@ -446,6 +451,7 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   travel_type_ = costing_->travel_type();
   access_mode_ = costing_->access_mode();
+  auto timing = search_timer_.start(stats_, graphreader);
 
   if (!FORWARD) {
     // date_time must be set on the destination. Log an error but allow routes for now.
@@ -478,6 +484,7 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
 
   // Update hierarchy limits
   ModifyHierarchyLimits(mindist, density);
+  search_timer_.phase(SearchPhase::expansion);
 
   // Find shortest path
   uint32_t nc = 0; // Count of iterations with no convergence
@@ -505,6 +512,7 @@ std::vector<std::vector<PathInfo>> UnidirectionalAStar<expansion_direction, FORW
       LOG_ERROR("Route failed after iterations = " + std::to_string(edgelabels_.size()));
       return {};
     }
+    ++stats_.settled;
 
     // Copy the EdgeLabel for use in costing. Check if this is a destination
     // edge and potentially complete the path.
@@ -577,6 +585,7 @@ void UnidirectionalAStar<expansion_direction, FORWARD>::Init(const midgard::Poin
                                                              const midgard::PointLL& destll) {
 
   float mincost = 0;
+  astarheuristic_.SetAltBounds(alt_bounds_.get());
   if (FORWARD) {
     astarheuristic_.Init(destll, costing_->AStarCostFactor());
     mincost = astarheuristic_.Get(origll);
@@ -839,6 +848,12 @@ UnidirectionalAStar<expansion_direction, FORWARD>::SetDestination(GraphReader& g
     // NOTE: we store by edgeid, not opposing edgeid!
     destinations_.emplace(edgeid, edge);
 
+    // The search reaches the destination through the begin node of the edge and the origin
+    // through the end node
+    graph_tile_ptr node_tile = tile;
+    astarheuristic_.AddTarget(FORWARD ? graphreader.edge_startnode(edgeid, node_tile)
+                                      : tile->directededge(edgeid)->endnode());
+
     // Edge score (penalty) is handled within GetPath. Do not add score here.
 
     // Get the tile relative density
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <sstream>
@@ -50,6 +51,8 @@ constexpr float kDistanceScale = 10.f;
 
 #ifdef HAVE_HTTP
 std::string serialize_to_pbf(Api& request) {
+  // odin tells how long it waited for the request from when it left
+  stamp_hand_off(request);
   std::string buf;
   if (!request.SerializeToString(&buf)) {
     LOG_ERROR("Failed serializing to pbf in Thor::Worker");
@@ -67,14 +70,21 @@ namespace thor {
 thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
     : service_worker_t(config), mode(valhalla::sif::TravelMode::kPedestrian),
-      bidir_astar(config.get_child("thor")), bss_astar(config.get_child("thor")),
-      multi_modal_astar(config.get_child("thor")), timedep_forward(config.get_child("thor")),
-      timedep_reverse(config.get_child("thor")), costmatrix_(config.get_child("thor")),
+      bidir_astar(config.get_child("thor"), config.get_child("mjolnir")),
+      bss_astar(config.get_child("thor")),
+      multi_modal_astar(config.get_child("thor")), raptor(config.get_child("thor")),
+      timedep_forward(config.get_child("thor")),
+      timedep_reverse(config.get_child("thor")), contraction_path(config.get_child("thor")),
+      costmatrix_(config.get_child("thor"), config.get_child("mjolnir")),
       time_distance_matrix_(config.get_child("thor")),
-      time_distance_bss_matrix_(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
+      time_distance_bss_matrix_(config.get_child("thor")),
+      bucket_matrix_(config.get_child("thor"), config.get_child("mjolnir")),
+      optimizer_(config.get_child("thor")),
+      isochrone_gen(config.get_child("thor")),
       reader(graph_reader ? graph_reader
                           : std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
-      matcher_factory(config, reader), controller{} {
+      matcher_factory(config, reader), controller{},
+      centroid_gen(config.get_child("thor"), config.get_child("mjolnir")) {
 
   // Select the matrix algorithm based on the conf file (defaults to
   // select_optimal if not present)
@@ -103,6 +113,66 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
 
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+  bidirectional_time_dependent = config.get<bool>("thor.bidirectional_time_dependent", false);
+  matrix_time_limit = std::chrono::milliseconds(config.get<uint32_t>("thor.matrix_time_limit", 0));
+
+  // keep the expensive requests from taking all the workers from the cheap ones
+  heavy_cost = config.get<double>("thor.admission.heavy_cost", 100000);
+  max_heavy_requests = config.get<size_t>("thor.admission.max_heavy_requests", 0);
+
+  // Load the precomputed contraction overlays if we are allowed to use them
+  if (config.get<bool>("thor.use_contraction", false)) {
+    contraction_path.Load(config, *reader);
+  }
+
+  // And the bike share station tables
+  if (config.get<bool>("thor.use_bss_tables", false)) {
+    auto bss_tables = LoadBssTables(*reader);
+    bss_astar.set_bss_tables(bss_tables);
+    time_distance_bss_matrix_.set_bss_tables(bss_tables);
+  }
+
+  // Bound the cost to the destination of the A* searches with the landmark distances, if any
+  auto alt_bounds = baldr::AltBounds::get(config.get<std::string>("mjolnir.alt_bounds", ""));
+  bidir_astar.set_alt_bounds(alt_bounds);
+  timedep_forward.set_alt_bounds(alt_bounds);
+  timedep_reverse.set_alt_bounds(alt_bounds);
+
+  // Routes between nodes the components tell apart are not searched for
+  if (config.get<bool>("thor.use_connectivity", true)) {
+    connectivity_map = baldr::connectivity_map_t::load(reader);
+  }
+
+  // Route searches of the regions in this table use its tuned hierarchy limits
+  hierarchy_limits_table =
+      sif::HierarchyLimitsTable::get(config.get<std::string>("thor.hierarchy_limits_file", ""));
+
+  // Requests split their work onto the threads of the process
+  thread_pool = thread_pool_t::shared(config);
+
+  // The isochrones of a batch are expanded on this many threads, the extra ones share a tile cache
+  auto batch_threads = config.get<uint32_t>("thor.isochrone_batch_threads", 1);
+  if (batch_threads > 1) {
+    auto batch_config = config.get_child("mjolnir");
+    batch_config.put("global_synchronized_cache", true);
+    for (uint32_t i = 1; i < batch_threads; ++i) {
+      isochrone_batch_workers.emplace_back(
+          new isochrone_batch_worker_t(config.get_child("thor"), batch_config));
+    }
+  }
+
+  // The legs of routes are searched on this many threads, each extra one has a worker of its own
+  auto leg_threads = config.get<uint32_t>("thor.leg_threads", 1);
+  if (leg_threads > 1) {
+    auto leg_config = config;
+    leg_config.put("thor.leg_threads", 1);
+    leg_config.put("thor.use_connectivity", false);
+    leg_config.erase("statsd");
+    for (uint32_t i = 1; i < leg_threads; ++i) {
+      leg_workers.emplace_back(new thor_worker_t(leg_config));
+      leg_workers.back()->connectivity_map = connectivity_map;
+    }
+  }
 
   // signal that the worker started successfully
   started();
@@ -111,6 +181,21 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
 thor_worker_t::~thor_worker_t() {
 }
 
+midgard::Finally<std::function<void()>> thor_worker_t::admit(const Api& request) const {
+  if (max_heavy_requests == 0 || request.info().cost() < heavy_cost) {
+    return midgard::Finally<std::function<void()>>([]() {});
+  }
+
+  // shared by all the workers of the process, the expensive requests over the limit are turned away
+  // right away, waiting for a turn would hold on to a worker that could answer cheap ones
+  static std::atomic<size_t> heavy_requests(0);
+  if (heavy_requests.fetch_add(1) >= max_heavy_requests) {
+    --heavy_requests;
+    throw valhalla_exception_t{403};
+  }
+  return midgard::Finally<std::function<void()>>([]() { --heavy_requests; });
+}
+
 #ifdef HAVE_HTTP
 prime_server::worker_t::result_t
 thor_worker_t::work(const std::list<zmq::message_t>& job,
@@ -120,25 +205,33 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
   // get request info and make sure to record any metrics before we are done
   auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
   LOG_INFO("Got Thor Request " + std::to_string(info.id));
-  Api request;
+  Api& request = request_arena.next();
   prime_server::worker_t::result_t result{true, {}, {}};
   try {
     // crack open the original request
+    const auto received = std::chrono::steady_clock::now();
     bool success = request.ParseFromArray(job.front().data(), job.front().size());
     if (!success) {
       LOG_ERROR("Failed parsing pbf in Thor::Worker");
       throw valhalla_exception_t{401, "Failed parsing pbf in Thor::Worker"};
     }
+    trace_arrival(request, service_name(), received, std::chrono::steady_clock::now());
     const auto& options = request.options();
 
     // Set the interrupt function
     service_worker_t::set_interrupt(&interrupt_function);
 
+    // the expensive requests only get so many of the workers
+    auto admitted = admit(request);
+
     // do request specific processing
     switch (options.action()) {
       case Options::sources_to_targets:
         result = to_response(matrix(request), info, request);
         break;
+      case Options::route_batch:
+        result = to_response(route_batch(request), info, request);
+        break;
       case Options::optimized_route: {
         optimized_route(request);
         result.messages.emplace_back(serialize_to_pbf(request));
@@ -147,6 +240,9 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
       case Options::isochrone:
         result = to_response(isochrones(request), info, request);
         break;
+      case Options::isochrone_batch:
+        result = to_response(isochrone_batch(request), info, request);
+        break;
       case Options::route: {
         route(request);
         result.messages.emplace_back(serialize_to_pbf(request));
@@ -185,9 +281,11 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
     result = serialize_error({499, std::string(e.what())}, info, request);
   }
 
-  // keep track of the metrics if the request is going back to the client
-  if (!result.intermediate)
+  // keep track of the metrics and the trace if the request is going back to the client
+  if (!result.intermediate) {
     enqueue_statistics(request);
+    export_trace(request);
+  }
 
   return result;
 }
@@ -305,23 +403,62 @@ void thor_worker_t::log_admin(const valhalla::TripLeg& trip_path) {
   }
 }
 
+void thor_worker_t::add_search_stats(Api& request,
+                                     const char* algorithm,
+                                     const thor::SearchStats& stats) const {
+  const std::string stage = service_name() + ".search";
+  add_count(request, stage, "settled", stats.settled);
+  add_count(request, stage, "reached", stats.reached);
+  add_count(request, stage, "label_bytes", stats.label_bytes);
+  add_timing(request, stage, "setup", stats.ms(SearchPhase::setup));
+  add_timing(request, stage, "expansion", stats.ms(SearchPhase::expansion));
+  add_timing(request, stage, "path", stats.ms(SearchPhase::path));
+
+  LOG_INFO(std::string("search::") + algorithm + " settled=" + std::to_string(stats.settled) +
+           " reached=" + std::to_string(stats.reached) +
+           " label_bytes=" + std::to_string(stats.label_bytes) +
+           " tiles_fetched=" + std::to_string(stats.tiles_fetched) +
+           " tile_cache_misses=" + std::to_string(stats.tile_cache_misses) +
+           " deferred=" + std::to_string(stats.deferred) +
+           " setup_ms=" + std::to_string(stats.ms(SearchPhase::setup)) +
+           " expansion_ms=" + std::to_string(stats.ms(SearchPhase::expansion)) +
+           " path_ms=" + std::to_string(stats.ms(SearchPhase::path)));
+
+  if (!request.options().verbose()) {
+    return;
+  }
+  auto* effort = request.mutable_info()->add_search_effort();
+  effort->set_algorithm(algorithm);
+  effort->set_settled(stats.settled);
+  effort->set_reached(stats.reached);
+  effort->set_label_bytes(stats.label_bytes);
+  effort->set_tiles_fetched(stats.tiles_fetched);
+  effort->set_tile_cache_misses(stats.tile_cache_misses);
+  effort->set_setup_ms(stats.ms(SearchPhase::setup));
+  effort->set_expansion_ms(stats.ms(SearchPhase::expansion));
+  effort->set_path_ms(stats.ms(SearchPhase::path));
+}
+
 void thor_worker_t::cleanup() {
   service_worker_t::cleanup();
   bidir_astar.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
+  raptor.Clear();
   bss_astar.Clear();
   trace.clear();
   costmatrix_.clear();
   time_distance_matrix_.clear();
   time_distance_bss_matrix_.clear();
+  bucket_matrix_.clear();
   isochrone_gen.Clear();
   centroid_gen.Clear();
   matcher_factory.ClearFullCache();
   if (reader->OverCommitted()) {
     reader->Trim();
-  }
+  }  // requests in flight are done with the tiles, time to move to a newly published tile set
+  reader->SwitchTileSet();
 }
 
 void thor_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
@@ -0,0 +1,144 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+
+thread_pool_t::thread_pool_t(size_t thread_count, const boost::property_tree::ptree& reader_config)
+    : shutdown_(false) {
+  // the readers share one cache so the pool holds the tiles of a region once
+  auto config = reader_config;
+  config.put("global_synchronized_cache", true);
+  for (size_t i = 0; i < thread_count; ++i) {
+    readers_.emplace_back(new GraphReader(config));
+  }
+  for (auto& reader : readers_) {
+    threads_.emplace_back(&thread_pool_t::work, this, std::ref(*reader));
+  }
+}
+
+thread_pool_t::~thread_pool_t() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<thread_pool_t> thread_pool_t::shared(const boost::property_tree::ptree& config) {
+  // the first worker of the process to ask makes it, the others share it
+  static std::mutex lock;
+  static std::weak_ptr<thread_pool_t> instance;
+  std::lock_guard<std::mutex> _(lock);
+  auto pool = instance.lock();
+  if (!pool) {
+    auto threads = config.get<size_t>("thread_pool.threads", 0);
+    if (threads == 0) {
+      threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    pool = std::make_shared<thread_pool_t>(threads, config.get_child("mjolnir"));
+    instance = pool;
+  }
+  return pool;
+}
+
+void thread_pool_t::run(size_t count,
+                        const task_t& task,
+                        GraphReader& reader,
+                        const std::function<void()>* interrupt,
+                        size_t max_threads) {
+  if (count == 0) {
+    return;
+  }
+
+  job_t job;
+  job.task = &task;
+  job.count = count;
+  job.max_threads = max_threads == 0 ? threads_.size() + 1 : max_threads;
+  job.next.store(0, std::memory_order_relaxed);
+  job.cancelled.store(false, std::memory_order_relaxed);
+  job.slots = 1;
+  job.running = 0;
+
+  // a single task or a job for one thread isn't worth waking anyone up for
+  const bool shared = count > 1 && job.max_threads > 1 && !threads_.empty();
+  if (shared) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back(&job);
+    }
+    work_.notify_all();
+  }
+
+  // the calling thread does its share and then waits for the threads still on its tasks
+  drain(job, 0, reader, interrupt);
+  if (shared) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.remove(&job);
+    done_.wait(lock, [&job] { return job.running == 0; });
+  }
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+void thread_pool_t::drain(job_t& job,
+                          size_t slot,
+                          GraphReader& reader,
+                          const std::function<void()>* interrupt) {
+  try {
+    for (size_t i = job.next.fetch_add(1); i < job.count; i = job.next.fetch_add(1)) {
+      if (job.cancelled.load(std::memory_order_relaxed)) {
+        break;
+      }
+      if (interrupt) {
+        (*interrupt)();
+      }
+      (*job.task)(i, slot, reader);
+    }
+  } catch (...) {
+    // keep the first error and stop handing out tasks
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!job.error) {
+      job.error = std::current_exception();
+    }
+    job.cancelled.store(true, std::memory_order_relaxed);
+  }
+}
+
+thread_pool_t::job_t* thread_pool_t::open_job() {
+  for (auto* job : jobs_) {
+    if (job->slots < job->max_threads && !job->cancelled.load(std::memory_order_relaxed) &&
+        job->next.load(std::memory_order_relaxed) < job->count) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void thread_pool_t::work(GraphReader& reader) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    job_t* job = nullptr;
+    work_.wait(lock, [this, &job] { return shutdown_ || (job = open_job()) != nullptr; });
+    if (shutdown_) {
+      return;
+    }
+
+    // take a slot of the job and work on it without holding the lock
+    const size_t slot = job->slots++;
+    ++job->running;
+    lock.unlock();
+    drain(*job, slot, reader, nullptr);
+    lock.lock();
+    --job->running;
+    done_.notify_all();
+  }
+}
+
+} // namespace valhalla
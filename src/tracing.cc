@@ -0,0 +1,244 @@
+#include "tracing.h"
+#include "baldr/rapidjson_utils.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using namespace valhalla;
+
+uint64_t random_id() {
+  thread_local std::mt19937_64 generator(std::random_device{}());
+  uint64_t id;
+  while ((id = generator()) == 0) {
+  }
+  return id;
+}
+
+std::string hex(const uint64_t id) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(id));
+  return buffer;
+}
+
+uint64_t unix_ns(const std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// the spans of every stage are on the system clock so the ones of different processes and hosts
+// line up, the steady clock of the timings only moves them back from now
+uint64_t unix_ns(const std::chrono::steady_clock::time_point time) {
+  return unix_ns(std::chrono::system_clock::now()) -
+         std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                              time)
+             .count();
+}
+
+void add_span(Api& api,
+              const std::string& process,
+              const std::string& name,
+              const uint64_t start_ns,
+              const uint64_t end_ns,
+              const TraceSpan::Kind kind) {
+  auto* span = api.mutable_info()->add_trace();
+  span->set_name(name);
+  span->set_process(process);
+  span->set_thread(std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xffffffff);
+  span->set_start_ns(start_ns);
+  span->set_duration_ns(end_ns > start_ns ? end_ns - start_ns : 0);
+  span->set_kind(kind);
+  span->set_span_id(random_id());
+}
+
+class chrome_trace_sink_t : public trace_sink_t {
+public:
+  explicit chrome_trace_sink_t(const boost::property_tree::ptree& config)
+      : dir_(config.get<std::string>("httpd.service.trace_dir", "")) {
+    if (dir_.empty()) {
+      throw std::runtime_error("The chrome trace sink needs httpd.service.trace_dir");
+    }
+  }
+  void consume(const Api& api) override {
+    write_trace(api, dir_);
+  }
+
+private:
+  std::string dir_;
+};
+
+// every span as one json line with the fields of an OpenTelemetry span
+class log_trace_sink_t : public trace_sink_t {
+public:
+  void consume(const Api& api) override {
+    const auto& info = api.info();
+    for (const auto& span : info.trace()) {
+      rapidjson::writer_wrapper_t writer(512);
+      writer.start_object();
+      writer("traceId", info.trace_id());
+      writer("spanId", hex(span.span_id()));
+      writer("parentSpanId", info.parent_span_id());
+      writer("name", span.name());
+      writer("kind", TraceSpan_Kind_Name(span.kind()));
+      writer("service", span.process());
+      writer("startTimeUnixNano", span.start_ns());
+      writer("endTimeUnixNano", span.start_ns() + span.duration_ns());
+      writer.end_object();
+      LOG_INFO(std::string("trace::") + writer.get_buffer());
+    }
+  }
+};
+
+std::mutex sinks_lock;
+std::unordered_map<std::string, trace_sink_t::factory_t>& sinks() {
+  static std::unordered_map<std::string, trace_sink_t::factory_t> factories{
+      {"chrome",
+       [](const boost::property_tree::ptree& config) {
+         return std::make_shared<chrome_trace_sink_t>(config);
+       }},
+      {"log",
+       [](const boost::property_tree::ptree&) { return std::make_shared<log_trace_sink_t>(); }},
+  };
+  return factories;
+}
+
+} // namespace
+
+namespace valhalla {
+
+void add_trace_span(Api& api,
+                    const std::string& process,
+                    const std::string& name,
+                    std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end,
+                    TraceSpan::Kind kind) {
+  if (!api.has_info() || api.info().trace_id().empty()) {
+    return;
+  }
+  const auto start_ns = unix_ns(start);
+  add_span(api, process, name, start_ns,
+           start_ns + std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+           kind);
+}
+
+void sample_trace(Api& api, double rate) {
+  if (rate <= 0 || !api.info().trace_id().empty()) {
+    return;
+  }
+  thread_local std::mt19937_64 generator(std::random_device{}());
+  if (std::uniform_real_distribution<double>(0, 1)(generator) < rate) {
+    api.mutable_info()->set_trace_id(hex(random_id()) + hex(random_id()));
+  }
+}
+
+void stamp_hand_off(Api& api) {
+  if (api.has_info() && !api.info().trace_id().empty()) {
+    api.mutable_info()->set_handoff_unix_ns(unix_ns(std::chrono::system_clock::now()));
+  }
+}
+
+void trace_arrival(Api& api,
+                   const std::string& stage,
+                   std::chrono::steady_clock::time_point received,
+                   std::chrono::steady_clock::time_point parsed) {
+  if (!api.has_info() || api.info().trace_id().empty()) {
+    return;
+  }
+  const auto received_ns = unix_ns(received);
+  if (api.info().handoff_unix_ns()) {
+    add_span(api, stage, stage + ".queue", api.info().handoff_unix_ns(), received_ns,
+             TraceSpan::queue);
+    api.mutable_info()->clear_handoff_unix_ns();
+  }
+  add_trace_span(api, stage, stage + ".deserialize", received, parsed, TraceSpan::serialize);
+}
+
+bool write_trace(const Api& api, const std::string& dir) {
+  if (dir.empty() || !api.has_info() || api.info().trace_id().empty() ||
+      api.info().trace().empty()) {
+    return false;
+  }
+
+  // complete events in microseconds since the first span, one process per service
+  const auto& spans = api.info().trace();
+  const auto origin =
+      std::min_element(spans.begin(), spans.end(), [](const auto& a, const auto& b) {
+        return a.start_ns() < b.start_ns();
+      })->start_ns();
+  std::vector<std::string> processes;
+  rapidjson::writer_wrapper_t writer(4096);
+  writer.set_precision(3);
+  writer.start_object();
+  writer.start_array("traceEvents");
+  for (const auto& span : spans) {
+    auto process = std::find(processes.begin(), processes.end(), span.process());
+    if (process == processes.end()) {
+      process = processes.insert(process, span.process());
+    }
+    writer.start_object();
+    writer("name", span.name());
+    writer("cat", TraceSpan_Kind_Name(span.kind()));
+    writer("ph", "X");
+    writer("ts", (span.start_ns() - origin) / 1e3);
+    writer("dur", span.duration_ns() / 1e3);
+    writer("pid", static_cast<uint64_t>(process - processes.begin() + 1));
+    writer("tid", span.thread());
+    writer.end_object();
+  }
+  for (size_t i = 0; i < processes.size(); ++i) {
+    writer.start_object();
+    writer("name", "process_name");
+    writer("ph", "M");
+    writer("pid", static_cast<uint64_t>(i + 1));
+    writer.start_object("args");
+    writer("name", processes[i]);
+    writer.end_object();
+    writer.end_object();
+  }
+  writer.end_array();
+  writer("displayTimeUnit", "ms");
+  writer("trace_id", api.info().trace_id());
+  writer.end_object();
+
+  filesystem::path file(dir);
+  file /= api.info().trace_id() + ".trace.json";
+  std::ofstream out(file.string());
+  out << writer.get_buffer();
+  if (!out) {
+    LOG_WARN("Couldn't write the trace " + file.string());
+    return false;
+  }
+  LOG_INFO("Wrote the trace " + file.string());
+  return true;
+}
+
+void trace_sink_t::register_sink(const std::string& name, factory_t factory) {
+  std::lock_guard<std::mutex> _(sinks_lock);
+  sinks()[name] = std::move(factory);
+}
+
+std::shared_ptr<trace_sink_t> trace_sink_t::make(const boost::property_tree::ptree& config) {
+  const auto dir = config.get<std::string>("httpd.service.trace_dir", "");
+  const auto name =
+      config.get<std::string>("httpd.service.trace_sink", dir.empty() ? "" : "chrome");
+  if (name.empty() || name == "none") {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> _(sinks_lock);
+  auto sink = sinks().find(name);
+  if (sink == sinks().end()) {
+    throw std::runtime_error("Unknown trace sink " + name);
+  }
+  return sink->second(config);
+}
+
+} // namespace valhalla
@@ -1,8 +1,17 @@
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
 #include "tyr/actor.h"
 #include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
+#include "meili/batch_matcher.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
+#include "midgard/logging.h"
+#include "thread_pool.h"
 #include "tyr/serializers.h"
 
 using namespace valhalla;
@@ -15,12 +24,14 @@ namespace tyr {
 
 struct actor_t::pimpl_t {
   pimpl_t(const boost::property_tree::ptree& config)
-      : reader(new baldr::GraphReader(config.get_child("mjolnir"))), loki_worker(config, reader),
-        thor_worker(config, reader), odin_worker(config) {
+      : config(config), reader(new baldr::GraphReader(config.get_child("mjolnir"))),
+        loki_worker(config, reader), thor_worker(config, reader), odin_worker(config),
+        request_arena(config), thread_pool(thread_pool_t::shared(config)) {
   }
   pimpl_t(const boost::property_tree::ptree& config, baldr::GraphReader& graph_reader)
-      : reader(&graph_reader, [](baldr::GraphReader*) {}), loki_worker(config, reader),
-        thor_worker(config, reader), odin_worker(config) {
+      : config(config), reader(&graph_reader, [](baldr::GraphReader*) {}),
+        loki_worker(config, reader), thor_worker(config, reader), odin_worker(config),
+        request_arena(config), thread_pool(thread_pool_t::shared(config)) {
   }
   void set_interrupts(const std::function<void()>* interrupt_function) {
     loki_worker.set_interrupt(interrupt_function);
@@ -31,11 +42,21 @@ struct actor_t::pimpl_t {
     loki_worker.cleanup();
     thor_worker.cleanup();
     odin_worker.cleanup();
+    request_arena.reset();
   }
+  boost::property_tree::ptree config;
   std::shared_ptr<baldr::GraphReader> reader;
   loki::loki_worker_t loki_worker;
   thor::thor_worker_t thor_worker;
   odin_worker_t odin_worker;
+  // the Api of the requests the caller doesn't want a copy of
+  request_arena_t request_arena;
+  // created on the first batch, its threads have their own readers
+  std::unique_ptr<meili::BatchMatcher> batch_matcher;
+  // the threads of the process the requests of a batch are worked on with
+  std::shared_ptr<thread_pool_t> thread_pool;
+  // created on the first batch of requests, one per thread
+  std::vector<std::unique_ptr<actor_t>> batch_actors;
 };
 
 actor_t::actor_t(const boost::property_tree::ptree& config, bool auto_cleanup)
@@ -52,47 +73,93 @@ void actor_t::cleanup() {
 }
 
 std::string actor_t::act(Api& api, const std::function<void()>* interrupt) {
-  if (api.options().action() == Options::no_action)
-    throw valhalla_exception_t{106};
+  return dispatch(api.options().action(), "", interrupt, &api);
+}
 
-  switch (api.options().action()) {
+std::string actor_t::dispatch(Options::Action action,
+                              const std::string& request_str,
+                              const std::function<void()>* interrupt,
+                              Api* api) {
+  switch (action) {
     case Options::route:
-      return route("", interrupt, &api);
+      return route(request_str, interrupt, api);
     case Options::locate:
-      return locate("", interrupt, &api);
+      return locate(request_str, interrupt, api);
     case Options::sources_to_targets:
-      return matrix("", interrupt, &api);
+      return matrix(request_str, interrupt, api);
     case Options::optimized_route:
-      return optimized_route("", interrupt, &api);
+      return optimized_route(request_str, interrupt, api);
     case Options::isochrone:
-      return isochrone("", interrupt, &api);
+      return isochrone(request_str, interrupt, api);
     case Options::trace_route:
-      return trace_route("", interrupt, &api);
+      return trace_route(request_str, interrupt, api);
     case Options::trace_attributes:
-      return trace_attributes("", interrupt, &api);
+      return trace_attributes(request_str, interrupt, api);
     case Options::height:
-      return height("", interrupt, &api);
+      return height(request_str, interrupt, api);
     case Options::transit_available:
-      return transit_available("", interrupt, &api);
+      return transit_available(request_str, interrupt, api);
     case Options::expansion:
-      return expansion("", interrupt, &api);
+      return expansion(request_str, interrupt, api);
     case Options::centroid:
-      return centroid("", interrupt, &api);
+      return centroid(request_str, interrupt, api);
     case Options::status:
-      return status("", interrupt, &api);
+      return status(request_str, interrupt, api);
+    case Options::route_batch:
+      return route_batch(request_str, interrupt, api);
+    case Options::isochrone_batch:
+      return isochrone_batch(request_str, interrupt, api);
+    case Options::tile:
+      return tile(request_str, interrupt, api);
     default:
       throw valhalla_exception_t{106};
   }
 }
 
+std::vector<std::string> actor_t::batch(Options::Action action,
+                                         const std::vector<std::string>& requests,
+                                         size_t threads,
+                                         const std::function<void()>* interrupt) {
+  if (threads == 0) {
+    threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  threads = std::min(threads, std::max<size_t>(requests.size(), 1));
+
+  // the actors of the threads are kept for the next batch, all of their readers share one cache
+  if (pimpl->batch_actors.size() < threads) {
+    auto config = pimpl->config;
+    config.put("mjolnir.global_synchronized_cache", true);
+    while (pimpl->batch_actors.size() < threads) {
+      pimpl->batch_actors.emplace_back(new actor_t(config));
+    }
+  }
+
+  // every thread of the pool takes the next request until there are none left
+  std::vector<std::string> responses(requests.size());
+  const thread_pool_t::task_t work = [&](const size_t i, const size_t slot, baldr::GraphReader&) {
+    auto& actor = *pimpl->batch_actors[slot];
+    Api& api = actor.pimpl->request_arena.next();
+    try {
+      responses[i] = actor.dispatch(action, requests[i], interrupt, &api);
+    } catch (const valhalla_exception_t& e) {
+      responses[i] = serialize_error(e, api);
+    } catch (const std::exception& e) {
+      responses[i] = serialize_error({499, std::string(e.what())}, api);
+    }
+    // clean up after every request, the ones that threw included
+    actor.cleanup();
+  };
+  pimpl->thread_pool->run(requests.size(), work, *pimpl->reader, nullptr, threads);
+  return responses;
+}
+
 std::string
 actor_t::route(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::route, *api);
@@ -113,10 +180,9 @@ std::string
 actor_t::locate(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::locate, *api);
@@ -133,17 +199,38 @@ std::string
 actor_t::matrix(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::sources_to_targets, *api);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.matrix(*api);
   // compute the matrix
-  auto bytes = pimpl->thor_worker.matrix(*api);
+  auto bytes = tyr::joinChunks(pimpl->thor_worker.matrix(*api));
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  return bytes;
+}
+
+std::string actor_t::route_batch(const std::string& request_str,
+                                 const std::function<void()>* interrupt,
+                                 Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // if the caller doesn't want a copy we'll use one on the arena
+  if (!api) {
+    api = &pimpl->request_arena.next();
+  }
+  // parse the request
+  ParseApi(request_str, Options::route_batch, *api);
+  // check the request and locate all the locations in the graph at once
+  pimpl->loki_worker.route_batch(*api);
+  // route each pair reusing the same costing and path algorithms
+  auto bytes = pimpl->thor_worker.route_batch(*api);
   // if they want you do to do the cleanup automatically
   if (auto_cleanup) {
     cleanup();
@@ -156,10 +243,9 @@ std::string actor_t::optimized_route(const std::string& request_str,
                                      Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::optimized_route, *api);
@@ -180,10 +266,9 @@ std::string
 actor_t::isochrone(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::isochrone, *api);
@@ -198,15 +283,36 @@ actor_t::isochrone(const std::string& request_str, const std::function<void()>*
   return json;
 }
 
+std::string actor_t::isochrone_batch(const std::string& request_str,
+                                     const std::function<void()>* interrupt,
+                                     Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // if the caller doesn't want a copy we'll use one on the arena
+  if (!api) {
+    api = &pimpl->request_arena.next();
+  }
+  // parse the request
+  ParseApi(request_str, Options::isochrone_batch, *api);
+  // check the request and locate all the locations in the graph at once
+  pimpl->loki_worker.isochrone_batch(*api);
+  // expand from each location sharing the costing and the tile cache
+  auto bytes = pimpl->thor_worker.isochrone_batch(*api);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  return bytes;
+}
+
 std::string actor_t::trace_route(const std::string& request_str,
                                  const std::function<void()>* interrupt,
                                  Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::trace_route, *api);
@@ -228,10 +334,9 @@ std::string actor_t::trace_attributes(const std::string& request_str,
                                       Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::trace_attributes, *api);
@@ -246,14 +351,25 @@ std::string actor_t::trace_attributes(const std::string& request_str,
   return json;
 }
 
+std::string actor_t::trace_batch(const std::string& traces,
+                                 const std::function<void()>* interrupt) {
+  if (!pimpl->batch_matcher) {
+    pimpl->batch_matcher.reset(new meili::BatchMatcher(pimpl->config));
+  }
+  // match all the traces and write their records in order
+  std::istringstream input(traces);
+  std::ostringstream records;
+  pimpl->batch_matcher->Match(input, records, meili::BatchMatcher::Format::kJson, interrupt);
+  return records.str();
+}
+
 std::string
 actor_t::height(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::height, *api);
@@ -271,10 +387,9 @@ std::string actor_t::transit_available(const std::string& request_str,
                                        Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::transit_available, *api);
@@ -287,14 +402,32 @@ std::string actor_t::transit_available(const std::string& request_str,
   return json;
 }
 
+std::string
+actor_t::tile(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // if the caller doesn't want a copy we'll use one on the arena
+  if (!api) {
+    api = &pimpl->request_arena.next();
+  }
+  // parse the request
+  ParseApi(request_str, Options::tile, *api);
+  // encode the network within the tile
+  auto bytes = pimpl->loki_worker.tile(*api);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  return bytes;
+}
+
 std::string
 actor_t::expansion(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::expansion, *api);
@@ -307,22 +440,21 @@ actor_t::expansion(const std::string& request_str, const std::function<void()>*
     pimpl->loki_worker.matrix(*api);
   }
   // route between the locations in the graph to find the best path
-  auto json = pimpl->thor_worker.expansion(*api);
+  auto bytes = tyr::joinChunks(pimpl->thor_worker.expansion(*api));
   // if they want you do to do the cleanup automatically
   if (auto_cleanup) {
     cleanup();
   }
-  return json;
+  return bytes;
 }
 
 std::string
 actor_t::centroid(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::centroid, *api);
@@ -343,10 +475,9 @@ std::string
 actor_t::status(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
   pimpl->set_interrupts(interrupt);
-  // if the caller doesn't want a copy we'll use this dummy
-  Api dummy;
+  // if the caller doesn't want a copy we'll use one on the arena
   if (!api) {
-    api = &dummy;
+    api = &pimpl->request_arena.next();
   }
   // parse the request
   ParseApi(request_str, Options::status, *api);
@@ -365,5 +496,74 @@ actor_t::status(const std::string& request_str, const std::function<void()>* int
   return json;
 }
 
+#ifdef HAVE_HTTP
+void run_service(const boost::property_tree::ptree& config) {
+  // gracefully shutdown when asked via SIGTERM
+  prime_server::quiesce(config.get<unsigned int>("httpd.service.drain_seconds", 28),
+                        config.get<unsigned int>("httpd.service.shutting_seconds", 1));
+
+  // gets requests from the http server
+  auto upstream_endpoint = config.get<std::string>("loki.service.proxy") + "_out";
+  // nothing goes further down the pipeline but the worker needs somewhere to send it
+  auto downstream_endpoint = config.get<std::string>("thor.service.proxy") + "_in";
+  // the responses go straight back to the server
+  auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
+  auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
+
+  // the same actions are supported as when loki is its own stage
+  std::unordered_set<Options::Action> actions;
+  std::string action_str;
+  Options::Action action;
+  for (const auto& kv : config.get_child("loki.actions")) {
+    auto path = kv.second.get_value<std::string>();
+    if (!Options_Action_Enum_Parse(path, &action)) {
+      throw std::runtime_error("Action not supported " + path);
+    }
+    actions.insert(action);
+    action_str.append("'/" + path + "' ");
+  }
+
+  actor_t actor(config);
+  request_arena_t request_arena(config);
+  const auto trace_sink = trace_sink_t::make(config);
+  const auto trace_sample_rate = config.get<double>("httpd.service.trace_sample_rate", 0);
+  auto work = [&](const std::list<zmq::message_t>& job, void* request_info,
+                  const std::function<void()>& interrupt) {
+    auto& info = *static_cast<prime_server::http_request_info_t*>(request_info);
+    LOG_INFO("Got Request " + std::to_string(info.id));
+    Api& request = request_arena.next();
+    try {
+      auto http_request =
+          prime_server::http_request_t::from_string(static_cast<const char*>(job.front().data()),
+                                                    job.front().size());
+      ParseApi(http_request, request);
+      sample_trace(request, trace_sample_rate);
+      if (actions.find(request.options().action()) == actions.cend()) {
+        throw valhalla_exception_t{106, action_str};
+      }
+      // loki, thor and odin all do their part on this one Api
+      auto response = actor.act(request, &interrupt);
+      auto result = to_response(response, info, request);
+      if (trace_sink && !request.info().trace_id().empty()) {
+        trace_sink->consume(request);
+      }
+      return result;
+    } catch (const valhalla_exception_t& e) {
+      LOG_WARN("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+      return serialize_error(e, info, request);
+    } catch (const std::exception& e) {
+      LOG_ERROR("400::" + std::string(e.what()) + " request_id=" + std::to_string(info.id));
+      return serialize_error({199, std::string(e.what())}, info, request);
+    }
+  };
+
+  // listen for requests
+  zmq::context_t context;
+  prime_server::worker_t worker(context, upstream_endpoint, downstream_endpoint, loopback_endpoint,
+                                interrupt_endpoint, work, std::bind(&actor_t::cleanup, &actor));
+  worker.work();
+}
+#endif
+
 } // namespace tyr
 } // namespace valhalla
@@ -1,3 +1,5 @@
+#include <cmath>
+#include <limits>
 #include <sstream>
 
 #include "baldr/json.h"
@@ -57,6 +59,64 @@ json::ArrayPtr serialize_shape(const google::protobuf::RepeatedPtrField<valhalla
   return array;
 }
 
+/*
+The postings of a profile in little endian:
+
+  char[4]  "VHGT"
+  uint8    version, currently 1
+  uint8    flags, 1 when everything after the header is zlib compressed, 2 with ranges, 4 with
+           the resampled shape
+  uint8    height precision
+  uint8    reserved
+  uint32   number of postings
+  the heights as int32 in units of 10^-precision meters, kNoHeight where there is no data, the
+  ranges as uint32 meters if asked for and, if the shape was resampled, the latitude and longitude
+  of each posting as int32 in units of 10^-6 degrees.
+*/
+constexpr int32_t kNoHeight = std::numeric_limits<int32_t>::min();
+
+std::string serialize_binary(const Api& request,
+                             const std::vector<double>& heights,
+                             const std::vector<double>& ranges) {
+  using valhalla::tyr::write_le;
+  const auto& options = request.options();
+  const uint32_t precision = options.height_precision();
+  const double scale = std::pow(10.0, precision);
+  const bool with_shape = options.has_resample_distance_case();
+
+  std::string postings;
+  postings.reserve(heights.size() * sizeof(int32_t) * (1 + !ranges.empty() + 2 * with_shape));
+  for (const auto height : heights) {
+    write_le(postings, height == skadi::get_no_data_value()
+                           ? kNoHeight
+                           : static_cast<int32_t>(std::llround(height * scale)));
+  }
+  for (const auto range : ranges) {
+    write_le(postings, static_cast<uint32_t>(std::llround(range)));
+  }
+  if (with_shape) {
+    for (const auto& p : options.shape()) {
+      write_le(postings, static_cast<int32_t>(std::llround(p.ll().lat() * 1e6)));
+      write_le(postings, static_cast<int32_t>(std::llround(p.ll().lng() * 1e6)));
+    }
+  }
+
+  const bool compress = options.compress();
+  std::string bytes("VHGT", 4);
+  write_le(bytes, static_cast<uint8_t>(1));
+  write_le(bytes, static_cast<uint8_t>((compress ? 1 : 0) | (ranges.empty() ? 0 : 2) |
+                                       (with_shape ? 4 : 0)));
+  write_le(bytes, static_cast<uint8_t>(precision));
+  write_le(bytes, static_cast<uint8_t>(0));
+  write_le(bytes, static_cast<uint32_t>(heights.size()));
+  if (compress) {
+    bytes += valhalla::tyr::compressZlib(postings);
+  } else {
+    bytes += postings;
+  }
+  return bytes;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -71,6 +131,11 @@ namespace tyr {
 std::string serializeHeight(const Api& request,
                             const std::vector<double>& heights,
                             const std::vector<double>& ranges) {
+  // just the numbers for clients that draw many profiles
+  if (request.options().format() == Options::binary) {
+    return serialize_binary(request, heights, ranges);
+  }
+
   auto json = json::map({});
 
   // get the precision to use for returned heights
@@ -4,15 +4,21 @@
 #include "midgard/pointll.h"
 #include "tyr/serializers.h"
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <stdexcept>
 #include <utility>
 
 using namespace valhalla::baldr::json;
 
 namespace {
 using rgba_t = std::tuple<float, float, float>;
-}
+
+// the raster stores seconds and decameters
+constexpr float kRasterSecondsPerStep = 1.f;
+constexpr float kRasterMetersPerStep = 10.f;
+} // namespace
 
 namespace valhalla {
 namespace tyr {
@@ -137,10 +143,147 @@ std::string serializeIsochrones(const Api& request,
     feature_collection->emplace("warnings", serializeWarnings(request));
   }
 
+  // what the search for the isochrone cost, verbose requests only
+  if (request.info().search_effort_size() > 0) {
+    feature_collection->emplace("search_effort", serializeSearchEffort(request));
+  }
+
   std::stringstream ss;
   ss << *feature_collection;
 
   return ss.str();
 }
+std::string
+serializeIsochroneRaster(const Api& request,
+                         const midgard::GriddedData<2>& grid,
+                         const std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals) {
+  // the largest contour of each metric, the grid tracks minutes and kilometers
+  std::vector<std::pair<size_t, float>> metrics;
+  for (const auto& interval : intervals) {
+    auto metric = std::find_if(metrics.begin(), metrics.end(), [&interval](const auto& m) {
+      return m.first == std::get<0>(interval);
+    });
+    if (metric == metrics.end()) {
+      metrics.emplace_back(std::get<0>(interval), std::get<1>(interval));
+    } else {
+      metric->second = std::max(metric->second, std::get<1>(interval));
+    }
+  }
+  std::sort(metrics.begin(), metrics.end());
+
+  // crop to the cells that any metric reaches within its largest contour
+  const int32_t columns = grid.ncolumns();
+  const int32_t rows = grid.nrows();
+  int32_t min_col = columns, max_col = -1, min_row = rows, max_row = -1;
+  for (int32_t row = 0; row < rows; ++row) {
+    for (int32_t col = 0; col < columns; ++col) {
+      const auto& value = grid.DataAt(grid.TileId(col, row));
+      for (const auto& metric : metrics) {
+        if (value[metric.first] <= metric.second) {
+          min_col = std::min(min_col, col);
+          max_col = std::max(max_col, col);
+          min_row = std::min(min_row, row);
+          max_row = std::max(max_row, row);
+          break;
+        }
+      }
+    }
+  }
+  const uint32_t width = max_col < min_col ? 0 : max_col - min_col + 1;
+  const uint32_t height = max_row < min_row ? 0 : max_row - min_row + 1;
+  const auto west = grid.TileBounds().minx() + std::max(min_col, 0) * grid.TileSize();
+  const auto south = grid.TileBounds().miny() + std::max(min_row, 0) * grid.TileSize();
+
+  // quantize the values
+  std::string cells;
+  cells.reserve(metrics.size() * width * height * sizeof(uint16_t));
+  for (const auto& metric : metrics) {
+    const float scale = metric.first == 0 ? midgard::kSecPerMinute / kRasterSecondsPerStep
+                                          : midgard::kMetersPerKm / kRasterMetersPerStep;
+    for (uint32_t row = 0; row < height; ++row) {
+      for (uint32_t col = 0; col < width; ++col) {
+        const auto value = grid.DataAt(grid.TileId(min_col + col, min_row + row))[metric.first];
+        uint16_t step = kRasterUnreached;
+        if (value <= metric.second) {
+          step = static_cast<uint16_t>(
+              std::min(std::round(value * scale), static_cast<float>(kRasterUnreached - 1)));
+        }
+        write_le(cells, step);
+      }
+    }
+  }
+
+  std::string raster("VISO", 4);
+  write_le(raster, static_cast<uint8_t>(1));
+  write_le(raster, static_cast<uint8_t>(metrics.size()));
+  write_le(raster, static_cast<uint16_t>(0));
+  write_le(raster, width);
+  write_le(raster, height);
+  write_le(raster, static_cast<double>(west));
+  write_le(raster, static_cast<double>(south));
+  write_le(raster, static_cast<double>(grid.TileSize()));
+  for (const auto& metric : metrics) {
+    write_le(raster, static_cast<uint8_t>(metric.first));
+    raster.append(3, '\0');
+    write_le(raster, metric.first == 0 ? kRasterSecondsPerStep : kRasterMetersPerStep);
+  }
+  raster += compressZlib(cells);
+  return raster;
+}
+
+/*
+isochrone batch output is newline delimited json, one line per location in request order:
+
+{"index":0,"contours":[{"metric":"time","contour":10,"area":12.345,"population":6789}],
+ "isochrone":{"type":"FeatureCollection",...}}
+{"index":1,"contours":null}
+
+population is only there if population cells were part of the request and isochrone is left out
+for metrics only requests. the id and any warnings of the request are added to the first line
+*/
+std::string
+serializeIsochroneBatch(const Api& request,
+                        const std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
+                        const std::vector<std::vector<std::pair<double, double>>>& metrics,
+                        const std::vector<std::string>& isochrones) {
+  const auto& options = request.options();
+  const bool population = options.population_size() > 0;
+
+  std::stringstream ss;
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    auto line = map({{"index", static_cast<uint64_t>(i)}});
+    if (metrics[i].empty()) {
+      line->emplace("contours", static_cast<std::nullptr_t>(nullptr));
+    } else {
+      auto contours = array({});
+      for (size_t c = 0; c < intervals.size(); ++c) {
+        auto contour = map({{"metric", std::get<2>(intervals[c])},
+                            {"contour", baldr::json::float_t{std::get<1>(intervals[c])}},
+                            {"area", fixed_t{metrics[i][c].first, 3}}});
+        if (population) {
+          contour->emplace("population", static_cast<uint64_t>(std::round(metrics[i][c].second)));
+        }
+        contours->emplace_back(contour);
+      }
+      line->emplace("contours", contours);
+    }
+
+    if (i == 0) {
+      if (options.has_id_case()) {
+        line->emplace("id", options.id());
+      }
+      if (request.info().warnings_size() >= 1) {
+        line->emplace("warnings", serializeWarnings(request));
+      }
+    }
+
+    if (!isochrones[i].empty()) {
+      line->emplace("isochrone", RawJSON{isochrones[i]});
+    }
+    ss << *line << '\n';
+  }
+  return ss.str();
+}
+
 } // namespace tyr
 } // namespace valhalla
@@ -1,5 +1,6 @@
 #include "baldr/json.h"
 #include "baldr/openlr.h"
+#include "baldr/rapidjson_utils.h"
 #include "tyr/serializers.h"
 #include <cstdint>
 
@@ -63,7 +64,7 @@ json::ArrayPtr serialize_edges(const PathLocation& location, GraphReader& reader
       // they want MOAR!
       if (verbose) {
         // live traffic information
-        const volatile auto& traffic = tile->trafficspeed(directed_edge);
+        const auto traffic = tile->trafficspeed(directed_edge);
         auto live_speed = traffic.json();
 
         // incident information
@@ -176,6 +177,71 @@ json::MapPtr serialize(const midgard::PointLL& ll, const std::string& reason, bo
 
   return m;
 }
+
+const char* side_of_street(const PathLocation::PathEdge& edge) {
+  return edge.sos == PathLocation::LEFT ? "left"
+                                        : (edge.sos == PathLocation::RIGHT ? "right" : "neither");
+}
+
+// only the properties that were asked for, which but for the way id need no more than the
+// correlated edge, so many locations can be checked in bulk
+std::string
+serialize_fields(const Api& request,
+                 const std::vector<baldr::Location>& locations,
+                 const std::unordered_map<baldr::Location, PathLocation>& projections,
+                 GraphReader& reader) {
+  const auto& fields = request.options().locate_fields();
+  rapidjson::writer_wrapper_t writer(locations.size() * 128);
+  graph_tile_ptr tile;
+  writer.start_array();
+  for (const auto& location : locations) {
+    writer.start_object();
+    writer.fixed("input_lat", location.latlng_.lat(), 6);
+    writer.fixed("input_lon", location.latlng_.lng(), 6);
+    auto projection = projections.find(location);
+    if (projection == projections.cend()) {
+      writer("edges", nullptr);
+      writer.end_object();
+      continue;
+    }
+    writer.start_array("edges");
+    for (const auto& edge : projection->second.edges) {
+      writer.start_object();
+      for (const auto field : fields) {
+        switch (field) {
+          case Options::edge_id:
+            writer("edge_id", static_cast<uint64_t>(edge.id.value));
+            break;
+          case Options::percent_along:
+            writer.fixed("percent_along", edge.percent_along, 5);
+            break;
+          case Options::distance:
+            writer.fixed("distance", edge.distance, 1);
+            break;
+          case Options::side_of_street:
+            writer("side_of_street", side_of_street(edge));
+            break;
+          case Options::way_id:
+            // the fixed size part of the edge info has the way id, the names are never read
+            if (reader.GetGraphTile(edge.id, tile)) {
+              writer("way_id", static_cast<uint64_t>(
+                                   tile->edgeinfo(tile->directededge(edge.id)).wayid()));
+            } else {
+              writer("way_id", nullptr);
+            }
+            break;
+          default:
+            break;
+        }
+      }
+      writer.end_object();
+    }
+    writer.end_array();
+    writer.end_object();
+  }
+  writer.end_array();
+  return writer.get_buffer();
+}
 } // namespace
 
 namespace valhalla {
@@ -185,6 +251,10 @@ std::string serializeLocate(const Api& request,
                             const std::vector<baldr::Location>& locations,
                             const std::unordered_map<baldr::Location, PathLocation>& projections,
                             GraphReader& reader) {
+  if (request.options().locate_fields_size() > 0) {
+    return serialize_fields(request, locations, projections, reader);
+  }
+
   auto json = json::array({});
   for (const auto& location : locations) {
     try {
@@ -1,6 +1,10 @@
+#include <algorithm>
 #include <cstdint>
+#include <list>
+#include <sstream>
 
 #include "baldr/json.h"
+#include "baldr/rapidjson_utils.h"
 #include "proto_conversions.h"
 #include "thor/matrix_common.h"
 #include "tyr/serializers.h"
@@ -12,67 +16,112 @@ using namespace valhalla::thor;
 
 namespace {
 
-json::ArrayPtr
-serialize_duration(const valhalla::Matrix& matrix, size_t start_td, const size_t td_count) {
-  auto time = json::array({});
+void serialize_duration(const valhalla::Matrix& matrix,
+                        size_t start_td,
+                        const size_t td_count,
+                        rapidjson::writer_wrapper_t& writer) {
+  writer.start_array();
   for (size_t i = start_td; i < start_td + td_count; ++i) {
     // check to make sure a route was found; if not, return null for time in matrix result
     if (matrix.times()[i] != kMaxCost) {
-      time->emplace_back(static_cast<uint64_t>(matrix.times()[i]));
+      writer(static_cast<uint64_t>(matrix.times()[i]));
     } else {
-      time->emplace_back(static_cast<std::nullptr_t>(nullptr));
+      writer(nullptr);
     }
   }
-  return time;
+  writer.end_array();
 }
 
-json::ArrayPtr serialize_distance(const valhalla::Matrix& matrix,
-                                  size_t start_td,
-                                  const size_t td_count,
-                                  const size_t /* source_index */,
-                                  const size_t /* target_index */,
-                                  double distance_scale) {
-  auto distance = json::array({});
+void serialize_distance(const valhalla::Matrix& matrix,
+                        size_t start_td,
+                        const size_t td_count,
+                        double distance_scale,
+                        rapidjson::writer_wrapper_t& writer) {
+  writer.start_array();
   for (size_t i = start_td; i < start_td + td_count; ++i) {
     // check to make sure a route was found; if not, return null for distance in matrix result
     if (matrix.times()[i] != kMaxCost) {
-      distance->emplace_back(json::fixed_t{matrix.distances()[i] * distance_scale, 3});
+      writer.fixed(matrix.distances()[i] * distance_scale, 3);
     } else {
-      distance->emplace_back(static_cast<std::nullptr_t>(nullptr));
+      writer(nullptr);
     }
   }
-  return distance;
+  writer.end_array();
+}
+
+// The locations whose cells are missing because the matrix ran out of time, if any
+void serialize_incomplete(const valhalla::Matrix& matrix, rapidjson::writer_wrapper_t& writer) {
+  if (matrix.incomplete_sources_size() == 0 && matrix.incomplete_targets_size() == 0) {
+    return;
+  }
+  writer.start_array("incomplete_sources");
+  for (const auto index : matrix.incomplete_sources()) {
+    writer(static_cast<uint64_t>(index));
+  }
+  writer.end_array();
+  writer.start_array("incomplete_targets");
+  for (const auto index : matrix.incomplete_targets()) {
+    writer(static_cast<uint64_t>(index));
+  }
+  writer.end_array();
+}
+
+// Room for the json of a matrix, which is streamed into the buffer instead of allocating a json
+// value for every time and distance first. Large ones are handed on in pieces so the buffer only
+// needs to fit one of them
+size_t reservation(const Api& request) {
+  const auto& options = request.options();
+  return std::min<size_t>(static_cast<size_t>(options.sources_size()) * options.targets_size() *
+                                  (options.verbose() ? 80 : 16) +
+                              4096,
+                          tyr::kResponseChunkSize + 4096);
+}
+
+// Hands the json written so far on as the next piece of the response once there is enough of it
+void flush(rapidjson::writer_wrapper_t& writer, std::list<std::string>& chunks) {
+  if (writer.size() >= tyr::kResponseChunkSize) {
+    chunks.push_back(writer.flush());
+  }
 }
 } // namespace
 
 namespace osrm_serializers {
 
 // Serialize route response in OSRM compatible format.
-std::string serialize(const Api& request) {
-  auto json = json::map({});
-  auto time = json::array({});
-  auto distance = json::array({});
+void serialize(const Api& request, std::list<std::string>& chunks) {
   const auto& options = request.options();
+  rapidjson::writer_wrapper_t writer(reservation(request));
+  writer.start_object();
 
   // If here then the matrix succeeded. Set status code to OK and serialize
   // waypoints (locations).
-  json->emplace("code", std::string("Ok"));
-  json->emplace("sources", osrm::waypoints(options.sources()));
-  json->emplace("destinations", osrm::waypoints(options.targets()));
+  writer("code", "Ok");
+  std::stringstream ss;
+  ss << *osrm::waypoints(options.sources());
+  writer.raw("sources", ss.str());
+  ss.str("");
+  ss << *osrm::waypoints(options.targets());
+  writer.raw("destinations", ss.str());
 
+  writer.start_array("durations");
+  for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
+    serialize_duration(request.matrix(), source_index * options.targets_size(),
+                       options.targets_size(), writer);
+    flush(writer, chunks);
+  }
+  writer.end_array();
+  writer.start_array("distances");
   for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-    time->emplace_back(serialize_duration(request.matrix(), source_index * options.targets_size(),
-                                          options.targets_size()));
-    distance->emplace_back(serialize_distance(request.matrix(), source_index * options.targets_size(),
-                                              options.targets_size(), source_index, 0, 1.0));
+    serialize_distance(request.matrix(), source_index * options.targets_size(),
+                       options.targets_size(), 1.0, writer);
+    flush(writer, chunks);
   }
-  json->emplace("durations", time);
-  json->emplace("distances", distance);
-  json->emplace("algorithm", MatrixAlgoToString(request.matrix().algorithm()));
+  writer.end_array();
+  writer("algorithm", MatrixAlgoToString(request.matrix().algorithm()));
+  serialize_incomplete(request.matrix(), writer);
 
-  std::stringstream ss;
-  ss << *json;
-  return ss.str();
+  writer.end_object();
+  chunks.push_back(writer.flush());
 }
 } // namespace osrm_serializers
 
@@ -83,115 +132,189 @@ valhalla output looks like this:
 
 */
 
-json::ArrayPtr locations(const google::protobuf::RepeatedPtrField<valhalla::Location>& correlated) {
-  auto input_locs = json::array({});
+void locations(const google::protobuf::RepeatedPtrField<valhalla::Location>& correlated,
+               rapidjson::writer_wrapper_t& writer) {
+  writer.start_array();
   for (size_t i = 0; i < correlated.size(); i++) {
-    input_locs->emplace_back(json::map({{"lat", json::fixed_t{correlated.Get(i).ll().lat(), 6}},
-                                        {"lon", json::fixed_t{correlated.Get(i).ll().lng(), 6}}}));
+    writer.start_object();
+    writer.fixed("lat", correlated.Get(i).ll().lat(), 6);
+    writer.fixed("lon", correlated.Get(i).ll().lng(), 6);
+    writer.end_object();
   }
-  return input_locs;
+  writer.end_array();
 }
 
-json::ArrayPtr serialize_row(const valhalla::Matrix& matrix,
-                             size_t start_td,
-                             const size_t td_count,
-                             const size_t source_index,
-                             const size_t target_index,
-                             double distance_scale) {
-  auto row = json::array({});
+void serialize_row(const valhalla::Matrix& matrix,
+                   size_t start_td,
+                   const size_t td_count,
+                   const size_t source_index,
+                   const size_t target_index,
+                   double distance_scale,
+                   rapidjson::writer_wrapper_t& writer) {
+  writer.start_array();
   for (size_t i = start_td; i < start_td + td_count; ++i) {
     // check to make sure a route was found; if not, return null for distance & time in matrix
     // result
-    json::MapPtr map;
     const auto time = matrix.times()[i];
     const auto& date_time = matrix.date_times()[i];
+    writer.start_object();
+    writer("from_index", static_cast<uint64_t>(source_index));
+    writer("to_index", static_cast<uint64_t>(target_index + (i - start_td)));
     if (time != kMaxCost) {
-      map = json::map({{"from_index", static_cast<uint64_t>(source_index)},
-                       {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-                       {"time", static_cast<uint64_t>(time)},
-                       {"distance", json::fixed_t{matrix.distances()[i] * distance_scale, 3}}});
+      writer("time", static_cast<uint64_t>(time));
+      writer.fixed("distance", matrix.distances()[i] * distance_scale, 3);
       if (!date_time.empty()) {
-        map->emplace("date_time", date_time);
+        writer("date_time", date_time);
       }
     } else {
-      map = json::map({{"from_index", static_cast<uint64_t>(source_index)},
-                       {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-                       {"time", static_cast<std::nullptr_t>(nullptr)},
-                       {"distance", static_cast<std::nullptr_t>(nullptr)}});
+      writer("time", nullptr);
+      writer("distance", nullptr);
     }
-    row->emplace_back(map);
+    writer.end_object();
   }
-  return row;
+  writer.end_array();
 }
 
-std::string serialize(const Api& request, double distance_scale) {
-  auto json = json::map({});
+void serialize(const Api& request, double distance_scale, std::list<std::string>& chunks) {
   const auto& options = request.options();
+  rapidjson::writer_wrapper_t writer(reservation(request));
+  writer.start_object();
 
   if (options.verbose()) {
-    json::ArrayPtr matrix = json::array({});
+    writer.start_array("sources_to_targets");
     for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-      matrix->emplace_back(serialize_row(request.matrix(), source_index * options.targets_size(),
-                                         options.targets_size(), source_index, 0, distance_scale));
+      serialize_row(request.matrix(), source_index * options.targets_size(), options.targets_size(),
+                    source_index, 0, distance_scale, writer);
+      flush(writer, chunks);
     }
+    writer.end_array();
 
-    json->emplace("sources_to_targets", matrix);
-
-    json->emplace("targets", json::array({locations(options.targets())}));
-    json->emplace("sources", json::array({locations(options.sources())}));
+    writer.start_array("targets");
+    locations(options.targets(), writer);
+    writer.end_array();
+    writer.start_array("sources");
+    locations(options.sources(), writer);
+    writer.end_array();
   } // slim it down
   else {
-    auto matrix = json::map({});
-    auto time = json::array({});
-    auto distance = json::array({});
-
+    writer.start_object("sources_to_targets");
+    writer.start_array("distances");
     for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
-      time->emplace_back(serialize_duration(request.matrix(), source_index * options.targets_size(),
-                                            options.targets_size()));
-      distance->emplace_back(
-          serialize_distance(request.matrix(), source_index * options.targets_size(),
-                             options.targets_size(), source_index, 0, distance_scale));
+      serialize_distance(request.matrix(), source_index * options.targets_size(),
+                         options.targets_size(), distance_scale, writer);
+      flush(writer, chunks);
     }
-    matrix->emplace("distances", distance);
-    matrix->emplace("durations", time);
-
-    json->emplace("sources_to_targets", matrix);
+    writer.end_array();
+    writer.start_array("durations");
+    for (size_t source_index = 0; source_index < options.sources_size(); ++source_index) {
+      serialize_duration(request.matrix(), source_index * options.targets_size(),
+                         options.targets_size(), writer);
+      flush(writer, chunks);
+    }
+    writer.end_array();
+    writer.end_object();
   }
 
-  json->emplace("units", Options_Units_Enum_Name(options.units()));
-  json->emplace("algorithm", MatrixAlgoToString(request.matrix().algorithm()));
+  writer("units", Options_Units_Enum_Name(options.units()));
+  writer("algorithm", MatrixAlgoToString(request.matrix().algorithm()));
+  serialize_incomplete(request.matrix(), writer);
 
   if (options.has_id_case()) {
-    json->emplace("id", options.id());
+    writer("id", options.id());
   }
 
   // add warnings to json response
   if (request.info().warnings_size() >= 1) {
-    json->emplace("warnings", valhalla::tyr::serializeWarnings(request));
+    valhalla::tyr::serializeWarnings(request, writer);
   }
 
-  std::stringstream ss;
-  ss << *json;
-  return ss.str();
+  // what the searches for the matrix cost, verbose requests only
+  if (request.info().search_effort_size() > 0) {
+    valhalla::tyr::serializeSearchEffort(request, writer);
+  }
+
+  writer.end_object();
+  chunks.push_back(writer.flush());
 }
 } // namespace valhalla_serializers
 
+namespace binary_serializers {
+/*
+The columns of the matrix in little endian:
+
+  char[4]  "VMAT"
+  uint8    version, currently 1
+  uint8    flags, 1 when the columns are zlib compressed
+  uint16   reserved
+  uint32   number of sources
+  uint32   number of targets
+  the row ordered times in seconds as uint32, followed by the row ordered distances in meters as
+  uint32. Both are kBinaryUnreachable when no route was found.
+*/
+std::string serialize(const Api& request) {
+  using valhalla::tyr::compressZlib;
+  using valhalla::tyr::kBinaryUnreachable;
+  using valhalla::tyr::write_le;
+  const auto& matrix = request.matrix();
+  const auto cells = static_cast<size_t>(matrix.times().size());
+
+  // whole seconds like the json and the meters the distances are kept in
+  std::string columns;
+  columns.reserve(cells * 2 * sizeof(uint32_t));
+  for (const auto time : matrix.times()) {
+    write_le(columns, time != kMaxCost
+                          ? static_cast<uint32_t>(std::min<double>(time, kBinaryUnreachable - 1))
+                          : kBinaryUnreachable);
+  }
+  for (size_t i = 0; i < cells; ++i) {
+    write_le(columns, matrix.times()[i] != kMaxCost
+                          ? std::min(matrix.distances()[i], kBinaryUnreachable - 1)
+                          : kBinaryUnreachable);
+  }
+
+  const bool compress = request.options().compress();
+  std::string bytes("VMAT", 4);
+  write_le(bytes, static_cast<uint8_t>(1));
+  write_le(bytes, static_cast<uint8_t>(compress ? 1 : 0));
+  write_le(bytes, static_cast<uint16_t>(0));
+  write_le(bytes, static_cast<uint32_t>(request.options().sources_size()));
+  write_le(bytes, static_cast<uint32_t>(request.options().targets_size()));
+  if (compress) {
+    bytes += compressZlib(columns);
+  } else {
+    bytes += columns;
+  }
+  return bytes;
+}
+} // namespace binary_serializers
+
 namespace valhalla {
 namespace tyr {
 
-std::string serializeMatrix(Api& request) {
-  auto format = request.options().format();
+std::list<std::string> serializeMatrixChunks(Api& request) {
   double distance_scale = (request.options().units() == Options::miles) ? kMilePerMeter : kKmPerMeter;
+  std::list<std::string> chunks;
   switch (request.options().format()) {
     case Options_Format_osrm:
-      return osrm_serializers::serialize(request);
+      osrm_serializers::serialize(request, chunks);
+      break;
     case Options_Format_json:
-      return valhalla_serializers::serialize(request, distance_scale);
+      valhalla_serializers::serialize(request, distance_scale, chunks);
+      break;
     case Options_Format_pbf:
-      return serializePbf(request);
+      chunks.push_back(serializePbf(request));
+      break;
+    case Options_Format_binary:
+      chunks.push_back(binary_serializers::serialize(request));
+      break;
     default:
       throw;
   }
+  return chunks;
+}
+
+std::string serializeMatrix(Api& request) {
+  return joinChunks(serializeMatrixChunks(request));
 }
 
 } // namespace tyr
@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <sstream>
+
+#include "baldr/json.h"
+#include "proto_conversions.h"
+#include "thor/matrix_common.h"
+#include "tyr/serializers.h"
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+/*
+route batch output is newline delimited json, one line per source/target pair in request order:
+
+{"index":0,"time":1234,"distance":26.713,"units":"kilometers"}
+{"index":1,"time":null,"distance":null,"units":"kilometers"}
+
+the id and any warnings of the request are added to the first line
+*/
+
+namespace valhalla {
+namespace tyr {
+
+std::string serializeRouteBatch(Api& request) {
+  const auto& options = request.options();
+  const auto& matrix = request.matrix();
+  double distance_scale = (options.units() == Options::miles) ? kMilePerMeter : kKmPerMeter;
+  const auto& units = Options_Units_Enum_Name(options.units());
+
+  std::stringstream ss;
+  for (int i = 0; i < matrix.times_size(); ++i) {
+    // check to make sure a route was found; if not, return null for distance & time
+    auto line = json::map({{"index", static_cast<uint64_t>(matrix.from_indices(i))}});
+    if (matrix.times(i) != kMaxCost) {
+      line->emplace("time", static_cast<uint64_t>(matrix.times(i)));
+      line->emplace("distance", json::fixed_t{matrix.distances(i) * distance_scale, 3});
+    } else {
+      line->emplace("time", static_cast<std::nullptr_t>(nullptr));
+      line->emplace("distance", static_cast<std::nullptr_t>(nullptr));
+    }
+    line->emplace("units", units);
+
+    if (i == 0) {
+      if (options.has_id_case()) {
+        line->emplace("id", options.id());
+      }
+      if (request.info().warnings_size() >= 1) {
+        line->emplace("warnings", serializeWarnings(request));
+      }
+    }
+    ss << *line << '\n';
+  }
+  return ss.str();
+}
+
+} // namespace tyr
+} // namespace valhalla
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "baldr/json.h"
+#include "baldr/rapidjson_utils.h"
 #include "midgard/encoded.h"
 #include "midgard/pointll.h"
 #include "midgard/polyline2.h"
@@ -62,7 +63,7 @@ inline double toFloating(const std::int32_t fixed) {
 }
 
 const constexpr double TILE_SIZE = 256.0;
-static constexpr unsigned MAX_ZOOM = 18;
+static constexpr unsigned MAX_ZOOM = kMaxGeneralizeZoom;
 static constexpr unsigned MIN_ZOOM = 1;
 // this is an upper bound to current display sizes
 static constexpr double VIEWPORT_WIDTH = 8 * TILE_SIZE;
@@ -72,28 +73,6 @@ const constexpr double DEGREE_TO_RAD = 0.017453292519943295769236907684886;
 const constexpr double RAD_TO_DEGREE = 1. / DEGREE_TO_RAD;
 const constexpr double EPSG3857_MAX_LATITUDE = 85.051128779806592378; // 90(4*atan(exp(pi))/pi-1)
 
-const constexpr PointLL::first_type DOUGLAS_PEUCKER_THRESHOLDS[19] = {
-    703125.0, // z0
-    351562.5, // z1
-    175781.2, // z2
-    87890.6,  // z3
-    43945.3,  // z4
-    21972.6,  // z5
-    10986.3,  // z6
-    5493.1,   // z7
-    2746.5,   // z8
-    1373.2,   // z9
-    686.6,    // z10
-    343.3,    // z11
-    171.6,    // z12
-    85.8,     // z13
-    42.9,     // z14
-    21.4,     // z15
-    10.7,     // z16
-    5.3,      // z17
-    2.6,      // z18
-};
-
 inline double clamp(const double lat) {
   return std::max(std::min(lat, double(EPSG3857_MAX_LATITUDE)), double(-EPSG3857_MAX_LATITUDE));
 }
@@ -247,18 +226,30 @@ void route_summary(json::MapPtr& route, const valhalla::Api& api, bool imperial,
   }
 }
 
+// A writer for the parts of the response that have a value per shape point. Those are streamed
+// and added to the response as raw json, so they do not allocate a json value per point. The
+// buffer is reused by the next shape or annotation on the thread
+rapidjson::writer_wrapper_t& point_writer() {
+  static thread_local rapidjson::writer_wrapper_t writer(4096);
+  writer.clear();
+  return writer;
+}
+
 // Generate leg shape in geojson format.
-json::MapPtr geojson_shape(const std::vector<PointLL> shape) {
-  auto geojson = json::map({});
-  auto coords = json::array({});
-  coords->reserve(shape.size());
+json::RawJSON geojson_shape(const std::vector<PointLL>& shape) {
+  auto& writer = point_writer();
+  writer.start_object();
+  writer("type", "LineString");
+  writer.start_array("coordinates");
   for (const auto& p : shape) {
-    coords->emplace_back(json::array(
-        {json::fixed_t{p.lng(), DIGITS_PRECISION}, json::fixed_t{p.lat(), DIGITS_PRECISION}}));
-  }
-  geojson->emplace("type", std::string("LineString"));
-  geojson->emplace("coordinates", std::move(coords));
-  return geojson;
+    writer.start_array();
+    writer.fixed(p.lng(), DIGITS_PRECISION);
+    writer.fixed(p.lat(), DIGITS_PRECISION);
+    writer.end_array();
+  }
+  writer.end_array();
+  writer.end_object();
+  return {writer.get_buffer()};
 }
 
 // Generate full shape of the route.
@@ -309,7 +300,7 @@ std::vector<PointLL> simplified_shape(const valhalla::DirectionsRoute& direction
   }
 
   const auto zoom_level = std::min(MAX_ZOOM, getFittedZoom(south_west, north_east));
-  Polyline2<PointLL>::Generalize(simple_shape, DOUGLAS_PEUCKER_THRESHOLDS[zoom_level], indices);
+  Polyline2<PointLL>::Generalize(simple_shape, kGeneralizeTolerances[zoom_level], indices);
   return simple_shape;
 }
 
@@ -331,60 +322,57 @@ void route_geometry(json::MapPtr& route,
   }
 }
 
-json::MapPtr serialize_annotations(const valhalla::TripLeg& trip_leg) {
-  auto attributes_map = json::map({});
-  attributes_map->reserve(4);
+json::RawJSON serialize_annotations(const valhalla::TripLeg& trip_leg) {
+  auto& writer = point_writer();
+  writer.start_object();
 
   if (trip_leg.shape_attributes().time_size() > 0) {
-    auto duration_array = json::array({});
-    duration_array->reserve(trip_leg.shape_attributes().time_size());
+    writer.start_array("duration");
     for (const auto& time : trip_leg.shape_attributes().time()) {
       // milliseconds (ms) to seconds (sec)
-      duration_array->push_back(json::fixed_t{time * kSecPerMillisecond, 3});
+      writer.fixed(time * kSecPerMillisecond, 3);
     }
-    attributes_map->emplace("duration", duration_array);
+    writer.end_array();
   }
 
   if (trip_leg.shape_attributes().length_size() > 0) {
-    auto distance_array = json::array({});
-    distance_array->reserve(trip_leg.shape_attributes().length_size());
+    writer.start_array("distance");
     for (const auto& length : trip_leg.shape_attributes().length()) {
       // decimeters (dm) to meters (m)
-      distance_array->push_back(json::fixed_t{length * kMeterPerDecimeter, 1});
+      writer.fixed(length * kMeterPerDecimeter, 1);
     }
-    attributes_map->emplace("distance", distance_array);
+    writer.end_array();
   }
 
   if (trip_leg.shape_attributes().speed_size() > 0) {
-    auto speeds_array = json::array({});
-    speeds_array->reserve(trip_leg.shape_attributes().speed_size());
+    writer.start_array("speed");
     for (const auto& speed : trip_leg.shape_attributes().speed()) {
       // dm/s to m/s
-      speeds_array->push_back(json::fixed_t{speed * kMeterPerDecimeter, 1});
+      writer.fixed(speed * kMeterPerDecimeter, 1);
     }
-    attributes_map->emplace("speed", speeds_array);
+    writer.end_array();
   }
 
   if (trip_leg.shape_attributes().speed_limit_size() > 0) {
-    auto speed_limits_array = json::array({});
-    speed_limits_array->reserve(trip_leg.shape_attributes().speed_limit_size());
+    writer.start_array("maxspeed");
     for (const auto& speed_limit : trip_leg.shape_attributes().speed_limit()) {
-      auto speed_limit_annotation = json::map({});
+      writer.start_object();
       if (speed_limit == kUnlimitedSpeedLimit) {
-        speed_limit_annotation->emplace("none", true);
+        writer("none", true);
       } else if (speed_limit > 0) {
         // TODO support mph?
-        speed_limit_annotation->emplace("unit", kSpeedLimitUnitsKph);
-        speed_limit_annotation->emplace("speed", static_cast<uint64_t>(speed_limit));
+        writer("unit", kSpeedLimitUnitsKph);
+        writer("speed", static_cast<uint64_t>(speed_limit));
       } else {
-        speed_limit_annotation->emplace("unknown", true);
+        writer("unknown", true);
       }
-      speed_limits_array->push_back(speed_limit_annotation);
+      writer.end_object();
     }
-    attributes_map->emplace("maxspeed", speed_limits_array);
+    writer.end_array();
   }
 
-  return attributes_map;
+  writer.end_object();
+  return {writer.get_buffer()};
 }
 
 // Serialize waypoints for optimized route. Note that OSRM retains the
@@ -429,65 +417,151 @@ struct IntersectionEdges {
   }
 };
 
-// Process 'indications' array - add indications from left to right
-json::ArrayPtr lane_indications(const bool drive_on_right, const uint16_t mask) {
-  auto indications = json::array({});
-
+// Calls add with the 'indications' of a lane from left to right
+template <typename add_t>
+void for_each_lane_indication(const bool drive_on_right, const uint16_t mask, const add_t& add) {
   // TODO make map for lane mask to osrm indication string
 
   // reverse (left u-turn)
   if (mask & kTurnLaneReverse && drive_on_right) {
-    indications->emplace_back(osrmconstants::kModifierUturn);
+    add(osrmconstants::kModifierUturn);
   }
   // sharp_left
   if (mask & kTurnLaneSharpLeft) {
-    indications->emplace_back(osrmconstants::kModifierSharpLeft);
+    add(osrmconstants::kModifierSharpLeft);
   }
   // left
   if (mask & kTurnLaneLeft) {
-    indications->emplace_back(osrmconstants::kModifierLeft);
+    add(osrmconstants::kModifierLeft);
   }
   // slight_left
   if (mask & kTurnLaneSlightLeft) {
-    indications->emplace_back(osrmconstants::kModifierSlightLeft);
+    add(osrmconstants::kModifierSlightLeft);
   }
   // through
   if (mask & kTurnLaneThrough) {
-    indications->emplace_back(osrmconstants::kModifierStraight);
+    add(osrmconstants::kModifierStraight);
   }
   // slight_right
   if (mask & kTurnLaneSlightRight) {
-    indications->emplace_back(osrmconstants::kModifierSlightRight);
+    add(osrmconstants::kModifierSlightRight);
   }
   // right
   if (mask & kTurnLaneRight) {
-    indications->emplace_back(osrmconstants::kModifierRight);
+    add(osrmconstants::kModifierRight);
   }
   // sharp_right
   if (mask & kTurnLaneSharpRight) {
-    indications->emplace_back(osrmconstants::kModifierSharpRight);
+    add(osrmconstants::kModifierSharpRight);
   }
   // reverse (right u-turn)
   if (mask & kTurnLaneReverse && !drive_on_right) {
-    indications->emplace_back(osrmconstants::kModifierUturn);
+    add(osrmconstants::kModifierUturn);
   }
+}
+
+// Process 'indications' array - add indications from left to right
+json::ArrayPtr lane_indications(const bool drive_on_right, const uint16_t mask) {
+  auto indications = json::array({});
+  for_each_lane_indication(drive_on_right, mask, [&indications](const std::string& indication) {
+    indications->emplace_back(indication);
+  });
   return indications;
 }
 
+/**
+ * The bearings of the edges at the nodes of a leg, sorted, whether each of them can be entered and
+ * which ones the path comes in on and goes out on. They are computed in one pass over the leg
+ * before its steps are serialized, for all but the last node, which only the arrive step has.
+ */
+class LegIntersections {
+public:
+  explicit LegIntersections(EnhancedTripLeg& etp) {
+    const int count = std::max(etp.node_size() - 1, 0);
+    nodes_.reserve(count);
+    std::vector<IntersectionEdges> edges;
+    for (int i = 0; i < count; ++i) {
+      // the edge departing the node, the others of the node and the one coming in, which can't
+      // be entered. Only the departing one at the start of the leg
+      edges.clear();
+      auto curr_edge = etp.GetCurrEdge(i);
+      edges.emplace_back(curr_edge->begin_heading(), true, false, true);
+      if (i > 0) {
+        auto node = etp.GetEnhancedNode(i);
+        for (uint32_t m = 0; m < node->intersecting_edge_size(); m++) {
+          auto intersecting_edge = node->GetIntersectingEdge(m);
+          bool routable = intersecting_edge->IsTraversableOutbound(curr_edge->travel_mode());
+          edges.emplace_back(intersecting_edge->begin_heading(), routable, false, false);
+        }
+        // TODO - what if a true U-turn - need to set it to routeable.
+        uint32_t prior_heading = etp.GetPrevEdge(i)->end_heading();
+        edges.emplace_back(((prior_heading + 180) % 360), false, true, false);
+      }
+
+      // Sort edges by increasing bearing and keep the in/out edge indexes
+      std::sort(edges.begin(), edges.end());
+      node_t node{static_cast<uint32_t>(bearings_.size()), 0, 0};
+      for (uint32_t n = 0; n < edges.size(); ++n) {
+        if (edges[n].in_edge) {
+          node.in = n;
+        }
+        if (edges[n].out_edge) {
+          node.out = n;
+        }
+        bearings_.push_back(edges[n].bearing);
+        entries_.push_back(edges[n].routeable);
+      }
+      nodes_.push_back(node);
+    }
+  }
+
+  // Writes the "in", "out", "entry" and "bearings" of a node that has an edge departing it
+  void write(rapidjson::writer_wrapper_t& writer, const uint32_t index) const {
+    const auto& node = nodes_[index];
+    const uint32_t end = index + 1 < nodes_.size() ? nodes_[index + 1].begin : bearings_.size();
+    if (index > 0) {
+      writer("in", static_cast<uint64_t>(node.in));
+    }
+    writer("out", static_cast<uint64_t>(node.out));
+    writer.start_array("entry");
+    for (uint32_t n = node.begin; n < end; ++n) {
+      writer(static_cast<bool>(entries_[n]));
+    }
+    writer.end_array();
+    writer.start_array("bearings");
+    for (uint32_t n = node.begin; n < end; ++n) {
+      writer(static_cast<uint64_t>(bearings_[n]));
+    }
+    writer.end_array();
+  }
+
+private:
+  struct node_t {
+    uint32_t begin; // first of the bearings of the node
+    uint32_t in;
+    uint32_t out;
+  };
+
+  std::vector<node_t> nodes_;
+  std::vector<uint16_t> bearings_;
+  std::vector<bool> entries_;
+};
+
 // Add intersections along a step/maneuver.
-json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
-                             valhalla::odin::EnhancedTripLeg* etp,
-                             const std::vector<PointLL>& shape,
-                             uint32_t& count,
-                             const bool arrive_maneuver,
-                             const baldr::AttributesController& controller) {
+json::RawJSON intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
+                            valhalla::odin::EnhancedTripLeg* etp,
+                            const LegIntersections& leg_intersections,
+                            const std::vector<PointLL>& shape,
+                            uint32_t& count,
+                            const bool arrive_maneuver,
+                            const baldr::AttributesController& controller) {
   // Iterate through the nodes/intersections of the path for this maneuver
   count = 0;
-  auto intersections = json::array({});
+  auto& writer = point_writer();
+  writer.start_array();
   uint32_t n = arrive_maneuver ? maneuver.end_path_index() + 1 : maneuver.end_path_index();
-  EnhancedTripLeg_Node* prev_node = nullptr;
   for (uint32_t i = maneuver.begin_path_index(); i < n; i++) {
-    auto intersection = json::map({});
+    writer.start_object();
 
     // Get the node and current edge from the enhanced trip path
     // NOTE: curr_edge does not exist for the arrive maneuver
@@ -497,145 +571,106 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
 
     // Add the node location (lon, lat). Use the last shape point for
     // the arrive step
-    auto loc = json::array({});
     size_t shape_index = arrive_maneuver ? shape.size() - 1 : curr_edge->begin_shape_index();
     PointLL ll = shape[shape_index];
-    loc->emplace_back(json::fixed_t{ll.lng(), 6});
-    loc->emplace_back(json::fixed_t{ll.lat(), 6});
-    intersection->emplace("location", loc);
-    intersection->emplace("geometry_index", static_cast<uint64_t>(shape_index));
+    writer.start_array("location");
+    writer.fixed(ll.lng(), 6);
+    writer.fixed(ll.lat(), 6);
+    writer.end_array();
+    writer("geometry_index", static_cast<uint64_t>(shape_index));
 
     // Add index into admin list
-    if (controller(kNodeAdminIndex)) {
-      intersection->emplace("admin_index", static_cast<uint64_t>(node->admin_index()));
+    if (controller(Attribute::kNodeAdminIndex)) {
+      writer("admin_index", static_cast<uint64_t>(node->admin_index()));
     }
 
-    if (!arrive_maneuver && controller(kEdgeIsUrban)) {
-      intersection->emplace("is_urban", curr_edge->is_urban());
+    if (!arrive_maneuver && controller(Attribute::kEdgeIsUrban)) {
+      writer("is_urban", curr_edge->is_urban());
     }
 
-    auto toll_collection = json::map({});
     if (node->type() == TripLeg_Node::kTollBooth) {
-      toll_collection->emplace("type", std::string("toll_booth"));
+      writer.start_object("toll_collection");
+      writer("type", "toll_booth");
+      writer.end_object();
     } else if (node->type() == TripLeg_Node::kTollGantry) {
-      toll_collection->emplace("type", std::string("toll_gantry"));
+      writer.start_object("toll_collection");
+      writer("type", "toll_gantry");
+      writer.end_object();
     }
-    if (!toll_collection->empty())
-      intersection->emplace("toll_collection", toll_collection);
 
     if (node->cost().transition_cost().seconds() > 0)
-      intersection->emplace("turn_duration",
-                            json::fixed_t{node->cost().transition_cost().seconds(), 3});
+      writer.fixed("turn_duration", node->cost().transition_cost().seconds(), 3);
     if (node->cost().transition_cost().cost() > 0)
-      intersection->emplace("turn_weight", json::fixed_t{node->cost().transition_cost().cost(), 3});
+      writer.fixed("turn_weight", node->cost().transition_cost().cost(), 3);
     auto next_node = i + 1 < n ? etp->GetEnhancedNode(i + 1) : nullptr;
     if (next_node) {
       auto secs = next_node->cost().elapsed_cost().seconds() - node->cost().elapsed_cost().seconds();
       auto cost = next_node->cost().elapsed_cost().cost() - node->cost().elapsed_cost().cost();
       if (secs > 0)
-        intersection->emplace("duration", json::fixed_t{secs, 3});
+        writer.fixed("duration", secs, 3);
       if (cost > 0)
-        intersection->emplace("weight", json::fixed_t{cost, 3});
+        writer.fixed("weight", cost, 3);
     }
 
     // TODO: add recosted durations to the intersection?
 
     // Add rest_stop when passing by a rest_area or service_area
     if (i > 0 && !arrive_maneuver) {
-      auto rest_stop = json::map({});
       for (uint32_t m = 0; m < node->intersecting_edge_size(); m++) {
         auto intersecting_edge = node->GetIntersectingEdge(m);
         bool routeable = intersecting_edge->IsTraversableOutbound(curr_edge->travel_mode());
+        if (!routeable || (intersecting_edge->use() != TripLeg_Use_kRestAreaUse &&
+                           intersecting_edge->use() != TripLeg_Use_kServiceAreaUse)) {
+          continue;
+        }
 
+        // I've looked at the results from guide_destinations(), destinations(), and
+        // exit_destinations(). exit_destinations() does not contain rest-area names.
+        // guide_destinations() and destinations() return the same string value for
+        // the rest area name. So I've decided to use guide_destinations().
         std::string sign_text;
         if (intersecting_edge->has_sign()) {
-          const valhalla::TripSign& trip_leg_sign = intersecting_edge->sign();
-          // I've looked at the results from guide_destinations(), destinations(), and
-          // exit_destinations(). exit_destinations() does not contain rest-area names.
-          // guide_destinations() and destinations() return the same string value for
-          // the rest area name. So I've decided to use guide_destinations().
-          sign_text = destinations(trip_leg_sign);
+          sign_text = destinations(intersecting_edge->sign());
         }
 
-        if (routeable && intersecting_edge->use() == TripLeg_Use_kRestAreaUse) {
-          rest_stop->emplace("type", std::string("rest_area"));
-          if (!sign_text.empty()) {
-            rest_stop->emplace("name", sign_text);
-          }
-          intersection->emplace("rest_stop", rest_stop);
-          break;
-        } else if (routeable && intersecting_edge->use() == TripLeg_Use_kServiceAreaUse) {
-          rest_stop->emplace("type", std::string("service_area"));
-          if (!sign_text.empty()) {
-            rest_stop->emplace("name", sign_text);
-          }
-          intersection->emplace("rest_stop", rest_stop);
-          break;
+        writer.start_object("rest_stop");
+        writer("type", intersecting_edge->use() == TripLeg_Use_kRestAreaUse ? "rest_area"
+                                                                           : "service_area");
+        if (!sign_text.empty()) {
+          writer("name", sign_text);
         }
+        writer.end_object();
+        break;
       }
     }
 
-    // Get bearings and access to outgoing intersecting edges. Do not add
-    // any intersecting edges for the first depart intersection and for
-    // the arrival step.
-    std::vector<IntersectionEdges> edges;
-
-    // Add the edge departing the node
+    // Get bearings and access to outgoing intersecting edges. The arrival step only has the
+    // incoming edge, which it can enter
     if (!arrive_maneuver) {
-      edges.emplace_back(curr_edge->begin_heading(), true, false, true);
+      leg_intersections.write(writer, i);
+    } else {
       if (i > 0) {
-        for (uint32_t m = 0; m < node->intersecting_edge_size(); m++) {
-          auto intersecting_edge = node->GetIntersectingEdge(m);
-          bool routable = intersecting_edge->IsTraversableOutbound(curr_edge->travel_mode());
-          edges.emplace_back(intersecting_edge->begin_heading(), routable, false, false);
-        }
+        writer("in", static_cast<uint64_t>(0));
       }
-    }
-
-    // Add the incoming edge except for the first depart intersection.
-    // Set routable to false except for arrive.
-    // TODO - what if a true U-turn - need to set it to routeable.
-    if (i > 0) {
-      bool entry = (arrive_maneuver) ? true : false;
-      uint32_t prior_heading = prev_edge->end_heading();
-      edges.emplace_back(((prior_heading + 180) % 360), entry, true, false);
-    }
-
-    // Create bearing and entry output
-    auto bearings = json::array({});
-    auto entries = json::array({});
-
-    // Sort edges by increasing bearing and update the in/out edge indexes
-    std::sort(edges.begin(), edges.end());
-    uint32_t incoming_index, outgoing_index;
-    for (uint32_t n = 0; n < edges.size(); ++n) {
-      if (edges[n].in_edge) {
-        incoming_index = n;
+      writer.start_array("entry");
+      if (i > 0) {
+        writer(true);
       }
-      if (edges[n].out_edge) {
-        outgoing_index = n;
+      writer.end_array();
+      writer.start_array("bearings");
+      if (i > 0) {
+        writer(static_cast<uint64_t>((prev_edge->end_heading() + 180) % 360));
       }
-      bearings->emplace_back(static_cast<uint64_t>(edges[n].bearing));
-      entries->emplace_back(edges[n].routeable);
-    }
-
-    // Add the index of the input edge and output edge
-    if (i > 0) {
-      intersection->emplace("in", static_cast<uint64_t>(incoming_index));
-    }
-    if (!arrive_maneuver) {
-      intersection->emplace("out", static_cast<uint64_t>(outgoing_index));
+      writer.end_array();
     }
 
-    intersection->emplace("entry", entries);
-    intersection->emplace("bearings", bearings);
-
     // Add tunnel_name for tunnels
     if (!arrive_maneuver) {
       if (curr_edge->tunnel() && !curr_edge->tagged_value().empty()) {
         for (uint32_t t = 0; t < curr_edge->tagged_value().size(); ++t) {
           if (curr_edge->tagged_value().Get(t).type() == TaggedValue_Type_kTunnel) {
-            intersection->emplace("tunnel_name", curr_edge->tagged_value().Get(t).value());
+            writer("tunnel_name", curr_edge->tagged_value().Get(t).value());
+            break;
           }
         }
       }
@@ -644,29 +679,27 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
     // Add classes based on the first edge after the maneuver (not needed
     // for arrive maneuver).
     if (!arrive_maneuver) {
-      std::vector<std::string> classes;
-      if (curr_edge->tunnel()) {
-        classes.push_back("tunnel");
-      }
-      if (maneuver.portions_toll() || curr_edge->toll()) {
-        classes.push_back("toll");
-      }
-      if (curr_edge->road_class() == valhalla::RoadClass::kMotorway) {
-        classes.push_back("motorway");
-      }
-      if (curr_edge->use() == TripLeg::Use::TripLeg_Use_kFerryUse) {
-        classes.push_back("ferry");
-      }
-
-      if (curr_edge->destination_only()) {
-        classes.push_back("restricted");
-      }
-      if (classes.size() > 0) {
-        auto class_list = json::array({});
-        for (const auto& cl : classes) {
-          class_list->emplace_back(cl);
+      const bool toll = maneuver.portions_toll() || curr_edge->toll();
+      const bool motorway = curr_edge->road_class() == valhalla::RoadClass::kMotorway;
+      const bool ferry = curr_edge->use() == TripLeg::Use::TripLeg_Use_kFerryUse;
+      if (curr_edge->tunnel() || toll || motorway || ferry || curr_edge->destination_only()) {
+        writer.start_array("classes");
+        if (curr_edge->tunnel()) {
+          writer("tunnel");
+        }
+        if (toll) {
+          writer("toll");
+        }
+        if (motorway) {
+          writer("motorway");
+        }
+        if (ferry) {
+          writer("ferry");
         }
-        intersection->emplace("classes", class_list);
+        if (curr_edge->destination_only()) {
+          writer("restricted");
+        }
+        writer.end_array();
       }
     }
 
@@ -675,31 +708,34 @@ json::ArrayPtr intersections(const valhalla::DirectionsLeg::Maneuver& maneuver,
     // Verify that turn lanes are not non-directional
     if (prev_edge && (prev_edge->turn_lanes_size() > 0) && prev_edge->HasActiveTurnLane() &&
         !prev_edge->HasNonDirectionalTurnLane()) {
-      auto lanes = json::array({});
+      writer.start_array("lanes");
       for (const auto& turn_lane : prev_edge->turn_lanes()) {
-        auto lane = json::map({});
+        writer.start_object();
         // Process 'valid' & 'active' flags
         bool is_active = turn_lane.state() == TurnLane::kActive;
         // an active lane is also valid
         bool is_valid = is_active || turn_lane.state() == TurnLane::kValid;
-        lane->emplace("active", is_active);
-        lane->emplace("valid", is_valid);
+        writer("active", is_active);
+        writer("valid", is_valid);
         // Add valid_indication for a valid & active lanes
         if (turn_lane.state() != TurnLane::kInvalid) {
-          lane->emplace("valid_indication", turn_lane_direction(turn_lane.active_direction()));
+          writer("valid_indication", turn_lane_direction(turn_lane.active_direction()));
         }
-        lane->emplace("indications",
-                      lane_indications(prev_edge->drive_on_right(), turn_lane.directions_mask()));
-        lanes->emplace_back(std::move(lane));
+        writer.start_array("indications");
+        for_each_lane_indication(prev_edge->drive_on_right(), turn_lane.directions_mask(),
+                                 [&writer](const std::string& indication) { writer(indication); });
+        writer.end_array();
+        writer.end_object();
       }
-      intersection->emplace("lanes", std::move(lanes));
+      writer.end_array();
     }
 
     // Add the intersection to the JSON array
-    intersections->emplace_back(intersection);
+    writer.end_object();
     count++;
   }
-  return intersections;
+  writer.end_array();
+  return {writer.get_buffer()};
 }
 
 // Add exits (exit numbers) along a step/maneuver.
@@ -1576,6 +1612,9 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
     // encoded shape for each step (maneuver) in OSRM output.
     auto shape = midgard::decode<std::vector<PointLL>>(leg->shape());
 
+    // The bearings at the intersections of the leg, for all of its steps
+    const LegIntersections leg_intersections(etp);
+
     // #########################################################################
     //  Iterate through maneuvers - convert to OSRM steps
     uint32_t maneuver_index = 0;
@@ -1771,8 +1810,9 @@ json::ArrayPtr serialize_legs(const google::protobuf::RepeatedPtrField<valhalla:
       }
 
       // Add intersections
-      step->emplace("intersections", intersections(maneuver, &etp, shape, prev_intersection_count,
-                                                   arrive_maneuver, controller));
+      step->emplace("intersections",
+                    intersections(maneuver, &etp, leg_intersections, shape,
+                                  prev_intersection_count, arrive_maneuver, controller));
 
       // Add step
       prev_rotary = rotary;
@@ -2002,6 +2042,11 @@ std::string serialize(valhalla::Api& api) {
     json->emplace("warnings", serializeWarnings(api));
   }
 
+  // what the searches for the route cost, verbose requests only
+  if (api.info().search_effort_size() > 0) {
+    json->emplace("search_effort", serializeSearchEffort(api));
+  }
+
   std::stringstream ss;
   ss << *json;
   return ss.str();
@@ -2224,12 +2269,8 @@ TEST(RouteSerializerOsrm, testserializeAnnotationsEmpty) {
   rapidjson::Document serialized_to_json;
   {
     auto leg = TripLeg();
-    json::MapPtr annotations = serialize_annotations(leg);
-
-    std::stringstream ss;
-    ss << *annotations;
-    serialized_to_json.Parse(ss.str().c_str());
-    std::cout << *annotations << std::endl;
+    auto annotations = serialize_annotations(leg);
+    serialized_to_json.Parse(annotations.data.c_str());
   }
   rapidjson::Document expected_json;
   { expected_json.Parse(R"({})"); }
@@ -2245,10 +2286,7 @@ TEST(RouteSerializerOsrm, testserializeAnnotations) {
     leg.mutable_shape_attributes()->add_length(2);
     leg.mutable_shape_attributes()->add_speed(3);
     auto annotations = serialize_annotations(leg);
-
-    std::stringstream ss;
-    ss << *annotations;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(annotations.data.c_str());
   }
   rapidjson::Document expected_json;
   {
@@ -2271,10 +2309,7 @@ TEST(RouteSerializerOsrm, testserializeAnnotationsSpeedLimits) {
     leg.mutable_shape_attributes()->add_speed_limit(255);
     leg.mutable_shape_attributes()->add_speed_limit(0);
     auto annotations = serialize_annotations(leg);
-
-    std::stringstream ss;
-    ss << *annotations;
-    serialized_to_json.Parse(ss.str().c_str());
+    serialized_to_json.Parse(annotations.data.c_str());
   }
   rapidjson::Document expected_json;
   {
@@ -2306,6 +2341,40 @@ TEST(RouteSerializerOsrm, testlaneIndications) {
   ASSERT_STREQ(boost::get<std::string>(indications_2->at(2)).c_str(), "sharp right");
 }
 
+TEST(RouteSerializerOsrm, testLegIntersections) {
+  TripLeg leg;
+  auto* first = leg.add_node()->mutable_edge();
+  first->set_begin_heading(80);
+  first->set_end_heading(90);
+  auto* node = leg.add_node();
+  node->mutable_edge()->set_begin_heading(0);
+  auto* routable = node->add_intersecting_edge();
+  routable->set_begin_heading(180);
+  routable->set_driveability(TripLeg_Traversability_kForward);
+  auto* oneway = node->add_intersecting_edge();
+  oneway->set_begin_heading(200);
+  oneway->set_driveability(TripLeg_Traversability_kBackward);
+  leg.add_node();
+
+  EnhancedTripLeg etp(leg);
+  const LegIntersections intersections(etp);
+  rapidjson::writer_wrapper_t writer;
+
+  // the depart intersection only has the edge leaving it
+  writer.start_object();
+  intersections.write(writer, 0);
+  writer.end_object();
+  EXPECT_STREQ(writer.get_buffer(), R"({"out":0,"entry":[true],"bearings":[80]})");
+
+  // the incoming edge is turned around and sorted in with the others
+  writer.clear();
+  writer.start_object();
+  intersections.write(writer, 1);
+  writer.end_object();
+  EXPECT_STREQ(writer.get_buffer(),
+               R"({"in":3,"out":0,"entry":[true,true,false,false],"bearings":[0,180,200,270]})");
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -530,10 +530,27 @@ void legs(const valhalla::Api& api, int route_index, rapidjson::writer_wrapper_t
         writer("time_" + recost_itr->name(), std::nullptr_t());
       ++recost_itr;
     }
+    if (trip_leg_itr->departure_profile_size()) {
+      writer.start_array("departure_profile");
+      for (const auto seconds : trip_leg_itr->departure_profile()) {
+        writer(static_cast<double>(seconds));
+      }
+      writer.end_array();
+    }
     ++trip_leg_itr;
     writer.end_object();
 
     writer("shape", directions_leg.shape());
+    if (directions_leg.zoom_shapes_size()) {
+      writer.start_array("zoom_shapes");
+      for (const auto& zoom_shape : directions_leg.zoom_shapes()) {
+        writer.start_object();
+        writer("zoom", static_cast<uint64_t>(zoom_shape.zoom()));
+        writer("shape", zoom_shape.shape());
+        writer.end_object();
+      }
+      writer.end_array();
+    }
 
     writer.end_object(); // leg
   }
@@ -587,6 +604,11 @@ std::string serialize(const Api& api) {
     writer("id", api.options().id());
   }
 
+  // what the searches for the route cost, verbose requests only
+  if (api.info().search_effort_size() > 0) {
+    valhalla::tyr::serializeSearchEffort(api, writer);
+  }
+
   writer.end_object(); // outer object
 
   return writer.get_buffer();
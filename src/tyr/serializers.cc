@@ -1,13 +1,16 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
 #include <cstdint>
 #include <functional>
+#include <list>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "baldr/compression_utils.h"
 #include "baldr/datetime.h"
 #include "baldr/json.h"
 #include "baldr/openlr.h"
@@ -123,12 +126,138 @@ std::string serializeStatus(Api& request) {
   if (request.status().has_has_transit_tiles_case())
     status_doc.AddMember("has_transit_tiles",
                          rapidjson::Value().SetBool(request.status().has_transit_tiles()), alloc);
+  if (request.status().has_has_elevation_case())
+    status_doc.AddMember("has_elevation",
+                         rapidjson::Value().SetBool(request.status().has_elevation()), alloc);
+  if (request.status().has_tileset_version_case())
+    status_doc.AddMember("tileset_version",
+                         rapidjson::Value().SetString(request.status().tileset_version(), alloc),
+                         alloc);
   // a 0 changeset indicates there's none, so don't write in the output
   // TODO: currently this can't be tested as gurka isn't adding changeset IDs to OSM objects (yet)
   if (request.status().has_osm_changeset_case() && request.status().osm_changeset())
     status_doc.AddMember("osm_changeset",
                          rapidjson::Value().SetUint64(request.status().osm_changeset()), alloc);
 
+  if (request.status().tileset_levels_size()) {
+    rapidjson::Value tileset_levels(rapidjson::kArrayType);
+    for (const auto& level : request.status().tileset_levels()) {
+      rapidjson::Value value(rapidjson::kObjectType);
+      value.AddMember("level", rapidjson::Value().SetUint(level.level()), alloc);
+      value.AddMember("tiles", rapidjson::Value().SetUint64(level.tiles()), alloc);
+      tileset_levels.PushBack(value, alloc);
+    }
+    status_doc.AddMember("tileset_levels", tileset_levels, alloc);
+  }
+
+  if (request.status().label_memory_size()) {
+    rapidjson::Value label_memory(rapidjson::kObjectType);
+    for (const auto& memory : request.status().label_memory()) {
+      rapidjson::Value algorithm(rapidjson::kObjectType);
+      algorithm.AddMember("reserved_bytes", rapidjson::Value().SetUint64(memory.reserved_bytes()),
+                          alloc);
+      algorithm.AddMember("used_bytes", rapidjson::Value().SetUint64(memory.used_bytes()), alloc);
+      algorithm.AddMember("peak_used_bytes",
+                          rapidjson::Value().SetUint64(memory.peak_used_bytes()), alloc);
+      algorithm.AddMember("trims", rapidjson::Value().SetUint(memory.trims()), alloc);
+      label_memory.AddMember(rapidjson::Value().SetString(memory.algorithm(), alloc), algorithm,
+                             alloc);
+    }
+    status_doc.AddMember("label_memory", label_memory, alloc);
+  }
+
+  if (request.status().has_snap_cache()) {
+    const auto& stats = request.status().snap_cache();
+    rapidjson::Value snap_cache(rapidjson::kObjectType);
+    snap_cache.AddMember("hits", rapidjson::Value().SetUint64(stats.hits()), alloc);
+    snap_cache.AddMember("misses", rapidjson::Value().SetUint64(stats.misses()), alloc);
+    snap_cache.AddMember("evictions", rapidjson::Value().SetUint64(stats.evictions()), alloc);
+    snap_cache.AddMember("invalidations", rapidjson::Value().SetUint64(stats.invalidations()),
+                         alloc);
+    snap_cache.AddMember("size", rapidjson::Value().SetUint64(stats.size()), alloc);
+    status_doc.AddMember("snap_cache", snap_cache, alloc);
+  }
+
+  if (request.status().has_shape_cache()) {
+    const auto& stats = request.status().shape_cache();
+    rapidjson::Value shape_cache(rapidjson::kObjectType);
+    shape_cache.AddMember("decodes", rapidjson::Value().SetUint64(stats.decodes()), alloc);
+    shape_cache.AddMember("hits", rapidjson::Value().SetUint64(stats.hits()), alloc);
+    status_doc.AddMember("shape_cache", shape_cache, alloc);
+  }
+
+  if (request.status().has_traffic_writes()) {
+    const auto& stats = request.status().traffic_writes();
+    rapidjson::Value traffic_writes(rapidjson::kObjectType);
+    traffic_writes.AddMember("batches", rapidjson::Value().SetUint64(stats.batches()), alloc);
+    traffic_writes.AddMember("updates", rapidjson::Value().SetUint64(stats.updates()), alloc);
+    traffic_writes.AddMember("write_waits", rapidjson::Value().SetUint64(stats.write_waits()),
+                             alloc);
+    traffic_writes.AddMember("read_retries", rapidjson::Value().SetUint64(stats.read_retries()),
+                             alloc);
+    status_doc.AddMember("traffic_writes", traffic_writes, alloc);
+  }
+
+  if (request.status().tile_cache_size()) {
+    rapidjson::Value tile_cache(rapidjson::kArrayType);
+    for (const auto& level : request.status().tile_cache()) {
+      rapidjson::Value value(rapidjson::kObjectType);
+      value.AddMember("level", rapidjson::Value().SetUint(level.level()), alloc);
+      value.AddMember("tiles", rapidjson::Value().SetUint64(level.tiles()), alloc);
+      value.AddMember("bytes", rapidjson::Value().SetUint64(level.bytes()), alloc);
+      value.AddMember("max_bytes", rapidjson::Value().SetUint64(level.max_bytes()), alloc);
+      value.AddMember("rejected", rapidjson::Value().SetUint64(level.rejected()), alloc);
+      tile_cache.PushBack(value, alloc);
+    }
+    status_doc.AddMember("tile_cache", tile_cache, alloc);
+  }
+
+  if (request.status().has_tile_warmup()) {
+    const auto& stats = request.status().tile_warmup();
+    rapidjson::Value tile_warmup(rapidjson::kObjectType);
+    tile_warmup.AddMember("tiles", rapidjson::Value().SetUint64(stats.tiles()), alloc);
+    tile_warmup.AddMember("bytes", rapidjson::Value().SetUint64(stats.bytes()), alloc);
+    tile_warmup.AddMember("millis", rapidjson::Value().SetUint64(stats.millis()), alloc);
+    status_doc.AddMember("tile_warmup", tile_warmup, alloc);
+  }
+
+  if (request.status().tile_access_size()) {
+    rapidjson::Value tile_access(rapidjson::kArrayType);
+    for (const auto& level : request.status().tile_access()) {
+      rapidjson::Value value(rapidjson::kObjectType);
+      value.AddMember("level", rapidjson::Value().SetUint(level.level()), alloc);
+      value.AddMember("tiles", rapidjson::Value().SetUint64(level.tiles()), alloc);
+      value.AddMember("accesses", rapidjson::Value().SetUint64(level.accesses()), alloc);
+      value.AddMember("misses", rapidjson::Value().SetUint64(level.misses()), alloc);
+      tile_access.PushBack(value, alloc);
+    }
+    status_doc.AddMember("tile_access", tile_access, alloc);
+  }
+
+  if (request.status().metrics_size()) {
+    const auto& bounds = request.status().metric_bucket_bounds();
+    rapidjson::Value metrics(rapidjson::kObjectType);
+    for (const auto& metric : request.status().metrics()) {
+      rapidjson::Value value(rapidjson::kObjectType);
+      value.AddMember("requests", rapidjson::Value().SetUint64(metric.requests()), alloc);
+      value.AddMember("sum", rapidjson::Value().SetDouble(metric.sum()), alloc);
+      value.AddMember("max", rapidjson::Value().SetDouble(metric.max()), alloc);
+      // the buckets are keyed by their upper bound in milliseconds
+      if (metric.buckets_size()) {
+        rapidjson::Value buckets(rapidjson::kObjectType);
+        for (int i = 0; i < metric.buckets_size(); ++i) {
+          auto bound = i < bounds.size() ? std::to_string(static_cast<uint64_t>(bounds.Get(i)))
+                                         : std::string("inf");
+          buckets.AddMember(rapidjson::Value().SetString(bound, alloc),
+                            rapidjson::Value().SetUint64(metric.buckets(i)), alloc);
+        }
+        value.AddMember("buckets", buckets, alloc);
+      }
+      metrics.AddMember(rapidjson::Value().SetString(metric.key(), alloc), value, alloc);
+    }
+    status_doc.AddMember("metrics", metrics, alloc);
+  }
+
   rapidjson::Document bbox_doc;
   if (request.status().has_bbox_case()) {
     bbox_doc.Parse(request.status().bbox());
@@ -190,6 +319,44 @@ json::ArrayPtr serializeWarnings(const valhalla::Api& api) {
   return warnings;
 }
 
+void serializeSearchEffort(const valhalla::Api& api, rapidjson::writer_wrapper_t& writer) {
+  writer.start_array("search_effort");
+  for (const auto& effort : api.info().search_effort()) {
+    writer.start_object();
+    writer("algorithm", effort.algorithm());
+    writer("settled", effort.settled());
+    writer("reached", effort.reached());
+    writer("label_bytes", effort.label_bytes());
+    writer("tiles_fetched", effort.tiles_fetched());
+    writer("tile_cache_misses", effort.tile_cache_misses());
+    writer.set_precision(3);
+    writer("setup_ms", effort.setup_ms());
+    writer("expansion_ms", effort.expansion_ms());
+    writer("path_ms", effort.path_ms());
+    writer.set_precision(rapidjson::Writer<rapidjson::StringBuffer>::kDefaultMaxDecimalPlaces);
+    writer.end_object();
+  }
+  writer.end_array();
+}
+
+json::ArrayPtr serializeSearchEffort(const valhalla::Api& api) {
+  auto efforts = json::array({});
+  for (const auto& effort : api.info().search_effort()) {
+    efforts->emplace_back(json::map({
+        {"algorithm", effort.algorithm()},
+        {"settled", effort.settled()},
+        {"reached", effort.reached()},
+        {"label_bytes", effort.label_bytes()},
+        {"tiles_fetched", effort.tiles_fetched()},
+        {"tile_cache_misses", effort.tile_cache_misses()},
+        {"setup_ms", json::fixed_t{effort.setup_ms(), 3}},
+        {"expansion_ms", json::fixed_t{effort.expansion_ms(), 3}},
+        {"path_ms", json::fixed_t{effort.path_ms(), 3}},
+    }));
+  }
+  return efforts;
+}
+
 std::string serializePbf(Api& request) {
   // if they dont want to select the parts just pick the obvious thing they would want based on action
   PbfFieldSelector selection = request.options().pbf_field_selector();
@@ -249,6 +416,52 @@ std::string serializePbf(Api& request) {
 
   return bytes;
 }
+
+std::string joinChunks(std::list<std::string>&& chunks) {
+  if (chunks.size() == 1) {
+    return std::move(chunks.front());
+  }
+  size_t size = 0;
+  for (const auto& chunk : chunks) {
+    size += chunk.size();
+  }
+  std::string joined;
+  joined.reserve(size);
+  // free every piece as soon as it is copied so we never hold much more than the response
+  while (!chunks.empty()) {
+    joined += chunks.front();
+    chunks.pop_front();
+  }
+  return joined;
+}
+
+std::string compressZlib(const std::string& bytes) {
+  auto deflate_src = [&bytes](z_stream& s) {
+    s.next_in = reinterpret_cast<Byte*>(const_cast<char*>(bytes.data()));
+    s.avail_in = static_cast<unsigned int>(bytes.size());
+    return Z_FINISH;
+  };
+
+  std::string compressed;
+  size_t written = 0;
+  auto deflate_dst = [&compressed, &written](z_stream& s) {
+    written = s.total_out;
+    // we need more space, doubling it so large responses dont copy over and over
+    if (s.avail_out == 0) {
+      auto size = compressed.size();
+      auto more = std::max<size_t>(size, 4096);
+      compressed.resize(size + more);
+      s.next_out = reinterpret_cast<Byte*>(&compressed[0] + size);
+      s.avail_out = static_cast<unsigned int>(more);
+    }
+  };
+
+  if (!baldr::deflate(deflate_src, deflate_dst, Z_DEFAULT_COMPRESSION, false))
+    throw std::logic_error("Can't write compressed response");
+  // the last call only tells us how much was written
+  compressed.resize(written);
+  return compressed;
+}
 } // namespace tyr
 } // namespace valhalla
 
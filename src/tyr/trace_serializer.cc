@@ -59,38 +59,38 @@ void serialize_edges(const AttributesController& controller,
       const auto& edge = trip_path.node(i - 1).edge();
 
       writer.start_object();
-      if (controller(kEdgeTruckRoute)) {
+      if (controller(Attribute::kEdgeTruckRoute)) {
         writer("truck_route", static_cast<bool>(edge.truck_route()));
       }
-      if (controller(kEdgeTruckSpeed) && (edge.truck_speed() > 0)) {
+      if (controller(Attribute::kEdgeTruckSpeed) && (edge.truck_speed() > 0)) {
         writer("truck_speed", static_cast<uint64_t>(std::round(edge.truck_speed() * scale)));
       }
-      if (controller(kEdgeSpeedLimit) && (edge.speed_limit() > 0)) {
+      if (controller(Attribute::kEdgeSpeedLimit) && (edge.speed_limit() > 0)) {
         if (edge.speed_limit() == kUnlimitedSpeedLimit) {
           writer("speed_limit", std::string("unlimited"));
         } else {
           writer("speed_limit", static_cast<uint64_t>(std::round(edge.speed_limit() * scale)));
         }
       }
-      if (controller(kEdgeDensity)) {
+      if (controller(Attribute::kEdgeDensity)) {
         writer("density", static_cast<uint64_t>(edge.density()));
       }
-      if (controller(kEdgeSacScale)) {
+      if (controller(Attribute::kEdgeSacScale)) {
         writer("sac_scale", static_cast<uint64_t>(edge.sac_scale()));
       }
-      if (controller(kEdgeShoulder)) {
+      if (controller(Attribute::kEdgeShoulder)) {
         writer("shoulder", static_cast<bool>(edge.shoulder()));
       }
-      if (controller(kEdgeSidewalk)) {
+      if (controller(Attribute::kEdgeSidewalk)) {
         writer("sidewalk", to_string(edge.sidewalk()));
       }
-      if (controller(kEdgeBicycleNetwork)) {
+      if (controller(Attribute::kEdgeBicycleNetwork)) {
         writer("bicycle_network", static_cast<uint64_t>(edge.bicycle_network()));
       }
-      if (controller(kEdgeCycleLane)) {
+      if (controller(Attribute::kEdgeCycleLane)) {
         writer("cycle_lane", to_string(static_cast<CycleLane>(edge.cycle_lane())));
       }
-      if (controller(kEdgeLaneCount)) {
+      if (controller(Attribute::kEdgeLaneCount)) {
         writer("lane_count", static_cast<uint64_t>(edge.lane_count()));
       }
       if (edge.lane_connectivity_size()) {
@@ -104,17 +104,17 @@ void serialize_edges(const AttributesController& controller,
         }
         writer.end_array();
       }
-      if (controller(kEdgeMaxDownwardGrade)) {
+      if (controller(Attribute::kEdgeMaxDownwardGrade)) {
         writer("max_downward_grade", static_cast<int64_t>(edge.max_downward_grade()));
       }
-      if (controller(kEdgeMaxUpwardGrade)) {
+      if (controller(Attribute::kEdgeMaxUpwardGrade)) {
         writer("max_upward_grade", static_cast<int64_t>(edge.max_upward_grade()));
       }
-      if (controller(kEdgeWeightedGrade)) {
+      if (controller(Attribute::kEdgeWeightedGrade)) {
         writer.set_precision(3);
         writer("weighted_grade", edge.weighted_grade());
       }
-      if (controller(kEdgeMeanElevation)) {
+      if (controller(Attribute::kEdgeMeanElevation)) {
         float mean = edge.mean_elevation();
         if (mean != kNoElevationData) {
           // Convert to feet if a valid elevation and units are miles
@@ -124,73 +124,83 @@ void serialize_edges(const AttributesController& controller,
           writer("mean_elevation", static_cast<int64_t>(mean));
         }
       }
-      if (controller(kEdgeWayId)) {
+      // Convert to feet if units are miles
+      const double elevation_scale = options.units() == Options::miles ? kFeetPerMeter : 1.0;
+      if (controller(Attribute::kEdgeAscent) && edge.has_ascent_case()) {
+        writer.set_precision(1);
+        writer("ascent", edge.ascent() * elevation_scale);
+      }
+      if (controller(Attribute::kEdgeDescent) && edge.has_descent_case()) {
+        writer.set_precision(1);
+        writer("descent", edge.descent() * elevation_scale);
+      }
+      if (controller(Attribute::kEdgeWayId)) {
         writer("way_id", static_cast<uint64_t>(edge.way_id()));
       }
-      if (controller(kEdgeId)) {
+      if (controller(Attribute::kEdgeId)) {
         writer("id", static_cast<uint64_t>(edge.id()));
       }
-      if (controller(kEdgeTravelMode)) {
+      if (controller(Attribute::kEdgeTravelMode)) {
         writer("travel_mode", to_string(edge.travel_mode()));
       }
-      if (controller(kEdgeVehicleType) && edge.travel_mode() == valhalla::kDrive) {
+      if (controller(Attribute::kEdgeVehicleType) && edge.travel_mode() == valhalla::kDrive) {
         writer("vehicle_type", to_string(edge.vehicle_type()));
       }
-      if (controller(kEdgePedestrianType) && edge.travel_mode() == valhalla::kPedestrian) {
+      if (controller(Attribute::kEdgePedestrianType) && edge.travel_mode() == valhalla::kPedestrian) {
         writer("pedestrian_type", to_string(edge.pedestrian_type()));
       }
-      if (controller(kEdgeBicycleType) && edge.travel_mode() == valhalla::kBicycle) {
+      if (controller(Attribute::kEdgeBicycleType) && edge.travel_mode() == valhalla::kBicycle) {
         writer("bicycle_type", to_string(edge.bicycle_type()));
       }
-      if (controller(kEdgeSurface)) {
+      if (controller(Attribute::kEdgeSurface)) {
         writer("surface", to_string(static_cast<baldr::Surface>(edge.surface())));
       }
-      if (controller(kEdgeDriveOnRight)) {
+      if (controller(Attribute::kEdgeDriveOnRight)) {
         writer("drive_on_right", static_cast<bool>(!edge.drive_on_left()));
       }
-      if (controller(kEdgeInternalIntersection)) {
+      if (controller(Attribute::kEdgeInternalIntersection)) {
         writer("internal_intersection", static_cast<bool>(edge.internal_intersection()));
       }
-      if (controller(kEdgeRoundabout)) {
+      if (controller(Attribute::kEdgeRoundabout)) {
         writer("roundabout", static_cast<bool>(edge.roundabout()));
       }
-      if (controller(kEdgeBridge)) {
+      if (controller(Attribute::kEdgeBridge)) {
         writer("bridge", static_cast<bool>(edge.bridge()));
       }
-      if (controller(kEdgeTunnel)) {
+      if (controller(Attribute::kEdgeTunnel)) {
         writer("tunnel", static_cast<bool>(edge.tunnel()));
       }
-      if (controller(kEdgeUnpaved)) {
+      if (controller(Attribute::kEdgeUnpaved)) {
         writer("unpaved", static_cast<bool>(edge.unpaved()));
       }
-      if (controller(kEdgeToll)) {
+      if (controller(Attribute::kEdgeToll)) {
         writer("toll", static_cast<bool>(edge.toll()));
       }
-      if (controller(kEdgeUse)) {
+      if (controller(Attribute::kEdgeUse)) {
         writer("use", to_string(static_cast<baldr::Use>(edge.use())));
       }
-      if (controller(kEdgeTraversability)) {
+      if (controller(Attribute::kEdgeTraversability)) {
         writer("traversability", to_string(edge.traversability()));
       }
-      if (controller(kEdgeEndShapeIndex)) {
+      if (controller(Attribute::kEdgeEndShapeIndex)) {
         writer("end_shape_index", static_cast<uint64_t>(edge.end_shape_index()));
       }
-      if (controller(kEdgeBeginShapeIndex)) {
+      if (controller(Attribute::kEdgeBeginShapeIndex)) {
         writer("begin_shape_index", static_cast<uint64_t>(edge.begin_shape_index()));
       }
-      if (controller(kEdgeEndHeading)) {
+      if (controller(Attribute::kEdgeEndHeading)) {
         writer("end_heading", static_cast<uint64_t>(edge.end_heading()));
       }
-      if (controller(kEdgeBeginHeading)) {
+      if (controller(Attribute::kEdgeBeginHeading)) {
         writer("begin_heading", static_cast<uint64_t>(edge.begin_heading()));
       }
-      if (controller(kEdgeRoadClass)) {
+      if (controller(Attribute::kEdgeRoadClass)) {
         writer("road_class", to_string(static_cast<baldr::RoadClass>(edge.road_class())));
       }
-      if (controller(kEdgeSpeed)) {
+      if (controller(Attribute::kEdgeSpeed)) {
         writer("speed", static_cast<uint64_t>(std::round(edge.speed() * scale)));
       }
-      if (controller(kEdgeLength)) {
+      if (controller(Attribute::kEdgeLength)) {
         writer.set_precision(3);
         writer("length", edge.length_km() * scale);
         if (edge.source_along_edge() != 0.f) {
@@ -274,31 +284,31 @@ void serialize_edges(const AttributesController& controller,
           writer.start_array("intersecting_edges");
           for (const auto& xedge : node.intersecting_edge()) {
             writer.start_object();
-            if (controller(kNodeIntersectingEdgeWalkability) &&
+            if (controller(Attribute::kNodeIntersectingEdgeWalkability) &&
                 (xedge.walkability() != TripLeg_Traversability_kNone)) {
               writer("walkability", to_string(xedge.walkability()));
             }
-            if (controller(kNodeIntersectingEdgeCyclability) &&
+            if (controller(Attribute::kNodeIntersectingEdgeCyclability) &&
                 (xedge.cyclability() != TripLeg_Traversability_kNone)) {
               writer("cyclability", to_string(xedge.cyclability()));
             }
-            if (controller(kNodeIntersectingEdgeDriveability) &&
+            if (controller(Attribute::kNodeIntersectingEdgeDriveability) &&
                 (xedge.driveability() != TripLeg_Traversability_kNone)) {
               writer("driveability", to_string(xedge.driveability()));
             }
-            if (controller(kNodeIntersectingEdgeFromEdgeNameConsistency)) {
+            if (controller(Attribute::kNodeIntersectingEdgeFromEdgeNameConsistency)) {
               writer("from_edge_name_consistency", static_cast<bool>(xedge.prev_name_consistency()));
             }
-            if (controller(kNodeIntersectingEdgeToEdgeNameConsistency)) {
+            if (controller(Attribute::kNodeIntersectingEdgeToEdgeNameConsistency)) {
               writer("to_edge_name_consistency", static_cast<bool>(xedge.curr_name_consistency()));
             }
-            if (controller(kNodeIntersectingEdgeBeginHeading)) {
+            if (controller(Attribute::kNodeIntersectingEdgeBeginHeading)) {
               writer("begin_heading", static_cast<uint64_t>(xedge.begin_heading()));
             }
-            if (controller(kNodeIntersectingEdgeUse)) {
+            if (controller(Attribute::kNodeIntersectingEdgeUse)) {
               writer("use", to_string(static_cast<baldr::Use>(xedge.use())));
             }
-            if (controller(kNodeIntersectingEdgeRoadClass)) {
+            if (controller(Attribute::kNodeIntersectingEdgeRoadClass)) {
               writer("road_class", to_string(static_cast<baldr::RoadClass>(xedge.road_class())));
             }
             writer.end_object();
@@ -306,23 +316,23 @@ void serialize_edges(const AttributesController& controller,
           writer.end_array();
         }
 
-        if (controller(kNodeElapsedTime)) {
+        if (controller(Attribute::kNodeElapsedTime)) {
           writer.set_precision(3);
           writer("elapsed_time", node.cost().elapsed_cost().seconds());
         }
-        if (controller(kNodeAdminIndex)) {
+        if (controller(Attribute::kNodeAdminIndex)) {
           writer("admin_index", static_cast<uint64_t>(node.admin_index()));
         }
-        if (controller(kNodeType)) {
+        if (controller(Attribute::kNodeType)) {
           writer("type", to_string(static_cast<baldr::NodeType>(node.type())));
         }
-        if (controller(kNodeFork)) {
+        if (controller(Attribute::kNodeFork)) {
           writer("fork", static_cast<bool>(node.fork()));
         }
-        if (controller(kNodeTimeZone) && !node.time_zone().empty()) {
+        if (controller(Attribute::kNodeTimeZone) && !node.time_zone().empty()) {
           writer("time_zone", node.time_zone());
         }
-        if (controller(kNodeTransitionTime)) {
+        if (controller(Attribute::kNodeTransitionTime)) {
           writer.set_precision(3);
           writer("transition_time", node.cost().transition_cost().seconds());
         }
@@ -368,14 +378,14 @@ void serialize_matched_points(const AttributesController& controller,
     writer.start_object();
 
     // Process matched point
-    if (controller(kMatchedPoint)) {
+    if (controller(Attribute::kMatchedPoint)) {
       writer.set_precision(6);
       writer("lon", match_result.lnglat.first);
       writer("lat", match_result.lnglat.second);
     }
 
     // Process matched type
-    if (controller(kMatchedType)) {
+    if (controller(Attribute::kMatchedType)) {
       switch (match_result.GetType()) {
         case meili::MatchResult::Type::kMatched:
           writer("type", std::string("matched"));
@@ -392,29 +402,29 @@ void serialize_matched_points(const AttributesController& controller,
     // TODO: need to keep track of the index of the edge in the global set of edges a given
     // TODO: match result belongs/correlated to
     // Process matched point edge index
-    if (controller(kMatchedEdgeIndex) && match_result.edgeid.Is_Valid()) {
+    if (controller(Attribute::kMatchedEdgeIndex) && match_result.edgeid.Is_Valid()) {
       writer("edge_index", static_cast<uint64_t>(match_result.edge_index));
     }
 
     // Process matched point begin route discontinuity
-    if (controller(kMatchedBeginRouteDiscontinuity) && match_result.begins_discontinuity) {
+    if (controller(Attribute::kMatchedBeginRouteDiscontinuity) && match_result.begins_discontinuity) {
       writer("begin_route_discontinuity", static_cast<bool>(match_result.begins_discontinuity));
     }
 
     // Process matched point end route discontinuity
-    if (controller(kMatchedEndRouteDiscontinuity) && match_result.ends_discontinuity) {
+    if (controller(Attribute::kMatchedEndRouteDiscontinuity) && match_result.ends_discontinuity) {
       writer("end_route_discontinuity", static_cast<bool>(match_result.ends_discontinuity));
     }
 
     // Process matched point distance along edge
-    if (controller(kMatchedDistanceAlongEdge) &&
+    if (controller(Attribute::kMatchedDistanceAlongEdge) &&
         (match_result.GetType() != meili::MatchResult::Type::kUnmatched)) {
       writer.set_precision(6);
       writer("distance_along_edge", match_result.distance_along);
     }
 
     // Process matched point distance from trace point
-    if (controller(kMatchedDistanceFromTracePoint) &&
+    if (controller(Attribute::kMatchedDistanceFromTracePoint) &&
         (match_result.GetType() != meili::MatchResult::Type::kUnmatched)) {
       writer.set_precision(6);
       writer("distance_from_trace_point", match_result.distance_from);
@@ -429,7 +439,7 @@ void serialize_shape_attributes(const AttributesController& controller,
                                 rapidjson::writer_wrapper_t& writer) {
   writer.start_object("shape_attributes");
   writer.set_precision(3);
-  if (controller(kShapeAttributesTime)) {
+  if (controller(Attribute::kShapeAttributesTime)) {
     writer.start_array("time");
     for (const auto& time : trip_path.shape_attributes().time()) {
       // milliseconds (ms) to seconds (sec)
@@ -437,7 +447,7 @@ void serialize_shape_attributes(const AttributesController& controller,
     }
     writer.end_array();
   }
-  if (controller(kShapeAttributesLength)) {
+  if (controller(Attribute::kShapeAttributesLength)) {
     writer.start_array("length");
     for (const auto& length : trip_path.shape_attributes().length()) {
       // decimeters (dm) to kilometer (km)
@@ -445,7 +455,7 @@ void serialize_shape_attributes(const AttributesController& controller,
     }
     writer.end_array();
   }
-  if (controller(kShapeAttributesSpeed)) {
+  if (controller(Attribute::kShapeAttributesSpeed)) {
     writer.start_array("speed");
     for (const auto& speed : trip_path.shape_attributes().speed()) {
       // dm/s to km/h
@@ -466,23 +476,23 @@ void append_trace_info(
   const auto& match_results = std::get<kMatchResultsIndex>(map_match_result);
 
   // Add osm_changeset
-  if (controller(kOsmChangeset)) {
+  if (controller(Attribute::kOsmChangeset)) {
     writer("osm_changeset", trip_path.osm_changeset());
   }
 
   // Add shape
-  if (controller(kShape)) {
+  if (controller(Attribute::kShape)) {
     writer("shape", trip_path.shape());
   }
 
   // Add confidence_score
-  if (controller(kConfidenceScore)) {
+  if (controller(Attribute::kConfidenceScore)) {
     writer.set_precision(3);
     writer("confidence_score", std::get<kConfidenceScoreIndex>(map_match_result));
   }
 
   // Add raw_score
-  if (controller(kRawScore)) {
+  if (controller(Attribute::kRawScore)) {
     writer.set_precision(3);
     writer("raw_score", std::get<kRawScoreIndex>(map_match_result));
   }
@@ -10,8 +10,11 @@
 
 #include "config.h"
 #include <algorithm>
+#include <atomic>
 #include <cxxopts.hpp>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
@@ -26,26 +29,32 @@ bool ferries, unnamed;
 
 namespace {
 
-// a place we can mark what edges we've seen, even for the planet we should need < 100mb
+// a place we can mark what edges we've seen, even for the planet we should need < 100mb. the
+// threads claim edges in it so only one of them ever exports an edge
 struct bitset_t {
-  bitset_t(size_t size) {
-    bits.resize(std::ceil(size / 64.0));
+  bitset_t(size_t size) : bits(std::ceil(size / 64.0)), count(size) {
   }
-  void set(const uint64_t id) {
+  size_t size() const {
+    return count;
+  }
+  // sets the bit and returns whether it was the one to set it
+  bool claim(const uint64_t id) {
     if (id >= bits.size() * 64) {
       throw std::runtime_error("id out of bounds");
     }
-    bits[id / 64] |= static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    const auto bit = static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
+    return !(bits[id / 64].fetch_or(bit) & bit);
   }
   bool get(const uint64_t id) const {
     if (id >= bits.size() * 64) {
       throw std::runtime_error("id out of bounds");
     }
-    return bits[id / 64] & (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
+    return bits[id / 64].load() & (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
   }
 
 protected:
-  std::vector<uint64_t> bits;
+  std::vector<std::atomic<uint64_t>> bits;
+  size_t count;
 };
 
 // often we need both the edge id and the directed edge, so lets have something to represent that
@@ -72,12 +81,24 @@ edge_t opposing(GraphReader& reader, graph_tile_ptr tile, const GraphId& edge_id
   return {opp_id, opp_edge};
 }
 
+// an edge and its opposing edge are the same road, they share the bit of the one that comes first
+uint64_t road(const std::unordered_map<GraphId, uint64_t>& tile_set,
+              const edge_t& edge,
+              const edge_t& opposing_edge) {
+  auto id = tile_set.find(edge.i.Tile_Base())->second + edge.i.id();
+  if (opposing_edge.e != nullptr) {
+    id = std::min(id, tile_set.find(opposing_edge.i.Tile_Base())->second + opposing_edge.i.id());
+  }
+  return id;
+}
+
 edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
-            const bitset_t& edge_set,
+            bitset_t& edge_set,
             GraphReader& reader,
             graph_tile_ptr& tile,
             const edge_t& edge,
-            const std::vector<std::string>& names) {
+            const std::vector<std::string>& names,
+            edge_t& opposing_edge) {
   // get the right tile
   if (tile->id() != edge.e->endnode().Tile_Base()) {
     tile = reader.GetGraphTile(edge.e->endnode());
@@ -91,10 +112,6 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
     // get the edge
     GraphId id = tile->id();
     id.set_id(node->edge_index() + i);
-    // already used
-    if (edge_set.get(tile_set.find(tile->id())->second + id.id())) {
-      continue;
-    }
     edge_t candidate{id, tile->directededge(id)};
     // dont need these
     if (!ferries && candidate.e->use() == Use::kFerry) {
@@ -107,8 +124,14 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set,
     }
     // names have to match
     auto candidate_names = tile->edgeinfo(candidate.e).GetNames();
-    if (names.size() == candidate_names.size() &&
-        std::equal(names.cbegin(), names.cend(), candidate_names.cbegin())) {
+    if (names.size() != candidate_names.size() ||
+        !std::equal(names.cbegin(), names.cend(), candidate_names.cbegin())) {
+      continue;
+    }
+    // already used, by this thread or another one
+    auto t = tile;
+    opposing_edge = opposing(reader, t, candidate);
+    if (edge_set.claim(road(tile_set, candidate, opposing_edge))) {
       return candidate;
     }
   }
@@ -138,90 +161,25 @@ void extend(GraphReader& reader,
   shape.splice(shape.end(), more);
 }
 
-} // namespace
-
-// program entry point
-int main(int argc, char* argv[]) {
-  const auto program = filesystem::path(__FILE__).stem().string();
-  // args
-  boost::property_tree::ptree pt;
-  std::string bbox;
-
-  try {
-    // clang-format off
-    cxxopts::Options options(
-      program,
-      program + " " + VALHALLA_VERSION + "\n\n"
-      "a simple command line test tool which\n"
-      "dumps information about each graph edge.\n\n");
-
-    using namespace std::string_literals;
-    options.add_options()
-      ("h,help", "Print this help message.")
-      ("v,version", "Print the version of this software.")
-      ("c,column", "What separator to use between columns [default=\\0].", cxxopts::value<std::string>(column_separator)->default_value("\0"s))
-      ("r,row", "What separator to use between row [default=\\n].", cxxopts::value<std::string>(row_separator)->default_value("\n"))
-      ("f,ferries", "Export ferries as well [default=false]", cxxopts::value<bool>(ferries)->default_value("false"))
-      ("u,unnamed", "Export unnamed edges as well [default=false]", cxxopts::value<bool>(unnamed)->default_value("false"))
-      ("config", "positional argument", cxxopts::value<std::string>());
-    // clang-format on
-
-    options.parse_positional({"config"});
-    options.positional_help("Config file path");
-    auto result = options.parse(argc, argv);
-    if (!parse_common_args(program, options, result, pt, "mjolnir.logging"))
-      return EXIT_SUCCESS;
-  } catch (cxxopts::OptionException& e) {
-    std::cerr << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (std::exception& e) {
-    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
-              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
-    return EXIT_FAILURE;
-  }
-
-  // get something we can use to fetch tiles
-  valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
-
-  // keep the global number of edges encountered at the point we encounter each tile
-  // this allows an edge to have a sequential global id and makes storing it very small
-  LOG_INFO("Enumerating edges...");
-  std::unordered_map<GraphId, uint64_t> tile_set(kMaxGraphTileId * TileHierarchy::levels().size());
-  uint64_t edge_count = 0;
-  for (const auto& level : TileHierarchy::levels()) {
-    for (uint32_t i = 0; i < level.tiles.TileCount(); ++i) {
-      GraphId tile_id{i, level.level, 0};
-      if (reader.DoesTileExist(tile_id)) {
-        // TODO: just read the header, parsing the whole thing isnt worth it at this point
-        tile_set.emplace(tile_id, edge_count);
-        auto tile = reader.GetGraphTile(tile_id);
-        assert(tile);
-        edge_count += tile->header()->directededgecount();
-        reader.Clear();
-      }
-    }
-  }
-
-  // this is how we know what i've touched and what we havent
-  bitset_t edge_set(edge_count);
-
-  // TODO: we could parallelize this and it might be quite a bit faster but if we really want to
-  // maximize continuous edges we need to avoid the lady and the tramp scenario where two threads
-  // are
-  // consuming the same stretch of road at the same time
-
-  // for each tile
-  LOG_INFO("Exporting " + std::to_string(edge_count) + " edges");
-  int progress = -1;
-  uint64_t set = 0;
-  for (const auto& tile_count_pair : tile_set) {
+// exports the roads of the tiles the threads haven't taken yet
+void work(const boost::property_tree::ptree& config,
+          const std::unordered_map<GraphId, uint64_t>& tile_set,
+          const std::vector<GraphId>& tiles,
+          std::atomic<size_t>& next_tile,
+          bitset_t& edge_set,
+          std::atomic<uint64_t>& set,
+          std::mutex& lock) {
+  GraphReader reader(config);
+  std::string out;
+  for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
     // for each edge in the tile
     reader.Clear();
-    auto tile = reader.GetGraphTile(tile_count_pair.first);
+    auto tile = reader.GetGraphTile(tiles[t]);
     assert(tile);
+    const auto first = tile_set.find(tiles[t])->second;
     for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
       // we've seen this one already
-      if (edge_set.get(tile_count_pair.second + i)) {
+      if (edge_set.get(first + i)) {
         continue;
       }
 
@@ -229,25 +187,26 @@ int main(int argc, char* argv[]) {
       // times maybe we should mark them though once every normal edge connected there has been
       // marked
 
-      // make sure we dont ever look at this again
-      edge_t edge{tile_count_pair.first, tile->directededge(i)};
+      edge_t edge{tiles[t], tile->directededge(i)};
       edge.i.set_id(i);
-      edge_set.set(tile_count_pair.second + i);
-      ++set;
 
       // these wont have opposing edges that we care about
       if (edge.e->use() == Use::kTransitConnection ||
           edge.e->IsTransitLine()) { // these 2 should never happen
+        edge_set.claim(first + i);
         continue;
       }
 
-      // get the opposing edge as well (ensure a valid edge is returned)
+      // get the opposing edge as well and make sure we dont ever look at this again, unless
+      // another thread got to the road first
       edge_t opposing_edge = opposing(reader, tile, edge);
+      if (!edge_set.claim(road(tile_set, edge, opposing_edge))) {
+        continue;
+      }
+      set += 2;
       if (opposing_edge.e == nullptr) {
         continue;
       }
-      edge_set.set(tile_set.find(opposing_edge.i.Tile_Base())->second + opposing_edge.i.id());
-      ++set;
 
       // shortcuts arent real and maybe we dont want ferries
       if (edge.e->is_shortcut() || (!ferries && edge.e->use() == Use::kFerry)) {
@@ -269,37 +228,31 @@ int main(int argc, char* argv[]) {
       // can't be guaranteed in the overall graph, but we can create the subgraphs in such a way
       // that
       // they are DAGs. this can produce suboptimal results however and depends on the initial edge.
-      // so for now we'll just greedily export edges
+      // so for now we'll just greedily export edges. with more than one thread two of them can
+      // meet on the same stretch of road, which then comes out in two pieces
 
       // keep some state about this section of road
       std::list<edge_t> edges{edge};
 
       // go forward
       auto t = tile;
-      while ((edge = next(tile_set, edge_set, reader, t, edge, names))) {
-        // mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
-        edge_t other = opposing(reader, t, edge);
+      edge_t other;
+      while ((edge = next(tile_set, edge_set, reader, t, edge, names, other))) {
+        set += 2;
         if (other.e == nullptr) {
           continue;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
         // keep this
         edges.push_back(edge);
       }
 
       // go backward
       edge = opposing_edge;
-      while ((edge = next(tile_set, edge_set, reader, t, edge, names))) {
-        // mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
-        edge_t other = opposing(reader, t, edge);
+      while ((edge = next(tile_set, edge_set, reader, t, edge, names, other))) {
+        set += 2;
         if (other.e == nullptr) {
           continue;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
         // keep this
         edges.push_front(other);
       }
@@ -311,29 +264,134 @@ int main(int argc, char* argv[]) {
       }
 
       // output it as: shape,name,name,...
-      auto encoded = encode(shape);
-      std::cout << encoded << column_separator;
+      out += encode(shape);
+      out += column_separator;
       for (const auto& name : names) {
-        std::cout << name << (&name == &names.back() ? "" : column_separator);
+        out += name;
+        out += &name == &names.back() ? "" : column_separator;
       }
-      std::cout << row_separator;
-      std::cout.flush();
+      out += row_separator;
     }
 
+    // hand what the tile had over, whole rows at a time
+    std::lock_guard<std::mutex> _(lock);
+    std::cout << out;
+    std::cout.flush();
+    out.clear();
+
     // check progress
-    int procent = (100.f * set) / edge_count;
+    static int progress = -1;
+    int procent = (100.f * set) / edge_set.size();
     if (procent > progress) {
       LOG_INFO(std::to_string(progress = procent) + "%");
     }
   }
-  LOG_INFO("Done");
+}
+
+} // namespace
+
+// program entry point
+int main(int argc, char* argv[]) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  // args
+  boost::property_tree::ptree pt;
+  std::string bbox;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "a simple command line test tool which\n"
+      "dumps information about each graph edge.\n\n");
+
+    using namespace std::string_literals;
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,column", "What separator to use between columns [default=\\0].", cxxopts::value<std::string>(column_separator)->default_value("\0"s))
+      ("r,row", "What separator to use between row [default=\\n].", cxxopts::value<std::string>(row_separator)->default_value("\n"))
+      ("f,ferries", "Export ferries as well [default=false]", cxxopts::value<bool>(ferries)->default_value("false"))
+      ("u,unnamed", "Export unnamed edges as well [default=false]", cxxopts::value<bool>(unnamed)->default_value("false"))
+      ("j,concurrency", "Number of threads to use. Defaults to all threads, 1 exports the same rows every time.", cxxopts::value<uint32_t>())
+      ("config", "positional argument", cxxopts::value<std::string>());
+    // clang-format on
+
+    options.parse_positional({"config"});
+    options.positional_help("Config file path");
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, pt, "mjolnir.logging", true))
+      return EXIT_SUCCESS;
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // get something we can use to fetch tiles
+  valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
+  const auto concurrency = pt.get<unsigned int>("mjolnir.concurrency");
 
-  for (uint64_t i = 0; i < edge_count; ++i) {
-    if (!edge_set.get(i)) {
-      LOG_INFO(std::to_string(i));
-      break;
+  // keep the global number of edges encountered at the point we encounter each tile
+  // this allows an edge to have a sequential global id and makes storing it very small
+  LOG_INFO("Enumerating edges...");
+  std::vector<GraphId> tiles;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (uint32_t i = 0; i < level.tiles.TileCount(); ++i) {
+      GraphId tile_id{i, level.level, 0};
+      if (reader.DoesTileExist(tile_id)) {
+        tiles.push_back(tile_id);
+      }
     }
   }
+  // TODO: just read the header, parsing the whole thing isnt worth it at this point
+  std::vector<uint64_t> counts(tiles.size());
+  {
+    std::atomic<size_t> next_tile(0);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < concurrency; ++i) {
+      threads.emplace_back([&]() {
+        GraphReader reader(pt.get_child("mjolnir"));
+        for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
+          auto tile = reader.GetGraphTile(tiles[t]);
+          assert(tile);
+          counts[t] = tile->header()->directededgecount();
+          reader.Clear();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  std::unordered_map<GraphId, uint64_t> tile_set(tiles.size());
+  uint64_t edge_count = 0;
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    tile_set.emplace(tiles[t], edge_count);
+    edge_count += counts[t];
+  }
+
+  // this is how we know what i've touched and what we havent
+  bitset_t edge_set(edge_count);
+
+  // for each tile, the threads take the next one that is left
+  LOG_INFO("Exporting " + std::to_string(edge_count) + " edges");
+  std::atomic<size_t> next_tile(0);
+  std::atomic<uint64_t> set(0);
+  std::mutex lock;
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < concurrency; ++i) {
+    threads.emplace_back(work, std::cref(pt.get_child("mjolnir")), std::cref(tile_set),
+                         std::cref(tiles), std::ref(next_tile), std::ref(edge_set), std::ref(set),
+                         std::ref(lock));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG_INFO("Done");
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "argparse_utils.h"
+#include "baldr/curler.h"
+#include "baldr/json.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "tyr/actor.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// requests of one file of the mix
+struct workload_t {
+  Options::Action action;
+  std::string file;
+  double weight;
+  std::vector<std::string> requests;
+};
+
+// what a single request took
+struct sample_t {
+  uint32_t workload;
+  uint32_t micros;
+  bool ok;
+};
+
+// Parse a mix entry of the form [action=]file[:weight]
+workload_t parse_workload(const std::string& entry) {
+  workload_t workload{Options::route, entry, 1., {}};
+  auto equals = entry.find('=');
+  if (equals != std::string::npos) {
+    if (!Options_Action_Enum_Parse(entry.substr(0, equals), &workload.action)) {
+      throw cxxopts::OptionException("Unknown action in " + entry);
+    }
+    workload.file = entry.substr(equals + 1);
+  }
+  auto colon = workload.file.rfind(':');
+  if (colon != std::string::npos) {
+    char* end = nullptr;
+    const auto weight = workload.file.substr(colon + 1);
+    workload.weight = std::strtod(weight.c_str(), &end);
+    if (end == weight.c_str() || *end != '\0' || workload.weight <= 0) {
+      throw cxxopts::OptionException("Invalid weight in " + entry);
+    }
+    workload.file.resize(colon);
+  }
+
+  // one request per line, either bare json or in the -j '{...}' form of the run_route_scripts
+  std::ifstream in(workload.file);
+  if (!in) {
+    throw cxxopts::OptionException("Couldn't read " + workload.file);
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    auto begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+    if (line.compare(begin, 2, "-j") == 0) {
+      begin = line.find_first_not_of(" \t", begin + 2);
+    }
+    auto end = line.find_last_not_of(" \t\r");
+    if (begin == std::string::npos || end <= begin) {
+      continue;
+    }
+    if (line[begin] == '\'' && line[end] == '\'') {
+      ++begin;
+      --end;
+    }
+    workload.requests.emplace_back(line.substr(begin, end - begin + 1));
+  }
+  if (workload.requests.empty()) {
+    throw cxxopts::OptionException("No requests in " + workload.file);
+  }
+  return workload;
+}
+
+// Percent encode a request for the query string of a GET
+std::string url_encode(const std::string& text) {
+  static const char* hex = "0123456789ABCDEF";
+  std::string encoded;
+  encoded.reserve(text.size() * 3);
+  for (const unsigned char c : text) {
+    if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      encoded.push_back(c);
+    } else {
+      encoded.push_back('%');
+      encoded.push_back(hex[c >> 4]);
+      encoded.push_back(hex[c & 15]);
+    }
+  }
+  return encoded;
+}
+
+// Lets the workers finish building their actors before the clock starts
+struct gate_t {
+  std::mutex mutex;
+  std::condition_variable condition;
+  size_t arrived = 0;
+  bool open = false;
+
+  void arrive() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++arrived;
+    condition.notify_all();
+    condition.wait(lock, [this]() { return open; });
+  }
+};
+
+// Summarize the latencies of some samples, nearest rank percentiles in milliseconds
+json::MapPtr summarize(std::vector<uint32_t>& micros, const size_t errors, const double seconds) {
+  std::sort(micros.begin(), micros.end());
+  auto percentile = [&micros](const double p) {
+    if (micros.empty()) {
+      return json::fixed_t{0, 3};
+    }
+    auto rank = static_cast<size_t>(std::ceil(p * micros.size()));
+    return json::fixed_t{micros[std::max<size_t>(rank, 1) - 1] / 1000.L, 3};
+  };
+  uint64_t total = 0;
+  for (const auto m : micros) {
+    total += m;
+  }
+  const auto count = micros.size() + errors;
+  return json::map({
+      {"requests", static_cast<uint64_t>(count)},
+      {"errors", static_cast<uint64_t>(errors)},
+      {"throughput", json::fixed_t{seconds > 0 ? count / seconds : 0, 2}},
+      {"latency_ms",
+       json::map({
+           {"mean", json::fixed_t{micros.empty() ? 0 : total / 1000.L / micros.size(), 3}},
+           {"p50", percentile(.5)},
+           {"p95", percentile(.95)},
+           {"p99", percentile(.99)},
+           {"max", json::fixed_t{micros.empty() ? 0 : micros.back() / 1000.L, 3}},
+       })},
+  });
+}
+
+} // namespace
+
+// Replays a mix of requests against an in process actor or a running service and reports the
+// throughput and the latency percentiles of the whole run and of each action as json
+int main(int argc, char* argv[]) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  boost::property_tree::ptree pt;
+  std::vector<workload_t> workloads;
+  std::string url;
+  uint32_t concurrency, count, warmup, seed;
+  double rate, duration;
+
+  try {
+    const auto hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "a load generator that replays a mix of requests against an in process actor or,\n"
+      "with --url, against a running valhalla service and reports the throughput and the\n"
+      "latency percentiles overall and per action as json.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Valhalla configuration file", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
+      ("r,requests", "A file of the mix as [action=]file[:weight], one json request per line. "
+        "The action defaults to route and the weight, the share of the requests picked from the "
+        "file, to 1. May be given several times.", cxxopts::value<std::vector<std::string>>())
+      ("u,url", "Send the requests to the service at this url, like http://localhost:8002, "
+        "rather than to an actor of this process.", cxxopts::value<std::string>())
+      ("j,concurrency", "Number of requests in flight at once.",
+        cxxopts::value<uint32_t>()->default_value(std::to_string(hardware_threads)))
+      ("n,count", "Number of requests to measure, by default every request of the mix once or "
+        "as many as fit in the duration.", cxxopts::value<uint32_t>()->default_value("0"))
+      ("d,duration", "Stop sending requests after this many seconds.",
+        cxxopts::value<double>()->default_value("0"))
+      ("rate", "Send the requests open loop at this many per second, their latency counts from "
+        "when they were due. Closed loop by default.", cxxopts::value<double>()->default_value("0"))
+      ("warmup", "Number of requests to send before measuring.",
+        cxxopts::value<uint32_t>()->default_value("0"))
+      ("seed", "Seed of the pick from the mix.", cxxopts::value<uint32_t>()->default_value("0"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, pt, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!result.count("requests")) {
+      throw cxxopts::OptionException("At least one request file is required\n\n" + options.help());
+    }
+    for (const auto& entry : result["requests"].as<std::vector<std::string>>()) {
+      workloads.emplace_back(parse_workload(entry));
+    }
+    if (result.count("url")) {
+      url = result["url"].as<std::string>();
+      while (!url.empty() && url.back() == '/') {
+        url.pop_back();
+      }
+    }
+    concurrency = std::max(1u, result["concurrency"].as<uint32_t>());
+    count = result["count"].as<uint32_t>();
+    duration = result["duration"].as<double>();
+    rate = result["rate"].as<double>();
+    warmup = result["warmup"].as<uint32_t>();
+    seed = result["seed"].as<uint32_t>();
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // without a count or a duration every request of the mix is sent once
+  if (count == 0 && duration <= 0) {
+    for (const auto& workload : workloads) {
+      count += workload.requests.size();
+    }
+  }
+
+  // the order the mix is sent in, a weighted pick of the file and the next request of it
+  std::vector<std::pair<uint32_t, uint32_t>> schedule(count ? warmup + count : warmup + (1u << 16));
+  {
+    std::vector<double> weights;
+    for (const auto& workload : workloads) {
+      weights.push_back(workload.weight);
+    }
+    std::mt19937 generator(seed);
+    std::discrete_distribution<uint32_t> pick(weights.begin(), weights.end());
+    std::vector<uint32_t> next(workloads.size(), 0);
+    for (auto& entry : schedule) {
+      entry.first = pick(generator);
+      entry.second = next[entry.first]++ % workloads[entry.first].requests.size();
+    }
+  }
+
+  // every worker keeps its own actor or connection and its own samples
+  std::atomic<uint64_t> next_request(0);
+  std::vector<std::vector<sample_t>> samples(concurrency);
+  gate_t gate;
+  clock_type::time_point start;
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < concurrency; ++i) {
+    workers.emplace_back([&, i]() {
+      std::unique_ptr<tyr::actor_t> actor;
+      std::unique_ptr<baldr::curler_t> curler;
+      if (url.empty()) {
+        actor.reset(new tyr::actor_t(pt, true));
+      } else {
+        curler.reset(new baldr::curler_t(program));
+      }
+      Api api;
+      auto send = [&](const std::pair<uint32_t, uint32_t>& entry) {
+        const auto& workload = workloads[entry.first];
+        const auto& request = workload.requests[entry.second];
+        try {
+          if (actor) {
+            api.Clear();
+            ParseApi(request, workload.action, api);
+            actor->act(api);
+            return true;
+          }
+          long http_code = 0;
+          (*curler)(url + "/" + Options_Action_Enum_Name(workload.action) +
+                        "?json=" + url_encode(request),
+                    http_code, false, nullptr);
+          return http_code == 200;
+        } catch (const std::exception& e) {
+          LOG_DEBUG(std::string("Request failed: ") + e.what());
+          return false;
+        }
+      };
+
+      // warm the caches up before anything is measured
+      uint64_t index;
+      while ((index = next_request++) < warmup) {
+        send(schedule[index]);
+      }
+      gate.arrive();
+
+      // closed loop sends as soon as the last response came back, open loop when the request is due
+      const auto stop = start + std::chrono::duration_cast<clock_type::duration>(
+                                    std::chrono::duration<double>(duration));
+      while ((index = next_request++ - warmup) < count || count == 0) {
+        auto sent = clock_type::now();
+        if (rate > 0) {
+          sent = start + std::chrono::duration_cast<clock_type::duration>(
+                             std::chrono::duration<double>(index / rate));
+          std::this_thread::sleep_until(sent);
+        }
+        if (duration > 0 && sent >= stop) {
+          break;
+        }
+        const auto& entry = schedule[(warmup + index) % schedule.size()];
+        const bool ok = send(entry);
+        const auto micros =
+            std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - sent).count();
+        samples[i].push_back({entry.first, static_cast<uint32_t>(micros), ok});
+      }
+    });
+  }
+
+  // every worker is ready and the warmup is done, start the clock
+  {
+    std::unique_lock<std::mutex> lock(gate.mutex);
+    gate.condition.wait(lock, [&]() { return gate.arrived == workers.size(); });
+    next_request = warmup;
+    start = clock_type::now();
+    gate.open = true;
+    gate.condition.notify_all();
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+  // the whole run and each action
+  std::vector<uint32_t> micros;
+  size_t errors = 0;
+  std::map<std::string, std::pair<std::vector<uint32_t>, size_t>> actions;
+  for (const auto& worker_samples : samples) {
+    for (const auto& sample : worker_samples) {
+      auto& action = actions[Options_Action_Enum_Name(workloads[sample.workload].action)];
+      if (sample.ok) {
+        micros.push_back(sample.micros);
+        action.first.push_back(sample.micros);
+      } else {
+        ++errors;
+        ++action.second;
+      }
+    }
+  }
+  auto report = summarize(micros, errors, seconds);
+  report->emplace("mode", std::string(url.empty() ? "in_process" : "http"));
+  report->emplace("concurrency", static_cast<uint64_t>(concurrency));
+  report->emplace("rate", json::fixed_t{rate, 2});
+  report->emplace("seconds", json::fixed_t{seconds, 3});
+  auto per_action = json::map({});
+  for (auto& action : actions) {
+    per_action->emplace(action.first,
+                        summarize(action.second.first, action.second.second, seconds));
+  }
+  report->emplace("actions", per_action);
+  std::cout << *report << std::endl;
+
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
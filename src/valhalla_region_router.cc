@@ -0,0 +1,24 @@
+#include <iostream>
+
+#include "baldr/rapidjson_utils.h"
+#include <boost/property_tree/ptree.hpp>
+
+#include "region_router.h"
+
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << std::string(argv[0]) << " conf/valhalla.json" << std::endl;
+    return 1;
+  }
+
+  // config file
+  std::string config_file(argv[1]);
+  boost::property_tree::ptree config;
+  rapidjson::read_json(config_file, config);
+
+  // send each request on to the cluster of its region
+  valhalla::run_region_router(config);
+
+  return 0;
+}
@@ -21,12 +21,35 @@ using namespace prime_server;
 #endif
 
 #include "midgard/logging.h"
+#include "midgard/numa.h"
 
 #include "loki/worker.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
 
+#ifdef HAVE_HTTP
+namespace {
+
+using run_service_t = void (*)(const boost::property_tree::ptree&);
+
+// Starts a worker, with numa_pinning the workers of each stage are spread round robin over the
+// NUMA nodes and kept there so the reader, tile cache and labels they allocate are node local
+void start_worker(const run_service_t run,
+                  const boost::property_tree::ptree& config,
+                  const size_t index) {
+  const bool pin = config.get<bool>("httpd.service.numa_pinning", false);
+  std::thread([run, config, index, pin]() {
+    if (pin && !valhalla::midgard::pin_thread_to_numa_node(index)) {
+      LOG_WARN("Could not pin worker " + std::to_string(index) + " to a NUMA node");
+    }
+    run(config);
+  }).detach();
+}
+
+} // namespace
+#endif
+
 int main(int argc, char** argv) {
 #ifdef HAVE_HTTP
   if (argc < 2 || argc > 4) {
@@ -181,6 +204,18 @@ int main(int argc, char** argv) {
 
   uint32_t request_timeout = config.get<uint32_t>("httpd.service.timeout_seconds");
 
+  // where the workers go
+  if (config.get<bool>("httpd.service.numa_pinning", false)) {
+    const auto& nodes = valhalla::midgard::numa_node_cpus();
+    for (size_t node = 0; node < nodes.size(); ++node) {
+      LOG_INFO("NUMA node " + std::to_string(node) + " has " + std::to_string(nodes[node].size()) +
+               " cpus and runs " +
+               std::to_string(worker_concurrency / nodes.size() +
+                              (node < worker_concurrency % nodes.size())) +
+               " workers of each stage");
+    }
+  }
+
   // setup the cluster within this process
   zmq::context_t context;
   std::thread server_thread =
@@ -188,34 +223,40 @@ int main(int argc, char** argv) {
                             http_server_t(context, listen, loki_proxy + "_in", loopback, interrupt,
                                           true, DEFAULT_MAX_REQUEST_SIZE, request_timeout)));
 
+  // every worker runs the whole pipeline on one Api so nothing goes between loki, thor and odin
+  if (config.get<bool>("httpd.service.inline_pipeline", false)) {
+    std::thread proxy_thread(
+        std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
+    proxy_thread.detach();
+    for (size_t i = 0; i < worker_concurrency; ++i) {
+      start_worker(valhalla::tyr::run_service, config, i);
+    }
+    server_thread.join();
+    return 0;
+  }
+
   // loki layer
   std::thread loki_proxy_thread(
       std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
   loki_proxy_thread.detach();
-  std::list<std::thread> loki_worker_threads;
   for (size_t i = 0; i < worker_concurrency; ++i) {
-    loki_worker_threads.emplace_back(valhalla::loki::run_service, config);
-    loki_worker_threads.back().detach();
+    start_worker(valhalla::loki::run_service, config, i);
   }
 
   // thor layer
   std::thread thor_proxy_thread(
       std::bind(&proxy_t::forward, proxy_t(context, thor_proxy + "_in", thor_proxy + "_out")));
   thor_proxy_thread.detach();
-  std::list<std::thread> thor_worker_threads;
   for (size_t i = 0; i < worker_concurrency; ++i) {
-    thor_worker_threads.emplace_back(valhalla::thor::run_service, config);
-    thor_worker_threads.back().detach();
+    start_worker(valhalla::thor::run_service, config, i);
   }
 
   // odin layer
   std::thread odin_proxy_thread(
       std::bind(&proxy_t::forward, proxy_t(context, odin_proxy + "_in", odin_proxy + "_out")));
   odin_proxy_thread.detach();
-  std::list<std::thread> odin_worker_threads;
   for (size_t i = 0; i < worker_concurrency; ++i) {
-    odin_worker_threads.emplace_back(valhalla::odin::run_service, config);
-    odin_worker_threads.back().detach();
+    start_worker(valhalla::odin::run_service, config, i);
   }
 
   // TODO: add multipoint accumulator
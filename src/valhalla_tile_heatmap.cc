@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cxxopts.hpp>
+
+#include "baldr/graphid.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tileaccesslog.h"
+#include "baldr/tilehierarchy.h"
+#include "config.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include "argparse_utils.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// the share of the accesses to a tile that missed the cache
+double miss_rate(const TileAccessCount& tile) {
+  return tile.count ? static_cast<double>(tile.misses) / tile.count : 0.;
+}
+
+void write_geojson(const std::vector<TileAccessCount>& tiles) {
+  rapidjson::writer_wrapper_t writer(4096);
+  writer.start_object();
+  writer("type", "FeatureCollection");
+  writer.start_array("features");
+  for (const auto& tile : tiles) {
+    const GraphId id(tile.tile_id);
+    const auto bbox = TileHierarchy::GetGraphIdBoundingBox(id);
+    writer.start_object();
+    writer("type", "Feature");
+    writer.start_object("geometry");
+    writer("type", "Polygon");
+    writer.start_array("coordinates");
+    writer.start_array();
+    for (const auto& corner : {bbox.minpt(), PointLL(bbox.maxx(), bbox.miny()), bbox.maxpt(),
+                               PointLL(bbox.minx(), bbox.maxy()), bbox.minpt()}) {
+      writer.start_array();
+      writer.fixed(corner.lng(), 6);
+      writer.fixed(corner.lat(), 6);
+      writer.end_array();
+    }
+    writer.end_array();
+    writer.end_array();
+    writer.end_object();
+    writer.start_object("properties");
+    writer("graph_id", std::to_string(id));
+    writer("level", static_cast<uint64_t>(id.level()));
+    writer("tile_id", static_cast<uint64_t>(id.tileid()));
+    writer("accesses", tile.count);
+    writer("misses", tile.misses);
+    writer.fixed("miss_rate", miss_rate(tile), 4);
+    writer.end_object();
+    writer.end_object();
+    // keep the buffer small however many tiles there are
+    std::cout << writer.flush();
+  }
+  writer.end_array();
+  writer.end_object();
+  std::cout << writer.flush() << std::endl;
+}
+
+void write_csv(const std::vector<TileAccessCount>& tiles) {
+  std::cout << "graph_id,level,tile_id,min_x,min_y,max_x,max_y,accesses,misses,miss_rate\n";
+  std::cout << std::fixed;
+  for (const auto& tile : tiles) {
+    const GraphId id(tile.tile_id);
+    const auto bbox = TileHierarchy::GetGraphIdBoundingBox(id);
+    std::cout << std::to_string(id) << ',' << id.level() << ',' << id.tileid() << ','
+              << std::setprecision(6) << bbox.minx() << ',' << bbox.miny() << ',' << bbox.maxx()
+              << ',' << bbox.maxy() << ',' << tile.count << ',' << tile.misses << ','
+              << std::setprecision(4) << miss_rate(tile) << '\n';
+  }
+  std::cout << std::flush;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  boost::property_tree::ptree pt;
+  std::string log_file, format;
+  uint32_t level, top;
+  bool one_level = false;
+
+  try {
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "Writes the tile access log of mjolnir.tile_access_log as a heatmap of the tiles with how\n"
+      "often each was asked for and how often that missed the tile cache, as GeoJSON polygons\n"
+      "or csv. The counts are sampled from every 16th tile access. The accesses and misses of\n"
+      "each hierarchy level are logged.\n\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Path to the json configuration file.", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline json config.", cxxopts::value<std::string>())
+      ("l,log", "The tile access log to read instead of mjolnir.tile_access_log.", cxxopts::value<std::string>(log_file))
+      ("level", "Only the tiles of this hierarchy level.", cxxopts::value<uint32_t>(level))
+      ("t,top", "Only this many of the most accessed tiles, 0 for all of them.", cxxopts::value<uint32_t>(top)->default_value("0"))
+      ("f,format", "geojson or csv.", cxxopts::value<std::string>(format)->default_value("geojson"));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, pt, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!result.count("log")) {
+      log_file = pt.get<std::string>("mjolnir.tile_access_log", "");
+    }
+    if (log_file.empty()) {
+      std::cerr << "There is no mjolnir.tile_access_log to read.\n\n";
+      std::cerr << options.help() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (format != "geojson" && format != "csv") {
+      std::cerr << "The format must be geojson or csv.\n\n";
+      std::cerr << options.help() << std::endl;
+      return EXIT_FAILURE;
+    }
+    one_level = result.count("level");
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // the log is most accessed first already
+  auto tiles = TileAccessLog::Read(log_file);
+  if (tiles.empty()) {
+    LOG_ERROR("No tile accesses in " + log_file);
+    return EXIT_FAILURE;
+  }
+  for (const auto& counts : TileAccessLog::ByLevel(tiles)) {
+    LOG_INFO("Level " + std::to_string(counts.level) + ": " + std::to_string(counts.tiles) +
+             " tiles, " + std::to_string(counts.count) + " accesses, " +
+             std::to_string(counts.misses) + " cache misses");
+  }
+  if (one_level) {
+    tiles.erase(std::remove_if(tiles.begin(), tiles.end(),
+                               [level](const TileAccessCount& tile) {
+                                 return GraphId(tile.tile_id).level() != level;
+                               }),
+                tiles.end());
+  }
+  if (top > 0 && tiles.size() > top) {
+    tiles.resize(top);
+  }
+
+  if (format == "csv") {
+    write_csv(tiles);
+  } else {
+    write_geojson(tiles);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "argparse_utils.h"
+#include "baldr/json.h"
+#include "baldr/rapidjson_utils.h"
+#include "midgard/aabb2.h"
+#include "midgard/logging.h"
+#include "midgard/pointll.h"
+#include "proto_conversions.h"
+#include "sif/hierarchylimits.h"
+#include "tyr/actor.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// the levels whose limits are tuned, the highway level never transitions up
+constexpr uint32_t kTunedLevels[] = {1, 2};
+
+// what a route of the sample took
+struct outcome_t {
+  bool ok = false;
+  double cost = 0.;
+  uint64_t settled = 0;
+};
+
+// a set of limits tried on the sample, as factors of the defaults
+struct candidate_t {
+  double transitions;
+  double distance;
+};
+
+// the routes of the sample that start and end in a region and share a costing
+struct group_t {
+  size_t region;
+  std::string costing;
+  std::vector<size_t> requests;
+};
+
+struct region_t {
+  std::string name;
+  AABB2<PointLL> bbox;
+};
+
+// One route request per line, either bare json or in the -j '{...}' form of the run_route_scripts
+std::vector<std::string> read_requests(const std::string& file) {
+  std::ifstream in(file);
+  if (!in) {
+    throw cxxopts::OptionException("Couldn't read " + file);
+  }
+  std::vector<std::string> requests;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+    if (line.compare(begin, 2, "-j") == 0) {
+      begin = line.find_first_not_of(" \t", begin + 2);
+    }
+    auto end = line.find_last_not_of(" \t\r");
+    if (begin == std::string::npos || end <= begin) {
+      continue;
+    }
+    if (line[begin] == '\'' && line[end] == '\'') {
+      ++begin;
+      --end;
+    }
+    requests.emplace_back(line.substr(begin, end - begin + 1));
+  }
+  if (requests.empty()) {
+    throw cxxopts::OptionException("No requests in " + file);
+  }
+  return requests;
+}
+
+// The regions of a file in the format of the limits table, its costings are ignored
+std::vector<region_t> read_regions(const std::string& file) {
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(file, pt);
+  std::vector<region_t> regions;
+  for (const auto& region_pt : pt.get_child("regions")) {
+    std::vector<double> bbox;
+    for (const auto& coord : region_pt.second.get_child("bbox")) {
+      bbox.push_back(coord.second.get_value<double>());
+    }
+    if (bbox.size() != 4) {
+      throw cxxopts::OptionException("The bbox of a region in " + file +
+                                     " is not [minlon, minlat, maxlon, maxlat]");
+    }
+    regions.push_back({region_pt.second.get<std::string>("name", ""),
+                       AABB2<PointLL>(bbox[0], bbox[1], bbox[2], bbox[3])});
+  }
+  return regions;
+}
+
+std::vector<double> parse_factors(const std::string& list) {
+  std::vector<double> factors;
+  std::stringstream stream(list);
+  std::string factor;
+  while (std::getline(stream, factor, ',')) {
+    char* end = nullptr;
+    factors.push_back(std::strtod(factor.c_str(), &end));
+    if (end == factor.c_str() || *end != '\0' || factors.back() <= 0) {
+      throw cxxopts::OptionException("Invalid factor " + factor + " in " + list);
+    }
+  }
+  if (factors.empty()) {
+    throw cxxopts::OptionException("No factors in " + list);
+  }
+  return factors;
+}
+
+// Route every request of the sample with actors of the given config, verbose so that thor reports
+// the labels its searches settled
+std::vector<outcome_t> replay(const boost::property_tree::ptree& config,
+                              const std::vector<std::string>& requests,
+                              const bool unlimited,
+                              const uint32_t concurrency) {
+  std::vector<outcome_t> outcomes(requests.size());
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < concurrency; ++i) {
+    workers.emplace_back([&]() {
+      tyr::actor_t actor(config, true);
+      Api api;
+      size_t index;
+      while ((index = next++) < requests.size()) {
+        auto& outcome = outcomes[index];
+        try {
+          api.Clear();
+          ParseApi(requests[index], Options::route, api);
+          auto& options = *api.mutable_options();
+          options.set_verbose(true);
+          if (unlimited) {
+            for (auto& costing : *options.mutable_costings()) {
+              costing.second.mutable_options()->set_disable_hierarchy_pruning(true);
+            }
+          }
+          actor.act(api);
+        } catch (const std::exception& e) {
+          LOG_DEBUG(std::string("Request failed: ") + e.what());
+          continue;
+        }
+        if (api.trip().routes_size() == 0) {
+          continue;
+        }
+        outcome.ok = true;
+        for (const auto& leg : api.trip().routes(0).legs()) {
+          if (leg.node_size()) {
+            outcome.cost += leg.node(leg.node_size() - 1).cost().elapsed_cost().cost();
+          }
+        }
+        for (const auto& effort : api.info().search_effort()) {
+          outcome.settled += effort.settled();
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return outcomes;
+}
+
+// The limits of a candidate, the defaults of the tuned levels scaled by its factors
+json::ArrayPtr candidate_levels(const candidate_t& candidate) {
+  auto levels = json::array({});
+  for (const auto level : kTunedLevels) {
+    levels->emplace_back(json::map({
+        {"level", static_cast<uint64_t>(level)},
+        {"max_up_transitions", static_cast<uint64_t>(std::llround(
+                                   kDefaultMaxUpTransitions[level] * candidate.transitions))},
+        {"expansion_within_dist",
+         json::fixed_t{kDefaultExpansionWithinDist[level] * candidate.distance, 0}},
+    }));
+  }
+  return levels;
+}
+
+// A limits table with one candidate for the given groups
+json::MapPtr table(const std::vector<region_t>& regions,
+                   const std::vector<group_t>& groups,
+                   const std::vector<const candidate_t*>& chosen) {
+  auto regions_json = json::array({});
+  for (size_t r = 0; r < regions.size(); ++r) {
+    auto costings = json::map({});
+    for (size_t g = 0; g < groups.size(); ++g) {
+      if (groups[g].region == r && chosen[g]) {
+        costings->emplace(groups[g].costing, candidate_levels(*chosen[g]));
+      }
+    }
+    if (costings->empty()) {
+      continue;
+    }
+    const auto& bbox = regions[r].bbox;
+    regions_json->emplace_back(json::map({
+        {"name", regions[r].name},
+        {"bbox", json::array({json::fixed_t{bbox.minx(), 6}, json::fixed_t{bbox.miny(), 6},
+                              json::fixed_t{bbox.maxx(), 6}, json::fixed_t{bbox.maxy(), 6}})},
+        {"costings", costings},
+    }));
+  }
+  return json::map({{"regions", regions_json}});
+}
+
+// The config of the service without its limits table
+boost::property_tree::ptree without_table(const boost::property_tree::ptree& config) {
+  auto copy = config;
+  if (auto thor = copy.get_child_optional("thor")) {
+    thor->erase("hierarchy_limits_file");
+  }
+  return copy;
+}
+
+void write(const std::string& file, const json::MapPtr& json) {
+  std::ofstream out(file);
+  out << *json << std::endl;
+  if (!out) {
+    throw std::runtime_error("Couldn't write " + file);
+  }
+}
+
+} // namespace
+
+// Replays a sample of route requests with hierarchy pruning disabled and with a grid of scaled
+// hierarchy limits and writes, per region and costing, the limits that settle the fewest labels
+// while keeping the routes within a tolerance of the unlimited ones
+int main(int argc, char* argv[]) {
+  const auto program = filesystem::path(__FILE__).stem().string();
+  boost::property_tree::ptree pt;
+  std::vector<std::string> requests;
+  std::vector<region_t> regions;
+  std::vector<double> transition_factors, distance_factors;
+  std::string output;
+  double tolerance, max_suboptimal;
+  uint32_t concurrency;
+
+  try {
+    const auto hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    // clang-format off
+    cxxopts::Options options(
+      program,
+      program + " " + VALHALLA_VERSION + "\n\n"
+      "replays a sample of route requests without hierarchy pruning and with scaled hierarchy\n"
+      "limits and writes the limits per region and costing that settle the fewest labels while\n"
+      "the routes stay as good as the unlimited ones, for thor.hierarchy_limits_file.\n");
+
+    options.add_options()
+      ("h,help", "Print this help message.")
+      ("v,version", "Print the version of this software.")
+      ("c,config", "Valhalla configuration file", cxxopts::value<std::string>())
+      ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
+      ("r,requests", "A file of route requests, one json request per line.",
+        cxxopts::value<std::string>())
+      ("regions", "A json file of regions in the format of the limits table, the routes are "
+        "tuned per region they start and end in. One region for the world by default.",
+        cxxopts::value<std::string>())
+      ("o,output", "Where to write the limits table.",
+        cxxopts::value<std::string>()->default_value("hierarchy_limits.json"))
+      ("transition-factors", "Comma separated factors the default maximum up transitions are "
+        "scaled by.", cxxopts::value<std::string>()->default_value("0.25,0.5,1,2,4"))
+      ("distance-factors", "Comma separated factors the default expansion distances are scaled "
+        "by.", cxxopts::value<std::string>()->default_value("0.5,1,2"))
+      ("tolerance", "Share a route may cost more than the unlimited route and still count as "
+        "optimal.", cxxopts::value<double>()->default_value("0.01"))
+      ("max-suboptimal", "Share of the routes of a region and costing that may be suboptimal or "
+        "not found with the chosen limits.", cxxopts::value<double>()->default_value("0.02"))
+      ("j,concurrency", "Number of requests routed at once.",
+        cxxopts::value<uint32_t>()->default_value(std::to_string(hardware_threads)));
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (!parse_common_args(program, options, result, pt, "mjolnir.logging"))
+      return EXIT_SUCCESS;
+
+    if (!result.count("requests")) {
+      throw cxxopts::OptionException("A request file is required\n\n" + options.help());
+    }
+    requests = read_requests(result["requests"].as<std::string>());
+    if (result.count("regions")) {
+      regions = read_regions(result["regions"].as<std::string>());
+    } else {
+      regions.push_back({"world", AABB2<PointLL>(-180., -90., 180., 90.)});
+    }
+    output = result["output"].as<std::string>();
+    transition_factors = parse_factors(result["transition-factors"].as<std::string>());
+    distance_factors = parse_factors(result["distance-factors"].as<std::string>());
+    tolerance = result["tolerance"].as<double>();
+    max_suboptimal = result["max-suboptimal"].as<double>();
+    concurrency = std::max(1u, result["concurrency"].as<uint32_t>());
+  } catch (cxxopts::OptionException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // group the requests by the first region holding their origin and destination and their costing
+  std::vector<group_t> groups;
+  {
+    std::map<std::pair<size_t, std::string>, size_t> group_index;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      Api api;
+      try {
+        ParseApi(requests[i], Options::route, api);
+      } catch (const std::exception& e) {
+        LOG_WARN("Skipping request " + std::to_string(i) + ": " + e.what());
+        continue;
+      }
+      const auto& options = api.options();
+      if (options.locations_size() < 2) {
+        continue;
+      }
+      const auto& first = options.locations(0).ll();
+      const auto& last = options.locations(options.locations_size() - 1).ll();
+      const PointLL origin(first.lng(), first.lat()), destination(last.lng(), last.lat());
+      auto region = std::find_if(regions.begin(), regions.end(), [&](const region_t& r) {
+        return r.bbox.Contains(origin) && r.bbox.Contains(destination);
+      });
+      if (region == regions.end()) {
+        continue;
+      }
+      const std::pair<size_t, std::string> key{region - regions.begin(),
+                                                Costing_Enum_Name(options.costing_type())};
+      auto inserted = group_index.emplace(key, groups.size());
+      if (inserted.second) {
+        groups.push_back({key.first, key.second, {}});
+      }
+      groups[inserted.first->second].requests.push_back(i);
+    }
+  }
+  if (groups.empty()) {
+    std::cerr << "No request starts and ends in one of the regions" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // the routes to measure the others against, loki must not ignore disable_hierarchy_pruning
+  auto unlimited_config = without_table(pt);
+  unlimited_config.put("service_limits.max_distance_disable_hierarchy_culling",
+                       std::numeric_limits<float>::max());
+  LOG_INFO("Routing " + std::to_string(requests.size()) + " requests without hierarchy pruning");
+  const auto unlimited = replay(unlimited_config, requests, true, concurrency);
+  LOG_INFO("Routing with the default limits");
+  const auto defaults = replay(without_table(pt), requests, false, concurrency);
+
+  // every candidate is tried on all groups at once
+  std::vector<candidate_t> candidates;
+  for (const auto transitions : transition_factors) {
+    for (const auto distance : distance_factors) {
+      candidates.push_back({transitions, distance});
+    }
+  }
+  std::vector<std::vector<outcome_t>> tried;
+  for (size_t c = 0; c < candidates.size(); ++c) {
+    // a file per candidate, the workers of a process share the table of a file name
+    const auto file = output + ".candidate" + std::to_string(c);
+    write(file, table(regions, groups,
+                      std::vector<const candidate_t*>(groups.size(), &candidates[c])));
+    auto config = pt;
+    config.put("thor.hierarchy_limits_file", file);
+    LOG_INFO("Routing with " + std::to_string(candidates[c].transitions) +
+             " times the up transitions and " + std::to_string(candidates[c].distance) +
+             " times the expansion distances");
+    tried.emplace_back(replay(config, requests, false, concurrency));
+    filesystem::remove(file);
+  }
+
+  // mean settled labels and the share of suboptimal routes of a group under some outcomes
+  auto measure = [&](const group_t& group, const std::vector<outcome_t>& outcomes) {
+    uint64_t settled = 0, measured = 0, suboptimal = 0;
+    for (const auto i : group.requests) {
+      if (!unlimited[i].ok) {
+        continue;
+      }
+      ++measured;
+      settled += outcomes[i].settled;
+      if (!outcomes[i].ok || outcomes[i].cost > unlimited[i].cost * (1. + tolerance)) {
+        ++suboptimal;
+      }
+    }
+    return std::make_tuple(measured, measured ? static_cast<double>(settled) / measured : 0.,
+                           measured ? static_cast<double>(suboptimal) / measured : 0.);
+  };
+
+  // the candidate that settles the fewest labels and finds good enough routes, if it beats the
+  // defaults, the defaults are written otherwise so the table says they were checked
+  const candidate_t default_candidate{1., 1.};
+  std::vector<const candidate_t*> chosen(groups.size(), &default_candidate);
+  auto report = json::array({});
+  for (size_t g = 0; g < groups.size(); ++g) {
+    uint64_t measured;
+    double default_settled, default_suboptimal, unlimited_settled;
+    std::tie(measured, default_settled, default_suboptimal) = measure(groups[g], defaults);
+    std::tie(std::ignore, unlimited_settled, std::ignore) = measure(groups[g], unlimited);
+    double best_settled = default_settled, best_suboptimal = default_suboptimal;
+    for (size_t c = 0; c < candidates.size(); ++c) {
+      double settled, suboptimal;
+      std::tie(std::ignore, settled, suboptimal) = measure(groups[g], tried[c]);
+      if (suboptimal <= max_suboptimal && settled < best_settled) {
+        chosen[g] = &candidates[c];
+        best_settled = settled;
+        best_suboptimal = suboptimal;
+      }
+    }
+    report->emplace_back(json::map({
+        {"region", regions[groups[g].region].name},
+        {"costing", groups[g].costing},
+        {"requests", static_cast<uint64_t>(groups[g].requests.size())},
+        {"routed", measured},
+        {"unlimited_settled", json::fixed_t{unlimited_settled, 1}},
+        {"default_settled", json::fixed_t{default_settled, 1}},
+        {"default_suboptimal", json::fixed_t{default_suboptimal, 4}},
+        {"settled", json::fixed_t{best_settled, 1}},
+        {"suboptimal", json::fixed_t{best_suboptimal, 4}},
+        {"transition_factor", json::float_t{chosen[g]->transitions}},
+        {"distance_factor", json::float_t{chosen[g]->distance}},
+    }));
+  }
+
+  auto result = table(regions, groups, chosen);
+  result->emplace("tuning", report);
+  write(output, result);
+  std::cout << *report << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -1,20 +1,28 @@
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <string>
 #include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
 #include "baldr/location.h"
 #include "loki/worker.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/numa.h"
+#include "midgard/polyline2.h"
 #include "midgard/util.h"
 #include "odin/util.h"
 #include "odin/worker.h"
 #include "proto_conversions.h"
 #include "sif/costfactory.h"
 #include "thor/worker.h"
+#include "tyr/serializers.h"
 #include "worker.h"
 
 #include <boost/optional.hpp>
@@ -28,6 +36,14 @@ using namespace prime_server;
 
 namespace {
 
+// the size of the blocks a request arena allocates beyond its initial one
+constexpr size_t kRequestArenaBlockSize = 64 * 1024;
+
+// a week of departures a quarter of an hour apart at most, and not closer than a minute
+constexpr unsigned int kMaxProfileDepartures = 672;
+constexpr unsigned int kDefaultProfileInterval = 900;
+constexpr unsigned int kMinProfileInterval = 60;
+
 // clang-format off
 constexpr const char* HTTP_400 = "Bad Request";
 constexpr const char* HTTP_404 = "Not Found";
@@ -42,6 +58,7 @@ constexpr const char* OSRM_INVALID_VALUE = R"({"code":"InvalidValue","message":"
 constexpr const char* OSRM_NO_ROUTE = R"({"code":"NoRoute","message":"Impossible route between points"})";
 constexpr const char* OSRM_NO_SEGMENT = R"({"code":"NoSegment","message":"One of the supplied input coordinates could not snap to street segment."})";
 constexpr const char* OSRM_SHUTDOWN = R"({"code":"ServiceUnavailable","message":"The service is shutting down."})";
+constexpr const char* OSRM_OVERLOADED = R"({"code":"ServiceUnavailable","message":"Too many expensive requests, try again later."})";
 constexpr const char* OSRM_SERVER_ERROR = R"({"code":"InvalidUrl","message":"Failed to serialize route."})";
 constexpr const char* OSRM_DISTANCE_EXCEEDED = R"({"code":"DistanceExceeded","message":"Path distance exceeds the max distance limit."})";
 constexpr const char* OSRM_PERIMETER_EXCEEDED = R"({"code":"PerimeterExceeded","message":"Perimeter of avoid polygons exceeds the max limit."})";
@@ -70,6 +87,7 @@ const std::unordered_map<unsigned, valhalla::valhalla_exception_t> error_codes{
     {126, {126, "No shape provided", 400, HTTP_400, OSRM_INVALID_OPTIONS, "shape_required"}},
     {127, {127, "Recostings require a valid costing parameter", 400, HTTP_400, OSRM_INVALID_OPTIONS, "recosting_parse_failed"}},
     {128, {128, "Recostings require a unique 'name' field for each recosting", 400, HTTP_400, OSRM_INVALID_OPTIONS, "no_recosting_duplicate_names"}},
+    {129, {129, "Number of sources and targets must match for route_batch", 400, HTTP_400, OSRM_INVALID_OPTIONS, "batch_size_mismatch"}},
     {130, {130, "Failed to parse location", 400, HTTP_400, OSRM_INVALID_VALUE, "location_parse_failed"}},
     {131, {131, "Failed to parse source", 400, HTTP_400, OSRM_INVALID_VALUE, "source_parse_failed"}},
     {132, {132, "Failed to parse target", 400, HTTP_400, OSRM_INVALID_VALUE, "target_parse_failed"}},
@@ -83,6 +101,7 @@ const std::unordered_map<unsigned, valhalla::valhalla_exception_t> error_codes{
     {142, {142, "Arrive by not implemented for isochrones", 501, HTTP_501, OSRM_INVALID_VALUE, "no_arrive_by_isochrones"}},
     {143, {143, "ignore_closures in costing and exclude_closures in search_filter cannot both be specified", 400, HTTP_400, OSRM_INVALID_VALUE, "closures_conflict"}},
     {144, {144, "Action does not support expansion", 400, HTTP_400, OSRM_INVALID_VALUE, "no_action_for_expansion"}},
+    {145, {145, "No edge table found", 400, HTTP_400, OSRM_INVALID_VALUE, "wrong_edge_table"}},
     {150, {150, "Exceeded max locations", 400, HTTP_400, OSRM_INVALID_VALUE, "too_many_locations"}},
     {151, {151, "Exceeded max time", 400, HTTP_400, OSRM_INVALID_VALUE, "too_large_time"}},
     {152, {152, "Exceeded max contours", 400, HTTP_400, OSRM_INVALID_VALUE, "too_many_contours"}},
@@ -101,9 +120,13 @@ const std::unordered_map<unsigned, valhalla::valhalla_exception_t> error_codes{
     {165, {165, "Date and time required for destination for date_type of invariant", 400, HTTP_400, OSRM_INVALID_OPTIONS, "missing_invariant_date"}},
     {167, {167, "Exceeded maximum circumference for exclude_polygons", 400, HTTP_400, OSRM_PERIMETER_EXCEEDED, "too_large_polygon"}},
     {168, {168, "Invalid expansion property type", 400, HTTP_400, OSRM_INVALID_OPTIONS, "invalid_expansion_property"}},
+    {169, {169, "Population cells require a lat, lon and count", 400, HTTP_400, OSRM_INVALID_OPTIONS, "population_parse_failed"}},
     {170, {170, "Locations are in unconnected regions. Go check/edit the map at osm.org", 400, HTTP_400, OSRM_NO_ROUTE, "impossible_route"}},
     {171, {171, "No suitable edges near location", 400, HTTP_400, OSRM_NO_SEGMENT, "no_edges_near"}},
     {172, {172, "Exceeded breakage distance for all pairs", 400, HTTP_400, OSRM_BREAKAGE_EXCEEDED, "too_large_breakage_distance"}},
+    {173, {173, "Invalid locate field", 400, HTTP_400, OSRM_INVALID_OPTIONS, "invalid_locate_field"}},
+    {174, {174, "Invalid tile coordinates", 400, HTTP_400, OSRM_INVALID_VALUE, "invalid_tile"}},
+    {175, {175, "Zoom level is below the minimum of", 400, HTTP_400, OSRM_INVALID_VALUE, "too_small_tile_zoom"}},
     {199, {199, "Unknown", 400, HTTP_400, OSRM_INVALID_URL, "unknown"}},
     {200, {200, "Failed to parse intermediate request format", 500, HTTP_500, OSRM_INVALID_URL, "pbf_parse_failed"}},
     {201, {201, "Failed to parse TripLeg", 500, HTTP_500, OSRM_INVALID_URL, "trip_parse_failed"}},
@@ -124,6 +147,7 @@ const std::unordered_map<unsigned, valhalla::valhalla_exception_t> error_codes{
     {400, {400, "Unknown action", 400, HTTP_400, OSRM_INVALID_SERVICE, "wrong_action"}},
     {401, {401, "Failed to parse intermediate request format", 500, HTTP_500, OSRM_SERVER_ERROR, "options_parse_failed"}},
     {402, {402, "The service is shutting down", 503, HTTP_503, OSRM_SHUTDOWN, "shutting_down"}},
+    {403, {403, "Too many expensive requests, try again later", 503, HTTP_503, OSRM_OVERLOADED, "too_many_expensive_requests"}},
     {420, {420, "Failed to parse correlated location", 400, HTTP_400, OSRM_INVALID_VALUE, "candidate_parse_failed"}},
     {421, {421, "Failed to parse location", 400, HTTP_400, OSRM_INVALID_VALUE, "location_parse_failed"}},
     {422, {422, "Failed to parse source", 400, HTTP_400, OSRM_INVALID_VALUE, "source_parse_failed"}},
@@ -156,31 +180,82 @@ const std::unordered_map<int, std::string> warning_codes = {
   {204, R"("exclude_polygons" received invalid input, ignoring exclude_polygons)"},
   {205, R"("disable_hierarchy_pruning" exceeded the max distance, ignoring disable_hierarchy_pruning)"},
   {206, R"(CostMatrix does not consider "targets" with "date_time" set, ignoring date_time)"},
+  {207, R"("symmetric" needs the same sources and targets, no date_time and a costing without oneways, ignoring symmetric)"},
+  {208, R"(the matrix was not finished within the time limit, the cells of "incomplete_sources" and "incomplete_targets" are missing)"},
   // 3xx is used when costing options were specified but we had to change them internally for some reason
   {300, R"(Many:Many CostMatrix was requested, but server only allows 1:Many TimeDistanceMatrix)"},
   {301, R"(1:Many TimeDistanceMatrix was requested, but server only allows Many:Many CostMatrix)"},
 };
 // clang-format on
 
-rapidjson::Document from_string(const std::string& json, const valhalla_exception_t& e) {
-  rapidjson::Document d;
-  if (json.empty()) {
-    d.SetObject();
-    return d;
+// bytes of the pool a request document is parsed into before the pool has to allocate
+constexpr size_t kRequestPoolSize = 64 * 1024;
+
+// the copy of a request a document is parsed in situ in and the pool its values come from
+struct request_buffers_t {
+  std::string text;
+  std::vector<char> pool = std::vector<char>(kRequestPoolSize);
+  bool in_use = false;
+};
+
+/**
+ * A request json document parsed in situ, its strings point into a copy of the request rather than
+ * being copied out of it one by one, and its values come from a pool. The copy and the pool are
+ * kept per thread so that parsing a request hardly allocates, a request parsed while another one
+ * still is on the same thread gets buffers of its own.
+ */
+class request_document_t {
+public:
+  request_document_t()
+      : own_(thread_buffers().in_use ? new request_buffers_t : nullptr),
+        buffers_(own_ ? *own_ : thread_buffers()),
+        allocator_(buffers_.pool.data(), buffers_.pool.size()), document(&allocator_) {
+    buffers_.in_use = true;
   }
-  d.Parse(json.c_str());
-  if (d.HasParseError()) {
-    throw e;
+
+  ~request_document_t() {
+    buffers_.in_use = false;
   }
-  return d;
-}
+
+  // parses the json, an empty one is an empty object
+  void parse(const std::string& json, const valhalla_exception_t& e) {
+    if (json.empty()) {
+      document.SetObject();
+      return;
+    }
+    buffers_.text.assign(json);
+    document.ParseInsitu(&buffers_.text[0]);
+    if (document.HasParseError()) {
+      throw e;
+    }
+  }
+
+private:
+  static request_buffers_t& thread_buffers() {
+    static thread_local request_buffers_t buffers;
+    return buffers;
+  }
+
+  std::unique_ptr<request_buffers_t> own_;
+  request_buffers_t& buffers_;
+  rapidjson::MemoryPoolAllocator<> allocator_;
+
+public:
+  rapidjson::Document document;
+};
 
 bool add_date_to_locations(Options& options,
                            google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
                            const std::string& node) {
   if (options.has_date_time_case() && !locations.empty()) {
     auto dt = options.date_time_type();
-    if (options.action() != Options::sources_to_targets) {
+    if (options.action() == Options::isochrone_batch) {
+      // every location is the origin of an isochrone of its own
+      for (auto& loc : locations) {
+        loc.set_date_time(dt == Options::current ? "current" : options.date_time());
+      }
+    } else if (options.action() != Options::sources_to_targets &&
+               options.action() != Options::route_batch) {
       switch (dt) {
         case Options::current:
           locations.Mutable(0)->set_date_time("current");
@@ -658,7 +733,23 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
     else {
       options.clear_jsonp();
     }
+  } // only isochrones have a grid to send and its bytes cant be wrapped in jsonp either
+  else if (options.format() == Options::raster) {
+    if (options.action() != Options::isochrone) {
+      options.set_format(Options::json);
+    } else {
+      options.clear_jsonp();
+    }
+  } // and only matrices, expansions and heights have a binary format
+  else if (options.format() == Options::binary) {
+    if (options.action() != Options::sources_to_targets && options.action() != Options::expansion &&
+        options.action() != Options::height) {
+      options.set_format(Options::json);
+    } else {
+      options.clear_jsonp();
+    }
   }
+  options.set_compress(rapidjson::get<bool>(doc, "/compress", options.compress()));
 
   auto units = rapidjson::get_optional<std::string>(doc, "/units");
   if (units && ((*units == "miles") || (*units == "mi"))) {
@@ -669,7 +760,7 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
   options.set_reverse(rapidjson::get<bool>(doc, "/reverse", false));
 
   auto language = rapidjson::get_optional<std::string>(doc, "/language");
-  if (language && odin::get_locales().find(*language) != odin::get_locales().end()) {
+  if (language && odin::has_locale(*language)) {
     options.set_language(*language);
   }
   if (!options.has_language_case()) {
@@ -833,7 +924,8 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
   }
 
   // if any of the locations params have a date_time object in their locations, we'll remember
-  // only /sources_to_targets will parse more than one location collection and there it's fine
+  // only /sources_to_targets and /route_batch will parse more than one location collection and
+  // there it's fine
   bool had_date_time = false;
 
   // parse map matching location input and encoded_polyline for height actions
@@ -931,6 +1023,20 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
     }
   }
 
+  // the vector tile of the network, the path of a /tile/{z}/{x}/{y}.mvt request puts them here
+  if (options.action() == Options::tile) {
+    auto z = rapidjson::get_optional<uint32_t>(doc, "/z");
+    auto x = rapidjson::get_optional<uint32_t>(doc, "/x");
+    auto y = rapidjson::get_optional<uint32_t>(doc, "/y");
+    if (z && x && y) {
+      options.mutable_tile_xyz()->set_z(*z);
+      options.mutable_tile_xyz()->set_x(*x);
+      options.mutable_tile_xyz()->set_y(*y);
+    } else if (!pbf) {
+      throw valhalla_exception_t{174};
+    }
+  }
+
   // Elevation service options
   options.set_range(rapidjson::get(doc, "/range", options.range()));
   constexpr uint32_t MAX_HEIGHT_PRECISION = 2;
@@ -1006,6 +1112,9 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
     options.set_matrix_locations(std::numeric_limits<uint32_t>::max());
   }
 
+  // whether a matrix between the same locations may be computed one way and mirrored
+  options.set_symmetric(rapidjson::get<bool>(doc, "/symmetric", options.symmetric()));
+
   // get the avoid polygons in there
   auto rings_req =
       rapidjson::get_child_optional(doc, doc.HasMember("avoid_polygons") ? "/avoid_polygons"
@@ -1064,15 +1173,44 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
     }
   }
 
+  // the only properties of the located edges to return
+  auto locate_fields = rapidjson::get_child_optional(doc, "/locate_fields");
+  if (locate_fields && locate_fields->IsArray()) {
+    Options::LocateField locate_field;
+    for (const auto& field : locate_fields->GetArray()) {
+      if (!field.IsString() ||
+          !valhalla::Options_LocateField_Enum_Parse(std::string(field.GetString()), &locate_field)) {
+        throw valhalla_exception_t(173, field.IsString() ? std::string(field.GetString()) : "");
+      }
+      options.add_locate_fields(locate_field);
+    }
+  }
+
   // should the expansion track opposites?
   options.set_skip_opposites(rapidjson::get<bool>(doc, "/skip_opposites", options.skip_opposites()));
 
+  // should the binary expansion have the edge shapes?
+  options.set_expansion_shapes(
+      rapidjson::get<bool>(doc, "/expansion_shapes", options.expansion_shapes()));
+
+  // how many departures to time each route leg for and how far apart
+  auto profile_departures = rapidjson::get_optional<unsigned int>(doc, "/profile_departures");
+  if (profile_departures) {
+    options.set_profile_departures(std::min(*profile_departures, kMaxProfileDepartures));
+    options.set_profile_interval(
+        std::max(rapidjson::get<unsigned int>(doc, "/profile_interval", kDefaultProfileInterval),
+                 kMinProfileInterval));
+  }
+
   // get the contours in there
   parse_contours(doc, options.mutable_contours());
 
   // if specified, get the polygons boolean in there
   options.set_polygons(rapidjson::get<bool>(doc, "/polygons", options.polygons()));
 
+  // whether long isochrones may leave the local roads to the higher levels of the hierarchy
+  options.set_hierarchical(rapidjson::get<bool>(doc, "/hierarchical", options.hierarchical()));
+
   // if specified, get the denoise in there
   auto denoise =
       rapidjson::get<float>(doc, "/denoise", options.has_denoise_case() ? options.denoise() : 1.0);
@@ -1084,6 +1222,25 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
     options.set_generalize(*generalize);
   }
 
+  // a batch of isochrones may only want the metrics of the contours, maybe with the population
+  options.set_metrics_only(rapidjson::get<bool>(doc, "/metrics_only", options.metrics_only()));
+  auto population = rapidjson::get_child_optional(doc, "/population");
+  if (population && population->IsArray()) {
+    options.clear_population();
+    for (const auto& cell : population->GetArray()) {
+      auto lat = rapidjson::get_optional<double>(cell, "/lat");
+      auto lon = rapidjson::get_optional<double>(cell, "/lon");
+      auto count = rapidjson::get_optional<float>(cell, "/count");
+      if (!lat || !lon || !count) {
+        throw valhalla_exception_t{169};
+      }
+      auto* population_cell = options.add_population();
+      population_cell->mutable_ll()->set_lat(*lat);
+      population_cell->mutable_ll()->set_lng(*lon);
+      population_cell->set_count(*count);
+    }
+  }
+
   // if specified, get the show_locations boolean in there
   options.set_show_locations(rapidjson::get<bool>(doc, "/show_locations", options.show_locations()));
 
@@ -1130,6 +1287,16 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
     options.set_interpolation_distance(*interpolation_distance);
   }
 
+  // if specified, get the beam of the viterbi search in there
+  auto beam_width = rapidjson::get_optional<unsigned int>(doc, "/trace_options/beam_width");
+  if (beam_width) {
+    options.set_beam_width(*beam_width);
+  }
+  auto beam_cost_gap = rapidjson::get_optional<float>(doc, "/trace_options/beam_cost_gap");
+  if (beam_cost_gap) {
+    options.set_beam_cost_gap(*beam_cost_gap);
+  }
+
   // if specified, get the filter_action value in there
   auto filter_action_str = rapidjson::get_optional<std::string>(doc, "/filters/action");
   FilterAction filter_action;
@@ -1166,6 +1333,22 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
   if (options.action() != Options::trace_attributes && options.locations_size() > 2)
     options.set_alternates(0);
 
+  // whether an optimized route may end at any location, default false
+  options.set_open_end(rapidjson::get<bool>(doc, "/open_end", options.open_end()));
+
+  // zoom levels to also return the shape of each leg generalized for, others are ignored
+  auto shape_zooms = rapidjson::get_child_optional(doc, "/shape_zooms");
+  if (shape_zooms && shape_zooms->IsArray()) {
+    options.clear_shape_zooms();
+    for (const auto& zoom : shape_zooms->GetArray()) {
+      if (zoom.IsUint() && zoom.GetUint() <= midgard::kMaxGeneralizeZoom &&
+          std::find(options.shape_zooms().begin(), options.shape_zooms().end(), zoom.GetUint()) ==
+              options.shape_zooms().end()) {
+        options.add_shape_zooms(zoom.GetUint());
+      }
+    }
+  }
+
   // whether to return guidance_views, default false
   options.set_guidance_views(rapidjson::get<bool>(doc, "/guidance_views", options.guidance_views()));
 
@@ -1209,6 +1392,102 @@ void add_warning(valhalla::Api& api, unsigned code) {
   }
 }
 
+midgard::Finally<std::function<void()>>
+measure_phase_time(Api& api, const std::string& stage, const std::string& phase) {
+  auto start = std::chrono::steady_clock::now();
+  const auto allocations = midgard::thread_allocations();
+  return midgard::Finally<std::function<void()>>([&api, stage, phase, start, allocations]() {
+    const auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+    add_timing(api, stage, phase, elapsed.count());
+    add_allocations(api, stage + "." + phase, allocations);
+    if (!api.info().trace_id().empty()) {
+      add_trace_span(api, stage, stage + "." + phase, start, end,
+                     phase == "serialize" ? TraceSpan::serialize : TraceSpan::compute);
+    }
+  });
+}
+
+void add_timing(Api& api, const std::string& stage, const std::string& phase, double ms) {
+  const auto& action = Options_Action_Enum_Name(api.options().action());
+  auto* stat = api.mutable_info()->mutable_statistics()->Add();
+  stat->set_key(action + ".info." + stage + "." + phase + ".latency_ms");
+  stat->set_value(ms);
+  stat->set_type(timing);
+}
+
+void add_count(Api& api, const std::string& stage, const std::string& metric, double value) {
+  const auto& action = Options_Action_Enum_Name(api.options().action());
+  auto* stat = api.mutable_info()->mutable_statistics()->Add();
+  stat->set_key(action + ".info." + stage + "." + metric);
+  stat->set_value(value);
+  stat->set_type(count);
+}
+
+void add_allocations(Api& api,
+                     const std::string& stage,
+                     const midgard::allocation_counts_t& since) {
+  if (!midgard::counting_allocations()) {
+    return;
+  }
+  const auto now = midgard::thread_allocations();
+  add_count(api, stage, "allocations", now.count - since.count);
+  add_count(api, stage, "allocated_bytes", now.bytes - since.bytes);
+}
+
+service_metrics_t& service_metrics_t::get() {
+  static service_metrics_t metrics;
+  return metrics;
+}
+
+void service_metrics_t::add(const Info& info) {
+  // a phase can run more than once per request, we want the total of the request
+  std::unordered_map<std::string, std::pair<StatisticType, double>> totals;
+  for (const auto& stat : info.statistics()) {
+    if (stat.type() != timing && stat.type() != count) {
+      continue;
+    }
+    auto& total = totals.emplace(stat.key(), std::make_pair(stat.type(), 0.0)).first->second;
+    total.second += stat.value();
+  }
+
+  std::lock_guard<std::mutex> _(mutex);
+  for (const auto& total : totals) {
+    auto& metric = metrics[total.first];
+    metric.type = total.second.first;
+    ++metric.requests;
+    metric.sum += total.second.second;
+    metric.max = std::max(metric.max, total.second.second);
+    if (metric.type == timing) {
+      auto bucket = std::lower_bound(kBucketBounds.cbegin(), kBucketBounds.cend(),
+                                     total.second.second) -
+                    kBucketBounds.cbegin();
+      ++metric.buckets[bucket];
+    }
+  }
+}
+
+void service_metrics_t::fill(Status& status) const {
+  for (auto bound : kBucketBounds) {
+    status.add_metric_bucket_bounds(bound);
+  }
+
+  std::lock_guard<std::mutex> _(mutex);
+  for (const auto& kv : metrics) {
+    auto* metric = status.add_metrics();
+    metric->set_key(kv.first);
+    metric->set_type(kv.second.type);
+    metric->set_requests(kv.second.requests);
+    metric->set_sum(kv.second.sum);
+    metric->set_max(kv.second.max);
+    if (kv.second.type == timing) {
+      for (auto requests : kv.second.buckets) {
+        metric->add_buckets(requests);
+      }
+    }
+  }
+}
+
 std::string serialize_error(const valhalla_exception_t& exception, Api& request) {
   // get the http status
   std::stringstream body;
@@ -1266,11 +1545,64 @@ std::string serialize_error(const valhalla_exception_t& exception, Api& request)
 
 void ParseApi(const std::string& request, Options::Action action, valhalla::Api& api) {
   // maybe parse some json
-  auto document = from_string(request, valhalla_exception_t{100});
-  from_json(document, action, api);
+  request_document_t json;
+  json.parse(request, valhalla_exception_t{100});
+  from_json(json.document, action, api);
 }
 
 #ifdef HAVE_HTTP
+namespace {
+bool is_hex(const std::string& value, size_t offset, size_t count) {
+  return std::all_of(value.begin() + offset, value.begin() + offset + count, [](const char c) {
+    return std::isdigit(static_cast<unsigned char>(c)) || (c >= 'a' && c <= 'f');
+  });
+}
+
+// Continue the trace of the caller from a W3C traceparent header when the caller sampled it, the
+// header is 00-<trace id>-<parent id>-<flags>
+bool parse_traceparent(const http_request_t& request, valhalla::Api& api) {
+  auto traceparent = request.headers.find("traceparent");
+  if (traceparent == request.headers.end()) {
+    return false;
+  }
+  const auto& value = traceparent->second;
+  if (value.size() != 55 || value[2] != '-' || value[35] != '-' || value[52] != '-' ||
+      !is_hex(value, 0, 2) || value.compare(0, 2, "ff") == 0 || !is_hex(value, 3, 32) ||
+      !is_hex(value, 36, 16) || !is_hex(value, 53, 2) ||
+      value.compare(3, 32, std::string(32, '0')) == 0 ||
+      value.compare(36, 16, std::string(16, '0')) == 0) {
+    LOG_WARN("Ignoring the invalid traceparent header " + value);
+    return false;
+  }
+  if (!(std::stoi(value.substr(53, 2), nullptr, 16) & 1)) {
+    return false;
+  }
+  api.mutable_info()->set_trace_id(value.substr(3, 32));
+  api.mutable_info()->set_parent_span_id(value.substr(36, 16));
+  return true;
+}
+
+// Trace the request if it asks for it, the id names the trace file so it may only have characters
+// that are safe in a file name
+void parse_trace_id(const http_request_t& request, valhalla::Api& api) {
+  if (parse_traceparent(request, api)) {
+    return;
+  }
+  auto trace = request.headers.find("X-Valhalla-Trace");
+  if (trace == request.headers.end()) {
+    return;
+  }
+  const auto& id = trace->second;
+  if (id.empty() || id.size() > 64 || !std::all_of(id.begin(), id.end(), [](const char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+      })) {
+    LOG_WARN("Ignoring the X-Valhalla-Trace header, it is not up to 64 letters, digits, - or _");
+    return;
+  }
+  api.mutable_info()->set_trace_id(id);
+}
+} // namespace
+
 void ParseApi(const http_request_t& request, valhalla::Api& api) {
   // block all but get and post
   if (request.method != method_t::POST && request.method != method_t::GET) {
@@ -1281,10 +1613,22 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
   api.Clear();
   api.mutable_info()->set_is_service(true);
 
-  // get the action
+  // get the action, a vector tile has its coordinates in the path
   Options::Action action = static_cast<Options::Action>(Options::Action_ARRAYSIZE);
-  if (!request.path.empty())
+  std::vector<std::string> tile_xyz;
+  if (request.path.compare(0, 6, "/tile/") == 0) {
+    action = Options::tile;
+    auto path = request.path.substr(6);
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".mvt") == 0) {
+      path.resize(path.size() - 4);
+    }
+    std::istringstream parts(path);
+    for (std::string part; std::getline(parts, part, '/');) {
+      tile_xyz.push_back(part);
+    }
+  } else if (!request.path.empty()) {
     Options_Action_Enum_Parse(request.path.substr(1), &action);
+  }
 
   // if its a protobuf mime go with that
   auto pbf_content = request.headers.find("Content-Type");
@@ -1292,6 +1636,12 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
     if (!api.ParseFromString(request.body)) {
       throw valhalla_exception_t{103};
     }
+    // only the header asks for a trace
+    api.mutable_info()->clear_trace_id();
+    api.mutable_info()->clear_trace();
+    api.mutable_info()->clear_parent_span_id();
+    api.mutable_info()->clear_handoff_unix_ns();
+    parse_trace_id(request, api);
     // validate the options
     rapidjson::Document dummy;
     dummy.SetObject();
@@ -1299,25 +1649,20 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
     return;
   }
 
+  parse_trace_id(request, api);
+
   // parse the json input
-  rapidjson::Document document;
+  request_document_t parsed;
+  auto& document = parsed.document;
   auto& allocator = document.GetAllocator();
   const auto& json = request.query.find("json");
   if (json != request.query.end() && json->second.size() && json->second.front().size()) {
-    document.Parse(json->second.front().c_str());
-  } // no json parameter, check the body
-  else if (!request.body.empty()) {
-    document.Parse(request.body.c_str());
-  } // no json at all
+    parsed.parse(json->second.front(), valhalla_exception_t{100});
+  } // no json parameter, check the body, or no json at all
   else {
-    document.SetObject();
+    parsed.parse(request.body, valhalla_exception_t{100});
   }
 
-  // if parsing failed
-  if (document.HasParseError()) {
-    throw valhalla_exception_t{100};
-  };
-
   // throw the query params into the rapidjson doc
   for (const auto& kv : request.query) {
     // skip json or empty entries
@@ -1339,6 +1684,16 @@ void ParseApi(const http_request_t& request, valhalla::Api& api) {
     document.AddMember({kv.first, allocator}, array, allocator);
   }
 
+  // the coordinates of the vector tile from the path
+  if (tile_xyz.size() == 3) {
+    for (const auto* key : {"z", "x", "y"}) {
+      document.RemoveMember(key);
+    }
+    document.AddMember("z", {tile_xyz[0], allocator}, allocator);
+    document.AddMember("x", {tile_xyz[1], allocator}, allocator);
+    document.AddMember("y", {tile_xyz[2], allocator}, allocator);
+  }
+
   // parse out the options
   from_json(document, action, api);
 }
@@ -1360,14 +1715,69 @@ worker_t::result_t serialize_error(const valhalla_exception_t& exception,
   return result;
 }
 
+namespace {
+// the content type of the format the request asked for
+const worker::content_type& response_mime(const Api& request) {
+  auto fmt = request.options().format();
+  if (request.options().action() == Options::tile) {
+    return worker::MVT_MIME;
+  }
+  return fmt == Options::json || fmt == Options::osrm
+             ? (request.options().action() == Options::route_batch ||
+                        request.options().action() == Options::isochrone_batch
+                    ? worker::NDJSON_MIME
+                    : worker::JSON_MIME)
+             : (fmt == Options::pbf                               ? worker::PBF_MIME
+                : fmt == Options::raster || fmt == Options::binary ? worker::BINARY_MIME
+                                                                   : worker::GPX_MIME);
+}
+
+// the allocations of each stage and phase of the request as stage=count/bytes, empty unless they
+// are counted
+std::string allocations_header(const Api& request) {
+  if (!midgard::counting_allocations()) {
+    return "";
+  }
+  std::vector<std::pair<std::string, std::pair<uint64_t, uint64_t>>> stages;
+  for (const auto& stat : request.info().statistics()) {
+    const auto info = stat.key().find(".info.");
+    const auto dot = stat.key().rfind('.');
+    const auto metric = stat.key().substr(dot + 1);
+    if (info == std::string::npos || (metric != "allocations" && metric != "allocated_bytes")) {
+      continue;
+    }
+    const auto stage = stat.key().substr(info + 6, dot - info - 6);
+    auto found = std::find_if(stages.begin(), stages.end(),
+                              [&stage](const auto& s) { return s.first == stage; });
+    if (found == stages.end()) {
+      found = stages.emplace(stages.end(), stage, std::make_pair<uint64_t, uint64_t>(0, 0));
+    }
+    (metric == "allocations" ? found->second.first : found->second.second) += stat.value();
+  }
+  std::string header;
+  for (const auto& stage : stages) {
+    header += (header.empty() ? "" : ",") + stage.first + "=" +
+              std::to_string(stage.second.first) + "/" + std::to_string(stage.second.second);
+  }
+  return header;
+}
+
+// the headers every successful response has
+headers_t response_headers(const Api& request) {
+  headers_t headers{CORS, response_mime(request)};
+  auto allocations = allocations_header(request);
+  if (!allocations.empty()) {
+    headers.emplace("X-Valhalla-Allocations", std::move(allocations));
+  }
+  return headers;
+}
+} // namespace
+
 worker_t::result_t
 to_response(const std::string& data, http_request_info_t& request_info, const Api& request) {
   // try to get all the proper headers
   auto fmt = request.options().format();
-  const auto& mime = fmt == Options::json || fmt == Options::osrm
-                         ? worker::JSON_MIME
-                         : (fmt == Options::pbf ? worker::PBF_MIME : worker::GPX_MIME);
-  headers_t headers{CORS, mime};
+  headers_t headers = response_headers(request);
   if (fmt == Options::gpx)
     headers.insert(ATTACHMENT);
 
@@ -1392,6 +1802,38 @@ to_response(const std::string& data, http_request_info_t& request_info, const Ap
   return result;
 }
 
+worker_t::result_t
+to_response(std::list<std::string>&& chunks, http_request_info_t& request_info, const Api& request) {
+  // jsonp has to wrap the whole thing and http 1.0 clients dont know chunked transfer encoding
+  if (chunks.size() < 2 || request.options().has_jsonp_case() || request_info.version == 0) {
+    return to_response(tyr::joinChunks(std::move(chunks)), request_info, request);
+  }
+
+  // the head has no content length, the body follows in as many messages as there are pieces
+  http_response_t response(200, "OK", "", response_headers(request));
+  response.from_info(request_info);
+  std::string head = response.version + " 200 OK\r\n";
+  for (const auto& header : response.headers) {
+    head += header.first + ": " + header.second + "\r\n";
+  }
+  head += "Transfer-Encoding: chunked\r\n\r\n";
+
+  worker_t::result_t result{false, std::list<std::string>{std::move(head)}, ""};
+  for (auto& chunk : chunks) {
+    // an empty chunk would end the body early
+    if (chunk.empty()) {
+      continue;
+    }
+    std::ostringstream size;
+    size << std::hex << chunk.size() << "\r\n";
+    chunk.insert(0, size.str());
+    chunk += "\r\n";
+    result.messages.emplace_back(std::move(chunk));
+  }
+  result.messages.emplace_back("0\r\n\r\n");
+  return result;
+}
+
 #endif
 
 // TODO: when we want to use this in mjolnir too we can move this into a private header
@@ -1419,7 +1861,42 @@ struct statsd_client_t : public Statsd::StatsdClient {
   std::vector<std::string> tags;
 };
 
-service_worker_t::service_worker_t(const boost::property_tree::ptree& conf) : interrupt(nullptr) {
+request_arena_t::request_arena_t(const boost::property_tree::ptree& config)
+    : block_size(config.get<size_t>("httpd.service.request_arena_bytes", 1 << 20)) {
+  if (block_size == 0) {
+    return;
+  }
+  block.reset(new char[block_size]);
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block.get();
+  options.initial_block_size = block_size;
+  // a long route makes messages by the hundred thousand so the arena grows in large blocks
+  options.start_block_size = kRequestArenaBlockSize;
+  options.max_block_size = kRequestArenaBlockSize;
+  arena = std::make_unique<google::protobuf::Arena>(options);
+}
+
+Api& request_arena_t::next() {
+  reset();
+  if (!arena) {
+    api = std::make_unique<Api>();
+    return *api;
+  }
+  return *google::protobuf::Arena::CreateMessage<Api>(arena.get());
+}
+
+void request_arena_t::reset() {
+  // frees every block but the initial one, which the arena starts over in
+  if (arena) {
+    arena->Reset();
+  }
+  api.reset();
+}
+
+service_worker_t::service_worker_t(const boost::property_tree::ptree& conf)
+    : interrupt(nullptr), result_cache(result_cache_t::shared(conf)), request_arena(conf),
+      trace_sink(trace_sink_t::make(conf)),
+      trace_sample_rate(conf.get<double>("httpd.service.trace_sample_rate", 0)) {
   if (conf.count("statsd")) {
     statsd_client = std::make_unique<statsd_client_t>(conf);
   }
@@ -1430,6 +1907,7 @@ void service_worker_t::set_interrupt(const std::function<void()>* interrupt_func
   interrupt = interrupt_function;
 }
 void service_worker_t::cleanup() {
+  request_arena.reset();
   if (statsd_client) {
     // sends metrics to statsd server over udp
     statsd_client->flush();
@@ -1437,7 +1915,12 @@ void service_worker_t::cleanup() {
 }
 void service_worker_t::enqueue_statistics(Api& api) const {
   // nothing to do without stats
-  if (!statsd_client || !api.has_info() || api.info().statistics().empty())
+  if (!api.has_info() || api.info().statistics().empty())
+    return;
+
+  // keep them for the status of the process
+  service_metrics_t::get().add(api.info());
+  if (!statsd_client)
     return;
 
   // these have been filled out as the request progressed through the system
@@ -1473,7 +1956,12 @@ void service_worker_t::enqueue_statistics(Api& api) const {
 midgard::Finally<std::function<void()>> service_worker_t::measure_scope_time(Api& api) const {
   // we copy the captures that could go out of scope
   auto start = std::chrono::steady_clock::now();
-  return midgard::Finally<std::function<void()>>([this, &api, start]() {
+  const auto* reader = tile_reader();
+  const auto tiles = reader ? reader->GetTileCounts() : baldr::GraphReader::TileCounts{};
+  const auto allocations = midgard::thread_allocations();
+  const auto node = midgard::current_numa_node();
+  return midgard::Finally<std::function<void()>>([this, &api, start, reader, tiles, allocations,
+                                                  node]() {
     auto elapsed = std::chrono::steady_clock::now() - start;
     auto e = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(elapsed).count();
     const auto& action = Options_Action_Enum_Name(api.options().action());
@@ -1482,9 +1970,33 @@ midgard::Finally<std::function<void()>> service_worker_t::measure_scope_time(Api
     stat->set_key(action + ".info." + service_name() + ".latency_ms");
     stat->set_value(e);
     stat->set_type(timing);
+
+    // the tiles the action needed and how many of them had to be loaded
+    if (reader) {
+      const auto& now = reader->GetTileCounts();
+      add_count(api, service_name(), "tiles_fetched", now.fetched - tiles.fetched);
+      add_count(api, service_name(), "tile_cache_misses", now.cache_misses - tiles.cache_misses);
+      if (now.replicated > tiles.replicated) {
+        add_count(api, service_name(), "tiles_replicated", now.replicated - tiles.replicated);
+      }
+    }
+
+    // which NUMA node the request ran on and whether the thread was moved off it on the way
+    if (midgard::numa_node_count() > 1) {
+      add_count(api, service_name(), "numa_node_" + std::to_string(node), 1);
+      add_count(api, service_name(), "numa_migrations", midgard::current_numa_node() != node);
+    }
+    add_allocations(api, service_name(), allocations);
+    add_trace_span(api, service_name(), service_name(), start, start + elapsed);
   });
 }
 
+void service_worker_t::export_trace(const Api& api) const {
+  if (trace_sink && !api.info().trace_id().empty()) {
+    trace_sink->consume(api);
+  }
+}
+
 void service_worker_t::started() {
   if (statsd_client) {
     statsd_client->count("none.info." + service_name() + ".worker_started", 1, 1.f,
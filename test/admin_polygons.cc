@@ -0,0 +1,104 @@
+#include "mjolnir/admin.h"
+#include "baldr/tilehierarchy.h"
+
+#include "test.h"
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+PolygonIndex::Record record(uint32_t id, const std::string& wkt) {
+  PolygonIndex::Record record;
+  record.id = id;
+  boost::geometry::read_wkt(wkt, record.geometry);
+  return record;
+}
+
+// two timezones split at 5 degrees east and one far away
+PolygonIndex timezones() {
+  std::vector<PolygonIndex::Record> records;
+  records.push_back(record(7, "MULTIPOLYGON(((0 0,5 0,5 10,0 10,0 0)))"));
+  records.push_back(record(3, "MULTIPOLYGON(((5 0,10 0,10 10,5 10,5 0)))"));
+  records.push_back(record(9, "MULTIPOLYGON(((50 50,60 50,60 60,50 60,50 50)))"));
+  return PolygonIndex(std::move(records));
+}
+
+TEST(PolygonIndex, ClipsToTheBox) {
+  const auto index = timezones();
+  EXPECT_EQ(index.size(), 3);
+
+  const auto clipped = index.Clip(AABB2<PointLL>(4, 4, 6, 6));
+  ASSERT_EQ(clipped.size(), 2);
+  // in the order they were loaded, whatever the tree returns
+  EXPECT_EQ(clipped[0].first->id, 7);
+  EXPECT_EQ(clipped[1].first->id, 3);
+  EXPECT_NEAR(boost::geometry::area(clipped[0].second), 2., 1e-9);
+  EXPECT_NEAR(boost::geometry::area(clipped[1].second), 2., 1e-9);
+
+  EXPECT_TRUE(index.Clip(AABB2<PointLL>(20, 20, 30, 30)).empty());
+}
+
+TEST(PolygonIndex, TimeZonesOfATile) {
+  const auto index = timezones();
+
+  auto polys = GetTimeZones(index, AABB2<PointLL>(4, 4, 6, 6));
+  ASSERT_EQ(polys.size(), 2);
+  EXPECT_EQ(GetMultiPolyId(polys, PointLL(4.5, 5)), 7);
+  EXPECT_EQ(GetMultiPolyId(polys, PointLL(5.5, 5)), 3);
+  // on the edge of the tile
+  EXPECT_EQ(GetMultiPolyId(polys, PointLL(6, 6)), 3);
+
+  polys = GetTimeZones(index, AABB2<PointLL>(51, 51, 52, 52));
+  ASSERT_EQ(polys.size(), 1);
+  EXPECT_EQ(polys.begin()->first, 9);
+}
+
+TEST(PolygonIndex, TilePieces) {
+  // a local tile with one timezone in its western half and another one covering all of it
+  const auto& tiling = TileHierarchy::levels().back().tiles;
+  const auto tileid = tiling.TileId(PointLL(5.1, 52.1));
+  const auto bounds = tiling.TileBounds(tileid);
+  const double middle = (bounds.minx() + bounds.maxx()) / 2;
+  std::vector<PolygonIndex::Record> records;
+  records.emplace_back().id = 3;
+  records.emplace_back().id = 7;
+  PolygonIndex::tile_pieces_t tiles;
+  multi_polygon_type west;
+  west.resize(1);
+  boost::geometry::convert(box_type(point_type(bounds.minx(), bounds.miny()),
+                                    point_type(middle, bounds.maxy())),
+                           west.front());
+  // in another order than the records
+  tiles[tileid].emplace_back(1, multi_polygon_type{});
+  tiles[tileid].emplace_back(0, west);
+  const PolygonIndex index(std::move(records), std::move(tiles));
+
+  const double tile_area = bounds.Width() * bounds.Height();
+  auto clipped = index.Clip(bounds);
+  ASSERT_EQ(clipped.size(), 2);
+  EXPECT_EQ(clipped[0].first->id, 3);
+  EXPECT_EQ(clipped[1].first->id, 7);
+  EXPECT_NEAR(boost::geometry::area(clipped[0].second), tile_area / 2, 1e-6);
+  EXPECT_NEAR(boost::geometry::area(clipped[1].second), tile_area, 1e-6);
+
+  // a box in the east of the tile only has the timezone covering all of it
+  const AABB2<PointLL> east(middle + 0.01, bounds.miny(), bounds.maxx(), bounds.maxy());
+  clipped = index.Clip(east);
+  ASSERT_EQ(clipped.size(), 1);
+  EXPECT_EQ(clipped[0].first->id, 7);
+  EXPECT_NEAR(boost::geometry::area(clipped[0].second), east.Width() * east.Height(), 1e-6);
+
+  const auto polys = GetTimeZones(index, bounds);
+  EXPECT_EQ(GetMultiPolyId(polys, PointLL(bounds.minx() + 0.01, bounds.miny() + 0.01)), 3);
+  EXPECT_EQ(GetMultiPolyId(polys, PointLL(bounds.maxx() - 0.01, bounds.miny() + 0.01)), 7);
+
+  // nothing outside of the tiles that were cut
+  EXPECT_TRUE(index.Clip(AABB2<PointLL>(50, 50, 51, 51)).empty());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,65 @@
+#include "midgard/allocations.h"
+#include "test.h"
+#include "worker.h"
+
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace valhalla;
+
+namespace {
+
+TEST(Allocations, thread_counts) {
+  const auto before = midgard::thread_allocations();
+  auto numbers = std::make_unique<std::vector<int>>(1000);
+  const auto after = midgard::thread_allocations();
+  if (!midgard::counting_allocations()) {
+    EXPECT_EQ(after.count, 0u);
+    EXPECT_EQ(after.bytes, 0u);
+    return;
+  }
+  EXPECT_EQ(after.count - before.count, 2u);
+  EXPECT_EQ(after.bytes - before.bytes, sizeof(std::vector<int>) + 1000 * sizeof(int));
+
+  // another thread has counts of its own
+  midgard::allocation_counts_t other{};
+  std::thread([&other]() {
+    const auto start = midgard::thread_allocations();
+    auto number = std::make_unique<int>(7);
+    const auto end = midgard::thread_allocations();
+    other = {end.count - start.count, end.bytes - start.bytes};
+  }).join();
+  EXPECT_EQ(other.count, 1u);
+  EXPECT_EQ(other.bytes, sizeof(int));
+}
+
+TEST(Allocations, statistics) {
+  Api api;
+  api.mutable_options()->set_action(Options::route);
+  {
+    auto _ = measure_phase_time(api, "thor", "expansion");
+    std::vector<char> bytes(4096);
+  }
+
+  // the phase has a latency and, only when they are counted, its allocations
+  std::map<std::string, double> stats;
+  for (const auto& stat : api.info().statistics()) {
+    stats[stat.key()] = stat.value();
+  }
+  EXPECT_EQ(stats.count("route.info.thor.expansion.latency_ms"), 1u);
+  if (!midgard::counting_allocations()) {
+    EXPECT_EQ(stats.count("route.info.thor.expansion.allocations"), 0u);
+    return;
+  }
+  EXPECT_GE(stats["route.info.thor.expansion.allocations"], 1);
+  EXPECT_GE(stats["route.info.thor.expansion.allocated_bytes"], 4096);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
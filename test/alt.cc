@@ -0,0 +1,135 @@
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+#include "baldr/altbounds.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "loki/worker.h"
+#include "mjolnir/altbuilder.h"
+#include "sif/costfactory.h"
+#include "thor/bidirectional_astar.h"
+#include "thor/unidirectional_astar.h"
+#include "thor/worker.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::thor;
+
+namespace {
+
+const auto config = test::make_config("test/data/utrecht_tiles");
+const std::string alt_file = "test/data/utrecht_alt.bin";
+
+std::shared_ptr<const AltBounds> build_alt() {
+  static bool built = false;
+  if (!built) {
+    mjolnir::AltBuilder::Build(config.get_child("mjolnir"), alt_file, 8);
+    built = true;
+  }
+  return AltBounds::get(alt_file);
+}
+
+// the cost of the best path
+template <class Algorithm>
+float route(GraphReader& reader,
+            loki_worker_t& loki_worker,
+            const std::shared_ptr<const AltBounds>& alt_bounds,
+            const std::string& request_json) {
+  Api request;
+  ParseApi(request_json, Options::route, request);
+  loki_worker.route(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  sif::TravelMode mode;
+  auto mode_costing = sif::CostFactory().CreateModeCosting(request.options(), mode);
+  valhalla::Location origin = request.options().locations(0);
+  valhalla::Location dest = request.options().locations(1);
+
+  Algorithm algorithm;
+  algorithm.set_alt_bounds(alt_bounds);
+  auto path = algorithm.GetBestPath(origin, dest, reader, mode_costing, mode).front();
+  EXPECT_FALSE(path.empty());
+  return path.empty() ? 0.f : path.back().elapsed_cost.cost;
+}
+
+TEST(Alt, Bounds) {
+  auto alt_bounds = build_alt();
+  ASSERT_NE(alt_bounds, nullptr);
+  ASSERT_EQ(alt_bounds->landmark_count(), 8);
+
+  // each landmark is at distance 0 of itself and further away from the others
+  for (uint32_t i = 0; i < alt_bounds->landmark_count(); ++i) {
+    const auto* landmark = alt_bounds->Distances(GraphId(alt_bounds->landmarks()[i]));
+    ASSERT_NE(landmark, nullptr);
+    EXPECT_EQ(landmark[i], 0.f);
+    EXPECT_EQ(alt_bounds->LowerBound(landmark, landmark), 0.f);
+    for (uint32_t j = 0; j < alt_bounds->landmark_count(); ++j) {
+      if (i != j) {
+        EXPECT_GT(landmark[j], 0.f);
+      }
+    }
+  }
+
+  // a node on another level has the same distances
+  GraphReader reader(config.get_child("mjolnir"));
+  bool transitions = false;
+  for (const auto& tile_id : reader.GetTileSet(2)) {
+    auto tile = reader.GetGraphTile(tile_id);
+    for (GraphId node = tile_id; node.id() < tile->header()->nodecount(); ++node) {
+      const auto* info = tile->node(node);
+      for (uint32_t i = 0; i < info->transition_count(); ++i) {
+        const auto* distances = alt_bounds->Distances(node);
+        const auto* other =
+            alt_bounds->Distances(tile->transition(info->transition_index() + i)->endnode());
+        ASSERT_NE(other, nullptr);
+        EXPECT_EQ(alt_bounds->LowerBound(distances, other), 0.f);
+        transitions = true;
+      }
+    }
+  }
+  EXPECT_TRUE(transitions);
+
+  // there are no distances past the graph
+  EXPECT_EQ(alt_bounds->Distances(GraphId(0, 2, 0)), nullptr);
+  EXPECT_EQ(alt_bounds->Distances(GraphId(0, 3, 0)), nullptr);
+}
+
+TEST(Alt, SamePaths) {
+  auto alt_bounds = build_alt();
+  ASSERT_NE(alt_bounds, nullptr);
+  loki_worker_t loki_worker(config);
+  GraphReader reader(config.get_child("mjolnir"));
+
+  const std::vector<std::string> requests = {
+      R"({"locations":[{"lat":52.099247,"lon":5.115873},{"lat":52.062043,"lon":5.110077}],"costing":"auto"})",
+      R"({"locations":[{"lat":52.110116,"lon":5.135983},{"lat":52.067372,"lon":5.025595}],"costing":"auto"})",
+      R"({"locations":[{"lat":52.074073,"lon":5.112481},{"lat":52.108956,"lon":5.095273}],"costing":"bicycle"})",
+      R"({"locations":[{"lat":52.101841,"lon":5.114576},{"lat":52.103607,"lon":5.114598}],"costing":"pedestrian"})",
+  };
+
+  // the landmarks only make the searches look at fewer edges, the best paths stay the same
+  for (const auto& request : requests) {
+    auto plain = route<TimeDepForward>(reader, loki_worker, nullptr, request);
+    auto alt = route<TimeDepForward>(reader, loki_worker, alt_bounds, request);
+    EXPECT_NEAR(alt, plain, plain * 0.001f) << request;
+
+    plain = route<TimeDepReverse>(reader, loki_worker, nullptr, request);
+    alt = route<TimeDepReverse>(reader, loki_worker, alt_bounds, request);
+    EXPECT_NEAR(alt, plain, plain * 0.001f) << request;
+
+    plain = route<BidirectionalAStar>(reader, loki_worker, nullptr, request);
+    alt = route<BidirectionalAStar>(reader, loki_worker, alt_bounds, request);
+    EXPECT_NEAR(alt, plain, plain * 0.001f) << request;
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
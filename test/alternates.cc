@@ -8,6 +8,7 @@
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "odin/worker.h"
+#include "thor/alternates.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
 #include <boost/property_tree/ptree.hpp>
@@ -85,3 +86,33 @@ TEST(Alternates, test_one_alternate) {
 TEST(Alternates, test_two_alternates) {
   test_alternates(2);
 }
+
+TEST(Alternates, test_validate_by_labels) {
+  DirectedEdge edge;
+  const auto label = [&edge](uint32_t pred, float cost) {
+    return sif::BDEdgeLabel(pred, {}, {}, &edge, {cost, cost}, cost, 0, sif::TravelMode::kDrive, {},
+                            false, false, false, sif::InternalTurn::kNoTurn, kInvalidRestriction);
+  };
+  // the optimal path goes through the forward labels 0, 1, 2 and the reverse labels 1, 0 and the
+  // candidates branch off after the forward label 1 and join at the reverse label 0
+  std::vector<sif::BDEdgeLabel> forward = {label(kInvalidLabel, 10), label(0, 20), label(1, 30),
+                                           label(1, 40), label(3, 100)};
+  std::vector<sif::BDEdgeLabel> reverse = {label(kInvalidLabel, 5), label(0, 15), label(1, 25),
+                                           label(0, 60)};
+  LabelPath optimal{{true, true, true, false, false},
+                    {true, true, false, false},
+                    {{0, 0.f}, {1, 100.f}, {2, 200.f}},
+                    {{0, 0.f}, {1, 100.f}},
+                    30.f,
+                    15.f};
+  std::vector<std::vector<PathInfo>> paths = {
+      {PathInfo(sif::TravelMode::kDrive, {45.f, 45.f}, {}, 0, 400.f)}};
+
+  // shares 100m and its detour costs as much as the one of the optimal path
+  EXPECT_TRUE(validate_alternate_by_labels({optimal}, paths, forward, reverse, 3, 3, 0.75f));
+  EXPECT_FALSE(validate_alternate_by_labels({optimal}, paths, forward, reverse, 3, 3, 0.2f));
+  // a detour four times as costly
+  EXPECT_FALSE(validate_alternate_by_labels({optimal}, paths, forward, reverse, 4, 3, 0.75f));
+  // nothing to compare with yet
+  EXPECT_TRUE(validate_alternate_by_labels({}, {}, forward, reverse, 4, 3, 0.75f));
+}
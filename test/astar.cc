@@ -1559,6 +1559,57 @@ TEST(Astar, BiDirTrivial) {
   EXPECT_LT(path.front().elapsed_cost.secs, 1);
 }
 
+TEST(BiDiAstar, test_parallel_searches) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", "test/data/utrecht_tiles");
+  conf.put<unsigned long>("mjolnir.id_table_size", 1000);
+  vb::GraphReader graph_reader(conf);
+
+  Options options;
+  create_costing_options(options, Costing::auto_);
+  vs::TravelMode mode;
+  auto mode_costing = vs::CostFactory().CreateModeCosting(options, mode);
+
+  // run both searches at the same time for every route
+  boost::property_tree::ptree thor_conf;
+  thor_conf.put("bidirectional_parallel_distance", 0.001f);
+  vt::BidirectionalAStar serial, parallel(thor_conf, conf);
+
+  const std::vector<std::pair<vm::PointLL, vm::PointLL>> routes = {
+      {{5.115873, 52.099247}, {5.110077, 52.062043}},
+      {{5.135983, 52.110116}, {5.025595, 52.067372}},
+      {{5.112481, 52.074073}, {5.095273, 52.108956}},
+  };
+  for (const auto& route : routes) {
+    std::vector<valhalla::baldr::Location> locations{vb::Location(route.first),
+                                                     vb::Location(route.second)};
+    const auto projections = vk::Search(locations, graph_reader, mode_costing[int(mode)]);
+    options.clear_locations();
+    for (const auto& loc : locations) {
+      PathLocation::toPBF(projections.at(loc), options.mutable_locations()->Add(), graph_reader);
+    }
+
+    auto expected = serial
+                        .GetBestPath(*options.mutable_locations(0), *options.mutable_locations(1),
+                                     graph_reader, mode_costing, mode)
+                        .front();
+    serial.Clear();
+    ASSERT_FALSE(expected.empty());
+
+    // the searches meet in other places but find paths as good, also when reused
+    for (int i = 0; i < 2; ++i) {
+      auto path = parallel
+                      .GetBestPath(*options.mutable_locations(0), *options.mutable_locations(1),
+                                   graph_reader, mode_costing, mode)
+                      .front();
+      parallel.Clear();
+      ASSERT_FALSE(path.empty());
+      EXPECT_NEAR(path.back().elapsed_cost.cost, expected.back().elapsed_cost.cost,
+                  expected.back().elapsed_cost.cost * 0.001f);
+    }
+  }
+}
+
 TEST(BiDiAstar, test_recost_path) {
   const std::string ascii_map = R"(
            X-----------Y
@@ -2,6 +2,8 @@
 #include "baldr/attributes_controller.h"
 #include "config.h"
 
+#include <algorithm>
+
 #include "test.h"
 
 using namespace std;
@@ -89,6 +91,42 @@ TEST(AttrController, TestAdminAttributeEnabled) {
   TryCategoryAttributeEnabled(controller, kAdminCategory, true);
 }
 
+TEST(AttrController, TestCompiledAttributes) {
+  AttributesController controller;
+  EXPECT_EQ(controller.enabled.count(), std::count_if(controller.attributes.begin(),
+                                                      controller.attributes.end(),
+                                                      [](const auto& pair) { return pair.second; }));
+  EXPECT_TRUE(controller(Attribute::kEdgeNames));
+  EXPECT_FALSE(controller(Attribute::kShapeAttributesTime));
+
+  // Filters from the request are compiled in
+  valhalla::Options options;
+  options.set_filter_action(valhalla::FilterAction::exclude);
+  options.add_filter_attributes(kEdgeNames);
+  options.add_filter_attributes(kRawScore);
+  AttributesController excluded(options);
+  EXPECT_FALSE(excluded(Attribute::kEdgeNames));
+  EXPECT_FALSE(excluded(Attribute::kRawScore));
+  EXPECT_TRUE(excluded(Attribute::kEdgeLength));
+
+  options.set_filter_action(valhalla::FilterAction::include);
+  options.clear_filter_attributes();
+  options.add_filter_attributes(kShapeAttributesTime);
+  AttributesController included(options, true);
+  EXPECT_EQ(included.enabled.count(), 1);
+  EXPECT_TRUE(included(Attribute::kShapeAttributesTime));
+  EXPECT_EQ(included(Attribute::kShapeAttributesTime), included(kShapeAttributesTime));
+
+  // Changing the attributes directly needs a compile
+  controller.disable_all();
+  EXPECT_TRUE(controller.enabled.none());
+  controller.attributes.at(kNodeType) = true;
+  EXPECT_FALSE(controller(Attribute::kNodeType));
+  controller.compile();
+  EXPECT_TRUE(controller(Attribute::kNodeType));
+  EXPECT_EQ(controller.enabled.count(), 1);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
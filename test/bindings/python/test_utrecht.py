@@ -112,6 +112,52 @@ class TestBindings(unittest.TestCase):
         iso = self.actor.isochrone(query)
         self.assertEqual(len(iso['features']), 6)  # 4 isochrones and the 2 point layers
 
+    def test_matrix_arrays(self):
+        query = {
+            "sources": [{"lat": 52.08813, "lon": 5.03231}, {"lat": 52.09987, "lon": 5.14913}],
+            "targets": [{"lat": 52.09987, "lon": 5.14913}, {"lat": 52.08813, "lon": 5.03231},
+                        {"lat": 52.10205, "lon": 5.11431}],
+            "costing": "auto"
+        }
+        matrix = self.actor.matrix(query)
+        arrays = self.actor.matrix_arrays(query)
+
+        # the same cells as the json, the distances in meters instead of kilometers
+        self.assertEqual(arrays['times'].shape, (2, 3))
+        self.assertEqual(arrays['distances'].shape, (2, 3))
+        for row in matrix['sources_to_targets']:
+            for cell in row:
+                i, j = cell['from_index'], cell['to_index']
+                self.assertAlmostEqual(float(arrays['times'][i, j]), cell['time'], delta=1)
+                self.assertAlmostEqual(arrays['distances'][i, j] / 1000, cell['distance'], delta=0.01)
+
+    def test_trace_arrays(self):
+        route = self.actor.route({
+            "locations": [
+                {"lat": 52.08813, "lon": 5.03231},
+                {"lat": 52.09987, "lon": 5.14913}
+            ],
+            "costing": "auto"
+        })
+        query = {
+            "encoded_polyline": route['trip']['legs'][0]['shape'],
+            "shape_match": "edge_walk",
+            "costing": "auto"
+        }
+        attributes = self.actor.trace_attributes(query)
+        arrays = self.actor.trace_arrays(query)
+
+        # the same edges and shape as the json
+        edges = arrays['edges']
+        self.assertEqual(len(edges), len(attributes['edges']))
+        for edge, json_edge in zip(edges, attributes['edges']):
+            self.assertEqual(int(edge['way_id']), json_edge['way_id'])
+            self.assertEqual(int(edge['begin_shape_index']), json_edge['begin_shape_index'])
+            self.assertEqual(int(edge['end_shape_index']), json_edge['end_shape_index'])
+            self.assertAlmostEqual(float(edge['length_km']), json_edge['length'], delta=0.001)
+        self.assertEqual(arrays['shape'].shape[1], 2)
+        self.assertEqual(arrays['shape'].shape[0], int(edges['end_shape_index'].max()) + 1)
+
     def test_change_config(self):
         config = get_config(self.tiles_path, self.extract_path)
         config['service_limits']['bicycle']['max_distance'] = 1
@@ -123,3 +169,24 @@ class TestBindings(unittest.TestCase):
         with self.assertRaises(RuntimeError) as e:
             actor.route(json.dumps({"locations":[{"lat":52.08813,"lon":5.03231},{"lat":52.09987,"lon":5.14913}],"costing":"bicycle","directions_options":{"language":"ru-RU"}}))
         self.assertIn('exceeds the max distance limit', str(e.exception))
+
+    def test_batch(self):
+        query = {
+            "locations": [
+                {"lat": 52.08813, "lon": 5.03231},
+                {"lat": 52.09987, "lon": 5.14913}
+            ],
+            "costing": "bicycle"
+        }
+        route = self.actor.route(query)
+        bad = {"locations": [{"lat": 52.08813, "lon": 5.03231}], "costing": "bicycle"}
+
+        # the responses in the order of the requests, the failed one gets its error
+        responses = self.actor.batch('route', [query, json.dumps(query), bad, query], 3)
+        self.assertEqual(len(responses), 4)
+        for resp in (responses[0], json.loads(responses[1]), responses[3]):
+            self.assertEqual(resp['trip']['summary']['length'], route['trip']['summary']['length'])
+        self.assertIn('error_code', responses[2])
+
+        with self.assertRaises(ValueError):
+            self.actor.batch('not_an_action', [query])
@@ -0,0 +1,189 @@
+#include "baldr/bss_tables.h"
+#include "filesystem.h"
+#include "loki/worker.h"
+#include "mjolnir/bsstablesbuilder.h"
+#include "odin/worker.h"
+#include "thor/worker.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// see astar_bikeshare.cc for why the radius isn't 0
+const auto conf =
+    test::make_config("test/data/paris_bss_tiles", {{"loki.service_defaults.radius", "10"}});
+
+boost::property_tree::ptree with_tables() {
+  auto config = conf;
+  config.put("thor.use_bss_tables", true);
+  return config;
+}
+
+struct tester {
+  explicit tester(const boost::property_tree::ptree& config)
+      : reader(std::make_shared<GraphReader>(config.get_child("mjolnir"))),
+        loki_worker(config, reader), thor_worker(config, reader), odin_worker(config) {
+  }
+
+  Api route(const std::string& request_json) {
+    Api request;
+    ParseApi(request_json, Options::route, request);
+    loki_worker.route(request);
+    thor_worker.route(request);
+    odin_worker.narrate(request);
+    return request;
+  }
+
+  Api matrix(const std::string& request_json) {
+    Api request;
+    ParseApi(request_json, Options::sources_to_targets, request);
+    loki_worker.matrix(request);
+    thor_worker.matrix(request);
+    return request;
+  }
+
+  std::shared_ptr<GraphReader> reader;
+  loki::loki_worker_t loki_worker;
+  thor::thor_worker_t thor_worker;
+  odin::odin_worker_t odin_worker;
+};
+
+std::vector<TravelMode> travel_modes(const Api& response) {
+  std::vector<TravelMode> modes;
+  for (const auto& maneuver : response.directions().routes(0).legs(0).maneuver()) {
+    if (modes.empty() || modes.back() != maneuver.travel_mode()) {
+      modes.push_back(maneuver.travel_mode());
+    }
+  }
+  return modes;
+}
+
+std::string route_request(const std::string& from,
+                          const std::string& to,
+                          const std::string& costing_options = "") {
+  return R"({"locations":[)" + from + "," + to + R"(],"costing":"bikeshare")" +
+         (costing_options.empty() ? "" : R"(,"costing_options":)" + costing_options) + "}";
+}
+
+const std::vector<std::string> locations = {
+    R"({"lat":48.864655,"lon":2.361374})", R"({"lat":48.859608,"lon":2.36117})",
+    R"({"lat":48.858376,"lon":2.358229})", R"({"lat":48.86911,"lon":2.36019})",
+    R"({"lat":48.857826,"lon":2.366695})", R"({"lat":48.865448,"lon":2.363641})",
+};
+
+} // namespace
+
+class BssTablesTest : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    mjolnir::BssTablesBuilder::Build(conf);
+  }
+};
+
+TEST(BssTables, SaveAndLoad) {
+  std::vector<GraphId> stations = {{1, 2, 3}, {1, 2, 7}, {4, 2, 0}};
+  std::vector<BssRide> rides = {{2, 0, 30.f, 20.f, 100, 0, 11, 12},
+                                {0, 1, 10.f, 8.f, 50, 0, 13, 14},
+                                {0, 2, 20.f, 15.f, 80, 0, 15, 16},
+                                {1, 2, 5.f, 4.f, 20, 0, 17, 18}};
+  const auto file_name = BssTables::file_name("test/data/bss_tables_io");
+  BssTables(stations, rides, 42).Save(file_name);
+
+  auto tables = BssTables::Load(file_name);
+  EXPECT_EQ(tables->dataset_id(), 42);
+  ASSERT_EQ(tables->station_count(), 3);
+  ASSERT_EQ(tables->ride_count(), 4);
+  EXPECT_EQ(tables->station_index({1, 2, 7}), 1);
+  EXPECT_EQ(tables->station_index({1, 2, 5}), kInvalidBssStation);
+
+  // the rides from a station are in order of the station they go to
+  auto from = tables->rides_from(0);
+  ASSERT_EQ(from.second - from.first, 2);
+  EXPECT_EQ(from.first[0].to, 1);
+  EXPECT_EQ(from.first[1].to, 2);
+  EXPECT_EQ(from.first[1].last_edge, 16);
+
+  auto to = tables->rides_to(2);
+  ASSERT_EQ(to.second - to.first, 2);
+  for (auto* ride = to.first; ride != to.second; ++ride) {
+    EXPECT_EQ(tables->ride(*ride).to, 2);
+  }
+  EXPECT_EQ(tables->rides_to(1).second - tables->rides_to(1).first, 1);
+
+  // anything that isn't a tables file is refused
+  {
+    std::fstream file(file_name, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(0);
+    file.write("XXXXXXXX", 8);
+  }
+  EXPECT_THROW(BssTables::Load(file_name), std::runtime_error);
+  std::remove(file_name.c_str());
+}
+
+TEST_F(BssTablesTest, BuiltFromTheTiles) {
+  GraphReader reader(conf.get_child("mjolnir"));
+  auto tables = BssTables::Load(BssTables::file_name(reader.tile_dir()));
+  ASSERT_GT(tables->station_count(), 1);
+  EXPECT_GT(tables->ride_count(), 0);
+  for (uint32_t i = 0; i < tables->ride_count(); ++i) {
+    const auto& ride = tables->ride(i);
+    EXPECT_NE(ride.from, ride.to);
+    EXPECT_GT(ride.cost, 0.f);
+    // the ride ends on an edge into the station it goes to
+    EXPECT_EQ(reader.edge_endnode(GraphId(ride.last_edge)), tables->station(ride.to));
+    EXPECT_EQ(reader.edge_startnode(GraphId(ride.first_edge)), tables->station(ride.from));
+  }
+}
+
+TEST_F(BssTablesTest, RoutesMatchTheSearch) {
+  tester search(conf), tables(with_tables());
+  for (size_t i = 0; i + 1 < locations.size(); ++i) {
+    const auto request = route_request(locations[i], locations[i + 1]);
+    auto expected = search.route(request);
+    auto response = tables.route(request);
+    EXPECT_EQ(travel_modes(response), travel_modes(expected)) << request;
+    const auto expected_time = expected.directions().routes(0).legs(0).summary().time();
+    EXPECT_NEAR(response.directions().routes(0).legs(0).summary().time(), expected_time,
+                expected_time * 0.05)
+        << request;
+  }
+}
+
+TEST_F(BssTablesTest, CustomOptionsDoNotUseTheTables) {
+  tester search(conf), tables(with_tables());
+  const auto request = route_request(locations[0], locations[1],
+                                     R"({"bicycle":{"cycling_speed":12}})");
+  auto expected = search.route(request);
+  auto response = tables.route(request);
+  EXPECT_EQ(response.trip().routes(0).legs(0).shape(), expected.trip().routes(0).legs(0).shape());
+  EXPECT_EQ(response.directions().routes(0).legs(0).summary().time(),
+            expected.directions().routes(0).legs(0).summary().time());
+}
+
+TEST_F(BssTablesTest, MatrixMatchesTheSearch) {
+  tester search(conf), tables(with_tables());
+  for (const auto& many_to_one : {false, true}) {
+    // more sources than targets expands in reverse through the rides ending at a station
+    std::string sources, targets;
+    for (size_t i = 0; i < locations.size(); ++i) {
+      auto& list = (i == 0) != many_to_one ? sources : targets;
+      list += (list.empty() ? "" : ",") + locations[i];
+    }
+    const auto request =
+        R"({"sources":[)" + sources + R"(],"targets":[)" + targets + R"(],"costing":"bikeshare"})";
+    auto expected = search.matrix(request);
+    auto response = tables.matrix(request);
+    ASSERT_EQ(response.matrix().times_size(), expected.matrix().times_size());
+    for (int i = 0; i < expected.matrix().times_size(); ++i) {
+      EXPECT_NEAR(response.matrix().times(i), expected.matrix().times(i),
+                  expected.matrix().times(i) * 0.05)
+          << request << " " << i;
+    }
+  }
+}
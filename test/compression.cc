@@ -1,6 +1,7 @@
 #include "baldr/compression_utils.h"
 
 #include <string>
+#include <vector>
 
 #include "test.h"
 
@@ -136,6 +137,61 @@ TEST(Compression, fail_inflate) {
   EXPECT_FALSE(inflate_result);
 }
 
+TEST(Compression, detect) {
+  using valhalla::baldr::detect_compression;
+  using valhalla::baldr::tile_compression_t;
+  EXPECT_EQ(detect_compression("\x1f\x8b\x08\x00", 4), tile_compression_t::gzip);
+  EXPECT_EQ(detect_compression("\x28\xb5\x2f\xfd", 4), tile_compression_t::zstd);
+  EXPECT_EQ(detect_compression("\x04\x22\x4d\x18", 4), tile_compression_t::lz4);
+  EXPECT_EQ(detect_compression("\x28\xb5", 2), tile_compression_t::none);
+
+  // the graph id a raw tile starts with never looks like a frame
+  uint64_t graphid = (uint64_t(1234567) << 3) | 2;
+  EXPECT_EQ(detect_compression(reinterpret_cast<const char*>(&graphid), sizeof(graphid)),
+            tile_compression_t::none);
+}
+
+TEST(Compression, zstd_roundtrip) {
+  std::string message;
+  for (int i = 0; i < 1000; ++i)
+    message += "message in a zstd bottle " + std::to_string(i % 7);
+  std::vector<char> dictionary(message.begin(), message.begin() + 200);
+
+  std::vector<char> compressed;
+  if (!valhalla::baldr::zstd_compress(message.data(), message.size(), compressed, 19, dictionary))
+    GTEST_SKIP() << "Built without zstd";
+  EXPECT_EQ(valhalla::baldr::detect_compression(compressed.data(), compressed.size()),
+            valhalla::baldr::tile_compression_t::zstd);
+
+  // it needs the dictionary it was compressed with
+  std::vector<char> decompressed;
+  EXPECT_FALSE(valhalla::baldr::zstd_decompress(compressed.data(), compressed.size(), decompressed));
+  valhalla::baldr::zstd_dictionary_t digested(dictionary.data(), dictionary.size());
+  EXPECT_TRUE(valhalla::baldr::zstd_decompress(compressed.data(), compressed.size(), decompressed,
+                                               &digested));
+  EXPECT_EQ(std::string(decompressed.begin(), decompressed.end()), message);
+}
+
+TEST(Compression, lz4_roundtrip) {
+  std::string message;
+  for (int i = 0; i < 1000; ++i)
+    message += "message in an lz4 bottle " + std::to_string(i % 7);
+
+  std::vector<char> compressed;
+  if (!valhalla::baldr::lz4_compress(message.data(), message.size(), compressed))
+    GTEST_SKIP() << "Built without lz4";
+  EXPECT_EQ(valhalla::baldr::detect_compression(compressed.data(), compressed.size()),
+            valhalla::baldr::tile_compression_t::lz4);
+
+  std::vector<char> decompressed;
+  EXPECT_TRUE(valhalla::baldr::lz4_decompress(compressed.data(), compressed.size(), decompressed));
+  EXPECT_EQ(std::string(decompressed.begin(), decompressed.end()), message);
+
+  // a truncated frame fails
+  EXPECT_FALSE(
+      valhalla::baldr::lz4_decompress(compressed.data(), compressed.size() / 2, decompressed));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,268 @@
+#include "baldr/contraction.h"
+#include "mjolnir/contractionbuilder.h"
+#include "thor/bucketmatrix.h"
+
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// a random, mostly bidirectional, graph whose edge ids are just the index of the arc
+std::vector<ContractionArc> make_graph(const uint32_t node_count, const uint32_t seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<uint32_t> node(0, node_count - 1);
+  std::uniform_real_distribution<float> cost(1.f, 100.f);
+  std::vector<ContractionArc> arcs;
+  auto add = [&arcs](uint32_t from, uint32_t to, float c) {
+    arcs.push_back({from, to, c, c, static_cast<uint32_t>(c), kInvalidArc, kInvalidArc, 0,
+                    static_cast<uint64_t>(arcs.size())});
+  };
+  for (uint32_t i = 0; i < node_count * 3; ++i) {
+    const uint32_t from = node(generator), to = node(generator);
+    const float c = cost(generator);
+    add(from, to, c);
+    if (i % 5 != 0) {
+      add(to, from, c);
+    }
+  }
+  return arcs;
+}
+
+std::vector<ContractionArc> contract(const uint32_t node_count,
+                                     const std::vector<ContractionArc>& graph,
+                                     std::vector<uint32_t>& ranks) {
+  auto arcs = graph;
+  ranks = ContractionBuilder::Contract(node_count, arcs, 50);
+  return arcs;
+}
+
+std::vector<GraphId> make_nodes(const uint32_t node_count) {
+  std::vector<GraphId> nodes;
+  for (uint32_t i = 0; i < node_count; ++i) {
+    nodes.emplace_back(0, 0, i);
+  }
+  return nodes;
+}
+
+// plain dijkstra over the original graph
+float dijkstra(const uint32_t node_count,
+               const std::vector<ContractionArc>& arcs,
+               const uint32_t source,
+               const uint32_t target) {
+  std::vector<float> costs(node_count, std::numeric_limits<float>::max());
+  using label_t = std::pair<float, uint32_t>;
+  std::priority_queue<label_t, std::vector<label_t>, std::greater<label_t>> queue;
+  costs[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto label = queue.top();
+    queue.pop();
+    if (label.second == target) {
+      return label.first;
+    }
+    if (label.first > costs[label.second]) {
+      continue;
+    }
+    for (const auto& arc : arcs) {
+      if (arc.from == label.second && label.first + arc.cost < costs[arc.to]) {
+        costs[arc.to] = label.first + arc.cost;
+        queue.emplace(costs[arc.to], arc.to);
+      }
+    }
+  }
+  return std::numeric_limits<float>::max();
+}
+
+TEST(Contraction, RanksArePermutation) {
+  const uint32_t node_count = 200;
+  std::vector<uint32_t> ranks;
+  contract(node_count, make_graph(node_count, 1), ranks);
+  ASSERT_EQ(ranks.size(), node_count);
+  std::vector<bool> seen(node_count, false);
+  for (auto rank : ranks) {
+    ASSERT_LT(rank, node_count);
+    EXPECT_FALSE(seen[rank]);
+    seen[rank] = true;
+  }
+}
+
+TEST(Contraction, MatchesDijkstra) {
+  const uint32_t node_count = 300;
+  const auto graph = make_graph(node_count, 7);
+  std::vector<uint32_t> ranks;
+  auto arcs = contract(node_count, graph, ranks);
+  EXPECT_GE(arcs.size(), graph.size());
+  ContractionOverlay overlay(make_nodes(node_count), ranks, arcs, 0, "auto", 42);
+
+  ContractionSearch search;
+  std::vector<uint32_t> path;
+  std::vector<GraphId> edges;
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<uint32_t> node(0, node_count - 1);
+  for (int i = 0; i < 200; ++i) {
+    const uint32_t from = node(generator), to = node(generator);
+    uint32_t source, target;
+    const float cost = search.Find(overlay, {{from, 0.f}}, {{to, 0.f}}, path, source, target);
+    const float expected = dijkstra(node_count, graph, from, to);
+    if (expected == std::numeric_limits<float>::max()) {
+      EXPECT_EQ(cost, expected);
+      continue;
+    }
+    ASSERT_NEAR(cost, expected, 1e-3f * expected) << from << " -> " << to;
+    EXPECT_EQ(source, from);
+    EXPECT_EQ(target, to);
+
+    // the unpacked edges have to chain from the source to the target and add up to the cost
+    edges.clear();
+    for (auto arc : path) {
+      overlay.Unpack(arc, edges);
+    }
+    uint32_t at = from;
+    float total = 0.f;
+    for (const auto& edge : edges) {
+      const auto& arc = graph[edge.value];
+      EXPECT_EQ(arc.from, at);
+      at = arc.to;
+      total += arc.cost;
+    }
+    EXPECT_EQ(at, to);
+    EXPECT_NEAR(total, expected, 1e-3f * expected);
+  }
+}
+
+TEST(Contraction, SeedCosts) {
+  const uint32_t node_count = 100;
+  const auto graph = make_graph(node_count, 11);
+  std::vector<uint32_t> ranks;
+  auto arcs = contract(node_count, graph, ranks);
+  ContractionOverlay overlay(make_nodes(node_count), ranks, arcs, 0, "auto", 42);
+
+  // the cheaper seeds should win even if their graph path is longer
+  ContractionSearch search;
+  std::vector<uint32_t> path;
+  uint32_t source, target;
+  const float cost =
+      search.Find(overlay, {{0, 1000.f}, {1, 0.f}}, {{2, 0.f}, {3, 5.f}}, path, source, target);
+  float expected = std::numeric_limits<float>::max();
+  for (auto s : {std::make_pair(0u, 1000.f), std::make_pair(1u, 0.f)}) {
+    for (auto t : {std::make_pair(2u, 0.f), std::make_pair(3u, 5.f)}) {
+      const float c = dijkstra(node_count, graph, s.first, t.first);
+      if (c != std::numeric_limits<float>::max()) {
+        expected = std::min(expected, s.second + c + t.second);
+      }
+    }
+  }
+  EXPECT_NEAR(cost, expected, 1e-3f * expected);
+}
+
+// fills the matrix straight from the seeds of overlay nodes
+class TestBucketMatrix : public BucketMatrix {
+public:
+  using BucketMatrix::BucketMatrix;
+
+  void Compute(const ContractionOverlay& overlay,
+               const std::vector<uint32_t>& sources,
+               const std::vector<uint32_t>& targets,
+               GraphReader& reader) {
+    source_seeds_.clear();
+    source_edges_.assign(sources.size(), {});
+    for (auto node : sources) {
+      source_seeds_.push_back({{node, 0.f, 0.f, 0.f}});
+    }
+    target_seeds_.clear();
+    target_edges_.clear();
+    for (auto node : targets) {
+      target_seeds_.push_back({{node, 0.f, 0.f, 0.f}});
+    }
+    BucketMatrix::Compute(overlay, std::numeric_limits<float>::max() / 2, reader);
+  }
+
+  float cost(const size_t source, const size_t target) const {
+    return costs_[source * target_seeds_.size() + target];
+  }
+};
+
+TEST(Contraction, BucketMatrixMatchesDijkstra) {
+  const uint32_t node_count = 300;
+  const auto graph = make_graph(node_count, 13);
+  std::vector<uint32_t> ranks;
+  auto arcs = contract(node_count, graph, ranks);
+  ContractionOverlay overlay(make_nodes(node_count), ranks, arcs, 0, "auto", 42);
+
+  std::mt19937 generator(17);
+  std::uniform_int_distribution<uint32_t> node(0, node_count - 1);
+  std::vector<uint32_t> sources, targets;
+  for (int i = 0; i < 20; ++i) {
+    sources.push_back(node(generator));
+  }
+  for (int i = 0; i < 30; ++i) {
+    targets.push_back(node(generator));
+  }
+
+  // serially and spread over helper threads, which also get reused
+  boost::property_tree::ptree reader_config;
+  reader_config.put("tile_dir", "test/data/contraction");
+  GraphReader reader(reader_config);
+  boost::property_tree::ptree thor_config;
+  thor_config.put("bucketmatrix_threads", 3);
+  TestBucketMatrix serial, parallel(thor_config, reader_config);
+  for (auto* matrix : {&serial, &parallel, &parallel}) {
+    matrix->Compute(overlay, sources, targets, reader);
+    for (size_t s = 0; s < sources.size(); ++s) {
+      for (size_t t = 0; t < targets.size(); ++t) {
+        const float expected = dijkstra(node_count, graph, sources[s], targets[t]);
+        if (expected == std::numeric_limits<float>::max()) {
+          EXPECT_EQ(matrix->cost(s, t), valhalla::thor::kMaxCost);
+        } else {
+          EXPECT_NEAR(matrix->cost(s, t), expected, 1e-3f * expected)
+              << sources[s] << " -> " << targets[t];
+        }
+      }
+    }
+  }
+}
+
+TEST(Contraction, SaveLoad) {
+  const uint32_t node_count = 50;
+  std::vector<uint32_t> ranks;
+  auto arcs = contract(node_count, make_graph(node_count, 5), ranks);
+  ContractionOverlay overlay(make_nodes(node_count), ranks, arcs, 0, "truck", 1234);
+
+  const std::string file = "test/data/contraction/truck.ch";
+  overlay.Save(file);
+  auto loaded = ContractionOverlay::Load(file);
+  EXPECT_EQ(loaded->costing(), "truck");
+  EXPECT_EQ(loaded->dataset_id(), 1234);
+  EXPECT_EQ(loaded->level(), 0);
+  ASSERT_EQ(loaded->node_count(), overlay.node_count());
+  ASSERT_EQ(loaded->arc_count(), overlay.arc_count());
+  for (uint32_t i = 0; i < overlay.node_count(); ++i) {
+    EXPECT_EQ(loaded->node(i), overlay.node(i));
+    EXPECT_EQ(loaded->rank(i), overlay.rank(i));
+    EXPECT_EQ(loaded->node_index(overlay.node(i)), i);
+  }
+  for (uint32_t i = 0; i < overlay.arc_count(); ++i) {
+    EXPECT_EQ(loaded->arc(i).edgeid, overlay.arc(i).edgeid);
+    EXPECT_EQ(loaded->arc(i).first, overlay.arc(i).first);
+  }
+  EXPECT_EQ(loaded->node_index(GraphId(1, 0, 0)), kInvalidContractionNode);
+  std::remove(file.c_str());
+
+  EXPECT_THROW(ContractionOverlay::Load("test/data/contraction/missing.ch"), std::runtime_error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,6 @@
 
 #include <cstdint>
+#include <limits>
 #include <string>
 
 #include "baldr/datetime.h"
@@ -698,7 +699,39 @@ TEST(DateTime, DiffCaching) {
     }
   }
   EXPECT_NE(total_offset, 0);
-  EXPECT_GE(cache.size(), test_cases.size());
+  // the offset tables of the timezones answer all of them without the cache
+  EXPECT_TRUE(cache.empty());
+}
+
+TEST(DateTime, OffsetTables) {
+  const auto& tzdb = DateTime::get_tz_db();
+  for (const auto* name : {"America/New_York", "Europe/Amsterdam", "Australia/Lord_Howe",
+                           "Asia/Kolkata", "America/Sao_Paulo", "Etc/UTC", "Pacific/Apia"}) {
+    const auto* tz = tzdb.from_index(tzdb.to_index(name));
+    const auto* offsets = tzdb.offsets(tz);
+    ASSERT_NE(offsets, nullptr) << name;
+    // the same ones every time they are asked for
+    EXPECT_EQ(offsets, tzdb.offsets(tz));
+
+    // every 4 days and a bit from before the range to after it, so all the transitions are crossed
+    for (int64_t t = -86400 * 30; t < DateTime::tz_offsets_t::kEnd + 86400 * 400; t += 352817) {
+      const date::sys_seconds at{std::chrono::seconds(t)};
+      const auto info = tz->get_info(at);
+      ASSERT_EQ(offsets->offset(t), info.offset.count()) << name << " at " << t;
+      if (t < 0 || t > std::numeric_limits<uint32_t>::max()) {
+        continue;
+      }
+      // the second of the week from the local time of the zoned time
+      const auto local = date::make_zoned(tz, at).get_local_time();
+      const auto days = date::floor<date::days>(local);
+      const uint32_t expected = (date::weekday(days) - date::Sunday).count() *
+                                    valhalla::midgard::kSecondsPerDay +
+                                (local - days).count();
+      ASSERT_EQ(DateTime::second_of_week(t, tz), expected) << name << " at " << t;
+    }
+  }
+
+  EXPECT_EQ(tzdb.offsets(nullptr), nullptr);
 }
 
 } // namespace
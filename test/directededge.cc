@@ -1,5 +1,6 @@
 
 #include "baldr/directededge.h"
+#include "baldr/directededgehot.h"
 
 #include "test.h"
 
@@ -104,6 +105,38 @@ TEST(DirectedEdge, TestMaxSlope) {
   EXPECT_EQ(edge.max_down_slope(), -16);
 }
 
+TEST(DirectedEdge, TestHotFields) {
+  // the hot fields have to read back what the edges hold
+  DirectedEdge edges[2];
+  edges[0].set_endnode(GraphId(3196, 0, 12));
+  edges[0].set_length(1234);
+  edges[0].set_forwardaccess(kAutoAccess | kTruckAccess);
+  edges[0].set_reverseaccess(kPedestrianAccess);
+  edges[0].set_speed(87);
+  edges[0].set_use(Use::kRamp);
+  edges[0].set_classification(RoadClass::kPrimary);
+  edges[1].set_endnode(GraphId(3197, 1, 7));
+  edges[1].set_length(5);
+  edges[1].set_forwardaccess(kAllAccess);
+  edges[1].set_speed(12);
+  edges[1].set_use(Use::kFootway);
+  edges[1].set_classification(RoadClass::kServiceOther);
+
+  DirectedEdgeHot hot(edges, 2);
+  ASSERT_EQ(hot.size(), 2);
+  for (uint32_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(hot.endnode(i), edges[i].endnode());
+    EXPECT_EQ(hot.length(i), edges[i].length());
+    EXPECT_EQ(hot.attributes(i).forwardaccess, edges[i].forwardaccess());
+    EXPECT_EQ(hot.attributes(i).reverseaccess, edges[i].reverseaccess());
+    EXPECT_EQ(hot.attributes(i).speed, edges[i].speed());
+    EXPECT_EQ(static_cast<Use>(hot.attributes(i).use), edges[i].use());
+    EXPECT_EQ(static_cast<RoadClass>(hot.attributes(i).classification), edges[i].classification());
+  }
+
+  EXPECT_EQ(DirectedEdgeHot().size(), 0);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
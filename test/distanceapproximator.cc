@@ -3,6 +3,10 @@
 #include "midgard/constants.h"
 #include "midgard/pointll.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "test.h"
 
 using namespace std;
@@ -47,6 +51,42 @@ TEST(DistanceApproximator, TestDistanceSquared) {
   TryDistanceSquared(a, b, d * d);
 }
 
+TEST(DistanceApproximator, TestTableLngScalePerLat) {
+  for (double lat = -91; lat <= 91; lat += 0.0137) {
+    const double clamped = std::max(-90., std::min(90., lat));
+    EXPECT_NEAR(DistanceApproximator<PointLL>::TableLngScalePerLat(lat),
+                std::cos(clamped * kRadPerDegD), 3e-6)
+        << lat;
+    EXPECT_NEAR(DistanceApproximator<PointLL>::TableLngScalePerLat(lat),
+                DistanceApproximator<PointLL>::LngScalePerLat(clamped), 4e-6)
+        << lat;
+  }
+  EXPECT_FLOAT_EQ(DistanceApproximator<PointLL>::TableLngScalePerLat(0), 1);
+  EXPECT_NEAR(DistanceApproximator<PointLL>::TableLngScalePerLat(90), 0, 1e-7);
+}
+
+TEST(DistanceApproximator, TestDistanceSquaredFrom) {
+  PointLL a(-80.0f, 42.0f);
+  PointLL b(-79.99f, 42.01f);
+  DistanceApproximator<PointLL> approx(a);
+  EXPECT_NEAR(DistanceApproximator<PointLL>::DistanceSquaredFrom(a, b) / approx.DistanceSquared(b),
+              1, 1e-5);
+  EXPECT_EQ(a.DistanceSquared(b), DistanceApproximator<PointLL>::DistanceSquaredFrom(a, b));
+}
+
+TEST(DistanceApproximator, TestBatchDistanceSquared) {
+  DistanceApproximator<PointLL> approx(PointLL(5.1, 52.1));
+  std::vector<PointLL> points;
+  for (int i = 0; i < 37; ++i) {
+    points.emplace_back(5.1 + i * 0.001, 52.1 - i * 0.0007);
+  }
+  std::vector<double> sq_distances(points.size());
+  approx.DistanceSquared(points.data(), points.size(), sq_distances.data());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(sq_distances[i], approx.DistanceSquared(points[i]));
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
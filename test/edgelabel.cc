@@ -0,0 +1,70 @@
+#include "sif/edgelabel.h"
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+TEST(EdgeLabel, CompactSize) {
+  EXPECT_EQ(sizeof(CompactEdgeLabel), 32);
+  EXPECT_LT(sizeof(CompactEdgeLabel), sizeof(EdgeLabel));
+}
+
+TEST(EdgeLabel, CompactExpandsToEdgeLabel) {
+  DirectedEdge edge;
+  edge.set_endnode(GraphId(123, 2, 4567));
+  edge.set_use(Use::kRamp);
+  edge.set_classification(RoadClass::kPrimary);
+  edge.set_toll(true);
+  edge.set_dest_only(true);
+  edge.set_not_thru(true);
+  edge.set_restrictions(5);
+  edge.set_opp_local_idx(3);
+
+  const GraphId edgeid(123, 2, 89);
+  const Cost cost(123.5f, 67.25f);
+  EdgeLabel full(7, edgeid, &edge, cost, cost.cost, 0.f, TravelMode::kDrive, 4321, Cost{},
+                 kInvalidRestriction, true, true, InternalTurn::kLeftTurn);
+  CompactEdgeLabel compact(7, edgeid, &edge, cost, TravelMode::kDrive, 4321, true, true,
+                           InternalTurn::kLeftTurn);
+  compact.set_origin();
+  full.set_origin();
+
+  const auto label = compact.label();
+  EXPECT_EQ(label.predecessor(), full.predecessor());
+  EXPECT_EQ(label.edgeid(), full.edgeid());
+  EXPECT_EQ(label.endnode(), full.endnode());
+  EXPECT_EQ(label.cost().cost, full.cost().cost);
+  EXPECT_EQ(label.cost().secs, full.cost().secs);
+  EXPECT_EQ(label.sortcost(), full.sortcost());
+  EXPECT_EQ(label.path_distance(), full.path_distance());
+  EXPECT_EQ(label.restrictions(), full.restrictions());
+  EXPECT_EQ(label.opp_local_idx(), full.opp_local_idx());
+  EXPECT_EQ(label.mode(), full.mode());
+  EXPECT_EQ(label.use(), full.use());
+  EXPECT_EQ(label.classification(), full.classification());
+  EXPECT_EQ(label.toll(), full.toll());
+  EXPECT_EQ(label.destonly(), full.destonly());
+  EXPECT_EQ(label.not_thru(), full.not_thru());
+  EXPECT_EQ(label.origin(), full.origin());
+  EXPECT_EQ(label.closure_pruning(), full.closure_pruning());
+  EXPECT_EQ(label.has_measured_speed(), full.has_measured_speed());
+  EXPECT_EQ(label.internal_turn(), full.internal_turn());
+  EXPECT_EQ(label.restriction_idx(), kInvalidRestriction);
+
+  // updates keep the sort cost at the cost
+  compact.Update(9, Cost(100.f, 50.f), 4000);
+  EXPECT_EQ(compact.predecessor(), 9);
+  EXPECT_EQ(compact.sortcost(), 100.f);
+  EXPECT_EQ(compact.path_distance(), 4000);
+  EXPECT_TRUE(compact.origin());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -66,6 +66,83 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, ReuseAfterClear) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // touch enough tiles (and path ids) to force the tile table to grow a few times
+  for (uint32_t tileid = 0; tileid < 500; ++tileid) {
+    for (uint8_t path_id = 0; path_id < 2; ++path_id) {
+      edgestatus.Set(GraphId(tileid, 2, tileid), EdgeSet::kPermanent, tileid, tile, path_id);
+    }
+  }
+  for (uint32_t tileid = 0; tileid < 500; ++tileid) {
+    for (uint8_t path_id = 0; path_id < 2; ++path_id) {
+      auto status = edgestatus.Get(GraphId(tileid, 2, tileid), path_id);
+      EXPECT_EQ(status.set(), EdgeSet::kPermanent);
+      EXPECT_EQ(status.index(), tileid);
+    }
+    EXPECT_EQ(edgestatus.Get(GraphId(tileid, 2, tileid + 1)).set(), EdgeSet::kUnreachedOrReset);
+    EXPECT_EQ(edgestatus.Get(GraphId(tileid, 2, tileid), 2).set(), EdgeSet::kUnreachedOrReset);
+  }
+  const auto reserved = edgestatus.reserved();
+  EXPECT_GE(reserved, 1000u * 1000u);
+
+  // after a clear the memory is kept but everything has to read as reset again, even the
+  // entries living in recycled memory
+  edgestatus.clear();
+  EXPECT_EQ(edgestatus.reserved(), reserved);
+  EXPECT_THROW(edgestatus.Update(GraphId(1, 2, 1), EdgeSet::kTemporary), std::runtime_error);
+  for (uint32_t tileid = 500; tileid > 0; --tileid) {
+    auto* ptr = edgestatus.GetPtr(GraphId(tileid - 1, 2, 0), tile);
+    for (uint32_t i = 0; i < header.directededgecount(); ++i) {
+      EXPECT_EQ(ptr[i].set(), EdgeSet::kUnreachedOrReset);
+    }
+    ptr[tileid - 1] = {EdgeSet::kTemporary, 7};
+  }
+  edgestatus.Update(GraphId(1, 2, 1), EdgeSet::kSkipped);
+  EXPECT_EQ(edgestatus.Get(GraphId(1, 2, 1)).set(), EdgeSet::kSkipped);
+  EXPECT_EQ(edgestatus.Get(GraphId(1, 2, 1)).index(), 7);
+  EXPECT_EQ(edgestatus.Get(GraphId(2, 2, 2)).set(), EdgeSet::kTemporary);
+  EXPECT_EQ(edgestatus.Get(GraphId(1, 2, 1), 1).set(), EdgeSet::kUnreachedOrReset);
+  EXPECT_EQ(edgestatus.reserved(), reserved);
+}
+
+TEST(EdgeStatus, PointersStableAcrossSlabs) {
+  EdgeStatus edgestatus;
+
+  // a tile larger than a single slab plus small ones that spill over into new slabs
+  GraphTileHeader big_header, small_header;
+  big_header.set_directededgecount(1u << 19);
+  small_header.set_directededgecount(100000);
+  test_tile* big = new test_tile;
+  big->header_ = &big_header;
+  test_tile* small = new test_tile;
+  small->header_ = &small_header;
+  graph_tile_ptr big_tile{big}, small_tile{small};
+
+  auto* first = edgestatus.GetPtr(GraphId(0, 0, 5), small_tile);
+  *first = {EdgeSet::kPermanent, 42};
+  edgestatus.Set(GraphId(1, 0, (1u << 19) - 1), EdgeSet::kTemporary, 1, big_tile);
+  for (uint32_t tileid = 2; tileid < 10; ++tileid) {
+    edgestatus.Set(GraphId(tileid, 0, 99999), EdgeSet::kTemporary, tileid, small_tile);
+  }
+
+  // the first pointer must still be valid and pointing at the same status
+  EXPECT_EQ(first, edgestatus.GetPtr(GraphId(0, 0, 5), small_tile));
+  EXPECT_EQ(first->set(), EdgeSet::kPermanent);
+  EXPECT_EQ(first->index(), 42);
+  EXPECT_EQ(edgestatus.Get(GraphId(1, 0, (1u << 19) - 1)).set(), EdgeSet::kTemporary);
+  for (uint32_t tileid = 2; tileid < 10; ++tileid) {
+    EXPECT_EQ(edgestatus.Get(GraphId(tileid, 0, 99999)).index(), tileid);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,112 @@
+#include "baldr/edgetable.h"
+#include "filesystem.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string kTableDir = "test/data/edge_tables";
+
+EdgeTableEntry entry(uint32_t speed, uint32_t penalty, bool banned) {
+  EdgeTableEntry e{};
+  e.speed = speed;
+  e.penalty = penalty;
+  e.banned = banned;
+  return e;
+}
+
+class EdgeTableTest : public testing::Test {
+protected:
+  void SetUp() override {
+    filesystem::remove_all(kTableDir);
+    filesystem::create_directories(kTableDir);
+    EdgeTable::set_dir(kTableDir);
+  }
+  void TearDown() override {
+    EdgeTable::set_dir("");
+    filesystem::remove_all(kTableDir);
+  }
+};
+
+TEST_F(EdgeTableTest, WriteAndRead) {
+  const GraphId a(100, 2, 7), b(100, 2, 3), c(5, 1, 0);
+  EdgeTable::write(kTableDir + "/fleet.edges",
+                   {{a, entry(30, 0, false)}, {b, entry(0, 60, false)}, {c, entry(0, 0, true)}});
+
+  EdgeTable table(kTableDir + "/fleet.edges");
+  ASSERT_NE(table.get(a), nullptr);
+  EXPECT_EQ(table.get(a)->speed, 30);
+  EXPECT_EQ(table.get(b)->penalty, 60);
+  EXPECT_TRUE(table.get(c)->banned);
+
+  // edges between the ones written have empty entries, the ones past them and other tiles none
+  const auto* between = table.get(GraphId(100, 2, 5));
+  ASSERT_NE(between, nullptr);
+  EXPECT_EQ(between->speed, 0);
+  EXPECT_EQ(between->penalty, 0);
+  EXPECT_FALSE(between->banned);
+  EXPECT_EQ(table.get(GraphId(100, 2, 8)), nullptr);
+  EXPECT_EQ(table.get(GraphId(101, 2, 7)), nullptr);
+}
+
+TEST_F(EdgeTableTest, Invalid) {
+  {
+    std::ofstream f(kTableDir + "/bogus.edges");
+    f << "definitely not an edge table";
+  }
+  EXPECT_THROW(EdgeTable(kTableDir + "/bogus.edges"), std::runtime_error);
+  EXPECT_THROW(EdgeTable(kTableDir + "/missing.edges"), std::runtime_error);
+
+  // ids cannot leave the directory
+  EXPECT_THROW(EdgeTable::get("../fleet"), std::runtime_error);
+  EXPECT_THROW(EdgeTable::get(""), std::runtime_error);
+  EXPECT_FALSE(EdgeTable::get("missing"));
+}
+
+TEST_F(EdgeTableTest, Reload) {
+  const GraphId edge(100, 2, 7);
+  EdgeTable::write(kTableDir + "/fleet.edges", {{edge, entry(30, 0, false)}});
+  auto first = EdgeTable::get("fleet");
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first->get(edge)->speed, 30);
+  EXPECT_EQ(EdgeTable::get("fleet"), first) << " the loaded table should be reused";
+
+  // swap in a new table the way a deployment would
+  EdgeTable::write(kTableDir + "/fleet.edges.tmp", {{edge, entry(50, 0, false)}});
+  ASSERT_EQ(std::rename((kTableDir + "/fleet.edges.tmp").c_str(),
+                        (kTableDir + "/fleet.edges").c_str()),
+            0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  auto second = EdgeTable::get("fleet");
+  ASSERT_TRUE(second);
+  EXPECT_EQ(second->get(edge)->speed, 50);
+
+  // whoever still holds the old table keeps using it
+  EXPECT_EQ(first->get(edge)->speed, 30);
+
+  // and removing the file removes the table
+  filesystem::remove(kTableDir + "/fleet.edges");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_FALSE(EdgeTable::get("fleet"));
+}
+
+TEST_F(EdgeTableTest, NoDirectory) {
+  EdgeTable::write(kTableDir + "/fleet.edges", {{GraphId(100, 2, 7), entry(30, 0, false)}});
+  EdgeTable::set_dir("");
+  EXPECT_FALSE(EdgeTable::get("fleet"));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -2,6 +2,8 @@
 
 #include "test.h"
 
+#include <list>
+#include <random>
 #include <string>
 
 using namespace std;
@@ -620,6 +622,42 @@ TEST(Encode, VarInt) {
                   {58.26482, -169.02219}});
 }
 
+TEST(Encode, Bulk) {
+  // vectors are encoded in bulk, lists one point at a time, both have to give the same bytes
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> lng(-180, 180), lat(-90, 90), step(-0.01, 0.01);
+  for (size_t count : {0, 1, 2, 3, 5, 127, 128, 129, 1000}) {
+    container_t points;
+    for (size_t i = 0; i < count; ++i) {
+      if (i % 7 == 3) {
+        // halves have to round away from zero
+        points.emplace_back(-(i + 0.5) * 1e-6, (i + 0.5) * 1e-5);
+      } else if (i % 2 && !points.empty()) {
+        points.emplace_back(points.back().first + step(generator),
+                            points.back().second + step(generator));
+      } else {
+        points.emplace_back(lng(generator), lat(generator));
+      }
+    }
+    std::list<std::pair<double, double>> listed(points.begin(), points.end());
+    for (int precision : {int(1e5), int(1e6)}) {
+      auto encoded = encode(points, precision);
+      EXPECT_EQ(encoded, encode(listed, precision)) << count << " points";
+
+      // and decode back whichever way they are decoded
+      auto decoded = decode<container_t>(encoded, 1.0 / precision);
+      auto decoded_listed = decode<std::list<std::pair<double, double>>>(encoded, 1.0 / precision);
+      EXPECT_EQ(decoded.size(), count);
+      EXPECT_TRUE(std::equal(decoded.begin(), decoded.end(), decoded_listed.begin()));
+      assert_approx_equal(decoded, points, 1.0 / precision);
+    }
+  }
+
+  // numbers that never end are bad, however many bytes are left
+  EXPECT_THROW(decode<container_t>(std::string(20, '~')), std::runtime_error);
+  EXPECT_THROW(decode<container_t>("s}ksFfkupMz@fT~~"), std::runtime_error);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -646,6 +646,30 @@ TEST(EnhancedTripPath, TestActivateTurnLanesShortNextLeft) {
   ClearActiveTurnLanes(edge_3.mutable_turn_lanes());
 }
 
+TEST(EnhancedTripPath, TestWrapperLookups) {
+  TripLeg path;
+  for (int i = 0; i < 3; ++i) {
+    path.add_node()->mutable_edge()->set_length_km(i + 1);
+  }
+  path.add_node();
+  EnhancedTripLeg etp(path);
+
+  // every lookup of a node or edge hands back the same wrapper
+  EXPECT_EQ(etp.GetEnhancedNode(1), etp.GetEnhancedNode(1));
+  EXPECT_NE(etp.GetEnhancedNode(1), etp.GetEnhancedNode(2));
+  EXPECT_EQ(etp.GetCurrEdge(1), etp.GetCurrEdge(1));
+  EXPECT_EQ(etp.GetPrevEdge(2), etp.GetCurrEdge(1));
+  EXPECT_EQ(etp.GetNextEdge(0), etp.GetCurrEdge(1));
+  EXPECT_EQ(etp.GetPrevEdge(3, 3), etp.GetCurrEdge(0));
+  EXPECT_FLOAT_EQ(etp.GetCurrEdge(2)->length_km(), 3.f);
+
+  // there is no edge before the first node or from the last one
+  EXPECT_EQ(etp.GetPrevEdge(0), nullptr);
+  EXPECT_EQ(etp.GetCurrEdge(3), nullptr);
+  EXPECT_EQ(etp.GetNextEdge(2), nullptr);
+  EXPECT_FALSE(path.node(3).has_edge());
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
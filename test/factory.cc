@@ -26,6 +26,75 @@ TEST(Factory, Register) {
   auto truck = factory.Create(Costing::truck);
 }
 
+TEST(Factory, Cache) {
+  Options options;
+  const rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  options.set_costing_type(Costing::auto_);
+  CostFactory factory;
+
+  // each request gets its own costing even when the options are the same
+  auto first = factory.Create(options);
+  first->RelaxHierarchyLimits(true);
+  first->set_allow_destination_only(false);
+  auto second = factory.Create(options);
+  ASSERT_NE(first, second);
+  EXPECT_EQ(second->travel_mode(), sif::TravelMode::kDrive);
+  EXPECT_NE(first->GetHierarchyLimits()[1].max_up_transitions,
+            second->GetHierarchyLimits()[1].max_up_transitions);
+
+  // the exclude edges of one request do not end up in the costing of the next
+  auto& costing = (*options.mutable_costings())[Costing::auto_];
+  auto* exclude = costing.mutable_options()->add_exclude_edges();
+  exclude->set_id(baldr::GraphId(0, 2, 42));
+  exclude->set_percent_along(0.5);
+  auto excluded = factory.Create(options);
+  EXPECT_TRUE(excluded->IsUserAvoidEdge(baldr::GraphId(0, 2, 42)));
+  costing.mutable_options()->clear_exclude_edges();
+  EXPECT_FALSE(factory.Create(options)->IsUserAvoidEdge(baldr::GraphId(0, 2, 42)));
+
+  // different options get a different costing
+  costing.mutable_options()->set_top_speed(60);
+  EXPECT_GT(factory.Create(options)->AStarCostFactor(), second->AStarCostFactor());
+}
+
+TEST(Factory, ExcludeEdges) {
+  Options options;
+  const rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  options.set_costing_type(Costing::auto_);
+  auto& costing = (*options.mutable_costings())[Costing::auto_];
+  for (const auto& edge : {std::make_pair(baldr::GraphId(5, 2, 7), 0.25f),
+                           std::make_pair(baldr::GraphId(5, 2, 700), 0.f),
+                           std::make_pair(baldr::GraphId(3, 1, 64), 0.f),
+                           std::make_pair(baldr::GraphId(5, 2, 7), 0.75f)}) {
+    auto* exclude = costing.mutable_options()->add_exclude_edges();
+    exclude->set_id(edge.first);
+    exclude->set_percent_along(edge.second);
+  }
+  auto excluded = CostFactory().Create(options);
+
+  EXPECT_TRUE(excluded->IsUserAvoidEdge(baldr::GraphId(5, 2, 7)));
+  EXPECT_TRUE(excluded->IsUserAvoidEdge(baldr::GraphId(5, 2, 700)));
+  EXPECT_TRUE(excluded->IsUserAvoidEdge(baldr::GraphId(3, 1, 64)));
+  EXPECT_FALSE(excluded->IsUserAvoidEdge(baldr::GraphId(5, 2, 8)));
+  EXPECT_FALSE(excluded->IsUserAvoidEdge(baldr::GraphId(5, 2, 7000)));
+  EXPECT_FALSE(excluded->IsUserAvoidEdge(baldr::GraphId(3, 1, 7)));
+  EXPECT_FALSE(excluded->IsUserAvoidEdge(baldr::GraphId(4, 2, 7)));
+
+  // the first percent along of an edge is kept
+  EXPECT_TRUE(excluded->AvoidAsOriginEdge(baldr::GraphId(5, 2, 7), 0.2f));
+  EXPECT_FALSE(excluded->AvoidAsOriginEdge(baldr::GraphId(5, 2, 7), 0.5f));
+  EXPECT_TRUE(excluded->AvoidAsDestinationEdge(baldr::GraphId(5, 2, 7), 0.5f));
+  EXPECT_FALSE(excluded->AvoidAsDestinationEdge(baldr::GraphId(5, 2, 7), 0.2f));
+
+  // edges without a percent along are avoided from their start
+  EXPECT_TRUE(excluded->AvoidAsOriginEdge(baldr::GraphId(5, 2, 700), 0.f));
+  EXPECT_FALSE(excluded->AvoidAsOriginEdge(baldr::GraphId(5, 2, 700), 0.1f));
+  EXPECT_TRUE(excluded->AvoidAsDestinationEdge(baldr::GraphId(5, 2, 700), 0.1f));
+  EXPECT_FALSE(excluded->AvoidAsDestinationEdge(baldr::GraphId(5, 2, 8), 0.1f));
+}
+
 // TODO: add many more tests!
 
 } // namespace
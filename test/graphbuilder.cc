@@ -2,10 +2,13 @@
 #include "baldr/graphreader.h"
 #include "midgard/sequence.h"
 #include "mjolnir/directededgebuilder.h"
+#include "mjolnir/node_expander.h"
 #include "mjolnir/osmdata.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/util.h"
 
+#include <cstring>
+#include <fstream>
 #include <sstream>
 #include <string>
 
@@ -92,6 +95,40 @@ TEST(Graphbuilder, TestConstructEdgesSubset) {
   EXPECT_TRUE(reader.DoesTileExist(GraphId{5993698}));
 }
 
+// Test that reclassifying in parallel changes the edges just like reclassifying on one thread.
+TEST(Graphbuilder, TestReclassifyInParallel) {
+  ptree config;
+  config.put<std::string>("mjolnir.tile_dir", tile_dir);
+  config.put("mjolnir.concurrency", 1);
+  OSMData osm_data{0};
+  osm_data.read_from_temp_files(tile_dir);
+  GraphBuilder::BuildEdges(config, ways_file, way_nodes_file, nodes_file, edges_file);
+  const std::string parallel_edges_file = "test_edges_harrisburg_parallel.bin";
+  {
+    std::ifstream in(edges_file, std::ios::binary);
+    std::ofstream out(parallel_edges_file, std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+  }
+
+  GraphBuilder::Reclassify(config, osm_data, ways_file, way_nodes_file, nodes_file, edges_file);
+  config.put("mjolnir.concurrency", 4);
+  GraphBuilder::Reclassify(config, osm_data, ways_file, way_nodes_file, nodes_file,
+                           parallel_edges_file);
+
+  sequence<Edge> edges(edges_file, false);
+  sequence<Edge> parallel_edges(parallel_edges_file, false);
+  ASSERT_EQ(edges.size(), parallel_edges.size());
+  size_t reclassified = 0;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const Edge edge = *edges[i];
+    const Edge parallel_edge = *parallel_edges[i];
+    EXPECT_EQ(memcmp(&edge, &parallel_edge, sizeof(Edge)), 0) << "edge " << i;
+    reclassified += edge.attributes.reclass_link;
+  }
+  EXPECT_GT(reclassified, 0);
+  filesystem::remove(parallel_edges_file);
+}
+
 TEST(Graphbuilder, TestDEBuilderLength) {
 
   std::vector<PointLL> shape1{{-160.096619f, 21.997619f},
@@ -3,9 +3,11 @@
 #include "baldr/connectivity_map.h"
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
+#include "baldr/tilescope.h"
 #include "filesystem.h"
 
 #include <fcntl.h>
+#include <thread>
 
 #include "test.h"
 
@@ -888,6 +890,283 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(CacheLruLevels, EvictWithinLevel) {
+  // local tiles get 3/4 of the cache, highway and arterial tiles 1/8 each
+  TileCacheLRU cache(8000, TileCacheLRU::MemoryLimitControl::HARD, {1, 1, 6});
+
+  GraphId highway_id(1, 0, 0);
+  cache.Put(highway_id, graph_tile_ptr{new TestGraphTile(highway_id, 1000)}, 1000);
+
+  // a burst of local tiles only evicts other local tiles
+  for (uint32_t i = 0; i < 20; ++i) {
+    GraphId local_id(i, 2, 0);
+    cache.Put(local_id, graph_tile_ptr{new TestGraphTile(local_id, 1000)}, 1000);
+    EXPECT_FALSE(cache.OverCommitted());
+  }
+  EXPECT_TRUE(cache.Contains(highway_id));
+  EXPECT_TRUE(cache.Contains(GraphId(19, 2, 0)));
+  EXPECT_TRUE(cache.Contains(GraphId(14, 2, 0)));
+  EXPECT_FALSE(cache.Contains(GraphId(13, 2, 0)));
+
+  // transit tiles share the last budget
+  GraphId transit_id(1, 3, 0);
+  cache.Put(transit_id, graph_tile_ptr{new TestGraphTile(transit_id, 1000)}, 1000);
+  EXPECT_FALSE(cache.Contains(GraphId(14, 2, 0)));
+
+  auto usage = cache.GetLevelUsage();
+  ASSERT_EQ(usage.size(), 4);
+  EXPECT_EQ(usage[0].level, 0);
+  EXPECT_EQ(usage[0].tiles, 1);
+  EXPECT_EQ(usage[0].bytes, 1000);
+  EXPECT_EQ(usage[0].max_bytes, 1000);
+  EXPECT_EQ(usage[1].tiles, 0);
+  EXPECT_EQ(usage[1].max_bytes, 1000);
+  EXPECT_EQ(usage[2].tiles, 5);
+  EXPECT_EQ(usage[2].bytes, 5000);
+  EXPECT_EQ(usage[2].max_bytes, 6000);
+  EXPECT_EQ(usage[3].tiles, 1);
+  EXPECT_EQ(usage[3].max_bytes, 6000);
+
+  // a tile too big for its budget is handed back without being cached
+  GraphId arterial_id(1, 1, 0);
+  auto tile = cache.Put(arterial_id, graph_tile_ptr{new TestGraphTile(arterial_id, 2000)}, 2000);
+  CheckGraphTile(tile, arterial_id, 2000);
+  EXPECT_FALSE(cache.Contains(arterial_id));
+  EXPECT_EQ(cache.GetLevelUsage()[1].rejected, 1);
+}
+
+TEST(CacheLruLevels, Admission) {
+  TileCacheLRU cache(2000, TileCacheLRU::MemoryLimitControl::HARD, {}, true);
+
+  // two tiles everyone asks for
+  GraphId popular1(1, 2, 0), popular2(2, 2, 0);
+  for (const auto& id : {popular1, popular2}) {
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(cache.Get(id), nullptr);
+    }
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 1000)}, 1000);
+  }
+
+  // a tile asked for once does not get to evict them
+  GraphId once(3, 2, 0);
+  EXPECT_EQ(cache.Get(once), nullptr);
+  auto tile = cache.Put(once, graph_tile_ptr{new TestGraphTile(once, 1000)}, 1000);
+  CheckGraphTile(tile, once, 1000);
+  EXPECT_FALSE(cache.Contains(once));
+  EXPECT_TRUE(cache.Contains(popular1));
+  EXPECT_TRUE(cache.Contains(popular2));
+
+  // until it is asked for more often than the least recently used one
+  for (int i = 0; i < 10; ++i) {
+    cache.Get(once);
+  }
+  cache.Put(once, graph_tile_ptr{new TestGraphTile(once, 1000)}, 1000);
+  EXPECT_TRUE(cache.Contains(once));
+  EXPECT_FALSE(cache.Contains(popular1));
+  EXPECT_TRUE(cache.Contains(popular2));
+
+  auto usage = cache.GetLevelUsage();
+  ASSERT_EQ(usage.size(), 1);
+  EXPECT_EQ(usage[0].level, 2);
+  EXPECT_EQ(usage[0].tiles, 2);
+  EXPECT_EQ(usage[0].max_bytes, 0);
+  EXPECT_EQ(usage[0].rejected, 1);
+}
+
+TEST(FrequencySketch, Estimates) {
+  FrequencySketch sketch(100);
+  for (uint64_t key = 0; key < 100; ++key) {
+    for (uint64_t i = 0; i < key % 10; ++i) {
+      sketch.increment(key);
+    }
+  }
+  // collisions can only overestimate
+  for (uint64_t key = 0; key < 100; ++key) {
+    EXPECT_GE(sketch.estimate(key), key % 10);
+  }
+  // counters saturate
+  for (int i = 0; i < 100; ++i) {
+    sketch.increment(1000);
+  }
+  EXPECT_EQ(sketch.estimate(1000), 15);
+  sketch.clear();
+  EXPECT_EQ(sketch.estimate(1000), 0);
+}
+
+TEST(ShardedCache, InsertWithEvictionSingleShard) {
+  // a single shard has the exact same eviction order as the lru cache
+  ShardedTileCache cache(500, 1, TileCacheLRU::MemoryLimitControl::HARD);
+
+  GraphId tile1_id(1000, 1, 0);
+  cache.Put(tile1_id, graph_tile_ptr{new TestGraphTile(tile1_id, 200)}, 200);
+  GraphId tile2_id(300, 2, 0);
+  cache.Put(tile2_id, graph_tile_ptr{new TestGraphTile(tile2_id, 250)}, 250);
+  GraphId tile3_id(1, 1, 0);
+  cache.Put(tile3_id, graph_tile_ptr{new TestGraphTile(tile3_id, 45)}, 45);
+
+  // the oldest entry goes first
+  GraphId tile4_id(400, 2, 0);
+  cache.Put(tile4_id, graph_tile_ptr{new TestGraphTile(tile4_id, 20)}, 20);
+  EXPECT_FALSE(cache.Contains(tile1_id));
+  EXPECT_TRUE(cache.Contains(tile2_id));
+  EXPECT_TRUE(cache.Contains(tile3_id));
+  EXPECT_TRUE(cache.Contains(tile4_id));
+
+  // touching tile2 makes tile3 the next one to go
+  CheckGraphTile(cache.Get(tile2_id), tile2_id, 250);
+  GraphId tile5_id(999, 1, 0);
+  cache.Put(tile5_id, graph_tile_ptr{new TestGraphTile(tile5_id, 200)}, 200);
+  EXPECT_TRUE(cache.Contains(tile2_id));
+  EXPECT_FALSE(cache.Contains(tile3_id));
+  EXPECT_TRUE(cache.Contains(tile4_id));
+  EXPECT_TRUE(cache.Contains(tile5_id));
+  EXPECT_FALSE(cache.OverCommitted());
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 0);
+  EXPECT_EQ(stats.evictions, 2);
+
+  EXPECT_EQ(cache.Get(tile1_id), nullptr);
+  EXPECT_EQ(cache.GetStats().misses, 1);
+}
+
+TEST(ShardedCache, OverwriteAndTrimSoft) {
+  ShardedTileCache cache(2000, 1, TileCacheLRU::MemoryLimitControl::SOFT);
+
+  GraphId tile1_id(10, 1, 0);
+  cache.Put(tile1_id, graph_tile_ptr{new TestGraphTile(tile1_id, 1500)}, 1500);
+  GraphId tile2_id(300, 2, 0);
+  cache.Put(tile2_id, graph_tile_ptr{new TestGraphTile(tile2_id, 400)}, 400);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  // overwriting replaces the size of the previous value
+  cache.Put(tile2_id, graph_tile_ptr{new TestGraphTile(tile2_id, 800)}, 800);
+  EXPECT_TRUE(cache.OverCommitted());
+  CheckGraphTile(cache.Get(tile2_id), tile2_id, 800);
+
+  // no eviction happens with the soft limit until we trim
+  EXPECT_TRUE(cache.Contains(tile1_id));
+  cache.Trim();
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(tile1_id));
+  EXPECT_TRUE(cache.Contains(tile2_id));
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Contains(tile2_id));
+  EXPECT_THROW(cache.Put(tile1_id, graph_tile_ptr{new TestGraphTile(tile1_id, 3000)}, 3000),
+               std::runtime_error);
+}
+
+TEST(ShardedCache, SharedBetweenCopies) {
+  ShardedTileCache cache(1000000, 16, TileCacheLRU::MemoryLimitControl::HARD);
+  ShardedTileCache copy(cache);
+
+  GraphId tile_id(42, 0, 0);
+  auto tile = cache.Put(tile_id, graph_tile_ptr{new TestGraphTile(tile_id, 100)}, 100);
+  EXPECT_EQ(copy.Get(tile_id), tile);
+  copy.Clear();
+  EXPECT_FALSE(cache.Contains(tile_id));
+}
+
+TEST(ShardedCache, ConcurrentAccess) {
+  ShardedTileCache cache(100000000, 8, TileCacheLRU::MemoryLimitControl::HARD);
+  constexpr size_t kThreads = 8;
+  constexpr uint32_t kTiles = 200;
+
+  // every thread works on its own tiles
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (uint32_t i = 0; i < kTiles; ++i) {
+        GraphId tile_id(t * kTiles + i, 2, 0);
+        cache.Put(tile_id, graph_tile_ptr{new TestGraphTile(tile_id, 100)}, 100);
+        CheckGraphTile(cache.Get(tile_id), tile_id, 100);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, kThreads * kTiles);
+  EXPECT_EQ(stats.misses, 0);
+  EXPECT_EQ(stats.evictions, 0);
+  for (uint32_t i = 0; i < kThreads * kTiles; ++i) {
+    EXPECT_TRUE(cache.Contains(GraphId(i, 2, 0)));
+  }
+}
+
+TEST(ShardedCache, ConcurrentSharedTiles) {
+  ShardedTileCache cache(100000000, 8, TileCacheLRU::MemoryLimitControl::HARD);
+  constexpr size_t kThreads = 8;
+  constexpr uint32_t kTiles = 50;
+  for (uint32_t i = 0; i < kTiles; ++i) {
+    GraphId tile_id(i, 2, 0);
+    cache.Put(tile_id, graph_tile_ptr{new TestGraphTile(tile_id, 100)}, 100);
+  }
+
+  // all threads copy and release the same tiles while one of them drops them from the cache
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (size_t round = 0; round < 100; ++round) {
+        for (uint32_t i = 0; i < kTiles; ++i) {
+          GraphId tile_id(i, 2, 0);
+          auto tile = cache.Get(tile_id);
+          if (tile) {
+            CheckGraphTile(tile, tile_id, 100);
+          }
+        }
+        if (t == 0 && round == 50) {
+          cache.Clear();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(cache.Contains(GraphId(0, 2, 0)));
+}
+
+class scope_reader : public GraphReader {
+public:
+  using GraphReader::cache_;
+  using GraphReader::GraphReader;
+};
+
+TEST(TileScope, PinsTiles) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/gphrdr_test");
+  scope_reader reader(pt);
+  for (uint32_t i = 0; i < 4; ++i) {
+    GraphId tile_id(i, 2, 0);
+    reader.cache_->Put(tile_id, graph_tile_ptr{new TestGraphTile(tile_id, 100)}, 100);
+  }
+
+  TileScope scope(2);
+  const auto& tile = scope.Get(reader, GraphId(0, 2, 5));
+  CheckGraphTile(tile, GraphId(0, 2, 0), 100);
+  // the same pin is handed out for every id within the tile
+  EXPECT_EQ(&scope.Get(reader, GraphId(0, 2, 17)), &tile);
+  EXPECT_EQ(scope.size(), 1);
+
+  // the pin outlives the tile in the cache
+  reader.cache_->Clear();
+  CheckGraphTile(scope.Get(reader, GraphId(0, 2, 0)), GraphId(0, 2, 0), 100);
+
+  // tiles the reader does not have are pinned as null pointers
+  EXPECT_EQ(scope.Get(reader, GraphId(1, 2, 0)), nullptr);
+  EXPECT_EQ(scope.size(), 2);
+  EXPECT_FALSE(scope.Trim());
+  EXPECT_EQ(scope.Get(reader, GraphId(2, 2, 0)), nullptr);
+  EXPECT_TRUE(scope.Trim());
+  EXPECT_EQ(scope.size(), 0);
+  EXPECT_EQ(scope.Get(reader, GraphId(0, 2, 0)), nullptr);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
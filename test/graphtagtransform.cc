@@ -0,0 +1,256 @@
+#include "test.h"
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mjolnir/graph_lua_proc.h"
+#include "mjolnir/graphtagtransform.h"
+#include "mjolnir/luatagtransform.h"
+#include "mjolnir/osmdata.h"
+
+using namespace valhalla;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// the keys the lua looks at with values it knows and some it doesnt
+const std::vector<std::pair<std::string, std::vector<std::string>>> kWayTags = {
+    {"highway",
+     {"motorway", "trunk_link", "primary", "residential", "service", "track", "footway", "steps",
+      "path", "cycleway", "bridleway", "pedestrian", "construction", "proposed", "busway",
+      "elevator", "platform", "living_street", "unknown", "bogus"}},
+    {"construction", {"primary", "motorway_link", "footway"}},
+    {"route", {"ferry", "shuttle_train", "bus"}},
+    {"railway", {"rail", "platform"}},
+    {"access", {"yes", "no", "private", "destination", "psv", "emergency", "permissive", "hov",
+                "taxi", "delivery"}},
+    {"vehicle", {"no", "yes"}},
+    {"motor_vehicle", {"no", "yes", "destination", "agricultural"}},
+    {"motorcar", {"no", "yes"}},
+    {"hgv", {"no", "designated", "local", "permissive"}},
+    {"bus", {"yes", "no", "designated"}},
+    {"taxi", {"yes", "no"}},
+    {"psv", {"yes", "no", "bus", "taxi"}},
+    {"foot", {"yes", "no", "designated", "crossing"}},
+    {"pedestrian", {"yes", "no"}},
+    {"bicycle", {"yes", "no", "dismount", "use_sidepath"}},
+    {"moped", {"yes", "no"}},
+    {"mofa", {"no", "yes"}},
+    {"motorcycle", {"no", "yes"}},
+    {"emergency", {"yes", "no"}},
+    {"service",
+     {"driveway", "alley", "parking_aisle", "emergency_access", "drive-through", "spur"}},
+    {"impassable", {"yes"}},
+    {"area", {"yes", "no"}},
+    {"oneway", {"yes", "-1", "no", "reversible", "alternating", "1", "true"}},
+    {"oneway:bicycle", {"no", "yes", "-1"}},
+    {"oneway:bus", {"no", "yes", "-1"}},
+    {"oneway:psv", {"no", "yes"}},
+    {"oneway:taxi", {"no", "-1"}},
+    {"oneway:moped", {"no", "-1"}},
+    {"oneway:mofa", {"no", "-1"}},
+    {"oneway:motorcycle", {"no", "-1"}},
+    {"oneway:foot", {"no", "yes", "-1"}},
+    {"junction", {"roundabout", "circular", "yes"}},
+    {"cycleway", {"lane", "track", "opposite", "opposite_lane", "shared_lane", "no"}},
+    {"cycleway:left", {"lane", "opposite_track", "track"}},
+    {"cycleway:right", {"lane", "shared", "opposite_lane"}},
+    {"cycleway:both", {"lane", "separate"}},
+    {"cycleway:both:buffer", {"yes"}},
+    {"cycleway:right:buffer", {"yes"}},
+    {"segregated", {"yes", "no"}},
+    {"busway", {"lane", "opposite_lane"}},
+    {"busway:left", {"lane"}},
+    {"busway:right", {"lane"}},
+    {"bus:backward", {"yes", "designated"}},
+    {"taxi:backward", {"yes"}},
+    {"lanes:bus", {"1", "2"}},
+    {"lanes:psv", {"1", "2"}},
+    {"lanes:psv:forward", {"designated"}},
+    {"lanes:psv:backward", {"designated"}},
+    {"bicycle:backward", {"yes", "no"}},
+    {"foot:backward", {"yes", "no"}},
+    {"motor_vehicle:forward", {"no", "yes"}},
+    {"vehicle:backward", {"no"}},
+    {"sac_scale", {"hiking", "alpine_hiking"}},
+    {"motorroad", {"yes"}},
+    {"maxspeed", {"50", "30 mph", "none", "200", "5", "signals", "45mph"}},
+    {"maxspeed:advisory", {"40", "25 mph"}},
+    {"maxspeed:forward", {"60"}},
+    {"maxspeed:hgv", {"80", "55 mph"}},
+    {"lanes", {"2", "4;3", "20", "a"}},
+    {"lanes:forward", {"1", "2"}},
+    {"maxheight", {"4", "3.5", "4,2", "12'6\"", "3 m", "13 ft 6 in", "default", "none", "2.0"}},
+    {"maxheight:physical", {"4.1", "14'"}},
+    {"maxwidth", {"2.5", "7'"}},
+    {"maxlength", {"12", "40 ft"}},
+    {"maxweight", {"3.5", "7.5 t", "10000 lbs", "3500kg", "3 tons", "12 st"}},
+    {"maxaxleload", {"10", "11.5t"}},
+    {"maxaxles", {"2", "x"}},
+    {"hazmat", {"no", "yes", "destination"}},
+    {"hazmat:water", {"no"}},
+    {"shoulder", {"yes", "no", "right", "left", "both"}},
+    {"shoulder:right", {"yes"}},
+    {"shoulder:left", {"yes"}},
+    {"hov", {"designated", "lane", "no"}},
+    {"hov:lanes", {"designated", "designated|designated", "|designated", "yes|designated"}},
+    {"hov:minimum", {"2", "3", "4"}},
+    {"oneway:conditional", {"-1 @ (15:00-19:00)"}},
+    {"tunnel", {"yes", "building_passage", "culvert"}},
+    {"bridge", {"yes", "viaduct"}},
+    {"toll", {"yes", "no", "snowmobile"}},
+    {"lit", {"yes", "no", "24/7", "dusk-dawn"}},
+    {"wheelchair", {"yes", "no", "limited"}},
+    {"tracktype", {"grade1", "grade3", "grade5"}},
+    {"conveying", {"yes"}},
+    {"footway", {"sidewalk", "crossing"}},
+    {"seasonal", {"yes", "no", "winter"}},
+    {"name", {"Main Street"}},
+    {"ref", {"I 80"}},
+    {"unsigned_ref", {"SR 12"}},
+    {"ncn_ref", {"4"}},
+    {"rcn", {"yes"}},
+    {"lcn_ref", {"12"}},
+    {"mtb", {"yes"}},
+    {"hgv:national_network", {"yes"}},
+    {"level", {"0", "-1;0", "1;2;3"}},
+    {"FIXME", {"check"}},
+    {"note", {"a note"}},
+    {"source", {"survey"}},
+};
+
+const std::vector<std::pair<std::string, std::vector<std::string>>> kNodeTags = {
+    {"barrier", {"gate", "bollard", "block", "sump_buster", "border_control", "toll_booth", "yes",
+                 "lift_gate", "jersey_barrier"}},
+    {"bollard", {"rising", "removable"}},
+    {"access", {"yes", "no", "private", "psv", "emergency", "destination"}},
+    {"motor_vehicle", {"no", "yes"}},
+    {"motorcar", {"yes", "no"}},
+    {"foot", {"yes", "no", "crossing"}},
+    {"bicycle", {"no", "yes"}},
+    {"wheelchair", {"yes", "no"}},
+    {"hgv", {"yes", "no"}},
+    {"bus", {"yes", "no"}},
+    {"taxi", {"yes"}},
+    {"psv", {"yes", "bus", "taxi", "no"}},
+    {"moped", {"yes", "no"}},
+    {"mofa", {"yes"}},
+    {"motorcycle", {"yes", "no"}},
+    {"emergency", {"yes"}},
+    {"vehicle", {"no"}},
+    {"hov", {"designated", "no"}},
+    {"impassable", {"yes"}},
+    {"highway", {"crossing", "traffic_signals", "stop", "give_way", "toll_gantry", "elevator"}},
+    {"railway", {"crossing"}},
+    {"crossing", {"zebra"}},
+    {"direction", {"both", "forward", "backward", "reverse", "north"}},
+    {"stop", {"all"}},
+    {"traffic_signals:direction", {"forward", "backward"}},
+    {"name", {"Main & 1st"}},
+    {"public_transport", {"stop_position"}},
+    {"junction", {"yes"}},
+    {"reference_point", {"yes"}},
+    {"payment:cash", {"yes", "no"}},
+    {"payment:coins", {"yes"}},
+    {"payment:credit_cards", {"yes", "NO"}},
+    {"entrance", {"yes"}},
+    {"indoor", {"yes"}},
+    {"amenity", {"bicycle_rental"}},
+    {"iso:3166_2", {"US-PA", "DE-BY", "FR", "USA", "CAAB", "GB-ENG", "A-B"}},
+};
+
+const std::vector<std::pair<std::string, std::vector<std::string>>> kRelationTags = {
+    {"type", {"restriction", "route", "connectivity", "multipolygon"}},
+    {"restriction", {"no_left_turn", "only_straight_on", "no_entry", "bogus"}},
+    {"restriction:conditional",
+     {"no_right_turn @ (Mo-Fr 07:00-09:00)", "no_u_turn@wet", "only_left_turn @", "no_turn"}},
+    {"restriction:probable", {"no_left_turn @ (00:00-06:00)"}},
+    {"restriction:hgv", {"no_left_turn", "no_exit"}},
+    {"restriction:bus", {"only_right_turn"}},
+    {"restriction:foot", {"no_straight_on"}},
+    {"route", {"bicycle", "mtb", "road", "bus"}},
+    {"network", {"ncn", "rcn", "lcn", "mtb"}},
+    {"day_on", {"Monday"}},
+    {"day_off", {"Friday"}},
+};
+
+// random combinations of the tags, each of them present a third of the time
+std::vector<Tags>
+Combinations(const std::vector<std::pair<std::string, std::vector<std::string>>>& candidates,
+             size_t count) {
+  std::mt19937 generator(42);
+  std::vector<Tags> combinations;
+  for (size_t i = 0; i < count; ++i) {
+    Tags tags;
+    for (const auto& candidate : candidates) {
+      const auto pick = generator() % (candidate.second.size() * 3);
+      if (pick < candidate.second.size()) {
+        tags.emplace(candidate.first, candidate.second[pick]);
+      }
+    }
+    combinations.push_back(std::move(tags));
+  }
+  return combinations;
+}
+
+std::string ToString(const Tags& tags) {
+  std::map<std::string, std::string> sorted(tags.begin(), tags.end());
+  std::string str;
+  for (const auto& tag : sorted) {
+    str += tag.first + "=" + tag.second + " ";
+  }
+  return str;
+}
+
+void ExpectSameAsLua(OSMType type, const std::vector<Tags>& combinations) {
+  LuaTagTransform lua(std::string(lua_graph_lua, lua_graph_lua + lua_graph_lua_len));
+  GraphTagTransform graph;
+  for (const auto& tags : combinations) {
+    EXPECT_EQ(graph.Transform(type, 1, tags), lua.Transform(type, 1, tags))
+        << "tags: " << ToString(tags);
+  }
+}
+
+TEST(GraphTagTransform, Ways) {
+  auto ways = Combinations(kWayTags, 20000);
+  ways.push_back({});
+  ways.push_back({{"highway", "primary"}});
+  ways.push_back({{"highway", "primary"}, {"maxweight", "."}});
+  ExpectSameAsLua(OSMType::kWay, ways);
+}
+
+TEST(GraphTagTransform, Nodes) {
+  auto nodes = Combinations(kNodeTags, 10000);
+  nodes.push_back({});
+  ExpectSameAsLua(OSMType::kNode, nodes);
+}
+
+TEST(GraphTagTransform, Relations) {
+  auto relations = Combinations(kRelationTags, 5000);
+  relations.push_back({});
+  ExpectSameAsLua(OSMType::kRelation, relations);
+}
+
+TEST(GraphTagTransform, Measurements) {
+  GraphTagTransform graph;
+  for (const auto& height : std::vector<std::pair<std::string, std::string>>{
+           {"2.0", "2"}, {"1,5", "1.5"}, {"12'6\"", "3.81"}, {"6ft", "1.83"}, {"150 cm", "1.5"}}) {
+    auto results =
+        graph.Transform(OSMType::kWay, 1, {{"highway", "tertiary"}, {"maxheight", height.first}});
+    EXPECT_EQ(results["maxheight"], height.second) << height.first;
+  }
+  auto results =
+      graph.Transform(OSMType::kWay, 1, {{"highway", "tertiary"}, {"maxheight", "none"}});
+  EXPECT_EQ(results.count("maxheight"), 0);
+  EXPECT_FALSE(results.empty());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
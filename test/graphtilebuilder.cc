@@ -333,6 +333,173 @@ TEST(GraphTileBuilder, TestBinEdges) {
   EXPECT_EQ(tweeners.size(), 1) << "This edge leaves a tile for 1 other tile and comes back.";
 }
 
+TEST(GraphTileBuilder, TestStopDepartureIndex) {
+  // a stop with a bus and two rail lines leaving it and a node without any
+  const std::string test_dir = "test/data/stop_departures";
+  const GraphId tile_id(0, 3, 0);
+  {
+    GraphTileBuilder builder(test_dir, tile_id, false);
+    builder.nodes().resize(2);
+    builder.nodes()[0].set_edge_index(0);
+    builder.nodes()[0].set_edge_count(3);
+    builder.nodes()[1].set_edge_index(3);
+    builder.nodes()[1].set_edge_count(1);
+    builder.directededges().resize(4);
+    builder.directededges()[0].set_use(Use::kBus);
+    builder.directededges()[0].set_lineid(1);
+    builder.directededges()[1].set_use(Use::kRail);
+    builder.directededges()[1].set_lineid(2);
+    builder.directededges()[2].set_use(Use::kRail);
+    builder.directededges()[2].set_lineid(3);
+    builder.directededges()[3].set_use(Use::kRoad);
+    builder.AddTransitSchedule(TransitSchedule(~0ULL, kAllDaysOfWeek, 63));
+    builder.AddTransitDeparture(TransitDeparture(1, 10, 0, 0, 0, 32400, 60, 0, true, true));
+    builder.AddTransitDeparture(TransitDeparture(1, 11, 0, 0, 0, 28800, 60, 0, true, true));
+    builder.AddTransitDeparture(TransitDeparture(2, 12, 0, 0, 0, 30600, 60, 0, false, true));
+    builder.AddTransitDeparture(
+        TransitDeparture(3, 13, 0, 0, 0, 25200, 36000, 1200, 60, 0, false, true));
+    builder.StoreTileData();
+  }
+
+  auto tile = GraphTile::Create(test_dir, tile_id);
+  ASSERT_TRUE(tile->has_stop_departures());
+  auto next = [&](const uint32_t node, const uint32_t time, const bool wheelchair) {
+    uint32_t departure_time = 0;
+    const auto* departure =
+        tile->GetNextStopDeparture(node, time, 0, kMonday, false, wheelchair, false, departure_time);
+    return std::make_pair(departure ? departure->tripid() : 0, departure_time);
+  };
+
+  // the frequency based rail runs every 20 minutes from 7:00 until 10:00
+  EXPECT_EQ(next(0, 27000, false), std::make_pair(13u, 27600u));
+  // a fixed departure wins a tie
+  EXPECT_EQ(next(0, 28000, false), std::make_pair(11u, 28800u));
+  // the rails are not wheelchair accessible
+  EXPECT_EQ(next(0, 29000, false), std::make_pair(13u, 30000u));
+  EXPECT_EQ(next(0, 29000, true), std::make_pair(10u, 32400u));
+  // nothing leaves after the last bus or from a node without transit lines
+  EXPECT_EQ(next(0, 36001, false).first, 0u);
+  EXPECT_EQ(next(1, 0, false).first, 0u);
+
+  // it agrees with looking up each line on its own
+  for (uint32_t time = 20000; time < 37000; time += 250) {
+    uint32_t earliest = std::numeric_limits<uint32_t>::max();
+    for (const uint32_t lineid : {1, 2, 3}) {
+      std::unique_ptr<const TransitDeparture> frequency;
+      const auto* departure = tile->GetNextDeparture(lineid, time, 0, kMonday, false, false, false);
+      if (departure && departure->type() == kFrequencySchedule) {
+        frequency.reset(departure);
+      }
+      if (departure) {
+        earliest = std::min(earliest, departure->departure_time());
+      }
+    }
+    const auto found = next(0, time, false);
+    EXPECT_EQ(found.first != 0 ? found.second : std::numeric_limits<uint32_t>::max(), earliest);
+  }
+}
+
+TEST(GraphTileBuilder, TestPatchPredictedSpeeds) {
+  const std::string test_dir = "test/data/patch_predicted_speeds";
+  const GraphId tile_id(0, 2, 0);
+  {
+    GraphTileBuilder builder(test_dir, tile_id, false);
+    builder.nodes().resize(1);
+    builder.nodes()[0].set_edge_count(3);
+    builder.directededges().resize(3);
+    builder.StoreTileData();
+  }
+  const auto size = GraphTile::Create(test_dir, tile_id)->header()->end_offset();
+
+  std::array<int16_t, kCoefficientCount> first, second;
+  for (uint32_t c = 0; c < kCoefficientCount; ++c) {
+    first[c] = c;
+    second[c] = -static_cast<int16_t>(c);
+  }
+
+  // a profile for the first edge and a constrained speed for the last one
+  ASSERT_TRUE(GraphTileBuilder::PatchPredictedSpeeds(
+      test_dir, tile_id,
+      [&](const uint32_t idx, DirectedEdge& edge, std::array<int16_t, kCoefficientCount>& profile) {
+        if (idx == 0) {
+          edge.set_free_flow_speed(50);
+          profile = first;
+          return true;
+        }
+        if (idx == 2) {
+          edge.set_constrained_flow_speed(30);
+        }
+        return false;
+      }));
+  auto tile = GraphTile::Create(test_dir, tile_id);
+  ASSERT_TRUE(tile);
+  const auto patched_size = tile->header()->end_offset();
+  EXPECT_EQ(patched_size, size + 3 * sizeof(uint32_t) + kCoefficientCount * sizeof(int16_t));
+  EXPECT_EQ(tile->header()->predictedspeeds_count(), 1);
+  EXPECT_EQ(tile->node(0)->edge_count(), 3);
+  EXPECT_TRUE(tile->directededge(0)->has_predicted_speed());
+  EXPECT_EQ(tile->directededge(0)->free_flow_speed(), 50);
+  EXPECT_FALSE(tile->directededge(2)->has_predicted_speed());
+  EXPECT_EQ(tile->directededge(2)->constrained_flow_speed(), 30);
+  EXPECT_EQ(tile->GetSpeedProfile(0), first);
+
+  // patching again replaces the predicted speeds instead of appending to them
+  ASSERT_TRUE(GraphTileBuilder::PatchPredictedSpeeds(
+      test_dir, tile_id,
+      [&](const uint32_t idx, DirectedEdge&, std::array<int16_t, kCoefficientCount>& profile) {
+        profile = second;
+        return idx == 1;
+      }));
+  tile = GraphTile::Create(test_dir, tile_id);
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(tile->header()->end_offset(), patched_size);
+  EXPECT_EQ(tile->header()->predictedspeeds_count(), 1);
+  EXPECT_FALSE(tile->directededge(0)->has_predicted_speed());
+  EXPECT_EQ(tile->directededge(0)->free_flow_speed(), 50);
+  EXPECT_TRUE(tile->directededge(1)->has_predicted_speed());
+  EXPECT_EQ(tile->GetSpeedProfile(1), second);
+
+  // there is nothing to patch without a tile
+  EXPECT_FALSE(GraphTileBuilder::PatchPredictedSpeeds(
+      test_dir, GraphId(1, 2, 0),
+      [](const uint32_t, DirectedEdge&, std::array<int16_t, kCoefficientCount>&) {
+        return false;
+      }));
+}
+
+TEST(GraphTileBuilder, TestPatchDirectedEdges) {
+  const std::string test_dir = "test/data/patch_directed_edges";
+  const GraphId tile_id(0, 2, 0);
+  {
+    GraphTileBuilder builder(test_dir, tile_id, false);
+    builder.nodes().resize(2);
+    builder.nodes()[0].set_edge_count(2);
+    builder.nodes()[1].set_edge_index(2);
+    builder.nodes()[1].set_edge_count(1);
+    builder.directededges().resize(3);
+    builder.StoreTileData();
+  }
+  auto tile = GraphTile::Create(test_dir, tile_id);
+  const auto size = tile->header()->end_offset();
+
+  std::vector<DirectedEdge> edges(tile->directededge(0), tile->directededge(0) + 3);
+  edges[0].set_speed(80);
+  edges[2].set_truck_speed(60);
+  ASSERT_TRUE(GraphTileBuilder::PatchDirectedEdges(test_dir, tile_id, edges));
+  tile = GraphTile::Create(test_dir, tile_id);
+  ASSERT_TRUE(tile);
+  EXPECT_EQ(tile->header()->end_offset(), size);
+  EXPECT_EQ(tile->node(1)->edge_index(), 2);
+  EXPECT_EQ(tile->directededge(0)->speed(), 80);
+  EXPECT_EQ(tile->directededge(2)->truck_speed(), 60);
+
+  // the edges have to be all the edges of the tile
+  edges.pop_back();
+  EXPECT_FALSE(GraphTileBuilder::PatchDirectedEdges(test_dir, tile_id, edges));
+  // and there is nothing to patch without a tile
+  EXPECT_FALSE(GraphTileBuilder::PatchDirectedEdges(test_dir, GraphId(1, 2, 0), edges));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -78,6 +78,37 @@ TEST(GriddedData, Basic) {
   */
 }
 
+TEST(GriddedData, ParallelContours) {
+  // two metrics, distance from center and distance from a corner
+  GriddedData<2> g({-7, -7, 7, 7}, 1, {std::numeric_limits<float>::max(),
+                                       std::numeric_limits<float>::max()});
+  Tiles<PointLL> t({-7, -7, 7, 7}, 1);
+  for (int i = 0; i < 14; ++i) {
+    for (int j = 0; j < 14; ++j) {
+      auto b = t.Base(t.TileId(i, j));
+      g.SetIfLessThan(t.TileId(i, j), {PointLL(0, 0).Distance(b), PointLL(-7, -7).Distance(b)});
+    }
+  }
+
+  std::vector<GriddedData<2>::contour_interval_t> iso_markers{
+      {0, 100000, "dist", ""}, {0, 300000, "dist", ""}, {0, 500000, "dist", ""},
+      {1, 400000, "corner", ""}, {1, 800000, "corner", ""},
+  };
+  auto sequential = g.GenerateContours(iso_markers, false, 0.f, 0.f);
+
+  // the intervals are traced independently so any number of threads gives the same lines
+  for (size_t threads : {2, 3, 8}) {
+    auto markers = iso_markers;
+    auto parallel = g.GenerateContours(markers, false, 0.f, 0.f, threads);
+    ASSERT_EQ(markers, iso_markers);
+    ASSERT_EQ(parallel.size(), sequential.size());
+    for (size_t i = 0; i < sequential.size(); ++i) {
+      ASSERT_FALSE(sequential[i].front().empty());
+      EXPECT_EQ(parallel[i], sequential[i]) << "Contour " << i << " with " << threads << " threads";
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,103 @@
+#include "test.h"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mjolnir/gtfs_stop_times.h"
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+const std::string kStopTimesFile = "test/data/gtfs_stop_times_test.txt";
+
+void write_stop_times(const std::string& header, const size_t trips, const size_t stops) {
+  std::ofstream out(kStopTimesFile, std::ios::out | std::ios::binary | std::ios::trunc);
+  out << header << "\r\n";
+  for (size_t trip = 0; trip < trips; ++trip) {
+    for (size_t stop = 0; stop < stops; ++stop) {
+      out << "\"trip " << trip << "\",8:0" << stop % 10 << ":00,08:0" << stop % 10 << ":30,stop_"
+          << stop << "," << stop + 1 << "," << stop * 100 << "\r\n";
+    }
+  }
+}
+
+std::vector<GtfsStopTime> read_all(const unsigned int threads, const size_t batch_size) {
+  std::vector<GtfsStopTime> stop_times;
+  std::mutex lock;
+  const auto consume = [&](std::vector<GtfsStopTime>& batch) {
+    std::lock_guard<std::mutex> guard(lock);
+    stop_times.insert(stop_times.end(), batch.begin(), batch.end());
+  };
+  const auto count = read_gtfs_stop_times(kStopTimesFile, threads, batch_size, consume);
+  EXPECT_EQ(count, stop_times.size());
+  std::sort(stop_times.begin(), stop_times.end(), [](const GtfsStopTime& a, const GtfsStopTime& b) {
+    return a.trip_id == b.trip_id ? a.stop_sequence < b.stop_sequence : a.trip_id < b.trip_id;
+  });
+  return stop_times;
+}
+
+TEST(GtfsStopTimes, ParseTime) {
+  EXPECT_EQ(parse_gtfs_time("08:30:15"), 8 * 3600 + 30 * 60 + 15);
+  EXPECT_EQ(parse_gtfs_time("8:30:15"), 8 * 3600 + 30 * 60 + 15);
+  EXPECT_EQ(parse_gtfs_time("25:00:00"), 25 * 3600);
+  EXPECT_EQ(parse_gtfs_time(""), 0);
+  EXPECT_EQ(parse_gtfs_time("08:30"), 0);
+}
+
+TEST(GtfsStopTimes, SplitLine) {
+  std::vector<std::string> fields;
+  split_gtfs_line("a, b ,\"c,d\",\"say \"\"hi\"\"\",", fields);
+  ASSERT_EQ(fields.size(), 5);
+  EXPECT_EQ(fields[0], "a");
+  EXPECT_EQ(fields[1], "b");
+  EXPECT_EQ(fields[2], "c,d");
+  EXPECT_EQ(fields[3], "say \"hi\"");
+  EXPECT_EQ(fields[4], "");
+}
+
+TEST(GtfsStopTimes, ThreadsReadTheSameRows) {
+  write_stop_times("\xEF\xBB\xBFtrip_id,arrival_time,departure_time,stop_id,stop_sequence,"
+                   "shape_dist_traveled",
+                   50, 37);
+  const auto single = read_all(1, 1000);
+  ASSERT_EQ(single.size(), 50 * 37);
+  EXPECT_EQ(single.front().trip_id, "trip 0");
+  EXPECT_EQ(single.front().stop_id, "stop_0");
+  EXPECT_EQ(single.front().stop_sequence, 1);
+  EXPECT_EQ(single.front().arrival_time, 8 * 3600);
+  EXPECT_EQ(single.front().departure_time, 8 * 3600 + 30);
+  EXPECT_EQ(single[1].shape_dist_traveled, 100.f);
+
+  for (const unsigned int threads : {2u, 3u, 7u, 64u}) {
+    const auto multi = read_all(threads, 13);
+    ASSERT_EQ(multi.size(), single.size()) << threads << " threads";
+    for (size_t i = 0; i < single.size(); ++i) {
+      EXPECT_EQ(multi[i].trip_id, single[i].trip_id);
+      EXPECT_EQ(multi[i].stop_id, single[i].stop_id);
+      EXPECT_EQ(multi[i].stop_sequence, single[i].stop_sequence);
+      EXPECT_EQ(multi[i].arrival_time, single[i].arrival_time);
+      EXPECT_EQ(multi[i].departure_time, single[i].departure_time);
+      EXPECT_EQ(multi[i].shape_dist_traveled, single[i].shape_dist_traveled);
+    }
+  }
+}
+
+TEST(GtfsStopTimes, MissingColumn) {
+  write_stop_times("trip_id,arrival_time,departure_time,stop,stop_sequence", 1, 2);
+  EXPECT_THROW(read_all(2, 10), std::runtime_error);
+  EXPECT_THROW(read_gtfs_stop_times("test/data/no_such_stop_times.txt", 1, 10,
+                                    [](std::vector<GtfsStopTime>&) {}),
+               std::runtime_error);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -642,12 +642,18 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
     case valhalla::Options::isochrone:
       json_str = actor.isochrone(request_json, nullptr, &api);
       break;
+    case valhalla::Options::isochrone_batch:
+      json_str = actor.isochrone_batch(request_json, nullptr, &api);
+      break;
     case valhalla::Options::optimized_route:
       json_str = actor.optimized_route(request_json, nullptr, &api);
       break;
     case valhalla::Options::sources_to_targets:
       json_str = actor.matrix(request_json, nullptr, &api);
       break;
+    case valhalla::Options::route_batch:
+      json_str = actor.route_batch(request_json, nullptr, &api);
+      break;
     case valhalla::Options::height:
       json_str = actor.height(request_json, nullptr, &api);
       break;
@@ -657,6 +663,9 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
     case valhalla::Options::transit_available:
       json_str = actor.transit_available(request_json, nullptr, &api);
       break;
+    case valhalla::Options::tile:
+      json_str = actor.tile(request_json, nullptr, &api);
+      break;
     default:
       throw std::logic_error("Unsupported action");
       break;
@@ -701,7 +710,7 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
   return do_action(action, map, *request_json, reader, response);
 }
 
-// overload for /sources_to_targets
+// overload for /sources_to_targets and /route_batch
 valhalla::Api do_action(const valhalla::Options::Action& action,
                         const map& map,
                         const std::vector<std::string>& sources,
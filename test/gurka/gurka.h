@@ -207,7 +207,7 @@ valhalla::Api do_action(const valhalla::Options::Action& action,
                         const std::string& stop_type = "break",
                         std::string* request_json = nullptr);
 
-// overload for /sources_to_targets
+// overload for /sources_to_targets and /route_batch
 valhalla::Api do_action(const valhalla::Options::Action& action,
                         const map& map,
                         const std::vector<std::string>& sources,
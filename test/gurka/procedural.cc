@@ -0,0 +1,291 @@
+#include "procedural.h"
+#include "test.h"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/builder/osm_object_builder.hpp>
+#include <osmium/io/pbf_output.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+using namespace valhalla;
+using namespace valhalla::gurka::procedural;
+
+namespace {
+
+// bumped whenever the same parameters would build a different map
+constexpr uint32_t kVersion = 1;
+// segments of the ways rows, columns, rings and spokes are split into
+constexpr uint32_t kWaySegments = 10;
+// bytes of osm objects kept in memory before they are written to the pbf
+constexpr size_t kBufferSize = 16 * 1024 * 1024;
+// the same timestamp for every object so that the pbf only depends on the parameters
+constexpr time_t kTimestamp = 1577836800;
+
+// splitmix64, unlike the distributions of <random> it is the same on every platform
+uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// a number in [0, 1) that only depends on the seed and what it is for
+double unit(const uint32_t seed, const uint64_t what) {
+  return (mix(mix(seed) ^ what) >> 11) * (1.0 / (1ULL << 53));
+}
+
+const char* road_class(const Params& params, const uint32_t index) {
+  if (params.highway_every && index % params.highway_every == 0) {
+    return "motorway";
+  }
+  if (params.arterial_every && index % params.arterial_every == 0) {
+    return "primary";
+  }
+  return "residential";
+}
+
+// the node ids and positions of a layout, ids start at 1 and have no gaps
+class Network {
+public:
+  explicit Network(const Params& params) : params_(params) {
+    if (params.size < 2 || params.spacing <= 0 ||
+        (params.layout == Layout::kRadial && params.spokes < 3)) {
+      throw std::invalid_argument("A procedural map needs at least 2 rows or rings, a positive "
+                                  "spacing and a radial city at least 3 spokes");
+    }
+  }
+
+  uint64_t node_count() const {
+    return params_.layout == Layout::kGrid
+               ? static_cast<uint64_t>(params_.size) * params_.size
+               : 1 + static_cast<uint64_t>(params_.size) * params_.spokes;
+  }
+
+  // rows and columns count from the top left corner
+  uint64_t grid_node(const uint32_t row, const uint32_t column) const {
+    return static_cast<uint64_t>(row) * params_.size + column + 1;
+  }
+
+  // rings count from 1, the center is ring 0
+  uint64_t radial_node(const uint32_t ring, const uint32_t spoke) const {
+    return ring == 0 ? 1 : 2 + static_cast<uint64_t>(ring - 1) * params_.spokes + spoke;
+  }
+
+  midgard::PointLL position(const uint64_t id) const {
+    // meters east and south of the origin
+    double x, y;
+    const uint64_t index = id - 1;
+    if (params_.layout == Layout::kGrid) {
+      x = (index % params_.size) * params_.spacing;
+      y = (index / params_.size) * params_.spacing;
+    } else if (index == 0) {
+      x = y = 0;
+    } else {
+      const double radius = ((index - 1) / params_.spokes + 1) * params_.spacing;
+      const double angle = ((index - 1) % params_.spokes) * midgard::kPiD * 2 / params_.spokes;
+      x = radius * std::cos(angle);
+      y = -radius * std::sin(angle);
+    }
+    if (params_.jitter > 0) {
+      x += (unit(params_.seed, id * 2) * 2 - 1) * params_.jitter;
+      y += (unit(params_.seed, id * 2 + 1) * 2 - 1) * params_.jitter;
+    }
+    const double lat = params_.origin.lat() - y / midgard::kMetersPerDegreeLat;
+    const double lng =
+        params_.origin.lng() +
+        x / (midgard::kMetersPerDegreeLat * std::cos(params_.origin.lat() * midgard::kRadPerDegD));
+    return {lng, lat};
+  }
+
+  /**
+   * Calls back with the nodes, road class and name of every way of the layout. Rows, columns,
+   * rings and spokes are split into ways of kWaySegments segments.
+   */
+  template <typename way_callback_t> void ways(const way_callback_t& callback) const {
+    const auto size = params_.size;
+    std::vector<uint64_t> nodes;
+    const auto split = [&](const std::function<uint64_t(uint32_t)>& node, const uint32_t count,
+                           const char* highway, const std::string& name) {
+      for (uint32_t first = 0; first + 1 < count; first += kWaySegments) {
+        nodes.clear();
+        for (uint32_t i = first; i < count && i <= first + kWaySegments; ++i) {
+          nodes.push_back(node(i));
+        }
+        callback(nodes, highway, name);
+      }
+    };
+
+    if (params_.layout == Layout::kGrid) {
+      for (uint32_t row = 0; row < size; ++row) {
+        split([&](uint32_t column) { return grid_node(row, column); }, size,
+              road_class(params_, row), "row " + std::to_string(row));
+      }
+      for (uint32_t column = 0; column < size; ++column) {
+        split([&](uint32_t row) { return grid_node(row, column); }, size,
+              road_class(params_, column), "column " + std::to_string(column));
+      }
+      return;
+    }
+
+    // rings are closed by coming back to the first spoke
+    const auto spokes = params_.spokes;
+    for (uint32_t ring = 1; ring <= size; ++ring) {
+      split([&](uint32_t spoke) { return radial_node(ring, spoke % spokes); }, spokes + 1,
+            road_class(params_, ring), "ring " + std::to_string(ring));
+    }
+    for (uint32_t spoke = 0; spoke < spokes; ++spoke) {
+      split([&](uint32_t ring) { return radial_node(ring, spoke); }, size + 1,
+            spoke % 4 == 0 ? "primary" : "secondary", "spoke " + std::to_string(spoke));
+    }
+  }
+
+private:
+  const Params& params_;
+};
+
+// writes the pbf as it is generated rather than collecting and sorting the objects first, the ids
+// of the nodes and then of the ways are generated in order
+void write_pbf(const Params& params, const std::string& filename) {
+  namespace attr = osmium::builder::attr;
+  const Network network(params);
+
+  osmium::io::Header header;
+  header.set("generator", "valhalla-procedural");
+  osmium::io::Writer writer{osmium::io::File{filename, "pbf"}, header,
+                            osmium::io::overwrite::allow, osmium::io::fsync::no};
+  osmium::memory::Buffer buffer{kBufferSize, osmium::memory::Buffer::auto_grow::yes};
+  const auto flush = [&]() {
+    if (buffer.committed() > kBufferSize / 2) {
+      writer(std::move(buffer));
+      buffer = osmium::memory::Buffer{kBufferSize, osmium::memory::Buffer::auto_grow::yes};
+    }
+  };
+
+  for (uint64_t id = 1; id <= network.node_count(); ++id) {
+    const auto ll = network.position(id);
+    osmium::builder::add_node(buffer, attr::_id(id), attr::_version(1),
+                              attr::_timestamp(kTimestamp),
+                              attr::_location(osmium::Location{ll.lng(), ll.lat()}));
+    flush();
+  }
+
+  uint64_t way_id = 1;
+  network.ways([&](const std::vector<uint64_t>& nodes, const char* highway,
+                   const std::string& name) {
+    std::vector<std::pair<std::string, std::string>> tags{{"highway", highway}, {"name", name}};
+    // motorways would be oneway by default
+    if (std::string(highway) == "motorway") {
+      tags.emplace_back("oneway", "no");
+    } else if (std::string(highway) == "residential" &&
+               unit(params.seed, ~way_id) < params.oneway_share) {
+      tags.emplace_back("oneway", "yes");
+    }
+    const std::vector<osmium::object_id_type> refs(nodes.begin(), nodes.end());
+    osmium::builder::add_way(buffer, attr::_id(way_id++), attr::_version(1), attr::_cid(1001),
+                             attr::_timestamp(kTimestamp), attr::_nodes(refs), attr::_tags(tags));
+    flush();
+  });
+
+  writer(std::move(buffer));
+  writer.close();
+}
+
+} // namespace
+
+namespace valhalla {
+namespace gurka {
+namespace procedural {
+
+std::string Params::name() const {
+  std::stringstream name;
+  name << (layout == Layout::kGrid ? "grid" : "radial") << "-v" << kVersion << "-n" << size << "-d"
+       << spacing;
+  if (layout == Layout::kRadial) {
+    name << "-s" << spokes;
+  }
+  name << "-h" << highway_every << "-a" << arterial_every << "-o" << oneway_share << "-j" << jitter
+       << "-r" << seed << "-" << origin.lng() << "_" << origin.lat();
+  return name.str();
+}
+
+map build(const Params& params,
+          const std::string& cache_dir,
+          const std::unordered_map<std::string, std::string>& config_options) {
+  const Network network(params);
+  const auto tile_dir = cache_dir + "/" + params.name();
+  map result{test::make_config(tile_dir, config_options), {}};
+  if (params.layout == Layout::kGrid) {
+    const auto last = params.size - 1;
+    result.nodes = {{"nw", network.position(network.grid_node(0, 0))},
+                    {"ne", network.position(network.grid_node(0, last))},
+                    {"sw", network.position(network.grid_node(last, 0))},
+                    {"se", network.position(network.grid_node(last, last))},
+                    {"c", network.position(network.grid_node(last / 2, last / 2))}};
+  } else {
+    result.nodes = {{"c", network.position(network.radial_node(0, 0))},
+                    {"o", network.position(network.radial_node(params.size, 0))}};
+  }
+
+  // the marker is only written once the tiles are complete
+  const auto complete = tile_dir + "/complete";
+  if (filesystem::exists(complete)) {
+    return result;
+  }
+  if (filesystem::exists(tile_dir)) {
+    filesystem::remove_all(tile_dir);
+  }
+  filesystem::create_directories(tile_dir);
+
+  const auto pbf_filename = tile_dir + "/map.pbf";
+  std::cerr << "[          ] generating " << network.node_count() << " nodes of " << params.name()
+            << std::endl;
+  write_pbf(params, pbf_filename);
+  std::cerr << "[          ] building tiles in " << tile_dir << std::endl;
+  midgard::logging::Configure({{"type", ""}});
+  mjolnir::build_tile_set(result.config, {pbf_filename}, mjolnir::BuildStage::kInitialize,
+                          mjolnir::BuildStage::kValidate, false);
+
+  // the tiles are all that is needed from now on
+  filesystem::remove(pbf_filename);
+  std::ofstream(complete) << params.name() << std::endl;
+  return result;
+}
+
+std::vector<midgard::PointLL> locations(const Params& params, size_t count, uint32_t seed) {
+  const Network network(params);
+  std::vector<midgard::PointLL> points;
+  points.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    points.push_back(network.position(1 + mix(mix(seed) ^ i) % network.node_count()));
+  }
+  return points;
+}
+
+std::vector<midgard::PointLL> trace(const Params& params, size_t count, uint32_t seed) {
+  const Network network(params);
+  std::vector<midgard::PointLL> points;
+  if (params.layout == Layout::kGrid) {
+    count = std::min<size_t>(count, params.size);
+    const uint32_t row = mix(seed) % params.size;
+    const uint32_t column = mix(mix(seed)) % (params.size - count + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+      points.push_back(network.position(network.grid_node(row, column + i)));
+    }
+  } else {
+    count = std::min<size_t>(count, params.spokes + 1);
+    const uint32_t ring = 1 + mix(seed) % params.size;
+    const uint32_t spoke = mix(mix(seed)) % params.spokes;
+    for (uint32_t i = 0; i < count; ++i) {
+      points.push_back(network.position(network.radial_node(ring, (spoke + i) % params.spokes)));
+    }
+  }
+  return points;
+}
+
+} // namespace procedural
+} // namespace gurka
+} // namespace valhalla
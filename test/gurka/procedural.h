@@ -0,0 +1,97 @@
+#pragma once
+/******************************************************************************
+ * Procedural maps
+ *
+ * Large synthetic road networks, from a few thousand up to millions of edges, for benchmarking
+ * thor, loki and meili at scale without real data. The networks are a pure function of their
+ * parameters, so the same parameters always build the same tiles, and the tiles are kept on disk
+ * between runs.
+ ******************************************************************************/
+#include "gurka.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace valhalla {
+namespace gurka {
+namespace procedural {
+
+enum class Layout {
+  // size x size nodes in rows and columns
+  kGrid,
+  // a center with size rings around it crossed by spokes
+  kRadial,
+};
+
+struct Params {
+  Layout layout = Layout::kGrid;
+  // nodes per side of a grid or rings of a radial city
+  uint32_t size = 100;
+  // meters between the nodes of a grid or between the rings of a radial city
+  double spacing = 100;
+  // spokes of a radial city
+  uint32_t spokes = 32;
+  // every nth row and column of a grid, and every nth ring, is a motorway, 0 for none
+  uint32_t highway_every = 0;
+  // every nth row and column of a grid, and every nth ring, is a primary road, 0 for none
+  uint32_t arterial_every = 10;
+  // share of the residential ways that are oneway
+  double oneway_share = 0;
+  // at most how far in meters nodes are moved off the layout, so not all edges are straight
+  double jitter = 0;
+  // drives the jitter and the oneways
+  uint32_t seed = 1;
+  // longitude and latitude of the top left corner of a grid or the center of a radial city
+  midgard::PointLL origin{5.1, 52.1};
+
+  /**
+   * A name that is different for every map, the cache directory of the tiles
+   * @return the name
+   */
+  std::string name() const;
+};
+
+/**
+ * Builds the tiles of a map, unless a previous run already left them in the cache. The pbf of the
+ * map is written straight from the layout, so memory stays small even for millions of edges.
+ *
+ * @param params          the map to build
+ * @param cache_dir       where the tiles of each map are kept, in a directory named after it
+ * @param config_options  config overrides like those of gurka::buildtiles, they don't take part
+ *                        in the name of the cached map
+ * @return the config of the map and the names of a few of its nodes: the corners (nw, ne, sw, se)
+ *         and the center (c) of a grid, the center (c) and where the first spoke meets the outer
+ *         ring (o) of a radial city
+ */
+map build(const Params& params,
+          const std::string& cache_dir = "test/data/procedural",
+          const std::unordered_map<std::string, std::string>& config_options = {
+              {"mjolnir.concurrency", "1"}});
+
+/**
+ * The same locations for the same seed, all of them nodes of the map. Benchmarks use these as the
+ * origins, destinations or trace points of their requests.
+ *
+ * @param params  the map
+ * @param count   how many locations
+ * @param seed    which locations
+ * @return the locations
+ */
+std::vector<midgard::PointLL> locations(const Params& params, size_t count, uint32_t seed = 1);
+
+/**
+ * A route along the map as a trace of its nodes, starting at a node picked by the seed and going
+ * count nodes along a row of a grid or a ring of a radial city, for map matching benchmarks.
+ *
+ * @param params  the map
+ * @param count   how many points
+ * @param seed    where the trace starts
+ * @return the points of the trace
+ */
+std::vector<midgard::PointLL> trace(const Params& params, size_t count, uint32_t seed = 1);
+
+} // namespace procedural
+} // namespace gurka
+} // namespace valhalla
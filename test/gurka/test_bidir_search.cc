@@ -129,3 +129,46 @@ TEST(StandAlone, failed_search) {
 
   auto result = gurka::do_action(valhalla::Options::route, map, {"A", "F"}, "auto", {});
 }
+
+TEST(StandAlone, time_dependent) {
+  const std::string ascii_map = R"(
+  A--------------------B---C-X
+                       |   |
+                       D---E
+  )";
+
+  // Half an hour to B, by then BC is closed
+  const gurka::ways ways = {{"AB", {{"highway", "primary"}, {"maxspeed", "40"}}},
+                            {"BC",
+                             {{"highway", "primary"},
+                              {"motorcar:conditional", "no @ (Mo-Su 08:35-18:00)"}}},
+                            {"CX", {{"highway", "primary"}}},
+                            {"BD", {{"highway", "residential"}}},
+                            {"DE", {{"highway", "residential"}}},
+                            {"EC", {{"highway", "residential"}}}};
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 1000);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/bidir_search_time_dependent",
+                               {{"mjolnir.timezone", VALHALLA_BUILD_DIR "test/data/tz.sqlite"}});
+
+  for (const auto& date_time : std::vector<std::pair<std::string, std::string>>{
+           {"1", "2021-04-02T08:30"},
+           {"2", "2021-04-02T09:30"},
+       }) {
+    const std::unordered_map<std::string, std::string> options = {
+        {"/date_time/type", date_time.first}, {"/date_time/value", date_time.second}};
+
+    // the time dependent A* of the short route
+    map.config.put("thor.bidirectional_time_dependent", false);
+    auto expected = gurka::do_action(valhalla::Options::route, map, {"A", "X"}, "auto", options);
+    ASSERT_NE(expected.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+    gurka::assert::raw::expect_path(expected, {"AB", "BD", "DE", "EC", "CX"});
+
+    // the reverse search knows BC is closed by the time the route gets there
+    map.config.put("thor.bidirectional_time_dependent", true);
+    auto result = gurka::do_action(valhalla::Options::route, map, {"A", "X"}, "auto", options);
+    ASSERT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+    gurka::assert::raw::expect_path(result, {"AB", "BD", "DE", "EC", "CX"});
+    EXPECT_NEAR(result.directions().routes(0).legs(0).summary().time(),
+                expected.directions().routes(0).legs(0).summary().time(), 1.0);
+  }
+}
@@ -23,3 +23,39 @@ TEST(centroid, minimal) {
   ASSERT_NEAR(map.nodes["1"].lat(), api.trip().routes(0).legs(0).location(1).ll().lat(), 0.0000001);
   ASSERT_NEAR(map.nodes["1"].lng(), api.trip().routes(0).legs(0).location(1).ll().lng(), 0.0000001);
 }
+
+TEST(centroid, parallel) {
+  const std::string ascii_map = R"(
+    A-----B-----C-----D
+    |     |     |     |
+    E-----F--1--G-----H
+    |     |     |     |
+    I-----J-----K-----L
+  )";
+  const gurka::ways ways = {
+      {"ABCD", {{"highway", "residential"}}}, {"EFGH", {{"highway", "residential"}}},
+      {"IJKL", {{"highway", "residential"}}}, {"AEI", {{"highway", "residential"}}},
+      {"BFJ", {{"highway", "residential"}}},  {"CGK", {{"highway", "residential"}}},
+      {"DHL", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 50);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_centroid_parallel");
+
+  // a search per location on a pool of threads must find the same centroid as the serial one
+  map.config.put("thor.centroid_threads", 1);
+  auto serial = gurka::do_action(Options::centroid, map, {"A", "D", "I", "L"}, "pedestrian");
+  map.config.put("thor.centroid_threads", 3);
+  auto parallel = gurka::do_action(Options::centroid, map, {"A", "D", "I", "L"}, "pedestrian");
+
+  ASSERT_EQ(serial.trip().routes_size(), 4);
+  ASSERT_EQ(parallel.trip().routes_size(), 4);
+  for (int i = 0; i < 4; ++i) {
+    const auto& a = serial.trip().routes(i).legs(0);
+    const auto& b = parallel.trip().routes(i).legs(0);
+    EXPECT_EQ(a.location(1).ll().lat(), b.location(1).ll().lat());
+    EXPECT_EQ(a.location(1).ll().lng(), b.location(1).ll().lng());
+    EXPECT_EQ(a.node_size(), b.node_size());
+    EXPECT_NEAR(a.node().rbegin()->cost().elapsed_cost().cost(),
+                b.node().rbegin()->cost().elapsed_cost().cost(), 0.01);
+  }
+}
@@ -1,4 +1,5 @@
 #include "gurka.h"
+#include "sif/dynamiccost.h"
 #include <gtest/gtest.h>
 
 #if !defined(VALHALLA_SOURCE_DIR)
@@ -267,3 +268,33 @@ TEST_F(ConditionalRestrictions, DestinationRestrictionOnMidEdgeIsNotValid_ManyAl
     }
   }
 }
+
+TEST(ConditionalRestrictions, RememberedAnswers) {
+  // Mo-Fr 07:00-09:00 and 19:00-06:00
+  baldr::TimeDomain weekdays;
+  weekdays.set_dow(baldr::kMonday | baldr::kTuesday | baldr::kWednesday | baldr::kThursday |
+                   baldr::kFriday);
+  weekdays.set_begin_hrs(7);
+  weekdays.set_end_hrs(9);
+  baldr::TimeDomain nights;
+  nights.set_begin_hrs(19);
+  nights.set_end_hrs(6);
+
+  const auto& tzdb = baldr::DateTime::get_tz_db();
+  const uint32_t zones[] = {static_cast<uint32_t>(tzdb.to_index("Europe/Berlin")),
+                            static_cast<uint32_t>(tzdb.to_index("America/New_York"))};
+
+  // the answers are asked for twice in every minute of a week, the second time from the table
+  for (uint64_t t = 1683504000; t < 1683504000 + midgard::kSecondsPerWeek; t += 30) {
+    for (const auto& td : {weekdays, nights}) {
+      for (const auto tz_index : zones) {
+        const bool active = baldr::DateTime::is_conditional_active(
+            td.type(), td.begin_hrs(), td.begin_mins(), td.end_hrs(), td.end_mins(), td.dow(),
+            td.begin_week(), td.begin_month(), td.begin_day_dow(), td.end_week(), td.end_month(),
+            td.end_day_dow(), t, tzdb.from_index(tz_index));
+        ASSERT_EQ(sif::DynamicCost::IsConditionalActive(td.td_value(), t, tz_index), active)
+            << t << " " << tz_index;
+      }
+    }
+  }
+}
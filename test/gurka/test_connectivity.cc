@@ -0,0 +1,163 @@
+#include "gurka.h"
+#include "baldr/connectivity_map.h"
+#include "mjolnir/connectivitybuilder.h"
+#include "mjolnir/tileextract.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// two road networks in the same tile that no edge connects
+const std::string ascii_map = R"(
+    A----B----C
+
+    D----E
+
+    F----G----H
+  )";
+
+const gurka::ways ways = {
+    {"ABC", {{"highway", "primary"}}},
+    {"BE", {{"highway", "residential"}}},
+    {"DE", {{"highway", "residential"}}},
+    {"FGH", {{"highway", "primary"}}},
+};
+
+uint32_t component(const connectivity_map_t& connectivity,
+                   GraphReader& reader,
+                   const gurka::map& map,
+                   const std::string& from,
+                   const std::string& to) {
+  auto edge = gurka::findEdgeByNodes(reader, map.nodes, from, to);
+  return connectivity.get_component(std::get<1>(edge)->endnode());
+}
+
+int route_error(const gurka::map& map,
+                const std::string& from,
+                const std::string& to,
+                const std::string& costing = "auto") {
+  try {
+    gurka::do_action(valhalla::Options::route, map, {from, to}, costing);
+  } catch (const valhalla_exception_t& e) { return e.code; }
+  return 0;
+}
+
+} // namespace
+
+TEST(Connectivity, Components) {
+  auto map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                               "test/data/connectivity_components");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+
+  // without connectivity.bin the tiles are colored and it takes a search to find there is no route
+  {
+    connectivity_map_t connectivity(map.config.get_child("mjolnir"));
+    EXPECT_FALSE(connectivity.has_components());
+    EXPECT_TRUE(connectivity.has_data(2));
+    EXPECT_EQ(route_error(map, "A", "H"), 442);
+  }
+
+  auto stats = mjolnir::ConnectivityBuilder::Build(map.config.get_child("mjolnir"),
+                                                   tile_dir + "/" + kConnectivityFile);
+  EXPECT_GT(stats.tiles, 0);
+  EXPECT_GT(stats.nodes, 0);
+  EXPECT_GE(stats.components, 2);
+
+  // with it the nodes know their components and loki rejects the route right away
+  connectivity_map_t connectivity(map.config.get_child("mjolnir"));
+  ASSERT_TRUE(connectivity.has_components());
+  EXPECT_TRUE(connectivity.has_data(2));
+  GraphReader reader(map.config.get_child("mjolnir"));
+  const auto abc = component(connectivity, reader, map, "A", "B");
+  EXPECT_NE(abc, kNoComponent);
+  EXPECT_EQ(component(connectivity, reader, map, "E", "D"), abc);
+  EXPECT_EQ(component(connectivity, reader, map, "B", "C"), abc);
+  EXPECT_NE(component(connectivity, reader, map, "F", "G"), abc);
+  EXPECT_EQ(component(connectivity, reader, map, "G", "H"),
+            component(connectivity, reader, map, "F", "G"));
+
+  EXPECT_EQ(route_error(map, "A", "H"), 170);
+  EXPECT_EQ(route_error(map, "A", "D"), 0);
+}
+
+TEST(Connectivity, InTheExtract) {
+  auto map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                               "test/data/connectivity_extract");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+  mjolnir::ConnectivityBuilder::Build(map.config.get_child("mjolnir"),
+                                      tile_dir + "/" + kConnectivityFile);
+
+  // the extract carries it after the tiles and the reader finds it through the index
+  const auto extract = tile_dir + "/tiles.tar";
+  mjolnir::TileExtract::Build(tile_dir, extract, 2);
+  auto config = map.config;
+  config.put("mjolnir.tile_extract", extract);
+  auto reader = std::make_shared<GraphReader>(config.get_child("mjolnir"));
+  ASSERT_NE(reader->GetConnectivity().first, nullptr);
+  EXPECT_EQ(reader->GetTileSet().size(), mjolnir::TileExtract::Layout(tile_dir).size());
+
+  connectivity_map_t connectivity(config.get_child("mjolnir"), reader);
+  ASSERT_TRUE(connectivity.has_components());
+  const auto abc = component(connectivity, *reader, map, "A", "B");
+  EXPECT_NE(abc, kNoComponent);
+  EXPECT_NE(component(connectivity, *reader, map, "F", "G"), abc);
+
+  map.config = config;
+  EXPECT_EQ(route_error(map, "A", "H"), 170);
+  EXPECT_EQ(route_error(map, "A", "C"), 0);
+}
+
+TEST(Connectivity, StrongComponents) {
+  // a one way loop that cars can only leave
+  const std::string ascii_map = R"(
+    A-----B-----C
+                |
+          D-----E
+          |     |
+          F-----G
+  )";
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "primary"}}},
+      {"EC", {{"highway", "residential"}, {"oneway", "yes"}}},
+      {"DE", {{"highway", "residential"}, {"oneway", "yes"}}},
+      {"EG", {{"highway", "residential"}, {"oneway", "yes"}}},
+      {"GF", {{"highway", "residential"}, {"oneway", "yes"}}},
+      {"FD", {{"highway", "residential"}, {"oneway", "yes"}}},
+  };
+  auto map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                               "test/data/connectivity_strong");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+  auto stats = mjolnir::ConnectivityBuilder::Build(map.config.get_child("mjolnir"),
+                                                   tile_dir + "/" + kConnectivityFile);
+  EXPECT_EQ(stats.components, 1);
+  EXPECT_GT(stats.strong_components, 0);
+
+  auto reader = std::make_shared<GraphReader>(map.config.get_child("mjolnir"));
+  auto connectivity = connectivity_map_t::load(reader);
+  ASSERT_NE(connectivity, nullptr);
+  auto node = [&](const std::string& name) { return gurka::findNode(*reader, map.nodes, name); };
+
+  // cars can leave the loop but never get into it, people walk both ways
+  EXPECT_EQ(connectivity->get_component(node("D"), ComponentSet::kAuto),
+            connectivity->get_component(node("G"), ComponentSet::kAuto));
+  EXPECT_NE(connectivity->get_component(node("A"), ComponentSet::kAuto),
+            connectivity->get_component(node("G"), ComponentSet::kAuto));
+  EXPECT_TRUE(connectivity->unreachable(node("A"), node("F"), ComponentSet::kAuto));
+  EXPECT_FALSE(connectivity->unreachable(node("F"), node("A"), ComponentSet::kAuto));
+  EXPECT_FALSE(connectivity->unreachable(node("A"), node("F"), ComponentSet::kPedestrian));
+  EXPECT_FALSE(connectivity->unreachable(node("A"), node("F"), ComponentSet::kWeak));
+
+  ComponentSet set;
+  ASSERT_TRUE(connectivity_map_t::strong_components(kAutoAccess | kHOVAccess, set));
+  EXPECT_EQ(set, ComponentSet::kAuto);
+  ASSERT_TRUE(connectivity_map_t::strong_components(kWheelchairAccess, set));
+  EXPECT_EQ(set, ComponentSet::kPedestrian);
+  EXPECT_FALSE(connectivity_map_t::strong_components(kBusAccess, set));
+
+  // thor gives up without a search, loki lets it through as it is all one weak component
+  EXPECT_EQ(route_error(map, "A", "F"), 442);
+  EXPECT_EQ(route_error(map, "F", "A"), 0);
+  EXPECT_EQ(route_error(map, "A", "F", "pedestrian"), 0);
+}
@@ -0,0 +1,135 @@
+#include "gurka.h"
+#include "mjolnir/regioncut.h"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string ascii_map = R"(
+    A----B----C----D
+    |    |    |    |
+    E----F----G----H
+  )";
+
+const gurka::ways ways = {
+    {"ABCD", {{"highway", "primary"}}}, {"EFGH", {{"highway", "residential"}}},
+    {"AE", {{"highway", "residential"}}}, {"BF", {{"highway", "residential"}}},
+    {"CG", {{"highway", "residential"}}}, {"DH", {{"highway", "residential"}}},
+};
+
+// a box around the nodes that reaches a bit past them
+mjolnir::multi_polygon_type box(const gurka::map& map, const std::vector<std::string>& nodes) {
+  mjolnir::box_type box;
+  boost::geometry::assign_inverse(box);
+  for (const auto& node : nodes) {
+    const auto& ll = map.nodes.at(node);
+    boost::geometry::expand(box, mjolnir::point_type(ll.lng(), ll.lat()));
+  }
+  boost::geometry::buffer(box, box, 0.0001);
+  mjolnir::multi_polygon_type region(1);
+  boost::geometry::convert(box, region.front());
+  return region;
+}
+
+gurka::map cut(const gurka::map& map,
+               const mjolnir::multi_polygon_type& region,
+               const std::string& out_dir,
+               mjolnir::RegionCut::Stats& stats) {
+  filesystem::remove_all(out_dir);
+  stats = mjolnir::RegionCut::Cut(map.config.get_child("mjolnir"), region, out_dir, 2);
+  gurka::map cut_map = map;
+  cut_map.config.put("mjolnir.tile_dir", out_dir);
+  return cut_map;
+}
+
+// every edge of the tiles has an opposing edge that leads back and every transition a node
+void expect_connected(const gurka::map& map) {
+  GraphReader reader(map.config.get_child("mjolnir"));
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    GraphId node_id = tile_id;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i, ++node_id) {
+      const auto* node = tile->node(i);
+      GraphId edge_id(tile_id.tileid(), tile_id.level(), node->edge_index());
+      for (uint32_t j = 0; j < node->edge_count(); ++j, ++edge_id) {
+        const auto opp_id = reader.GetOpposingEdgeId(edge_id);
+        ASSERT_TRUE(opp_id.Is_Valid()) << edge_id;
+        EXPECT_EQ(reader.directededge(opp_id)->endnode(), node_id) << edge_id;
+      }
+      for (uint32_t t = 0; t < node->transition_count(); ++t) {
+        const auto endnode = tile->transition(node->transition_index() + t)->endnode();
+        ASSERT_NE(reader.nodeinfo(endnode), nullptr) << endnode;
+        const auto base_ll = reader.GetGraphTile(endnode)->header()->base_ll();
+        EXPECT_EQ(reader.nodeinfo(endnode)->latlng(base_ll),
+                  node->latlng(tile->header()->base_ll()));
+      }
+    }
+  }
+}
+
+std::string contents(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+} // namespace
+
+TEST(CutRegion, border_tiles) {
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/cut_region");
+
+  mjolnir::RegionCut::Stats stats;
+  auto cut_map = cut(map, box(map, {"A", "B", "E", "F"}), "test/data/cut_region_west", stats);
+  EXPECT_EQ(stats.copied_tiles, 0);
+  EXPECT_GT(stats.rebuilt_tiles, 0);
+  EXPECT_GT(stats.cut_nodes, 0);
+  EXPECT_GT(stats.cut_edges, 0);
+  expect_connected(cut_map);
+
+  // routes in the region are the same, the rest of the map is gone
+  auto result = gurka::do_action(valhalla::Options::route, cut_map, {"A", "F"}, "auto");
+  gurka::assert::raw::expect_path(result, {"ABCD", "BF"});
+  GraphReader reader(cut_map.config.get_child("mjolnir"));
+  EXPECT_THROW(gurka::findEdgeByNodes(reader, layout, "C", "G"), std::exception);
+}
+
+TEST(CutRegion, covered_tiles) {
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/cut_region");
+
+  // a region around the whole map copies its tiles as they are
+  mjolnir::box_type world(mjolnir::point_type(-180, -90), mjolnir::point_type(180, 90));
+  mjolnir::multi_polygon_type region(1);
+  boost::geometry::convert(world, region.front());
+  mjolnir::RegionCut::Stats stats;
+  auto cut_map = cut(map, region, "test/data/cut_region_all", stats);
+  EXPECT_GT(stats.copied_tiles, 0);
+  EXPECT_EQ(stats.rebuilt_tiles, 0);
+  EXPECT_EQ(stats.cut_nodes, 0);
+  EXPECT_EQ(stats.cut_edges, 0);
+
+  GraphReader reader(map.config.get_child("mjolnir"));
+  for (const auto& tile_id : reader.GetTileSet()) {
+    const auto suffix = GraphTile::FileSuffix(tile_id);
+    EXPECT_EQ(contents("test/data/cut_region_all/" + suffix),
+              contents(map.config.get<std::string>("mjolnir.tile_dir") + "/" + suffix))
+        << suffix;
+  }
+  auto result = gurka::do_action(valhalla::Options::route, cut_map, {"A", "H"}, "auto");
+  gurka::assert::raw::expect_path(result, {"ABCD", "DH"});
+}
+
+TEST(CutRegion, not_into_the_tile_dir) {
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/cut_region");
+  EXPECT_THROW(mjolnir::RegionCut::Cut(map.config.get_child("mjolnir"), box(map, {"A", "F"}),
+                                       map.config.get<std::string>("mjolnir.tile_dir"), 1),
+               std::runtime_error);
+}
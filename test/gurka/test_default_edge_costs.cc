@@ -0,0 +1,88 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+size_t default_edge_costs_size(GraphReader& reader) {
+  size_t size = 0;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (tile && tile->GetDefaultEdgeCosts()) {
+      size += tile->GetDefaultEdgeCosts()->memory_usage();
+    }
+  }
+  return size;
+}
+
+} // namespace
+
+TEST(DefaultEdgeCosts, same_routes_as_costing_every_edge) {
+  const std::string ascii_map = R"(
+      A----B----C----D
+      |    |    |    |
+      E----F----G----H
+      |    |    |    |
+      I----J----K----L
+    )";
+
+  const gurka::ways ways = {
+      {"ABCD", {{"highway", "motorway"}, {"toll", "yes"}}},
+      {"EFGH", {{"highway", "primary"}, {"surface", "gravel"}}},
+      {"IJKL", {{"highway", "residential"}}},
+      {"AEI", {{"highway", "service"}}},
+      {"BFJ", {{"highway", "track"}}},
+      {"CGK", {{"highway", "tertiary"}, {"maxspeed", "30"}}},
+      {"DHL", {{"highway", "living_street"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 200);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/default_edge_costs");
+
+  const std::vector<std::vector<std::string>> routes = {{"A", "L"}, {"I", "D"}, {"E", "K"}};
+  const std::vector<std::string> costings = {"auto", "truck"};
+
+  // the routes with every edge costed on its own, before tiles keep any costs
+  std::vector<valhalla::Api> expected;
+  for (const auto& costing : costings) {
+    for (const auto& route : routes) {
+      expected.push_back(gurka::do_action(Options::route, map, route, costing));
+    }
+  }
+
+  auto config = map.config.get_child("mjolnir");
+  config.put("default_edge_costs", true);
+  auto reader = std::make_shared<GraphReader>(config);
+  EXPECT_EQ(default_edge_costs_size(*reader), 0);
+
+  // options that are not the defaults and requests with a time cost their edges as before
+  auto slow = gurka::do_action(Options::route, map, {"A", "L"}, "auto",
+                               {{"/costing_options/auto/use_highways", "0.1"}}, reader);
+  auto timed =
+      gurka::do_action(Options::route, map, {"A", "L"}, "auto",
+                       {{"/date_time/type", "1"}, {"/date_time/value", "2023-05-01T08:00"}}, reader);
+  EXPECT_EQ(slow.directions().routes_size(), 1);
+  EXPECT_EQ(timed.directions().routes_size(), 1);
+  EXPECT_EQ(default_edge_costs_size(*reader), 0);
+
+  size_t i = 0;
+  for (const auto& costing : costings) {
+    for (const auto& route : routes) {
+      auto result = gurka::do_action(Options::route, map, route, costing, {}, reader);
+      const auto& summary = result.directions().routes(0).legs(0).summary();
+      const auto& expected_summary = expected[i++].directions().routes(0).legs(0).summary();
+      EXPECT_EQ(summary.time(), expected_summary.time());
+      EXPECT_EQ(summary.length(), expected_summary.length());
+    }
+  }
+
+  // the costings filled the costs of all edges of the tiles they went through
+  EXPECT_GT(default_edge_costs_size(*reader), 0);
+  for (const auto& tile_id : reader->GetTileSet()) {
+    auto tile = reader->GetGraphTile(tile_id);
+    const auto edges_size = tile->header()->directededgecount() * sizeof(DefaultEdgeCosts::Entry);
+    EXPECT_EQ(tile->GetDefaultEdgeCosts()->memory_usage() % edges_size, 0);
+  }
+}
@@ -0,0 +1,91 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+const std::string ascii_map = R"(
+    A----B----C
+    |    |    |
+    D----E----F
+  )";
+
+const gurka::ways ways = {
+    {"ABC", {{"highway", "primary"}}},
+    {"DEF", {{"highway", "residential"}}},
+    {"AD", {{"highway", "residential"}}},
+    {"BE", {{"highway", "residential"}}},
+    {"CF", {{"highway", "primary"}}},
+};
+
+class DepartureProfile : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                            "test/data/departure_profile");
+  }
+
+  static float leg_seconds(const Api& result, int leg) {
+    return result.trip().routes(0).legs(leg).node().rbegin()->cost().elapsed_cost().seconds();
+  }
+};
+
+gurka::map DepartureProfile::map = {};
+
+} // namespace
+
+TEST_F(DepartureProfile, WithoutTrafficEveryDepartureTakesAsLong) {
+  auto result = gurka::do_action(Options::route, map, {"A", "F"}, "auto",
+                                 {{"/date_time/type", "1"},
+                                  {"/date_time/value", "2023-05-01T08:00"},
+                                  {"/profile_departures", "12"},
+                                  {"/profile_interval", "600"}});
+  const auto& profile = result.trip().routes(0).legs(0).departure_profile();
+  ASSERT_EQ(profile.size(), 12);
+  for (const auto seconds : profile) {
+    EXPECT_NEAR(seconds, leg_seconds(result, 0), 0.1);
+  }
+}
+
+TEST_F(DepartureProfile, EveryBreakLeg) {
+  auto result = gurka::do_action(Options::route, map, {"A", "F", "D"}, "auto",
+                                 {{"/date_time/type", "1"},
+                                  {"/date_time/value", "2023-05-01T08:00"},
+                                  {"/profile_departures", "3"}});
+  for (int leg = 0; leg < 2; ++leg) {
+    const auto& profile = result.trip().routes(0).legs(leg).departure_profile();
+    ASSERT_EQ(profile.size(), 3);
+    EXPECT_NEAR(profile.Get(0), leg_seconds(result, leg), 0.1);
+  }
+}
+
+TEST_F(DepartureProfile, OnlyTimeDependentLegs) {
+  // without a time or with one that doesn't change along the route there is nothing to profile
+  auto result =
+      gurka::do_action(Options::route, map, {"A", "F"}, "auto", {{"/profile_departures", "4"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).departure_profile_size(), 0);
+  result = gurka::do_action(Options::route, map, {"A", "F"}, "auto",
+                            {{"/date_time/type", "3"},
+                             {"/date_time/value", "2023-05-01T08:00"},
+                             {"/profile_departures", "4"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).departure_profile_size(), 0);
+
+  // legs with through points in between are left alone
+  result = gurka::do_action(Options::route, map, {"A", "E", "F"}, "auto",
+                            {{"/date_time/type", "1"},
+                             {"/date_time/value", "2023-05-01T08:00"},
+                             {"/profile_departures", "4"},
+                             {"/locations/1/type", "through"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).departure_profile_size(), 0);
+}
+
+TEST_F(DepartureProfile, Capped) {
+  auto result = gurka::do_action(Options::route, map, {"A", "F"}, "auto",
+                                 {{"/date_time/type", "1"},
+                                  {"/date_time/value", "2023-05-01T08:00"},
+                                  {"/profile_departures", "100000"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).departure_profile_size(), 672);
+}
@@ -0,0 +1,83 @@
+#include "gurka.h"
+#include "mjolnir/graphtilebuilder.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// gives the edge from A to C a rolling climb, it drops as much as it climbs
+void store_edge_elevation(const gurka::map& map) {
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+  GraphReader reader(map.config.get_child("mjolnir"));
+  const auto edge_id = std::get<0>(gurka::findEdgeByNodes(reader, map.nodes, "A", "C"));
+  for (auto tile_id : reader.GetTileSet()) {
+    mjolnir::GraphTileBuilder builder(tile_dir, tile_id, false);
+    std::vector<EdgeElevation> elevations(builder.header()->directededgecount(), {0, 0});
+    if (edge_id.Tile_Base() == tile_id) {
+      elevations[edge_id.id()].set_ascent(70.f);
+      elevations[edge_id.id()].set_descent(70.f);
+    }
+    builder.UpdateEdgeElevation(elevations);
+  }
+}
+
+} // namespace
+
+TEST(EdgeElevation, climbs_are_costed_and_reported) {
+  const std::string ascii_map = R"(
+      A----1----C
+      |         |
+      D---------E
+    )";
+
+  const gurka::ways ways = {
+      {"AC", {{"highway", "residential"}}},
+      {"AD", {{"highway", "residential"}}},
+      {"DE", {{"highway", "residential"}}},
+      {"EC", {{"highway", "residential"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/edge_elevation");
+
+  // without the section the edges look flat
+  auto result = gurka::do_action(valhalla::Options::route, map, {"A", "C"}, "bicycle",
+                                 {{"/costing_options/bicycle/use_hills", "0"}});
+  gurka::assert::raw::expect_path(result, {"AC"});
+
+  store_edge_elevation(map);
+  {
+    GraphReader reader(map.config.get_child("mjolnir"));
+    auto edge = gurka::findEdgeByNodes(reader, map.nodes, "A", "C");
+    auto tile = reader.GetGraphTile(std::get<0>(edge));
+    ASSERT_TRUE(tile->has_edge_elevation());
+    EXPECT_FLOAT_EQ(tile->edge_elevation(std::get<0>(edge).id()).ascent(), 70.f);
+    EXPECT_EQ(tile->edge_elevation(std::get<1>(edge))->descent_, 700);
+  }
+
+  // the weighted grade is still flat but avoiding hills now rides around the climbs
+  result = gurka::do_action(valhalla::Options::route, map, {"A", "C"}, "bicycle",
+                            {{"/costing_options/bicycle/use_hills", "0"}});
+  gurka::assert::raw::expect_path(result, {"AD", "DE", "EC"});
+  result = gurka::do_action(valhalla::Options::route, map, {"A", "C"}, "bicycle",
+                            {{"/costing_options/bicycle/use_hills", "1"}});
+  gurka::assert::raw::expect_path(result, {"AC"});
+
+  // and the trip legs report them in the direction of travel
+  std::string trace_json;
+  gurka::do_action(valhalla::Options::trace_attributes, map, {"A", "1", "C"}, "bicycle", {}, {},
+                   &trace_json, "via");
+  rapidjson::Document trace;
+  trace.Parse(trace_json.c_str());
+  auto edges = trace["edges"].GetArray();
+  ASSERT_EQ(edges.Size(), 1);
+  EXPECT_NEAR(edges[0]["ascent"].GetDouble(), 70.0, 0.01);
+  EXPECT_NEAR(edges[0]["descent"].GetDouble(), 70.0, 0.01);
+
+  gurka::do_action(valhalla::Options::trace_attributes, map, {"D", "E"}, "bicycle", {}, {},
+                   &trace_json, "via");
+  trace.Parse(trace_json.c_str());
+  EXPECT_NEAR(trace["edges"][0]["ascent"].GetDouble(), 0.0, 0.01);
+}
@@ -0,0 +1,63 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+const std::string ascii_map = R"(
+    A----B----C----D
+         |    |
+         E----F
+  )";
+
+const gurka::ways ways = {
+    {"AB", {{"highway", "primary"}, {"name", "AB"}}},
+    {"BC", {{"highway", "primary"}, {"name", "BC"}}},
+    {"CD", {{"highway", "primary"}, {"name", "CD"}}},
+    {"BE", {{"highway", "residential"}, {"name", "BE"}}},
+    {"EF", {{"highway", "residential"}, {"name", "EF"}}},
+    {"CF", {{"highway", "residential"}, {"name", "CF"}}},
+};
+
+class EdgeWalk : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                            "test/data/edge_walk");
+  }
+
+  // a request for the shape through the nodes, with a point halfway between each pair of them
+  std::string request(const std::vector<std::string>& nodes) {
+    std::string shape;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const auto& ll = map.nodes.at(nodes[i]);
+      if (i > 0) {
+        const auto mid = map.nodes.at(nodes[i - 1]).PointAlongSegment(ll);
+        shape += R"({"lat":)" + std::to_string(mid.lat()) + R"(,"lon":)" +
+                 std::to_string(mid.lng()) + "},";
+      }
+      shape += R"({"lat":)" + std::to_string(ll.lat()) + R"(,"lon":)" + std::to_string(ll.lng()) +
+               "}" + (i + 1 < nodes.size() ? "," : "");
+    }
+    return R"({"shape":[)" + shape + R"(],"costing":"auto","shape_match":"edge_walk"})";
+  }
+};
+
+gurka::map EdgeWalk::map = {};
+
+} // namespace
+
+TEST_F(EdgeWalk, FollowsShape) {
+  auto result = gurka::do_action(Options::trace_route, map, request({"A", "B", "C", "D"}));
+  gurka::assert::raw::expect_path(result, {"AB", "BC", "CD"});
+}
+
+TEST_F(EdgeWalk, ShapeRevisitingNodes) {
+  // B and C are passed twice, each edge has to end at the shape point that is next in order
+  auto result =
+      gurka::do_action(Options::trace_route, map, request({"A", "B", "C", "F", "E", "B", "C", "D"}));
+  gurka::assert::raw::expect_path(result, {"AB", "BC", "CF", "EF", "BE", "BC", "CD"});
+}
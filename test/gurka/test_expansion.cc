@@ -1,4 +1,5 @@
 #include "gurka.h"
+#include "midgard/encoded.h"
 #include <boost/algorithm/string/join.hpp>
 #include <boost/format.hpp>
 #include <gtest/gtest.h>
@@ -75,6 +76,52 @@ protected:
 
 gurka::map ExpansionTest::expansion_map = {};
 
+namespace {
+// one record of the binary expansion
+struct binary_record_t {
+  uint64_t edge_id;
+  uint64_t pred_edge_id;
+  uint8_t status;
+  float cost;
+  float duration;
+  uint32_t distance;
+  std::string shape;
+};
+
+template <typename T> T read_le(const std::string& bytes, size_t& pos) {
+  T value;
+  std::memcpy(&value, bytes.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return value;
+}
+
+std::vector<binary_record_t> parse_binary(const std::string& bytes, bool& shapes) {
+  EXPECT_GE(bytes.size(), 8u);
+  EXPECT_EQ(bytes.substr(0, 4), "VEXP");
+  EXPECT_EQ(static_cast<uint8_t>(bytes[4]), 1);
+  shapes = bytes[5] & 1;
+  std::vector<binary_record_t> records;
+  size_t pos = 8;
+  while (pos < bytes.size()) {
+    binary_record_t record;
+    record.edge_id = read_le<uint64_t>(bytes, pos);
+    record.pred_edge_id = read_le<uint64_t>(bytes, pos);
+    record.status = read_le<uint8_t>(bytes, pos);
+    record.cost = read_le<float>(bytes, pos);
+    record.duration = read_le<float>(bytes, pos);
+    record.distance = read_le<uint32_t>(bytes, pos);
+    if (shapes) {
+      auto size = read_le<uint32_t>(bytes, pos);
+      record.shape = bytes.substr(pos, size);
+      pos += size;
+    }
+    records.push_back(std::move(record));
+  }
+  EXPECT_EQ(pos, bytes.size());
+  return records;
+}
+} // namespace
+
 // TODO: tons of " C++ exception with description "IsObject()" thrown in the test body."
 
 TEST_P(ExpansionTest, Isochrone) {
@@ -135,9 +182,54 @@ TEST_F(ExpansionTest, NoAction) {
   };
 }
 
+TEST_F(ExpansionTest, Binary) {
+  std::string res;
+  gurka::do_action(Options::expansion, expansion_map, {"A"}, "auto",
+                   {{"/action", "isochrone"},
+                    {"/format", "binary"},
+                    {"/contours/0/time", "10"},
+                    {"/contours/1/time", "20"}},
+                   {}, &res);
+
+  bool shapes = true;
+  auto records = parse_binary(res, shapes);
+  EXPECT_FALSE(shapes);
+  // the same 11 edges as the geojson, all settled by the dijkstra
+  ASSERT_EQ(records.size(), 11);
+  std::unordered_set<uint64_t> settled;
+  for (const auto& record : records) {
+    EXPECT_EQ(record.status, 1);
+    // every edge is reached from one that was settled before it or from the location
+    if (record.pred_edge_id != baldr::kInvalidGraphId) {
+      EXPECT_TRUE(settled.count(record.pred_edge_id));
+    }
+    settled.insert(record.edge_id);
+  }
+}
+
+TEST_F(ExpansionTest, BinaryShapes) {
+  std::string res;
+  gurka::do_action(Options::expansion, expansion_map, {"E", "H"}, "auto",
+                   {{"/action", "route"},
+                    {"/format", "binary"},
+                    {"/skip_opposites", "1"},
+                    {"/expansion_shapes", "1"}},
+                   {}, &res);
+
+  bool shapes = false;
+  auto records = parse_binary(res, shapes);
+  EXPECT_TRUE(shapes);
+  ASSERT_EQ(records.size(), 16);
+  for (const auto& record : records) {
+    EXPECT_LE(record.status, 2);
+    EXPECT_GE(midgard::decode<std::vector<midgard::PointLL>>(record.shape).size(), 2);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(ExpandPropsTest,
                          ExpansionTest,
                          ::testing::Values(std::vector<std::string>{"statuses"},
                                            std::vector<std::string>{"distances", "durations"},
                                            std::vector<std::string>{"edge_ids", "costs"},
+                                           std::vector<std::string>{"pred_edge_ids"},
                                            std::vector<std::string>{}));
@@ -0,0 +1,96 @@
+#include "gurka.h"
+#include "mjolnir/graphvalidator.h"
+#include "mjolnir/util.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace valhalla;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// everything validating writes into the tiles
+struct snapshot_t {
+  std::vector<char> nodes;
+  std::vector<char> edges;
+  std::vector<std::vector<uint64_t>> bins;
+};
+
+std::map<baldr::GraphId, snapshot_t> snapshot(const boost::property_tree::ptree& config) {
+  std::map<baldr::GraphId, snapshot_t> tiles;
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto& snap = tiles[tile_id];
+    const auto nodes = tile->GetNodes();
+    const auto edges = tile->GetDirectedEdges();
+    snap.nodes.assign(reinterpret_cast<const char*>(nodes.begin()),
+                      reinterpret_cast<const char*>(nodes.end()));
+    snap.edges.assign(reinterpret_cast<const char*>(edges.begin()),
+                      reinterpret_cast<const char*>(edges.end()));
+    for (size_t i = 0; i < baldr::kBinCount; ++i) {
+      snap.bins.emplace_back();
+      for (const auto& edge_id : tile->GetBin(i)) {
+        snap.bins.back().push_back(edge_id.value);
+      }
+      std::sort(snap.bins.back().begin(), snap.bins.back().end());
+    }
+  }
+  return tiles;
+}
+
+void expect_same(const std::map<baldr::GraphId, snapshot_t>& expected,
+                 const std::map<baldr::GraphId, snapshot_t>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (const auto& tile : expected) {
+    const auto found = actual.find(tile.first);
+    ASSERT_NE(found, actual.end()) << tile.first;
+    EXPECT_EQ(tile.second.nodes, found->second.nodes) << tile.first;
+    EXPECT_EQ(tile.second.edges, found->second.edges) << tile.first;
+    EXPECT_EQ(tile.second.bins, found->second.bins) << tile.first;
+  }
+}
+
+} // namespace
+
+TEST(IncrementalValidate, ChangedTilesOnly) {
+  // 10km per character so the edges pass through tiles they dont start or end in
+  const std::string ascii_map = R"(
+    A------B------C-----------D
+                  |
+                  E-----------F
+  )";
+  const gurka::ways ways = {
+      {"AB", {{"highway", "motorway"}}},  {"BC", {{"highway", "primary"}}},
+      {"CD", {{"highway", "primary"}}},   {"CE", {{"highway", "residential"}}},
+      {"EF", {{"highway", "secondary"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10000, {4.0, 52.0});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_incremental_validate");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+
+  // validating the tiles cleared the changes
+  EXPECT_TRUE(TileChanges::Read(tile_dir).all);
+  EXPECT_FALSE(filesystem::exists(tile_dir + "/changed_tiles.txt"));
+  const auto built = snapshot(map.config);
+
+  // a tile with new speeds and the tiles around it are validated again, their bins replace the
+  // ones they had
+  const auto changed = baldr::TileHierarchy::GetGraphId(layout.at("C"), 2);
+  TileChanges::Record(tile_dir, {changed});
+  auto changes = TileChanges::Read(tile_dir);
+  EXPECT_FALSE(changes.all);
+  EXPECT_EQ(changes.tiles, std::unordered_set<baldr::GraphId>{changed});
+  GraphValidator::Validate(map.config);
+  EXPECT_TRUE(TileChanges::Read(tile_dir).all);
+  expect_same(built, snapshot(map.config));
+
+  // validating all of them again doesnt bin anything twice either
+  TileChanges::Record(tile_dir, {changed});
+  TileChanges::RecordAll(tile_dir);
+  EXPECT_TRUE(TileChanges::Read(tile_dir).all);
+  GraphValidator::Validate(map.config);
+  expect_same(built, snapshot(map.config));
+}
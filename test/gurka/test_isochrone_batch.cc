@@ -0,0 +1,150 @@
+#include "gurka.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace valhalla;
+
+namespace {
+
+std::vector<rapidjson::Document> parse_lines(const std::string& response) {
+  std::vector<rapidjson::Document> lines;
+  std::istringstream stream(response);
+  std::string line;
+  while (std::getline(stream, line)) {
+    lines.emplace_back();
+    lines.back().Parse(line.c_str());
+    EXPECT_FALSE(lines.back().HasParseError()) << line;
+  }
+  return lines;
+}
+
+} // namespace
+
+class IsochroneBatchTest : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map threaded_map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A----B----C----D
+      |    |    |    |
+      E----F----G----H
+      |    |    |    |
+      I----J----K----L     M----N
+    )";
+    const gurka::ways ways = {
+        {"AB", {{"highway", "primary"}}},     {"BC", {{"highway", "primary"}}},
+        {"CD", {{"highway", "primary"}}},     {"EF", {{"highway", "residential"}}},
+        {"FG", {{"highway", "residential"}}}, {"GH", {{"highway", "residential"}}},
+        {"IJ", {{"highway", "residential"}}}, {"JK", {{"highway", "residential"}}},
+        {"KL", {{"highway", "residential"}}}, {"AE", {{"highway", "residential"}}},
+        {"EI", {{"highway", "residential"}}}, {"BF", {{"highway", "residential"}}},
+        {"FJ", {{"highway", "residential"}}}, {"CG", {{"highway", "residential"}}},
+        {"GK", {{"highway", "residential"}}}, {"DH", {{"highway", "residential"}}},
+        {"HL", {{"highway", "residential"}}}, {"MN", {{"highway", "residential"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_isochrone_batch");
+    threaded_map = map;
+    threaded_map.config.put("thor.isochrone_batch_threads", 3);
+  }
+
+  // population cells at a few of the nodes with a count of 100 each
+  std::unordered_map<std::string, std::string>
+  population(const std::vector<std::string>& nodes,
+             std::unordered_map<std::string, std::string> options = {}) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const auto& ll = map.nodes.at(nodes[i]);
+      const auto cell = "/population/" + std::to_string(i);
+      options[cell + "/lat"] = std::to_string(ll.lat());
+      options[cell + "/lon"] = std::to_string(ll.lng());
+      options[cell + "/count"] = "100";
+    }
+    return options;
+  }
+};
+
+gurka::map IsochroneBatchTest::map = {};
+gurka::map IsochroneBatchTest::threaded_map = {};
+
+TEST_F(IsochroneBatchTest, OneLinePerLocation) {
+  const std::vector<std::string> locations = {"A", "F", "L"};
+  std::string response;
+  gurka::do_action(Options::isochrone_batch, map, locations, "auto",
+                   {{"/contours/0/time", "1"}, {"/contours/1/time", "2"}}, {}, &response);
+  auto lines = parse_lines(response);
+  ASSERT_EQ(lines.size(), locations.size());
+
+  for (size_t i = 0; i < locations.size(); ++i) {
+    EXPECT_EQ(lines[i]["index"].GetUint64(), i);
+    ASSERT_TRUE(lines[i]["contours"].IsArray()) << i;
+    ASSERT_EQ(lines[i]["contours"].Size(), 2) << i;
+    const auto& inner = lines[i]["contours"][0];
+    const auto& outer = lines[i]["contours"][1];
+    EXPECT_STREQ(inner["metric"].GetString(), "time");
+    EXPECT_GT(inner["area"].GetDouble(), 0.) << i;
+    EXPECT_GE(outer["area"].GetDouble(), inner["area"].GetDouble()) << i;
+    EXPECT_FALSE(inner.HasMember("population"));
+
+    // the isochrone is the same as the one of a request for the location alone
+    ASSERT_TRUE(lines[i].HasMember("isochrone")) << i;
+    std::string single;
+    gurka::do_action(Options::isochrone, map, {locations[i]}, "auto",
+                     {{"/contours/0/time", "1"}, {"/contours/1/time", "2"}}, {}, &single);
+    rapidjson::Document expected;
+    expected.Parse(single.c_str());
+    EXPECT_EQ(lines[i]["isochrone"]["features"], expected["features"]) << i;
+  }
+}
+
+TEST_F(IsochroneBatchTest, MetricsOnlyWithPopulation) {
+  std::string response;
+  gurka::do_action(Options::isochrone_batch, map, {"A", "M"}, "auto",
+                   population({"A", "B", "L"},
+                              {{"/contours/0/time", "1"}, {"/metrics_only", "1"}, {"/id", "x"}}),
+                   {}, &response);
+  auto lines = parse_lines(response);
+  ASSERT_EQ(lines.size(), 2);
+
+  // the cells next to A are reached from it, the one in the far corner isn't
+  EXPECT_STREQ(lines[0]["id"].GetString(), "x");
+  EXPECT_FALSE(lines[0].HasMember("isochrone"));
+  const auto& contour = lines[0]["contours"][0];
+  EXPECT_EQ(contour["population"].GetUint64(), 200);
+
+  // the cells are all out of reach of the island, if it gets an isochrone at all
+  EXPECT_FALSE(lines[1].HasMember("id"));
+  if (lines[1]["contours"].IsArray()) {
+    EXPECT_EQ(lines[1]["contours"][0]["population"].GetUint64(), 0);
+  }
+}
+
+TEST_F(IsochroneBatchTest, ThreadsGiveTheSameLines) {
+  const std::vector<std::string> locations = {"A", "B", "C", "D", "E", "F", "G", "H", "M"};
+  const std::unordered_map<std::string, std::string> options =
+      population({"A", "F", "K"}, {{"/contours/0/time", "1"}, {"/contours/1/distance", "0.5"}});
+  std::string expected, response;
+  gurka::do_action(Options::isochrone_batch, map, locations, "auto", options, {}, &expected);
+  gurka::do_action(Options::isochrone_batch, threaded_map, locations, "auto", options, {},
+                   &response);
+  auto expected_lines = parse_lines(expected);
+  auto lines = parse_lines(response);
+  ASSERT_EQ(lines.size(), expected_lines.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    EXPECT_EQ(lines[i], expected_lines[i]) << i;
+  }
+}
+
+TEST_F(IsochroneBatchTest, TooManyLocations) {
+  auto limited = map;
+  limited.config.put("service_limits.isochrone.max_batch_locations", 2);
+  try {
+    gurka::do_action(Options::isochrone_batch, limited, {"A", "B", "C"}, "auto",
+                     {{"/contours/0/time", "1"}});
+    FAIL() << "the batch has more locations than allowed";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 150); }
+}
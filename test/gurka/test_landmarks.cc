@@ -5,6 +5,7 @@
 
 #include "baldr/graphreader.h"
 #include "baldr/landmark.h"
+#include "baldr/landmarkstore.h"
 #include "gurka.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/landmarks.h"
@@ -410,6 +411,99 @@ TEST(LandmarkTest, TestAddLandmarksToTiles) {
   CheckLandmarksInTiles(gr, GraphId("2/517680/0"));
 }
 
+TEST(LandmarkTest, TestAddLandmarksFromStore) {
+  const std::string workdir_store = VALHALLA_BUILD_DIR "test/data/landmarks/landmarks_store";
+  const std::string store_path = workdir_store + "/landmarks.bin";
+  if (!filesystem::exists(workdir_store)) {
+    bool created = filesystem::create_directories(workdir_store);
+    EXPECT_TRUE(created);
+  }
+
+  // the same map as TestAddLandmarksToTiles, its landmarks end up on the same edges
+  BuildPBFAddLandmarksToTiles();
+  auto config =
+      test::make_config(workdir_store, {{"mjolnir.landmark_store", store_path}},
+                        {{"additional_data", "mjolnir.traffic_extract", "mjolnir.tile_extract"}});
+  mjolnir::build_tile_set(config, {pbf_filename_tile_test}, mjolnir::BuildStage::kInitialize,
+                          mjolnir::BuildStage::kValidate, false);
+
+  // the landmarks go to the store rather than to a database
+  EXPECT_TRUE(BuildLandmarkFromPBF(config.get_child("mjolnir"), {pbf_filename_tile_test}));
+  LandmarkStore store(store_path);
+  EXPECT_EQ(store.landmark_count(), 11);
+  const auto landmark = store.Get(0);
+  EXPECT_EQ(landmark.id, 0);
+  const midgard::PointLL ll(landmark.lng, landmark.lat);
+  const auto found = store.Find(midgard::ExpandMeters(ll, 1));
+  ASSERT_EQ(found.size(), 1);
+  EXPECT_EQ(found[0].name, landmark.name);
+  EXPECT_TRUE(store.Find({-10, -10, -9, -9}).empty());
+
+  AddLandmarks(config);
+
+  GraphReader gr(config.get_child("mjolnir"));
+  CheckLandmarksInTiles(gr, GraphId("0/002025/0"));
+  CheckLandmarksInTiles(gr, GraphId("1/032220/0"));
+  CheckLandmarksInTiles(gr, GraphId("2/517680/0"));
+}
+
+TEST(LandmarkTest, TestLandmarksFromStoreInRoute) {
+  const std::string ascii_map = R"(
+       A
+    a-----b-----c
+              B
+
+            D
+  )";
+
+  const gurka::nodes nodes = {
+      {"A", {{"name", "lv_mo_li"}, {"amenity", "bar"}}},
+      {"B", {{"name", "hai_di_lao"}, {"amenity", "restaurant"}}},
+      {"D", {{"name", "wan_da"}, {"amenity", "cinema"}}},
+  };
+  const gurka::ways ways = {
+      {"ab", {{"highway", "secondary"}, {"name", "S1"}}},
+      {"bc", {{"highway", "secondary"}, {"name", "S2"}}},
+  };
+
+  const std::string workdir = VALHALLA_BUILD_DIR "test/data/landmarks/store_route";
+  const std::string store_path = workdir + "/landmarks.bin";
+  const std::string pbf = workdir + "/map.pbf";
+  if (!filesystem::exists(workdir)) {
+    bool created = filesystem::create_directories(workdir);
+    EXPECT_TRUE(created);
+  }
+
+  valhalla::gurka::map map{};
+  map.nodes = gurka::detail::map_to_coordinates(ascii_map, 10, {0, 0});
+  detail::build_pbf(map.nodes, ways, nodes, {}, pbf, 0, false);
+  map.config =
+      test::make_config(workdir, {{"mjolnir.landmark_store", store_path}},
+                        {{"additional_data", "mjolnir.traffic_extract", "mjolnir.tile_extract"}});
+  mjolnir::build_tile_set(map.config, {pbf}, mjolnir::BuildStage::kInitialize,
+                          mjolnir::BuildStage::kValidate, false);
+
+  // the tiles are left as they are, the route finds the landmarks near its edges in the store
+  EXPECT_TRUE(BuildLandmarkFromPBF(map.config.get_child("mjolnir"), {pbf}));
+  auto result = gurka::do_action(valhalla::Options::route, map, {"a", "c"}, "auto");
+
+  std::map<std::string, std::vector<std::pair<std::string, bool>>> landmarks;
+  for (const auto& node : result.trip().routes(0).legs(0).node()) {
+    if (node.edge().name_size() == 0) {
+      continue;
+    }
+    auto& edge_landmarks = landmarks[node.edge().name(0).value()];
+    for (const auto& landmark : node.edge().landmarks()) {
+      edge_landmarks.emplace_back(landmark.name(), landmark.right());
+    }
+  }
+  const decltype(landmarks) expected = {
+      {"S1", {{"lv_mo_li", false}}},
+      {"S2", {{"hai_di_lao", true}}},
+  };
+  EXPECT_EQ(landmarks, expected);
+}
+
 // TODO: This is an example test to show the underlying bugs or problems in the current code.
 // Right now the problem is we cannot add landmarks to a graph tile twice.
 // The test will return "[ERROR] Failed to build GraphTile. Error: GraphId level exceeds tile
@@ -0,0 +1,90 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+const std::string ascii_map = R"(
+    A----B----C
+    |    |    |
+    D----E----F
+    |         |
+    G---------H
+  )";
+
+const gurka::ways ways = {
+    {"ABC", {{"highway", "primary"}, {"name", "North"}}},
+    {"DEF", {{"highway", "residential"}, {"name", "Middle"}}},
+    {"GH", {{"highway", "residential"}, {"name", "South"}}},
+    {"ADG", {{"highway", "residential"}, {"name", "West"}}},
+    {"BE", {{"highway", "residential"}, {"name", "Center"}}},
+    {"CFH", {{"highway", "primary"}, {"name", "East"}}},
+};
+
+class LegThreads : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map threaded_map;
+
+  static void SetUpTestSuite() {
+    map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                            "test/data/leg_threads");
+    threaded_map = map;
+    threaded_map.config.put("thor.leg_threads", 3);
+  }
+
+  // the legs come out the same whether they are searched one by one or all at once
+  void expect_same_legs(const std::vector<std::string>& waypoints,
+                        const std::unordered_map<std::string, std::string>& options = {}) {
+    auto expected = gurka::do_action(Options::route, map, waypoints, "auto", options);
+    auto result = gurka::do_action(Options::route, threaded_map, waypoints, "auto", options);
+    ASSERT_EQ(result.trip().routes_size(), 1);
+    ASSERT_EQ(result.trip().routes(0).legs_size(), expected.trip().routes(0).legs_size());
+    for (int i = 0; i < result.trip().routes(0).legs_size(); ++i) {
+      EXPECT_EQ(result.trip().routes(0).legs(i).shape(), expected.trip().routes(0).legs(i).shape())
+          << "leg " << i;
+      EXPECT_EQ(result.directions().routes(0).legs(i).summary().length(),
+                expected.directions().routes(0).legs(i).summary().length())
+          << "leg " << i;
+    }
+  }
+};
+
+gurka::map LegThreads::map = {};
+gurka::map LegThreads::threaded_map = {};
+
+} // namespace
+
+TEST_F(LegThreads, BreakLegs) {
+  expect_same_legs({"A", "H", "C", "G", "B", "F"});
+  auto result = gurka::do_action(Options::route, threaded_map, {"A", "H", "C", "G"}, "auto");
+  EXPECT_EQ(result.trip().routes(0).legs_size(), 3);
+}
+
+TEST_F(LegThreads, DependentLegs) {
+  // through points and times carried over from one leg to the next keep the legs one by one
+  expect_same_legs({"A", "E", "H", "B"}, {{"/locations/1/type", "through"}});
+  expect_same_legs({"A", "E", "H", "B"}, {{"/locations/2/type", "via"}});
+  expect_same_legs({"A", "E", "H", "B"},
+                   {{"/date_time/type", "1"}, {"/date_time/value", "2023-05-01T08:00"}});
+}
+
+TEST_F(LegThreads, NoRoute) {
+  const gurka::ways ways = {
+      {"AB", {{"highway", "primary"}}},
+      {"CD", {{"highway", "primary"}}},
+  };
+  const std::string ascii_map = R"(
+    A----B
+
+    C----D
+  )";
+  auto map = gurka::buildtiles(gurka::detail::map_to_coordinates(ascii_map, 100), ways, {}, {},
+                               "test/data/leg_threads_no_route",
+                               {{"mjolnir.concurrency", "1"}, {"thor.leg_threads", "2"}});
+  try {
+    gurka::do_action(Options::route, map, {"A", "B", "C", "D"}, "auto");
+    FAIL() << "the legs between the networks have no route";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 442); }
+}
@@ -130,3 +130,50 @@ TEST(locate, basic_properties) {
   ASSERT_EQ(result.options().locations(0).heading_tolerance(), 20);
   ASSERT_TRUE(result.options().locations(0).correlation().edges().empty());
 }
+
+TEST(locate, fields) {
+  const std::string ascii_map = R"(
+    A---1---B
+            2
+            C)";
+  const gurka::ways ways = {{"AB", {{"highway", "primary"}, {"osm_id", "101"}}},
+                            {"BC", {{"highway", "primary"}, {"osm_id", "102"}}}};
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_locate_fields");
+
+  // the edges of each location only have the fields that were asked for
+  const auto& one = layout.find("1")->second;
+  const auto& two = layout.find("2")->second;
+  const std::string request =
+      R"({"costing":"auto","locate_fields":["way_id","side_of_street","percent_along"],)"
+      R"("locations":[{"lon":)" +
+      std::to_string(one.lng()) + R"(,"lat":)" + std::to_string(one.lat()) +
+      R"(},{"lon":)" + std::to_string(two.lng()) + R"(,"lat":)" + std::to_string(two.lat()) +
+      R"(},{"lon":0,"lat":0}]})";
+  std::string json;
+  gurka::do_action(valhalla::Options::locate, map, request, {}, &json);
+  rapidjson::Document response;
+  response.Parse(json);
+  ASSERT_FALSE(response.HasParseError());
+  ASSERT_EQ(response.GetArray().Size(), 3);
+
+  for (size_t i = 0; i < 2; ++i) {
+    const auto& location = response[i];
+    EXPECT_TRUE(location.HasMember("input_lat"));
+    EXPECT_FALSE(location.HasMember("nodes"));
+    ASSERT_EQ(location["edges"].Size(), 2);
+    for (const auto& edge : location["edges"].GetArray()) {
+      EXPECT_EQ(edge.MemberCount(), 3);
+      EXPECT_EQ(edge["way_id"].GetUint64(), i == 0 ? 101 : 102);
+      EXPECT_STREQ(edge["side_of_street"].GetString(), "neither");
+      EXPECT_NEAR(edge["percent_along"].GetDouble(), .5, .01);
+    }
+  }
+  EXPECT_TRUE(response[2]["edges"].IsNull());
+
+  // fields that don't exist are an error
+  EXPECT_THROW(gurka::do_action(valhalla::Options::locate, map,
+                                R"({"costing":"auto","locate_fields":["names"],)"
+                                R"("locations":[{"lon":0,"lat":0}]})"),
+               valhalla_exception_t);
+}
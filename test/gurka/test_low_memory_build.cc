@@ -0,0 +1,61 @@
+#include "gurka.h"
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace valhalla;
+
+TEST(LowMemoryBuild, SameTilesAsInMemory) {
+  const std::string ascii_map = R"(
+    A----B----C
+         |    |
+         D----E----F
+  )";
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "primary"}, {"ref", "N 1"}}},
+      {"BD", {{"highway", "residential"}}},
+      {"CE", {{"highway", "residential"}, {"oneway", "yes"}}},
+      {"DEF", {{"highway", "secondary"}}},
+  };
+  const gurka::relations relations = {
+      {{{gurka::way_member, "BD", "from"},
+        {gurka::way_member, "DEF", "to"},
+        {gurka::node_member, "D", "via"}},
+       {{"type", "restriction"}, {"restriction", "no_left_turn"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto in_memory =
+      gurka::buildtiles(layout, ways, {}, relations, "test/data/gurka_low_memory_build_off");
+  auto low_memory =
+      gurka::buildtiles(layout, ways, {}, relations, "test/data/gurka_low_memory_build_on",
+                        {{"mjolnir.concurrency", "1"}, {"mjolnir.low_memory", "true"}});
+
+  baldr::GraphReader one(in_memory.config.get_child("mjolnir"));
+  baldr::GraphReader two(low_memory.config.get_child("mjolnir"));
+  const auto tiles = one.GetTileSet();
+  ASSERT_FALSE(tiles.empty());
+  EXPECT_EQ(tiles, two.GetTileSet());
+  for (const auto& tile_id : tiles) {
+    auto tile_one = one.GetGraphTile(tile_id);
+    auto tile_two = two.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile_one && tile_two) << tile_id;
+    const auto nodes = tile_one->GetNodes();
+    const auto edges = tile_one->GetDirectedEdges();
+    ASSERT_EQ(nodes.size(), tile_two->GetNodes().size()) << tile_id;
+    ASSERT_EQ(edges.size(), tile_two->GetDirectedEdges().size()) << tile_id;
+    EXPECT_EQ(std::memcmp(nodes.begin(), tile_two->GetNodes().begin(),
+                          nodes.size() * sizeof(baldr::NodeInfo)),
+              0)
+        << tile_id;
+    EXPECT_EQ(std::memcmp(edges.begin(), tile_two->GetDirectedEdges().begin(),
+                          edges.size() * sizeof(baldr::DirectedEdge)),
+              0)
+        << tile_id;
+    // the restriction is in the edges, the names and refs came back from disk as well
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+      EXPECT_EQ(tile_one->edgeinfo(tile_one->directededge(i)).GetNames(),
+                tile_two->edgeinfo(tile_two->directededge(i)).GetNames())
+          << tile_id << " edge " << i;
+    }
+  }
+}
@@ -225,20 +225,17 @@ TEST_F(MatrixTest, CostMatrixWithLiveTraffic) {
   check_matrix(res_doc, {0.0f, 2.8f}, true, Matrix::CostMatrix);
   ASSERT_EQ(result.info().warnings().size(), 0);
 
-  // we don't support date_time on the targets
-  options = {{"/targets/0/date_time", "2016-07-03T08:06"},
+  // bidir matrix allows less targets than sources and date_time on the targets, the backward
+  // searches arrive at that time and see the traffic too
+  options = {{"/targets/0/date_time", "current"},
              {"/costing_options/auto/speed_types/0", "current"},
              {"/prioritize_bidirectional", "1"}};
   res.erase();
   result = gurka::do_action(Options::sources_to_targets, map, {"E", "L"}, {"E"}, "auto", options,
                             nullptr, &res);
   res_doc.Parse(res.c_str());
-  // TODO: there's still a bug in CostMatrix which chooses the wrong correlated edges:
-  // https://github.com/valhalla/valhalla/issues/3803
-  // this should really take the longer route since it's not using traffic here
-  check_matrix(res_doc, {0.0f, 2.8f}, false, Matrix::CostMatrix);
-  ASSERT_EQ(result.info().warnings().size(), 1);
-  ASSERT_EQ(result.info().warnings(0).code(), 206);
+  check_matrix(res_doc, {0.0f, 2.8f}, true, Matrix::CostMatrix);
+  ASSERT_EQ(result.info().warnings().size(), 0);
 }
 
 TEST_F(MatrixTest, DisallowedRequest) {
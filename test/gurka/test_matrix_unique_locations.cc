@@ -0,0 +1,100 @@
+#include "gurka.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class MatrixUniqueLocations : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A----B----C
+      |    |    |
+      D----E----F
+      |    |    |
+      G----H----I
+    )";
+
+    const gurka::ways ways = {
+        {"ABC", {{"highway", "residential"}}}, {"DEF", {{"highway", "footway"}}},
+        {"GHI", {{"highway", "residential"}}}, {"ADG", {{"highway", "residential"}}},
+        {"BEH", {{"highway", "path"}}},        {"CFI", {{"highway", "residential"}}},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/matrix_unique_locations");
+  }
+
+  static void expect_same_cells(const Matrix& matrix,
+                                const Matrix& expected,
+                                const std::vector<size_t>& sources,
+                                const std::vector<size_t>& targets,
+                                const size_t expected_targets,
+                                const bool same_algorithm = true) {
+    ASSERT_EQ(matrix.times_size(), sources.size() * targets.size());
+    for (size_t s = 0; s < sources.size(); ++s) {
+      for (size_t t = 0; t < targets.size(); ++t) {
+        const size_t cell = s * targets.size() + t;
+        const size_t from = sources[s] * expected_targets + targets[t];
+        EXPECT_EQ(matrix.from_indices(cell), s);
+        EXPECT_EQ(matrix.to_indices(cell), t);
+        EXPECT_NEAR(matrix.times(cell), expected.times(from), 0.01);
+        // another algorithm may take another path of the same cost
+        if (same_algorithm) {
+          EXPECT_EQ(matrix.distances(cell), expected.distances(from));
+        }
+      }
+    }
+  }
+};
+
+gurka::map MatrixUniqueLocations::map = {};
+
+TEST_F(MatrixUniqueLocations, duplicates_get_the_cells_of_their_location) {
+  for (const auto& costing : {"auto", "pedestrian"}) {
+    auto expected =
+        gurka::do_action(Options::sources_to_targets, map, {"A", "E", "I"}, {"C", "G"}, costing);
+    auto result = gurka::do_action(Options::sources_to_targets, map, {"A", "E", "A", "I", "E"},
+                                   {"C", "G", "C"}, costing);
+    expect_same_cells(result.matrix(), expected.matrix(), {0, 1, 0, 2, 1}, {0, 1, 0}, 2);
+
+    // the response names every location of the request
+    EXPECT_EQ(result.options().sources_size(), 5);
+    EXPECT_EQ(result.options().targets_size(), 3);
+  }
+}
+
+TEST_F(MatrixUniqueLocations, symmetric_mirrors_the_upper_triangle) {
+  const std::vector<std::string> locations = {"A", "C", "E", "G", "I", "A"};
+  auto expected =
+      gurka::do_action(Options::sources_to_targets, map, locations, locations, "pedestrian");
+  auto result = gurka::do_action(Options::sources_to_targets, map, locations, locations,
+                                 "pedestrian", {{"/symmetric", "1"}});
+  EXPECT_EQ(result.info().warnings_size(), 0);
+  expect_same_cells(result.matrix(), expected.matrix(), {0, 1, 2, 3, 4, 5}, {0, 1, 2, 3, 4, 5}, 6,
+                    false);
+  for (size_t i = 0; i < locations.size(); ++i) {
+    for (size_t j = 0; j < locations.size(); ++j) {
+      EXPECT_EQ(result.matrix().times(i * locations.size() + j),
+                result.matrix().times(j * locations.size() + i));
+    }
+  }
+}
+
+TEST_F(MatrixUniqueLocations, symmetric_needs_a_costing_without_oneways) {
+  const std::vector<std::string> locations = {"A", "E", "I"};
+  auto expected = gurka::do_action(Options::sources_to_targets, map, locations, locations, "auto");
+  auto result = gurka::do_action(Options::sources_to_targets, map, locations, locations, "auto",
+                                 {{"/symmetric", "1"}});
+  ASSERT_EQ(result.info().warnings_size(), 1);
+  EXPECT_EQ(result.info().warnings(0).code(), 207);
+  expect_same_cells(result.matrix(), expected.matrix(), {0, 1, 2}, {0, 1, 2}, 3);
+
+  // so are sources that are not the targets
+  result = gurka::do_action(Options::sources_to_targets, map, {"A", "E"}, {"E", "A"}, "pedestrian",
+                            {{"/symmetric", "1"}});
+  ASSERT_EQ(result.info().warnings_size(), 1);
+  EXPECT_EQ(result.info().warnings(0).code(), 207);
+}
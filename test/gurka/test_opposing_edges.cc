@@ -0,0 +1,101 @@
+#include "gurka.h"
+#include "mjolnir/graphtilebuilder.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// opposing edge of every directed edge of the map, found the way the reader does
+std::map<GraphId, GraphId> opposing_edges(const gurka::map& map) {
+  GraphReader reader(map.config.get_child("mjolnir"));
+  std::map<GraphId, GraphId> opposing;
+  for (auto tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    GraphId edge_id = tile_id;
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i, ++edge_id) {
+      opposing[edge_id] = reader.GetOpposingEdgeId(edge_id);
+    }
+  }
+  return opposing;
+}
+
+void store_opposing_edges(const gurka::map& map, const std::map<GraphId, GraphId>& opposing) {
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+  GraphReader reader(map.config.get_child("mjolnir"));
+  for (auto tile_id : reader.GetTileSet()) {
+    mjolnir::GraphTileBuilder builder(tile_dir, tile_id, false);
+    std::vector<GraphId> ids;
+    GraphId edge_id = tile_id;
+    for (uint32_t i = 0; i < builder.header()->directededgecount(); ++i, ++edge_id) {
+      ids.push_back(opposing.at(edge_id));
+    }
+    builder.UpdateOpposingEdgeIds(ids);
+  }
+}
+
+} // namespace
+
+TEST(OpposingEdges, stored_in_tile) {
+  const std::string ascii_map = R"(
+      A----B----C
+      |         |
+      D----E----F
+    )";
+
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "primary"}}},
+      {"DEF", {{"highway", "residential"}}},
+      {"AD", {{"highway", "residential"}}},
+      {"CF", {{"highway", "residential"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/opposing_edges");
+
+  const auto expected = opposing_edges(map);
+  {
+    GraphReader reader(map.config.get_child("mjolnir"));
+    auto tile = reader.GetGraphTile(expected.begin()->first);
+    EXPECT_FALSE(tile->has_opposing_edge_ids());
+  }
+
+  // the reader now looks them up and gets the same answers
+  store_opposing_edges(map, expected);
+  {
+    GraphReader reader(map.config.get_child("mjolnir"));
+    for (const auto& edge : expected) {
+      graph_tile_ptr tile = reader.GetGraphTile(edge.first);
+      ASSERT_TRUE(tile->has_opposing_edge_ids());
+      EXPECT_EQ(tile->opposing_edge_id(edge.first.id()), edge.second);
+
+      graph_tile_ptr opp_tile;
+      EXPECT_EQ(reader.GetOpposingEdgeId(edge.first, opp_tile), edge.second);
+      ASSERT_TRUE(opp_tile);
+      EXPECT_EQ(opp_tile->id(), edge.second.Tile_Base());
+    }
+  }
+
+  // storing them again overwrites the section instead of adding another one
+  std::vector<uint32_t> sizes;
+  {
+    GraphReader reader(map.config.get_child("mjolnir"));
+    for (auto tile_id : reader.GetTileSet()) {
+      sizes.push_back(reader.GetGraphTile(tile_id)->header()->end_offset());
+    }
+  }
+  store_opposing_edges(map, expected);
+  EXPECT_EQ(opposing_edges(map), expected);
+  {
+    GraphReader reader(map.config.get_child("mjolnir"));
+    size_t i = 0;
+    for (auto tile_id : reader.GetTileSet()) {
+      EXPECT_EQ(reader.GetGraphTile(tile_id)->header()->end_offset(), sizes[i++]);
+    }
+  }
+
+  // the rest of the tile is untouched
+  auto result = gurka::do_action(valhalla::Options::route, map, {"A", "F"}, "auto");
+  gurka::assert::raw::expect_path(result, {"ABC", "CF"});
+}
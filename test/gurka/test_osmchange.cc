@@ -0,0 +1,88 @@
+#include "gurka.h"
+#include "mjolnir/osmchange.h"
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace valhalla;
+
+namespace {
+
+const std::string osc = R"(<?xml version="1.0" encoding="UTF-8"?>
+<osmChange version="0.6" generator="test">
+  <modify>
+    <way id="100" version="2">
+      <nd ref="1"/>
+      <nd ref="2"/>
+      <tag k="highway" v="primary"/>
+    </way>
+  </modify>
+  <create>
+    <node id="7" version="1" lat="52.0" lon="5.1"/>
+    <node id="-1" version="1" lat="52.1" lon="5.2"/>
+    <relation id="8" version="1">
+      <member type="way" ref="300" role="from"/>
+      <member type="node" ref="5" role="via"/>
+    </relation>
+  </create>
+  <delete>
+    <node id="9" version="3"/>
+  </delete>
+</osmChange>)";
+
+} // namespace
+
+TEST(OSMChange, Read) {
+  std::stringstream ss(osc);
+  auto change = mjolnir::OSMChange::Read(ss);
+  ASSERT_EQ(change.node_positions.size(), 2);
+  EXPECT_EQ(change.node_positions.front(), midgard::PointLL(5.1, 52.0));
+  EXPECT_EQ(change.way_ids, (std::unordered_set<uint64_t>{100, 300}));
+
+  std::stringstream not_a_change("<osm version=\"0.6\"></osm>");
+  EXPECT_THROW(mjolnir::OSMChange::Read(not_a_change), std::runtime_error);
+}
+
+TEST(OSMChange, AffectedTiles) {
+  // 10km per character so every node is in a tile of its own, far from the others
+  const std::string ascii_map = R"(
+    A-----B-----C                  D-----E
+  )";
+  const gurka::ways ways = {
+      {"AB", {{"highway", "residential"}, {"osm_id", "100"}}},
+      {"BC", {{"highway", "residential"}, {"osm_id", "200"}}},
+      {"DE", {{"highway", "residential"}, {"osm_id", "300"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10000, {4.0, 52.0});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_osmchange");
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+
+  const auto& local = baldr::TileHierarchy::levels().back();
+  auto tile = [&](const std::string& node, const uint8_t level) {
+    return baldr::TileHierarchy::GetGraphId(layout.at(node), level);
+  };
+  for (const auto& node : {"A", "B", "C", "D", "E"}) {
+    ASSERT_TRUE(reader.DoesTileExist(tile(node, local.level))) << node;
+  }
+
+  // the way is in the tiles of A and B, the edge from C ends in the tile of B
+  mjolnir::OSMChange change;
+  change.way_ids.insert(100);
+  auto affected = mjolnir::AffectedTiles(reader, change);
+  for (const auto& node : {"A", "B", "C"}) {
+    EXPECT_TRUE(affected.count(tile(node, local.level))) << node;
+    for (const auto& level : baldr::TileHierarchy::levels()) {
+      EXPECT_TRUE(affected.count(tile(node, level.level))) << node;
+    }
+  }
+  EXPECT_FALSE(affected.count(tile("D", local.level)));
+  EXPECT_FALSE(affected.count(tile("E", local.level)));
+
+  // a node next to D, the edge from E ends in its tile
+  change.way_ids.clear();
+  change.node_positions.push_back(layout.at("D"));
+  affected = mjolnir::AffectedTiles(reader, change);
+  EXPECT_TRUE(affected.count(tile("D", local.level)));
+  EXPECT_TRUE(affected.count(tile("E", local.level)));
+  EXPECT_FALSE(affected.count(tile("A", local.level)));
+}
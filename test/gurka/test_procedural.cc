@@ -0,0 +1,73 @@
+#include "gurka.h"
+#include "procedural.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+namespace procedural = gurka::procedural;
+
+namespace {
+
+size_t count_edges(baldr::GraphReader& reader) {
+  size_t edges = 0;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    edges += reader.GetGraphTile(tile_id)->header()->directededgecount();
+  }
+  return edges;
+}
+
+} // namespace
+
+TEST(Procedural, grid) {
+  procedural::Params params;
+  params.size = 12;
+  params.arterial_every = 4;
+  params.highway_every = 8;
+  const auto map = procedural::build(params, "test/data/procedural");
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+
+  // every segment of the rows and columns is a pair of directed edges, the motorways and primary
+  // roads are also on the highway and arterial levels
+  EXPECT_GE(count_edges(*reader), size_t(2 * 2 * params.size * (params.size - 1)));
+
+  // the corners are connected
+  auto result = gurka::do_action(Options::route, map, {"nw", "se"}, "auto");
+  EXPECT_EQ(result.trip().routes(0).legs_size(), 1);
+  EXPECT_NEAR(result.directions().routes(0).legs(0).summary().length(),
+              2 * (params.size - 1) * params.spacing / 1000, 0.1);
+
+  // the locations and traces don't change for the same seed
+  EXPECT_EQ(procedural::locations(params, 5, 7), procedural::locations(params, 5, 7));
+  EXPECT_NE(procedural::locations(params, 5, 7), procedural::locations(params, 5, 8));
+  const auto trace = procedural::trace(params, 5);
+  ASSERT_EQ(trace.size(), 5u);
+  EXPECT_NEAR(trace.front().Distance(trace.back()), 4 * params.spacing, 1);
+}
+
+TEST(Procedural, cached) {
+  procedural::Params params;
+  params.layout = procedural::Layout::kRadial;
+  params.size = 5;
+  params.spokes = 8;
+  params.jitter = 10;
+  params.oneway_share = .5;
+  const auto map = procedural::build(params, "test/data/procedural");
+  const auto complete = map.config.get<std::string>("mjolnir.tile_dir") + "/complete";
+  ASSERT_TRUE(filesystem::exists(complete));
+
+  // a second build of the same map reuses the tiles
+  const auto built = filesystem::last_write_time(complete);
+  const auto again = procedural::build(params, "test/data/procedural");
+  EXPECT_EQ(again.config.get<std::string>("mjolnir.tile_dir"),
+            map.config.get<std::string>("mjolnir.tile_dir"));
+  EXPECT_EQ(filesystem::last_write_time(complete), built);
+
+  // while another seed is another map
+  auto reseeded = params;
+  reseeded.seed = 2;
+  EXPECT_NE(reseeded.name(), params.name());
+
+  auto result = gurka::do_action(Options::route, map, {"c", "o"}, "auto");
+  EXPECT_EQ(result.trip().routes(0).legs_size(), 1);
+}
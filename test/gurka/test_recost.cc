@@ -742,3 +742,71 @@ TEST(recosting, api) {
     }
   }
 }
+
+TEST(recosting, batch) {
+  const std::string ascii_map = R"(A--1--B-2-3-C
+                                         |     |
+                                         |     |
+                                         4     5
+                                         |     |
+                                         |     |
+                                         D--6--E--7--F)";
+  const gurka::ways ways = {
+      {"A1B23C", {{"highway", "primary"}}},
+      {"D6E7F", {{"highway", "residential"}}},
+      {"B4D", {{"highway", "residential"}, {"hgv", "no"}}},
+      {"C5E", {{"highway", "residential"}, {"hgv", "no"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_recost_batch", build_config);
+  auto reader = std::make_shared<baldr::GraphReader>(map.config.get_child("mjolnir"));
+  auto api = gurka::do_action(valhalla::Options::route, map, {"1", "7"}, "auto", {}, reader);
+  const auto& leg = api.trip().routes(0).legs(0);
+
+  auto edge_itr = leg.node().begin();
+  sif::EdgeCallback edge_cb = [&edge_itr]() -> baldr::GraphId {
+    auto edge_id = edge_itr->has_edge() ? baldr::GraphId(edge_itr->edge().id()) : baldr::GraphId{};
+    ++edge_itr;
+    return edge_id;
+  };
+  float src_pct = api.options().locations(0).correlation().edges(0).percent_along();
+  float tgt_pct = 1;
+  for (const auto& edge : api.options().locations(1).correlation().edges()) {
+    if (std::next(leg.node().rbegin())->edge().id() == edge.graph_id()) {
+      tgt_pct = edge.percent_along();
+      break;
+    }
+  }
+
+  // the truck isnt allowed on the residential edges so it drops out along the way
+  sif::CostFactory factory;
+  std::vector<sif::cost_ptr_t> costings{factory.Create(Costing::auto_),
+                                        factory.Create(Costing::bicycle),
+                                        factory.Create(Costing::truck)};
+  std::vector<std::vector<sif::EdgeLabel>> batch(costings.size());
+  auto allowed = sif::recost_forward(
+      *reader, {costings[0].get(), costings[1].get(), costings[2].get()}, edge_cb,
+      [&batch](size_t i, const sif::EdgeLabel& label) { batch[i].push_back(label); }, src_pct,
+      tgt_pct);
+  EXPECT_EQ(allowed, std::vector<bool>({true, true, false}));
+  EXPECT_FALSE(batch[2].empty());
+  EXPECT_LT(batch[2].size(), batch[0].size());
+
+  // the costings that make it come out the same as when they recost one at a time
+  for (size_t i = 0; i < 2; ++i) {
+    std::vector<sif::EdgeLabel> single;
+    edge_itr = leg.node().begin();
+    sif::recost_forward(
+        *reader, *costings[i], edge_cb,
+        [&single](const sif::EdgeLabel& label) { single.push_back(label); }, src_pct, tgt_pct);
+    ASSERT_EQ(batch[i].size(), single.size());
+    for (size_t j = 0; j < single.size(); ++j) {
+      EXPECT_EQ(batch[i][j].edgeid(), single[j].edgeid());
+      EXPECT_EQ(batch[i][j].predecessor(), single[j].predecessor());
+      EXPECT_EQ(batch[i][j].path_distance(), single[j].path_distance());
+      EXPECT_FLOAT_EQ(batch[i][j].cost().secs, single[j].cost().secs);
+      EXPECT_FLOAT_EQ(batch[i][j].cost().cost, single[j].cost().cost);
+      EXPECT_FLOAT_EQ(batch[i][j].transition_cost().secs, single[j].transition_cost().secs);
+    }
+  }
+}
@@ -0,0 +1,103 @@
+#include "gurka.h"
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace valhalla;
+
+namespace {
+
+std::vector<rapidjson::Document> parse_lines(const std::string& response) {
+  std::vector<rapidjson::Document> lines;
+  std::istringstream stream(response);
+  std::string line;
+  while (std::getline(stream, line)) {
+    lines.emplace_back();
+    lines.back().Parse(line.c_str());
+    EXPECT_FALSE(lines.back().HasParseError()) << line;
+  }
+  return lines;
+}
+
+} // namespace
+
+class RouteBatchTest : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A----B----C----D
+      |    |    |    |
+      E----F----G----H
+      |    |    |    |
+      I----J----K----L     M----N
+    )";
+    const gurka::ways ways = {
+        {"AB", {{"highway", "primary"}}},     {"BC", {{"highway", "primary"}}},
+        {"CD", {{"highway", "primary"}}},     {"EF", {{"highway", "residential"}}},
+        {"FG", {{"highway", "residential"}}}, {"GH", {{"highway", "residential"}}},
+        {"IJ", {{"highway", "residential"}}}, {"JK", {{"highway", "residential"}}},
+        {"KL", {{"highway", "residential"}}}, {"AE", {{"highway", "residential"}}},
+        {"EI", {{"highway", "residential"}}}, {"BF", {{"highway", "residential"}}},
+        {"FJ", {{"highway", "residential"}}}, {"CG", {{"highway", "residential"}}},
+        {"GK", {{"highway", "residential"}}}, {"DH", {{"highway", "residential"}}},
+        {"HL", {{"highway", "residential"}}}, {"MN", {{"highway", "residential"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_route_batch");
+  }
+};
+
+gurka::map RouteBatchTest::map = {};
+
+TEST_F(RouteBatchTest, MatchesRoute) {
+  const std::vector<std::string> sources = {"A", "I", "F", "D"};
+  const std::vector<std::string> targets = {"L", "D", "K", "A"};
+
+  std::string response;
+  gurka::do_action(Options::route_batch, map, sources, targets, "auto", {}, {}, &response);
+  auto lines = parse_lines(response);
+  ASSERT_EQ(lines.size(), sources.size());
+
+  // every pair has to be the same as the equivalent single route
+  for (size_t i = 0; i < sources.size(); ++i) {
+    EXPECT_EQ(lines[i]["index"].GetUint64(), i);
+    auto route = gurka::do_action(Options::route, map, {sources[i], targets[i]}, "auto");
+    const auto& summary = route.directions().routes(0).legs(0).summary();
+    EXPECT_NEAR(lines[i]["distance"].GetDouble(), summary.length(), 0.01) << i;
+    EXPECT_NEAR(lines[i]["time"].GetDouble(), summary.time(), 1.0) << i;
+    EXPECT_STREQ(lines[i]["units"].GetString(), "kilometers");
+  }
+}
+
+TEST_F(RouteBatchTest, UnroutablePairDoesNotFailBatch) {
+  std::string response;
+  gurka::do_action(Options::route_batch, map, {"A", "M", "E"}, {"L", "A", "H"}, "auto", {}, {},
+                   &response);
+  auto lines = parse_lines(response);
+  ASSERT_EQ(lines.size(), 3);
+  EXPECT_FALSE(lines[0]["time"].IsNull());
+  EXPECT_TRUE(lines[1]["time"].IsNull());
+  EXPECT_TRUE(lines[1]["distance"].IsNull());
+  EXPECT_FALSE(lines[2]["distance"].IsNull());
+}
+
+TEST_F(RouteBatchTest, Miles) {
+  std::string response;
+  gurka::do_action(Options::route_batch, map, {"A"}, {"D"}, "auto", {{"/units", "miles"}}, {},
+                   &response);
+  auto lines = parse_lines(response);
+  ASSERT_EQ(lines.size(), 1);
+  EXPECT_STREQ(lines[0]["units"].GetString(), "miles");
+  EXPECT_NEAR(lines[0]["distance"].GetDouble(), 0.3 * 0.621371, 0.01);
+}
+
+TEST_F(RouteBatchTest, MismatchedPairs) {
+  try {
+    gurka::do_action(Options::route_batch, map, {"A", "B"}, {"D"}, "auto");
+    FAIL() << "Expected a valhalla_exception_t";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 129); }
+}
@@ -180,12 +180,12 @@ struct test_reader : public baldr::GraphReader {
     tile_extract_.reset(new baldr::GraphReader::tile_extract_t(pt));
     enable_incidents_ = true;
   }
-  virtual std::shared_ptr<const valhalla::IncidentsTile>
+  virtual std::shared_ptr<const baldr::IncidentTile>
   GetIncidentTile(const baldr::GraphId& tile_id) const override {
     auto i = incidents.find(tile_id.Tile_Base());
     if (i == incidents.cend())
       return {};
-    return std::shared_ptr<valhalla::IncidentsTile>(&i->second, [](valhalla::IncidentsTile*) {});
+    return std::make_shared<const baldr::IncidentTile>(i->second);
   }
   void add(const baldr::GraphId& id,
            valhalla::IncidentsTile::Location&& _incident_location,
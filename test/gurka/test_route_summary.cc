@@ -204,3 +204,49 @@ TEST(TestRouteSummary, DupSummaryFix) {
 
   filesystem::remove_all(workdir);
 }
+
+TEST(TestRouteSummary, SummaryOnlyLeg) {
+  const std::string ascii_map = R"(
+      A----B----C
+           |    |
+           D----E----F
+    )";
+
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "primary"}, {"name", "RT 1"}}},
+      {"BD", {{"highway", "residential"}, {"name", "RT 2"}}},
+      {"CEF", {{"highway", "primary"}, {"name", "RT 3"}}},
+      {"DE", {{"highway", "residential"}, {"name", "RT 4"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_test_route_summary_only");
+
+  auto full = gurka::do_action(valhalla::Options::route, map, {"A", "F"}, "auto");
+  auto summary = gurka::do_action(valhalla::Options::route, map, {"A", "F"}, "auto",
+                                  {{"/directions_type", "none"}});
+
+  // the summary is the same
+  const auto& full_leg = full.trip().routes(0).legs(0);
+  const auto& summary_leg = summary.trip().routes(0).legs(0);
+  EXPECT_EQ(summary_leg.shape(), full_leg.shape());
+  EXPECT_EQ(summary.directions().routes(0).legs(0).summary().length(),
+            full.directions().routes(0).legs(0).summary().length());
+  EXPECT_EQ(summary.directions().routes(0).legs(0).summary().time(),
+            full.directions().routes(0).legs(0).summary().time());
+  ASSERT_EQ(summary_leg.node_size(), full_leg.node_size());
+
+  // but nothing only maneuvers read is built
+  bool intersecting = false;
+  for (int i = 0; i < full_leg.node_size(); ++i) {
+    intersecting = intersecting || full_leg.node(i).intersecting_edge_size() > 0;
+    EXPECT_EQ(summary_leg.node(i).intersecting_edge_size(), 0);
+    if (full_leg.node(i).has_edge()) {
+      EXPECT_GT(full_leg.node(i).edge().name_size(), 0);
+      EXPECT_EQ(summary_leg.node(i).edge().name_size(), 0);
+      EXPECT_EQ(summary_leg.node(i).edge().length_km(), full_leg.node(i).edge().length_km());
+    }
+  }
+  EXPECT_TRUE(intersecting);
+  EXPECT_EQ(summary.directions().routes(0).legs(0).maneuver_size(), 0);
+}
@@ -0,0 +1,107 @@
+#include "gurka.h"
+#include "sif/edgelabel.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+namespace {
+
+class SearchEffort : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A-----B-----C-----D
+      |     |     |     |
+      E-----F-----G-----H
+      |     |     |     |
+      I-----J-----K-----L
+    )";
+    const gurka::ways ways = {
+        {"ABCD", {{"highway", "residential"}}}, {"EFGH", {{"highway", "residential"}}},
+        {"IJKL", {{"highway", "residential"}}}, {"AEI", {{"highway", "residential"}}},
+        {"BFJ", {{"highway", "residential"}}},  {"CGK", {{"highway", "residential"}}},
+        {"DHL", {{"highway", "residential"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_search_effort");
+  }
+};
+gurka::map SearchEffort::map = {};
+
+void check_effort(const rapidjson::Value& effort, const std::string& algorithm) {
+  ASSERT_TRUE(effort.IsObject());
+  EXPECT_EQ(std::string(effort["algorithm"].GetString()), algorithm);
+  EXPECT_GT(effort["settled"].GetUint64(), 0);
+  EXPECT_GE(effort["reached"].GetUint64(), effort["settled"].GetUint64());
+  EXPECT_GT(effort["label_bytes"].GetUint64(), 0);
+  EXPECT_GE(effort["tiles_fetched"].GetUint64(), effort["tile_cache_misses"].GetUint64());
+  for (const auto* phase : {"setup_ms", "expansion_ms", "path_ms"}) {
+    EXPECT_GE(effort[phase].GetDouble(), 0.) << phase;
+  }
+}
+
+} // namespace
+
+TEST_F(SearchEffort, route) {
+  std::string json;
+  auto api = gurka::do_action(Options::route, map, {"A", "L"}, "auto", {}, {}, &json);
+  ASSERT_EQ(api.info().search_effort_size(), 1);
+  EXPECT_EQ(api.info().search_effort(0).reached(),
+            api.info().search_effort(0).label_bytes() / sizeof(sif::BDEdgeLabel));
+
+  rapidjson::Document result;
+  result.Parse(json.c_str());
+  ASSERT_TRUE(result.HasMember("search_effort"));
+  ASSERT_EQ(result["search_effort"].Size(), 1);
+  check_effort(result["search_effort"][0], "bidirectional_a*");
+}
+
+TEST_F(SearchEffort, one_per_leg) {
+  auto api = gurka::do_action(Options::route, map, {"A", "G", "L"}, "auto");
+  EXPECT_EQ(api.info().search_effort_size(), 2);
+}
+
+TEST_F(SearchEffort, not_verbose) {
+  // gurka asks for verbose responses, the same request without it must not have the effort
+  std::string request;
+  gurka::do_action(Options::route, map, {"A", "L"}, "auto", {}, {}, nullptr, "break", &request);
+  const auto verbose = request.find("\"verbose\":true");
+  ASSERT_NE(verbose, std::string::npos);
+  request.replace(verbose, 14, "\"verbose\":false");
+
+  std::string json;
+  auto api = gurka::do_action(Options::route, map, request, {}, &json);
+  EXPECT_EQ(api.info().search_effort_size(), 0);
+
+  rapidjson::Document result;
+  result.Parse(json.c_str());
+  EXPECT_FALSE(result.HasMember("search_effort"));
+}
+
+TEST_F(SearchEffort, matrix) {
+  std::string json;
+  gurka::do_action(Options::sources_to_targets, map, {"A", "D"}, {"I", "L"}, "auto", {}, {},
+                   &json);
+
+  rapidjson::Document result;
+  result.Parse(json.c_str());
+  ASSERT_TRUE(result.HasMember("search_effort"));
+  ASSERT_EQ(result["search_effort"].Size(), 1);
+  check_effort(result["search_effort"][0], "costmatrix");
+}
+
+TEST_F(SearchEffort, isochrone) {
+  std::string json;
+  gurka::do_action(Options::isochrone, map, {"F"}, "auto", {{"/contours/0/time", "5"}}, {}, &json);
+
+  rapidjson::Document result;
+  result.Parse(json.c_str());
+  ASSERT_TRUE(result.HasMember("search_effort"));
+  ASSERT_EQ(result["search_effort"].Size(), 1);
+  const auto& effort = result["search_effort"][0];
+  EXPECT_EQ(std::string(effort["algorithm"].GetString()), "isochrone");
+  EXPECT_GT(effort["settled"].GetUint64(), 0);
+  EXPECT_GT(effort["reached"].GetUint64(), 0);
+}
@@ -0,0 +1,56 @@
+#include "gurka.h"
+#include "midgard/encoded.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+TEST(Standalone, ShapeZooms) {
+  const std::string ascii_map = R"(
+    B---C---D
+    |
+    A
+  )";
+
+  const gurka::ways ways = {
+      {"AB", {{"highway", "primary"}}},
+      {"BC", {{"highway", "primary"}}},
+      {"CD", {{"highway", "primary"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10, {40.7351162, -73.985719});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/shape_zooms");
+
+  // no zoom shapes unless asked for
+  auto result = gurka::do_action(valhalla::Options::route, map, {"A", "D"}, "auto");
+  EXPECT_EQ(result.directions().routes(0).legs(0).zoom_shapes_size(), 0);
+
+  // out of range and repeated zoom levels are dropped
+  const std::string request =
+      (boost::format(R"({"locations":[{"lat":%s,"lon":%s},{"lat":%s,"lon":%s}],
+             "costing":"auto","shape_zooms":[18,0,19,18]})") %
+       std::to_string(map.nodes.at("A").lat()) % std::to_string(map.nodes.at("A").lng()) %
+       std::to_string(map.nodes.at("D").lat()) % std::to_string(map.nodes.at("D").lng()))
+          .str();
+  result = gurka::do_action(valhalla::Options::route, map, request);
+  const auto& leg = result.directions().routes(0).legs(0);
+  EXPECT_EQ(midgard::decode<std::vector<midgard::PointLL>>(leg.shape()).size(), 4);
+  ASSERT_EQ(leg.zoom_shapes_size(), 2);
+
+  // C is on the way from B to D so it goes at any zoom, B only goes at low zoom
+  EXPECT_EQ(leg.zoom_shapes(0).zoom(), 18);
+  auto shape = midgard::decode<std::vector<midgard::PointLL>>(leg.zoom_shapes(0).shape());
+  ASSERT_EQ(shape.size(), 3);
+  EXPECT_TRUE(shape[1].ApproximatelyEqual(map.nodes.at("B")));
+  EXPECT_EQ(leg.zoom_shapes(1).zoom(), 0);
+  shape = midgard::decode<std::vector<midgard::PointLL>>(leg.zoom_shapes(1).shape());
+  ASSERT_EQ(shape.size(), 2);
+  EXPECT_TRUE(shape[0].ApproximatelyEqual(map.nodes.at("A")));
+  EXPECT_TRUE(shape[1].ApproximatelyEqual(map.nodes.at("D")));
+
+  // and they are in the json
+  auto json = gurka::convert_to_json(result, Options::Format::Options_Format_json);
+  ASSERT_EQ(json["trip"]["legs"][0]["zoom_shapes"].Size(), 2);
+  EXPECT_EQ(json["trip"]["legs"][0]["zoom_shapes"][0]["zoom"].GetInt(), 18);
+  EXPECT_EQ(std::string(json["trip"]["legs"][0]["zoom_shapes"][1]["shape"].GetString()),
+            leg.zoom_shapes(1).shape());
+}
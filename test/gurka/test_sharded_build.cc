@@ -0,0 +1,132 @@
+#include "gurka.h"
+#include "mjolnir/util.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace valhalla;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+std::vector<uint64_t> bin(const baldr::graph_tile_ptr& tile, size_t index) {
+  std::vector<uint64_t> edges;
+  for (const auto& edge_id : tile->GetBin(index)) {
+    edges.push_back(edge_id.value);
+  }
+  std::sort(edges.begin(), edges.end());
+  return edges;
+}
+
+} // namespace
+
+TEST(ShardedBuild, SameTilesAsOneProcess) {
+  // 10km per character so the edges pass through tiles they dont start or end in
+  const std::string ascii_map = R"(
+    A------B------C-----------D
+                  |
+                  E-----------F
+  )";
+  const gurka::ways ways = {
+      {"AB", {{"highway", "motorway"}}},  {"BC", {{"highway", "primary"}}},
+      {"CD", {{"highway", "primary"}}},   {"CE", {{"highway", "residential"}}},
+      {"EF", {{"highway", "secondary"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10000, {4.0, 52.0});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_sharded_build_one");
+  const auto pbf = map.config.get<std::string>("mjolnir.tile_dir") + "/map.pbf";
+
+  // the same pbf in 2 shards, every stage in all shards before the next one
+  const std::string workdir = "test/data/gurka_sharded_build_two";
+  if (filesystem::exists(workdir)) {
+    filesystem::remove_all(workdir);
+  }
+  auto config = test::make_config(workdir);
+  config.put("mjolnir.shard.count", 2);
+  auto run = [&](const BuildStage start, const BuildStage end, const uint32_t index) {
+    auto shard_config = config;
+    shard_config.put("mjolnir.shard.index", index);
+    return build_tile_set(shard_config, {pbf}, start, end, false);
+  };
+  ASSERT_TRUE(run(BuildStage::kInitialize, BuildStage::kConstructEdges, 0));
+  ASSERT_TRUE(run(BuildStage::kInitialize, BuildStage::kConstructEdges, 1));
+  for (const auto stage : {BuildStage::kBuild, BuildStage::kEnhance}) {
+    ASSERT_TRUE(run(stage, stage, 0));
+    ASSERT_TRUE(run(stage, stage, 1));
+  }
+  ASSERT_TRUE(run(BuildStage::kFilter, BuildStage::kShortcuts, 0));
+  ASSERT_TRUE(run(BuildStage::kFilter, BuildStage::kShortcuts, 1));
+  ASSERT_TRUE(run(BuildStage::kElevation, BuildStage::kElevation, 0));
+  ASSERT_TRUE(run(BuildStage::kElevation, BuildStage::kElevation, 1));
+  ASSERT_TRUE(run(BuildStage::kRestrictions, BuildStage::kRestrictions, 0));
+  for (const auto index : {0, 1}) {
+    ASSERT_TRUE(run(BuildStage::kValidate, BuildStage::kValidate, index));
+  }
+  ASSERT_TRUE(run(BuildStage::kMerge, BuildStage::kMerge, 0));
+  EXPECT_FALSE(filesystem::exists(workdir + "/tweeners_0.bin"));
+
+  // a shard can not run a per tile stage together with another one
+  EXPECT_FALSE(run(BuildStage::kBuild, BuildStage::kEnhance, 1));
+
+  // the tiles are the same as when one process builds them all
+  baldr::GraphReader one(map.config.get_child("mjolnir"));
+  baldr::GraphReader two(config.get_child("mjolnir"));
+  const auto tiles = one.GetTileSet();
+  ASSERT_FALSE(tiles.empty());
+  EXPECT_EQ(tiles, two.GetTileSet());
+  bool binned = false;
+  for (const auto& tile_id : tiles) {
+    auto tile_one = one.GetGraphTile(tile_id);
+    auto tile_two = two.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile_one && tile_two) << tile_id;
+    const auto nodes = tile_one->GetNodes();
+    const auto edges = tile_one->GetDirectedEdges();
+    ASSERT_EQ(nodes.size(), tile_two->GetNodes().size()) << tile_id;
+    ASSERT_EQ(edges.size(), tile_two->GetDirectedEdges().size()) << tile_id;
+    EXPECT_EQ(std::memcmp(nodes.begin(), tile_two->GetNodes().begin(),
+                          nodes.size() * sizeof(baldr::NodeInfo)),
+              0)
+        << tile_id;
+    EXPECT_EQ(std::memcmp(edges.begin(), tile_two->GetDirectedEdges().begin(),
+                          edges.size() * sizeof(baldr::DirectedEdge)),
+              0)
+        << tile_id;
+    for (size_t i = 0; i < baldr::kBinCount; ++i) {
+      EXPECT_EQ(bin(tile_one, i), bin(tile_two, i)) << tile_id << " bin " << i;
+      binned = binned || (edges.size() == 0 && !bin(tile_one, i).empty());
+    }
+  }
+  // the long edges pass through tiles without nodes
+  EXPECT_TRUE(binned);
+}
+
+TEST(ShardedBuild, Select) {
+  std::vector<baldr::GraphId> tiles;
+  for (uint32_t i = 0; i < 10; ++i) {
+    tiles.emplace_back(9 - i, 2, 0);
+  }
+  tiles.emplace_back(5, 0, 0);
+
+  boost::property_tree::ptree config;
+  EXPECT_FALSE(TileShard::FromConfig(config).sharded());
+  EXPECT_EQ(TileShard::FromConfig(config).Select(tiles).size(), tiles.size());
+
+  // every tile in exactly one shard, each one a range of the ordered tiles
+  config.put("mjolnir.shard.count", 3);
+  std::vector<baldr::GraphId> all;
+  for (uint32_t index = 0; index < 3; ++index) {
+    config.put("mjolnir.shard.index", index);
+    auto shard = TileShard::FromConfig(config).Select(tiles);
+    EXPECT_GE(shard.size(), 3);
+    all.insert(all.end(), shard.begin(), shard.end());
+  }
+  ASSERT_EQ(all.size(), tiles.size());
+  EXPECT_EQ(all.front(), baldr::GraphId(5, 0, 0));
+  for (uint32_t i = 1; i < all.size(); ++i) {
+    EXPECT_EQ(all[i], baldr::GraphId(i - 1, 2, 0));
+  }
+
+  config.put("mjolnir.shard.index", 3);
+  EXPECT_THROW(TileShard::FromConfig(config), std::invalid_argument);
+}
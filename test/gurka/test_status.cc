@@ -0,0 +1,54 @@
+#include "gurka.h"
+#include "test.h"
+#include "tyr/actor.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+TEST(Status, TileSetFromMemory) {
+  const std::string ascii_map = R"(
+    A----B----C
+         |
+         D
+  )";
+  const gurka::ways ways = {
+      {"AB", {{"highway", "motorway"}}},
+      {"BC", {{"highway", "primary"}}},
+      {"BD", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100, {5.1, 52.1});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_status");
+
+  std::string version;
+  {
+    baldr::GraphReader reader(map.config.get_child("mjolnir"));
+    version = reader.GetGraphTile(*reader.GetTileSet().begin())->header()->version();
+  }
+
+  tyr::actor_t actor(map.config, true);
+  const auto verbose = test::json_to_pt(actor.status(R"({"verbose":true})"));
+  EXPECT_TRUE(verbose.get<bool>("has_tiles"));
+  EXPECT_FALSE(verbose.get<bool>("has_transit_tiles"));
+  EXPECT_FALSE(verbose.get<bool>("has_elevation"));
+  EXPECT_EQ(verbose.get<std::string>("tileset_version"), version);
+  EXPECT_NE(verbose.get_child_optional("bbox"), boost::none);
+
+  // a road of each class in one tile of its level
+  const auto& levels = verbose.get_child("tileset_levels");
+  ASSERT_EQ(levels.size(), 3);
+  uint32_t level = 0;
+  for (const auto& tiles : levels) {
+    EXPECT_EQ(tiles.second.get<uint32_t>("level"), level++);
+    EXPECT_EQ(tiles.second.get<uint64_t>("tiles"), 1);
+  }
+
+  // it was found when the worker started, the tiles aren't looked at again to answer
+  filesystem::remove_all(map.config.get<std::string>("mjolnir.tile_dir"));
+  const auto again = test::json_to_pt(actor.status(R"({"verbose":true})"));
+  EXPECT_EQ(again.get_child("tileset_levels"), levels);
+  EXPECT_EQ(again.get<std::string>("tileset_version"), version);
+
+  // none of it without verbose
+  const auto plain = test::json_to_pt(actor.status(""));
+  EXPECT_EQ(plain.get_child_optional("tileset_levels"), boost::none);
+}
@@ -0,0 +1,119 @@
+#include "gurka.h"
+#include "mjolnir/tileextract.h"
+#include <gtest/gtest.h>
+
+#include <set>
+
+using namespace valhalla;
+using namespace valhalla::mjolnir;
+
+TEST(TileExtract, HilbertIndex) {
+  // the 2x2 tiles in the corner of the grid are the first 4 on the curve
+  const auto columns = baldr::TileHierarchy::levels().back().tiles.ncolumns();
+  std::set<uint64_t> corner;
+  for (const uint32_t row : {0, 1}) {
+    for (const uint32_t column : {0, 1}) {
+      corner.insert(TileExtract::HilbertIndex(baldr::GraphId(row * columns + column, 2, 0)));
+    }
+  }
+  EXPECT_EQ(corner, (std::set<uint64_t>{0, 1, 2, 3}));
+
+  // every tile has its own place on the curve
+  std::set<uint64_t> indices;
+  for (uint32_t tile = 0; tile < 4 * columns; ++tile) {
+    EXPECT_TRUE(indices.insert(TileExtract::HilbertIndex(baldr::GraphId(tile, 2, 0))).second);
+  }
+}
+
+TEST(TileExtract, Build) {
+  // 10km per character so there are a few tiles on every level
+  const std::string ascii_map = R"(
+    A------B------C
+           |
+           D------E
+  )";
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "motorway"}}},
+      {"BD", {{"highway", "primary"}}},
+      {"DE", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10000, {4.0, 52.0});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_tile_extract");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+
+  // the tiles are ordered by level and follow each other block aligned
+  const auto tiles = TileExtract::Layout(tile_dir);
+  ASSERT_FALSE(tiles.empty());
+  for (size_t i = 1; i < tiles.size(); ++i) {
+    EXPECT_LE(tiles[i - 1].id.level(), tiles[i].id.level());
+    EXPECT_EQ(tiles[i].offset % 512, 0);
+    EXPECT_GE(tiles[i].offset, tiles[i - 1].offset + tiles[i - 1].size + 512);
+  }
+
+  // the reader finds every tile through the index
+  const auto extract = tile_dir + "/tiles.tar";
+  EXPECT_EQ(TileExtract::Build(tile_dir, extract, 3), tiles.size());
+  auto config = map.config;
+  config.put("mjolnir.tile_extract", extract);
+  baldr::GraphReader from_dir(map.config.get_child("mjolnir"));
+  baldr::GraphReader from_tar(config.get_child("mjolnir"));
+  ASSERT_EQ(from_tar.tile_extract(), extract);
+  EXPECT_EQ(from_tar.GetTileSet(), from_dir.GetTileSet());
+  for (const auto& tile : tiles) {
+    auto tile_dir_tile = from_dir.GetGraphTile(tile.id);
+    auto tile_tar_tile = from_tar.GetGraphTile(tile.id);
+    ASSERT_TRUE(tile_dir_tile && tile_tar_tile) << tile.id;
+    EXPECT_EQ(tile_tar_tile->header()->directededgecount(),
+              tile_dir_tile->header()->directededgecount())
+        << tile.id;
+  }
+
+  map.config = config;
+  gurka::do_action(valhalla::Options::route, map, {"A", "E"}, "auto");
+}
+
+TEST(TileExtract, BuildTraffic) {
+  const std::string ascii_map = R"(
+    A------B------C
+           |
+           D------E
+  )";
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "motorway"}}},
+      {"BD", {{"highway", "primary"}}},
+      {"DE", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 10000, {4.0, 52.0});
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_traffic_extract");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+
+  // the traffic goes with the tiles of the tile extract
+  const auto extract = tile_dir + "/tiles.tar";
+  const auto traffic = tile_dir + "/traffic.tar";
+  const auto count = TileExtract::Build(tile_dir, extract, 1);
+  auto config = map.config;
+  config.put("mjolnir.tile_extract", extract);
+  EXPECT_EQ(TileExtract::BuildTraffic(config.get_child("mjolnir"), traffic), count);
+
+  // every edge of every tile has traffic that is not known yet
+  config.put("mjolnir.traffic_extract", traffic);
+  baldr::GraphReader reader(config.get_child("mjolnir"), nullptr, false);
+  ASSERT_TRUE(reader.HasLiveTraffic());
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    ASSERT_TRUE(tile) << tile_id;
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      EXPECT_FALSE(tile->trafficspeed(tile->directededge(i)).speed_valid()) << tile_id;
+    }
+  }
+
+  // live speeds written into the mapped extract are seen right away
+  const auto edge = std::get<0>(gurka::findEdgeByNodes(reader, layout, "B", "D"));
+  ASSERT_TRUE(reader.UpdateLiveTraffic(edge.Tile_Base(),
+                                       {{edge.id(), baldr::TrafficSpeed{20, 20, 0, 0, 255, 0, 1,
+                                                                        0, 0, false}}},
+                                       1234));
+  auto tile = reader.GetGraphTile(edge);
+  EXPECT_EQ(tile->trafficspeed(tile->directededge(edge)).get_overall_speed(), 40);
+  EXPECT_EQ(reader.GetTrafficLastUpdate(), 1234);
+}
@@ -0,0 +1,59 @@
+#include "gurka.h"
+#include "baldr/tileaccesslog.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+TEST(TileWarmup, loads_most_accessed_tiles) {
+  const std::string ascii_map = R"(
+      A----B----C
+      |         |
+      D----E----F
+    )";
+
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "motorway"}}},
+      {"DEF", {{"highway", "residential"}}},
+      {"AD", {{"highway", "primary"}}},
+      {"CF", {{"highway", "residential"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/tile_warmup");
+  const auto log_file = map.config.get<std::string>("mjolnir.tile_dir") + "/tile_access.log";
+
+  // ask for every tile a few times so the log has them
+  std::vector<GraphId> tile_ids;
+  {
+    auto config = map.config.get_child("mjolnir");
+    config.put("tile_access_log", log_file);
+    GraphReader reader(config);
+    for (const auto& tile_id : reader.GetTileSet()) {
+      tile_ids.push_back(tile_id);
+    }
+    for (size_t i = 0; i < 4096; ++i) {
+      reader.GetGraphTile(tile_ids[i % tile_ids.size()]);
+    }
+  }
+  TileAccessLog::get(log_file, std::chrono::seconds(300))->Write();
+  ASSERT_EQ(TileAccessLog::Read(log_file).size(), tile_ids.size());
+
+  // a new reader has them cached before it is asked for any
+  auto config = map.config.get_child("mjolnir");
+  config.put("tile_access_log", log_file);
+  config.put("tile_warmup_size", 64 * 1024 * 1024);
+  config.put("tile_warmup_threads", 2);
+  GraphReader reader(config);
+  EXPECT_EQ(reader.GetWarmupStats().tiles, tile_ids.size());
+  EXPECT_GT(reader.GetWarmupStats().bytes, 0);
+  for (const auto& tile_id : tile_ids) {
+    EXPECT_NE(reader.GetGraphTile(tile_id), nullptr);
+  }
+  EXPECT_EQ(reader.GetTileCounts().cache_misses, 0);
+
+  // no warmup without a budget
+  config.put("tile_warmup_size", 0);
+  GraphReader cold(config);
+  EXPECT_EQ(cold.GetWarmupStats().tiles, 0);
+}
@@ -0,0 +1,110 @@
+#include "gurka.h"
+#include "sif/osrm_car_duration.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+size_t turn_classes_size(GraphReader& reader) {
+  size_t size = 0;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (tile) {
+      size += tile->decoded_size();
+    }
+  }
+  return size;
+}
+
+} // namespace
+
+TEST(TurnClasses, same_costs_as_working_the_turns_out) {
+  const std::string ascii_map = R"(
+          M
+          |
+      A---B---C---D
+      |   |    \  |
+      E---F-----G-H
+      |  /    |   |
+      I-J-----K---L
+    )";
+
+  const gurka::ways ways = {
+      {"ABCD", {{"highway", "primary"}}},
+      {"EFGH", {{"highway", "secondary"}}},
+      {"IJKL", {{"highway", "residential"}}},
+      {"AEI", {{"highway", "tertiary"}}},
+      {"MBF", {{"highway", "residential"}}},
+      {"FJ", {{"highway", "motorway_link"}, {"oneway", "yes"}}},
+      {"CG", {{"highway", "service"}}},
+      {"GK", {{"highway", "unclassified"}}},
+      {"DHL", {{"highway", "tertiary"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {{"F", {{"highway", "traffic_signals"}}}}, {},
+                               "test/data/turn_classes");
+
+  const std::vector<std::vector<std::string>> routes = {{"A", "L"}, {"M", "K"}, {"I", "D"},
+                                                        {"L", "A"}, {"E", "C"}, {"K", "M"}};
+  const std::vector<std::string> costings = {"auto", "truck", "taxi"};
+
+  // the routes with every turn worked out on its own, before tiles keep any classes
+  std::vector<valhalla::Api> expected;
+  for (const auto& costing : costings) {
+    for (const auto& route : routes) {
+      expected.push_back(gurka::do_action(Options::route, map, route, costing));
+    }
+  }
+  auto expected_matrix =
+      gurka::do_action(Options::sources_to_targets, map, {"A", "M", "I"}, {"L", "K", "D"}, "auto");
+
+  auto config = map.config.get_child("mjolnir");
+  config.put("turn_classes", true);
+  auto reader = std::make_shared<GraphReader>(config);
+  const auto size_before = turn_classes_size(*reader);
+
+  size_t i = 0;
+  for (const auto& costing : costings) {
+    for (const auto& route : routes) {
+      auto result = gurka::do_action(Options::route, map, route, costing, {}, reader);
+      const auto& summary = result.directions().routes(0).legs(0).summary();
+      const auto& expected_summary = expected[i++].directions().routes(0).legs(0).summary();
+      EXPECT_EQ(summary.time(), expected_summary.time());
+      EXPECT_EQ(summary.length(), expected_summary.length());
+    }
+  }
+  auto matrix = gurka::do_action(Options::sources_to_targets, map, {"A", "M", "I"},
+                                 {"L", "K", "D"}, "auto", {}, reader);
+  ASSERT_EQ(matrix.matrix().times_size(), expected_matrix.matrix().times_size());
+  for (int j = 0; j < matrix.matrix().times_size(); ++j) {
+    EXPECT_EQ(matrix.matrix().times(j), expected_matrix.matrix().times(j));
+  }
+
+  // the classes of all edges of the tiles the routes went through were filled
+  EXPECT_GT(turn_classes_size(*reader), size_before);
+
+  // and every class gives the turn duration and turn cost the edges and nodes give
+  for (const auto& tile_id : reader->GetTileSet()) {
+    auto tile = reader->GetGraphTile(tile_id);
+    for (uint32_t n = 0; n < tile->header()->nodecount(); ++n) {
+      const auto* node = tile->node(n);
+      for (uint32_t e = 0; e < node->edge_count(); ++e) {
+        const auto* edge = tile->directededge(node->edge_index() + e);
+        const auto* classes = tile->turn_classes(edge);
+        ASSERT_NE(classes, nullptr);
+        for (uint32_t idx = 0; idx < node->local_edge_count(); ++idx) {
+          EXPECT_EQ(OSRMCarTurnDuration(classes[idx], node), OSRMCarTurnDuration(edge, node, idx));
+          if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+            EXPECT_EQ(classes[idx].cost_index(), kCrossingTurnCostIndex);
+          } else {
+            EXPECT_EQ(classes[idx].cost_index() % kLeftSideTurnCostIndex,
+                      static_cast<uint32_t>(edge->turntype(idx)));
+          }
+        }
+      }
+    }
+  }
+}
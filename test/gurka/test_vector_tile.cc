@@ -0,0 +1,170 @@
+#include "gurka.h"
+#include "loki/vector_tile_cache.h"
+#include "midgard/constants.h"
+#include "proto/vector_tile.pb.h"
+#include "tyr/actor.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <thread>
+
+using namespace valhalla;
+
+namespace {
+
+// the tile of the zoom level a position is in
+std::string tile_request(const midgard::PointLL& ll, uint32_t z) {
+  const double n = std::ldexp(1.0, z);
+  const double lat_rad = ll.lat() * midgard::kRadPerDegD;
+  const auto x = static_cast<uint32_t>((ll.lng() + 180.0) / 360.0 * n);
+  const auto y = static_cast<uint32_t>(
+      (1.0 - std::log(std::tan(lat_rad) + 1.0 / std::cos(lat_rad)) / midgard::kPiD) / 2.0 * n);
+  return "{\"z\":" + std::to_string(z) + ",\"x\":" + std::to_string(x) +
+         ",\"y\":" + std::to_string(y) + "}";
+}
+
+// the tags of the features keyed by their road class
+std::map<std::string, std::map<std::string, std::string>> features(const std::string& bytes) {
+  vector_tile::Tile tile;
+  EXPECT_TRUE(tile.ParseFromString(bytes));
+  EXPECT_EQ(tile.layers_size(), 1);
+  std::map<std::string, std::map<std::string, std::string>> result;
+  if (tile.layers_size() != 1) {
+    return result;
+  }
+  const auto& layer = tile.layers(0);
+  EXPECT_EQ(layer.name(), "edges");
+  EXPECT_EQ(layer.extent(), 4096);
+  for (const auto& feature : layer.features()) {
+    // a move to and a line to at least one more point
+    EXPECT_GE(feature.geometry_size(), 6);
+    std::map<std::string, std::string> tags;
+    for (int i = 0; i + 1 < feature.tags_size(); i += 2) {
+      const auto& value = layer.values(feature.tags(i + 1));
+      tags[layer.keys(feature.tags(i))] =
+          value.has_string_value() ? value.string_value()
+          : value.has_bool_value() ? std::to_string(value.bool_value())
+                                   : std::to_string(value.uint_value());
+    }
+    result[tags["road_class"]] = tags;
+  }
+  return result;
+}
+
+int error_code(tyr::actor_t& actor, const std::string& request) {
+  try {
+    actor.tile(request);
+  } catch (const valhalla_exception_t& e) { return e.code; }
+  return 0;
+}
+
+} // namespace
+
+class VectorTile : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A----B----C
+           |
+           D
+    )";
+    const gurka::ways ways = {
+        {"AB", {{"highway", "motorway"}, {"oneway", "yes"}, {"maxspeed", "100"}}},
+        {"BC", {{"highway", "primary"}, {"maxspeed", "60"}}},
+        {"BD", {{"highway", "residential"}}},
+    };
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100, {5.1, 52.1});
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_vector_tile",
+                            {{"loki.vector_tile_cache.size", "1000000"}});
+  }
+};
+
+gurka::map VectorTile::map = {};
+
+TEST_F(VectorTile, RoadsByZoom) {
+  tyr::actor_t actor(map.config, true);
+
+  // every road in the tiles of the local zoom levels
+  auto local = features(actor.tile(tile_request(map.nodes["B"], 14)));
+  ASSERT_EQ(local.size(), 3);
+  EXPECT_EQ(local["motorway"]["use"], "road");
+  EXPECT_EQ(local["motorway"]["speed"], "100");
+  EXPECT_NE(local["motorway"]["access"], local["motorway"]["reverse_access"]);
+  EXPECT_EQ(local["primary"]["speed"], "60");
+  EXPECT_EQ(local["primary"]["reverse_speed"], "60");
+  EXPECT_NE(local["residential"]["access"], "0");
+  EXPECT_EQ(local["residential"]["access"], local["residential"]["reverse_access"]);
+
+  // no local roads in the arterial ones
+  auto arterial = features(actor.tile(tile_request(map.nodes["B"], 11)));
+  ASSERT_EQ(arterial.size(), 2);
+  EXPECT_EQ(arterial.count("residential"), 0);
+
+  // and just the highways below them
+  auto highway = features(actor.tile(tile_request(map.nodes["B"], 8)));
+  ASSERT_EQ(highway.size(), 1);
+  EXPECT_EQ(highway.count("motorway"), 1);
+
+  // nothing in a tile far away
+  EXPECT_TRUE(features(actor.tile(tile_request({-70.0, -40.0}, 14))).empty());
+}
+
+TEST_F(VectorTile, SameTileTwice) {
+  tyr::actor_t actor(map.config, true);
+  const auto request = tile_request(map.nodes["C"], 16);
+  const auto first = actor.tile(request);
+  EXPECT_EQ(actor.tile(request), first);
+  EXPECT_FALSE(features(first).empty());
+}
+
+TEST_F(VectorTile, InvalidTiles) {
+  tyr::actor_t actor(map.config, true);
+  EXPECT_EQ(error_code(actor, "{}"), 174);
+  EXPECT_EQ(error_code(actor, R"({"z":14,"x":16384,"y":0})"), 174);
+  EXPECT_EQ(error_code(actor, R"({"z":14,"x":0,"y":16384})"), 174);
+  EXPECT_EQ(error_code(actor, R"({"z":21,"x":0,"y":0})"), 174);
+  EXPECT_EQ(error_code(actor, R"({"z":5,"x":0,"y":0})"), 175);
+}
+
+TEST(VectorTileCache, LeastRecentlyUsed) {
+  boost::property_tree::ptree config;
+  config.put("size", 10);
+  config.put("max_age", 60);
+  loki::VectorTileCache cache(config);
+
+  cache.Insert(14, 1, 2, "abcd");
+  cache.Insert(14, 2, 1, "efgh");
+  ASSERT_NE(cache.Find(14, 1, 2), nullptr);
+  EXPECT_EQ(*cache.Find(14, 1, 2), "abcd");
+
+  // the other one was used less recently
+  cache.Insert(15, 1, 2, "ijkl");
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.Find(14, 2, 1), nullptr);
+  EXPECT_NE(cache.Find(15, 1, 2), nullptr);
+  EXPECT_EQ(cache.stats().evictions, 1);
+
+  // too big for the whole cache
+  cache.Insert(16, 0, 0, "abcdefghijk");
+  EXPECT_EQ(cache.Find(16, 0, 0), nullptr);
+  EXPECT_EQ(cache.size(), 2);
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.Find(14, 1, 2), nullptr);
+}
+
+TEST(VectorTileCache, TooOld) {
+  boost::property_tree::ptree config;
+  config.put("size", 10);
+  config.put("max_age", 0);
+  loki::VectorTileCache cache(config);
+  cache.Insert(14, 1, 2, "abcd");
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(cache.Find(14, 1, 2), nullptr);
+  EXPECT_EQ(cache.size(), 0);
+}
@@ -0,0 +1,124 @@
+#include "sif/hierarchylimits.h"
+#include "filesystem.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::sif;
+using valhalla::midgard::PointLL;
+
+namespace {
+
+const std::string kTableDir = "test/data/hierarchy_limits";
+
+std::string write_table(const std::string& name, const std::string& json) {
+  filesystem::create_directories(kTableDir);
+  const auto file = kTableDir + "/" + name;
+  std::ofstream(file) << json;
+  return file;
+}
+
+std::vector<HierarchyLimits> defaults() {
+  std::vector<HierarchyLimits> limits;
+  for (uint32_t level = 0; level < 8; ++level) {
+    limits.emplace_back(level);
+  }
+  return limits;
+}
+
+const std::string kTable = R"({"regions": [
+  {"name": "utrecht", "bbox": [5.0, 52.0, 5.2, 52.2],
+   "costings": {"auto": [{"level": 1, "max_up_transitions": 50, "expansion_within_dist": 2000}]}},
+  {"name": "netherlands", "bbox": [3.2, 50.7, 7.3, 53.6],
+   "costings": {"auto": [{"level": 1, "max_up_transitions": 200, "expansion_within_dist": 40000},
+                         {"level": 2, "max_up_transitions": 80, "expansion_within_dist": 4000}],
+                "truck": [{"level": 2, "max_up_transitions": 10, "expansion_within_dist": 0}]}}
+]})";
+
+TEST(HierarchyLimitsTable, FirstRegionWithBothLocations) {
+  HierarchyLimitsTable table(write_table("table.json", kTable));
+  ASSERT_EQ(table.regions().size(), 2u);
+
+  // both in utrecht
+  auto limits = defaults();
+  auto* region = table.Apply("auto", {5.1, 52.1}, {5.12, 52.08}, limits);
+  ASSERT_NE(region, nullptr);
+  EXPECT_EQ(region->name, "utrecht");
+  EXPECT_EQ(limits[1].max_up_transitions, 50u);
+  EXPECT_EQ(limits[1].expansion_within_dist, 2000.f);
+  EXPECT_EQ(limits[2].max_up_transitions, kDefaultMaxUpTransitions[2]);
+
+  // the destination leaves utrecht
+  limits = defaults();
+  region = table.Apply("auto", {5.1, 52.1}, {4.9, 52.37}, limits);
+  ASSERT_NE(region, nullptr);
+  EXPECT_EQ(region->name, "netherlands");
+  EXPECT_EQ(limits[1].max_up_transitions, 200u);
+  EXPECT_EQ(limits[2].max_up_transitions, 80u);
+  EXPECT_EQ(limits[2].expansion_within_dist, 4000.f);
+}
+
+TEST(HierarchyLimitsTable, KeepsDefaultsElsewhere) {
+  HierarchyLimitsTable table(write_table("table.json", kTable));
+
+  // outside of every region
+  auto limits = defaults();
+  EXPECT_EQ(table.Apply("auto", {13.4, 52.5}, {13.3, 52.4}, limits), nullptr);
+  EXPECT_EQ(limits[1].max_up_transitions, kDefaultMaxUpTransitions[1]);
+
+  // utrecht has no truck limits but the netherlands do
+  limits = defaults();
+  auto* region = table.Apply("truck", {5.1, 52.1}, {5.12, 52.08}, limits);
+  ASSERT_NE(region, nullptr);
+  EXPECT_EQ(region->name, "netherlands");
+  EXPECT_EQ(limits[1].max_up_transitions, kDefaultMaxUpTransitions[1]);
+  EXPECT_EQ(limits[2].max_up_transitions, 10u);
+
+  // no costing has limits for bicycle
+  limits = defaults();
+  EXPECT_EQ(table.Apply("bicycle", {5.1, 52.1}, {5.12, 52.08}, limits), nullptr);
+}
+
+TEST(HierarchyLimitsTable, KeepsUnlimitedLevels) {
+  HierarchyLimitsTable table(write_table("table.json", kTable));
+  auto limits = defaults();
+  for (auto& level : limits) {
+    level.max_up_transitions = kUnlimitedTransitions;
+  }
+  EXPECT_NE(table.Apply("auto", {5.1, 52.1}, {5.12, 52.08}, limits), nullptr);
+  EXPECT_EQ(limits[1].max_up_transitions, kUnlimitedTransitions);
+}
+
+TEST(HierarchyLimitsTable, Invalid) {
+  EXPECT_THROW(HierarchyLimitsTable(kTableDir + "/missing.json"), std::exception);
+  EXPECT_THROW(HierarchyLimitsTable(write_table("bbox.json",
+                                                R"({"regions": [{"name": "a", "bbox": [1, 2],
+                                                    "costings": {}}]})")),
+               std::exception);
+  EXPECT_THROW(HierarchyLimitsTable(write_table("level.json", R"({"regions": [{"name": "a",
+    "bbox": [0, 0, 1, 1], "costings": {"auto": [{"level": 9, "max_up_transitions": 1,
+    "expansion_within_dist": 1}]}}]})")),
+               std::exception);
+
+  // the service goes on without it
+  EXPECT_EQ(HierarchyLimitsTable::get(kTableDir + "/missing.json"), nullptr);
+  EXPECT_EQ(HierarchyLimitsTable::get(""), nullptr);
+}
+
+TEST(HierarchyLimitsTable, SharedPerFile) {
+  const auto file = write_table("shared.json", kTable);
+  auto a = HierarchyLimitsTable::get(file);
+  auto b = HierarchyLimitsTable::get(file);
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(a.get(), b.get());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -27,8 +27,10 @@ std::string get_tile_url() {
   return oss.str();
 }
 
-boost::property_tree::ptree
-make_conf(const std::string& tile_dir, bool tile_url_gz, size_t curler_count) {
+boost::property_tree::ptree make_conf(const std::string& tile_dir,
+                                      bool tile_url_gz,
+                                      size_t curler_count,
+                                      bool tile_url_neighbors = false) {
   auto conf = test::make_config(tile_dir, {{"mjolnir.user_agent", "MapboxNavigationNative"}});
 
   conf.put("mjolnir.tile_url", get_tile_url());
@@ -41,12 +43,13 @@ make_conf(const std::string& tile_dir, bool tile_url_gz, size_t curler_count) {
   }
 
   conf.put("mjolnir.tile_url_gz", tile_url_gz);
+  conf.put("mjolnir.tile_url_neighbors", tile_url_neighbors);
   conf.put("loki.use_connectivity", false);
   return conf;
 }
 
-void test_route(const std::string& tile_dir, bool tile_url_gz) {
-  auto conf = make_conf(tile_dir, tile_url_gz, 1);
+void test_route(const std::string& tile_dir, bool tile_url_gz, bool tile_url_neighbors = false) {
+  auto conf = make_conf(tile_dir, tile_url_gz, 1, tile_url_neighbors);
   tyr::actor_t actor(conf);
 
   auto route_json = actor.route(R"({"locations":[{"lat":52.09620,"lon": 5.11909,"type":"break"},
@@ -86,6 +89,14 @@ TEST_F(HttpTilesWithCache, test_cache_gz) {
   test_route("url_tile_cache", true);
 }
 
+TEST_F(HttpTilesWithCache, test_cache_neighbors) {
+  test_route("url_tile_cache", false, true);
+}
+
+TEST(HttpTiles, test_no_cache_neighbors) {
+  test_route("", true, true);
+}
+
 struct TestTileDownloadData {
   TestTileDownloadData() {
     test_tile_ids = {{3196, 0, 0},
@@ -221,6 +232,49 @@ TEST(HttpTiles, test_graphreader_multiple_threads) {
   test_graphreader_tile_download(8, 2, 4);
 }
 
+TEST(HttpTiles, test_batch_download) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  const auto non_existent_tile_id = params.get_nonexistent_tile_id();
+
+  // every tile twice, the second request of each waits for the first
+  std::vector<std::string> tile_uris;
+  std::vector<GraphId> expected_tile_ids;
+  for (size_t i = 0; i < params.test_tile_names.size() * 2; ++i) {
+    auto test_tile_index = i % params.test_tile_names.size();
+    tile_uris.push_back(params.tile_url_base + params.test_tile_names[test_tile_index] +
+                        params.request_params);
+    expected_tile_ids.push_back(params.test_tile_ids[test_tile_index]);
+  }
+
+  curl_tile_getter_t tile_getter(2, "", params.is_gzipped_tile);
+  auto results = tile_getter.get_batch(tile_uris);
+  ASSERT_EQ(results.size(), tile_uris.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i].status_ == tile_getter_t::status_code_t::SUCCESS) {
+      auto tile = GraphTile::Create(GraphId(), std::move(results[i].bytes_));
+      ASSERT_TRUE(tile);
+      EXPECT_EQ(tile->id(), expected_tile_ids[i]);
+    } else {
+      EXPECT_EQ(expected_tile_ids[i], non_existent_tile_id);
+    }
+  }
+
+  // the same through the graph tile which leaves out the tiles it could not get
+  auto tiles = GraphTile::CacheTileURLs(params.full_tile_url_pattern, params.test_tile_ids,
+                                        &tile_getter, "");
+  ASSERT_EQ(tiles.size(), params.test_tile_ids.size());
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    if (params.test_tile_ids[i] == non_existent_tile_id) {
+      EXPECT_FALSE(tiles[i]);
+    } else {
+      ASSERT_TRUE(tiles[i]);
+      EXPECT_EQ(tiles[i]->id(), params.test_tile_ids[i]);
+    }
+  }
+}
+
 TEST(HttpTiles, test_interrupt) {
   using namespace baldr;
 
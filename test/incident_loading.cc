@@ -21,6 +21,13 @@ protected:
   }
 };
 
+// the flat tile the watcher loaded is what the protobuf tile lays out to
+bool flat_equals(const IncidentsTile& expected, const baldr::IncidentTile& tile) {
+  const auto bytes = baldr::IncidentTile::Serialize(expected);
+  return bytes.size() == tile.memory().size &&
+         std::equal(bytes.begin(), bytes.end(), tile.memory().data);
+}
+
 struct testable_singleton : public incident_singleton_t {
   // make an incident singleton and inject a watch function that either passes or fails initialization
   testable_singleton(const boost::property_tree::ptree& config, bool initialize)
@@ -36,6 +43,7 @@ struct testable_singleton : public incident_singleton_t {
   }
 
   // this stuff is all static and protected here we make it public so we can test it
+  using incident_singleton_t::publish;
   using incident_singleton_t::read_tile;
   using incident_singleton_t::state_t;
   using incident_singleton_t::update_tile;
@@ -74,6 +82,76 @@ TEST_F(incident_loading, read_tile) {
     f << t.SerializeAsString();
   }
   ASSERT_TRUE(testable_singleton::read_tile(filename)) << " should return valid tile";
+
+  // out of order locations get sorted by edge
+  for (uint32_t edge_index : {7, 3, 3, 5}) {
+    loc = t.mutable_locations()->Add();
+    loc->set_edge_index(edge_index);
+    loc->set_metadata_index(edge_index);
+  }
+  {
+    std::ofstream f(filename, std::ofstream::out | std::ofstream::trunc);
+    f << t.SerializeAsString();
+  }
+  auto tile = testable_singleton::read_tile(filename);
+  ASSERT_TRUE(tile) << " should return valid tile";
+  std::vector<uint32_t> edges;
+  for (const auto& location : tile->locations())
+    edges.push_back(location.edge_index);
+  EXPECT_EQ(edges, (std::vector<uint32_t>{0, 3, 3, 5, 7})) << " locations should be sorted by edge";
+}
+
+TEST_F(incident_loading, flat_tile) {
+  IncidentsTile t;
+  for (uint32_t edge_index : {9, 2, 4}) {
+    auto* loc = t.mutable_locations()->Add();
+    loc->set_edge_index(edge_index);
+    loc->set_start_offset(.25f);
+    loc->set_end_offset(.75f);
+    loc->set_metadata_index(edge_index == 2 ? 1 : 0);
+  }
+  for (uint64_t id : {13, 17}) {
+    auto* meta = t.mutable_metadata()->Add();
+    meta->set_id(id);
+    meta->set_description("incident " + std::to_string(id));
+    meta->set_type(IncidentsTile::Metadata::CONSTRUCTION);
+  }
+
+  // a flat tile is read as it was written, its locations sorted by edge
+  std::string filename = scratch_dir + "flat";
+  {
+    std::ofstream f(filename, std::ofstream::out | std::ofstream::binary);
+    f << baldr::IncidentTile::Serialize(t);
+  }
+  auto tile = testable_singleton::read_tile(filename);
+  ASSERT_TRUE(tile) << " should return valid tile";
+  EXPECT_TRUE(flat_equals(t, *tile));
+  ASSERT_EQ(tile->location_count(), 3);
+  EXPECT_EQ(tile->metadata_count(), 2);
+  const auto& location = tile->locations()[0];
+  EXPECT_EQ(location.edge_index, 2);
+  EXPECT_EQ(location.start_offset, .25f);
+  EXPECT_EQ(location.end_offset, .75f);
+
+  // the metadata is only parsed when asked for
+  EXPECT_EQ(tile->metadata_id(location), 17);
+  IncidentsTile::Metadata meta;
+  tile->metadata(location, meta);
+  EXPECT_TRUE(test::pbf_equals(meta, t.metadata(1)));
+  baldr::IncidentLocation past_the_end{2, 0, 1, 2};
+  EXPECT_THROW(tile->metadata_id(past_the_end), std::runtime_error);
+  EXPECT_THROW(tile->metadata(past_the_end, meta), std::runtime_error);
+
+  // a truncated tile or one of another version is not used
+  auto bytes = baldr::IncidentTile::Serialize(t);
+  EXPECT_THROW(baldr::IncidentTile(bytes.substr(0, bytes.size() - 1)), std::runtime_error);
+  reinterpret_cast<baldr::IncidentTileHeader*>(&bytes[0])->version =
+      baldr::INCIDENT_TILE_VERSION + 1;
+  {
+    std::ofstream f(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    f << bytes;
+  }
+  EXPECT_FALSE(testable_singleton::read_tile(filename)) << " should not read another version";
 }
 
 TEST_F(incident_loading, update_tile) {
@@ -85,7 +163,7 @@ TEST_F(incident_loading, update_tile) {
   ASSERT_TRUE(state->cache.find(baldr::GraphId(0))->second == nullptr) << " tile should be null";
 
   // slot exists already
-  std::shared_ptr<const IncidentsTile> tile{new IncidentsTile()};
+  auto tile = std::make_shared<const baldr::IncidentTile>(IncidentsTile{});
   ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(0), std::move(tile)))
       << " unable to update existing tile";
   ASSERT_TRUE(state->cache.count(baldr::GraphId(0))) << " cannot find updated tile in cache";
@@ -105,6 +183,27 @@ TEST_F(incident_loading, update_tile) {
   ASSERT_TRUE(state->cache.find(baldr::GraphId(0))->second == nullptr) << " tile should be null";
 }
 
+TEST_F(incident_loading, publish) {
+  std::shared_ptr<testable_singleton::state_t> state{new testable_singleton::state_t{}};
+  auto tile = std::make_shared<const baldr::IncidentTile>(IncidentsTile{});
+  ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(0), {}));
+  ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(1), std::move(tile)));
+  ASSERT_FALSE(state->published) << " nothing should be visible before publishing";
+
+  // only tiles with incidents are published
+  testable_singleton::publish(state);
+  auto published = state->published;
+  ASSERT_TRUE(published);
+  EXPECT_EQ(published->size(), 1);
+  EXPECT_EQ(published->count(baldr::GraphId(1)), 1);
+
+  // readers holding the old copy are unaffected by the next publish
+  ASSERT_TRUE(testable_singleton::update_tile(state, baldr::GraphId(1), {}));
+  testable_singleton::publish(state);
+  EXPECT_EQ(published->size(), 1);
+  EXPECT_TRUE(state->published->empty());
+}
+
 TEST_F(incident_loading, disabled) {
   // check that it bails early
   boost::property_tree::ptree config;
@@ -186,7 +285,7 @@ TEST_F(incident_loading, watch) {
           EXPECT_EQ(state->cache.size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
           EXPECT_EQ(state->cache.count(snake_eyes), 1) << " there should be one tile in here now";
           EXPECT_TRUE(state->cache[snake_eyes]) << " the tile pointer should be non null";
-          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *state->cache[snake_eyes]))
+          EXPECT_TRUE(flat_equals(snake_eyes_tile, *state->cache[snake_eyes]))
               << " the tile should be equal to the one written";
           // update it
           auto* loc = snake_eyes_tile.mutable_locations()->Add();
@@ -215,7 +314,7 @@ TEST_F(incident_loading, watch) {
           EXPECT_EQ(state->cache.size(), tileset.empty() ? 1 : 2) << " wrong number of cache entries";
           EXPECT_EQ(state->cache.count(snake_eyes), 1) << " should still be in there";
           EXPECT_TRUE(state->cache[snake_eyes]) << " should still be not null";
-          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *state->cache[snake_eyes]))
+          EXPECT_TRUE(flat_equals(snake_eyes_tile, *state->cache[snake_eyes]))
               << " should have all the changes that were made";
           // remove one
           EXPECT_TRUE(filesystem::remove(snake_eyes_name)) << " couldnt remove file";
@@ -262,11 +361,11 @@ TEST_F(incident_loading, watch) {
           EXPECT_EQ(state->cache.size(), 2) << " wrong number of cache entries";
           EXPECT_EQ(state->cache.count(snake_eyes), 1) << " both should be there";
           EXPECT_TRUE(state->cache[snake_eyes]) << " should be not null";
-          EXPECT_TRUE(test::pbf_equals(snake_eyes_tile, *state->cache[snake_eyes]))
+          EXPECT_TRUE(flat_equals(snake_eyes_tile, *state->cache[snake_eyes]))
               << " should be equivalent";
           EXPECT_EQ(state->cache.count(box_cars), 1) << " both should be there";
           EXPECT_TRUE(state->cache[box_cars]) << " should be not null";
-          EXPECT_TRUE(test::pbf_equals(box_cars_tile, *state->cache[box_cars]))
+          EXPECT_TRUE(flat_equals(box_cars_tile, *state->cache[box_cars]))
               << " should be equivalent";
           // remove one
           EXPECT_TRUE(filesystem::remove(snake_eyes_name)) << " couldnt remove file";
@@ -281,7 +380,7 @@ TEST_F(incident_loading, watch) {
           EXPECT_FALSE(state->cache[snake_eyes]) << " should be null now";
           EXPECT_EQ(state->cache.count(box_cars), 1) << " should also be this one";
           EXPECT_TRUE(state->cache[box_cars]) << " should be not null";
-          EXPECT_TRUE(test::pbf_equals(box_cars_tile, *state->cache[box_cars]))
+          EXPECT_TRUE(flat_equals(box_cars_tile, *state->cache[box_cars]))
               << " should be equivalent";
           // remove the dir and quit before next update
           filesystem::remove_all(scratch_dir);
@@ -300,7 +399,7 @@ TEST_F(incident_loading, watch) {
     EXPECT_FALSE(state->cache[snake_eyes]) << " should be null now";
     EXPECT_EQ(state->cache.count(box_cars), 1) << " should also be this one";
     EXPECT_TRUE(state->cache[box_cars]) << " should be not null";
-    EXPECT_TRUE(test::pbf_equals(box_cars_tile, *state->cache[box_cars])) << " should be equivalent";
+    EXPECT_TRUE(flat_equals(box_cars_tile, *state->cache[box_cars])) << " should be equivalent";
   }
 }
 
@@ -343,7 +442,7 @@ TEST_F(incident_loading, get) {
   config.put("incident_dir", scratch_dir);
   auto got = incident_singleton_t::get(box_cars, config, {});
   ASSERT_TRUE(got);
-  ASSERT_TRUE(test::pbf_equals(box_cars_tile, *got));
+  ASSERT_TRUE(flat_equals(box_cars_tile, *got));
 
   // get the one that isnt there
   got = incident_singleton_t::get({});
@@ -1,11 +1,15 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include "baldr/compression_utils.h"
 #include "baldr/graphreader.h"
 #include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
 #include "thor/worker.h"
+#include "tyr/serializers.h"
 
 #include "gurka/gurka.h"
 #include "test.h"
@@ -231,6 +235,147 @@ TEST(Isochrones, LongEdge) {
   EXPECT_EQ(within(point_type(interpolated.x(), interpolated.y()), polygon), true);
 }
 
+std::string isochrone_json(loki_worker_t& loki_worker,
+                           thor_worker_t& thor_worker,
+                           const std::string& test_request) {
+  Api request;
+  ParseApi(test_request, Options::isochrone, request);
+  loki_worker.isochrones(request);
+  auto response_json = thor_worker.isochrones(request);
+  loki_worker.cleanup();
+  thor_worker.cleanup();
+  return response_json;
+}
+
+TEST(Isochrones, Cache) {
+  auto cache_config = config;
+  cache_config.put("thor.isochrone_cache.size", 2);
+  loki_worker_t loki_worker(cache_config);
+  thor_worker_t thor_worker(cache_config);
+
+  // the cached grid gives the same contours as the one it was expanded for
+  const auto request =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":9.1}],"polygons":false,"generalize":55})";
+  const auto first = isochrone_json(loki_worker, thor_worker, request);
+  EXPECT_EQ(isochrone_json(loki_worker, thor_worker, request), first);
+
+  // re-contouring the same grid with other parameters still works
+  const auto denoised =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":9.1}],"polygons":true,"denoise":0.5})";
+  EXPECT_FALSE(polygon_from_geojson(isochrone_json(loki_worker, thor_worker, denoised)).empty());
+
+  // extending a 5 minute grid to 9 minutes gives about what expanding 9 minutes right away does
+  loki_worker_t extended_loki(cache_config);
+  thor_worker_t extended_thor(cache_config);
+  const auto smaller =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":5}],"polygons":true})";
+  const auto larger =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":9}],"polygons":true})";
+  auto small_ring = polygon_from_geojson(isochrone_json(extended_loki, extended_thor, smaller));
+  auto extended_ring = polygon_from_geojson(isochrone_json(extended_loki, extended_thor, larger));
+
+  loki_worker_t fresh_loki(config);
+  thor_worker_t fresh_thor(config);
+  auto fresh_ring = polygon_from_geojson(isochrone_json(fresh_loki, fresh_thor, larger));
+
+  ASSERT_FALSE(small_ring.empty());
+  ASSERT_FALSE(extended_ring.empty());
+  ASSERT_FALSE(fresh_ring.empty());
+  const auto small_area = std::abs(polygon_area(small_ring));
+  const auto extended_area = std::abs(polygon_area(extended_ring));
+  const auto fresh_area = std::abs(polygon_area(fresh_ring));
+  EXPECT_GT(extended_area, small_area);
+  EXPECT_NEAR(extended_area, fresh_area, fresh_area * 0.05);
+}
+
+TEST(Isochrones, Hierarchical) {
+  auto hierarchy_config = config;
+  hierarchy_config.put("thor.isochrone_hierarchy.local_reach", 2000);
+  hierarchy_config.put("thor.isochrone_hierarchy.arterial_reach", 5000);
+  loki_worker_t loki_worker(hierarchy_config);
+  thor_worker_t thor_worker(hierarchy_config);
+
+  // away from the location and the contour only the higher levels are expanded
+  const auto full =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":15}],"polygons":true,"verbose":true})";
+  const auto hierarchical =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":15}],"polygons":true,"verbose":true,"hierarchical":true})";
+  const auto full_json = isochrone_json(loki_worker, thor_worker, full);
+  const auto hierarchical_json = isochrone_json(loki_worker, thor_worker, hierarchical);
+
+  rapidjson::Document full_response, hierarchical_response;
+  full_response.Parse(full_json);
+  hierarchical_response.Parse(hierarchical_json);
+  const auto* full_settled = rp("/search_effort/0/settled").Get(full_response);
+  const auto* hierarchical_settled = rp("/search_effort/0/settled").Get(hierarchical_response);
+  ASSERT_TRUE(full_settled && hierarchical_settled);
+  EXPECT_LT(hierarchical_settled->GetUint64(), full_settled->GetUint64());
+
+  // while the local roads near the contour keep its outline about where it was
+  auto full_ring = polygon_from_geojson(full_json);
+  auto hierarchical_ring = polygon_from_geojson(hierarchical_json);
+  ASSERT_FALSE(full_ring.empty());
+  ASSERT_FALSE(hierarchical_ring.empty());
+  const auto full_area = std::abs(polygon_area(full_ring));
+  EXPECT_NEAR(std::abs(polygon_area(hierarchical_ring)), full_area, full_area * 0.1);
+}
+
+TEST(Isochrones, Raster) {
+  loki_worker_t loki_worker(config);
+  thor_worker_t thor_worker(config);
+  const auto request =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto","contours":[{"time":9}],"format":"raster"})";
+  const auto raster = isochrone_json(loki_worker, thor_worker, request);
+
+  // the header, this test assumes a little endian host
+  ASSERT_GT(raster.size(), 48);
+  EXPECT_EQ(raster.substr(0, 4), "VISO");
+  EXPECT_EQ(raster[4], 1);
+  ASSERT_EQ(raster[5], 1);
+  uint32_t width, height;
+  double west, south, cell_size;
+  float seconds_per_step;
+  std::memcpy(&width, &raster[8], sizeof(width));
+  std::memcpy(&height, &raster[12], sizeof(height));
+  std::memcpy(&west, &raster[16], sizeof(west));
+  std::memcpy(&south, &raster[24], sizeof(south));
+  std::memcpy(&cell_size, &raster[32], sizeof(cell_size));
+  std::memcpy(&seconds_per_step, &raster[44], sizeof(seconds_per_step));
+  ASSERT_GT(width, 0);
+  ASSERT_GT(height, 0);
+  EXPECT_EQ(raster[40], 0);
+  EXPECT_EQ(seconds_per_step, 1.f);
+
+  // the origin is within the cropped bounds
+  EXPECT_LE(west, 5.115321);
+  EXPECT_GE(west + width * cell_size, 5.115321);
+  EXPECT_LE(south, 52.078937);
+  EXPECT_GE(south + height * cell_size, 52.078937);
+
+  // the cells
+  std::string compressed = raster.substr(48);
+  auto src_func = [&compressed](z_stream& s) -> void {
+    s.next_in = static_cast<Byte*>(static_cast<void*>(&compressed[0]));
+    s.avail_in = static_cast<unsigned int>(compressed.size());
+  };
+  std::vector<uint16_t> cells(width * height + 1);
+  auto dst_func = [&cells](z_stream& s) -> int {
+    s.next_out = static_cast<Byte*>(static_cast<void*>(cells.data()));
+    s.avail_out = cells.size() * sizeof(uint16_t);
+    return Z_FINISH;
+  };
+  ASSERT_TRUE(baldr::inflate(src_func, dst_func));
+  cells.pop_back();
+
+  // the origin is reached right away and the corners of the bounds usually are not
+  const auto minmax = std::minmax_element(cells.begin(), cells.end());
+  EXPECT_LT(*minmax.first, 60);
+  EXPECT_EQ(*minmax.second, kRasterUnreached);
+  for (const auto cell : cells) {
+    EXPECT_TRUE(cell <= 9 * 60 || cell == kRasterUnreached);
+  }
+}
+
 class IsochroneTest : public thor::Isochrone {
 public:
   explicit IsochroneTest(const boost::property_tree::ptree& config = {}) : Isochrone(config) {
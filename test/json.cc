@@ -2,6 +2,10 @@
 #include "baldr/rapidjson_utils.h"
 
 #include <cstdint>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <vector>
 
 #include "test.h"
 
@@ -74,6 +78,73 @@ TEST(JSON, Serialize) {
   EXPECT_EQ(res, ans) << "Wrong json";
 }
 
+TEST(JSON, WriterFixedMatchesDom) {
+  using namespace valhalla::baldr;
+  const std::vector<std::pair<double, size_t>> values = {
+      {40.744377, 3}, {-73.990433, 6}, {0.1, 1}, {2.5, 0}, {-0.0004, 3}, {1e20, 3}, {12345.678, 1}};
+  for (const auto& value : values) {
+    std::stringstream dom;
+    dom << *json::array({json::fixed_t{value.first, value.second}});
+    rapidjson::writer_wrapper_t writer;
+    writer.start_array();
+    writer.fixed(value.first, value.second);
+    writer.end_array();
+    EXPECT_EQ(dom.str(), writer.get_buffer());
+  }
+
+  // reused for another document
+  rapidjson::writer_wrapper_t writer;
+  writer.start_object();
+  writer.fixed("a", 1.5, 3);
+  writer.raw("b", R"({"c":[1,2]})");
+  writer.end_object();
+  EXPECT_STREQ(writer.get_buffer(), R"({"a":1.500,"b":{"c":[1,2]}})");
+  writer.clear();
+  writer.start_array();
+  writer.fixed(std::numeric_limits<double>::infinity(), 2);
+  writer.end_array();
+  EXPECT_STREQ(writer.get_buffer(), R"(["inf"])");
+}
+
+TEST(JSON, WriterFlush) {
+  // a document handed on in pieces is the same document
+  rapidjson::writer_wrapper_t writer;
+  std::string pieces;
+  writer.start_object();
+  writer.start_array("rows");
+  for (uint64_t row = 0; row < 3; ++row) {
+    writer.start_array();
+    writer(row);
+    writer(row * 2);
+    writer.end_array();
+    pieces += writer.flush();
+    EXPECT_EQ(writer.size(), 0);
+  }
+  writer.end_array();
+  writer("units", "kilometers");
+  writer.end_object();
+  pieces += writer.flush();
+  EXPECT_EQ(pieces, R"({"rows":[[0,0],[1,2],[2,4]],"units":"kilometers"})");
+}
+
+TEST(JSON, FindValue) {
+  rapidjson::Document doc;
+  doc.Parse(R"({"a":1,"b":{"c":[4,5]},"d/e":2,"":3})");
+  ASSERT_FALSE(doc.HasParseError());
+
+  // single keys are looked up directly, anything else is still a pointer
+  EXPECT_EQ(rapidjson::get<int>(doc, "/a"), 1);
+  EXPECT_EQ(rapidjson::get<int>(doc, "/"), 3);
+  EXPECT_EQ(rapidjson::get<int>(doc, "/b/c/1"), 5);
+  EXPECT_EQ(rapidjson::get<int>(doc, "/d~1e"), 2);
+  EXPECT_FALSE(rapidjson::get_optional<int>(doc, "/x"));
+  EXPECT_FALSE(rapidjson::get_child_optional(doc, "/b/x"));
+
+  const auto& c = rapidjson::get_child(doc, "/b/c");
+  EXPECT_EQ(rapidjson::get<int>(c, "/0"), 4);
+  EXPECT_FALSE(rapidjson::get_optional<int>(c, "/2"));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
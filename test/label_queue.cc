@@ -0,0 +1,147 @@
+#include "baldr/label_queue.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct simple_label {
+  float c;
+  float sortcost() const {
+    return c;
+  }
+};
+
+const std::vector<QueueType> kTypes = {QueueType::kDoubleBucket, QueueType::kRadixHeap,
+                                       QueueType::kQuaternaryHeap};
+
+TEST(LabelQueue, ParseQueueType) {
+  EXPECT_EQ(ParseQueueType("double_bucket"), QueueType::kDoubleBucket);
+  EXPECT_EQ(ParseQueueType("radix_heap"), QueueType::kRadixHeap);
+  EXPECT_EQ(ParseQueueType("quaternary_heap"), QueueType::kQuaternaryHeap);
+  EXPECT_THROW(ParseQueueType("fibonacci_heap"), std::invalid_argument);
+}
+
+TEST(LabelQueue, AddRemove) {
+  const std::vector<float> costs = {67,  325, 25,  466,   1000, 100005,
+                                    758, 167, 258, 16442, 278,  111111000};
+  auto expected = costs;
+  std::sort(expected.begin(), expected.end());
+
+  for (auto type : kTypes) {
+    std::vector<simple_label> labels;
+    LabelQueue<simple_label> queue(type, 0, 10000, 1, &labels);
+    for (auto cost : costs) {
+      labels.push_back({cost});
+      queue.add(labels.size() - 1);
+    }
+    for (auto cost : expected) {
+      const auto label = queue.pop();
+      ASSERT_NE(label, kInvalidLabel);
+      EXPECT_EQ(labels[label].sortcost(), cost) << static_cast<int>(type);
+    }
+    EXPECT_EQ(queue.pop(), kInvalidLabel);
+
+    // the queue can be used again after a clear
+    queue.add(0);
+    queue.add(1);
+    queue.clear();
+    EXPECT_EQ(queue.pop(), kInvalidLabel);
+    queue.reuse(0, 10000, 1, &labels);
+    queue.add(2);
+    EXPECT_EQ(queue.pop(), 2);
+  }
+}
+
+TEST(LabelQueue, Underflow) {
+  // like the double bucket queue a heap hands out a cost below the last one it popped next
+  for (auto type : kTypes) {
+    std::vector<simple_label> labels = {{100.f}, {200.f}, {50.f}};
+    LabelQueue<simple_label> queue(type, 0, 1000, 1, &labels);
+    queue.add(0);
+    queue.add(1);
+    EXPECT_EQ(queue.pop(), 0);
+    queue.add(2);
+    EXPECT_EQ(queue.pop(), 2) << static_cast<int>(type);
+    EXPECT_EQ(queue.pop(), 1);
+    EXPECT_EQ(queue.pop(), kInvalidLabel);
+  }
+}
+
+// pops, adds and decreases like a search does and checks each pop is the cheapest label queued
+void Simulate(const QueueType type,
+              const float bucket_range,
+              const size_t loop_count,
+              const size_t expansion_size,
+              const float max_increment_cost) {
+  std::vector<simple_label> labels;
+  LabelQueue<simple_label> queue(type, 0, bucket_range, 1, &labels);
+  std::unordered_set<uint32_t> queued;
+  std::mt19937 gen(42);
+
+  labels.push_back({10.f});
+  queue.add(0);
+  queued.insert(0);
+  for (size_t i = 0; i < loop_count; ++i) {
+    const auto label = queue.pop();
+    if (label == kInvalidLabel) {
+      break;
+    }
+    ASSERT_EQ(queued.erase(label), 1) << static_cast<int>(type);
+    const auto min_cost = labels[label].sortcost();
+    for (auto other : queued) {
+      ASSERT_LE(min_cost, labels[other].sortcost()) << static_cast<int>(type);
+    }
+
+    for (size_t j = 0; j < expansion_size; ++j) {
+      const float cost = std::floor(min_cost + 1 + test::rand01(gen) * max_increment_cost);
+      if (j % 2 == 0 && !queued.empty()) {
+        const auto other = *std::next(queued.begin(), test::rand01(gen) * queued.size());
+        if (cost < labels[other].sortcost()) {
+          // the algorithms decrease before they update the label
+          queue.decrease(other, cost);
+          labels[other] = {cost};
+        }
+      } else {
+        labels.push_back({cost});
+        queue.add(labels.size() - 1);
+        queued.insert(labels.size() - 1);
+      }
+    }
+  }
+
+  // what is left comes out in order
+  float previous = 0.f;
+  for (size_t i = 0, left = queued.size(); i < left; ++i) {
+    const auto label = queue.pop();
+    ASSERT_NE(label, kInvalidLabel);
+    EXPECT_LE(previous, labels[label].sortcost()) << static_cast<int>(type);
+    previous = labels[label].sortcost();
+  }
+  EXPECT_EQ(queue.pop(), kInvalidLabel);
+}
+
+TEST(LabelQueue, Simulation) {
+  for (auto type : kTypes) {
+    Simulate(type, 100000, 1000, 10, 1000);
+    Simulate(type, 100000, 333, 60, 100);
+    // a narrow range sends most costs to the overflow of the double bucket queue
+    Simulate(type, 50, 500, 20, 5000);
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,89 @@
+#include "thor/labelbudget.h"
+
+#include "test.h"
+
+using namespace valhalla::thor;
+
+namespace {
+
+// pretend a request created this many labels
+void use(std::vector<uint32_t>& labels, size_t count) {
+  labels.resize(count);
+}
+
+TEST(LabelBudget, TrimAboveHighWater) {
+  LabelBudget budget(1000, false, 0);
+  std::vector<uint32_t> labels;
+
+  // an outlier request is cut back to the high water mark right away
+  use(labels, 5000);
+  budget.clear(labels);
+  EXPECT_TRUE(labels.empty());
+  EXPECT_EQ(labels.capacity(), 1000);
+  EXPECT_EQ(budget.memory().used_bytes, 5000 * sizeof(uint32_t));
+  EXPECT_EQ(budget.memory().peak_used_bytes, 5000 * sizeof(uint32_t));
+  EXPECT_EQ(budget.memory().reserved_bytes, 1000 * sizeof(uint32_t));
+  EXPECT_EQ(budget.memory().trims, 1);
+
+  // below the high water mark we keep it all when there is no hysteresis
+  for (int i = 0; i < 10; ++i) {
+    use(labels, 10);
+    budget.clear(labels);
+  }
+  EXPECT_EQ(labels.capacity(), 1000);
+  EXPECT_EQ(budget.memory().used_bytes, 10 * sizeof(uint32_t));
+  EXPECT_EQ(budget.memory().trims, 1);
+}
+
+TEST(LabelBudget, TrimAfterQuietClears) {
+  LabelBudget budget(1000, false, 3);
+  std::vector<uint32_t> labels;
+  use(labels, 800);
+  budget.clear(labels);
+  EXPECT_EQ(labels.capacity(), 800);
+
+  // a busy request in between restarts the count
+  use(labels, 100);
+  budget.clear(labels);
+  use(labels, 700);
+  budget.clear(labels);
+  use(labels, 50);
+  budget.clear(labels);
+  use(labels, 150);
+  budget.clear(labels);
+  EXPECT_EQ(labels.capacity(), 800);
+
+  // the third quiet one in a row trims to the most any of them used
+  use(labels, 20);
+  budget.clear(labels);
+  EXPECT_EQ(labels.capacity(), 150);
+  EXPECT_EQ(budget.memory().reserved_bytes, 150 * sizeof(uint32_t));
+  EXPECT_EQ(budget.memory().peak_used_bytes, 800 * sizeof(uint32_t));
+  EXPECT_EQ(budget.memory().trims, 1);
+}
+
+TEST(LabelBudget, ClearReservedMemory) {
+  LabelBudget budget(1000, true, 3);
+  std::vector<uint32_t> labels;
+  use(labels, 10);
+  budget.clear(labels);
+  EXPECT_EQ(labels.capacity(), 0);
+  EXPECT_EQ(budget.memory().reserved_bytes, 0);
+}
+
+TEST(LabelBudget, Sum) {
+  LabelMemory a{10, 5, 7, 1};
+  LabelMemory b{20, 1, 30, 2};
+  a += b;
+  EXPECT_EQ(a.reserved_bytes, 30);
+  EXPECT_EQ(a.used_bytes, 6);
+  EXPECT_EQ(a.peak_used_bytes, 30);
+  EXPECT_EQ(a.trims, 3);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include "midgard/logging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+constexpr size_t kThreads = 4;
+constexpr size_t kLines = 1000;
+
+// the logger is a singleton, this binary only ever configures the async one
+TEST(Logging, AsyncLoggerTest) {
+  const std::string file_name = "test/thread_async_log_test.log";
+  std::remove(file_name.c_str());
+
+  // a queue much smaller than what is logged, blocking means nothing is lost
+  logging::Configure({{"type", "async"},
+                      {"sink", "file"},
+                      {"file_name", file_name},
+                      {"queue_size", "100"},
+                      {"overflow", "block"}});
+
+  std::vector<std::future<void>> results;
+  for (size_t t = 0; t < kThreads; ++t) {
+    results.emplace_back(std::async(std::launch::async, [t]() {
+      for (size_t i = 0; i < kLines; ++i) {
+        LOG_INFO("thread " + std::to_string(t) + " line " + std::to_string(i));
+      }
+    }));
+  }
+  for (auto& result : results) {
+    result.get();
+  }
+
+  // the writer catches up in the background
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  auto stats = logging::GetAsyncLoggerStats();
+  while (stats.written < stats.logged && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stats = logging::GetAsyncLoggerStats();
+  }
+  EXPECT_EQ(stats.logged, kThreads * kLines);
+  EXPECT_EQ(stats.dropped, 0);
+  EXPECT_EQ(stats.written, kThreads * kLines);
+  EXPECT_GT(stats.writes, 0);
+  EXPECT_LE(stats.writes, stats.written);
+
+  // every line made it and the lines of each thread are in order
+  std::ifstream file(file_name);
+  std::string line;
+  std::vector<int> last(kThreads, -1);
+  size_t lines = 0;
+  while (std::getline(file, line)) {
+    ASSERT_NE(line.find(" [INFO] thread "), std::string::npos) << line;
+    const auto thread = std::stoul(line.substr(line.find("thread ") + 7));
+    const auto number = std::stoi(line.substr(line.find("line ") + 5));
+    ASSERT_LT(thread, kThreads);
+    EXPECT_EQ(number, last[thread] + 1);
+    last[thread] = number;
+    ++lines;
+  }
+  EXPECT_EQ(lines, kThreads * kLines);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -595,6 +595,44 @@ TEST(LokiService, test_hierarchy_warning) {
   }
 }
 
+TEST(LokiService, test_estimate_cost) {
+  auto add = [](google::protobuf::RepeatedPtrField<Location>* locations, double lng) {
+    auto* ll = locations->Add()->mutable_ll();
+    ll->set_lng(lng);
+    ll->set_lat(0);
+  };
+
+  // a route across a degree at the equator
+  Options options;
+  options.set_action(Options::route);
+  options.set_costing_type(Costing::auto_);
+  add(options.mutable_locations(), 0);
+  add(options.mutable_locations(), 1);
+  const auto route = loki::estimate_cost(options);
+  EXPECT_NEAR(route, 111, 1);
+
+  // another leg over the same distance costs more, so does walking it
+  add(options.mutable_locations(), 0.5);
+  EXPECT_NEAR(loki::estimate_cost(options), route * 2, 1);
+  options.set_costing_type(Costing::pedestrian);
+  EXPECT_NEAR(loki::estimate_cost(options), route * 4, 1);
+
+  // a matrix finds a path for every pair
+  options.set_action(Options::sources_to_targets);
+  options.set_costing_type(Costing::auto_);
+  for (int i = 0; i < 10; ++i) {
+    add(options.mutable_sources(), 0);
+    add(options.mutable_targets(), 1);
+  }
+  EXPECT_NEAR(loki::estimate_cost(options), route * 100, 100);
+
+  // an isochrone expands over its whole area
+  options.set_action(Options::isochrone);
+  options.add_contours()->set_time(10);
+  options.add_contours()->set_time(30);
+  EXPECT_NEAR(loki::estimate_cost(options), 3 * 30 * 30, 1);
+}
+
 } // namespace
 
 class LokiServiceEnv : public ::testing::Environment {
@@ -1,16 +1,28 @@
 #include <algorithm>
 #include <iostream>
 #include <random>
+#include <set>
+#include <sstream>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "baldr/json.h"
+#include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
+#include "baldr/tilehierarchy.h"
+#include "meili/batch_matcher.h"
+#include "meili/candidate_search.h"
+#include "meili/map_matcher_factory.h"
+#include "meili/match_session.h"
+#include "meili/openlr_matcher.h"
+#include "meili/parallel_map_matcher.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "odin/worker.h"
+#include "sif/costfactory.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
 #include "worker.h"
@@ -1505,6 +1517,432 @@ TEST(Mapmatch, openlr_parameter_falsy_native_api) {
     EXPECT_THROW(response.get_child("trip.linear_references"), std::runtime_error);
   }
 }
+std::vector<meili::Measurement> to_measurements(const std::vector<PointLL>& shape) {
+  std::vector<meili::Measurement> measurements;
+  for (const auto& p : shape) {
+    measurements.emplace_back(p, 5.f, 50.f);
+  }
+  return measurements;
+}
+
+// a measurement every 30m along a route through utrecht
+std::vector<meili::Measurement> utrecht_trace() {
+  api_tester tester;
+  auto route = tester.route(
+      R"({"costing":"auto","locations":[{"lat":52.096672,"lon":5.110825},{"lat":52.081371,"lon":5.125671}]})");
+  auto shape = midgard::decode<std::vector<PointLL>>(route.trip().routes(0).legs(0).shape());
+  return to_measurements(midgard::resample_spherical_polyline(shape, 30, true));
+}
+
+Options auto_options() {
+  Options options;
+  const rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  options.set_costing_type(Costing::auto_);
+  return options;
+}
+
+meili::MatchResult matched(const baldr::GraphId& edgeid, const uint32_t time) {
+  return {{}, 0.f, edgeid, 0.5f, -1, meili::StateId(time, 0), false};
+}
+
+TEST(Mapmatch, parallel_windows) {
+  // a straight line with a point every ~11m and a big gap before the 8th point
+  std::vector<PointLL> shape;
+  for (int i = 0; i < 12; ++i) {
+    shape.emplace_back(5.1 + i * 0.0001 + (i >= 7 ? 0.1 : 0.0), 52.09);
+  }
+  auto measurements = to_measurements(shape);
+
+  // no gap is too big so only the window size cuts the trace
+  auto windows = meili::ParallelMapMatcher::Windows(measurements, 100000.f, 4, 2);
+  std::vector<std::pair<size_t, size_t>> expected = {{0, 4}, {2, 6}, {4, 8}, {6, 10}, {8, 12}};
+  ASSERT_EQ(windows.size(), expected.size());
+  for (size_t i = 0; i < windows.size(); ++i) {
+    EXPECT_EQ(windows[i].begin, expected[i].first);
+    EXPECT_EQ(windows[i].end, expected[i].second);
+    EXPECT_EQ(windows[i].overlaps, i > 0);
+  }
+
+  // the gap starts a new piece that doesnt overlap the previous one
+  windows = meili::ParallelMapMatcher::Windows(measurements, 2000.f, 4, 2);
+  expected = {{0, 4}, {2, 6}, {4, 7}, {7, 11}, {9, 12}};
+  ASSERT_EQ(windows.size(), expected.size());
+  for (size_t i = 0; i < windows.size(); ++i) {
+    EXPECT_EQ(windows[i].begin, expected[i].first);
+    EXPECT_EQ(windows[i].end, expected[i].second);
+    EXPECT_EQ(windows[i].overlaps, i != 0 && i != 3);
+  }
+
+  // a gap that would leave a single measurement on its own is not cut
+  measurements.resize(8);
+  windows = meili::ParallelMapMatcher::Windows(measurements, 2000.f, 10, 2);
+  ASSERT_EQ(windows.size(), 1);
+  EXPECT_EQ(windows.front().end, 8);
+}
+
+TEST(Mapmatch, parallel_stitch) {
+  const baldr::GraphId a(1, 2, 0), b(1, 2, 1), c(1, 2, 2), d(1, 2, 3);
+
+  // the first window goes a -> b, the second b -> c, they agree on b in the overlap
+  std::vector<meili::MatchResult> results;
+  std::vector<meili::EdgeSegment> segments;
+  meili::MatchResults first({matched(a, 0), matched(a, 1), matched(b, 2), matched(b, 3)},
+                            {{a, 0.f, 1.f, 0, 1}, {b, 0.f, 0.9f, 2, 3}}, 1.f);
+  meili::ParallelMapMatcher::Stitch(results, segments, {0, 4, false}, first);
+  meili::MatchResults second({matched(b, 0), matched(b, 1), matched(c, 2), matched(c, 3)},
+                             {{b, 0.1f, 1.f, 0, 1}, {c, 0.f, 0.5f, 2, 3}}, 1.f);
+  meili::ParallelMapMatcher::Stitch(results, segments, {2, 6, true}, second);
+
+  ASSERT_EQ(results.size(), 6);
+  ASSERT_EQ(segments.size(), 3);
+  EXPECT_EQ(segments[1].edgeid, b);
+  EXPECT_FLOAT_EQ(segments[1].source, 0.f);
+  EXPECT_FLOAT_EQ(segments[1].target, 1.f);
+  EXPECT_EQ(segments[1].first_match_idx, 2);
+  EXPECT_EQ(segments[1].last_match_idx, 3);
+  EXPECT_EQ(segments[2].edgeid, c);
+  EXPECT_EQ(segments[2].first_match_idx, 4);
+  EXPECT_EQ(segments[2].last_match_idx, 5);
+  for (const auto& result : results) {
+    EXPECT_FALSE(result.begins_discontinuity || result.ends_discontinuity);
+  }
+
+  // the third window disagrees all over the overlap so it is joined with a discontinuity
+  meili::MatchResults third({matched(d, 0), matched(d, 1), matched(d, 2)},
+                            {{d, 0.f, 1.f, 0, 2}}, 1.f);
+  meili::ParallelMapMatcher::Stitch(results, segments, {4, 7, true}, third);
+
+  ASSERT_EQ(results.size(), 7);
+  EXPECT_EQ(results[4].edgeid, c);
+  EXPECT_TRUE(results[4].begins_discontinuity);
+  EXPECT_EQ(results[5].edgeid, d);
+  EXPECT_TRUE(results[5].ends_discontinuity);
+  ASSERT_EQ(segments.size(), 4);
+  EXPECT_EQ(segments[2].last_match_idx, 4);
+  EXPECT_TRUE(segments[2].discontinuity);
+  EXPECT_EQ(segments[3].edgeid, d);
+  EXPECT_EQ(segments[3].first_match_idx, 5);
+  EXPECT_EQ(segments[3].last_match_idx, 6);
+}
+
+TEST(Mapmatch, parallel_matches_sequential) {
+  // match the trace in small windows on a few threads
+  const auto measurements = utrecht_trace();
+  const auto options = auto_options();
+
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+  const auto sequential = std::move(matcher->OfflineMatch(measurements).front());
+
+  auto parallel_conf = conf;
+  parallel_conf.put("meili.parallel.threads", 3);
+  parallel_conf.put("meili.parallel.window_size", 10);
+  parallel_conf.put("meili.parallel.window_overlap", 4);
+  meili::ParallelMapMatcher parallel_matcher(parallel_conf);
+  EXPECT_EQ(parallel_matcher.concurrency(), 3);
+  const auto parallel = parallel_matcher.Match(options, measurements);
+
+  ASSERT_EQ(parallel.results.size(), sequential.results.size());
+  for (size_t i = 0; i < parallel.results.size(); ++i) {
+    EXPECT_EQ(parallel.results[i].edgeid, sequential.results[i].edgeid) << "measurement " << i;
+  }
+  EXPECT_EQ(parallel.edges, sequential.edges);
+}
+
+TEST(Mapmatch, session_matches_offline) {
+  // push the trace a few measurements at a time
+  const auto measurements = utrecht_trace();
+  const auto options = auto_options();
+
+  auto session_conf = conf;
+  session_conf.put("meili.session.finalize_lag", 3);
+  session_conf.put("meili.session.max_window", 8);
+  meili::MapMatcherFactory factory(session_conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+  const auto offline = std::move(matcher->OfflineMatch(measurements).front());
+
+  meili::MatchSession session(factory.Create(options));
+  std::vector<meili::MatchResult> results;
+  std::vector<uint64_t> edges;
+  auto collect = [&](const meili::MatchResults& match) {
+    results.insert(results.end(), match.results.begin(), match.results.end());
+    for (const auto& segment : match.segments) {
+      if (edges.empty() || edges.back() != segment.edgeid) {
+        edges.push_back(segment.edgeid);
+      }
+    }
+  };
+  for (size_t i = 0; i < measurements.size(); i += 2) {
+    auto end = std::min(i + 2, measurements.size());
+    collect(session.Push({measurements.begin() + i, measurements.begin() + end}));
+    // the lag holds back results and the window never grows past its limit
+    EXPECT_EQ(session.finalized(), end > 3 ? end - 3 : 0);
+    EXPECT_LE(session.window(), 8);
+  }
+  collect(session.Finish());
+
+  ASSERT_EQ(results.size(), offline.results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].edgeid, offline.results[i].edgeid) << "measurement " << i;
+  }
+  EXPECT_EQ(edges, offline.edges);
+  EXPECT_EQ(session.pushed(), 0);
+}
+
+TEST(Mapmatch, expansion_cache) {
+  const auto measurements = utrecht_trace();
+  const auto options = auto_options();
+
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+  const auto first = std::move(matcher->OfflineMatch(measurements).front());
+  const auto& cache = matcher->transition_cost_model().expansion_cache();
+  EXPECT_GT(cache.size(), 0);
+
+  // a new match starts with an empty cache and comes to the same result
+  const auto second = std::move(matcher->OfflineMatch(measurements).front());
+  EXPECT_EQ(first.edges, second.edges);
+  EXPECT_FLOAT_EQ(first.score, second.score);
+  matcher->Clear();
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(Mapmatch, trace_batch) {
+  const auto measurements = utrecht_trace();
+  std::string shape;
+  for (const auto& measurement : measurements) {
+    shape += (shape.empty() ? "" : ",") + std::string(R"({"lat":)") +
+             std::to_string(measurement.lnglat().lat()) + R"(,"lon":)" +
+             std::to_string(measurement.lnglat().lng()) + R"(,"accuracy":5,"radius":50})";
+  }
+  const std::string trace = R"({"costing":"auto","shape_match":"map_snap","shape":[)" + shape + "]}";
+
+  // a good trace, a blank line, one that cant be parsed and the good one again
+  auto batch_conf = conf;
+  batch_conf.put("meili.batch.threads", 2);
+  batch_conf.put("meili.batch.chunk_size", 2);
+  tyr::actor_t actor(batch_conf, true);
+  std::istringstream records(actor.trace_batch(trace + "\n\n{\"costing\":\"auto\"}\n" + trace));
+
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(auto_options()));
+  const auto expected = std::move(matcher->OfflineMatch(measurements).front());
+
+  std::vector<meili::BatchRecord> batch;
+  meili::BatchRecord record;
+  while (meili::BatchMatcher::ReadRecord(records, record)) {
+    batch.push_back(record);
+  }
+  ASSERT_EQ(batch.size(), 3);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_EQ(batch[i].index, i);
+  }
+  EXPECT_EQ(batch[0].status, meili::kBatchMatched);
+  EXPECT_EQ(batch[0].edges, expected.edges);
+  EXPECT_NE(batch[1].status, meili::kBatchMatched);
+  EXPECT_TRUE(batch[1].edges.empty());
+  EXPECT_EQ(batch[2].status, meili::kBatchMatched);
+  EXPECT_EQ(batch[2].edges, expected.edges);
+}
+
+TEST(Mapmatch, speed_observations) {
+  // the resampled route driven at 15m/s
+  auto measurements = utrecht_trace();
+  for (size_t i = 0; i < measurements.size(); ++i) {
+    const auto& m = measurements[i];
+    measurements[i] = meili::Measurement(m.lnglat(), m.gps_accuracy(), m.search_radius(), 2. * i);
+  }
+
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(auto_options()));
+  const auto match = std::move(matcher->OfflineMatch(measurements).front());
+  const auto observations = meili::ObserveSpeeds(match, matcher->graphreader());
+  ASSERT_FALSE(observations.empty());
+
+  double length = 0, time = 0, last_exit = 0;
+  for (const auto& observation : observations) {
+    EXPECT_NE(std::find(match.edges.begin(), match.edges.end(), baldr::GraphId(observation.edge)),
+              match.edges.end());
+    EXPECT_GT(observation.exit_time, observation.entry_time);
+    EXPECT_GE(observation.entry_time, last_exit - 1e-6);
+    EXPECT_GT(observation.coverage, 0.f);
+    EXPECT_LE(observation.coverage, 1.f + 1e-6f);
+    last_exit = observation.exit_time;
+    length += observation.length;
+    time += observation.exit_time - observation.entry_time;
+  }
+  EXPECT_NEAR(length / time * 3.6, 54, 54 * 0.1);
+
+  // every fully covered edge gets one update on its tile
+  size_t full = 0;
+  for (const auto& observation : observations) {
+    full += observation.coverage >= 0.5f;
+  }
+  size_t updated = 0;
+  for (const auto& tile : meili::TrafficUpdates(observations)) {
+    for (const auto& update : tile.second) {
+      EXPECT_TRUE(update.speed.speed_valid());
+      EXPECT_GT(update.speed.get_overall_speed(), 0);
+      ++updated;
+    }
+  }
+  EXPECT_GT(updated, 0);
+  EXPECT_LE(updated, full);
+
+  // timeless traces have nothing to observe
+  EXPECT_TRUE(meili::ObserveSpeeds(std::move(matcher->OfflineMatch(utrecht_trace()).front()),
+                                   matcher->graphreader())
+                  .empty());
+}
+
+TEST(Mapmatch, trace_batch_speeds) {
+  const auto measurements = utrecht_trace();
+  std::string shape;
+  for (size_t i = 0; i < measurements.size(); ++i) {
+    shape += (shape.empty() ? "" : ",") + std::string(R"({"lat":)") +
+             std::to_string(measurements[i].lnglat().lat()) + R"(,"lon":)" +
+             std::to_string(measurements[i].lnglat().lng()) + R"(,"time":)" +
+             std::to_string(2 * i) + "}";
+  }
+  const std::string trace = R"({"costing":"auto","shape_match":"map_snap","shape":[)" + shape + "]}";
+
+  // the second trace reuses the matcher of the first
+  auto batch_conf = conf;
+  batch_conf.put("meili.batch.threads", 1);
+  meili::BatchMatcher batch(batch_conf, meili::BatchMatcher::Output::kSpeeds);
+  std::istringstream traces(trace + "\n" + trace);
+  std::stringstream records;
+  const auto stats = batch.Match(traces, records);
+  EXPECT_EQ(stats.matched, 2);
+
+  std::vector<meili::BatchRecord> read;
+  meili::BatchRecord record;
+  while (meili::BatchMatcher::ReadRecord(records, record, meili::BatchMatcher::Output::kSpeeds)) {
+    read.push_back(record);
+  }
+  ASSERT_EQ(read.size(), 2);
+  EXPECT_TRUE(read[0].edges.empty());
+  ASSERT_FALSE(read[0].speeds.empty());
+  ASSERT_EQ(read[0].speeds.size(), read[1].speeds.size());
+  for (size_t i = 0; i < read[0].speeds.size(); ++i) {
+    EXPECT_EQ(read[0].speeds[i].edge, read[1].speeds[i].edge);
+    EXPECT_DOUBLE_EQ(read[0].speeds[i].entry_time, read[1].speeds[i].entry_time);
+  }
+}
+
+// Collects the edge ids of the range a query looks at
+struct RangeCollector {
+  template <typename edgeid_iterator_t>
+  std::unordered_set<baldr::GraphId> WithinSquaredDistance(const PointLL&,
+                                                           baldr::Location::StopType,
+                                                           float,
+                                                           edgeid_iterator_t begin,
+                                                           edgeid_iterator_t end,
+                                                           const sif::cost_ptr_t&) const {
+    return std::unordered_set<baldr::GraphId>(begin, end);
+  }
+};
+
+// The projected points of the candidates, which don't depend on which of the edges at a node the
+// candidate was made from
+std::multiset<std::tuple<double, double, double>>
+projections(const std::vector<baldr::PathLocation>& candidates) {
+  std::multiset<std::tuple<double, double, double>> points;
+  for (const auto& candidate : candidates) {
+    for (const auto& edge : candidate.edges) {
+      points.emplace(std::round(edge.projected.lng() * 1e6), std::round(edge.projected.lat() * 1e6),
+                     std::round(edge.distance));
+    }
+  }
+  return points;
+}
+
+TEST(Mapmatch, candidate_window) {
+  const auto measurements = utrecht_trace();
+  meili::MapMatcherFactory factory(conf);
+  auto& reader = *factory.graphreader();
+  const auto cell = baldr::TileHierarchy::levels().back().tiles.TileSize() / 500;
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(auto_options()));
+  const auto& costing = matcher->costing();
+
+  // the window moves along the trace and finds what a query without one finds
+  meili::CandidateGridQuery windowed(reader, cell, cell);
+  const auto stop = baldr::Location::StopType::BREAK;
+  const float sq_radius = 50 * 50;
+  for (const auto& measurement : measurements) {
+    const auto& ll = measurement.lnglat();
+    const auto candidates = windowed.Query(ll, stop, sq_radius, costing);
+    meili::CandidateGridQuery fresh(reader, cell, cell);
+    EXPECT_EQ(projections(candidates), projections(fresh.Query(ll, stop, sq_radius, costing)));
+    const auto range = fresh.Query(ll, stop, sq_radius, costing, RangeCollector());
+    EXPECT_EQ(windowed.window_size(), range.size());
+  }
+
+  // a jump elsewhere replaces the whole window
+  const auto& first = measurements.front().lnglat();
+  windowed.Query(first, stop, sq_radius, costing);
+  meili::CandidateGridQuery fresh(reader, cell, cell);
+  EXPECT_EQ(windowed.window_size(),
+            fresh.Query(first, stop, sq_radius, costing, RangeCollector()).size());
+  windowed.Clear();
+  EXPECT_EQ(windowed.window_size(), 0);
+}
+
+TEST(Mapmatch, openlr_round_trip) {
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(auto_options()));
+  const auto match = std::move(matcher->OfflineMatch(utrecht_trace()).front());
+  ASSERT_GT(match.edges.size(), 5);
+
+  // a few whole edges in the middle of the route, short enough to have one way between the ends
+  const size_t middle = match.edges.size() / 2;
+  const std::vector<uint64_t> edges(match.edges.begin() + middle - 1,
+                                    match.edges.begin() + middle + 2);
+  const auto reference = meili::EncodeOpenLr(edges, matcher->graphreader());
+  ASSERT_EQ(reference.lrps.size(), 2);
+  double length = 0;
+  for (const auto edge : edges) {
+    length += matcher->graphreader().directededge(baldr::GraphId(edge))->length();
+  }
+  EXPECT_NEAR(reference.getLength(), length, 58.6);
+
+  // the same edges come back from the single and the bulk decode
+  auto openlr_conf = conf;
+  openlr_conf.put("meili.openlr.threads", 2);
+  meili::OpenLrMatcher openlr(openlr_conf);
+  std::unique_ptr<meili::MapMatcher> decoder(factory.Create(auto_options()));
+  EXPECT_EQ(meili::DecodeOpenLr(reference, *decoder, 50.f), edges);
+
+  std::string bytes;
+  meili::BatchMatcher::WriteRecord(bytes, {0, meili::kBatchMatched, edges, {}});
+  meili::BatchMatcher::WriteRecord(bytes, {1, 444, {}, {}});
+  std::istringstream in(bytes);
+  std::stringstream references;
+  auto stats = openlr.Encode(in, references);
+  EXPECT_EQ(stats.references, 2);
+  EXPECT_EQ(stats.converted, 1);
+  EXPECT_EQ(references.str(), reference.toBase64() + "\n\n");
+
+  std::istringstream lines(references.str() + "not a reference\n");
+  std::stringstream records;
+  stats = openlr.Decode(lines, records);
+  EXPECT_EQ(stats.references, 3);
+  EXPECT_EQ(stats.converted, 1);
+
+  meili::BatchRecord record;
+  ASSERT_TRUE(meili::BatchMatcher::ReadRecord(records, record));
+  EXPECT_EQ(record.status, meili::kBatchMatched);
+  EXPECT_EQ(record.edges, edges);
+  for (uint64_t index = 1; index < 3; ++index) {
+    ASSERT_TRUE(meili::BatchMatcher::ReadRecord(records, record));
+    EXPECT_EQ(record.index, index);
+    EXPECT_NE(record.status, meili::kBatchMatched);
+    EXPECT_TRUE(record.edges.empty());
+  }
+  EXPECT_FALSE(meili::BatchMatcher::ReadRecord(records, record));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
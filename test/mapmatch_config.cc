@@ -25,6 +25,10 @@ const auto fake_config = test::json_to_pt(R"({
       "search_radius": 10,
       "sigma_z": 5.1,
       "turn_penalty_factor": 100
+    },
+    "session": {
+      "finalize_lag": 3,
+      "max_window": 50
     }
   })");
 
@@ -60,6 +64,11 @@ TEST(MapmatchConfig, check_read_all_params) {
   const auto& routing = config.routing;
   EXPECT_EQ(routing.interpolation_distance_meters, 5.f);
   EXPECT_FALSE(routing.is_interpolation_distance_customizable);
+
+  // check session params
+  const auto& session = config.session;
+  EXPECT_EQ(session.finalize_lag, 3);
+  EXPECT_EQ(session.max_window, 50);
 }
 
 TEST(MapmatchConfig, validate_candidate_search_params) {
@@ -124,6 +133,17 @@ TEST(MapmatchConfig, validate_routing_params) {
   EXPECT_THROW(config.Read(pt), std::exception);
 }
 
+TEST(MapmatchConfig, validate_session_params) {
+  valhalla::meili::Config config;
+
+  auto pt = fake_config;
+  pt.put<size_t>("session.max_window", 4);
+  EXPECT_THROW(config.Read(pt), std::exception);
+
+  pt.put<size_t>("session.max_window", 5);
+  EXPECT_NO_THROW(config.Read(pt));
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
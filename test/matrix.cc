@@ -4,9 +4,12 @@
 #include <string>
 #include <vector>
 
+#include <zlib.h>
+
 #include "baldr/rapidjson_utils.h"
 #include "loki/worker.h"
 #include "midgard/logging.h"
+#include "sif/costfactory.h"
 #include "sif/dynamiccost.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -273,6 +276,40 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, goal_pruning) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+
+  TimeDistanceMatrix full_matrix;
+  full_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto expected = request.matrix();
+  const auto full_settled = full_matrix.search_stats().settled;
+  request.clear_matrix();
+
+  // pruning the nodes that are too far from the destinations left doesn't change any answer
+  auto thor_config = config.get_child("thor");
+  thor_config.put("matrix_goal_pruning", true);
+  TimeDistanceMatrix pruned_matrix(thor_config);
+  pruned_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto& matrix = request.matrix();
+  ASSERT_EQ(matrix.times().size(), expected.times().size());
+  for (int i = 0; i < matrix.times().size(); ++i) {
+    EXPECT_EQ(matrix.distances(i), expected.distances(i)) << "distance " << i << " differs";
+    EXPECT_EQ(matrix.times(i), expected.times(i)) << "time " << i << " differs";
+  }
+  EXPECT_LE(pruned_matrix.search_stats().settled, full_settled);
+}
+
 TEST(Matrix, test_timedistancematrix_forward) {
   // Input request is the same as `test_request`, but without the last target
   const auto test_request_more_sources = R"({
@@ -376,6 +413,42 @@ TEST(Matrix, test_timedistancematrix_reverse) {
   }
 }
 
+TEST(Matrix, test_timedistancematrix_shared_edge_costs) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+  sif::TravelMode mode;
+  auto mode_costing = sif::CostFactory().CreateModeCosting(request.options(), mode);
+
+  // the request has no time so all the sources share the edge costs
+  TimeDistanceMatrix timedist_matrix;
+  timedist_matrix.SourceToTarget(request, reader, mode_costing, mode, 400000.0);
+  const auto& matrix = request.matrix();
+  const auto target_count = request.options().targets().size();
+
+  // and get the same rows as when each of them is on its own
+  for (int source = 0; source < request.options().sources().size(); ++source) {
+    Api single = request;
+    single.clear_matrix();
+    auto* sources = single.mutable_options()->mutable_sources();
+    sources->SwapElements(0, source);
+    sources->DeleteSubrange(1, sources->size() - 1);
+
+    TimeDistanceMatrix single_matrix;
+    single_matrix.SourceToTarget(single, reader, mode_costing, mode, 400000.0);
+    for (int target = 0; target < target_count; ++target) {
+      const auto i = source * target_count + target;
+      EXPECT_EQ(matrix.times(i), single.matrix().times(target)) << "source " << source;
+      EXPECT_EQ(matrix.distances(i), single.matrix().distances(target)) << "source " << source;
+    }
+  }
+}
+
 TEST(Matrix, test_matrix_osrm) {
   loki_worker_t loki_worker(config);
 
@@ -396,6 +469,7 @@ TEST(Matrix, test_matrix_osrm) {
   auto json_res = tyr::serializeMatrix(request);
   std::string algo = "costmatrix";
   check_osrm_response(json_res, algo);
+  EXPECT_EQ(tyr::joinChunks(tyr::serializeMatrixChunks(request)), json_res);
 
   TimeDistanceMatrix timedist_matrix;
   timedist_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
@@ -404,6 +478,94 @@ TEST(Matrix, test_matrix_osrm) {
   check_osrm_response(json_res, algo);
 }
 
+TEST(Matrix, parallel_matrix) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+
+  CostMatrix serial_matrix;
+  serial_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto expected = request.matrix();
+  request.clear_matrix();
+
+  // the parallel searches must come up with exactly the same answers, also when reused
+  auto thor_config = config.get_child("thor");
+  thor_config.put("costmatrix_threads", 4);
+  CostMatrix parallel_matrix(thor_config, config.get_child("mjolnir"));
+  for (int i = 0; i < 3; ++i) {
+    parallel_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive,
+                                   400000.0);
+    const auto& matrix = request.matrix();
+    ASSERT_EQ(matrix.times().size(), expected.times().size());
+    for (int j = 0; j < matrix.times().size(); ++j) {
+      EXPECT_EQ(matrix.distances(j), expected.distances(j)) << "distance " << j << " differs";
+      EXPECT_EQ(matrix.times(j), expected.times(j)) << "time " << j << " differs";
+    }
+    request.clear_matrix();
+    parallel_matrix.clear();
+  }
+}
+
+TEST(Matrix, target_cache) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+
+  CostMatrix fresh_matrix;
+  fresh_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto expected = request.matrix();
+  request.clear_matrix();
+
+  // the second matrix to the same targets carries on with the reverse searches of the first
+  auto thor_config = config.get_child("thor");
+  thor_config.put("costmatrix_target_cache_size", 64 * 1024 * 1024);
+  CostMatrix cached_matrix(thor_config);
+  for (uint32_t hits : {0, 4}) {
+    cached_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive,
+                                 400000.0);
+    EXPECT_EQ(cached_matrix.target_cache_hits(), hits);
+    const auto& matrix = request.matrix();
+    ASSERT_EQ(matrix.times().size(), expected.times().size());
+    for (int j = 0; j < matrix.times().size(); ++j) {
+      EXPECT_NEAR(matrix.times(j), expected.times(j), expected.times(j) * 0.05f + kThreshold)
+          << "time " << j << " differs";
+      EXPECT_NEAR(matrix.distances(j), expected.distances(j),
+                  expected.distances(j) * 0.05f + kThreshold)
+          << "distance " << j << " differs";
+    }
+    request.clear_matrix();
+    cached_matrix.clear();
+  }
+
+  // nothing fits into a cache of a few bytes
+  thor_config.put("costmatrix_target_cache_size", 16);
+  CostMatrix tiny_matrix(thor_config);
+  for (int i = 0; i < 2; ++i) {
+    tiny_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+    EXPECT_EQ(tiny_matrix.target_cache_hits(), 0);
+    request.clear_matrix();
+    tiny_matrix.clear();
+  }
+}
+
 const auto test_request_partial = R"({
     "sources":[
       {"lat":52.103948,"lon":5.06813}
@@ -445,6 +607,67 @@ TEST(Matrix, partial_matrix) {
   EXPECT_EQ(found, 2) << " partial result did not find 2 results as expected";
 }
 
+TEST(Matrix, rows_until_deadline) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  thor_worker_t::adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+
+  TimeDistanceMatrix full_matrix;
+  full_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  const auto expected = request.matrix();
+  request.clear_matrix();
+
+  // each row is handed on with its cells as soon as it is done, the time is up after the first
+  TimeDistanceMatrix timedist_matrix;
+  std::vector<uint32_t> rows;
+  TimeDistanceMatrix::row_callback_t row_callback = [&](const Api& api, const bool source,
+                                                        const uint32_t index) {
+    EXPECT_TRUE(source);
+    const uint32_t targets = api.options().targets_size();
+    for (uint32_t i = index * targets; i < (index + 1) * targets; ++i) {
+      EXPECT_EQ(api.matrix().times(i), expected.times(i)) << "time " << i << " differs";
+      EXPECT_EQ(api.matrix().date_times(i), expected.date_times(i));
+    }
+    rows.push_back(index);
+    timedist_matrix.set_deadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+  };
+  timedist_matrix.set_row_callback(&row_callback);
+  timedist_matrix.SourceToTarget(request, reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+  EXPECT_EQ(rows, std::vector<uint32_t>{0});
+
+  // the rows after it are missing and listed as incomplete
+  const auto& matrix = request.matrix();
+  ASSERT_EQ(matrix.times().size(), expected.times().size());
+  const uint32_t targets = request.options().targets_size();
+  for (uint32_t i = 0; i < static_cast<uint32_t>(matrix.times().size()); ++i) {
+    EXPECT_EQ(matrix.from_indices(i), i / targets);
+    EXPECT_EQ(matrix.to_indices(i), i % targets);
+    EXPECT_EQ(matrix.times(i), i < targets ? expected.times(i) : kMaxCost);
+  }
+  EXPECT_EQ(std::vector<uint32_t>(matrix.incomplete_sources().begin(),
+                                  matrix.incomplete_sources().end()),
+            (std::vector<uint32_t>{1, 2, 3}));
+  EXPECT_EQ(matrix.incomplete_targets_size(), 0);
+  ASSERT_EQ(request.info().warnings_size(), 1);
+  EXPECT_EQ(request.info().warnings(0).code(), 208);
+
+  rapidjson::Document json;
+  json.Parse(tyr::serializeMatrix(request));
+  ASSERT_FALSE(json.HasParseError());
+  ASSERT_TRUE(json.HasMember("incomplete_sources"));
+  EXPECT_EQ(json["incomplete_sources"].Size(), 3);
+  EXPECT_TRUE(json["sources_to_targets"][1][0]["time"].IsNull());
+}
+
 // slim dowm matrix response: https://github.com/valhalla/valhalla/pull/3987
 const auto test_matrix_default = R"({
     "sources":[
@@ -547,6 +770,66 @@ TEST(Matrix, slim_matrix) {
   EXPECT_TRUE(json.HasMember("units"));
 }
 
+TEST(Matrix, binary_matrix) {
+  tyr::actor_t actor(config, true);
+  auto json_response = actor.matrix(test_matrix_verbose_false);
+  rapidjson::Document json;
+  json.Parse(json_response);
+  ASSERT_FALSE(json.HasParseError());
+  const auto& durations = json["sources_to_targets"]["durations"];
+  const auto& distances = json["sources_to_targets"]["distances"];
+
+  auto read_le = [](const std::string& bytes, size_t offset) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[offset + i])) << (8 * i);
+    }
+    return value;
+  };
+
+  for (const bool compress : {false, true}) {
+    auto request = std::string(test_matrix_verbose_false);
+    request.insert(request.rfind('}'), std::string(R"(,"format":"binary","compress":)") +
+                                           (compress ? "true" : "false"));
+    auto response = actor.matrix(request);
+    ASSERT_GE(response.size(), 16);
+    EXPECT_EQ(response.substr(0, 4), "VMAT");
+    EXPECT_EQ(response[4], 1);
+    EXPECT_EQ(response[5], compress ? 1 : 0);
+    const auto sources = read_le(response, 8);
+    const auto targets = read_le(response, 12);
+    ASSERT_EQ(sources, durations.Size());
+    ASSERT_EQ(targets, durations[0].Size());
+
+    auto columns = response.substr(16);
+    if (compress) {
+      uLongf size = sources * targets * 2 * sizeof(uint32_t);
+      std::string uncompressed(size, '\0');
+      ASSERT_EQ(uncompress(reinterpret_cast<Bytef*>(&uncompressed[0]), &size,
+                           reinterpret_cast<const Bytef*>(columns.data()), columns.size()),
+                Z_OK);
+      ASSERT_EQ(size, uncompressed.size());
+      columns = uncompressed;
+    }
+    ASSERT_EQ(columns.size(), sources * targets * 2 * sizeof(uint32_t));
+
+    // the same seconds as the json and the meters it rounds to kilometers
+    for (uint32_t i = 0; i < sources * targets; ++i) {
+      const auto& duration = durations[i / targets][i % targets];
+      const auto& distance = distances[i / targets][i % targets];
+      const auto seconds = read_le(columns, i * sizeof(uint32_t));
+      const auto meters = read_le(columns, (sources * targets + i) * sizeof(uint32_t));
+      if (duration.IsNull()) {
+        EXPECT_EQ(seconds, kBinaryUnreachable);
+        EXPECT_EQ(meters, kBinaryUnreachable);
+      } else {
+        EXPECT_EQ(seconds, duration.GetUint64());
+        EXPECT_NEAR(meters / 1000.0, distance.GetDouble(), 0.001);
+      }
+    }
+  }
+}
+
 int main(int argc, char* argv[]) {
   logging::Configure({{"type", ""}}); // silence logs
   testing::InitGoogleTest(&argc, argv);
@@ -1338,6 +1338,25 @@ TEST(NarrativeDictionary, test_en_US_approach_verbal_alert) {
   validate(us_customary_lengths, kExpectedUsCustomaryLengths);
 }
 
+TEST(NarrativeDictionary, test_phrase_template) {
+  // tags without a value and unknown tags are kept as is, a stray bracket is text
+  PhraseTemplate phrase("Turn <RELATIVE_DIRECTION> onto <<STREET_NAMES>. <UNKNOWN> <TOWARD_SIGN>");
+  std::string instruction = "previous instruction";
+  const std::string street_names = "Main Street";
+  phrase.Fill(instruction, {{kStreetNamesTag, street_names}, {kRelativeDirectionTag, "left"}});
+  EXPECT_EQ(instruction, "Turn left onto <Main Street. <UNKNOWN> <TOWARD_SIGN>");
+
+  // the dictionary parses every phrase into a template of the same id
+  const NarrativeDictionary& dictionary = GetNarrativeDictionary("en-US");
+  const auto& turn = dictionary.turn_subset;
+  ASSERT_EQ(turn.templates.size(), turn.phrases.size());
+  turn.templates.at(2).Fill(instruction, {{kRelativeDirectionTag, "right"},
+                                          {kBeginStreetNamesTag, street_names},
+                                          {kStreetNamesTag, "Elm Street"}});
+  // "2": "Turn <RELATIVE_DIRECTION> onto <BEGIN_STREET_NAMES>. Continue on <STREET_NAMES>."
+  EXPECT_EQ(instruction, "Turn right onto Main Street. Continue on Elm Street.");
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
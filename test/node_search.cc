@@ -414,6 +414,30 @@ TEST(Search, test_opposite_in_another_tile) {
   EXPECT_EQ(nodes.size(), 1) << "Expecting to find one node";
 }
 
+TEST(Search, test_covered_tile) {
+  // make the config file
+  std::stringstream json;
+  json << "{ \"tile_dir\": \"" << test_tile_dir << "\" }";
+  boost::property_tree::ptree conf;
+  rapidjson::read_json(json, conf);
+
+  vb::GraphReader reader(conf);
+  // the box covers the tile at the lower left of the grid and reaches into its
+  // neighbours, the nodes of the covered tile are taken straight from it and
+  // the others are found through the bins. the grid has a node every 0.5 / 99
+  // degrees, so there are 60 of them along each side of the box.
+  vm::AABB2<vm::PointLL> box{{-0.01, -0.01}, {0.3, 0.3}};
+
+  auto nodes = valhalla::loki::nodes_in_bbox(box, reader);
+  EXPECT_EQ(nodes.size(), 3600) << "Expecting to find 60 by 60 nodes";
+
+  // the tiles searched in parallel find the same
+  valhalla::thread_pool_t pool(3, conf);
+  EXPECT_EQ(valhalla::loki::nodes_in_bbox(box, reader, &pool), nodes);
+  EXPECT_EQ(valhalla::loki::edges_in_bbox(box, reader, &pool),
+            valhalla::loki::edges_in_bbox(box, reader));
+}
+
 // Setup and tearown will be called only once for the entire suite
 class Env : public ::testing::Environment {
 public:
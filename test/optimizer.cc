@@ -1,8 +1,14 @@
 #include "thor/optimizer.h"
 #include "config.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <numeric>
+#include <random>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include "test.h"
 
 using namespace std;
@@ -10,29 +16,100 @@ using namespace valhalla::thor;
 
 namespace {
 
+const std::vector<float> kCosts = {
+    0,    3036, 707,  956,  318,  1934, 355,  1170, 1286, 3171, 2133, 2978, 0,    2664, 3613,
+    3102, 2011, 3139, 3846, 1764, 2050, 1143, 638,  2638, 0,    1295, 763,  1536, 800,  1528,
+    888,  2773, 1735, 940,  3457, 1281, 0,    582,  2450, 630,  655,  1796, 3681, 2643, 357,
+    3037, 708,  637,  0,    1935, 47,   851,  1286, 3171, 2133, 1839, 2004, 1525, 2480, 1963,
+    0,    2000, 2713, 690,  2578, 1100, 387,  3066, 737,  715,  77,   1964, 0,    928,  1316,
+    3201, 2163, 1129, 3803, 1537, 682,  769,  2707, 819,  0,    2052, 3230, 2899, 1214, 1750,
+    900,  1849, 1338, 634,  1375, 2082, 0,    1907, 846,  3128, 2036, 2814, 3763, 3252, 2549,
+    3290, 3228, 1914, 0,    2010, 2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854,  2000,
+    0};
+
 void TryOptimizer(const uint32_t nlocs,
                   const std::vector<float>& costs,
-                  const std::vector<uint32_t>& expected_order) {
+                  const std::vector<uint32_t>& expected_order,
+                  const bool open_end = false) {
   Optimizer optimizer;
   optimizer.Seed(111111);
-  auto order = optimizer.Solve(nlocs, costs);
+  auto order = optimizer.Solve(nlocs, costs, open_end);
   EXPECT_EQ(order, expected_order);
 }
 
+float TourCost(const uint32_t nlocs,
+               const std::vector<float>& costs,
+               const std::vector<uint32_t>& order) {
+  float cost = 0.f;
+  for (size_t i = 1; i < order.size(); ++i) {
+    cost += costs[order[i - 1] * nlocs + order[i]];
+  }
+  return cost;
+}
+
 TEST(Optimizer, Basic) {
-  std::vector<float> costs = {0,    3036, 707,  956,  318,  1934, 355,  1170, 1286, 3171, 2133,
-                              2978, 0,    2664, 3613, 3102, 2011, 3139, 3846, 1764, 2050, 1143,
-                              638,  2638, 0,    1295, 763,  1536, 800,  1528, 888,  2773, 1735,
-                              940,  3457, 1281, 0,    582,  2450, 630,  655,  1796, 3681, 2643,
-                              357,  3037, 708,  637,  0,    1935, 47,   851,  1286, 3171, 2133,
-                              1839, 2004, 1525, 2480, 1963, 0,    2000, 2713, 690,  2578, 1100,
-                              387,  3066, 737,  715,  77,   1964, 0,    928,  1316, 3201, 2163,
-                              1129, 3803, 1537, 682,  769,  2707, 819,  0,    2052, 3230, 2899,
-                              1214, 1750, 900,  1849, 1338, 634,  1375, 2082, 0,    1907, 846,
-                              3128, 2036, 2814, 3763, 3252, 2549, 3290, 3228, 1914, 0,    2010,
-                              2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854,  2000, 0};
+  // the cheapest of all the orders
   std::vector<uint32_t> expected_order = {0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10};
-  TryOptimizer(11, costs, expected_order);
+  TryOptimizer(11, kCosts, expected_order);
+}
+
+TEST(Optimizer, OpenEnd) {
+  // the same costs without a fixed destination end elsewhere
+  std::vector<uint32_t> expected_order = {0, 3, 7, 4, 6, 2, 8, 5, 10, 1, 9};
+  TryOptimizer(11, kCosts, expected_order, true);
+}
+
+TEST(Optimizer, Trivial) {
+  TryOptimizer(2, {0, 1, 1, 0}, {0, 1});
+  TryOptimizer(3, {0, 1, 9, 1, 0, 1, 1, 9, 0}, {0, 1, 2});
+  TryOptimizer(3, {0, 9, 1, 1, 0, 1, 1, 1, 0}, {0, 2, 1}, true);
+}
+
+TEST(Optimizer, Threads) {
+  // asymmetric costs between random points
+  const uint32_t nlocs = 60;
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> coordinate(0.f, 1000.f), detour(1.f, 1.5f);
+  std::vector<std::pair<float, float>> points(nlocs);
+  for (auto& point : points) {
+    point = {coordinate(gen), coordinate(gen)};
+  }
+  std::vector<float> costs(nlocs * nlocs, 0.f);
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    for (uint32_t j = 0; j < nlocs; ++j) {
+      if (i != j) {
+        costs[i * nlocs + j] = std::hypot(points[i].first - points[j].first,
+                                          points[i].second - points[j].second) *
+                               detour(gen);
+      }
+    }
+  }
+
+  // the tour visits every location once and does not depend on the number of threads
+  boost::property_tree::ptree config;
+  config.put("optimizer_time_limit", 0);
+  Optimizer single(config);
+  config.put("optimizer_threads", 4);
+  Optimizer multi(config);
+  for (const bool open_end : {false, true}) {
+    auto order = single.Solve(nlocs, costs, open_end);
+    ASSERT_EQ(order.size(), nlocs);
+    EXPECT_EQ(order.front(), 0);
+    if (!open_end) {
+      EXPECT_EQ(order.back(), nlocs - 1);
+    }
+    auto sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    for (uint32_t i = 0; i < nlocs; ++i) {
+      EXPECT_EQ(sorted[i], i);
+    }
+    EXPECT_EQ(multi.Solve(nlocs, costs, open_end), order);
+
+    // and is cheaper than visiting the locations in their order
+    std::vector<uint32_t> in_order(nlocs);
+    std::iota(in_order.begin(), in_order.end(), 0);
+    EXPECT_LT(TourCost(nlocs, costs, order), TourCost(nlocs, costs, in_order));
+  }
 }
 
 } // namespace
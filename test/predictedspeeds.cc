@@ -1,4 +1,6 @@
+#include <cmath>
 #include <iostream>
+#include <random>
 
 #include "baldr/predictedspeeds.h"
 #include "midgard/util.h"
@@ -227,6 +229,106 @@ TEST(PredictedSpeeds, test_negative_speeds) {
   }
 }
 
+TEST(PredictedSpeeds, test_decompress_matches_reference) {
+  // random coefficients of about the magnitude real profiles have
+  std::mt19937 generator(17);
+  std::uniform_int_distribution<int> distribution(-600, 600);
+  std::array<int16_t, kCoefficientCount> coefficients;
+  for (auto& c : coefficients) {
+    c = static_cast<int16_t>(distribution(generator));
+  }
+
+  // whichever kernel the machine picked has to agree with the textbook DCT-III
+  for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+    double expected = coefficients[0] / std::sqrt(2.0);
+    for (uint32_t c = 1; c < kCoefficientCount; ++c) {
+      expected += coefficients[c] * std::cos(M_PI / kBucketsPerWeek * (bucket + 0.5) * c);
+    }
+    expected *= std::sqrt(2.0 / kBucketsPerWeek);
+    ASSERT_NEAR(decompress_speed_bucket(coefficients.data(), bucket), expected, 1e-2) << bucket;
+  }
+}
+
+TEST(PredictedSpeeds, test_compress_matches_reference) {
+  // speeds as they are measured, in whole KPH
+  std::mt19937 generator(23);
+  std::uniform_int_distribution<int> distribution(0, 130);
+  std::array<float, kBucketsPerWeek> speeds;
+  for (auto& speed : speeds) {
+    speed = distribution(generator);
+  }
+
+  // whichever kernel the machine picked has to agree with the textbook DCT-II
+  const auto coefficients = compress_speed_buckets(speeds.data());
+  for (uint32_t c = 0; c < kCoefficientCount; ++c) {
+    double expected = 0;
+    for (uint32_t bucket = 0; bucket < kBucketsPerWeek; ++bucket) {
+      expected += speeds[bucket] * std::cos(M_PI / kBucketsPerWeek * (bucket + 0.5) * c);
+    }
+    expected *= std::sqrt(2.0 / kBucketsPerWeek) / (c == 0 ? std::sqrt(2.0) : 1.0);
+    ASSERT_NEAR(coefficients[c], expected, 1.0) << c;
+  }
+}
+
+TEST(PredictedSpeeds, test_decoded_speed_cache) {
+  std::array<int16_t, 2 * kCoefficientCount> profiles{};
+  profiles[0] = 1000;
+  profiles[kCoefficientCount] = 500;
+  profiles[kCoefficientCount + 1] = 100;
+  uint32_t offsets[] = {kCoefficientCount, 0, kCoefficientCount};
+
+  PredictedSpeeds uncached;
+  uncached.set_offset(offsets);
+  uncached.set_profiles(profiles.data());
+  PredictedSpeeds cached;
+  cached.set_offset(offsets);
+  cached.set_profiles(profiles.data());
+  cached.enable_cache(2);
+
+  // the cache must give back the same speed no matter the order we ask in
+  for (uint32_t secs : {0u, 0u, 3600u, 0u, 86400u, 86400u, 604799u}) {
+    for (uint32_t idx = 0; idx < 3; ++idx) {
+      EXPECT_EQ(cached.speed(idx, secs), uncached.speed(idx, secs)) << idx << " " << secs;
+    }
+  }
+}
+
+TEST(PredictedSpeeds, test_speed_snapshots) {
+  std::array<int16_t, 2 * kCoefficientCount> profiles{};
+  profiles[0] = 1000;
+  profiles[kCoefficientCount] = 500;
+  profiles[kCoefficientCount + 1] = 100;
+  uint32_t offsets[] = {kCoefficientCount, 0, kCoefficientCount};
+
+  PredictedSpeeds decoded;
+  decoded.set_offset(offsets);
+  decoded.set_profiles(profiles.data());
+
+  // snapshot the first window of the week and one on monday morning
+  PredictedSpeeds::set_snapshot_windows({0, 100, kSnapshotWindowsPerWeek});
+  EXPECT_TRUE(PredictedSpeeds::snapshots_enabled());
+  PredictedSpeeds snapshotted;
+  snapshotted.set_offset(offsets);
+  snapshotted.set_profiles(profiles.data());
+  snapshotted.enable_snapshots(2);
+
+  // snapshotted windows give the rounded speed, the others are decoded as before
+  for (uint32_t secs : {0u, 299u, 300u, 899u, 900u, 90000u, 90600u, 604799u}) {
+    for (uint32_t idx = 0; idx < 3; ++idx) {
+      const float speed = decoded.speed(idx, secs);
+      if (secs < 900 || (secs >= 90000 && secs < 90900)) {
+        EXPECT_EQ(snapshotted.speed(idx, secs), static_cast<uint32_t>(speed + 0.5f))
+            << idx << " " << secs;
+      } else {
+        EXPECT_EQ(snapshotted.speed(idx, secs), speed) << idx << " " << secs;
+      }
+    }
+  }
+
+  PredictedSpeeds::set_snapshot_windows({});
+  EXPECT_FALSE(PredictedSpeeds::snapshots_enabled());
+}
+
 TEST(PredictedSpeeds, test_compress_decompress_accuracy) {
   // generate speed values for buckets
   std::array<float, kBucketsPerWeek> speeds;
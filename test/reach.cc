@@ -6,6 +6,7 @@
 #include "loki/reach.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "mjolnir/graphtilebuilder.h"
 #include "sif/costfactory.h"
 #include "sif/dynamiccost.h"
 
@@ -123,6 +124,77 @@ TEST(Reach, transition_misscount) {
   EXPECT_EQ(reach.outbound, 7);
 }
 
+TEST(Reach, reach_index) {
+  const std::string ascii_map = R"(
+      b--c--d
+      |  |  |
+      |  |  |
+      a--f--e
+      |  |  |
+      |  |  |
+      g--h--i
+    )";
+
+  const gurka::ways ways = {
+      {"abcdefaghie", {{"highway", "residential"}}},
+      {"cfh", {{"highway", "tertiary"}}},
+  };
+
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/reach_index");
+  const auto tile_dir = map.config.get<std::string>("mjolnir.tile_dir");
+  auto costing = sif::CostFactory{}.Create(Costing::auto_);
+
+  // store a made up reach of 3 for auto on every edge so we can tell it was looked up
+  const std::vector<uint32_t> access(kReachIndexAccess.begin(), kReachIndexAccess.end());
+  const int auto_column = 0;
+  {
+    baldr::GraphReader reader(map.config.get_child("mjolnir"));
+    for (auto tile_id : reader.GetTileSet()) {
+      mjolnir::GraphTileBuilder builder(tile_dir, tile_id, false);
+      std::vector<EdgeReach> reaches(builder.header()->directededgecount() * access.size(),
+                                     EdgeReach{0, 0});
+      for (size_t i = 0; i < builder.header()->directededgecount(); ++i) {
+        reaches[i * access.size() + auto_column] = {3, 3};
+      }
+      builder.UpdateReachIndex(5, access, reaches);
+    }
+  }
+
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  auto edge = gurka::findEdgeByNodes(reader, map.nodes, "a", "f");
+  auto tile = reader.GetGraphTile(std::get<0>(edge));
+  ASSERT_EQ(tile->GetReachIndex().max_reach(), 5);
+  EXPECT_EQ(tile->GetReachIndex().column(kAutoAccess), auto_column);
+  EXPECT_EQ(tile->GetReachIndex().column(kBusAccess), -1);
+
+  // the rest of the tile is untouched
+  auto result = gurka::do_action(valhalla::Options::route, map, {"a", "e"}, "auto");
+  EXPECT_EQ(result.trip().routes_size(), 1);
+
+  loki::Reach reach_checker;
+  reach_checker.set_use_reach_index(true);
+
+  // within the max reach of the index we get what is stored, capped at what we asked for
+  auto reach = reach_checker(std::get<1>(edge), std::get<0>(edge), 5, reader, costing);
+  EXPECT_EQ(reach.outbound, 3);
+  EXPECT_EQ(reach.inbound, 3);
+  reach = reach_checker(std::get<1>(edge), std::get<0>(edge), 2, reader, costing, kOutbound);
+  EXPECT_EQ(reach.outbound, 2);
+  EXPECT_EQ(reach.inbound, 0);
+
+  // beyond it we expand the graph
+  reach = reach_checker(std::get<1>(edge), std::get<0>(edge), 50, reader, costing);
+  EXPECT_EQ(reach.outbound, 7);
+  EXPECT_EQ(reach.inbound, 7);
+
+  // as we do when the index should not be used
+  reach_checker.set_use_reach_index(false);
+  reach = reach_checker(std::get<1>(edge), std::get<0>(edge), 5, reader, costing);
+  EXPECT_EQ(reach.outbound, 5);
+  EXPECT_EQ(reach.inbound, 5);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,116 @@
+#include "region_router.h"
+
+#include <fstream>
+
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+// a square polygon region as it is configured
+boost::property_tree::ptree square(const std::string& name, double lon, double lat, double size) {
+  boost::property_tree::ptree ring;
+  for (const auto& corner : std::vector<std::pair<double, double>>{
+           {lon, lat}, {lon + size, lat}, {lon + size, lat + size}, {lon, lat + size}}) {
+    boost::property_tree::ptree point, x, y;
+    x.put_value(corner.first);
+    y.put_value(corner.second);
+    point.push_back({"", x});
+    point.push_back({"", y});
+    ring.push_back({"", point});
+  }
+  boost::property_tree::ptree region, polygons;
+  polygons.push_back({"", ring});
+  region.put("name", name);
+  region.put("url", "http://" + name + ":8002/");
+  region.add_child("polygons", polygons);
+  return region;
+}
+
+boost::property_tree::ptree make_config(const std::vector<boost::property_tree::ptree>& regions) {
+  boost::property_tree::ptree config, list;
+  for (const auto& region : regions) {
+    list.push_back({"", region});
+  }
+  config.add_child("router.regions", list);
+  config.put("router.fallback", "http://planet:8002");
+  return config;
+}
+
+// a route request between locations
+Api make_request(const std::vector<std::pair<double, double>>& locations) {
+  Api request;
+  request.mutable_options()->set_action(Options::route);
+  for (const auto& location : locations) {
+    auto* ll = request.mutable_options()->add_locations()->mutable_ll();
+    ll->set_lng(location.first);
+    ll->set_lat(location.second);
+  }
+  return request;
+}
+
+} // namespace
+
+TEST(RegionRouter, Polygons) {
+  region_router_t router(make_config({square("europe", 0, 40, 10), square("africa", 0, 0, 10)}));
+  ASSERT_EQ(router.regions().size(), 2);
+  EXPECT_EQ(router.regions()[0].url, "http://europe:8002");
+
+  // a request goes to the region that has all of its locations
+  EXPECT_EQ(router.route(make_request({{1, 41}, {9, 49}})).name, "europe");
+  EXPECT_EQ(router.route(make_request({{1, 1}, {5, 5}, {9, 9}})).name, "africa");
+
+  // requests between regions, outside of them or without locations go to the whole planet
+  EXPECT_EQ(router.route(make_request({{1, 41}, {1, 1}})).name, "fallback");
+  EXPECT_EQ(router.route(make_request({{1, 41}, {20, 41}})).name, "fallback");
+  EXPECT_EQ(router.route(make_request({})).name, "fallback");
+  EXPECT_EQ(router.fallback().url, "http://planet:8002");
+
+  // the sources and targets of a matrix count as well
+  Api matrix;
+  matrix.mutable_options()->set_action(Options::sources_to_targets);
+  matrix.mutable_options()->add_sources()->mutable_ll()->set_lat(5);
+  matrix.mutable_options()->mutable_sources(0)->mutable_ll()->set_lng(5);
+  matrix.mutable_options()->add_targets()->mutable_ll()->set_lat(45);
+  matrix.mutable_options()->mutable_targets(0)->mutable_ll()->set_lng(5);
+  EXPECT_EQ(router.route(matrix).name, "fallback");
+  matrix.mutable_options()->mutable_targets(0)->mutable_ll()->set_lat(6);
+  EXPECT_EQ(router.route(matrix).name, "africa");
+}
+
+TEST(RegionRouter, TileSet) {
+  // a tile set of two local tiles, the files are only listed so they can be empty
+  const std::string tile_dir = "test/data/region_router_tiles";
+  filesystem::remove_all(tile_dir);
+  const uint8_t level = TileHierarchy::levels().back().level;
+  const auto first = TileHierarchy::GetGraphId({5.1, 52.1}, level);
+  const auto second = TileHierarchy::GetGraphId({5.4, 52.1}, level);
+  for (const auto& id : {first, second}) {
+    const auto path = tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(id);
+    filesystem::create_directories(filesystem::path(path).parent_path());
+    std::ofstream(path).flush();
+  }
+
+  boost::property_tree::ptree utrecht;
+  utrecht.put("name", "utrecht");
+  utrecht.put("url", "http://utrecht:8002");
+  utrecht.put("tile_dir", tile_dir);
+  region_router_t router(make_config({utrecht}));
+
+  EXPECT_EQ(router.route(make_request({{5.1, 52.1}, {5.4, 52.1}})).name, "utrecht");
+  // the tiles east and north of them are not in the tile set
+  EXPECT_EQ(router.route(make_request({{5.1, 52.1}, {5.9, 52.1}})).name, "fallback");
+  EXPECT_EQ(router.route(make_request({{5.1, 52.1}, {5.1, 53.1}})).name, "fallback");
+}
+
+TEST(RegionRouter, NeedsCoverage) {
+  boost::property_tree::ptree empty;
+  empty.put("name", "nowhere");
+  empty.put("url", "http://nowhere:8002");
+  EXPECT_THROW(region_router_t(make_config({empty})), std::runtime_error);
+}
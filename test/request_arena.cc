@@ -0,0 +1,75 @@
+#include "worker.h"
+
+#include "test.h"
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree make_config(size_t bytes) {
+  boost::property_tree::ptree config;
+  config.put("httpd.service.request_arena_bytes", bytes);
+  return config;
+}
+
+// a trip with enough legs and shape to outgrow the kept block
+void fill(Api& request) {
+  request.mutable_options()->set_action(Options::route);
+  auto* route = request.mutable_trip()->add_routes();
+  for (int i = 0; i < 1000; ++i) {
+    auto* leg = route->add_legs();
+    leg->set_shape(std::string(100, 'x'));
+    leg->add_node()->mutable_edge()->add_name()->set_value("street");
+  }
+}
+
+TEST(RequestArena, OnArena) {
+  request_arena_t arena(make_config(1 << 16));
+  auto& request = arena.next();
+  EXPECT_NE(request.GetArena(), nullptr);
+  fill(request);
+  EXPECT_EQ(request.trip().routes(0).legs_size(), 1000);
+
+  // the next request starts out empty on the same arena
+  auto& next = arena.next();
+  EXPECT_EQ(next.GetArena(), request.GetArena());
+  EXPECT_FALSE(next.has_trip());
+  EXPECT_EQ(next.options().action(), Options::no_action);
+  fill(next);
+  EXPECT_EQ(next.trip().routes(0).legs(999).shape(), std::string(100, 'x'));
+  arena.reset();
+}
+
+TEST(RequestArena, OnHeap) {
+  request_arena_t arena(make_config(0));
+  auto& request = arena.next();
+  EXPECT_EQ(request.GetArena(), nullptr);
+  fill(request);
+  auto& next = arena.next();
+  EXPECT_FALSE(next.has_trip());
+}
+
+TEST(RequestArena, CopyOut) {
+  // what is copied or swapped out of a request outlives it
+  request_arena_t arena(make_config(1 << 16));
+  Api copy;
+  {
+    auto& request = arena.next();
+    fill(request);
+    copy = request;
+    Api swapped;
+    swapped.mutable_trip()->Swap(request.mutable_trip());
+    EXPECT_EQ(request.trip().routes_size(), 0);
+    arena.reset();
+    EXPECT_EQ(swapped.trip().routes(0).legs_size(), 1000);
+  }
+  EXPECT_EQ(copy.trip().routes(0).legs_size(), 1000);
+  EXPECT_EQ(copy.options().action(), Options::route);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,134 @@
+#include "result_cache.h"
+
+#include "test.h"
+
+using namespace valhalla;
+
+namespace {
+
+// lets the tests look at the traffic again without waiting a second
+struct testable_cache_t : public result_cache_t {
+  using result_cache_t::result_cache_t;
+  void recheck_traffic() {
+    traffic_checked = {};
+  }
+};
+
+// a route request from one location to another
+Api make_request(double lon, const std::string& id = "") {
+  Api request;
+  auto& options = *request.mutable_options();
+  options.set_action(Options::route);
+  options.set_costing_type(Costing::auto_);
+  options.add_locations()->mutable_ll()->set_lng(lon);
+  options.add_locations()->mutable_ll()->set_lng(lon + 1);
+  if (!id.empty()) {
+    options.set_id(id);
+  }
+  request.mutable_info()->set_cache_key(result_cache_t::key(request));
+  return request;
+}
+
+// the request with its results
+Api make_result(double lon, const std::string& id = "") {
+  auto result = make_request(lon, id);
+  result.mutable_trip()->add_routes()->add_legs()->set_shape(std::string(100, 'x'));
+  return result;
+}
+
+TEST(ResultCache, Key) {
+  // the id only changes how the results are serialized
+  EXPECT_EQ(result_cache_t::key(make_request(1)), result_cache_t::key(make_request(1, "a")));
+  EXPECT_NE(result_cache_t::key(make_request(1)), result_cache_t::key(make_request(2)));
+  EXPECT_NE(result_cache_t::key(make_request(1)), 0);
+}
+
+TEST(ResultCache, HitAndMiss) {
+  result_cache_t cache(1 << 20, std::chrono::seconds(300));
+
+  auto request = make_request(1, "second");
+  EXPECT_FALSE(cache.get(request));
+
+  cache.put(make_result(1, "first"));
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_GT(cache.bytes(), 100);
+
+  // a hit has the results of the first request with its own id
+  ASSERT_TRUE(cache.get(request));
+  EXPECT_EQ(request.trip().routes(0).legs(0).shape(), std::string(100, 'x'));
+  EXPECT_EQ(request.options().id(), "second");
+
+  // without an id it has none
+  auto no_id = make_request(1);
+  ASSERT_TRUE(cache.get(no_id));
+  EXPECT_FALSE(no_id.options().has_id_case());
+
+  // other locations miss and requests without a key are never cached
+  auto other = make_request(2);
+  EXPECT_FALSE(cache.get(other));
+  auto no_key = make_result(3);
+  no_key.mutable_info()->clear_cache_key();
+  cache.put(no_key);
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(ResultCache, Expires) {
+  result_cache_t cache(1 << 20, std::chrono::seconds(0));
+  cache.put(make_result(1));
+  auto request = make_request(1);
+  EXPECT_FALSE(cache.get(request));
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.bytes(), 0);
+}
+
+TEST(ResultCache, Budget) {
+  const auto result_bytes = make_result(1).ByteSizeLong();
+  result_cache_t cache(result_bytes * 2 + result_bytes / 2, std::chrono::seconds(300));
+  cache.put(make_result(1));
+  cache.put(make_result(2));
+
+  // using the first makes the second the least recently used one
+  auto first = make_request(1);
+  ASSERT_TRUE(cache.get(first));
+  cache.put(make_result(3));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_LE(cache.bytes(), result_bytes * 2 + result_bytes / 2);
+
+  auto second = make_request(2);
+  EXPECT_FALSE(cache.get(second));
+  first = make_request(1);
+  EXPECT_TRUE(cache.get(first));
+  auto third = make_request(3);
+  EXPECT_TRUE(cache.get(third));
+
+  // results larger than the budget are not kept
+  result_cache_t small(result_bytes - 1, std::chrono::seconds(300));
+  small.put(make_result(1));
+  EXPECT_EQ(small.size(), 0);
+}
+
+TEST(ResultCache, TrafficChange) {
+  testable_cache_t cache(1 << 20, std::chrono::seconds(300));
+  uint64_t traffic = 1;
+  auto version = [&traffic]() { return traffic; };
+
+  auto request = make_request(1);
+  EXPECT_FALSE(cache.get(request, version));
+  cache.put(make_result(1));
+  request = make_request(1);
+  EXPECT_TRUE(cache.get(request, version));
+
+  // new traffic drops the results computed with the old traffic
+  traffic = 2;
+  cache.recheck_traffic();
+  request = make_request(1);
+  EXPECT_FALSE(cache.get(request, version));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -212,6 +212,27 @@ TEST(Routing, TestRoutePathIterator) {
   EXPECT_EQ(it5, the_end) << "TestRoutePathIterator: wrong advance";
 }
 
+
+TEST(Routing, TestLabelSetReuse) {
+  meili::LabelSet labelset(100);
+  sif::TravelMode travelmode = static_cast<sif::TravelMode>(0);
+  baldr::DirectedEdge de;
+
+  labelset.put(0, travelmode, nullptr);
+  labelset.put(1, baldr::GraphId(), 0.f, 1.f, {5.f, 5.f}, 0.f, 5.f, 0, &de, travelmode, -1);
+  EXPECT_EQ(labelset.pop(), 0);
+  EXPECT_EQ(labelset.pop(), 1);
+
+  // a reused set starts over with the same destinations and a longer range
+  labelset.reuse(1000);
+  labelset.put(0, travelmode, nullptr);
+  labelset.put(1, baldr::GraphId(), 0.f, 1.f, {500.f, 500.f}, 0.f, 500.f, 0, &de, travelmode, -1);
+  EXPECT_EQ(labelset.pop(), 0);
+  EXPECT_EQ(labelset.pop(), 1);
+  EXPECT_EQ(labelset.label(1).predecessor(), 0);
+  EXPECT_EQ(labelset.pop(), baldr::kInvalidLabel);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -2,12 +2,14 @@
 #include "pixels.h"
 
 #include "baldr/compression_utils.h"
+#include "filesystem.h"
 #include "midgard/sequence.h"
 #include "midgard/util.h"
 
 #include <cmath>
 #include <fstream>
 #include <list>
+#include <thread>
 #include <lz4frame.h>
 
 #include "test.h"
@@ -118,6 +120,53 @@ TEST(Sample, getlz4) {
   _get("test/data/samplelz4");
 };
 
+TEST(Sample, threads) {
+  // the threads share the unpacked tiles, the first ones wait for it to be unpacked
+  skadi::sample s("test/data/samplelz4");
+  std::vector<std::pair<double, double>> postings = {{-76.503915, 40.678783},
+                                                     {-76.9, 40.0},
+                                                     {-76.537011, 40.729872}};
+  std::vector<std::vector<double>> heights(8);
+  std::vector<std::thread> threads;
+  for (auto& h : heights) {
+    threads.emplace_back([&s, &h, &postings]() {
+      for (int i = 0; i < 10; ++i) {
+        h = s.get_all(postings);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& h : heights) {
+    ASSERT_EQ(h.size(), postings.size());
+    EXPECT_NEAR(h[0], 490, 1.0);
+    EXPECT_NEAR(h[1], 134, 1.0);
+    EXPECT_EQ(h, heights.front());
+  }
+}
+
+TEST(Sample, raw_dir) {
+  // compressed tiles are stored raw once they were unpacked
+  const std::string raw_dir = "test/data/sample_raw";
+  filesystem::remove_all(raw_dir);
+  boost::property_tree::ptree config;
+  config.put("additional_data.elevation", "test/data/samplelz4");
+  config.put("additional_data.elevation_raw_dir", raw_dir);
+  {
+    skadi::sample s(config);
+    EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+  }
+  EXPECT_EQ(filesystem::directory_entry(raw_dir + "/N40/N40W077.hgt").file_size(),
+            3601 * 3601 * sizeof(int16_t));
+
+  // and used from there by the next sampler
+  skadi::sample s(config);
+  EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+  EXPECT_NEAR(134, s.get(std::make_pair(-76.9, 40.0)), 1.0);
+  filesystem::remove_all(raw_dir);
+}
+
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir) : sample(dir) {
     {
@@ -158,6 +207,39 @@ TEST(Sample, edges) {
   EXPECT_EQ(v, skadi::get_no_data_value()) << "Wrong value at location";
 }
 
+TEST(Sample, get_all_matches_get) {
+  // points going back and forth between the tile with data, its last row which has none and
+  // places without any tile, in bulk they have to come out as they do one by one
+  testable_sample_t s("/dev/null");
+  std::vector<std::pair<double, double>> postings;
+  const auto n = .5 / 3600;
+  for (int i = 0; i < 101; ++i) {
+    postings.emplace_back(-180. + n * (i % 13), -89. - n * (i % 7));
+    postings.emplace_back(-180. + n * (i % 5), -90.);
+    if (i % 10 == 0) {
+      postings.emplace_back(-179.5, -88.5);
+      postings.emplace_back(200., 200.);
+    }
+  }
+
+  const auto heights = s.get_all(postings);
+  ASSERT_EQ(heights.size(), postings.size());
+  for (size_t i = 0; i < postings.size(); ++i) {
+    EXPECT_NEAR(heights[i], s.get(postings[i]), 1e-9) << "Wrong value at posting " << i;
+  }
+
+  // and on a real tile
+  skadi::sample real("test/data/sample");
+  std::vector<midgard::PointLL> points;
+  for (int i = 0; i < 50; ++i) {
+    points.emplace_back(-76.537011 + i * 0.0007, 40.723872 + i * 0.0003);
+  }
+  const auto real_heights = real.get_all(points);
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_NEAR(real_heights[i], real.get(points[i]), 1e-9) << "Wrong value at point " << i;
+  }
+}
+
 TEST(Sample, lazy_load) {
   // make sure there is no data there
   { std::ofstream file("test/data/sample/N00/N00E000.hgt", std::ios::binary | std::ios::trunc); }
@@ -0,0 +1,63 @@
+import unittest
+
+import valhalla_bench_compare
+
+
+def results(name, times, labels=None, unit="ms"):
+    benchmarks = []
+    for i, time in enumerate(times):
+        benchmark = {
+            "name": name,
+            "run_name": name,
+            "run_type": "iteration",
+            "repetition_index": i,
+            "real_time": time,
+            "cpu_time": time,
+            "time_unit": unit,
+        }
+        if labels is not None:
+            benchmark["Labels"] = labels
+        benchmarks.append(benchmark)
+    # the aggregates are skipped
+    benchmarks.append(dict(benchmarks[0], name=name + "_mean", run_type="aggregate"))
+    return {"benchmarks": benchmarks}
+
+
+class TestBenchCompare(unittest.TestCase):
+    def test_mann_whitney_u(self):
+        # completely separated samples are significant, identical ones are not
+        separated = valhalla_bench_compare.mann_whitney_u(list(range(10)), list(range(10, 20)))
+        self.assertLess(separated, 0.001)
+        self.assertGreater(valhalla_bench_compare.mann_whitney_u([1.0] * 10, [1.0] * 10), 0.99)
+        self.assertEqual(valhalla_bench_compare.mann_whitney_u([1.0], [2.0, 3.0]), 1.0)
+
+    def test_regression(self):
+        baseline = results("BM_Route", [10 + i * 0.01 for i in range(10)], labels=100)
+        slower = results("BM_Route", [12 + i * 0.01 for i in range(10)], labels=100)
+        rows = valhalla_bench_compare.compare(baseline, slower, 0.05, 0.05, ["Labels"])
+        by_metric = {r["metric"]: r for r in rows}
+        self.assertTrue(by_metric["real_time"]["regression"])
+        self.assertTrue(by_metric["cpu_time"]["regression"])
+        self.assertAlmostEqual(by_metric["real_time"]["change"], 0.2, places=2)
+        self.assertFalse(by_metric["Labels"]["regression"])
+
+    def test_below_threshold_or_faster(self):
+        baseline = results("BM_Route", [10 + i * 0.01 for i in range(10)])
+        slightly = results("BM_Route", [10.2 + i * 0.01 for i in range(10)])
+        faster = results("BM_Route", [8 + i * 0.01 for i in range(10)])
+        for contender in (slightly, faster):
+            rows = valhalla_bench_compare.compare(baseline, contender, 0.05, 0.05, [])
+            self.assertFalse(any(r["regression"] for r in rows))
+
+    def test_units_and_counters(self):
+        # the same time in another unit is no change, more labels are a regression
+        baseline = results("BM_Route", [10 + i * 0.01 for i in range(10)], labels=100)
+        contender = results("BM_Route", [10000 + i * 10 for i in range(10)], labels=150, unit="us")
+        rows = valhalla_bench_compare.compare(baseline, contender, 0.05, 0.05, ["Labels"])
+        by_metric = {r["metric"]: r for r in rows}
+        self.assertAlmostEqual(by_metric["real_time"]["change"], 0.0)
+        self.assertTrue(by_metric["Labels"]["regression"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1 @@
+../../scripts/valhalla_bench_compare
\ No newline at end of file
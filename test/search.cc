@@ -1,4 +1,5 @@
 #include "loki/search.h"
+#include "loki/snap_cache.h"
 #include <cstdint>
 
 #include <boost/property_tree/ptree.hpp>
@@ -456,6 +457,41 @@ TEST(Search, test_search_cutoff) {
   search(x, 2, 0);
 }
 
+TEST(Search, test_snap_cache) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf);
+  const auto costing = create_costing();
+
+  boost::property_tree::ptree cache_conf;
+  cache_conf.put("size", 2);
+  SnapCache cache(cache_conf, reader);
+
+  Location x(a.second.PointAlongSegment(d.second));
+  x.street_side_max_distance_ = 5000;
+  const auto expected = Search({x}, reader, costing).at(x);
+
+  // the first search is a miss, the second is answered from the cache with the same edges
+  for (size_t i = 0; i < 2; ++i) {
+    const auto results = cache.Search({x}, reader, costing, "none");
+    const auto& p = results.at(x);
+    ASSERT_EQ(p.edges.size(), expected.edges.size());
+    EXPECT_TRUE(p.shares_edges(expected));
+    EXPECT_EQ(p.latlng_, x.latlng_);
+  }
+  EXPECT_EQ(cache.stats().misses, 1);
+  EXPECT_EQ(cache.stats().hits, 1);
+
+  // another costing and other search parameters are different entries
+  cache.Search({x}, reader, costing, "other");
+  Location y = x;
+  y.radius_ = 10;
+  cache.Search({y}, reader, costing, "none");
+  EXPECT_EQ(cache.stats().misses, 3);
+  EXPECT_EQ(cache.stats().evictions, 1);
+  EXPECT_EQ(cache.size(), 2);
+}
+
 } // namespace
 
 // Setup and tearown will be called only once for the entire suite121
@@ -70,6 +70,39 @@ TEST(Sequence, Iterator) {
   EXPECT_EQ(i.position(), 0) << "Pre-decrement operator wasn't right";
 }
 
+TEST(Sequence, Hints) {
+  // write behind with buffers of 100 elements, the last ones are still in flight when read
+  auto& hints = sequence_hints();
+  const auto defaults = hints;
+  hints.huge_pages = true;
+  hints.populate = true;
+  hints.write_behind = true;
+  {
+    sequence<osm_node> sequence("hinted.nd", true, 100);
+    for (uint64_t i = 0; i < 1050; ++i) {
+      sequence.push_back({1049 - i, 0.f, 0.f, 0});
+      ASSERT_EQ(sequence.size(), i + 1);
+    }
+    EXPECT_EQ((*sequence[1000]).id, 49);
+    sequence[1001] = osm_node{7, 0.f, 0.f, 1};
+    EXPECT_EQ((*sequence[1001]).attributes, 1);
+    sequence.sort([](const osm_node& a, const osm_node& b) { return a.id < b.id; });
+    EXPECT_EQ(sequence.size(), 1050);
+  }
+
+  // the file opened again is populated and read sequentially
+  sequence<osm_node> sequence("hinted.nd", false);
+  uint64_t count = 0, attributes = 0;
+  sequence.enumerate([&](const osm_node& node) {
+    attributes += node.attributes;
+    ++count;
+  });
+  EXPECT_EQ(count, 1050);
+  EXPECT_EQ(attributes, 1);
+  EXPECT_EQ((*sequence[1049]).id, 1049);
+  hints = defaults;
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,79 @@
+#include "baldr/shapecache.h"
+#include "midgard/encoded.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+const std::vector<PointLL> kShape = {{5.1, 52.1}, {5.2, 52.2}, {5.3, 52.1}};
+const std::vector<PointLL> kOtherShape = {{-73.9, 40.7}, {-73.8, 40.8}};
+
+TEST(ShapeCache, HitsAndDecodes) {
+  const auto encoded = encode7(kShape);
+  ShapeCache cache(16);
+
+  const auto before = ShapeCache::stats();
+  const auto first = cache.get(100, encoded.data(), encoded.size());
+  ASSERT_EQ(first->size(), kShape.size());
+  for (size_t i = 0; i < kShape.size(); ++i) {
+    EXPECT_TRUE(first->at(i).ApproximatelyEqual(kShape[i]));
+  }
+
+  // the second lookup of the same edge info shares the shape decoded by the first
+  const auto second = cache.get(100, encoded.data(), encoded.size());
+  EXPECT_EQ(first.get(), second.get());
+  const auto after = ShapeCache::stats();
+  EXPECT_EQ(after.decodes - before.decodes, 1u);
+  EXPECT_EQ(after.hits - before.hits, 1u);
+}
+
+TEST(ShapeCache, Replacement) {
+  const auto encoded = encode7(kShape);
+  const auto other_encoded = encode7(kOtherShape);
+
+  // with 2 slots some of these offsets share a slot, each lookup still gets its own shape and a
+  // shape that was replaced stays valid
+  ShapeCache cache(1);
+  std::vector<ShapeCache::Shape> shapes;
+  for (uint32_t offset = 0; offset < 64; offset += 8) {
+    const auto& shape = offset % 16 ? kOtherShape : kShape;
+    const auto& bytes = offset % 16 ? other_encoded : encoded;
+    shapes.push_back(cache.get(offset, bytes.data(), bytes.size()));
+    ASSERT_EQ(shapes.back()->size(), shape.size());
+  }
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    EXPECT_EQ(shapes[i]->size(), i % 2 ? kOtherShape.size() : kShape.size());
+  }
+}
+
+TEST(ShapeCache, Threads) {
+  const auto encoded = encode7(kShape);
+  ShapeCache cache(4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (uint32_t i = 0; i < 10000; ++i) {
+        auto shape = cache.get(i % 7, encoded.data(), encoded.size());
+        ASSERT_EQ(shape->size(), kShape.size());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include "baldr/sharedtilestore.h"
+
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// a segment of its own for every test so they dont see each others tiles
+class SharedStore : public ::testing::Test {
+protected:
+  void SetUp() override {
+    name = "/valhalla_test_" + std::to_string(getpid()) + "_" +
+           ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    SharedTileStore::Remove(name);
+  }
+  void TearDown() override {
+    SharedTileStore::Remove(name);
+  }
+  std::string name;
+};
+
+std::vector<char> make_tile(size_t size, char fill) {
+  return std::vector<char>(size, fill);
+}
+
+TEST_F(SharedStore, PutAndGet) {
+  SharedTileStore store(name, 1 << 20);
+  GraphId id(1, 2, 0);
+  EXPECT_EQ(store.Get(id), nullptr);
+
+  auto tile = make_tile(1000, 'a');
+  auto put = store.Put(id, tile.data(), tile.size());
+  ASSERT_NE(put, nullptr);
+  EXPECT_EQ(put->size, tile.size());
+  EXPECT_EQ(std::string(put->data, put->size), std::string(tile.begin(), tile.end()));
+
+  auto got = store.Get(id);
+  ASSERT_NE(got, nullptr);
+  EXPECT_EQ(got->data, put->data);
+
+  // putting it again hands back what is there
+  auto again = store.Put(id, tile.data(), tile.size());
+  EXPECT_EQ(again->data, put->data);
+
+  auto stats = store.GetStats();
+  EXPECT_EQ(stats.puts, 1);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+}
+
+TEST_F(SharedStore, EvictsUnpinned) {
+  // room for 4 tiles of 256 bytes
+  SharedTileStore store(name, 1024);
+  for (uint32_t i = 0; i < 8; ++i) {
+    auto tile = make_tile(256, 'a' + i);
+    EXPECT_NE(store.Put(GraphId(i, 2, 0), tile.data(), tile.size()), nullptr);
+  }
+  // the oldest were overwritten by the newest
+  for (uint32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(store.Get(GraphId(i, 2, 0)), nullptr);
+  }
+  for (uint32_t i = 4; i < 8; ++i) {
+    auto got = store.Get(GraphId(i, 2, 0));
+    ASSERT_NE(got, nullptr);
+    EXPECT_EQ(got->data[0], 'a' + i);
+  }
+  EXPECT_EQ(store.GetStats().evictions, 4);
+}
+
+TEST_F(SharedStore, KeepsPinned) {
+  SharedTileStore store(name, 1024);
+  auto tile = make_tile(256, 'p');
+  auto pinned = store.Put(GraphId(100, 2, 0), tile.data(), tile.size());
+  ASSERT_NE(pinned, nullptr);
+
+  // cycling through the ring goes around the pinned tile
+  for (uint32_t i = 0; i < 12; ++i) {
+    auto other = make_tile(256, 'o');
+    store.Put(GraphId(i, 2, 0), other.data(), other.size());
+  }
+  auto got = store.Get(GraphId(100, 2, 0));
+  ASSERT_NE(got, nullptr);
+  EXPECT_EQ(std::string(got->data, got->size), std::string(tile.begin(), tile.end()));
+
+  // a tile that does not fit is not shared
+  auto big = make_tile(2048, 'b');
+  EXPECT_EQ(store.Put(GraphId(200, 2, 0), big.data(), big.size()), nullptr);
+  EXPECT_EQ(store.GetStats().rejected, 1);
+}
+
+TEST_F(SharedStore, AcrossProcesses) {
+  auto tile = make_tile(4096, 'x');
+  {
+    SharedTileStore store(name, 1 << 20);
+    ASSERT_NE(store.Put(GraphId(7, 1, 0), tile.data(), tile.size()), nullptr);
+  }
+
+  // another process finds the tile and puts one of its own
+  pid_t child = fork();
+  if (child == 0) {
+    SharedTileStore store(name, 1 << 20);
+    auto got = store.Get(GraphId(7, 1, 0));
+    bool ok = got && std::string(got->data, got->size) == std::string(tile.begin(), tile.end());
+    auto mine = make_tile(100, 'c');
+    ok = ok && store.Put(GraphId(8, 1, 0), mine.data(), mine.size());
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  SharedTileStore store(name, 1 << 20);
+  auto got = store.Get(GraphId(8, 1, 0));
+  ASSERT_NE(got, nullptr);
+  EXPECT_EQ(std::string(got->data, got->size), std::string(100, 'c'));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,6 +1,7 @@
 #include "loki/worker.h"
 #include "pixels.h"
 #include "test.h"
+#include "tyr/serializers.h"
 
 #include <boost/property_tree/ptree.hpp>
 #include <prime_server/http_protocol.hpp>
@@ -73,8 +74,32 @@ const std::vector<http_request_t> requests{
         "IxaIcF~|@cBngJiMjj@_I`HwXlJuO^kKj@gJkAeaBy`AgNoHwDkAeELwD|@uDfC_i@bq@mOjUaCvDqBrEcAbGWbG|@"
         "jVd@rPkAbGsAfDqBvCaIrFsP~RoNjWajBlnD{OtZoNfXyBtE{B~HyAtEsFhL_DvDsGrF_I`HwDpGoH|T_"
         "IzLaMzKuOrFqfAbPwCl@_h@fN}OnI\"}"),
+    http_request_t(
+        POST,
+        "/height",
+        "{\"range\":true,\"format\":\"binary\",\"shape\":[{\"lat\":40.712431, "
+        "\"lon\":-76.504916},{\"lat\":40.712275, \"lon\":-76.605259},{\"lat\":40.712122, "
+        "\"lon\":-76.805694},{\"lat\":40.722431, \"lon\":-76.884916},{\"lat\":40.812275, "
+        "\"lon\":-76.905259},{\"lat\":40.912122, \"lon\":-76.965694}]}"),
 };
 
+// the binary response of a profile that wasn't resampled
+std::string binary_profile(const std::vector<int32_t>& heights,
+                           const std::vector<uint32_t>& ranges) {
+  std::string bytes("VHGT", 4);
+  tyr::write_le(bytes, static_cast<uint8_t>(1));
+  tyr::write_le(bytes, static_cast<uint8_t>(ranges.empty() ? 0 : 2));
+  tyr::write_le(bytes, static_cast<uint16_t>(0));
+  tyr::write_le(bytes, static_cast<uint32_t>(heights.size()));
+  for (const auto height : heights) {
+    tyr::write_le(bytes, height);
+  }
+  for (const auto range : ranges) {
+    tyr::write_le(bytes, range);
+  }
+  return bytes;
+}
+
 const std::vector<std::string> responses{
     std::string(
         "{\"shape\":[{\"lat\":40.712431,\"lon\":-76.504916},{\"lat\":40.712275,\"lon\":-76.605259},"
@@ -153,11 +178,14 @@ const std::vector<std::string> responses{
         "320,322,323,324,328,359,445,452,463,463,448,405,393,336,329,326,316,311,309,308,289,291,"
         "292,292,291,289,278,279,279,280,281,281,280,281,281,282,282,282,280,276,251,248,247,246,"
         "244,243,240,239,239,238,239,241,241,239,236,221,221,225,224]}"),
+    binary_profile({307, 272, 204, 204, 180, 198}, {0, 8467, 25380, 32162, 42309, 54533}),
 };
 
-const auto config =
-    test::make_config(VALHALLA_BUILD_DIR "test" +
-                      std::string(1, filesystem::path::preferred_separator) + "skadi_service_tmp");
+// the requests ask for the same shapes more than once so some are answered from the cache
+const auto config = test::make_config(VALHALLA_BUILD_DIR "test" +
+                                         std::string(1, filesystem::path::preferred_separator) +
+                                         "skadi_service_tmp",
+                                     {{"loki.height_cache.size", "1000"}});
 
 void create_tile() {
   // its annoying to have to get actual data but its also very boring to test with fake data
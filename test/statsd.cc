@@ -42,6 +42,9 @@ public:
     }
     return e;
   }
+  void enqueue(Api& request) {
+    service_worker_t::enqueue_statistics(request);
+  }
   void stop_server() {
     Api request;
     auto* stat = request.mutable_info()->add_statistics();
@@ -93,3 +96,50 @@ TEST(statsd, errors_and_warnings) {
         << "Could not find key " << expected[i] << " in stat " << messages[i];
   }
 }
+
+TEST(statsd, metrics) {
+  // a request that ran a phase twice and counted some tiles
+  Api request;
+  request.mutable_options()->set_action(Options::route);
+  add_timing(request, "thor", "expansion", 3);
+  add_timing(request, "thor", "expansion", 4);
+  add_count(request, "thor", "tiles_fetched", 10);
+
+  // the worker keeps its statistics for the status of the process
+  boost::property_tree::ptree config;
+  test_worker_t worker(config);
+  auto& metrics = service_metrics_t::get();
+  worker.enqueue(request);
+  add_timing(request, "thor", "expansion", 5000);
+  worker.enqueue(request);
+
+  Status status;
+  metrics.fill(status);
+  ASSERT_EQ(status.metric_bucket_bounds_size(), service_metrics_t::kBucketBounds.size());
+
+  const Metric* expansion = nullptr;
+  const Metric* tiles = nullptr;
+  for (const auto& metric : status.metrics()) {
+    if (metric.key() == "route.info.thor.expansion.latency_ms")
+      expansion = &metric;
+    if (metric.key() == "route.info.thor.tiles_fetched")
+      tiles = &metric;
+  }
+  ASSERT_NE(expansion, nullptr);
+  ASSERT_NE(tiles, nullptr);
+
+  // the times of a phase add up per request and go in the bucket of the total
+  EXPECT_EQ(expansion->type(), timing);
+  EXPECT_EQ(expansion->requests(), 2);
+  EXPECT_DOUBLE_EQ(expansion->sum(), 7 + 5007);
+  EXPECT_DOUBLE_EQ(expansion->max(), 5007);
+  ASSERT_EQ(expansion->buckets_size(), service_metrics_t::kBucketBounds.size() + 1);
+  EXPECT_EQ(expansion->buckets(3), 1);  // up to 10ms
+  EXPECT_EQ(expansion->buckets(12), 1); // up to 10s
+
+  // counts only have totals
+  EXPECT_EQ(tiles->type(), count);
+  EXPECT_EQ(tiles->requests(), 2);
+  EXPECT_DOUBLE_EQ(tiles->sum(), 20);
+  EXPECT_EQ(tiles->buckets_size(), 0);
+}
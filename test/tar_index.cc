@@ -8,7 +8,10 @@ namespace vb = valhalla::baldr;
 class TestGraphReader : vb::GraphReader {
 public:
   using vb::GraphReader::GetGraphTile;
+  using vb::GraphReader::GetTileSet;
+  using vb::GraphReader::GetTileSetEpoch;
   using vb::GraphReader::GraphReader;
+  using vb::GraphReader::SwitchTileSet;
   using vb::GraphReader::tile_extract_;
 };
 
@@ -37,3 +40,90 @@ TEST(TarIndexer, CheckScanTar) {
 
   ASSERT_NE(reader_tar.tile_extract_->checksum, 0);
 }
+
+TEST(TarIndexer, IndexSkipsTarContents) {
+  // with an index the tar doesnt need to know about every single tile
+  TestGraphReader reader_tar(config_tar.get_child("mjolnir"));
+  ASSERT_EQ(reader_tar.tile_extract_->archive->contents.size(), 1);
+  ASSERT_FALSE(reader_tar.tile_extract_->tiles.empty());
+}
+
+TEST(TarIndexer, ExtractAdvice) {
+  auto config = config_tar;
+  config.put("mjolnir.tile_extract_advice.highway", "willneed");
+  config.put("mjolnir.tile_extract_advice.local", "random");
+  TestGraphReader reader_tar(config.get_child("mjolnir"));
+  GraphReader reader_dir(config_dir.get_child("mjolnir"));
+
+  // the advice doesnt change what we read
+  for (const auto& tile_id : reader_dir.GetTileSet()) {
+    auto dir_tile = reader_dir.GetGraphTile(tile_id);
+    auto tar_tile = reader_tar.GetGraphTile(tile_id);
+    ASSERT_EQ(dir_tile->header()->end_offset(), tar_tile->header()->end_offset());
+  }
+
+  config.put("mjolnir.tile_extract_advice.local", "sometimes");
+  EXPECT_THROW(TestGraphReader(config.get_child("mjolnir")), std::runtime_error);
+}
+
+TEST(TarIndexer, ExtractPread) {
+  auto config = config_tar;
+  config.put("mjolnir.tile_extract_pread", true);
+  TestGraphReader reader_pread(config.get_child("mjolnir"));
+  TestGraphReader reader_tar(config_tar.get_child("mjolnir"));
+  ASSERT_NE(reader_pread.tile_extract_->fd, -1);
+  ASSERT_EQ(reader_tar.tile_extract_->fd, -1);
+
+  // the tiles are the same bytes but no longer point into the mmap
+  const auto* begin = reader_pread.tile_extract_->archive->mm.get();
+  const auto* end = begin + reader_pread.tile_extract_->archive->mm.size();
+  for (const auto& tile_id : reader_tar.GetTileSet()) {
+    auto pread_tile = reader_pread.GetGraphTile(tile_id);
+    auto tar_tile = reader_tar.GetGraphTile(tile_id);
+    const auto* data = reinterpret_cast<const char*>(pread_tile->header());
+    EXPECT_TRUE(data < begin || data >= end);
+    ASSERT_EQ(pread_tile->header()->end_offset(), tar_tile->header()->end_offset());
+    ASSERT_EQ(memcmp(data, reinterpret_cast<const char*>(tar_tile->header()),
+                     tar_tile->header()->end_offset()),
+              0);
+  }
+}
+
+TEST(TarIndexer, SwitchTileSet) {
+  TestGraphReader reader(config_tar.get_child("mjolnir"));
+  const auto tile_id = *reader.GetTileSet().begin();
+  auto old_tile = reader.GetGraphTile(tile_id);
+  std::weak_ptr<valhalla::midgard::tar> old_archive = reader.tile_extract_->archive;
+
+  // nothing changes for the reader until it switches
+  const auto epoch = vb::GraphReader::PublishTileSet(config_tar.get_child("mjolnir"));
+  ASSERT_GT(epoch, 0);
+  EXPECT_EQ(reader.GetTileSetEpoch(), epoch - 1);
+  EXPECT_EQ(reader.tile_extract_->archive, old_archive.lock());
+
+  ASSERT_TRUE(reader.SwitchTileSet());
+  EXPECT_EQ(reader.GetTileSetEpoch(), epoch);
+  EXPECT_FALSE(reader.SwitchTileSet());
+  EXPECT_NE(reader.tile_extract_->archive, old_archive.lock());
+
+  // the tile of the old set is still good until it is let go of, and with it the old extract
+  auto new_tile = reader.GetGraphTile(tile_id);
+  ASSERT_NE(new_tile, old_tile);
+  ASSERT_EQ(memcmp(reinterpret_cast<const char*>(old_tile->header()),
+                   reinterpret_cast<const char*>(new_tile->header()), sizeof(vb::GraphTileHeader)),
+            0);
+  EXPECT_FALSE(old_archive.expired());
+  old_tile.reset();
+  EXPECT_TRUE(old_archive.expired());
+
+  // readers made after the publish start on the published tile set
+  TestGraphReader later(config_tar.get_child("mjolnir"));
+  EXPECT_EQ(later.GetTileSetEpoch(), epoch);
+  EXPECT_FALSE(later.SwitchTileSet());
+
+  // an extract without tiles is not published
+  auto config = config_tar;
+  config.put("mjolnir.tile_extract", "test/data/does_not_exist.tar");
+  EXPECT_EQ(vb::GraphReader::PublishTileSet(config.get_child("mjolnir")), 0);
+  EXPECT_FALSE(reader.SwitchTileSet());
+}
@@ -145,7 +145,10 @@ boost::property_tree::ptree make_config(const std::string& path_prefix,
           "transit_available",
           "expansion",
           "centroid",
-          "status"
+          "status",
+          "route_batch",
+          "isochrone_batch",
+          "tile"
         ],
         "logging": {
           "color": false,
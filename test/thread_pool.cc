@@ -0,0 +1,118 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct pool_test_t {
+  pool_test_t() : reader(boost::property_tree::ptree{}), pool(3, boost::property_tree::ptree{}) {
+  }
+  GraphReader reader;
+  thread_pool_t pool;
+};
+
+} // namespace
+
+TEST(ThreadPool, RunsEveryTaskOnce) {
+  pool_test_t test;
+  ASSERT_EQ(test.pool.size(), 3);
+  std::vector<std::atomic<uint32_t>> runs(1000);
+  std::vector<size_t> slots(runs.size());
+  test.pool.run(runs.size(),
+                [&](const size_t i, const size_t slot, GraphReader&) {
+                  ++runs[i];
+                  slots[i] = slot;
+                },
+                test.reader);
+  for (const auto& run : runs) {
+    EXPECT_EQ(run.load(), 1);
+  }
+  EXPECT_LT(*std::max_element(slots.begin(), slots.end()), 4);
+
+  // a job may be kept to fewer threads, the calling one is always there
+  test.pool.run(runs.size(),
+                [&](const size_t i, const size_t slot, GraphReader&) { slots[i] = slot; },
+                test.reader, nullptr, 2);
+  EXPECT_LT(*std::max_element(slots.begin(), slots.end()), 2);
+  test.pool.run(runs.size(),
+                [&](const size_t i, const size_t slot, GraphReader&) { slots[i] = slot; },
+                test.reader, nullptr, 1);
+  EXPECT_EQ(std::set<size_t>(slots.begin(), slots.end()), std::set<size_t>{0});
+}
+
+TEST(ThreadPool, Errors) {
+  pool_test_t test;
+  std::atomic<uint32_t> started(0);
+  EXPECT_THROW(test.pool.run(1000,
+                             [&](const size_t i, const size_t, GraphReader&) {
+                               ++started;
+                               if (i == 10) {
+                                 throw std::runtime_error("failed");
+                               }
+                             },
+                             test.reader),
+               std::runtime_error);
+  // no more tasks are started once one failed
+  EXPECT_LT(started.load(), 1000);
+
+  // the interrupt stops the job as well
+  uint32_t interrupts = 0;
+  const std::function<void()> interrupt = [&interrupts]() {
+    if (++interrupts == 5) {
+      throw std::runtime_error("interrupted");
+    }
+  };
+  EXPECT_THROW(test.pool.run(1000, [](const size_t, const size_t, GraphReader&) {}, test.reader,
+                             &interrupt, 1),
+               std::runtime_error);
+  EXPECT_EQ(interrupts, 5);
+
+  // and the pool works on the next job as usual
+  std::atomic<uint32_t> done(0);
+  test.pool.run(100, [&](const size_t, const size_t, GraphReader&) { ++done; }, test.reader);
+  EXPECT_EQ(done.load(), 100);
+}
+
+TEST(ThreadPool, SharedByJobs) {
+  pool_test_t test;
+  // jobs of several threads and jobs of tasks all finish, even when the pool is busy with others
+  std::atomic<uint32_t> done(0);
+  std::vector<std::thread> requests;
+  for (int r = 0; r < 4; ++r) {
+    requests.emplace_back([&]() {
+      GraphReader reader(boost::property_tree::ptree{});
+      test.pool.run(50,
+                    [&](const size_t, const size_t, GraphReader& task_reader) {
+                      test.pool.run(10,
+                                    [&](const size_t, const size_t, GraphReader&) { ++done; },
+                                    task_reader);
+                    },
+                    reader);
+    });
+  }
+  for (auto& request : requests) {
+    request.join();
+  }
+  EXPECT_EQ(done.load(), 4 * 50 * 10);
+}
+
+TEST(ThreadPool, Shared) {
+  boost::property_tree::ptree config;
+  config.put("thread_pool.threads", 2);
+  config.put_child("mjolnir", {});
+  auto pool = thread_pool_t::shared(config);
+  EXPECT_EQ(pool->size(), 2);
+  EXPECT_EQ(thread_pool_t::shared(config), pool);
+}
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
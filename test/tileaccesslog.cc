@@ -0,0 +1,149 @@
+#include "baldr/tileaccesslog.h"
+#include "filesystem.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string kLogFile = "test/data/tile_access.log";
+
+class TileAccessLogTest : public testing::Test {
+protected:
+  void SetUp() override {
+    filesystem::remove(kLogFile);
+  }
+  void TearDown() override {
+    filesystem::remove(kLogFile);
+  }
+};
+
+TEST_F(TileAccessLogTest, MostAccessedFirst) {
+  const GraphId a(100, 2, 0), b(5, 1, 0), c(7, 0, 0);
+  {
+    TileAccessLog log(kLogFile, std::chrono::seconds(300));
+    log.Add({{a, 3}, {b, 10}});
+    log.Add({{c, 5}, {a, 4}});
+    ASSERT_TRUE(log.Write());
+  }
+
+  const auto tiles = TileAccessLog::Read(kLogFile);
+  ASSERT_EQ(tiles.size(), 3);
+  EXPECT_EQ(tiles[0].tile_id, b.value);
+  EXPECT_EQ(tiles[0].count, 10);
+  EXPECT_EQ(tiles[1].tile_id, a.value);
+  EXPECT_EQ(tiles[1].count, 7);
+  EXPECT_EQ(tiles[2].tile_id, c.value);
+  EXPECT_EQ(tiles[2].count, 5);
+}
+
+TEST_F(TileAccessLogTest, OldCountsFade) {
+  const GraphId a(100, 2, 0), b(5, 1, 0), c(7, 0, 0);
+  {
+    TileAccessLog log(kLogFile, std::chrono::seconds(300));
+    log.Add({{a, 20}, {b, 1}});
+  }
+  {
+    // the next process halves what it finds and drops what was only seen once
+    TileAccessLog log(kLogFile, std::chrono::seconds(300));
+    log.Add({{c, 15}});
+  }
+
+  const auto tiles = TileAccessLog::Read(kLogFile);
+  ASSERT_EQ(tiles.size(), 2);
+  EXPECT_EQ(tiles[0].tile_id, c.value);
+  EXPECT_EQ(tiles[0].count, 15);
+  EXPECT_EQ(tiles[1].tile_id, a.value);
+  EXPECT_EQ(tiles[1].count, 10);
+}
+
+TEST_F(TileAccessLogTest, WritesWhenDue) {
+  TileAccessLog log(kLogFile, std::chrono::seconds(0));
+  log.Add({{GraphId(1, 0, 0), 1}});
+  EXPECT_EQ(TileAccessLog::Read(kLogFile).size(), 1);
+}
+
+TEST_F(TileAccessLogTest, CacheMisses) {
+  const GraphId a(100, 2, 0), b(5, 1, 0), c(7, 1, 0);
+  {
+    TileAccessLog log(kLogFile, std::chrono::seconds(300));
+    log.Add({{a, 8}, {b, 10}}, {{a, 6}});
+    log.Add({{c, 4}}, {{c, 1}, {a, 2}});
+
+    // what is counted so far is there before it is written
+    const auto counts = log.Counts();
+    ASSERT_EQ(counts.size(), 3);
+    EXPECT_EQ(counts[0].tile_id, b.value);
+    EXPECT_EQ(counts[0].misses, 0);
+    EXPECT_EQ(counts[1].tile_id, a.value);
+    EXPECT_EQ(counts[1].misses, 8);
+  }
+
+  // the misses are written and fade like the accesses
+  const auto tiles = TileAccessLog::Read(kLogFile);
+  ASSERT_EQ(tiles.size(), 3);
+  EXPECT_EQ(tiles[1].count, 8);
+  EXPECT_EQ(tiles[1].misses, 8);
+  {
+    TileAccessLog log(kLogFile, std::chrono::seconds(300));
+    const auto counts = log.Counts();
+    ASSERT_EQ(counts.size(), 3);
+    EXPECT_EQ(counts[1].tile_id, a.value);
+    EXPECT_EQ(counts[1].misses, 4);
+  }
+
+  // summed up per level
+  const auto levels = TileAccessLog::ByLevel(tiles);
+  ASSERT_EQ(levels.size(), 2);
+  EXPECT_EQ(levels[0].level, 1);
+  EXPECT_EQ(levels[0].tiles, 2);
+  EXPECT_EQ(levels[0].count, 14);
+  EXPECT_EQ(levels[0].misses, 1);
+  EXPECT_EQ(levels[1].level, 2);
+  EXPECT_EQ(levels[1].tiles, 1);
+  EXPECT_EQ(levels[1].count, 8);
+  EXPECT_EQ(levels[1].misses, 8);
+}
+
+TEST_F(TileAccessLogTest, ReadsVersion1) {
+  // written before the misses were counted
+  {
+    std::ofstream file(kLogFile, std::ios::binary);
+    TileAccessLogHeader header{};
+    std::memcpy(header.magic, kTileAccessLogMagic, sizeof(kTileAccessLogMagic));
+    header.version = 1;
+    header.tile_count = 2;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const uint64_t records[] = {GraphId(3, 2, 0).value, 9, GraphId(4, 2, 0).value, 5};
+    file.write(reinterpret_cast<const char*>(records), sizeof(records));
+  }
+  const auto tiles = TileAccessLog::Read(kLogFile);
+  ASSERT_EQ(tiles.size(), 2);
+  EXPECT_EQ(tiles[0].tile_id, GraphId(3, 2, 0).value);
+  EXPECT_EQ(tiles[0].count, 9);
+  EXPECT_EQ(tiles[0].misses, 0);
+  EXPECT_EQ(tiles[1].tile_id, GraphId(4, 2, 0).value);
+  EXPECT_EQ(tiles[1].count, 5);
+}
+
+TEST_F(TileAccessLogTest, Invalid) {
+  EXPECT_TRUE(TileAccessLog::Read(kLogFile).empty());
+  {
+    std::ofstream file(kLogFile);
+    file << "not a tile access log";
+  }
+  EXPECT_TRUE(TileAccessLog::Read(kLogFile).empty());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -4,6 +4,11 @@
 
 #include "test.h"
 
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <vector>
+
 #include <boost/property_tree/ptree.hpp>
 
 using namespace std;
@@ -69,6 +74,72 @@ TEST(TileHierarchy, parent) {
   EXPECT_EQ(invalid, GraphId(kInvalidGraphId));
 }
 
+// random positions around and just outside of the world along with the edges of the tiles
+std::vector<PointLL> TestPoints() {
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> lng(-181, 181), lat(-91, 91);
+  std::vector<PointLL> points;
+  for (size_t i = 0; i < 100000; ++i) {
+    points.emplace_back(lng(generator), lat(generator));
+  }
+  for (double x : {-180., -179.9999999, -1e-9, 0., 179.99999999, std::nextafter(180., 0.), 180.}) {
+    for (double y : {-90.0000001, -90., -1e-9, 0., 89.9999999, std::nextafter(90., 0.), 90.}) {
+      points.emplace_back(x, y);
+    }
+  }
+  for (int i = -720; i <= 720; ++i) {
+    points.emplace_back(i * .25, i * .125);
+    points.emplace_back(std::nextafter(i * .25, -180.), std::nextafter(i * .125, -90.));
+  }
+  return points;
+}
+
+template <uint8_t level> void CompareLevelTiling(const std::vector<PointLL>& points) {
+  const auto& tiles = TileHierarchy::levels()[level].tiles;
+  EXPECT_EQ(LevelTiling<level>::kColumns, tiles.ncolumns());
+  EXPECT_EQ(LevelTiling<level>::kRows, tiles.nrows());
+  for (const auto& point : points) {
+    const auto tile_id = tiles.TileId(point);
+    ASSERT_EQ(LevelTiling<level>::TileId(point), tile_id)
+        << std::setprecision(17) << point.lng() << "," << point.lat() << " on level " << int(level);
+    if (tile_id >= 0) {
+      const auto base = LevelTiling<level>::Base(tile_id);
+      EXPECT_EQ(base.lng(), tiles.Base(tile_id).lng());
+      EXPECT_EQ(base.lat(), tiles.Base(tile_id).lat());
+    }
+  }
+}
+
+TEST(TileHierarchy, LevelTiling) {
+  const auto points = TestPoints();
+  CompareLevelTiling<0>(points);
+  CompareLevelTiling<1>(points);
+  CompareLevelTiling<2>(points);
+}
+
+TEST(TileHierarchy, GetGraphIds) {
+  const auto points = TestPoints();
+  std::vector<GraphId> ids(points.size());
+  for (uint8_t level = 0; level <= TileHierarchy::get_max_level() + 1; ++level) {
+    TileHierarchy::GetGraphIds(points.data(), points.size(), level, ids.data());
+    for (size_t i = 0; i < points.size(); ++i) {
+      // what the tiling of the level gives at runtime
+      GraphId expected;
+      if (level < TileHierarchy::levels().size()) {
+        const auto tile_id = TileHierarchy::levels()[level].tiles.TileId(points[i]);
+        if (tile_id >= 0) {
+          expected = GraphId(tile_id, level, 0);
+        }
+      }
+      ASSERT_EQ(TileHierarchy::GetGraphId(points[i], level), expected);
+      ASSERT_EQ(ids[i], expected);
+    }
+  }
+
+  EXPECT_EQ(TileHierarchy::GetGraphId<2>(PointLL(-76.5, 40.5)), GraphId(522 * 1440 + 414, 2, 0));
+  EXPECT_FALSE(TileHierarchy::GetGraphId<0>(PointLL(180.5, 0)).Is_Valid());
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,107 @@
+#include "baldr/tileprefetcher.h"
+#include "baldr/tilehierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+TEST(TilePrefetcher, Corridor) {
+  const PointLL origin(5.1, 52.1), destination(6.9, 52.3);
+  auto narrow = TilePrefetcher::Corridor(origin, destination, 1);
+  auto wide = TilePrefetcher::Corridor(origin, destination, 50);
+  EXPECT_GT(wide.size(), narrow.size());
+
+  // the tiles of both ends and of every level are in it
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& point : {origin, destination}) {
+      auto tile_id = TileHierarchy::GetGraphId(point, level.level);
+      EXPECT_NE(std::find(narrow.begin(), narrow.end(), tile_id), narrow.end());
+    }
+  }
+
+  // the tiles closest to either end come first
+  auto closest = [&](const GraphId& tile_id) {
+    auto center = TileHierarchy::levels()[tile_id.level()].tiles.Center(tile_id.tileid());
+    return std::min(center.Distance(origin), center.Distance(destination));
+  };
+  for (size_t i = 1; i < wide.size(); ++i) {
+    EXPECT_LE(closest(wide[i - 1]), closest(wide[i]));
+  }
+}
+
+TEST(TilePrefetcher, Enqueue) {
+  TilePrefetcher prefetcher(2);
+  std::atomic<int> fetched{0};
+  auto fetch = [&fetched]() {
+    ++fetched;
+    return true;
+  };
+  auto missing = [&fetched]() {
+    ++fetched;
+    return false;
+  };
+
+  prefetcher.Enqueue(GraphId(1, 2, 0), fetch);
+  prefetcher.Enqueue(GraphId(2, 2, 0), missing);
+  prefetcher.Wait();
+  EXPECT_EQ(fetched, 2);
+
+  // tiles that were warmed may need it again, the ones that dont exist are not tried again
+  prefetcher.Enqueue(GraphId(1, 2, 0), fetch);
+  prefetcher.Enqueue(GraphId(2, 2, 0), fetch);
+  prefetcher.Wait();
+  EXPECT_EQ(fetched, 3);
+}
+
+TEST(TilePrefetcher, IsPending) {
+  TilePrefetcher prefetcher(1);
+  std::mutex gate;
+  gate.lock();
+  std::atomic<bool> started{false};
+  prefetcher.Enqueue(GraphId(1, 2, 0), [&]() {
+    started = true;
+    std::lock_guard<std::mutex> wait(gate);
+    return true;
+  });
+  prefetcher.Enqueue(GraphId(2, 2, 0), []() { return true; });
+
+  // pending while being warmed and while queued behind it
+  while (!started) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(prefetcher.IsPending(GraphId(1, 2, 0)));
+  EXPECT_TRUE(prefetcher.IsPending(GraphId(2, 2, 0)));
+  EXPECT_FALSE(prefetcher.IsPending(GraphId(3, 2, 0)));
+
+  gate.unlock();
+  prefetcher.Wait();
+  EXPECT_FALSE(prefetcher.IsPending(GraphId(1, 2, 0)));
+  EXPECT_FALSE(prefetcher.IsPending(GraphId(2, 2, 0)));
+}
+
+TEST(TilePrefetcher, Disabled) {
+  boost::property_tree::ptree config;
+  EXPECT_EQ(TilePrefetcher::shared(config), nullptr);
+
+  // the readers of a process share one
+  config.put("tile_prefetch.max_in_flight", 1);
+  auto prefetcher = TilePrefetcher::shared(config);
+  ASSERT_NE(prefetcher, nullptr);
+  EXPECT_EQ(TilePrefetcher::shared(config), prefetcher);
+  EXPECT_EQ(prefetcher->tile_getter(), nullptr);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
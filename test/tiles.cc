@@ -5,6 +5,7 @@
 #include "midgard/util.h"
 
 #include <array>
+#include <iomanip>
 #include <random>
 
 #include "test.h"
@@ -59,6 +60,43 @@ TEST(Tiles, TestRowCol) {
   EXPECT_EQ(tileid1, tileid2) << "TileId does not match using row,col";
 }
 
+TEST(Tiles, TestTileIds) {
+  // points all over and just around the world, on the tile edges and ones that only cross an edge
+  // when rounded to float
+  Tiles<PointLL> tiles(AABB2<PointLL>(PointLL(-180, -90), PointLL(180, 90)), .25);
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> lng(-181, 181), lat(-91, 91);
+  std::uniform_int_distribution<int> edge(-720, 720);
+  std::vector<PointLL> points;
+  for (int i = 0; i < 1001; ++i) {
+    points.emplace_back(lng(generator), lat(generator));
+    points.emplace_back(edge(generator) * .25, edge(generator) * .125);
+    points.emplace_back(edge(generator) * .25 - 1e-9, edge(generator) * .125 + 1e-9);
+  }
+  points.emplace_back(180, 90);
+  points.emplace_back(-180, -90);
+  points.emplace_back(180 + 1e-9, 0);
+
+  std::vector<int32_t> ids;
+  tiles.TileIds(points, ids);
+  ASSERT_EQ(ids.size(), points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(ids[i], tiles.TileId(points[i])) << std::setprecision(17) << points[i].lng() << ","
+                                               << points[i].lat();
+  }
+
+  // and in a grid of its own where the points aren't doubles
+  Tiles<Point2> grid(AABB2<Point2>(Point2(-10, -10), Point2(10, 10)), 3);
+  std::vector<Point2> grid_points;
+  for (int i = 0; i < 100; ++i) {
+    grid_points.emplace_back(lng(generator) / 15, lat(generator) / 8);
+  }
+  grid.TileIds(grid_points, ids);
+  for (size_t i = 0; i < grid_points.size(); ++i) {
+    EXPECT_EQ(ids[i], grid.TileId(grid_points[i]));
+  }
+}
+
 TEST(Tiles, TestTileBounds) {
   Tiles tiles(AABB2(PointLL(-180, -90), PointLL(180, 90)), 1);
   auto n_tiles = tiles.ncolumns() * tiles.nrows();
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "baldr/graphid.h"
+#include "mjolnir/tileextract.h"
+#include "mjolnir/tilescheduler.h"
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+std::vector<GraphId> make_tiles(const uint32_t count) {
+  std::vector<GraphId> tiles;
+  for (uint32_t i = 0; i < count; ++i) {
+    tiles.emplace_back(i, 2, 0);
+  }
+  return tiles;
+}
+
+// the higher the tile id the costlier the tile
+uint64_t by_id(const GraphId& tile_id) {
+  return tile_id.tileid();
+}
+
+TEST(TileScheduler, CostliestFirst) {
+  TileScheduler scheduler("test", make_tiles(100), 1, by_id);
+  EXPECT_EQ(scheduler.workers(), 1);
+  EXPECT_EQ(scheduler.size(), 100);
+
+  GraphId tile_id;
+  std::vector<uint32_t> order;
+  while (scheduler.Next(0, tile_id)) {
+    order.push_back(tile_id.tileid());
+  }
+  ASSERT_EQ(order.size(), 100);
+  for (size_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(order[i], 99 - i);
+  }
+  EXPECT_EQ(scheduler.steals(), 0);
+  EXPECT_THROW(scheduler.Next(1, tile_id), std::out_of_range);
+}
+
+TEST(TileScheduler, Stealing) {
+  // every worker starts with one of the costliest tiles
+  TileScheduler scheduler("test", make_tiles(8), 4, by_id);
+  GraphId tile_id;
+  for (size_t worker = 0; worker < 4; ++worker) {
+    ASSERT_TRUE(scheduler.Next(worker, tile_id));
+    EXPECT_EQ(tile_id.tileid(), 7 - worker);
+  }
+
+  // the first worker does all the rest, stealing the cheapest tiles of the others
+  std::set<uint32_t> rest;
+  while (scheduler.Next(0, tile_id)) {
+    rest.insert(tile_id.tileid());
+  }
+  EXPECT_EQ(rest, (std::set<uint32_t>{0, 1, 2, 3}));
+  EXPECT_EQ(scheduler.steals(), 3);
+  for (size_t worker = 1; worker < 4; ++worker) {
+    EXPECT_FALSE(scheduler.Next(worker, tile_id));
+  }
+}
+
+TEST(TileScheduler, Threads) {
+  TileScheduler scheduler("test", make_tiles(1000), 4, by_id);
+  std::mutex lock;
+  std::multiset<uint32_t> done;
+  std::vector<std::thread> threads;
+  for (size_t worker = 0; worker < scheduler.workers(); ++worker) {
+    threads.emplace_back([&, worker]() {
+      GraphId tile_id;
+      while (scheduler.Next(worker, tile_id)) {
+        std::lock_guard<std::mutex> l(lock);
+        done.insert(tile_id.tileid());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // every tile exactly once
+  ASSERT_EQ(done.size(), 1000);
+  EXPECT_EQ(std::set<uint32_t>(done.begin(), done.end()).size(), 1000);
+  EXPECT_GE(scheduler.utilization(), 0.f);
+  EXPECT_LE(scheduler.utilization(), 1.1f);
+  scheduler.LogUtilization();
+}
+
+TEST(TileScheduler, NeighbourBatches) {
+  const auto tiles = make_tiles(64);
+  TileScheduler scheduler("test", tiles, 1, by_id, 16);
+  GraphId tile_id;
+  std::vector<GraphId> order;
+  while (scheduler.Next(0, tile_id)) {
+    order.push_back(tile_id);
+  }
+  ASSERT_EQ(order.size(), 64);
+
+  // the batches are runs along the hilbert curve
+  std::vector<GraphId> curve(tiles);
+  std::sort(curve.begin(), curve.end(), [](const GraphId& a, const GraphId& b) {
+    return TileExtract::HilbertIndex(a) < TileExtract::HilbertIndex(b);
+  });
+  std::vector<std::set<uint32_t>> batches;
+  for (size_t i = 0; i < curve.size(); ++i) {
+    if (i % 16 == 0) {
+      batches.emplace_back();
+    }
+    batches.back().insert(curve[i].tileid());
+  }
+  std::vector<uint64_t> costs;
+  for (size_t i = 0; i < order.size(); i += 16) {
+    std::set<uint32_t> batch;
+    uint64_t cost = 0;
+    for (size_t j = i; j < i + 16; ++j) {
+      batch.insert(order[j].tileid());
+      cost += order[j].tileid();
+    }
+    EXPECT_NE(std::find(batches.begin(), batches.end(), batch), batches.end());
+    costs.push_back(cost);
+  }
+
+  // the costliest batches first
+  EXPECT_TRUE(std::is_sorted(costs.rbegin(), costs.rend()));
+}
+
+TEST(TileScheduler, FileSize) {
+  auto cost = TileScheduler::FileSize("test/data/does_not_exist");
+  EXPECT_EQ(cost(GraphId(0, 2, 0)), 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
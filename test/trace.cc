@@ -0,0 +1,261 @@
+#include "filesystem.h"
+#include "test.h"
+#include "worker.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <rapidjson/document.h>
+
+using namespace valhalla;
+
+namespace {
+
+const std::string kTraceDir = "test/data/traces";
+
+Api traced(const std::string& id) {
+  Api api;
+  api.mutable_options()->set_action(Options::route);
+  api.mutable_info()->set_trace_id(id);
+  return api;
+}
+
+TEST(Trace, OnlyWhenAsked) {
+  Api api;
+  api.mutable_options()->set_action(Options::route);
+  const auto now = std::chrono::steady_clock::now();
+  add_trace_span(api, "thor", "thor.expansion", now, now + std::chrono::milliseconds(2));
+  { auto _ = measure_phase_time(api, "thor", "expansion"); }
+  EXPECT_EQ(api.info().trace_size(), 0);
+  EXPECT_FALSE(write_trace(api, kTraceDir));
+}
+
+TEST(Trace, Spans) {
+  auto api = traced("spans");
+  const auto now = std::chrono::steady_clock::now();
+  add_trace_span(api, "loki", "loki", now, now + std::chrono::microseconds(1500));
+  { auto _ = measure_phase_time(api, "thor", "expansion"); }
+
+  ASSERT_EQ(api.info().trace_size(), 2);
+  const auto& span = api.info().trace(0);
+  EXPECT_EQ(span.name(), "loki");
+  EXPECT_EQ(span.process(), "loki");
+  EXPECT_EQ(span.duration_ns(), 1500000u);
+  EXPECT_EQ(api.info().trace(1).name(), "thor.expansion");
+  EXPECT_EQ(api.info().trace(1).process(), "thor");
+  EXPECT_GE(api.info().trace(1).start_ns(), span.start_ns());
+
+  // the phase is still timed as a statistic
+  ASSERT_GE(api.info().statistics_size(), 1);
+  EXPECT_EQ(api.info().statistics(0).key(), "route.info.thor.expansion.latency_ms");
+}
+
+TEST(Trace, ChromeTrace) {
+  filesystem::remove_all(kTraceDir);
+  filesystem::create_directories(kTraceDir);
+
+  auto api = traced("chrome-trace_1");
+  const auto now = std::chrono::steady_clock::now();
+  add_trace_span(api, "loki", "loki", now, now + std::chrono::milliseconds(1));
+  add_trace_span(api, "thor", "thor.expansion", now + std::chrono::milliseconds(2),
+                 now + std::chrono::milliseconds(5));
+  add_trace_span(api, "thor", "thor", now + std::chrono::milliseconds(1),
+                 now + std::chrono::milliseconds(6));
+  EXPECT_FALSE(write_trace(api, ""));
+  ASSERT_TRUE(write_trace(api, kTraceDir));
+
+  std::ifstream in(kTraceDir + "/chrome-trace_1.trace.json");
+  std::stringstream json;
+  json << in.rdbuf();
+  rapidjson::Document trace;
+  trace.Parse(json.str().c_str());
+  ASSERT_FALSE(trace.HasParseError());
+  EXPECT_EQ(std::string(trace["trace_id"].GetString()), "chrome-trace_1");
+
+  // three complete events in microseconds from the first span and a name for each process
+  const auto& events = trace["traceEvents"];
+  ASSERT_EQ(events.Size(), 5u);
+  EXPECT_EQ(std::string(events[0]["ph"].GetString()), "X");
+  // the starts are moved to the system clock one by one so they may be off by a bit
+  EXPECT_NEAR(events[0]["ts"].GetDouble(), 0., 1.);
+  EXPECT_DOUBLE_EQ(events[0]["dur"].GetDouble(), 1000.);
+  EXPECT_NEAR(events[1]["ts"].GetDouble(), 2000., 1.);
+  EXPECT_DOUBLE_EQ(events[1]["dur"].GetDouble(), 3000.);
+  EXPECT_NE(events[0]["pid"].GetUint64(), events[1]["pid"].GetUint64());
+  EXPECT_EQ(events[1]["pid"].GetUint64(), events[2]["pid"].GetUint64());
+  for (rapidjson::SizeType i = 3; i < 5; ++i) {
+    EXPECT_EQ(std::string(events[i]["ph"].GetString()), "M");
+    EXPECT_EQ(std::string(events[i]["name"].GetString()), "process_name");
+  }
+  EXPECT_EQ(std::string(events[3]["args"]["name"].GetString()), "loki");
+  EXPECT_EQ(std::string(events[4]["args"]["name"].GetString()), "thor");
+
+  filesystem::remove_all(kTraceDir);
+}
+
+TEST(Trace, Kinds) {
+  auto api = traced("kinds");
+  { auto _ = measure_phase_time(api, "thor", "expansion"); }
+  { auto _ = measure_phase_time(api, "thor", "serialize"); }
+  ASSERT_EQ(api.info().trace_size(), 2);
+  EXPECT_EQ(api.info().trace(0).kind(), TraceSpan::compute);
+  EXPECT_EQ(api.info().trace(1).kind(), TraceSpan::serialize);
+  EXPECT_NE(api.info().trace(0).span_id(), 0u);
+  EXPECT_NE(api.info().trace(0).span_id(), api.info().trace(1).span_id());
+
+  // on the system clock so the spans of other hosts line up
+  const uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+  EXPECT_LE(api.info().trace(1).start_ns(), now);
+  EXPECT_GT(api.info().trace(1).start_ns(), now - 60000000000ull);
+}
+
+TEST(Trace, QueueBetweenStages) {
+  // loki passes the request on
+  auto loki = traced("queue");
+  stamp_hand_off(loki);
+  ASSERT_NE(loki.info().handoff_unix_ns(), 0u);
+
+  // thor got it 5ms later and took 1ms to parse it
+  Api thor;
+  ASSERT_TRUE(thor.ParseFromString(loki.SerializeAsString()));
+  thor.mutable_info()->set_handoff_unix_ns(thor.info().handoff_unix_ns() - 5000000);
+  const auto received = std::chrono::steady_clock::now();
+  trace_arrival(thor, "thor", received, received + std::chrono::milliseconds(1));
+
+  ASSERT_EQ(thor.info().trace_size(), 2);
+  const auto& queue = thor.info().trace(0);
+  EXPECT_EQ(queue.name(), "thor.queue");
+  EXPECT_EQ(queue.process(), "thor");
+  EXPECT_EQ(queue.kind(), TraceSpan::queue);
+  EXPECT_GE(queue.duration_ns(), 5000000u);
+  EXPECT_LT(queue.duration_ns(), 1000000000u);
+  const auto& parse = thor.info().trace(1);
+  EXPECT_EQ(parse.name(), "thor.deserialize");
+  EXPECT_EQ(parse.kind(), TraceSpan::serialize);
+  EXPECT_EQ(parse.duration_ns(), 1000000u);
+  EXPECT_EQ(thor.info().handoff_unix_ns(), 0u);
+
+  // nothing happens to requests that are not traced
+  Api untraced;
+  stamp_hand_off(untraced);
+  trace_arrival(untraced, "odin", received, received);
+  EXPECT_EQ(untraced.info().handoff_unix_ns(), 0u);
+  EXPECT_EQ(untraced.info().trace_size(), 0);
+}
+
+TEST(Trace, Sampling) {
+  Api api;
+  sample_trace(api, 0);
+  EXPECT_TRUE(api.info().trace_id().empty());
+  sample_trace(api, 1);
+  EXPECT_EQ(api.info().trace_id().size(), 32u);
+  EXPECT_EQ(api.info().trace_id().find_first_not_of("0123456789abcdef"), std::string::npos);
+
+  // a request that asked for a trace keeps its id
+  auto asked = traced("asked");
+  sample_trace(asked, 1);
+  EXPECT_EQ(asked.info().trace_id(), "asked");
+}
+
+struct counting_sink_t : public trace_sink_t {
+  void consume(const Api& api) override {
+    consumed.push_back(api.info().trace_id());
+  }
+  static std::vector<std::string> consumed;
+};
+std::vector<std::string> counting_sink_t::consumed;
+
+TEST(Trace, Sinks) {
+  boost::property_tree::ptree config;
+  EXPECT_EQ(trace_sink_t::make(config), nullptr);
+  config.put("httpd.service.trace_sink", "chrome");
+  EXPECT_THROW(trace_sink_t::make(config), std::exception);
+  config.put("httpd.service.trace_sink", "bogus");
+  EXPECT_THROW(trace_sink_t::make(config), std::exception);
+  config.put("httpd.service.trace_sink", "log");
+  auto log = trace_sink_t::make(config);
+  ASSERT_NE(log, nullptr);
+  auto api = traced("logged");
+  { auto _ = measure_phase_time(api, "odin", "narrative"); }
+  log->consume(api);
+
+  // chrome is the default with a directory and none turns it off
+  config.erase("httpd");
+  config.put("httpd.service.trace_dir", kTraceDir);
+  EXPECT_NE(trace_sink_t::make(config), nullptr);
+  config.put("httpd.service.trace_sink", "none");
+  EXPECT_EQ(trace_sink_t::make(config), nullptr);
+
+  // sinks of our own
+  trace_sink_t::register_sink("counting", [](const boost::property_tree::ptree&) {
+    return std::make_shared<counting_sink_t>();
+  });
+  config.put("httpd.service.trace_sink", "counting");
+  auto counting = trace_sink_t::make(config);
+  ASSERT_NE(counting, nullptr);
+  counting->consume(api);
+  ASSERT_EQ(counting_sink_t::consumed.size(), 1u);
+  EXPECT_EQ(counting_sink_t::consumed.front(), "logged");
+}
+
+#ifdef HAVE_HTTP
+TEST(Trace, Header) {
+  using namespace prime_server;
+  Api api;
+  ParseApi(http_request_t(GET, "/status", "", {}, {{"X-Valhalla-Trace", "slow-route_7"}}), api);
+  EXPECT_EQ(api.info().trace_id(), "slow-route_7");
+
+  // ids that are not safe as file names are ignored
+  for (const auto* id : {"", "../etc/passwd", "a b", "x/y"}) {
+    ParseApi(http_request_t(GET, "/status", "", {}, {{"X-Valhalla-Trace", id}}), api);
+    EXPECT_TRUE(api.info().trace_id().empty()) << id;
+  }
+  ParseApi(http_request_t(GET, "/status", "", {}, {{"X-Valhalla-Trace", std::string(65, 'a')}}),
+           api);
+  EXPECT_TRUE(api.info().trace_id().empty());
+
+  ParseApi(http_request_t(GET, "/status"), api);
+  EXPECT_TRUE(api.info().trace_id().empty());
+}
+
+TEST(Trace, Traceparent) {
+  using namespace prime_server;
+  const std::string trace_id = "4bf92f3577b34da6a3ce929d0e0e4736";
+  const std::string parent = "00f067aa0ba902b7";
+  Api api;
+  ParseApi(http_request_t(GET, "/status", "", {},
+                          {{"traceparent", "00-" + trace_id + "-" + parent + "-01"},
+                           {"X-Valhalla-Trace", "ignored"}}),
+           api);
+  EXPECT_EQ(api.info().trace_id(), trace_id);
+  EXPECT_EQ(api.info().parent_span_id(), parent);
+
+  // the caller did not sample it
+  ParseApi(http_request_t(GET, "/status", "", {},
+                          {{"traceparent", "00-" + trace_id + "-" + parent + "-00"}}),
+           api);
+  EXPECT_TRUE(api.info().trace_id().empty());
+
+  // invalid ones are ignored
+  for (const auto& value : {std::string("00-" + trace_id + "-" + parent), "00-" +
+                                std::string(32, '0') + "-" + parent + "-01",
+                            "ff-" + trace_id + "-" + parent + "-01",
+                            "00-" + trace_id + "-" + std::string(16, 'X') + "-01"}) {
+    ParseApi(http_request_t(GET, "/status", "", {}, {{"traceparent", value}}), api);
+    EXPECT_TRUE(api.info().trace_id().empty()) << value;
+  }
+}
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
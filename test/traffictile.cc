@@ -2,6 +2,10 @@
 
 #include "baldr/traffictile.h"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 namespace {
 class UnmanagedGraphMemory : public valhalla::baldr::GraphMemory {
 public:
@@ -116,6 +120,132 @@ TEST(Traffic, SpeedValid) {
   EXPECT_EQ(speed.encoded_speed1, 0);
 }
 
+TEST(Traffic, UpdateBatch) {
+  using namespace valhalla::baldr;
+
+#pragma pack(push, 1)
+  struct TestTile {
+    TrafficTileHeader header;
+    TrafficSpeed speeds[3];
+  };
+#pragma pack(pop)
+
+  TestTile testdata{};
+  testdata.header.directed_edge_count = 3;
+  testdata.header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  TrafficTile tile(
+      std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata), sizeof(TestTile)));
+
+  const auto before = TrafficTile::stats();
+  tile.update({{0, TrafficSpeed{20, 20, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0,
+                                1, 0, 0, false}},
+               {2, TrafficSpeed{0, 0, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0,
+                                0, 0, 0, false}}},
+              1234);
+
+  EXPECT_EQ(tile.speed(0).get_overall_speed(), 40);
+  EXPECT_FALSE(tile.speed(1).speed_valid());
+  EXPECT_TRUE(tile.speed(2).closed());
+  EXPECT_EQ(testdata.header.last_update, 1234);
+  // the batch left the sequence even
+  EXPECT_EQ(testdata.header.write_sequence, 2);
+
+  const auto after = TrafficTile::stats();
+  EXPECT_EQ(after.batches - before.batches, 1);
+  EXPECT_EQ(after.updates - before.updates, 2);
+
+  // out of bounds updates are refused as a whole
+  EXPECT_THROW(tile.update({{0, TrafficSpeed{}}, {3, TrafficSpeed{}}}, 1235), std::runtime_error);
+  EXPECT_EQ(tile.speed(0).get_overall_speed(), 40);
+  EXPECT_EQ(testdata.header.write_sequence, 2);
+}
+
+TEST(Traffic, ClosureCount) {
+  using namespace valhalla::baldr;
+
+#pragma pack(push, 1)
+  struct TestTile {
+    TrafficTileHeader header;
+    TrafficSpeed speeds[3];
+  };
+#pragma pack(pop)
+
+  const TrafficSpeed closed{0, 0, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0, 0, 0,
+                            0, false};
+  const TrafficSpeed open{20, 20, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0, 1, 0,
+                          0, false};
+
+  // a tile written by some other process has closures nobody counted yet
+  TestTile testdata{};
+  testdata.header.directed_edge_count = 3;
+  testdata.header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  testdata.speeds[1] = closed;
+  TrafficTile tile(
+      std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata), sizeof(TestTile)));
+  EXPECT_TRUE(tile.has_closures());
+
+  // the first batch counts the existing closure along with its own
+  tile.update({{0, closed}}, 1);
+  EXPECT_TRUE(testdata.header.closures_counted);
+  EXPECT_EQ(testdata.header.closed_edge_count, 2);
+
+  // reopening and closing again adjusts the count
+  tile.update({{0, open}, {1, open}, {2, closed}}, 2);
+  EXPECT_EQ(testdata.header.closed_edge_count, 1);
+  tile.update({{2, closed}}, 3);
+  EXPECT_EQ(testdata.header.closed_edge_count, 1);
+  EXPECT_TRUE(tile.has_closures());
+  tile.update({{2, open}}, 4);
+  EXPECT_EQ(testdata.header.closed_edge_count, 0);
+  EXPECT_FALSE(tile.has_closures());
+
+  // no traffic means nothing is closed
+  EXPECT_FALSE(TrafficTile(nullptr).has_closures());
+}
+
+TEST(Traffic, UpdateWhileReading) {
+  using namespace valhalla::baldr;
+
+#pragma pack(push, 1)
+  struct TestTile {
+    TrafficTileHeader header;
+    TrafficSpeed speeds[64];
+  };
+#pragma pack(pop)
+
+  TestTile testdata{};
+  testdata.header.directed_edge_count = 64;
+  testdata.header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  TrafficTile tile(
+      std::make_unique<UnmanagedGraphMemory>(reinterpret_cast<char*>(&testdata), sizeof(TestTile)));
+
+  // every batch gives all the edges the same speed, so a reader must never see two different ones
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (uint32_t round = 0; round < 2000; ++round) {
+      const uint32_t encoded = 1 + round % 100;
+      std::vector<TrafficSpeedUpdate> updates;
+      for (uint32_t i = 0; i < 64; ++i) {
+        updates.push_back({i, TrafficSpeed{encoded, encoded, encoded, encoded, 100, 200, 1, 1, 1,
+                                           false}});
+      }
+      tile.update(updates, round);
+    }
+    done = true;
+  });
+
+  size_t mixed = 0;
+  while (!done) {
+    auto first = tile.speed(0);
+    auto last = tile.speed(63);
+    mixed += first.encoded_speed1 != first.encoded_speed3;
+    mixed += last.overall_encoded_speed != last.encoded_speed2;
+  }
+  writer.join();
+  EXPECT_EQ(mixed, 0);
+  EXPECT_EQ(testdata.header.write_sequence, 4000);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
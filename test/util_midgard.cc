@@ -733,6 +733,28 @@ TEST(UtilMidgard, SequenceSort) {
   EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), standard.begin()));
 }
 
+TEST(UtilMidgard, SequenceParallelSort) {
+  std::vector<uint8_t> in_mem;
+  valhalla::midgard::sequence<uint8_t> merge("char_sequence_test_parallel_merge.bin", true, 1327);
+  valhalla::midgard::sequence<uint8_t> standard("char_sequence_test_parallel_standard.bin", true,
+                                                1327 * 5);
+
+  for (int i = 0; i < int(1327 * 4.5); ++i) {
+    auto n = static_cast<uint8_t>(rand() % std::numeric_limits<uint8_t>::max());
+    in_mem.push_back(n);
+    merge.push_back(n);
+    standard.push_back(n);
+  }
+
+  // odd thread counts leave parts of different lengths to merge
+  std::sort(in_mem.begin(), in_mem.end());
+  merge.sort(std::less<uint8_t>(), 1327, 3);
+  standard.sort(std::less<uint8_t>(), 1327 * 5, 5);
+
+  EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), merge.begin()));
+  EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), standard.begin()));
+}
+
 TEST(UtilMidgard, TriangleContains) {
   PointLL a = {1, 1}, b = {2, 1}, c = {2, 2};
 
@@ -781,6 +803,57 @@ TEST(UtilMidgard, PolygonArea) {
   }
 }
 
+TEST(UtilMidgard, HilbertIndex) {
+  // every cell of an 8x8 grid gets its own position and each step along the curve is to a
+  // neighbouring cell
+  const uint64_t n = 8;
+  std::vector<std::pair<uint64_t, uint64_t>> cells(n * n, {n, n});
+  for (uint64_t x = 0; x < n; ++x) {
+    for (uint64_t y = 0; y < n; ++y) {
+      auto d = hilbert_index(x, y, n);
+      ASSERT_LT(d, n * n);
+      EXPECT_EQ(cells[d].first, n) << " two cells at position " << d;
+      cells[d] = {x, y};
+    }
+  }
+  for (size_t d = 1; d < cells.size(); ++d) {
+    auto dx = std::max(cells[d].first, cells[d - 1].first) -
+              std::min(cells[d].first, cells[d - 1].first);
+    auto dy = std::max(cells[d].second, cells[d - 1].second) -
+              std::min(cells[d].second, cells[d - 1].second);
+    EXPECT_EQ(dx + dy, 1) << " step " << d << " is not to a neighbour";
+  }
+
+  // the largest grid still fits
+  EXPECT_EQ(hilbert_index(0, 0, uint64_t(1) << 32), 0);
+  EXPECT_EQ(hilbert_index((uint64_t(1) << 32) - 1, 0, uint64_t(1) << 32), ~uint64_t(0));
+}
+
+TEST(UtilMidgard, ProjectSegments) {
+  // a zig zag with a zero length segment and enough segments for the vector loop and its tail
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> offset(-0.001, 0.001);
+  std::vector<double> lngs, lats;
+  for (int i = 0; i < 11; ++i) {
+    lngs.push_back(5.1 + i * 0.0005 + offset(generator));
+    lats.push_back(52.09 + offset(generator));
+  }
+  lngs.push_back(lngs.back());
+  lats.push_back(lats.back());
+
+  std::vector<double> sq_distances(lngs.size());
+  for (int p = 0; p < 100; ++p) {
+    PointLL ll(5.1 + offset(generator) * 4, 52.09 + offset(generator));
+    projector_t project(ll);
+    project_segments(project, lngs.data(), lats.data(), lngs.size(), sq_distances.data());
+    for (size_t i = 0; i + 1 < lngs.size(); ++i) {
+      auto point = project(PointLL(lngs[i], lats[i]), PointLL(lngs[i + 1], lats[i + 1]));
+      auto expected = project.approx.DistanceSquared(point);
+      EXPECT_NEAR(sq_distances[i], expected, expected * 1e-9 + 1e-9) << p << " " << i;
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -17,6 +17,28 @@ TEST(UtilOdin, test_get_locales) {
   EXPECT_NE(init.find("en-US"), init.cend()) << "Should find 'en-US' locales file";
 }
 
+TEST(UtilOdin, test_get_locale) {
+  // a locale and its alias are the same dictionary
+  const auto en_us = get_locale("en-US");
+  ASSERT_NE(en_us, nullptr);
+  EXPECT_EQ(en_us->GetLanguageTag(), "en-US");
+  EXPECT_EQ(get_locale("en"), en_us);
+  EXPECT_EQ(get_locale("en-US"), en_us);
+
+  EXPECT_EQ(get_locale("xx-XX"), nullptr);
+  EXPECT_TRUE(has_locale("de"));
+  EXPECT_TRUE(has_locale("pt-BR"));
+  EXPECT_FALSE(has_locale("xx-XX"));
+
+  // every locale and alias is in the map of all of them, sharing the loaded dictionaries
+  const auto& locales = get_locales();
+  EXPECT_EQ(locales.at("en"), en_us);
+  for (const auto& locale : locales) {
+    EXPECT_TRUE(has_locale(locale.first)) << locale.first;
+    EXPECT_EQ(get_locale(locale.first), locale.second) << locale.first;
+  }
+}
+
 void try_get_formatted_time(const std::string& date_time,
                             const std::string& expected_date_time,
                             const std::locale& locale) {
@@ -35,6 +35,22 @@ TEST(UtilSkadi, Grade) {
   EXPECT_EQ(elev, skadi::get_no_data_value());
 }
 
+TEST(UtilSkadi, ElevationChange) {
+  // rolling terrain climbs and drops even though it ends where it started
+  auto change = skadi::elevation_change({10, 25, 5, 30, 10});
+  EXPECT_NEAR(change.first, 40.0, .00001);
+  EXPECT_NEAR(change.second, 40.0, .00001);
+
+  // sections touching a missing posting do not count
+  change = skadi::elevation_change({0, 10, -32768, 50, 45});
+  EXPECT_NEAR(change.first, 10.0, .00001);
+  EXPECT_NEAR(change.second, 5.0, .00001);
+
+  change = skadi::elevation_change({7});
+  EXPECT_EQ(change.first, 0.0);
+  EXPECT_EQ(change.second, 0.0);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
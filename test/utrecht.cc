@@ -6,6 +6,7 @@
 
 #include <boost/property_tree/ptree.hpp>
 #include <fstream>
+#include <iterator>
 
 #include "baldr/directededge.h"
 #include "baldr/graphconstants.h"
@@ -210,6 +211,42 @@ TEST(Utrecht, TestBus) {
   EXPECT_TRUE(way_33648196.bike_backward());
 }
 
+std::string read_file(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+TEST(Utrecht, ParallelParse) {
+  // the same ways come out in the same order no matter how many threads parse them
+  std::vector<std::string> ways, way_nodes;
+  std::vector<uint64_t> way_counts;
+  for (unsigned int threads : {1, 4}) {
+    boost::property_tree::ptree conf;
+    conf.put<std::string>("mjolnir.tile_dir", "test/data/parser_tiles");
+    conf.put<unsigned long>("mjolnir.id_table_size", 1000);
+    conf.put<unsigned int>("mjolnir.concurrency", threads);
+
+    auto osmdata =
+        PBFGraphParser::ParseWays(conf.get_child("mjolnir"),
+                                  {VALHALLA_SOURCE_DIR "test/data/utrecht_netherlands.osm.pbf"},
+                                  "test_parallel_ways.bin", "test_parallel_way_nodes.bin",
+                                  "test_parallel_access.bin", "test_parallel_pronunciation.bin");
+    ways.push_back(read_file("test_parallel_ways.bin"));
+    way_nodes.push_back(read_file("test_parallel_way_nodes.bin"));
+    way_counts.push_back(osmdata.osm_way_count);
+  }
+  for (const auto& file_name : {"test_parallel_ways.bin", "test_parallel_way_nodes.bin",
+                                "test_parallel_access.bin", "test_parallel_pronunciation.bin"}) {
+    filesystem::remove(file_name);
+  }
+
+  EXPECT_GT(way_counts.front(), 0u);
+  EXPECT_EQ(way_counts.front(), way_counts.back());
+  EXPECT_FALSE(ways.front().empty());
+  EXPECT_TRUE(ways.front() == ways.back());
+  EXPECT_TRUE(way_nodes.front() == way_nodes.back());
+}
+
 // Setup and tearown will be called only once for the entire suite
 class UtrecthTestSuiteEnv : public ::testing::Environment {
 public:
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <iostream>
 #include <random>
+#include <tuple>
 
 #include "meili/topk_search.h"
 #include "meili/viterbi_search.h"
@@ -536,6 +537,97 @@ TEST(ViterbiSearch, TestTopKSearch) {
   }
 }
 
+// The winners and their costs and predecessors at every time
+std::vector<std::tuple<StateId, double, StateId>> search_all(IViterbiSearch& vs, size_t count) {
+  std::vector<std::tuple<StateId, double, StateId>> winners;
+  for (StateId::Time time = 0; time < count; ++time) {
+    const auto winner = vs.SearchWinner(time);
+    winners.emplace_back(winner, vs.AccumulatedCost(winner), vs.Predecessor(winner));
+  }
+  return winners;
+}
+
+TEST(ViterbiSearch, TestSearchReuse) {
+  const std::uniform_int_distribution<int> costs(1, 10);
+  const std::uniform_int_distribution<size_t> few(1, 8), more(2, 12);
+  const auto columns = generate_columns(costs, costs, generate_column_counts(20, few));
+  const auto others = generate_columns(costs, costs, generate_column_counts(30, more));
+
+  ViterbiSearch vs;
+  vs.set_emission_cost_model(EmissionCostModel(columns));
+  vs.set_transition_cost_model(TransitionCostModel(columns));
+  AddColumns(vs, columns);
+  const auto first = search_all(vs, columns.size());
+
+  // searching again on the labels kept from the first search finds the same
+  vs.ClearSearch();
+  EXPECT_EQ(search_all(vs, columns.size()), first);
+
+  // as does a search of other columns compared to a fresh one
+  vs.Clear();
+  vs.set_emission_cost_model(EmissionCostModel(others));
+  vs.set_transition_cost_model(TransitionCostModel(others));
+  AddColumns(vs, others);
+  ViterbiSearch fresh;
+  fresh.set_emission_cost_model(EmissionCostModel(others));
+  fresh.set_transition_cost_model(TransitionCostModel(others));
+  AddColumns(fresh, others);
+  EXPECT_EQ(search_all(vs, others.size()), search_all(fresh, others.size()));
+}
+
+// A search of the columns with a beam and how many transitions it computed
+struct BeamSearch : ViterbiSearch {
+  BeamSearch(const std::vector<Column>& columns, uint32_t width, double cost_gap) {
+    set_emission_cost_model(EmissionCostModel(columns));
+    const TransitionCostModel cost_model(columns);
+    set_transition_cost_model([this, cost_model](const StateId& lhs, const StateId& rhs) {
+      ++transitions;
+      return cost_model(lhs, rhs);
+    });
+    set_beam(width, cost_gap);
+    AddColumns(*this, columns);
+  }
+  size_t transitions = 0;
+};
+
+TEST(ViterbiSearch, TestBeam) {
+  // the cheaper of the first two states only leads on at a high cost
+  std::vector<Column> columns{{{1, {{0, 100}}}, {2, {{0, 1}}}}, {{1, {}}}};
+  auto search = [&columns](uint32_t width, double cost_gap) {
+    BeamSearch vs(columns, width, cost_gap);
+    const auto winner = vs.SearchWinner(1);
+    return std::make_pair(vs.Predecessor(winner), vs.AccumulatedCost(winner));
+  };
+  const auto best = std::make_pair(StateId(0, 1), 4.0);
+  const auto greedy = std::make_pair(StateId(0, 0), 102.0);
+  EXPECT_EQ(search(0, 0), best);
+  EXPECT_EQ(search(2, 0), best);
+  EXPECT_EQ(search(1, 0), greedy);
+  EXPECT_EQ(search(0, 1), best);
+  EXPECT_EQ(search(0, 0.5), greedy);
+
+  // a beam as wide as the columns finds the best paths, a narrower one computes fewer transitions
+  // for paths that are no better
+  const std::uniform_int_distribution<int> costs(0, 50);
+  const std::uniform_int_distribution<size_t> widths(1, 40);
+  const auto many = generate_columns(costs, costs, generate_column_counts(200, widths));
+  BeamSearch full(many, 0, 0), wide(many, 40, 0), narrow(many, 3, 0), gap(many, 0, 20);
+  const auto full_winners = search_all(full, many.size());
+  EXPECT_EQ(search_all(wide, many.size()), full_winners);
+  for (auto* beam : {&narrow, &gap}) {
+    const auto winners = search_all(*beam, many.size());
+    EXPECT_GE(std::get<1>(winners.back()), std::get<1>(full_winners.back()));
+    EXPECT_LT(beam->transitions, full.transitions);
+  }
+
+  // the narrow beam goes on from at most 3 states of a column
+  size_t most = 0;
+  for (size_t time = 0; time + 1 < many.size(); ++time) {
+    most += std::min<size_t>(many[time].size(), 3) * many[time + 1].size();
+  }
+  EXPECT_LE(narrow.transitions, most);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Identifies a landmark distance file and the version of its layout
+constexpr char kAltBoundsMagic[8] = {'V', 'A', 'L', 'H', 'A', 'L', 'T', '\0'};
+constexpr uint32_t kAltBoundsVersion = 1;
+
+/**
+ * Start of a landmark distance file. It is followed by landmark_count landmark node ids as
+ * uint64_t, by tile_count + 1 uint64_t offsets of the first node of each tile slot and then by
+ * landmark_count float distances in meters per node, node after node.
+ */
+struct AltBoundsHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t landmark_count; // Number of landmarks stored per node
+  uint64_t tile_count;     // Number of tile slots of the road levels of the hierarchy
+  uint64_t node_count;     // Number of nodes with distances
+};
+
+/**
+ * Read only view of a landmark distance file built by valhalla_build_alt. It holds the network
+ * distance between every node of the road levels and a handful of landmark nodes, regardless of
+ * access and direction of the edges. Because of the triangle inequality the difference between the
+ * distances of two nodes to the same landmark never exceeds the network distance between them,
+ * which makes the largest such difference a lower bound of the length of any path between them.
+ */
+class AltBounds {
+public:
+  /**
+   * Maps the file read only, throws when it is not a landmark distance file of this hierarchy
+   * @param  file  the path of the file
+   */
+  explicit AltBounds(const std::string& file);
+
+  /**
+   * Get the distances of a file, the services of a process share them
+   * @param  file  the path of the file, may be empty
+   * @return the distances, nullptr when there is no file or it cannot be used
+   */
+  static std::shared_ptr<const AltBounds> get(const std::string& file);
+
+  /**
+   * Get the distances between a node and the landmarks
+   * @param  node  the id of the node on any road level
+   * @return landmark_count() distances in meters, infinite when the node cannot reach the landmark,
+   *         nullptr when the file has no distances for the node
+   */
+  const float* Distances(const GraphId& node) const;
+
+  /**
+   * Get a lower bound of the network distance between two nodes
+   * @param  from  the distances of one node
+   * @param  to    the distances of the other one
+   * @return the bound in meters
+   */
+  float LowerBound(const float* from, const float* to) const;
+
+  uint32_t landmark_count() const {
+    return header_->landmark_count;
+  }
+
+  /**
+   * @return the landmarks the distances are measured to
+   */
+  const uint64_t* landmarks() const {
+    return landmarks_;
+  }
+
+  /**
+   * Get the slot of a tile in the offsets of the file, the slots of a level follow the ones of the
+   * levels below it
+   * @param  tile_id  the id of a tile on a road level
+   * @return the slot
+   */
+  static uint64_t TileSlot(const GraphId& tile_id);
+
+  /**
+   * @return the number of tile slots of the road levels
+   */
+  static uint64_t TileSlotCount();
+
+protected:
+  midgard::mem_map<char> memory_;
+  const AltBoundsHeader* header_;
+  const uint64_t* landmarks_;
+  const uint64_t* offsets_;
+  const float* distances_;
+};
+
+} // namespace baldr
+} // namespace valhalla
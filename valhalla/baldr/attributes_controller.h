@@ -1,4 +1,6 @@
 #pragma once
+#include <bitset>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -59,6 +61,8 @@ const std::string kEdgeWeightedGrade = "edge.weighted_grade";
 const std::string kEdgeMaxUpwardGrade = "edge.max_upward_grade";
 const std::string kEdgeMaxDownwardGrade = "edge.max_downward_grade";
 const std::string kEdgeMeanElevation = "edge.mean_elevation";
+const std::string kEdgeAscent = "edge.ascent";
+const std::string kEdgeDescent = "edge.descent";
 const std::string kEdgeLaneCount = "edge.lane_count";
 const std::string kEdgeLaneConnectivity = "edge.lane_connectivity";
 const std::string kEdgeCycleLane = "edge.cycle_lane";
@@ -150,6 +154,148 @@ const std::string kAdminCategory = "admin.";
 const std::string kMatchedCategory = "matched.";
 const std::string kShapeAttributesCategory = "shape_attributes.";
 
+/**
+ * The attributes by index, in the same order as their keys above. The controller compiles the
+ * enabled attributes into a bitset indexed by these so per edge lookups are a single bit test.
+ */
+enum class Attribute : uint8_t {
+  // Edge keys
+  kEdgeNames,
+  kEdgeLength,
+  kEdgeSpeed,
+  kEdgeRoadClass,
+  kEdgeBeginHeading,
+  kEdgeEndHeading,
+  kEdgeBeginShapeIndex,
+  kEdgeEndShapeIndex,
+  kEdgeTraversability,
+  kEdgeUse,
+  kEdgeToll,
+  kEdgeUnpaved,
+  kEdgeTunnel,
+  kEdgeBridge,
+  kEdgeRoundabout,
+  kEdgeInternalIntersection,
+  kEdgeDriveOnRight,
+  kEdgeSurface,
+  kEdgeSignExitNumber,
+  kEdgeSignExitBranch,
+  kEdgeSignExitToward,
+  kEdgeSignExitName,
+  kEdgeSignGuideBranch,
+  kEdgeSignGuideToward,
+  kEdgeSignJunctionName,
+  kEdgeSignGuidanceViewJunction,
+  kEdgeSignGuidanceViewSignboard,
+  kEdgeTravelMode,
+  kEdgeVehicleType,
+  kEdgePedestrianType,
+  kEdgeBicycleType,
+  kEdgeTransitType,
+  kEdgeTransitRouteInfoOnestopId,
+  kEdgeTransitRouteInfoBlockId,
+  kEdgeTransitRouteInfoTripId,
+  kEdgeTransitRouteInfoShortName,
+  kEdgeTransitRouteInfoLongName,
+  kEdgeTransitRouteInfoHeadsign,
+  kEdgeTransitRouteInfoColor,
+  kEdgeTransitRouteInfoTextColor,
+  kEdgeTransitRouteInfoDescription,
+  kEdgeTransitRouteInfoOperatorOnestopId,
+  kEdgeTransitRouteInfoOperatorName,
+  kEdgeTransitRouteInfoOperatorUrl,
+  kEdgeId,
+  kEdgeWayId,
+  kEdgeWeightedGrade,
+  kEdgeMaxUpwardGrade,
+  kEdgeMaxDownwardGrade,
+  kEdgeMeanElevation,
+  kEdgeAscent,
+  kEdgeDescent,
+  kEdgeLaneCount,
+  kEdgeLaneConnectivity,
+  kEdgeCycleLane,
+  kEdgeBicycleNetwork,
+  kEdgeSacScale,
+  kEdgeShoulder,
+  kEdgeSidewalk,
+  kEdgeDensity,
+  kEdgeSpeedLimit,
+  kEdgeTruckSpeed,
+  kEdgeTruckRoute,
+  kEdgeDefaultSpeed,
+  kEdgeDestinationOnly,
+  kEdgeIsUrban,
+  kEdgeTaggedValues,
+  kEdgeIndoor,
+  kEdgeLandmarks,
+
+  // Node keys
+  kNodeIntersectingEdgeBeginHeading,
+  kNodeIntersectingEdgeFromEdgeNameConsistency,
+  kNodeIntersectingEdgeToEdgeNameConsistency,
+  kNodeIntersectingEdgeDriveability,
+  kNodeIntersectingEdgeCyclability,
+  kNodeIntersectingEdgeWalkability,
+  kNodeIntersectingEdgeUse,
+  kNodeIntersectingEdgeRoadClass,
+  kNodeIntersectingEdgeLaneCount,
+  kNodeIntersectingEdgeSignInfo,
+  kNodeElapsedTime,
+  kNodeAdminIndex,
+  kNodeType,
+  kNodeFork,
+  kNodeTransitPlatformInfoType,
+  kNodeTransitPlatformInfoOnestopId,
+  kNodeTransitPlatformInfoName,
+  kNodeTransitPlatformInfoStationOnestopId,
+  kNodeTransitPlatformInfoStationName,
+  kNodeTransitPlatformInfoArrivalDateTime,
+  kNodeTransitPlatformInfoDepartureDateTime,
+  kNodeTransitPlatformInfoIsParentStop,
+  kNodeTransitPlatformInfoAssumedSchedule,
+  kNodeTransitPlatformInfoLatLon,
+  kNodeTransitStationInfoOnestopId,
+  kNodeTransitStationInfoName,
+  kNodeTransitStationInfoLatLon,
+  kNodeTransitEgressInfoOnestopId,
+  kNodeTransitEgressInfoName,
+  kNodeTransitEgressInfoLatLon,
+  kNodeTimeZone,
+  kNodeTransitionTime,
+
+  // Top level: osm changeset, admin list, and full shape keys
+  kOsmChangeset,
+  kAdminCountryCode,
+  kAdminCountryText,
+  kAdminStateCode,
+  kAdminStateText,
+  kShape,
+  kIncidents,
+
+  // Map matching ones nested to points and top level ones
+  kMatchedPoint,
+  kMatchedType,
+  kMatchedEdgeIndex,
+  kMatchedBeginRouteDiscontinuity,
+  kMatchedEndRouteDiscontinuity,
+  kMatchedDistanceAlongEdge,
+  kMatchedDistanceFromTracePoint,
+  kConfidenceScore,
+  kRawScore,
+
+  // Per-shape attributes
+  kShapeAttributesTime,
+  kShapeAttributesLength,
+  kShapeAttributesSpeed,
+  kShapeAttributesSpeedLimit,
+  kShapeAttributesClosure,
+
+  // not an attribute, the number of them
+  kCount
+};
+constexpr size_t kAttributeCount = static_cast<size_t>(Attribute::kCount);
+
 /**
  * Trip path controller for attributes
  */
@@ -182,9 +328,24 @@ struct AttributesController {
    */
   bool category_attribute_enabled(const std::string& category) const;
 
+  /**
+   * Compiles the attributes into the bitset of enabled attributes. The constructors and
+   * disable_all() do this, it is only needed after changing the attributes directly.
+   */
+  void compile();
+
   bool operator()(const std::string& key) const;
 
+  /**
+   * Returns true if the attribute is enabled, a single bit test for the lookups made per edge.
+   */
+  bool operator()(const Attribute attribute) const {
+    return enabled[static_cast<size_t>(attribute)];
+  }
+
+  // The attributes by key, the bitset is compiled from these
   std::unordered_map<std::string, bool> attributes;
+  std::bitset<kAttributeCount> enabled;
 };
 
 } // namespace baldr
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kInvalidBssStation = std::numeric_limits<uint32_t>::max();
+
+/**
+ * The cheapest bicycle ride between two bike share stations, from taking the bicycle at the
+ * first station up to the end of the edge entering the second station.
+ */
+struct BssRide {
+  uint32_t from;       // index of the station the ride starts at
+  uint32_t to;         // index of the station the ride ends at
+  float cost;          // cost of the ride including the transition onto the bicycle
+  float secs;          // time of the ride in seconds
+  uint32_t length;     // length of the ride in meters
+  uint32_t spare;
+  uint64_t first_edge; // the directed edge leaving the first station
+  uint64_t last_edge;  // the directed edge entering the second station
+};
+
+/**
+ * Station to station bicycle rides between the bike share stations of the graph, computed
+ * offline with the default bicycle options (see mjolnir::BssTablesBuilder). Only the cost and
+ * the edges at both ends of a ride are kept, the edges in between are found again by a search
+ * between the two stations when a path is needed. Rides longer than the limit they were built
+ * with are missing from the tables.
+ */
+class BssTables {
+public:
+  BssTables() = default;
+
+  /**
+   * Creates the tables from the rides found between the stations
+   * @param stations    the graph ids of the station nodes, sorted
+   * @param rides       the rides, at most one per pair of stations
+   * @param dataset_id  the dataset id of the tiles the tables were built from
+   */
+  BssTables(std::vector<GraphId> stations, std::vector<BssRide> rides, const uint64_t dataset_id);
+
+  /**
+   * Where the tables live inside the tile directory
+   * @param tile_dir  the tile directory
+   * @return the path of the tables file
+   */
+  static std::string file_name(const std::string& tile_dir);
+
+  /**
+   * Loads tables written by Save. Throws if the file is missing or malformed.
+   * @param file_name  the file to load
+   * @return the tables
+   */
+  static std::shared_ptr<const BssTables> Load(const std::string& file_name);
+
+  /**
+   * Writes the tables to a file, creating the parent directories as needed
+   * @param file_name  the file to write
+   */
+  void Save(const std::string& file_name) const;
+
+  /**
+   * Index of the station at the given node
+   * @param node  graph id of the node
+   * @return the index or kInvalidBssStation if the node is not a station of the tables
+   */
+  uint32_t station_index(const GraphId& node) const;
+
+  const GraphId& station(const uint32_t index) const {
+    return stations_[index];
+  }
+
+  const BssRide& ride(const uint32_t index) const {
+    return rides_[index];
+  }
+
+  size_t station_count() const {
+    return stations_.size();
+  }
+
+  size_t ride_count() const {
+    return rides_.size();
+  }
+
+  uint64_t dataset_id() const {
+    return dataset_id_;
+  }
+
+  /**
+   * The rides starting at a station
+   * @param index  the station
+   * @return begin and end of the rides
+   */
+  std::pair<const BssRide*, const BssRide*> rides_from(const uint32_t index) const {
+    return {rides_.data() + from_offsets_[index], rides_.data() + from_offsets_[index + 1]};
+  }
+
+  /**
+   * The rides ending at a station
+   * @param index  the station
+   * @return begin and end of the ride indices
+   */
+  std::pair<const uint32_t*, const uint32_t*> rides_to(const uint32_t index) const {
+    return {to_rides_.data() + to_offsets_[index], to_rides_.data() + to_offsets_[index + 1]};
+  }
+
+protected:
+  std::vector<GraphId> stations_;
+  std::vector<BssRide> rides_;
+  std::vector<uint32_t> from_offsets_;
+  std::vector<uint32_t> to_offsets_;
+  std::vector<uint32_t> to_rides_;
+  uint64_t dataset_id_ = 0;
+
+  // sorts the rides by the station they start at and indexes them by the one they end at
+  void Index();
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <vector>
 #include <zlib.h>
 
+struct ZSTD_DDict_s;
+
 namespace valhalla {
 namespace baldr {
 
@@ -26,5 +31,96 @@ bool deflate(const std::function<int(z_stream&)>& src_func,
 bool inflate(const std::function<void(z_stream&)>& src_func,
              const std::function<int(z_stream&)>& dst_func);
 
+/**
+ * The compression the bytes of a graph tile were stored with. A tile starts with the graph id of
+ * its first node whose low bits can never spell the magic numbers of the frames below, so the
+ * first bytes are enough to tell them apart
+ */
+enum class tile_compression_t : uint8_t { none, gzip, zstd, lz4 };
+
+/* Tells the compression of tile bytes from their first bytes
+ * @param data  the bytes of the tile
+ * @param size  how many there are
+ * @return      the compression they were stored with
+ */
+tile_compression_t detect_compression(const char* data, size_t size);
+
+/**
+ * A zstd dictionary trained on the tiles of an extract and stored once alongside them. It is
+ * digested when constructed so the tiles decompressed with it dont load it again
+ */
+class zstd_dictionary_t {
+public:
+  /**
+   * @param data  the bytes of the dictionary
+   * @param size  how many there are
+   * @throws std::runtime_error if zstd support is missing or the dictionary cant be loaded
+   */
+  zstd_dictionary_t(const char* data, size_t size);
+  ~zstd_dictionary_t();
+
+  zstd_dictionary_t(const zstd_dictionary_t&) = delete;
+  zstd_dictionary_t& operator=(const zstd_dictionary_t&) = delete;
+
+  /**
+   * The id zstd writes into the frames compressed with the dictionary, 0 for raw content
+   */
+  uint32_t id() const {
+    return id_;
+  }
+
+  ZSTD_DDict_s* get() const {
+    return ddict_;
+  }
+
+private:
+  ZSTD_DDict_s* ddict_;
+  uint32_t id_;
+};
+
+/* Compresses data into a single zstd frame which records its decompressed size
+ * @param src         the data to compress
+ * @param size        how much of it there is
+ * @param dst         the frame is written to it
+ * @param level       what compression level to use
+ * @param dictionary  the raw bytes of the dictionary to compress with, empty for none
+ * @return            returns true if the data was compressed, false if it failed or valhalla was
+ *                    built without zstd
+ */
+bool zstd_compress(const char* src,
+                   size_t size,
+                   std::vector<char>& dst,
+                   int level = 19,
+                   const std::vector<char>& dictionary = {});
+
+/* Decompresses a zstd frame, the frame has to record its decompressed size
+ * @param src         the frame
+ * @param size        how large it is
+ * @param dst         the decompressed data is written to it
+ * @param dictionary  the dictionary the frame was compressed with, nullptr for none
+ * @return            returns true if the frame was decompressed, false otherwise
+ */
+bool zstd_decompress(const char* src,
+                     size_t size,
+                     std::vector<char>& dst,
+                     const zstd_dictionary_t* dictionary = nullptr);
+
+/* Compresses data into a single lz4 frame which records its decompressed size
+ * @param src   the data to compress
+ * @param size  how much of it there is
+ * @param dst   the frame is written to it
+ * @return      returns true if the data was compressed, false if it failed or valhalla was built
+ *              without lz4
+ */
+bool lz4_compress(const char* src, size_t size, std::vector<char>& dst);
+
+/* Decompresses an lz4 frame
+ * @param src   the frame
+ * @param size  how large it is
+ * @param dst   the decompressed data is written to it
+ * @return      returns true if the frame was decompressed, false otherwise
+ */
+bool lz4_decompress(const char* src, size_t size, std::vector<char>& dst);
+
 } // namespace baldr
 } // namespace valhalla
\ No newline at end of file
@@ -1,28 +1,106 @@
 #ifndef VALHALLA_BALDR_CONNECTIVITY_MAP_H_
 #define VALHALLA_BALDR_CONNECTIVITY_MAP_H_
 
+#include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/midgard/sequence.h>
 
 #include <cstdint>
-#include <unordered_map>
+#include <limits>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
 namespace valhalla {
 namespace baldr {
+
+// the file valhalla_build_connectivity writes to the tile_dir and TileExtract puts in the extract
+const std::string kConnectivityFile = "connectivity.bin";
+// level and tileindex only take 25 bits so this tile_id marks the index entry of the connectivity
+constexpr uint32_t kConnectivityIndexId = std::numeric_limits<uint32_t>::max() - 1;
+// the component of nodes whose component isnt known, e.g. on the transit level
+constexpr uint32_t kNoComponent = std::numeric_limits<uint32_t>::max();
+
+// The components connectivity.bin has for the nodes of the road levels. The weak ones are the
+// weakly connected components over every edge but shortcuts and every transition, whatever the
+// access. The others are the strongly connected components over the edges a mode has access to in
+// the direction it has access, which tell apart the one way and the gated parts of the graph.
+enum class ComponentSet : uint8_t {
+  kWeak = 0,
+  kAuto = 1,
+  kTruck = 2,
+  kBicycle = 3,
+  kPedestrian = 4
+};
+constexpr size_t kComponentSetCount = 5;
+
+// The access the strong components of each set are over, auto also has the hov and taxi lanes and
+// pedestrian the wheelchair accessible ways. A costing can use the set that has all its access.
+constexpr uint16_t kComponentSetAccess[kComponentSetCount] =
+    {kAllAccess, kAutoAccess | kHOVAccess | kTaxiAccess, kTruckAccess, kBicycleAccess,
+     kPedestrianAccess | kWheelchairAccess};
+
+// An edge of the set leaves or enters the component, routes that leave one without the first or
+// enter one without the second start or end inside of it
+constexpr uint8_t kComponentLeft = 1;
+constexpr uint8_t kComponentEntered = 2;
+
 // TODO: maintain consistent coloring of regions despite the connectivity changing
 class connectivity_map_t {
 public:
+  // connectivity.bin starts with this header
+  struct file_header_t {
+    char magic[8];                                 // kMagic
+    uint32_t version;                              // kVersion
+    uint32_t tile_count;                           // number of tile_t that follow the header
+    uint64_t node_count[kComponentSetCount];       // number of node_t of each set
+    uint32_t component_count[kComponentSetCount];  // number of components of each set
+    uint32_t spare;
+  };
+
+  // then the tiles sorted by id
+  struct tile_t {
+    uint32_t tile_id;                         // level and tileindex of the tile
+    uint32_t color;                           // tiles of the same color are neighbours or
+                                              // neighbours of neighbours
+    uint32_t component[kComponentSetCount];   // the component of each set most nodes are in
+    uint32_t first_node[kComponentSetCount];  // the node_t of the tile in each set start here and
+                                              // end where the next tile's do
+  };
+
+  // then of each set the nodes that are not in the component of their tile sorted by tile and
+  // index, nodes no edge of a strong set touches are never asked about and not listed
+  struct node_t {
+    uint32_t index;     // the index of the node in its tile
+    uint32_t component; // the component it is in
+  };
+
+  // and last of each set the kComponentLeft and kComponentEntered flags of every component
+
+  static constexpr char kMagic[8] = {'V', 'H', 'C', 'O', 'N', 'N', '\0', '\0'};
+  static constexpr uint32_t kVersion = 2;
+
   /**
    * Constructs the connectivity map
    * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
    * @param graphreader optional pointer to the graph reader to use. If null, then the reader will be
    * constructed using pt.
+   *
+   * The connectivity valhalla_build_connectivity wrote to the tile extract or the tile_dir is
+   * mapped when there is one, only otherwise are the tiles of each level colored by flood fill.
    */
   connectivity_map_t(const boost::property_tree::ptree& pt,
                      const std::shared_ptr<GraphReader>& graph_reader = {});
 
+  /**
+   * Maps the connectivity valhalla_build_connectivity wrote for the tiles of a reader, which
+   * unlike the constructor never colors the tiles at startup.
+   * @param reader  the reader of the tiles
+   * @return the connectivity, nullptr if the tiles dont have one
+   */
+  static std::shared_ptr<const connectivity_map_t> load(const std::shared_ptr<GraphReader>& reader);
+
   /**
    * Alternative to GetTiles() to query whether a level even exists, e.g. transit.#
    *
@@ -73,14 +151,95 @@ public:
    * @return Returns true if the level has data, false if it does not (no tiles present)
    */
   bool has_data(const uint32_t level) const {
-    auto c = colors.find(level);
-    return (c == colors.end()) ? false : c->second.size() > 0;
+    return level_color_exists(level);
   }
 
+  /**
+   * Whether the components of the nodes are known, which they only are when the connectivity was
+   * built by valhalla_build_connectivity.
+   * @return true if get_component can tell nodes apart
+   */
+  bool has_components() const {
+    return has_components_;
+  }
+
+  /**
+   * Returns the component of a node, see ComponentSet. There is no path between nodes of
+   * different weak components for any mode, whatever its costing allows.
+   *
+   * @param node  the node
+   * @param set   the set of components
+   * @return the component, kNoComponent if it isnt known
+   */
+  uint32_t get_component(const GraphId& node, ComponentSet set = ComponentSet::kWeak) const;
+
+  /**
+   * Whether the strong components of a set tell there is no path from one node to another, which
+   * they do when the nodes are in different components and no edge leaves the first or enters
+   * the second.
+   *
+   * @param from  the node the path would start at
+   * @param to    the node the path would end at
+   * @param set   the set of components
+   * @return true if there is no path, false if there may be one or the components arent known
+   */
+  bool unreachable(const GraphId& from, const GraphId& to, ComponentSet set) const;
+
+  /**
+   * The set of strong components a costing can use, the first one that has all of its access.
+   * @param access_mask  the access of the costing
+   * @param set          the set it can use
+   * @return false if there is no set with all of its access
+   */
+  static bool strong_components(uint32_t access_mask, ComponentSet& set);
+
+  /**
+   * Returns the components of the edges a location was correlated to, an edge is in the
+   * component of its end node.
+   *
+   * @param location  the correlated location
+   * @param reader    to look up the end nodes of its edges
+   * @return the components, empty if they arent known or one of the edges is in no component
+   */
+  std::unordered_set<uint32_t> get_components(const baldr::PathLocation& location,
+                                              GraphReader& reader) const;
+
+  /**
+   * Colors the tiles of each level by flood filling the tiles that are neighbours, which is what
+   * happens at startup when the connectivity wasnt built with valhalla_build_connectivity.
+   *
+   * @param tiles  the tiles of the tileset
+   * @return the tiles sorted by id with their colors and kNoComponent as their component
+   */
+  static std::vector<tile_t> color_tiles(const std::unordered_set<GraphId>& tiles);
+
 private:
+  connectivity_map_t();
+  // map the connectivity.bin in the extract or the tile_dir of the reader, false if there is none
+  bool open(const std::shared_ptr<GraphReader>& reader);
+  // use the connectivity.bin at data when it is valid, false otherwise
+  bool load(const char* data, size_t size);
+  // the tile of an id, nullptr if there is no such tile
+  const tile_t* find_tile(const GraphId& id) const;
+
   uint32_t transit_level;
-  // this is a map(tile_level, map(tile_id, tile_color))
-  std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> colors;
+  // the tiles sorted by id and the nodes out of the component of their tile, which either point
+  // into connectivity.bin or into the colors computed at startup
+  const tile_t* tiles_ = nullptr;
+  size_t tile_count_ = 0;
+  const node_t* nodes_[kComponentSetCount] = {};
+  size_t node_count_[kComponentSetCount] = {};
+  const uint8_t* flags_[kComponentSetCount] = {};
+  size_t component_count_[kComponentSetCount] = {};
+  bool has_components_ = false;
+  // which levels have tiles
+  std::vector<bool> levels_;
+  // connectivity.bin when it was mapped from the tile_dir
+  midgard::mem_map<char> file_;
+  // keeps the extract mapped when connectivity.bin was found in it
+  std::shared_ptr<GraphReader> reader_;
+  // the colors when they were computed at startup
+  std::vector<tile_t> computed_;
 };
 } // namespace baldr
 } // namespace valhalla
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kInvalidArc = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t kInvalidContractionNode = std::numeric_limits<uint32_t>::max();
+
+/**
+ * An arc of a contraction overlay. An arc is either a directed edge of the routing graph
+ * or a shortcut which replaces two arcs via a node that was contracted before both ends.
+ */
+struct ContractionArc {
+  uint32_t from;   // index of the node the arc starts at
+  uint32_t to;     // index of the node the arc ends at
+  float cost;      // cost of the arc
+  float secs;      // time along the arc in seconds
+  uint32_t length; // length of the arc in meters
+  uint32_t first;  // first arc replaced by a shortcut, kInvalidArc for edges of the graph
+  uint32_t second; // second arc replaced by a shortcut, kInvalidArc for edges of the graph
+  uint32_t spare;
+  uint64_t edgeid; // the directed edge for arcs which are edges of the graph
+
+  bool is_shortcut() const {
+    return first != kInvalidArc;
+  }
+};
+
+/**
+ * A contraction hierarchy over the nodes of one level of the routing graph computed offline
+ * for one costing (see mjolnir::ContractionBuilder). Every node is given a rank and the arcs
+ * are split into those going up in rank, used by the forward search, and those coming down,
+ * used by the reverse search. The overlay is node based so turn costs and complex restrictions
+ * are not part of it, users need to validate paths they unpack from it.
+ */
+class ContractionOverlay {
+public:
+  ContractionOverlay() = default;
+
+  /**
+   * Creates an overlay from the contracted graph
+   * @param nodes       the graph ids of the nodes, sorted
+   * @param ranks       the rank of each node
+   * @param arcs        the edges of the graph and the shortcuts added while contracting
+   * @param level       the hierarchy level the nodes are on
+   * @param costing     name of the costing the arcs were costed with
+   * @param dataset_id  the dataset id of the tiles the overlay was built from
+   */
+  ContractionOverlay(std::vector<GraphId> nodes,
+                     std::vector<uint32_t> ranks,
+                     std::vector<ContractionArc> arcs,
+                     const uint8_t level,
+                     const std::string& costing,
+                     const uint64_t dataset_id);
+
+  /**
+   * Where the overlay of the given costing lives inside the tile directory
+   * @param tile_dir  the tile directory
+   * @param costing   name of the costing
+   * @return the path of the overlay file
+   */
+  static std::string file_name(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * Loads an overlay written by Save. Throws if the file is missing or malformed.
+   * @param file_name  the file to load
+   * @return the overlay
+   */
+  static std::shared_ptr<const ContractionOverlay> Load(const std::string& file_name);
+
+  /**
+   * Writes the overlay to a file, creating the parent directories as needed
+   * @param file_name  the file to write
+   */
+  void Save(const std::string& file_name) const;
+
+  /**
+   * Index of the node with the given graph id
+   * @param node  graph id of the node
+   * @return the index or kInvalidContractionNode if the node is not part of the overlay
+   */
+  uint32_t node_index(const GraphId& node) const;
+
+  const GraphId& node(const uint32_t index) const {
+    return nodes_[index];
+  }
+
+  uint32_t rank(const uint32_t index) const {
+    return ranks_[index];
+  }
+
+  const ContractionArc& arc(const uint32_t index) const {
+    return arcs_[index];
+  }
+
+  size_t node_count() const {
+    return nodes_.size();
+  }
+
+  size_t arc_count() const {
+    return arcs_.size();
+  }
+
+  uint8_t level() const {
+    return level_;
+  }
+
+  const std::string& costing() const {
+    return costing_;
+  }
+
+  uint64_t dataset_id() const {
+    return dataset_id_;
+  }
+
+  /**
+   * The arcs leaving a node towards higher ranked nodes
+   * @param index  the node
+   * @return begin and end of the arc indices
+   */
+  std::pair<const uint32_t*, const uint32_t*> up(const uint32_t index) const {
+    return {up_arcs_.data() + up_offsets_[index], up_arcs_.data() + up_offsets_[index + 1]};
+  }
+
+  /**
+   * The arcs entering a node from higher ranked nodes
+   * @param index  the node
+   * @return begin and end of the arc indices
+   */
+  std::pair<const uint32_t*, const uint32_t*> down(const uint32_t index) const {
+    return {down_arcs_.data() + down_offsets_[index], down_arcs_.data() + down_offsets_[index + 1]};
+  }
+
+  /**
+   * Appends the directed edges an arc stands for, shortcuts are recursively expanded
+   * @param arc    index of the arc
+   * @param edges  the edges are appended here in travel order
+   */
+  void Unpack(const uint32_t arc, std::vector<GraphId>& edges) const;
+
+protected:
+  std::vector<GraphId> nodes_;
+  std::vector<uint32_t> ranks_;
+  std::vector<ContractionArc> arcs_;
+  std::vector<uint32_t> up_offsets_;
+  std::vector<uint32_t> up_arcs_;
+  std::vector<uint32_t> down_offsets_;
+  std::vector<uint32_t> down_arcs_;
+  uint8_t level_ = 0;
+  std::string costing_;
+  uint64_t dataset_id_ = 0;
+
+  // splits the arcs into the up and down adjacency lists
+  void Index();
+};
+
+/**
+ * Bidirectional search over a contraction overlay. Both directions only relax arcs
+ * towards higher ranked nodes and the cheapest meeting node is the shortest path. The
+ * search keeps its buffers around so that reusing an instance avoids allocations.
+ */
+class ContractionSearch {
+public:
+  struct seed_t {
+    uint32_t node;
+    float cost;
+  };
+
+  /**
+   * Finds the cheapest path from any of the sources to any of the targets
+   * @param overlay  the overlay to search
+   * @param sources  nodes and the cost of getting to them to start the forward search from
+   * @param targets  nodes and the cost of getting from them to start the reverse search from
+   * @param arcs     arcs of the path in travel order, empty if the best source is a target
+   * @param source   the source node the path starts at
+   * @param target   the target node the path ends at
+   * @return the cost of the path including the seed costs, max float if there is none
+   */
+  float Find(const ContractionOverlay& overlay,
+             const std::vector<seed_t>& sources,
+             const std::vector<seed_t>& targets,
+             std::vector<uint32_t>& arcs,
+             uint32_t& source,
+             uint32_t& target);
+
+protected:
+  using queue_t = std::priority_queue<std::pair<float, uint32_t>,
+                                      std::vector<std::pair<float, uint32_t>>,
+                                      std::greater<std::pair<float, uint32_t>>>;
+
+  struct direction_t {
+    std::vector<float> costs;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> touched;
+    queue_t queue;
+
+    void reset(const size_t node_count);
+    void seed(const seed_t& seed);
+  };
+
+  direction_t forward_;
+  direction_t reverse_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/tilegetter.h>
@@ -10,7 +11,8 @@ namespace valhalla {
 namespace baldr {
 
 /**
- * Default implementation which uses libcurl and curler_pool_t.
+ * Default implementation which uses libcurl and curler_pool_t. Concurrent requests for the same url
+ * through any of the getters of the process are coalesced into one, the others wait for it
  */
 class curl_tile_getter_t : public tile_getter_t {
 public:
@@ -18,31 +20,34 @@ public:
    * @param pool_size  the number of curler instances in the pool
    * @param user_agent  user agent to use by curlers for HTTP requests
    * @param gzipped  whether to request for gzip compressed data
+   * @param tile_suffix  the suffix of the tile files to request, .gph.zst or .gph.lz4 for
+   *                     compressed ones
    */
-  curl_tile_getter_t(const size_t pool_size, const std::string& user_agent, bool gzipped)
-      : curlers_(pool_size, user_agent), gzipped_(gzipped) {
+  curl_tile_getter_t(const size_t pool_size,
+                     const std::string& user_agent,
+                     bool gzipped,
+                     std::string tile_suffix = ".gph")
+      : curlers_(pool_size, user_agent), gzipped_(gzipped), tile_suffix_(std::move(tile_suffix)) {
   }
 
   using response_t = tile_getter_t::response_t;
 
-  response_t get(const std::string& url) override {
-    scoped_curler_t curler(curlers_);
-    long http_code = 0;
-    auto tile_data = curler.get()(url, http_code, gzipped_, interrupt_);
-    response_t result;
-    // TODO: Check other codes.
-    if (http_code == 200) {
-      result.bytes_ = std::move(tile_data);
-      result.status_ = tile_getter_t::status_code_t::SUCCESS;
-    }
+  response_t get(const std::string& url) override;
 
-    return result;
-  }
+  /**
+   * Fetches the urls at once with a single curler, multiplexing them over one connection when the
+   * server speaks http/2
+   */
+  std::vector<response_t> get_batch(const std::vector<std::string>& urls) override;
 
   bool gzipped() const override {
     return gzipped_;
   }
 
+  std::string tile_suffix() const override {
+    return tile_suffix_;
+  }
+
   using interrupt_t = tile_getter_t::interrupt_t;
 
   void set_interrupt(const interrupt_t* interrupt) override {
@@ -50,8 +55,12 @@ public:
   }
 
 private:
+  // fetches the url without coalescing it with other requests
+  response_t fetch(const std::string& url);
+
   curler_pool_t curlers_;
   const bool gzipped_;
+  const std::string tile_suffix_;
   const interrupt_t* interrupt_ = nullptr;
 };
 
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_DATETIME_H_
 #define VALHALLA_BALDR_DATETIME_H_
 
+#include <atomic>
 #include <cstdint>
 #include <ctime>
 #include <iomanip>
@@ -39,15 +40,53 @@ namespace valhalla {
 namespace baldr {
 namespace DateTime {
 
+/**
+ * The offsets from utc of a timezone over the dates routes are asked for, so the local time of a
+ * utc time is a binary search over the transitions of the timezone instead of a date::zoned_time.
+ * Times outside of that range still go through the timezone.
+ */
+class tz_offsets_t {
+public:
+  // 1970-01-01 and 2100-01-01 in seconds since epoch
+  static constexpr int64_t kBegin = 0;
+  static constexpr int64_t kEnd = 4102444800;
+
+  explicit tz_offsets_t(const date::time_zone* time_zone);
+
+  /**
+   * Get the offset from utc
+   * @param seconds  seconds since epoch
+   * @return the seconds to add to the utc time to get the local time
+   */
+  int32_t offset(int64_t seconds) const;
+
+protected:
+  const date::time_zone* time_zone_;
+  // the times at which each offset starts, the first one at kBegin
+  std::vector<int64_t> begins_;
+  std::vector<int32_t> offsets_;
+};
+
 // tz db
 struct tz_db_t {
   tz_db_t();
+  ~tz_db_t();
   size_t to_index(const std::string& zone) const;
   const date::time_zone* from_index(size_t index) const;
 
+  /**
+   * Get the offsets of a timezone, they are made the first time they are asked for and never
+   * change after that so threads look them up without a lock
+   * @param time_zone  a timezone from this db
+   * @return the offsets, nullptr if the timezone is not one of this db
+   */
+  const tz_offsets_t* offsets(const date::time_zone* time_zone) const;
+
 protected:
   std::unordered_map<std::string, size_t> names;
   const date::tzdb& db;
+  // the offsets of each zone once they were asked for
+  std::unique_ptr<std::atomic<const tz_offsets_t*>[]> offsets_;
 };
 
 /**
@@ -102,7 +141,8 @@ uint64_t seconds_since_epoch(const std::string& date_time, const date::time_zone
  * @param   seconds       seconds since epoch
  * @param   origin_tz     timezone for origin
  * @param   dest_tz       timezone for dest
- * @param   cache         a cache for timezone sys_info lookup (since its expensive)
+ * @param   cache         a cache for timezone sys_info lookup (since its expensive), only used for
+ *                        times outside of the offset tables of the timezones
  * @return Returns the seconds difference between the 2 timezones.
  */
 using tz_sys_info_cache_t = std::unordered_map<const date::time_zone*, std::vector<date::sys_info>>;
@@ -0,0 +1,88 @@
+#ifndef VALHALLA_BALDR_DEFAULTEDGECOSTS_H_
+#define VALHALLA_BALDR_DEFAULTEDGECOSTS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Costs of the directed edges of a tile that a costing computed with its default options. Most
+ * requests do not change the options of their costing and do not depart at a time, their edge
+ * costs are then the same for every request and a tile keeps them in an array per costing. The
+ * array of a costing is filled for the whole tile the first time it is asked for and not changed
+ * after, so the entries it hands out stay valid for as long as the tile lives.
+ */
+class DefaultEdgeCosts {
+public:
+  // The costings that keep their default costs, each has its own array
+  enum Costing : uint32_t { kAuto = 0, kTruck = 1 };
+  static constexpr uint32_t kCostingCount = 2;
+
+  // Used by costings whose options are not the defaults
+  static constexpr uint32_t kNone = kCostingCount;
+
+  struct Entry {
+    float cost;
+    float secs;
+    uint8_t flow_sources;
+  };
+
+  /**
+   * Constructor.
+   * @param  edge_count  Number of directed edges in the tile.
+   */
+  explicit DefaultEdgeCosts(const uint32_t edge_count);
+  ~DefaultEdgeCosts();
+
+  DefaultEdgeCosts(const DefaultEdgeCosts&) = delete;
+  DefaultEdgeCosts& operator=(const DefaultEdgeCosts&) = delete;
+
+  /**
+   * Get the default costs of a costing, filling them when this is the first time they are asked
+   * for. Threads racing to fill the same costing each compute them and all but one throw theirs
+   * away.
+   * @param  costing  The costing.
+   * @param  fill     Computes the entries of all directed edges of the tile, in edge order.
+   * @return the entries of the directed edges of the tile
+   */
+  template <typename fill_t> const Entry* get(const uint32_t costing, const fill_t& fill) const {
+    const Entry* costs = costs_[costing].load(std::memory_order_acquire);
+    return costs ? costs : Fill(costing, std::function<void(Entry*)>(fill));
+  }
+
+  /**
+   * Number of directed edges there are entries for.
+   */
+  uint32_t edge_count() const {
+    return edge_count_;
+  }
+
+  /**
+   * Bytes the filled arrays take up.
+   */
+  size_t memory_usage() const;
+
+  /**
+   * Whether tiles keep the default edge costs of costings. This is set by the GraphReader from
+   * mjolnir.default_edge_costs and applies to the whole process.
+   */
+  static bool enabled();
+  static void set_enabled(const bool enabled);
+
+protected:
+  const Entry* Fill(const uint32_t costing, const std::function<void(Entry*)>& fill) const;
+
+  uint32_t edge_count_;
+
+  // Filled once and then only read, an array per costing
+  mutable std::array<std::atomic<const Entry*>, kCostingCount> costs_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_DEFAULTEDGECOSTS_H_
@@ -0,0 +1,108 @@
+#ifndef VALHALLA_BALDR_DIRECTEDEDGEHOT_H_
+#define VALHALLA_BALDR_DIRECTEDEDGEHOT_H_
+
+#include <cstdint>
+#include <memory>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The fields of a directed edge that path expansion reads for every edge it looks at, besides
+ * the ones it only reads once an edge is allowed. 8 bytes instead of the 48 of a DirectedEdge.
+ */
+struct DirectedEdgeHotAttributes {
+  uint16_t forwardaccess; // Access modes in the forward direction
+  uint16_t reverseaccess; // Access modes in the reverse direction
+  uint8_t speed;          // Average speed in KPH
+  uint8_t use;            // Specialized use, see baldr::Use
+  uint8_t classification; // Road class, see baldr::RoadClass
+  uint8_t spare;
+};
+static_assert(sizeof(DirectedEdgeHotAttributes) == 8, "Hot attributes must stay 8 bytes");
+
+/**
+ * Structure of arrays copy of the hot routing fields of the directed edges of a tile. Walking the
+ * edges leaving a node through these arrays touches 20 bytes per edge spread over three dense
+ * arrays instead of a 48 byte DirectedEdge each, so more of the neighbourhood stays in cache.
+ * The copy is made when the tile is loaded and is never written afterwards.
+ */
+class DirectedEdgeHot {
+public:
+  DirectedEdgeHot() = default;
+
+  /**
+   * Copy the hot fields out of the directed edges of a tile.
+   * @param  edges  Directed edges of the tile.
+   * @param  count  Number of directed edges.
+   */
+  DirectedEdgeHot(const DirectedEdge* edges, const uint32_t count)
+      : endnodes_(new uint64_t[count]), lengths_(new uint32_t[count]),
+        attributes_(new DirectedEdgeHotAttributes[count]), count_(count) {
+    for (uint32_t i = 0; i < count; ++i) {
+      const auto& edge = edges[i];
+      endnodes_[i] = edge.endnode().value;
+      lengths_[i] = edge.length();
+      attributes_[i] = {static_cast<uint16_t>(edge.forwardaccess()),
+                        static_cast<uint16_t>(edge.reverseaccess()),
+                        static_cast<uint8_t>(edge.speed()),
+                        static_cast<uint8_t>(edge.use()),
+                        static_cast<uint8_t>(edge.classification()),
+                        0};
+    }
+  }
+
+  /**
+   * Number of edges copied, 0 when the tile has no hot fields.
+   */
+  uint32_t size() const {
+    return count_;
+  }
+
+  /**
+   * Bytes the copied fields take up.
+   */
+  size_t memory_usage() const {
+    return static_cast<size_t>(count_) *
+           (sizeof(uint64_t) + sizeof(uint32_t) + sizeof(DirectedEdgeHotAttributes));
+  }
+
+  /**
+   * Gets the end node of a directed edge.
+   * @param  idx  Directed edge index within the tile.
+   */
+  GraphId endnode(const uint32_t idx) const {
+    return GraphId(endnodes_[idx]);
+  }
+
+  /**
+   * Gets the length of a directed edge in meters.
+   * @param  idx  Directed edge index within the tile.
+   */
+  uint32_t length(const uint32_t idx) const {
+    return lengths_[idx];
+  }
+
+  /**
+   * Gets the access, speed, use and classification of a directed edge.
+   * @param  idx  Directed edge index within the tile.
+   */
+  const DirectedEdgeHotAttributes& attributes(const uint32_t idx) const {
+    return attributes_[idx];
+  }
+
+protected:
+  std::unique_ptr<uint64_t[]> endnodes_;
+  std::unique_ptr<uint32_t[]> lengths_;
+  std::unique_ptr<DirectedEdgeHotAttributes[]> attributes_;
+  uint32_t count_ = 0;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_DIRECTEDEDGEHOT_H_
@@ -0,0 +1,77 @@
+#ifndef VALHALLA_BALDR_EDGEELEVATION_H_
+#define VALHALLA_BALDR_EDGEELEVATION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+// Ascent and descent are kept in decimeters in 16 bits
+constexpr float kMaxEdgeElevationChange = 6553.5f;
+
+/**
+ * Summary of the elevation profile of a directed edge in the direction of travel, precomputed by
+ * the ElevationBuilder from the heights it samples along the shape. Unlike the weighted grade it
+ * keeps every climb of an edge, so rolling terrain that ends where it started still counts.
+ */
+struct EdgeElevation {
+  uint16_t ascent_;  // total climb in decimeters
+  uint16_t descent_; // total drop in decimeters
+
+  /**
+   * Get the total climb along the edge.
+   * @return the ascent in meters
+   */
+  float ascent() const {
+    return ascent_ * 0.1f;
+  }
+
+  /**
+   * Set the total climb along the edge, clamped to what can be stored.
+   * @param  ascent  the ascent in meters
+   */
+  void set_ascent(const float ascent) {
+    ascent_ =
+        static_cast<uint16_t>(std::round(std::clamp(ascent, 0.f, kMaxEdgeElevationChange) * 10));
+  }
+
+  /**
+   * Get the total drop along the edge.
+   * @return the descent in meters
+   */
+  float descent() const {
+    return descent_ * 0.1f;
+  }
+
+  /**
+   * Set the total drop along the edge, clamped to what can be stored.
+   * @param  descent  the descent in meters
+   */
+  void set_descent(const float descent) {
+    descent_ =
+        static_cast<uint16_t>(std::round(std::clamp(descent, 0.f, kMaxEdgeElevationChange) * 10));
+  }
+
+  /**
+   * Get the average climbing grade of the edge in the encoding of DirectedEdge::weighted_grade
+   * (-10% to +15% mapped to 0 to 15), so costing can use it in place of the weighted grade.
+   * @param  length  the length of the edge in meters
+   * @return the grade index
+   */
+  uint32_t climb_grade(const uint32_t length) const {
+    if (length == 0) {
+      return 6;
+    }
+    const float grade = std::min(100.f * ascent() / length, 15.f);
+    return static_cast<uint32_t>(grade * .6f + 6.5f);
+  }
+};
+
+static_assert(sizeof(EdgeElevation) == 4, "EdgeElevation size is unexpected");
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_EDGEELEVATION_H_
@@ -9,6 +9,7 @@
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/json.h>
+#include <valhalla/baldr/shapecache.h>
 #include <valhalla/midgard/encoded.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
@@ -80,8 +81,14 @@ public:
    * @param  ptr  Pointer to a bit of memory that has the info for this edge
    * @param  names_list  Pointer to the start of the text/names list.
    * @param  names_list_length  Length (bytes) of the text/names list.
+   * @param  shape_cache  The decoded shape cache of the tile, if it has one.
+   * @param  offset  Offset of the edge info within the tile, the key of its shape in the cache.
    */
-  EdgeInfo(char* ptr, const char* names_list, const size_t names_list_length);
+  EdgeInfo(char* ptr,
+           const char* names_list,
+           const size_t names_list_length,
+           const ShapeCache* shape_cache = nullptr,
+           const uint32_t offset = 0);
 
   /**
    * Destructor
@@ -206,7 +213,17 @@ public:
    */
   const std::vector<midgard::PointLL>& shape() const;
 
+  /**
+   * Whether the tile of the edge caches its decoded shapes, so that shape() is cheaper than
+   * decoding lazy_shape() once.
+   * @return  Returns true if the shape is decoded through the cache of the tile.
+   */
+  bool shape_cached() const {
+    return shape_cache_ != nullptr && encoded_shape_ != nullptr;
+  }
+
   midgard::Shape7Decoder<midgard::PointLL> lazy_shape() const {
+    ShapeCache::count_decode();
     return midgard::Shape7Decoder<midgard::PointLL>(encoded_shape_, ei_.encoded_shape_size_);
   }
 
@@ -279,6 +296,13 @@ protected:
   // Lng, lat shape of the edge
   mutable std::vector<midgard::PointLL> shape_;
 
+  // The decoded shape cache of the tile and the offset of this edge info within the tile
+  const ShapeCache* shape_cache_;
+  uint32_t offset_;
+
+  // Lng, lat shape of the edge when it comes from the cache of the tile
+  mutable ShapeCache::Shape cached_shape_;
+
   // The list of names within the tile
   const char* names_list_;
 
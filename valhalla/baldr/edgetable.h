@@ -0,0 +1,113 @@
+#ifndef VALHALLA_BALDR_EDGETABLE_H_
+#define VALHALLA_BALDR_EDGETABLE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Attributes of one directed edge that a request can refer to by table instead of sending along
+struct EdgeTableEntry {
+  uint32_t speed : 8;    // speed in kph replacing the one of the costing model, 0 keeps it
+  uint32_t penalty : 16; // penalty in seconds added to the cost of the edge
+  uint32_t banned : 1;   // the edge must not be used
+  uint32_t spare : 7;
+};
+
+// Start of an edge table file
+struct EdgeTableHeader {
+  char magic[8];       // kEdgeTableMagic
+  uint32_t version;    // kEdgeTableVersion
+  uint32_t tile_count; // number of EdgeTableTile records following the header
+};
+
+// Where the entries of one graph tile are in an edge table file
+struct EdgeTableTile {
+  uint64_t tile_id;    // the base graph id of the tile
+  uint32_t offset;     // index of the entry of the first edge of the tile
+  uint32_t edge_count; // entries of the tile, edges past the end of them have none
+};
+
+static_assert(sizeof(EdgeTableEntry) == sizeof(uint32_t), "EdgeTableEntry size is unexpected");
+static_assert(sizeof(EdgeTableHeader) == 16, "EdgeTableHeader size is unexpected");
+static_assert(sizeof(EdgeTableTile) == 16, "EdgeTableTile size is unexpected");
+
+constexpr char kEdgeTableMagic[8] = {'V', 'A', 'L', 'E', 'D', 'G', 'E', 'S'};
+constexpr uint32_t kEdgeTableVersion = 1;
+constexpr char kEdgeTableSuffix[] = ".edges";
+
+/**
+ * A memory mapped table of per edge speeds, penalties and bans keyed by graph tile and edge index,
+ * laid out like this:
+ *
+ * EdgeTableHeader
+ * tile_count x EdgeTableTile
+ * n x EdgeTableEntry, the entries of each tile indexed by the id of the edge within the tile
+ *
+ * Tables live in mjolnir.edge_table_dir as <id>.edges and costing options name the one to use with
+ * edge_table. To swap a table out write the new one next to it and rename it over the old one,
+ * requests that already hold the old table keep using it.
+ */
+class EdgeTable {
+public:
+  /**
+   * Maps an edge table file.
+   * @param file_name  the file to map
+   * @throws std::runtime_error if the file is not a valid edge table
+   */
+  explicit EdgeTable(const std::string& file_name);
+
+  /**
+   * Get the entry of an edge.
+   * @param edge_id  the directed edge
+   * @return the entry or nullptr if the table has none for the edge
+   */
+  const EdgeTableEntry* get(const GraphId& edge_id) const {
+    auto tile = tiles_.find(edge_id.Tile_Base());
+    if (tile == tiles_.cend() || edge_id.id() >= tile->second->edge_count) {
+      return nullptr;
+    }
+    return entries_ + tile->second->offset + edge_id.id();
+  }
+
+  /**
+   * Writes an edge table file. Tiles get entries up to the highest edge id they have one for.
+   * @param file_name  the file to write
+   * @param entries    the entries by directed edge
+   */
+  static void write(const std::string& file_name,
+                    const std::unordered_map<GraphId, EdgeTableEntry>& entries);
+
+  /**
+   * Get an edge table of mjolnir.edge_table_dir by its id. Tables are loaded the first time they
+   * are asked for and reloaded when their file changed, which is checked at most once a second.
+   * @param id  the id of the table, its file name without the suffix
+   * @return the table or an empty pointer if there is no such table
+   * @throws std::runtime_error if the id is not made of letters, digits, '-' and '_' or the file
+   *         is not a valid edge table
+   */
+  static std::shared_ptr<const EdgeTable> get(const std::string& id);
+
+  /**
+   * Directory edge tables are loaded from, empty when requests cannot use them. This is set by the
+   * GraphReader from mjolnir.edge_table_dir and applies to the whole process.
+   */
+  static std::string dir();
+  static void set_dir(const std::string& dir);
+
+protected:
+  midgard::mem_map<char> memory_;
+  const EdgeTableEntry* entries_;
+  std::unordered_map<uint64_t, const EdgeTableTile*> tiles_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_EDGETABLE_H_
@@ -0,0 +1,95 @@
+#ifndef VALHALLA_BALDR_FREQUENCYSKETCH_H_
+#define VALHALLA_BALDR_FREQUENCYSKETCH_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Count-min sketch of how often keys were seen recently, as used by TinyLFU cache admission. Each
+ * key has a counter in each of 4 rows, the estimate is the smallest of them so collisions can
+ * only overestimate. Counters saturate at 15 and are all halved once 10 times the width of the
+ * sketch was counted, so keys that were popular a while ago fade out. Costs 4 bytes per counter
+ * column, it is not thread-safe.
+ */
+class FrequencySketch {
+public:
+  /**
+   * Constructor.
+   * @param  expected_keys  number of distinct keys the sketch should tell apart, the width is
+   *                        the next power of 2
+   */
+  explicit FrequencySketch(const size_t expected_keys) {
+    size_t width = 64;
+    while (width < expected_keys) {
+      width <<= 1;
+    }
+    mask_ = width - 1;
+    counters_.assign(width * kRows, 0);
+    sample_size_ = width * 10;
+  }
+
+  /**
+   * Count one occurrence of a key.
+   * @param  key  the key
+   */
+  void increment(const uint64_t key) {
+    for (size_t row = 0; row < kRows; ++row) {
+      auto& counter = counters_[index(key, row)];
+      counter += counter < kMaxCount;
+    }
+    if (++additions_ == sample_size_) {
+      for (auto& counter : counters_) {
+        counter >>= 1;
+      }
+      additions_ /= 2;
+    }
+  }
+
+  /**
+   * Estimate how often a key was seen recently.
+   * @param  key  the key
+   * @return the estimated count, at most 15
+   */
+  uint32_t estimate(const uint64_t key) const {
+    uint8_t count = kMaxCount;
+    for (size_t row = 0; row < kRows; ++row) {
+      count = std::min(count, counters_[index(key, row)]);
+    }
+    return count;
+  }
+
+  /**
+   * Forget everything that was counted.
+   */
+  void clear() {
+    std::fill(counters_.begin(), counters_.end(), 0);
+    additions_ = 0;
+  }
+
+protected:
+  static constexpr size_t kRows = 4;
+  static constexpr uint8_t kMaxCount = 15;
+
+  size_t index(const uint64_t key, const size_t row) const {
+    // splitmix64 finalizer with a different seed per row
+    uint64_t h = key + 0x9e3779b97f4a7c15ULL * (row + 1);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return row * (mask_ + 1) + (h & mask_);
+  }
+
+  std::vector<uint8_t> counters_;
+  size_t mask_;
+  size_t additions_ = 0;
+  size_t sample_size_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_FREQUENCYSKETCH_H_
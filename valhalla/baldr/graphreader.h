@@ -1,26 +1,35 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <limits>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/curler.h>
+#include <valhalla/baldr/frequencysketch.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/incidenttile.h>
+#include <valhalla/baldr/landmarkstore.h>
+#include <valhalla/baldr/sharedtilestore.h>
+#include <valhalla/baldr/tileaccesslog.h>
 #include <valhalla/baldr/tilegetter.h>
 #include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/baldr/tileprefetcher.h>
 
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/sequence.h>
 
-#include <valhalla/proto/incidents.pb.h>
 
 namespace valhalla {
 namespace baldr {
@@ -31,13 +40,24 @@ struct tile_gone_error_t : public std::runtime_error {
 };
 
 struct IncidentResult {
-  std::shared_ptr<const IncidentsTile> tile;
+  std::shared_ptr<const IncidentTile> tile;
   // Index into the Location array
   int start_index;
   // Index into the Location array
   int end_index;
 };
 
+/**
+ * How much of a tile cache the tiles of one hierarchy level take up.
+ */
+struct TileCacheLevelUsage {
+  uint32_t level = 0;
+  size_t tiles = 0;      // tiles of the level in the cache
+  size_t bytes = 0;      // memory those tiles take up
+  size_t max_bytes = 0;  // the budget of the level, 0 if it shares the whole cache
+  uint64_t rejected = 0; // tiles of the level that were not admitted to the cache
+};
+
 /**
  * Tile cache interface.
  */
@@ -92,6 +112,14 @@ public:
    *  Some implementations may simply clear the entire cache
    */
   virtual void Trim() = 0;
+
+  /**
+   * Get the usage of the cache by hierarchy level, only caches that track it report any.
+   * @return the levels that have tiles in the cache or a budget
+   */
+  virtual std::vector<TileCacheLevelUsage> GetLevelUsage() const {
+    return {};
+  }
 };
 
 /**
@@ -248,7 +276,13 @@ protected:
 
 /**
  * Class that manages simple tile cache and makes sure it's never overcommited.
- * The eviction policy is least
+ * The eviction policy is least recently used.
+ *
+ * The cache can be split into budgets by hierarchy level, each with its own share of the memory
+ * limit and its own LRU list, so a burst of local tiles only evicts other local tiles and leaves
+ * the highway tiles alone. With hard memory control it can also use TinyLFU admission: a tile that
+ * would evict another one is only admitted if it was asked for more often recently than the tile
+ * it would evict, otherwise it is handed back without being cached.
  * It is NOT thread-safe!
  */
 class TileCacheLRU : public TileCache {
@@ -260,10 +294,17 @@ public:
 
   /**
    * Constructor.
-   * @param max_size     maximum size of the cache
-   * @param mem_control  strategy our cache will use to control its memory
+   * @param max_size      maximum size of the cache
+   * @param mem_control   strategy our cache will use to control its memory
+   * @param level_shares  share of max_size of each hierarchy level, levels past the end use the
+   *                      last share. The shares are scaled to add up to 1, empty for no budgets
+   * @param admission     only admit tiles that are asked for more often than what they evict,
+   *                      needs hard memory control
    */
-  TileCacheLRU(size_t max_size, MemoryLimitControl mem_control);
+  TileCacheLRU(size_t max_size,
+               MemoryLimitControl mem_control,
+               const std::vector<float>& level_shares = {},
+               bool admission = false);
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
@@ -310,25 +351,58 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Get the usage of the cache by hierarchy level.
+   * @return the levels that have tiles in the cache or a budget
+   */
+  std::vector<TileCacheLevelUsage> GetLevelUsage() const override;
+
 protected:
   struct KeyValue {
-    KeyValue(GraphId id_, graph_tile_ptr tile_) : id(id_), tile(std::move(tile_)) {
+    KeyValue(GraphId id_, graph_tile_ptr tile_, size_t size_)
+        : id(id_), tile(std::move(tile_)), size(size_) {
     }
     GraphId id;
     graph_tile_ptr tile;
+    size_t size;
   };
   using KeyValueIter = std::list<KeyValue>::iterator;
 
+  // The tiles sharing one part of the memory limit
+  struct Budget {
+    // Linked list of <GraphId, Tile> pairs.
+    // The most recently used item is at the beginning and the least one - at the back.
+    std::list<KeyValue> key_val_lru_list;
+    size_t cache_size = 0;
+    size_t max_cache_size = 0;
+  };
+
+  Budget& GetBudget(const GraphId& graphid) const {
+    return budgets_[std::min<size_t>(graphid.level(), budgets_.size() - 1)];
+  }
+
   /**
-   * If needed, delete cache items until required_size in bytes is free in cache.
+   * If needed, delete cache items of a budget until required_size in bytes is free in it.
    * The deletion starts from the items that have been unaccessed longer than others.
-   * Can potentially clean the entire cache.
+   * Can potentially clean the entire budget.
    *
-   * @param  required_size   size in bytes that should be free in the cache
+   * @param  budget          the budget to evict from
+   * @param  required_size   size in bytes that should be free in the budget
    *
    * @return  bytes freed by the eviction
    */
-  size_t TrimToFit(const size_t required_size);
+  size_t TrimToFit(Budget& budget, const size_t required_size);
+
+  /**
+   * Whether a new tile should go into the cache when it needs required_size bytes of its budget.
+   * Without admission or when the tile fits it always does, otherwise the tile has to be more
+   * frequent than the least recently used tile it would evict.
+   *
+   * @param  graphid         the new tile
+   * @param  budget          its budget
+   * @param  required_size   the size of the new tile
+   */
+  bool Admit(const GraphId& graphid, const Budget& budget, const size_t required_size) const;
 
   /**
    * Mark provided cache entry as most recently used.
@@ -340,9 +414,14 @@ protected:
   // The GraphId -> Iterator into the linked list which owns the cached objects
   std::unordered_map<uint64_t, KeyValueIter> cache_;
 
-  // Linked list of <GraphId, Tile> pairs.
-  // The most recently used item is at the beginning and the least one - at the back.
-  mutable std::list<KeyValue> key_val_lru_list_;
+  // The budgets by hierarchy level, a single one when the cache is not split
+  mutable std::vector<Budget> budgets_;
+
+  // Tiles, bytes and rejections by hierarchy level
+  std::array<TileCacheLevelUsage, kMaxGraphHierarchy + 1> level_usage_;
+
+  // How often tiles were asked for recently, only with admission
+  mutable std::unique_ptr<FrequencySketch> sketch_;
 
   // Determines how we deal with
   MemoryLimitControl mem_control_;
@@ -411,11 +490,156 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Get the usage of the wrapped cache by hierarchy level.
+   * @return the levels that have tiles in the cache or a budget
+   */
+  std::vector<TileCacheLevelUsage> GetLevelUsage() const override;
+
 private:
   TileCache& cache_;
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Thread-safe tile cache which splits the tiles over a number of independent shards keyed by
+ * GraphId::tile_value(). Each shard publishes an immutable snapshot of its index which readers
+ * load atomically, so a lookup never waits on the shard's write lock. Writers (Put, Trim, Clear)
+ * serialize per shard and publish a modified copy of the index, RCU style, the previous snapshot
+ * is freed once the last reader drops its reference to it.
+ *
+ * Eviction follows the TileCacheLRU semantics within each shard, the memory limit is divided
+ * evenly between the shards. Recency is tracked with a per shard clock which only advances on
+ * insertion, hits just stamp the entry with the current tick which keeps them free of writes to
+ * shared state. Entries touched between the same two insertions are therefore equally recent.
+ *
+ * Copies of the cache share the same shards, which is how multiple GraphReaders can use one cache.
+ */
+class ShardedTileCache : public TileCache {
+public:
+  /**
+   * Counters of the cache activity, summed over all shards
+   */
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param shard_count  number of shards to split the cache into
+   * @param mem_control  strategy our cache will use to control its memory
+   */
+  ShardedTileCache(size_t max_size,
+                   size_t shard_count,
+                   TileCacheLRU::MemoryLimitControl mem_control);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Evicts the least recently used tiles of every shard which is over its share of the limit.
+   */
+  void Trim() override;
+
+  /**
+   * Returns the hit, miss and eviction counters accumulated since construction
+   * @return the cache statistics
+   */
+  Stats GetStats() const;
+
+  /**
+   * Get the usage of the cache by hierarchy level, summed over all shards.
+   * @return the levels that have tiles in the cache
+   */
+  std::vector<TileCacheLevelUsage> GetLevelUsage() const override;
+
+protected:
+  struct Entry {
+    Entry(graph_tile_ptr tile_, size_t size_, uint64_t tick)
+        : tile(std::move(tile_)), size(size_), last_access(tick) {
+    }
+    graph_tile_ptr tile;
+    size_t size;
+    mutable std::atomic<uint64_t> last_access;
+  };
+  using index_t = std::unordered_map<uint64_t, std::shared_ptr<const Entry>>;
+
+  // cache line aligned so that the counters of neighbouring shards dont false share
+  struct alignas(64) Shard {
+    // the current snapshot, only ever accessed through std::atomic_load/std::atomic_store
+    std::shared_ptr<const index_t> index = std::make_shared<const index_t>();
+    // serializes the writers of this shard
+    std::mutex write_mutex;
+    std::atomic<size_t> cache_size{0};
+    std::atomic<uint64_t> clock{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+  };
+
+  inline Shard& GetShard(const GraphId& graphid) const {
+    return shards_->at(graphid.tile_value() % shards_->size());
+  }
+
+  /**
+   * Evict the least recently used entries of the shard until required_size bytes fit into it.
+   * Must be called while holding the shards write lock.
+   *
+   * @param  shard           the shard to evict from
+   * @param  index           the copy of the shards index to remove the evicted entries from
+   * @param  required_size   size in bytes that should be free in the shard
+   */
+  void TrimToFit(Shard& shard, index_t& index, size_t required_size) const;
+
+  std::shared_ptr<std::vector<Shard>> shards_;
+
+  // Determines how we deal with
+  TileCacheLRU::MemoryLimitControl mem_control_;
+
+  // The max cache size in bytes, of the entire cache and of each of its shards
+  size_t max_cache_size_;
+  size_t max_shard_size_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -448,7 +672,7 @@ public:
                        std::unique_ptr<tile_getter_t>&& tile_getter = nullptr,
                        bool traffic_readonly = true);
 
-  virtual ~GraphReader() = default;
+  virtual ~GraphReader();
 
   virtual void SetInterrupt(const tile_getter_t::interrupt_t* interrupt) {
     if (tile_getter_) {
@@ -469,6 +693,111 @@ public:
     return !tile_extract_->traffic_tiles.empty();
   }
 
+  /**
+   * Get the time of the most recent update of any traffic tile, it changes whenever live traffic
+   * is written to the traffic extract.
+   * @return seconds since epoch of the last update, 0 without live traffic
+   */
+  uint64_t GetTrafficLastUpdate() const;
+
+  /**
+   * Applies a batch of live speeds to the traffic of a tile in place, readers of the process see
+   * either none or all of them, see TrafficTile::update. The reader has to be constructed with
+   * traffic_readonly set to false.
+   * @param tile_id      the tile the speeds are for
+   * @param updates      the speeds and the edges of the tile they are for
+   * @param last_update  seconds since epoch the speeds are from
+   * @return false if the traffic extract has no tile with that id
+   */
+  bool UpdateLiveTraffic(const GraphId& tile_id,
+                         const std::vector<TrafficSpeedUpdate>& updates,
+                         uint64_t last_update);
+
+  /**
+   * Opens and indexes the tile_extract and traffic_extract of the config and makes them the tile
+   * set of every reader of the process. Nothing changes for the readers until they call
+   * SwitchTileSet, so requests in flight finish on the tiles they started on, and the memory of
+   * the old tile set is released once the last reader and tile using it let go of it. With a
+   * tile_access_log and tile_warmup_size the pages of the most accessed tiles of the new extract
+   * are asked for before it is published. This takes a while and is meant for a background
+   * thread, mjolnir.tile_extract_reload_interval has one do it when the extract is replaced.
+   * @param pt  the mjolnir config
+   * @return the epoch of the new tile set, 0 if the extract had no usable tiles and the readers
+   *         stay on the one they have
+   */
+  static uint64_t PublishTileSet(const boost::property_tree::ptree& pt);
+
+  /**
+   * Moves the reader to the most recently published tile set, dropping the tiles it cached from
+   * the one it was on. Call it between requests. Readers with a writable traffic extract keep the
+   * tile set they were constructed with.
+   * @return true if the reader switched
+   */
+  bool SwitchTileSet();
+
+  /**
+   * Get the epoch of the tile set the reader is on, 0 is the one it was constructed with
+   * @return the epoch
+   */
+  uint64_t GetTileSetEpoch() const {
+    return tile_set_epoch_;
+  }
+
+  /**
+   * Counts of the tiles this reader was asked for, like the reader they are not thread safe
+   */
+  struct TileCounts {
+    uint64_t fetched = 0;      // tiles asked for
+    uint64_t cache_misses = 0; // tiles that were not in the cache
+    uint64_t replicated = 0;   // tiles copied out of the extract, see tile_extract_replicate_levels
+  };
+
+  /**
+   * Get the counts of the tiles this reader was asked for since it was constructed
+   * @return the tile counts
+   */
+  const TileCounts& GetTileCounts() const {
+    return tile_counts_;
+  }
+
+  /**
+   * What warming up the cache did
+   */
+  struct WarmupStats {
+    uint64_t tiles = 0;  // tiles put into the cache
+    uint64_t bytes = 0;  // memory the cache counts for them
+    uint64_t millis = 0; // how long it took
+  };
+
+  /**
+   * Loads the given tiles into the cache, several at a time, in order until they take up the
+   * given memory. Tiles that are cached already or can only be fetched from the tile_url are
+   * skipped. The reader does this at construction with the most accessed tiles of
+   * mjolnir.tile_access_log when mjolnir.tile_warmup_size is set.
+   * @param tiles      the tiles, most important first
+   * @param max_bytes  memory the loaded tiles may take up in the cache
+   * @param threads    how many tiles to load at a time
+   * @return what the warmup did
+   */
+  WarmupStats Warmup(const std::vector<GraphId>& tiles, size_t max_bytes, size_t threads);
+
+  /**
+   * Get the tile access log the reader counts into, shared by the readers of the process. The
+   * counts of the last few thousand sampled accesses of each reader are not in it yet.
+   * @return the log, nullptr without mjolnir.tile_access_log
+   */
+  const std::shared_ptr<TileAccessLog>& GetTileAccessLog() const {
+    return access_log_;
+  }
+
+  /**
+   * Get what warming up the cache at construction did
+   * @return the warmup stats, all 0 if there was no warmup
+   */
+  const WarmupStats& GetWarmupStats() const {
+    return warmup_stats_;
+  }
+
   /**
    * Get a pointer to a graph tile object given a GraphId.
    * @param graphid  the graphid of the tile
@@ -509,6 +838,26 @@ public:
     return GetGraphTile(pointll, TileHierarchy::levels().back().level);
   }
 
+  /**
+   * Warm the tiles in a corridor between two points on background threads so that a search between
+   * them does not stall on reading or downloading them. Does nothing unless
+   * tile_prefetch.max_in_flight is configured.
+   * @param origin       where the search starts
+   * @param destination  where the search ends
+   */
+  void PrefetchCorridor(const midgard::PointLL& origin, const midgard::PointLL& destination);
+
+  /**
+   * Whether getting a tile now would wait on the prefetcher, which is still reading or downloading
+   * it. A search with other work to do can do that first instead of blocking on the I/O.
+   * @param graphid  an id of or in the tile
+   * @return true if the tile is not cached and the prefetcher has yet to warm it
+   */
+  bool IsTilePending(const GraphId& graphid) const {
+    return prefetcher_ && !cache_->Contains(graphid.Tile_Base()) &&
+           prefetcher_->IsPending(graphid.Tile_Base());
+  }
+
   /**
    * Clears the cache
    */
@@ -540,6 +889,15 @@ public:
     return cache_->OverCommitted();
   }
 
+  /**
+   * Get how much of the tile cache each hierarchy level takes up, empty for caches that do not
+   * track it.
+   * @return the usage by level
+   */
+  std::vector<TileCacheLevelUsage> GetCacheLevelUsage() const {
+    return cache_->GetLevelUsage();
+  }
+
   /**
    * Convenience method to get an opposing directed edge.
    * @param  edgeid  Graph Id of the directed edge.
@@ -877,6 +1235,24 @@ public:
    */
   std::unordered_set<GraphId> GetTileSet(const uint8_t level) const;
 
+  /**
+   * Returns the connectivity valhalla_build_connectivity wrote if it is in the tile extract, see
+   * connectivity_map_t. It stays mapped as long as this reader does.
+   * @return  the bytes of the connectivity and their count, nullptr if the extract has none
+   */
+  std::pair<const char*, size_t> GetConnectivity() const {
+    return tile_extract_->connectivity;
+  }
+
+  /**
+   * Returns the landmark store of mjolnir.landmark_store, which routes look the landmarks near
+   * their edges up in when the tiles hold none for an edge.
+   * @return  the store, nullptr if there is none
+   */
+  const LandmarkStore* landmark_store() const {
+    return landmark_store_.get();
+  }
+
   /**
    * Returns the tile directory.
    * @return  Returns the tile directory.
@@ -932,7 +1308,7 @@ public:
    * @param tile_id  the tile id for which incidents should be returned
    * @return the incident tile for the tile id
    */
-  virtual std::shared_ptr<const IncidentsTile> GetIncidentTile(const GraphId& tile_id) const;
+  virtual std::shared_ptr<const IncidentTile> GetIncidentTile(const GraphId& tile_id) const;
 
   /**
    * Returns a vector of incidents for the given edge
@@ -943,20 +1319,116 @@ public:
   IncidentResult GetIncidents(const GraphId& edge_id, graph_tile_ptr& tile);
 
 protected:
+  /**
+   * Fetch a tile from the tile_url together with the neighbours of it on the same level that are
+   * neither cached in memory, nor on disk nor known to be missing. The neighbours are put into the
+   * cache, the tile is returned
+   * @param base  the id of the tile
+   * @return the tile, nullptr if it could not be fetched
+   */
+  graph_tile_ptr FetchTileAndNeighbors(const GraphId& base);
+
+  /**
+   * Loads the zstd dictionary the tiles were compressed with from the extract, the tile_dir or the
+   * tile_url, caching the latter in the tile_dir
+   * @return the dictionary, nullptr if the tiles dont have one
+   */
+  std::shared_ptr<const zstd_dictionary_t> LoadTileDictionary() const;
+
+  /**
+   * Get the traffic of a tile from the traffic extract
+   * @param base  the id of the tile
+   * @return the traffic tile memory, nullptr if there is no traffic for the tile
+   */
+  std::unique_ptr<const GraphMemory> GetTrafficMemory(const GraphId& base) const;
+
+  /**
+   * Get a tile another process put into the shared store and cache it
+   * @param base  the id of the tile
+   * @return the tile, nullptr if there is no shared store or it does not have the tile
+   */
+  graph_tile_ptr GetSharedTile(const GraphId& base);
+
+  /**
+   * Cache a tile that was loaded, sharing it with the other processes first if there is a shared
+   * store so the cached tile points into it
+   * @param base  the id of the tile
+   * @param tile  the loaded tile
+   * @return the cached tile
+   */
+  graph_tile_ptr PutTile(const GraphId& base, graph_tile_ptr tile);
+
+  /**
+   * Share a tile that was loaded with the other processes if there is a shared store
+   * @param base  the id of the tile
+   * @param tile  the loaded tile
+   * @return the tile pointing into the shared store or the loaded tile if it could not be shared
+   */
+  graph_tile_ptr ShareTile(const GraphId& base, graph_tile_ptr tile) const;
+
+  /**
+   * Load a tile from the shared store, the extract or the tile_dir without caching it, which is
+   * safe to do from several threads at once
+   * @param base  the id of the tile
+   * @return the tile, nullptr if it is not available locally
+   */
+  graph_tile_ptr LoadTile(const GraphId& base) const;
+
+  /**
+   * Read a tile out of the extract with pread, so that its bytes take up memory for as long as the
+   * tile is used and the pages of the extract are left to the page cache
+   * @param base      the id of the tile
+   * @param position  where the tile is in the mmap of the extract
+   * @return the tile, decompressed if it was compressed, nullptr if it could not be read
+   */
+  graph_tile_ptr ReadTile(const GraphId& base, const std::pair<char*, size_t>& position) const;
+
   // (Tar) extract of tiles - the contents are empty if not being used
   struct tile_extract_t {
     tile_extract_t(const boost::property_tree::ptree& pt, bool traffic_readonly = true);
+    ~tile_extract_t();
+    tile_extract_t(const tile_extract_t&) = delete;
+    tile_extract_t& operator=(const tile_extract_t&) = delete;
+    // applies the configured madvise policy to the tiles of each hierarchy level
+    void advise_levels(const boost::property_tree::ptree& pt);
     // TODO: dont remove constness, and actually make graphtile read only?
     std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
     std::unordered_map<uint64_t, std::pair<char*, size_t>> traffic_tiles;
     std::shared_ptr<midgard::tar> archive;
     std::shared_ptr<midgard::tar> traffic_archive;
+    // whether the traffic archive was mapped writable
+    bool traffic_writable = false;
+    // the dictionary of the zstd compressed tiles in the archive, if any
+    std::shared_ptr<const zstd_dictionary_t> dictionary;
+    // the connectivity built by valhalla_build_connectivity in the archive, if any
+    std::pair<const char*, size_t> connectivity{nullptr, 0};
     uint64_t checksum;
+    // the extract opened again to pread its tiles rather than use them through the mmap, see
+    // tile_extract_pread, -1 if the tiles are used through the mmap
+    int fd = -1;
   };
   std::shared_ptr<const tile_extract_t> tile_extract_;
   static std::shared_ptr<const GraphReader::tile_extract_t>
   get_extract_instance(const boost::property_tree::ptree& pt);
 
+  // The tile set readers switch to, see PublishTileSet
+  static std::mutex published_tile_set_mutex_;
+  static std::shared_ptr<const tile_extract_t> published_tile_set_;
+  static std::atomic<uint64_t> published_tile_set_epoch_;
+  // the epoch of the tile set the reader is on
+  uint64_t tile_set_epoch_;
+
+  /**
+   * Whether the reader may use its cache. Readers of a cache shared by the whole process leave it
+   * to the readers on the published tile set once they are on an older one, so that the tiles of
+   * the two sets are never mixed.
+   * @return true if the cache can be used
+   */
+  bool UseCache() const {
+    return !shared_cache_ ||
+           tile_set_epoch_ == published_tile_set_epoch_.load(std::memory_order_relaxed);
+  }
+
   // Information about where the tiles are kept
   const std::string tile_dir_;
 
@@ -964,18 +1436,40 @@ protected:
   std::unique_ptr<tile_getter_t> tile_getter_;
   const size_t max_concurrent_users_;
   const std::string tile_url_;
+  // whether to fetch the missing neighbours of a tile from the tile_url along with it
+  const bool tile_url_neighbors_;
+  // the dictionary zstd compressed tiles were compressed with, nullptr if there is none
+  std::shared_ptr<const zstd_dictionary_t> tile_dictionary_;
 
   std::mutex _404s_lock;
   std::unordered_set<GraphId> _404s;
 
   std::unique_ptr<TileCache> cache_;
+  // whether the cache is shared by the readers of the process, see global_synchronized_cache
+  const bool shared_cache_;
+  TileCounts tile_counts_;
+
+  // Bit per hierarchy level whose extract tiles the reader copies into its own memory
+  uint32_t replicate_levels_ = 0;
+
+  // Tile data shared with the other processes on the host, see mjolnir.shared_mem_cache
+  std::shared_ptr<SharedTileStore> shared_tiles_;
+
+  // How often tiles are asked for, sampled and handed to the log of the process in batches
+  std::shared_ptr<TileAccessLog> access_log_;
+  std::unordered_map<uint64_t, uint32_t> access_counts_;
+  std::unordered_map<uint64_t, uint32_t> access_misses_;
+  uint32_t access_samples_ = 0;
+  WarmupStats warmup_stats_;
+
+  // warms the tiles of the search corridors, nullptr when disabled
+  std::shared_ptr<TilePrefetcher> prefetcher_;
+  float prefetch_width_;
+
+  // the landmarks of mjolnir.landmark_store, nullptr when there is none
+  std::shared_ptr<const LandmarkStore> landmark_store_;
 
   bool enable_incidents_;
 };
-
-// Given the Location relation, return the full metadata
-const valhalla::IncidentsTile::Metadata&
-getIncidentMetadata(const std::shared_ptr<const valhalla::IncidentsTile>& tile,
-                    const valhalla::IncidentsTile::Location& incident_location);
 } // namespace baldr
 } // namespace valhalla
@@ -5,7 +5,10 @@
 #include <valhalla/baldr/complexrestriction.h>
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/datetime.h>
+#include <valhalla/baldr/defaultedgecosts.h>
 #include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/directededgehot.h>
+#include <valhalla/baldr/edgeelevation.h>
 #include <valhalla/baldr/edgeinfo.h>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
@@ -16,7 +19,10 @@
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/nodetransition.h>
 #include <valhalla/baldr/predictedspeeds.h>
+#include <valhalla/baldr/reachindex.h>
+#include <valhalla/baldr/shapecache.h>
 #include <valhalla/baldr/sign.h>
+#include <valhalla/baldr/stopdepartureindex.h>
 #include <valhalla/baldr/signinfo.h>
 #include <valhalla/baldr/traffictile.h>
 #include <valhalla/baldr/transitdeparture.h>
@@ -24,6 +30,7 @@
 #include <valhalla/baldr/transitschedule.h>
 #include <valhalla/baldr/transitstop.h>
 #include <valhalla/baldr/transittransfer.h>
+#include <valhalla/baldr/turnclasses.h>
 #include <valhalla/baldr/turnlanes.h>
 
 #include <valhalla/midgard/aabb2.h>
@@ -41,13 +48,20 @@ namespace baldr {
 
 const std::string SUFFIX_NON_COMPRESSED = ".gph";
 const std::string SUFFIX_COMPRESSED = ".gph.gz";
+const std::string SUFFIX_ZSTD = ".gph.zst";
+const std::string SUFFIX_LZ4 = ".gph.lz4";
+// the zstd dictionary the tiles of a tile_dir, tile_url or extract were compressed with
+const std::string TILE_DICTIONARY = "tiles.dict";
 
 class tile_getter_t;
+class zstd_dictionary_t;
 /**
- * Graph information for a tile within the Tiled Hierarchical Graph.
+ * Graph information for a tile within the Tiled Hierarchical Graph. The reference count is atomic
+ * because caches shared between threads release tiles from any of them, see TileScope for passing
+ * tiles around without touching it.
  */
 #ifndef ENABLE_THREAD_SAFE_TILE_REF_COUNT
-class GraphTile : public boost::intrusive_ref_counter<GraphTile, boost::thread_unsafe_counter> {
+class GraphTile : public boost::intrusive_ref_counter<GraphTile, boost::thread_safe_counter> {
 #else
 class GraphTile {
 #endif // ENABLE_THREAD_SAFE_TILE_REF_COUNT
@@ -57,13 +71,15 @@ public:
   /**
    * Constructs with a given GraphId. Reads the graph tile from file
    * into memory.
-   * @param  tile_dir   Tile directory.
-   * @param  graphid    GraphId (tileid and level)
+   * @param  tile_dir    Tile directory.
+   * @param  graphid     GraphId (tileid and level)
+   * @param  dictionary  the dictionary zstd compressed tiles were compressed with, if any
    * @return nullptr if the tile could not be loaded. may throw
    */
   static graph_tile_ptr Create(const std::string& tile_dir,
                                const GraphId& graphid,
-                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr,
+                               const zstd_dictionary_t* dictionary = nullptr);
 
   /**
    * Constructs with a given the graph Id, pointer to the tile data, and the
@@ -89,13 +105,55 @@ public:
    * @param  tile_url URL of tile
    * @param  graphid Tile Id
    * @param  tile_getter object that will handle tile downloading
+   * @param  dictionary  the dictionary zstd compressed tiles were compressed with, if any
    * @return whether or not the tile could be cached to disk
    */
 
   static graph_tile_ptr CacheTileURL(const std::string& tile_url,
                                      const GraphId& graphid,
                                      tile_getter_t* tile_getter,
-                                     const std::string& cache_location);
+                                     const std::string& cache_location,
+                                     const zstd_dictionary_t* dictionary = nullptr);
+
+  /**
+   * Constructs tiles given a url for the tiles, fetching them all at once with the tile getters
+   * get_batch. Unlike CacheTileURL a tile that could not be fetched does not throw
+   * @param  tile_url        URL of the tiles
+   * @param  graphids        Tile Ids
+   * @param  tile_getter     object that will handle tile downloading
+   * @param  cache_location  where to cache the tiles on disk, they are not cached when empty
+   * @param  dictionary      the dictionary zstd compressed tiles were compressed with, if any
+   * @return the tiles in the order of the ids, nullptr for the ones that could not be fetched
+   */
+  static std::vector<graph_tile_ptr> CacheTileURLs(const std::string& tile_url,
+                                                   const std::vector<GraphId>& graphids,
+                                                   tile_getter_t* tile_getter,
+                                                   const std::string& cache_location,
+                                                   const zstd_dictionary_t* dictionary = nullptr);
+
+  /**
+   * Decompresses gzip, zstd or lz4 compressed tile bytes into a tile, the compression is told
+   * from the bytes themselves
+   * @param  graphid     the id of the tile to be decompressed
+   * @param  data        the compressed bytes
+   * @param  size        how many there are
+   * @param  dictionary  the dictionary zstd compressed bytes were compressed with, if any
+   * @param  traffic_memory  the live traffic of the tile, if any
+   * @return a pointer to a graphtile if it has been successfully initialized with
+   *         the uncompressed data, or nullptr
+   */
+  static graph_tile_ptr DecompressTile(const GraphId& graphid,
+                                       const char* data,
+                                       size_t size,
+                                       const zstd_dictionary_t* dictionary = nullptr,
+                                       std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+
+  /**
+   * Gets the file suffix of tiles stored with a compression
+   * @param  compression  empty or none for raw tiles, otherwise gzip, zstd or lz4
+   * @return the suffix, throws for unknown compressions
+   */
+  static const std::string& CompressionSuffix(const std::string& compression);
 
   /**
    * Construct a tile given a url for the tile using curl
@@ -320,6 +378,71 @@ public:
     return {endnode.tileid(), endnode.level(), node(endnode.id())->edge_index() + edge->opp_index()};
   }
 
+  /**
+   * Does this tile have the precomputed opposing edge ids valhalla_build_opposing added to it.
+   * @return true if opposing_edge_id can be used
+   */
+  bool has_opposing_edge_ids() const {
+    return opposing_edge_ids_ != nullptr;
+  }
+
+  /**
+   * Get the precomputed opposing edge id of a directed edge, only valid to call when
+   * has_opposing_edge_ids is true. Edges without an opposing edge, like transit lines, have an
+   * invalid id.
+   * @param  idx  Index of the directed edge within the current tile.
+   * @return Returns the GraphId of the opposing directed edge.
+   */
+  const GraphId& opposing_edge_id(const size_t idx) const {
+    if (idx < header_->directededgecount()) {
+      return opposing_edge_ids_[idx];
+    }
+    throw std::runtime_error(
+        std::string(__FILE__) + ":" + std::to_string(__LINE__) +
+        " GraphTile opposing edge index out of bounds: " + std::to_string(header_->graphid().tileid()) +
+        "," + std::to_string(header_->graphid().level()) + "," + std::to_string(idx) +
+        " directededgecount= " + std::to_string(header_->directededgecount()));
+  }
+
+  /**
+   * Does this tile have the elevation summaries the ElevationBuilder added to it.
+   * @return true if edge_elevation can be used
+   */
+  bool has_edge_elevation() const {
+    return edge_elevations_ != nullptr;
+  }
+
+  /**
+   * Get the precomputed ascent and descent of a directed edge in its direction of travel, only
+   * valid to call when has_edge_elevation is true.
+   * @param  idx  Index of the directed edge within the current tile.
+   * @return Returns the elevation summary of the directed edge.
+   */
+  const EdgeElevation& edge_elevation(const size_t idx) const {
+    if (idx < header_->directededgecount()) {
+      return edge_elevations_[idx];
+    }
+    throw std::runtime_error(
+        std::string(__FILE__) + ":" + std::to_string(__LINE__) +
+        " GraphTile edge elevation index out of bounds: " +
+        std::to_string(header_->graphid().tileid()) + "," +
+        std::to_string(header_->graphid().level()) + "," + std::to_string(idx) +
+        " directededgecount= " + std::to_string(header_->directededgecount()));
+  }
+
+  /**
+   * Convenience method to get the precomputed elevation summary of a directed edge.
+   * @param  edge  Directed edge.
+   * @return Returns the elevation summary, null if the tile has none or the edge is not in it.
+   */
+  const EdgeElevation* edge_elevation(const DirectedEdge* edge) const {
+    if (edge_elevations_ == nullptr || edge < directededges_ ||
+        edge >= directededges_ + header_->directededgecount()) {
+      return nullptr;
+    }
+    return &edge_elevations_[edge - directededges_];
+  }
+
   /**
    * Get a pointer to a node transition.
    * @param  idx  Index of the directed edge within the current tile.
@@ -382,6 +505,60 @@ public:
     return midgard::iterable_t<const DirectedEdge>{directededges_, header_->directededgecount()};
   }
 
+  /**
+   * Get the structure of arrays copy of the hot routing fields of the directed edges. Only filled
+   * when hot fields are enabled, check size() before use.
+   * @return returns the hot fields of the directed edges in this tile
+   */
+  const DirectedEdgeHot& GetDirectedEdgeHot() const {
+    return directededge_hot_;
+  }
+
+  /**
+   * Get the memory the tile allocated besides its data when it was loaded: the hot fields of the
+   * directed edges, the predicted speed cache and snapshots, the shape cache slots and the transit
+   * onestop maps. Tile caches add this to the size of the data.
+   * @return returns the number of bytes
+   */
+  size_t decoded_size() const;
+
+  /**
+   * Get the precomputed reach of the directed edges in this tile. The index has a max_reach of 0
+   * when valhalla_build_reach has not been run over the tile.
+   * @return returns the reach index of this tile
+   */
+  const ReachIndex& GetReachIndex() const {
+    return reach_index_;
+  }
+
+  /**
+   * Get the costs costings computed for the directed edges of this tile with their default
+   * options. Only there when default edge costs are enabled, the arrays are filled as costings
+   * first ask for them.
+   * @return returns the default edge costs of this tile, nullptr when they are not enabled
+   */
+  const DefaultEdgeCosts* GetDefaultEdgeCosts() const {
+    return default_edge_costs_.get();
+  }
+
+  /**
+   * Get the turn classes of a directed edge, one for each local index of the node it leaves that
+   * an edge can be turned onto it from. Only there when turn classes are enabled, the classes of
+   * all edges of the tile are filled the first time any of them is asked for.
+   * @param  edge  Directed edge.
+   * @return Returns kTurnClassesPerEdge classes, null if the tile has none or the edge is not
+   *         in it.
+   */
+  const TurnClass* turn_classes(const DirectedEdge* edge) const;
+
+  /**
+   * Whether tiles copy the hot routing fields of their directed edges into a DirectedEdgeHot when
+   * they are loaded. This is set by the GraphReader from mjolnir.directededge_hot_fields and
+   * applies to the whole process.
+   */
+  static bool hot_fields_enabled();
+  static void set_hot_fields_enabled(const bool enabled);
+
   /**
    * Get an iterable set of edge extensions in this tile
    * @return returns an iterable collection of edge extensions
@@ -510,6 +687,41 @@ public:
                                            bool wheelchair,
                                            bool bicycle) const;
 
+  /**
+   * Does this tile have the departure index of its transit stops.
+   * @return true if GetNextStopDeparture can be used
+   */
+  bool has_stop_departures() const {
+    return !stop_departures_.empty();
+  }
+
+  /**
+   * Get the next departure from a transit stop on any of the transit lines leaving it, given the
+   * current time (seconds from midnight). The fixed schedule departures of the stop are binary
+   * searched, only its frequency based departures that still run are looked at one by one. Only
+   * valid to call when has_stop_departures is true.
+   * @param   node_index        Index of the stop node within the tile.
+   * @param   current_time      Current time (seconds from midnight).
+   * @param   day               Days since the tile creation date.
+   * @param   dow               Day of week (see graphconstants.h)
+   * @param   date_before_tile  Is the date that was input before
+   *                            the tile creation date?
+   * @param   wheelchair        Only find departures with wheelchair access if true
+   * @param   bicycle           Only find departures with bicycle access if true
+   * @param   departure_time    (OUT) When the departure leaves, for a frequency based departure
+   *                            the first run at or after the current time.
+   * @return  Returns a pointer to the transit departure information, its lineid tells which
+   *          transit edge it leaves on. Returns nullptr if no departures are found.
+   */
+  const TransitDeparture* GetNextStopDeparture(const uint32_t node_index,
+                                               const uint32_t current_time,
+                                               const uint32_t day,
+                                               const uint32_t dow,
+                                               bool date_before_tile,
+                                               bool wheelchair,
+                                               bool bicycle,
+                                               uint32_t& departure_time) const;
+
   /**
    * Get the departure given the directed edge Id and tripid
    * @param   lineid  Transit Line Id
@@ -605,6 +817,15 @@ public:
    */
   std::vector<LaneConnectivity> GetLaneConnectivity(const uint32_t idx) const;
 
+  /**
+   * Get the compressed predicted speed profile of a directed edge, to copy it to another tile.
+   * @param  idx  Index of the directed edge, it must have a predicted speed.
+   * @return  Returns the coefficients of the profile.
+   */
+  std::array<int16_t, kCoefficientCount> GetSpeedProfile(const uint32_t idx) const {
+    return predictedspeeds_.profile(idx);
+  }
+
   /**
    * Convenience method for use with costing to get the speed for an edge given the directed
    * edge and a time (seconds since start of the week). If the current speed of the edge
@@ -650,7 +871,7 @@ public:
     float partial_live_pct = 0;
     if ((flow_mask & kCurrentFlowMask) && traffic_tile() && live_traffic_multiplier != 0.) {
       auto directed_edge_index = std::distance(const_cast<const DirectedEdge*>(directededges_), de);
-      auto volatile& live_speed = traffic_tile.trafficspeed(directed_edge_index);
+      const auto live_speed = traffic_tile.speed(directed_edge_index);
       // only use current speed if its valid and non zero, a speed of 0 makes costing values crazy
       if (live_speed.speed_valid() && (partial_live_speed = live_speed.get_overall_speed()) > 0) {
         *flow_sources |= kCurrentFlowMask;
@@ -740,9 +961,14 @@ public:
     return (is_truck && (de->truck_speed() > 0)) ? std::min(de->truck_speed(), speed) : speed;
   }
 
-  inline const volatile TrafficSpeed& trafficspeed(const DirectedEdge* de) const {
+  /**
+   * Gets a consistent copy of the live speed of an edge, see TrafficTile::speed
+   * @param  de  the directed edge
+   * @return the live speed
+   */
+  inline TrafficSpeed trafficspeed(const DirectedEdge* de) const {
     auto directed_edge_index = std::distance(const_cast<const DirectedEdge*>(directededges_), de);
-    return traffic_tile.trafficspeed(directed_edge_index);
+    return traffic_tile.speed(directed_edge_index);
   }
 
   /**
@@ -774,9 +1000,8 @@ public:
    * @return      whether or not its closed
    */
   inline bool IsClosed(const DirectedEdge* edge) const {
-    auto volatile& live_speed =
-        traffic_tile.trafficspeed(static_cast<uint32_t>(edge - directededges_));
-    return live_speed.closed();
+    return traffic_tile.has_closures() &&
+           traffic_tile.speed(static_cast<uint32_t>(edge - directededges_)).closed();
   }
 
   const TrafficTile& get_traffic_tile() const {
@@ -845,6 +1070,11 @@ protected:
   // Size of the complex restrictions in the reverse direction
   std::size_t complex_restriction_reverse_size_{};
 
+  // The edge id and offset of each complex restriction, sorted by edge id. The forward ones by the
+  // edge they end on and the reverse ones by the edge they start on
+  std::vector<std::pair<uint64_t, uint32_t>> complex_restriction_forward_index_;
+  std::vector<std::pair<uint64_t, uint32_t>> complex_restriction_reverse_index_;
+
   // List of edge info structures. Since edgeinfo is not fixed size we
   // use offsets in directed edges.
   char* edgeinfo_{};
@@ -852,6 +1082,15 @@ protected:
   // Size of the edgeinfo data
   std::size_t edgeinfo_size_{};
 
+  // Decoded shapes of the edge infos, only when the shape cache is enabled
+  std::unique_ptr<ShapeCache> shape_cache_;
+
+  // Costs of the directed edges for default costing options, only when they are enabled
+  std::unique_ptr<DefaultEdgeCosts> default_edge_costs_;
+
+  // Turn classes of the directed edges, only when they are enabled
+  std::unique_ptr<TurnClasses> turn_classes_;
+
   // Street names as sets of null-terminated char arrays. Edge info has
   // offsets into this array.
   char* textlist_{};
@@ -872,6 +1111,21 @@ protected:
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Hot routing fields of the directed edges, empty unless hot fields are enabled
+  DirectedEdgeHot directededge_hot_;
+
+  // Precomputed reach of the directed edges, empty unless the tile has a reach section
+  ReachIndex reach_index_;
+
+  // Precomputed opposing edge ids of the directed edges, null unless the tile has the section
+  const GraphId* opposing_edge_ids_{};
+
+  // Precomputed ascent and descent of the directed edges, null unless the tile has the section
+  const EdgeElevation* edge_elevations_{};
+
+  // Departures of the transit lines leaving each stop, empty unless the tile has the index
+  StopDepartureIndex stop_departures_;
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
@@ -933,13 +1187,18 @@ protected:
    */
   void AssociateOneStopIds(const GraphId& graphid);
 
-  /** Decrompresses tile bytes into the internal graphtile byte buffer
-   * @param  graphid     the id of the tile to be decompressed
-   * @param  compressed  the compressed bytes
-   * @return a pointer to a graphtile if it  has been successfully initialized with
-   *         the uncompressed data, or nullptr
-   */
-  static graph_tile_ptr DecompressTile(const GraphId& graphid, const std::vector<char>& compressed);
+  /**
+   * Caches the bytes of a tile fetched from a url on disk and turns them into a tile
+   * @param  graphid         the id of the tile
+   * @param  bytes           the bytes it got
+   * @param  cache_location  where to cache the tile on disk, it is not cached when empty
+   * @param  dictionary      the dictionary zstd compressed tiles were compressed with, if any
+   * @return the tile
+   */
+  static graph_tile_ptr CacheTileBytes(const GraphId& graphid,
+                                       std::vector<char>&& bytes,
+                                       const std::string& cache_location,
+                                       const zstd_dictionary_t* dictionary);
 };
 
 } // namespace baldr
@@ -18,7 +18,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 7;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -574,6 +574,70 @@ public:
     predictedspeeds_offset_ = offset;
   }
 
+  /**
+   * Gets the offset to the precomputed reach of the directed edges.
+   * @return  Returns the offset (bytes) to the reach section, 0 if the tile has none.
+   */
+  uint32_t reach_offset() const {
+    return reach_offset_;
+  }
+
+  /**
+   * Sets the offset to the precomputed reach of the directed edges.
+   * @param offset Offset to the reach section within the tile.
+   */
+  void set_reach_offset(const uint32_t offset) {
+    reach_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the precomputed opposing edge ids of the directed edges.
+   * @return  Returns the offset (bytes) to the opposing edge section, 0 if the tile has none.
+   */
+  uint32_t opposing_offset() const {
+    return opposing_offset_;
+  }
+
+  /**
+   * Sets the offset to the precomputed opposing edge ids of the directed edges.
+   * @param offset Offset to the opposing edge section within the tile.
+   */
+  void set_opposing_offset(const uint32_t offset) {
+    opposing_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the precomputed elevation summaries of the directed edges.
+   * @return  Returns the offset (bytes) to the edge elevation section, 0 if the tile has none.
+   */
+  uint32_t elevation_offset() const {
+    return elevation_offset_;
+  }
+
+  /**
+   * Sets the offset to the precomputed elevation summaries of the directed edges.
+   * @param offset Offset to the edge elevation section within the tile.
+   */
+  void set_elevation_offset(const uint32_t offset) {
+    elevation_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the departure index of the transit stops.
+   * @return  Returns the offset (bytes) to the stop departure index, 0 if the tile has none.
+   */
+  uint32_t stop_departure_offset() const {
+    return stop_departure_offset_;
+  }
+
+  /**
+   * Sets the offset to the departure index of the transit stops.
+   * @param offset Offset to the stop departure index within the tile.
+   */
+  void set_stop_departure_offset(const uint32_t offset) {
+    stop_departure_offset_ = offset;
+  }
+
   /**
    * Get the offset to the end of the tile
    * @return the number of bytes in the tile, unless the last slot is used
@@ -689,6 +753,18 @@ protected:
   // GraphTile data size in bytes
   uint32_t tile_size_ = 0;
 
+  // Offset to the beginning of the precomputed reach section
+  uint32_t reach_offset_ = 0;
+
+  // Offset to the beginning of the precomputed opposing edge ids
+  uint32_t opposing_offset_ = 0;
+
+  // Offset to the beginning of the precomputed edge elevation summaries
+  uint32_t elevation_offset_ = 0;
+
+  // Offset to the beginning of the departure index of the transit stops
+  uint32_t stop_departure_offset_ = 0;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
@@ -0,0 +1,147 @@
+#ifndef VALHALLA_BALDR_INCIDENTTILE_H_
+#define VALHALLA_BALDR_INCIDENTTILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <valhalla/baldr/graphmemory.h>
+#include <valhalla/midgard/util.h>
+#include <valhalla/proto/incidents.pb.h>
+
+namespace valhalla {
+namespace baldr {
+
+// The version of the flat incident tile format, bumped whenever the layout changes
+constexpr uint32_t INCIDENT_TILE_VERSION = 1;
+
+// The first bytes of a flat incident tile, a serialized IncidentsTile starts with a field tag
+constexpr char kIncidentTileMagic[8] = {'\xff', 'V', 'I', 'N', 'C', 'I', 'D', 'T'};
+
+struct IncidentTileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t location_count;
+  uint32_t metadata_count;
+  uint32_t spare;
+  uint64_t metadata_bytes; // bytes of serialized metadata after the metadata entries
+};
+
+// Links a portion of an edge to incident metadata, the same as IncidentsTile::Location
+struct IncidentLocation {
+  uint32_t edge_index;
+  float start_offset;
+  float end_offset;
+  uint32_t metadata_index;
+};
+
+// Where the serialized IncidentsTile::Metadata of an incident is, along with its id so that
+// incidents can be told apart without parsing them
+struct IncidentMetadataEntry {
+  uint64_t id;
+  uint64_t offset; // from the first byte after the metadata entries
+  uint32_t size;
+  uint32_t spare;
+};
+
+/**
+ * The incidents of a graph tile in a flat layout that is used in place, like the traffic tile.
+ * The header is followed by the locations sorted by edge, the metadata entries and then the
+ * serialized metadata of each incident. Finding the incidents of an edge is a binary search over
+ * the locations and only the metadata of the incidents a route actually passes is ever parsed.
+ *
+ * Producers can write this layout directly with Serialize so that it can be read or mapped as is,
+ * tiles written as a protobuf IncidentsTile are converted into it when they are loaded.
+ */
+class IncidentTile {
+public:
+  /**
+   * Use the bytes of a flat incident tile in place
+   * @param memory  the bytes, starting with the header
+   * @throws std::runtime_error if the bytes are not a flat incident tile of this version
+   */
+  explicit IncidentTile(std::unique_ptr<const GraphMemory> memory);
+
+  /**
+   * Use the bytes of a flat incident tile read into memory
+   * @param bytes  the bytes, starting with the header
+   * @throws std::runtime_error if the bytes are not a flat incident tile of this version
+   */
+  explicit IncidentTile(std::string&& bytes);
+
+  /**
+   * Lay out the incidents of a protobuf tile flat, the locations sorted by edge
+   * @param tile  the incidents
+   */
+  explicit IncidentTile(const IncidentsTile& tile);
+
+  IncidentTile(const IncidentTile&) = delete;
+  IncidentTile& operator=(const IncidentTile&) = delete;
+
+  /**
+   * Serializes a protobuf tile into the flat layout, for producers of incident tiles
+   * @param tile  the incidents
+   * @return the bytes of the flat tile
+   */
+  static std::string Serialize(const IncidentsTile& tile);
+
+  /**
+   * Whether the bytes start like a flat incident tile
+   * @param data  the bytes
+   * @param size  how many there are
+   * @return true if they do
+   */
+  static bool IsFlat(const char* data, size_t size);
+
+  /**
+   * @return the locations of the incidents, sorted by edge
+   */
+  midgard::iterable_t<const IncidentLocation> locations() const {
+    return {locations_, header_->location_count};
+  }
+
+  uint32_t location_count() const {
+    return header_->location_count;
+  }
+
+  uint32_t metadata_count() const {
+    return header_->metadata_count;
+  }
+
+  /**
+   * Get the id of the incident a location belongs to without parsing its metadata
+   * @param location  the location of the incident
+   * @return the id of the incident
+   * @throws std::runtime_error if the location points past the metadata
+   */
+  uint64_t metadata_id(const IncidentLocation& location) const;
+
+  /**
+   * Parse the metadata of the incident a location belongs to
+   * @param location  the location of the incident
+   * @param metadata  the message to parse it into
+   * @throws std::runtime_error if the location points past the metadata or it does not parse
+   */
+  void metadata(const IncidentLocation& location, IncidentsTile::Metadata& metadata) const;
+
+  /**
+   * @return the bytes of the tile
+   */
+  const GraphMemory& memory() const {
+    return *memory_;
+  }
+
+protected:
+  const IncidentMetadataEntry& entry(const IncidentLocation& location) const;
+
+  std::unique_ptr<const GraphMemory> memory_;
+  const IncidentTileHeader* header_;
+  const IncidentLocation* locations_;
+  const IncidentMetadataEntry* entries_;
+  const char* metadata_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_INCIDENTTILE_H_
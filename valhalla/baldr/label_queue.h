@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/graphconstants.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The priority queues the path algorithms can keep their adjacency list in. They all hold label
+ * indexes into external data and share the interface of the DoubleBucketQueue (reuse, clear, add,
+ * decrease and pop) so an algorithm can switch between them at runtime through a LabelQueue.
+ */
+enum class QueueType : uint8_t {
+  // buckets of a fixed cost range and an overflow bucket, cheapest when the costs of a search stay
+  // within a few bucket ranges
+  kDoubleBucket = 0,
+  // a monotone radix heap on the bits of the costs, it has no range to outgrow so wide cost ranges
+  // (high penalties, long ferries) do not pay for the rebucketing of the overflow
+  kRadixHeap = 1,
+  // an indexed 4-ary heap, exact order and no assumption about the costs at all
+  kQuaternaryHeap = 2,
+};
+
+/**
+ * Get the queue type from its name in the config.
+ * @param  name  double_bucket, radix_heap or quaternary_heap
+ * @return the queue type
+ */
+inline QueueType ParseQueueType(const std::string& name) {
+  if (name == "double_bucket") {
+    return QueueType::kDoubleBucket;
+  }
+  if (name == "radix_heap") {
+    return QueueType::kRadixHeap;
+  }
+  if (name == "quaternary_heap") {
+    return QueueType::kQuaternaryHeap;
+  }
+  throw std::invalid_argument("Unknown adjacency queue type: " + name);
+}
+
+/**
+ * Radix heap - a monotone priority queue. Costs are turned into their (order preserving) float bits
+ * and each entry sits in the bucket of the highest bit where it differs from the last popped cost.
+ * Popping from an empty lowest bucket takes the smallest entry of the next non-empty bucket as the
+ * new last cost and spreads that bucket over the lower ones, so every entry moves at most once per
+ * bit. A cost below the last popped one is placed with it, just like the DoubleBucketQueue does
+ * with costs below its current bucket. Decreases leave the old entry behind, it is skipped when it
+ * comes up.
+ */
+template <typename label_t> class RadixHeapQueue final {
+public:
+  RadixHeapQueue() = default;
+
+  /**
+   * Sets the container of the labels, the heap needs no range or bucket size.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  void reuse(const float /*mincost*/,
+             const float /*range*/,
+             const uint32_t /*bucketsize*/,
+             const std::vector<label_t>* labelcontainer) {
+    labelcontainer_ = labelcontainer;
+  }
+
+  /**
+   * Reserve space for the labels to come.
+   * @param count  the number of labels
+   */
+  void reserve(const size_t count) {
+    keys_.reserve(count);
+  }
+
+  /**
+   * Clear all labels from the heap, the memory is kept.
+   */
+  void clear() {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    keys_.clear();
+    last_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * Adds a label index to the heap at the sortcost of the label.
+   * @param  label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) {
+    push(label, key((*labelcontainer_)[label].sortcost()));
+  }
+
+  /**
+   * The specified label index now has a smaller cost.
+   * @param  label    Label index to reorder.
+   * @param  newcost  New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    const auto k = key(newcost);
+    if (label < keys_.size() && keys_[label] != kNotQueued && k < keys_[label]) {
+      push(label, k);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the heap.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the heap is empty.
+   */
+  uint32_t pop() {
+    while (size_ > 0) {
+      if (buckets_[0].empty()) {
+        redistribute();
+      }
+      const auto entry = buckets_[0].back();
+      buckets_[0].pop_back();
+      // skip what a decrease left behind
+      if (keys_[entry.second] == entry.first) {
+        keys_[entry.second] = kNotQueued;
+        --size_;
+        return entry.second;
+      }
+    }
+    return kInvalidLabel;
+  }
+
+private:
+  // float bits are never all ones
+  static constexpr uint32_t kNotQueued = std::numeric_limits<uint32_t>::max();
+
+  // (key, label index)
+  using entry_t = std::pair<uint32_t, uint32_t>;
+
+  // entries whose key equals last_ and one bucket for each bit where they can differ from it
+  std::array<std::vector<entry_t>, 33> buckets_;
+  std::vector<entry_t> spread_;
+
+  // the key each queued label is at
+  std::vector<uint32_t> keys_;
+  uint32_t last_ = 0;
+  size_t size_ = 0;
+
+  const std::vector<label_t>* labelcontainer_ = nullptr;
+
+  // the bits of non-negative floats sort like the floats
+  static uint32_t key(const float cost) {
+    const float c = cost > 0.f ? cost : 0.f;
+    uint32_t bits;
+    std::memcpy(&bits, &c, sizeof(bits));
+    return bits;
+  }
+
+  // 1 + the index of the highest set bit, 0 for 0
+  static uint32_t bit_width(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return x == 0 ? 0 : 32 - __builtin_clz(x);
+#else
+    uint32_t width = 0;
+    for (; x != 0; x >>= 1) {
+      ++width;
+    }
+    return width;
+#endif
+  }
+
+  void push(const uint32_t label, uint32_t k) {
+    k = std::max(k, last_);
+    if (label >= keys_.size()) {
+      keys_.resize(label + 1, kNotQueued);
+    }
+    if (keys_[label] == kNotQueued) {
+      ++size_;
+    }
+    keys_[label] = k;
+    buckets_[bit_width(k ^ last_)].emplace_back(k, label);
+  }
+
+  // moves the smallest key of the first non-empty bucket into last_ and spreads that bucket over
+  // the lower ones, they all differ from the new last_ in a lower bit
+  void redistribute() {
+    size_t i = 1;
+    while (buckets_[i].empty()) {
+      ++i;
+    }
+    spread_.swap(buckets_[i]);
+    last_ = spread_.front().first;
+    for (const auto& entry : spread_) {
+      last_ = std::min(last_, entry.first);
+    }
+    for (const auto& entry : spread_) {
+      buckets_[bit_width(entry.first ^ last_)].push_back(entry);
+    }
+    spread_.clear();
+  }
+};
+
+/**
+ * Indexed 4-ary heap. Keeps the cost of each entry next to its label index so the sift steps do not
+ * have to look the labels up, and the position of each label so it can be decreased in place. The
+ * wider nodes make the heap half as deep as a binary one and keep the children of a node on one
+ * cache line.
+ */
+template <typename label_t> class QuaternaryHeapQueue final {
+public:
+  QuaternaryHeapQueue() = default;
+
+  /**
+   * Sets the container of the labels, the heap needs no range or bucket size.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  void reuse(const float /*mincost*/,
+             const float /*range*/,
+             const uint32_t /*bucketsize*/,
+             const std::vector<label_t>* labelcontainer) {
+    labelcontainer_ = labelcontainer;
+  }
+
+  /**
+   * Reserve space for the labels to come.
+   * @param count  the number of labels
+   */
+  void reserve(const size_t count) {
+    positions_.reserve(count);
+  }
+
+  /**
+   * Clear all labels from the heap, the memory is kept.
+   */
+  void clear() {
+    heap_.clear();
+    positions_.clear();
+  }
+
+  /**
+   * Adds a label index to the heap at the sortcost of the label.
+   * @param  label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) {
+    if (label >= positions_.size()) {
+      positions_.resize(label + 1, kNotQueued);
+    }
+    heap_.emplace_back((*labelcontainer_)[label].sortcost(), label);
+    sift_up(heap_.size() - 1);
+  }
+
+  /**
+   * The specified label index now has a smaller cost.
+   * @param  label    Label index to reorder.
+   * @param  newcost  New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    if (label < positions_.size() && positions_[label] != kNotQueued) {
+      const auto position = positions_[label];
+      if (newcost < heap_[position].first) {
+        heap_[position].first = newcost;
+        sift_up(position);
+      }
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the heap.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the heap is empty.
+   */
+  uint32_t pop() {
+    if (heap_.empty()) {
+      return kInvalidLabel;
+    }
+    const uint32_t label = heap_.front().second;
+    positions_[label] = kNotQueued;
+    if (heap_.size() > 1) {
+      heap_.front() = heap_.back();
+      heap_.pop_back();
+      sift_down(0);
+    } else {
+      heap_.pop_back();
+    }
+    return label;
+  }
+
+private:
+  static constexpr uint32_t kNotQueued = std::numeric_limits<uint32_t>::max();
+
+  // (sort cost, label index)
+  std::vector<std::pair<float, uint32_t>> heap_;
+  // where each label is in the heap
+  std::vector<uint32_t> positions_;
+
+  const std::vector<label_t>* labelcontainer_ = nullptr;
+
+  void sift_up(size_t position) {
+    const auto entry = heap_[position];
+    while (position > 0) {
+      const size_t parent = (position - 1) / 4;
+      if (!(entry.first < heap_[parent].first)) {
+        break;
+      }
+      heap_[position] = heap_[parent];
+      positions_[heap_[position].second] = position;
+      position = parent;
+    }
+    heap_[position] = entry;
+    positions_[entry.second] = position;
+  }
+
+  void sift_down(size_t position) {
+    const auto entry = heap_[position];
+    while (true) {
+      const size_t first = position * 4 + 1;
+      if (first >= heap_.size()) {
+        break;
+      }
+      const size_t last = std::min(first + 4, heap_.size());
+      size_t smallest = first;
+      for (size_t child = first + 1; child < last; ++child) {
+        if (heap_[child].first < heap_[smallest].first) {
+          smallest = child;
+        }
+      }
+      if (!(heap_[smallest].first < entry.first)) {
+        break;
+      }
+      heap_[position] = heap_[smallest];
+      positions_[heap_[position].second] = position;
+      position = smallest;
+    }
+    heap_[position] = entry;
+    positions_[entry.second] = position;
+  }
+};
+
+/**
+ * The adjacency list of a path algorithm, one of the queues above picked at runtime (usually from
+ * the config, see ParseQueueType). All calls are forwarded to the queue of the type, the others stay
+ * empty and do not allocate.
+ */
+template <typename label_t> class LabelQueue final {
+public:
+  /**
+   * Constructor, the queue needs to be initialized with `reuse` before use.
+   * @param type  the queue to keep the labels in
+   */
+  explicit LabelQueue(const QueueType type = QueueType::kDoubleBucket) : type_(type) {
+  }
+
+  /**
+   * Constructor, see DoubleBucketQueue.
+   * @param type            the queue to keep the labels in
+   * @param mincost         Minimum cost. Used to create the initial range for bucket sorting.
+   * @param range           Cost range for low-level buckets.
+   * @param bucketsize      Bucket size (range of costs within same bucket).
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  LabelQueue(const QueueType type,
+             const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer)
+      : type_(type) {
+    reuse(mincost, range, bucketsize, labelcontainer);
+  }
+
+  LabelQueue(LabelQueue&&) = default;
+  LabelQueue& operator=(LabelQueue&&) = default;
+  LabelQueue(const LabelQueue&) = delete;
+  LabelQueue& operator=(const LabelQueue&) = delete;
+
+  QueueType type() const {
+    return type_;
+  }
+
+  /**
+   * Prepares the queue for a search, see DoubleBucketQueue::reuse. The heaps only take the label
+   * container.
+   */
+  void reuse(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    switch (type_) {
+      case QueueType::kDoubleBucket:
+        buckets_.reuse(mincost, range, bucketsize, labelcontainer);
+        break;
+      case QueueType::kRadixHeap:
+        radix_.reuse(mincost, range, bucketsize, labelcontainer);
+        break;
+      case QueueType::kQuaternaryHeap:
+        heap_.reuse(mincost, range, bucketsize, labelcontainer);
+        break;
+    }
+  }
+
+  /**
+   * Reserve space for the labels a search expects to add, the buckets grow on their own.
+   * @param count  the number of labels
+   */
+  void reserve(const size_t count) {
+    switch (type_) {
+      case QueueType::kDoubleBucket:
+        break;
+      case QueueType::kRadixHeap:
+        radix_.reserve(count);
+        break;
+      case QueueType::kQuaternaryHeap:
+        heap_.reserve(count);
+        break;
+    }
+  }
+
+  void clear() {
+    switch (type_) {
+      case QueueType::kDoubleBucket:
+        buckets_.clear();
+        break;
+      case QueueType::kRadixHeap:
+        radix_.clear();
+        break;
+      case QueueType::kQuaternaryHeap:
+        heap_.clear();
+        break;
+    }
+  }
+
+  void add(const uint32_t label) {
+    switch (type_) {
+      case QueueType::kDoubleBucket:
+        buckets_.add(label);
+        break;
+      case QueueType::kRadixHeap:
+        radix_.add(label);
+        break;
+      case QueueType::kQuaternaryHeap:
+        heap_.add(label);
+        break;
+    }
+  }
+
+  void decrease(const uint32_t label, const float newcost) {
+    switch (type_) {
+      case QueueType::kDoubleBucket:
+        buckets_.decrease(label, newcost);
+        break;
+      case QueueType::kRadixHeap:
+        radix_.decrease(label, newcost);
+        break;
+      case QueueType::kQuaternaryHeap:
+        heap_.decrease(label, newcost);
+        break;
+    }
+  }
+
+  uint32_t pop() {
+    switch (type_) {
+      case QueueType::kRadixHeap:
+        return radix_.pop();
+      case QueueType::kQuaternaryHeap:
+        return heap_.pop();
+      case QueueType::kDoubleBucket:
+      default:
+        return buckets_.pop();
+    }
+  }
+
+private:
+  QueueType type_;
+  DoubleBucketQueue<label_t> buckets_;
+  RadixHeapQueue<label_t> radix_;
+  QuaternaryHeapQueue<label_t> heap_;
+};
+
+} // namespace baldr
+} // namespace valhalla
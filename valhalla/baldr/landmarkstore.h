@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/landmark.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Identifies a landmark store and the version of its layout
+constexpr char kLandmarkStoreMagic[8] = {'V', 'A', 'L', 'H', 'L', 'M', 'K', '\0'};
+constexpr uint32_t kLandmarkStoreVersion = 1;
+
+// Each local tile holding landmarks is split into this many bins along each side
+constexpr uint32_t kLandmarkBinsDim = 8;
+constexpr uint32_t kLandmarkBinCount = kLandmarkBinsDim * kLandmarkBinsDim;
+
+/**
+ * Start of a landmark store. It is followed by tile_count uint32_t ids of the local tiles that
+ * hold landmarks in ascending order, by tile_count * kLandmarkBinCount + 1 uint32_t indices of the
+ * first landmark of each bin of those tiles, by landmark_count LandmarkRecords in bin order and
+ * then by names_size bytes of null terminated names.
+ */
+struct LandmarkStoreHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t tile_count;     // Number of local tiles that hold landmarks
+  uint64_t landmark_count; // Number of landmarks
+  uint64_t names_size;     // Bytes of the names
+};
+
+/**
+ * A landmark of a store, its name is in the names that follow the landmarks.
+ */
+struct LandmarkRecord {
+  uint64_t location;    // See encode_lnglat
+  uint32_t name_offset; // Offset of the name in the names
+  uint8_t type;         // LandmarkType
+  uint8_t spare[3];
+};
+
+static_assert(sizeof(LandmarkRecord) == 16, "LandmarkRecord size is unexpected");
+
+/**
+ * Read only view of a landmark store built by valhalla_build_landmarks. It keeps the landmarks
+ * binned by the local tile and the bin of the tile they are in, so finding the ones in an area
+ * only reads the bins that overlap it. The id of a landmark is its index in the store.
+ */
+class LandmarkStore {
+public:
+  /**
+   * Maps the file read only, throws when it is not a landmark store
+   * @param  file  the path of the file
+   */
+  explicit LandmarkStore(const std::string& file);
+
+  /**
+   * Get the landmarks of a file, the services of a process share them
+   * @param  file  the path of the file, may be empty
+   * @return the landmarks, nullptr when there is no file or it cannot be used
+   */
+  static std::shared_ptr<const LandmarkStore> get(const std::string& file);
+
+  /**
+   * Get a landmark
+   * @param  id  the index of the landmark, less than landmark_count()
+   * @return the landmark
+   */
+  Landmark Get(const uint64_t id) const;
+
+  /**
+   * Get the landmarks in an area
+   * @param  bbox  the area, the landmarks on its maximum sides are left out
+   * @return the landmarks
+   */
+  std::vector<Landmark> Find(const midgard::AABB2<midgard::PointLL>& bbox) const;
+
+  uint64_t landmark_count() const {
+    return header_->landmark_count;
+  }
+
+  /**
+   * Get the bin of the local tile a position is in
+   * @param  ll       the position
+   * @param  tile_id  set to the id of the local tile
+   * @return the bin, -1 when the position is outside of the tiles
+   */
+  static int32_t Bin(const midgard::PointLL& ll, int32_t& tile_id);
+
+protected:
+  midgard::mem_map<char> memory_;
+  const LandmarkStoreHeader* header_;
+  const uint32_t* tiles_;
+  const uint32_t* bins_;
+  const LandmarkRecord* landmarks_;
+  const char* names_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -2,6 +2,11 @@
 #define VALHALLA_BALDR_PREDICTEDSPEEDS_H_
 
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <valhalla/midgard/util.h>
 
 namespace valhalla {
@@ -11,6 +16,11 @@ constexpr uint32_t kSpeedBucketSizeMinutes = 5;
 constexpr uint32_t kSpeedBucketSizeSeconds = kSpeedBucketSizeMinutes * 60;
 constexpr uint32_t kBucketsPerWeek = (7 * 24 * 60) / kSpeedBucketSizeMinutes;
 
+// Speed snapshots are taken for 15 minute windows of the week, each covers 3 speed buckets
+constexpr uint32_t kSnapshotWindowMinutes = 15;
+constexpr uint32_t kBucketsPerSnapshotWindow = kSnapshotWindowMinutes / kSpeedBucketSizeMinutes;
+constexpr uint32_t kSnapshotWindowsPerWeek = kBucketsPerWeek / kBucketsPerSnapshotWindow;
+
 // Length of transformed speed buckets array.
 constexpr uint32_t kCoefficientCount = 200;
 
@@ -75,6 +85,58 @@ public:
     profiles_ = profiles;
   }
 
+  /**
+   * Keep the decoded speed of each profile for the last bucket it was asked for. A request at a
+   * given time asks for the same bucket of an edge over and over, this makes those lookups a
+   * single read instead of a DCT. The cache costs 8 bytes per profile.
+   * @param  profile_count  Number of speed profiles in the tile.
+   */
+  void enable_cache(const uint32_t profile_count) {
+    cache_.reset(new std::atomic<uint64_t>[profile_count]());
+    cache_size_ = profile_count;
+  }
+
+  /**
+   * Whether tiles should enable the decoded speed cache when they are loaded. This is set by the
+   * GraphReader from mjolnir.predicted_speed_cache and applies to the whole process.
+   */
+  static bool cache_enabled();
+  static void set_cache_enabled(const bool enabled);
+
+  /**
+   * Give the tile room for a speed snapshot of each configured window. The snapshot of a window is
+   * a uint8_t speed per profile and bucket of the window, it is filled by the first lookup that
+   * falls into the window and read directly by every lookup after that.
+   * @param  profile_count  Number of speed profiles in the tile.
+   */
+  void enable_snapshots(const uint32_t profile_count);
+
+  /**
+   * The 15 minute windows of the week (0 starts at midnight at the start of the week) for which
+   * tiles keep a speed snapshot. This is set by the GraphReader from
+   * mjolnir.predicted_speed_snapshots and applies to the whole process, set it before any tile is
+   * loaded.
+   * @param  windows  Window indices, out of range indices are ignored.
+   */
+  static void set_snapshot_windows(const std::vector<uint32_t>& windows);
+  static bool snapshots_enabled();
+
+  /**
+   * Bytes the decoded speed cache and the snapshots take up, counting every snapshot as filled
+   * since they fill up as soon as requests depart in their window.
+   */
+  size_t memory_usage() const;
+
+  /**
+   * Get the compressed speed profile of a directed edge, as it was added to the tile.
+   * @param  idx  Directed edge index, the edge must have a predicted speed.
+   */
+  std::array<int16_t, kCoefficientCount> profile(const uint32_t idx) const {
+    std::array<int16_t, kCoefficientCount> coefficients;
+    std::memcpy(coefficients.data(), profiles_ + offset_[idx], sizeof(coefficients));
+    return coefficients;
+  }
+
   /**
    * Get the speed given the edge Id and the seconds of the week.
    * @param  idx  Directed edge index.
@@ -85,15 +147,65 @@ public:
     // (otherwise an exception would be thrown when getting the directed edge) and the profile
     // offset is valid. If there is no predicted speed profile this method will not be called due
     // to DirectedEdge::has_predicted_speed being false.
-    const int16_t* coefficients = profiles_ + offset_[idx];
-
-    return decompress_speed_bucket(coefficients, seconds_of_week / kSpeedBucketSizeSeconds);
+    const uint32_t offset = offset_[idx];
+    const uint32_t bucket = seconds_of_week / kSpeedBucketSizeSeconds;
+    const uint32_t profile = offset / kCoefficientCount;
+    if (snapshots_ != nullptr && profile < snapshot_profiles_) {
+      const int16_t slot = snapshot_slots_[bucket / kBucketsPerSnapshotWindow];
+      if (slot >= 0) {
+        return snapshot(slot, bucket)[profile * kBucketsPerSnapshotWindow +
+                                      bucket % kBucketsPerSnapshotWindow];
+      }
+    }
+    if (cache_ == nullptr || profile >= cache_size_) {
+      return decompress_speed_bucket(profiles_ + offset, bucket);
+    }
+
+    // the tile is shared between threads, each slot packs the bucket (plus one so that zero is
+    // empty) with the bits of the speed so that it is read and written in one go
+    auto& slot = cache_[profile];
+    const uint64_t cached = slot.load(std::memory_order_relaxed);
+    float speed;
+    if (static_cast<uint32_t>(cached >> 32) == bucket + 1) {
+      const auto bits = static_cast<uint32_t>(cached);
+      std::memcpy(&speed, &bits, sizeof(speed));
+      return speed;
+    }
+    speed = decompress_speed_bucket(profiles_ + offset, bucket);
+    uint32_t bits;
+    std::memcpy(&bits, &speed, sizeof(bits));
+    slot.store((static_cast<uint64_t>(bucket + 1) << 32) | bits, std::memory_order_relaxed);
+    return speed;
   }
 
 protected:
+  // Speeds of one snapshot window, decoded once per tile
+  struct Snapshot {
+    std::once_flag built;
+    std::unique_ptr<uint8_t[]> speeds;
+  };
+
+  /**
+   * Get the speeds of a snapshot window, decoding them on first use.
+   * @param  slot    Slot of the window in snapshots_.
+   * @param  bucket  Any bucket within the window.
+   * @return Returns kBucketsPerSnapshotWindow speeds per profile, 0 where the speed is unusable.
+   */
+  const uint8_t* snapshot(const int16_t slot, const uint32_t bucket) const;
+
   const uint32_t* offset_;  // Offset into the array of compressed speed profiles
                             // for each directed edge
   const int16_t* profiles_; // Compressed speed profiles
+
+  // Last decoded bucket and speed of each profile, only when the cache is enabled
+  std::unique_ptr<std::atomic<uint64_t>[]> cache_;
+  uint32_t cache_size_ = 0;
+
+  // Speed snapshots of the configured windows, only when snapshots are enabled. The slots map
+  // every window of the week to its snapshot or to -1
+  std::unique_ptr<Snapshot[]> snapshots_;
+  const int16_t* snapshot_slots_ = nullptr;
+  uint32_t snapshot_profiles_ = 0;
 };
 
 } // namespace baldr
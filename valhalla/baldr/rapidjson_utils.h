@@ -1,6 +1,9 @@
 #ifndef VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 #define VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <istream>
 #include <locale>
@@ -51,12 +54,24 @@ inline std::string to_string(const rapidjson::Value& value, int decimal_places =
  * its not found
  */
 
+// most paths are a single key of an object, those are found without parsing and allocating a
+// pointer, which is most of the cost of looking up the many keys of a large request
+template <typename V>
+inline auto find_value(V&& v, const char* source)
+    -> decltype(rapidjson::Pointer{source}.Get(std::forward<V>(v))) {
+  if (source[0] == '/' && v.IsObject() && !std::strpbrk(source + 1, "/~")) {
+    auto member = v.FindMember(source + 1);
+    return member == v.MemberEnd() ? nullptr : &member->value;
+  }
+  return rapidjson::Pointer{source}.Get(std::forward<V>(v));
+}
+
 // if you dont want an arithmetic type dont try any lexical casting
 template <typename T, typename V>
 inline typename std::enable_if<!std::is_arithmetic<T>::value, boost::optional<T>>::type
 get_optional(V&& v, const char* source) {
   // if we dont have this key bail
-  auto* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  auto* ptr = find_value(std::forward<V>(v), source);
   if (!ptr) {
     return boost::none;
   }
@@ -73,7 +88,7 @@ template <typename T, typename V>
 inline typename std::enable_if<std::is_arithmetic<T>::value, boost::optional<T>>::type
 get_optional(V&& v, const char* source) {
   // if we dont have this key bail
-  auto* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  auto* ptr = find_value(std::forward<V>(v), source);
   if (!ptr) {
     return boost::none;
   }
@@ -128,7 +143,7 @@ template <typename T, typename V> inline T get(V&& v, const char* source) {
 }
 
 template <typename V> inline const rapidjson::Value& get_child(const V& v, const char* source) {
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find_value(v, source);
   if (!ptr) {
     throw std::runtime_error(std::string("No child: ") + source);
   }
@@ -137,7 +152,7 @@ template <typename V> inline const rapidjson::Value& get_child(const V& v, const
 
 template <typename V>
 inline const rapidjson::Value& get_child(const V& v, const char* source, const rapidjson::Value& t) {
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find_value(v, source);
   if (!ptr) {
     return t;
   }
@@ -145,7 +160,7 @@ inline const rapidjson::Value& get_child(const V& v, const char* source, const r
 }
 
 template <typename V> inline rapidjson::Value& get_child(V&& v, const char* source) {
-  rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  rapidjson::Value* ptr = find_value(std::forward<V>(v), source);
   if (!ptr) {
     throw std::runtime_error(std::string("No child: ") + source);
   }
@@ -155,7 +170,7 @@ template <typename V> inline rapidjson::Value& get_child(V&& v, const char* sour
 template <typename V>
 inline boost::optional<const rapidjson::Value&> get_child_optional(const V& v, const char* source) {
   boost::optional<const rapidjson::Value&> c;
-  const rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(v);
+  const rapidjson::Value* ptr = find_value(v, source);
   if (ptr) {
     c.reset(*ptr);
   }
@@ -165,7 +180,7 @@ inline boost::optional<const rapidjson::Value&> get_child_optional(const V& v, c
 template <typename V>
 inline boost::optional<rapidjson::Value&> get_child_optional(V&& v, const char* source) {
   boost::optional<rapidjson::Value&> c;
-  rapidjson::Value* ptr = rapidjson::Pointer{source}.Get(std::forward<V>(v));
+  rapidjson::Value* ptr = find_value(std::forward<V>(v), source);
   if (ptr) {
     c.reset(*ptr);
   }
@@ -323,6 +338,65 @@ public:
     writer.SetMaxDecimalPlaces(precision);
   }
 
+  // Number of bytes in the buffer
+  inline size_t size() const {
+    return buffer.GetSize();
+  }
+
+  // Moves what is in the buffer out of it, the writer carries on with the document where it left
+  // off so a large one can be handed on in pieces while it is written
+  inline std::string flush() {
+    std::string written(buffer.GetString(), buffer.GetSize());
+    buffer.Clear();
+    return written;
+  }
+
+  // Empty the buffer so the writer can be reused for another document
+  inline void clear() {
+    buffer.Clear();
+    writer.Reset(buffer);
+  }
+
+  /**
+   * Writes a number with exactly this many decimal places, trailing zeros included, which is the
+   * same text baldr::json::fixed_t writes. Like it, values that are not finite become strings
+   */
+  inline void fixed(const double value, const int decimals) {
+    char number[64];
+    int length = std::snprintf(number, sizeof(number), "%.*f", decimals, value);
+    std::string longer;
+    if (length >= static_cast<int>(sizeof(number))) {
+      longer.resize(length + 1);
+      std::snprintf(&longer[0], longer.size(), "%.*f", decimals, value);
+    }
+    const char* text = longer.empty() ? number : longer.c_str();
+    if (std::isfinite(value)) {
+      writer.RawValue(text, length, rapidjson::kNumberType);
+    } else {
+      writer.String(text, length);
+    }
+  }
+
+  inline void fixed(const char* key, const double value, const int decimals) {
+    writer.String(key);
+    fixed(value, decimals);
+  }
+
+  inline void fixed(const std::string& key, const double value, const int decimals) {
+    writer.String(key);
+    fixed(value, decimals);
+  }
+
+  // Writes json that is already serialized as the next value
+  inline void raw(const std::string& json) {
+    writer.RawValue(json.c_str(), json.size(), rapidjson::kObjectType);
+  }
+
+  inline void raw(const char* key, const std::string& json) {
+    writer.String(key);
+    raw(json);
+  }
+
   inline void operator()(const char* key, const char* value) {
     writer.String(key);
     writer.String(value);
@@ -0,0 +1,125 @@
+#ifndef VALHALLA_BALDR_REACHINDEX_H_
+#define VALHALLA_BALDR_REACHINDEX_H_
+
+#include <array>
+#include <cstdint>
+
+#include <valhalla/baldr/graphconstants.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Access modes whose reach valhalla_build_reach precomputes, one column each, with the default
+// options of the auto, truck, bicycle, pedestrian, motor_scooter and motorcycle costings
+constexpr std::array<uint16_t, 6> kReachIndexAccess = {
+    kAutoAccess, kTruckAccess, kBicycleAccess, kPedestrianAccess, kMopedAccess, kMotorcycleAccess,
+};
+
+// Reach is counted in nodes and stored in 16 bits
+constexpr uint32_t kMaxIndexedReach = 65535;
+
+/**
+ * Precomputed outbound and inbound reach of a directed edge for one access mode, capped at the
+ * max reach of the index.
+ */
+struct EdgeReach {
+  uint16_t outbound;
+  uint16_t inbound;
+};
+
+/**
+ * Start of the reach section of a tile. It is followed by the access mask of each column as a
+ * uint32_t and then by column_count EdgeReach records per directed edge, edge after edge.
+ */
+struct ReachIndexHeader {
+  uint32_t max_reach;    // Reach values are capped at this
+  uint32_t column_count; // Number of access modes stored per edge
+};
+
+/**
+ * Read only view of the reach section of a tile. Reach that is below the max reach of the index
+ * is exact for the default costing of the access mode without live traffic, reach at the max
+ * reach only says the edge reaches at least that far.
+ */
+class ReachIndex {
+public:
+  ReachIndex() = default;
+
+  /**
+   * @param  section     Start of the reach section within the tile.
+   * @param  edge_count  Number of directed edges in the tile.
+   */
+  ReachIndex(const char* section, const uint32_t edge_count) : edge_count_(edge_count) {
+    const auto* header = reinterpret_cast<const ReachIndexHeader*>(section);
+    max_reach_ = header->max_reach;
+    column_count_ = header->column_count;
+    access_ = reinterpret_cast<const uint32_t*>(section + sizeof(ReachIndexHeader));
+    reaches_ = reinterpret_cast<const EdgeReach*>(access_ + column_count_);
+  }
+
+  /**
+   * Size in bytes of a reach section.
+   * @param  column_count  Number of access modes stored per edge.
+   * @param  edge_count    Number of directed edges in the tile.
+   */
+  static size_t SizeOf(const uint32_t column_count, const uint32_t edge_count) {
+    return sizeof(ReachIndexHeader) + column_count * sizeof(uint32_t) +
+           static_cast<size_t>(column_count) * edge_count * sizeof(EdgeReach);
+  }
+
+  /**
+   * Reach is capped at this value, 0 when the tile has no reach section.
+   */
+  uint32_t max_reach() const {
+    return max_reach_;
+  }
+
+  /**
+   * Get the column of an access mode.
+   * @param  access  Access mask of the costing, see DynamicCost::access_mode.
+   * @return the column or -1 if the access mode is not in the index
+   */
+  int column(const uint32_t access) const {
+    for (uint32_t i = 0; i < column_count_; ++i) {
+      if (access_[i] == access) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * Get the reach of a directed edge.
+   * @param  edge_index  Index of the directed edge within the tile.
+   * @param  column      Column of the access mode, see column().
+   */
+  EdgeReach reach(const uint32_t edge_index, const int column) const {
+    return reaches_[static_cast<size_t>(edge_index) * column_count_ + column];
+  }
+
+  /**
+   * Number of access modes stored per edge.
+   */
+  uint32_t column_count() const {
+    return column_count_;
+  }
+
+  /**
+   * Number of directed edges in the tile.
+   */
+  uint32_t edge_count() const {
+    return edge_count_;
+  }
+
+protected:
+  uint32_t max_reach_ = 0;
+  uint32_t column_count_ = 0;
+  uint32_t edge_count_ = 0;
+  const uint32_t* access_ = nullptr;
+  const EdgeReach* reaches_ = nullptr;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_REACHINDEX_H_
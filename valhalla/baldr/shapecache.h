@@ -0,0 +1,84 @@
+#ifndef VALHALLA_BALDR_SHAPECACHE_H_
+#define VALHALLA_BALDR_SHAPECACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Decoded edge shapes of a tile, keyed by the offset of their edge info. The cache has a fixed
+ * number of slots and an edge info goes into the slot of its offset, replacing whatever shape was
+ * there, so it never grows past its size. Tiles are shared between threads, so slots are read and
+ * written atomically and a shape handed out stays valid after it is replaced.
+ */
+class ShapeCache {
+public:
+  using Shape = std::shared_ptr<const std::vector<midgard::PointLL>>;
+
+  /**
+   * Constructor.
+   * @param  size  Number of slots, rounded up to a power of 2 of at least 2.
+   */
+  explicit ShapeCache(const uint32_t size);
+
+  /**
+   * Get the decoded shape of an edge info, decoding it when it is not cached.
+   * @param  offset        Offset of the edge info within the tile.
+   * @param  encoded       The encoded shape of the edge info.
+   * @param  encoded_size  Number of bytes of the encoded shape.
+   * @return the decoded shape
+   */
+  Shape get(const uint32_t offset, const char* encoded, const size_t encoded_size) const;
+
+  /**
+   * Bytes the slots take up, the shapes in them come and go and are not counted.
+   */
+  size_t memory_usage() const {
+    return slots_.size() * sizeof(slots_[0]);
+  }
+
+  /**
+   * Number of slots of the cache of each tile, 0 when tiles have no shape cache. This is set by
+   * the GraphReader from mjolnir.shape_cache_size and applies to the whole process.
+   */
+  static uint32_t size();
+  static void set_size(const uint32_t size);
+
+  // Shape decoding counters of the whole process
+  struct Stats {
+    uint64_t decodes; // shapes decoded, with or without a cache
+    uint64_t hits;    // shapes found in the cache of their tile
+  };
+
+  /**
+   * Returns the counters accumulated since the process started.
+   */
+  static Stats stats();
+
+  /**
+   * Counts a shape decoded outside of a cache.
+   */
+  static void count_decode();
+
+protected:
+  struct Entry {
+    uint32_t offset;
+    std::vector<midgard::PointLL> shape;
+  };
+
+  // Bits dropped from the hashed offset to get its slot
+  uint32_t shift_;
+
+  // The cached shapes, accessed with the atomic shared_ptr functions
+  mutable std::vector<std::shared_ptr<const Entry>> slots_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHAPECACHE_H_
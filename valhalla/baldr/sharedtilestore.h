@@ -0,0 +1,117 @@
+#ifndef VALHALLA_BALDR_SHAREDTILESTORE_H_
+#define VALHALLA_BALDR_SHAREDTILESTORE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphmemory.h>
+
+namespace valhalla {
+namespace baldr {
+
+struct SharedTileStoreHeader;
+struct SharedTileSlot;
+
+/**
+ * Decompressed tile data in a POSIX shared memory segment, so that several processes on one host
+ * load and keep each tile once instead of once per process. GraphReaders look tiles up here
+ * before they read them from disk and put what they read, their own tile cache then only holds
+ * the GraphTile objects pointing into the segment.
+ *
+ * Lookups are lock-free: every slot has one atomic word with a valid bit, a generation and the
+ * number of tiles using it, a reader pins a slot by incrementing that word if it did not change
+ * since it read the slot. Writers serialize on a process-shared robust mutex in the segment. The
+ * data is written ring buffer style and a writer evicts the slots in the way of a new tile, slots
+ * that are pinned by any process are skipped. A tile that does not fit is simply not shared.
+ *
+ * The segment outlives the processes, remove it with Remove (or from /dev/shm) when the tiles it
+ * was filled from change.
+ */
+class SharedTileStore {
+public:
+  /**
+   * Counters of the store, shared by all processes using it
+   */
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t puts = 0;
+    uint64_t evictions = 0;
+    uint64_t rejected = 0; // tiles that were too big or only had pinned slots in their way
+  };
+
+  /**
+   * Opens the segment or creates it if no process did so yet.
+   * @param  name  name of the segment, e.g. /valhalla_tiles
+   * @param  size  bytes of tile data the segment holds when it is created
+   * @throws std::runtime_error if the segment cannot be created or mapped or it was created with a
+   *         different layout
+   */
+  SharedTileStore(const std::string& name, size_t size);
+
+  SharedTileStore(const SharedTileStore&) = delete;
+  SharedTileStore& operator=(const SharedTileStore&) = delete;
+
+  /**
+   * Get the data of a tile, pinned until the returned memory is destroyed.
+   * @param  graphid  the tile
+   * @return the tile data or nullptr if the store does not have it
+   */
+  std::unique_ptr<const GraphMemory> Get(const GraphId& graphid) const;
+
+  /**
+   * Copy the data of a tile into the store, replacing nothing if it is there already.
+   * @param  graphid  the tile
+   * @param  data     the tile data
+   * @param  size     bytes of tile data
+   * @return the data in the store, pinned until it is destroyed, or nullptr if it did not fit
+   */
+  std::unique_ptr<const GraphMemory> Put(const GraphId& graphid, const char* data, size_t size);
+
+  /**
+   * Returns the counters accumulated since the segment was created.
+   */
+  Stats GetStats() const;
+
+  /**
+   * Get the store of a segment, opening it the first time. GraphReaders of the same process share
+   * the mapping.
+   * @param  name  name of the segment
+   * @param  size  bytes of tile data the segment holds when it is created
+   */
+  static std::shared_ptr<SharedTileStore> get(const std::string& name, size_t size);
+
+  /**
+   * Removes a segment, processes that have it mapped keep using it until they unmap it.
+   * @param  name  name of the segment
+   */
+  static void Remove(const std::string& name);
+
+protected:
+  SharedTileSlot* slot(uint64_t idx) const;
+
+  /**
+   * Pin a slot holding the tile and hand out its data.
+   * @return the data or nullptr if the slot does not hold the tile
+   */
+  std::unique_ptr<const GraphMemory> Pin(SharedTileSlot* slot, uint64_t tile_id) const;
+
+  /**
+   * Evict the unpinned slots whose data overlaps [begin, end). Must hold the write lock.
+   * @return the end of the data of a pinned slot in the way or 0 if the range is free
+   */
+  uint64_t Evict(uint64_t begin, uint64_t end);
+
+  // the mapped segment, tile data handed out keeps it mapped
+  std::shared_ptr<char> segment_;
+  SharedTileStoreHeader* header_;
+  char* data_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHAREDTILESTORE_H_
@@ -0,0 +1,91 @@
+#ifndef VALHALLA_BALDR_STOPDEPARTUREINDEX_H_
+#define VALHALLA_BALDR_STOPDEPARTUREINDEX_H_
+
+#include <cstdint>
+
+#include <valhalla/midgard/util.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Start of the stop departure index section of a transit tile. It is followed by 2 * node_count + 1
+ * offsets into the departure list and then by the departure list itself, entry_count indexes into
+ * the departures of the tile.
+ */
+struct StopDepartureIndexHeader {
+  uint32_t node_count;  // Number of nodes in the tile
+  uint32_t entry_count; // Number of departure indexes in the list
+};
+
+/**
+ * Read only view of the stop departure index of a transit tile. It lists the departures of all
+ * the transit lines leaving each stop, so the next departure at a stop can be binary searched for
+ * across its lines at once. The fixed schedule departures of a stop are sorted by departure time
+ * and followed by its frequency based departures sorted by the end of their service.
+ */
+class StopDepartureIndex {
+public:
+  StopDepartureIndex() = default;
+
+  /**
+   * @param  section  Start of the stop departure index section within the tile.
+   */
+  explicit StopDepartureIndex(const char* section) {
+    const auto* header = reinterpret_cast<const StopDepartureIndexHeader*>(section);
+    node_count_ = header->node_count;
+    offsets_ = reinterpret_cast<const uint32_t*>(section + sizeof(StopDepartureIndexHeader));
+    departures_ = offsets_ + 2 * node_count_ + 1;
+  }
+
+  /**
+   * Size in bytes of a stop departure index section.
+   * @param  node_count   Number of nodes in the tile.
+   * @param  entry_count  Number of departure indexes in the list.
+   */
+  static size_t SizeOf(const uint32_t node_count, const uint32_t entry_count) {
+    return sizeof(StopDepartureIndexHeader) +
+           (2 * static_cast<size_t>(node_count) + 1 + entry_count) * sizeof(uint32_t);
+  }
+
+  /**
+   * Does the tile have the index.
+   */
+  bool empty() const {
+    return offsets_ == nullptr;
+  }
+
+  /**
+   * Get the fixed schedule departures leaving a stop, sorted by departure time.
+   * @param  node_index  Index of the stop node within the tile.
+   * @return indexes into the departures of the tile
+   */
+  midgard::iterable_t<const uint32_t> fixed(const uint32_t node_index) const {
+    if (node_index >= node_count_) {
+      return {departures_, static_cast<size_t>(0)};
+    }
+    return {departures_ + offsets_[2 * node_index], departures_ + offsets_[2 * node_index + 1]};
+  }
+
+  /**
+   * Get the frequency based departures leaving a stop, sorted by the end of their service.
+   * @param  node_index  Index of the stop node within the tile.
+   * @return indexes into the departures of the tile
+   */
+  midgard::iterable_t<const uint32_t> frequency(const uint32_t node_index) const {
+    if (node_index >= node_count_) {
+      return {departures_, static_cast<size_t>(0)};
+    }
+    return {departures_ + offsets_[2 * node_index + 1], departures_ + offsets_[2 * node_index + 2]};
+  }
+
+protected:
+  uint32_t node_count_ = 0;
+  const uint32_t* offsets_ = nullptr;
+  const uint32_t* departures_ = nullptr;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_STOPDEPARTUREINDEX_H_
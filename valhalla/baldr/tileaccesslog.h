@@ -0,0 +1,137 @@
+#ifndef VALHALLA_BALDR_TILEACCESSLOG_H_
+#define VALHALLA_BALDR_TILEACCESSLOG_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Start of a tile access log file
+struct TileAccessLogHeader {
+  char magic[8];       // kTileAccessLogMagic
+  uint32_t version;    // kTileAccessLogVersion
+  uint32_t tile_count; // number of TileAccessCount records following the header
+};
+
+// How often a tile was asked for
+struct TileAccessCount {
+  uint64_t tile_id; // the base graph id of the tile
+  uint64_t count;
+  uint64_t misses; // how many of the counted accesses did not find the tile in the cache
+};
+
+// The accesses of the tiles of a hierarchy level
+struct TileAccessLevel {
+  uint32_t level;
+  uint64_t tiles;  // tiles of the level that were asked for
+  uint64_t count;  // accesses to them
+  uint64_t misses; // accesses that did not find the tile in the cache
+};
+
+static_assert(sizeof(TileAccessLogHeader) == 16, "TileAccessLogHeader size is unexpected");
+static_assert(sizeof(TileAccessCount) == 24, "TileAccessCount size is unexpected");
+
+constexpr char kTileAccessLogMagic[8] = {'V', 'A', 'L', 'T', 'A', 'C', 'C', 'S'};
+// version 1 had no misses, its records are 16 bytes and are still read
+constexpr uint32_t kTileAccessLogVersion = 2;
+
+/**
+ * A histogram of how often the GraphReaders of a process asked for each tile, written to a file
+ * every so often so the next process can warm its tile cache with the tiles that were used most,
+ * see GraphReader::Warmup. The counts in the file are halved when a process picks them up, so
+ * what was popular a few deploys ago fades out.
+ *
+ * Next to the accesses it counts the ones that missed the tile cache, so the log is also a heatmap
+ * of where the tiles are used and where the cache falls short, see valhalla_tile_heatmap and the
+ * tile_access of a verbose /status.
+ *
+ * The file is a TileAccessLogHeader followed by a TileAccessCount per tile, most accessed first.
+ * It is written next to itself and renamed over the old one so readers never see half of it.
+ */
+class TileAccessLog {
+public:
+  /**
+   * Constructor. Picks up the counts of the file if there is one.
+   * @param  file_name       the file to keep the histogram in
+   * @param  write_interval  how long the counts are gathered before they are written
+   */
+  TileAccessLog(const std::string& file_name, std::chrono::seconds write_interval);
+
+  /**
+   * Writes what was counted.
+   */
+  ~TileAccessLog();
+
+  TileAccessLog(const TileAccessLog&) = delete;
+  TileAccessLog& operator=(const TileAccessLog&) = delete;
+
+  /**
+   * Adds the counts one reader gathered and writes the file if it is time to.
+   * @param  counts  accesses by base tile id
+   * @param  misses  accesses that missed the cache by base tile id
+   */
+  void Add(const std::unordered_map<uint64_t, uint32_t>& counts,
+           const std::unordered_map<uint64_t, uint32_t>& misses = {});
+
+  /**
+   * Get what was counted so far, as it would be written now.
+   * @return the counts, most accessed first
+   */
+  std::vector<TileAccessCount> Counts();
+
+  /**
+   * Sums up the counts of the tiles per hierarchy level.
+   * @param  counts  the counts of the tiles
+   * @return the levels that have counts, lowest first
+   */
+  static std::vector<TileAccessLevel> ByLevel(const std::vector<TileAccessCount>& counts);
+
+  /**
+   * Writes the file now.
+   * @return false if the file could not be written
+   */
+  bool Write();
+
+  /**
+   * Reads a tile access log file.
+   * @param  file_name  the file to read
+   * @return the counts, most accessed first, empty if the file is missing or not a valid log
+   */
+  static std::vector<TileAccessCount> Read(const std::string& file_name);
+
+  /**
+   * Get the log of a file, opening it the first time. GraphReaders of the same process share it.
+   * @param  file_name       the file to keep the histogram in
+   * @param  write_interval  how long the counts are gathered before they are written
+   */
+  static std::shared_ptr<TileAccessLog> get(const std::string& file_name,
+                                            std::chrono::seconds write_interval);
+
+protected:
+  bool WriteLocked();
+  std::vector<TileAccessCount> CountsLocked() const;
+
+  struct counts_t {
+    uint64_t count = 0;
+    uint64_t misses = 0;
+  };
+
+  std::mutex mutex_;
+  const std::string file_name_;
+  const std::chrono::seconds write_interval_;
+  std::chrono::steady_clock::time_point last_write_;
+  std::unordered_map<uint64_t, counts_t> counts_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TILEACCESSLOG_H_
@@ -36,6 +36,19 @@ public:
    * */
   virtual response_t get(const std::string& url) = 0;
 
+  /**
+   * Makes synchronous requests to several urls and returns a response_t object for each of them.
+   * Getters that can fetch them at once should, by default they are fetched one after the other.
+   * */
+  virtual std::vector<response_t> get_batch(const std::vector<std::string>& urls) {
+    std::vector<response_t> responses;
+    responses.reserve(urls.size());
+    for (const auto& url : urls) {
+      responses.push_back(get(url));
+    }
+    return responses;
+  }
+
   /**
    * Whether tiles are with .gz extension.
    */
@@ -43,6 +56,14 @@ public:
     return false;
   }
 
+  /**
+   * The suffix of the tile files to request, zstd or lz4 compressed tiles are served as files of
+   * their own rather than through a content encoding like gzip.
+   */
+  virtual std::string tile_suffix() const {
+    return ".gph";
+  }
+
   /**
    * A callback which is called to check if the request should be interrupted.
    */
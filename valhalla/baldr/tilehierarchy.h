@@ -1,6 +1,7 @@
 #ifndef VALHALLA_MIDGARD_TILEHIERARCHY_H
 #define VALHALLA_MIDGARD_TILEHIERARCHY_H
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -27,6 +28,54 @@ struct TileLevel {
   midgard::Tiles<midgard::PointLL> tiles;
 };
 
+// Tile sizes in degrees of the levels of the hierarchy, which its tilings are made from. They are
+// powers of 2 so multiplying by their inverses gives exactly what dividing by them gives
+constexpr std::array<double, 3> kTileSizes = {4., 1., .25};
+constexpr double kTransitTileSize = .25;
+
+/**
+ * Tile math of a level of the hierarchy with the size of its tiles known at compile time. Gives
+ * exactly the tile ids and bases the tiling of the level gives, rounding included, without reading
+ * the tiling or dividing at runtime.
+ */
+template <uint8_t level> struct LevelTiling {
+  static_assert(level < kTileSizes.size(), "Not a level of the hierarchy");
+  static constexpr double kTileSize = kTileSizes[level];
+  static constexpr double kInverseTileSize = 1. / kTileSize;
+  static constexpr int32_t kColumns = static_cast<int32_t>(360. / kTileSize);
+  static constexpr int32_t kRows = static_cast<int32_t>(180. / kTileSize);
+
+  /**
+   * Get the tile id of a position, see midgard::Tiles::TileId.
+   * @param  ll  Lat,lng position.
+   * @return the tile id, -1 outside of the world
+   */
+  static int32_t TileId(const midgard::PointLL& ll) {
+    const double lng = ll.lng(), lat = ll.lat();
+    if (lat < -90. || lng < -180. || lat > 90. || lng > 180.) {
+      return -1;
+    }
+    // the tilings round the position to float and the column to float again before truncating
+    const float lat_f = static_cast<float>(lat), lng_f = static_cast<float>(lng);
+    const int32_t row = lat_f == 90.f ? kRows - 1
+                                      : static_cast<int32_t>((lat_f + 90.) * kInverseTileSize);
+    const float col_f = static_cast<float>((lng_f + 180.) * kInverseTileSize);
+    const int32_t col = lng_f == 180.f ? kColumns - 1 : static_cast<int32_t>(col_f);
+    return row * kColumns + col;
+  }
+
+  /**
+   * Get the south west corner of a tile, see midgard::Tiles::Base.
+   * @param  tileid  Tile id.
+   * @return the corner
+   */
+  static midgard::PointLL Base(const int32_t tileid) {
+    const int32_t row = tileid / kColumns;
+    const int32_t col = tileid - row * kColumns;
+    return {-180. + col * kTileSize, -90. + row * kTileSize};
+  }
+};
+
 /**
  * Set of static methods used to get information the hierarchy of tiles. The
  * tile hierarchy levels are static.
@@ -53,6 +102,30 @@ public:
    */
   static GraphId GetGraphId(const midgard::PointLL& pointll, const uint8_t level);
 
+  /**
+   * Returns the GraphId of the tile of a level known at compile time based on a lat,lng.
+   * @param pointll  Lat,lng location within the tile.
+   * @return the tile, invalid outside of the world
+   */
+  template <uint8_t level> static GraphId GetGraphId(const midgard::PointLL& pointll) {
+    const auto tile_id = LevelTiling<level>::TileId(pointll);
+    return tile_id >= 0 ? GraphId(static_cast<uint32_t>(tile_id), level, 0) : GraphId();
+  }
+
+  /**
+   * Returns the GraphIds of the tiles of a batch of lat,lngs on a level, the same GetGraphId
+   * returns for each of them.
+   * @param points  Lat,lng locations.
+   * @param count   Number of locations.
+   * @param level   Level of the requested tiles.
+   * @param ids     Receives the tile of each location, invalid for the locations outside of the
+   *                world and all of them if the level is not supported.
+   */
+  static void GetGraphIds(const midgard::PointLL* points,
+                          const size_t count,
+                          const uint8_t level,
+                          GraphId* ids);
+
   /**
    * Returns bounding box for the given GraphId .
    * @param id corresponding GraphId.
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/tilegetter.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Warms the tiles a search is expected to need on background I/O threads, so that when the search
+ * gets to them the reader finds them in the page cache or in its tile_dir instead of stalling on
+ * the disk or the network. The tiles are not put into the tile cache of the reader, those caches
+ * belong to a single worker and are not thread safe unless configured to be.
+ *
+ * The readers of a process share one prefetcher, the number of its threads bounds how many tiles
+ * are fetched at once.
+ */
+class TilePrefetcher {
+public:
+  // warms one tile, returns false when there is no such tile
+  using fetch_t = std::function<bool()>;
+
+  /**
+   * Constructor
+   * @param max_in_flight  the number of threads and therefore tiles fetched at once
+   * @param tile_getter    gets the tiles of a tile_url, may be nullptr when there is none
+   */
+  TilePrefetcher(size_t max_in_flight, std::unique_ptr<tile_getter_t>&& tile_getter = nullptr);
+
+  ~TilePrefetcher();
+
+  /**
+   * Get the prefetcher of the process, the first reader to ask makes it and the others share it
+   * @param pt  the configuration of the reader
+   * @return the prefetcher, nullptr when mjolnir.tile_prefetch.max_in_flight is 0
+   */
+  static std::shared_ptr<TilePrefetcher> shared(const boost::property_tree::ptree& pt);
+
+  /**
+   * Get the tiles of each hierarchy level which are within width kilometers of the straight line
+   * between two points. They are sorted by how far they are from the closer of the two, the tiles
+   * a bidirectional search reaches first come first.
+   * @param origin       where the search starts
+   * @param destination  where the search ends
+   * @param width        how far away from the line the tiles may be in kilometers
+   * @return the ids of the tiles
+   */
+  static std::vector<GraphId>
+  Corridor(const midgard::PointLL& origin, const midgard::PointLL& destination, float width);
+
+  /**
+   * Queue a tile to be warmed. Tiles that are already queued, that turned out not to exist or that
+   * do not fit into the queue anymore are skipped.
+   * @param tile_id  the id of the tile
+   * @param fetch    the function warming it, called on one of the threads
+   */
+  void Enqueue(const GraphId& tile_id, fetch_t&& fetch);
+
+  /**
+   * Wait until the queued tiles have been warmed
+   */
+  void Wait() const;
+
+  /**
+   * Whether a tile is queued or being warmed right now
+   * @param tile_id  the id of the tile
+   * @return true until the tile has been warmed
+   */
+  bool IsPending(const GraphId& tile_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_.count(tile_id) > 0;
+  }
+
+  /**
+   * @return the getter the fetch functions should use for the tiles of a tile_url, may be nullptr
+   */
+  tile_getter_t* tile_getter() const {
+    return tile_getter_.get();
+  }
+
+protected:
+  void Work();
+
+  std::unique_ptr<tile_getter_t> tile_getter_;
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable signal_;
+  std::deque<std::pair<GraphId, fetch_t>> queue_;
+  std::unordered_set<GraphId> queued_;
+  std::unordered_set<GraphId> missing_;
+  size_t in_flight_;
+  bool stop_;
+
+  std::vector<std::thread> threads_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,95 @@
+#ifndef VALHALLA_BALDR_TILESCOPE_H_
+#define VALHALLA_BALDR_TILESCOPE_H_
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/graphtileptr.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Pins the tiles a search uses so that its inner loops can pass them around by reference. Getting
+ * a tile from the reader copies a graph_tile_ptr, an atomic increment and decrement of a reference
+ * count every thread using the tile writes to. The scope takes that reference once per tile, the
+ * first time the tile is asked for, and gives all of them back at once when it is cleared. In
+ * between a tile is a lookup in a small direct mapped table.
+ *
+ * Tiles the reader evicts from its cache stay alive while they are pinned, which is why searches
+ * trim the scope in between expansions once it pins more than max_tiles. A scope belongs to one
+ * thread at a time and the references it hands out stay valid until it is cleared.
+ */
+class TileScope {
+public:
+  static constexpr size_t kDefaultMaxTiles = 512;
+
+  /**
+   * @param max_tiles  how many tiles Trim lets the scope pin
+   */
+  explicit TileScope(size_t max_tiles = kDefaultMaxTiles);
+
+  TileScope(const TileScope&) = delete;
+  TileScope& operator=(const TileScope&) = delete;
+
+  /**
+   * Get the tile of a graph id, pinned until the scope is cleared
+   * @param reader  the reader to get the tile from the first time
+   * @param id      any graph id within the tile
+   * @return the tile, a null pointer if the reader does not have it
+   */
+  const graph_tile_ptr& Get(GraphReader& reader, const GraphId& id) {
+    const uint32_t tile = id.tile_value();
+    auto& slot = slots_[(tile ^ (tile >> 7)) % slots_.size()];
+    if (slot.pin != nullptr && slot.tile == tile) {
+      return *slot.pin;
+    }
+    return Pin(reader, tile, slot);
+  }
+
+  /**
+   * Releases every pinned tile, references handed out before are no longer valid
+   */
+  void Clear();
+
+  /**
+   * Clears the scope if it pins more than max_tiles, only call it when none of the references it
+   * handed out are in use
+   * @return true if it was cleared
+   */
+  bool Trim() {
+    if (pins_.size() <= max_tiles_) {
+      return false;
+    }
+    Clear();
+    return true;
+  }
+
+  /**
+   * @return how many tiles are pinned
+   */
+  size_t size() const {
+    return pins_.size();
+  }
+
+protected:
+  struct slot_t {
+    uint32_t tile = 0;
+    const graph_tile_ptr* pin = nullptr;
+  };
+
+  const graph_tile_ptr& Pin(GraphReader& reader, uint32_t tile, slot_t& slot);
+
+  size_t max_tiles_;
+  std::array<slot_t, 64> slots_;
+  // nodes of the map do not move so the slots can point at them
+  std::unordered_map<uint32_t, graph_tile_ptr> pins_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TILESCOPE_H_
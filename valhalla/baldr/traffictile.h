@@ -8,7 +8,9 @@
 // C99 stdint.h, and POD structs with no constructors
 #ifndef C_ONLY_INTERFACE
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <memory>
 #include <string>
@@ -187,8 +189,15 @@ struct TrafficTileHeader {
   uint64_t last_update; // seconds since epoch
   uint32_t directed_edge_count;
   uint32_t traffic_tile_version;
-  uint32_t spare2;
-  uint32_t spare3;
+  // Bumped by in-process writers before and after they apply a batch of speeds, odd while they are
+  // at it. Readers retry a speed read while it is odd or changed under them (a seqlock). Processes
+  // that write the extract in place on their own leave it at 0
+  uint32_t write_sequence;
+  // How many edges of the tile are closed, kept up to date by in-process writers once they have
+  // counted them. Processes that write the extract in place on their own have to clear
+  // closures_counted, otherwise closed edges they add would be skipped
+  uint32_t closed_edge_count : 31;
+  uint32_t closures_counted : 1;
 };
 
 #ifndef C_ONLY_INTERFACE
@@ -227,6 +236,13 @@ static constexpr volatile TrafficSpeed INVALID_SPEED{
 static_assert(MAX_TRAFFIC_SPEED_KPH == valhalla::baldr::kMaxTrafficSpeed,
               "Constants must be the same");
 } // namespace
+
+// A live speed for one directed edge of a traffic tile
+struct TrafficSpeedUpdate {
+  uint32_t directed_edge_offset;
+  TrafficSpeed speed;
+};
+
 class TrafficTile {
 public:
   // Disallow copying
@@ -257,12 +273,146 @@ public:
     return *(speeds + directed_edge_offset);
   }
 
+  /**
+   * Reads the speed of an edge as a copy that no batch of the writers of this process is half
+   * through. The whole 64 bit record is loaded at once so its fields never come from different
+   * writes, unlike reading them one by one out of the volatile record.
+   * @param directed_edge_offset  the index of the edge in the tile
+   * @return the speed, INVALID_SPEED if there is no traffic for the tile
+   */
+  TrafficSpeed speed(const uint32_t directed_edge_offset) const {
+    if (header == nullptr || header->traffic_tile_version != TRAFFIC_TILE_VERSION) {
+      return load(&INVALID_SPEED);
+    }
+    if (directed_edge_offset >= header->directed_edge_count)
+      throw std::runtime_error("TrafficSpeed requested for edgeid beyond bounds of tile (offset: " +
+                               std::to_string(directed_edge_offset) +
+                               ", edge count: " + std::to_string(header->directed_edge_count));
+
+    const auto& sequence = as_atomic(&header->write_sequence);
+    for (bool retried = false;; retried = true) {
+      const auto before = sequence.load(std::memory_order_acquire);
+      if (!(before & 1)) {
+        auto speed = load(speeds + directed_edge_offset);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+          // counted once per read so spinning readers dont fight over the counter
+          if (retried)
+            read_retries_.fetch_add(1, std::memory_order_relaxed);
+          return speed;
+        }
+      }
+    }
+  }
+
+  /**
+   * Whether any edge of the tile can be closed. Tiles whose closures update() has counted and found
+   * none of can skip reading the speeds of their edges to check for closures.
+   */
+  bool has_closures() const {
+    return header != nullptr && header->traffic_tile_version == TRAFFIC_TILE_VERSION &&
+           (!header->closures_counted || header->closed_edge_count != 0);
+  }
+
+  /**
+   * Applies a batch of live speeds to the tile. Readers going through speed() see either none or
+   * all of them, other writers of the process wait for the batch to finish. The traffic has to be
+   * mapped writable, see the traffic_readonly flag of the GraphReader.
+   * @param updates      the speeds and the edges they are for
+   * @param last_update  seconds since epoch the speeds are from
+   */
+  void update(const std::vector<TrafficSpeedUpdate>& updates, const uint64_t last_update) {
+    if (header == nullptr) {
+      throw std::runtime_error("Cannot update a traffic tile without data");
+    }
+    for (const auto& update : updates) {
+      if (update.directed_edge_offset >= header->directed_edge_count)
+        throw std::runtime_error("TrafficSpeed update for edgeid beyond bounds of tile (offset: " +
+                                 std::to_string(update.directed_edge_offset) +
+                                 ", edge count: " + std::to_string(header->directed_edge_count));
+    }
+
+    // take the tile from other writers by making the sequence odd
+    auto& sequence = as_atomic(&header->write_sequence);
+    auto before = sequence.load(std::memory_order_relaxed);
+    bool waited = false;
+    while ((before & 1) ||
+           !sequence.compare_exchange_weak(before, before + 1, std::memory_order_acquire)) {
+      waited = true;
+      before = sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    if (waited)
+      write_waits_.fetch_add(1, std::memory_order_relaxed);
+
+    // the first batch counts the closures the tile already has, later ones just adjust the count
+    int64_t closed = header->closures_counted ? header->closed_edge_count : 0;
+    if (!header->closures_counted) {
+      for (uint32_t i = 0; i < header->directed_edge_count; ++i)
+        closed += load(speeds + i).closed();
+    }
+
+    for (const auto& update : updates) {
+      auto* speed = speeds + update.directed_edge_offset;
+      closed += int64_t(update.speed.closed()) - int64_t(load(speed).closed());
+      uint64_t raw;
+      std::memcpy(&raw, &update.speed, sizeof(raw));
+      as_atomic(reinterpret_cast<volatile uint64_t*>(speed)).store(raw, std::memory_order_relaxed);
+    }
+    header->closed_edge_count = static_cast<uint32_t>(closed);
+    header->closures_counted = 1;
+    header->last_update = last_update;
+
+    // and hand it back, readers that started during the batch retry
+    sequence.store(before + 2, std::memory_order_release);
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    updates_.fetch_add(updates.size(), std::memory_order_relaxed);
+  }
+
+  // Live traffic counters of the whole process
+  struct Stats {
+    uint64_t batches;      // batches applied by update()
+    uint64_t updates;      // speeds written by those batches
+    uint64_t write_waits;  // times a writer found another one at the same tile
+    uint64_t read_retries; // times speed() read during a batch and had to read again
+  };
+
+  /**
+   * Returns the counters accumulated since the process started.
+   */
+  static Stats stats() {
+    return {batches_.load(std::memory_order_relaxed), updates_.load(std::memory_order_relaxed),
+            write_waits_.load(std::memory_order_relaxed),
+            read_retries_.load(std::memory_order_relaxed)};
+  }
+
   // Returns true if this tile is valid or not
   bool operator()() const {
     return header != nullptr;
   }
 
 private:
+  // the words of the tile are shared with other threads and processes, they are only ever touched
+  // through lock free atomics of the same size
+  template <typename T> static std::atomic<T>& as_atomic(const volatile T* word) {
+    static_assert(sizeof(std::atomic<T>) == sizeof(T) && std::atomic<T>::is_always_lock_free,
+                  "Traffic words must be lock free atomics");
+    return *reinterpret_cast<std::atomic<T>*>(const_cast<T*>(word));
+  }
+
+  static TrafficSpeed load(const volatile TrafficSpeed* speed) {
+    const uint64_t raw = as_atomic(reinterpret_cast<const volatile uint64_t*>(speed))
+                             .load(std::memory_order_relaxed);
+    TrafficSpeed copy;
+    std::memcpy(&copy, &raw, sizeof(copy));
+    return copy;
+  }
+
+  static inline std::atomic<uint64_t> batches_{0};
+  static inline std::atomic<uint64_t> updates_{0};
+  static inline std::atomic<uint64_t> write_waits_{0};
+  static inline std::atomic<uint64_t> read_retries_{0};
+
   std::unique_ptr<const GraphMemory> memory_;
 
 public:
@@ -0,0 +1,148 @@
+#ifndef VALHALLA_BALDR_TURNCLASSES_H_
+#define VALHALLA_BALDR_TURNCLASSES_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include <valhalla/baldr/nodeinfo.h>
+
+namespace valhalla {
+namespace baldr {
+
+class DirectedEdge;
+
+// Turn costs are indexed by the turn type when driving on the right, then by the turn type when
+// driving on the left, then comes the crossing of a road that has edges on both sides
+constexpr uint32_t kTurnCostIndexCount = 17;
+constexpr uint32_t kLeftSideTurnCostIndex = 8;
+constexpr uint32_t kCrossingTurnCostIndex = 16;
+
+// A directed edge has a turn class for every local index an edge can be turned onto it from
+constexpr uint32_t kTurnClassesPerEdge = kMaxLocalEdgeIndex + 1;
+
+/**
+ * The turn from an edge onto a directed edge at the node the directed edge leaves, as far as it
+ * does not depend on the costing options: the turn degree between their headings, which of the
+ * turn costs applies and whether the turn durations of the OSRM car profile count the angle.
+ * Costings look the seconds of the class up in their tables and apply their own factors.
+ */
+class TurnClass {
+public:
+  TurnClass() : turn_degree_(0), cost_index_(0), osrm_turn_(0) {
+  }
+
+  /**
+   * Constructor.
+   * @param  edge  Directed edge turned onto.
+   * @param  node  Node the directed edge leaves, where the turn is made.
+   * @param  idx   Local index of the opposing edge of the edge turned from.
+   */
+  TurnClass(const DirectedEdge* edge, const NodeInfo* node, const uint32_t idx);
+
+  /**
+   * Get the turn degree from the heading into the node to the heading of the directed edge.
+   * @return the turn degree, 0 to 359
+   */
+  uint32_t turn_degree() const {
+    return turn_degree_;
+  }
+
+  /**
+   * Get which turn cost applies, see kTurnCostIndexCount.
+   * @return the index into the turn costs of a costing
+   */
+  uint32_t cost_index() const {
+    return cost_index_;
+  }
+
+  /**
+   * Whether the turn durations of the OSRM car profile count the angle of the turn, which they do
+   * at nodes with more than 2 edges and for u-turns.
+   * @return true if the angle counts
+   */
+  bool osrm_turn() const {
+    return osrm_turn_ != kNoOsrmTurn;
+  }
+
+  /**
+   * Whether the OSRM car profile sees the turn as a u-turn.
+   * @return true if it is a u-turn
+   */
+  bool osrm_u_turn() const {
+    return osrm_turn_ == kOsrmUTurn;
+  }
+
+protected:
+  static constexpr uint16_t kNoOsrmTurn = 0;
+  static constexpr uint16_t kOsrmTurn = 1;
+  static constexpr uint16_t kOsrmUTurn = 2;
+
+  uint16_t turn_degree_ : 9;
+  uint16_t cost_index_ : 5;
+  uint16_t osrm_turn_ : 2;
+};
+
+static_assert(sizeof(TurnClass) == 2, "TurnClass size is unexpected");
+
+/**
+ * The turn classes of the directed edges of a tile, kTurnClassesPerEdge per edge in edge order.
+ * They only depend on the tile, so the array is filled for the whole tile the first time a costing
+ * asks for it and then shared by every request. It is not changed after, so the classes it hands
+ * out stay valid for as long as the tile lives.
+ */
+class TurnClasses {
+public:
+  /**
+   * Constructor.
+   * @param  edge_count  Number of directed edges in the tile.
+   */
+  explicit TurnClasses(const uint32_t edge_count);
+  ~TurnClasses();
+
+  TurnClasses(const TurnClasses&) = delete;
+  TurnClasses& operator=(const TurnClasses&) = delete;
+
+  /**
+   * Get the turn classes, filling them when this is the first time they are asked for. Threads
+   * racing to fill them each compute them and all but one throw theirs away.
+   * @param  fill  Computes the classes of all directed edges of the tile, in edge order.
+   * @return the classes of the directed edges of the tile
+   */
+  template <typename fill_t> const TurnClass* get(const fill_t& fill) const {
+    const TurnClass* classes = classes_.load(std::memory_order_acquire);
+    return classes ? classes : Fill(std::function<void(TurnClass*)>(fill));
+  }
+
+  /**
+   * Number of directed edges there are classes for.
+   */
+  uint32_t edge_count() const {
+    return edge_count_;
+  }
+
+  /**
+   * Bytes the filled array takes up.
+   */
+  size_t memory_usage() const;
+
+  /**
+   * Whether tiles keep the turn classes of their directed edges. This is set by the GraphReader
+   * from mjolnir.turn_classes and applies to the whole process.
+   */
+  static bool enabled();
+  static void set_enabled(const bool enabled);
+
+protected:
+  const TurnClass* Fill(const std::function<void(TurnClass*)>& fill) const;
+
+  uint32_t edge_count_;
+
+  // Filled once and then only read
+  mutable std::atomic<const TurnClass*> classes_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TURNCLASSES_H_
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace loki {
+
+/**
+ * Remembers the sampled elevation profiles of recent height requests so that the same shapes,
+ * popular trails say, are not resampled and sampled again request after request. Profiles are
+ * keyed by the shape or encoded polyline exactly as it was sent along with the resample distance,
+ * and the least recently used are thrown away once the profiles hold more than size postings.
+ * Elevation tiles don't change while a worker runs so profiles don't expire.
+ *
+ * A cache belongs to one worker and is not thread safe.
+ */
+class HeightCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  // the (resampled) shape of a request and the height at each of its points
+  struct Profile {
+    std::vector<midgard::PointLL> shape;
+    std::vector<double> heights;
+    bool resampled;
+  };
+
+  /**
+   * @param config  The loki.height_cache config: size, the postings of all profiles together.
+   */
+  explicit HeightCache(const boost::property_tree::ptree& config);
+
+  /**
+   * The key of a height request, to be made before its shape is resampled
+   * @param options  the options of the height request
+   * @return the key
+   */
+  static std::string make_key(const Options& options);
+
+  /**
+   * Finds the profile of a request and marks it as recently used
+   * @param key  the key of the request
+   * @return the profile, valid until the next insert, or nullptr if there isn't one
+   */
+  const Profile* Find(const std::string& key);
+
+  /**
+   * Remembers the profile of a request, unless it is bigger than the whole cache
+   * @param key      the key of the request
+   * @param profile  its profile
+   */
+  void Insert(std::string key, Profile profile);
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+protected:
+  struct entry_t {
+    std::string key;
+    Profile profile;
+  };
+
+  size_t max_postings_;
+  size_t postings_ = 0;
+
+  // most recently used entries at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+  Stats stats_;
+};
+
+} // namespace loki
+} // namespace valhalla
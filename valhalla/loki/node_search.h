@@ -3,29 +3,36 @@
 
 #include <cstdint>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/thread_pool.h>
 
 namespace valhalla {
 namespace loki {
 
 /**
- * Find nodes within the given bounding box in the route network.
+ * Find nodes within the given bounding box in the route network. The nodes of tiles the box
+ * covers entirely are taken straight from the tiles, the others are found through the edges in
+ * the bins of the tiles the box intersects.
  *
  * @param  bbox   bounding box in which to look for nodes.
  * @param  reader graph reader object to use for loading tiles.
+ * @param  pool   searches the tiles in parallel on the pool when given.
  * @return nodes  a collection of nodes which are in the bounding box.
  */
 std::vector<baldr::GraphId> nodes_in_bbox(const midgard::AABB2<midgard::PointLL>& bbox,
-                                          baldr::GraphReader& reader);
+                                          baldr::GraphReader& reader,
+                                          thread_pool_t* pool = nullptr);
 
 /**
  * Find edges that intersect the given bounding box in the route network.
  *
  * @param  bbox   bounding box in which to look for nodes.
  * @param  reader graph reader object to use for loading tiles.
+ * @param  pool   searches the tiles in parallel on the pool when given.
  * @return edges  a collection of edges which intersect the bounding box.
  */
 std::vector<baldr::GraphId> edges_in_bbox(const midgard::AABB2<midgard::PointLL>& bbox,
-                                          baldr::GraphReader& reader);
+                                          baldr::GraphReader& reader,
+                                          thread_pool_t* pool = nullptr);
 
 } // namespace loki
 } // namespace valhalla
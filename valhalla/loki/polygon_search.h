@@ -13,13 +13,17 @@ namespace loki {
  *
  * @param rings The (optionally closed) rings to intersect edges with
  * @param reader GraphReader instance
+ * @param costing the costing whose disallowed edges are never returned
+ * @param max_length the longest the perimeters of all rings may be together in meters
+ * @param threads how many threads intersect the edges of the rings' bins with the rings
  *
  */
 std::unordered_set<valhalla::baldr::GraphId>
 edges_in_rings(const google::protobuf::RepeatedPtrField<valhalla::Ring>& rings,
                baldr::GraphReader& reader,
                const std::shared_ptr<sif::DynamicCost>& costing,
-               float max_length);
+               float max_length,
+               size_t threads = 1);
 
 } // namespace loki
 } // namespace valhalla
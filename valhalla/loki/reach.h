@@ -55,7 +55,25 @@ public:
                             const std::shared_ptr<sif::DynamicCost>& costing,
                             uint8_t direction = kInbound | kOutbound);
 
+  /**
+   * Whether reach is looked up in the reach section of the tiles, when they have one that goes
+   * far enough, instead of expanding. Only valid when the costing has the default options of its
+   * costing type and there is no live traffic, since that is what the section was computed with.
+   * @param use  whether to use the precomputed reach
+   */
+  void set_use_reach_index(const bool use) {
+    use_reach_index_ = use;
+  }
+
 protected:
+  // the precomputed reach of the edge if the tile has it for the costing and max_reach
+  bool indexed(const baldr::GraphId edge_id,
+               uint32_t max_reach,
+               baldr::GraphReader& reader,
+               const std::shared_ptr<sif::DynamicCost>& costing,
+               uint8_t direction,
+               directed_reach& reach);
+
   // the main method above will do a conservative reach estimate stopping the expansion at any
   // edges which the costing could decide to skip (because of restrictions and possibly more?)
   // when that happens and the maximum reach is not found, this is then validated with a more
@@ -100,6 +118,7 @@ protected:
   std::unordered_set<uint64_t> queue_, done_;
   uint32_t max_reach_{};
   size_t transitions_{};
+  bool use_reach_index_{false};
 };
 
 } // namespace loki
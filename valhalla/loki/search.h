@@ -13,6 +13,14 @@
 namespace valhalla {
 namespace loki {
 
+/**
+ * What a search spent its time on, for the statistics of the request
+ */
+struct SearchStats {
+  double reach_ms = 0;       // time spent finding the reach of candidate edges
+  uint64_t reach_checks = 0; // candidate edges whose reach had to be found
+};
+
 /**
  * Find an location within the route network given an input location
  * same tiled route data and a search strategy
@@ -22,13 +30,18 @@ namespace loki {
  * proper cache
  * @param costing        a costing object by which we can determine which portions of the graph are
  *                       accessible and therefor potential candidates
+ * @param use_reach_index whether reachability can be answered from the precomputed reach of the
+ *                       tiles, see Reach::set_use_reach_index
+ * @param stats          if not null the time spent on reach is added to it
  * @return pathLocations the correlated data with in the tile that matches the inputs. If a
  * projection is not found, it will not have any entry in the returned value.
  */
 std::unordered_map<baldr::Location, baldr::PathLocation>
 Search(const std::vector<baldr::Location>& locations,
        baldr::GraphReader& reader,
-       const std::shared_ptr<sif::DynamicCost>& costing);
+       const std::shared_ptr<sif::DynamicCost>& costing,
+       bool use_reach_index = false,
+       SearchStats* stats = nullptr);
 
 } // namespace loki
 } // namespace valhalla
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/location.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/loki/search.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace loki {
+
+/**
+ * Remembers the correlated path locations of recently searched locations so that origins which
+ * come back request after request (depots, warehouses, stores) skip the candidate search and the
+ * reach check. Entries are keyed by the quantized coordinate, every search parameter of the
+ * location and the costing of the request, and are thrown away when the tile set changes or,
+ * with live traffic, once they are older than max_age since closures may have changed.
+ *
+ * A cache belongs to one worker and is not thread safe.
+ */
+class SnapCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+  };
+
+  /**
+   * @param config  The loki.snap_cache config: size (entries), quantization (degrees), max_age
+   *                (seconds) and tileset_check_interval (seconds).
+   * @param reader  The reader whose tile set and live traffic the entries depend on.
+   */
+  SnapCache(const boost::property_tree::ptree& config, const baldr::GraphReader& reader);
+
+  /**
+   * Same as loki::Search but answers the locations it has seen before from the cache and only
+   * searches the rest.
+   * @param locations    the positions which need to be correlated to the route network
+   * @param reader       object used to access tiled route data
+   * @param costing      the costing used to filter candidates
+   * @param costing_key  identifies the costing and all of its options
+   * @param use_reach_index  whether misses may use the precomputed reach of the tiles
+   * @param stats        if not null the time the search of the misses spent on reach is added to it
+   * @return the correlated locations, locations without a correlation have no entry
+   */
+  std::unordered_map<baldr::Location, baldr::PathLocation>
+  Search(const std::vector<baldr::Location>& locations,
+         baldr::GraphReader& reader,
+         const sif::cost_ptr_t& costing,
+         const std::string& costing_key,
+         bool use_reach_index = false,
+         SearchStats* stats = nullptr);
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  struct entry_t {
+    std::string key;
+    baldr::PathLocation correlated;
+    clock_t::time_point created;
+  };
+
+  std::string make_key(const baldr::Location& location, const std::string& costing_key) const;
+  void check_tileset(baldr::GraphReader& reader, clock_t::time_point now);
+  void clear();
+
+  size_t max_size_;
+  double quantization_;
+  clock_t::duration max_age_;
+  clock_t::duration tileset_check_interval_;
+
+  // most recently used entries at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> index_;
+
+  std::chrono::system_clock::time_point tileset_modified_;
+  clock_t::time_point tileset_checked_;
+  Stats stats_;
+};
+
+} // namespace loki
+} // namespace valhalla
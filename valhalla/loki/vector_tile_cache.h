@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace loki {
+
+/**
+ * Remembers the encoded vector tiles of recent /tile requests, so that a map panning around the
+ * same area doesn't encode the same tiles of the network over and over. Tiles are keyed by their
+ * zoom, column and row, and the least recently used are thrown away once the tiles hold more than
+ * size bytes. The speeds in the tiles come from live traffic, so a tile is only used for max_age
+ * seconds after it was encoded. When the worker moves to another tile set all of them are cleared.
+ *
+ * A cache belongs to one worker and is not thread safe.
+ */
+class VectorTileCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  /**
+   * @param config  The loki.vector_tile_cache config: size, the bytes of all tiles together, and
+   *                max_age, the seconds a tile is used for.
+   */
+  explicit VectorTileCache(const boost::property_tree::ptree& config);
+
+  /**
+   * Finds the encoded tile and marks it as recently used
+   * @param z  zoom level
+   * @param x  column
+   * @param y  row
+   * @return the tile, valid until the next insert, or nullptr if there isn't one or it is too old
+   */
+  const std::string* Find(uint32_t z, uint32_t x, uint32_t y);
+
+  /**
+   * Remembers an encoded tile, unless it is bigger than the whole cache
+   * @param z      zoom level
+   * @param x      column
+   * @param y      row
+   * @param bytes  the encoded tile
+   */
+  void Insert(uint32_t z, uint32_t x, uint32_t y, std::string bytes);
+
+  /**
+   * Forgets all tiles
+   */
+  void Clear();
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  struct entry_t {
+    uint64_t key;
+    std::string bytes;
+    clock_t::time_point encoded;
+  };
+
+  static uint64_t make_key(uint32_t z, uint32_t x, uint32_t y);
+  void Erase(std::list<entry_t>::iterator entry);
+
+  size_t max_bytes_;
+  std::chrono::seconds max_age_;
+  size_t bytes_ = 0;
+
+  // most recently used entries at the front
+  std::list<entry_t> entries_;
+  std::unordered_map<uint64_t, std::list<entry_t>::iterator> index_;
+  Stats stats_;
+};
+
+} // namespace loki
+} // namespace valhalla
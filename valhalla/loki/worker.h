@@ -2,6 +2,8 @@
 #define __VALHALLA_LOKI_SERVICE_H__
 
 #include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -11,6 +13,9 @@
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/loki/height_cache.h>
+#include <valhalla/loki/snap_cache.h>
+#include <valhalla/loki/vector_tile_cache.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/costfactory.h>
@@ -25,6 +30,16 @@ namespace loki {
 void run_service(const boost::property_tree::ptree& config);
 #endif
 
+/**
+ * Estimate how expensive a request will be before any work is done on it, so that the expensive
+ * ones can be kept from taking all the workers of the service. It is the number of paths to find
+ * times the kilometers across the locations, the area for isochrones, times a factor for costings
+ * that expand more of the graph per kilometer.
+ * @param options  the parsed request
+ * @return the estimated cost, only meaningful compared to other estimates
+ */
+double estimate_cost(const Options& options);
+
 class loki_worker_t : public service_worker_t {
 public:
   loki_worker_t(const boost::property_tree::ptree& config,
@@ -39,10 +54,13 @@ public:
   std::string locate(Api& request);
   void route(Api& request);
   void matrix(Api& request);
+  void route_batch(Api& request);
   void isochrones(Api& request);
+  void isochrone_batch(Api& request);
   void trace(Api& request);
   std::string height(Api& request);
   std::string transit_available(Api& request);
+  std::string tile(Api& request);
   void status(Api& request) const;
 
   void set_interrupt(const std::function<void()>* interrupt) override;
@@ -56,19 +74,61 @@ protected:
   void locations_from_shape(Api& request);
   void check_hierarchy_distance(Api& request);
 
+  /**
+   * What the verbose status tells about the tile set, the same for every request until the reader
+   * switches to another tile set. Finding it takes a pass over the whole tile set so it is done
+   * when the worker starts and after it switched tile sets, never while answering a request.
+   */
+  struct tileset_status_t {
+    uint64_t epoch = 0;
+    std::string bbox; // empty without a connectivity map
+    bool has_tiles = false;
+    bool has_admins = false;
+    bool has_timezones = false;
+    bool has_transit_tiles = false;
+    bool has_elevation = false;
+    uint64_t osm_changeset = 0;
+    std::string tileset_version;
+    std::vector<std::pair<uint32_t, uint64_t>> level_tiles; // tiles per hierarchy level
+  };
+  void update_tileset_status();
+
+  /**
+   * Correlate locations to the graph with the costing of the current request, through the snap
+   * cache when it is enabled. The time of the search and of its reach checks is added to the
+   * statistics of the request.
+   */
+  std::unordered_map<baldr::Location, baldr::PathLocation>
+  search(const std::vector<baldr::Location>& locations, Api& request);
+
   void init_locate(Api& request);
   void init_route(Api& request);
   void init_matrix(Api& request);
+  void init_route_batch(Api& request);
   void init_isochrones(Api& request);
   void init_trace(Api& request);
   std::vector<midgard::PointLL> init_height(Api& request);
   void init_transit_available(Api& request);
+  void init_tile(Api& request);
 
   boost::property_tree::ptree config;
   sif::CostFactory factory;
   sif::cost_ptr_t costing;
+  // identifies the costing and its options for the snap cache
+  std::string costing_key;
+  std::shared_ptr<SnapCache> snap_cache;
+  std::shared_ptr<HeightCache> height_cache;
+  std::shared_ptr<VectorTileCache> vector_tile_cache;
+  // the tile set the cached vector tiles were encoded from
+  uint64_t vector_tile_epoch = 0;
+  // whether the current costing can use the reach precomputed by valhalla_build_reach
+  bool use_reach_index = false;
+  // serialized default options of the costings the reach index was computed with
+  std::unordered_map<Costing::Type, std::string> reach_index_options;
   std::shared_ptr<baldr::GraphReader> reader;
   std::shared_ptr<baldr::connectivity_map_t> connectivity_map;
+  // only made when verbose status is allowed
+  std::shared_ptr<const tileset_status_t> tileset_status;
   std::unordered_set<Options::Action> actions;
   std::string action_str;
   std::unordered_map<std::string, size_t> max_locations;
@@ -78,6 +138,7 @@ protected:
   std::unordered_map<std::string, float> max_matrix_locations;
   size_t max_exclude_locations;
   float max_exclude_polygons_length;
+  size_t exclude_polygons_threads;
   unsigned int max_reachability;
   unsigned int default_reachability;
   unsigned int max_radius;
@@ -94,6 +155,7 @@ protected:
   size_t max_contours;
   size_t max_contour_min;
   size_t max_contour_km;
+  size_t max_batch_isochrones;
   size_t max_trace_shape;
   float max_gps_accuracy;
   float max_search_radius;
@@ -104,6 +166,8 @@ protected:
   float min_resample;
   unsigned int max_alternates;
   bool allow_verbose;
+  uint32_t min_tile_zoom;
+  uint32_t max_tile_zoom;
 
   // add max_distance_disable_hierarchy_culling
   float max_distance_disable_hierarchy_culling;
@@ -112,6 +176,9 @@ private:
   std::string service_name() const override {
     return "loki";
   }
+  const baldr::GraphReader* tile_reader() const override {
+    return reader.get();
+  }
 };
 } // namespace loki
 } // namespace valhalla
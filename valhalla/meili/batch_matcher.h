@@ -0,0 +1,176 @@
+// -*- mode: c++ -*-
+#ifndef MMP_BATCH_MATCHER_H_
+#define MMP_BATCH_MATCHER_H_
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/traffictile.h>
+#include <valhalla/meili/map_matcher_factory.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+namespace meili {
+
+// Status of a trace that matched, otherwise it is the code of the error it failed with
+constexpr uint32_t kBatchMatched = 0;
+// Status of a trace that failed with something other than a valhalla error
+constexpr uint32_t kBatchUnknownError = 999;
+
+/**
+ * Throughput of a batch.
+ */
+struct BatchStats {
+  uint64_t traces = 0;  // Traces read
+  uint64_t points = 0;  // Measurements of the traces that could be parsed
+  uint64_t matched = 0; // Traces that matched
+  double seconds = 0;   // Wall time of the batch
+
+  double traces_per_second() const {
+    return seconds > 0 ? traces / seconds : 0;
+  }
+
+  double points_per_second() const {
+    return seconds > 0 ? points / seconds : 0;
+  }
+};
+
+/**
+ * How fast a trace went over one edge of its best path, or over the part of the edge the path
+ * covers where it starts or ends on it. Entering and leaving are interpolated along the path
+ * between the timed measurements around the edge.
+ */
+struct SpeedObservation {
+  uint64_t edge;     // directed edge id
+  double entry_time; // seconds from epoch the covered part of the edge was entered
+  double exit_time;  // seconds from epoch it was left
+  float length;      // meters of the edge that were covered
+  float coverage;    // fraction of the edge that was covered
+
+  float speed_kph() const {
+    return exit_time > entry_time ? length / (exit_time - entry_time) * 3.6f : 0.f;
+  }
+};
+static_assert(sizeof(SpeedObservation) == 32, "SpeedObservation is written as it is");
+
+/**
+ * The matched edges of one trace as they are written to the output of a batch. Records are
+ * written in the order of the input as the index (uint64_t), the status (uint32_t), the number
+ * of entries (uint32_t) and the entries, in native byte order. With BatchMatcher::Output::kEdges
+ * the entries are the edge ids (uint64_t each) of the best path, with Output::kSpeeds they are
+ * the SpeedObservations of the path.
+ */
+struct BatchRecord {
+  uint64_t index;
+  uint32_t status;
+  std::vector<uint64_t> edges;
+  std::vector<SpeedObservation> speeds;
+};
+
+/**
+ * Interpolates when the best path of a trace entered and left each of its edges. Only the
+ * measurements with a time are used and an edge is only observed if there is one at or before it
+ * and one at or after it, with no discontinuity of the path in between.
+ * @param match   The best path of the trace.
+ * @param reader  Graph reader for the lengths of the edges.
+ * @return the observations in path order
+ */
+std::vector<SpeedObservation> ObserveSpeeds(const MatchResults& match, baldr::GraphReader& reader);
+
+/**
+ * Averages speed observations into live traffic speeds, by tile, for
+ * baldr::GraphReader::UpdateLiveTraffic. The speed of an edge is the space mean speed, covered
+ * length over time taken, of the observations that covered at least min_coverage of it. Edges
+ * without such an observation get no update.
+ * @param observations  The observations of any number of traces.
+ * @param min_coverage  Observations covering less of their edge are ignored.
+ * @return the updates keyed by the id of their tile
+ */
+std::unordered_map<baldr::GraphId, std::vector<baldr::TrafficSpeedUpdate>>
+TrafficUpdates(const std::vector<SpeedObservation>& observations, float min_coverage = 0.5f);
+
+/**
+ * Matches streams of traces for offline re-matching. Every thread owns a MapMatcherFactory so a
+ * reader and a candidate grid, configure a global tile cache for them to share their tiles. The
+ * input is read a chunk of meili.batch.chunk_size traces at a time, the chunk is matched on
+ * meili.batch.threads threads and the records of the chunk are written before the next one is
+ * read, so memory does not grow with the size of the input.
+ *
+ * Traces are either newline delimited trace_attributes json requests or pbf, one uint32_t length
+ * in native byte order followed by that many bytes of a serialized Api per trace. Consecutive
+ * traces of a thread with the same costing and matcher options reuse its MapMatcher.
+ */
+class BatchMatcher final {
+public:
+  enum class Format { kJson, kPbf };
+  enum class Output { kEdges, kSpeeds };
+
+  /**
+   * @param root    The whole config, meili.batch holds threads and chunk_size, mjolnir configures
+   *                the readers of the threads.
+   * @param output  What the records hold, the edges or the speed observations of the best paths.
+   */
+  BatchMatcher(const boost::property_tree::ptree& root, Output output = Output::kEdges);
+
+  ~BatchMatcher();
+
+  /**
+   * Match all the traces of a stream.
+   * @param traces     The traces in the given format.
+   * @param records    Where the records of the traces are written.
+   * @param format     The format of the traces.
+   * @param interrupt  Called between chunks, throws to abort the batch.
+   * @return the throughput of the batch
+   */
+  BatchStats Match(std::istream& traces,
+                   std::ostream& records,
+                   Format format = Format::kJson,
+                   const std::function<void()>* interrupt = nullptr);
+
+  size_t concurrency() const {
+    return factories_.size();
+  }
+
+  /**
+   * Append a record to the bytes of a batch.
+   * @param output  What the records of the batch hold.
+   */
+  static void
+  WriteRecord(std::string& bytes, const BatchRecord& record, Output output = Output::kEdges);
+
+  /**
+   * Read the next record of a batch.
+   * @param output  What the records of the batch hold.
+   * @return false when there are no more records
+   */
+  static bool
+  ReadRecord(std::istream& records, BatchRecord& record, Output output = Output::kEdges);
+
+private:
+  // A matcher a thread keeps for as long as its traces ask for the same one
+  struct PooledMatcher {
+    std::string key;
+    std::unique_ptr<MapMatcher> matcher;
+  };
+
+  BatchRecord MatchTrace(size_t thread, uint64_t index, Api& api, uint64_t& points);
+
+  std::vector<std::unique_ptr<MapMatcherFactory>> factories_;
+  std::vector<PooledMatcher> matchers_;
+  size_t chunk_size_;
+  Output output_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_BATCH_MATCHER_H_
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <cmath>
 #include <tuple>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -34,6 +36,14 @@ public:
                                                  const sif::cost_ptr_t& costing = nullptr) const = 0;
 };
 
+/**
+ * Finds the candidate edges around a measurement in grids of the edge shapes, one grid per bin of
+ * a graph tile. The query keeps a window on the cells of the grids the last query covered and the
+ * edges in them. The next query only adds the cells it covers that the last one didn't and drops
+ * the ones it no longer covers, so consecutive measurements of a trace, which cover nearly the same
+ * cells, reuse most of the window. The edges of the window keep their opposing edges, decoded
+ * shapes and whether the costing allows them, a query only projects the measurement onto them.
+ */
 class CandidateGridQuery final : public CandidateQuery {
 public:
   using grid_t = GridRangeQuery<baldr::GraphId, midgard::PointLL>;
@@ -70,9 +80,38 @@ public:
 
   void Clear() {
     grid_cache_.clear();
+    window_cells_.clear();
+    window_edges_.clear();
+  }
+
+  // Number of edges in the window of the last query
+  size_t window_size() const {
+    return window_edges_.size();
   }
 
 private:
+  // An edge in the window and what its candidates need that doesn't depend on the measurement
+  struct WindowEdge {
+    uint32_t cells = 0;      // times the edge is indexed in the cells of the window
+    bool resolved = false;   // whether the rest has been looked up
+    bool usable = false;     // whether the edge can be a candidate at all
+    uint32_t allowed_by = 0; // the costing the allowed flags are for
+    bool edge_allowed = false;
+    bool opp_edge_allowed = false;
+    const baldr::DirectedEdge* edge = nullptr;
+    const baldr::DirectedEdge* opp_edge = nullptr;
+    baldr::GraphId opp_edgeid;
+    graph_tile_ptr tile;
+    graph_tile_ptr opp_tile;
+    std::vector<midgard::PointLL> shape;
+  };
+
+  // Moves the window onto the cells that intersect with the range
+  void MoveWindow(const midgard::AABB2<midgard::PointLL>& range) const;
+
+  // Looks up what the edge needs unless that was done already, false if it can't be a candidate
+  bool Resolve(const baldr::GraphId& edgeid, WindowEdge& window_edge) const;
+
   // Get a grid for a specified bin within a tile. Tile support for
   // graph tiles and bins is provided to go between bin Ids and tile Ids.
   const grid_t* GetGrid(const int32_t bin_id,
@@ -89,6 +128,16 @@ private:
   // Grid cache - cached per "bin" within a graph tile
   mutable std::unordered_map<int32_t, grid_t> grid_cache_;
 
+  // The cells of the window sorted by their bin and square, the cells of the next window and
+  // the edges in the window
+  mutable std::vector<uint64_t> window_cells_;
+  mutable std::vector<uint64_t> next_cells_;
+  mutable std::unordered_map<baldr::GraphId, WindowEdge> window_edges_;
+
+  // The costing of the last query and a count of the costings queried with so far
+  mutable sif::cost_ptr_t window_costing_;
+  mutable uint32_t window_costings_ = 0;
+
   baldr::GraphReader& reader_;
 };
 
@@ -66,10 +66,34 @@ struct Config {
     void Read(const boost::property_tree::ptree& params);
   };
 
+  struct Viterbi {
+    // most candidates per measurement the search goes on from, 0 for all of them
+    uint32_t beam_width = 0;
+    // define if 'beam_width' option can be reassigned with user request
+    bool is_beam_width_customizable = true;
+    // most accumulated cost a candidate may have over the best one of its measurement, 0 for any
+    float beam_cost_gap = 0.f;
+    // define if 'beam_cost_gap' option can be reassigned with user request
+    bool is_beam_cost_gap_customizable = true;
+
+    void Read(const boost::property_tree::ptree& params);
+  };
+
+  struct Session {
+    // measurements this far behind the newest one of a match session are finalized
+    size_t finalize_lag = 5;
+    // most measurements a match session searches over before it prunes the finalized ones
+    size_t max_window = 200;
+
+    void Read(const boost::property_tree::ptree& params);
+  };
+
   CandidateSearch candidate_search{};
   TransitionCost transition_cost{};
   EmissionCost emission_cost{};
   Routing routing{};
+  Viterbi viterbi{};
+  Session session{};
 };
 
 } // namespace meili
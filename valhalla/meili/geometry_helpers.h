@@ -21,6 +21,12 @@ Project(const midgard::projector_t& p,
         midgard::Shape7Decoder<midgard::PointLL>& shape,
         double snap_distance = 0.0);
 
+// the same for a shape that was decoded already
+std::tuple<midgard::PointLL, double, typename std::vector<midgard::PointLL>::size_type, double>
+Project(const midgard::projector_t& p,
+        const std::vector<midgard::PointLL>& shape,
+        double snap_distance = 0.0);
+
 } // namespace helpers
 } // namespace meili
 } // namespace valhalla
@@ -87,8 +87,8 @@ public:
     AddLineSegment(item, segment.a(), segment.b());
   }
 
-  // Query all items that intersects with the range
-  std::unordered_set<item_t> Query(const midgard::AABB2<coord_t>& range) const {
+  // The squares that intersect with the range as mincol, minrow, maxcol, maxrow
+  std::tuple<int, int, int, int> SquareRange(const midgard::AABB2<coord_t>& range) const {
     int mincol, minrow, maxcol, maxrow;
     std::tie(mincol, minrow) = grid_.SquareAtPoint(range.minpt());
     std::tie(maxcol, maxrow) = grid_.SquareAtPoint(range.maxpt());
@@ -98,6 +98,13 @@ public:
     maxcol = std::max(0, std::min(maxcol, ncols_ - 1));
     minrow = std::max(0, std::min(minrow, nrows_ - 1));
     maxrow = std::max(0, std::min(maxrow, nrows_ - 1));
+    return std::make_tuple(mincol, minrow, maxcol, maxrow);
+  }
+
+  // Query all items that intersects with the range
+  std::unordered_set<item_t> Query(const midgard::AABB2<coord_t>& range) const {
+    int mincol, minrow, maxcol, maxrow;
+    std::tie(mincol, minrow, maxcol, maxrow) = SquareRange(range);
 
     std::unordered_set<item_t> items;
 
@@ -69,6 +69,25 @@ public:
   std::vector<MatchResults> OfflineMatch(const std::vector<Measurement>& measurements,
                                          uint32_t k = 1);
 
+  /**
+   * Append a measurement as the newest column of an online match, the search only expands the
+   * columns that were appended since the last search. Clear() starts a new online match.
+   * @param measurement  The measurement to match.
+   * @param pinned_edge  When valid only candidates on this edge are kept, unless there are none,
+   *                     used to resume a match from a measurement that was already matched.
+   * @return the time of the measurement within the match
+   */
+  StateId::Time AppendOnline(const Measurement& measurement,
+                             const baldr::GraphId& pinned_edge = baldr::GraphId());
+
+  /**
+   * Get the match results of the best path that ends at the newest measurement of the online match.
+   * @param begin  The time of the first result.
+   * @param end    One past the time of the last result.
+   * @return one result per time, results of times without a state are unmatched
+   */
+  std::vector<MatchResult> OnlineResults(StateId::Time begin, StateId::Time end);
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
@@ -82,7 +101,9 @@ private:
   std::unordered_map<StateId::Time, std::vector<Measurement>>
   AppendMeasurements(const std::vector<Measurement>& measurements);
 
-  StateId::Time AppendMeasurement(const Measurement& measurement, const float sq_max_search_radius);
+  StateId::Time AppendMeasurement(const Measurement& measurement,
+                                  const float sq_max_search_radius,
+                                  const baldr::GraphId& pinned_edge = baldr::GraphId());
 
   void RemoveRedundancies(const std::vector<StateId>& result,
                           const std::vector<MatchResult>& results);
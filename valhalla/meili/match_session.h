@@ -0,0 +1,93 @@
+// -*- mode: c++ -*-
+#ifndef MMP_MATCH_SESSION_H_
+#define MMP_MATCH_SESSION_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <valhalla/meili/map_matcher.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/meili/measurement.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Matches a trace as it comes in rather than all at once. Every pushed measurement becomes a
+ * column of the online search of the matcher so a push only expands the new columns. Results
+ * are finalized once they are session.finalize_lag measurements behind the newest one, after
+ * that the best path may no longer change them. When the matcher holds session.max_window
+ * measurements the finalized ones are pruned and the match resumes from the last finalized
+ * measurement, pinned to the edge it was matched to, which bounds the memory of the session.
+ *
+ * Unlike OfflineMatch measurements are not interpolated, each of them gets its own column, and
+ * the results carry no score.
+ */
+class MatchSession final {
+public:
+  /**
+   * @param matcher  The matcher of the session, the session takes ownership of it.
+   */
+  explicit MatchSession(MapMatcher* matcher);
+
+  ~MatchSession();
+
+  /**
+   * Push the next measurements of the trace.
+   * @param measurements  The measurements in the order they were taken.
+   * @return the results that were finalized by this push and the segments of the path through
+   *         them, match indices count from the first measurement of the session. The first
+   *         segment may continue the last segment returned by the previous push.
+   */
+  MatchResults Push(const std::vector<Measurement>& measurements);
+
+  /**
+   * Finalize all the remaining results, the session is reset to match a new trace after this.
+   * @return the same as Push
+   */
+  MatchResults Finish();
+
+  // Measurements pushed since the session began
+  size_t pushed() const {
+    return window_begin_ + window_.size();
+  }
+
+  // Measurements whose results were returned
+  size_t finalized() const {
+    return finalized_;
+  }
+
+  // Measurements the matcher currently holds
+  size_t window() const {
+    return window_.size();
+  }
+
+  const MapMatcher& matcher() const {
+    return *matcher_;
+  }
+
+private:
+  void Finalize(size_t end, std::vector<MatchResult>& results, std::vector<EdgeSegment>& segments);
+
+  void Prune();
+
+  std::unique_ptr<MapMatcher> matcher_;
+
+  // The measurements in the matcher, the first one is at time 0
+  std::vector<Measurement> window_;
+
+  // Session index of the first measurement in the matcher
+  size_t window_begin_;
+
+  size_t finalized_;
+
+  // The last finalized result if it was matched, the path of the next results continues from it
+  MatchResult anchor_;
+  bool has_anchor_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_MATCH_SESSION_H_
@@ -0,0 +1,109 @@
+// -*- mode: c++ -*-
+#ifndef MMP_OPENLR_MATCHER_H_
+#define MMP_OPENLR_MATCHER_H_
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/openlr.h>
+#include <valhalla/meili/batch_matcher.h>
+#include <valhalla/meili/map_matcher.h>
+#include <valhalla/meili/map_matcher_factory.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Throughput of a bulk OpenLR decode or encode.
+ */
+struct OpenLrStats {
+  uint64_t references = 0; // References, or edge lists, read
+  uint64_t converted = 0;  // Those that could be decoded, or encoded
+  double seconds = 0;      // Wall time of the bulk
+
+  double references_per_second() const {
+    return seconds > 0 ? references / seconds : 0;
+  }
+};
+
+/**
+ * Decodes an OpenLR line reference into the edges it runs over. The location reference points
+ * are matched as a trace, so the path between consecutive points is the one the matcher routes,
+ * and the offsets then drop the edges before the positive and after the negative offset. Only
+ * the positions of the points are matched, their bearings and road classes are not scored, but
+ * a path much longer or shorter than the distances of the reference is rejected.
+ * @param reference      The line reference.
+ * @param matcher        The matcher of the costing the reference is decoded for.
+ * @param search_radius  How far from each point its candidates are searched in meters.
+ * @return the edge ids of the location in path order
+ */
+std::vector<uint64_t> DecodeOpenLr(const baldr::OpenLR::OpenLr& reference,
+                                   MapMatcher& matcher,
+                                   float search_radius);
+
+/**
+ * Encodes a path of whole edges into an OpenLR line reference. There is a point where the path
+ * starts, where it ends and where it would otherwise exceed the longest distance a point can
+ * give to the next one, always at the start of an edge. Edges longer than that distance can't
+ * be encoded this way.
+ * @param edges   The edge ids of the path in path order.
+ * @param reader  Graph reader for the edges and their shapes.
+ * @return the reference without offsets
+ */
+baldr::OpenLR::OpenLr EncodeOpenLr(const std::vector<uint64_t>& edges, baldr::GraphReader& reader);
+
+/**
+ * Decodes and encodes streams of OpenLR references in bulk, on meili.openlr.threads threads that
+ * each own a MapMatcherFactory and a matcher for the meili.openlr.costing. Like the BatchMatcher
+ * the input is read, converted and written a chunk of meili.openlr.chunk_size at a time.
+ *
+ * References are newline delimited and base64 encoded. Decoding writes a BatchRecord of edges per
+ * reference line, in the format of BatchMatcher::Output::kEdges, and encoding reads such records
+ * and writes a reference line for each, which is empty if the record could not be encoded.
+ */
+class OpenLrMatcher final {
+public:
+  /**
+   * @param root  The whole config, meili.openlr holds threads, chunk_size, costing, search_radius
+   *              and breakage_distance, mjolnir configures the readers of the threads.
+   */
+  explicit OpenLrMatcher(const boost::property_tree::ptree& root);
+
+  ~OpenLrMatcher();
+
+  /**
+   * Decode all the references of a stream.
+   * @param references  The base64 references, one per line.
+   * @param records     Where the edge records of the references are written.
+   * @return the throughput of the bulk
+   */
+  OpenLrStats Decode(std::istream& references, std::ostream& records);
+
+  /**
+   * Encode all the edge records of a stream.
+   * @param records     The edge records, records that did not match are written as empty lines.
+   * @param references  Where the base64 references are written, one per line.
+   * @return the throughput of the bulk
+   */
+  OpenLrStats Encode(std::istream& records, std::ostream& references);
+
+  size_t concurrency() const {
+    return factories_.size();
+  }
+
+private:
+  std::vector<std::unique_ptr<MapMatcherFactory>> factories_;
+  std::vector<std::unique_ptr<MapMatcher>> matchers_;
+  size_t chunk_size_;
+  float search_radius_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_OPENLR_MATCHER_H_
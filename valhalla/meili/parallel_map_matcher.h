@@ -0,0 +1,109 @@
+// -*- mode: c++ -*-
+#ifndef MMP_PARALLEL_MAP_MATCHER_H_
+#define MMP_PARALLEL_MAP_MATCHER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/meili/map_matcher_factory.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/meili/measurement.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Matches long traces by cutting them into windows which are matched on a pool of threads and
+ * stitched back together. Traces are first cut wherever consecutive measurements are further
+ * apart than the breakage distance, which is a discontinuity for the sequential matcher anyway,
+ * and the pieces longer than the window size are cut into windows which overlap by the window
+ * overlap. Within an overlap the windows are joined at the measurement closest to its middle
+ * which both windows matched to the same edge, failing that they are joined with a
+ * discontinuity in the middle of the overlap.
+ *
+ * Each thread owns a MapMatcherFactory, so a GraphReader and a CandidateGridQuery, which means
+ * the candidate lookups of the windows run in parallel as well. Configure a global tile cache
+ * for the readers to share their tiles. Only the best path is computed, state ids of the results
+ * are relative to the window that matched them and the score is the sum of the window scores.
+ */
+class ParallelMapMatcher final {
+public:
+  /**
+   * @param root  The whole config, meili.parallel holds threads, window_size (measurements) and
+   *              window_overlap (measurements), mjolnir configures the readers of the threads.
+   */
+  ParallelMapMatcher(const boost::property_tree::ptree& root);
+
+  ~ParallelMapMatcher();
+
+  /**
+   * Match the measurements.
+   * @param options       The request options, the costing and matcher overrides are used.
+   * @param measurements  The trace.
+   * @return the best path, one result per measurement
+   */
+  MatchResults Match(const Options& options, const std::vector<Measurement>& measurements);
+
+  size_t concurrency() const {
+    return factories_.size();
+  }
+
+  size_t window_size() const {
+    return window_size_;
+  }
+
+  size_t window_overlap() const {
+    return window_overlap_;
+  }
+
+  /**
+   * Trims the tile and candidate caches of the threads that are over their limits.
+   */
+  void ClearFullCache();
+
+  // A range of measurements matched by one matcher
+  struct Window {
+    size_t begin;
+    size_t end;
+    // whether the window overlaps the previous one rather than starting after a breakage
+    bool overlaps;
+  };
+
+  /**
+   * Cut the measurements into windows.
+   * @param measurements       The trace.
+   * @param breakage_distance  Measurements further apart than this (meters) start a new piece.
+   * @param window_size        The most measurements in a window.
+   * @param window_overlap     Measurements shared by consecutive windows of a piece.
+   * @return the windows in order
+   */
+  static std::vector<Window> Windows(const std::vector<Measurement>& measurements,
+                                     float breakage_distance,
+                                     size_t window_size,
+                                     size_t window_overlap);
+
+  /**
+   * Append the match of a window to the stitched match.
+   * @param results   Results so far, one per measurement up to the end of the previous window.
+   * @param segments  Segments so far, their match indices refer to the whole trace.
+   * @param window    The window that was matched.
+   * @param match     The match of the window, its match indices refer to the window.
+   */
+  static void Stitch(std::vector<MatchResult>& results,
+                     std::vector<EdgeSegment>& segments,
+                     const Window& window,
+                     const MatchResults& match);
+
+private:
+  std::vector<std::unique_ptr<MapMatcherFactory>> factories_;
+  size_t window_size_;
+  size_t window_overlap_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_PARALLEL_MAP_MATCHER_H_
@@ -4,6 +4,8 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
@@ -168,6 +170,11 @@ class LabelSet {
 public:
   LabelSet(const float max_cost, const float bucket_size = 1.0f);
 
+  /**
+   * Empties the set for another route, keeping the memory of its labels and queue.
+   */
+  void reuse(const float max_cost, const float bucket_size = 1.0f);
+
   /**
    * Add an origin label using a destination index.
    */
@@ -272,6 +279,57 @@ private:
 
 using labelset_ptr_t = std::shared_ptr<LabelSet>;
 
+/**
+ * What expanding a directed edge needs to know about it that does not depend on the path that
+ * reached it.
+ */
+struct EdgeExpansion {
+  midgard::PointLL end_ll;   // Location of the end node, invalid if its tile is missing
+  float secs;                // Seconds to traverse the whole edge
+  uint16_t outbound_heading; // Heading leaving the start node
+  uint16_t inbound_heading;  // Heading arriving at the end node from the shape, if computed
+};
+
+/**
+ * Caches the expansion of directed edges within a match. The routes between consecutive columns
+ * of a trace run over largely the same edges, so each edge only needs to be costed and have its
+ * end node and headings looked up once per match. The cache must be cleared when the costing or
+ * the tiles change.
+ */
+class ExpansionCache {
+public:
+  ExpansionCache();
+  ~ExpansionCache();
+
+  /**
+   * Get the expansion of an edge.
+   * @param edgeid     The directed edge.
+   * @param expansion  Set to the cached expansion if there is one.
+   * @return true if the edge was cached
+   */
+  bool find(const baldr::GraphId& edgeid, EdgeExpansion& expansion) const;
+
+  /**
+   * Cache the expansion of an edge.
+   */
+  void insert(const baldr::GraphId& edgeid, const EdgeExpansion& expansion);
+
+  /**
+   * Remember the inbound heading of an edge that is already cached.
+   */
+  void set_inbound_heading(const baldr::GraphId& edgeid, uint16_t heading);
+
+  void clear();
+
+  size_t size() const;
+
+private:
+  struct Edges;
+  std::unique_ptr<Edges> edges_;
+};
+
+constexpr uint16_t kUnknownHeading = std::numeric_limits<uint16_t>::max();
+
 /**
  * Find the shortest paths between an origin and a set of destinations.
  * @param reader            a graph reader for tile access
@@ -288,6 +346,7 @@ using labelset_ptr_t = std::shared_ptr<LabelSet>;
  * @param turn_cost_table   array of turn costs based on turn angle
  * @param max_dist          how far to allow the expansion to run
  * @param max_time          how long to allow the expansion to run
+ * @param cache             optional cache of the edges expanded by earlier searches of the match
  * @return a map of destination index to label index so that you can recover a path for any
  * destination
  */
@@ -302,7 +361,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const Label* edgelabel,
                    const float turn_cost_table[181],
                    const float max_dist,
-                   const float max_time);
+                   const float max_time,
+                   ExpansionCache* cache = nullptr);
 
 // Route path iterator. Methods to assist recovering route paths from Labels.
 class RoutePathIterator {
@@ -18,7 +18,8 @@ namespace meili {
 class State {
 public:
   State(const StateId& stateid, const baldr::PathLocation& candidate)
-      : stateid_(stateid), candidate_(candidate), labelset_(nullptr), label_idx_() {
+      : stateid_(stateid), candidate_(candidate), labelset_(nullptr), routed_time_(kInvalidTime),
+        label_idx_() {
   }
 
   const StateId& stateid() const {
@@ -40,14 +41,18 @@ public:
       throw std::runtime_error("expect valid labelset but got nullptr");
     }
 
-    // Cache results
+    // Cache results, the states routed to are the ones of the next column so their ids index them
     label_idx_.clear();
+    routed_time_ = stateids.empty() ? kInvalidTime : stateids.front().time();
     uint16_t dest = 1; // dest at 0 is reserved for the origin
     [[maybe_unused]] uint16_t found = 0;
     for (const auto& stateid : stateids) {
       const auto it = results.find(dest);
       if (it != results.end()) {
-        label_idx_[stateid] = it->second;
+        if (label_idx_.size() <= stateid.id()) {
+          label_idx_.resize(stateid.id() + 1, baldr::kInvalidLabel);
+        }
+        label_idx_[stateid.id()] = it->second;
         ++found;
       }
       ++dest;
@@ -57,17 +62,14 @@ public:
   }
 
   const Label* last_label(const State& state) const {
-    const auto it = label_idx_.find(state.stateid());
-    if (it != label_idx_.end()) {
-      return &labelset_->label(it->second);
-    }
-    return nullptr;
+    const auto idx = label_idx(state.stateid());
+    return idx != baldr::kInvalidLabel ? &labelset_->label(idx) : nullptr;
   }
 
   RoutePathIterator RouteBegin(const State& state) const {
-    const auto it = label_idx_.find(state.stateid());
-    if (it != label_idx_.end()) {
-      return RoutePathIterator(labelset_.get(), it->second);
+    const auto idx = label_idx(state.stateid());
+    if (idx != baldr::kInvalidLabel) {
+      return RoutePathIterator(labelset_.get(), idx);
     }
     return RoutePathIterator(labelset_.get());
   }
@@ -77,31 +79,75 @@ public:
   }
 
 private:
+  uint32_t label_idx(const StateId& stateid) const {
+    return stateid.time() == routed_time_ && stateid.id() < label_idx_.size()
+               ? label_idx_[stateid.id()]
+               : baldr::kInvalidLabel;
+  }
+
   StateId stateid_;
 
   baldr::PathLocation candidate_;
 
   mutable std::shared_ptr<LabelSet> labelset_;
 
-  mutable std::unordered_map<StateId, uint32_t> label_idx_;
+  // The column the route went to and the label of each of its states by id
+  mutable StateId::Time routed_time_;
+  mutable std::vector<uint32_t> label_idx_;
 };
 
+/**
+ * The measurements of a match and the candidate states of each. The states of all the columns
+ * are kept back to back in one vector, which keeps its memory when the container is cleared for
+ * the next match. Appending a state may move the others, don't hold on to them while appending.
+ */
 class StateContainer {
-private:
-  using Column = std::vector<State>;
-
 public:
-  StateContainer() : measurements_(), leave_times_(), columns_() {
+  // The states of one measurement
+  class Column {
+  public:
+    using const_iterator = std::vector<State>::const_iterator;
+
+    Column(const_iterator begin, const_iterator end) : begin_(begin), end_(end) {
+    }
+
+    const_iterator begin() const {
+      return begin_;
+    }
+
+    const_iterator end() const {
+      return end_;
+    }
+
+    size_t size() const {
+      return end_ - begin_;
+    }
+
+    bool empty() const {
+      return begin_ == end_;
+    }
+
+    const State& operator[](const size_t id) const {
+      return *(begin_ + id);
+    }
+
+  private:
+    const_iterator begin_;
+    const_iterator end_;
+  };
+
+  StateContainer() : measurements_(), leave_times_(), states_(), column_offsets_() {
   }
 
   void Clear() {
     measurements_.clear();
     leave_times_.clear();
-    columns_.clear();
+    states_.clear();
+    column_offsets_.clear();
   }
 
   const State& state(const StateId& stateid) const {
-    return columns_[stateid.time()][stateid.id()];
+    return states_[column_offsets_[stateid.time()] + stateid.id()];
   }
 
   const Measurement& measurement(const StateId::Time& time) const {
@@ -116,22 +162,19 @@ public:
     leave_times_[time] = leave_time;
   }
 
-  const Column& column(const StateId::Time& time) const {
-    return columns_[time];
+  Column column(const StateId::Time& time) const {
+    const auto end = time + 1 < column_offsets_.size() ? column_offsets_[time + 1] : states_.size();
+    return Column(states_.cbegin() + column_offsets_[time], states_.cbegin() + end);
   }
 
   StateId::Time size() const {
-    return static_cast<StateId::Time>(columns_.size());
+    return static_cast<StateId::Time>(column_offsets_.size());
   }
 
   // Check to see if we have the minimum number of measurements and edge candidates to perform a map
   // match. We need at least one measurements with a non-zero number of edge candidates.
   bool HasMinimumCandidates() {
-    if (size() < 2) {
-      return false;
-    }
-    return std::find_if(columns_.begin(), columns_.end(),
-                        [](Column& col) { return col.size() > 0; }) != columns_.end();
+    return size() >= 2 && !states_.empty();
   }
 
   std::string geojson(const StateId& s) const {
@@ -153,7 +196,9 @@ public:
   }
 
   StateId NewStateId() const {
-    return columns_.empty() ? StateId() : StateId(columns_.size() - 1, columns_.back().size());
+    return column_offsets_.empty()
+               ? StateId()
+               : StateId(column_offsets_.size() - 1, states_.size() - column_offsets_.back());
   }
 
   StateId::Time AppendMeasurement(const Measurement& measurement) {
@@ -161,7 +206,7 @@ public:
 
     measurements_.push_back(measurement);
     leave_times_.push_back(measurement.epoch_time());
-    columns_.emplace_back();
+    column_offsets_.push_back(states_.size());
 
     return time;
   }
@@ -173,11 +218,11 @@ public:
   }
 
   void AppendState(const State& state) {
-    if (columns_.empty()) {
+    if (column_offsets_.empty()) {
       throw std::runtime_error("add measurement first");
     }
-    const auto expected_time = columns_.size() - 1;
-    const auto expected_id = columns_.back().size();
+    const auto expected_time = column_offsets_.size() - 1;
+    const auto expected_id = states_.size() - column_offsets_.back();
     if (state.stateid() != StateId(expected_time, expected_id)) {
       throw std::runtime_error("state's stateid should be " + std::to_string(expected_time) + "/" +
                                std::to_string(expected_id) + " but got " +
@@ -185,7 +230,7 @@ public:
                                std::to_string(state.stateid().id()));
     }
 
-    columns_.back().push_back(state);
+    states_.push_back(state);
   }
 
 private:
@@ -193,7 +238,10 @@ private:
 
   std::vector<double> leave_times_;
 
-  std::vector<Column> columns_;
+  std::vector<State> states_;
+
+  // Where the states of each column start
+  std::vector<uint32_t> column_offsets_;
 };
 
 } // namespace meili
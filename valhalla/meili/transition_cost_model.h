@@ -2,10 +2,12 @@
 #define MMP_TRANSITION_COST_MODEL_H_
 
 #include <functional>
+#include <memory>
 
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/meili/config.h>
 #include <valhalla/meili/measurement.h>
+#include <valhalla/meili/routing.h>
 #include <valhalla/meili/state.h>
 #include <valhalla/meili/topk_search.h>
 #include <valhalla/meili/viterbi_search.h>
@@ -51,6 +53,19 @@ public:
 
   float operator()(const StateId& lhs, const StateId& rhs) const;
 
+  /**
+   * Forget the edges expanded by the routes of the last match and hand their label sets to the
+   * routes of the next one. Copies of the model share the cache and the label sets.
+   */
+  void ClearCache() const {
+    expansion_cache_->clear();
+    labelsets_->used = 0;
+  }
+
+  const ExpansionCache& expansion_cache() const {
+    return *expansion_cache_;
+  }
+
 private:
   void UpdateRoute(const StateId& lhs, const StateId& rhs) const;
 
@@ -93,6 +108,16 @@ private:
   float turn_cost_table_[181];
 
   bool match_on_restrictions_{false};
+
+  // Edges expanded by the routes of the current match
+  std::shared_ptr<ExpansionCache> expansion_cache_;
+
+  // Label sets of the routes, the first used of them belong to the current match
+  struct LabelSetPool {
+    std::vector<labelset_ptr_t> labelsets;
+    size_t used = 0;
+  };
+  std::shared_ptr<LabelSetPool> labelsets_;
 };
 
 } // namespace meili
@@ -170,17 +170,51 @@ public:
   StateId Predecessor(const StateId& stateid) const override;
   double AccumulatedCost(const StateId& stateid) const override;
 
+  /**
+   * Keep the search to a beam, only the cheapest states of a column go on to the next one. The
+   * states of a column come off the queue cheapest first, so once one of them falls out of the
+   * beam the rest of the column is dropped before the transitions from any of them are computed.
+   * The best path is missed when it goes through a dropped state. Takes effect with the next
+   * search, ClearSearch to apply it to a search that already started.
+   * @param width     the most states of a column to go on from, 0 for all of them
+   * @param cost_gap  the most accumulated cost a state may have over the winner of its column to
+   *                  go on from it, 0 for any
+   */
+  void set_beam(uint32_t width, double cost_gap) {
+    beam_width_ = width;
+    beam_cost_gap_ = cost_gap;
+  }
+
 private:
   // Initialize labels from a column and push them into priority queue
   void InitQueue(const std::vector<StateId>& column);
   void AddSuccessorsToQueue(const StateId& stateid);
   StateId::Time IterativeSearch(StateId::Time target, bool request_new_start);
   constexpr static bool IsInvalidCost(double cost);
+  // The label of a scanned state or nullptr
+  const StateLabel* ScannedLabel(const StateId& stateid) const;
+  // Keeps the label of a newly scanned state, false if the state was scanned before
+  bool ScanLabel(const StateLabel& label);
+  // Whether the label is the first of its column to fall out of the beam
+  bool OutOfBeam(const StateLabel& label) const;
 
   std::vector<std::vector<StateId>> unreached_states_by_time;
-  std::unordered_map<StateId, StateLabel> scanned_labels_;
   SPQueue<StateLabel> queue_;
   StateId::Time earliest_time_{0};
+
+  // The labels of the scanned states in the order they were scanned. They are found through
+  // slots laid out column after column, a column gets as many as its widest state id when it is
+  // laid out. States without a slot, like the clones of the top k search whose ids count down
+  // from the max, are found through the map. All of it keeps its memory across searches.
+  std::vector<StateLabel> scanned_labels_;
+  std::vector<uint32_t> label_slots_;
+  std::vector<uint32_t> column_offsets_{0};
+  std::vector<uint32_t> column_widths_;
+  std::unordered_map<StateId, uint32_t> unslotted_labels_;
+
+  uint32_t beam_width_{0};
+  double beam_cost_gap_{0};
+  std::vector<uint32_t> scanned_by_time_; // states scanned per column, for the beam width
 };
 } // namespace meili
 } // namespace valhalla
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace valhalla {
+namespace midgard {
+
+/**
+ * How often and how much the calling thread allocated with operator new
+ */
+struct allocation_counts_t {
+  uint64_t count;
+  uint64_t bytes;
+};
+
+/**
+ * Whether allocations are counted. They are when valhalla is built with ENABLE_ALLOCATION_COUNTING,
+ * which replaces the global operator new and delete of the process with ones that count the
+ * allocations of each thread.
+ * @return true if allocations are counted
+ */
+bool counting_allocations();
+
+/**
+ * The allocations the calling thread made since it started. The difference of two calls is what
+ * the thread allocated in between, allocations of other threads it waited for are not in it.
+ * @return the counts, always zero when allocations are not counted
+ */
+allocation_counts_t thread_allocations();
+
+} // namespace midgard
+} // namespace valhalla
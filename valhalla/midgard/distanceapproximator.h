@@ -2,13 +2,51 @@
 #ifndef VALHALLA_MIDGARD_DISTANCEAPPROXIMATOR_H_
 #define VALHALLA_MIDGARD_DISTANCEAPPROXIMATOR_H_
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
 
 #include <valhalla/midgard/constants.h>
 
 namespace valhalla {
 namespace midgard {
 
+namespace detail {
+
+// Cosine of an angle in radians within [-pi, pi] from its Taylor series, so that it can be used in
+// constant expressions
+constexpr double taylor_cos(double x) {
+  x = x < 0 ? -x : x;
+  double sign = 1;
+  if (x > kPiD / 2) {
+    x = kPiD - x;
+    sign = -1;
+  }
+  double term = 1, sum = 1;
+  for (int n = 1; n < 12; ++n) {
+    term *= -x * x / ((2 * n - 1) * (2 * n));
+    sum += term;
+  }
+  return sign * sum;
+}
+
+// The longitude scale is looked up in bands of a quarter degree of latitude from 0 to 90
+constexpr double kLngScaleBandSize = 0.25;
+constexpr size_t kLngScaleBands = 360;
+
+constexpr std::array<float, kLngScaleBands + 1> make_lng_scales() {
+  std::array<float, kLngScaleBands + 1> scales{};
+  for (size_t i = 0; i <= kLngScaleBands; ++i) {
+    scales[i] = static_cast<float>(taylor_cos(i * kLngScaleBandSize * kRadPerDegD));
+  }
+  return scales;
+}
+
+constexpr std::array<float, kLngScaleBands + 1> kLngScales = make_lng_scales();
+
+} // namespace detail
+
 /**
  * Provides distance approximation in latitude, longitude space. Approximates
  * distance in meters between two points. This method is more efficient
@@ -78,6 +116,23 @@ public:
            sqr((ll.lng() - centerlng_) * m_per_lng_degree_);
   }
 
+  /**
+   * Approximates the squared distances between a batch of positions and the current test point,
+   * the same as DistanceSquared(ll) for each of them. The loop has no branches so the compiler can
+   * vectorize it.
+   * @param   lls           Latitude, longitude of the points (degrees)
+   * @param   count         Number of points
+   * @param   sq_distances  Receives the squared distance in meters of each point
+   */
+  void DistanceSquared(const PointT* lls,
+                       const size_t count,
+                       typename PointT::first_type* sq_distances) const {
+    for (size_t i = 0; i < count; ++i) {
+      sq_distances[i] = sqr((lls[i].lat() - centerlat_) * kMetersPerDegreeLat) +
+                        sqr((lls[i].lng() - centerlng_) * m_per_lng_degree_);
+    }
+  }
+
   /**
    * Approximates arc distance between 2 lat,lng positions using meters per
    * latitude and longitude degree.  Uses the mid latitude of the 2 positions
@@ -88,7 +143,24 @@ public:
    */
   static typename PointT::first_type DistanceSquared(const PointT& ll1, const PointT& ll2) {
     auto latm = (ll1.lat() - ll2.lat()) * kMetersPerDegreeLat;
-    auto lngm = (ll1.lng() - ll2.lng()) * MetersPerLngDegree((ll1.lat() + ll2.lat()) * 0.5);
+    auto lngm = (ll1.lng() - ll2.lng()) * kMetersPerDegreeLat *
+                TableLngScalePerLat((ll1.lat() + ll2.lat()) * 0.5);
+    return (latm * latm + lngm * lngm);
+  }
+
+  /**
+   * Approximates arc distance from a test point to a position like DistanceSquared(ll) does, for
+   * when the test point is used only once. The longitude scale comes from the table rather than
+   * from a cosine.
+   * @param   test_point  Point to measure from (lat,lng)
+   * @param   ll          Point to measure to (lat,lng)
+   * @return  Returns the approximate distance squared (in meters)
+   */
+  static typename PointT::first_type DistanceSquaredFrom(const PointT& test_point,
+                                                         const PointT& ll) {
+    auto latm = (ll.lat() - test_point.lat()) * kMetersPerDegreeLat;
+    auto lngm =
+        (ll.lng() - test_point.lng()) * kMetersPerDegreeLat * TableLngScalePerLat(test_point.lat());
     return (latm * latm + lngm * lngm);
   }
 
@@ -114,6 +186,22 @@ public:
     return cosf(lat * kRadPerDeg);
   }
 
+  /**
+   * Gets the distance scale for longitude at a latitude from a table of latitude bands a quarter
+   * of a degree apart, interpolating between the bands. It is within 3e-6 of LngScalePerLat and
+   * saves the cosine where the latitude changes with every distance.
+   * @param   lat   Latitude in degrees, clamped to [-90, 90]
+   * @return  Returns the scale to use for longitude at this degree of latitude
+   */
+  static typename PointT::first_type TableLngScalePerLat(const typename PointT::first_type lat) {
+    const auto abs_lat = std::abs(lat);
+    const auto band = abs_lat < 90 ? abs_lat / detail::kLngScaleBandSize : detail::kLngScaleBands;
+    const size_t index = std::min(static_cast<size_t>(band), detail::kLngScaleBands - 1);
+    const auto fraction = band - index;
+    return detail::kLngScales[index] +
+           (detail::kLngScales[index + 1] - detail::kLngScales[index]) * fraction;
+  }
+
 private:
   typename PointT::first_type centerlat_;
   typename PointT::first_type centerlng_;
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 // we store 6 digits of precision in the tiles, changing to 7 digits is a breaking change
@@ -157,6 +158,17 @@ container_t decode7(const std::string& encoded, const double precision = DECODE_
   return decode7<container_t>(encoded.c_str(), encoded.length(), precision);
 }
 
+/**
+ * Polyline encode interleaved longitudes and latitudes, several coordinates at a time with AVX2 or
+ * NEON where the machine has it. The output is the same as that of encode.
+ *
+ * @param coords    count longitude, latitude pairs
+ * @param count     the number of points
+ * @param precision Precision of the encoded polyline
+ * @return string   the encoded points
+ */
+std::string encode_polyline(const double* coords, const size_t count, const int precision);
+
 /**
  * Polyline encode a container of points into a string suitable for web use
  * Note: newer versions of this algorithm allow one to specify a zoom level
@@ -168,6 +180,16 @@ container_t decode7(const std::string& encoded, const double precision = DECODE_
  */
 template <class container_t>
 std::string encode(const container_t& points, const int precision = ENCODE_PRECISION) {
+  // vectors of points laid out as a pair of doubles, like PointLL, are encoded in bulk
+  using point_t = typename container_t::value_type;
+  if constexpr (std::is_same<std::vector<point_t>, container_t>::value &&
+                std::is_base_of<std::pair<double, double>, point_t>::value &&
+                std::is_standard_layout<point_t>::value &&
+                sizeof(point_t) == sizeof(std::pair<double, double>)) {
+    return encode_polyline(reinterpret_cast<const double*>(points.data()), points.size(),
+                           precision);
+  }
+
   // a place to keep the output
   std::string output;
   // unless the shape is very course you should probably only need about 3 bytes
@@ -7,6 +7,7 @@
 #include <limits>
 #include <list>
 #include <map>
+#include <thread>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/polyline2.h>
 #include <valhalla/midgard/tiles.h>
@@ -61,6 +62,45 @@ public:
     }
   }
 
+  /**
+   * Lower the values of this grid to those of another grid wherever the other grid reached a
+   * tile. Tiles are matched by their centers so the grids should have the same tile size and be
+   * aligned to each other.
+   * @param  other  Grid to take the values from.
+   */
+  void SetIfLessThan(const GriddedData& other) {
+    for (int32_t tile_id = 0; tile_id < static_cast<int32_t>(other.data_.size()); ++tile_id) {
+      auto value = max_value_;
+      bool reached = false;
+      for (size_t i = 0; i < dimensions_t; ++i) {
+        if (other.data_[tile_id][i] < other.max_value_[i]) {
+          value[i] = other.data_[tile_id][i];
+          reached = true;
+        }
+      }
+      if (reached) {
+        SetIfLessThan(this->TileId(other.Center(tile_id)), value);
+      }
+    }
+  }
+
+  /**
+   * Get the value at a tile.
+   * @param  tile_id  Tile Id, it must be valid.
+   * @return the value of the tile
+   */
+  const value_type& DataAt(const int32_t tile_id) const {
+    return data_[tile_id];
+  }
+
+  /**
+   * Get the value of the tiles that were never set.
+   * @return the value the grid was initialized with
+   */
+  const value_type& MaxValue() const {
+    return max_value_;
+  }
+
   using contour_t = std::list<PointLL>;
   using feature_t = std::list<contour_t>;
   using contours_t = std::vector<std::list<feature_t>>;
@@ -83,37 +123,25 @@ public:
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param threads              the number of threads to trace the contour intervals on, the
+   *                             contours are the same for any number of threads
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
   contours_t GenerateContours(std::vector<contour_interval_t>& intervals,
                               const bool rings_only = false,
                               const float denoise = 1.f,
-                              const float generalize = 200.f) const {
+                              const float generalize = 200.f,
+                              const size_t threads = 1) const {
     // sort the contours first on the metric index then on the values with the bigger contours first
     std::sort(intervals.begin(), intervals.end(), std::greater<>());
 
-    // Values at tile corners and center (0 element is center)
-    int sh[5];
-    typename PointLL::first_type s[5]; // Values at the tile corners and center
-    PointLL tile_corners[5];           // PointLL at tile corners and center
-    int m1, m2, m3;                    // Indices into the tile corners
-    PointLL from_pt, to_pt;            // The intersection points in the tile
-    int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
-
-    // Find the intersection along a tile edge
-    auto intersect = [&tile_corners, &s](int p1, int p2) {
-      auto ds = s[p2] - s[p1];
-      return PointLL((s[p2] * tile_corners[p1].first - s[p1] * tile_corners[p2].first) / ds,
-                     (s[p2] * tile_corners[p1].second - s[p1] * tile_corners[p2].second) / ds);
-    };
-
     // In the tight loop below, we need to decide where a contour intersects the triangles that make
     // up the given tile. this works out to a number of discrete cases which we lookup using the table
     // below. based on the case we perform the appropriate intersection. to avoid branching we store
     // the intersection operation for each case in an array and perform the correct one by calling the
     // function stored in the array
-    int case_table[3][3][3] = {
+    const int case_table[3][3][3] = {
         {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
         {{0, 3, 4}, {1, 0, 1}, {4, 3, 0}},
         {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}},
@@ -135,59 +163,11 @@ public:
     // "A linear ring MUST follow the right-hand rule with respect to the area it
     // bounds, i.e., exterior rings are counterclockwise, and holes are clockwise."  (c)
     // (c) https://tools.ietf.org/html/rfc7946#section-3.1.6
-    bool swap_table[3][3][3] = {
+    const bool swap_table[3][3][3] = {
         {{false, false, true}, {false, true, true}, {true, false, false}},
         {{false, true, false}, {true, false, false}, {true, false, false}},
         {{true, true, false}, {false, false, false}, {false, false, false}},
     };
-    std::array<std::function<void()>, 10> cases{
-        [&]() {},
-        // Line between vertices 1 and 2
-        [&]() {
-          from_pt = tile_corners[m1];
-          to_pt = tile_corners[m2];
-        },
-        // Line between vertices 2 and 3
-        [&]() {
-          from_pt = tile_corners[m2];
-          to_pt = tile_corners[m3];
-        },
-        // Line between vertices 3 and 1
-        [&]() {
-          from_pt = tile_corners[m3];
-          to_pt = tile_corners[m1];
-        },
-        // Line between vertex 1 and side 2-3
-        [&]() {
-          from_pt = tile_corners[m1];
-          to_pt = intersect(m2, m3);
-        },
-        // Line between vertex 2 and side 3-1
-        [&]() {
-          from_pt = tile_corners[m2];
-          to_pt = intersect(m3, m1);
-        },
-        // Line between vertex 3 and side 1-2
-        [&]() {
-          from_pt = tile_corners[m3];
-          to_pt = intersect(m1, m2);
-        },
-        // Line between sides 1-2 and 2-3
-        [&]() {
-          from_pt = intersect(m1, m2);
-          to_pt = intersect(m2, m3);
-        },
-        // Line between sides 2-3 and 3-1
-        [&]() {
-          from_pt = intersect(m2, m3);
-          to_pt = intersect(m3, m1);
-        },
-        // Line between sides 3-1 and 1-2
-        [&]() {
-          from_pt = intersect(m3, m1);
-          to_pt = intersect(m1, m2);
-        },
-    };
 
     // which metrics do we need contours for
     auto _ = std::make_pair(intervals.cbegin(), intervals.cend());
@@ -209,148 +189,231 @@ public:
     std::vector<contour_lookup_t> end_lookups(intervals.size());
     // TODO: preallocate the lookups for each interval
 
-    // For each metric we tracked
-    for (const auto& metric : metrics) {
-      size_t metric_index = std::get<0>(*metric.first);
-
-      // For each cell, skipping the outer rim since its out of bounds
-      for (int row = 1; row < this->nrows_ - 1; ++row) {
-        for (int col = 1; col < this->ncolumns_ - 1; ++col) {
-          int tileid = this->TileId(col, row);
-          auto cell1 = data_[tileid][metric_index];
-          auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col,   row+1)];
-          auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)];
-          auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)];
-          auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
-          auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
-
-          // Continue if outside the range of contour values for this metric_index
-          if (dmax < std::get<1>(*std::prev(metric.second)) || dmin > std::get<1>(*metric.first)) {
-            continue;
-          }
-
-          // For each requested contour value
-          for (size_t i = 0; i < intervals.size(); ++i) {
-            // some setup to process this contour
-            auto& begin_lookup = begin_lookups[i];
-            auto& end_lookup = end_lookups[i];
-            auto& contour = contours[i];
-            auto contour_value = std::get<1>(intervals[i]);
-
-            // we skip this contour if its interested in a different metric_index or its value
-            // would not intersect this cell
-            if (std::get<0>(intervals[i]) != metric_index || contour_value < dmin ||
-                contour_value > dmax) {
+    const int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
+
+    // Every contour interval has its own lines and lookups so the intervals can be traced
+    // independently. A worker traces every workers'th interval over the whole grid and the
+    // segments of each interval are visited in the same order no matter how many workers there are
+    const size_t workers = std::max<size_t>(1, std::min(threads, intervals.size()));
+    auto trace = [&](const size_t worker) {
+      // Values at tile corners and center (0 element is center)
+      int sh[5];
+      typename PointLL::first_type s[5]; // Values at the tile corners and center
+      PointLL tile_corners[5];           // PointLL at tile corners and center
+      int m1, m2, m3;                    // Indices into the tile corners
+      PointLL from_pt, to_pt;            // The intersection points in the tile
+
+      // Find the intersection along a tile edge
+      auto intersect = [&tile_corners, &s](int p1, int p2) {
+        auto ds = s[p2] - s[p1];
+        return PointLL((s[p2] * tile_corners[p1].first - s[p1] * tile_corners[p2].first) / ds,
+                       (s[p2] * tile_corners[p1].second - s[p1] * tile_corners[p2].second) / ds);
+      };
+
+      std::array<std::function<void()>, 10> cases{
+          [&]() {},
+          // Line between vertices 1 and 2
+          [&]() {
+            from_pt = tile_corners[m1];
+            to_pt = tile_corners[m2];
+          },
+          // Line between vertices 2 and 3
+          [&]() {
+            from_pt = tile_corners[m2];
+            to_pt = tile_corners[m3];
+          },
+          // Line between vertices 3 and 1
+          [&]() {
+            from_pt = tile_corners[m3];
+            to_pt = tile_corners[m1];
+          },
+          // Line between vertex 1 and side 2-3
+          [&]() {
+            from_pt = tile_corners[m1];
+            to_pt = intersect(m2, m3);
+          },
+          // Line between vertex 2 and side 3-1
+          [&]() {
+            from_pt = tile_corners[m2];
+            to_pt = intersect(m3, m1);
+          },
+          // Line between vertex 3 and side 1-2
+          [&]() {
+            from_pt = tile_corners[m3];
+            to_pt = intersect(m1, m2);
+          },
+          // Line between sides 1-2 and 2-3
+          [&]() {
+            from_pt = intersect(m1, m2);
+            to_pt = intersect(m2, m3);
+          },
+          // Line between sides 2-3 and 3-1
+          [&]() {
+            from_pt = intersect(m2, m3);
+            to_pt = intersect(m3, m1);
+          },
+          // Line between sides 3-1 and 1-2
+          [&]() {
+            from_pt = intersect(m3, m1);
+            to_pt = intersect(m1, m2);
+          },
+      };
+
+      // For each metric we tracked
+      for (const auto& metric : metrics) {
+        size_t metric_index = std::get<0>(*metric.first);
+
+        // For each cell, skipping the outer rim since its out of bounds
+        for (int row = 1; row < this->nrows_ - 1; ++row) {
+          for (int col = 1; col < this->ncolumns_ - 1; ++col) {
+            int tileid = this->TileId(col, row);
+            auto cell1 = data_[tileid][metric_index];
+            // TileId(col, row+1), TileId(col+1, row) and TileId(col+1, row+1)
+            auto cell2 = data_[tileid + this->ncolumns_][metric_index];
+            auto cell3 = data_[tileid + 1][metric_index];
+            auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index];
+            auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
+            auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
+
+            // Continue if outside the range of contour values for this metric_index
+            if (dmax < std::get<1>(*std::prev(metric.second)) ||
+                dmin > std::get<1>(*metric.first)) {
               continue;
             }
 
-            for (int m = 4; m > 0; m--) {
-              int newtileid = tileid + tile_inc[m - 1];
-              // Make sure the tile corner value is not set to the max_value
-              // (messes up the intersect method). Set a value slightly above
-              // the contour (e.g. 1 minute higher).
-              // TODO - the value 1 is a bit of a hack.
-              float nd = data_[newtileid][metric_index];
-              s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
-              tile_corners[m] = this->Base(newtileid);
-              sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
-            }
-            s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
-            tile_corners[0] = this->Center(tileid);
-            sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
-
-            /*
-             Note: at this stage the relative heights of the corners and the
-             centre are in the h array, and the corresponding coordinates are
-             in the xh and yh arrays. The centre of the box is indexed by 0
-             and the 4 corners by 1 to 4 as shown below.
-             Each triangle is then indexed by the parameter m, and the 3
-             vertices of each triangle are indexed by parameters m1,m2,and m3.
-             It is assumed that the centre of the box is always vertex 2
-             though this is important only when all 3 vertices lie exactly on
-             the same contour level, in which case only the side of the box
-             is drawn.
-                vertex 4 +-------------------+ vertex 3
-                         | \               / |
-                         |   \    m-3    /   |
-                         |     \       /     |
-                         |       \   /       |
-                         |  m=2    X   m=2   |       the centre is vertex 0
-                         |       /   \       |
-                         |     /       \     |
-                         |   /    m=1    \   |
-                         | /               \ |
-                vertex 1 +-------------------+ vertex 2
-            */
-
-            // Scan each triangle in the box
-            for (int m = 1; m <= 4; m++) {
-              // figure out which intersection we need to do
-              m1 = m;
-              m2 = 0;
-              m3 = (m != 4) ? m + 1 : 1;
-              int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
-              bool swap_points = swap_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
-
-              // there is no intersection of this triangle
-              if (case_index == 0) {
+            // For each requested contour value this worker traces
+            for (size_t i = worker; i < intervals.size(); i += workers) {
+              // some setup to process this contour
+              auto& begin_lookup = begin_lookups[i];
+              auto& end_lookup = end_lookups[i];
+              auto& contour = contours[i];
+              auto contour_value = std::get<1>(intervals[i]);
+
+              // we skip this contour if its interested in a different metric_index or its value
+              // would not intersect this cell
+              if (std::get<0>(intervals[i]) != metric_index || contour_value < dmin ||
+                  contour_value > dmax) {
                 continue;
               }
 
-              // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
-              cases[case_index]();
-
-              // this isnt a segment..
-              if (from_pt == to_pt) {
-                continue;
-              }
-              if (swap_points) {
-                std::swap(from_pt, to_pt);
+              for (int m = 4; m > 0; m--) {
+                int newtileid = tileid + tile_inc[m - 1];
+                // Make sure the tile corner value is not set to the max_value
+                // (messes up the intersect method). Set a value slightly above
+                // the contour (e.g. 1 minute higher).
+                // TODO - the value 1 is a bit of a hack.
+                float nd = data_[newtileid][metric_index];
+                s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
+                tile_corners[m] = this->Base(newtileid);
+                sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
               }
+              s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
+              tile_corners[0] = this->Center(tileid);
+              sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
+
+              /*
+               Note: at this stage the relative heights of the corners and the
+               centre are in the h array, and the corresponding coordinates are
+               in the xh and yh arrays. The centre of the box is indexed by 0
+               and the 4 corners by 1 to 4 as shown below.
+               Each triangle is then indexed by the parameter m, and the 3
+               vertices of each triangle are indexed by parameters m1,m2,and m3.
+               It is assumed that the centre of the box is always vertex 2
+               though this is important only when all 3 vertices lie exactly on
+               the same contour level, in which case only the side of the box
+               is drawn.
+                  vertex 4 +-------------------+ vertex 3
+                           | \               / |
+                           |   \    m-3    /   |
+                           |     \       /     |
+                           |       \   /       |
+                           |  m=2    X   m=2   |       the centre is vertex 0
+                           |       /   \       |
+                           |     /       \     |
+                           |   /    m=1    \   |
+                           | /               \ |
+                  vertex 1 +-------------------+ vertex 2
+              */
+
+              // Scan each triangle in the box
+              for (int m = 1; m <= 4; m++) {
+                // figure out which intersection we need to do
+                m1 = m;
+                m2 = 0;
+                m3 = (m != 4) ? m + 1 : 1;
+                int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
+                bool swap_points = swap_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
+
+                // there is no intersection of this triangle
+                if (case_index == 0) {
+                  continue;
+                }
 
-              // see if we have anything to connect this segment to
-              typename contour_lookup_t::iterator end_lookup_it = end_lookup.find(from_pt);
-              typename contour_lookup_t::iterator begin_lookup_it = begin_lookup.find(to_pt);
-
-              if (end_lookup_it != end_lookup.end() && begin_lookup_it != begin_lookup.end()) {
-                // we want to merge two records
-                //   first_segment                               second_segment
-                // (... ------> from_pt) + (from_pt, to_pt) + (to_pt ------> ...)
-                auto first_segment = end_lookup_it->second;
-                auto second_segment = begin_lookup_it->second;
-                end_lookup.erase(end_lookup_it);
-                begin_lookup.erase(begin_lookup_it);
-
-                // this segment is now a ring
-                if (first_segment == second_segment) {
-                  first_segment->push_back(first_segment->front());
+                // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
+                cases[case_index]();
+
+                // this isnt a segment..
+                if (from_pt == to_pt) {
                   continue;
                 }
+                if (swap_points) {
+                  std::swap(from_pt, to_pt);
+                }
 
-                end_lookup[second_segment->back()] = first_segment;
-                first_segment->splice(first_segment->end(), *second_segment);
-                contour.front().erase(second_segment);
-              } else if (end_lookup_it != end_lookup.end()) {
-                // (... ------> from_pt) + (from_pt, to_pt)
-                end_lookup_it->second->push_back(to_pt);
-                end_lookup.emplace(to_pt, end_lookup_it->second);
-                end_lookup.erase(end_lookup_it);
-              } else if (begin_lookup_it != begin_lookup.end()) {
-                // (from_pt, to_pt) + (to_pt ------> ...)
-                begin_lookup_it->second->push_front(from_pt);
-                begin_lookup.emplace(from_pt, begin_lookup_it->second);
-                begin_lookup.erase(begin_lookup_it);
-              } else {
-                // this is an orphan segment for now
-                contour.front().push_front(contour_t{from_pt, to_pt});
-                begin_lookup.emplace(from_pt, contour.front().begin());
-                end_lookup.emplace(to_pt, contour.front().begin());
+                // see if we have anything to connect this segment to
+                typename contour_lookup_t::iterator end_lookup_it = end_lookup.find(from_pt);
+                typename contour_lookup_t::iterator begin_lookup_it = begin_lookup.find(to_pt);
+
+                if (end_lookup_it != end_lookup.end() && begin_lookup_it != begin_lookup.end()) {
+                  // we want to merge two records
+                  //   first_segment                               second_segment
+                  // (... ------> from_pt) + (from_pt, to_pt) + (to_pt ------> ...)
+                  auto first_segment = end_lookup_it->second;
+                  auto second_segment = begin_lookup_it->second;
+                  end_lookup.erase(end_lookup_it);
+                  begin_lookup.erase(begin_lookup_it);
+
+                  // this segment is now a ring
+                  if (first_segment == second_segment) {
+                    first_segment->push_back(first_segment->front());
+                    continue;
+                  }
+
+                  end_lookup[second_segment->back()] = first_segment;
+                  first_segment->splice(first_segment->end(), *second_segment);
+                  contour.front().erase(second_segment);
+                } else if (end_lookup_it != end_lookup.end()) {
+                  // (... ------> from_pt) + (from_pt, to_pt)
+                  end_lookup_it->second->push_back(to_pt);
+                  end_lookup.emplace(to_pt, end_lookup_it->second);
+                  end_lookup.erase(end_lookup_it);
+                } else if (begin_lookup_it != begin_lookup.end()) {
+                  // (from_pt, to_pt) + (to_pt ------> ...)
+                  begin_lookup_it->second->push_front(from_pt);
+                  begin_lookup.emplace(from_pt, begin_lookup_it->second);
+                  begin_lookup.erase(begin_lookup_it);
+                } else {
+                  // this is an orphan segment for now
+                  contour.front().push_front(contour_t{from_pt, to_pt});
+                  begin_lookup.emplace(from_pt, contour.front().begin());
+                  end_lookup.emplace(to_pt, contour.front().begin());
+                }
               }
-            }
-          } // Each contour
-        }   // Each tile col
-      }     // Each tile row
-    }       // Each dimension of the grid
+            } // Each contour
+          }   // Each tile col
+        }     // Each tile row
+      }       // Each dimension of the grid
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker) {
+      pool.emplace_back(trace, worker);
+    }
+    trace(0);
+    for (auto& thread : pool) {
+      thread.join();
+    }
 
     // If the generalization value equals kOptimalGeneralization then set
     // the generalization factor to 1/4 of the grid size
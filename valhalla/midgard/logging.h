@@ -1,6 +1,7 @@
 #ifndef VALHALLA_MIDGARD_LOGGING_H_
 #define VALHALLA_MIDGARD_LOGGING_H_
 
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -50,8 +51,23 @@ void Log(const std::string&, const std::string& custom_directive = " [TRACE] ");
 // try something like:
 // logging::Configure({ {"type", "std_out"}, {"color", ""} })
 // logging::Configure({ {"type", "file"}, {"file_name", "test.log"}, {"reopen_interval", "1"} })
+// logging::Configure({ {"type", "async"}, {"sink", "file"}, {"file_name", "test.log"},
+//                      {"queue_size", "8192"}, {"overflow", "drop"} })
 void Configure(const LoggingConfig& config);
 
+// what the async logger did so far, it writes the lines of a sink logger (std_out, std_err or
+// file) from a background thread and either drops lines or has the threads logging wait when its
+// queue is full (overflow drop or block)
+struct AsyncLoggerStats {
+  uint64_t logged;  // lines handed to the logger
+  uint64_t dropped; // lines dropped because the queue was full
+  uint64_t written; // lines written to the sink
+  uint64_t writes;  // batches the lines were written in
+};
+
+// statically get the stats of the logger, all 0 if it is not async
+AsyncLoggerStats GetAsyncLoggerStats();
+
 // guarding against redefinitions
 #ifndef LOG_ERROR
 #ifndef LOG_WARN
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace midgard {
+
+/**
+ * The cpus of each NUMA node of the host, read from sysfs. Hosts without NUMA, or platforms other
+ * than linux, have one node with no cpus listed.
+ * @return the cpus by node
+ */
+const std::vector<std::vector<uint32_t>>& numa_node_cpus();
+
+/**
+ * Number of NUMA nodes of the host, at least 1
+ */
+size_t numa_node_count();
+
+/**
+ * Keeps the calling thread on the cpus of a NUMA node. Memory the thread touches first is then
+ * allocated on that node by the kernel's default policy.
+ * @param node  the node, taken modulo the node count
+ * @return true if the thread was pinned
+ */
+bool pin_thread_to_numa_node(const size_t node);
+
+/**
+ * The NUMA node the calling thread is running on
+ * @return the node or 0 if it can't be told
+ */
+size_t current_numa_node();
+
+/**
+ * How many pages of a memory range sit on each NUMA node. Only every stride-th page is looked at
+ * and pages that aren't resident are not counted.
+ * @param data    start of the range
+ * @param size    bytes of the range
+ * @param stride  look at every stride-th page
+ * @return the sampled pages by node, empty if it can't be told
+ */
+std::vector<size_t> numa_page_nodes(const void* data, const size_t size, const size_t stride = 1);
+
+} // namespace midgard
+} // namespace valhalla
@@ -132,13 +132,12 @@ public:
 
   /**
    * Approximates the distance squared between two lng,lat points - uses
-   * the DistanceApproximator.
+   * the DistanceApproximator with the longitude scale of this point's latitude.
    * @param   ll2   Second lng,lat position to calculate distance to.
    * @return  Returns the distance squared in meters.
    */
   PrecisionT DistanceSquared(const GeoPoint& ll2) const {
-    DistanceApproximator<GeoPoint<PrecisionT>> approx(*this);
-    return approx.DistanceSquared(ll2);
+    return DistanceApproximator<GeoPoint<PrecisionT>>::DistanceSquaredFrom(*this, ll2);
   }
 
   /**
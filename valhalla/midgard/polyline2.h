@@ -14,6 +14,33 @@
 namespace valhalla {
 namespace midgard {
 
+// Highest zoom level there is a generalization tolerance for
+constexpr uint32_t kMaxGeneralizeZoom = 18;
+
+// Douglas-Peucker tolerance in meters for each zoom level, small enough that the generalized shape
+// looks the same as the full shape when drawn at that zoom
+constexpr double kGeneralizeTolerances[kMaxGeneralizeZoom + 1] = {
+    703125.0, // z0
+    351562.5, // z1
+    175781.2, // z2
+    87890.6,  // z3
+    43945.3,  // z4
+    21972.6,  // z5
+    10986.3,  // z6
+    5493.1,   // z7
+    2746.5,   // z8
+    1373.2,   // z9
+    686.6,    // z10
+    343.3,    // z11
+    171.6,    // z12
+    85.8,     // z13
+    42.9,     // z14
+    21.4,     // z15
+    10.7,     // z16
+    5.3,      // z17
+    2.6,      // z18
+};
+
 /**
  * 2-D polyline. This is a template class that works with Point2
  * (Euclidean x,y) or PointLL (latitude,longitude).
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cmath>
 #include <cstdint>
@@ -8,6 +9,7 @@
 #include <cstring>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <iterator>
 #include <list>
@@ -16,6 +18,7 @@
 #include <queue>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -71,7 +74,10 @@
 #define MAP_ANONYMOUS 0x20
 #define MAP_FAILED (reinterpret_cast<void*>(static_cast<LONG_PTR>(-1)))
 #define POSIX_MADV_NORMAL 0     // ignored
+#define POSIX_MADV_RANDOM 1     // ignored
 #define POSIX_MADV_SEQUENTIAL 2 // ignored
+#define POSIX_MADV_WILLNEED 3   // ignored
+#define POSIX_MADV_DONTNEED 4   // ignored
 
 inline void* mmap(void* addr, size_t length, int prot, int flags, int fd, long long offset) {
   (void)addr; // ignored
@@ -126,6 +132,26 @@ inline int munmap(void* addr, size_t length) {
 namespace valhalla {
 namespace midgard {
 
+/**
+ * How sequences use memory and io. The intermediate files of a build are made all over mjolnir so
+ * these are set once for the whole process, before the build, rather than handed to every one.
+ */
+struct sequence_hints_t {
+  // ask for transparent huge pages on the maps so large files take fewer TLB entries
+  bool huge_pages = false;
+  // fault in the whole map of a file that is opened for reading, rather than page by page
+  bool populate = false;
+  // write full buffers on a thread of their own while the next buffer fills
+  bool write_behind = false;
+  // the bytes of elements a sequence buffers before it writes them to its file
+  size_t write_buffer_size = 1024 * 1024 * 32;
+};
+
+inline sequence_hints_t& sequence_hints() {
+  static sequence_hints_t hints;
+  return hints;
+}
+
 template <class T> class mem_map {
 public:
   // non-copyable
@@ -167,11 +193,12 @@ public:
     map(new_file_name, new_count, advice);
   }
 
-  // reset to another file or another size
+  // reset to another file or another size, flags are or'ed into the flags of the mmap
   void map(const std::string& new_file_name,
            size_t new_count,
            int advice = POSIX_MADV_NORMAL,
-           bool readonly = false) {
+           bool readonly = false,
+           int flags = 0) {
     // just in case there was already something
     unmap();
 
@@ -187,7 +214,7 @@ public:
         throw std::runtime_error(new_file_name + "(open): " + strerror(errno));
       }
       ptr = mmap(nullptr, new_count * sizeof(T), (readonly ? PROT_READ : PROT_READ | PROT_WRITE),
-                 MAP_SHARED, fd, 0);
+                 MAP_SHARED | flags, fd, 0);
       if (ptr == MAP_FAILED) {
         throw std::runtime_error(new_file_name + "(mmap): " + strerror(errno));
       }
@@ -229,6 +256,31 @@ public:
     }
   }
 
+  // advise the kernel about the access pattern of a range of elements within the map, the range
+  // is widened to the pages it touches as the kernel only works on whole pages
+  void advise(size_t offset, size_t length, int advice) const {
+#ifndef _WIN32
+    if (!ptr || offset >= count) {
+      return;
+    }
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    auto* begin = static_cast<char*>(ptr) + offset * sizeof(T);
+    auto* end = static_cast<char*>(ptr) + std::min(offset + length, count) * sizeof(T);
+    auto* aligned = static_cast<char*>(ptr) +
+                    ((begin - static_cast<char*>(ptr)) / page_size) * page_size;
+    posix_madvise(aligned, end - aligned, advice);
+#endif
+  }
+
+  // ask for transparent huge pages for the whole map, where the kernel has them for files
+  void advise_huge_pages() const {
+#ifdef MADV_HUGEPAGE
+    if (ptr) {
+      madvise(ptr, count * sizeof(T), MADV_HUGEPAGE);
+    }
+#endif
+  }
+
   T* get() const {
     return static_cast<T*>(ptr);
   }
@@ -272,7 +324,7 @@ public:
 
   sequence(const std::string& file_name,
            bool create = false,
-           size_t write_buffer_size = 1024 * 1024 * 32 / sizeof(T))
+           size_t write_buffer_size = sequence_hints().write_buffer_size / sizeof(T))
       : file(new std::fstream(file_name,
                               std::ios_base::binary | std::ios_base::in | std::ios_base::out |
                                   (create ? std::ios_base::trunc : std::ios_base::ate))),
@@ -289,8 +341,8 @@ public:
     }
     write_buffer.reserve(write_buffer_size ? write_buffer_size : 1);
 
-    // memory map the file for reading
-    memmap.map(file_name, element_count);
+    // memory map the file for reading, a file that already has its elements is there to be read
+    remap(element_count, !create && sequence_hints().populate);
   }
 
   ~sequence() {
@@ -303,7 +355,11 @@ public:
     write_buffer.push_back(obj);
     // push it to the file
     if (write_buffer.size() == write_buffer.capacity()) {
-      flush();
+      if (sequence_hints().write_behind) {
+        write_behind();
+      } else {
+        flush();
+      }
     }
   }
 
@@ -314,6 +370,7 @@ public:
                        const std::function<bool(const T&, const T&)>& predicate,
                        size_t start_index = 0) {
     flush();
+    sequential_scope scan(memmap, start_index);
     // keep looking while we have stuff to look at
     while (start_index < memmap.size()) {
       T candidate = memmap ? *(static_cast<const T*>(memmap) + start_index) : (*this)[start_index];
@@ -325,24 +382,33 @@ public:
     return npos;
   }
 
+  // how much of the file to sort in memory at once by default
+  static constexpr size_t sort_buffer_size = 1024 * 1024 * 512 / sizeof(T);
+
   // sort the file based on the predicate, and outputs to output_seq
   //
   // Strategy is to first sort sub-ranges of length buffer_size in place.
   // These should all fit in memory. Then, merge the sub-ranges into the
   // output sequence via priority queue.
+  //
+  // With more than one thread the sub-ranges are sorted that many at a time, each of them is
+  // buffer_size / threads long so that no more than buffer_size is sorted at once
   void sort(const std::function<bool(const T&, const T&)>& predicate,
-            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
+            size_t buffer_size = sort_buffer_size,
+            size_t threads = 1) {
     flush();
     // if no elements we are done
     if (memmap.size() == 0) {
       return;
     }
+    threads = std::max<size_t>(threads, 1);
 
     // If there wont be any merging we may as well take the simple approach
     if (buffer_size > memmap.size() + write_buffer.size()) {
-      std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
+      sort_in_memory(static_cast<T*>(memmap), memmap.size(), predicate, threads);
       return;
     }
+    buffer_size = std::max<size_t>(buffer_size / threads, 1);
 
     auto tmp_path = filesystem::path(file_name).replace_filename(
         filesystem::path(file_name).filename().string() + ".tmp");
@@ -359,13 +425,29 @@ public:
           cmp);
 
       // Sort the subsections
+      const size_t subsections = (memmap.size() + buffer_size - 1) / buffer_size;
+      std::atomic<size_t> next_subsection{0};
+      auto sort_subsections = [&]() {
+        for (size_t i = next_subsection++; i < subsections; i = next_subsection++) {
+          std::sort(static_cast<T*>(memmap) + i * buffer_size,
+                    static_cast<T*>(memmap) + std::min(memmap.size(), (i + 1) * buffer_size),
+                    predicate);
+        }
+      };
+      std::vector<std::thread> sorters;
+      for (size_t i = 1; i < std::min(threads, subsections); ++i) {
+        sorters.emplace_back(sort_subsections);
+      }
+      sort_subsections();
+      for (auto& sorter : sorters) {
+        sorter.join();
+      }
       for (size_t i = 0; i < memmap.size(); i += buffer_size) {
-        std::sort(static_cast<T*>(memmap) + i,
-                  static_cast<T*>(memmap) + std::min(memmap.size(), i + buffer_size), predicate);
         pq.emplace(*at(i), i);
       }
 
-      // Perform the merge
+      // Perform the merge, it reads every subsection front to back
+      sequential_scope merge(memmap);
       while (!pq.empty()) {
         auto tmp = pq.top();
         pq.pop();
@@ -396,6 +478,7 @@ public:
   // perform an volatile operation on all the items of this sequence
   void transform(const std::function<void(T&)>& predicate) {
     flush();
+    sequential_scope scan(memmap);
     for (size_t i = 0; i < memmap.size(); ++i) {
       // grab the element
       auto element = at(i);
@@ -411,6 +494,7 @@ public:
   // perform a non-volatile operation on all the items of this sequence
   void enumerate(const std::function<void(const T&)>& predicate) {
     flush();
+    sequential_scope scan(memmap);
     // grab each element and do something with it
     for (size_t i = 0; i < memmap.size(); ++i) {
       predicate(*(at(i)));
@@ -419,19 +503,17 @@ public:
 
   // force writing whatever we have in the write_buffer to file
   void flush() {
+    settle();
     if (write_buffer.size()) {
-      file->seekg(0, file->end);
-      file->write(static_cast<const char*>(static_cast<const void*>(write_buffer.data())),
-                  write_buffer.size() * sizeof(T));
-      file->flush();
-      memmap.map(file_name, memmap.size() + write_buffer.size());
+      write(write_buffer);
+      remap(memmap.size() + write_buffer.size());
       write_buffer.clear();
     }
   }
 
   // how many things have been written so far
   size_t size() const {
-    return memmap.size() + write_buffer.size();
+    return memmap.size() + behind_buffer.size() + write_buffer.size();
   }
 
   // a read/writeable object within the sequence, accessed through memory mapped file
@@ -455,6 +537,9 @@ public:
     iterator& operator=(const T& other) {
       // If index is beyond the end of the mmap buffer, then
       // access items that may be in the write_buffer.
+      if (index >= parent->memmap.size()) {
+        parent->settle();
+      }
       if (index >= parent->memmap.size()) {
         parent->write_buffer[index - parent->memmap.size()] = other;
       } else {
@@ -465,6 +550,9 @@ public:
     operator T() {
       // If index is beyond the end of the mmap buffer, then
       // access items that may be in the write_buffer.
+      if (index >= parent->memmap.size()) {
+        parent->settle();
+      }
       if (index >= parent->memmap.size()) {
         return parent->write_buffer.at(index - parent->memmap.size());
       } else {
@@ -583,14 +671,118 @@ public:
 
   // invalid end iterator
   iterator end() {
-    return iterator(this, memmap.size() + write_buffer.size());
+    return iterator(this, size());
   }
 
 protected:
+  // reads of the map are sequential while one of these is around, the readahead of the kernel
+  // then reads the file in big chunks and drops the pages that were read early
+  struct sequential_scope {
+    sequential_scope(const mem_map<T>& map, size_t offset = 0) : map(map), offset(offset) {
+      map.advise(offset, map.size(), POSIX_MADV_SEQUENTIAL);
+    }
+    ~sequential_scope() {
+      map.advise(offset, map.size(), POSIX_MADV_NORMAL);
+    }
+    const mem_map<T>& map;
+    size_t offset;
+  };
+
+  // appends the elements to the file
+  void write(const std::vector<T>& elements) {
+    file->seekg(0, file->end);
+    file->write(static_cast<const char*>(static_cast<const void*>(elements.data())),
+                elements.size() * sizeof(T));
+    file->flush();
+    if (!*file) {
+      throw std::runtime_error("sequence: " + file_name + ": " + strerror(errno));
+    }
+  }
+
+  // maps the first count elements of the file
+  void remap(size_t count, bool populate = false) {
+    int flags = 0;
+#ifdef MAP_POPULATE
+    if (populate) {
+      flags |= MAP_POPULATE;
+    }
+#else
+    (void)populate;
+#endif
+    memmap.map(file_name, count, POSIX_MADV_NORMAL, false, flags);
+    if (sequence_hints().huge_pages) {
+      memmap.advise_huge_pages();
+    }
+  }
+
+  // hands the full write buffer to a thread that writes it while the next one fills up, there is
+  // at most one such write so a writer that is faster than the disk waits for the last one
+  void write_behind() {
+    settle();
+    behind_buffer.swap(write_buffer);
+    write_buffer.reserve(behind_buffer.capacity());
+    behind_write = std::async(std::launch::async, [this]() { write(behind_buffer); });
+  }
+
+  // waits for the write behind and maps what it wrote, the file and the elements beyond the map
+  // are only to be touched once it is done
+  void settle() {
+    if (behind_write.valid()) {
+      // the buffer is gone either way, an error of the write is rethrown here
+      const auto written = behind_buffer.size();
+      try {
+        behind_write.get();
+      } catch (...) {
+        behind_buffer.clear();
+        throw;
+      }
+      behind_buffer.clear();
+      remap(memmap.size() + written);
+    }
+  }
+
+  // sort a range that fits in memory, in parts on the threads which are then merged pairwise
+  static void sort_in_memory(T* data,
+                             const size_t count,
+                             const std::function<bool(const T&, const T&)>& predicate,
+                             const size_t threads) {
+    const size_t part = (count + threads - 1) / threads;
+    if (threads == 1 || part < 2) {
+      std::sort(data, data + count, predicate);
+      return;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t begin = 0; begin < count; begin += part) {
+      workers.emplace_back([=, &predicate]() {
+        std::sort(data + begin, data + std::min(count, begin + part), predicate);
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    // every round halves the number of sorted parts
+    for (size_t width = part; width < count; width *= 2) {
+      workers.clear();
+      for (size_t begin = 0; begin + width < count; begin += 2 * width) {
+        workers.emplace_back([=, &predicate]() {
+          std::inplace_merge(data + begin, data + begin + width,
+                             data + std::min(count, begin + 2 * width), predicate);
+        });
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    }
+  }
+
   std::shared_ptr<std::fstream> file;
   std::string file_name;
   std::vector<T> write_buffer;
   mem_map<T> memmap;
+  std::vector<T> behind_buffer;   // the elements the write behind is writing
+  std::future<void> behind_write; // the write behind, valid while it has not been settled
 };
 
 struct tar {
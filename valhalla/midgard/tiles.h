@@ -7,6 +7,7 @@
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/constants.h>
@@ -192,6 +193,26 @@ public:
     return (row * ncolumns_) + col;
   }
 
+  /**
+   * Convert a batch of coordinates into tile Ids. Gives the same Ids as TileId(c) for each of them
+   * but bins several coordinates at a time where the CPU allows it.
+   * @param  coords    Coordinates to bin.
+   * @param  count     Number of coordinates.
+   * @param  tile_ids  Receives the tile Id of each coordinate, -1 for the coordinates outside
+   *                   of the tiling system extent.
+   */
+  void TileIds(const coord_t* coords, const size_t count, int32_t* tile_ids) const;
+
+  /**
+   * Convert a batch of coordinates into tile Ids.
+   * @param  coords    Coordinates to bin.
+   * @param  tile_ids  Resized to and filled with the tile Id of each coordinate.
+   */
+  void TileIds(const std::vector<coord_t>& coords, std::vector<int32_t>& tile_ids) const {
+    tile_ids.resize(coords.size());
+    TileIds(coords.data(), coords.size(), tile_ids.data());
+  }
+
   /**
    * Get the tile row, col based on tile Id.
    * @param  tileid  Tile Id.
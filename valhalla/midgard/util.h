@@ -622,6 +622,24 @@ struct projector_t {
   DistanceApproximator<PointLL> approx;
 };
 
+/**
+ * Projects the point of a projector onto every segment of a shape at once and gives back the
+ * squared distance to each projection. The shape is passed as separate longitude and latitude
+ * arrays so that several segments can be handled per instruction with AVX2 or NEON. The
+ * distances match projector_t followed by DistanceSquared up to rounding, callers that need the
+ * exact scalar result should redo the segments whose distance is close to the smallest.
+ * @param project       The projector of the point.
+ * @param lngs          Longitudes of the shape points.
+ * @param lats          Latitudes of the shape points.
+ * @param count         Number of shape points.
+ * @param sq_distances  Receives count - 1 squared distances in meters, one per segment.
+ */
+void project_segments(const projector_t& project,
+                      const double* lngs,
+                      const double* lats,
+                      size_t count,
+                      double* sq_distances);
+
 /**
  * Use the barycentric technique to test if the point p is inside the triangle formed by (a, b, c).
  * If p is along the triangle's nodes/edges, this is not considered contained.
@@ -667,6 +685,32 @@ inline uint16_t to_big_endian(uint16_t val) {
   return (val << 8) | (val >> 8);
 }
 
+/**
+ * Position of a cell along the Hilbert curve that covers a square grid, cells close to each other
+ * on the curve are close to each other in the grid.
+ * @param x  column of the cell
+ * @param y  row of the cell
+ * @param n  side of the grid, a power of 2 of at most 2^32
+ * @return the position along the curve
+ */
+inline uint64_t hilbert_index(uint64_t x, uint64_t y, const uint64_t n) {
+  // walk down the quadrants, rotating them so the curve stays continuous
+  uint64_t d = 0;
+  for (uint64_t s = n / 2; s > 0; s /= 2) {
+    uint64_t rx = (x & s) > 0;
+    uint64_t ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
 template <class T> inline void hash_combine(std::size_t& seed, const T& v) {
   std::hash<T> hasher;
   seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
@@ -4,12 +4,16 @@
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/geometries/polygon.hpp>
+#include <boost/geometry/index/rtree.hpp>
 #include <boost/geometry/io/wkt/wkt.hpp>
 #include <boost/geometry/multi/geometries/multi_polygon.hpp>
 
 #include <cstdint>
+#include <memory>
 #include <sqlite3.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
@@ -25,6 +29,84 @@ namespace mjolnir {
 typedef boost::geometry::model::d2::point_xy<double> point_type;
 typedef boost::geometry::model::polygon<point_type> polygon_type;
 typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
+typedef boost::geometry::model::box<point_type> box_type;
+
+/**
+ * The admin or timezone polygons of a db, loaded once and kept in an R-tree of their bounding
+ * boxes. The polygons of a tile are then found without a query to the db and come back clipped to
+ * the tile, so the point in polygon tests of its nodes only look at the part of a border that runs
+ * through the tile. Nothing changes once it is loaded so the threads building tiles share one.
+ *
+ * An admin db that valhalla_build_admins already cut into local tiles is loaded as those pieces
+ * instead, so nothing is clipped while the tiles are built.
+ */
+class PolygonIndex {
+public:
+  struct Record {
+    // the timezone index, unused for admins which get theirs when they are added to a tile
+    uint32_t id = 0;
+    std::string country_name;
+    std::string state_name;
+    std::string country_iso;
+    std::string state_iso;
+    bool drive_on_right = true;
+    bool allow_intersection_names = false;
+    multi_polygon_type geometry;
+  };
+
+  // The pieces of the polygons within each local tile by the index of their record. A piece
+  // without polygons covers the whole tile.
+  using tile_pieces_t =
+      std::unordered_map<uint32_t, std::vector<std::pair<size_t, multi_polygon_type>>>;
+
+  /**
+   * Constructor
+   * @param  records  the polygons in the order tiles should get them
+   */
+  explicit PolygonIndex(std::vector<Record>&& records);
+
+  /**
+   * Constructor for polygons that are already cut into local tiles
+   * @param  records  the polygons in the order tiles should get them, without their geometry
+   * @param  tiles    the pieces of the polygons in each local tile
+   */
+  PolygonIndex(std::vector<Record>&& records, tile_pieces_t&& tiles);
+
+  /**
+   * Load the states and then the countries of an admin db, as their tile pieces when the db has
+   * them
+   * @param  db_handle  sqlite3 db handle with spatialite loaded
+   */
+  static std::shared_ptr<const PolygonIndex> LoadAdmins(sqlite3* db_handle);
+
+  /**
+   * Load the timezones of a timezone db, ones the tz db doesn't know are left out
+   * @param  db_handle  sqlite3 db handle with spatialite loaded
+   */
+  static std::shared_ptr<const PolygonIndex> LoadTimeZones(sqlite3* db_handle);
+
+  /**
+   * Get the polygons that intersect a bounding box
+   * @param  aabb  the bounding box, of a tile
+   * @return the records in the order they were loaded, each with its polygon clipped to the box
+   */
+  std::vector<std::pair<const Record*, multi_polygon_type>> Clip(const AABB2<PointLL>& aabb) const;
+
+  size_t size() const {
+    return records_.size();
+  }
+
+protected:
+  typedef std::pair<box_type, size_t> value_type;
+
+  // Clip gets the pieces of the tiles under the box when the polygons are cut into tiles
+  std::vector<std::pair<const Record*, multi_polygon_type>> ClipTiles(const AABB2<PointLL>& aabb,
+                                                                      const box_type& box) const;
+
+  std::vector<Record> records_;
+  boost::geometry::index::rtree<value_type, boost::geometry::index::quadratic<16>> rtree_;
+  tile_pieces_t tiles_;
+};
 
 /**
  * Get the dbhandle of a sqlite db.  Used for timezones and admins DBs.
@@ -58,6 +140,14 @@ uint32_t GetMultiPolyId(const std::multimap<uint32_t, multi_polygon_type>& polys
  */
 std::multimap<uint32_t, multi_polygon_type> GetTimeZones(sqlite3* db_handle,
                                                          const AABB2<PointLL>& aabb);
+
+/**
+ * Get the timezone polys from the preloaded timezones, clipped to the tile
+ * @param  index        the timezones
+ * @param  aabb         bb of the tile
+ */
+std::multimap<uint32_t, multi_polygon_type> GetTimeZones(const PolygonIndex& index,
+                                                         const AABB2<PointLL>& aabb);
 /**
  * Get the admin data from the spatialite db given an SQL statement
  * @param  db_handle        sqlite3 db handle
@@ -92,6 +182,24 @@ GetAdminInfo(sqlite3* db_handle,
              const AABB2<PointLL>& aabb,
              GraphTileBuilder& tilebuilder);
 
+/**
+ * Get the admin polys that intersect with the tile bounding box from the preloaded admins, clipped
+ * to the tile. They are added to the tile in the same order as the db query would add them.
+ * @param  index            the admins
+ * @param  drive_on_right   unordered map that indicates if a country drives on right side of the
+ * road
+ * @param  allow_intersection_names   unordered map that indicates if we call out intersections
+ * names for this country
+ * @param  aabb             bb of the tile
+ * @param  tilebuilder      Graph tile builder
+ */
+std::multimap<uint32_t, multi_polygon_type>
+GetAdminInfo(const PolygonIndex& index,
+             std::unordered_map<uint32_t, bool>& drive_on_right,
+             std::unordered_map<uint32_t, bool>& allow_intersection_names,
+             const AABB2<PointLL>& aabb,
+             GraphTileBuilder& tilebuilder);
+
 /**
  * Get all the country access records from the db and save them to a map.
  * @param  db_handle    sqlite3 db handle
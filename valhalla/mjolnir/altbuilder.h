@@ -0,0 +1,33 @@
+#ifndef VALHALLA_MJOLNIR_ALTBUILDER_H
+#define VALHALLA_MJOLNIR_ALTBUILDER_H
+
+#include <cstdint>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to precompute the landmark distances of the ALT (A*, landmarks and the triangle
+ * inequality) heuristic of thor.
+ */
+class AltBuilder {
+public:
+  /**
+   * @brief Pick landmarks spread over the graph and write the network distance between every node
+   *        of the road levels and each of them to a file, see baldr::AltBounds for its layout.
+   * param[in] config          Config used to read the tiles.
+   * param[in] file            Where to write the distances.
+   * param[in] landmark_count  How many landmarks to pick.
+   */
+  static void Build(const boost::property_tree::ptree& config,
+                    const std::string& file,
+                    const uint32_t landmark_count);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_ALTBUILDER_H
@@ -0,0 +1,26 @@
+#ifndef VALHALLA_MJOLNIR_BSSTABLESBUILDER_H
+#define VALHALLA_MJOLNIR_BSSTABLESBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the station to station bicycle rides between bike share stations. This is
+ * an optional step run after the bike share stations have been added to the tiles, it writes the
+ * tables next to the tiles.
+ */
+class BssTablesBuilder {
+public:
+  /**
+   * Build the tables of all stations in the tiles.
+   * @param pt  the config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_BSSTABLESBUILDER_H
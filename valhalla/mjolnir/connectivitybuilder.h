@@ -0,0 +1,43 @@
+#ifndef VALHALLA_MJOLNIR_CONNECTIVITYBUILDER_H
+#define VALHALLA_MJOLNIR_CONNECTIVITYBUILDER_H
+
+#include <cstdint>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Builds the connectivity.bin baldr::connectivity_map_t maps at startup instead of flood filling
+ * the tiles of every level, which takes its time and memory on a planet. Next to the color of
+ * every tile it has the components of every node of the road levels, see baldr::ComponentSet: the
+ * weakly connected components found with a union find and the strongly connected components of
+ * each mode found with Tarjan's algorithm, over the edges and transitions of all nodes held in
+ * memory at once. Most nodes of a tile are in the same component so a tile stores that component
+ * and only the nodes in another one are listed.
+ */
+class ConnectivityBuilder {
+public:
+  struct Stats {
+    uint64_t tiles = 0;      // tiles in the file
+    uint64_t nodes = 0;      // nodes of the road levels
+    uint64_t components = 0;        // weak components they are in
+    uint64_t strong_components = 0; // strong components of all the modes
+    uint64_t listed = 0; // nodes listed because they arent in the component of their tile
+  };
+
+  /**
+   * Build the connectivity of a tileset.
+   * @param config  The mjolnir config, the tiles are read from its tile_dir or tile_extract.
+   * @param file    The file to write, valhalla_build_connectivity writes to the tile_dir.
+   * @return what was written
+   */
+  static Stats Build(const boost::property_tree::ptree& config, const std::string& file);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONNECTIVITYBUILDER_H
@@ -0,0 +1,43 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/contraction.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build contraction hierarchy overlays of the highway level. This is an
+ * optional step run after the hierarchy and shortcuts have been built, it writes one
+ * overlay per costing listed in mjolnir.contraction.costings next to the tiles.
+ */
+class ContractionBuilder {
+public:
+  /**
+   * Build the overlays of all configured costings.
+   * @param pt  the config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+
+  /**
+   * Contracts the nodes of a graph one by one in order of their edge difference, adding
+   * shortcuts between the neighbours of a node whenever a bounded witness search can't find
+   * a path around it which is at least as cheap.
+   * @param node_count   number of nodes in the graph
+   * @param arcs         the edges of the graph, shortcuts are appended
+   * @param max_settled  how many nodes a witness search may settle before giving up
+   * @return the rank of each node, the order in which the nodes were contracted
+   */
+  static std::vector<uint32_t> Contract(const uint32_t node_count,
+                                        std::vector<baldr::ContractionArc>& arcs,
+                                        const uint32_t max_settled = 500);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
@@ -72,7 +72,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
                       sequence<OSMWay>& ways,
                       sequence<OSMWayNode>& way_nodes,
-                      sequence<Edge>& edges,
+                      edge_view_t& edges,
                       sequence<Node>& nodes,
                       const bool inbound,
                       const bool remove_dest_only);
@@ -84,19 +84,20 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
  */
 bool ShortFerry(const uint32_t node_index,
                 node_bundle& bundle,
-                sequence<Edge>& edges,
+                edge_view_t& edges,
                 sequence<Node>& nodes,
-                sequence<OSMWay>& ways,
                 sequence<OSMWayNode>& way_nodes);
 
 /**
  * Reclassify edges from a ferry along the shortest path to the
- * specified road classification.
+ * specified road classification. The ferries are worked on by up to
+ * concurrency threads with the same result as by one.
  */
 void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& way_nodes_file,
                                 const std::string& nodes_file,
-                                const std::string& edges_file);
+                                const std::string& edges_file,
+                                unsigned int concurrency = 1);
 
 } // namespace mjolnir
 } // namespace valhalla
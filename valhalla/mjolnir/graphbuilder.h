@@ -37,6 +37,8 @@ public:
    * in memory
    * @param  pronunciation_file             where to store the to pronunciations so they are not
    * in memory
+   * @param  tiles                          the tiles to build, with the index of their first node,
+   * of which a shard only builds its own
    */
   static void Build(const boost::property_tree::ptree& pt,
                     const OSMData& osmdata,
@@ -49,6 +51,23 @@ public:
                     const std::string& pronunciation_file,
                     const std::map<baldr::GraphId, size_t>& tiles);
 
+  /**
+   * Reclassify links (ramps) and the edges that connect ferries to the road network. Build does
+   * this first unless the tile build is sharded, then it is done once, after the edges are built.
+   * @param  config          properties file
+   * @param  osmdata         OSM data used to build the graph.
+   * @param  ways_file       where the ways are stored
+   * @param  way_nodes_file  where the way nodes are stored
+   * @param  nodes_file      where the node information is stored
+   * @param  edges_file      where the edge information is stored
+   */
+  static void Reclassify(const boost::property_tree::ptree& pt,
+                         const OSMData& osmdata,
+                         const std::string& ways_file,
+                         const std::string& way_nodes_file,
+                         const std::string& nodes_file,
+                         const std::string& edges_file);
+
   static std::map<baldr::GraphId, size_t> BuildEdges(const ptree& conf,
                                                      const std::string& ways_file,
                                                      const std::string& way_nodes_file,
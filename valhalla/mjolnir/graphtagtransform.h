@@ -0,0 +1,33 @@
+#ifndef VALHALLA_MJOLNIR_GRAPHTAGTRANSFORM_H
+#define VALHALLA_MJOLNIR_GRAPHTAGTRANSFORM_H
+
+#include <valhalla/mjolnir/luatagtransform.h>
+#include <valhalla/mjolnir/osmdata.h>
+
+#include <cstdint>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * The rules of lua/graph.lua written out in C++. The tags of a node, way or relation come out the
+ * same as nodes_proc, ways_proc and rels_proc of the lua would give them back, without pushing
+ * them through a lua state one at a time. Changes to lua/graph.lua have to be made here as well,
+ * a script of its own still needs a LuaTagTransform.
+ */
+class GraphTagTransform {
+public:
+  /**
+   * Transforms the tags as lua/graph.lua would
+   * @param type   whether the tags are of a node, a way or a relation
+   * @param osmid  the id of the object, for the log when its tags can't be transformed
+   * @param tags   the osm tags of the object
+   * @return the transformed tags, none if the object is filtered out
+   */
+  Tags Transform(OSMType type, uint64_t osmid, const Tags& tags) const;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_GRAPHTAGTRANSFORM_H
@@ -5,10 +5,12 @@
 #include <boost/functional/hash.hpp>
 #include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -436,10 +438,13 @@ public:
    * @param tile_dir   Base tile directory
    * @param tile       the tile that needs the bins added
    * @param more_bins  the extra bin data to append to the tile
+   * @param drop       the edges it is true for are taken out of the bins the tile already has,
+   *                   so the bins of tiles that are binned again replace their old ones
    */
   static void AddBins(const std::string& tile_dir,
                       const graph_tile_ptr& tile,
-                      const std::array<std::vector<GraphId>, kBinCount>& more_bins);
+                      const std::array<std::vector<GraphId>, kBinCount>& more_bins,
+                      const std::function<bool(const GraphId& edge_id)>& drop = nullptr);
 
   /**
    * Get the turn lane builder at the specified index.
@@ -486,6 +491,71 @@ public:
    */
   void UpdatePredictedSpeeds(const std::vector<DirectedEdge>& directededges);
 
+  /**
+   * Called for every directed edge of a tile whose predicted speeds are patched, it can change
+   * the free flow and constrained flow speeds of the edge and returns whether it filled in a
+   * compressed speed profile for it.
+   */
+  using predicted_speed_patch_t =
+      std::function<bool(const uint32_t idx,
+                         DirectedEdge& directededge,
+                         std::array<int16_t, kCoefficientCount>& coefficients)>;
+
+  /**
+   * Updates the directed edges and replaces the predicted speeds of a tile without decoding the
+   * rest of it, which is copied as it is. The tile is read once and its directed edges are
+   * changed where they lie. The predicted speeds take the place of the ones the tile had when
+   * those were its last section, otherwise they are appended like UpdatePredictedSpeeds does.
+   * The tile is written to a temporary file which is then renamed over the tile.
+   * @param  tile_dir  Base tile directory
+   * @param  graphid   Id of the tile
+   * @param  patch     Called for every directed edge, in order
+   * @return false if there is no uncompressed tile to patch
+   */
+  static bool PatchPredictedSpeeds(const std::string& tile_dir,
+                                   const GraphId& graphid,
+                                   const predicted_speed_patch_t& patch);
+
+  /**
+   * Overwrites the directed edges of a tile where they lie in its file, nothing else of the tile
+   * is read or written. For changes to the attributes of the edges, like their speeds, that
+   * leave everything else as it is.
+   * @param  tile_dir  Base tile directory
+   * @param  graphid   Id of the tile
+   * @param  edges     All the directed edges of the tile, in order
+   * @return false if there is no uncompressed tile with as many directed edges to patch
+   */
+  static bool PatchDirectedEdges(const std::string& tile_dir,
+                                 const GraphId& graphid,
+                                 const std::vector<DirectedEdge>& edges);
+
+  /**
+   * Writes the precomputed reach of the directed edges as the last section of the tile,
+   * replacing a reach section that was the last section already. The tile is written to a
+   * temporary file which is then renamed over the tile so readers never see a partial tile.
+   * @param  max_reach  Reach values are capped at this.
+   * @param  access     Access mode of each column.
+   * @param  reaches    Reach of each directed edge, access.size() records per edge.
+   */
+  void UpdateReachIndex(const uint32_t max_reach,
+                        const std::vector<uint32_t>& access,
+                        const std::vector<EdgeReach>& reaches);
+
+  /**
+   * Writes the opposing edge id of every directed edge into the tile. A tile that has them already
+   * gets them overwritten in place, otherwise they are appended as the last section. The tile is
+   * written to a temporary file which is then renamed over the tile.
+   * @param  opposing_edge_ids  Opposing edge id of each directed edge, invalid if it has none.
+   */
+  void UpdateOpposingEdgeIds(const std::vector<GraphId>& opposing_edge_ids);
+
+  /**
+   * Writes the ascent and descent of every directed edge into the tile, the same way
+   * UpdateOpposingEdgeIds writes its section.
+   * @param  elevations  Elevation summary of each directed edge in its direction of travel.
+   */
+  void UpdateEdgeElevation(const std::vector<baldr::EdgeElevation>& elevations);
+
   /**
    * Adds a landmark to the given edge id by modifying its edgeinfo to add a name and tagged value
    *
@@ -495,6 +565,26 @@ public:
   void AddLandmark(const baldr::GraphId& edge_id, const Landmark& landmark);
 
 protected:
+  /**
+   * Builds the departure index of the transit stops from the sorted departures, see
+   * StopDepartureIndex for its layout.
+   * @return the section as a list of words, empty if the tile has no departures
+   */
+  std::vector<uint32_t> BuildStopDepartureIndex() const;
+
+  /**
+   * Writes a section with a fixed size per directed edge into the tile, overwriting it in place if
+   * the tile has it already and appending it otherwise, via a temporary file renamed over the tile.
+   * @param  offset        Offset of the section if the tile has it, 0 otherwise.
+   * @param  data          The section.
+   * @param  section_size  Size of the section in bytes.
+   * @param  set_offset    The header setter of the offset of the section.
+   */
+  void UpdateSection(size_t offset,
+                     const char* data,
+                     const size_t section_size,
+                     void (GraphTileHeader::*set_offset)(const uint32_t));
+
   struct EdgeTupleHasher {
     std::size_t operator()(const edge_tuple& k) const {
       std::size_t seed = 13;
@@ -585,9 +675,9 @@ protected:
   // The edgeinfo list
   std::list<EdgeInfoBuilder> edgeinfo_list_;
 
-  // Text list offset and map
+  // Text list offset and map, the keys view the strings in the text list
   uint32_t text_list_offset_ = 0;
-  std::unordered_map<std::string, uint32_t> text_offset_map_;
+  std::unordered_map<std::string_view, uint32_t> text_offset_map_;
 
   // Text list. List of names used within this tile
   std::list<std::string> textlistbuilder_;
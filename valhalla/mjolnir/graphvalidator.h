@@ -18,6 +18,12 @@ public:
    * Validate the graph tiles.
    */
   static void Validate(const boost::property_tree::ptree& pt);
+
+  /**
+   * Bin the edges that pass through tiles of other shards into those tiles, once every shard of
+   * a sharded tile build validated its tiles.
+   */
+  static void Merge(const boost::property_tree::ptree& pt);
 };
 
 } // namespace mjolnir
@@ -0,0 +1,60 @@
+#ifndef VALHALLA_MJOLNIR_GTFS_STOP_TIMES_H
+#define VALHALLA_MJOLNIR_GTFS_STOP_TIMES_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * One row of a GTFS stop_times.txt.
+ */
+struct GtfsStopTime {
+  std::string trip_id;
+  std::string stop_id;
+  uint32_t stop_sequence;
+  uint32_t arrival_time;     // seconds from midnight of the service day, 0 if not given
+  uint32_t departure_time;   // seconds from midnight of the service day, 0 if not given
+  float shape_dist_traveled; // 0 if not given
+};
+
+/**
+ * Parse a GTFS time of the form H:MM:SS or HH:MM:SS, hours may go past 24.
+ * @param  time  the time
+ * @return seconds from midnight, 0 if the time is empty or malformed
+ */
+uint32_t parse_gtfs_time(const std::string& time);
+
+/**
+ * Split a line of a GTFS file into its fields. Fields may be quoted to hold commas, quotes within
+ * them are doubled.
+ * @param  line    the line without its line break
+ * @param  fields  the fields, reused between calls
+ */
+void split_gtfs_line(const std::string& line, std::vector<std::string>& fields);
+
+/**
+ * Parse a GTFS stop_times.txt without loading all of it. The file is cut into byte ranges at line
+ * breaks that are parsed on several threads at once, each thread hands its stop times to the
+ * callback in batches so that memory stays bounded by the batches in flight. Quoted fields may hold
+ * commas but no line breaks.
+ * @param  file        path of the stop_times.txt
+ * @param  threads     number of threads to parse with
+ * @param  batch_size  number of stop times per batch
+ * @param  consume     called on the parsing threads with each batch, it may move from the batch
+ * @return the number of stop times parsed
+ * @throws std::runtime_error if the file can't be read or lacks the trip_id, stop_id or
+ *         stop_sequence columns
+ */
+size_t read_gtfs_stop_times(const std::string& file,
+                            unsigned int threads,
+                            size_t batch_size,
+                            const std::function<void(std::vector<GtfsStopTime>&)>& consume);
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_GTFS_STOP_TIMES_H
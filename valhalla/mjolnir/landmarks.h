@@ -77,6 +77,7 @@ protected:
  * This function reads landmark data from PBF files specified in the `input_files` vector.
  * It then parses the data to extract landmark nodes and stores the landmarks in the database.
  * The database is automatically built based on the configuration settings provided in `pt`.
+ * When `landmark_store` is configured the landmarks are written to that store instead.
  *
  * @param pt The configuration settings for the landmark building process.
  * @param input_files A vector of file paths to the PBF input files.
@@ -85,11 +86,20 @@ protected:
 bool BuildLandmarkFromPBF(const boost::property_tree::ptree& pt,
                           const std::vector<std::string>& input_files);
 
+/**
+ * Write a landmark store, see baldr::LandmarkStore. The file is swapped in whole once it is done.
+ *
+ * @param file The path of the store.
+ * @param landmarks The landmarks, their ids are not kept, the ids in the store are the indices
+ *                  the landmarks end up at.
+ */
+void WriteLandmarkStore(const std::string& file, std::vector<baldr::Landmark> landmarks);
+
 /**
  * Add landmarks from the landmark database to graph tiles.
  * This function finds landmarks in each graph tile, retrieves them from the landmark database,
  * associate them with nearby edges, and update the graph tiles with these associations of landmark -
- * edge pairs.
+ * edge pairs. When `landmark_store` is configured the landmarks are read from that store instead.
  *
  * @param pt The configuration settings
  * @return
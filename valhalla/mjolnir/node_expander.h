@@ -1,8 +1,10 @@
 #ifndef VALHALLA_MJOLNIR_NODE_EXPANDER_H_
 #define VALHALLA_MJOLNIR_NODE_EXPANDER_H_
 
+#include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <valhalla/baldr/graphconstants.h>
@@ -242,6 +244,44 @@ struct node_bundle : Node {
   }
 };
 
+/**
+ * The edges as a task that runs in run_in_order sees them. While the task runs speculatively its
+ * changes are kept aside and it sees the edges as they were plus its own changes, otherwise it
+ * changes the edges directly. Either way the edges it reads and the ones it changes are noted.
+ */
+class edge_view_t {
+public:
+  edge_view_t(sequence<Edge>& edges, bool speculative) : edges_(edges), speculative_(speculative) {
+  }
+
+  Edge get(const uint32_t index) {
+    reads_.push_back(index);
+    auto changed = changes_.find(index);
+    return changed != changes_.end() ? changed->second : *edges_[index];
+  }
+
+  void set(const uint32_t index, const Edge& edge) {
+    changes_[index] = edge;
+    if (!speculative_) {
+      edges_[index] = edge;
+    }
+  }
+
+  const std::vector<uint32_t>& reads() const {
+    return reads_;
+  }
+
+  const std::unordered_map<uint32_t, Edge>& changes() const {
+    return changes_;
+  }
+
+protected:
+  sequence<Edge>& edges_;
+  bool speculative_;
+  std::vector<uint32_t> reads_;
+  std::unordered_map<uint32_t, Edge> changes_;
+};
+
 /**
  * Collect node information and edges from the node.
  */
@@ -249,6 +289,47 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
                                sequence<Node>& nodes,
                                sequence<Edge>& edges);
 
+/**
+ * Collect node information and edges from the node as the task of the view sees them.
+ */
+node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
+                               sequence<Node>& nodes,
+                               edge_view_t& edges);
+
+/**
+ * Calls the function with the first node of every bundle of nodes and the bundle. The nodes are
+ * split into as many parts as threads, each of which starts with the first node of a bundle, and
+ * every part is visited by a thread of its own.
+ * @param nodes    the nodes
+ * @param edges    the edges, they are only read
+ * @param threads  the number of parts and threads, at least 1
+ * @param visit    called with the index of the part, the node and its bundle
+ */
+void for_each_bundle(
+    sequence<Node>& nodes,
+    sequence<Edge>& edges,
+    size_t threads,
+    const std::function<
+        void(size_t part, const sequence<Node>::iterator& node_itr, const node_bundle& bundle)>&
+        visit);
+
+/**
+ * Runs tasks that read and change the edges on up to the given number of threads so the edges end
+ * up as if the tasks ran one after the other in order. The tasks run in batches. The tasks of a
+ * batch run at the same time on the edges as they were before the batch, keeping their changes
+ * aside. Then, in order, the changes of each task are applied unless it read an edge that a task
+ * before it in the batch changed, in which case it runs again on the edges as they are by then.
+ * @param count    the number of tasks
+ * @param threads  the number of threads, with 1 the tasks simply run in order
+ * @param edges    the edges the tasks read and change
+ * @param task     runs the task of an index. it may run twice and has to read and change the
+ *                 edges only through the view, anything else it makes goes to a place of its index
+ */
+void run_in_order(size_t count,
+                  size_t threads,
+                  sequence<Edge>& edges,
+                  const std::function<void(size_t index, edge_view_t& edges)>& task);
+
 } // namespace mjolnir
 } // namespace valhalla
 #endif // VALHALLA_MJOLNIR_NODE_EXPANDER_H_
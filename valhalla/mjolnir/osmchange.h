@@ -0,0 +1,55 @@
+#ifndef VALHALLA_MJOLNIR_OSMCHANGE_H
+#define VALHALLA_MJOLNIR_OSMCHANGE_H
+
+#include <cstdint>
+#include <istream>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * What an OSM change file (.osc) touches as far as the graph is concerned: where the nodes it
+ * creates, modifies or deletes are and which ways it changes, directly or as a member of a
+ * changed relation.
+ */
+struct OSMChange {
+  // Positions of the changed nodes, deleted nodes are only here if the file has their position
+  std::vector<midgard::PointLL> node_positions;
+  // Ids of the changed ways and of the ways that changed relations refer to
+  std::unordered_set<uint64_t> way_ids;
+
+  /**
+   * Read the create, modify and delete sections of an osmChange document.
+   * @param osc  The xml of the change file.
+   * @return what the change touches
+   */
+  static OSMChange Read(std::istream& osc);
+};
+
+/**
+ * Find the tiles of an existing graph that have to be rebuilt for a change. These are the tiles
+ * with the changed nodes or with edges of the changed ways, on any level, plus
+ *   - the neighbors of those tiles on the local level, which new ways may reach into
+ *   - the tiles with edges that end at a node of those tiles, whose node indices may move
+ *   - the tiles of the higher levels that contain any of the above, since the hierarchy and the
+ *     shortcuts are formed from the local level within them
+ * A new way that only connects existing, unchanged nodes can not be located from the change
+ * alone, the tiles of the ways it connects to are only found if they changed too.
+ *
+ * @param reader  Reads the graph the change is applied to.
+ * @param change  The change.
+ * @return the ids of the affected tiles, in order
+ */
+std::set<baldr::GraphId> AffectedTiles(baldr::GraphReader& reader, const OSMChange& change);
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_OSMCHANGE_H
@@ -75,6 +75,15 @@ struct OSMData {
    */
   bool read_from_unique_names_file(const std::string& tile_dir);
 
+  /**
+   * Write what is in memory to temporary files and free it, for the low memory build mode.
+   * Parsing the nodes and constructing the edges dont use the way and relation data so it can
+   * stay on disk until read_from_temp_files brings it all back to build the tiles. Until then
+   * write_to_temp_files only writes the counts and the node names, the rest is already there.
+   * @return Returns true if successful, false if an error occurs.
+   */
+  bool release_to_temp_files(const std::string& tile_dir);
+
   /**
    * add the direction information to the forward or reverse map for relations.
    */
@@ -129,6 +138,9 @@ struct OSMData {
   OSMLaneConnectivityMultiMap lane_connectivity_map;
 
   bool initialized = false;
+
+  // Whether the way and relation data is only in the temporary files
+  bool released = false;
 };
 
 } // namespace mjolnir
@@ -32,6 +32,7 @@
 #define __OSMPBFPARSER__
 
 #include <fstream>
+#include <memory>
 #include <string>
 
 // this describes the low-level blob storage
@@ -65,9 +66,24 @@ struct Member {
   Member(Member&& other);
 };
 
+// transforms the tags of objects on the parsing threads before they are called back, every
+// parsing thread gets its own so implementations dont have to be thread safe
+struct TagTransform {
+  virtual ~TagTransform(){};
+  // type is one of NODES, WAYS or RELATIONS, returns false to leave the object untransformed
+  virtual bool
+  transform(const Interest type, const uint64_t osmid, const Tags& tags, Tags& transformed) = 0;
+};
+
 // pure virtual interface for consumers to implement
 struct Callback {
   virtual ~Callback(){};
+  // a transform for one parsing thread, only used when parsing with more than one thread
+  virtual std::unique_ptr<TagTransform> tag_transform() {
+    return nullptr;
+  }
+  // set while an object is called back to what the tag transform made of its tags, if anything
+  const Tags* transformed_tags = nullptr;
   virtual void
   node_callback(const uint64_t osmid, const double lng, const double lat, const Tags& tags) = 0;
   virtual void
@@ -81,8 +97,13 @@ struct Callback {
 class Parser {
 public:
   Parser() = delete;
-  // parse the pbf file for the things you are interested in
-  static void parse(std::ifstream& file, const Interest interest, Callback& callback);
+  // parse the pbf file for the things you are interested in. with more than one thread the blobs
+  // are decompressed, decoded and tag transformed in parallel while the callbacks are still
+  // called one at a time in the order of the file
+  static void parse(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const size_t threads = 1);
   // clean up protobuf library level memory, this will make protobuf unusable after its called
   static void free();
 };
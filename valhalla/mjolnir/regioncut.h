@@ -0,0 +1,56 @@
+#ifndef VALHALLA_MJOLNIR_REGIONCUT_H
+#define VALHALLA_MJOLNIR_REGIONCUT_H
+
+#include <cstdint>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/mjolnir/admin.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Cuts a region out of a built tileset into a tile directory of its own, so a subset of a
+ * tileset is had in minutes instead of a build from an extract of the osm data. Tiles the region
+ * covers are copied as they are unless an edge of theirs leads out of the region. The rest are
+ * written again without the nodes outside the region and the edges that touch those nodes, the
+ * way GraphFilter drops edges, with the ids of the nodes and edges that remain renumbered
+ * everywhere they are referenced: end nodes, opposing edges, node transitions, complex
+ * restrictions and the edge bins. Shortcuts are kept when their whole shape is in the region,
+ * which keeps the edges they supersede.
+ *
+ * Signs, turn lanes, lane connections, access restrictions, names, predicted speeds and elevation
+ * summaries are carried over. Transit is not, the sections added by valhalla_build_reach and
+ * valhalla_build_opposing are dropped from the tiles that are written again.
+ */
+class RegionCut {
+public:
+  struct Stats {
+    uint64_t copied_tiles = 0;  // tiles copied as they are
+    uint64_t rebuilt_tiles = 0; // tiles written again without what was cut
+    uint64_t nodes = 0;         // nodes in the cut tiles
+    uint64_t edges = 0;         // directed edges in the cut tiles
+    uint64_t cut_nodes = 0;     // nodes of the tiles touching the region that were left out
+    uint64_t cut_edges = 0;     // directed edges of those tiles that were left out
+  };
+
+  /**
+   * Cut a region out of a tileset.
+   * @param config   The mjolnir config, the tiles are read from its tile_dir or tile_extract.
+   * @param region   Polygons of the region in longitude and latitude.
+   * @param out_dir  Directory the tiles of the region are written to, not the tile_dir.
+   * @param threads  Number of threads cutting tiles.
+   * @return what was copied, written and cut
+   */
+  static Stats Cut(const boost::property_tree::ptree& config,
+                   multi_polygon_type region,
+                   const std::string& out_dir,
+                   size_t threads);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_REGIONCUT_H
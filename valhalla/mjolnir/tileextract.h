@@ -0,0 +1,74 @@
+#ifndef VALHALLA_MJOLNIR_TILEEXTRACT_H
+#define VALHALLA_MJOLNIR_TILEEXTRACT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Builds the tar of graph tiles that mjolnir.tile_extract points at. The tar starts with the
+ * index.bin file GraphReader loads the tile locations from, so it never has to scan the tar.
+ * The tiles follow ordered by hierarchy level and then along a Hilbert curve over the tile grid
+ * of the level, so tiles that are close on the map are close in the file and routing touches
+ * fewer pages. Every offset is known before anything is written, which lets the tiles be
+ * copied into the tar on multiple threads.
+ */
+class TileExtract {
+public:
+  // Where a tile goes in the tar
+  struct Tile {
+    baldr::GraphId id;
+    std::string path;    // the tile file
+    uint64_t size = 0;   // bytes of the tile
+    uint64_t offset = 0; // byte offset of the tile data, its tar header comes right before it
+  };
+
+  /**
+   * Position of a tile along the Hilbert curve that covers the tile grid of its level.
+   * @param tile_id  The tile.
+   * @return the distance along the curve, only comparable between tiles of the same level
+   */
+  static uint64_t HilbertIndex(const baldr::GraphId& tile_id);
+
+  /**
+   * Find the tiles in a tile directory and lay them out in the order and at the offsets they
+   * will have in the tar.
+   * @param tile_dir  Directory of the tiles.
+   * @return the tiles in the order they go in the tar
+   */
+  static std::vector<Tile> Layout(const std::string& tile_dir);
+
+  /**
+   * Write the tiles of a tile directory to a tar, replacing the file if there is one.
+   * @param tile_dir  Directory of the tiles.
+   * @param extract   The tar to write.
+   * @param threads   Number of threads copying tiles into the tar.
+   * @return the number of tiles in the tar
+   */
+  static size_t Build(const std::string& tile_dir, const std::string& extract, size_t threads);
+
+  /**
+   * Write the tar of live traffic that mjolnir.traffic_extract points at, replacing the file if
+   * there is one. It has a traffic tile for every graph tile the config reads, from its tile
+   * extract or its tile directory, in the same order and with the same index as Build uses. A
+   * traffic tile is a TrafficTileHeader and a TrafficSpeed per directed edge, the speeds start
+   * out unknown. Every speed is 8 bytes aligned so live traffic can be written into the mapped
+   * tar with atomic stores.
+   * @param config   The mjolnir config with the tiles, its traffic_extract is ignored.
+   * @param extract  The tar to write.
+   * @return the number of traffic tiles in the tar
+   */
+  static size_t BuildTraffic(const boost::property_tree::ptree& config, const std::string& extract);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_TILEEXTRACT_H
@@ -0,0 +1,119 @@
+#ifndef VALHALLA_MJOLNIR_TILESCHEDULER_H
+#define VALHALLA_MJOLNIR_TILESCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Hands out the tiles of a per-tile build stage to its worker threads. The cost of a tile varies
+ * by orders of magnitude between a dense city and the countryside, so a shared queue in random
+ * order tends to leave one thread working on a big tile while the others are idle. Instead the
+ * tiles are dealt to the workers from the costliest to the cheapest, each worker works through
+ * its own tiles in that order and steals the cheapest tiles of the others once it runs out.
+ *
+ * Stages that read the neighbours of their tiles can have the tiles dealt out in batches of tiles
+ * that are next to each other along a Hilbert curve, so a worker finds the neighbours of the
+ * tile it works on in its tile cache more often than not.
+ *
+ * Workers identify themselves by their index, from 0 to workers() - 1. When they are all done
+ * LogUtilization reports how much of the threads' time was spent working, which shows how
+ * many cores were idle during the stage.
+ */
+class TileScheduler {
+public:
+  // Estimates the cost of a tile, only the order of the costs matters
+  using cost_t = std::function<uint64_t(const baldr::GraphId&)>;
+
+  // Batch size for stages that read the neighbours of their tiles
+  static constexpr size_t kNeighbourBatch = 16;
+
+  /**
+   * @param stage    Name of the stage, for the log.
+   * @param tiles    Tiles to work on.
+   * @param workers  Number of worker threads, at least 1.
+   * @param cost     Cost of a tile, the tiles are handed out in the given order without it.
+   * @param batch    Number of neighbouring tiles dealt out together, the costliest batches first.
+   *                 The tiles of a batch are worked on one after the other.
+   */
+  TileScheduler(const std::string& stage,
+                const std::vector<baldr::GraphId>& tiles,
+                size_t workers,
+                const cost_t& cost = nullptr,
+                size_t batch = 1);
+
+  /**
+   * Cost of a tile by the size of its file in a directory, which is the size it had when the
+   * previous stage or run wrote it. Tiles without a file cost nothing.
+   * @param dir     Directory of the tiles.
+   * @param suffix  File name suffix of the tiles.
+   */
+  static cost_t FileSize(const std::string& dir, const std::string& suffix = ".gph");
+
+  /**
+   * Get the next tile a worker should work on, from its own tiles or else stolen from another
+   * worker.
+   * @param worker   Index of the worker.
+   * @param tile_id  The next tile, when there is one.
+   * @return false when there are no tiles left for anyone
+   */
+  bool Next(size_t worker, baldr::GraphId& tile_id);
+
+  /**
+   * Log the wall and CPU time of the stage and the utilization of the workers. Call it after
+   * all workers are done.
+   */
+  void LogUtilization() const;
+
+  size_t workers() const {
+    return workers_.size();
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  // Utilization of the workers, the CPU time they used over the time they could have used
+  float utilization() const;
+
+  // Number of tiles workers took from another worker
+  size_t steals() const;
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  struct worker_t {
+    std::mutex lock;
+    std::deque<baldr::GraphId> tiles;
+    // Accounting, only written by the worker itself
+    bool started = false;
+    bool finished = false;
+    clock_t::time_point start, end;
+    double cpu_start = 0, cpu_seconds = 0;
+    size_t steals = 0;
+  };
+
+  // Take the costliest tile of a worker
+  bool pop_front(worker_t& worker, baldr::GraphId& tile_id);
+  // Take the cheapest tile of a worker
+  bool pop_back(worker_t& worker, baldr::GraphId& tile_id);
+
+  std::string stage_;
+  size_t size_;
+  std::vector<std::unique_ptr<worker_t>> workers_;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_TILESCHEDULER_H
@@ -6,6 +6,7 @@
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <sqlite3.h>
@@ -40,7 +41,9 @@ enum class BuildStage : int8_t {
   kRestrictions = 12,
   kElevation = 13,
   kValidate = 14,
-  kCleanup = 15
+  kMerge = 15,
+  kConnectivity = 16,
+  kCleanup = 17
 };
 
 constexpr uint8_t kMinor = 1;
@@ -65,6 +68,8 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
+       {"merge", BuildStage::kMerge},
+       {"connectivity", BuildStage::kConnectivity},
        {"cleanup", BuildStage::kCleanup}};
 
   auto i = stringToBuildStage.find(s);
@@ -89,6 +94,8 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
+       {static_cast<int8_t>(BuildStage::kMerge), "merge"},
+       {static_cast<int8_t>(BuildStage::kConnectivity), "connectivity"},
        {static_cast<int8_t>(BuildStage::kCleanup), "cleanup"}};
 
   auto i = BuildStageStrings.find(static_cast<int8_t>(stg));
@@ -145,7 +152,8 @@ std::shared_ptr<void> make_spatialite_cache(sqlite3* handle);
  * @param end_stage     End stage of the pipeline to run
  * @param release_osmpbf_memory Free PBF parsing libs after use.  Saves RAM, but makes libprotobuf
  * unusable afterwards.  Set to false if you need to perform protobuf operations after building tiles.
- * @return Returns true if no errors occur, false if an error occurs.
+ * @return Returns true if no errors occur, false if an error occurs. A shard (see TileShard) that is
+ * asked to run a stage that is split by tile together with any other stage fails.
  */
 bool build_tile_set(const ptree& config,
                     const std::vector<std::string>& input_files,
@@ -153,6 +161,77 @@ bool build_tile_set(const ptree& config,
                     const BuildStage end_stage = BuildStage::kValidate,
                     const bool release_osmpbf_memory = true);
 
+/**
+ * One of several processes, possibly on different machines, that share a tile build. The per-tile
+ * stages (build, enhance, elevation and validate) of each shard only work on its part of the tiles,
+ * the other stages only run in the first shard. All shards use the same tile_dir, every stage has
+ * to be done in all shards before the next one starts, and the tiles edges pass through are binned
+ * in the merge stage once they all validated their tiles. The shard comes from mjolnir.shard.index
+ * and mjolnir.shard.count, a single process builds everything when they are not set.
+ */
+struct TileShard {
+  uint32_t index = 0;
+  uint32_t count = 1;
+
+  static TileShard FromConfig(const ptree& config);
+
+  bool sharded() const {
+    return count > 1;
+  }
+
+  // Whether this shard runs the stages that are not split by tile
+  bool shared() const {
+    return index == 0;
+  }
+
+  /**
+   * The tiles of this shard. The tiles are ordered by level and tile id and split into as many
+   * ranges of the same size as there are shards, so every shard that is given the same tiles gets
+   * a range of its own.
+   * @param tiles  All the tiles of the stage.
+   * @return the tiles of this shard, ordered by level and tile id
+   */
+  std::vector<baldr::GraphId> Select(std::vector<baldr::GraphId> tiles) const;
+};
+
+/**
+ * The tiles that changed since the tiles were last validated. The stages and tools that write
+ * tiles record them in the changed tiles file of the tile_dir, so the validate stage, which may
+ * run in another process, only validates and bins those tiles and their neighbours. Stages that
+ * write the whole graph record that all tiles changed, and so does a missing file, which is what
+ * a tile build starts with as the initialize stage removes it. Validating clears the file.
+ */
+struct TileChanges {
+  // whether all tiles changed, otherwise only the tiles do
+  bool all = false;
+  std::unordered_set<baldr::GraphId> tiles;
+
+  /**
+   * Records that the tiles changed, on top of what was recorded before.
+   * @param tile_dir  Directory of the tiles.
+   * @param tiles     The tiles, at any level.
+   */
+  static void Record(const std::string& tile_dir, const std::vector<baldr::GraphId>& tiles);
+
+  /**
+   * Records that all tiles changed.
+   * @param tile_dir  Directory of the tiles.
+   */
+  static void RecordAll(const std::string& tile_dir);
+
+  /**
+   * @param tile_dir  Directory of the tiles.
+   * @return the changes recorded since the tiles were last validated
+   */
+  static TileChanges Read(const std::string& tile_dir);
+
+  /**
+   * Forgets about the changes, once the tiles are validated.
+   * @param tile_dir  Directory of the tiles.
+   */
+  static void Clear(const std::string& tile_dir);
+};
+
 // The tile manifest is a JSON-serializable index of tiles to be processed during the build stage of
 // valhalla_build_tiles'. It can be used to distribute shard keys when building tiles with
 // parallelized, distributed batch processing. For example, a workflow orchestrator can partition
@@ -32,6 +32,10 @@ public:
     return trip_path_.shape();
   }
 
+  const ::google::protobuf::RepeatedPtrField<::valhalla::ZoomShape>& zoom_shapes() const {
+    return trip_path_.zoom_shapes();
+  }
+
   int node_size() const {
     return trip_path_.node_size();
   }
@@ -88,13 +92,15 @@ public:
     return trip_path_.bbox();
   }
 
-  std::unique_ptr<EnhancedTripLeg_Node> GetEnhancedNode(const int node_index);
+  // The wrappers are made on the first lookup of a node or edge and belong to the EnhancedTripLeg,
+  // so later lookups of the same node or edge neither allocate nor copy
+  EnhancedTripLeg_Node* GetEnhancedNode(const int node_index);
 
-  std::unique_ptr<EnhancedTripLeg_Edge> GetPrevEdge(const int node_index, int delta = 1);
+  EnhancedTripLeg_Edge* GetPrevEdge(const int node_index, int delta = 1);
 
-  std::unique_ptr<EnhancedTripLeg_Edge> GetCurrEdge(const int node_index) const;
+  EnhancedTripLeg_Edge* GetCurrEdge(const int node_index) const;
 
-  std::unique_ptr<EnhancedTripLeg_Edge> GetNextEdge(const int node_index, int delta = 1) const;
+  EnhancedTripLeg_Edge* GetNextEdge(const int node_index, int delta = 1) const;
 
   bool IsValidNodeIndex(int node_index) const;
 
@@ -117,7 +123,14 @@ public:
   float GetLength(const Options::Units& units);
 
 protected:
+  // the wrapper of the edge of a node, making it on the first lookup
+  EnhancedTripLeg_Edge* GetEdge(const int node_index) const;
+
   TripLeg& trip_path_;
+  // the wrappers of the nodes and of their edges, made on their first lookup and kept for the
+  // lookups after it, which odin makes several times per node
+  mutable std::vector<std::unique_ptr<EnhancedTripLeg_Node>> nodes_;
+  mutable std::vector<std::unique_ptr<EnhancedTripLeg_Edge>> edges_;
 };
 
 class EnhancedTripLeg_Edge {
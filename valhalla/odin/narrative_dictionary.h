@@ -1,9 +1,11 @@
 #ifndef VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 #define VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 
+#include <initializer_list>
 #include <locale>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -158,13 +160,62 @@ constexpr auto kTransitPlatformCountTag = "<TRANSIT_STOP_COUNT>";
 constexpr auto kTransitPlatformCountLabelTag = "<TRANSIT_STOP_COUNT_LABEL>";
 constexpr auto kLevelTag = "<LEVEL>";
 
+// The tags a phrase template recognizes, any other text between angle brackets is kept as is
+constexpr const char* kPhraseTags[] = {kCardinalDirectionTag, kRelativeDirectionTag, kOrdinalValueTag,
+                                       kStreetNamesTag, kPreviousStreetNamesTag, kBeginStreetNamesTag,
+                                       kCrossStreetNamesTag, kRoundaboutExitStreetNamesTag,
+                                       kRoundaboutExitBeginStreetNamesTag, kRampExitNumbersVisualTag,
+                                       kLengthTag, kDestinationTag, kCurrentVerbalCueTag,
+                                       kNextVerbalCueTag, kNumberSignTag, kBranchSignTag,
+                                       kTowardSignTag, kNameSignTag, kJunctionNameTag, kFerryLabelTag,
+                                       kTransitPlatformTag, kStationLabelTag, kTimeTag,
+                                       kTransitNameTag, kTransitHeadSignTag, kTransitPlatformCountTag,
+                                       kTransitPlatformCountLabelTag, kLevelTag};
+
 } // namespace
 
 namespace valhalla {
 namespace odin {
 
+/**
+ * A phrase parsed once into the text between its tags and the tags themselves. Filling it appends
+ * each part once to the instruction instead of searching the whole phrase for every tag.
+ */
+class PhraseTemplate {
+public:
+  // The value of a tag of a phrase
+  struct TagValue {
+    const char* tag;
+    const std::string& value;
+  };
+  // The values of the tags of a phrase, a tag without a value is kept as is
+  using TagValues = std::initializer_list<TagValue>;
+
+  PhraseTemplate() = default;
+
+  /**
+   * Parses the specified phrase.
+   * @param  phrase  the tagged phrase
+   */
+  explicit PhraseTemplate(const std::string& phrase);
+
+  /**
+   * Sets the instruction to the phrase with its tags replaced by their values. The instruction
+   * keeps its capacity so it can be reused.
+   * @param  instruction  the instruction to set
+   * @param  values       the tags and their values, a tag is one of kPhraseTags
+   */
+  void Fill(std::string& instruction, TagValues values) const;
+
+protected:
+  // The text before each tag and the tag, the tag of the text after the last tag is nullptr
+  std::vector<std::pair<std::string, const char*>> parts_;
+};
+
 struct PhraseSet {
   std::unordered_map<std::string, std::string> phrases;
+  // The phrases parsed into templates, indexed by phrase id
+  std::vector<PhraseTemplate> templates;
 };
 
 struct StartSubset : PhraseSet {
@@ -76,12 +76,28 @@ std::string get_localized_date(const std::string& date_time, const std::locale&
 
 using locales_singleton_t = std::unordered_map<std::string, std::shared_ptr<NarrativeDictionary>>;
 /**
- * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information
+ * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information.
+ * This parses every locale, get_locale() only parses the one asked for.
  *
  * @return the map of locales to NarrativeDictionaries
  */
 const locales_singleton_t& get_locales();
 
+/**
+ * Returns the NarrativeDictionary of a locale or one of its aliases, parsing only that locale on
+ * its first use so a language costs nothing until it is asked for
+ * @param language  the locale or alias
+ * @return the dictionary or nullptr when there is no such locale
+ */
+std::shared_ptr<NarrativeDictionary> get_locale(const std::string& language);
+
+/**
+ * Returns whether there is a locale or an alias of one by this name, without parsing any locale
+ * @param language  the locale or alias
+ * @return true if there is such a locale
+ */
+bool has_locale(const std::string& language);
+
 /**
  * Returns locale strings mapped to json strings defining the dictionaries
  *
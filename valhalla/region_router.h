@@ -0,0 +1,108 @@
+#ifndef __VALHALLA_REGION_ROUTER_H__
+#define __VALHALLA_REGION_ROUTER_H__
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/proto/api.pb.h>
+
+#ifdef HAVE_HTTP
+#include <prime_server/prime_server.hpp>
+#endif
+
+namespace valhalla {
+
+/**
+ * Picks which of several regional deployments answers a request, for planets that are split into
+ * regional tile sets served by clusters of their own. A region covers the area of its polygons or
+ * of the tiles in its tile set, whose names are only listed and never loaded. A request goes to the
+ * first region that covers all of its locations. Requests between regions, requests without
+ * locations and requests that do not parse go to the fallback, which has the whole planet.
+ *
+ * The router only parses the requests, so it needs neither tiles nor much memory and can sit in
+ * front of the clusters. Adding a region then only adds the memory of its own tiles to one cluster.
+ */
+class region_router_t {
+public:
+  struct region_t {
+    std::string name;
+    // where the requests of the region go, the path and query of a request are appended to it
+    std::string url;
+    // the polygons covering the region, each a ring of longitude and latitude
+    std::vector<std::vector<midgard::PointLL>> polygons;
+    // or the local level tiles of its tile set
+    std::unordered_set<uint32_t> tiles;
+    // everything the region covers is within these bounds
+    midgard::AABB2<midgard::PointLL> bounds;
+
+    /**
+     * @param  ll  a location
+     * @return whether the region covers the location
+     */
+    bool covers(const midgard::PointLL& ll) const;
+  };
+
+  /**
+   * Reads the regions and the fallback from router.regions and router.fallback. A region has a
+   * name, the url of its cluster and either polygons, an array of rings of [lon, lat], or the
+   * tile_dir or tile_extract of its tile set.
+   * @param config  the whole config
+   */
+  explicit region_router_t(const boost::property_tree::ptree& config);
+
+  /**
+   * The region a request goes to
+   * @param request  the parsed request
+   * @return the first region covering all the locations of the request, else the fallback
+   */
+  const region_t& route(const Api& request) const;
+
+  /**
+   * @return the regions in the order they are tried in
+   */
+  const std::vector<region_t>& regions() const {
+    return regions_;
+  }
+
+  /**
+   * @return where requests no region covers go
+   */
+  const region_t& fallback() const {
+    return fallback_;
+  }
+
+#ifdef HAVE_HTTP
+  /**
+   * Answers an http request with a redirect to the cluster of its region
+   * @param job           the http request
+   * @param request_info  the http request info
+   * @return the redirect
+   */
+  prime_server::worker_t::result_t work(const std::list<zmq::message_t>& job,
+                                        void* request_info) const;
+#endif
+
+protected:
+  std::vector<region_t> regions_;
+  region_t fallback_;
+};
+
+#ifdef HAVE_HTTP
+/**
+ * Runs the http server of the router on router.service.listen with router.service.concurrency
+ * workers, it does not return.
+ * @param config  the whole config
+ */
+void run_region_router(const boost::property_tree::ptree& config);
+#endif
+
+} // namespace valhalla
+
+#endif // __VALHALLA_REGION_ROUTER_H__
@@ -0,0 +1,101 @@
+#ifndef __VALHALLA_RESULT_CACHE_H__
+#define __VALHALLA_RESULT_CACHE_H__
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+
+/**
+ * Keeps the results of requests for a while so exact repeats of a request skip loki, thor and odin.
+ * Requests are keyed by a hash of their options right after parsing, leaving out the id and jsonp
+ * which only change how the results are serialized. A hit gets the whole Api of the first request
+ * with its own id and jsonp so it is serialized like it was computed. Entries expire after a time
+ * to live, the least recently used ones are dropped to stay within a byte budget and all of them
+ * are dropped when the live traffic changes.
+ *
+ * The service workers of a process share one cache so it only has hits when loki runs in the same
+ * process as the workers that finish the requests, like it does in valhalla_service.
+ */
+class result_cache_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  /**
+   * @param max_bytes  the most bytes of results to keep
+   * @param ttl        how long a result is kept
+   */
+  result_cache_t(size_t max_bytes, std::chrono::seconds ttl);
+
+  /**
+   * The cache of the process as configured in httpd.service.result_cache
+   * @param config  the whole config
+   * @return the cache, nullptr if it is not enabled
+   */
+  static std::shared_ptr<result_cache_t> shared(const boost::property_tree::ptree& config);
+
+  /**
+   * The key of a request, the same for requests with the same options but for their id and jsonp
+   * @param request  the parsed request
+   * @return the key, never 0
+   */
+  static uint64_t key(const Api& request);
+
+  /**
+   * Replace a request with the results of the first request with the same cache key
+   * @param request          the request with its cache key in its info
+   * @param traffic_version  returns something that changes when the live traffic changes, it is
+   *                         called at most once a second
+   * @return true if the request now has the results
+   */
+  bool get(Api& request, const std::function<uint64_t()>& traffic_version = nullptr);
+
+  /**
+   * Keep the results of a request with a cache key in its info, before they are serialized
+   * @param request  the request with its results
+   */
+  void put(const Api& request);
+
+  /**
+   * @return the number of results that are kept
+   */
+  size_t size() const;
+
+  /**
+   * @return the bytes of the results that are kept
+   */
+  size_t bytes() const;
+
+protected:
+  struct entry_t {
+    uint64_t key;
+    std::string result;
+    clock_t::time_point expires;
+  };
+
+  // drop an entry, the lock must be held
+  void erase(std::list<entry_t>::iterator entry);
+
+  size_t max_bytes;
+  std::chrono::seconds ttl;
+  mutable std::mutex mutex;
+  std::list<entry_t> entries; // most recently used first
+  std::unordered_map<uint64_t, std::list<entry_t>::iterator> index;
+  size_t used_bytes;
+  uint64_t traffic_seen; // the traffic version the results were computed with
+  clock_t::time_point traffic_checked;
+};
+
+} // namespace valhalla
+
+#endif // __VALHALLA_RESULT_CACHE_H__
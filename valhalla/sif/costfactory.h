@@ -4,6 +4,8 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include <valhalla/baldr/rapidjson_utils.h>
 #include <valhalla/proto/options.pb.h>
@@ -22,10 +24,16 @@ namespace valhalla {
 namespace sif {
 
 /**
- * Generic factory class for creating objects based on type name.
+ * Generic factory class for creating objects based on type name. Requests mostly share their
+ * costing options, so the factory keeps the costing it created for a set of options and hands out
+ * copies of it (see DynamicCost::Clone) with the exclude edges of each request added. A factory is
+ * not meant to be shared between threads.
  */
 class CostFactory {
 public:
+  // How many costings a factory keeps before it starts over
+  static constexpr size_t kMaxCachedCostings = 256;
+
   using factory_function_t = std::function<cost_ptr_t(const Costing& options)>;
 
   /**
@@ -56,6 +64,7 @@ public:
   void Register(const Costing::Type costing, factory_function_t function) {
     factory_funcs_.erase(costing);
     factory_funcs_.emplace(costing, function);
+    cache_.clear();
   }
 
   /**
@@ -94,8 +103,41 @@ public:
       auto costing_str = Costing_Enum_Name(costing.type());
       throw std::runtime_error("No costing method found for '" + costing_str + "'");
     }
-    // create the cost using the function pointer
-    return itr->second(costing);
+
+    // the exclude edges differ per request, they are added to a copy of the costing without them
+    const bool has_exclude_edges = costing.options().exclude_edges_size() > 0;
+    Costing shared_costing;
+    if (has_exclude_edges) {
+      shared_costing = costing;
+      shared_costing.mutable_options()->clear_exclude_edges();
+    }
+    const auto& key_costing = has_exclude_edges ? shared_costing : costing;
+    auto key = key_costing.SerializeAsString();
+
+    auto cached = cache_.find(key);
+    if (cached == cache_.end()) {
+      // create the cost using the function pointer
+      auto cost = itr->second(key_costing);
+      if (!cost->Clone()) {
+        // this costing cannot be copied so it is created for every request
+        return has_exclude_edges ? itr->second(costing) : cost;
+      }
+      if (cache_.size() >= kMaxCachedCostings) {
+        cache_.clear();
+      }
+      cached = cache_.emplace(std::move(key), std::move(cost)).first;
+    }
+
+    auto cost = cached->second->Clone();
+    if (has_exclude_edges) {
+      std::vector<AvoidEdge> exclude_edges;
+      exclude_edges.reserve(costing.options().exclude_edges_size());
+      for (const auto& edge : costing.options().exclude_edges()) {
+        exclude_edges.push_back({baldr::GraphId(edge.id()), edge.percent_along()});
+      }
+      cost->AddUserAvoidEdges(exclude_edges);
+    }
+    return cost;
   }
 
   mode_costing_t CreateModeCosting(const Options& options, TravelMode& mode) {
@@ -120,6 +162,8 @@ public:
 
 private:
   std::map<const Costing::Type, factory_function_t> factory_funcs_;
+  // the costings created so far by their serialized options without exclude edges
+  mutable std::unordered_map<std::string, cost_ptr_t> cache_;
 };
 
 } // namespace sif
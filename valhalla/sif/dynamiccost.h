@@ -1,11 +1,14 @@
 #ifndef VALHALLA_SIF_DYNAMICCOST_H_
 #define VALHALLA_SIF_DYNAMICCOST_H_
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <valhalla/baldr/accessrestriction.h>
 #include <valhalla/baldr/datetime.h>
 #include <valhalla/baldr/directededge.h>
 #include <valhalla/baldr/double_bucket_queue.h> // For kInvalidLabel
+#include <valhalla/baldr/edgetable.h>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
@@ -14,6 +17,7 @@
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/baldr/timedomain.h>
 #include <valhalla/baldr/transitdeparture.h>
+#include <valhalla/midgard/constants.h>
 #include <valhalla/midgard/logging.h>
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/costconstants.h>
@@ -112,6 +116,10 @@ constexpr float kTCUnfavorableUturn = 600.f;
 // Maximum highway avoidance bias (modulates the highway factors based on road class)
 constexpr float kMaxHighwayBiasFactor = 8.0f;
 
+// Number of answers each thread keeps about which conditional access restrictions are active
+constexpr uint32_t kConditionalAnswersBits = 10;
+constexpr uint32_t kConditionalAnswers = 1 << kConditionalAnswersBits;
+
 /**
  * Mask values used in the allowed function by loki::reach to control how conservative
  * the decision should be. By default allowed methods will not disallow start/end/simple
@@ -124,6 +132,87 @@ constexpr uint16_t kDisallowSimpleRestriction = 0x4;
 constexpr uint16_t kDisallowClosure = 0x8;
 constexpr uint16_t kDisallowShortcut = 0x10;
 
+/**
+ * What evaluating an edge for an expansion yields, see DynamicCost::EvaluateEdge.
+ */
+struct EdgeEvaluation {
+  // the cost of the edge itself (of the opposing edge in reverse)
+  Cost edge_cost;
+  // the cost of the transition onto the edge from the predecessor
+  Cost transition_cost;
+  // the speed sources the edge cost came from
+  uint8_t flow_sources = 0;
+  // the access restriction Allowed found on the edge
+  uint8_t restriction_idx = baldr::kInvalidRestriction;
+};
+
+/**
+ * The edges a request excludes as a bitset of edge ids per tile, so that telling whether an edge
+ * is excluded is a bit test. Requests exclude the edges of few tiles which are therefore kept in a
+ * sorted vector rather than hashed.
+ */
+class ExcludedEdges {
+public:
+  /**
+   * Excludes an edge.
+   * @param  edgeid  Directed edge Id.
+   */
+  void set(const baldr::GraphId& edgeid);
+
+  /**
+   * Is the edge excluded.
+   * @param  edgeid  Directed edge Id.
+   * @return Returns true if the edge was set.
+   */
+  bool get(const baldr::GraphId& edgeid) const {
+    if (tiles_.empty()) {
+      return false;
+    }
+    auto tile = find(edgeid.Tile_Base());
+    if (tile == tiles_.end() || tile->first != edgeid.Tile_Base()) {
+      return false;
+    }
+    const uint64_t word = edgeid.id() / 64;
+    return word < tile->second.size() && ((tile->second[word] >> (edgeid.id() % 64)) & 1);
+  }
+
+  bool empty() const {
+    return tiles_.empty();
+  }
+
+protected:
+  using tile_bits_t = std::pair<baldr::GraphId, std::vector<uint64_t>>;
+
+  std::vector<tile_bits_t>::const_iterator find(const baldr::GraphId& tile_id) const {
+    return std::lower_bound(tiles_.begin(), tiles_.end(), tile_id,
+                            [](const tile_bits_t& a, const baldr::GraphId& b) {
+                              return a.first < b;
+                            });
+  }
+
+  std::vector<tile_bits_t> tiles_;
+};
+
+/**
+ * Lays the turn costs of a costing out in the order of TurnClass::cost_index.
+ * @param  right     turn costs by turn type when driving on the right
+ * @param  left      turn costs by turn type when driving on the left
+ * @param  crossing  turn cost of crossing a road that has edges on both sides
+ * @return the turn costs by turn class
+ */
+constexpr std::array<float, baldr::kTurnCostIndexCount>
+TurnClassCosts(const float (&right)[baldr::kLeftSideTurnCostIndex],
+               const float (&left)[baldr::kLeftSideTurnCostIndex],
+               const float crossing) {
+  std::array<float, baldr::kTurnCostIndexCount> costs{};
+  for (uint32_t i = 0; i < baldr::kLeftSideTurnCostIndex; ++i) {
+    costs[i] = right[i];
+    costs[baldr::kLeftSideTurnCostIndex + i] = left[i];
+  }
+  costs[baldr::kCrossingTurnCostIndex] = crossing;
+  return costs;
+}
+
 /**
  * Base class for dynamic edge costing. This class defines the interface for
  * costing methods and includes a few base methods that define default behavior
@@ -153,9 +242,15 @@ public:
 
   virtual ~DynamicCost();
 
-  DynamicCost(const DynamicCost&) = delete;
   DynamicCost& operator=(const DynamicCost&) = delete;
 
+  /**
+   * Copies the costing with its current state. CostFactory keeps one costing per set of costing
+   * options and hands out copies of it, so a costing model overrides this to be cached.
+   * @return Returns a copy of the costing, nullptr if the costing cannot be copied.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const;
+
   /**
    * Does the costing method allow multiple passes (with relaxed
    * hierarchy limits).
@@ -163,6 +258,14 @@ public:
    */
   virtual bool AllowMultiPass() const;
 
+  /**
+   * Whether a matrix between the same locations may be computed one way and mirrored. The costing
+   * has to go along every edge in both directions and charge about the same for each, requests
+   * then accept that grades and turn restrictions can make the two ways differ.
+   * @return  Returns true if the costing allows symmetric matrices.
+   */
+  virtual bool AllowSymmetricMatrix() const;
+
   /**
    * Get the pass number.
    * @return  Returns the pass through the algorithm.
@@ -202,6 +305,15 @@ public:
     return access_mask_;
   }
 
+  /**
+   * Whether the costing may use edges its access mode has no access to or use them against the
+   * direction it has access in, which ignore_access and ignore_oneways let it do.
+   * @return  Returns true if it keeps to neither the access nor the oneways of the edges.
+   */
+  bool IgnoresAccess() const {
+    return ignore_access_ || ignore_oneways_;
+  }
+
   /**
    * Checks if access is allowed for the provided directed edge.
    * This is generally based on mode of travel and the access modes
@@ -350,6 +462,10 @@ public:
    */
   virtual Cost EdgeCost(const baldr::DirectedEdge* edge, const graph_tile_ptr& tile) const;
 
+  // Whether the costing has TransitionCost and TransitionCostReverse overloads taking the turn
+  // class of the transition, which EvaluateEdge and EvaluateEdgeReverse then look up in the tile
+  static constexpr bool kTurnClasses = false;
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -385,6 +501,65 @@ public:
                                      const bool has_measured_speed = false,
                                      const InternalTurn internal_turn = InternalTurn::kNoTurn) const;
 
+  /**
+   * Checks if access is allowed onto an edge after the predecessor and if so gets the cost of the
+   * edge and of the transition onto it, Allowed, EdgeCost and TransitionCost in one call. The
+   * expansions of the path algorithms call this per edge, the costing models override it (see
+   * VALHALLA_SIF_EVALUATE_EDGE) so the three calls are resolved at compile time and inlined into
+   * each other, leaving one virtual call per edge instead of three.
+   * @param  edge          Pointer to a directed edge.
+   * @param  is_dest       Is a directed edge the destination?
+   * @param  pred          Predecessor edge information.
+   * @param  tile          Current tile.
+   * @param  edgeid        GraphId of the directed edge.
+   * @param  node          Node (intersection) where the transition occurs.
+   * @param  time_info     Time info for the speed lookup of the edge cost.
+   * @param  current_time  Current time (seconds since epoch) for access, 0 if not time dependent.
+   * @param  tz_index      timezone index for the node
+   * @param  evaluation    gets the costs, flow sources and restriction index if allowed
+   * @return Returns true if access is allowed, false if not.
+   */
+  virtual bool EvaluateEdge(const baldr::DirectedEdge* edge,
+                            const bool is_dest,
+                            const EdgeLabel& pred,
+                            const graph_tile_ptr& tile,
+                            const baldr::GraphId& edgeid,
+                            const baldr::NodeInfo* node,
+                            const baldr::TimeInfo& time_info,
+                            const uint64_t current_time,
+                            const uint32_t tz_index,
+                            EdgeEvaluation& evaluation) const;
+
+  /**
+   * The reverse search counterpart of EvaluateEdge, AllowedReverse, EdgeCost of the opposing edge
+   * and TransitionCostReverse (with the measured speed of the edge) in one call.
+   * @param  edge           Pointer to a directed edge.
+   * @param  pred           Predecessor edge information.
+   * @param  opp_edge       Pointer to the opposing directed edge.
+   * @param  opp_tile       Tile of the opposing edge.
+   * @param  opp_edgeid     GraphId of the opposing edge.
+   * @param  node           Node (intersection) where the transition occurs.
+   * @param  opp_pred_edge  Pointer to the opposing directed edge to the predecessor.
+   * @param  tile           Tile of the node, the edge and the opposing predecessor edge.
+   * @param  time_info      Time info for the speed lookup of the edge cost.
+   * @param  current_time   Current time (seconds since epoch) for access, 0 if not time dependent.
+   * @param  tz_index       timezone index for the node
+   * @param  evaluation     gets the costs, flow sources and restriction index if allowed
+   * @return Returns true if access is allowed, false if not.
+   */
+  virtual bool EvaluateEdgeReverse(const baldr::DirectedEdge* edge,
+                                   const EdgeLabel& pred,
+                                   const baldr::DirectedEdge* opp_edge,
+                                   const graph_tile_ptr& opp_tile,
+                                   const baldr::GraphId& opp_edgeid,
+                                   const baldr::NodeInfo* node,
+                                   const baldr::DirectedEdge* opp_pred_edge,
+                                   const graph_tile_ptr& tile,
+                                   const baldr::TimeInfo& time_info,
+                                   const uint64_t current_time,
+                                   const uint32_t tz_index,
+                                   EdgeEvaluation& evaluation) const;
+
   /**
    * Test if an edge should be restricted due to a complex restriction.
    * @param  edge  Directed edge.
@@ -412,13 +587,21 @@ public:
                   thor::EdgeStatus* edgestatus = nullptr,
                   const uint64_t current_time = 0,
                   const uint32_t tz_index = 0) const {
+    // The walk only needs the edge and the predecessor of the labels so the container can hold any
+    // kind of label, the compact ones of the expansions that keep a lot of them included
+    struct step_t {
+      baldr::GraphId edgeid;
+      uint32_t predecessor;
+    };
     // Lambda to get the next predecessor EdgeLabel (that is not a transition)
-    auto next_predecessor = [&edge_labels](const EdgeLabel* label) {
+    auto next_predecessor = [&edge_labels](const step_t& label) {
       // Get the next predecessor - make sure it is valid. Continue to get
       // the next predecessor if the edge is a transition edge.
-      const EdgeLabel* next_pred =
-          (label->predecessor() == baldr::kInvalidLabel) ? label : &edge_labels[label->predecessor()];
-      return next_pred;
+      if (label.predecessor == baldr::kInvalidLabel) {
+        return label;
+      }
+      const auto& next_pred = edge_labels[label.predecessor];
+      return step_t{next_pred.edgeid(), next_pred.predecessor()};
     };
     auto reset_edge_status =
         [&edgestatus](const std::vector<baldr::GraphId>& edge_ids_in_complex_restriction) {
@@ -468,7 +651,7 @@ public:
       }
 
       // Iterate through the restrictions
-      const EdgeLabel* first_pred = &pred;
+      const step_t first_pred{pred.edgeid(), pred.predecessor()};
       for (const auto& cr : restrictions) {
         if (cr->type() == baldr::RestrictionType::kNoProbable ||
             cr->type() == baldr::RestrictionType::kOnlyProbable) {
@@ -482,30 +665,30 @@ public:
         // Walk the via list, move to the next restriction if the via edge
         // Ids do not match the path for this restriction.
         bool match = true;
-        const EdgeLabel* next_pred = first_pred;
+        step_t next_pred = first_pred;
         // Remember the edge_ids in restriction for later reset
         std::vector<baldr::GraphId> edge_ids_in_complex_restriction;
         edge_ids_in_complex_restriction.reserve(10);
 
         cr->WalkVias([&match, &next_pred, next_predecessor,
                       &edge_ids_in_complex_restriction](const baldr::GraphId* via) {
-          if (via->value != next_pred->edgeid().value) {
+          if (via->value != next_pred.edgeid.value) {
             // Pred diverged from restriction, exit early
             match = false;
             return baldr::WalkingVia::StopWalking;
           } else {
-            edge_ids_in_complex_restriction.push_back(next_pred->edgeid());
+            edge_ids_in_complex_restriction.push_back(next_pred.edgeid);
             // Move to the next predecessor and keep walking restriction
             next_pred = next_predecessor(next_pred);
             return baldr::WalkingVia::KeepWalking;
           }
         });
         // Don't forget the last one
-        edge_ids_in_complex_restriction.push_back(next_pred->edgeid());
+        edge_ids_in_complex_restriction.push_back(next_pred.edgeid);
 
         // Check against the start/end of the complex restriction
-        if (match && ((forward && next_pred->edgeid() == cr->from_graphid()) ||
-                      (!forward && next_pred->edgeid() == cr->to_graphid()))) {
+        if (match && ((forward && next_pred.edgeid == cr->from_graphid()) ||
+                      (!forward && next_pred.edgeid == cr->to_graphid()))) {
 
           if (current_time && cr->has_dt()) {
             // TODO Possibly a bug here. Shouldn't both kTimedDenied and kTimedAllowed
@@ -551,14 +734,36 @@ public:
   static bool IsConditionalActive(const uint64_t restriction,
                                   const uint64_t current_time,
                                   const uint32_t tz_index) {
+    // Whether a restriction is active only changes from one minute to the next and a search runs
+    // into the same few restrictions over and over, so each thread keeps the last answers in a
+    // small table. A slot holds the last restriction, timezone and minute that hashed to it
+    struct answer_t {
+      uint64_t restriction;
+      uint64_t minute; // plus one so that empty slots never match
+      uint32_t tz_index;
+      bool active;
+    };
+    thread_local std::array<answer_t, kConditionalAnswers> answers{};
+    const uint64_t minute = current_time / 60 + 1;
+    const uint64_t hash = (restriction ^ (minute << 24) ^ tz_index) * 0x9E3779B97F4A7C15ull;
+    auto& answer = answers[hash >> (64 - kConditionalAnswersBits)];
+    if (answer.minute == minute && answer.restriction == restriction &&
+        answer.tz_index == tz_index) {
+      return answer.active;
+    }
 
     baldr::TimeDomain td(restriction);
-    return baldr::DateTime::is_conditional_active(td.type(), td.begin_hrs(), td.begin_mins(),
-                                                  td.end_hrs(), td.end_mins(), td.dow(),
-                                                  td.begin_week(), td.begin_month(),
-                                                  td.begin_day_dow(), td.end_week(), td.end_month(),
-                                                  td.end_day_dow(), current_time,
-                                                  baldr::DateTime::get_tz_db().from_index(tz_index));
+    answer.active =
+        baldr::DateTime::is_conditional_active(td.type(), td.begin_hrs(), td.begin_mins(),
+                                               td.end_hrs(), td.end_mins(), td.dow(),
+                                               td.begin_week(), td.begin_month(),
+                                               td.begin_day_dow(), td.end_week(), td.end_month(),
+                                               td.end_day_dow(), current_time,
+                                               baldr::DateTime::get_tz_db().from_index(tz_index));
+    answer.restriction = restriction;
+    answer.minute = minute;
+    answer.tz_index = tz_index;
+    return answer.active;
   }
 
   inline bool EvaluateRestrictions(uint32_t access_mode,
@@ -826,8 +1031,7 @@ public:
    *         false otherwise.
    */
   bool IsUserAvoidEdge(const baldr::GraphId& edgeid) const {
-    return (user_exclude_edges_.size() != 0 &&
-            user_exclude_edges_.find(edgeid) != user_exclude_edges_.end());
+    return user_exclude_edges_.get(edgeid);
   }
 
   /**
@@ -840,8 +1044,7 @@ public:
    *         false otherwise.
    */
   bool AvoidAsOriginEdge(const baldr::GraphId& edgeid, const float percent_along) const {
-    auto avoid = user_exclude_edges_.find(edgeid);
-    return (avoid != user_exclude_edges_.end() && avoid->second >= percent_along);
+    return user_exclude_edges_.get(edgeid) && UserAvoidPercentAlong(edgeid) >= percent_along;
   }
 
   /**
@@ -854,8 +1057,7 @@ public:
    *         false otherwise.
    */
   bool AvoidAsDestinationEdge(const baldr::GraphId& edgeid, const float percent_along) const {
-    auto avoid = user_exclude_edges_.find(edgeid);
-    return (avoid != user_exclude_edges_.end() && avoid->second <= percent_along);
+    return user_exclude_edges_.get(edgeid) && UserAvoidPercentAlong(edgeid) <= percent_along;
   }
 
   /**
@@ -868,6 +1070,34 @@ public:
 
   virtual Cost BSSCost() const;
 
+  /**
+   * Applies the entry of the edge table of the request, if it has one for the edge, to the cost
+   * the costing model came up with for it. The speed of the entry replaces the one the cost was
+   * based on and its penalty is added on top.
+   * @param  edge    Pointer to the directed edge.
+   * @param  edgeid  GraphId of the directed edge.
+   * @param  cost    The cost of the edge, adjusted in place.
+   * @return Returns false if the table bans the edge.
+   */
+  inline bool ApplyEdgeTable(const baldr::DirectedEdge* edge,
+                             const baldr::GraphId& edgeid,
+                             Cost& cost) const {
+    const auto* entry = edge_table_ ? edge_table_->get(edgeid) : nullptr;
+    if (entry == nullptr) {
+      return true;
+    }
+    if (entry->banned) {
+      return false;
+    }
+    if (entry->speed && cost.secs > 0.f) {
+      const float secs = edge->length() * midgard::kMetersPerSectoKPH / entry->speed;
+      cost.cost *= secs / cost.secs;
+      cost.secs = secs;
+    }
+    cost.cost += entry->penalty;
+    return true;
+  }
+
   /*
    * Determine whether an edge is currently closed due to traffic.
    * @param  edgeid         GraphId of the opposing edge.
@@ -897,6 +1127,116 @@ public:
   }
 
 protected:
+  // only copied through Clone
+  DynamicCost(const DynamicCost&) = default;
+
+  /**
+   * EvaluateEdge of a costing model, its own Allowed, EdgeCost and TransitionCost are called
+   * without virtual dispatch. A model deriving from another one that overrides any of them has to
+   * override EvaluateEdge again.
+   */
+  template <class cost_t>
+  static bool EvaluateEdgeOf(const cost_t& costing,
+                             const baldr::DirectedEdge* edge,
+                             const bool is_dest,
+                             const EdgeLabel& pred,
+                             const graph_tile_ptr& tile,
+                             const baldr::GraphId& edgeid,
+                             const baldr::NodeInfo* node,
+                             const baldr::TimeInfo& time_info,
+                             const uint64_t current_time,
+                             const uint32_t tz_index,
+                             EdgeEvaluation& evaluation) {
+    if (!costing.cost_t::Allowed(edge, is_dest, pred, tile, edgeid, current_time, tz_index,
+                                 evaluation.restriction_idx)) {
+      return false;
+    }
+    evaluation.edge_cost = costing.cost_t::EdgeCost(edge, tile, time_info, evaluation.flow_sources);
+    if (!costing.ApplyEdgeTable(edge, edgeid, evaluation.edge_cost)) {
+      return false;
+    }
+    if constexpr (cost_t::kTurnClasses) {
+      evaluation.transition_cost =
+          costing.cost_t::TransitionCost(edge, node, pred,
+                                         TurnClassOf(tile, edge, pred.opp_local_idx()));
+    } else {
+      evaluation.transition_cost = costing.cost_t::TransitionCost(edge, node, pred);
+    }
+    return true;
+  }
+
+  /**
+   * EvaluateEdgeReverse of a costing model, see EvaluateEdgeOf.
+   */
+  template <class cost_t>
+  static bool EvaluateEdgeReverseOf(const cost_t& costing,
+                                    const baldr::DirectedEdge* edge,
+                                    const EdgeLabel& pred,
+                                    const baldr::DirectedEdge* opp_edge,
+                                    const graph_tile_ptr& opp_tile,
+                                    const baldr::GraphId& opp_edgeid,
+                                    const baldr::NodeInfo* node,
+                                    const baldr::DirectedEdge* opp_pred_edge,
+                                    const graph_tile_ptr& tile,
+                                    const baldr::TimeInfo& time_info,
+                                    const uint64_t current_time,
+                                    const uint32_t tz_index,
+                                    EdgeEvaluation& evaluation) {
+    if (!costing.cost_t::AllowedReverse(edge, pred, opp_edge, opp_tile, opp_edgeid, current_time,
+                                        tz_index, evaluation.restriction_idx)) {
+      return false;
+    }
+    evaluation.edge_cost =
+        costing.cost_t::EdgeCost(opp_edge, opp_tile, time_info, evaluation.flow_sources);
+    if (!costing.ApplyEdgeTable(opp_edge, opp_edgeid, evaluation.edge_cost)) {
+      return false;
+    }
+    const bool has_measured_speed =
+        static_cast<bool>(evaluation.flow_sources & baldr::kDefaultFlowMask);
+    if constexpr (cost_t::kTurnClasses) {
+      evaluation.transition_cost =
+          costing.cost_t::TransitionCostReverse(edge->localedgeidx(), node, opp_edge, opp_pred_edge,
+                                                has_measured_speed, pred.internal_turn(),
+                                                TurnClassOf(tile, opp_pred_edge,
+                                                            edge->localedgeidx()));
+    } else {
+      evaluation.transition_cost =
+          costing.cost_t::TransitionCostReverse(edge->localedgeidx(), node, opp_edge, opp_pred_edge,
+                                                has_measured_speed, pred.internal_turn());
+    }
+    return true;
+  }
+
+  /**
+   * The turn class of a transition from the turn classes of the tile, see GraphTile::turn_classes.
+   * @param  tile  Tile of the node where the transition occurs.
+   * @param  edge  Directed edge turned onto, it leaves the node.
+   * @param  idx   Local index of the opposing edge of the edge turned from.
+   * @return the turn class, null when the tile has none and the transition is costed as usual
+   */
+  static const baldr::TurnClass*
+  TurnClassOf(const graph_tile_ptr& tile, const baldr::DirectedEdge* edge, const uint32_t idx) {
+    const baldr::TurnClass* classes;
+    if (!tile || idx >= baldr::kTurnClassesPerEdge || !(classes = tile->turn_classes(edge))) {
+      return nullptr;
+    }
+    return classes + idx;
+  }
+
+  /**
+   * The grade index hill avoidance penalizes an edge with. That is its weighted grade unless the
+   * tile has the ascent of the edge and the edge climbs more steeply than that on average, so that
+   * rolling edges whose ups and downs cancel out in the weighted grade pay for their climbs.
+   * @param  edge  Directed edge.
+   * @param  tile  Tile of the directed edge.
+   * @return the grade index, 0 to 15 like DirectedEdge::weighted_grade
+   */
+  static uint32_t ClimbGrade(const baldr::DirectedEdge* edge, const graph_tile_ptr& tile) {
+    const auto* elevation = tile ? tile->edge_elevation(edge) : nullptr;
+    return elevation ? std::max(edge->weighted_grade(), elevation->climb_grade(edge->length()))
+                     : edge->weighted_grade();
+  }
+
   /**
    * Calculate `track` costs based on tracks preference.
    * @param use_tracks value of tracks preference in range [0; 1]
@@ -937,8 +1277,29 @@ protected:
   // Hierarchy limits.
   std::vector<HierarchyLimits> hierarchy_limits_;
 
-  // User specified edges to avoid with percent along (for avoiding PathEdges of locations)
-  std::unordered_map<baldr::GraphId, float> user_exclude_edges_;
+  // User specified edges to avoid and the percent along of those not avoided from their start
+  // (for avoiding PathEdges of locations), the edges of exclude_polygons are avoided entirely
+  ExcludedEdges user_exclude_edges_;
+  std::unordered_map<baldr::GraphId, float> user_exclude_percents_;
+
+  /**
+   * Adds an edge to the user specified avoid list, an edge already on it keeps its percent along.
+   * @param  edgeid         Directed edge Id.
+   * @param  percent_along  Percent along the edge of the avoided location.
+   */
+  void AddUserAvoidEdge(const baldr::GraphId& edgeid, const float percent_along);
+
+  /**
+   * The percent along of an edge on the user specified avoid list.
+   * @param  edgeid  Directed edge Id.
+   */
+  float UserAvoidPercentAlong(const baldr::GraphId& edgeid) const {
+    auto percent = user_exclude_percents_.find(edgeid);
+    return percent == user_exclude_percents_.end() ? 0.f : percent->second;
+  }
+
+  // Speeds, penalties and bans of individual edges the request named with edge_table
+  std::shared_ptr<const baldr::EdgeTable> edge_table_;
 
   // Weighting to apply to ferry edges
   float ferry_factor_, rail_ferry_factor_;
@@ -996,6 +1357,44 @@ protected:
   bool include_hov2_{false};
   bool include_hov3_{false};
 
+  // Which of the default edge costs of the tiles this costing reads, DefaultEdgeCosts::kNone when
+  // its options are not the defaults
+  uint32_t default_edge_costs_{baldr::DefaultEdgeCosts::kNone};
+
+  /**
+   * Get the cost of an edge from the default edge costs of its tile, costing all edges of the tile
+   * with edge_cost the first time. Requests without a time whose options are the defaults cost
+   * every edge the same, they only differ in which edges they look at.
+   * @param  edge       Directed edge.
+   * @param  tile       Tile of the edge.
+   * @param  time_info  Time info of the request.
+   * @param  edge_cost  Costs an edge of the tile, Cost(const DirectedEdge*, uint8_t& flow_sources).
+   * @return the entry of the edge, nullptr when the edge has to be costed as usual
+   */
+  template <class edge_cost_t>
+  const baldr::DefaultEdgeCosts::Entry* DefaultEdgeCost(const baldr::DirectedEdge* edge,
+                                                        const graph_tile_ptr& tile,
+                                                        const baldr::TimeInfo& time_info,
+                                                        const edge_cost_t& edge_cost) const {
+    const baldr::DefaultEdgeCosts* costs;
+    if (default_edge_costs_ == baldr::DefaultEdgeCosts::kNone || time_info.valid ||
+        !(costs = tile->GetDefaultEdgeCosts()) || costs->edge_count() == 0) {
+      return nullptr;
+    }
+    const auto* first = tile->directededge(0);
+    if (edge < first || edge >= first + costs->edge_count()) {
+      return nullptr;
+    }
+    const auto* entries = costs->get(default_edge_costs_, [&](baldr::DefaultEdgeCosts::Entry* e) {
+      for (uint32_t i = 0; i < costs->edge_count(); ++i) {
+        uint8_t flow_sources = baldr::kNoFlowMask;
+        const Cost cost = edge_cost(first + i, flow_sources);
+        e[i] = {cost.cost, cost.secs, flow_sources};
+      }
+    });
+    return entries + (edge - first);
+  }
+
   /**
    * Get the base transition costs (and ferry factor) from the costing options.
    * @param costing_options Protocol buffer of costing options.
@@ -1152,6 +1551,31 @@ protected:
   }
 };
 
+/**
+ * Declares the EvaluateEdge and EvaluateEdgeReverse overrides of a costing model inside its class,
+ * they call the Allowed, EdgeCost and TransitionCost methods of the model directly.
+ * @param cost_t  the costing model class
+ */
+#define VALHALLA_SIF_EVALUATE_EDGE(cost_t)                                                          \
+  bool EvaluateEdge(const baldr::DirectedEdge* edge, const bool is_dest, const EdgeLabel& pred,      \
+                    const graph_tile_ptr& tile, const baldr::GraphId& edgeid,                        \
+                    const baldr::NodeInfo* node, const baldr::TimeInfo& time_info,                   \
+                    const uint64_t current_time, const uint32_t tz_index,                            \
+                    EdgeEvaluation& evaluation) const override {                                     \
+    return EvaluateEdgeOf<cost_t>(*this, edge, is_dest, pred, tile, edgeid, node, time_info,         \
+                                  current_time, tz_index, evaluation);                               \
+  }                                                                                                  \
+  bool EvaluateEdgeReverse(const baldr::DirectedEdge* edge, const EdgeLabel& pred,                   \
+                           const baldr::DirectedEdge* opp_edge, const graph_tile_ptr& opp_tile,      \
+                           const baldr::GraphId& opp_edgeid, const baldr::NodeInfo* node,            \
+                           const baldr::DirectedEdge* opp_pred_edge, const graph_tile_ptr& tile,     \
+                           const baldr::TimeInfo& time_info, const uint64_t current_time,            \
+                           const uint32_t tz_index, EdgeEvaluation& evaluation) const override {     \
+    return EvaluateEdgeReverseOf<cost_t>(*this, edge, pred, opp_edge, opp_tile, opp_edgeid, node,    \
+                                         opp_pred_edge, tile, time_info, current_time, tz_index,     \
+                                         evaluation);                                                \
+  }
+
 using cost_ptr_t = std::shared_ptr<DynamicCost>;
 using mode_costing_t = std::array<cost_ptr_t, static_cast<size_t>(TravelMode::kMaxTravelMode)>;
 
@@ -1240,6 +1664,14 @@ void ParseCosting(const rapidjson::Document& doc,
                   Costing* costing,
                   Costing::Type costing_type = static_cast<Costing::Type>(Costing::Type_ARRAYSIZE));
 
+/**
+ * Whether the options of a costing are the ones a request without a time gets when it does not
+ * specify any, those requests leave predicted and live speeds out of the flow mask
+ * @param costing  the costing
+ * @return true if the options are the defaults
+ */
+bool HasDefaultOptions(const Costing& costing);
+
 } // namespace sif
 
 } // namespace valhalla
@@ -17,6 +17,8 @@ constexpr uint32_t kInitialEdgeLabelCountBidirAstar = 1000000;
 constexpr uint32_t kInitialEdgeLabelCountDijkstras = 4000000;
 constexpr uint32_t kInitialEdgeLabelCountBidirDijkstra = 2000000;
 
+class CompactEdgeLabel;
+
 /**
  * Labeling information for shortest path algorithm. Contains cost,
  * predecessor, current time, and assorted information required during
@@ -416,6 +418,8 @@ public:
   }
 
 protected:
+  friend class CompactEdgeLabel;
+
   // predecessor_: Index to the predecessor edge label information.
   // Note: invalid predecessor value uses all 32 bits (so if this needs to
   // be part of a bit field make sure kInvalidLabel is changed.
@@ -890,6 +894,205 @@ protected:
   uint32_t walking_distance_;
 };
 
+/**
+ * A 32 byte EdgeLabel for expansions that keep millions of labels but never recover a path from
+ * them, like the time distance matrix. It keeps what costing looks at of a predecessor and the
+ * cost and distance along the path, the sort cost is the cost. There is no distance to the
+ * destination, transition cost, restriction index, path id or opposing edge index. Costing is
+ * handed the EdgeLabel the compact one expands to.
+ */
+class CompactEdgeLabel {
+public:
+  /**
+   * Default constructor.
+   */
+  CompactEdgeLabel()
+      : predecessor_(baldr::kInvalidLabel), path_distance_(0), restrictions_(0),
+        edgeid_(baldr::kInvalidGraphId), opp_local_idx_(0), mode_(0), classification_(0),
+        shortcut_(0), dest_only_(0), origin_(0), destination_(0), endnode_(baldr::kInvalidGraphId),
+        use_(0), internal_turn_(0), toll_(0), not_thru_(0), deadend_(0), on_complex_rest_(0),
+        closure_pruning_(0), has_measured_speed_(0), unpaved_(0), spare_(0), cost_(0, 0) {
+  }
+
+  /**
+   * Constructor with values.
+   * @param predecessor         Index into the edge label list for the predecessor
+   *                            directed edge in the shortest path.
+   * @param edgeid              Directed edge Id.
+   * @param edge                Directed edge.
+   * @param cost                True cost (cost and time in seconds) to the edge.
+   * @param mode                Mode of travel along this edge.
+   * @param path_distance       Accumulated path distance
+   * @param closure_pruning     Should closure pruning be enabled on this path?
+   * @param has_measured_speed  Do we have any of the measured speed types set?
+   * @param internal_turn       Did we make an turn on a short internal edge.
+   */
+  CompactEdgeLabel(const uint32_t predecessor,
+                   const baldr::GraphId& edgeid,
+                   const baldr::DirectedEdge* edge,
+                   const Cost& cost,
+                   const TravelMode mode,
+                   const uint32_t path_distance,
+                   const bool closure_pruning,
+                   const bool has_measured_speed,
+                   const InternalTurn internal_turn)
+      : predecessor_(predecessor), path_distance_(path_distance),
+        restrictions_(edge->restrictions()), edgeid_(edgeid),
+        opp_local_idx_(edge->opp_local_idx()), mode_(static_cast<uint32_t>(mode)),
+        classification_(static_cast<uint32_t>(edge->classification())),
+        shortcut_(edge->shortcut()), dest_only_(edge->destonly()), origin_(0), destination_(0),
+        endnode_(edge->endnode()), use_(static_cast<uint32_t>(edge->use())),
+        internal_turn_(static_cast<uint8_t>(internal_turn)), toll_(edge->toll()),
+        not_thru_(edge->not_thru()), deadend_(edge->deadend()),
+        on_complex_rest_(edge->part_of_complex_restriction() || edge->start_restriction() ||
+                         edge->end_restriction()),
+        closure_pruning_(closure_pruning), has_measured_speed_(has_measured_speed),
+        unpaved_(edge->unpaved()), spare_(0), cost_(cost) {
+  }
+
+  /**
+   * Update an existing edge label with new predecessor and cost information.
+   * @param predecessor    Predecessor directed edge in the shortest path.
+   * @param cost           True cost (and elapsed time in seconds) to the edge.
+   * @param path_distance  Accumulated path distance.
+   */
+  void Update(const uint32_t predecessor, const Cost& cost, const uint32_t path_distance) {
+    predecessor_ = predecessor;
+    cost_ = cost;
+    path_distance_ = path_distance;
+  }
+
+  /**
+   * Expands the label to the EdgeLabel costing and the expansion look at. Its sort cost is the
+   * cost and it has no restriction index.
+   * @return the full edge label
+   */
+  EdgeLabel label() const {
+    EdgeLabel label;
+    label.predecessor_ = predecessor_;
+    label.path_distance_ = path_distance_;
+    label.restrictions_ = restrictions_;
+    label.edgeid_ = edgeid_;
+    label.opp_local_idx_ = opp_local_idx_;
+    label.mode_ = mode_;
+    label.endnode_ = endnode_;
+    label.use_ = use_;
+    label.classification_ = classification_;
+    label.shortcut_ = shortcut_;
+    label.dest_only_ = dest_only_;
+    label.origin_ = origin_;
+    label.destination_ = destination_;
+    label.toll_ = toll_;
+    label.not_thru_ = not_thru_;
+    label.deadend_ = deadend_;
+    label.on_complex_rest_ = on_complex_rest_;
+    label.closure_pruning_ = closure_pruning_;
+    label.has_measured_speed_ = has_measured_speed_;
+    label.restriction_idx_ = baldr::kInvalidRestriction;
+    label.internal_turn_ = internal_turn_;
+    label.unpaved_ = unpaved_;
+    label.cost_ = cost_;
+    label.sortcost_ = cost_.cost;
+    return label;
+  }
+
+  /**
+   * Get the predecessor edge label.
+   * @return Predecessor edge label.
+   */
+  uint32_t predecessor() const {
+    return predecessor_;
+  }
+
+  /**
+   * Get the GraphId of this directed edge.
+   * @return  Returns the GraphId of this directed edge.
+   */
+  baldr::GraphId edgeid() const {
+    return baldr::GraphId(edgeid_);
+  }
+
+  /**
+   * Get the end node of this directed edge.
+   * @return  Returns the GraphId of the end node of this directed edge.
+   */
+  baldr::GraphId endnode() const {
+    return baldr::GraphId(endnode_);
+  }
+
+  /**
+   * Get the cost from the origin to this directed edge.
+   * @return  Returns the cost (units are based on the costing method)
+   *          and elapsed time (seconds) to the end of the directed edge.
+   */
+  const Cost& cost() const {
+    return cost_;
+  }
+
+  /**
+   * Get the sort cost, without a heuristic that is the cost.
+   * @return  Returns the sort cost (units are based on the costing method).
+   */
+  float sortcost() const {
+    return cost_.cost;
+  }
+
+  /**
+   * Get the current path distance in meters.
+   * @return  Returns the current path distance.
+   */
+  uint32_t path_distance() const {
+    return path_distance_;
+  }
+
+  /**
+   * Is this edge an origin edge?
+   * @return  Returns true if this edge is an origin edge.
+   */
+  bool origin() const {
+    return origin_;
+  }
+
+  /**
+   * Sets this edge as an origin.
+   */
+  void set_origin() {
+    origin_ = true;
+  }
+
+protected:
+  // The fields of EdgeLabel of the same name
+  uint32_t predecessor_;
+
+  uint32_t path_distance_ : 25;
+  uint32_t restrictions_ : 7;
+
+  uint64_t edgeid_ : 46;
+  uint64_t opp_local_idx_ : 7;
+  uint64_t mode_ : 4;
+  uint64_t classification_ : 3;
+  uint64_t shortcut_ : 1;
+  uint64_t dest_only_ : 1;
+  uint64_t origin_ : 1;
+  uint64_t destination_ : 1;
+
+  uint64_t endnode_ : 46;
+  uint64_t use_ : 6;
+  uint64_t internal_turn_ : 2;
+  uint64_t toll_ : 1;
+  uint64_t not_thru_ : 1;
+  uint64_t deadend_ : 1;
+  uint64_t on_complex_rest_ : 1;
+  uint64_t closure_pruning_ : 1;
+  uint64_t has_measured_speed_ : 1;
+  uint64_t unpaved_ : 1;
+  uint64_t spare_ : 3;
+
+  Cost cost_;
+};
+
+static_assert(sizeof(CompactEdgeLabel) == 32, "CompactEdgeLabel is meant to fit in 32 bytes");
+
 } // namespace sif
 } // namespace valhalla
 
@@ -3,6 +3,13 @@
 
 #include <boost/property_tree/ptree.hpp>
 #include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
 
 // Default hierarchy transitions. Note that this corresponds to a 3 level
 // strategy: highway, arterial, local. Any changes to this will require
@@ -92,6 +99,64 @@ struct HierarchyLimits {
   }
 };
 
+/**
+ * Hierarchy limits per region and costing that replace the defaults, like the ones the
+ * valhalla_tune_hierarchy_limits tool recommends. A route takes the limits of the first region
+ * whose bounding box contains its origin and its destination. The file looks like:
+ *
+ * {"regions": [{"name": "netherlands", "bbox": [3.2, 50.7, 7.3, 53.6],
+ *               "costings": {"auto": [{"level": 1, "max_up_transitions": 200,
+ *                                      "expansion_within_dist": 50000}]}}]}
+ */
+class HierarchyLimitsTable {
+public:
+  struct LevelLimits {
+    uint32_t level;
+    uint32_t max_up_transitions;
+    float expansion_within_dist;
+  };
+
+  struct Region {
+    std::string name;
+    midgard::AABB2<midgard::PointLL> bbox;
+    std::unordered_map<std::string, std::vector<LevelLimits>> costings;
+  };
+
+  /**
+   * Read the limits from a file, throws when it can't be read or isn't a limits table.
+   * @param  file  The json file with the limits.
+   */
+  explicit HierarchyLimitsTable(const std::string& file);
+
+  /**
+   * The table of a file, shared by the workers of a process.
+   * @param  file  The json file with the limits.
+   * @return the table or nullptr if the file is empty or could not be read
+   */
+  static std::shared_ptr<const HierarchyLimitsTable> get(const std::string& file);
+
+  /**
+   * Replace the limits of a costing with the ones of the region of a route. Levels whose
+   * transitions are unlimited, because pruning is disabled or the costing never prunes, are kept.
+   * @param  costing      The name of the costing, like auto.
+   * @param  origin       Where the route starts.
+   * @param  destination  Where the route ends.
+   * @param  limits       The limits of the costing, one per level.
+   * @return the region whose limits were used or nullptr if no region has limits for the route
+   */
+  const Region* Apply(const std::string& costing,
+                      const midgard::PointLL& origin,
+                      const midgard::PointLL& destination,
+                      std::vector<HierarchyLimits>& limits) const;
+
+  const std::vector<Region>& regions() const {
+    return regions_;
+  }
+
+private:
+  std::vector<Region> regions_;
+};
+
 } // namespace sif
 } // namespace valhalla
 
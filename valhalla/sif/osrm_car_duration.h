@@ -3,6 +3,7 @@
 #include "baldr/directededge.h"
 #include "baldr/graphconstants.h"
 #include "baldr/nodeinfo.h"
+#include "baldr/turnclasses.h"
 
 namespace {
 
@@ -77,4 +78,20 @@ inline float OSRMCarTurnDuration(const valhalla::baldr::DirectedEdge* edge,
   return turn_duration;
 }
 
+// The same duration from the turn class of the transition, which has the turn degree worked out
+inline float OSRMCarTurnDuration(const valhalla::baldr::TurnClass& turn,
+                                 const valhalla::baldr::NodeInfo* node) {
+  static const auto left_hand_lookup(lookup_table(false));
+  static const auto right_hand_lookup(lookup_table(true));
+
+  double turn_duration = node->traffic_signal() ? kTrafficLightPenalty : 0;
+  if (turn.osrm_turn()) {
+    turn_duration += node->drive_on_right() ? right_hand_lookup[turn.turn_degree()]
+                                            : left_hand_lookup[turn.turn_degree()];
+    turn_duration += turn.osrm_u_turn() ? kUTurnPenalty : 0;
+  }
+
+  return turn_duration;
+}
+
 } // namespace
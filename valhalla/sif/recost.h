@@ -5,6 +5,7 @@
 #include <valhalla/sif/edgelabel.h>
 
 #include <functional>
+#include <vector>
 
 namespace valhalla {
 namespace sif {
@@ -13,6 +14,8 @@ namespace sif {
 using EdgeCallback = std::function<baldr::GraphId(void)>;
 // what this function calls to emit the next label
 using LabelCallback = std::function<void(const EdgeLabel& label)>;
+// what the batch recosting calls to emit the next label of one of its costings
+using CostingLabelCallback = std::function<void(size_t costing_index, const EdgeLabel& label)>;
 
 /**
  * Will take a sequence of edges and create the set of edge labels that would represent it
@@ -38,5 +41,33 @@ void recost_forward(baldr::GraphReader& reader,
                     const baldr::TimeInfo& time_info = baldr::TimeInfo::invalid(),
                     const bool invariant = false,
                     const bool ignore_access = false);
+
+/**
+ * Recosts a sequence of edges under several costings while walking it only once. Every edge and
+ * node of the path is fetched a single time and each of the costings evaluates it in turn, so the
+ * labels of all costings for an edge are emitted before the labels of the next edge. A costing
+ * that doesn't allow the path emits no more labels, the others carry on.
+ *
+ * @param reader            used to get access to graph data. modifiable because its got a cache
+ * @param costings          the costings to be used for costing/access computations
+ * @param edge_cb           the callback used to get each edge in the path
+ * @param label_cb          the callback used to emit each label of each costing in the path
+ * @param source_pct        the percent along the initial edge the source location is
+ * @param target_pct        the percent along the final edge the target location is
+ * @param time_info         the time tracking information representing the local time before
+ *                          traversing the first edge
+ * @param invariant         static date_time, dont offset the time as the path lengthens
+ * @param ignore_access     ignore access restrictions for edges and nodes if it's true
+ * @return for each costing whether it could recost the whole path
+ */
+std::vector<bool> recost_forward(baldr::GraphReader& reader,
+                                 const std::vector<const sif::DynamicCost*>& costings,
+                                 const EdgeCallback& edge_cb,
+                                 const CostingLabelCallback& label_cb,
+                                 float source_pct = 0.f,
+                                 float target_pct = 1.f,
+                                 const baldr::TimeInfo& time_info = baldr::TimeInfo::invalid(),
+                                 const bool invariant = false,
+                                 const bool ignore_access = false);
 } // namespace sif
 } // namespace valhalla
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <utility>
 #include <vector>
 
 namespace valhalla {
@@ -36,6 +37,15 @@ weighted_grade(const std::vector<double>& heights,
                const double interval_distance,
                const std::function<double(double&)>& grade_weighting = energy_weighting);
 
+/*
+ * Returns the total climb and the total drop along a stretch of heights, summing every rise and
+ * every fall between consecutive readings. Sections touching an invalid posting are ignored.
+ *
+ * @param    heights            the height reading at each sampled location
+ * @return   the ascent and the descent in meters, both positive
+ */
+std::pair<double, double> elevation_change(const std::vector<double>& heights);
+
 } // namespace skadi
 } // namespace valhalla
 
@@ -19,5 +19,64 @@ bool validate_alternate_by_sharing(std::vector<std::unordered_set<baldr::GraphId
                                    float at_most_shared);
 
 bool validate_alternate_by_local_optimality(const std::vector<PathInfo>& candidate_path);
+
+/**
+ * The labels a path found by a bidirectional search goes through in the forward and the reverse
+ * label set of the search. The path goes from the origin to the connection through the forward
+ * labels and on through the reverse labels before the connection.
+ */
+struct LabelPath {
+  // one bit per label of each set, set for the labels of the path
+  std::vector<bool> forward;
+  std::vector<bool> reverse;
+  // the labels of the path from the origin and from the destination on, each with the length of
+  // the path from there up to and including its edge, not counting the origin and destination edges
+  std::vector<std::pair<uint32_t, float>> forward_lengths;
+  std::vector<std::pair<uint32_t, float>> reverse_lengths;
+  // the cost of the path from the origin to the connection and from the connection to the
+  // destination
+  float forward_cost;
+  float reverse_cost;
+};
+
+/**
+ * Gets the labels of the path through a connection of a bidirectional search.
+ * @param  graphreader     graph reader for the lengths of the edges
+ * @param  forward_labels  the forward label set
+ * @param  reverse_labels  the reverse label set
+ * @param  forward_idx     the forward label of the connection
+ * @param  reverse_idx     the reverse label of the connection
+ * @return the labels of the path
+ */
+LabelPath get_label_path(baldr::GraphReader& graphreader,
+                         const std::vector<sif::BDEdgeLabel>& forward_labels,
+                         const std::vector<sif::BDEdgeLabel>& reverse_labels,
+                         const uint32_t forward_idx,
+                         const uint32_t reverse_idx);
+
+/**
+ * Rejects a candidate connection by sharing and by stretch before its path is recovered. Each label
+ * set is a tree, so the labels a candidate has in common with a chosen path in a set are the ones
+ * from the root up to where it branches off. What they share there is a lower bound of what the
+ * recovered paths share and the costs past the branches bound their differing segments. Up to the
+ * differences between the costs of the labels and those of the recosted paths, a candidate this
+ * rejects would be rejected by validate_alternate_by_sharing or validate_alternate_by_stretch
+ * after its recovery, one it accepts still has to pass them.
+ * @param  label_paths     the labels of the chosen paths, the optimal one first
+ * @param  paths           the chosen paths
+ * @param  forward_labels  the forward label set
+ * @param  reverse_labels  the reverse label set
+ * @param  forward_idx     the forward label of the candidate connection
+ * @param  reverse_idx     the reverse label of the candidate connection
+ * @param  at_most_shared  the sharing threshold
+ * @return false if the candidate is no viable alternate
+ */
+bool validate_alternate_by_labels(const std::vector<LabelPath>& label_paths,
+                                  const std::vector<std::vector<PathInfo>>& paths,
+                                  const std::vector<sif::BDEdgeLabel>& forward_labels,
+                                  const std::vector<sif::BDEdgeLabel>& reverse_labels,
+                                  const uint32_t forward_idx,
+                                  const uint32_t reverse_idx,
+                                  float at_most_shared);
 } // namespace thor
 } // namespace valhalla
@@ -15,6 +15,7 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/astarheuristic.h>
+#include <valhalla/thor/bss_tables.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/pathinfo.h>
@@ -80,6 +81,15 @@ public:
     max_label_count_ = max_count;
   }
 
+  /**
+   * Set the bike share tables. Requests they apply to ride from station to station through the
+   * tables instead of expanding the bicycle graph.
+   * @param  tables  the tables, nullptr for none
+   */
+  void set_bss_tables(std::shared_ptr<const baldr::BssTables> tables) {
+    bss_tables_ = std::move(tables);
+  }
+
 protected:
   uint32_t max_label_count_; // Max label count to allow
   sif::TravelMode mode_;     // Current travel mode
@@ -106,6 +116,11 @@ protected:
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
+  // The bike share tables and whether the current request rides through them
+  std::shared_ptr<const baldr::BssTables> bss_tables_;
+  bool use_bss_tables_ = false;
+  BssStationSearch bss_search_;
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -136,6 +151,19 @@ protected:
                      const valhalla::Location& dest,
                      std::pair<int32_t, float>& best_path);
 
+  /**
+   * Adds a bicycle label for each ride of the tables from the station at the node, the label is
+   * on the edge entering the station the ride ends at.
+   * @param  graphreader  Graph tile reader.
+   * @param  node         Graph Id of the station node.
+   * @param  pred         Predecessor edge label, the walk to the station.
+   * @param  pred_idx     Predecessor index into the EdgeLabel list.
+   */
+  void ExpandRides(baldr::GraphReader& graphreader,
+                   const baldr::GraphId& node,
+                   const sif::EdgeLabel& pred,
+                   const uint32_t pred_idx);
+
   /**
    * Add edges at the origin to the adjacency list.
    * @param  graphreader  Graph tile reader.
@@ -1,6 +1,12 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <valhalla/baldr/altbounds.h>
+#include <valhalla/baldr/graphid.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
@@ -11,13 +17,27 @@ namespace thor {
 /**
  * Class to calculate A* cost heuristics based on distances of nodes from
  * a destination within the shortest path computation.
+ *
+ * When landmark distances are set and the search says at which nodes it can
+ * reach the destination, the heuristic of a node is the larger of its straight
+ * line distance and the landmark (ALT) bound of its network distance to the
+ * closest of those nodes. Both are consistent, so their maximum is as well.
  */
 class AStarHeuristic {
 public:
   /**
    * Constructor.
    */
-  AStarHeuristic() : distapprox_({}), costfactor_(1.0f) {
+  AStarHeuristic() : distapprox_({}), costfactor_(1.0f), alt_bounds_(nullptr), alt_(nullptr) {
+  }
+
+  /**
+   * Sets the landmark distances to bound the network distance with, they are
+   * used for the searches started after the next Init.
+   * @param  alt_bounds  The distances, nullptr to only use the straight line.
+   */
+  void SetAltBounds(const baldr::AltBounds* alt_bounds) {
+    alt_bounds_ = alt_bounds;
   }
 
   /**
@@ -33,6 +53,30 @@ public:
   void Init(const midgard::PointLL& ll, const float factor) {
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
+    alt_ = alt_bounds_;
+    targets_.clear();
+  }
+
+  /**
+   * Adds a node through which the search can reach its destination. The
+   * landmark bound is only used once the search added all of them.
+   * @param  node  The node, for a forward search the begin node of a
+   *               destination edge, for a reverse one the end node of an
+   *               origin edge.
+   */
+  void AddTarget(const baldr::GraphId& node) {
+    if (!alt_) {
+      return;
+    }
+    const float* distances = alt_->Distances(node);
+    // without the distances of one of them the bound could overestimate
+    if (!distances) {
+      alt_ = nullptr;
+      return;
+    }
+    if (std::find(targets_.begin(), targets_.end(), distances) == targets_.end()) {
+      targets_.push_back(distances);
+    }
   }
 
   /**
@@ -77,10 +121,63 @@ public:
     return dist * costfactor_;
   }
 
+  /**
+   * Get the A* heuristic of a node, using the landmark bound when there is
+   * one. Also return the straight line distance via an argument.
+   * @param   ll    Lat,lng of the node.
+   * @param   node  Id of the node.
+   * @param   dist  Distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll, const baldr::GraphId& node, float& dist) const {
+    dist = sqrtf(distapprox_.DistanceSquared(ll));
+    return std::max(dist, GetAltDistance(node)) * costfactor_;
+  }
+
+  /**
+   * Get the A* heuristic of a node, using the landmark bound when there is
+   * one.
+   * @param   ll    Lat,lng of the node.
+   * @param   node  Id of the node.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll, const baldr::GraphId& node) const {
+    float dist;
+    return Get(ll, node, dist);
+  }
+
+protected:
+  /**
+   * Get the landmark bound of the network distance (meters) between a node
+   * and the closest target.
+   * @param   node  Id of the node.
+   * @return  Returns the bound, 0 when there is none.
+   */
+  float GetAltDistance(const baldr::GraphId& node) const {
+    if (!alt_ || targets_.empty()) {
+      return 0.0f;
+    }
+    const float* distances = alt_->Distances(node);
+    if (!distances) {
+      return 0.0f;
+    }
+    float bound = std::numeric_limits<float>::max();
+    for (const float* target : targets_) {
+      bound = std::min(bound, alt_->LowerBound(distances, target));
+    }
+    return bound;
+  }
+
 private:
   midgard::DistanceApproximator<midgard::PointLL> distapprox_; // Distance approximation
   float costfactor_; // Cost factor - ensures the cost estimate
                      // underestimates the true cost.
+
+  const baldr::AltBounds* alt_bounds_; // Landmark distances, if any
+  const baldr::AltBounds* alt_;        // Landmark distances of the current search
+  std::vector<const float*> targets_;  // Landmark distances of the target nodes
 };
 
 } // namespace thor
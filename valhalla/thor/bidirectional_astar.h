@@ -8,7 +8,8 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
+#include <valhalla/baldr/tilescope.h>
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/edgelabel.h>
@@ -16,6 +17,7 @@
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/searchpool.h>
 
 namespace valhalla {
 namespace thor {
@@ -43,9 +45,14 @@ class BidirectionalAStar : public PathAlgorithm {
 public:
   /**
    * Constructor.
-   * @param config A config object of key, value pairs
+   * @param config         A config object of key, value pairs, a bidirectional_parallel_distance
+   *                       above 0 runs both searches of the routes at least that long concurrently,
+   *                       bidirectional_time_dependent lets time vary along date_time routes
+   * @param reader_config  Config of the graph reader kept by the thread of the second search, the
+   *                       searches never run concurrently without it
    */
-  explicit BidirectionalAStar(const boost::property_tree::ptree& config = {});
+  explicit BidirectionalAStar(const boost::property_tree::ptree& config = {},
+                              const boost::property_tree::ptree& reader_config = {});
 
   /**
    * Destructor
@@ -84,6 +91,26 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Get how much label memory the forward and reverse searches keep between requests.
+   */
+  LabelMemory label_memory() const override {
+    auto memory = forward_budget_.memory();
+    memory += reverse_budget_.memory();
+    return memory;
+  }
+
+  size_t label_count() const override {
+    return edgelabels_forward_.size() + edgelabels_reverse_.size();
+  }
+
+  SearchStats search_stats() const override {
+    auto stats = stats_;
+    stats.add_labels(edgelabels_forward_);
+    stats.add_labels(edgelabels_reverse_);
+    return stats;
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -111,14 +138,22 @@ protected:
   std::vector<sif::BDEdgeLabel> edgelabels_forward_;
   std::vector<sif::BDEdgeLabel> edgelabels_reverse_;
 
-  // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_forward_;
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_reverse_;
+  // How much of the edge label capacity survives a clear
+  LabelBudget forward_budget_;
+  LabelBudget reverse_budget_;
+
+  // Adjacency list - approximate double bucket sort unless thor.adjacency_queue says otherwise
+  baldr::LabelQueue<sif::BDEdgeLabel> adjacencylist_forward_;
+  baldr::LabelQueue<sif::BDEdgeLabel> adjacencylist_reverse_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_forward_;
   EdgeStatus edgestatus_reverse_;
 
+  // Tiles each direction expanded through, one scope per direction as both can run concurrently
+  baldr::TileScope tiles_forward_;
+  baldr::TileScope tiles_reverse_;
+
   // Best candidate connection and threshold to extend search.
   float cost_threshold_;
   uint32_t iterations_threshold_;
@@ -133,6 +168,38 @@ protected:
   // edge)
   bool pruning_disabled_at_origin_, pruning_disabled_at_destination_;
 
+  // Straight line distance (meters) from which both searches run concurrently, 0 if they never do
+  float parallel_distance_;
+  boost::property_tree::ptree reader_config_;
+  // Helper thread running one of the searches, created on first use
+  std::unique_ptr<SearchPool> pool_;
+  // Set while both searches run, neither may look at the state of the other one then
+  bool parallel_;
+  enum class RoundEnd : uint8_t { kOpen, kExhausted, kPastThreshold };
+  // The reverse search keeps its own timezone cache while the searches run concurrently
+  baldr::DateTime::tz_sys_info_cache_t reverse_tz_cache_;
+
+  // Whether date_time routes track the time along both searches instead of using a fixed time
+  bool time_dependent_;
+  // Set for the current route when it tracks the time. The search from the location with the time
+  // counts from it, the other one offsets it by the duration the route is expected to take
+  bool time_dependent_search_;
+  bool time_from_origin_;
+  // Straight line distance (meters) between the locations and the expected duration (seconds) of
+  // the route, only ever changed between expansions
+  float route_distance_;
+  float duration_lower_bound_;
+  float duration_estimate_;
+
+  /**
+   * Refine the expected duration of a time dependent route from a label settled by the search
+   * that counts from the known time. The pace of the label so far is extrapolated over the whole
+   * straight line between the locations, until the searches meet and the connection tells.
+   * @param graphreader  to get the location of the end node of the label
+   * @param pred         the label just settled
+   */
+  void RefineDurationEstimate(baldr::GraphReader& graphreader, const sif::BDEdgeLabel& pred);
+
   /**
    * Initialize the A* heuristic and adjacency lists for both the forward
    * and reverse search.
@@ -181,6 +248,38 @@ protected:
                           uint32_t& shortcuts,
                           const graph_tile_ptr& tile,
                           const baldr::TimeInfo& time_info);
+  /**
+   * Settle up to a round worth of edges of one search without looking at the other search, so
+   * that both can run at the same time.
+   * @param graphreader       to access graph data, owned by the running thread
+   * @param time_info         time tracking information about the start of the search
+   * @param invariant         static date_time, dont offset the time as the path lengthens
+   * @param opposite_sortcost sort cost of the other search at the start of the round, a lower
+   *                          bound of the cost it still has to expand
+   * @param settled           gets the label indices of the edges settled in this round
+   * @return returns why the round ended
+   */
+  template <const ExpansionType expansion_direction>
+  RoundEnd ExpandRound(baldr::GraphReader& graphreader,
+                   const baldr::TimeInfo& time_info,
+                   const bool invariant,
+                   const float opposite_sortcost,
+                   std::vector<uint32_t>& settled);
+
+  /**
+   * Run the forward and the reverse search concurrently, in rounds after which the edges settled
+   * by either search are checked against the other one for connections.
+   * @param graphreader        Graph reader of the calling thread
+   * @param forward_time_info  What time is it when we start the route
+   * @param reverse_time_info  What time is it when we end the route
+   * @param invariant          static date_time, dont offset the time as the path lengthens
+   * @return Returns true if a path can be formed from the connections that were found
+   */
+  bool ExpandInParallel(baldr::GraphReader& graphreader,
+                        const baldr::TimeInfo& forward_time_info,
+                        const baldr::TimeInfo& reverse_time_info,
+                        const bool invariant);
+
   /**
    * Add edges at the origin to the forward adjacency list.
    * @param graphreader  Graph tile reader.
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/bss_tables.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Loads the bike share tables built by mjolnir::BssTablesBuilder from the tile directory.
+ * @param reader  graph reader used to check the tables match the tiles
+ * @return the tables or nullptr if they are missing or were built from other tiles
+ */
+std::shared_ptr<const baldr::BssTables> LoadBssTables(baldr::GraphReader& reader);
+
+/**
+ * Whether a bikeshare request can use the tables, that is if it uses the default pedestrian and
+ * bicycle options and doesn't avoid anything. The tables were costed that way.
+ * @param options  the request options
+ * @return true if the rides of the tables are the ones the request would find
+ */
+bool BssTablesApplicable(const Options& options);
+
+/**
+ * Bicycle search from a bike share station to the stations around it. It fills the tables when
+ * they are built and finds the edges of a ride again when a path through the tables is formed,
+ * the same search from the same station gives the same rides both times. The rider is taken to
+ * have walked in on one of the connections of the station.
+ */
+class BssStationSearch {
+public:
+  struct ride_t {
+    baldr::GraphId station; // the station the ride ends at
+    uint32_t label;         // the label of the edge entering the station
+  };
+
+  /**
+   * Finds the cheapest rides to the stations within reach
+   * @param reader     graph reader for accessing the routing graph
+   * @param bicycle    the bicycle costing
+   * @param station    the node of the station to start at
+   * @param max_secs   rides taking longer than this are not searched
+   * @param last_edge  if valid the search stops once the ride over this edge is found and only
+   *                   returns that one
+   * @return the rides, cheapest first
+   */
+  std::vector<ride_t> Expand(baldr::GraphReader& reader,
+                             const sif::DynamicCost& bicycle,
+                             const baldr::GraphId& station,
+                             const float max_secs,
+                             const baldr::GraphId& last_edge = {});
+
+  const sif::EdgeLabel& label(const uint32_t index) const {
+    return labels_[index];
+  }
+
+  /**
+   * The labels of a ride found by the last search in travel order
+   * @param label  the label of the edge the ride ends with
+   * @return the labels from the one leaving the station on
+   */
+  std::vector<sif::EdgeLabel> Path(const uint32_t label) const;
+
+protected:
+  void Relax(baldr::GraphReader& reader,
+             const sif::DynamicCost& bicycle,
+             const baldr::GraphId& node,
+             const sif::EdgeLabel& pred,
+             const uint32_t pred_idx,
+             const bool from_transition);
+
+  float max_secs_ = 0.f;
+  std::vector<sif::EdgeLabel> labels_;
+  std::vector<bool> settled_;
+  // the label of each edge reached so far
+  std::unordered_map<uint64_t, uint32_t> edges_;
+  std::priority_queue<std::pair<float, uint32_t>,
+                      std::vector<std::pair<float, uint32_t>>,
+                      std::greater<std::pair<float, uint32_t>>>
+      queue_;
+};
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,181 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/contraction.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/matrix_common.h>
+#include <valhalla/thor/searchpool.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Class to compute time + distance matrices among many locations on a contraction overlay (see
+ * baldr::ContractionOverlay). Like the bucket based many-to-many algorithm of Knopp et al. every
+ * target runs one search up the hierarchy and leaves its costs in a bucket at each node it settles.
+ * Every source then runs one search up the hierarchy and scans the buckets of the nodes it settles,
+ * the cheapest sum over the nodes both reach is the cost between them. The upward searches only see
+ * a small part of the overlay, so the matrix scales with the number of locations rather than with
+ * their product times the size of the graph.
+ *
+ * The overlay is node based and costed with the default options of its costing and without time,
+ * so the matrix has no turn costs or time dependence, see Applicable.
+ */
+class BucketMatrix {
+public:
+  /**
+   * Constructor.
+   * @param config         the thor config, bucketmatrix_threads > 1 runs the searches in parallel
+   * @param reader_config  the mjolnir config the helper threads need a graph reader of, when empty
+   *                       the searches always run on the calling thread
+   */
+  BucketMatrix(const boost::property_tree::ptree& config = {},
+               const boost::property_tree::ptree& reader_config = {});
+
+  ~BucketMatrix();
+
+  /**
+   * Whether the matrix of a request can be computed on an overlay, every location needs a
+   * candidate edge on the level of the overlay and none of them may have a time.
+   * @param  options  the request options
+   * @param  overlay  the overlay of the costing of the request
+   * @return true if the overlay can be used
+   */
+  static bool Applicable(const Options& options, const baldr::ContractionOverlay& overlay);
+
+  /**
+   * Forms a time distance matrix from the set of source locations to the set of target locations.
+   * @param  request              the request with the sources and targets, gets the matrix
+   * @param  graphreader          Graph reader for accessing routing graph.
+   * @param  mode_costing         Costing methods.
+   * @param  mode                 Travel mode to use.
+   * @param  overlay              the overlay of the costing of the request
+   * @param  max_matrix_distance  Maximum arc-length distance for current mode.
+   */
+  void SourceToTarget(Api& request,
+                      baldr::GraphReader& graphreader,
+                      const sif::mode_costing_t& mode_costing,
+                      const sif::travel_mode_t mode,
+                      const baldr::ContractionOverlay& overlay,
+                      const float max_matrix_distance);
+
+  /**
+   * Clear the temporary information generated during matrix construction.
+   */
+  void clear();
+
+protected:
+  // where a location joins or leaves the overlay
+  struct seed_t {
+    uint32_t node;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  // the costs of getting from a node to a target, kept in the bucket of the node
+  struct entry_t {
+    uint32_t target;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  // a candidate edge of a location, a source can get to a target further along the same edge
+  // without going through the overlay
+  struct on_edge_t {
+    uint32_t location;
+    float percent_along;
+    float penalty;
+    // of the whole edge
+    float cost;
+    float secs;
+    float length;
+  };
+
+  class UpwardSearch;
+
+  // Number of threads to run the searches on and the config for their readers
+  uint32_t thread_count_;
+  boost::property_tree::ptree reader_config_;
+  std::unique_ptr<SearchPool> pool_;
+
+  // one search per thread, kept for the next request
+  std::vector<std::unique_ptr<UpwardSearch>> searches_;
+
+  std::vector<std::vector<seed_t>> source_seeds_;
+  std::vector<std::vector<seed_t>> target_seeds_;
+
+  // the candidate edges of each source and those of the targets by edge
+  std::vector<std::vector<std::pair<uint64_t, on_edge_t>>> source_edges_;
+  std::unordered_map<uint64_t, std::vector<on_edge_t>> target_edges_;
+
+  // the entries the target searches of each thread found, and all of them by node
+  std::vector<std::vector<std::pair<uint32_t, entry_t>>> found_;
+  std::vector<uint32_t> bucket_offsets_;
+  std::vector<entry_t> buckets_;
+
+  // best cost, time and distance from each source to each target, row by row
+  std::vector<float> costs_;
+  std::vector<float> times_;
+  std::vector<float> distances_;
+
+  /**
+   * Get the cost threshold based on the mode and the max arc-length distance for that mode.
+   * @param  mode                 Travel mode to use.
+   * @param  max_matrix_distance  Maximum arc-length distance for current mode.
+   */
+  static float GetCostThreshold(const sif::travel_mode_t mode, const float max_matrix_distance);
+
+  /**
+   * Finds where the locations join (targets) or leave (sources) the overlay.
+   * @param  locations    the locations
+   * @param  overlay      the overlay
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      the costing of the request
+   * @param  is_source    whether the locations are the sources
+   */
+  void Seed(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+            const baldr::ContractionOverlay& overlay,
+            baldr::GraphReader& graphreader,
+            const sif::DynamicCost& costing,
+            const bool is_source);
+
+  /**
+   * Fills the buckets from the target seeds and then the best cost, time and distance from each
+   * source to each target from the source seeds.
+   * @param  overlay      the overlay
+   * @param  threshold    the cost beyond which the searches stop
+   * @param  graphreader  Graph reader for the calling thread
+   */
+  void Compute(const baldr::ContractionOverlay& overlay,
+               const float threshold,
+               baldr::GraphReader& graphreader);
+
+  /**
+   * Runs search(index, thread) for every index below count, on the pool if there is one. Each
+   * thread works on every thread_count-th index so it only touches its own search.
+   * @param  count        the number of indices
+   * @param  search       what to do for an index
+   * @param  graphreader  Graph reader for the calling thread
+   */
+  void Run(const uint32_t count,
+           const std::function<void(const uint32_t, const uint32_t)>& search,
+           baldr::GraphReader& graphreader);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BUCKETMATRIX_H_
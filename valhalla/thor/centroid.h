@@ -1,16 +1,21 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include <valhalla/midgard/util.h>
 #include <valhalla/sif/costconstants.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/thor/dijkstras.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/searchpool.h>
 
 namespace valhalla {
 namespace thor {
@@ -80,6 +85,60 @@ template <> struct hash<valhalla::thor::PathIntersection> {
 namespace valhalla {
 namespace thor {
 
+/**
+ * The path intersections of all locations when each location is expanded by a search of its own.
+ * It is an open addressing hash table whose slots are claimed and updated with atomic operations,
+ * so the searches never wait on each other to record that their paths reached an edge. Besides the
+ * paths that converged on an edge pair it keeps the cost of the most expensive of them. The table
+ * can only grow while no search is running.
+ */
+class SharedIntersections {
+public:
+  /**
+   * Empties the table
+   * @param location_count  the number of paths
+   * @param capacity        the number of slots, a power of 2
+   */
+  void reset(uint8_t location_count, size_t capacity);
+
+  /**
+   * Marks that a path has found its shortest path to an edge pair
+   * @param edge_id   the lesser id of the edge and its opposing edge
+   * @param path_id   the index of the path
+   * @param cost      the cost of the path to the edge
+   * @param max_cost  set to the cost of the most expensive path once all the paths converged
+   * @return true if this call made the last of the paths converge on the edge pair
+   */
+  bool AddPath(uint64_t edge_id, uint8_t path_id, float cost, float& max_cost);
+
+  /**
+   * Whether the table is full enough that it should grow before the searches go on
+   */
+  bool crowded() const {
+    return size_.load(std::memory_order_relaxed) * 2 > capacity_;
+  }
+
+  /**
+   * Doubles the number of slots, no search may be running
+   */
+  void grow();
+
+protected:
+  struct Slot {
+    std::atomic<uint64_t> key;      // edge id + 1, 0 while the slot is free
+    std::atomic<uint64_t> mask[2];  // the paths that have converged here
+    std::atomic<uint32_t> cost;     // the bits of the highest cost of those paths
+    std::atomic<uint32_t> arrived;  // the number of paths that have converged here
+  };
+
+  Slot& claim(uint64_t key);
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t capacity_ = 0;
+  std::atomic<size_t> size_{0};
+  uint8_t location_count_ = 0;
+};
+
 /**
  * TODO: explain this better and more accurately, the claim about minimum isnt quite accurate
  * A best first (dijkstras) path algorithm which given a set of locations, will find the set of paths
@@ -91,6 +150,17 @@ namespace thor {
  */
 class Centroid : public thor::Dijkstras {
 public:
+  /**
+   * Constructor
+   * @param config         the thor config, centroid_threads sets how many threads expand the
+   *                       locations at the same time
+   * @param reader_config  the config of the graph reader each extra thread keeps
+   */
+  explicit Centroid(const boost::property_tree::ptree& config = {},
+                    const boost::property_tree::ptree& reader_config = {});
+
+  ~Centroid() override;
+
   /**
    * Returns a path for each location to a common intersection point (centroid) of all locations paths
    * such that each path is the shortest path to that common intersection point
@@ -116,7 +186,51 @@ public:
    */
   virtual void Clear() override;
 
+  /**
+   * Get how much label memory the expansions keep between requests.
+   */
+  LabelMemory label_memory() const;
+
 protected:
+  // The expansion of one location when the locations are expanded in parallel
+  class LocationSearch;
+
+  /**
+   * Expands every location with a search of its own on the search pool. The searches go on in
+   * rounds of growing cost, in between which the shared intersection table may grow. Every
+   * search stops once its cost passes the cheapest intersection all paths converged on, as no
+   * later intersection can be cheaper than that anymore.
+   *
+   * @param expansion_type  forward or reverse
+   * @param api             the locations to expand from
+   * @param reader          graph reader of the calling thread
+   * @param costings        per mode costing objects
+   * @param mode            the mode specifying which costing to use
+   */
+  void ExpandParallel(const ExpansionType& expansion_type,
+                      valhalla::Api& api,
+                      baldr::GraphReader& reader,
+                      const sif::mode_costing_t& costings,
+                      const sif::TravelMode mode);
+
+  /**
+   * Records that a search has found its shortest path to an edge and keeps the intersection if
+   * all the paths converged on it and it is the cheapest so far. Called by the searches on the
+   * pool threads.
+   *
+   * @param reader   graph reader of the calling thread
+   * @param label    the label of the edge
+   * @param path_id  the index of the location of the search
+   */
+  void Converge(baldr::GraphReader& reader, const sif::EdgeLabel& label, uint8_t path_id);
+
+  /**
+   * The cost of the cheapest intersection all paths have converged on so far
+   */
+  float best_cost() const {
+    return best_cost_.load(std::memory_order_relaxed);
+  }
+
   /**
    * This callback is used to notify the child class of an edge who has been reached. We only care
    * about edges who have been settled which means we can completely ignore this
@@ -170,6 +284,28 @@ protected:
             baldr::GraphReader& reader,
             valhalla::Location& centroid) const;
 
+  /**
+   * Walks back the labels of one location to recover its path to the centroid
+   *
+   * @param expansion_type  forward or reverse
+   * @param edgestatus      the edge status of the expansion of the location
+   * @param labels          the edge labels of the expansion of the location
+   * @param path_id         the path id of the location within the expansion
+   * @param edge_id         the edge at the centroid
+   * @param opp_id          the opposing edge at the centroid
+   * @param reader          used for accessing graph primitives
+   * @param path            the path to fill in
+   */
+  template <typename label_container_t>
+  void FormPath(const ExpansionType& expansion_type,
+                const EdgeStatus& edgestatus,
+                const label_container_t& labels,
+                uint8_t path_id,
+                const baldr::GraphId& edge_id,
+                const baldr::GraphId& opp_id,
+                baldr::GraphReader& reader,
+                std::vector<PathInfo>& path) const;
+
   // the key is the edge id and the value is the label indices for each location
   // we store both directions of the edge to avoid strange uturns at the centroid
   std::unordered_set<PathIntersection> intersections_;
@@ -180,6 +316,20 @@ protected:
 
   // number of paths we are tracking
   uint8_t location_count_;
+
+  // to expand the locations in parallel
+  uint32_t thread_count_;
+  boost::property_tree::ptree config_;
+  boost::property_tree::ptree reader_config_;
+  std::unique_ptr<SearchPool> pool_;
+  std::vector<std::unique_ptr<LocationSearch>> searches_;
+  bool parallel_;
+
+  // the intersections the parallel searches share and the cheapest one all paths converged on
+  SharedIntersections shared_intersections_;
+  std::atomic<float> best_cost_;
+  uint64_t best_edge_id_;
+  std::mutex best_mutex_;
 };
 
 } // namespace thor
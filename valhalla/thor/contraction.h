@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/contraction.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Answers routes from the contraction overlays built by mjolnir::ContractionBuilder. The overlays
+ * are costed without time and with the default options of their costing so they can only be used
+ * for requests which don't customize any of that, see Applicable. The overlay is node based, paths
+ * which cross a complex or simple turn restriction are rejected and an empty result is returned so
+ * that the caller can fall back to a regular search.
+ */
+class ContractionPathAlgorithm : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param config A config object of key, value pairs
+   */
+  explicit ContractionPathAlgorithm(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Loads the overlays of the costings listed in mjolnir.contraction.costings from the tile
+   * directory. Overlays which are missing or which were built from other tiles are skipped.
+   * @param config  the full config
+   * @param reader  graph reader used to check the overlays match the tiles
+   */
+  void Load(const boost::property_tree::ptree& config, baldr::GraphReader& reader);
+
+  /**
+   * The overlay of the costing of a request if the request can be answered from it, that is if it
+   * uses the default options of the costing and doesn't avoid anything
+   * @param options  the request options
+   * @return the overlay or nullptr if there is none the request could use
+   */
+  std::shared_ptr<const baldr::ContractionOverlay> Overlay(const Options& options) const;
+
+  /**
+   * Whether there is an overlay which can answer a route between the locations
+   * @param origin   origin location
+   * @param dest     destination location
+   * @param options  the request options
+   * @return true if the overlay can be used for the request
+   */
+  bool Applicable(const valhalla::Location& origin,
+                  const valhalla::Location& dest,
+                  const Options& options) const;
+
+  /**
+   * Finds the path on the overlay and unpacks it into the edges of the routing graph.
+   * @param  origin       Origin location
+   * @param  dest         Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing Costing methods.
+   * @param  mode         Travel mode to use.
+   * @param  options      the request options
+   * @return the path or no paths if the overlay could not answer, callers should then fall back
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Nothing to clear, the search buffers are sized to the overlay and kept for the next request
+   */
+  void Clear() override {
+  }
+
+protected:
+  struct overlay_t {
+    std::shared_ptr<const baldr::ContractionOverlay> overlay;
+    // serialized default options of the costing, requests have to match them exactly
+    std::string default_options;
+  };
+
+  // collects the seeds of a locations candidate edges on the overlay level
+  void Seed(const valhalla::Location& location,
+            const baldr::ContractionOverlay& overlay,
+            baldr::GraphReader& graphreader,
+            const sif::DynamicCost& costing,
+            const bool is_origin);
+
+  // whether the edges can be driven one after another without crossing a turn restriction
+  bool Unrestricted(baldr::GraphReader& graphreader, const sif::DynamicCost& costing) const;
+
+  std::unordered_map<int, overlay_t> overlays_;
+  baldr::ContractionSearch search_;
+
+  // seeds and the candidate edges they came from
+  std::vector<baldr::ContractionSearch::seed_t> sources_;
+  std::vector<baldr::ContractionSearch::seed_t> targets_;
+  std::vector<baldr::GraphId> source_edges_;
+  std::vector<baldr::GraphId> target_edges_;
+
+  // the arcs and the edges of the current path
+  std::vector<uint32_t> arcs_;
+  std::vector<baldr::GraphId> path_edges_;
+};
+
+} // namespace thor
+} // namespace valhalla
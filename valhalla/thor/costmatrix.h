@@ -2,13 +2,17 @@
 #define VALHALLA_THOR_COSTMATRIX_H_
 
 #include <cstdint>
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/common.pb.h>
@@ -17,6 +21,8 @@
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/matrix_common.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/searchpool.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -79,8 +85,14 @@ public:
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   *
+   * @param config         the thor config, costmatrix_threads > 1 enables the parallel searches
+   *                       and costmatrix_target_cache_size > 0 keeps the reverse searches
+   * @param reader_config  the mjolnir config used to create one graph reader per helper thread,
+   *                       when empty the searches always run on the calling thread
    */
-  CostMatrix(const boost::property_tree::ptree& config = {});
+  CostMatrix(const boost::property_tree::ptree& config = {},
+             const boost::property_tree::ptree& reader_config = {});
 
   ~CostMatrix();
 
@@ -112,14 +124,46 @@ public:
    * Sets the functor which will track the Dijkstra expansion.
    *
    * @param  expansion_callback  the functor to call back when the Dijkstra makes progress
-   *                             on a given edge
+   *                             on a given edge, it gets the edge, the edge it was reached
+   *                             from (invalid at the locations), the algorithm, the status
+   *                             ("r"eached, "s"ettled or "c"onnected), the duration, the
+   *                             distance and the cost
    */
-  using expansion_callback_t = std::function<
-      void(baldr::GraphReader&, baldr::GraphId, const char*, const char*, float, uint32_t, float)>;
+  using expansion_callback_t = std::function<void(baldr::GraphReader&,
+                                                  baldr::GraphId,
+                                                  baldr::GraphId,
+                                                  const char*,
+                                                  const char*,
+                                                  float,
+                                                  uint32_t,
+                                                  float)>;
   void set_track_expansion(const expansion_callback_t& expansion_callback) {
     expansion_callback_ = expansion_callback;
   }
 
+  /**
+   * Get how much work the last matrix did, until the matrix is cleared. The tiles the helper
+   * threads fetched with their own readers are not counted.
+   */
+  SearchStats search_stats() const {
+    auto stats = stats_;
+    for (const auto& labels : source_edgelabel_) {
+      stats.add_labels(labels);
+    }
+    for (const auto& labels : target_edgelabel_) {
+      stats.add_labels(labels);
+    }
+    return stats;
+  }
+
+  /**
+   * Number of targets of the last matrix whose reverse search was picked up from the target
+   * cache instead of starting over at the target.
+   */
+  uint32_t target_cache_hits() const {
+    return target_cache_hits_;
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -148,26 +192,75 @@ protected:
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // source location (forward traversal)
   std::vector<std::vector<sif::HierarchyLimits>> source_hierarchy_limits_;
-  std::vector<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> source_adjacency_;
+  std::vector<baldr::LabelQueue<sif::BDEdgeLabel>> source_adjacency_;
   std::vector<std::vector<sif::BDEdgeLabel>> source_edgelabel_;
   std::vector<EdgeStatus> source_edgestatus_;
 
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // target location (reverse traversal)
   std::vector<std::vector<sif::HierarchyLimits>> target_hierarchy_limits_;
-  std::vector<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> target_adjacency_;
+  std::vector<baldr::LabelQueue<sif::BDEdgeLabel>> target_adjacency_;
   std::vector<std::vector<sif::BDEdgeLabel>> target_edgelabel_;
   std::vector<EdgeStatus> target_edgestatus_;
 
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // Status updates for the other side of the search that are queued while the searches of one
+  // iteration run and applied in location order once they are done. This keeps the results the
+  // same no matter whether the searches of an iteration run serially or in parallel
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> source_pending_;
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> target_pending_;
+
+  // Edges reached by each target's reverse search during the current iteration, these are
+  // moved into the target map once all reverse searches of the iteration are done
+  std::vector<std::vector<baldr::GraphId>> target_reached_;
+
+  // Number of threads to run the searches of an iteration on and the config for their readers
+  uint32_t thread_count_;
+  boost::property_tree::ptree reader_config_;
+
+  // The priority queue the searches keep their adjacency lists in
+  baldr::QueueType queue_type_;
+
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
   // for tracking the expansion of the Dijkstra
   expansion_callback_t expansion_callback_;
 
+  // the work of the last matrix and the timer of its phases
+  SearchStats stats_;
+  SearchTimer search_timer_;
+
+  // The reverse search of a target as a matrix left it. The labels of a reverse search don't
+  // depend on the sources, a later matrix to the same target carries on from where it stopped
+  struct CachedTarget {
+    std::vector<sif::BDEdgeLabel> labels;
+    std::vector<EdgeSet> status; // the status of the edge of each label
+    std::vector<sif::HierarchyLimits> hierarchy_limits;
+
+    size_t bytes() const {
+      return labels.size() * (sizeof(sif::BDEdgeLabel) + sizeof(EdgeSet)) +
+             hierarchy_limits.size() * sizeof(sif::HierarchyLimits);
+    }
+  };
+
+  // Reverse searches kept across matrices, most recently used first, and their total size which
+  // is held below the configured number of bytes by dropping the least recently used ones
+  using target_cache_t = std::list<std::pair<std::string, CachedTarget>>;
+  target_cache_t target_cache_;
+  std::unordered_map<std::string, target_cache_t::iterator> target_cache_index_;
+  size_t target_cache_bytes_;
+  size_t target_cache_size_;
+  uint32_t time_bucket_;
+
+  // The cache key of each target of the current matrix, empty when it isn't cached, and the
+  // number of labels its reverse search was restored with
+  std::vector<std::string> target_keys_;
+  std::vector<size_t> target_restored_;
+  uint32_t target_cache_hits_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -209,18 +302,52 @@ protected:
                                baldr::GraphReader& graphreader);
 
   /**
-   * Update status when a connection is found.
+   * Update status when a connection is found. The source status is updated right
+   * away while the update of the target status is queued until the forward searches
+   * of the current iteration are done.
    * @param  source  Source index
    * @param  target  Target index
    */
   void UpdateStatus(const uint32_t source, const uint32_t target);
 
+  /**
+   * Remove the target from the remaining locations of the source.
+   * @param  source       Source index
+   * @param  target       Target index
+   * @param  label_count  Number of edge labels of both searches when the connection was found
+   */
+  void UpdateSourceStatus(const uint32_t source, const uint32_t target, const uint32_t label_count);
+
+  /**
+   * Remove the source from the remaining locations of the target.
+   * @param  source       Source index
+   * @param  target       Target index
+   * @param  label_count  Number of edge labels of both searches when the connection was found
+   */
+  void UpdateTargetStatus(const uint32_t source, const uint32_t target, const uint32_t label_count);
+
+  /**
+   * Runs one step of the search of each location, either serially or spread over the
+   * search pool. The search must only touch the state of its own location.
+   * @param  count        Number of locations
+   * @param  search       The search step to run for a location index with a graph reader
+   * @param  graphreader  Graph reader for the calling thread
+   */
+  void RunSearches(const uint32_t count,
+                   const std::function<void(const uint32_t, baldr::GraphReader&)>& search,
+                   baldr::GraphReader& graphreader);
+
   /**
    * Iterate the backward search from the target/destination location.
    * @param  index        Index of the target location.
    * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  time_info    the time to arrive at the target at, invalid without one
+   * @param  invariant    whether time is invariant
    */
-  void BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
+  void BackwardSearch(const uint32_t index,
+                      baldr::GraphReader& graphreader,
+                      const baldr::TimeInfo& time_info,
+                      const bool invariant);
 
   /**
    * Sets the source/origin locations. Search expands forward from these
@@ -237,9 +364,11 @@ protected:
    * these locations.
    * @param  graphreader   Graph reader for accessing routing graph.
    * @param  targets       List of target locations.
+   * @param  time_infos    the times to arrive at the targets at
    */
   void SetTargets(baldr::GraphReader& graphreader,
-                  const google::protobuf::RepeatedPtrField<valhalla::Location>& targets);
+                  const google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
+                  const std::vector<baldr::TimeInfo>& time_infos);
 
   /**
    * Update destinations along an edge that has been settled (lowest cost path
@@ -266,15 +395,44 @@ protected:
    * @param   graphreader  Graph tile reader
    * @param   origins      The source locations
    * @param   targets      The target locations
-   * @param   time_infos   The time info objects for the sources
+   * @param   source_time_infos  The time info objects for the sources
+   * @param   target_time_infos  The time info objects for the targets, used when the sources
+   *                             have no time
    * @param   invariant    Whether time is invariant
    */
   void RecostPaths(baldr::GraphReader& graphreader,
                    google::protobuf::RepeatedPtrField<valhalla::Location>& sources,
                    google::protobuf::RepeatedPtrField<valhalla::Location>& targets,
-                   const std::vector<baldr::TimeInfo>& time_infos,
+                   const std::vector<baldr::TimeInfo>& source_time_infos,
+                   const std::vector<baldr::TimeInfo>& target_time_infos,
                    bool invariant);
 
+  /**
+   * Sets the cache key of each target. Targets reached the same way under the same costing at
+   * the same time have the same reverse search.
+   * @param  request      the matrix request with the correlated targets
+   * @param  graphreader  Graph reader to get the dataset of the tiles the targets are on
+   * @param  time_infos   the times to arrive at the targets at
+   * @param  invariant    whether time is invariant
+   */
+  void SetTargetKeys(const Api& request,
+                     baldr::GraphReader& graphreader,
+                     const std::vector<baldr::TimeInfo>& time_infos,
+                     const bool invariant);
+
+  /**
+   * Restores the reverse search of a target from the cache.
+   * @param  index        Index of the target location.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @return true if the target was in the cache
+   */
+  bool RestoreTarget(const uint32_t index, baldr::GraphReader& graphreader);
+
+  /**
+   * Puts the reverse searches that grew during this matrix into the cache.
+   */
+  void CacheTargets();
+
   /**
    * Sets the date_time on the origin locations.
    *
@@ -300,6 +458,9 @@ private:
 
   // Mark each target edge with a list of target indexes that have reached it
   std::unique_ptr<TargetMap> targets_;
+
+  // Helper threads, each with its own graph reader, created on first use
+  std::unique_ptr<SearchPool> pool_;
 };
 
 } // namespace thor
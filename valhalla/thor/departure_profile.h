@@ -0,0 +1,136 @@
+#ifndef VALHALLA_THOR_DEPARTURE_PROFILE_H_
+#define VALHALLA_THOR_DEPARTURE_PROFILE_H_
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/time_info.h>
+#include <valhalla/proto/common.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Finds the travel time between two locations for a series of departure times in one expansion,
+ * the way a profile search does. Every edge label carries the time since each of the departures
+ * it is reached at, and an edge is expanded again whenever one of its times gets better, until
+ * no time left in the queue can better any arrival at the destination. The edge costs of the
+ * departures that reach an edge within the same predicted speed bucket are only asked for once.
+ *
+ * Each departure gets the fastest time of its own, so the paths behind the times may differ.
+ * Access restrictions are checked as for a route that is not time dependent.
+ */
+class DepartureProfile {
+public:
+  /**
+   * Computes the travel times.
+   * @param  origin        the origin with its correlated edges
+   * @param  destination   the destination with its correlated edges
+   * @param  graphreader   graph reader for accessing the routing graph
+   * @param  mode_costing  costing methods
+   * @param  mode          travel mode to use
+   * @param  departures    the times of the departures from the origin
+   * @return the travel time in seconds for each departure, -1 where there is no route
+   */
+  std::vector<float> Compute(const valhalla::Location& origin,
+                             const valhalla::Location& destination,
+                             baldr::GraphReader& graphreader,
+                             const sif::mode_costing_t& mode_costing,
+                             const sif::travel_mode_t mode,
+                             const std::vector<baldr::TimeInfo>& departures);
+
+  /**
+   * Clear the temporary information generated during the expansion.
+   */
+  void Clear();
+
+  /**
+   * Sets the function which checks whether the request was cancelled.
+   * @param  interrupt  the function, nullptr for none
+   */
+  void set_interrupt(const std::function<void()>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
+protected:
+  /**
+   * Adds the origin edges with the times to their ends.
+   */
+  void SetOrigin(baldr::GraphReader& graphreader,
+                 const valhalla::Location& origin,
+                 const std::vector<baldr::TimeInfo>& departures);
+
+  /**
+   * Expands from the end node of a label, possibly through node transitions.
+   */
+  void Expand(baldr::GraphReader& graphreader,
+              const baldr::GraphId& node,
+              const uint32_t pred_idx,
+              const std::vector<baldr::TimeInfo>& departures,
+              const bool from_transition);
+
+  /**
+   * Gets the seconds along an edge for each departure reaching its start at the given times.
+   * Departures whose times fall into the same predicted speed bucket share the cost.
+   * @param  edge       the directed edge
+   * @param  tile       the tile of the edge
+   * @param  elapsed    the seconds since each departure the edge is reached at
+   * @param  tz_index   the timezone at the start of the edge
+   * @param  departures the times of the departures
+   * @param  secs       the seconds along the edge for each departure
+   */
+  void EdgeSeconds(const baldr::DirectedEdge* edge,
+                   const graph_tile_ptr& tile,
+                   const float* elapsed,
+                   const uint32_t tz_index,
+                   const std::vector<baldr::TimeInfo>& departures,
+                   std::vector<float>& secs);
+
+  /**
+   * Lets the label at an index know about times to the end of its edge, queueing it again if
+   * any of them is better than it had.
+   */
+  void Improve(const uint32_t idx, const uint32_t pred_idx, const std::vector<float>& elapsed);
+
+  /**
+   * Keeps the times the destination is reached at where they are better than the best so far.
+   */
+  void Arrive(const std::vector<float>& arrivals);
+
+  sif::cost_ptr_t costing_;
+  sif::travel_mode_t mode_;
+  const std::function<void()>* interrupt_ = nullptr;
+
+  // the labels of the edges and for each of them the seconds since every departure to its end
+  std::vector<sif::EdgeLabel> labels_;
+  std::vector<float> elapsed_;
+  // whether the times of a label got better since it was last expanded
+  std::vector<bool> changed_;
+  EdgeStatus edgestatus_;
+
+  // labels by the least time that got better, the same label can be in here more than once
+  std::priority_queue<std::pair<float, uint32_t>,
+                      std::vector<std::pair<float, uint32_t>>,
+                      std::greater<std::pair<float, uint32_t>>>
+      queue_;
+
+  // how far along the destination edges the destination is and the best arrival per departure
+  std::unordered_map<uint64_t, float> destinations_;
+  std::vector<float> arrivals_;
+  // the latest of the best arrivals, labels reached later can't better any of them
+  float latest_arrival_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_DEPARTURE_PROFILE_H_
@@ -8,7 +8,7 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
@@ -18,6 +18,7 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -50,6 +51,25 @@ public:
    */
   virtual void Clear();
 
+  /**
+   * Get how much label memory the expansion keeps between requests.
+   */
+  LabelMemory label_memory() const {
+    auto memory = bd_budget_.memory();
+    memory += mm_budget_.memory();
+    return memory;
+  }
+
+  /**
+   * Get how much work the last expansion did, until the expansion is cleared.
+   */
+  SearchStats search_stats() const {
+    auto stats = stats_;
+    stats.add_labels(bdedgelabels_);
+    stats.add_labels(mmedgelabels_);
+    return stats;
+  }
+
   /**
    * Compute the best first graph traversal from a list locations
    * @param expansion_type  What type of expansion should be run
@@ -68,10 +88,19 @@ public:
    * Sets the functor which will track the Dijkstra expansion.
    *
    * @param  expansion_callback  the functor to call back when the Dijkstra makes progress
-   *                             on a given edge
+   *                             on a given edge, it gets the edge, the edge it was reached
+   *                             from (invalid at the locations), the algorithm, the status
+   *                             ("r"eached, "s"ettled or "c"onnected), the duration, the
+   *                             distance and the cost
    */
-  using expansion_callback_t = std::function<
-      void(baldr::GraphReader&, baldr::GraphId, const char*, const char*, float, uint32_t, float)>;
+  using expansion_callback_t = std::function<void(baldr::GraphReader&,
+                                                  baldr::GraphId,
+                                                  baldr::GraphId,
+                                                  const char*,
+                                                  const char*,
+                                                  float,
+                                                  uint32_t,
+                                                  float)>;
   void set_track_expansion(const expansion_callback_t& expansion_callback) {
     expansion_callback_ = expansion_callback;
   }
@@ -91,6 +120,23 @@ protected:
                const sif::mode_costing_t& mode_costing,
                const sif::TravelMode mode);
 
+  /**
+   * Continue a traversal that Compute finished, the labels of that traversal must still be
+   * around. The given labels are expanded again, in order of their cost, as are the labels they
+   * lead to, until the child-class stops or prunes the expansion again.
+   * @param  locations    The locations the traversal was computed from.
+   * @param  graphreader  Graphreader
+   * @param  mode_costing List of costing objects, the same costing the traversal was computed with
+   * @param  mode         Travel mode
+   * @param  labels       Indices of the labels to expand again, e.g. ones that were pruned before
+   */
+  template <const ExpansionType expansion_direction>
+  void Resume(google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const std::vector<uint32_t>& labels);
+
   /**
    * Compute the best first graph traversal from a list of origin locations using multimodal
    * @param  origin_locs  List of origin locations.
@@ -105,6 +151,10 @@ protected:
                     const sif::TravelMode mode,
                     const valhalla::Options& options);
 
+  // Settles the labels in the queue until it runs dry or the child-class stops the expansion
+  template <const ExpansionType expansion_direction>
+  void Settle(baldr::GraphReader& graphreader, const baldr::TimeInfo& time_info);
+
   // A child-class must implement this to learn about what nodes were expanded
   virtual void ExpandingNode(baldr::GraphReader&,
                              graph_tile_ptr,
@@ -120,6 +170,14 @@ protected:
   // A child-class must implement this to tell the algorithm how much expansion to expect to do
   virtual void GetExpansionHints(uint32_t& bucket_count, uint32_t& edge_label_reservation) const = 0;
 
+  // A child-class may keep the expansion off the edges of a node, its transitions to the nodes of
+  // the other levels are still followed
+  virtual bool ExpandEdgesOf(graph_tile_ptr /*tile*/,
+                             const baldr::NodeInfo* /*node*/,
+                             const sif::EdgeLabel& /*pred*/) {
+    return true;
+  }
+
   sif::TravelMode mode_; // Current travel mode
   uint32_t access_mode_; // Access mode used by the costing method
 
@@ -146,9 +204,13 @@ protected:
   // if `true` clean reserved memory for edge labels
   bool clear_reserved_memory_;
 
+  // How much of the edge label capacity survives a clear
+  LabelBudget bd_budget_;
+  LabelBudget mm_budget_;
+
   // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_;
-  baldr::DoubleBucketQueue<sif::MMEdgeLabel> mmadjacencylist_;
+  baldr::LabelQueue<sif::BDEdgeLabel> adjacencylist_;
+  baldr::LabelQueue<sif::MMEdgeLabel> mmadjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -156,6 +218,10 @@ protected:
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
+  // the work of the last expansion and the timer of its phases
+  SearchStats stats_;
+  SearchTimer search_timer_;
+
   // for tracking the expansion of the Dijkstra
   expansion_callback_t expansion_callback_;
 
@@ -173,7 +239,7 @@ protected:
    */
   template <typename label_container_t>
   void Initialize(label_container_t& labels,
-                  baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                  baldr::LabelQueue<typename label_container_t::value_type>& queue,
                   const uint32_t bucketsize);
 
   /**
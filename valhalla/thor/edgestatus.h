@@ -1,6 +1,11 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
@@ -50,6 +55,12 @@ struct EdgeStatusInfo {
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * The per tile arrays are carved out of large slabs which are kept around when
+ * the object is cleared, so that long lived algorithm instances (one per worker)
+ * do not hit the allocator on every request. Tiles are found through a flat open
+ * addressing table whose slots are stamped with a generation, clearing is then
+ * just a generation bump and does not touch the table or the slabs.
  */
 class EdgeStatus {
 public:
@@ -58,29 +69,25 @@ public:
    */
   EdgeStatus() = default;
 
-  // in order no to delete objects twice in destructor we should explicitly
-  // forbid copying
+  // the arrays handed out by GetPtr point into the slabs so copying makes no sense
   EdgeStatus(const EdgeStatus&) = delete;
   EdgeStatus& operator=(const EdgeStatus&) = delete;
   EdgeStatus(EdgeStatus&&) = default;
   EdgeStatus& operator=(EdgeStatus&&) = default;
 
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
-   */
-  ~EdgeStatus() {
-    clear();
-  }
-
-  /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the edge status of all tiles. The slab memory and the tile table are retained
+   * for the next use so this is constant time with respect to the number of tiles touched.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    // a wrapped generation could match stale slots so we have to really wipe them once
+    if (++generation_ == 0) {
+      std::fill(slots_.begin(), slots_.end(), slot_t{});
+      generation_ = 1;
     }
-    edgestatus_.clear();
+    size_ = 0;
+    current_slab_ = 0;
+    slab_used_ = 0;
   }
 
   /**
@@ -98,16 +105,7 @@ public:
            const graph_tile_ptr& tile,
            const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    get_or_allocate(edgeid.tile_value() | SHIFT_path_id(path_id), tile)[edgeid.id()] = {set, index};
   }
 
   /**
@@ -120,9 +118,9 @@ public:
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    auto* statuses = find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    if (statuses != nullptr) {
+      statuses[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -137,8 +135,8 @@ public:
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const auto* statuses = find(edgeid.tile_value() | SHIFT_path_id(path_id));
+    return statuses == nullptr ? EdgeStatusInfo() : statuses[edgeid.id()];
   }
 
   /**
@@ -154,23 +152,151 @@ public:
   EdgeStatusInfo*
   GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+    return &get_or_allocate(edgeid.tile_value() | SHIFT_path_id(path_id), tile)[edgeid.id()];
+  }
+
+  /**
+   * Returns the number of edge status entries currently reserved in the slabs. This is the
+   * memory that is kept alive across calls to clear().
+   * @return the number of reserved EdgeStatusInfo entries
+   */
+  size_t reserved() const {
+    size_t count = 0;
+    for (const auto& slab : slabs_) {
+      count += slab.capacity;
     }
+    return count;
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // the minimum number of entries in a slab, individual tiles larger than this get their own
+  static constexpr uint32_t kSlabSize = 1u << 18;
+  // the initial number of slots in the tile table, always a power of 2
+  static constexpr uint32_t kInitialSlots = 64;
+
+  // a slot of the open addressing tile table, only valid if its generation is the current one
+  struct slot_t {
+    uint32_t key = 0;
+    uint32_t generation = 0;
+    EdgeStatusInfo* statuses = nullptr;
+  };
+
+  // a contiguous block of memory from which the per tile arrays are carved
+  struct slab_t {
+    std::unique_ptr<EdgeStatusInfo[]> data;
+    uint32_t capacity;
+  };
+
+  static uint32_t hash(uint32_t key) {
+    // the level sits in the low bits and the path id in the high bits so mix all of them down
+    key ^= key >> 16;
+    key *= 0x45d9f3bu;
+    key ^= key >> 16;
+    return key;
+  }
+
+  /**
+   * Finds the array of the given tile if it has been allocated since the last clear
+   * @param key  the tile and path id
+   * @return the array or nullptr if the tile has not been seen yet
+   */
+  EdgeStatusInfo* find(uint32_t key) const {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    const uint32_t mask = slots_.size() - 1;
+    for (uint32_t i = hash(key) & mask;; i = (i + 1) & mask) {
+      const auto& slot = slots_[i];
+      if (slot.generation != generation_) {
+        return nullptr;
+      }
+      if (slot.key == key) {
+        return slot.statuses;
+      }
+    }
+  }
+
+  /**
+   * Finds the array of the given tile or carves a new, reset one out of the slabs
+   * @param key   the tile and path id
+   * @param tile  the tile, used to size the array
+   * @return the array for the tile
+   */
+  EdgeStatusInfo* get_or_allocate(uint32_t key, const graph_tile_ptr& tile) {
+    // keep the load factor at or below one half so probe sequences stay short
+    if ((size_ + 1) * 2 > slots_.size()) {
+      grow();
+    }
+    const uint32_t mask = slots_.size() - 1;
+    uint32_t i = hash(key) & mask;
+    for (; slots_[i].generation == generation_; i = (i + 1) & mask) {
+      if (slots_[i].key == key) {
+        return slots_[i].statuses;
+      }
+    }
+
+    // the tile is not in the table, grab an array for it and reset its contents
+    const uint32_t count = tile->header()->directededgecount();
+    auto* statuses = allocate(count);
+    std::fill_n(statuses, count, EdgeStatusInfo());
+    slots_[i] = {key, generation_, statuses};
+    ++size_;
+    return statuses;
+  }
+
+  /**
+   * Bump allocates space for count entries from the slabs, moving on to (or adding) another
+   * slab when the current one is full. The arrays of previous slabs are never moved.
+   * @param count  the number of entries needed
+   * @return pointer to the first entry
+   */
+  EdgeStatusInfo* allocate(uint32_t count) {
+    while (current_slab_ < slabs_.size()) {
+      auto& slab = slabs_[current_slab_];
+      if (slab_used_ + count <= slab.capacity) {
+        auto* statuses = slab.data.get() + slab_used_;
+        slab_used_ += count;
+        return statuses;
+      }
+      ++current_slab_;
+      slab_used_ = 0;
+    }
+    const uint32_t capacity = std::max(kSlabSize, count);
+    slabs_.push_back({std::unique_ptr<EdgeStatusInfo[]>(new EdgeStatusInfo[capacity]), capacity});
+    slab_used_ = count;
+    return slabs_.back().data.get();
+  }
+
+  /**
+   * Doubles the tile table and rehashes the slots of the current generation
+   */
+  void grow() {
+    std::vector<slot_t> old(std::max<size_t>(kInitialSlots, slots_.size() * 2));
+    old.swap(slots_);
+    const uint32_t mask = slots_.size() - 1;
+    for (const auto& slot : old) {
+      if (slot.generation != generation_) {
+        continue;
+      }
+      uint32_t i = hash(slot.key) & mask;
+      while (slots_[i].generation == generation_) {
+        i = (i + 1) & mask;
+      }
+      slots_[i] = slot;
+    }
+  }
+
+  // open addressing table from tile id (level and tile id and path id) to its status array
+  std::vector<slot_t> slots_;
+  // the current generation, slots stamped with any other generation are free
+  uint32_t generation_ = 1;
+  // the number of tiles in the table for the current generation
+  size_t size_ = 0;
+  // the slabs backing the status arrays, retained across clears
+  std::vector<slab_t> slabs_;
+  // the slab we are currently bump allocating from and how much of it is used
+  size_t current_slab_ = 0;
+  uint32_t slab_used_ = 0;
 };
 
 } // namespace thor
@@ -1,9 +1,12 @@
 #ifndef VALHALLA_THOR_ISOCHRONE_H_
 #define VALHALLA_THOR_ISOCHRONE_H_
 
+#include <chrono>
 #include <cstdint>
+#include <list>
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -12,6 +15,7 @@
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
+#include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/gridded_data.h>
 #include <valhalla/proto/common.pb.h>
 #include <valhalla/sif/dynamiccost.h>
@@ -41,12 +45,24 @@ public:
   virtual ~Isochrone() {
   }
 
+  /**
+   * Clear the temporary memory, unless it holds the expansion of a cached grid which a later
+   * request may extend.
+   */
+  virtual void Clear() override;
+
   /**
    * Compute an isochrone grid. This creates and populates a lat,lon grid with
    * time taken to reach each grid point. This gridded data is then contoured
    * so it can be output as polygons. Multiple locations are allowed as the
    * origins - within some reasonable distance from each other.
    *
+   * With isochrone_cache.size in the thor config the grids of recent requests are kept, keyed by
+   * the snapped locations, the costing options, the time and the kind of contours. A request
+   * whose contours fit into a cached grid with cells at least as small gets that grid back
+   * without expanding. When the contours reach further than the grid of the last expansion the
+   * expansion continues from where it stopped, onto a larger grid with the same cell size.
+   *
    * @param expansion_type  Which type of expansion to do, forward/reverse/mulitmodal
    * @param api             The request response containing the locations to seed the expansion
    * @param reader          Graph reader to provide access to graph primitives
@@ -71,6 +87,14 @@ public:
     inner_expansion_callback_ = callback;
   }
 
+  /**
+   * Number of threads to generate the contours of the grid with, from isochrone_contour_threads
+   * in the thor config.
+   */
+  size_t contour_threads() const {
+    return contour_threads_;
+  }
+
 protected:
   // when we expand up to a node we color the cells of the grid that the edge that ends at the
   // node touches
@@ -89,21 +113,77 @@ protected:
   virtual void GetExpansionHints(uint32_t& bucket_count,
                                  uint32_t& edge_label_reservation) const override;
 
+  // a hierarchical expansion only takes the edges of a level near the locations or a contour
+  virtual bool ExpandEdgesOf(graph_tile_ptr tile,
+                             const baldr::NodeInfo* node,
+                             const sif::EdgeLabel& pred) override;
+
   float shape_interval_; // Interval along shape to mark time
+  size_t contour_threads_;
   float max_seconds_;
   float max_meters_;
+  float max_distance_; // Distance from the locations the grid covers
+  bool has_time_;      // Whether there are time contours
+  bool has_distance_;  // Whether there are distance contours
+  midgard::GriddedData<2>::value_type grid_max_; // Value of the cells that arent reached
   std::shared_ptr<midgard::GriddedData<2>> isotile_;
   expansion_callback_t inner_expansion_callback_;
+  std::vector<int32_t> shape_tiles_; // Tile ids of the resampled shape of the edge being marked
+
+  // A grid of an earlier request and how far it reaches
+  struct cached_grid_t {
+    std::string key;
+    std::shared_ptr<const midgard::GriddedData<2>> grid;
+    float max_seconds;
+    float max_meters;
+    float max_distance;
+    std::chrono::steady_clock::time_point created;
+  };
+  size_t cache_size_;
+  std::chrono::steady_clock::duration cache_max_age_;
+  std::list<cached_grid_t> cache_; // most recently used first
+
+  // The key of the grid whose expansion we kept to extend it and the labels the expansion pruned
+  std::string resumable_key_;
+  std::vector<uint32_t> pruned_;
+
+  // A hierarchical expansion leaves the roads of a level to the levels above it once it is further
+  // from the locations than the level reaches, except near the contours where every road counts
+  bool hierarchical_;
+  std::vector<float> level_reach_; // Squared meters around the locations each level is expanded in
+  float boundary_band_;            // Fraction of a contour around it in which all levels expand
+  std::vector<midgard::DistanceApproximator<midgard::PointLL>> origins_;
+  std::vector<float> contour_seconds_;
+  std::vector<float> contour_meters_;
 
   /**
-   * Constructs the isotile - 2-D gridded data containing the time
-   * to get to each lat,lng tile.
+   * Sets the limits of the expansion from the largest contours of the request.
    * @param  multimodal  True if the route type is multimodal.
    * @param  api         Request information
-   * @param  locations   List of origin locations.
    * @param  mode        Travel mode
+   * @return the size of the grid cells that fits the limits
+   */
+  float SetLimits(const bool multimodal, const valhalla::Api& api, const sif::TravelMode mode);
+
+  /**
+   * Constructs the isotile - 2-D gridded data containing the time
+   * to get to each lat,lng tile - that covers the limits set before.
+   * @param  api         Request information
+   * @param  grid_size   Size of the grid cells
    */
-  void ConstructIsoTile(const bool multimodal, const valhalla::Api& api, const sif::TravelMode mode);
+  void ConstructIsoTile(const valhalla::Api& api, const float grid_size);
+
+  // Everything the grid of a request depends on besides how far it reaches
+  std::string CacheKey(const ExpansionType expansion_type, const valhalla::Api& api) const;
+
+  // Drops the expansion we kept to extend its grid
+  void ForgetExpansion();
+
+  /**
+   * Sets up a hierarchical expansion around the locations of the request, up to its contours.
+   * @param  api  Request information
+   */
+  void SetHierarchy(const valhalla::Api& api);
 
   /**
    * Updates the isotile using the edge information from the predecessor edge
@@ -129,6 +209,25 @@ protected:
   void UpdateIsoTileAlongSegment(const midgard::PointLL& from,
                                  const midgard::PointLL& to,
                                  float seconds,
+                                 float meters) {
+    UpdateIsoTileAlongSegment(from, to, isotile_->TileId(from), isotile_->TileId(to), seconds,
+                              meters);
+  }
+
+  /**
+   * Updates the isotile along short segment whose tiles are already known
+   * @param from Segment begin
+   * @param to Segment end
+   * @param tile1 Tile id of the segment begin
+   * @param tile2 Tile id of the segment end
+   * @param seconds Time contour level in seconds
+   * @param meters Distance contour level in meters
+   */
+  void UpdateIsoTileAlongSegment(const midgard::PointLL& from,
+                                 const midgard::PointLL& to,
+                                 int32_t tile1,
+                                 int32_t tile2,
+                                 float seconds,
                                  float meters);
 };
 
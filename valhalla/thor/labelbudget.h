@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace thor {
+
+// How many clears in a row have to use less than a quarter of the retained labels before the
+// retained labels are trimmed down to what those clears needed
+constexpr uint32_t kDefaultLabelTrimAfter = 16;
+
+/**
+ * Bytes of label storage an algorithm holds on to between requests and how much of it the last
+ * request used.
+ */
+struct LabelMemory {
+  uint64_t reserved_bytes = 0;  // Capacity kept after the last clear
+  uint64_t used_bytes = 0;      // Labels the last request created
+  uint64_t peak_used_bytes = 0; // Most labels any request created
+  uint32_t trims = 0;           // Times the capacity was given back
+
+  LabelMemory& operator+=(const LabelMemory& other) {
+    reserved_bytes += other.reserved_bytes;
+    used_bytes += other.used_bytes;
+    peak_used_bytes = std::max(peak_used_bytes, other.peak_used_bytes);
+    trims += other.trims;
+    return *this;
+  }
+};
+
+/**
+ * Decides how much of a label vector survives a clear. Path algorithms are kept alive between
+ * requests, so keeping the capacity saves regrowing it, but a single outlier request must not
+ * leave it inflated for the life of the worker:
+ *  - capacity above the high water mark (max_reserved_labels_count) is given back right away
+ *  - capacity below it is only given back once trim_after clears in a row used less than a
+ *    quarter of it, and then only down to the most any of those clears used
+ *  - with clear_reserved_memory everything is given back on every clear
+ */
+class LabelBudget {
+public:
+  LabelBudget(const uint32_t high_water, const bool clear_reserved_memory, const uint32_t trim_after)
+      : high_water_(clear_reserved_memory ? 0 : high_water), trim_after_(trim_after) {
+  }
+
+  LabelBudget(const boost::property_tree::ptree& config,
+              const uint32_t high_water,
+              const bool clear_reserved_memory)
+      : LabelBudget(high_water,
+                    clear_reserved_memory,
+                    config.get<uint32_t>("label_trim_after", kDefaultLabelTrimAfter)) {
+  }
+
+  /**
+   * Empty the labels, keeping as much capacity as the policy allows.
+   * @param  labels  The label vector of the algorithm.
+   */
+  template <typename label_t> void clear(std::vector<label_t>& labels) {
+    const size_t used = labels.size();
+    memory_.used_bytes = used * sizeof(label_t);
+    memory_.peak_used_bytes = std::max(memory_.peak_used_bytes, memory_.used_bytes);
+
+    // the most the quiet clears since the last trim needed, that is what we shrink to
+    if (used * 4 < labels.capacity()) {
+      ++quiet_clears_;
+      quiet_peak_ = std::max(quiet_peak_, used);
+    } else {
+      quiet_clears_ = 0;
+      quiet_peak_ = 0;
+    }
+
+    size_t keep = labels.capacity();
+    if (keep > high_water_) {
+      keep = high_water_;
+    } else if (trim_after_ > 0 && quiet_clears_ >= trim_after_) {
+      keep = quiet_peak_;
+    }
+
+    labels.clear();
+    if (keep < labels.capacity()) {
+      std::vector<label_t> trimmed;
+      trimmed.reserve(keep);
+      labels.swap(trimmed);
+      quiet_clears_ = 0;
+      quiet_peak_ = 0;
+      ++memory_.trims;
+    }
+    memory_.reserved_bytes = labels.capacity() * sizeof(label_t);
+  }
+
+  /**
+   * Get the label memory the policy has seen so far.
+   */
+  const LabelMemory& memory() const {
+    return memory_;
+  }
+
+protected:
+  size_t high_water_;
+  uint32_t trim_after_;
+  uint32_t quiet_clears_ = 0;
+  size_t quiet_peak_ = 0;
+  LabelMemory memory_;
+};
+
+} // namespace thor
+} // namespace valhalla
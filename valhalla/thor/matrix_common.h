@@ -106,9 +106,6 @@ inline bool check_matrix_time(Api& request, const Matrix::Algorithm algo) {
       if (less_sources && algo == Matrix::TimeDistanceMatrix) {
         add_warning(request, 202);
         return false;
-      } else if (algo == Matrix::CostMatrix) {
-        add_warning(request, 206);
-        return false;
       }
       return true;
     }
@@ -73,7 +73,27 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Get how much label memory the search keeps between requests.
+   */
+  LabelMemory label_memory() const override {
+    return labels_budget_.memory();
+  }
+
+  size_t label_count() const override {
+    return edgelabels_.size();
+  }
+
+  SearchStats search_stats() const override {
+    auto stats = stats_;
+    stats.add_labels(edgelabels_);
+    return stats;
+  }
+
 protected:
+  // How much of the edge label capacity survives a clear
+  LabelBudget labels_budget_;
+
   uint32_t max_walking_dist_;
   uint32_t max_label_count_; // Max label count to allow
   sif::TravelMode mode_;     // Current travel mode
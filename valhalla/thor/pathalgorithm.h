@@ -7,13 +7,16 @@
 #include <utility>
 #include <vector>
 
+#include <valhalla/baldr/altbounds.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelbudget.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -77,6 +80,30 @@ public:
    */
   virtual void Clear() = 0;
 
+  /**
+   * Get how much label memory the algorithm keeps between requests and how much it used.
+   * @return Returns the label memory of all label vectors of the algorithm.
+   */
+  virtual LabelMemory label_memory() const {
+    return {};
+  }
+
+  /**
+   * Get the number of edge labels the last path computation created, one per edge it reached.
+   * @return Returns the number of labels until the algorithm is cleared.
+   */
+  virtual size_t label_count() const {
+    return 0;
+  }
+
+  /**
+   * Get how much work the last path computation did, until the algorithm is cleared.
+   * @return Returns the stats of the last path computation.
+   */
+  virtual SearchStats search_stats() const {
+    return stats_;
+  }
+
   /**
    * Set a callback that will throw when the path computation should be aborted
    * @param interrupt_callback  the function to periodically call to see if
@@ -124,14 +151,32 @@ public:
    * Sets the functor which will track the algorithms expansion.
    *
    * @param  expansion_callback  the functor to call back when the algorithm makes progress
-   *                             on a given edge
+   *                             on a given edge, it gets the edge, the edge it was reached
+   *                             from (invalid at the locations), the algorithm, the status
+   *                             ("r"eached, "s"ettled or "c"onnected), the duration, the
+   *                             distance and the cost
    */
-  using expansion_callback_t = std::function<
-      void(baldr::GraphReader&, baldr::GraphId, const char*, const char*, float, uint32_t, float)>;
+  using expansion_callback_t = std::function<void(baldr::GraphReader&,
+                                                  baldr::GraphId,
+                                                  baldr::GraphId,
+                                                  const char*,
+                                                  const char*,
+                                                  float,
+                                                  uint32_t,
+                                                  float)>;
   void set_track_expansion(const expansion_callback_t& expansion_callback) {
     expansion_callback_ = expansion_callback;
   }
 
+  /**
+   * Sets the landmark distances the A* heuristic bounds the cost to the destination with.
+   * Algorithms without an A* heuristic ignore them.
+   * @param  alt_bounds  the distances, nullptr to only use the straight line distance
+   */
+  void set_alt_bounds(const std::shared_ptr<const baldr::AltBounds>& alt_bounds) {
+    alt_bounds_ = alt_bounds;
+  }
+
 protected:
   const std::function<void()>* interrupt;
 
@@ -142,6 +187,13 @@ protected:
   // for tracking the expansion of the algorithm visually
   expansion_callback_t expansion_callback_;
 
+  // landmark distances for the A* heuristic
+  std::shared_ptr<const baldr::AltBounds> alt_bounds_;
+
+  // the work of the last path computation and the timer of its phases
+  SearchStats stats_;
+  SearchTimer search_timer_;
+
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
@@ -0,0 +1,198 @@
+#ifndef VALHALLA_THOR_RAPTOR_H_
+#define VALHALLA_THOR_RAPTOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/common.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/pathinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default number of transit trips a journey may take
+constexpr uint32_t kDefaultRaptorMaxRounds = 4;
+
+// Default time budget of a journey in seconds
+constexpr uint32_t kDefaultRaptorMaxDuration = 10800;
+
+/**
+ * Round based public transit routing (RAPTOR). Each round boards the next departure of every
+ * line leaving the stops that were reached earlier in the previous round, rides those trips along
+ * their transit edges and then walks the transfers to nearby stops. Round k therefore holds the
+ * earliest arrival at each stop with k trips, and the journeys to the destination that arrive
+ * earlier than every journey with fewer trips form the Pareto set of arrival time and number of
+ * transfers. Stops are reached from the origin and left for the destination by pedestrian walks
+ * bounded by the transit start/end distance of the pedestrian costing.
+ *
+ * When no transit journey is found the request is answered by the multimodal A* it derives from.
+ */
+class RaptorPathAlgorithm : public MultiModalPathAlgorithm {
+public:
+  /**
+   * Constructor.
+   * @param config A config object of key, value pairs
+   */
+  explicit RaptorPathAlgorithm(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Form the fastest transit journey between an origin and a destination, followed by the
+   * journeys with fewer transfers that arrive later if alternates were asked for.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return  Returns the path edges (and elapsed time/modes at end of
+   *          each edge) of every journey.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "RAPTOR";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+protected:
+  // Edge labels of one pedestrian walk, kept to recover the edges of the walking legs
+  struct Walk {
+    std::vector<sif::EdgeLabel> labels;
+  };
+
+  // How a stop was reached in a round
+  struct Arrival {
+    sif::Cost cost;         // Elapsed cost since the origin, the secs are the arrival time
+    uint32_t path_distance; // Distance since the origin in meters
+    uint32_t leg;           // Index of the walk or of the ride that reached the stop
+    uint32_t label;         // Label of the last edge of a walk, edge count of a ride
+    baldr::GraphId from;    // Stop the leg started at, invalid for the walk from the origin
+    uint32_t tripid;        // Trip ridden to the stop, 0 if it was walked to
+  };
+
+  // One edge of a ride along a trip
+  struct RideEdge {
+    baldr::GraphId edgeid;
+    sif::Cost cost; // Elapsed cost since the origin at the end of the edge
+    uint32_t path_distance;
+  };
+
+  // Arrivals at the stops improved in a round
+  struct Round {
+    std::unordered_map<uint64_t, Arrival> rides;    // Ridden to with the trip of this round
+    std::unordered_map<uint64_t, Arrival> arrivals; // Best of the rides and of the transfers
+  };
+
+  // A journey to the destination that no journey with fewer trips beats
+  struct Journey {
+    uint32_t round;
+    baldr::GraphId stop; // Stop the walk to the destination leaves from
+    float secs;          // Estimated arrival time at the destination
+  };
+
+  uint32_t max_rounds_;
+  uint32_t max_duration_;
+
+  std::vector<Round> rounds_;
+  std::vector<Walk> walks_;
+  std::vector<std::vector<RideEdge>> rides_;
+
+  // Best arrival time at each stop over all the rounds
+  std::unordered_map<uint64_t, float> best_;
+
+  // Walking cost from each stop near the destination to the destination
+  std::unordered_map<uint64_t, sif::Cost> egress_;
+
+  /**
+   * Walk from the seeded labels up to a distance. Walks end at transit platforms and do not
+   * ride transit lines.
+   * @param  graphreader   Graph reader.
+   * @param  pc            Pedestrian costing.
+   * @param  walk          Walk whose labels hold the seed edges.
+   * @param  max_distance  Maximum walking distance in meters.
+   * @param  settled       Called with the index of each label once its cost is final and whether
+   *                       the label ends at a platform, the walk stops when it returns false.
+   */
+  void WalkFrom(baldr::GraphReader& graphreader,
+                const std::shared_ptr<sif::DynamicCost>& pc,
+                Walk& walk,
+                const uint32_t max_distance,
+                const std::function<bool(const uint32_t, const bool)>& settled);
+
+  /**
+   * Seed a walk with the edges a pedestrian can leave a stop on.
+   * @param  graphreader  Graph reader.
+   * @param  pc           Pedestrian costing.
+   * @param  stop         Stop the walk leaves from.
+   * @param  walk         Walk to seed.
+   */
+  void SeedFromStop(baldr::GraphReader& graphreader,
+                    const std::shared_ptr<sif::DynamicCost>& pc,
+                    const baldr::GraphId& stop,
+                    Walk& walk);
+
+  /**
+   * Board the next departure of each line leaving a stop and ride the trips, recording the stops
+   * they improve in the round.
+   * @param  graphreader  Graph reader.
+   * @param  tc           Transit costing.
+   * @param  round        Round to record the rides in.
+   * @param  stop         Stop to board at.
+   * @param  arrival      Arrival at the stop in the previous round.
+   * @param  best_dest    Best arrival time at the destination so far, for pruning.
+   */
+  void BoardAt(baldr::GraphReader& graphreader,
+               const std::shared_ptr<sif::DynamicCost>& tc,
+               const uint32_t round,
+               const baldr::GraphId& stop,
+               const Arrival& arrival,
+               const float best_dest);
+
+  /**
+   * Recover the edges of a journey from the legs of its arrivals.
+   * @param  graphreader  Graph reader.
+   * @param  pc           Pedestrian costing.
+   * @param  journey      Journey to recover.
+   * @return  Returns the path info of the journey, empty if its last walk cannot be recovered.
+   */
+  std::vector<PathInfo> FormJourney(baldr::GraphReader& graphreader,
+                                    const std::shared_ptr<sif::DynamicCost>& pc,
+                                    const Journey& journey);
+
+  /**
+   * Append the edges of a walk up to a label to a path.
+   * @param  walk    The walk.
+   * @param  label   Label of its last edge.
+   * @param  base    Arrival the walk starts from, its cost and distance are added.
+   * @param  path    Path to append to.
+   */
+  void AppendWalk(const Walk& walk,
+                  const uint32_t label,
+                  const Arrival* base,
+                  std::vector<PathInfo>& path) const;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_RAPTOR_H_
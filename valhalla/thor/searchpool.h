@@ -0,0 +1,73 @@
+#ifndef VALHALLA_THOR_SEARCHPOOL_H_
+#define VALHALLA_THOR_SEARCHPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * A set of helper threads which together with the calling thread run a batch of independent
+ * searches. Searches are handed out through a shared counter so that threads which finish early
+ * keep picking up the remaining ones. Between batches the helpers spin for a while since batches
+ * are short, then they go to sleep until the next request.
+ */
+class SearchPool {
+public:
+  using search_t = std::function<void(const uint32_t, baldr::GraphReader&)>;
+
+  /**
+   * Starts the helper threads.
+   * @param  thread_count   Number of threads running searches, including the calling one
+   * @param  reader_config  Config of the graph reader each helper thread keeps
+   */
+  SearchPool(const uint32_t thread_count, const boost::property_tree::ptree& reader_config);
+
+  /**
+   * Stops and joins the helper threads.
+   */
+  ~SearchPool();
+
+  /**
+   * Runs the searches 0 to count - 1 and returns once all of them are done. The first error thrown
+   * by a search is rethrown here.
+   * @param  count        Number of searches
+   * @param  search       The search to run for an index with a graph reader of the running thread
+   * @param  graphreader  Graph reader for the calling thread
+   */
+  void run(const uint32_t count, const search_t& search, baldr::GraphReader& graphreader);
+
+private:
+  void drain(baldr::GraphReader& graphreader);
+
+  void work(baldr::GraphReader& graphreader);
+
+  std::vector<std::unique_ptr<baldr::GraphReader>> readers_;
+  std::vector<std::thread> threads_;
+  const search_t* search_;
+  uint32_t count_;
+  std::atomic<uint32_t> next_;
+  std::atomic<uint32_t> busy_;
+  std::atomic<uint64_t> round_;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable signal_;
+  bool shutdown_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_SEARCHPOOL_H_
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/graphreader.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * The phases of a search, the time of each is kept apart in the search stats.
+ */
+enum class SearchPhase : uint8_t {
+  setup = 0,     // seeding the labels at the locations
+  expansion = 1, // settling labels until the search is done
+  path = 2,      // forming the path or matrix from the labels
+};
+constexpr size_t kSearchPhaseCount = 3;
+
+/**
+ * How much work the last search of an algorithm did. Comparing these between requests and
+ * regions is what tuning the hierarchy limits and label reservations is based on.
+ */
+struct SearchStats {
+  uint64_t settled = 0;           // Labels taken off the queue and expanded
+  uint64_t reached = 0;           // Labels created, one per edge the search reached
+  uint64_t label_bytes = 0;       // Bytes of the labels created
+  uint64_t tiles_fetched = 0;     // Tiles the search asked the graph reader for
+  uint64_t tile_cache_misses = 0; // Tiles of those that were not in the cache
+  uint64_t deferred = 0;          // Expansions put off while the prefetcher read their tile
+  std::array<double, kSearchPhaseCount> phase_ms{}; // Milliseconds spent in each phase
+
+  /**
+   * Count the labels of a search.
+   * @param  labels  The label vector of the search.
+   */
+  template <typename label_t> void add_labels(const std::vector<label_t>& labels) {
+    reached += labels.size();
+    label_bytes += labels.size() * sizeof(label_t);
+  }
+
+  double ms(const SearchPhase phase) const {
+    return phase_ms[static_cast<size_t>(phase)];
+  }
+
+  SearchStats& operator+=(const SearchStats& other) {
+    settled += other.settled;
+    reached += other.reached;
+    label_bytes += other.label_bytes;
+    tiles_fetched += other.tiles_fetched;
+    tile_cache_misses += other.tile_cache_misses;
+    deferred += other.deferred;
+    for (size_t i = 0; i < kSearchPhaseCount; ++i) {
+      phase_ms[i] += other.phase_ms[i];
+    }
+    return *this;
+  }
+};
+
+/**
+ * Times the phases of a search and counts the tiles it fetched into its stats. An algorithm keeps
+ * one as a member so that the functions it calls can move on to the next phase, start() returns a
+ * guard that stops the timer when the search returns, whichever way it returns.
+ */
+class SearchTimer {
+public:
+  class Running {
+  public:
+    explicit Running(SearchTimer& timer) : timer_(timer) {
+    }
+    Running(const Running&) = delete;
+    Running& operator=(const Running&) = delete;
+    ~Running() {
+      timer_.stop();
+    }
+
+  private:
+    SearchTimer& timer_;
+  };
+
+  /**
+   * Clear the stats and start the setup phase of a new search.
+   * @param  stats   Where the search is counted.
+   * @param  reader  The graph reader of the search, tiles fetched by other readers are not counted.
+   * @return the guard that stops the timer
+   */
+  [[nodiscard]] Running start(SearchStats& stats, const baldr::GraphReader& reader) {
+    stats = {};
+    stats_ = &stats;
+    reader_ = &reader;
+    tiles_ = reader.GetTileCounts();
+    phase_ = SearchPhase::setup;
+    phase_start_ = std::chrono::steady_clock::now();
+    return Running(*this);
+  }
+
+  /**
+   * End the current phase and begin the next one, does nothing when no search is running.
+   * @param  next  The phase the search moves on to.
+   */
+  void phase(const SearchPhase next) {
+    if (!stats_) {
+      return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    stats_->phase_ms[static_cast<size_t>(phase_)] +=
+        std::chrono::duration<double, std::milli>(now - phase_start_).count();
+    phase_ = next;
+    phase_start_ = now;
+  }
+
+private:
+  void stop() {
+    if (!stats_) {
+      return;
+    }
+    phase(phase_);
+    const auto& now = reader_->GetTileCounts();
+    stats_->tiles_fetched += now.fetched - tiles_.fetched;
+    stats_->tile_cache_misses += now.cache_misses - tiles_.cache_misses;
+    stats_ = nullptr;
+    reader_ = nullptr;
+  }
+
+  SearchStats* stats_ = nullptr;
+  const baldr::GraphReader* reader_ = nullptr;
+  baldr::GraphReader::TileCounts tiles_;
+  SearchPhase phase_ = SearchPhase::setup;
+  std::chrono::steady_clock::time_point phase_start_;
+};
+
+} // namespace thor
+} // namespace valhalla
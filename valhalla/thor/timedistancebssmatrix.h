@@ -15,6 +15,7 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astarheuristic.h>
+#include <valhalla/thor/bss_tables.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/matrix_common.h>
 #include <valhalla/thor/pathalgorithm.h>
@@ -59,6 +60,7 @@ public:
     // Set the costings
     pedestrian_costing_ = mode_costing[static_cast<uint32_t>(sif::travel_mode_t::kPedestrian)];
     bicycle_costing_ = mode_costing[static_cast<uint32_t>(sif::travel_mode_t::kBicycle)];
+    use_bss_tables_ = bss_tables_ && BssTablesApplicable(request.options());
 
     const bool forward_search =
         request.options().sources().size() <= request.options().targets().size();
@@ -76,16 +78,28 @@ public:
    * matrix construction.
    */
   inline void clear() {
-    auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-    if (edgelabels_.size() > reservation) {
-      edgelabels_.resize(max_reserved_labels_count_);
-      edgelabels_.shrink_to_fit();
-    }
+    labels_budget_.clear(edgelabels_);
     reset();
     destinations_.clear();
     dest_edges_.clear();
   };
 
+  /**
+   * Get how much label memory the expansions keep between requests.
+   */
+  LabelMemory label_memory() const {
+    return labels_budget_.memory();
+  }
+
+  /**
+   * Set the bike share tables. Requests they apply to ride from station to station through the
+   * tables instead of expanding the bicycle graph.
+   * @param  tables  the tables, nullptr for none
+   */
+  void set_bss_tables(std::shared_ptr<const baldr::BssTables> tables) {
+    bss_tables_ = std::move(tables);
+  }
+
 protected:
   // Number of destinations that have been found and settled (least cost path
   // computed).
@@ -97,6 +111,9 @@ protected:
   uint32_t max_reserved_labels_count_;
   bool clear_reserved_memory_;
 
+  // How much of the edge label capacity survives a clear
+  LabelBudget labels_budget_;
+
   // A* heuristic
   AStarHeuristic pedestrian_astarheuristic_;
   AStarHeuristic bicycle_astarheuristic_;
@@ -115,6 +132,10 @@ protected:
   EdgeStatus pedestrian_edgestatus_;
   EdgeStatus bicycle_edgestatus_;
 
+  // The bike share tables and whether the current request rides through them
+  std::shared_ptr<const baldr::BssTables> bss_tables_;
+  bool use_bss_tables_ = false;
+
   // List of destinations
   std::vector<Destination> destinations_;
 
@@ -126,11 +147,6 @@ protected:
    * Reset all origin-specific information
    */
   inline void reset() {
-    auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-    if (edgelabels_.size() > reservation) {
-      edgelabels_.resize(max_reserved_labels_count_);
-      edgelabels_.shrink_to_fit();
-    }
     edgelabels_.clear();
     // Clear the per-origin information
     for (auto& dest : destinations_) {
@@ -180,6 +196,23 @@ protected:
               const bool from_bss,
               const sif::TravelMode mode);
 
+  /**
+   * Adds a bicycle label for each ride of the tables at the station at the node. Forward the
+   * rides start at the station and the label is on the edge entering the station they end at,
+   * reverse they end at the station and the label is on the edge opposing the one they start
+   * with.
+   * @param  graphreader  Graph tile reader.
+   * @param  node         Graph Id of the station node.
+   * @param  pred         Predecessor edge label, the walk to or from the station.
+   * @param  pred_idx     Predecessor index into the EdgeLabel list.
+   */
+  template <const ExpansionType expansion_direction,
+            const bool FORWARD = expansion_direction == ExpansionType::forward>
+  void ExpandRides(baldr::GraphReader& graphreader,
+                   const baldr::GraphId& node,
+                   const sif::EdgeLabel& pred,
+                   const uint32_t pred_idx);
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -1,7 +1,9 @@
 #ifndef VALHALLA_THOR_TIMEDISTANCEMATRIX_H_
 #define VALHALLA_THOR_TIMEDISTANCEMATRIX_H_
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -16,6 +18,7 @@
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/matrix_common.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -23,9 +26,16 @@ namespace thor {
 // Class to compute time + distance matrices among locations.
 class TimeDistanceMatrix {
 public:
+  // Called with each origin as soon as its cells are in the matrix of the request, the origins are
+  // the sources of a forward search and the targets of a reverse one
+  using row_callback_t =
+      std::function<void(const Api& request, const bool source, const uint32_t index)>;
+
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param config  the thor config, matrix_goal_pruning enables the pruning of the expansion
+   *                towards the unsettled destinations
    */
   TimeDistanceMatrix(const boost::property_tree::ptree& config = {});
 
@@ -56,6 +66,7 @@ public:
 
     LOG_INFO("matrix::TimeDistanceMatrix");
     request.mutable_matrix()->set_algorithm(Matrix::TimeDistanceMatrix);
+    auto timing = search_timer_.start(stats_, graphreader);
 
     // Set the mode and costing
     mode_ = mode;
@@ -77,16 +88,47 @@ public:
    * matrix construction.
    */
   inline void clear() {
-    auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
-    if (edgelabels_.size() > reservation) {
-      edgelabels_.resize(max_reserved_labels_count_);
-      edgelabels_.shrink_to_fit();
-    }
+    labels_budget_.clear(edgelabels_);
     reset();
     destinations_.clear();
     dest_edges_.clear();
+    dest_points_.clear();
+    edge_costs_.clear();
   };
 
+  /**
+   * Set a function to be called with every row of the matrix as soon as it is done, so a caller can
+   * send the rows on while the ones after them are still searched for.
+   * @param  row_callback  the function, nullptr for none
+   */
+  void set_row_callback(const row_callback_t* row_callback) {
+    row_callback_ = row_callback;
+  }
+
+  /**
+   * Set when the matrices have to be done by. The search of the origin that is running by then is
+   * abandoned and the origins after it are not searched from, the cells of all of them are left
+   * unreachable and the origins are listed as incomplete in the matrix.
+   * @param  deadline  the time, time_point::max() for none
+   */
+  void set_deadline(const std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+  }
+
+  /**
+   * Get how much label memory the expansions keep between requests.
+   */
+  LabelMemory label_memory() const {
+    return labels_budget_.memory();
+  }
+
+  /**
+   * Get how much work the last matrix did, the searches from all of its origins together.
+   */
+  const SearchStats& search_stats() const {
+    return stats_;
+  }
+
 protected:
   // Number of destinations that have been found and settled (least cost path
   // computed).
@@ -98,6 +140,9 @@ protected:
   uint32_t max_reserved_labels_count_;
   bool clear_reserved_memory_;
 
+  // How much of the edge label capacity survives a clear
+  LabelBudget labels_budget_;
+
   // List of destinations
   std::vector<Destination> destinations_;
 
@@ -108,11 +153,16 @@ protected:
   // has a vector of indexes into the destinations vector
   std::unordered_map<uint64_t, std::vector<uint32_t>> dest_edges_;
 
-  // Vector of edge labels (requires access by index).
-  std::vector<sif::EdgeLabel> edgelabels_;
+  // the work of the last matrix and the timer of its phases
+  SearchStats stats_;
+  SearchTimer search_timer_;
+
+  // Vector of edge labels (requires access by index). No path is recovered from them so they are
+  // the compact ones, the label being expanded is expanded to a full EdgeLabel for costing
+  std::vector<sif::CompactEdgeLabel> edgelabels_;
 
   // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::EdgeLabel> adjacencylist_;
+  baldr::DoubleBucketQueue<sif::CompactEdgeLabel> adjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -122,6 +172,79 @@ protected:
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
+  // The cost of an edge (of its opposing edge in reverse) and the flow it came from
+  struct edge_cost_t {
+    sif::Cost cost;
+    uint8_t flow_sources = 0;
+    bool known = false;
+  };
+
+  // Without a time the cost of an edge is the same for every origin, so the expansions of all the
+  // origins of a request share the costs the earlier ones computed. Kept per tile like the edge
+  // status so an expansion looks the tile up once and walks the edges of the node. With a time
+  // bucket the costs at a time are shared too, by the bucket of the second of the week they were
+  // costed at, bucket 0 holds the costs without a time
+  std::unordered_map<uint64_t, std::vector<edge_cost_t>> edge_costs_;
+
+  // Seconds of the week the costs of an edge at a time are shared for, 0 costs every time exactly
+  uint32_t time_bucket_;
+
+  // Whether nodes from which no unsettled destination can be reached within the cost threshold
+  // are not expanded, see PrunedByGoal
+  bool goal_pruning_;
+
+  // The least a meter can cost, that is the A* heuristic of the costing, and the largest threshold
+  // of a destination, by which the cost threshold can grow once all destinations are found
+  float cost_per_meter_;
+  float max_dest_threshold_;
+
+  // The points the destinations are correlated at with the index of their destination
+  std::vector<std::pair<uint32_t, midgard::PointLL>> dest_points_;
+
+  // The distance from each tile of the current origin's expansion to the nearest unsettled
+  // destination, with the settled count it was computed at plus one (0 is not computed)
+  std::unordered_map<uint32_t, std::pair<uint32_t, float>> tile_bounds_;
+
+  // Called with each row once it is done and the time all rows have to be done by
+  const row_callback_t* row_callback_;
+  std::chrono::steady_clock::time_point deadline_;
+
+  /**
+   * Whether the expansion from a node can be skipped because the tile of the node is too far from
+   * every unsettled destination. The straight line distance from the tile to a destination at
+   * the cost of a meter of the A* heuristic is a lower bound on the cost of any path from the
+   * node to the destination, when that already puts the destination beyond the cost threshold the
+   * search ends before it could get there through the node.
+   * @param  node  Graph Id of the node to expand.
+   * @param  cost  Cost of the path to the node.
+   * @return true if the node needn't be expanded
+   */
+  bool PrunedByGoal(const baldr::GraphId& node, const float cost);
+
+  /**
+   * Get a pointer to the shared cost of a directed edge, the edges of a node follow it.
+   * @param  edgeid     GraphId of the directed edge.
+   * @param  tile       Graph tile of the directed edge.
+   * @param  time_info  the time the edge is costed at
+   * @return pointer to the cost of the edge, nullptr if costs at this time are not shared
+   */
+  edge_cost_t* EdgeCosts(const baldr::GraphId& edgeid,
+                         const graph_tile_ptr& tile,
+                         const baldr::TimeInfo& time_info) {
+    uint64_t bucket = 0;
+    if (time_info.valid) {
+      if (time_bucket_ == 0) {
+        return nullptr;
+      }
+      bucket = time_info.second_of_week / time_bucket_ + 1;
+    }
+    auto& costs = edge_costs_[bucket << 32 | edgeid.tile_value()];
+    if (costs.empty()) {
+      costs.resize(tile->header()->directededgecount());
+    }
+    return costs.data() + edgeid.id();
+  }
+
   /**
    * Reset all origin-specific information
    */
@@ -139,6 +262,9 @@ protected:
 
     // Clear the edge status flags
     edgestatus_.clear();
+
+    // The destinations settled from here on are those of another origin
+    tile_bounds_.clear();
   };
 
   /**
@@ -275,8 +401,17 @@ protected:
                               const uint32_t origin_index,
                               const std::string& origin_dt,
                               const uint64_t& origin_tz,
-                              const baldr::GraphId& pred_id,
-                              std::vector<std::string>& out_date_times);
+                              const baldr::GraphId& pred_id);
+
+  /**
+   * Leave the cells of an origin that was not searched from unreachable and list the origin as
+   * incomplete.
+   *
+   * @param request       The full request object
+   * @param forward       Whether the origin is a source
+   * @param origin_index  Index of the origin
+   */
+  void FormIncomplete(Api& request, const bool forward, const uint32_t origin_index);
 };
 
 } // namespace thor
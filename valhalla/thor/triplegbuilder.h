@@ -27,6 +27,42 @@ struct EdgeTrimmingInfo {
   double distance_along;
 };
 
+/**
+ * What of a trip leg a request reads, worked out once per leg from the attributes controller and
+ * the options so the builder skips decoding and filling what nobody reads. A route that only
+ * returns its summary (directions_type none in the json format) builds no maneuvers, so it needs
+ * no names, signs, lanes, landmarks, headings, intersecting edges or admins.
+ */
+struct TripLegBuildPlan {
+  TripLegBuildPlan(const valhalla::Options& options, const baldr::AttributesController& controller);
+
+  // only the summary, length, time and shape of the leg are read
+  bool summary_only;
+
+  // edge names with their pronunciations and the tagged values of the edges
+  bool names;
+  bool tagged_values;
+  // the exit and guide signs of the edges and the junction names at the nodes
+  bool signs;
+  bool junction_names;
+  bool turn_lanes;
+  bool lane_connectivity;
+  bool landmarks;
+  bool begin_heading;
+  bool end_heading;
+  bool intersecting_edges;
+  bool admin_index;
+  bool incidents;
+
+  // per shape point attributes
+  bool shape_attributes;
+  bool shape_time;
+  bool shape_length;
+  bool shape_speed;
+  bool shape_speed_limit;
+  bool shape_closure;
+};
+
 /**
  * Algorithm to create a trip path output from a list of directed edges.
  */
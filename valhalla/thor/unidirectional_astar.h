@@ -61,6 +61,23 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Get how much label memory the search keeps between requests.
+   */
+  LabelMemory label_memory() const override {
+    return labels_budget_.memory();
+  }
+
+  size_t label_count() const override {
+    return edgelabels_.size();
+  }
+
+  SearchStats search_stats() const override {
+    auto stats = stats_;
+    stats.add_labels(edgelabels_);
+    return stats;
+  }
+
   /**
    * Returns the name of the algorithm
    * @return the name of the algorithm
@@ -166,6 +183,9 @@ protected:
    */
   std::vector<PathInfo> FormPath(const uint32_t dest);
 
+  // How much of the edge label capacity survives a clear
+  LabelBudget labels_budget_;
+
   uint32_t max_label_count_; // Max label count to allow
   sif::TravelMode mode_;     // Current travel mode
   uint8_t travel_type_;      // Current travel type
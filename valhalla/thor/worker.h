@@ -1,13 +1,18 @@
 #ifndef __VALHALLA_THOR_SERVICE_H__
 #define __VALHALLA_THOR_SERVICE_H__
 
+#include <chrono>
 #include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
 #include <tuple>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/attributes_controller.h>
+#include <valhalla/baldr/connectivity_map.h>
 #include <valhalla/baldr/directededge.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -19,16 +24,23 @@
 #include <valhalla/proto/trip.pb.h>
 #include <valhalla/sif/costfactory.h>
 #include <valhalla/sif/edgelabel.h>
+#include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/astar_bss.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/bucketmatrix.h>
 #include <valhalla/thor/centroid.h>
+#include <valhalla/thor/contraction.h>
 #include <valhalla/thor/costmatrix.h>
+#include <valhalla/thor/departure_profile.h>
 #include <valhalla/thor/isochrone.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/optimizer.h>
+#include <valhalla/thor/raptor.h>
 #include <valhalla/thor/timedistancebssmatrix.h>
 #include <valhalla/thor/timedistancematrix.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/thor/unidirectional_astar.h>
+#include <valhalla/thread_pool.h>
 #include <valhalla/tyr/actor.h>
 #include <valhalla/worker.h>
 
@@ -61,12 +73,14 @@ public:
                                  const baldr::GraphId& out_edge);
 
   void route(Api& request);
-  std::string matrix(Api& request);
+  std::list<std::string> matrix(Api& request);
+  std::string route_batch(Api& request);
   void optimized_route(Api& request);
   std::string isochrones(Api& request);
+  std::string isochrone_batch(Api& request);
   void trace_route(Api& request);
   std::string trace_attributes(Api& request);
-  std::string expansion(Api& request);
+  std::list<std::string> expansion(Api& request);
   void centroid(Api& request);
   void status(Api& request) const;
 
@@ -77,13 +91,29 @@ protected:
                                                     Location& origin,
                                                     Location& destination,
                                                     const std::string& costing,
-                                                    const Options& options);
+                                                    const Options& options,
+                                                    thor::SearchStats* stats = nullptr);
+  /**
+   * Record the work of a search in the request: as statistics under thor.search, in the log and,
+   * for verbose requests, as the search effort of the response.
+   * @param request    the request
+   * @param algorithm  the name of the algorithm that searched
+   * @param stats      the work it did
+   */
+  void add_search_stats(Api& request, const char* algorithm, const thor::SearchStats& stats) const;
   void log_admin(const TripLeg&);
   thor::PathAlgorithm* get_path_algorithm(const std::string& routetype,
                                           const Location& origin,
                                           const Location& destination,
                                           const Options& options);
   void route_match(Api& request);
+  /**
+   * Lets a request in unless it is one of the expensive ones and the workers of the process are
+   * already busy with as many of those as they may be. Cheap requests are always let in.
+   * @param request  the request with the cost loki estimated
+   * @return an object whose destructor lets the next expensive request in
+   */
+  midgard::Finally<std::function<void()>> admit(const Api& request) const;
   /**
    * Returns the results of the map match where the first float is the normalized
    * match score (based on alternatives), the second is the raw score (the cost)
@@ -95,6 +125,37 @@ protected:
 
   void path_arrive_by(Api& api, const std::string& costing);
   void path_depart_at(Api& api, const std::string& costing);
+
+  // the search of a leg done ahead of putting the legs of the route together
+  struct leg_search_t {
+    valhalla::Location origin;
+    valhalla::Location destination;
+    std::vector<std::vector<thor::PathInfo>> paths;
+    const char* algorithm;
+    size_t label_count;
+    thor::SearchStats stats;
+  };
+  /**
+   * Searches all the legs of a depart at route at once, spread over this worker and its leg
+   * workers. That is only done when the legs don't depend on each other: every location is a break
+   * without a time to carry over from one leg to the next and there are no alternates.
+   * @param api      the request with the correlated locations
+   * @param costing  the name of the costing
+   * @return the searches of the legs in order, none if the legs have to be searched one by one
+   */
+  std::vector<leg_search_t> search_legs(Api& api, const std::string& costing);
+  /**
+   * Times a leg for each of the departures the request asks for, the first of them at the time of
+   * the origin, and keeps the times in the leg.
+   * @param api          the request
+   * @param origin       the origin of the leg with its time
+   * @param destination  the destination of the leg
+   * @param leg          the leg to keep the times in
+   */
+  void profile_departures(Api& api,
+                          const valhalla::Location& origin,
+                          const valhalla::Location& destination,
+                          TripLeg& leg);
   void parse_measurements(const Api& request);
   std::string parse_costing(const Api& request);
 
@@ -121,28 +182,67 @@ protected:
   BidirectionalAStar bidir_astar;
   AStarBSSAlgorithm bss_astar;
   MultiModalPathAlgorithm multi_modal_astar;
+  RaptorPathAlgorithm raptor;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
+  ContractionPathAlgorithm contraction_path;
 
   // Time distance matrix
   CostMatrix costmatrix_;
   TimeDistanceMatrix time_distance_matrix_;
   TimeDistanceBSSMatrix time_distance_bss_matrix_;
+  BucketMatrix bucket_matrix_;
+
+  // Optimized route solver
+  Optimizer optimizer_;
+
+  // Travel times of a leg over a series of departures
+  DepartureProfile departure_profile_;
 
   Isochrone isochrone_gen;
+  // the isochrones of a batch are also expanded on the threads of the pool, each of them with an
+  // isochrone and a graph reader of its own on the one tile cache they all share
+  struct isochrone_batch_worker_t {
+    isochrone_batch_worker_t(const boost::property_tree::ptree& thor_config,
+                             const boost::property_tree::ptree& mjolnir_config)
+        : isochrone(thor_config), reader(std::make_shared<baldr::GraphReader>(mjolnir_config)) {
+    }
+    Isochrone isochrone;
+    std::shared_ptr<baldr::GraphReader> reader;
+  };
+  std::vector<std::unique_ptr<isochrone_batch_worker_t>> isochrone_batch_workers;
   std::shared_ptr<meili::MapMatcher> matcher;
   float max_timedep_distance;
+  // date_time routes of any length go bidirectional, its searches track the time themselves
+  bool bidirectional_time_dependent;
+  // hierarchy limits per region and costing that replace the defaults of route searches
+  std::shared_ptr<const sif::HierarchyLimitsTable> hierarchy_limits_table;
   std::unordered_map<std::string, float> max_matrix_distance;
+  // how long the time distance matrices of a request may take, 0 for no limit
+  std::chrono::milliseconds matrix_time_limit;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  // requests loki estimated to cost at least this much are expensive
+  double heavy_cost;
+  // how many expensive requests the workers of the process work on at once, 0 for no limit
+  size_t max_heavy_requests;
   std::shared_ptr<baldr::GraphReader> reader;
+  // the components of the nodes for each mode, nullptr if the tiles have no connectivity.bin
+  std::shared_ptr<const baldr::connectivity_map_t> connectivity_map;
   meili::MapMatcherFactory matcher_factory;
   baldr::AttributesController controller;
   Centroid centroid_gen;
+  // workers with their own reader and searches that search legs of a route next to this one
+  std::vector<std::unique_ptr<thor_worker_t>> leg_workers;
+  // the threads of the process the legs and the isochrones of a batch are worked on with
+  std::shared_ptr<thread_pool_t> thread_pool;
 
 private:
   std::string service_name() const override {
     return "thor";
   }
+  const baldr::GraphReader* tile_reader() const override {
+    return reader.get();
+  }
 };
 
 } // namespace thor
@@ -0,0 +1,119 @@
+#ifndef __VALHALLA_THREAD_POOL_H__
+#define __VALHALLA_THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+
+namespace valhalla {
+
+/**
+ * Threads the requests of a process share to split their work, so features running parts of a
+ * request in parallel don't each start threads of their own. A request hands the pool a job of
+ * independent tasks and works on them itself. Idle threads of the pool join the oldest job that
+ * still has tasks and take them one at a time from its shared counter, so threads that finish early
+ * take over the tasks others haven't gotten to yet. A request always finishes its job, even when
+ * all threads of the pool are busy with other requests or when a task runs a job of its own.
+ *
+ * Every thread of the pool has a graph reader of its own, their readers share one tile cache.
+ */
+class thread_pool_t {
+public:
+  /**
+   * A task of a job
+   * @param index   the index of the task in the job
+   * @param slot    the index of the thread among the ones working on the job, 0 for the thread
+   *                that runs the job and less than the most threads the job was allowed
+   * @param reader  the graph reader of the thread
+   */
+  using task_t = std::function<void(size_t index, size_t slot, baldr::GraphReader& reader)>;
+
+  /**
+   * Starts the threads.
+   * @param thread_count   number of threads besides the ones running jobs
+   * @param reader_config  the mjolnir config of the graph readers of the threads
+   */
+  thread_pool_t(size_t thread_count, const boost::property_tree::ptree& reader_config);
+
+  /**
+   * Stops and joins the threads, after they finished the tasks they are working on.
+   */
+  ~thread_pool_t();
+
+  /**
+   * The pool of the process, with as many threads as thread_pool.threads or the hardware has
+   * @param config  the whole config
+   * @return the pool, the first one to ask for it makes it and it is gone with the last owner
+   */
+  static std::shared_ptr<thread_pool_t> shared(const boost::property_tree::ptree& config);
+
+  /**
+   * Runs the tasks 0 to count - 1 on the calling thread and the threads of the pool that are free
+   * to help, and returns once all of them are done. The calling thread calls the interrupt before
+   * each of its tasks. When the interrupt or a task throws no more tasks are started and the first
+   * error is rethrown here once the tasks that did start are done.
+   * @param count        number of tasks
+   * @param task         the task to run for each index
+   * @param reader       the graph reader the calling thread runs its tasks with
+   * @param interrupt    throws when the request is to be stopped, may be nullptr
+   * @param max_threads  the most threads to work on the job, the calling one included, 0 for all
+   */
+  void run(size_t count,
+           const task_t& task,
+           baldr::GraphReader& reader,
+           const std::function<void()>* interrupt = nullptr,
+           size_t max_threads = 0);
+
+  /**
+   * @return the number of threads of the pool, not counting the ones running jobs
+   */
+  size_t size() const {
+    return threads_.size();
+  }
+
+protected:
+  struct job_t {
+    const task_t* task;
+    size_t count;
+    size_t max_threads;
+    std::atomic<size_t> next;
+    std::atomic<bool> cancelled;
+    size_t slots;   // slots handed out so far, guarded by mutex_
+    size_t running; // threads of the pool working on the job, guarded by mutex_
+    std::exception_ptr error;
+  };
+
+  // runs tasks of the job until there are none left or the job is cancelled
+  void drain(job_t& job,
+             size_t slot,
+             baldr::GraphReader& reader,
+             const std::function<void()>* interrupt);
+
+  // the oldest job a thread of the pool can help with, guarded by mutex_
+  job_t* open_job();
+
+  void work(baldr::GraphReader& reader);
+
+  std::vector<std::unique_ptr<baldr::GraphReader>> readers_;
+  std::vector<std::thread> threads_;
+  std::list<job_t*> jobs_; // oldest first
+  std::mutex mutex_;
+  std::condition_variable work_; // a job was added or the pool shuts down
+  std::condition_variable done_; // a thread of the pool left a job
+  bool shutdown_;
+};
+
+} // namespace valhalla
+
+#endif // __VALHALLA_THREAD_POOL_H__
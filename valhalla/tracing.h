@@ -0,0 +1,108 @@
+#ifndef __VALHALLA_TRACING_H__
+#define __VALHALLA_TRACING_H__
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+
+/**
+ * Add a span of the work on the request to its trace. Nothing is added unless the request is
+ * traced, because it asked for it with the X-Valhalla-Trace or traceparent header or was sampled.
+ * measure_phase_time and measure_scope_time add their spans.
+ * @param api      the request
+ * @param process  the service doing the work, loki, thor or odin
+ * @param name     what was done, like thor.expansion
+ * @param start    when it started
+ * @param end      when it was done
+ * @param kind     whether it was work, waiting or (de)serializing
+ */
+void add_trace_span(Api& api,
+                    const std::string& process,
+                    const std::string& name,
+                    std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end,
+                    TraceSpan::Kind kind = TraceSpan::compute);
+
+/**
+ * Trace a share of the requests that did not ask for it under a new random trace id.
+ * @param api   the request
+ * @param rate  the share of the requests to trace, 0 to 1
+ */
+void sample_trace(Api& api, double rate);
+
+/**
+ * Stamp a traced request with the time a stage passes it on, the next stage counts the time from
+ * then until it parsed the request as the wait between the stages.
+ * @param api  the request about to be serialized for the next stage
+ */
+void stamp_hand_off(Api& api);
+
+/**
+ * Add the spans of a traced request arriving at a stage: the queue span from when the previous
+ * stage handed it off until it was received and the serialize span of parsing it. The queue span
+ * spans hosts when the stages run on different ones, so it is only as exact as their clocks agree.
+ * @param api       the parsed request
+ * @param stage     the stage it arrived at
+ * @param received  when the stage got the request
+ * @param parsed    when the stage had parsed it
+ */
+void trace_arrival(Api& api,
+                   const std::string& stage,
+                   std::chrono::steady_clock::time_point received,
+                   std::chrono::steady_clock::time_point parsed);
+
+/**
+ * Write the spans of a traced request as the Chrome trace dir/trace_id.trace.json, which
+ * chrome://tracing and Perfetto open.
+ * @param api  the request
+ * @param dir  where traces go, nothing is written if it is empty
+ * @return whether a trace was written
+ */
+bool write_trace(const Api& api, const std::string& dir);
+
+/**
+ * Where the spans of traced requests go, the stage that answers a request gives its spans to the
+ * sink httpd.service.trace_sink names. The built in sinks are chrome, which writes a Chrome trace
+ * per request to httpd.service.trace_dir, and log, which logs every span as a json line with the
+ * fields of an OpenTelemetry span. Other sinks, like an exporter to a collector, are registered
+ * under a name of their own before the workers start.
+ */
+class trace_sink_t {
+public:
+  using factory_t =
+      std::function<std::shared_ptr<trace_sink_t>(const boost::property_tree::ptree& config)>;
+
+  virtual ~trace_sink_t() = default;
+
+  /**
+   * Take the spans of a traced request, called once when the request is answered
+   * @param api  the request with its spans
+   */
+  virtual void consume(const Api& api) = 0;
+
+  /**
+   * Make a sink available to httpd.service.trace_sink, replaces a sink of the same name
+   * @param name     the name in the config
+   * @param factory  makes the sink of a worker from the config
+   */
+  static void register_sink(const std::string& name, factory_t factory);
+
+  /**
+   * The sink of a worker. Without httpd.service.trace_sink it is chrome when there is a
+   * httpd.service.trace_dir and none otherwise, throws if the sink is not registered
+   * @param config  the config of the service
+   * @return the sink or nullptr if traces go nowhere
+   */
+  static std::shared_ptr<trace_sink_t> make(const boost::property_tree::ptree& config);
+};
+
+} // namespace valhalla
+
+#endif //__VALHALLA_TRACING_H__
@@ -3,7 +3,9 @@
 
 #include <boost/property_tree/ptree.hpp>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/api.pb.h>
@@ -11,6 +13,16 @@
 namespace valhalla {
 namespace tyr {
 
+#ifdef HAVE_HTTP
+/**
+ * Answer the requests of the http server with one actor, so loki, thor, odin and the serializers
+ * work on the same Api one after the other in this thread instead of passing it down the pipeline
+ * of workers. Takes the requests from loki.service.proxy like the loki workers do.
+ * @param config  used to configure the actor
+ */
+void run_service(const boost::property_tree::ptree& config);
+#endif
+
 class actor_t {
 public:
   /**
@@ -87,6 +99,20 @@ public:
                      const std::function<void()>* interrupt = nullptr,
                      Api* api = nullptr);
 
+  /**
+   * Perform the route_batch action and return newline delimited json with one route summary per
+   * source/target pair. The request may either be in the form of a json string provided by the
+   * request_str parameter or contained in the api parameter as a deserialized protobuf object
+   * @param request_str  json string if json input is being used empty otherwise
+   * @param interrupt    allows the underlying computation to be aborted via the functor throwing
+   * @param api          protobuffer object which can contain the input request via the options object
+   *                     and will be filled out as the request is processed
+   * @return newline delimited json, one line per pair
+   */
+  std::string route_batch(const std::string& request_str,
+                          const std::function<void()>* interrupt = nullptr,
+                          Api* api = nullptr);
+
   /**
    * Perform the optimized_route action and return json or protobuf depending on which was requested.
    * The request may either be in the form of a json string provided by the request_str parameter or
@@ -115,6 +141,21 @@ public:
                         const std::function<void()>* interrupt = nullptr,
                         Api* api = nullptr);
 
+  /**
+   * Perform the isochrone_batch action and return newline delimited json with the area and
+   * population within the contours of each location and, unless only those metrics are asked for,
+   * its isochrone. The request may either be in the form of a json string provided by the
+   * request_str parameter or contained in the api parameter as a deserialized protobuf object
+   * @param request_str  json string if json input is being used empty otherwise
+   * @param interrupt    allows the underlying computation to be aborted via the functor throwing
+   * @param api          protobuffer object which can contain the input request via the options object
+   *                     and will be filled out as the request is processed
+   * @return newline delimited json, one line per location
+   */
+  std::string isochrone_batch(const std::string& request_str,
+                              const std::function<void()>* interrupt = nullptr,
+                              Api* api = nullptr);
+
   /**
    * Perform the trace_route action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
@@ -143,6 +184,17 @@ public:
                                const std::function<void()>* interrupt = nullptr,
                                Api* api = nullptr);
 
+  /**
+   * Match a batch of traces on meili.batch.threads threads and return the matched edge ids of
+   * each trace in the binary record format of meili::BatchMatcher, in the order of the input.
+   * Traces that fail get a record with the error code as their status.
+   * @param traces     newline delimited trace_attributes json requests
+   * @param interrupt  allows the underlying computation to be aborted via the functor throwing
+   * @return the records of the traces
+   */
+  std::string trace_batch(const std::string& traces,
+                          const std::function<void()>* interrupt = nullptr);
+
   /**
    * Perform the height action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
@@ -171,6 +223,21 @@ public:
                                 const std::function<void()>* interrupt = nullptr,
                                 Api* api = nullptr);
 
+  /**
+   * Perform the tile action and return the edges within a web mercator tile as a Mapbox Vector
+   * Tile. The request may either be in the form of a json string provided by the request_str
+   * parameter, with the z, x and y of the tile, or contained in the api parameter as a deserialized
+   * protobuf object
+   * @param request_str  json string if json input is being used empty otherwise
+   * @param interrupt    allows the underlying computation to be aborted via the functor throwing
+   * @param api          protobuffer object which can contain the input request via the options object
+   *                     and will be filled out as the request is processed
+   * @return the encoded vector tile
+   */
+  std::string tile(const std::string& request_str,
+                   const std::function<void()>* interrupt = nullptr,
+                   Api* api = nullptr);
+
   /**
    * Perform the expansion action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
@@ -179,7 +246,7 @@ public:
    * @param interrupt    allows the underlying computation to be aborted via the functor throwing
    * @param api          protobuffer object which can contain the input request via the options object
    *                     and will be filled out as the request is processed
-   * @return json or pbf bytes depending on what was specified in the options object
+   * @return json or binary bytes depending on what was specified in the options object
    */
   std::string expansion(const std::string& request_str,
                         const std::function<void()>* interrupt = nullptr,
@@ -213,7 +280,28 @@ public:
                      const std::function<void()>* interrupt = nullptr,
                      Api* api = nullptr);
 
+  /**
+   * Perform the same action for many json requests on the calling thread and the threads of the
+   * process wide pool and return the response to each request in the order of the requests. Every
+   * thread has its own actor and the readers of those actors share one global synchronized tile
+   * cache. Requests that fail get the json error the service would respond with.
+   * @param action     the action of all the requests
+   * @param requests   json strings of the requests
+   * @param threads    most threads to use, 0 for all of the hardware threads
+   * @param interrupt  allows the underlying computations to be aborted via the functor throwing
+   * @return json or pbf bytes of every request depending on what was specified in its options
+   */
+  std::vector<std::string> batch(Options::Action action,
+                                 const std::vector<std::string>& requests,
+                                 size_t threads = 0,
+                                 const std::function<void()>* interrupt = nullptr);
+
 protected:
+  std::string dispatch(Options::Action action,
+                       const std::string& request_str,
+                       const std::function<void()>* interrupt,
+                       Api* api);
+
   struct pimpl_t;
   std::shared_ptr<pimpl_t> pimpl;
   bool auto_cleanup;
@@ -1,9 +1,12 @@
 #ifndef __VALHALLA_TYR_SERVICE_H__
 #define __VALHALLA_TYR_SERVICE_H__
 
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -27,11 +30,37 @@ namespace tyr {
  */
 std::string serializeDirections(Api& request);
 
+// About how many bytes each piece of a response that is serialized in pieces has
+constexpr size_t kResponseChunkSize = 1 << 20;
+
 /**
  * Turn a time distance matrix into json that one can look up location pair results from
  */
 std::string serializeMatrix(Api& request);
 
+/**
+ * Turn a time distance matrix into the same response as serializeMatrix but in pieces of about
+ * kResponseChunkSize bytes, so a large one can be sent on without being copied into one string
+ * @param request  The request with the matrix
+ * @return the pieces of the response in order
+ */
+std::list<std::string> serializeMatrixChunks(Api& request);
+
+/**
+ * Puts the pieces of a response back together
+ * @param chunks  The pieces in order
+ * @return the whole response
+ */
+std::string joinChunks(std::list<std::string>&& chunks);
+
+// Value of the times and distances in the binary matrix format when no route was found
+constexpr uint32_t kBinaryUnreachable = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Turn the results of a route batch into newline delimited json, one line per location pair
+ */
+std::string serializeRouteBatch(Api& request);
+
 /**
  * Turn grid data contours into geojson
  *
@@ -44,6 +73,56 @@ std::string serializeIsochrones(const Api& request,
                                 bool polygons = true,
                                 bool show_locations = false);
 
+/**
+ * Turn the grid of an isochrone into a compact raster instead of tracing its contours. The raster
+ * is cropped to the cells that are within the largest contour of any metric and is laid out in
+ * little endian as:
+ *
+ *   char[4]  "VISO"
+ *   uint8    version, currently 1
+ *   uint8    number of metrics
+ *   uint16   reserved
+ *   uint32   columns
+ *   uint32   rows
+ *   double   longitude of the west edge of the raster
+ *   double   latitude of the south edge of the raster
+ *   double   size of a cell in degrees
+ *   per metric:
+ *     uint8    metric, 0 for time and 1 for distance
+ *     uint8[3] reserved
+ *     float    seconds or meters per step of the values
+ *   the zlib compressed values, a uint16 per cell of each metric in turn, rows from south to north
+ *   and columns from west to east. kRasterUnreached marks cells beyond the largest contour.
+ *
+ * @param request    The original request
+ * @param grid       The grid of the isochrone
+ * @param intervals  The contours of the request, the raster has the metrics they use
+ */
+std::string
+serializeIsochroneRaster(const Api& request,
+                         const midgard::GriddedData<2>& grid,
+                         const std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals);
+
+// Value of the raster cells that are beyond the largest contour
+constexpr uint16_t kRasterUnreached = 65535;
+
+/**
+ * Turn the isochrones of a batch into newline delimited json, one line per location with the
+ * area and population within each of its contours and, unless only the metrics were asked for,
+ * its isochrone geojson
+ *
+ * @param request    The original request
+ * @param intervals  The contours of the request
+ * @param metrics    Per location the area in square kilometers and the population within each
+ *                   contour, empty for the locations without an isochrone
+ * @param isochrones Per location the serialized isochrone, empty if there is none
+ */
+std::string
+serializeIsochroneBatch(const Api& request,
+                        const std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
+                        const std::vector<std::vector<std::pair<double, double>>>& metrics,
+                        const std::vector<std::string>& isochrones);
+
 /**
  * Turn heights and ranges into a height response
  *
@@ -122,6 +201,44 @@ std::string serializePbf(Api& request);
  */
 void serializeWarnings(const valhalla::Api& api, rapidjson::writer_wrapper_t& writer);
 baldr::json::ArrayPtr serializeWarnings(const valhalla::Api& api);
+
+/**
+ * Turns the search effort of a verbose request into json, what each search thor ran for it cost
+ * @param api     the request with the search effort in its info
+ * @param writer  the writer to add the search_effort array to
+ */
+void serializeSearchEffort(const valhalla::Api& api, rapidjson::writer_wrapper_t& writer);
+baldr::json::ArrayPtr serializeSearchEffort(const valhalla::Api& api);
+
+/**
+ * Appends a number to the bytes of a binary response in little endian
+ * @param bytes  The response so far
+ * @param value  The number to append
+ */
+template <typename T> void write_le(std::string& bytes, T value) {
+  static_assert(std::is_integral<T>::value, "Only integers have a byte order");
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    bytes.push_back(static_cast<char>(value & 0xff));
+    value >>= 8;
+  }
+}
+inline void write_le(std::string& bytes, const float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  write_le(bytes, bits);
+}
+inline void write_le(std::string& bytes, const double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  write_le(bytes, bits);
+}
+
+/**
+ * Compresses the bytes of a binary response with a zlib wrapper
+ * @param bytes  The uncompressed bytes
+ * @return the compressed bytes
+ */
+std::string compressZlib(const std::string& bytes);
 } // namespace tyr
 } // namespace valhalla
 
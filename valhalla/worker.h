@@ -1,11 +1,21 @@
 #ifndef __VALHALLA_SERVICE_H__
 #define __VALHALLA_SERVICE_H__
+#include <array>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include <valhalla/baldr/json.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/midgard/allocations.h>
 #include <valhalla/midgard/util.h>
 #include <valhalla/proto/api.pb.h>
+#include <valhalla/result_cache.h>
+#include <valhalla/tracing.h>
 #include <valhalla/valhalla.h>
 
 #ifdef HAVE_HTTP
@@ -78,6 +88,87 @@ std::string serialize_error(const valhalla_exception_t& exception, Api& options)
 // function to add warnings to proto info object
 void add_warning(valhalla::Api& api, unsigned code);
 
+/**
+ * Time a phase of the work a stage of the pipeline does for a request. The time until the returned
+ * object goes out of scope is added to the request as the timing statistic
+ * action.info.stage.phase.latency_ms, the times of a phase that runs more than once add up.
+ * @param api    the request
+ * @param stage  the name of the stage, loki, thor or odin
+ * @param phase  the name of the phase
+ * @return an object whose destructor records the elapsed time since construction as a stat
+ */
+midgard::Finally<std::function<void()>>
+measure_phase_time(Api& api, const std::string& stage, const std::string& phase);
+
+/**
+ * Add the timing statistic action.info.stage.phase.latency_ms to the request
+ * @param api    the request
+ * @param stage  the name of the stage, loki, thor or odin
+ * @param phase  the name of the phase
+ * @param ms     how long it took in milliseconds
+ */
+void add_timing(Api& api, const std::string& stage, const std::string& phase, double ms);
+
+/**
+ * Add the count statistic action.info.stage.metric to the request
+ * @param api     the request
+ * @param stage   the name of the stage, loki, thor or odin
+ * @param metric  the name of what was counted
+ * @param value   the count
+ */
+void add_count(Api& api, const std::string& stage, const std::string& metric, double value);
+
+/**
+ * Add the count statistics action.info.stage.allocations and action.info.stage.allocated_bytes of
+ * what the calling thread allocated since some counts to the request. Nothing is added unless
+ * allocations are counted, see midgard::counting_allocations.
+ * @param api    the request
+ * @param stage  the name of the stage, with the phase if any, like thor.expansion
+ * @param since  the counts of the thread when the stage started
+ */
+void add_allocations(Api& api, const std::string& stage, const midgard::allocation_counts_t& since);
+
+/**
+ * Aggregates the statistics of the requests the process finished for verbose /status responses.
+ * Timings go into histograms and counts into totals. The statistics of a request are added once
+ * when it leaves the pipeline and the ones with the same key are summed up per request first.
+ */
+class service_metrics_t {
+public:
+  // upper bounds of the timing buckets in milliseconds, there is one more bucket for the rest
+  static constexpr std::array<double, 13> kBucketBounds{1,   2,   5,    10,   20,   50,   100,
+                                                        200, 500, 1000, 2000, 5000, 10000};
+
+  /**
+   * @return the metrics of this process
+   */
+  static service_metrics_t& get();
+
+  /**
+   * Add the statistics of a finished request
+   * @param info  the info of the request with its statistics
+   */
+  void add(const Info& info);
+
+  /**
+   * Fill out the metrics of a status response
+   * @param status  the status
+   */
+  void fill(Status& status) const;
+
+protected:
+  struct metric_t {
+    StatisticType type;
+    uint64_t requests = 0;
+    double sum = 0;
+    double max = 0;
+    std::array<uint64_t, kBucketBounds.size() + 1> buckets{};
+  };
+
+  mutable std::mutex mutex;
+  std::map<std::string, metric_t> metrics;
+};
+
 #ifdef HAVE_HTTP
 prime_server::worker_t::result_t serialize_error(const valhalla_exception_t& exception,
                                                  prime_server::http_request_info_t& request_info,
@@ -85,16 +176,67 @@ prime_server::worker_t::result_t serialize_error(const valhalla_exception_t& exc
 namespace worker {
 using content_type = prime_server::headers_t::value_type;
 const content_type JSON_MIME{"Content-type", "application/json;charset=utf-8"};
+const content_type NDJSON_MIME{"Content-type", "application/x-ndjson;charset=utf-8"};
 const content_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 const content_type PBF_MIME{"Content-type", "application/x-protobuf"};
 const content_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+const content_type BINARY_MIME{"Content-type", "application/octet-stream"};
+const content_type MVT_MIME{"Content-type", "application/vnd.mapbox-vector-tile"};
 } // namespace worker
 
 prime_server::worker_t::result_t to_response(const std::string& data,
                                              prime_server::http_request_info_t& request_info,
                                              const Api& options);
+
+/**
+ * Sends a response that was serialized in pieces with chunked transfer encoding, one message per
+ * piece, so the pieces are never copied into one string. Responses in one piece, for jsonp or for
+ * http 1.0 clients are put back together and sent like any other.
+ */
+prime_server::worker_t::result_t to_response(std::list<std::string>&& chunks,
+                                             prime_server::http_request_info_t& request_info,
+                                             const Api& options);
 #endif
 
+namespace baldr {
+class GraphReader;
+}
+
+/**
+ * Where a worker makes the Api of each of its requests. With a size in the config the Api and every
+ * message nested in it are allocated on a protobuf arena that starts in a block the worker keeps,
+ * so the messages of a request are neither allocated nor freed one by one. What the arena needs
+ * beyond that block is freed when the next request starts or the worker cleans up, so a worker
+ * never holds on to more than the block between requests. Without a size the Api is allocated on
+ * the heap like any other message.
+ */
+class request_arena_t {
+public:
+  /**
+   * Constructor
+   * @param config  the config, httpd.service.request_arena_bytes is the size of the kept block
+   */
+  explicit request_arena_t(const boost::property_tree::ptree& config);
+
+  /**
+   * Starts the next request, the Api of the previous one is freed
+   * @return an empty Api that lives until the next request starts or reset() is called
+   */
+  Api& next();
+
+  /**
+   * Frees the Api of the last request along with what the arena allocated beyond its block
+   */
+  void reset();
+
+protected:
+  size_t block_size;
+  std::unique_ptr<char[]> block;
+  std::unique_ptr<google::protobuf::Arena> arena;
+  // the Api of the last request when there is no arena
+  std::unique_ptr<Api> api;
+};
+
 struct statsd_client_t;
 class service_worker_t {
 public:
@@ -140,20 +282,35 @@ protected:
    */
   void enqueue_statistics(Api& api) const;
 
+  /**
+   * Gives the spans of a traced request to the trace sink, if there is one
+   * @param api  The request going back to the client
+   */
+  void export_trace(const Api& api) const;
+
   /**
    * Returns name of the service used in statistics
    */
   virtual std::string service_name() const = 0;
 
   /**
-   * Used to measure the time it takes to do an action in the current stage of the pipeline.
-   * This should be called at the top of the scope in each major action of each worker
+   * Used to measure the time it takes to do an action in the current stage of the pipeline and the
+   * tiles the action fetches. This should be called at the top of the scope in each major action of
+   * each worker
    *
    * @param api  The request object where we store the timing information
    * @return an object whose destructor records the elapsed time since construction as a stat
    */
   midgard::Finally<std::function<void()>> measure_scope_time(Api& api) const;
 
+  /**
+   * The reader of the worker, measure_scope_time counts the tiles it fetches and misses in its cache
+   * @return the reader, nullptr for workers without one
+   */
+  virtual const baldr::GraphReader* tile_reader() const {
+    return nullptr;
+  }
+
   /**
    * Signals the start of the worker, sends statsd message if so configured
    */
@@ -161,6 +318,14 @@ protected:
 
   const std::function<void()>* interrupt;
   std::unique_ptr<statsd_client_t> statsd_client;
+  // the Api of the request being worked on, freed on cleanup
+  request_arena_t request_arena;
+  // results of earlier requests, shared by the workers of the process, nullptr when disabled
+  std::shared_ptr<result_cache_t> result_cache;
+  // where the spans of traced requests go, nullptr when they go nowhere
+  std::shared_ptr<trace_sink_t> trace_sink;
+  // the share of the requests loki traces without being asked to
+  double trace_sample_rate;
 };
 } // namespace valhalla
 